@@ -0,0 +1,106 @@
+#! /usr/bin/env python3
+#
+# Compares two benchmark result files and flags the regressions beyond a noise threshold.
+#
+# Usage: compare-bench-results.py [--threshold PERCENT] [--counter-threshold PERCENT] BASE.json NEW.json
+#
+# Understands the JSON written by `bench-headless screen json FILE` (optionally with perf-counters),
+# as well as the JSON written by google-benchmark targets, such as `crispy_bench --benchmark_out=FILE`.
+#
+# Times are compared per iteration. Hardware event counts are far less noisy than times,
+# so they are compared against a threshold of their own.
+# The exit code is 1 if any regression was found, and 0 otherwise.
+
+import argparse
+import json
+import sys
+
+TIME_UNITS = {"ns": 1e-9, "us": 1e-6, "ms": 1e-3, "s": 1.0}
+COUNTERS = ["instructions", "cycles", "cacheMisses", "branchMisses"]
+
+
+def load_metrics(path):
+    """Returns a dict mapping each benchmark name to a dict of its metrics, per iteration."""
+    with open(path) as file:
+        document = json.load(file)
+
+    metrics = {}
+    if "results" in document:
+        # bench-headless
+        for result in document["results"]:
+            iterations = max(result["iterations"], 1)
+            values = {"seconds": result["seconds"] / iterations}
+            for counter in COUNTERS:
+                if counter in result:
+                    values[counter] = result[counter] / iterations
+            metrics[result["name"]] = values
+    elif "benchmarks" in document:
+        # google-benchmark
+        for benchmark in document["benchmarks"]:
+            if benchmark.get("run_type") == "aggregate" and benchmark.get("aggregate_name") != "median":
+                continue
+            unit = TIME_UNITS[benchmark.get("time_unit", "ns")]
+            values = {"seconds": benchmark["cpu_time"] * unit}
+            # Counters collected via --benchmark_perf_counters are already per iteration.
+            for key, value in benchmark.items():
+                if key.upper() == key and isinstance(value, (int, float)):
+                    values[key.lower()] = value
+            metrics[benchmark["name"]] = values
+    else:
+        raise SystemExit(f"{path}: Unknown benchmark result format.")
+    return metrics
+
+
+def format_value(metric, value):
+    if metric != "seconds":
+        return f"{value:.0f}" if value >= 100 else f"{value:.2f}"
+    for unit in ["s", "ms", "us", "ns"]:
+        if value >= TIME_UNITS[unit] or unit == "ns":
+            return f"{value / TIME_UNITS[unit]:.3f} {unit}"
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compares two benchmark result files.")
+    parser.add_argument("base", help="results to compare against, e.g. of the target branch")
+    parser.add_argument("new", help="results to compare, e.g. of the proposed change")
+    parser.add_argument("--threshold", type=float, default=5.0,
+                        help="percentage by which times may grow before being flagged (default: 5)")
+    parser.add_argument("--counter-threshold", type=float, default=2.0,
+                        help="percentage by which event counts may grow before being flagged (default: 2)")
+    args = parser.parse_args()
+
+    base = load_metrics(args.base)
+    new = load_metrics(args.new)
+
+    regressions = 0
+    print(f"{'benchmark':<40} {'metric':<14} {'base':>14} {'new':>14} {'change':>9}")
+    for name, new_values in new.items():
+        if name not in base:
+            print(f"{name:<40} (new)")
+            continue
+        for metric, new_value in new_values.items():
+            base_value = base[name].get(metric)
+            if base_value is None:
+                continue
+            change = (new_value - base_value) / base_value * 100.0 if base_value else 0.0
+            threshold = args.threshold if metric == "seconds" else args.counter_threshold
+            flag = ""
+            if change > threshold:
+                flag = "  REGRESSION"
+                regressions += 1
+            elif change < -threshold:
+                flag = "  improved"
+            print(f"{name:<40} {metric:<14} {format_value(metric, base_value):>14} "
+                  f"{format_value(metric, new_value):>14} {change:>+8.1f}%{flag}")
+    for name in base:
+        if name not in new:
+            print(f"{name:<40} (removed)")
+
+    print()
+    print(f"{regressions} regression(s) beyond the threshold of {args.threshold}% "
+          f"for times and {args.counter_threshold}% for event counts.")
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -46,6 +46,7 @@ optional<Action> fromString(string const& _name)
         mapAction<actions::CancelSelection>("CancelSelection"),
         mapAction<actions::ChangeProfile>("ChangeProfile"),
         mapAction<actions::ClearHistoryAndReset>("ClearHistoryAndReset"),
+        mapAction<actions::CopyLastCommandOutput>("CopyLastCommandOutput"),
         mapAction<actions::CopyPreviousMarkRange>("CopyPreviousMarkRange"),
         mapAction<actions::CopySelection>("CopySelection"),
         mapAction<actions::CreateDebugDump>("CreateDebugDump"),
@@ -66,6 +67,7 @@ optional<Action> fromString(string const& _name)
         mapAction<actions::ReloadConfig>("ReloadConfig"),
         mapAction<actions::ResetConfig>("ResetConfig"),
         mapAction<actions::ResetFontSize>("ResetFontSize"),
+        mapAction<actions::SaveScrollback>("SaveScrollback"),
         mapAction<actions::ScreenshotVT>("ScreenshotVT"),
         mapAction<actions::ScrollDown>("ScrollDown"),
         mapAction<actions::ScrollMarkDown>("ScrollMarkDown"),
@@ -75,6 +77,7 @@ optional<Action> fromString(string const& _name)
         mapAction<actions::ScrollPageDown>("ScrollPageDown"),
         mapAction<actions::ScrollPageUp>("ScrollPageUp"),
         mapAction<actions::ScrollToBottom>("ScrollToBottom"),
+        mapAction<actions::ScrollToPreviousFailedCommand>("ScrollToPreviousFailedCommand"),
         mapAction<actions::ScrollToTop>("ScrollToTop"),
         mapAction<actions::ScrollUp>("ScrollUp"),
         mapAction<actions::SearchReverse>("SearchReverse"),
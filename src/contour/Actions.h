@@ -26,6 +26,7 @@ namespace contour::actions
 struct CancelSelection{};
 struct ChangeProfile{ std::string name; };
 struct ClearHistoryAndReset{};
+struct CopyLastCommandOutput{};
 struct CopyPreviousMarkRange{};
 struct CopySelection{};
 struct CreateDebugDump{};
@@ -46,6 +47,7 @@ struct Quit{};
 struct ReloadConfig{ std::optional<std::string> profileName; };
 struct ResetConfig{};
 struct ResetFontSize{};
+struct SaveScrollback{ std::string format = "text"; };
 struct ScreenshotVT{};
 struct ScrollDown{};
 struct ScrollMarkDown{};
@@ -55,6 +57,7 @@ struct ScrollOneUp{};
 struct ScrollPageDown{};
 struct ScrollPageUp{};
 struct ScrollToBottom{};
+struct ScrollToPreviousFailedCommand{};
 struct ScrollToTop{};
 struct ScrollUp{};
 struct SearchReverse{};
@@ -75,6 +78,7 @@ struct WriteScreen{ std::string chars; }; // "\033[2J\033[3J"
 using Action = std::variant<CancelSelection,
                             ChangeProfile,
                             ClearHistoryAndReset,
+                            CopyLastCommandOutput,
                             CopyPreviousMarkRange,
                             CopySelection,
                             CreateDebugDump,
@@ -95,6 +99,7 @@ using Action = std::variant<CancelSelection,
                             ReloadConfig,
                             ResetConfig,
                             ResetFontSize,
+                            SaveScrollback,
                             ScreenshotVT,
                             ScrollDown,
                             ScrollMarkDown,
@@ -104,6 +109,7 @@ using Action = std::variant<CancelSelection,
                             ScrollPageDown,
                             ScrollPageUp,
                             ScrollToBottom,
+                            ScrollToPreviousFailedCommand,
                             ScrollToTop,
                             ScrollUp,
                             SearchReverse,
@@ -143,6 +149,7 @@ std::optional<Action> fromString(std::string const& _name);
 // {{{ declare
 DECLARE_ACTION_FMT(CancelSelection)
 DECLARE_ACTION_FMT(ChangeProfile)
+DECLARE_ACTION_FMT(CopyLastCommandOutput)
 DECLARE_ACTION_FMT(CopyPreviousMarkRange)
 DECLARE_ACTION_FMT(CopySelection)
 DECLARE_ACTION_FMT(DecreaseFontSize)
@@ -162,6 +169,7 @@ DECLARE_ACTION_FMT(Quit)
 DECLARE_ACTION_FMT(ReloadConfig)
 DECLARE_ACTION_FMT(ResetConfig)
 DECLARE_ACTION_FMT(ResetFontSize)
+DECLARE_ACTION_FMT(SaveScrollback)
 DECLARE_ACTION_FMT(ScreenshotVT)
 DECLARE_ACTION_FMT(ScrollDown)
 DECLARE_ACTION_FMT(ScrollMarkDown)
@@ -171,6 +179,7 @@ DECLARE_ACTION_FMT(ScrollOneUp)
 DECLARE_ACTION_FMT(ScrollPageDown)
 DECLARE_ACTION_FMT(ScrollPageUp)
 DECLARE_ACTION_FMT(ScrollToBottom)
+DECLARE_ACTION_FMT(ScrollToPreviousFailedCommand)
 DECLARE_ACTION_FMT(ScrollToTop)
 DECLARE_ACTION_FMT(ScrollUp)
 DECLARE_ACTION_FMT(SearchReverse)
@@ -208,6 +217,7 @@ struct formatter<contour::actions::Action>
         // {{{ handle
         HANDLE_ACTION(CancelSelection);
         HANDLE_ACTION(ChangeProfile);
+        HANDLE_ACTION(CopyLastCommandOutput);
         HANDLE_ACTION(CopyPreviousMarkRange);
         HANDLE_ACTION(CopySelection);
         HANDLE_ACTION(DecreaseFontSize);
@@ -227,6 +237,7 @@ struct formatter<contour::actions::Action>
         HANDLE_ACTION(ReloadConfig);
         HANDLE_ACTION(ResetConfig);
         HANDLE_ACTION(ResetFontSize);
+        HANDLE_ACTION(SaveScrollback);
         HANDLE_ACTION(ScreenshotVT);
         HANDLE_ACTION(ScrollDown);
         HANDLE_ACTION(ScrollMarkDown);
@@ -236,6 +247,7 @@ struct formatter<contour::actions::Action>
         HANDLE_ACTION(ScrollPageDown);
         HANDLE_ACTION(ScrollPageUp);
         HANDLE_ACTION(ScrollToBottom);
+        HANDLE_ACTION(ScrollToPreviousFailedCommand);
         HANDLE_ACTION(ScrollToTop);
         HANDLE_ACTION(ScrollUp);
         HANDLE_ACTION(SearchReverse);
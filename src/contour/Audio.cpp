@@ -16,6 +16,9 @@ namespace
 {
 constexpr double SAMPLE_RATE = 44100;
 
+// About 20ms of samples, such that notes start playing right away.
+constexpr int LOW_LATENCY_BUFFER_SIZE = 1764;
+
 // TODO make this function constexpr when we switch to c++23
 double square_wave(double x) noexcept
 {
@@ -39,6 +42,37 @@ auto createMusicalNote(double volume, double duration, double frequency) noexcep
 
 Audio::Audio()
 {
+    qRegisterMetaType<std::vector<int>>();
+    soundThreadContext_.moveToThread(&soundThread_);
+    connect(this,
+            &Audio::play,
+            &soundThreadContext_,
+            [this](int volume, int duration, std::vector<int> const& notes) {
+                handlePlayback(volume, duration, notes);
+            });
+    soundThread_.start();
+}
+
+Audio::~Audio()
+{
+    // The audio output must be destroyed on the thread it has been created on.
+    QMetaObject::invokeMethod(
+        &soundThreadContext_,
+        [this]() {
+            audio.reset();
+            audioBuffer_.reset();
+        },
+        Qt::BlockingQueuedConnection);
+    soundThread_.quit();
+    soundThread_.wait();
+}
+
+bool Audio::initialize()
+{
+    if (initialized_)
+        return audio != nullptr;
+    initialized_ = true;
+
     QAudioFormat f;
     f.setSampleRate(44100);
     f.setChannelCount(1);
@@ -57,7 +91,7 @@ Audio::Audio()
     if (!info.isFormatSupported(f))
     {
         errorlog()("Default output device doesn't support 16 Bit signed integer PCM");
-        return;
+        return false;
     }
 
 #if QT_VERSION < 0x060000
@@ -65,42 +99,42 @@ Audio::Audio()
 #endif
 
     audio = std::make_unique<QAudioSink>(f);
-
-    audio->moveToThread(&soundThread_);
-
-    connect(audio.get(), &QAudioSink::stateChanged, this, &Audio::handleStateChanged);
-    qRegisterMetaType<std::vector<int>>();
-    connect(this, &Audio::play, this, &Audio::handlePlayback);
-    soundThread_.start();
+    audio->setBufferSize(LOW_LATENCY_BUFFER_SIZE);
+    connect(audio.get(), &QAudioSink::stateChanged, &soundThreadContext_, [this](QAudio::State state) {
+        handleStateChanged(state);
+    });
+    audioBuffer_ = std::make_unique<QBuffer>();
+    return true;
 }
 
-Audio::~Audio()
+void Audio::fillBuffer(int volume, int duration, gsl::span<int const> notes)
 {
-    soundThread_.quit();
-    soundThread_.wait();
+    for (auto const i: notes)
+        byteArray_.append(musicalNote(volume, duration, i));
 }
 
-void Audio::fillBuffer(int volume, int duration, gsl::span<int const> notes)
+QByteArray const& Audio::musicalNote(int volume, int duration, int note_)
 {
-    for (auto const i: notes)
-    {
-        auto b = createMusicalNote(volume, duration, i);
-        byteArray_.append(reinterpret_cast<char const*>(b.data()), static_cast<int>(2 * b.size()));
-    }
+    auto const key = (uint64_t { static_cast<uint16_t>(volume) } << 48)
+                     | (uint64_t { static_cast<uint32_t>(duration) } << 16) | static_cast<uint16_t>(note_);
+    return notes_.get_or_emplace(key, [&]() {
+        auto const samples = createMusicalNote(volume, duration, note_);
+        return QByteArray(reinterpret_cast<char const*>(samples.data()),
+                          static_cast<int>(samples.size() * sizeof(int16_t)));
+    });
 }
 
 void Audio::handlePlayback(int volume, int duration, std::vector<int> const& notes)
 {
-    Require(audio);
-    if (audio->state() == QAudio::State::ActiveState)
-    {
-        fillBuffer(volume, duration, gsl::span(notes.data(), notes.size()));
+    if (!initialize())
         return;
-    }
+
     fillBuffer(volume, duration, gsl::span(notes.data(), notes.size()));
-    audioBuffer_.setBuffer(&byteArray_);
-    audioBuffer_.open(QIODevice::ReadWrite);
-    audio->start(&audioBuffer_);
+    if (audio->state() == QAudio::State::ActiveState)
+        return;
+    audioBuffer_->setBuffer(&byteArray_);
+    audioBuffer_->open(QIODevice::ReadOnly);
+    audio->start(audioBuffer_.get());
 }
 
 void Audio::handleStateChanged(QAudio::State state)
@@ -109,7 +143,7 @@ void Audio::handleStateChanged(QAudio::State state)
     {
         case QAudio::IdleState:
             audio->stop();
-            audioBuffer_.close();
+            audioBuffer_->close();
             byteArray_.clear();
             break;
 
@@ -1,8 +1,12 @@
 #pragma once
 
+#include <crispy/LRUCache.h>
+
 #include <gsl/span>
 
+#include <cstdint>
 #include <memory>
+#include <vector>
 
 #include <qbuffer.h>
 #include <qthread.h>
@@ -14,6 +18,12 @@
 #endif
 namespace contour
 {
+// Plays the notes requested by DECPS on a thread of its own.
+//
+// Requests are queued to the sound thread, which sets up the audio output on first use,
+// such that neither the GUI thread nor the terminal's parse thread ever wait for audio.
+// The synthesized samples of recently played notes are cached, as applications tend to play
+// the same few notes over and over again.
 class Audio: public QObject
 {
     Q_OBJECT
@@ -23,17 +33,22 @@ class Audio: public QObject
     ~Audio() override;
   signals:
     void play(int volume, int duration, std::vector<int> const& notes);
-  private slots:
-    void handleStateChanged(QAudio::State state);
-    void handlePlayback(int volume, int duration, std::vector<int> const& notes);
 
   private:
+    // The following are only ever called on the sound thread.
+    bool initialize();
+    void handleStateChanged(QAudio::State state);
+    void handlePlayback(int volume, int duration, std::vector<int> const& notes);
     void fillBuffer(int volume, int duration, gsl::span<const int> notes);
+    QByteArray const& musicalNote(int volume, int duration, int note_);
     std::vector<std::int16_t> createMusicalNote(double volume, int duration, int note_) noexcept;
 
-    QByteArray byteArray_;
-    QBuffer audioBuffer_;
     QThread soundThread_;
+    QObject soundThreadContext_; // lives on the sound thread, receiving the playback requests
+    bool initialized_ = false;
+    crispy::LRUCache<uint64_t, QByteArray> notes_ { 32 }; // samples by volume, duration, and note
+    QByteArray byteArray_;
+    std::unique_ptr<QBuffer> audioBuffer_;
 #if QT_VERSION >= 0x060000
     std::unique_ptr<QAudioSink> audio;
 #else
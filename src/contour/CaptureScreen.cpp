@@ -17,11 +17,17 @@
 #include <terminal/Parser.h>
 #include <terminal/ParserEvents.h>
 
+#include <crispy/CacheStats.h>
+#include <crispy/MemoryStats.h>
+#include <crispy/LatencyHistogram.h>
 #include <crispy/utils.h>
 
 #include <fmt/format.h>
 
 #include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
 #include <cstdlib>
 #include <fstream>
 #include <functional>
@@ -32,6 +38,7 @@
 #include <string>
 #include <string_view>
 #include <tuple>
+#include <vector>
 
 // clang-format off
 #if defined(_WIN32)
@@ -92,19 +99,143 @@ class CaptureBufferCollector: public terminal::NullParserEvents
         if (code == terminal::CaptureBufferCode)
         {
             auto const payload = string_view(capturedBuffer.data() + offset, capturedBuffer.size() - offset);
+            if (payload.empty())
+                done = true;
             if (splitByWord)
-            {
-                crispy::split(payload, ' ', [&](auto word) -> bool {
-                    output.write(word.data(), static_cast<streamsize>(word.size()));
-                    output << '\n';
-                    return true;
-                });
-            }
+                writeWords(payload);
             else
                 output.write(payload.data(), static_cast<streamsize>(payload.size()));
-            if (payload.size() == 0)
-                done = true;
+
+            // The capture is streamed in chunks, so they are written out as they arrive.
+            output.flush();
+        }
+    }
+
+  private:
+    void writeWords(string_view _payload)
+    {
+        // The last word of a chunk may continue in the next chunk.
+        pendingWords += _payload;
+        auto const end = done ? pendingWords.size() : pendingWords.rfind(' ');
+        if (end == std::string::npos)
+            return;
+
+        crispy::split(string_view(pendingWords).substr(0, end), ' ', [&](auto word) -> bool {
+            output.write(word.data(), static_cast<streamsize>(word.size()));
+            output << '\n';
+            return true;
+        });
+        pendingWords.erase(0, done ? end : end + 1);
+    }
+
+    std::string pendingWords;
+};
+
+class InputLatencyCollector: public terminal::NullParserEvents
+{
+  public:
+    std::string capturedBuffer;
+    std::optional<crispy::LatencyHistogram::Summary> summary;
+
+    void startPM() override { capturedBuffer.clear(); }
+    void putPM(char t) override { capturedBuffer += t; }
+
+    void dispatchPM() override
+    {
+        // PM 315 ; count ; p50 ; p90 ; p99 ; max ST, with all durations in microseconds.
+        auto const [code, offset] = terminal::parser::extractCodePrefix(capturedBuffer);
+        if (code != terminal::InputLatencyCode)
+            return;
+
+        auto const fields = crispy::split(string_view(capturedBuffer).substr(offset), ';');
+        if (fields.size() != 5)
+            return;
+        auto values = std::array<uint64_t, 5> {};
+        for (size_t i = 0; i < fields.size(); ++i)
+            values[i] = crispy::to_integer<10, uint64_t>(fields[i]).value_or(0);
+
+        using std::chrono::microseconds;
+        summary = crispy::LatencyHistogram::Summary { static_cast<size_t>(values[0]),
+                                                      microseconds(values[1]),
+                                                      microseconds(values[2]),
+                                                      microseconds(values[3]),
+                                                      microseconds(values[4]) };
+    }
+};
+
+class CacheStatsCollector: public terminal::NullParserEvents
+{
+  public:
+    std::string capturedBuffer;
+    std::vector<crispy::CacheStats::Snapshot> caches;
+    bool done = false;
+
+    void startPM() override { capturedBuffer.clear(); }
+    void putPM(char t) override { capturedBuffer += t; }
+
+    void dispatchPM() override
+    {
+        // PM 316 ; name ; hits ; misses ; evictions ; size ; capacity ST for each cache,
+        // terminated by an empty PM 316 ST.
+        auto const [code, offset] = terminal::parser::extractCodePrefix(capturedBuffer);
+        if (code != terminal::CacheStatsCode)
+            return;
+
+        auto const payload = string_view(capturedBuffer).substr(offset);
+        if (payload.empty())
+        {
+            done = true;
+            return;
         }
+
+        auto const fields = crispy::split(payload, ';');
+        if (fields.size() != 6)
+            return;
+
+        auto const number = [&](size_t i) {
+            return crispy::to_integer<10, uint64_t>(fields[i]).value_or(0);
+        };
+        caches.emplace_back(crispy::CacheStats::Snapshot { string(fields[0]),
+                                                           number(1),
+                                                           number(2),
+                                                           number(3),
+                                                           static_cast<size_t>(number(4)),
+                                                           static_cast<size_t>(number(5)) });
+    }
+};
+
+class MemoryStatsCollector: public terminal::NullParserEvents
+{
+  public:
+    std::string capturedBuffer;
+    std::vector<crispy::MemoryStats::Snapshot> subsystems;
+    bool done = false;
+
+    void startPM() override { capturedBuffer.clear(); }
+    void putPM(char t) override { capturedBuffer += t; }
+
+    void dispatchPM() override
+    {
+        // PM 317 ; name ; bytes ; count ST for each subsystem, terminated by an empty PM 317 ST.
+        auto const [code, offset] = terminal::parser::extractCodePrefix(capturedBuffer);
+        if (code != terminal::MemoryStatsCode)
+            return;
+
+        auto const payload = string_view(capturedBuffer).substr(offset);
+        if (payload.empty())
+        {
+            done = true;
+            return;
+        }
+
+        auto const fields = crispy::split(payload, ';');
+        if (fields.size() != 3)
+            return;
+
+        auto const number = [&](size_t i) {
+            return static_cast<size_t>(crispy::to_integer<10, uint64_t>(fields[i]).value_or(0));
+        };
+        subsystems.emplace_back(crispy::MemoryStats::Snapshot { string(fields[0]), number(1), number(2) });
     }
 };
 
@@ -258,13 +389,16 @@ namespace
         }
     };
 
-    // Reads a response chunk.
-    bool readCaptureReply(TTY& _input, timeval* timeout, bool words, ostream& output)
+    // Reads the reply to a request, until @p _done returns true.
+    template <typename Done>
+    bool readReply(TTY& _input,
+                   timeval* timeout,
+                   terminal::ParserEvents& _collector,
+                   string_view _request,
+                   Done const& _done)
     {
-        auto captureBufferCollector = CaptureBufferCollector { output, words };
-        auto parser = terminal::parser::Parser<terminal::ParserEvents> { captureBufferCollector };
+        auto parser = terminal::parser::Parser<terminal::ParserEvents> { _collector };
 
-        // Response is of format: PM 314 ; <screen capture> ST`
         while (true)
         {
             int rv = _input.wait(timeout);
@@ -275,7 +409,7 @@ namespace
             }
             else if (rv == 0)
             {
-                cerr << "Time out. VTE did not respond to CAPTURE `CSI > Ps ; Ps t`.\r\n";
+                cerr << fmt::format("Time out. VTE did not respond to {}.\r\n", _request);
                 return false;
             }
 
@@ -290,10 +424,31 @@ namespace
             auto const inputView = string_view(buf, static_cast<size_t>(rv));
             parser.parseFragment(inputView);
 
-            if (captureBufferCollector.done)
+            if (_done())
                 return true;
         }
     }
+
+    // Reads a response chunk.
+    bool readCaptureReply(TTY& _input, timeval* timeout, bool words, ostream& output)
+    {
+        auto captureBufferCollector = CaptureBufferCollector { output, words };
+
+        // Response is of format: PM 314 ; <screen capture> ST`
+        return readReply(_input, timeout, captureBufferCollector, "CAPTURE `CSI > Ps ; Ps t`", [&]() {
+            return captureBufferCollector.done;
+        });
+    }
+
+    timeval toTimeval(double _seconds)
+    {
+        auto constexpr MicrosPerSecond = 1'000'000;
+        auto const timeoutMicros = int(_seconds * MicrosPerSecond);
+        auto timeout = timeval {};
+        timeout.tv_sec = timeoutMicros / MicrosPerSecond;
+        timeout.tv_usec = timeoutMicros % MicrosPerSecond;
+        return timeout;
+    }
 } // namespace
 
 bool captureScreen(CaptureSettings const& _settings)
@@ -302,11 +457,7 @@ bool captureScreen(CaptureSettings const& _settings)
     if (!tty.configured)
         return false;
 
-    auto constexpr MicrosPerSecond = 1'000'000;
-    auto const timeoutMicros = int(_settings.timeout * MicrosPerSecond);
-    auto timeout = timeval {};
-    timeout.tv_sec = timeoutMicros / MicrosPerSecond;
-    timeout.tv_usec = timeoutMicros % MicrosPerSecond;
+    auto timeout = toTimeval(_settings.timeout);
 
     auto const screenSizeOpt = tty.screenSize(&timeout);
     if (!screenSizeOpt.has_value())
@@ -339,4 +490,65 @@ bool captureScreen(CaptureSettings const& _settings)
     return readCaptureReply(tty, &timeout, _settings.words, output);
 }
 
+bool reportInputLatency(InputLatencySettings const& _settings)
+{
+    auto tty = TTY {};
+    if (!tty.configured)
+        return false;
+
+    auto timeout = toTimeval(_settings.timeout);
+
+    tty.write(fmt::format("\033[>{}z", _settings.reset ? '1' : '0'));
+
+    auto collector = InputLatencyCollector {};
+    if (!readReply(tty, &timeout, collector, "XTLATENCY `CSI > Ps z`", [&]() {
+            return collector.summary.has_value();
+        }))
+        return false;
+
+    cout << fmt::format("Key press to echo presentation latency: {}\n", *collector.summary);
+    return true;
+}
+
+bool reportCacheStats(CacheStatsSettings const& _settings)
+{
+    auto tty = TTY {};
+    if (!tty.configured)
+        return false;
+
+    auto timeout = toTimeval(_settings.timeout);
+
+    tty.write("\033[>y");
+
+    auto collector = CacheStatsCollector {};
+    if (!readReply(tty, &timeout, collector, "XTCACHESTATS `CSI > y`", [&]() { return collector.done; }))
+        return false;
+
+    for (auto const& stats: collector.caches)
+        cout << fmt::format("{}\n", stats);
+    return true;
+}
+
+bool reportMemoryStats(MemoryStatsSettings const& _settings)
+{
+    auto tty = TTY {};
+    if (!tty.configured)
+        return false;
+
+    auto timeout = toTimeval(_settings.timeout);
+
+    tty.write("\033[>w");
+
+    auto collector = MemoryStatsCollector {};
+    if (!readReply(tty, &timeout, collector, "XTMEMSTATS `CSI > w`", [&]() { return collector.done; }))
+        return false;
+
+    for (auto const& stats: collector.subsystems)
+        cout << fmt::format("{}\n", stats);
+    cout << fmt::format("Total: {}\n",
+                        crispy::humanReadableBytes(
+                            static_cast<long double>(crispy::MemoryStats::totalBytes(collector.subsystems))));
+    return true;
+}
+
 } // namespace contour
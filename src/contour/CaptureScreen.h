@@ -32,4 +32,29 @@ struct CaptureSettings
 
 bool captureScreen(CaptureSettings const& _settings);
 
+struct InputLatencySettings
+{
+    bool reset = false;    // resets the statistics after reporting them
+    double timeout = 1.0f; // seconds to wait for the terminal to respond
+};
+
+/// Prints the percentiles of the key press to echo presentation latency measured by the connected terminal.
+bool reportInputLatency(InputLatencySettings const& _settings);
+
+struct CacheStatsSettings
+{
+    double timeout = 1.0f; // seconds to wait for the terminal to respond
+};
+
+/// Prints the hit, miss, and eviction counts of all caches of the connected terminal's process.
+bool reportCacheStats(CacheStatsSettings const& _settings);
+
+struct MemoryStatsSettings
+{
+    double timeout = 1.0f; // seconds to wait for the terminal to respond
+};
+
+/// Prints the memory usage by subsystem, summed up over all sessions of the connected terminal's process.
+bool reportMemoryStats(MemoryStatsSettings const& _settings);
+
 } // namespace contour
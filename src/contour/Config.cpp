@@ -14,11 +14,14 @@
 #include "Config.h"
 
 #include <terminal/ControlCode.h>
+#include <terminal/HistoryExport.h>
 #include <terminal/InputGenerator.h>
 #include <terminal/Process.h>
 
 #include <text_shaper/mock_font_locator.h>
 
+#include <crispy/LogRingBuffer.h>
+#include <crispy/StartupTrace.h>
 #include <crispy/escape.h>
 #include <crispy/logstore.h>
 #include <crispy/overloaded.h>
@@ -334,7 +337,13 @@ namespace // {{{ helper
         return tryLoadChild(_usedKeys, _doc, _parentPath, _key, _store.value);
     }
 
-    void checkForSuperfluousKeys(YAML::Node _root, string const& _prefix, UsedKeys const& _usedKeys)
+    /// Reports the keys below @p _root that have not been used.
+    ///
+    /// @param _deferredKeys keys whose children are checked only once they get parsed on first use.
+    void checkForSuperfluousKeys(YAML::Node _root,
+                                 string const& _prefix,
+                                 UsedKeys const& _usedKeys,
+                                 UsedKeys const& _deferredKeys = {})
     {
         if (_root.IsMap())
         {
@@ -343,7 +352,8 @@ namespace // {{{ helper
                 auto const name = mapItem.first.as<string>();
                 auto const child = mapItem.second;
                 auto const prefix = _prefix.empty() ? name : fmt::format("{}.{}", _prefix, name);
-                checkForSuperfluousKeys(child, prefix, _usedKeys);
+                if (!_deferredKeys.count(prefix))
+                    checkForSuperfluousKeys(child, prefix, _usedKeys, _deferredKeys);
                 if (_usedKeys.count(prefix))
                     continue;
                 if (crispy::startsWith(string_view(prefix), "x-"sv))
@@ -355,7 +365,8 @@ namespace // {{{ helper
         {
             for (size_t i = 0; i < _root.size() && i < 8; ++i)
             {
-                checkForSuperfluousKeys(_root[i], fmt::format("{}.{}", _prefix, i), _usedKeys);
+                auto const prefix = fmt::format("{}.{}", _prefix, i);
+                checkForSuperfluousKeys(_root[i], prefix, _usedKeys, _deferredKeys);
             }
         }
 #if 0
@@ -369,9 +380,11 @@ namespace // {{{ helper
 #endif
     }
 
-    void checkForSuperfluousKeys(YAML::Node const& _root, UsedKeys const& _usedKeys)
+    void checkForSuperfluousKeys(YAML::Node const& _root,
+                                 UsedKeys const& _usedKeys,
+                                 UsedKeys const& _deferredKeys)
     {
-        checkForSuperfluousKeys(_root, "", _usedKeys);
+        checkForSuperfluousKeys(_root, "", _usedKeys, _deferredKeys);
     }
 
     optional<std::string> readFile(FileSystem::path const& _path)
@@ -778,6 +791,22 @@ namespace // {{{ helper
                 return action;
         }
 
+        if (holds_alternative<actions::SaveScrollback>(action))
+        {
+            if (auto format = _parent["format"]; format && format.IsScalar())
+            {
+                _usedKeys.emplace(_prefix + ".format");
+                if (!terminal::parseHistoryExportFormat(format.as<string>()))
+                {
+                    cerr << "Unknown scrollback format: '" << format.as<string>() << '\'' << endl;
+                    return nullopt;
+                }
+                return actions::SaveScrollback { format.as<string>() };
+            }
+            else
+                return action;
+        }
+
         if (holds_alternative<actions::SendChars>(action))
         {
             if (auto chars = _parent["chars"]; chars.IsScalar())
@@ -863,6 +892,29 @@ FileSystem::path configHome()
     return configHome("contour");
 }
 
+FileSystem::path cacheHome()
+{
+#if defined(__unix__) || defined(__APPLE__)
+    if (auto const* value = getenv("XDG_CACHE_HOME"); value && *value)
+        return FileSystem::path { value } / "contour";
+    else if (auto const* value = getenv("HOME"); value && *value)
+        return FileSystem::path { value } / ".cache" / "contour";
+#endif
+
+#if defined(_WIN32)
+    DWORD size = GetEnvironmentVariable("LOCALAPPDATA", nullptr, 0);
+    if (size)
+    {
+        std::vector<char> buf;
+        buf.resize(size);
+        GetEnvironmentVariable("LOCALAPPDATA", &buf[0], size);
+        return FileSystem::path { &buf[0] } / "contour" / "cache";
+    }
+#endif
+
+    return FileSystem::temp_directory_path() / "contour";
+}
+
 std::string defaultConfigString()
 {
     QFile file(":/contour/contour.yml");
@@ -895,6 +947,50 @@ Config loadConfig()
     return loadConfigFromFile(defaultConfigFilePath());
 }
 
+vector<string> Config::profileNames() const
+{
+    auto names = vector<string> {};
+    names.reserve(profiles.size() + profileLoaders.size());
+    for (auto const& profile: profiles)
+        names.emplace_back(profile.first);
+    for (auto const& loader: profileLoaders)
+        names.emplace_back(loader.first);
+    sort(names.begin(), names.end());
+    return names;
+}
+
+terminal::ColorPalette const* Config::colorscheme(string const& _name)
+{
+    if (auto i = colorschemes.find(_name); i != colorschemes.end())
+        return &i->second;
+
+    auto loader = colorschemeLoaders.find(_name);
+    if (loader == colorschemeLoaders.end())
+        return nullptr;
+
+    auto colorscheme = loader->second();
+    colorschemeLoaders.erase(loader);
+    return &(colorschemes[_name] = std::move(colorscheme));
+}
+
+TerminalProfile* Config::profile(string const& _name)
+{
+    assert(_name != "");
+    if (auto i = profiles.find(_name); i != profiles.end())
+        return &i->second;
+
+    if (auto loader = profileLoaders.find(_name); loader != profileLoaders.end())
+    {
+        ConfigLog()("Parsing profile {} on first use.", _name);
+        auto load = std::move(loader->second);
+        profileLoaders.erase(loader);
+        return &(profiles[_name] = load(*this));
+    }
+
+    assert(false && "Profile not found.");
+    return nullptr;
+}
+
 Config loadConfigFromFile(FileSystem::path const& _fileName)
 {
     Config config {};
@@ -1213,7 +1309,7 @@ TerminalProfile loadTerminalProfile(UsedKeys& _usedKeys,
                                     YAML::Node const& _profile,
                                     std::string const& _parentPath,
                                     std::string const& _profileName,
-                                    unordered_map<string, terminal::ColorPalette> const& _colorschemes)
+                                    Config& _config)
 {
     auto profile = TerminalProfile {};
 
@@ -1223,10 +1319,10 @@ TerminalProfile loadTerminalProfile(UsedKeys& _usedKeys,
         auto const path = fmt::format("{}.{}.{}", _parentPath, _profileName, "colors");
         if (colors.IsMap())
             profile.colors = loadColorScheme(_usedKeys, path, colors);
-        else if (auto i = _colorschemes.find(colors.as<string>()); i != _colorschemes.end())
+        else if (auto const* colorscheme = _config.colorscheme(colors.as<string>()); colorscheme)
         {
             _usedKeys.emplace(path);
-            profile.colors = i->second;
+            profile.colors = *colorscheme;
         }
         else if (colors.IsScalar())
         {
@@ -1514,7 +1610,7 @@ TerminalProfile loadTerminalProfile(UsedKeys& _usedKeys,
     auto const static renderModeMap = array {
         pair { "lcd"sv, text::render_mode::lcd },           pair { "light"sv, text::render_mode::light },
         pair { "gray"sv, text::render_mode::gray },         pair { ""sv, text::render_mode::gray },
-        pair { "monochrome"sv, text::render_mode::bitmap },
+        pair { "monochrome"sv, text::render_mode::bitmap }, pair { "sdf"sv, text::render_mode::sdf },
     };
 
     auto const i = crispy::find_if(renderModeMap, [&](auto m) { return m.first == strValue; });
@@ -1533,6 +1629,14 @@ TerminalProfile loadTerminalProfile(UsedKeys& _usedKeys,
     else
         profile.maxHistoryLineCount = LineCount(0);
 
+    intValue = LineCount(-1);
+    tryLoadChildRelative(_usedKeys, _profile, basePath, "history.compact_after", intValue);
+    // value -1 is used for never compacting the history
+    if (unbox<int>(intValue) > -1)
+        profile.historyCompactionThreshold = LineCount(intValue);
+    else
+        profile.historyCompactionThreshold = std::nullopt;
+
     strValue = fmt::format("{}", ScrollBarPosition::Right);
     if (tryLoadChildRelative(_usedKeys, _profile, basePath, "scrollbar.position", strValue))
     {
@@ -1622,6 +1726,7 @@ TerminalProfile loadTerminalProfile(UsedKeys& _usedKeys,
  */
 void loadConfigFromFile(Config& _config, FileSystem::path const& _fileName)
 {
+    auto const _ = crispy::StartupTrace::Scope("Load configuration");
     ConfigLog()("Loading configuration from file: {}", _fileName.string());
     _config.backingFilePath = _fileName;
     createFileIfNotExists(_config.backingFilePath);
@@ -1690,6 +1795,10 @@ void loadConfigFromFile(Config& _config, FileSystem::path const& _fileName)
 
     tryLoadValue(usedKeys, doc, "spawn_new_process", _config.spawnNewProcess);
 
+    tryLoadValue(usedKeys, doc, "prespawned_shells", _config.prespawnedShells);
+
+    tryLoadValue(usedKeys, doc, "tmux_control_mode", _config.tmuxControlMode);
+
     tryLoadValue(usedKeys, doc, "live_config", _config.live);
 
     auto logEnabled = false;
@@ -1698,6 +1807,9 @@ void loadConfigFromFile(Config& _config, FileSystem::path const& _fileName)
     auto logFilePath = ""s;
     tryLoadValue(usedKeys, doc, "logging.file", logFilePath);
 
+    auto logBuffered = false;
+    tryLoadValue(usedKeys, doc, "logging.buffered", logBuffered);
+
     if (logEnabled)
     {
         logFilePath =
@@ -1706,16 +1818,33 @@ void loadConfigFromFile(Config& _config, FileSystem::path const& _fileName)
 
         if (!logFilePath.empty())
         {
-            _config.loggingSink = make_shared<logstore::Sink>(logEnabled, make_shared<ofstream>(logFilePath));
+            auto logFile = make_shared<ofstream>(logFilePath);
+            if (logBuffered)
+                _config.loggingSink = make_shared<logstore::Sink>(
+                    logEnabled,
+                    logstore::RingBufferWriter::create([logFile](string_view const& _text) {
+                        // Only invoked on the ring buffer's flusher thread, off the logging threads.
+                        *logFile << _text;
+                        logFile->flush();
+                    }));
+            else
+                _config.loggingSink = make_shared<logstore::Sink>(logEnabled, logFile);
             logstore::set_sink(*_config.loggingSink);
         }
     }
 
     tryLoadValue(usedKeys, doc, "images.sixel_scrolling", _config.sixelScrolling);
+    tryLoadValue(usedKeys, doc, "images.sixel_progressive", _config.sixelProgressive);
+    tryLoadValue(usedKeys, doc, "images.sixel_decoder_threads", _config.sixelDecoderThreads);
+    tryLoadValue(usedKeys, doc, "images.rasterizer_threads", _config.imageRasterizerThreads);
+    tryLoadValue(usedKeys, doc, "images.memory_budget", _config.imageMemoryBudget);
     tryLoadValue(usedKeys, doc, "images.sixel_register_count", _config.maxImageColorRegisters);
     tryLoadValue(usedKeys, doc, "images.max_width", _config.maxImageSize.width);
     tryLoadValue(usedKeys, doc, "images.max_height", _config.maxImageSize.height);
 
+    // Color schemes and profiles are only parsed on first use, and so are their keys checked.
+    auto deferredKeys = UsedKeys {};
+
     if (auto colorschemes = doc["color_schemes"]; colorschemes)
     {
         usedKeys.emplace("color_schemes");
@@ -1723,7 +1852,15 @@ void loadConfigFromFile(Config& _config, FileSystem::path const& _fileName)
         {
             auto const name = i->first.as<string>();
             auto const path = "color_schemes." + name;
-            _config.colorschemes[name] = loadColorScheme(usedKeys, path, i->second);
+            usedKeys.emplace(path);
+            deferredKeys.emplace(path);
+            _config.colorschemes.erase(name);
+            _config.colorschemeLoaders[name] = [path, node = i->second]() {
+                auto usedColorKeys = UsedKeys {};
+                auto colorscheme = loadColorScheme(usedColorKeys, path, node);
+                checkForSuperfluousKeys(node, path, usedColorKeys);
+                return colorscheme;
+            };
         }
     }
 
@@ -1745,7 +1882,19 @@ void loadConfigFromFile(Config& _config, FileSystem::path const& _fileName)
 
     tryLoadValue(usedKeys, doc, "renderer.tile_hashtable_slots", _config.textureAtlasHashtableSlots.value);
     tryLoadValue(usedKeys, doc, "renderer.tile_cache_count", _config.textureAtlasTileCount.value);
+    tryLoadValue(usedKeys, doc, "renderer.tile_page_limit", _config.textureAtlasPageLimit);
     tryLoadValue(usedKeys, doc, "renderer.tile_direct_mapping", _config.textureAtlasDirectMapping);
+    tryLoadValue(usedKeys, doc, "renderer.cell_background_grid", _config.cellBackgroundGrid);
+    tryLoadValue(usedKeys, doc, "renderer.render_buffer_threads", _config.renderBufferThreads);
+    tryLoadValue(usedKeys, doc, "renderer.render_thread", _config.renderThread);
+    tryLoadValue(usedKeys, doc, "renderer.glyph_rasterizer_threads", _config.glyphRasterizerThreads);
+    tryLoadValue(usedKeys, doc, "renderer.glyph_upload_budget", _config.glyphUploadBudget);
+    tryLoadValue(usedKeys, doc, "renderer.text_shaping_threads", _config.textShapingThreads);
+    tryLoadValue(usedKeys, doc, "renderer.image_texture_budget", _config.imageTextureBudget);
+    tryLoadValue(usedKeys, doc, "renderer.procedural_box_drawing", _config.proceduralBoxDrawing);
+    tryLoadValue(usedKeys, doc, "renderer.glyph_disk_cache", _config.glyphDiskCache);
+    tryLoadValue(usedKeys, doc, "renderer.glyph_disk_cache_size", _config.glyphDiskCacheSizeLimit);
+    tryLoadValue(usedKeys, doc, "renderer.frame_stats_overlay", _config.frameStatsOverlay);
 
     if (doc["mock_font_locator"].IsSequence())
     {
@@ -1780,6 +1929,20 @@ void loadConfigFromFile(Config& _config, FileSystem::path const& _fileName)
         _config.ptyBufferObjectSize = 1024 * 256;
     }
 
+    tryLoadValue(usedKeys, doc, "pty_buffer_huge_pages", _config.ptyBufferHugePages);
+
+    tryLoadValue(usedKeys, doc, "vt_sequence_profiling", _config.vtSequenceProfiling);
+
+    tryLoadValue(usedKeys, doc, "pipelined_parsing", _config.pipelinedParsing);
+
+    tryLoadValue(usedKeys, doc, "pty_reactor_threads", _config.ptyReactorThreads);
+
+    auto idleMinutes = _config.idleMemoryTrimTimeout.count();
+    tryLoadValue(usedKeys, doc, "idle_memory_trim_timeout", idleMinutes);
+    _config.idleMemoryTrimTimeout = chrono::minutes(idleMinutes);
+
+    tryLoadValue(usedKeys, doc, "scrollback_memory_budget", _config.scrollbackMemoryBudget);
+
     tryLoadValue(usedKeys, doc, "reflow_on_resize", _config.reflowOnResize);
 
     if (auto profiles = doc["profiles"]; profiles)
@@ -1788,11 +1951,17 @@ void loadConfigFromFile(Config& _config, FileSystem::path const& _fileName)
         for (auto i = profiles.begin(); i != profiles.end(); ++i)
         {
             auto const& name = i->first.as<string>();
-            auto const profile = i->second;
             auto const parentPath = "profiles"s;
-            usedKeys.emplace(fmt::format("{}.{}", parentPath, name));
-            _config.profiles[name] =
-                loadTerminalProfile(usedKeys, profile, parentPath, name, _config.colorschemes);
+            auto const path = fmt::format("{}.{}", parentPath, name);
+            usedKeys.emplace(path);
+            deferredKeys.emplace(path);
+            _config.profiles.erase(name);
+            _config.profileLoaders[name] = [parentPath, path, name, node = i->second](Config& _owner) {
+                auto usedProfileKeys = UsedKeys {};
+                auto profile = loadTerminalProfile(usedProfileKeys, node, parentPath, name, _owner);
+                checkForSuperfluousKeys(node, path, usedProfileKeys);
+                return profile;
+            };
         }
     }
 
@@ -1815,7 +1984,7 @@ void loadConfigFromFile(Config& _config, FileSystem::path const& _fileName)
             }
     }
 
-    checkForSuperfluousKeys(doc, usedKeys);
+    checkForSuperfluousKeys(doc, usedKeys, deferredKeys);
 }
 
 optional<std::string> readConfigFile(std::string const& _filename)
@@ -32,12 +32,14 @@
 #include <crispy/stdfs.h>
 
 #include <chrono>
+#include <functional>
 #include <optional>
 #include <set>
 #include <string>
 #include <system_error>
 #include <unordered_map>
 #include <variant>
+#include <vector>
 
 namespace contour::config
 {
@@ -75,57 +77,22 @@ struct InputMappings
     std::vector<MouseInputMapping> mouseMappings;
 };
 
-namespace helper
+/// InputMappings compiled for looking up the actions bound to input events.
+struct InputMappingTables
 {
-    inline bool testMatchMode(uint8_t _actualModeFlags,
-                              terminal::MatchModes _expected,
-                              terminal::MatchModes::Flag _testFlag)
-    {
-        using MatchModes = terminal::MatchModes;
-        switch (_expected.status(_testFlag))
-        {
-            case MatchModes::Status::Enabled:
-                if (!(_actualModeFlags & _testFlag))
-                    return false;
-                break;
-            case MatchModes::Status::Disabled:
-                if ((_actualModeFlags & _testFlag))
-                    return false;
-                break;
-            case MatchModes::Status::Any: break;
-        }
-        return true;
-    }
+    terminal::InputBindingTable<terminal::Key, ActionList> keyMappings;
+    terminal::InputBindingTable<char32_t, ActionList> charMappings;
+    terminal::InputBindingTable<terminal::MouseButton, ActionList> mouseMappings;
 
-    inline bool testMatchMode(uint8_t _actualModeFlags, terminal::MatchModes _expected)
-    {
-        using Flag = terminal::MatchModes::Flag;
-        return testMatchMode(_actualModeFlags, _expected, Flag::AlternateScreen)
-               && testMatchMode(_actualModeFlags, _expected, Flag::AppCursor)
-               && testMatchMode(_actualModeFlags, _expected, Flag::AppKeypad)
-               && testMatchMode(_actualModeFlags, _expected, Flag::Select)
-               && testMatchMode(_actualModeFlags, _expected, Flag::Insert)
-               && testMatchMode(_actualModeFlags, _expected, Flag::Search);
-    }
-} // namespace helper
-
-template <typename Input>
-std::vector<actions::Action> const* apply(
-    std::vector<terminal::InputBinding<Input, ActionList>> const& _mappings,
-    Input _input,
-    terminal::Modifier _modifier,
-    uint8_t _actualModeFlags)
-{
-    for (terminal::InputBinding<Input, ActionList> const& mapping: _mappings)
+    InputMappingTables() = default;
+
+    explicit InputMappingTables(InputMappings const& _mappings):
+        keyMappings { _mappings.keyMappings },
+        charMappings { _mappings.charMappings },
+        mouseMappings { _mappings.mouseMappings }
     {
-        if (mapping.modifier == _modifier && mapping.input == _input
-            && helper::testMatchMode(_actualModeFlags, mapping.modes))
-        {
-            return &mapping.binding;
-        }
     }
-    return nullptr;
-}
+};
 
 struct CursorConfig
 {
@@ -154,6 +121,7 @@ struct TerminalProfile
     terminal::VTType terminalId = terminal::VTType::VT525;
 
     terminal::MaxHistoryLineCount maxHistoryLineCount;
+    std::optional<terminal::LineCount> historyCompactionThreshold;
     terminal::LineCount historyScrollMultiplier = terminal::LineCount(3);
     ScrollBarPosition scrollbarPosition = ScrollBarPosition::Right;
     bool hideScrollbarInAltScreen = true;
@@ -219,6 +187,44 @@ struct Config
     /// Enables/disables support for direct mapped texture atlas tiles (e.g. glyphs).
     bool textureAtlasDirectMapping = true;
 
+    /// Number of threads to build the render buffer with, each one building a band of lines.
+    unsigned renderBufferThreads = 1;
+
+    /// Renders each window on a thread of its own rather than on the GUI thread.
+    bool renderThread = false;
+
+    /// Number of threads to rasterize glyphs missing in the texture atlas with,
+    /// or 0 to rasterize them synchronously while rendering.
+    unsigned glyphRasterizerThreads = 0;
+
+    /// Number of threads to shape the texts of a frame missing in the shaping cache with,
+    /// or 0 to shape them synchronously while rendering.
+    unsigned textShapingThreads = 0;
+
+    /// Maximum number of asynchronously rasterized glyphs to upload per frame.
+    unsigned glyphUploadBudget = 256;
+
+    /// Maximum GPU memory in MiB for images uploaded into textures of their own,
+    /// or 0 to upload images as texture atlas tiles.
+    unsigned imageTextureBudget = 256;
+
+    /// Renders box drawing, block element and Powerline separator characters analytically
+    /// on the GPU, instead of rasterizing them into the texture atlas.
+    bool proceduralBoxDrawing = false;
+
+    /// Enables/disables caching rasterized glyphs on disk, across application launches.
+    bool glyphDiskCache = false;
+
+    /// Maximum size of the glyph disk cache file in MiB.
+    unsigned glyphDiskCacheSizeLimit = 64;
+
+    /// Renders all cell backgrounds of a frame in one go, from a per-cell grid of colors,
+    /// instead of one rectangle per cell or line.
+    bool cellBackgroundGrid = false;
+
+    /// Overlays the terminal with the percentiles of recent frame times and PTY pipeline latencies.
+    bool frameStatsOverlay = false;
+
     // Number of hashtable slots to map to the texture tiles.
     // Larger values may increase performance, but too large may also decrease.
     // This value is rounted up to a value equal to the power of two.
@@ -233,8 +239,13 @@ struct Config
     /// This value is automatically adjusted if too small.
     crispy::LRUCapacity textureAtlasTileCount = crispy::LRUCapacity { 4000 };
 
-    // Configures the size of the PTY read buffer.
-    // Changing this value may result in better or worse throughput performance.
+    /// Maximum number of texture atlas pages, each holding textureAtlasTileCount tiles.
+    ///
+    /// Pages are added on demand. Once all are full, the least recently used page is evicted.
+    uint32_t textureAtlasPageLimit = 4;
+
+    // Configures the initial size of the PTY read buffer.
+    // The effective read size is adapted to the output rate at runtime.
     //
     // This value must be integer-devisable by 16.
     size_t ptyReadBufferSize = 16384;
@@ -244,27 +255,51 @@ struct Config
     // Defaults to 1 MB, that's roughly 10k lines when column count is 100.
     size_t ptyBufferObjectSize = 1024u * 1024u;
 
+    // Backs the PTY buffer objects by transparent huge pages (Linux only).
+    bool ptyBufferHugePages = false;
+
+    // Profiles the VT sequences applied to the screen, reported in the debug dump.
+    bool vtSequenceProfiling = false;
+
+    // Parses the PTY output on the PTY reader thread, such that parsing overlaps with screen updates.
+    bool pipelinedParsing = false;
+
+    // Number of worker threads of the PTY reactor shared by all sessions, or 0 to let every session
+    // process its PTY input on threads of its own.
+    unsigned ptyReactorThreads = 0;
+
+    // Time without any input or output, after which a session releases the memory it only holds on to
+    // for speed (renderer caches, texture atlas, pooled buffers), or 0 to never do so.
+    std::chrono::minutes idleMemoryTrimTimeout { 10 };
+
+    // Megabytes the scrollback of all sessions together may take up, or 0 for no limit.
+    size_t scrollbackMemoryBudget = 2048;
+
     bool reflowOnResize = true;
 
     std::unordered_map<std::string, terminal::ColorPalette> colorschemes;
     std::unordered_map<std::string, TerminalProfile> profiles;
     std::string defaultProfileName;
 
-    TerminalProfile* profile(std::string const& _name)
-    {
-        assert(_name != "");
-        if (auto i = profiles.find(_name); i != profiles.end())
-            return &i->second;
-        assert(false && "Profile not found.");
-        return nullptr;
-    }
+    // Parsers of the color schemes and profiles that have not been used yet.
+    //
+    // Color schemes and profiles are parsed on first use only, moving them into the maps above,
+    // such that configurations with many profiles do not delay the application start-up.
+    std::unordered_map<std::string, std::function<terminal::ColorPalette()>> colorschemeLoaders;
+    std::unordered_map<std::string, std::function<TerminalProfile(Config&)>> profileLoaders;
+
+    /// @returns the names of all profiles, parsed or not, in lexicographical order.
+    [[nodiscard]] std::vector<std::string> profileNames() const;
+
+    /// @returns the color scheme of the given name, parsing it on first use, or nullptr if not defined.
+    terminal::ColorPalette const* colorscheme(std::string const& _name);
+
+    TerminalProfile* profile(std::string const& _name);
 
     TerminalProfile const* profile(std::string const& _name) const
     {
-        if (auto i = profiles.find(_name); i != profiles.end())
-            return &i->second;
-        assert(false && "Profile not found.");
-        return nullptr;
+        // Parsing a profile on first use does not change the configuration observably.
+        return const_cast<Config&>(*this).profile(_name);
     }
 
     TerminalProfile& profile() noexcept { return *profile(defaultProfileName); }
@@ -280,9 +315,20 @@ struct Config
     InputMappings inputMappings;
 
     bool spawnNewProcess = false;
+
+    // Number of shells to start ahead of time, such that new terminals can adopt one right away.
+    unsigned prespawnedShells = 0;
+
+    // Whether tmux started in control mode (tmux -CC) has its panes opened as native windows.
+    bool tmuxControlMode = false;
     std::shared_ptr<logstore::Sink> loggingSink;
 
     bool sixelScrolling = true;
+    bool sixelProgressive = false;
+    unsigned sixelDecoderThreads = 1;
+    unsigned imageRasterizerThreads = 1;
+    /// Memory in MiB of the pixels of a terminal's images to compress beyond, or 0 for no limit.
+    unsigned imageMemoryBudget = 256;
     terminal::ImageSize maxImageSize = {}; // default to runtime system screen size.
     unsigned maxImageColorRegisters = 4096;
 
@@ -291,6 +337,9 @@ struct Config
 
 FileSystem::path configHome(std::string const& _programName);
 
+/// @returns the directory to store this application's non-essential data in, e.g. caches.
+FileSystem::path cacheHome();
+
 std::optional<std::string> readConfigFile(std::string const& _filename);
 
 void loadConfigFromFile(Config& _config, FileSystem::path const& _fileName);
@@ -17,7 +17,13 @@
 
 #include <terminal/Capabilities.h>
 #include <terminal/Functions.h>
+#include <terminal/HeadlessTerminal.h>
+#include <terminal/HistoryExport.h>
+#include <terminal/MockTerm.h>
 #include <terminal/Parser.h>
+#include <terminal/ParserEvents.h>
+#include <terminal/PtyRecording.h>
+#include <terminal/pty/MockViewPty.h>
 
 #include <crispy/App.h>
 #include <crispy/StackTrace.h>
@@ -30,17 +36,25 @@
 
 #include <QtCore/QFile>
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cstdio>
 #include <fstream>
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include <signal.h>
 
 #if !defined(_WIN32)
     #include <sys/ioctl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
 
+    #include <fcntl.h>
     #include <unistd.h>
 #endif
 
@@ -125,6 +139,96 @@ namespace
         abort();
     }
 #endif
+
+    // Number of bytes handed to the terminal at a time while rendering a file.
+    constexpr auto RenderChunkSize = size_t { 1024 * 1024 };
+
+    /// Calls @p _callback with consecutive chunks of the given file's contents.
+    ///
+    /// The file is memory mapped where supported, and the chunks already processed are released
+    /// again, such that files larger than the available memory can be processed.
+    template <typename Callback>
+    bool forEachFileChunk(FileSystem::path const& _path, Callback _callback)
+    {
+#if !defined(_WIN32)
+        auto const fd = ::open(_path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return false;
+        auto const fdCloser = crispy::finally { [fd]() {
+            ::close(fd);
+        } };
+
+        struct stat st {};
+        if (::fstat(fd, &st) < 0)
+            return false;
+        auto const size = static_cast<size_t>(st.st_size);
+        if (size == 0)
+            return true;
+
+        auto* mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED)
+            return false;
+        auto const unmapper = crispy::finally { [mapping, size]() {
+            ::munmap(mapping, size);
+        } };
+        ::madvise(mapping, size, MADV_SEQUENTIAL);
+
+        auto const* data = static_cast<char const*>(mapping);
+        for (size_t offset = 0; offset < size; offset += RenderChunkSize)
+        {
+            auto const length = std::min(RenderChunkSize, size - offset);
+            _callback(string_view(data + offset, length));
+            ::madvise(const_cast<char*>(data + offset), length, MADV_DONTNEED);
+        }
+        return true;
+#else
+        auto input = std::ifstream(_path, std::ios::binary);
+        if (!input)
+            return false;
+        auto buffer = std::vector<char>(RenderChunkSize);
+        while (input.read(buffer.data(), static_cast<std::streamsize>(buffer.size())) || input.gcount() > 0)
+            _callback(string_view(buffer.data(), static_cast<size_t>(input.gcount())));
+        return input.eof();
+#endif
+    }
+
+    /// Renders the given file through its own headless terminal, including all lines that scrolled
+    /// out of the history on the way.
+    bool renderFile(FileSystem::path const& _input,
+                    FileSystem::path const& _output,
+                    terminal::HistoryExportFormat _format,
+                    terminal::PageSize _pageSize)
+    {
+        using terminal::HeadlessTerminal;
+        using terminal::Line;
+        using terminal::PrimaryScreenCell;
+
+        auto output = std::ofstream(_output, std::ios::binary | std::ios::trunc);
+        if (!output)
+            return false;
+
+        auto settings = HeadlessTerminal::Settings {};
+        settings.pageSize = _pageSize;
+        settings.maxHistoryLineCount = terminal::LineCount(1000);
+        auto vt = HeadlessTerminal(settings);
+
+        auto exporter = terminal::LineExporter<PrimaryScreenCell>(_format, settings.colorPalette, output);
+        vt.setEvictedLineHandler([&](Line<PrimaryScreenCell> const& _line) { exporter.write(_line); });
+
+        if (!forEachFileChunk(_input, [&](string_view _chunk) { vt.write(_chunk); }))
+            return false;
+
+        // The main page is written up to the cursor, leaving out the blank lines below it.
+        auto& screen = vt.terminal().primaryScreen();
+        auto const& grid = screen.grid();
+        auto const lastLine = screen.realCursorPosition().line;
+        for (auto line = -crispy::boxed_cast<terminal::LineOffset>(grid.historyLineCount()); line <= lastLine;
+             ++line)
+            exporter.write(grid.lineAt(line));
+        exporter.finish();
+
+        return static_cast<bool>(output);
+    }
 } // namespace
 // }}}
 
@@ -166,6 +270,7 @@ ContourApp::ContourApp(): App("contour", "Contour Terminal Emulator", CONTOUR_VE
 #endif
 
     link("contour.capture", bind(&ContourApp::captureAction, this));
+    link("contour.latency", bind(&ContourApp::latencyAction, this));
     link("contour.list-debug-tags", bind(&ContourApp::listDebugTagsAction, this));
     link("contour.set.profile", bind(&ContourApp::profileAction, this));
     link("contour.generate.parser-table", bind(&ContourApp::parserTableAction, this));
@@ -173,6 +278,10 @@ ContourApp::ContourApp(): App("contour", "Contour Terminal Emulator", CONTOUR_VE
     link("contour.generate.config", bind(&ContourApp::configAction, this));
     link("contour.generate.integration", bind(&ContourApp::integrationAction, this));
     link("contour.info.vt", bind(&ContourApp::infoVT, this));
+    link("contour.info.caches", bind(&ContourApp::infoCachesAction, this));
+    link("contour.info.memory", bind(&ContourApp::infoMemoryAction, this));
+    link("contour.replay", bind(&ContourApp::replayAction, this));
+    link("contour.render", bind(&ContourApp::renderAction, this));
 }
 
 template <typename Callback>
@@ -280,12 +389,204 @@ int ContourApp::captureAction()
         return EXIT_FAILURE;
 }
 
+int ContourApp::latencyAction()
+{
+    auto settings = contour::InputLatencySettings {};
+    settings.reset = parameters().get<bool>("contour.latency.reset");
+    settings.timeout = parameters().get<double>("contour.latency.timeout");
+
+    if (contour::reportInputLatency(settings))
+        return EXIT_SUCCESS;
+    else
+        return EXIT_FAILURE;
+}
+
+int ContourApp::infoCachesAction()
+{
+    auto settings = contour::CacheStatsSettings {};
+    settings.timeout = parameters().get<double>("contour.info.caches.timeout");
+
+    if (contour::reportCacheStats(settings))
+        return EXIT_SUCCESS;
+    else
+        return EXIT_FAILURE;
+}
+
+int ContourApp::infoMemoryAction()
+{
+    auto settings = contour::MemoryStatsSettings {};
+    settings.timeout = parameters().get<double>("contour.info.memory.timeout");
+
+    if (contour::reportMemoryStats(settings))
+        return EXIT_SUCCESS;
+    else
+        return EXIT_FAILURE;
+}
+
 int ContourApp::parserTableAction()
 {
     terminal::parser::parserTableDot(std::cout);
     return EXIT_SUCCESS;
 }
 
+int ContourApp::replayAction()
+{
+    using std::chrono::duration;
+    using std::chrono::steady_clock;
+    using terminal::PtyRecordingChunk;
+
+    if (parameters().verbatim.size() != 1)
+    {
+        cerr << "Usage: contour replay [realtime] FILE\n";
+        return EXIT_FAILURE;
+    }
+
+    auto const path = FileSystem::path(string(parameters().verbatim.front()));
+    auto const recording = terminal::loadPtyRecording(path);
+    if (!recording)
+    {
+        cerr << fmt::format("Failed to load PTY recording {}.\n", path.string());
+        return EXIT_FAILURE;
+    }
+    auto const realtime = parameters().get<bool>("contour.replay.realtime");
+
+    // Measure the parser on its own first, such that its share of the processing time is known.
+    auto parseTime = duration<double> {};
+    {
+        auto events = terminal::NullParserEvents {};
+        auto parser = terminal::parser::Parser<terminal::ParserEvents> { events };
+        auto const startTime = steady_clock::now();
+        for (auto const& chunk: recording->chunks)
+            if (chunk.type == PtyRecordingChunk::Type::Output)
+                parser.parseFragment(chunk.data);
+        parseTime = steady_clock::now() - startTime;
+    }
+
+    auto constexpr MaxHistoryLineCount = terminal::LineCount(1000);
+    auto constexpr PtyReadBufferSize = size_t { 1024 * 1024 };
+    using ReplayTerm = terminal::MockTerm<terminal::MockViewPty>;
+    auto vt = ReplayTerm(recording->pageSize, MaxHistoryLineCount, PtyReadBufferSize);
+    auto& pty = vt.mockPty();
+    auto processTime = duration<double> {};
+    auto renderBufferTime = duration<double> {};
+    auto renderBufferRefreshCount = 0u;
+
+    auto const replayStartTime = steady_clock::now();
+    for (auto const& chunk: recording->chunks)
+    {
+        if (realtime)
+            std::this_thread::sleep_until(replayStartTime + chunk.time);
+
+        auto const startTime = steady_clock::now();
+        switch (chunk.type)
+        {
+            case PtyRecordingChunk::Type::Output:
+                pty.setReadData(chunk.data);
+                do
+                    vt.terminal.processInputOnce();
+                while (!pty.isClosed() && !pty.stdoutBuffer().empty());
+                break;
+            case PtyRecordingChunk::Type::Resize: vt.terminal.resizeScreen(chunk.pageSize); break;
+        }
+        auto const processedTime = steady_clock::now();
+        processTime += processedTime - startTime;
+
+        vt.terminal.tick(processedTime);
+        vt.terminal.refreshRenderBuffer();
+        renderBufferTime += steady_clock::now() - processedTime;
+        ++renderBufferRefreshCount;
+    }
+    auto const wallClockTime = duration<double>(steady_clock::now() - replayStartTime);
+
+    auto const bytes = static_cast<double>(recording->outputSize());
+    auto const throughput = [&](duration<double> _time) {
+        return crispy::humanReadableBytes(static_cast<long double>(bytes / std::max(_time.count(), 1e-9)));
+    };
+    auto const applyTime = std::max(processTime - parseTime, duration<double> {});
+    auto const recordedTime =
+        recording->chunks.empty() ? duration<double> {} : duration<double>(recording->chunks.back().time);
+
+    fmt::print("Replayed {} chunks with {} of PTY output, recorded over {:.3f} s, in {:.3f} s.\n\n",
+               recording->chunks.size(),
+               crispy::humanReadableBytes(static_cast<long double>(bytes)),
+               recordedTime.count(),
+               wallClockTime.count());
+    fmt::print("{:<14} {:>10.3f} s {:>12}/s\n", "parse", parseTime.count(), throughput(parseTime));
+    fmt::print("{:<14} {:>10.3f} s {:>12}/s\n", "apply", applyTime.count(), throughput(applyTime));
+    fmt::print("{:<14} {:>10.3f} s {:>12} refreshes, {:.1f} us each\n",
+               "render buffer",
+               renderBufferTime.count(),
+               renderBufferRefreshCount,
+               renderBufferTime.count() * 1e6 / std::max(renderBufferRefreshCount, 1u));
+
+    return EXIT_SUCCESS;
+}
+
+int ContourApp::renderAction()
+{
+    auto const& flags = parameters();
+    if (flags.verbatim.empty())
+    {
+        cerr << "Usage: contour render [format FORMAT] [columns COUNT] [lines COUNT] [to DIRECTORY] "
+                "[jobs COUNT] FILES...\n";
+        return EXIT_FAILURE;
+    }
+
+    auto const format = terminal::parseHistoryExportFormat(flags.get<string>("contour.render.format"));
+    if (!format)
+    {
+        cerr << fmt::format("Unknown output format: {}\n", flags.get<string>("contour.render.format"));
+        return EXIT_FAILURE;
+    }
+
+    auto const pageSize = terminal::PageSize {
+        terminal::LineCount::cast_from(std::max(1u, flags.get<unsigned>("contour.render.lines"))),
+        terminal::ColumnCount::cast_from(std::max(1u, flags.get<unsigned>("contour.render.columns")))
+    };
+    auto const outputDirectory = FileSystem::path(flags.get<string>("contour.render.to"));
+    if (!outputDirectory.empty())
+        FileSystem::create_directories(outputDirectory);
+
+    auto const inputs = std::vector<string>(flags.verbatim.begin(), flags.verbatim.end());
+    auto const outputPath = [&](FileSystem::path const& _input) {
+        auto const fileName = FileSystem::path(
+            fmt::format("{}.{}", _input.filename().string(), terminal::fileExtension(*format)));
+        return outputDirectory.empty() ? _input.parent_path() / fileName : outputDirectory / fileName;
+    };
+
+    // Each file is rendered by a single worker, through a terminal of its own.
+    auto const jobs = flags.get<unsigned>("contour.render.jobs");
+    auto const workerCount =
+        std::min(static_cast<size_t>(jobs ? jobs : std::max(1u, std::thread::hardware_concurrency())),
+                 inputs.size());
+    auto nextInput = std::atomic<size_t> { 0 };
+    auto failureCount = std::atomic<unsigned> { 0 };
+    auto errorMutex = std::mutex {};
+
+    auto const worker = [&]() {
+        for (auto i = nextInput++; i < inputs.size(); i = nextInput++)
+        {
+            auto const input = FileSystem::path(inputs[i]);
+            auto const output = outputPath(input);
+            if (!renderFile(input, output, *format, pageSize))
+            {
+                ++failureCount;
+                auto const _ = std::lock_guard { errorMutex };
+                cerr << fmt::format("Failed to render {} into {}.\n", input.string(), output.string());
+            }
+        }
+    };
+
+    auto workers = std::vector<std::thread> {};
+    for (size_t i = 1; i < workerCount; ++i)
+        workers.emplace_back(worker);
+    worker();
+    for (auto& thread: workers)
+        thread.join();
+
+    return failureCount ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
 int ContourApp::listDebugTagsAction()
 {
     listDebugTags();
@@ -319,6 +620,25 @@ crispy::cli::Command ContourApp::parameterDefinition() const
                 CLI::OptionList {},
                 CLI::CommandList {
                     CLI::Command { "vt", "Prints general information about supported VT sequences." },
+                    CLI::Command {
+                        "caches",
+                        "Reports the hits, misses, and evictions of all caches of the currently running "
+                        "terminal.",
+                        {
+                            CLI::Option { "timeout",
+                                          CLI::Value { 1.0 },
+                                          "Sets timeout seconds to wait for terminal to respond.",
+                                          "SECONDS" },
+                        } },
+                    CLI::Command {
+                        "memory",
+                        "Reports the memory used by each subsystem of the currently running terminal.",
+                        {
+                            CLI::Option { "timeout",
+                                          CLI::Value { 1.0 },
+                                          "Sets timeout seconds to wait for terminal to respond.",
+                                          "SECONDS" },
+                        } },
                 } },
             CLI::Command {
                 "generate",
@@ -389,6 +709,53 @@ crispy::cli::Command ContourApp::parameterDefinition() const
                                   "FILE",
                                   CLI::Presence::Required },
                 } },
+            CLI::Command {
+                "latency",
+                "Reports the latency of the currently running terminal from key presses until the frames "
+                "showing their echo were presented.",
+                {
+                    CLI::Option { "reset",
+                                  CLI::Value { false },
+                                  "Resets the measurements after reporting them." },
+                    CLI::Option { "timeout",
+                                  CLI::Value { 1.0 },
+                                  "Sets timeout seconds to wait for terminal to respond.",
+                                  "SECONDS" },
+                } },
+            CLI::Command {
+                "replay",
+                "Replays a PTY recording headless and reports the time spent on parsing, applying, and "
+                "building render buffers.",
+                CLI::OptionList {
+                    CLI::Option { "realtime",
+                                  CLI::Value { false },
+                                  "Replays the recording at its original pace instead of at maximum speed." },
+                },
+                CLI::CommandList {},
+                CLI::CommandSelect::Explicit,
+                CLI::Verbatim { "FILE", "PTY recording, as created via: contour terminal record-pty FILE" } },
+            CLI::Command {
+                "render",
+                "Renders files containing VT sequences, such as build logs, through a headless terminal "
+                "into text or HTML, including all lines that scrolled by. Each file is written into "
+                "FILE.EXT, and the files are rendered in parallel.",
+                CLI::OptionList {
+                    CLI::Option {
+                        "format", CLI::Value { "html"s }, "Output format, one of text, vt, or html.", "FORMAT" },
+                    CLI::Option { "columns", CLI::Value { 80u }, "Page width to render with.", "COUNT" },
+                    CLI::Option { "lines", CLI::Value { 25u }, "Page height to render with.", "COUNT" },
+                    CLI::Option { "to",
+                                  CLI::Value { ""s },
+                                  "Directory to write the rendered files to instead of next to the input files.",
+                                  "DIRECTORY" },
+                    CLI::Option { "jobs",
+                                  CLI::Value { 0u },
+                                  "Number of files rendered in parallel, or the number of CPU cores if 0.",
+                                  "COUNT" },
+                },
+                CLI::CommandList {},
+                CLI::CommandSelect::Explicit,
+                CLI::Verbatim { "FILES...", "Files to render." } },
             CLI::Command {
                 "set",
                 "Sets various aspects of the connected terminal.",
@@ -30,13 +30,18 @@ class ContourApp: public crispy::App
 
   private:
     int captureAction();
+    int latencyAction();
     int listDebugTagsAction();
     int parserTableAction();
+    int replayAction();
+    int renderAction();
     int profileAction();
     int terminfoAction();
     int configAction();
     int integrationAction();
     int infoVT();
+    int infoCachesAction();
+    int infoMemoryAction();
 };
 
 } // namespace contour
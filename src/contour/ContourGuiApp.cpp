@@ -14,17 +14,24 @@
 #include <contour/Config.h>
 #include <contour/ContourGuiApp.h>
 #include <contour/TerminalWindow.h>
+#include <contour/display/RenderBenchmark.h>
 #include <contour/display/TerminalWidget.h>
 
 #include <terminal/Process.h>
+#include <terminal/PtyRecording.h>
 
 #include <text_shaper/font_locator.h>
 
+#include <crispy/StartupTrace.h>
 #include <crispy/logstore.h>
 #include <crispy/utils.h>
 
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDataStream>
 #include <QtCore/QProcess>
 #include <QtGui/QSurfaceFormat>
+#include <QtNetwork/QLocalServer>
+#include <QtNetwork/QLocalSocket>
 #include <QtWidgets/QApplication>
 
 #include <iostream>
@@ -49,10 +56,24 @@ namespace CLI = crispy::cli;
 namespace contour
 {
 
+namespace
+{
+    constexpr auto InstanceConnectTimeout = 500; // milliseconds
+
+    QString instanceServerName()
+    {
+        auto user = qEnvironmentVariable("USER");
+        if (user.isEmpty())
+            user = qEnvironmentVariable("USERNAME");
+        return QStringLiteral("contour-%1").arg(user);
+    }
+} // namespace
+
 ContourGuiApp::ContourGuiApp(): _sessionManager(*this)
 {
     link("contour.terminal", bind(&ContourGuiApp::terminalGuiAction, this));
     link("contour.font-locator", bind(&ContourGuiApp::fontConfigAction, this));
+    link("contour.benchmark.render", bind(&ContourGuiApp::benchmarkRenderAction, this));
 }
 
 ContourGuiApp::~ContourGuiApp()
@@ -71,6 +92,45 @@ crispy::cli::Command ContourGuiApp::parameterDefinition() const
 {
     auto command = ContourApp::parameterDefinition();
 
+    command.children.insert(
+        command.children.begin(),
+        CLI::Command {
+            "benchmark",
+            "Benchmarking utilities.",
+            CLI::OptionList {},
+            CLI::CommandList { CLI::Command {
+                "render",
+                "Renders a PTY recording into an offscreen OpenGL surface and reports the CPU and GPU "
+                "time per frame. This needs no window, so use e.g. platform offscreen on headless machines.",
+                CLI::OptionList {
+                    CLI::Option { "config",
+                                  CLI::Value { contour::config::defaultConfigFilePath() },
+                                  "Path to configuration file to load.",
+                                  "FILE" },
+                    CLI::Option {
+                        "profile", CLI::Value { ""s }, "Terminal Profile to render with.", "NAME" },
+                    CLI::Option { "frames",
+                                  CLI::Value { 0u },
+                                  "Number of frames to render, replaying the recording as often as needed. "
+                                  "Renders one frame per recorded chunk of output if 0.",
+                                  "COUNT" },
+                    CLI::Option { "dpi", CLI::Value { 96u }, "DPI to render the fonts with.", "DPI" },
+                    CLI::Option { "dump",
+                                  CLI::Value { ""s },
+                                  "Saves every rendered frame as PNG image into the given directory.",
+                                  "DIRECTORY" },
+                    CLI::Option {
+                        "platform", CLI::Value { ""s }, "Sets the QPA platform.", "PLATFORM[:OPTIONS]" },
+                    CLI::Option { "debug",
+                                  CLI::Value { ""s },
+                                  "Enables debug logging, using a comma (,) seperated list of tags.",
+                                  "TAGS" },
+                },
+                CLI::CommandList {},
+                CLI::CommandSelect::Explicit,
+                CLI::Verbatim { "FILE",
+                                "PTY recording, as created via: contour terminal record-pty FILE" } } } });
+
     command.children.insert(
         command.children.begin(),
         CLI::Command {
@@ -85,7 +145,8 @@ crispy::cli::Command ContourGuiApp::parameterDefinition() const
                     "profile", CLI::Value { ""s }, "Terminal Profile to load (overriding config).", "NAME" },
                 CLI::Option { "debug",
                               CLI::Value { ""s },
-                              "Enables debug logging, using a comma (,) seperated list of tags.",
+                              "Enables debug logging, using a comma (,) seperated list of tags. "
+                              "A tag may be rate limited as TAG:N/s, or sampled as TAG:1/N.",
                               "TAGS" },
             },
         });
@@ -104,7 +165,8 @@ crispy::cli::Command ContourGuiApp::parameterDefinition() const
                     "profile", CLI::Value { ""s }, "Terminal Profile to load (overriding config).", "NAME" },
                 CLI::Option { "debug",
                               CLI::Value { ""s },
-                              "Enables debug logging, using a comma (,) seperated list of tags.",
+                              "Enables debug logging, using a comma (,) seperated list of tags. "
+                              "A tag may be rate limited as TAG:N/s, or sampled as TAG:1/N.",
                               "TAGS" },
                 CLI::Option { "live-config", CLI::Value { false }, "Enables live config reloading." },
                 CLI::Option {
@@ -112,6 +174,11 @@ crispy::cli::Command ContourGuiApp::parameterDefinition() const
                     CLI::Value { ""s },
                     "Dumps internal state at exit into the given directory. This is for debugging contour.",
                     "PATH" },
+                CLI::Option { "record-pty",
+                              CLI::Value { ""s },
+                              "Records the output of the terminal application into the given file, "
+                              "which can be replayed via: contour replay FILE",
+                              "FILE" },
                 CLI::Option { "early-exit-threshold",
                               CLI::Value { 6u },
                               "If the spawned process exits earlier than the given threshold seconds, an "
@@ -127,6 +194,15 @@ crispy::cli::Command ContourGuiApp::parameterDefinition() const
                     "WM_CLASS" },
                 CLI::Option {
                     "platform", CLI::Value { ""s }, "Sets the QPA platform.", "PLATFORM[:OPTIONS]" },
+                CLI::Option { "trace-startup",
+                              CLI::Value { ""s },
+                              "Writes the timings of the startup phases until the first frame has been "
+                              "presented into the given file, in Chrome's trace event format.",
+                              "FILE" },
+                CLI::Option { "single-instance",
+                              CLI::Value { false },
+                              "Opens the window in an already running single instance, passing on the "
+                              "profile, working directory and program. Becomes that instance otherwise." },
                 CLI::Option { "session",
                               CLI::Value { ""s },
                               "Sets the sessioni ID used for resuming a prior session.",
@@ -158,14 +234,17 @@ std::chrono::seconds ContourGuiApp::earlyExitThreshold() const
 
 string ContourGuiApp::profileName() const
 {
+    if (_profileNameOverride)
+        return *_profileNameOverride;
+
     if (auto profile = parameters().get<string>("contour.terminal.profile"); !profile.empty())
         return profile;
 
     if (!_config.defaultProfileName.empty())
         return _config.defaultProfileName;
 
-    if (_config.profiles.size() == 1)
-        return _config.profiles.begin()->first;
+    if (auto const names = _config.profileNames(); names.size() == 1)
+        return names.front();
 
     return ""s;
 }
@@ -178,6 +257,14 @@ std::optional<FileSystem::path> ContourGuiApp::dumpStateAtExit() const
     return FileSystem::path(path);
 }
 
+std::optional<FileSystem::path> ContourGuiApp::ptyRecordingPath() const
+{
+    auto const path = parameters().get<std::string>("contour.terminal.record-pty");
+    if (path.empty())
+        return std::nullopt;
+    return FileSystem::path(path);
+}
+
 void ContourGuiApp::onExit(TerminalSession& _session)
 {
     auto const* localProcess = dynamic_cast<terminal::Process const*>(&_session.terminal().device());
@@ -212,13 +299,10 @@ bool ContourGuiApp::loadConfig(string const& target)
 
     if (!_config.profile(profileName()))
     {
-        auto const s =
-            accumulate(begin(_config.profiles),
-                       end(_config.profiles),
-                       ""s,
-                       [](string const& acc, auto const& profile) -> string {
-                           return acc.empty() ? profile.first : fmt::format("{}, {}", acc, profile.first);
-                       });
+        auto const names = _config.profileNames();
+        auto const s = accumulate(begin(names), end(names), ""s, [](string const& acc, string const& name) {
+            return acc.empty() ? name : fmt::format("{}, {}", acc, name);
+        });
         configLogger(
             fmt::format("No profile with name '{}' found. Available profiles: {}", profileName(), s));
     }
@@ -278,8 +362,147 @@ int ContourGuiApp::fontConfigAction()
     return EXIT_SUCCESS;
 }
 
+int ContourGuiApp::benchmarkRenderAction()
+{
+    auto const& flags = parameters();
+    if (flags.verbatim.size() != 1)
+    {
+        cerr << "Usage: contour benchmark render [frames COUNT] [dump DIRECTORY] FILE\n";
+        return EXIT_FAILURE;
+    }
+
+    if (auto const filterString = flags.get<string>("contour.benchmark.render.debug"); !filterString.empty())
+        logstore::configure(filterString);
+
+    auto const path = FileSystem::path(string(flags.verbatim.front()));
+    auto const recording = terminal::loadPtyRecording(path);
+    if (!recording)
+    {
+        cerr << fmt::format("Failed to load PTY recording {}.\n", path.string());
+        return EXIT_FAILURE;
+    }
+
+    _config = contour::config::loadConfigFromFile(flags.get<string>("contour.benchmark.render.config"));
+    auto profileName = flags.get<string>("contour.benchmark.render.profile");
+    if (profileName.empty())
+        profileName = _config.defaultProfileName;
+    auto const* profile = _config.profile(profileName);
+    if (!profile)
+    {
+        cerr << fmt::format("No profile with name '{}' found.\n", profileName);
+        return EXIT_FAILURE;
+    }
+
+    auto settings = display::RenderBenchmarkSettings {};
+    settings.frames = flags.get<unsigned>("contour.benchmark.render.frames");
+    auto const dpi = static_cast<int>(flags.get<unsigned>("contour.benchmark.render.dpi"));
+    settings.dpi = text::DPI { dpi, dpi };
+    if (auto const dumpDirectory = flags.get<string>("contour.benchmark.render.dump"); !dumpDirectory.empty())
+    {
+        settings.dumpDirectory = FileSystem::path(dumpDirectory);
+        FileSystem::create_directories(*settings.dumpDirectory);
+    }
+
+    auto qtArgs = vector<char const*> { _argv[0] };
+    auto const platform = flags.get<string>("contour.benchmark.render.platform");
+    if (!platform.empty())
+    {
+        qtArgs.push_back("-platform");
+        qtArgs.push_back(platform.c_str());
+    }
+    auto qtArgsCount = static_cast<int>(qtArgs.size());
+    QGuiApplication app(qtArgsCount, (char**) qtArgs.data());
+
+    return display::benchmarkRender(_config, *profile, *recording, settings);
+}
+
+bool ContourGuiApp::forwardToRunningInstance()
+{
+    auto const& flags = parameters();
+
+    auto request = QStringList {};
+    request << QString::fromStdString(flags.get<string>("contour.terminal.profile"));
+    if (auto const wd = flags.get<string>("contour.terminal.working-directory"); !wd.empty())
+        request << QString::fromStdString(FileSystem::absolute(FileSystem::path(wd)).string());
+    else
+        request << QString();
+    if (auto const exe = flags.get<string>("contour.terminal.execute"); !exe.empty())
+        request << QString::fromStdString(exe);
+    for (auto const arg: flags.verbatim)
+        request << QString::fromUtf8(arg.data(), static_cast<int>(arg.size()));
+
+    // Socket notifiers need an application object, but not yet a GUI one.
+    auto argc = 1;
+    auto argv = (char*) _argv[0];
+    QCoreApplication app(argc, &argv);
+
+    QLocalSocket socket;
+    socket.connectToServer(instanceServerName());
+    if (!socket.waitForConnected(InstanceConnectTimeout))
+        return false;
+
+    QDataStream stream(&socket);
+    stream << request;
+    socket.waitForBytesWritten(InstanceConnectTimeout);
+    socket.disconnectFromServer();
+    if (socket.state() != QLocalSocket::UnconnectedState)
+        socket.waitForDisconnected(InstanceConnectTimeout);
+    return true;
+}
+
+void ContourGuiApp::listenForInstances()
+{
+    _instanceServer = make_unique<QLocalServer>();
+    _instanceServer->setSocketOptions(QLocalServer::UserAccessOption);
+
+    // Nobody answered on the socket, so it can only have been left behind by a crashed instance.
+    QLocalServer::removeServer(instanceServerName());
+    if (!_instanceServer->listen(instanceServerName()))
+    {
+        errorlog()("Failed to listen for further instances. {}", _instanceServer->errorString().toStdString());
+        _instanceServer.reset();
+        return;
+    }
+
+    QObject::connect(_instanceServer.get(), &QLocalServer::newConnection, [this]() {
+        while (QLocalSocket* socket = _instanceServer->nextPendingConnection())
+        {
+            auto buffer = std::make_shared<QByteArray>();
+            QObject::connect(socket, &QLocalSocket::readyRead, [socket, buffer]() {
+                buffer->append(socket->readAll());
+            });
+            QObject::connect(socket, &QLocalSocket::disconnected, [this, socket, buffer]() {
+                socket->deleteLater();
+                buffer->append(socket->readAll());
+
+                auto arguments = QStringList {};
+                QDataStream stream(*buffer);
+                stream >> arguments;
+                if (stream.status() != QDataStream::Ok || arguments.size() < 2)
+                    return;
+
+                auto request = WindowRequest {};
+                request.profileName = arguments.at(0).toStdString();
+                request.workingDirectory = arguments.at(1).toStdString();
+                for (auto i = 2; i < arguments.size(); ++i)
+                    request.command.emplace_back(arguments.at(i).toStdString());
+
+                if (!newWindow(request))
+                    errorlog()("Could not spawn terminal window for forwarded request.");
+            });
+        }
+    });
+}
+
 int ContourGuiApp::terminalGuiAction()
 {
+    if (auto const path = parameters().get<string>("contour.terminal.trace-startup"); !path.empty())
+        crispy::StartupTrace::get().setOutputPath(path);
+
+    auto const singleInstance = parameters().boolean("contour.terminal.single-instance");
+    if (singleInstance && forwardToRunningInstance())
+        return EXIT_SUCCESS;
+
     if (!loadConfig("terminal"))
         return EXIT_FAILURE;
 
@@ -302,6 +525,10 @@ int ContourGuiApp::terminalGuiAction()
         errorlog()("Could not access configuration profile.");
         return EXIT_FAILURE;
     }
+
+    // Locate the fonts while Qt and the OpenGL context are being initialized.
+    terminal::renderer::prefetchFonts(profile->fonts);
+
     auto appName = QString::fromStdString(profile->wmClass);
     QCoreApplication::setApplicationName(appName);
     QCoreApplication::setOrganizationName("contour");
@@ -337,13 +564,21 @@ int ContourGuiApp::terminalGuiAction()
     addQtArgIfSet("contour.terminal.display", "-display");
 #endif
 
+    // All windows' OpenGL contexts share their objects, such that the shaders are compiled only once.
+    QCoreApplication::setAttribute(Qt::AA_ShareOpenGLContexts);
+
     auto qtArgsCount = static_cast<int>(qtArgsPtr.size());
+    auto const qtStartTime = crispy::StartupTrace::clock::now();
     QApplication app(qtArgsCount, (char**) qtArgsPtr.data());
+    crispy::StartupTrace::get().complete("Initialize Qt", qtStartTime, crispy::StartupTrace::clock::now());
 
     QSurfaceFormat::setDefaultFormat(display::createSurfaceFormat());
 
     ensureTermInfoFile();
 
+    if (singleInstance)
+        listenForInstances();
+
     // auto const HTS = "\033H";
     // auto const TBC = "\033[g";
     // printf("\r%s        %s                        %s\r", TBC, HTS, HTS);
@@ -357,6 +592,7 @@ int ContourGuiApp::terminalGuiAction()
 
     auto rv = app.exec();
 
+    _instanceServer.reset();
     _terminalWindows.clear();
 
     if (_exitStatus.has_value())
@@ -397,7 +633,8 @@ TerminalWindow* ContourGuiApp::newWindow(contour::config::Config const& config)
     mainWindow->show();
 
     _terminalWindows.emplace_back(mainWindow);
-    // TODO: Remove window from list when destroyed.
+    QObject::connect(
+        mainWindow, &QObject::destroyed, [this, mainWindow]() { _terminalWindows.remove(mainWindow); });
 
     // QObject::connect(mainWindow, &TerminalWindow::showNotification,
     //                  this, &ContourGuiApp::showNotification);
@@ -411,9 +648,45 @@ TerminalWindow* ContourGuiApp::newWindow()
     mainWindow->show();
 
     _terminalWindows.emplace_back(mainWindow);
+    QObject::connect(
+        mainWindow, &QObject::destroyed, [this, mainWindow]() { _terminalWindows.remove(mainWindow); });
     return _terminalWindows.back();
 }
 
+TerminalWindow* ContourGuiApp::newWindow(WindowRequest const& _request)
+{
+    auto const theProfileName = _request.profileName.empty() ? profileName() : _request.profileName;
+    auto* profile = _config.profile(theProfileName);
+    if (!profile)
+    {
+        errorlog()("No profile with name '{}' found.", theProfileName);
+        return nullptr;
+    }
+
+    // The overrides only apply to the session created along with the window.
+    auto const savedShell = profile->shell;
+    auto const _ = crispy::finally { [&]() {
+        profile->shell = savedShell;
+        _profileNameOverride.reset();
+        _shellOverridden = false;
+    } };
+
+    _profileNameOverride = theProfileName;
+    if (!_request.workingDirectory.empty())
+    {
+        profile->shell.workingDirectory = FileSystem::path(_request.workingDirectory);
+        _shellOverridden = true;
+    }
+    if (!_request.command.empty())
+    {
+        profile->shell.program = _request.command.front();
+        profile->shell.arguments.assign(std::next(_request.command.begin()), _request.command.end());
+        _shellOverridden = true;
+    }
+
+    return newWindow();
+}
+
 void ContourGuiApp::showNotification(std::string_view _title, std::string_view _content)
 {
     // systrayIcon_->showMessage(
@@ -23,6 +23,9 @@
 #include <memory>
 #include <optional>
 #include <string_view>
+#include <vector>
+
+class QLocalServer;
 
 namespace contour
 {
@@ -47,8 +50,17 @@ class ContourGuiApp: public ContourApp
     int run(int argc, char const* argv[]) override;
     crispy::cli::Command parameterDefinition() const override;
 
+    /// Arguments of a contour invocation that has been forwarded to this running instance.
+    struct WindowRequest
+    {
+        std::string profileName;
+        std::string workingDirectory;
+        std::vector<std::string> command;
+    };
+
     TerminalWindow* newWindow();
     TerminalWindow* newWindow(contour::config::Config const& _config);
+    TerminalWindow* newWindow(WindowRequest const& _request);
     void showNotification(std::string_view _title, std::string_view _content);
 
     std::string profileName() const;
@@ -56,6 +68,7 @@ class ContourGuiApp: public ContourApp
     std::optional<terminal::Process::ExitStatus> exitStatus() const noexcept { return _exitStatus; }
 
     std::optional<FileSystem::path> dumpStateAtExit() const;
+    std::optional<FileSystem::path> ptyRecordingPath() const;
 
     void onExit(TerminalSession& _session);
 
@@ -77,11 +90,21 @@ class ContourGuiApp: public ContourApp
 
     std::string programPath() const { return _argv[0]; }
 
+    /// Tells whether the session currently being created runs a shell of a forwarded request,
+    /// in which case pre-spawned shells must not be used for it.
+    [[nodiscard]] bool shellOverridden() const noexcept { return _shellOverridden; }
+
   private:
     void ensureTermInfoFile();
     bool loadConfig(std::string const& target);
     int terminalGuiAction();
     int fontConfigAction();
+    int benchmarkRenderAction();
+
+    /// Hands the terminal arguments over to an already running single instance.
+    /// @returns true if a running instance accepted them, false otherwise.
+    bool forwardToRunningInstance();
+    void listenForInstances();
 
     config::Config _config;
     TerminalSessionManager _sessionManager;
@@ -91,6 +114,10 @@ class ContourGuiApp: public ContourApp
     std::optional<terminal::Process::ExitStatus> _exitStatus;
 
     std::list<TerminalWindow*> _terminalWindows;
+
+    std::optional<std::string> _profileNameOverride; //!< profile of a forwarded request
+    bool _shellOverridden = false;
+    std::unique_ptr<QLocalServer> _instanceServer; //!< accepts forwarded requests in single-instance mode
 };
 
 } // namespace contour
@@ -14,8 +14,10 @@
 #include <contour/ContourGuiApp.h>
 #include <contour/TerminalSession.h>
 #include <contour/display/TerminalWidget.h>
+#include <contour/display/TimerWheel.h>
 #include <contour/helper.h>
 
+#include <terminal/HistoryExport.h>
 #include <terminal/MatchModes.h>
 #include <terminal/Process.h>
 #include <terminal/Terminal.h>
@@ -47,6 +49,8 @@
 
 #if !defined(_WIN32)
     #include <pthread.h>
+#else
+    #include <Windows.h>
 #endif
 
 #if !defined(_MSC_VER)
@@ -82,6 +86,62 @@ namespace
 #endif
     }
 
+    /// Lowers the scheduling priority of the calling thread, or restores it.
+    ///
+    /// Both must be possible without privileges, such as by SCHED_BATCH not touching the nice value.
+    void setThreadBackgroundPriority(bool background)
+    {
+#if defined(__APPLE__)
+        pthread_set_qos_class_self_np(background ? QOS_CLASS_UTILITY : QOS_CLASS_DEFAULT, 0);
+#elif defined(__linux__)
+        auto const param = sched_param {};
+        pthread_setschedparam(pthread_self(), background ? SCHED_BATCH : SCHED_OTHER, &param);
+#elif defined(_WIN32)
+        SetThreadPriority(GetCurrentThread(),
+                          background ? THREAD_PRIORITY_BELOW_NORMAL : THREAD_PRIORITY_NORMAL);
+#else
+        (void) background;
+#endif
+    }
+
+    /// Time to wait for further changes of the configuration file before reloading it, as editors
+    /// may save several times in a row (e.g. on every keystroke).
+    constexpr auto ConfigReloadDelay = 250ms;
+
+    /// Loads and validates the given configuration file.
+    ///
+    /// @returns the configuration, or nothing if it failed to load or lacks the given profile.
+    optional<config::Config> loadConfigWithProfile(FileSystem::path const& _path, string const& _profileName)
+    {
+        auto newConfig = config::Config {};
+        auto configFailures = int { 0 };
+
+        try
+        {
+            loadConfigFromFile(newConfig, _path);
+        }
+        catch (exception const& e)
+        {
+            // TODO: logger_.error(e.what());
+            errorlog()("Configuration failure. {}", unhandledExceptionMessage(__PRETTY_FUNCTION__, e));
+            ++configFailures;
+        }
+
+        if (!newConfig.profile(_profileName))
+        {
+            errorlog()(fmt::format("Currently active profile with name '{}' gone.", _profileName));
+            ++configFailures;
+        }
+
+        if (configFailures)
+        {
+            errorlog()("Failed to load configuration.");
+            return nullopt;
+        }
+
+        return { std::move(newConfig) };
+    }
+
     string normalize_crlf(QString&& text)
     {
 #if !defined(_WIN32)
@@ -94,7 +154,9 @@ namespace
 
 TerminalSession::TerminalSession(unique_ptr<Pty> _pty, ContourGuiApp& _app):
     startTime_ { steady_clock::now() },
+    lastActivity_ { startTime_ },
     config_ { _app.config() },
+    inputMappings_ { config_.inputMappings },
     profileName_ { _app.profileName() },
     profile_ { *config_.profile(profileName_) },
     app_ { _app },
@@ -126,18 +188,47 @@ TerminalSession::TerminalSession(unique_ptr<Pty> _pty, ContourGuiApp& _app):
                 SIGNAL(fileChanged(const QString&)),
                 this,
                 SLOT(onConfigReload()));
+        configReloadTimer_.setSingleShot(true);
+        configReloadTimer_.setInterval(ConfigReloadDelay);
+        connect(&configReloadTimer_, &QTimer::timeout, this, &TerminalSession::loadConfigInBackground);
     }
     musicalNotesBuffer_.reserve(16);
     profile_ = *config_.profile(profileName_); // XXX do it again. but we've to be more efficient here
     configureTerminal();
+    terminal_.setPtyBufferHugePages(config_.ptyBufferHugePages);
+    terminal_.setSequenceProfiling(config_.vtSequenceProfiling);
 }
 
 TerminalSession::~TerminalSession()
 {
+    // Sessions destroyed in the background have been shut down on the GUI thread already,
+    // which also owns the timers and the file watcher released by shutting down.
+    if (!terminating_)
+        shutdown();
+}
+
+void TerminalSession::shutdown()
+{
+    if (terminating_)
+        return;
+
     terminating_ = true;
+    display::TimerWheel::shared().cancel(this);
+    if (ptyReactor_)
+        ptyReactor_->remove(terminal_.device());
     terminal_.device().wakeupReader();
     if (screenUpdateThread_)
+    {
         screenUpdateThread_->join();
+        screenUpdateThread_.reset();
+    }
+
+    // Nothing refers to the display anymore once the main loop is gone.
+    display_ = nullptr;
+    configReloadTimer_.stop();
+    configFileChangeWatcher_.reset();
+    if (configLoadJob_.valid())
+        configLoadJob_.wait();
 }
 
 void TerminalSession::attachDisplay(display::TerminalWidget& newDisplay)
@@ -165,9 +256,54 @@ void TerminalSession::scheduleRedraw()
         display_->scheduleRedraw();
 }
 
+void TerminalSession::setVisible(bool _visible)
+{
+    SessionLog()("Session is {}.", _visible ? "visible" : "in the background");
+    terminal_.setVisible(_visible);
+    if (_visible)
+    {
+        lastActivity_.store(steady_clock::now(), std::memory_order_relaxed);
+        scheduleRedraw();
+    }
+}
+
+bool TerminalSession::trimMemoryIfIdle(steady_clock::time_point _now, chrono::seconds _idleTimeout)
+{
+    auto const lastActivity = lastActivity_.load(std::memory_order_relaxed);
+    if (memoryTrimmedAt_ > lastActivity || _now - lastActivity < _idleTimeout)
+        return false; // Already trimmed, or not idle for long enough.
+
+    SessionLog()("Releasing caches, idle for {} seconds.",
+                 chrono::duration_cast<chrono::seconds>(_now - lastActivity).count());
+    memoryTrimmedAt_ = _now;
+    terminal_.trimMemory();
+    if (display_)
+        display_->releaseCaches();
+    return true;
+}
+
 void TerminalSession::start()
 {
+    if (auto const path = app_.ptyRecordingPath(); path.has_value())
+        terminal_.setPtyRecorder(terminal::PtyRecorder::create(*path, terminal_.totalPageSize()));
+
     terminal_.device().start();
+
+    // Reported as soon as the shell exited, on the thread watching all shells, whereas the PTY
+    // only hangs up once background jobs holding on to it exited, too.
+    if (auto* process = dynamic_cast<terminal::Process*>(&terminal_.device()))
+        process->setExitHandler([](terminal::Process::ExitStatus _status) {
+            SessionLog()("Shell process exited with status {}.", _status);
+        });
+
+    if (ptyReactor_ && ptyReactor_->add(terminal_.device(), [this]() { return processAvailableInput(); }))
+    {
+        SessionLog()("Processing PTY input on the shared PTY reactor.");
+        return;
+    }
+    ptyReactor_.reset();
+
+    terminal_.startPtyReaderThread(config_.pipelinedParsing);
     screenUpdateThread_ = make_unique<std::thread>(bind(&TerminalSession::mainLoop, this));
 }
 
@@ -183,8 +319,12 @@ void TerminalSession::mainLoop()
         return sstr.str();
     }());
 
+    auto background = false;
     while (!terminating_)
     {
+        if (background == terminal_.isVisible())
+            setThreadBackgroundPriority(background = !background);
+
         if (!terminal_.processInputOnce())
             break;
     }
@@ -193,6 +333,25 @@ void TerminalSession::mainLoop()
     onClosed();
 }
 
+bool TerminalSession::processAvailableInput()
+{
+    // The worker threads are shared with the other sessions, so do not leave them deprioritized.
+    auto const background = !terminal_.isVisible();
+    if (background)
+        setThreadBackgroundPriority(true);
+    auto const open = !terminating_ && terminal_.processAvailableInput();
+    if (background)
+        setThreadBackgroundPriority(false);
+
+    if (open)
+        return true;
+
+    SessionLog()("PTY input processing terminating (PTY {}).",
+                 terminal_.device().isClosed() ? "closed" : "open");
+    onClosed();
+    return false;
+}
+
 void TerminalSession::terminate()
 {
     if (!display_)
@@ -212,14 +371,13 @@ void TerminalSession::bell()
 
 void TerminalSession::bufferChanged(terminal::ScreenType _type)
 {
-    if (!display_)
-        return;
-
-    display_->post([this, _type]() { display_->bufferChanged(_type); });
+    postPendingEvent([_type](PendingEvents& _events) { _events.bufferType = _type; });
 }
 
 void TerminalSession::screenUpdated()
 {
+    lastActivity_.store(steady_clock::now(), std::memory_order_relaxed);
+
     if (!display_)
         return;
 
@@ -230,11 +388,19 @@ void TerminalSession::screenUpdated()
     if (terminal().hasInput())
         display_->post(bind(&TerminalSession::flushInput, this));
 
+    // setVisible() redraws once visible again.
+    if (!terminal_.isVisible())
+        return;
+
     scheduleRedraw();
 }
 
 void TerminalSession::flushInput()
 {
+    // Keeps the paste progress in the indicator status line up to date.
+    if (terminal().pasteProgress())
+        scheduleRedraw();
+
     terminal().flushInput();
     if (terminal().hasInput() && display_)
         display_->post(bind(&TerminalSession::flushInput, this));
@@ -242,7 +408,7 @@ void TerminalSession::flushInput()
 
 void TerminalSession::renderBufferUpdated()
 {
-    if (!display_)
+    if (!display_ || !terminal_.isVisible())
         return;
 
     display_->renderBufferUpdated();
@@ -256,13 +422,29 @@ void TerminalSession::requestCaptureBuffer(LineCount lines, bool logical)
     display_->post([this, lines, logical]() {
         if (display_->requestPermission(profile_.permissions.captureBuffer, "capture screen buffer"))
         {
-            terminal_.primaryScreen().captureBuffer(lines, logical);
-            DisplayLog()("requestCaptureBuffer: Finished. Waking up I/O thread.");
-            flushInput();
+            terminal_.startCaptureBuffer(lines, logical);
+            continueCaptureBuffer();
         }
     });
 }
 
+void TerminalSession::continueCaptureBuffer()
+{
+    // Only a few chunks are queued ahead of the application reading them,
+    // so that capturing a large history neither piles up in memory nor blocks the terminal.
+    auto constexpr MaxPendingCaptureBytes = size_t { 64 * 1024 };
+
+    if (terminal_.pendingInputBytes() < MaxPendingCaptureBytes && !terminal_.continueCaptureBuffer())
+    {
+        DisplayLog()("requestCaptureBuffer: Finished. Waking up I/O thread.");
+        flushInput();
+        return;
+    }
+
+    flushInput();
+    display_->post(bind(&TerminalSession::continueCaptureBuffer, this));
+}
+
 terminal::FontDef TerminalSession::getFontDef()
 {
     return display_->getFontDef();
@@ -327,10 +509,9 @@ void TerminalSession::inspect()
 
 void TerminalSession::notify(string_view _title, string_view _content)
 {
-    if (!display_)
-        return;
-
-    display_->notify(_title, _content);
+    postPendingEvent([&](PendingEvents& _events) {
+        _events.notification = pair { string(_title), string(_content) };
+    });
 }
 
 void TerminalSession::onClosed()
@@ -442,10 +623,7 @@ void TerminalSession::requestWindowResize(Width _width, Height _height)
 
 void TerminalSession::setWindowTitle(string_view _title)
 {
-    if (!display_)
-        return;
-
-    display_->post([this, terminalTitle = string(_title)]() { display_->setWindowTitle(terminalTitle); });
+    postPendingEvent([&](PendingEvents& _events) { _events.windowTitle = string(_title); });
 }
 
 void TerminalSession::setTerminalProfile(string const& _configProfileName)
@@ -481,6 +659,7 @@ void TerminalSession::inputModeChanged(terminal::ViMode mode)
 // {{{ Input Events
 void TerminalSession::sendKeyPressEvent(Key _key, Modifier _modifier, Timestamp _now)
 {
+    lastActivity_.store(_now, std::memory_order_relaxed);
     InputLog()("key press: {} {}", _modifier, _key);
 
     if (terminatedAndWaitingForKeyPress_)
@@ -491,8 +670,7 @@ void TerminalSession::sendKeyPressEvent(Key _key, Modifier _modifier, Timestamp
 
     display_->setMouseCursorShape(MouseCursorShape::Hidden);
 
-    if (auto const* actions =
-            config::apply(config_.inputMappings.keyMappings, _key, _modifier, matchModeFlags()))
+    if (auto const* actions = inputMappings_.keyMappings.find(_key, _modifier, matchModeFlags()))
         executeAllActions(*actions);
     else
         terminal().sendKeyPressEvent(_key, _modifier, _now);
@@ -500,6 +678,7 @@ void TerminalSession::sendKeyPressEvent(Key _key, Modifier _modifier, Timestamp
 
 void TerminalSession::sendCharPressEvent(char32_t _value, Modifier _modifier, Timestamp _now)
 {
+    lastActivity_.store(_now, std::memory_order_relaxed);
     InputLog()("Character press event received: {} {}",
                _modifier,
                crispy::escape(unicode::convert_to<char>(_value)));
@@ -514,8 +693,7 @@ void TerminalSession::sendCharPressEvent(char32_t _value, Modifier _modifier, Ti
 
     display_->setMouseCursorShape(MouseCursorShape::Hidden);
 
-    if (auto const* actions =
-            config::apply(config_.inputMappings.charMappings, _value, _modifier, matchModeFlags()))
+    if (auto const* actions = inputMappings_.charMappings.find(_value, _modifier, matchModeFlags()))
         executeAllActions(*actions);
     else
         terminal().sendCharPressEvent(_value, _modifier, _now); // TODO: get rid of Event{} struct here, too!
@@ -526,6 +704,8 @@ void TerminalSession::sendMousePressEvent(Modifier _modifier,
                                           PixelCoordinate _pixelPosition,
                                           Timestamp _now)
 {
+    lastActivity_.store(_now, std::memory_order_relaxed);
+
     // InputLog()("sendMousePressEvent: {} {} at {}", _button, _modifier, currentMousePosition_);
 
     // First try to pass the mouse event to the application, as it might have requested that.
@@ -535,8 +715,7 @@ void TerminalSession::sendMousePressEvent(Modifier _modifier,
         return;
     }
 
-    if (auto const* actions =
-            config::apply(config_.inputMappings.mouseMappings, _button, _modifier, matchModeFlags()))
+    if (auto const* actions = inputMappings_.mouseMappings.find(_button, _modifier, matchModeFlags()))
     {
         if (executeAllActions(*actions))
             return;
@@ -611,7 +790,21 @@ void TerminalSession::sendFocusOutEvent()
 
 void TerminalSession::updateHighlights()
 {
-    QTimer::singleShot(terminal().highlightTimeout(), this, SLOT(onHighlightUpdate()));
+    // Nobody is going to see the highlight anyway.
+    if (!terminal_.isVisible())
+    {
+        terminal_.resetHighlight();
+        return;
+    }
+
+    // May be invoked from the terminal thread, whereas the timer wheel is owned by the GUI thread.
+    QMetaObject::invokeMethod(
+        this,
+        [this]() {
+            display::TimerWheel::shared().schedule(
+                this, terminal().highlightTimeout(), [this]() { onHighlightUpdate(); });
+        },
+        Qt::AutoConnection);
 }
 
 void TerminalSession::onHighlightUpdate()
@@ -629,7 +822,75 @@ void TerminalSession::playSound(terminal::Sequence::Parameters const& params_)
 
 void TerminalSession::cursorPositionChanged()
 {
-    QGuiApplication::inputMethod()->update(Qt::ImCursorRectangle);
+    postPendingEvent([](PendingEvents& _events) { _events.cursorPositionChanged = true; });
+}
+
+template <typename F>
+void TerminalSession::postPendingEvent(F&& _update)
+{
+    if (!display_)
+        return;
+
+    {
+        auto const _ = std::lock_guard { pendingEventsMutex_ };
+        _update(pendingEvents_);
+        if (std::exchange(pendingEvents_.deliveryScheduled, true))
+            return;
+    }
+
+    // Anything raised until the delivery is merged into it, keeping only the latest value of each event.
+    display_->post([this]() {
+        auto const nextDelivery = pendingEventsDeliveredAt_ + terminal_.refreshInterval();
+        auto const now = steady_clock::now();
+        if (now >= nextDelivery)
+            deliverPendingEvents();
+        else
+            QTimer::singleShot(chrono::duration_cast<chrono::milliseconds>(nextDelivery - now) + 1ms,
+                               this,
+                               [this]() { deliverPendingEvents(); });
+    });
+}
+
+void TerminalSession::deliverPendingEvents()
+{
+    auto events = PendingEvents {};
+    {
+        auto const _ = std::lock_guard { pendingEventsMutex_ };
+        events = std::exchange(pendingEvents_, PendingEvents {});
+    }
+    pendingEventsDeliveredAt_ = steady_clock::now();
+
+    if (!display_)
+        return;
+
+    if (events.bufferType)
+        display_->bufferChanged(*events.bufferType);
+    if (events.windowTitle)
+        display_->setWindowTitle(*events.windowTitle);
+    if (events.notification)
+        display_->notify(events.notification->first, events.notification->second);
+    if (events.cursorPositionChanged)
+        QGuiApplication::inputMethod()->update(Qt::ImCursorRectangle);
+}
+
+void TerminalSession::post(std::function<void()> _fn)
+{
+    if (display_)
+        display_->post(std::move(_fn));
+}
+
+terminal::TmuxControlParser::Events* TerminalSession::tmuxControlModeStarted()
+{
+    if (!config_.tmuxControlMode)
+    {
+        SessionLog()("Ignoring tmux control mode, as it is not enabled (tmux_control_mode).");
+        return nullptr;
+    }
+
+    if (!tmuxControlClient_)
+        tmuxControlClient_ = make_unique<TmuxControlClient>(*this, app_.sessionsManager());
+    tmuxControlClient_->start();
+    return tmuxControlClient_.get();
 }
 // }}}
 // {{{ Actions
@@ -664,6 +925,12 @@ bool TerminalSession::operator()(actions::ClearHistoryAndReset)
     return true;
 }
 
+bool TerminalSession::operator()(actions::CopyLastCommandOutput)
+{
+    copyToClipboard(terminal().extractLastCommandOutput());
+    return true;
+}
+
 bool TerminalSession::operator()(actions::CopyPreviousMarkRange)
 {
     copyToClipboard(terminal().extractLastMarkRange());
@@ -672,7 +939,8 @@ bool TerminalSession::operator()(actions::CopyPreviousMarkRange)
 
 bool TerminalSession::operator()(actions::CopySelection)
 {
-    copyToClipboard(terminal().extractSelectionText());
+    // Huge selections take a while to extract, which must not block the GUI thread.
+    terminal().extractSelectionTextInBackground([this](string _text) { copyToClipboard(_text); });
     return true;
 }
 
@@ -726,6 +994,13 @@ bool TerminalSession::operator()(actions::FollowHyperlink)
         followHyperlink(*hyperlink);
         return true;
     }
+    if (auto url = terminal().tryGetHoveringPlainTextUrl())
+    {
+        if (url->find("://") == string::npos)
+            url->insert(0, "http://");
+        followHyperlink(terminal::HyperlinkInfo { "", std::move(*url) });
+        return true;
+    }
     return false;
 }
 
@@ -826,6 +1101,43 @@ bool TerminalSession::operator()(actions::ResetFontSize)
     return true;
 }
 
+bool TerminalSession::operator()(actions::SaveScrollback const& _action)
+{
+    auto const format = terminal::parseHistoryExportFormat(_action.format);
+    if (!format)
+    {
+        errorlog()("SaveScrollback: Unknown format: {}", _action.format);
+        return false;
+    }
+
+    if (exportJob_.valid() && exportJob_.wait_for(chrono::seconds(0)) != future_status::ready)
+    {
+        SessionLog()("SaveScrollback: A previous export is still running.");
+        return false;
+    }
+
+    // Only take the snapshot with the terminal locked, so that the export does not stall the PTY.
+    auto lines = vector<Line<PrimaryScreenCell>> {};
+    auto colorPalette = ColorPalette {};
+    {
+        auto _l = lock_guard { terminal() };
+        lines = terminal::snapshotLines(terminal().primaryScreen().grid());
+        colorPalette = terminal().colorPalette();
+    }
+
+    auto const fileName = fmt::format("scrollback.{}", terminal::fileExtension(*format));
+    exportJob_ = std::async(std::launch::async,
+                            [lines = std::move(lines), colorPalette, fileName, format = *format]() {
+                                ofstream ofs { fileName, ios::trunc | ios::binary };
+                                terminal::exportLines(gsl::span<Line<PrimaryScreenCell> const>(lines),
+                                                      format,
+                                                      colorPalette,
+                                                      ofs);
+                                SessionLog()("SaveScrollback: Saved {} lines to {}.", lines.size(), fileName);
+                            });
+    return true;
+}
+
 bool TerminalSession::operator()(actions::ScreenshotVT)
 {
     auto _l = lock_guard { terminal() };
@@ -886,6 +1198,12 @@ bool TerminalSession::operator()(actions::ScrollToBottom)
     return true;
 }
 
+bool TerminalSession::operator()(actions::ScrollToPreviousFailedCommand)
+{
+    terminal().viewport().scrollToPreviousFailedCommand();
+    return true;
+}
+
 bool TerminalSession::operator()(actions::ScrollToTop)
 {
     terminal().viewport().scrollToTop();
@@ -990,8 +1308,26 @@ bool TerminalSession::reloadConfig(config::Config _newConfig, string const& _pro
                  _newConfig.backingFilePath.string(), _profileName);
     // clang-format on
 
+    if (_profileName != profileName_ || !_newConfig.profile(_profileName))
+    {
+        config_ = std::move(_newConfig);
+        inputMappings_ = config::InputMappingTables { config_.inputMappings };
+        activateProfile(_profileName);
+        return true;
+    }
+
+    // Reloading the active profile only reapplies what actually changed, such that e.g. changing
+    // a color does not reload the fonts and flush all of the renderer's caches.
+    auto const previousProfile = profile_;
+    auto const previousFonts = config_.profile(profileName_)->fonts;
     config_ = std::move(_newConfig);
-    activateProfile(_profileName);
+    inputMappings_ = config::InputMappingTables { config_.inputMappings };
+    profile_ = *config_.profile(profileName_);
+    if (profile_.fonts == previousFonts)
+        profile_.fonts = previousProfile.fonts; // Retains font size changes made at runtime.
+
+    configureTerminal();
+    reconfigureDisplay(previousProfile);
 
     return true;
 }
@@ -1089,6 +1425,7 @@ void TerminalSession::configureTerminal()
     terminal_.setMouseProtocolBypassModifier(config_.bypassMouseProtocolModifier);
     terminal_.setMouseBlockSelectionModifier(config_.mouseBlockSelectionModifier);
     terminal_.setLastMarkRangeOffset(profile_.copyLastMarkRangeOffset);
+    terminal_.setRenderBufferThreadCount(config_.renderBufferThreads);
 
     SessionLog()("Setting terminal ID to {}.", profile_.terminalId);
     terminal_.setTerminalId(profile_.terminalId);
@@ -1096,6 +1433,10 @@ void TerminalSession::configureTerminal()
     terminal_.setMaxImageColorRegisters(config_.maxImageColorRegisters);
     terminal_.setMaxImageSize(config_.maxImageSize);
     terminal_.setMode(terminal::DECMode::NoSixelScrolling, !config_.sixelScrolling);
+    terminal_.setProgressiveSixel(config_.sixelProgressive);
+    terminal_.setSixelDecoderThreads(config_.sixelDecoderThreads);
+    terminal_.setImageRasterizerThreads(config_.imageRasterizerThreads);
+    terminal_.setImageMemoryBudget(size_t { config_.imageMemoryBudget } * 1024 * 1024);
     terminal_.setStatusDisplay(profile_.initialStatusDisplayType);
     SessionLog()("maxImageSize={}, sixelScrolling={}", config_.maxImageSize, config_.sixelScrolling);
 
@@ -1107,6 +1448,7 @@ void TerminalSession::configureTerminal()
     terminal_.colorPalette() = profile_.colors;
     terminal_.defaultColorPalette() = profile_.colors;
     terminal_.setMaxHistoryLineCount(profile_.maxHistoryLineCount);
+    terminal_.setHistoryCompactionThreshold(profile_.historyCompactionThreshold);
     terminal_.setHighlightTimeout(profile_.highlightTimeout);
     terminal_.viewport().setScrollOff(profile_.modalCursorScrollOff);
 }
@@ -1152,6 +1494,46 @@ void TerminalSession::configureDisplay()
     display_->logDisplayTopInfo();
 }
 
+void TerminalSession::reconfigureDisplay(config::TerminalProfile const& _previousProfile)
+{
+    if (!display_)
+        return;
+
+    SessionLog()("Reconfiguring display.");
+
+    if (profile_.backgroundBlur != _previousProfile.backgroundBlur)
+        display_->setBlurBehind(profile_.backgroundBlur);
+
+    auto const sameBackgroundImage = [](auto const& a, auto const& b) {
+        if (!a || !b)
+            return a == b;
+        return a->hash == b->hash && a->opacity == b->opacity && a->blur == b->blur;
+    };
+    if (!sameBackgroundImage(profile_.colors.backgroundImage, _previousProfile.colors.backgroundImage))
+        display_->setBackgroundImage(profile_.colors.backgroundImage);
+
+    if (profile_.maximized != _previousProfile.maximized)
+    {
+        if (profile_.maximized)
+            display_->setWindowMaximized();
+        else
+            display_->setWindowNormal();
+    }
+
+    if (profile_.fullscreen != _previousProfile.fullscreen && profile_.fullscreen != display_->isFullScreen())
+        display_->toggleFullScreen();
+
+    if (profile_.fonts != _previousProfile.fonts)
+        display_->setFonts(profile_.fonts);
+
+    if (profile_.hyperlinkDecoration.normal != _previousProfile.hyperlinkDecoration.normal
+        || profile_.hyperlinkDecoration.hover != _previousProfile.hyperlinkDecoration.hover)
+        display_->setHyperlinkDecoration(profile_.hyperlinkDecoration.normal,
+                                         profile_.hyperlinkDecoration.hover);
+
+    scheduleRedraw();
+}
+
 uint8_t TerminalSession::matchModeFlags() const
 {
     uint8_t flags = 0;
@@ -1187,33 +1569,40 @@ void TerminalSession::setFontSize(text::font_size _size)
 
 bool TerminalSession::reloadConfigWithProfile(string const& _profileName)
 {
-    auto newConfig = config::Config {};
-    auto configFailures = int { 0 };
+    auto newConfig = loadConfigWithProfile(config_.backingFilePath, _profileName);
+    if (!newConfig)
+        return false;
 
-    try
-    {
-        loadConfigFromFile(newConfig, config_.backingFilePath.string());
-    }
-    catch (exception const& e)
-    {
-        // TODO: logger_.error(e.what());
-        errorlog()("Configuration failure. {}", unhandledExceptionMessage(__PRETTY_FUNCTION__, e));
-        ++configFailures;
-    }
+    return reloadConfig(std::move(*newConfig), _profileName);
+}
 
-    if (!newConfig.profile(_profileName))
+void TerminalSession::loadConfigInBackground()
+{
+    if (configLoadJob_.valid() && configLoadJob_.wait_for(chrono::seconds(0)) != future_status::ready)
     {
-        errorlog()(fmt::format("Currently active profile with name '{}' gone.", _profileName));
-        ++configFailures;
+        // Load again once the running job is done, as it may have read the file before the change.
+        configReloadPending_ = true;
+        return;
     }
+    configReloadPending_ = false;
 
-    if (configFailures)
-    {
-        errorlog()("Failed to load configuration.");
-        return false;
-    }
+    // Parsing and validating the YAML file is done off the GUI thread, which then only applies
+    // the changes (see reloadConfig()).
+    configLoadJob_ = std::async(
+        std::launch::async, [this, path = config_.backingFilePath, profileName = profileName_]() {
+            auto newConfig = make_shared<optional<config::Config>>(loadConfigWithProfile(path, profileName));
 
-    return reloadConfig(std::move(newConfig), _profileName);
+            // Queued calls are dropped if the session is gone meanwhile.
+            QMetaObject::invokeMethod(
+                this,
+                [this, newConfig, profileName]() {
+                    if (*newConfig && !terminating_ && profileName == profileName_)
+                        reloadConfig(std::move(**newConfig), profileName);
+                    if (configReloadPending_)
+                        configReloadTimer_.start();
+                },
+                Qt::QueuedConnection);
+        });
 }
 
 bool TerminalSession::resetConfig()
@@ -1278,17 +1667,16 @@ bool TerminalSession::requestPermission(config::Permission _allowedByConfig, str
 
 void TerminalSession::onConfigReload()
 {
-    display_->post([this]() { reloadConfigWithProfile(profileName_); });
+    if (!configFileChangeWatcher_)
+        return;
 
-    // TODO: needed still?
-    // if (setScreenDirty())
-    //     update();
+    // Editors that save by replacing the file make the watcher lose track of it.
+    auto const path = QString::fromStdString(config_.backingFilePath.generic_string());
+    if (!configFileChangeWatcher_->files().contains(path) && QFileInfo::exists(path))
+        configFileChangeWatcher_->addPath(path);
 
-    if (configFileChangeWatcher_)
-        connect(configFileChangeWatcher_.get(),
-                SIGNAL(fileChanged(const QString&)),
-                this,
-                SLOT(onConfigReload()));
+    // (Re)starting the timer coalesces a burst of changes into a single reload.
+    configReloadTimer_.start();
 }
 
 // }}}
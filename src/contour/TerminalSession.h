@@ -15,16 +15,24 @@
 
 #include <contour/Audio.h>
 #include <contour/Config.h>
+#include <contour/TmuxControlClient.h>
 
 #include <terminal/Terminal.h>
+#include <terminal/pty/PtyReactor.h>
 
 #include <terminal_renderer/Renderer.h>
 
 #include <crispy/point.h>
 
 #include <QtCore/QFileSystemWatcher>
+#include <QtCore/QTimer>
 
+#include <atomic>
+#include <chrono>
 #include <functional>
+#include <future>
+#include <mutex>
+#include <optional>
 #include <thread>
 
 namespace contour
@@ -59,12 +67,43 @@ class TerminalSession: public QObject, public terminal::Terminal::Events
     TerminalSession(std::unique_ptr<terminal::Pty> _pty, ContourGuiApp& _app);
     ~TerminalSession() override;
 
+    /// Makes start() process the PTY's input on the given shared reactor,
+    /// rather than on threads of this session's own (if the PTY supports that).
+    void setPtyReactor(std::shared_ptr<terminal::PtyReactor> _reactor) { ptyReactor_ = std::move(_reactor); }
+
     /// Starts the VT background thread.
     void start();
 
+    /// Marks the session as being visible or not, see TerminalSessionManager::setSessionVisible().
+    void setVisible(bool _visible);
+
+    /// Releases the memory of the terminal and its display that is only held on to for speed,
+    /// unless there has been neither input nor output since the last time or for less than @p _idleTimeout.
+    ///
+    /// @retval true the memory has been released.
+    bool trimMemoryIfIdle(std::chrono::steady_clock::time_point _now, std::chrono::seconds _idleTimeout);
+
+    /// @returns the time of the last user input or PTY output.
+    [[nodiscard]] std::chrono::steady_clock::time_point lastActivity() const noexcept
+    {
+        return lastActivity_.load(std::memory_order_relaxed);
+    }
+
+    /// Tests whether the memory has been released and there has been neither input nor output since.
+    [[nodiscard]] bool memoryTrimmed() const noexcept
+    {
+        return memoryTrimmedAt_ > lastActivity_.load(std::memory_order_relaxed);
+    }
+
     /// Initiates termination of this session, regardless of the underlying terminal state.
     void terminate();
 
+    /// Stops processing the PTY input and detaches the display, which may be destroyed afterwards,
+    /// as may this session, on any thread, e.g. in the background once its window has been closed.
+    ///
+    /// Must be called on the GUI thread. Calling it again does nothing.
+    void shutdown();
+
     config::Config const& config() const noexcept { return config_; }
     config::TerminalProfile const& profile() const noexcept { return profile_; }
 
@@ -105,6 +144,8 @@ class TerminalSession: public QObject, public terminal::Terminal::Events
     void updateHighlights() override;
     void playSound(terminal::Sequence::Parameters const& params_) override;
     void cursorPositionChanged() override;
+    void post(std::function<void()> _fn) override;
+    terminal::TmuxControlParser::Events* tmuxControlModeStarted() override;
 
     // Input Events
     using Timestamp = std::chrono::steady_clock::time_point;
@@ -131,6 +172,7 @@ class TerminalSession: public QObject, public terminal::Terminal::Events
     bool operator()(actions::CancelSelection);
     bool operator()(actions::ChangeProfile const&);
     bool operator()(actions::ClearHistoryAndReset);
+    bool operator()(actions::CopyLastCommandOutput);
     bool operator()(actions::CopyPreviousMarkRange);
     bool operator()(actions::CopySelection);
     bool operator()(actions::CreateDebugDump);
@@ -151,6 +193,7 @@ class TerminalSession: public QObject, public terminal::Terminal::Events
     bool operator()(actions::ReloadConfig const&);
     bool operator()(actions::ResetConfig);
     bool operator()(actions::ResetFontSize);
+    bool operator()(actions::SaveScrollback const&);
     bool operator()(actions::ScreenshotVT);
     bool operator()(actions::ScrollDown);
     bool operator()(actions::ScrollMarkDown);
@@ -160,6 +203,7 @@ class TerminalSession: public QObject, public terminal::Terminal::Events
     bool operator()(actions::ScrollPageDown);
     bool operator()(actions::ScrollPageUp);
     bool operator()(actions::ScrollToBottom);
+    bool operator()(actions::ScrollToPreviousFailedCommand);
     bool operator()(actions::ScrollToTop);
     bool operator()(actions::ScrollUp);
     bool operator()(actions::SearchReverse);
@@ -202,6 +246,7 @@ class TerminalSession: public QObject, public terminal::Terminal::Events
     void spawnNewTerminal(std::string const& _profileName);
     void activateProfile(std::string const& _newProfileName);
     bool reloadConfigWithProfile(std::string const& _profileName);
+    void loadConfigInBackground();
     bool resetConfig();
     void followHyperlink(terminal::HyperlinkInfo const& _hyperlink);
     bool requestPermission(config::Permission _allowedByConfig, std::string_view _topicText);
@@ -210,14 +255,23 @@ class TerminalSession: public QObject, public terminal::Terminal::Events
     void configureTerminal();
     void configureCursor(config::CursorConfig const& cursorConfig);
     void configureDisplay();
+    void reconfigureDisplay(config::TerminalProfile const& _previousProfile);
     uint8_t matchModeFlags() const;
     void flushInput();
+    void continueCaptureBuffer();
+    template <typename F>
+    void postPendingEvent(F&& _update);
+    void deliverPendingEvents();
     void mainLoop();
+    bool processAvailableInput();
 
     // private data
     //
     std::chrono::steady_clock::time_point startTime_;
+    std::atomic<std::chrono::steady_clock::time_point> lastActivity_; //!< of user input or PTY output
+    std::chrono::steady_clock::time_point memoryTrimmedAt_ {};         //!< see trimMemoryIfIdle()
     config::Config config_;
+    config::InputMappingTables inputMappings_; // Compiled from config_, rebuilt on config reload.
     std::string profileName_;
     config::TerminalProfile profile_;
     double contentScale_ = 1.0;
@@ -228,10 +282,14 @@ class TerminalSession: public QObject, public terminal::Terminal::Events
     display::TerminalWidget* display_ = nullptr;
 
     std::unique_ptr<QFileSystemWatcher> configFileChangeWatcher_;
+    QTimer configReloadTimer_;         //!< debounces configuration file changes
+    std::future<void> configLoadJob_;  //!< parses and validates the changed configuration file
+    bool configReloadPending_ = false; //!< the file changed again while configLoadJob_ was running
 
     bool terminating_ = false;
     std::thread::id mainLoopThreadID_ {};
     std::unique_ptr<std::thread> screenUpdateThread_;
+    std::shared_ptr<terminal::PtyReactor> ptyReactor_; //!< processes the PTY input instead, if set
 
     // state vars
     //
@@ -240,6 +298,22 @@ class TerminalSession: public QObject, public terminal::Terminal::Events
     bool allowKeyMappings_ = true;
     Audio audio;
     std::vector<int> musicalNotesBuffer_;
+    std::future<void> exportJob_; //!< background job of the most recent SaveScrollback action
+    std::unique_ptr<TmuxControlClient> tmuxControlClient_; //!< panes of tmux -CC, once started
+
+    // Latest values of the events raised by the terminal thread that are yet to be delivered
+    // to the display, which happens at most once per frame on the GUI thread.
+    struct PendingEvents
+    {
+        std::optional<std::string> windowTitle;
+        std::optional<terminal::ScreenType> bufferType;
+        std::optional<std::pair<std::string, std::string>> notification;
+        bool cursorPositionChanged = false;
+        bool deliveryScheduled = false;
+    };
+    std::mutex pendingEventsMutex_;
+    PendingEvents pendingEvents_;
+    std::chrono::steady_clock::time_point pendingEventsDeliveredAt_ {};
 };
 
 } // namespace contour
@@ -1,7 +1,13 @@
 #include <contour/ContourGuiApp.h>
 #include <contour/TerminalSession.h>
 #include <contour/TerminalSessionManager.h>
+#include <contour/helper.h>
 
+#include <crispy/AdaptiveCapacity.h>
+
+#include <QtCore/QTimer>
+
+using std::make_shared;
 using std::make_unique;
 using std::nullopt;
 
@@ -10,21 +16,71 @@ namespace contour
 
 TerminalSessionManager::TerminalSessionManager(ContourGuiApp& app): _app { app }, _earlyExitThreshold {}
 {
+    // Sessions are looked at often enough for them to be trimmed not much later than configured.
+    constexpr auto HousekeepingInterval = std::chrono::seconds(30);
+
+    connect(&_housekeepingTimer, &QTimer::timeout, this, &TerminalSessionManager::enforceHistoryBudget);
+    connect(&_housekeepingTimer, &QTimer::timeout, this, &TerminalSessionManager::trimIdleSessions);
+    _housekeepingTimer.start(std::chrono::duration_cast<std::chrono::milliseconds>(HousekeepingInterval));
+
+    _reaperThread.setObjectName("Session.Reaper");
+    _reaperThread.start(QThread::LowestPriority);
+}
+
+TerminalSessionManager::~TerminalSessionManager()
+{
+    // Sessions still waiting to be destroyed are so once the thread finished.
+    _reaperThread.quit();
+    _reaperThread.wait();
+
+    clearProcessPool();
+}
+
+std::unique_ptr<terminal::Process> TerminalSessionManager::createProcess()
+{
+    return make_unique<terminal::Process>(
+        _app.config().profile(_app.profileName())->shell,
+        terminal::createPty(_app.config().profile(_app.profileName())->terminalSize, nullopt));
 }
 
 TerminalSession* TerminalSessionManager::createSession()
 {
-    auto session = new TerminalSession(
-        make_unique<terminal::Process>(
-            _app.config().profile(_app.profileName())->shell,
-            terminal::createPty(_app.config().profile(_app.profileName())->terminalSize, nullopt)),
-        _app);
+    auto pty = std::move(_adoptedPty);
+    if (!pty)
+        pty = takePrespawnedProcess();
+    if (!pty)
+        pty = createProcess();
+
+    auto session = new TerminalSession(std::move(pty), _app);
+
+    // Start the replacement once the new terminal is on its way.
+    if (_app.config().prespawnedShells)
+        QTimer::singleShot(0, this, [this]() { refillProcessPool(); });
+
+    if (auto const threadCount = _app.config().ptyReactorThreads; threadCount)
+    {
+        if (!_ptyReactor)
+            _ptyReactor = make_shared<terminal::PtyReactor>(threadCount);
+        session->setPtyReactor(_ptyReactor);
+    }
 
     connect(session, &TerminalSession::sessionClosed, [this, session]() { removeSession(*session); });
 
+    _sessions.push_back(session);
     return session;
 }
 
+TerminalSession* TerminalSessionManager::openSessionWindow(std::unique_ptr<terminal::Pty> _pty)
+{
+    // The window creates its session right away, which then adopts the PTY.
+    _adoptedPty = std::move(_pty);
+    auto const sessionCount = _sessions.size();
+    _app.newWindow();
+    _adoptedPty.reset();
+
+    return _sessions.size() > sessionCount ? _sessions.back() : nullptr;
+}
+
 void TerminalSessionManager::removeSession(TerminalSession& thatSession)
 {
     _app.onExit(thatSession); // TODO: the logic behind that impl could probably be moved here.
@@ -38,4 +94,137 @@ void TerminalSessionManager::removeSession(TerminalSession& thatSession)
     // Notify app if all sessions have been killed to trigger app termination.
 }
 
+void TerminalSessionManager::destroySession(TerminalSession& _session)
+{
+    auto* session = &_session;
+    if (auto i = std::find(_sessions.begin(), _sessions.end(), session); i != _sessions.end())
+        _sessions.erase(i);
+
+    SessionLog()("Destroying session in the background.");
+    session->moveToThread(&_reaperThread);
+    session->deleteLater();
+}
+
+std::unique_ptr<terminal::Process> TerminalSessionManager::takePrespawnedProcess()
+{
+    // The pooled shells don't run the command or directory of a forwarded request.
+    if (_app.shellOverridden())
+        return nullptr;
+
+    if (_processPoolProfileName != _app.profileName())
+        clearProcessPool();
+
+    while (!_processPool.empty())
+    {
+        auto process = std::move(_processPool.front());
+        _processPool.pop_front();
+        if (process->alive())
+        {
+            SessionLog()("Adopting pre-spawned shell.");
+            return process;
+        }
+    }
+
+    return nullptr;
+}
+
+void TerminalSessionManager::refillProcessPool()
+{
+    if (_processPoolProfileName != _app.profileName())
+        clearProcessPool();
+    _processPoolProfileName = _app.profileName();
+
+    while (_processPool.size() < _app.config().prespawnedShells)
+    {
+        try
+        {
+            auto process = createProcess();
+            process->start();
+            _processPool.emplace_back(std::move(process));
+        }
+        catch (std::exception const& e)
+        {
+            SessionLog()("Failed to pre-spawn shell. {}", e.what());
+            break;
+        }
+    }
+}
+
+void TerminalSessionManager::clearProcessPool()
+{
+    // Hang up on the shells, such that destroying them does not wait forever for them to exit.
+    for (auto& process: _processPool)
+    {
+        process->close();
+        process->terminate(terminal::Process::TerminationHint::Hangup);
+    }
+    _processPool.clear();
+}
+
+void TerminalSessionManager::trimIdleSessions()
+{
+    auto const timeout = _app.config().idleMemoryTrimTimeout;
+    if (timeout.count() == 0 || _sessions.empty())
+        return;
+
+    auto const now = std::chrono::steady_clock::now();
+    auto trimmed = false;
+    for (auto* session: _sessions)
+        trimmed = session->trimMemoryIfIdle(now, timeout) || trimmed;
+    if (!trimmed)
+        return;
+
+    if (std::all_of(_sessions.begin(), _sessions.end(), [](auto* session) { return session->memoryTrimmed(); }))
+        terminal::Terminal::releasePooledMemory();
+
+    crispy::releaseFreeHeapMemory();
+}
+
+void TerminalSessionManager::enforceHistoryBudget()
+{
+    auto const budget = _app.config().scrollbackMemoryBudget * 1024 * 1024;
+    if (!budget || _sessions.empty())
+        return;
+
+    auto usage = std::vector<std::pair<TerminalSession*, size_t>> {};
+    auto totalBytes = size_t { 0 };
+    for (auto* session: _sessions)
+    {
+        auto const bytes = session->terminal().historyMemoryUsage();
+        usage.emplace_back(session, bytes);
+        totalBytes += bytes;
+    }
+    if (totalBytes <= budget)
+        return;
+
+    // Sessions may exceed their share as long as others leave theirs unused.
+    auto const share = budget / _sessions.size();
+    std::sort(usage.begin(), usage.end(), [](auto const& a, auto const& b) {
+        return a.first->lastActivity() < b.first->lastActivity();
+    });
+    for (auto const& [session, bytes]: usage)
+    {
+        if (totalBytes <= budget)
+            break;
+        if (bytes <= share)
+            continue;
+        auto const maxBytes = std::max(share, bytes - (totalBytes - budget));
+        totalBytes -= std::min(totalBytes, session->terminal().trimHistory(maxBytes));
+    }
+
+    if (totalBytes > budget)
+        SessionLog()("Scrollback of all sessions still exceeds its memory budget by {} bytes.",
+                     totalBytes - budget);
+
+    crispy::releaseFreeHeapMemory();
+}
+
+void TerminalSessionManager::setSessionVisible(TerminalSession& _session, bool _visible)
+{
+    if (std::find(_sessions.begin(), _sessions.end(), &_session) == _sessions.end())
+        return;
+
+    _session.setVisible(_visible);
+}
+
 } // namespace contour
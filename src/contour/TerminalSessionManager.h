@@ -2,6 +2,15 @@
 
 #include <contour/TerminalSession.h>
 
+#include <terminal/Process.h>
+#include <terminal/pty/PtyReactor.h>
+
+#include <QtCore/QThread>
+#include <QtCore/QTimer>
+
+#include <deque>
+#include <memory>
+#include <string>
 #include <vector>
 
 namespace contour
@@ -16,16 +25,60 @@ class TerminalSessionManager: public QObject
 
   public:
     TerminalSessionManager(ContourGuiApp& app);
+    ~TerminalSessionManager() override;
 
     TerminalSession* createSession();
 
+    /// Opens a new window with a session on the given PTY rather than on a shell of its own,
+    /// e.g. for a pane of tmux in control mode.
+    TerminalSession* openSessionWindow(std::unique_ptr<terminal::Pty> _pty);
+
     void removeSession(TerminalSession&);
 
+    /// Destroys a session that has been shut down, e.g. once its window has been closed.
+    ///
+    /// Destroying a session frees all of its scrollback and images, which may take a while,
+    /// and is therefore done on a background thread.
+    void destroySession(TerminalSession& _session);
+
+    /// Marks a session as being visible, or as being in the background (e.g. its window minimized).
+    ///
+    /// Background sessions keep processing their input, but on a lower thread priority,
+    /// and without refreshing their render buffers, blinking, or highlighting,
+    /// such that they do not steal frames from the visible ones.
+    void setSessionVisible(TerminalSession& _session, bool _visible);
+
   private:
+    std::unique_ptr<terminal::Process> createProcess();
+
+    /// @returns a started shell process of the current profile from the pool, if any.
+    std::unique_ptr<terminal::Process> takePrespawnedProcess();
+
+    /// Starts shell processes until the pool contains as many as configured.
+    void refillProcessPool();
+    void clearProcessPool();
+
+    /// Releases the memory of the sessions that have been idle for longer than configured,
+    /// and the memory pooled for all sessions once all of them are idle.
+    void trimIdleSessions();
+
+    /// Shrinks the scrollback of the least recently active sessions first, down to their share
+    /// of the configured scrollback memory budget each, until all sessions together fit into it.
+    void enforceHistoryBudget();
+
     ContourGuiApp& _app;
     std::chrono::seconds _earlyExitThreshold;
 
     std::vector<TerminalSession*> _sessions;
+    std::shared_ptr<terminal::PtyReactor> _ptyReactor; //!< shared PTY input processing, if configured
+
+    std::deque<std::unique_ptr<terminal::Process>> _processPool; //!< started shells to be adopted
+    std::string _processPoolProfileName;                          //!< profile of the pooled shells
+
+    std::unique_ptr<terminal::Pty> _adoptedPty; //!< PTY for the next session, see openSessionWindow()
+
+    QThread _reaperThread; //!< destroys the sessions passed to destroySession()
+    QTimer _housekeepingTimer; //!< periodically invokes enforceHistoryBudget() and trimIdleSessions()
 };
 
 } // namespace contour
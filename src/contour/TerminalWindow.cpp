@@ -37,6 +37,7 @@
 #include <QtCore/QDebug>
 #include <QtGui/QGuiApplication>
 #include <QtGui/QScreen>
+#include <QtGui/QWindow>
 #include <QtWidgets/QApplication>
 #include <QtWidgets/QMainWindow>
 #include <QtWidgets/QVBoxLayout>
@@ -109,6 +110,7 @@ TerminalWindow::TerminalWindow(ContourGuiApp& _app): _app { _app }
 #endif
 
     TerminalSession* session = _app.sessionsManager().createSession();
+    session_ = session;
 
     terminalWidget_ = new display::TerminalWidget();
 
@@ -128,6 +130,10 @@ TerminalWindow::TerminalWindow(ContourGuiApp& _app): _app { _app }
 
     connect(terminalWidget_, &display::TerminalWidget::displayInitialized, [this, session]() {
         session->attachDisplay(*terminalWidget_);
+        connect(windowHandle(), &QWindow::visibilityChanged, this, [this, session](auto _visibility) {
+            auto const visible = _visibility != QWindow::Hidden && _visibility != QWindow::Minimized;
+            _app.sessionsManager().setSessionVisible(*session, visible);
+        });
 #if defined(CONTOUR_SCROLLBAR)
         scrollableDisplay_->setSizePolicy(QSizePolicy::Preferred, QSizePolicy::Preferred);
         scrollableDisplay_->updatePosition();
@@ -150,12 +156,19 @@ config::TerminalProfile const& TerminalWindow::profile() const
 TerminalWindow::~TerminalWindow()
 {
     DisplayLog()("~TerminalWindow");
+
+    // The display and its GL resources are destroyed on this thread, as soon as the session stopped
+    // using them, whereas the session itself is destroyed in the background.
+    session_->shutdown();
+    delete centralWidget();
+    _app.sessionsManager().destroySession(*session_);
 }
 
 void TerminalWindow::onTerminalClosed()
 {
-    DisplayLog()("terminal closed: {}", terminalWidget_->session().terminal().windowTitle());
+    DisplayLog()("terminal closed: {}", session_->terminal().windowTitle());
     close();
+    deleteLater();
 }
 
 void TerminalWindow::setBlurBehind([[maybe_unused]] bool _enable)
@@ -81,6 +81,7 @@ class TerminalWindow: public QMainWindow
 #endif
 
     display::TerminalWidget* terminalWidget_ = nullptr;
+    TerminalSession* session_ = nullptr; //!< destroyed along with this window
 };
 
 } // namespace contour
@@ -0,0 +1,203 @@
+/**
+ * This file is part of the "contour" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <contour/TerminalSession.h>
+#include <contour/TerminalSessionManager.h>
+#include <contour/TmuxControlClient.h>
+#include <contour/helper.h>
+
+#include <terminal/pty/TmuxPanePty.h>
+
+#include <fmt/format.h>
+
+#include <QtCore/QMetaObject>
+
+#include <algorithm>
+#include <mutex>
+
+using std::string_view;
+using std::vector;
+
+namespace contour
+{
+
+// The host's terminal thread holds its terminal lock while passing on the notifications of tmux,
+// which take panesLock. Commands are therefore never written to tmux while holding panesLock.
+struct TmuxControlClient::Shared
+{
+    std::mutex hostLock;
+    TerminalSession* host; //!< nullptr once the client is gone
+
+    std::mutex panesLock;
+    std::unordered_map<unsigned, terminal::TmuxPanePty*> panes; //!< panes by pane ID, owned by their sessions
+    std::unordered_set<unsigned> killedPanes; //!< closed on our side, until tmux drops them from their window
+
+    /// Sends commands to tmux, from any thread but the host's terminal thread.
+    void writeCommands(string_view _commands)
+    {
+        auto const _ = std::lock_guard { hostLock };
+        if (!host)
+            return;
+        auto& terminal = host->terminal();
+        auto const _l = std::lock_guard { terminal };
+        terminal.reply(_commands);
+        terminal.flushInput();
+    }
+};
+
+class TmuxControlClient::Pane: public terminal::TmuxPanePty
+{
+  public:
+    Pane(unsigned _paneId, terminal::PageSize _pageSize, std::shared_ptr<Shared> _shared):
+        TmuxPanePty(
+            _paneId, _pageSize, [shared = _shared](string_view _commands) { shared->writeCommands(_commands); }),
+        _shared { std::move(_shared) }
+    {
+    }
+
+    ~Pane() override
+    {
+        // Panes still known to the client are being closed on our side, e.g. by closing their window.
+        auto const closedByUser = [&]() {
+            auto const _ = std::lock_guard { _shared->panesLock };
+            if (_shared->panes.erase(paneId()) == 0)
+                return false;
+            _shared->killedPanes.insert(paneId());
+            return true;
+        }();
+        if (closedByUser)
+            _shared->writeCommands(fmt::format("kill-pane -t %{}\n", paneId()));
+    }
+
+  private:
+    std::shared_ptr<Shared> _shared;
+};
+
+TmuxControlClient::TmuxControlClient(TerminalSession& _host, TerminalSessionManager& _sessions):
+    _host { _host }, _sessions { _sessions }, _shared { std::make_shared<Shared>() }
+{
+    _shared->host = &_host;
+}
+
+TmuxControlClient::~TmuxControlClient()
+{
+    {
+        auto const _ = std::lock_guard { _shared->hostLock };
+        _shared->host = nullptr;
+    }
+
+    closeAllPanes();
+}
+
+void TmuxControlClient::start()
+{
+    SessionLog()("tmux entered control mode.");
+
+    // Invoked from within the host's terminal thread, hence the reply being only queued.
+    auto const pageSize = _host.terminal().pageSize();
+    _host.terminal().reply(
+        terminal::tmuxResizeCommand(unbox<unsigned>(pageSize.columns), unbox<unsigned>(pageSize.lines)));
+}
+
+void TmuxControlClient::openPane(unsigned _paneId)
+{
+    if (_shared->panes.count(_paneId) || _shared->killedPanes.count(_paneId))
+        return;
+
+    if (_shared->panes.size() >= MaxPanes)
+    {
+        SessionLog()("Not opening tmux pane %{}, as {} panes are open already.", _paneId, MaxPanes);
+        return;
+    }
+
+    SessionLog()("Opening tmux pane %{}.", _paneId);
+    auto* pane = new Pane(_paneId, _host.terminal().pageSize(), _shared);
+    _shared->panes.emplace(_paneId, pane);
+
+    // Windows are opened on the GUI thread only. The pane takes its output in the meantime.
+    QMetaObject::invokeMethod(
+        &_sessions,
+        [sessions = &_sessions, pane]() { sessions->openSessionWindow(std::unique_ptr<terminal::Pty>(pane)); },
+        Qt::QueuedConnection);
+}
+
+void TmuxControlClient::closePanes(vector<unsigned> const& _paneIds)
+{
+    auto const _ = std::lock_guard { _shared->panesLock };
+    for (auto const paneId: _paneIds)
+    {
+        _shared->killedPanes.erase(paneId);
+        auto const i = _shared->panes.find(paneId);
+        if (i == _shared->panes.end())
+            continue;
+        // The pane's session reads the end of its output and closes.
+        SessionLog()("Closing tmux pane %{}.", paneId);
+        i->second->close();
+        _shared->panes.erase(i);
+    }
+}
+
+void TmuxControlClient::closeAllPanes()
+{
+    auto const _ = std::lock_guard { _shared->panesLock };
+    for (auto const& pane: _shared->panes)
+        pane.second->close();
+    _shared->panes.clear();
+    _shared->killedPanes.clear();
+}
+
+void TmuxControlClient::tmuxPaneOutput(unsigned _paneId, string_view _data)
+{
+    // Panes are opened by layout changes only, such that output cannot open any windows by itself.
+    auto const _ = std::lock_guard { _shared->panesLock };
+    if (auto const i = _shared->panes.find(_paneId); i != _shared->panes.end())
+        i->second->appendOutput(_data);
+}
+
+void TmuxControlClient::tmuxLayoutChanged(unsigned _windowId, vector<unsigned> const& _paneIds)
+{
+    auto& windowPanes = _windows[_windowId];
+
+    auto removedPanes = vector<unsigned> {};
+    for (auto const paneId: windowPanes)
+        if (std::find(_paneIds.begin(), _paneIds.end(), paneId) == _paneIds.end())
+            removedPanes.push_back(paneId);
+    closePanes(removedPanes);
+
+    {
+        auto const _ = std::lock_guard { _shared->panesLock };
+        for (auto const paneId: _paneIds)
+            openPane(paneId);
+    }
+
+    windowPanes = _paneIds;
+}
+
+void TmuxControlClient::tmuxWindowClosed(unsigned _windowId)
+{
+    if (auto const i = _windows.find(_windowId); i != _windows.end())
+    {
+        closePanes(i->second);
+        _windows.erase(i);
+    }
+}
+
+void TmuxControlClient::tmuxExited(string_view _reason)
+{
+    SessionLog()("tmux left control mode. {}", _reason);
+
+    closeAllPanes();
+    _windows.clear();
+}
+
+} // namespace contour
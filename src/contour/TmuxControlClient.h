@@ -0,0 +1,71 @@
+/**
+ * This file is part of the "contour" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <terminal/TmuxControlMode.h>
+
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace contour
+{
+
+class TerminalSession;
+class TerminalSessionManager;
+
+/**
+ * Presents the panes of tmux running in control mode (tmux -CC) on a terminal session
+ * as native terminal sessions, each in a window of its own.
+ *
+ * The output of each pane is thus parsed and rendered only once, by the terminal of its session,
+ * which also provides the scrollback and search, rather than tmux redrawing its virtual screen
+ * onto the hosting terminal.
+ */
+class TmuxControlClient: public terminal::TmuxControlParser::Events
+{
+  public:
+    /// Panes beyond this number are not opened, each taking a window of its own.
+    static constexpr size_t MaxPanes = 32;
+
+    TmuxControlClient(TerminalSession& _host, TerminalSessionManager& _sessions);
+    ~TmuxControlClient() override;
+
+    /// Invoked from the host's terminal thread whenever tmux enters control mode.
+    void start();
+
+    void tmuxPaneOutput(unsigned _paneId, std::string_view _data) override;
+    void tmuxLayoutChanged(unsigned _windowId, std::vector<unsigned> const& _paneIds) override;
+    void tmuxWindowClosed(unsigned _windowId) override;
+    void tmuxExited(std::string_view _reason) override;
+
+  private:
+    struct Shared;
+    class Pane;
+
+    /// Opens the given pane unless it is open already, has been killed on our side,
+    /// or MaxPanes are open. Requires the panes to be locked.
+    void openPane(unsigned _paneId);
+    void closePanes(std::vector<unsigned> const& _paneIds);
+    void closeAllPanes();
+
+    TerminalSession& _host;
+    TerminalSessionManager& _sessions;
+    std::shared_ptr<Shared> _shared; //!< state shared with the panes, which may outlive this client
+    std::unordered_map<unsigned, std::vector<unsigned>> _windows; //!< pane IDs by tmux window ID
+};
+
+} // namespace contour
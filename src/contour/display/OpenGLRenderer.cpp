@@ -18,6 +18,7 @@
 
 #include <terminal_renderer/TextureAtlas.h>
 
+#include <crispy/StartupTrace.h>
 #include <crispy/algorithm.h>
 #include <crispy/assert.h>
 #include <crispy/defines.h>
@@ -27,11 +28,20 @@
 
 #include <QtCore/QtGlobal>
 #include <QtGui/QImage>
+#include <QtGui/QOpenGLContext>
 
 #include <algorithm>
 #include <array>
 #include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <future>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -39,6 +49,7 @@ using std::array;
 using std::get;
 using std::holds_alternative;
 using std::make_shared;
+using std::max;
 using std::min;
 using std::move;
 using std::nullopt;
@@ -53,35 +64,31 @@ using terminal::ImageSize;
 using terminal::RGBAColor;
 using terminal::Width;
 
+// Not all OpenGL headers know about GL_ARB_buffer_storage / GL_EXT_buffer_storage.
+#if !defined(GL_MAP_PERSISTENT_BIT)
+    #define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#if !defined(GL_TIME_ELAPSED)
+    #define GL_TIME_ELAPSED 0x88BF
+#endif
+#if !defined(GL_MAP_COHERENT_BIT)
+    #define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
 namespace chrono = std::chrono;
 namespace atlas = terminal::renderer::atlas;
 
 namespace contour::display
 {
 
-namespace
+struct BackgroundImageFile
 {
-    struct CRISPY_PACKED vec2
-    {
-        float x;
-        float y;
-    };
-
-    struct CRISPY_PACKED vec3
-    {
-        float x;
-        float y;
-        float z;
-    };
-
-    struct CRISPY_PACKED vec4
-    {
-        float x;
-        float y;
-        float z;
-        float w;
-    };
+    FileSystem::path path;
+    std::shared_future<QImage> image; // converted to RGBA, or null if it could not be loaded
+};
 
+namespace
+{
     static constexpr bool isPowerOfTwo(uint32_t value) noexcept
     {
         //.
@@ -125,6 +132,18 @@ namespace
         return GL_RED;
     }
 
+    GLint glInternalFormat(atlas::Format _format)
+    {
+        // Sized internal formats, as OpenGL ES does not accept unsized GL_RED.
+        switch (_format)
+        {
+            case atlas::Format::RGBA: return GL_RGBA8;
+            case atlas::Format::RGB: return GL_RGB8;
+            case atlas::Format::Red: return GL_R8;
+        }
+        return GL_R8;
+    }
+
     QMatrix4x4 ortho(float left, float right, float bottom, float top)
     {
         constexpr float nearPlane = -1.0f;
@@ -146,24 +165,6 @@ namespace
         crispy::unreachable();
     }
 
-    struct OpenGLContextGuard
-    {
-        QOpenGLContext* _context;
-        QSurface* _surface;
-
-        OpenGLContextGuard():
-            _context { QOpenGLContext::currentContext() },
-            _surface { _context ? _context->surface() : nullptr }
-        {
-        }
-
-        ~OpenGLContextGuard()
-        {
-            if (_context)
-                _context->makeCurrent(_surface);
-        }
-    };
-
     // Returns first non-zero argument.
     template <typename T, typename... More>
     constexpr T firstNonZero(T a, More... more) noexcept
@@ -179,14 +180,48 @@ namespace
         }
     }
 
+    array<uint8_t, 4> toColorInstance(array<float, 4> const& color) noexcept
+    {
+        auto const component = [](float value) {
+            return static_cast<uint8_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+        };
+        return { component(color[0]), component(color[1]), component(color[2]), component(color[3]) };
+    }
+
+    // Background image files are decoded once, off the GUI thread, and then shared by all renderers
+    // (e.g. of many windows showing the same wallpaper) for as long as any of them shows it.
+    shared_ptr<BackgroundImageFile> loadBackgroundImageFile(FileSystem::path const& filePath)
+    {
+        static auto mutex = std::mutex {};
+        static auto files = std::unordered_map<string, std::weak_ptr<BackgroundImageFile>> {};
+
+        auto const _ = std::lock_guard { mutex };
+        auto& cached = files[filePath.string()];
+        if (auto file = cached.lock())
+            return file;
+
+        auto file = make_shared<BackgroundImageFile>();
+        file->path = filePath;
+        file->image = std::async(std::launch::async, [filePath]() {
+                          auto const qImage = QImage(QString::fromStdString(filePath.string()));
+                          return qImage.convertToFormat(QImage::Format_RGBA8888);
+                      }).share();
+        cached = file;
+        return file;
+    }
 } // namespace
 
 /**
- * Text rendering input:
- *  - vec3 screenCoord    (x/y/z)
- *  - vec4 textureCoord   (x/y and w/h)
- *  - vec4 textColor      (r/g/b/a)
+ * Text rendering input (per instance, i.e. per tile, see TileInstance):
+ *  - int16 x 4    target rectangle in pixels (x/y and w/h)
+ *  - uint16 x 4   normalized texture coordinates (x/y and w/h)
+ *  - uint8 x 4    text color (r/g/b/a)
+ *  - uint8        fragment shader selector (see RenderTile::fragmentShaderSelector)
+ *  - uint8        texture to sample from (see TEXT_TEXTURE_* in shared_defines.h)
+ *  - uint16       texture atlas page
  *
+ * The vertex shader expands each instance into a quad, drawn as triangle strip of 4 vertices.
+ * Quads covering the whole viewport, such as the background image, take no vertex data at all.
  */
 
 OpenGLRenderer::OpenGLRenderer(ShaderConfig const& textShaderConfig,
@@ -203,13 +238,19 @@ OpenGLRenderer::OpenGLRenderer(ShaderConfig const& textShaderConfig,
                               unbox<float>(targetSurfaceSize.height), // bottom, top
                               0.0f) },
     _margin { margin },
-    _textShader { createShader(textShaderConfig) },
+    _textShader { sharedShader(textShaderConfig) },
     _textProjectionLocation { _textShader->uniformLocation("vs_projection") },
     _textTimeLocation { _textShader->uniformLocation("u_time") },
-    _backgroundShader { createShader(backgroundImageShaderConfig) },
-    _rectShader { createShader(rectShaderConfig) },
+    _backgroundShader { sharedShader(backgroundImageShaderConfig) },
+    _rectShader { sharedShader(rectShaderConfig) },
     _rectProjectionLocation { _rectShader->uniformLocation("u_projection") },
-    _rectTimeLocation { _rectShader->uniformLocation("u_time") }
+    _rectTimeLocation { _rectShader->uniformLocation("u_time") },
+    _boxShader { sharedShader(builtinShaderConfig(ShaderClass::BoxDrawing)) },
+    _boxProjectionLocation { _boxShader->uniformLocation("u_projection") },
+    _cellGridShader { sharedShader(builtinShaderConfig(ShaderClass::CellBackground)) },
+    _cellGridUniformLocations { _cellGridShader->uniformLocation("u_projection"),
+                                _cellGridShader->uniformLocation("u_rect"),
+                                _cellGridShader->uniformLocation("u_cellSize") }
 {
     initialize();
 
@@ -223,14 +264,20 @@ OpenGLRenderer::OpenGLRenderer(ShaderConfig const& textShaderConfig,
     //  //glBlendFunc(GL_SRC1_COLOR, GL_ONE_MINUS_SRC1_COLOR);
 
     bound(*_textShader, [&]() {
-        CHECKED_GL(_textShader->setUniformValue("fs_textureAtlas", 0)); // GL_TEXTURE0?
-        auto const textureAtlasWidth = unbox<GLfloat>(_textureAtlas.textureSize.width);
-        CHECKED_GL(_textShader->setUniformValue("pixel_x", 1.0f / textureAtlasWidth));
+        CHECKED_GL(_textShader->setUniformValue("fs_redAtlas", TEXT_TEXTURE_ATLAS_RED));
+        CHECKED_GL(_textShader->setUniformValue("fs_rgbAtlas", TEXT_TEXTURE_ATLAS_RGB));
+        CHECKED_GL(_textShader->setUniformValue("fs_rgbaAtlas", TEXT_TEXTURE_ATLAS_RGBA));
+        CHECKED_GL(_textShader->setUniformValue("fs_imageTexture", TEXT_TEXTURE_IMAGE));
+        CHECKED_GL(_textPixelXLocation = _textShader->uniformLocation("pixel_x"));
     });
 
+    bound(*_cellGridShader, [&]() { CHECKED_GL(_cellGridShader->setUniformValue("u_cellColors", 0)); });
+
     initializeBackgroundRendering();
     initializeRectRendering();
+    initializeBoxDrawingRendering();
     initializeTextureRendering();
+    CHECKED_GL(glGenVertexArrays(1, &_cellGridVAO));
 }
 
 void OpenGLRenderer::setRenderSize(ImageSize targetSurfaceSize)
@@ -240,6 +287,7 @@ void OpenGLRenderer::setRenderSize(ImageSize targetSurfaceSize)
 
     // glOrtho
     _renderTargetSize = targetSurfaceSize;
+    _contentsValid = false;
     DisplayLog()("Setting render target size to {}.", _renderTargetSize);
     _projectionMatrix = ortho(0.0f,
                               unbox<float>(_renderTargetSize.width),  // left, right
@@ -259,69 +307,235 @@ atlas::AtlasBackend& OpenGLRenderer::textureScheduler()
 
 void OpenGLRenderer::initializeRectRendering()
 {
-    CHECKED_GL(glGenVertexArrays(1, &_rectVAO));
-    CHECKED_GL(glBindVertexArray(_rectVAO));
+    // clang-format off
+    _rectStream.stride = sizeof(RectInstance);
+    _rectStream.attributes = {
+        // 0 (vec4): target rectangle
+        VertexAttribute { 0, 4, GL_SHORT, GL_FALSE, offsetof(RectInstance, x) },
+        // 1 (vec4): color
+        VertexAttribute { 1, 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(RectInstance, color) },
+    };
+    // clang-format on
+    initializeVertexStream(_rectStream);
+}
 
-    CHECKED_GL(glGenBuffers(1, &_rectVBO));
-    CHECKED_GL(glBindBuffer(GL_ARRAY_BUFFER, _rectVBO));
-    CHECKED_GL(glBufferData(GL_ARRAY_BUFFER, 0, nullptr, GL_STREAM_DRAW));
+void OpenGLRenderer::initializeBoxDrawingRendering()
+{
+    // clang-format off
+    _boxStream.stride = sizeof(BoxInstance);
+    _boxStream.attributes = {
+        // 0 (vec4): target grid cell
+        VertexAttribute { 0, 4, GL_SHORT, GL_FALSE, offsetof(BoxInstance, x) },
+        // 1 (vec4): color
+        VertexAttribute { 1, 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(BoxInstance, color) },
+        // 2 (vec4): shape (lower and upper 16 bits), line thickness
+        VertexAttribute { 2, 4, GL_UNSIGNED_SHORT, GL_FALSE, offsetof(BoxInstance, shape) },
+    };
+    // clang-format on
+    initializeVertexStream(_boxStream);
+}
 
-    auto constexpr BufferStride = 7 * sizeof(GLfloat);
-    auto const VertexOffset = (void const*) (0 * sizeof(GLfloat));
-    auto const ColorOffset = (void const*) (3 * sizeof(GLfloat));
+void OpenGLRenderer::initializeTextureRendering()
+{
+    // clang-format off
+    _textStream.stride = sizeof(TileInstance);
+    _textStream.attributes = {
+        // 0 (vec4): target rectangle
+        VertexAttribute { 0, 4, GL_SHORT, GL_FALSE, offsetof(TileInstance, x) },
+        // 1 (vec4): texture coordinates of the tile in the atlas
+        VertexAttribute { 1, 4, GL_UNSIGNED_SHORT, GL_TRUE, offsetof(TileInstance, textureCoords) },
+        // 2 (vec4): color
+        VertexAttribute { 2, 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(TileInstance, color) },
+        // 3 (vec2): fragment shader selector and texture
+        VertexAttribute { 3, 2, GL_UNSIGNED_BYTE, GL_FALSE, offsetof(TileInstance, selector) },
+        // 4 (float): texture atlas page
+        VertexAttribute { 4, 1, GL_UNSIGNED_SHORT, GL_FALSE, offsetof(TileInstance, page) },
+    };
+    // clang-format on
+    initializeVertexStream(_textStream);
 
-    // 0 (vec3): vertex buffer
-    CHECKED_GL(glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, BufferStride, VertexOffset));
-    CHECKED_GL(glEnableVertexAttribArray(0));
+    // Tiles of images with textures of their own are streamed separately, grouped by texture.
+    _imageStream.stride = _textStream.stride;
+    _imageStream.attributes = _textStream.attributes;
+    initializeVertexStream(_imageStream);
+}
 
-    // 1 (vec4): color buffer
-    CHECKED_GL(glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, BufferStride, ColorOffset));
-    CHECKED_GL(glEnableVertexAttribArray(1));
+// {{{ vertex streaming
+void OpenGLRenderer::initializeVertexStream(VertexStream& stream)
+{
+    CHECKED_GL(glGenVertexArrays(1, &stream.vao));
+    CHECKED_GL(glGenBuffers(1, &stream.vbo));
+    reserveVertexStream(stream, 64 * 1024);
 }
 
-void OpenGLRenderer::initializeTextureRendering()
+void OpenGLRenderer::reserveVertexStream(VertexStream& stream, size_t size)
 {
-    CHECKED_GL(glGenVertexArrays(1, &_textVAO));
-    CHECKED_GL(glBindVertexArray(_textVAO));
+    if (size <= stream.regionSize && stream.regionSize != 0)
+        return;
 
-    auto constexpr BufferStride = (3 + 4 + 4) * sizeof(GLfloat);
-    auto constexpr VertexOffset = (void const*) 0;
-    auto const TexCoordOffset = (void const*) (3 * sizeof(GLfloat));
-    auto const ColorOffset = (void const*) (7 * sizeof(GLfloat));
+    // Grow generously, as the number of vertices varies from frame to frame.
+    auto const stride = static_cast<size_t>(stream.stride);
+    auto const regionSize = (max(size + size / 2, stream.regionSize * 2) + stride - 1) / stride * stride;
+    auto const bufferSize = static_cast<GLsizeiptr>(regionSize * VertexStream::RegionCount);
 
-    CHECKED_GL(glGenBuffers(1, &_textVBO));
-    CHECKED_GL(glBindBuffer(GL_ARRAY_BUFFER, _textVBO));
-    CHECKED_GL(glBufferData(GL_ARRAY_BUFFER, 0, nullptr, GL_STREAM_DRAW));
+    for (auto& fence: stream.fences)
+        if (fence)
+        {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
 
-    // 0 (vec3): vertex buffer
-    CHECKED_GL(glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, BufferStride, VertexOffset));
-    CHECKED_GL(glEnableVertexAttribArray(0));
+    if (_bufferStorage)
+    {
+        // Immutable storage cannot be resized, so it is replaced with a new buffer object and
+        // the vertex array has to refer to that one instead.
+        if (stream.mapping)
+        {
+            CHECKED_GL(glBindBuffer(GL_ARRAY_BUFFER, stream.vbo));
+            CHECKED_GL(glUnmapBuffer(GL_ARRAY_BUFFER));
+            CHECKED_GL(glDeleteBuffers(1, &stream.vbo));
+            CHECKED_GL(glGenBuffers(1, &stream.vbo));
+            stream.mapping = nullptr;
+        }
 
-    // 1 (vec4): texture coordinates buffer
-    CHECKED_GL(glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, BufferStride, TexCoordOffset));
-    CHECKED_GL(glEnableVertexAttribArray(1));
+        auto constexpr Flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        CHECKED_GL(glBindBuffer(GL_ARRAY_BUFFER, stream.vbo));
+        CHECKED_GL(_bufferStorage(GL_ARRAY_BUFFER, bufferSize, nullptr, Flags));
+        stream.mapping = glMapBufferRange(GL_ARRAY_BUFFER, 0, bufferSize, Flags);
+        if (!stream.mapping)
+            DisplayLog()("Failed to map vertex buffer persistently.");
+    }
+    else
+    {
+        CHECKED_GL(glBindBuffer(GL_ARRAY_BUFFER, stream.vbo));
+        CHECKED_GL(glBufferData(GL_ARRAY_BUFFER, bufferSize, nullptr, GL_STREAM_DRAW));
+    }
 
-    // 2 (vec4): color buffer
-    CHECKED_GL(glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, BufferStride, ColorOffset));
-    CHECKED_GL(glEnableVertexAttribArray(2));
+    stream.regionSize = regionSize;
+    stream.currentRegion = 0;
+}
+
+void OpenGLRenderer::streamVertices(VertexStream& stream, void const* data, size_t size)
+{
+    reserveVertexStream(stream, size);
+
+    stream.currentRegion = (stream.currentRegion + 1) % VertexStream::RegionCount;
+    auto const offset = stream.currentRegion * stream.regionSize;
+
+    // Wait for the GPU to finish drawing from this region, which happened RegionCount frames ago.
+    if (auto& fence = stream.fences[stream.currentRegion]; fence)
+    {
+        auto constexpr Timeout = GLuint64 { 1'000'000'000 }; // 1 second in nanoseconds
+        glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, Timeout);
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
 
-    // setup EBO
-    // glGenBuffers(1, &_ebo);
-    // glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _ebo);
-    // static const GLuint indices[6] = { 0, 1, 3, 1, 2, 3 };
-    // glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+    if (stream.mapping)
+    {
+        std::memcpy(static_cast<uint8_t*>(stream.mapping) + offset, data, size);
+    }
+    else
+    {
+        CHECKED_GL(glBindBuffer(GL_ARRAY_BUFFER, stream.vbo));
+        CHECKED_GL(glBufferSubData(
+            GL_ARRAY_BUFFER, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(size), data));
+    }
 
-    // glVertexAttribDivisor(0, 1); // TODO: later for instanced rendering
+    pointVertexStream(stream, 0);
 }
 
+void OpenGLRenderer::pointVertexStream(VertexStream& stream, size_t firstInstance)
+{
+    // Instanced draw calls cannot start at an instance other than the first one without
+    // GL_ARB_base_instance, so the attributes are pointed at the given instance of the current
+    // region instead.
+    auto const offset = stream.currentRegion * stream.regionSize
+                        + firstInstance * static_cast<size_t>(stream.stride);
+    CHECKED_GL(glBindVertexArray(stream.vao));
+    CHECKED_GL(glBindBuffer(GL_ARRAY_BUFFER, stream.vbo));
+    for (auto const& attribute: stream.attributes)
+    {
+        CHECKED_GL(glVertexAttribPointer(attribute.index,
+                                         attribute.size,
+                                         attribute.type,
+                                         attribute.normalized,
+                                         stream.stride,
+                                         (void const*) (offset + attribute.offset)));
+        CHECKED_GL(glEnableVertexAttribArray(attribute.index));
+        CHECKED_GL(glVertexAttribDivisor(attribute.index, 1));
+    }
+    CHECKED_GL(glBindVertexArray(0));
+}
+
+void OpenGLRenderer::fenceVertexStream(VertexStream& stream)
+{
+    // Without a mapping, the driver takes care of not overwriting what is still to be drawn.
+    if (!stream.mapping)
+        return;
+
+    auto& fence = stream.fences[stream.currentRegion];
+    if (fence)
+        glDeleteSync(fence);
+    fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void OpenGLRenderer::destroyVertexStream(VertexStream& stream)
+{
+    for (auto& fence: stream.fences)
+        if (fence)
+            glDeleteSync(fence);
+    stream.fences = {};
+
+    if (stream.mapping)
+    {
+        CHECKED_GL(glBindBuffer(GL_ARRAY_BUFFER, stream.vbo));
+        CHECKED_GL(glUnmapBuffer(GL_ARRAY_BUFFER));
+        stream.mapping = nullptr;
+    }
+
+    CHECKED_GL(glDeleteVertexArrays(1, &stream.vao));
+    CHECKED_GL(glDeleteBuffers(1, &stream.vbo));
+}
+// }}}
+
 OpenGLRenderer::~OpenGLRenderer()
 {
     DisplayLog()("~OpenGLRenderer");
-    CHECKED_GL(glDeleteVertexArrays(1, &_rectVAO));
-    CHECKED_GL(glDeleteBuffers(1, &_rectVBO));
+    destroyVertexStream(_rectStream);
+    destroyVertexStream(_boxStream);
+    destroyVertexStream(_textStream);
+    destroyVertexStream(_imageStream);
+    CHECKED_GL(glDeleteVertexArrays(1, &_cellGridVAO));
+    CHECKED_GL(glDeleteVertexArrays(1, &_backgroundVAO));
+
+    for (auto& readback: _screenshotReadbacks)
+        destroyScreenshotReadback(readback);
+
+    for (auto const& [imageTextureId, textureId]: _imageTextures)
+        CHECKED_GL(glDeleteTextures(1, &textureId));
+
+    for (auto const format: atlas::AtlasFormats)
+        executeDestroyAtlas(format);
+
+    if (_tileUploadBuffer)
+        CHECKED_GL(glDeleteBuffers(1, &_tileUploadBuffer));
+
+    if (_scrollFramebuffer)
+        CHECKED_GL(glDeleteFramebuffers(1, &_scrollFramebuffer));
+
+    if (_scrollTexture)
+        CHECKED_GL(glDeleteTextures(1, &_scrollTexture));
+
+    if (_cellGridTexture)
+        CHECKED_GL(glDeleteTextures(1, &_cellGridTexture));
 
     if (_backgroundImageTexture)
         CHECKED_GL(glDeleteTextures(1, &_backgroundImageTexture));
+
+    for (auto const& query: _timerQueries)
+        if (query.id)
+            CHECKED_GL(glDeleteQueries(1, &query.id));
 }
 
 void OpenGLRenderer::initialize()
@@ -330,9 +544,59 @@ void OpenGLRenderer::initialize()
     {
         _initialized = true;
         initializeOpenGLFunctions();
+
+        auto* context = QOpenGLContext::currentContext();
+        if (context->hasExtension("GL_ARB_buffer_storage"))
+            _bufferStorage =
+                reinterpret_cast<BufferStorageFunction>(context->getProcAddress("glBufferStorage"));
+        else if (context->hasExtension("GL_EXT_buffer_storage"))
+            _bufferStorage =
+                reinterpret_cast<BufferStorageFunction>(context->getProcAddress("glBufferStorageEXT"));
+        DisplayLog()("Streaming vertices via {}.",
+                     _bufferStorage ? "persistently mapped buffers" : "buffer sub-data updates");
+
+        // GL_TIME_ELAPSED queries are core as of OpenGL 3.3, but OpenGL ES only has them as extension.
+        _timerQueriesSupported = !context->isOpenGLES()
+                                 && (context->format().version() >= qMakePair(3, 3)
+                                     || context->hasExtension("GL_ARB_timer_query"));
+        if (_timerQueriesSupported)
+            for (auto& query: _timerQueries)
+                CHECKED_GL(glGenQueries(1, &query.id));
     }
 }
 
+void OpenGLRenderer::beginTimerQuery()
+{
+    auto& query = _timerQueries[_timerQueryIndex];
+    if (query.pending)
+    {
+        // Rather than stalling on the GPU, skip measuring frames until the oldest query completed.
+        GLuint available = GL_FALSE;
+        CHECKED_GL(glGetQueryObjectuiv(query.id, GL_QUERY_RESULT_AVAILABLE, &available));
+        if (!available)
+            return;
+
+        GLuint elapsed = 0; // in nanoseconds
+        CHECKED_GL(glGetQueryObjectuiv(query.id, GL_QUERY_RESULT, &elapsed));
+        _gpuTime.record(std::chrono::nanoseconds(elapsed));
+        query.pending = false;
+    }
+
+    CHECKED_GL(glBeginQuery(GL_TIME_ELAPSED, query.id));
+    _timerQueryActive = true;
+}
+
+void OpenGLRenderer::endTimerQuery()
+{
+    if (!_timerQueryActive)
+        return;
+
+    CHECKED_GL(glEndQuery(GL_TIME_ELAPSED));
+    _timerQueries[_timerQueryIndex].pending = true;
+    _timerQueryIndex = (_timerQueryIndex + 1) % TimerQueryCount;
+    _timerQueryActive = false;
+}
+
 void OpenGLRenderer::clearCache()
 {
 }
@@ -356,20 +620,29 @@ int OpenGLRenderer::maxTextureSize()
 }
 
 // {{{ AtlasBackend impl
+static_assert(atlas::format_index(atlas::Format::Red) == TEXT_TEXTURE_ATLAS_RED);
+static_assert(atlas::format_index(atlas::Format::RGB) == TEXT_TEXTURE_ATLAS_RGB);
+static_assert(atlas::format_index(atlas::Format::RGBA) == TEXT_TEXTURE_ATLAS_RGBA);
+
 ImageSize OpenGLRenderer::atlasSize() const noexcept
 {
-    return _textureAtlas.textureSize;
+    // All atlases share the same size.
+    return _textureAtlases.front().textureSize;
 }
 
 void OpenGLRenderer::configureAtlas(atlas::ConfigureAtlas atlas)
 {
     // schedule atlas creation
-    _scheduledExecutions.configureAtlas.emplace(atlas);
-    _textureAtlas.textureSize = atlas.size;
-    _textureAtlas.properties = atlas.properties;
+    auto const index = atlas::format_index(atlas.format);
+    _scheduledExecutions.configureAtlas[index].emplace(atlas);
+    for (auto& textureAtlas: _textureAtlases)
+    {
+        textureAtlas.textureSize = atlas.size;
+        textureAtlas.properties = atlas.properties;
+    }
 
     // clang-format off
-    DisplayLog()("configureAtlas: {} {}", atlas.size, atlas.properties.format);
+    DisplayLog()("configureAtlas: {} {} {} pages", atlas.size, atlas.format, atlas.pageCount);
     // clang-format on
 }
 
@@ -380,76 +653,70 @@ void OpenGLRenderer::uploadTile(atlas::UploadTile tile)
     //              tile.location.atlasID.value,
     //              tile.location.x.value,
     //              tile.location.y.value);
-    if (!(tile.bitmapSize.width <= _textureAtlas.properties.tileSize.width))
-        errorlog()("uploadTile assertion alert: width {} <= {} failed.", tile.bitmapSize.width, _textureAtlas.properties.tileSize.width);
-    if (!(tile.bitmapSize.height <= _textureAtlas.properties.tileSize.height))
-        errorlog()("uploadTile assertion alert: height {} <= {} failed.", tile.bitmapSize.height, _textureAtlas.properties.tileSize.height);
+    auto const& properties = _textureAtlases[atlas::format_index(tile.location.format)].properties;
+    if (!(tile.bitmapSize.width <= properties.tileSize.width))
+        errorlog()("uploadTile assertion alert: width {} <= {} failed.", tile.bitmapSize.width, properties.tileSize.width);
+    if (!(tile.bitmapSize.height <= properties.tileSize.height))
+        errorlog()("uploadTile assertion alert: height {} <= {} failed.", tile.bitmapSize.height, properties.tileSize.height);
     // clang-format on
 
-    // Require(tile.bitmapSize.width <= _textureAtlas.properties.tileSize.width);
-    // Require(tile.bitmapSize.height <= _textureAtlas.properties.tileSize.height);
+    // Require(tile.bitmapSize.width <= properties.tileSize.width);
+    // Require(tile.bitmapSize.height <= properties.tileSize.height);
 
     _scheduledExecutions.uploadTiles.emplace_back(std::move(tile));
 }
 
 void OpenGLRenderer::renderTile(atlas::RenderTile tile)
 {
-    RenderBatch& batch = _scheduledExecutions.renderBatch;
-
-    // atlas texture Vertices to locate the tile
-    auto const x = static_cast<GLfloat>(tile.x.value);
-    auto const y = static_cast<GLfloat>(tile.y.value);
-    auto const z = static_cast<GLfloat>(0);
-
     // tile bitmap size on target render surface
-    GLfloat const r = unbox<GLfloat>(firstNonZero(tile.targetSize.width, tile.bitmapSize.width));
-    GLfloat const s = unbox<GLfloat>(firstNonZero(tile.targetSize.height, tile.bitmapSize.height));
+    auto const width = unbox<int>(firstNonZero(tile.targetSize.width, tile.bitmapSize.width));
+    auto const height = unbox<int>(firstNonZero(tile.targetSize.height, tile.bitmapSize.height));
 
     // normalized TexCoords
-    GLfloat const nx = tile.normalizedLocation.x;
-    GLfloat const ny = tile.normalizedLocation.y;
-    GLfloat const nw = tile.normalizedLocation.width;
-    GLfloat const nh = tile.normalizedLocation.height;
-
-    // These two are currently not used.
-    // This used to be used for the z-plane into the 3D texture,
-    // but I've reverted back to a 2D texture atlas for now.
-    GLfloat const i = 0;
-
-    // Tile dependant userdata.
-    // This is current the fragment shader's selector that
-    // determines how to operate on this tile (images vs gray-scale anti-aliased
-    // glyphs vs LCD subpixel antialiased glyphs)
-    auto const u = static_cast<GLfloat>(tile.fragmentShaderSelector);
-
-    // color
-    GLfloat const cr = tile.color[0];
-    GLfloat const cg = tile.color[1];
-    GLfloat const cb = tile.color[2];
-    GLfloat const ca = tile.color[3];
+    auto const normalized = [](float value) {
+        return static_cast<uint16_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 65535.0f));
+    };
 
-    // clang-format off
-    GLfloat const vertices[6 * 11] = {
-        // first triangle
-    // <X      Y      Z> <X        Y        I  U>  <R   G   B   A>
-        x,     y + s, z,  nx,      ny + nh, i, u,  cr, cg, cb, ca, // left top
-        x,     y,     z,  nx,      ny,      i, u,  cr, cg, cb, ca, // left bottom
-        x + r, y,     z,  nx + nw, ny,      i, u,  cr, cg, cb, ca, // right bottom
-
-        // second triangle
-        x,     y + s, z,  nx,      ny + nh, i, u,  cr, cg, cb, ca, // left top
-        x + r, y,     z,  nx + nw, ny,      i, u,  cr, cg, cb, ca, // right bottom
-        x + r, y + s, z,  nx + nw, ny + nh, i, u,  cr, cg, cb, ca, // right top
-
-        // buffer contains
-        // - 3 vertex coordinates (XYZ)
-        // - 4 texture coordinates (XYIU), I is unused currently, U selects which texture to use
-        // - 4 color values (RGBA)
+    auto const instance = TileInstance {
+        static_cast<int16_t>(tile.x.value),
+        static_cast<int16_t>(tile.y.value),
+        static_cast<int16_t>(width),
+        static_cast<int16_t>(height),
+        { normalized(tile.normalizedLocation.x),
+          normalized(tile.normalizedLocation.y),
+          normalized(tile.normalizedLocation.width),
+          normalized(tile.normalizedLocation.height) },
+        toColorInstance(tile.color),
+        // Tile dependant userdata.
+        // This is current the fragment shader's selector that
+        // determines how to operate on this tile (images vs gray-scale anti-aliased
+        // glyphs vs LCD subpixel antialiased glyphs)
+        static_cast<uint8_t>(tile.fragmentShaderSelector),
+        static_cast<uint8_t>(tile.imageTextureId ? TEXT_TEXTURE_IMAGE
+                                                 : atlas::format_index(tile.tileLocation.format)),
+        tile.imageTextureId ? uint16_t { 0 } : tile.tileLocation.page.value,
     };
-    // clang-format on
 
-    batch.renderTiles.emplace_back(tile);
-    crispy::copy(vertices, back_inserter(batch.buffer));
+    if (tile.imageTextureId)
+        _scheduledExecutions.imageBatch.tiles.emplace_back(tile.imageTextureId, instance);
+    else
+        _scheduledExecutions.renderBatch.instances.emplace_back(instance);
+}
+
+void OpenGLRenderer::uploadImage(atlas::UploadImage image)
+{
+    _scheduledExecutions.uploadImages.emplace_back(std::move(image));
+}
+
+void OpenGLRenderer::destroyImage(uint32_t imageTextureId)
+{
+    // Uploads of the same ID scheduled earlier are obsolete.
+    auto& uploads = _scheduledExecutions.uploadImages;
+    uploads.erase(std::remove_if(uploads.begin(),
+                                 uploads.end(),
+                                 [&](auto const& upload) { return upload.imageTextureId == imageTextureId; }),
+                  uploads.end());
+    _scheduledExecutions.destroyImages.emplace_back(imageTextureId);
 }
 // }}}
 
@@ -479,119 +746,319 @@ void OpenGLRenderer::execute()
 
     auto const timeValue = uptime();
 
-    if (_backgroundImageTexture)
-    {
-        bound(*_backgroundShader, [&]() { executeRenderBackground(timeValue); });
-    }
+    if (_timerQueriesSupported)
+        beginTimerQuery();
 
-    // render filled rects
+    // upload filled rects
     //
+    auto const rectCount = static_cast<GLsizei>(_rectBuffer.size());
     if (!_rectBuffer.empty())
     {
-        bound(*_rectShader, [&]() {
-            _rectShader->setUniformValue(_rectProjectionLocation, _projectionMatrix);
-            _rectShader->setUniformValue(_rectTimeLocation, timeValue);
-
-            glBindVertexArray(_rectVAO);
-            glBindBuffer(GL_ARRAY_BUFFER, _rectVBO);
-            glBufferData(GL_ARRAY_BUFFER,
-                         static_cast<GLsizeiptr>(_rectBuffer.size() * sizeof(GLfloat)),
-                         _rectBuffer.data(),
-                         GL_STREAM_DRAW);
-
-            glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(_rectBuffer.size() / 7));
-            glBindVertexArray(0);
-        });
+        streamVertices(_rectStream, _rectBuffer.data(), _rectBuffer.size() * sizeof(RectInstance));
         _rectBuffer.clear();
     }
 
-    // render textures
+    // upload procedurally rendered box drawing characters
     //
-    bound(*_textShader, [&]() {
-        // TODO: only upload when it actually DOES change
-        _textShader->setUniformValue(_textProjectionLocation, _projectionMatrix);
-        _textShader->setUniformValue(_textTimeLocation, timeValue);
-        executeRenderTextures();
-    });
+    auto const boxCount = static_cast<GLsizei>(_boxBuffer.size());
+    if (!_boxBuffer.empty())
+    {
+        streamVertices(_boxStream, _boxBuffer.data(), _boxBuffer.size() * sizeof(BoxInstance));
+        _boxBuffer.clear();
+    }
+
+    // upload textures
+    //
+    executeUploadTextures();
+    executeUploadCellGrid();
+
+    if (_backgroundImageUploadPending)
+        uploadBackgroundImageFile();
+
+    if (_backgroundImageBlurPending)
+        blurBackgroundImage();
+
+    // Scrolled contents are moved first, such that the damaged areas are rendered on top.
+    if (auto const scroll = std::exchange(_contentScroll, nullopt); scroll && _damage && _contentsValid)
+        executeScrollContents(scroll->first, scroll->second);
+
+    auto const renderScene = [&]() {
+        if (_clearPending)
+            glClear(GL_COLOR_BUFFER_BIT);
+
+        if (_backgroundImageTexture)
+        {
+            bound(*_backgroundShader, [&]() { executeRenderBackground(timeValue); });
+        }
+
+        if (_scheduledExecutions.cellGrid.scheduled)
+            executeRenderCellGrid();
+
+        if (rectCount)
+            executeRenderRectangles(timeValue, rectCount);
+
+        if (boxCount)
+            executeRenderBoxDrawing(boxCount);
+
+        executeRenderTextures(timeValue);
+    };
 
+    if (auto const damage = std::exchange(_damage, nullopt); !damage)
+    {
+        renderScene();
+        _contentsValid = true;
+    }
+    else
+    {
+        // Render the scene once per damaged area, each time with everything else clipped away.
+        glEnable(GL_SCISSOR_TEST);
+        auto const renderTargetHeight = unbox<int>(_renderTargetSize.height);
+        for (auto const& area: *damage)
+        {
+            // Scissor boxes have their origin at the bottom left.
+            auto const height = unbox<int>(area.height);
+            glScissor(0, renderTargetHeight - area.top - height, unbox<int>(_renderTargetSize.width), height);
+            renderScene();
+        }
+        glDisable(GL_SCISSOR_TEST);
+    }
+    _clearPending = false;
+
+    if (rectCount)
+        fenceVertexStream(_rectStream);
+    if (boxCount)
+        fenceVertexStream(_boxStream);
+    if (!_scheduledExecutions.renderBatch.instances.empty())
+        fenceVertexStream(_textStream);
+    if (!_scheduledExecutions.imageBatch.instances.empty())
+        fenceVertexStream(_imageStream);
+    _scheduledExecutions.clear();
+
+    endTimerQuery();
+
+    completeScreenshotReadbacks();
     if (_pendingScreenshotCallback)
     {
-        auto result = takeScreenshot();
-        _pendingScreenshotCallback.value()(result.second, result.first);
+        auto callback = std::move(_pendingScreenshotCallback.value());
         _pendingScreenshotCallback.reset();
+        beginScreenshotReadback(std::move(callback));
     }
 }
 
-void OpenGLRenderer::executeRenderTextures()
+void OpenGLRenderer::executeUploadTextures()
 {
-    // potentially (re-)configure atlas
-    if (_scheduledExecutions.configureAtlas)
-        executeConfigureAtlas(*_scheduledExecutions.configureAtlas);
+    // potentially (re-)configure atlases
+    for (auto const& configureAtlas: _scheduledExecutions.configureAtlas)
+        if (configureAtlas)
+            executeConfigureAtlas(*configureAtlas);
 
     // potentially upload any new textures
-    for (auto const& params: _scheduledExecutions.uploadTiles)
-        executeUploadTile(params);
+    executeUploadTiles();
+
+    for (auto const imageTextureId: _scheduledExecutions.destroyImages)
+        executeDestroyImage(imageTextureId);
+    for (auto const& params: _scheduledExecutions.uploadImages)
+        executeUploadImage(params);
+
+    // upload tile instances of all atlases, which are rendered with a single draw call
+    RenderBatch const& batch = _scheduledExecutions.renderBatch;
+    if (!batch.instances.empty())
+        streamVertices(_textStream, batch.instances.data(), batch.instances.size() * sizeof(TileInstance));
+
+    // Group the image tiles by texture, such that each image texture needs one draw call only.
+    ImageBatch& images = _scheduledExecutions.imageBatch;
+    std::stable_sort(images.tiles.begin(), images.tiles.end(), [](auto const& a, auto const& b) {
+        return a.first < b.first;
+    });
+    for (auto const& [imageTextureId, instance]: images.tiles)
+    {
+        auto const texture = _imageTextures.find(imageTextureId);
+        if (texture == _imageTextures.end())
+            continue;
+        if (images.draws.empty() || images.draws.back().textureId != texture->second)
+            images.draws.emplace_back(ImageDraw { texture->second, images.instances.size(), 0 });
+        images.instances.emplace_back(instance);
+        ++images.draws.back().count;
+    }
+    if (!images.instances.empty())
+        streamVertices(
+            _imageStream, images.instances.data(), images.instances.size() * sizeof(TileInstance));
+}
+
+void OpenGLRenderer::executeRenderRectangles(float timeValue, GLsizei count)
+{
+    bound(*_rectShader, [&]() {
+        _rectShader->setUniformValue(_rectProjectionLocation, _projectionMatrix);
+        _rectShader->setUniformValue(_rectTimeLocation, timeValue);
+
+        glBindVertexArray(_rectStream.vao);
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+        glBindVertexArray(0);
+    });
+}
 
-    // upload vertices and render
-    RenderBatch& batch = _scheduledExecutions.renderBatch;
-    if (!batch.renderTiles.empty())
+void OpenGLRenderer::executeRenderBoxDrawing(GLsizei count)
+{
+    bound(*_boxShader, [&]() {
+        _boxShader->setUniformValue(_boxProjectionLocation, _projectionMatrix);
+
+        glBindVertexArray(_boxStream.vao);
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+        glBindVertexArray(0);
+    });
+}
+
+void OpenGLRenderer::executeRenderTextures(float timeValue)
+{
+    RenderBatch const& batch = _scheduledExecutions.renderBatch;
+    ImageBatch const& images = _scheduledExecutions.imageBatch;
+    if (batch.instances.empty() && images.draws.empty())
+        return;
+
+    bound(*_textShader, [&]() {
+        // TODO: only upload when it actually DOES change
+        _textShader->setUniformValue(_textProjectionLocation, _projectionMatrix);
+        _textShader->setUniformValue(_textTimeLocation, timeValue);
+        // Depends on this renderer's atlas, while the shader is shared with other renderers.
+        _textShader->setUniformValue(_textPixelXLocation, 1.0f / unbox<GLfloat>(atlasSize().width));
+
+        if (!batch.instances.empty())
+        {
+            for (size_t i = 0; i < AtlasCount; ++i)
+            {
+                glActiveTexture(static_cast<GLenum>(GL_TEXTURE0 + TEXT_TEXTURE_ATLAS_RED + i));
+                glBindTexture(GL_TEXTURE_2D_ARRAY, _textureAtlases[i].textureId);
+            }
+            pointVertexStream(_textStream, 0);
+            glBindVertexArray(_textStream.vao);
+            glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(batch.instances.size()));
+        }
+
+        // Images are rendered above text.
+        glActiveTexture(GL_TEXTURE0 + TEXT_TEXTURE_IMAGE);
+        for (auto const& draw: images.draws)
+        {
+            pointVertexStream(_imageStream, draw.first);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, draw.textureId);
+            glBindVertexArray(_imageStream.vao);
+            glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, draw.count);
+        }
+        glActiveTexture(GL_TEXTURE0);
+    });
+}
+
+void OpenGLRenderer::executeUploadCellGrid()
+{
+    CellGridBatch const& batch = _scheduledExecutions.cellGrid;
+    if (!batch.scheduled)
+        return;
+
+    auto const width = unbox<GLsizei>(batch.pageSize.columns);
+    auto const height = unbox<GLsizei>(batch.pageSize.lines);
+
+    CHECKED_GL(glActiveTexture(GL_TEXTURE0));
+    if (!_cellGridTexture)
     {
-        glActiveTexture(static_cast<GLenum>(GL_TEXTURE0 + batch.userdata));
-        bindTexture(_textureAtlas.textureId);
-        glBindVertexArray(_textVAO);
+        CHECKED_GL(glGenTextures(1, &_cellGridTexture));
+        bindTexture(_cellGridTexture);
+        CHECKED_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+        CHECKED_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+        CHECKED_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+        CHECKED_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+    }
+    else
+        bindTexture(_cellGridTexture);
 
-        // upload buffer
-        // clang-format off
-        glBindBuffer(GL_ARRAY_BUFFER, _textVBO);
-        glBufferData(GL_ARRAY_BUFFER,
-                     static_cast<GLsizei>(batch.buffer.size() * sizeof(GLfloat)),
-                     batch.buffer.data(), GL_STREAM_DRAW);
-        glDrawArrays(GL_TRIANGLES,
-                     0,
-                     static_cast<GLsizei>(batch.renderTiles.size() * 6));
-        // clang-format on
+    CHECKED_GL(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+    if (_cellGridTextureSize != batch.pageSize)
+    {
+        CHECKED_GL(glTexImage2D(
+            GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, batch.colors.data()));
+        _cellGridTextureSize = batch.pageSize;
+    }
+    else
+    {
+        CHECKED_GL(glTexSubImage2D(
+            GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, batch.colors.data()));
     }
+}
 
-    _scheduledExecutions.clear();
+void OpenGLRenderer::executeRenderCellGrid()
+{
+    CellGridBatch const& batch = _scheduledExecutions.cellGrid;
+
+    bound(*_cellGridShader, [&]() {
+        auto const cellWidth = unbox<float>(batch.cellSize.width);
+        auto const cellHeight = unbox<float>(batch.cellSize.height);
+        _cellGridShader->setUniformValue(_cellGridUniformLocations.projection, _projectionMatrix);
+        _cellGridShader->setUniformValue(_cellGridUniformLocations.rect,
+                                         static_cast<float>(batch.x),
+                                         static_cast<float>(batch.y),
+                                         cellWidth * unbox<float>(batch.pageSize.columns),
+                                         cellHeight * unbox<float>(batch.pageSize.lines));
+        _cellGridShader->setUniformValue(_cellGridUniformLocations.cellSize, cellWidth, cellHeight);
+
+        glActiveTexture(GL_TEXTURE0);
+        bindTexture(_cellGridTexture);
+        glBindVertexArray(_cellGridVAO);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        glBindVertexArray(0);
+    });
 }
 
 void OpenGLRenderer::executeConfigureAtlas(atlas::ConfigureAtlas const& param)
 {
-    if (_textureAtlas.textureId)
-        glDeleteTextures(1, &_textureAtlas.textureId);
-
-    CHECKED_GL(glGenTextures(1, &_textureAtlas.textureId));
-    bindTexture(_textureAtlas.textureId);
+    auto const _ = crispy::StartupTrace::Scope("Configure texture atlas");
 
     Require(isPowerOfTwo(unbox<uint32_t>(param.size.width)));
     Require(isPowerOfTwo(unbox<uint32_t>(param.size.height)));
 
-    // Already initialized.
-    // _textureAtlas.textureSize = param.size;
-    // _textureAtlas.properties = param.properties;
+    if (param.pageCount == 0)
+    {
+        executeDestroyAtlas(param.format);
+        return;
+    }
 
-    CHECKED_GL(glTexParameteri(GL_TEXTURE_2D,
+    auto& textureAtlas = _textureAtlases[atlas::format_index(param.format)];
+
+    // If only pages were added or released, the remaining pages are copied over into the new texture.
+    auto const& allocated = textureAtlas.allocated;
+    auto const resize = textureAtlas.textureId && allocated.size == param.size
+                        && allocated.pageCount != param.pageCount;
+    auto const copiedPageCount = resize ? std::min(allocated.pageCount, param.pageCount) : 0;
+    auto const previousTextureId = textureAtlas.textureId;
+
+    if (previousTextureId && !resize)
+        glDeleteTextures(1, &textureAtlas.textureId);
+
+    CHECKED_GL(glGenTextures(1, &textureAtlas.textureId));
+    CHECKED_GL(glBindTexture(GL_TEXTURE_2D_ARRAY, textureAtlas.textureId));
+
+    CHECKED_GL(glTexParameteri(GL_TEXTURE_2D_ARRAY,
                                GL_TEXTURE_MAG_FILTER,
                                GL_NEAREST)); // NEAREST, because LINEAR yields borders at the edges
-    CHECKED_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
-    CHECKED_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE));
-    CHECKED_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
-    CHECKED_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+    CHECKED_GL(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+    CHECKED_GL(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE));
+    CHECKED_GL(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+    CHECKED_GL(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
 
     // clang-format off
-    DisplayLog()("GL configure atlas: {} {} GL texture Id {}",
-                 param.size, param.properties.format, _textureAtlas.textureId);
+    DisplayLog()("GL configure atlas: {} {} {} pages ({} preserved) GL texture Id {}",
+                 param.size, param.format, param.pageCount, copiedPageCount,
+                 textureAtlas.textureId);
     // clang-format on
 
-    auto constexpr target = GL_TEXTURE_2D;
+    auto constexpr target = GL_TEXTURE_2D_ARRAY;
     auto constexpr levelOfDetail = 0;
     auto constexpr type = GL_UNSIGNED_BYTE;
+    auto const width = unbox<int>(param.size.width);
+    auto const height = unbox<int>(param.size.height);
 
     std::vector<uint8_t> stub;
     // {{{ fill stub
-    stub.resize(param.size.area() * element_count(param.properties.format));
+    stub.resize(param.size.area() * element_count(param.format));
     auto t = stub.begin();
-    switch (param.properties.format)
+    switch (param.format)
     {
         case atlas::Format::Red:
             for (auto i = 0u; i < param.size.area(); ++i)
@@ -617,94 +1084,229 @@ void OpenGLRenderer::executeConfigureAtlas(atlas::ConfigureAtlas const& param)
     }
     // }}}
 
-    GLenum const glFmt = glFormat(param.properties.format);
+    GLenum const glFmt = glFormat(param.format);
     GLint constexpr UnusedParam = 0;
-    CHECKED_GL(glTexImage2D(target,
+    CHECKED_GL(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+    CHECKED_GL(glTexImage3D(target,
                             levelOfDetail,
-                            (int) glFmt,
-                            unbox<int>(param.size.width),
-                            unbox<int>(param.size.height),
+                            glInternalFormat(param.format),
+                            width,
+                            height,
+                            static_cast<GLsizei>(param.pageCount),
                             UnusedParam,
                             glFmt,
                             type,
-                            stub.data()));
+                            nullptr));
+
+    for (auto page = copiedPageCount; page < param.pageCount; ++page)
+    {
+        auto const layer = static_cast<GLint>(page);
+        CHECKED_GL(glTexSubImage3D(
+            target, levelOfDetail, 0, 0, layer, width, height, 1, glFmt, type, stub.data()));
+    }
+
+    if (resize)
+    {
+        // Copying texture layers works via a framebuffer to read from, which must not disturb
+        // the framebuffer currently being rendered to.
+        auto previousReadFramebuffer = GLint {};
+        CHECKED_GL(glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previousReadFramebuffer));
+
+        auto fbo = GLuint {};
+        CHECKED_GL(glGenFramebuffers(1, &fbo));
+        CHECKED_GL(glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo));
+        for (auto page = 0u; page < copiedPageCount; ++page)
+        {
+            auto const layer = static_cast<GLint>(page);
+            CHECKED_GL(glFramebufferTextureLayer(
+                GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, previousTextureId, levelOfDetail, layer));
+            CHECKED_GL(glCopyTexSubImage3D(target, levelOfDetail, 0, 0, layer, 0, 0, width, height));
+        }
+        CHECKED_GL(glBindFramebuffer(GL_READ_FRAMEBUFFER, static_cast<GLuint>(previousReadFramebuffer)));
+        CHECKED_GL(glDeleteFramebuffers(1, &fbo));
+        glDeleteTextures(1, &previousTextureId);
+    }
+
+    textureAtlas.allocated = param;
 }
 
-void OpenGLRenderer::executeUploadTile(atlas::UploadTile const& param)
+void OpenGLRenderer::executeUploadTiles()
 {
-    auto const textureId = _textureAtlas.textureId;
-    Require(textureId != 0);
+    auto& uploads = _scheduledExecutions.uploadTiles;
+    if (uploads.empty())
+        return;
 
-    auto constexpr target = GL_TEXTURE_2D;
-    auto constexpr LevelOfDetail = 0;
-    auto constexpr BitmapType = GL_UNSIGNED_BYTE;
+    // Tiles are allocated in order within an atlas row, so that the tiles stored within a frame
+    // mostly end up next to each other.
+    auto const key = [](atlas::UploadTile const& tile) {
+        auto const& location = tile.location;
+        return std::tuple(
+            atlas::format_index(location.format), location.page.value, location.y.value, location.x.value);
+    };
+    std::stable_sort(
+        uploads.begin(), uploads.end(), [&](auto const& a, auto const& b) { return key(a) < key(b); });
 
-    // clang-format off
-    // DisplayLog()("-> uploadTile: tex {} location {} format {} size {}",
-    //              textureId, param.location, param.bitmapFormat, param.bitmapSize);
-    // clang-format on
+    auto const tileSize = _textureAtlases.front().properties.tileSize;
+    auto const tileWidth = unbox<size_t>(tileSize.width);
+    auto const tileHeight = unbox<size_t>(tileSize.height);
 
-    bindTexture(textureId);
+    // Join horizontally adjacent tiles into bands. Of several uploads into the same tile,
+    // only the last one is kept.
+    _tileBands.clear();
+    for (size_t i = 0; i < uploads.size(); ++i)
+    {
+        if (i + 1 < uploads.size() && key(uploads[i]) == key(uploads[i + 1]))
+            continue;
 
-    // Image row alignment is 1 byte (OpenGL defaults to 4).
-    CHECKED_GL(glPixelStorei(GL_UNPACK_ALIGNMENT, param.rowAlignment));
+        auto const& tile = uploads[i];
+        auto const& textureAtlas = _textureAtlases[atlas::format_index(tile.location.format)];
+        Require(textureAtlas.textureId != 0);
+        Require(tile.location.page.value < textureAtlas.allocated.pageCount);
+        Require(tile.bitmapFormat == tile.location.format);
 
-    // Forece RGBA as OpenGL ES cannot implicitly convert on the driver-side.
-    auto bitmapFormat = glFormat(param.bitmapFormat);
-    auto bitmapData = (void const*) param.bitmap.data();
-    auto bitmapConverted = atlas::Buffer();
-    switch (param.bitmapFormat)
-    {
-        case atlas::Format::Red: {
-            bitmapFormat = GL_RGBA;
-            bitmapConverted.resize(param.bitmapSize.area() * 4);
-            bitmapData = bitmapConverted.data();
-            auto s = param.bitmap.data();
-            auto e = param.bitmap.data() + param.bitmap.size();
-            auto t = bitmapConverted.data();
-            while (s != e)
+        if (!_tileBands.empty())
+        {
+            auto& band = _tileBands.back();
+            if (band.location.format == tile.location.format
+                && band.location.page.value == tile.location.page.value
+                && band.location.y.value == tile.location.y.value
+                && band.location.x.value + band.tiles.size() * tileWidth == tile.location.x.value)
             {
-                *t++ = *s++; // red
-                *t++ = 0x00; // green
-                *t++ = 0x00; // blue
-                *t++ = 0xFF; // alpha
+                band.tiles.emplace_back(&tile);
+                continue;
             }
-            break;
         }
-        case atlas::Format::RGB: {
-            bitmapFormat = GL_RGBA;
-            bitmapConverted.resize(param.bitmapSize.area() * 4);
-            bitmapData = bitmapConverted.data();
-            auto s = param.bitmap.data();
-            auto e = param.bitmap.data() + param.bitmap.size();
-            auto t = bitmapConverted.data();
-            while (s != e)
+        _tileBands.emplace_back(TileBand { tile.location, { &tile } });
+    }
+
+    auto const bandSize = [&](TileBand const& band) {
+        return band.tiles.size() * tileWidth * tileHeight * element_count(band.location.format);
+    };
+
+    auto constexpr target = GL_TEXTURE_2D_ARRAY;
+    auto constexpr LevelOfDetail = 0;
+    auto constexpr BitmapType = GL_UNSIGNED_BYTE;
+
+    if (!_tileUploadBuffer)
+        CHECKED_GL(glGenBuffers(1, &_tileUploadBuffer));
+    CHECKED_GL(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _tileUploadBuffer));
+    CHECKED_GL(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+
+    for (size_t first = 0; first < _tileBands.size();)
+    {
+        // Stage as many bands as fit into the budget, but at least one.
+        auto last = first;
+        auto stagedSize = size_t { 0 };
+        do
+            stagedSize += bandSize(_tileBands[last++]);
+        while (last < _tileBands.size() && stagedSize + bandSize(_tileBands[last]) <= TileUploadBudget);
+
+        // The tiles' bitmaps are copied to the top left of their tile, clearing the rest of the tile.
+        _tileUploadStaging.assign(stagedSize, 0);
+        auto offset = size_t { 0 };
+        for (auto i = first; i < last; ++i)
+        {
+            auto const& band = _tileBands[i];
+            auto const elementCount = element_count(band.location.format);
+            auto const bandPitch = band.tiles.size() * tileWidth * elementCount;
+            for (size_t column = 0; column < band.tiles.size(); ++column)
             {
-                *t++ = *s++; // red
-                *t++ = *s++; // green
-                *t++ = *s++; // blue
-                *t++ = 0xFF; // alpha
+                auto const& tile = *band.tiles[column];
+                auto const width = std::min(unbox<size_t>(tile.bitmapSize.width), tileWidth);
+                auto const height = std::min(unbox<size_t>(tile.bitmapSize.height), tileHeight);
+                auto const alignment = static_cast<size_t>(tile.rowAlignment);
+                auto const rowLength = unbox<size_t>(tile.bitmapSize.width) * elementCount;
+                auto const pitch = (rowLength + alignment - 1) / alignment * alignment;
+                auto* destination = _tileUploadStaging.data() + offset + column * tileWidth * elementCount;
+                for (size_t row = 0; row < height; ++row)
+                    std::memcpy(destination + row * bandPitch,
+                                tile.bitmap.data() + row * pitch,
+                                width * elementCount);
             }
-            break;
+            offset += bandSize(band);
         }
-        case atlas::Format::RGBA: break;
+
+        CHECKED_GL(glBufferData(GL_PIXEL_UNPACK_BUFFER,
+                                static_cast<GLsizeiptr>(stagedSize),
+                                _tileUploadStaging.data(),
+                                GL_STREAM_DRAW));
+
+        // With a pixel unpack buffer bound, the data pointer is an offset into that buffer.
+        offset = 0;
+        for (auto i = first; i < last; ++i)
+        {
+            auto const& band = _tileBands[i];
+            auto const textureId = _textureAtlases[atlas::format_index(band.location.format)].textureId;
+            CHECKED_GL(glBindTexture(target, textureId));
+            CHECKED_GL(glTexSubImage3D(target,
+                                       LevelOfDetail,
+                                       band.location.x.value,
+                                       band.location.y.value,
+                                       band.location.page.value,
+                                       static_cast<GLsizei>(band.tiles.size() * tileWidth),
+                                       static_cast<GLsizei>(tileHeight),
+                                       1,
+                                       glFormat(band.location.format),
+                                       BitmapType,
+                                       (void const*) offset));
+            offset += bandSize(band);
+        }
+
+        first = last;
     }
 
-    CHECKED_GL(glTexSubImage2D(target,
-                               LevelOfDetail,
-                               param.location.x.value,
-                               param.location.y.value,
-                               unbox<GLsizei>(param.bitmapSize.width),
-                               unbox<GLsizei>(param.bitmapSize.height),
-                               bitmapFormat,
-                               BitmapType,
-                               bitmapData));
+    CHECKED_GL(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
 }
 
-void OpenGLRenderer::executeDestroyAtlas()
+void OpenGLRenderer::executeUploadImage(atlas::UploadImage const& param)
 {
-    glDeleteTextures(1, &_textureAtlas.textureId);
-    _textureAtlas.textureId = 0;
+    executeDestroyImage(param.imageTextureId);
+
+    auto constexpr target = GL_TEXTURE_2D_ARRAY;
+    auto textureId = GLuint {};
+    CHECKED_GL(glGenTextures(1, &textureId));
+    CHECKED_GL(glBindTexture(target, textureId));
+
+    // Unlike atlas tiles, an image's fragments are neighbours within the same texture, so they can
+    // be filtered linearly without bleeding. Mipmaps keep the image smooth when rendered smaller.
+    CHECKED_GL(glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+    CHECKED_GL(glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR));
+    CHECKED_GL(glTexParameteri(target, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE));
+    CHECKED_GL(glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+    CHECKED_GL(glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+
+    CHECKED_GL(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+    CHECKED_GL(glTexImage3D(target,
+                            0,
+                            GL_RGBA8,
+                            unbox<GLsizei>(param.bitmapSize.width),
+                            unbox<GLsizei>(param.bitmapSize.height),
+                            1,
+                            0,
+                            GL_RGBA,
+                            GL_UNSIGNED_BYTE,
+                            param.bitmap.data()));
+    CHECKED_GL(glGenerateMipmap(target));
+
+    _imageTextures[param.imageTextureId] = textureId;
+}
+
+void OpenGLRenderer::executeDestroyImage(uint32_t imageTextureId)
+{
+    if (auto const i = _imageTextures.find(imageTextureId); i != _imageTextures.end())
+    {
+        CHECKED_GL(glDeleteTextures(1, &i->second));
+        _imageTextures.erase(i);
+    }
+}
+
+void OpenGLRenderer::executeDestroyAtlas(atlas::Format format)
+{
+    auto& textureAtlas = _textureAtlases[atlas::format_index(format)];
+    if (textureAtlas.textureId)
+        glDeleteTextures(1, &textureAtlas.textureId);
+    textureAtlas.textureId = 0;
+    textureAtlas.allocated.pageCount = 0;
 }
 
 void OpenGLRenderer::bindTexture(GLuint textureId)
@@ -716,49 +1318,72 @@ void OpenGLRenderer::bindTexture(GLuint textureId)
     }
 }
 
-void OpenGLRenderer::renderRectangle(int ix, int iy, Width width, Height height, RGBAColor color)
+void OpenGLRenderer::renderRectangle(int x, int y, Width width, Height height, RGBAColor color)
 {
-    auto const x = static_cast<GLfloat>(ix);
-    auto const y = static_cast<GLfloat>(iy);
-    auto const z = GLfloat { 0.0f };
-    auto const r = unbox<GLfloat>(width);
-    auto const s = unbox<GLfloat>(height);
-    auto const [cr, cg, cb, ca] = atlas::normalize(color);
+    _rectBuffer.emplace_back(RectInstance {
+        static_cast<int16_t>(x),
+        static_cast<int16_t>(y),
+        unbox<int16_t>(width),
+        unbox<int16_t>(height),
+        { color.red(), color.green(), color.blue(), color.alpha() },
+    });
+}
 
-    // clang-format off
-    GLfloat const vertices[6 * 7] = {
-        // first triangle
-        x,     y + s, z, cr, cg, cb, ca,
-        x,     y,     z, cr, cg, cb, ca,
-        x + r, y,     z, cr, cg, cb, ca,
-
-        // second triangle
-        x,     y + s, z, cr, cg, cb, ca,
-        x + r, y,     z, cr, cg, cb, ca,
-        x + r, y + s, z, cr, cg, cb, ca
-    };
-    // clang-format on
+void OpenGLRenderer::renderBoxDrawing(
+    int x, int y, ImageSize cellSize, int lineThickness, uint32_t shape, RGBAColor color)
+{
+    _boxBuffer.emplace_back(BoxInstance {
+        static_cast<int16_t>(x),
+        static_cast<int16_t>(y),
+        unbox<int16_t>(cellSize.width),
+        unbox<int16_t>(cellSize.height),
+        { color.red(), color.green(), color.blue(), color.alpha() },
+        { static_cast<uint16_t>(shape & 0xFFFF), static_cast<uint16_t>(shape >> 16) },
+        static_cast<uint16_t>(lineThickness),
+        0,
+    });
+}
 
-    crispy::copy(vertices, back_inserter(_rectBuffer));
+void OpenGLRenderer::renderCellBackgrounds(terminal::renderer::CellBackgroundGrid const& grid)
+{
+    CellGridBatch& batch = _scheduledExecutions.cellGrid;
+    batch.scheduled = true;
+    batch.x = grid.x;
+    batch.y = grid.y;
+    batch.cellSize = grid.cellSize;
+    batch.pageSize = grid.pageSize;
+
+    batch.colors.resize(grid.colors.size() * 4);
+    auto* texel = batch.colors.data();
+    for (auto const color: grid.colors)
+    {
+        *texel++ = color.red();
+        *texel++ = color.green();
+        *texel++ = color.blue();
+        *texel++ = color.alpha();
+    }
 }
 
 optional<terminal::renderer::AtlasTextureScreenshot> OpenGLRenderer::readAtlas()
 {
-    // NB: to get all atlas pages, call this from instance base id up to and including current
-    // instance id of the given allocator.
+    // NB: This reads the first page of the grayscale glyph atlas only, converted to RGBA.
+
+    auto const& textureAtlas = _textureAtlases[atlas::format_index(atlas::Format::Red)];
+    if (!textureAtlas.textureId)
+        return nullopt;
 
     auto output = terminal::renderer::AtlasTextureScreenshot {};
     output.atlasInstanceId = 0;
-    output.size = _textureAtlas.textureSize;
-    output.format = _textureAtlas.properties.format;
-    output.buffer.resize(_textureAtlas.textureSize.area() * element_count(_textureAtlas.properties.format));
+    output.size = textureAtlas.textureSize;
+    output.format = atlas::Format::RGBA;
+    output.buffer.resize(textureAtlas.textureSize.area() * element_count(output.format));
 
     // Reading texture data to host CPU (including for RGB textures) only works via framebuffers
     auto fbo = GLuint {};
     CHECKED_GL(glGenFramebuffers(1, &fbo));
     CHECKED_GL(glBindFramebuffer(GL_FRAMEBUFFER, fbo));
-    CHECKED_GL(glFramebufferTexture2D(
-        GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _textureAtlas.textureId, 0));
+    CHECKED_GL(
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, textureAtlas.textureId, 0, 0));
     CHECKED_GL(glReadPixels(0,
                             0,
                             unbox<GLsizei>(output.size.width),
@@ -777,24 +1402,71 @@ void OpenGLRenderer::scheduleScreenshot(ScreenshotCallback callback)
     _pendingScreenshotCallback = std::move(callback);
 }
 
-pair<ImageSize, vector<uint8_t>> OpenGLRenderer::takeScreenshot()
+void OpenGLRenderer::beginScreenshotReadback(ScreenshotCallback callback)
 {
-    ImageSize const imageSize = renderBufferSize();
-
-    vector<uint8_t> buffer;
-    buffer.resize(imageSize.area() * 4 /* 4 because RGBA */);
+    auto readback = ScreenshotReadback { std::move(callback), renderBufferSize() };
+    auto const bufferSize = static_cast<GLsizeiptr>(readback.size.area() * 4 /* 4 because RGBA */);
 
-    DisplayLog()("Capture screenshot ({}/{}).", imageSize, _renderTargetSize);
+    DisplayLog()("Capture screenshot ({}/{}).", readback.size, _renderTargetSize);
 
+    // Reading into a pixel buffer object returns without waiting for the GPU to finish the frame.
+    CHECKED_GL(glGenBuffers(1, &readback.pbo));
+    CHECKED_GL(glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo));
+    CHECKED_GL(glBufferData(GL_PIXEL_PACK_BUFFER, bufferSize, nullptr, GL_STREAM_READ));
     CHECKED_GL(glReadPixels(0,
                             0,
-                            unbox<GLsizei>(imageSize.width),
-                            unbox<GLsizei>(imageSize.height),
+                            unbox<GLsizei>(readback.size.width),
+                            unbox<GLsizei>(readback.size.height),
                             GL_RGBA,
                             GL_UNSIGNED_BYTE,
-                            buffer.data()));
+                            nullptr));
+    CHECKED_GL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+    readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    _screenshotReadbacks.emplace_back(std::move(readback));
+}
+
+void OpenGLRenderer::completeScreenshotReadbacks()
+{
+    // The GPU completes the readbacks in the order they have been issued.
+    while (!_screenshotReadbacks.empty())
+    {
+        auto& readback = _screenshotReadbacks.front();
+
+        // Only block on the GPU if the readback did not complete within the last few frames.
+        auto const mustComplete = ++readback.framesWaited > MaxScreenshotReadbackFrames;
+        auto const timeout = mustComplete ? GLuint64 { 1'000'000'000 } : GLuint64 { 0 };
+        auto const status = glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+        if (status == GL_TIMEOUT_EXPIRED && !mustComplete)
+            return;
+
+        auto pixels = vector<uint8_t>(readback.size.area() * 4);
+        CHECKED_GL(glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo));
+        if (auto const* mapping = glMapBufferRange(
+                GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(pixels.size()), GL_MAP_READ_BIT))
+        {
+            std::memcpy(pixels.data(), mapping, pixels.size());
+            CHECKED_GL(glUnmapBuffer(GL_PIXEL_PACK_BUFFER));
+        }
+        else
+            errorlog()("Failed to map screenshot pixel buffer.");
+        CHECKED_GL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
 
-    return { imageSize, buffer };
+        auto const size = readback.size;
+        auto callback = std::move(readback.callback);
+        destroyScreenshotReadback(readback);
+        _screenshotReadbacks.erase(_screenshotReadbacks.begin());
+
+        callback(pixels, size);
+    }
+}
+
+void OpenGLRenderer::destroyScreenshotReadback(ScreenshotReadback& readback)
+{
+    if (readback.fence)
+        glDeleteSync(readback.fence);
+    CHECKED_GL(glDeleteBuffers(1, &readback.pbo));
+    readback = ScreenshotReadback {};
 }
 
 void OpenGLRenderer::clear(terminal::RGBAColor fillColor)
@@ -804,24 +1476,117 @@ void OpenGLRenderer::clear(terminal::RGBAColor fillColor)
         auto const clearColor = atlas::normalize(fillColor);
         glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
         _renderStateCache.backgroundColor = fillColor;
+        _contentsValid = false;
     }
 
-    glClear(GL_COLOR_BUFFER_BIT);
+    // Clearing is deferred to execute(), as it may be restricted to the damaged areas.
+    _clearPending = true;
 }
 
-// }}}
+bool OpenGLRenderer::preservesContents() const noexcept
+{
+    return _preservingContents && _contentsValid;
+}
 
-void OpenGLRenderer::inspect(std::ostream& /*output*/) const
+void OpenGLRenderer::setDamage(vector<terminal::renderer::DamagedArea> areas)
 {
+    assert(preservesContents());
+    _damage = std::move(areas);
 }
 
-// {{{ background (image)
-struct CRISPY_PACKED BackgroundShaderParams
+bool OpenGLRenderer::scrollContents(terminal::renderer::DamagedArea area, int offset)
 {
-    vec3 vertices;
-    vec2 textureCoords;
-};
+    assert(preservesContents());
+
+    // The background image stays in place, and so would have to be rendered again anyway.
+    if (_backgroundImageTexture)
+        return false;
+
+    _contentScroll = pair { area, offset };
+    return true;
+}
+
+void OpenGLRenderer::executeScrollContents(terminal::renderer::DamagedArea const& area, int offset)
+{
+    auto const width = unbox<GLint>(_renderTargetSize.width);
+    auto const height = unbox<GLint>(area.height) - std::abs(offset);
+    if (height <= 0)
+        return;
+
+    // Framebuffer coordinates have their origin at the bottom left.
+    auto const renderTargetHeight = unbox<GLint>(_renderTargetSize.height);
+    auto const sourceY = renderTargetHeight - (area.top + std::max(0, -offset)) - height;
+    auto const targetY = renderTargetHeight - (area.top + std::max(0, offset)) - height;
 
+    auto framebuffer = GLint {};
+    auto previousReadFramebuffer = GLint {};
+    CHECKED_GL(glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer));
+    CHECKED_GL(glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previousReadFramebuffer));
+
+    // Source and target overlap, so the contents are moved through a texture rather than in place.
+    if (!_scrollFramebuffer)
+        CHECKED_GL(glGenFramebuffers(1, &_scrollFramebuffer));
+    if (!_scrollTexture || _scrollTextureSize != _renderTargetSize)
+    {
+        if (!_scrollTexture)
+            CHECKED_GL(glGenTextures(1, &_scrollTexture));
+        bindTexture(_scrollTexture);
+        CHECKED_GL(glTexImage2D(GL_TEXTURE_2D,
+                                0,
+                                GL_RGBA8,
+                                width,
+                                renderTargetHeight,
+                                0,
+                                GL_RGBA,
+                                GL_UNSIGNED_BYTE,
+                                nullptr));
+        CHECKED_GL(glBindFramebuffer(GL_FRAMEBUFFER, _scrollFramebuffer));
+        CHECKED_GL(glFramebufferTexture2D(
+            GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _scrollTexture, 0));
+        _scrollTextureSize = _renderTargetSize;
+    }
+
+    CHECKED_GL(glBindFramebuffer(GL_READ_FRAMEBUFFER, static_cast<GLuint>(framebuffer)));
+    CHECKED_GL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _scrollFramebuffer));
+    CHECKED_GL(glBlitFramebuffer(
+        0, sourceY, width, sourceY + height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST));
+
+    CHECKED_GL(glBindFramebuffer(GL_READ_FRAMEBUFFER, _scrollFramebuffer));
+    CHECKED_GL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, static_cast<GLuint>(framebuffer)));
+    CHECKED_GL(glBlitFramebuffer(
+        0, 0, width, height, 0, targetY, width, targetY + height, GL_COLOR_BUFFER_BIT, GL_NEAREST));
+
+    CHECKED_GL(glBindFramebuffer(GL_READ_FRAMEBUFFER, static_cast<GLuint>(previousReadFramebuffer)));
+}
+
+// }}}
+
+void OpenGLRenderer::inspect(std::ostream& output) const
+{
+    using terminal::renderer::atlas::element_count;
+
+    auto atlasBytes = size_t { 0 };
+    for (auto const& atlas: _textureAtlases)
+        atlasBytes += unbox<size_t>(atlas.allocated.size.width) * unbox<size_t>(atlas.allocated.size.height)
+                      * atlas.allocated.pageCount * element_count(atlas.allocated.format);
+
+    auto vertexBytes = size_t { 0 };
+    for (auto const* stream: { &_textStream, &_imageStream, &_rectStream, &_boxStream })
+        vertexBytes += stream->regionSize * VertexStream::RegionCount;
+
+    auto const cellGridBytes =
+        unbox<size_t>(_cellGridTextureSize.columns) * unbox<size_t>(_cellGridTextureSize.lines) * 4;
+
+    output << "OpenGLRenderer:\n";
+    output << fmt::format("texture atlases      : {}\n", crispy::humanReadableBytes(atlasBytes));
+    output << fmt::format("image textures       : {}\n", _imageTextures.size());
+    output << fmt::format("vertex streams       : {}\n", crispy::humanReadableBytes(vertexBytes));
+    output << fmt::format("cell grid texture    : {}\n", crispy::humanReadableBytes(cellGridBytes));
+    output << fmt::format("tile upload staging  : {}\n",
+                          crispy::humanReadableBytes(_tileUploadStaging.capacity()));
+}
+
+// {{{ background (image)
 void OpenGLRenderer::initializeBackgroundRendering()
 {
     bound(*_backgroundShader, [&]() {
@@ -836,97 +1601,86 @@ void OpenGLRenderer::initializeBackgroundRendering()
         // clang-format on
     });
 
-    // Setup VAO
+    // The quad covering the viewport is derived from gl_VertexID, without any vertex attributes.
     CHECKED_GL(glGenVertexArrays(1, &_backgroundVAO));
-    CHECKED_GL(glBindVertexArray(_backgroundVAO));
-
-    glGenBuffers(1, &_backgroundVBO);
-    CHECKED_GL(glBindBuffer(GL_ARRAY_BUFFER, _backgroundVBO));
-    CHECKED_GL(glBufferData(GL_ARRAY_BUFFER, 0, nullptr, GL_STREAM_DRAW));
-
-    auto constexpr BufferStride = sizeof(BackgroundShaderParams);
-    auto const VertexOffset = (void const*) offsetof(BackgroundShaderParams, vertices);
-    auto const TexCoordOffset = (void const*) offsetof(BackgroundShaderParams, textureCoords);
-
-    // 0 (vec3): vertex buffer
-    CHECKED_GL(glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, BufferStride, VertexOffset));
-    CHECKED_GL(glEnableVertexAttribArray(0));
-
-    // 1 (vec2): texture coordinates buffer
-    CHECKED_GL(glVertexAttribPointer(1, 2, GL_FLOAT, GL_TRUE, BufferStride, TexCoordOffset));
-    CHECKED_GL(glEnableVertexAttribArray(1));
-
-    // release
-    CHECKED_GL(glBindVertexArray(0));
 }
 
 void OpenGLRenderer::setBackgroundImage(shared_ptr<terminal::BackgroundImage const> const& backgroundImageOpt)
 {
-    if (!backgroundImageOpt || backgroundImageOpt->hash != _renderStateCache.backgroundImageHash)
+    _contentsValid = false;
+
+    auto const hasBackgroundImage = _backgroundImageTexture != 0 || _backgroundImageUploadPending;
+    if (backgroundImageOpt && hasBackgroundImage
+        && backgroundImageOpt->hash == _renderStateCache.backgroundImageHash
+        && backgroundImageOpt->blur == _renderStateCache.backgroundImageBlur)
     {
-        _renderStateCache.backgroundImageOpacity = 1.0f;
-        if (_backgroundImageTexture)
-        {
-            glDeleteTextures(1, &_backgroundImageTexture);
-            _backgroundImageTexture = 0;
-        }
+        // Still the same image, e.g. after reloading the configuration.
+        _renderStateCache.backgroundImageOpacity = backgroundImageOpt->opacity;
+        return;
     }
 
+    _renderStateCache.backgroundImageOpacity = 1.0f;
+    if (_backgroundImageTexture)
+    {
+        glDeleteTextures(1, &_backgroundImageTexture);
+        _backgroundImageTexture = 0;
+    }
+    _backgroundImageFile.reset();
+    _backgroundImageUploadPending = false;
+    _backgroundImageBlurPending = false;
+
     if (!backgroundImageOpt)
         return;
 
     auto& backgroundImage = *backgroundImageOpt;
     _renderStateCache.backgroundImageOpacity = backgroundImage.opacity;
     _renderStateCache.backgroundImageBlur = backgroundImage.blur;
+    _renderStateCache.backgroundImageHash = backgroundImage.hash;
 
     if (holds_alternative<FileSystem::path>(backgroundImage.location))
     {
-        auto const filePath = get<FileSystem::path>(backgroundImage.location);
-        auto const qFilePath = QString::fromStdString(filePath.string());
-        auto qImage = QImage(qFilePath);
-
-        if (backgroundImage.blur)
-        {
-            DisplayLog()("Blurring background image: {}", filePath.string());
-            auto const contextGuard = OpenGLContextGuard {};
-            auto blur = Blur {};
-            // auto const offsetStr = qgetenv("CONTOUR_BLUR_OFFSET").toStdString();
-            // auto const iterStr = qgetenv("CONTOUR_BLUR_ITERATIONS").toStdString();
-            // auto const offset = offsetStr.empty() ? 5 : std::stoi(offsetStr);
-            // auto const iterations = iterStr.empty() ? 5 : std::stoi(iterStr);
-            // qImage = blur.blurDualKawase(std::move(qImage), offset, iterations);
-            qImage = blur.blurGaussian(std::move(qImage));
-        }
-
-        qImage = qImage.convertToFormat(QImage::Format_RGBA8888);
-        if (qImage.format() != QImage::Format_RGBA8888)
-        {
-            errorlog()("Unsupported image format {} for background image at {}.",
-                       static_cast<int>(qImage.format()),
-                       filePath.string());
-            return;
-        }
-        auto const imageFormat = terminal::ImageFormat::RGBA;
-        auto const rowAlignment = 4; // This is default. Can it be any different?
-        DisplayLog()("Background image from disk: {}x{} {}", qImage.width(), qImage.height(), imageFormat);
-        _renderStateCache.backgroundImageHash = crispy::StrongHash::compute(filePath.string());
-        _renderStateCache.backgroundResolution = qImage.size();
-        _backgroundImageTexture =
-            createAndUploadImage(qImage.size(), imageFormat, rowAlignment, qImage.constBits());
+        // Decoded in the background meanwhile, and uploaded upon the next frame.
+        _backgroundImageFile = loadBackgroundImageFile(get<FileSystem::path>(backgroundImage.location));
+        _backgroundImageUploadPending = true;
     }
     else if (holds_alternative<terminal::ImageDataPtr>(backgroundImage.location))
     {
         auto const& imageData = *get<terminal::ImageDataPtr>(backgroundImage.location);
         DisplayLog()("Background inline image: {} {}", imageData.size, imageData.format);
-        _renderStateCache.backgroundImageHash = imageData.hash;
-        _backgroundImageTexture =
-            createAndUploadImage(QSize(unbox<int>(imageData.size.width), unbox<int>(imageData.size.height)),
-                                 imageData.format,
-                                 imageData.rowAlignment,
-                                 imageData.pixels.data());
+        _renderStateCache.backgroundResolution =
+            QSize(unbox<int>(imageData.size.width), unbox<int>(imageData.size.height));
+        _backgroundImageTexture = createAndUploadImage(_renderStateCache.backgroundResolution,
+                                                       imageData.format,
+                                                       imageData.rowAlignment,
+                                                       imageData.pixels.data());
+        _backgroundImageBlurPending = backgroundImage.blur;
     }
 }
 
+void OpenGLRenderer::uploadBackgroundImageFile()
+{
+    _backgroundImageUploadPending = false;
+
+    // Waits for the image to be decoded, if it still is.
+    auto const& file = *_backgroundImageFile;
+    auto const& qImage = file.image.get();
+    if (qImage.format() != QImage::Format_RGBA8888)
+    {
+        errorlog()("Unsupported image format {} for background image at {}.",
+                   static_cast<int>(qImage.format()),
+                   file.path.string());
+        return;
+    }
+
+    auto const imageFormat = terminal::ImageFormat::RGBA;
+    auto const rowAlignment = 4; // This is default. Can it be any different?
+    DisplayLog()("Background image from disk: {}x{} {}", qImage.width(), qImage.height(), imageFormat);
+    _renderStateCache.backgroundResolution = qImage.size();
+    _backgroundImageTexture =
+        createAndUploadImage(qImage.size(), imageFormat, rowAlignment, qImage.constBits());
+    _backgroundImageBlurPending = _renderStateCache.backgroundImageBlur;
+}
+
 GLuint OpenGLRenderer::createAndUploadImage(QSize imageSize,
                                             terminal::ImageFormat format,
                                             int rowAlignment,
@@ -969,13 +1723,74 @@ GLuint OpenGLRenderer::createAndUploadImage(QSize imageSize,
     return textureId;
 }
 
+void OpenGLRenderer::blurBackgroundImage()
+{
+    // Renders the blurred background image into a texture of the same size, which then replaces it,
+    // such that the image never has to leave the GPU, and blurring costs nothing per frame.
+    _backgroundImageBlurPending = false;
+
+    if (!_blurShader)
+        _blurShader = sharedShader(builtinShaderConfig(ShaderClass::BlurGaussian));
+    if (!_blurShader)
+        return;
+
+    auto const imageSize = _renderStateCache.backgroundResolution;
+    DisplayLog()("Blurring background image: {}x{}", imageSize.width(), imageSize.height());
+
+    auto const blurredTexture = createAndUploadImage(imageSize, terminal::ImageFormat::RGBA, 4, nullptr);
+
+    auto framebuffer = GLuint {};
+    auto previousFramebuffer = GLint {};
+    auto previousViewport = array<GLint, 4> {};
+    CHECKED_GL(glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer));
+    CHECKED_GL(glGetIntegerv(GL_VIEWPORT, previousViewport.data()));
+    CHECKED_GL(glGenFramebuffers(1, &framebuffer));
+    CHECKED_GL(glBindFramebuffer(GL_FRAMEBUFFER, framebuffer));
+    CHECKED_GL(
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, blurredTexture, 0));
+
+    auto const complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    if (complete)
+    {
+
+        auto const resolution = QVector2D(float(imageSize.width()), float(imageSize.height()));
+        CHECKED_GL(glDisable(GL_BLEND));
+        CHECKED_GL(glViewport(0, 0, imageSize.width(), imageSize.height()));
+        bound(*_blurShader, [&]() {
+            _blurShader->setUniformValue("u_texture", 0); // GL_TEXTURE0
+            _blurShader->setUniformValue("u_textureResolution", resolution);
+            _blurShader->setUniformValue("u_viewportResolution", resolution);
+
+            CHECKED_GL(glActiveTexture(GL_TEXTURE0));
+            CHECKED_GL(bindTexture(_backgroundImageTexture));
+            CHECKED_GL(glBindVertexArray(_backgroundVAO));
+            CHECKED_GL(glDrawArrays(GL_TRIANGLE_STRIP, 0, 4));
+            CHECKED_GL(glBindVertexArray(0));
+        });
+        CHECKED_GL(glEnable(GL_BLEND));
+    }
+    else
+        errorlog()("Cannot blur background image. Framebuffer is incomplete.");
+
+    CHECKED_GL(glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(previousFramebuffer)));
+    CHECKED_GL(glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]));
+    CHECKED_GL(glDeleteFramebuffers(1, &framebuffer));
+
+    if (!complete)
+    {
+        CHECKED_GL(glDeleteTextures(1, &blurredTexture));
+        return;
+    }
+
+    CHECKED_GL(glDeleteTextures(1, &_backgroundImageTexture));
+    _backgroundImageTexture = blurredTexture;
+    _currentTextureId = std::numeric_limits<GLuint>::max();
+}
+
 void OpenGLRenderer::executeRenderBackground(float timeValue)
 {
     Require(_backgroundImageTexture != 0);
 
-    auto const w = unbox<float>(_renderTargetSize.width);
-    auto const h = unbox<float>(_renderTargetSize.height);
-
     // {{{ setup uniforms
     // clang-format off
     auto const opacity = float(_renderStateCache.backgroundColor.alpha()) / 255.0f * _renderStateCache.backgroundImageOpacity;
@@ -984,7 +1799,7 @@ void OpenGLRenderer::executeRenderBackground(float timeValue)
     // NOTE: We currently hard disable the live shader ability, as most people
     // won't have a top-end graphics card to still deliver great performance
     // when wanting an awesome blurred image at the same time.
-    // Blur is now implemented offscreen via Blur::blurDualKawase().
+    // Blur is now applied once upon upload via blurBackgroundImage().
     // clang-format on
 
     _backgroundShader->setUniformValue(_backgroundUniformLocations.projection, _projectionMatrix);
@@ -996,28 +1811,11 @@ void OpenGLRenderer::executeRenderBackground(float timeValue)
     _backgroundShader->setUniformValue(_backgroundUniformLocations.time, timeValue);
     // }}}
 
-    // clang-format off
-    auto vertices = array {
-        // triangle 1
-        BackgroundShaderParams{vec3{ 0.0f, 0.0f, 0.0f }, vec2 { 0.0f, 1.0f } }, // bottom left
-        BackgroundShaderParams{vec3{    w, 0.0f, 0.0f }, vec2 { 1.0f, 1.0f } }, // bottom right
-        BackgroundShaderParams{vec3{    w,    h, 0.0f }, vec2 { 1.0f, 0.0f } }, // top right
-        // riangle 2
-        BackgroundShaderParams{vec3{    w,    h, 0.0f }, vec2 { 1.0f, 0.0f } }, // top right
-        BackgroundShaderParams{vec3{    0,    h, 0.0f }, vec2 { 0.0f, 0.0f } }, // top left
-        BackgroundShaderParams{vec3{ 0.0f,    0, 0.0f }, vec2 { 0.0f, 1.0f } }, // bottom left
-    };
-
     CHECKED_GL(glActiveTexture(GL_TEXTURE0));
     CHECKED_GL(bindTexture(_backgroundImageTexture));
     CHECKED_GL(glBindVertexArray(_backgroundVAO));
-    CHECKED_GL(glBindBuffer(GL_ARRAY_BUFFER, _backgroundVBO));
-
-    CHECKED_GL(glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(BackgroundShaderParams), vertices.data(), GL_STREAM_DRAW));
-
-    auto constexpr ElementCount = sizeof(BackgroundShaderParams) / sizeof(float);
-    CHECKED_GL(glDrawArrays(GL_TRIANGLES, 0, 6 * ElementCount));
-    // clang-format on
+    CHECKED_GL(glDrawArrays(GL_TRIANGLE_STRIP, 0, 4));
+    CHECKED_GL(glBindVertexArray(0));
 }
 // }}}
 
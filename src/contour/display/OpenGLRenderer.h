@@ -20,6 +20,8 @@
 #include <terminal_renderer/RenderTarget.h>
 #include <terminal_renderer/TextureAtlas.h>
 
+#include <crispy/LatencyHistogram.h>
+
 #include <QtGui/QMatrix4x4>
 #include <QtGui/QOpenGLExtraFunctions>
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
@@ -28,14 +30,17 @@
     #include <QtGui/QOpenGLShaderProgram>
 #endif
 
+#include <array>
 #include <chrono>
 #include <memory>
 #include <optional>
 #include <unordered_map>
+#include <vector>
 
 namespace contour::display
 {
 
+struct BackgroundImageFile;
 struct ShaderConfig;
 
 class OpenGLRenderer final:
@@ -52,6 +57,7 @@ class OpenGLRenderer final:
     using ConfigureAtlas = terminal::renderer::atlas::ConfigureAtlas;
     using UploadTile = terminal::renderer::atlas::UploadTile;
     using RenderTile = terminal::renderer::atlas::RenderTile;
+    using UploadImage = terminal::renderer::atlas::UploadImage;
 
   public:
     /**
@@ -74,6 +80,8 @@ class OpenGLRenderer final:
     void configureAtlas(ConfigureAtlas atlas) override;
     void uploadTile(UploadTile tile) override;
     void renderTile(RenderTile tile) override;
+    void uploadImage(UploadImage image) override;
+    void destroyImage(uint32_t imageTextureId) override;
 
     // RenderTarget implementation
     void setRenderSize(crispy::ImageSize _size) override;
@@ -84,15 +92,33 @@ class OpenGLRenderer final:
     void setBackgroundImage(
         std::shared_ptr<terminal::BackgroundImage const> const& _backgroundImage) override;
     void renderRectangle(int x, int y, Width, Height, RGBAColor color) override;
+    void renderCellBackgrounds(terminal::renderer::CellBackgroundGrid const& _grid) override;
+    void renderBoxDrawing(
+        int x, int y, ImageSize _cellSize, int _lineThickness, uint32_t _shape, RGBAColor _color) override;
     void clear(terminal::RGBAColor _fillColor) override;
+    [[nodiscard]] bool preservesContents() const noexcept override;
+    void setDamage(std::vector<terminal::renderer::DamagedArea> _areas) override;
+    [[nodiscard]] bool scrollContents(terminal::renderer::DamagedArea _area, int _offset) override;
     void execute() override;
 
-    std::pair<crispy::ImageSize, std::vector<uint8_t>> takeScreenshot();
+    /// Declares whether the surface being rendered to keeps its contents between frames,
+    /// which enables rendering only the damaged areas of a frame.
+    void setPreservingContents(bool _value) noexcept { _preservingContents = _value; }
+
+    /// Tests whether screenshots are still being read back from the GPU, which requires further frames
+    /// to be executed for them to complete.
+    [[nodiscard]] bool hasPendingScreenshots() const noexcept
+    {
+        return _pendingScreenshotCallback.has_value() || !_screenshotReadbacks.empty();
+    }
 
     void clearCache() override;
 
     void inspect(std::ostream& output) const override;
 
+    /// GPU time spent executing the frames, if the OpenGL implementation supports timer queries.
+    [[nodiscard]] crispy::LatencyHistogram const& gpuTime() const noexcept { return _gpuTime; }
+
     void setTime(std::chrono::steady_clock::time_point value) { _now = value; }
 
     float uptime() noexcept
@@ -110,62 +136,207 @@ class OpenGLRenderer final:
     void initializeBackgroundRendering();
     void initializeTextureRendering();
     void initializeRectRendering();
+    void initializeBoxDrawingRendering();
     int maxTextureDepth();
     int maxTextureSize();
     int maxTextureUnits();
     crispy::ImageSize renderBufferSize();
+    void beginTimerQuery();
+    void endTimerQuery();
 
     GLuint createAndUploadImage(QSize imageSize,
                                 terminal::ImageFormat format,
                                 int rowAlignment,
                                 uint8_t const* pixels);
 
+    void uploadBackgroundImageFile();
+    void blurBackgroundImage();
     void executeRenderBackground(float timeValue);
-    void executeRenderTextures();
+    void executeUploadTextures();
+    void executeRenderRectangles(float timeValue, GLsizei count);
+    void executeRenderBoxDrawing(GLsizei count);
+    void executeRenderTextures(float timeValue);
+    void executeUploadCellGrid();
+    void executeRenderCellGrid();
     void executeConfigureAtlas(ConfigureAtlas const& _param);
-    void executeUploadTile(UploadTile const& _param);
+    void executeUploadTiles();
     void executeRenderTile(RenderTile const& _param);
-    void executeDestroyAtlas();
+    void executeDestroyAtlas(terminal::renderer::atlas::Format _format);
+    void executeUploadImage(UploadImage const& _param);
+    void executeDestroyImage(uint32_t _imageTextureId);
+    void executeScrollContents(terminal::renderer::DamagedArea const& _area, int _offset);
 
     //? void renderRectangle(int _x, int _y, int _width, int _height, QVector4D const& _color);
 
     void bindTexture(GLuint _textureId);
 
+    // {{{ vertex streaming
+    struct VertexAttribute
+    {
+        GLuint index;
+        GLint size;
+        GLenum type;
+        GLboolean normalized;
+        size_t offset;
+    };
+
+    /// A filled rectangle, expanded into a quad by the vertex shader.
+    struct RectInstance
+    {
+        int16_t x;
+        int16_t y;
+        int16_t width;
+        int16_t height;
+        std::array<uint8_t, 4> color;
+    };
+    static_assert(sizeof(RectInstance) == 12);
+
+    /// A box drawing character filling a grid cell, whose shape is evaluated by the fragment shader.
+    struct BoxInstance
+    {
+        int16_t x;
+        int16_t y;
+        int16_t width;
+        int16_t height;
+        std::array<uint8_t, 4> color;
+        std::array<uint16_t, 2> shape; // lower and upper 16 bits, see BOX_SHAPE_* in shared_defines.h
+        uint16_t lineThickness;
+        uint16_t reserved;
+    };
+    static_assert(sizeof(BoxInstance) == 20);
+
+    /// A texture atlas tile, expanded into a quad by the vertex shader.
+    struct TileInstance
+    {
+        int16_t x;
+        int16_t y;
+        int16_t width;
+        int16_t height;
+        std::array<uint16_t, 4> textureCoords; // normalized x, y, width, height
+        std::array<uint8_t, 4> color;
+        uint8_t selector; // RenderTile::fragmentShaderSelector
+        uint8_t texture;  // texture to render from, see TEXT_TEXTURE_* in shared_defines.h
+        uint16_t page;    // texture atlas page, i.e. the layer of the array texture
+    };
+    static_assert(sizeof(TileInstance) == 24);
+
+    /// Buffer of per-instance vertex attributes that is written to once per frame.
+    ///
+    /// The buffer is split into one region per frame in flight, such that writing the instances of
+    /// the next frame never has to wait for the GPU to finish drawing a previous one.
+    /// If supported, the buffer is persistently mapped, so that instances are copied into it directly.
+    struct VertexStream
+    {
+        static constexpr size_t RegionCount = 3;
+
+        GLsizei stride = 0;
+        std::vector<VertexAttribute> attributes {};
+
+        GLuint vao {};
+        GLuint vbo {};
+        size_t regionSize = 0; // in bytes, a multiple of stride
+        size_t currentRegion = 0;
+        void* mapping = nullptr;
+        std::array<GLsync, RegionCount> fences {};
+    };
+
+    void initializeVertexStream(VertexStream& _stream);
+    void reserveVertexStream(VertexStream& _stream, size_t _size);
+    void streamVertices(VertexStream& _stream, void const* _data, size_t _size);
+    void pointVertexStream(VertexStream& _stream, size_t _firstInstance);
+    void fenceVertexStream(VertexStream& _stream);
+    void destroyVertexStream(VertexStream& _stream);
+    // }}}
+
     // -------------------------------------------------------------------------------------------
     // private data members
     //
 
     // {{{ scheduling data
+    static constexpr size_t AtlasCount = terminal::renderer::atlas::AtlasFormats.size();
+
+    /// Tiles of all texture atlases, rendered with a single draw call in the order they were
+    /// scheduled in, as the text shader samples each from the atlas it refers to.
     struct RenderBatch
     {
-        std::vector<terminal::renderer::atlas::RenderTile> renderTiles;
-        std::vector<GLfloat> buffer;
-        uint32_t userdata = 0;
+        std::vector<TileInstance> instances;
+
+        void clear() { instances.clear(); }
+    };
+
+    /// Consecutive instances of the image batch that are rendered from the same image texture.
+    struct ImageDraw
+    {
+        GLuint textureId;
+        size_t first;
+        GLsizei count;
+    };
+
+    struct ImageBatch
+    {
+        std::vector<std::pair<uint32_t, TileInstance>> tiles; // image texture ID and instance
+        std::vector<TileInstance> instances;                  // tiles, grouped by image texture
+        std::vector<ImageDraw> draws;
 
         void clear()
         {
-            renderTiles.clear();
-            buffer.clear();
+            tiles.clear();
+            instances.clear();
+            draws.clear();
         }
     };
 
+    struct CellGridBatch
+    {
+        bool scheduled = false;
+        int x = 0;
+        int y = 0;
+        ImageSize cellSize {};
+        terminal::PageSize pageSize {};
+        std::vector<uint8_t> colors {}; // RGBA, one texel per cell
+    };
+
     struct Scheduler
     {
-        std::optional<terminal::renderer::atlas::ConfigureAtlas> configureAtlas = std::nullopt;
+        std::array<std::optional<terminal::renderer::atlas::ConfigureAtlas>, AtlasCount> configureAtlas {};
         std::vector<terminal::renderer::atlas::UploadTile> uploadTiles {};
+        std::vector<uint32_t> destroyImages {};
+        std::vector<terminal::renderer::atlas::UploadImage> uploadImages {};
         RenderBatch renderBatch {};
+        ImageBatch imageBatch {};
+        CellGridBatch cellGrid {};
 
         void clear()
         {
-            configureAtlas.reset();
+            for (auto& configure: configureAtlas)
+                configure.reset();
             uploadTiles.clear();
+            destroyImages.clear();
+            uploadImages.clear();
             renderBatch.clear();
+            imageBatch.clear();
+            cellGrid.scheduled = false;
         }
     };
 
     Scheduler _scheduledExecutions;
     // }}}
 
+    // {{{ GPU timing
+    struct TimerQuery
+    {
+        GLuint id = 0;
+        bool pending = false; //!< whether the query's result has not been collected yet
+    };
+    // Results become available a few frames later, so that many queries are kept in flight.
+    static constexpr size_t TimerQueryCount = 3;
+    std::array<TimerQuery, TimerQueryCount> _timerQueries {};
+    size_t _timerQueryIndex = 0;     //!< query to measure the next frame with
+    bool _timerQueriesSupported = false;
+    bool _timerQueryActive = false;  //!< whether the current frame is being measured
+    crispy::LatencyHistogram _gpuTime;
+    // }}}
+
     bool _initialized = false;
     std::chrono::steady_clock::time_point _startTime;
     std::chrono::steady_clock::time_point _now;
@@ -174,24 +345,23 @@ class OpenGLRenderer final:
 
     terminal::renderer::PageMargin _margin {};
 
-    std::unique_ptr<QOpenGLShaderProgram> _textShader;
+    std::shared_ptr<QOpenGLShaderProgram> _textShader;
     int _textProjectionLocation;
     int _textTimeLocation;
+    int _textPixelXLocation = -1;
 
     // private data members for rendering textures
     //
-    GLuint _textVAO {}; // Vertex Array Object, covering all buffer objects
-    GLuint _textVBO {}; // Buffer containing the vertex coordinates
+    VertexStream _textStream;
     // TODO: GLuint ebo_{};
 
     // currently bound texture ID during execution
     GLuint _currentTextureId = std::numeric_limits<GLuint>::max();
 
     // background / background-image related fields
-    GLuint _backgroundVAO {};
-    GLuint _backgroundVBO {};
+    GLuint _backgroundVAO {}; // without any attributes, as the quad is derived from gl_VertexID
     GLuint _backgroundImageTexture {};
-    std::unique_ptr<QOpenGLShaderProgram> _backgroundShader;
+    std::shared_ptr<QOpenGLShaderProgram> _backgroundShader;
     struct
     {
         int projection;
@@ -202,25 +372,113 @@ class OpenGLRenderer final:
         int time;
     } _backgroundUniformLocations {};
 
-    // index equals AtlasID
+    // Background image file, shared with all other renderers showing the same one.
+    std::shared_ptr<BackgroundImageFile> _backgroundImageFile;
+    bool _backgroundImageUploadPending = false;
+
+    // The background image is blurred once on the GPU, replacing its texture, upon the next frame.
+    std::shared_ptr<QOpenGLShaderProgram> _blurShader;
+    bool _backgroundImageBlurPending = false;
+
     struct AtlasAttributes
     {
-        GLuint textureId {};
+        GLuint textureId {}; // GL_TEXTURE_2D_ARRAY with one layer per atlas page
         ImageSize textureSize {};
         terminal::renderer::atlas::AtlasProperties properties {};
+
+        // The configuration the texture has been allocated with on the GPU (zero pages if none).
+        terminal::renderer::atlas::ConfigureAtlas allocated { {}, {}, {}, 0 };
     };
-    AtlasAttributes _textureAtlas {};
+    // One texture atlas per tile format, indexed by atlas::format_index().
+    std::array<AtlasAttributes, AtlasCount> _textureAtlases {};
+
+    // Images uploaded into textures of their own, by image texture ID.
+    // Each is a GL_TEXTURE_2D_ARRAY of one layer, such that the text shader can render from it.
+    std::unordered_map<uint32_t, GLuint> _imageTextures;
+    VertexStream _imageStream;
 
     // private data members for rendering filled rectangles
     //
-    std::vector<GLfloat> _rectBuffer;
-    std::unique_ptr<QOpenGLShaderProgram> _rectShader;
+    std::vector<RectInstance> _rectBuffer;
+    std::shared_ptr<QOpenGLShaderProgram> _rectShader;
     int _rectProjectionLocation;
     int _rectTimeLocation;
-    GLuint _rectVAO {};
-    GLuint _rectVBO {};
+    VertexStream _rectStream;
+
+    // private data members for rendering box drawing characters procedurally
+    //
+    std::vector<BoxInstance> _boxBuffer;
+    std::shared_ptr<QOpenGLShaderProgram> _boxShader;
+    int _boxProjectionLocation;
+    VertexStream _boxStream;
+
+    // private data members for rendering cell backgrounds from a grid of colors
+    //
+    std::shared_ptr<QOpenGLShaderProgram> _cellGridShader;
+    struct
+    {
+        int projection;
+        int rect;
+        int cellSize;
+    } _cellGridUniformLocations {};
+    GLuint _cellGridVAO {}; // without any attributes, as the quad is derived from gl_VertexID
+    GLuint _cellGridTexture {};
+    terminal::PageSize _cellGridTextureSize {};
+
+    // glBufferStorage(), if GL_ARB_buffer_storage or GL_EXT_buffer_storage is available.
+    using BufferStorageFunction = void(QOPENGLF_APIENTRY*)(GLenum, GLsizeiptr, void const*, GLbitfield);
+    BufferStorageFunction _bufferStorage = nullptr;
+
+    // {{{ batched tile uploads
+    /// Horizontally adjacent tiles of the same atlas row, uploaded into the atlas with a single call.
+    struct TileBand
+    {
+        terminal::renderer::atlas::TileLocation location;                // of the leftmost tile
+        std::vector<terminal::renderer::atlas::UploadTile const*> tiles; // from left to right
+    };
+
+    /// Maximum number of bytes staged at once in the tile upload buffer.
+    ///
+    /// Bands beyond that are staged and uploaded once the previous ones have been.
+    static constexpr size_t TileUploadBudget = 4 * 1024 * 1024;
+
+    GLuint _tileUploadBuffer {};             // GL_PIXEL_UNPACK_BUFFER the bands are uploaded from
+    std::vector<uint8_t> _tileUploadStaging; // bands to be copied into the tile upload buffer
+    std::vector<TileBand> _tileBands;
+    // }}}
+
+    // {{{ asynchronous screenshot readback
+    /// A screenshot being read back into a pixel buffer object, completed once its fence is signaled.
+    struct ScreenshotReadback
+    {
+        ScreenshotCallback callback;
+        ImageSize size;
+        GLuint pbo {};
+        GLsync fence {};
+        int framesWaited = 0;
+    };
+
+    /// Number of frames after which a screenshot readback is waited for, if not completed by then.
+    static constexpr int MaxScreenshotReadbackFrames = 2;
+
+    void beginScreenshotReadback(ScreenshotCallback _callback);
+    void completeScreenshotReadbacks();
+    void destroyScreenshotReadback(ScreenshotReadback& _readback);
 
     std::optional<ScreenshotCallback> _pendingScreenshotCallback;
+    std::vector<ScreenshotReadback> _screenshotReadbacks;
+    // }}}
+
+    // {{{ partial redraw state
+    bool _preservingContents = false; // whether the surface keeps its contents between frames
+    bool _contentsValid = false;      // whether the surface holds the previously rendered frame
+    bool _clearPending = false;
+    std::optional<std::vector<terminal::renderer::DamagedArea>> _damage;
+    std::optional<std::pair<terminal::renderer::DamagedArea, int>> _contentScroll; // area and offset
+    GLuint _scrollFramebuffer {}; // holds the moved contents, as they cannot be blitted in place
+    GLuint _scrollTexture {};
+    ImageSize _scrollTextureSize {};
+    // }}}
 
     // render state cache
     struct
@@ -0,0 +1,234 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <contour/display/OpenGLRenderer.h>
+#include <contour/display/RenderBenchmark.h>
+#include <contour/display/ShaderConfig.h>
+#include <contour/helper.h>
+
+#include <terminal/MockTerm.h>
+#include <terminal/pty/MockViewPty.h>
+
+#include <terminal_renderer/Renderer.h>
+
+#include <crispy/LatencyHistogram.h>
+
+#include <fmt/format.h>
+
+#include <QtGui/QImage>
+#include <QtGui/QOffscreenSurface>
+#include <QtGui/QOpenGLContext>
+#include <QtGui/QOpenGLFunctions>
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    #include <QtOpenGL/QOpenGLFramebufferObject>
+#else
+    #include <QtGui/QOpenGLFramebufferObject>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <numeric>
+#include <string_view>
+#include <vector>
+
+// Defined in TerminalWidget.cpp, must be called from the global namespace.
+void initializeResourcesForContourFrontendOpenGL();
+
+using std::chrono::duration;
+using std::chrono::steady_clock;
+
+using terminal::ImageSize;
+using terminal::PtyRecordingChunk;
+using terminal::RGBAColor;
+
+namespace contour::display
+{
+
+namespace
+{
+    using Milliseconds = duration<double, std::milli>;
+
+    /// Prints the mean and percentiles of the given frame times.
+    void printFrameTimes(std::string_view _name, std::vector<Milliseconds> _times)
+    {
+        if (_times.empty())
+            return;
+
+        std::sort(_times.begin(), _times.end());
+        auto const at = [&](double _fraction) {
+            return _times[static_cast<size_t>(_fraction * static_cast<double>(_times.size() - 1) + 0.5)];
+        };
+        auto const mean = std::accumulate(_times.begin(), _times.end(), Milliseconds {}) / _times.size();
+        fmt::print("{:<20} mean {:.3f} p50 {:.3f} p90 {:.3f} p99 {:.3f} max {:.3f} ms\n",
+                   _name,
+                   mean.count(),
+                   at(0.5).count(),
+                   at(0.9).count(),
+                   at(0.99).count(),
+                   _times.back().count());
+    }
+
+    std::unique_ptr<QOpenGLFramebufferObject> createFramebuffer(ImageSize _size)
+    {
+        return std::make_unique<QOpenGLFramebufferObject>(
+            _size.width.as<int>(), _size.height.as<int>(), QOpenGLFramebufferObject::CombinedDepthStencil);
+    }
+} // namespace
+
+int benchmarkRender(config::Config const& _config,
+                    config::TerminalProfile const& _profile,
+                    terminal::PtyRecording const& _recording,
+                    RenderBenchmarkSettings const& _settings)
+{
+    initializeResourcesForContourFrontendOpenGL();
+
+    auto surface = QOffscreenSurface();
+    surface.setFormat(createSurfaceFormat());
+    surface.create();
+
+    auto context = QOpenGLContext();
+    context.setFormat(surface.format());
+    if (!context.create() || !context.makeCurrent(&surface))
+    {
+        fmt::print(stderr, "Failed to create an offscreen OpenGL context.\n");
+        return EXIT_FAILURE;
+    }
+
+    auto constexpr MaxHistoryLineCount = terminal::LineCount(1000);
+    using BenchTerminal = terminal::MockTerm<terminal::MockViewPty>;
+    auto vt = BenchTerminal(_recording.pageSize, MaxHistoryLineCount, _config.ptyReadBufferSize);
+    vt.terminal.colorPalette() = _profile.colors;
+    vt.terminal.defaultColorPalette() = _profile.colors;
+    auto& pty = vt.mockPty();
+
+    auto renderer = terminal::renderer::Renderer(_recording.pageSize,
+                                                 sanitizeFontDescription(_profile.fonts, _settings.dpi),
+                                                 _profile.colors,
+                                                 _profile.backgroundOpacity,
+                                                 _config.textureAtlasHashtableSlots,
+                                                 _config.textureAtlasTileCount,
+                                                 _config.textureAtlasPageLimit,
+                                                 _config.textureAtlasDirectMapping,
+                                                 _config.cellBackgroundGrid,
+                                                 _profile.hyperlinkDecoration.normal,
+                                                 _profile.hyperlinkDecoration.hover);
+    renderer.setAsyncRasterization(_config.glyphRasterizerThreads, _config.glyphUploadBudget);
+    renderer.setParallelShaping(_config.textShapingThreads);
+    renderer.setImageTextureBudget(size_t { _config.imageTextureBudget } << 20);
+    renderer.setProceduralBoxDrawing(_config.proceduralBoxDrawing);
+
+    auto pixelSize = renderer.cellSize() * _recording.pageSize;
+    auto framebuffer = createFramebuffer(pixelSize);
+    framebuffer->bind();
+
+    auto renderTarget =
+        OpenGLRenderer(_profile.textShader.value_or(builtinShaderConfig(ShaderClass::Text)),
+                       _profile.backgroundShader.value_or(builtinShaderConfig(ShaderClass::Background)),
+                       _profile.backgroundImageShader.value_or(
+                           builtinShaderConfig(ShaderClass::BackgroundImage)),
+                       pixelSize,
+                       renderer.cellSize(),
+                       terminal::renderer::PageMargin {});
+    // Framebuffer objects keep their contents, like the widget's partially updated surface does.
+    renderTarget.setPreservingContents(true);
+    renderer.setRenderTarget(renderTarget);
+
+    auto* gl = context.functions();
+    auto cpuTimes = std::vector<Milliseconds> {};
+    auto frameTimes = std::vector<Milliseconds> {};
+    auto frameCount = 0u;
+
+    auto const renderFrame = [&]() {
+        auto const startTime = steady_clock::now();
+        renderTarget.setTime(startTime);
+        renderTarget.clear(
+            RGBAColor(_profile.colors.defaultBackground, uint8_t(renderer.backgroundOpacity())));
+        renderer.render(vt.terminal, false);
+        auto const renderedTime = steady_clock::now();
+
+        // Waits for the GPU, as swapping the buffers of a window would, such that the time
+        // of a frame includes executing it and the timer queries' results are available.
+        gl->glFinish();
+        auto const finishedTime = steady_clock::now();
+
+        cpuTimes.emplace_back(renderedTime - startTime);
+        frameTimes.emplace_back(finishedTime - startTime);
+        ++frameCount;
+
+        if (_settings.dumpDirectory)
+            framebuffer->toImage().save(QString::fromStdString(
+                (*_settings.dumpDirectory / fmt::format("frame-{:05}.png", frameCount)).string()));
+    };
+
+    auto const frameLimit = _settings.frames;
+    auto const benchmarkStartTime = steady_clock::now();
+    do
+    {
+        for (auto const& chunk: _recording.chunks)
+        {
+            if (frameLimit && frameCount >= frameLimit)
+                break;
+
+            switch (chunk.type)
+            {
+                case PtyRecordingChunk::Type::Output:
+                    if (chunk.data.empty())
+                        continue;
+                    pty.setReadData(chunk.data);
+                    do
+                        vt.terminal.processInputOnce();
+                    while (!pty.isClosed() && !pty.stdoutBuffer().empty());
+                    break;
+                case PtyRecordingChunk::Type::Resize:
+                    vt.terminal.resizeScreen(chunk.pageSize);
+                    pixelSize = renderer.cellSize() * chunk.pageSize;
+                    renderTarget.setRenderSize(pixelSize);
+                    framebuffer = createFramebuffer(pixelSize);
+                    framebuffer->bind();
+                    continue;
+            }
+
+            vt.terminal.refreshRenderBuffer();
+            renderFrame();
+        }
+    } while (frameLimit && frameCount && frameCount < frameLimit);
+    auto const wallClockTime = duration<double>(steady_clock::now() - benchmarkStartTime);
+
+    fmt::print("Rendered {} frames of {} pixels using {} in {:.3f} s.\n\n",
+               frameCount,
+               pixelSize,
+               reinterpret_cast<char const*>(gl->glGetString(GL_RENDERER)),
+               wallClockTime.count());
+
+    printFrameTimes("CPU", cpuTimes);
+    printFrameTimes("CPU + GPU", frameTimes);
+
+    auto const add = [](std::string_view _name, crispy::LatencyHistogram const& _histogram) {
+        fmt::print("{:<20} {}\n", _name, _histogram.summary());
+    };
+    fmt::print("\nLast {} frames:\n", crispy::LatencyHistogram::Capacity);
+    auto const& frame = renderer.frameStats();
+    add("  cells", frame.cells);
+    add("  text", frame.text);
+    add("  images", frame.image);
+    add("  backgrounds", frame.background);
+    add("  cursor", frame.cursor);
+    add("  execute", frame.execute);
+    add("GPU", renderTarget.gpuTime());
+
+    return EXIT_SUCCESS;
+}
+
+} // namespace contour::display
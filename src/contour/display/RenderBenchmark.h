@@ -0,0 +1,53 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <contour/Config.h>
+
+#include <terminal/PtyRecording.h>
+
+#include <text_shaper/font.h>
+
+#include <crispy/stdfs.h>
+
+#include <optional>
+
+namespace contour::display
+{
+
+struct RenderBenchmarkSettings
+{
+    /// Number of frames to render, replaying the recording as often as needed,
+    /// or 0 for rendering one frame per chunk of the recording's output.
+    unsigned frames = 0;
+
+    /// DPI to rasterize the fonts with, as there is no screen to take it from.
+    text::DPI dpi { 96, 96 };
+
+    /// Directory to save every rendered frame to as PNG image, e.g. for diffing them visually.
+    std::optional<FileSystem::path> dumpDirectory;
+};
+
+/// Replays the PTY recording into a terminal and renders it into an offscreen OpenGL surface,
+/// reporting the CPU and GPU time per frame to standard output.
+///
+/// This requires a QGuiApplication, but neither a window nor a window manager.
+///
+/// @returns the process exit code.
+int benchmarkRender(config::Config const& _config,
+                    config::TerminalProfile const& _profile,
+                    terminal::PtyRecording const& _recording,
+                    RenderBenchmarkSettings const& _settings);
+
+} // namespace contour::display
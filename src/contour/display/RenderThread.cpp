@@ -0,0 +1,135 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <contour/display/RenderThread.h>
+
+#include <QtCore/QMetaObject>
+#include <QtGui/QOpenGLContext>
+
+namespace contour::display
+{
+
+RenderThread::RenderThread(QOpenGLWidget& widget, std::function<void()> renderFrame):
+    widget_ { widget }, renderFrame_ { std::move(renderFrame) }, guiThread_ { widget.thread() }
+{
+    // Composing the widget into the window reads its framebuffer, and resizing recreates it.
+    connections_ = {
+        QObject::connect(&widget_, &QOpenGLWidget::aboutToCompose, [this]() { lock(); }),
+        QObject::connect(&widget_, &QOpenGLWidget::frameSwapped, [this]() { unlock(); }),
+        QObject::connect(&widget_, &QOpenGLWidget::aboutToResize, [this]() { lock(); }),
+        QObject::connect(&widget_,
+                         &QOpenGLWidget::resized,
+                         [this]() {
+                             unlock();
+                             requestFrame();
+                         }),
+    };
+
+    thread_ = std::thread([this]() { run(); });
+}
+
+RenderThread::~RenderThread()
+{
+    stop();
+}
+
+void RenderThread::requestFrame()
+{
+    auto const _ = std::lock_guard { mutex_ };
+    framePending_ = true;
+    condition_.notify_one();
+}
+
+void RenderThread::stop()
+{
+    if (!thread_.joinable())
+        return;
+
+    {
+        auto const _ = std::lock_guard { mutex_ };
+        exiting_ = true;
+        condition_.notify_one();
+    }
+    thread_.join();
+
+    for (auto const& connection: connections_)
+        QObject::disconnect(connection);
+}
+
+void RenderThread::lock()
+{
+    // The context is on its way to or back from the render thread while not holding the lock.
+    for (;;)
+    {
+        renderLock_.lock();
+        auto const* context = widget_.context();
+        if (!context || context->thread() == guiThread_)
+            return;
+        renderLock_.unlock();
+        std::this_thread::yield();
+    }
+}
+
+void RenderThread::unlock()
+{
+    renderLock_.unlock();
+}
+
+void RenderThread::run()
+{
+    renderThread_ = QThread::currentThread();
+
+    auto lock = std::unique_lock { mutex_ };
+    for (;;)
+    {
+        condition_.wait(lock, [this]() { return framePending_ || exiting_; });
+        if (exiting_)
+            break;
+        framePending_ = false;
+
+        // A context can only be pushed to another thread by the thread it lives in.
+        QMetaObject::invokeMethod(
+            &widget_, [this]() { grabContext(); }, Qt::QueuedConnection);
+        condition_.wait(lock, [this]() { return contextGrabbed_ || exiting_; });
+        if (!contextGrabbed_)
+            break;
+        contextGrabbed_ = false;
+        lock.unlock();
+
+        {
+            auto const _ = std::lock_guard { renderLock_ };
+            widget_.makeCurrent();
+            renderFrame_();
+            widget_.doneCurrent();
+            widget_.context()->moveToThread(guiThread_);
+        }
+
+        // Has the GUI thread compose the new frame into the window.
+        QMetaObject::invokeMethod(&widget_, "update", Qt::QueuedConnection);
+
+        lock.lock();
+    }
+}
+
+void RenderThread::grabContext()
+{
+    auto const _ = std::lock_guard { *this };
+    auto const _l = std::lock_guard { mutex_ };
+    if (exiting_)
+        return;
+    widget_.context()->moveToThread(renderThread_);
+    contextGrabbed_ = true;
+    condition_.notify_one();
+}
+
+} // namespace contour::display
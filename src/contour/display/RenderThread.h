@@ -0,0 +1,85 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <QtCore/QThread>
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    #include <QtOpenGLWidgets/QOpenGLWidget>
+#else
+    #include <QtWidgets/QOpenGLWidget>
+#endif
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace contour::display
+{
+
+// Renders the frames of an OpenGL widget on a thread of its own, so that rendering and the work
+// on the GUI thread (input, layout, config reloads) do not hold up each other.
+//
+// The widget's context is moved to the render thread for each frame and moved back afterwards,
+// as the GUI thread still composes the widget's framebuffer into the window and recreates it
+// on resize. The GUI thread must therefore lock this object around any access to the state
+// shared with the frame renderer, which also makes sure the context is current on the GUI thread.
+//
+// The widget must not render in its own paintEvent(), and the render thread must be stopped
+// before the widget's GL resources are released.
+class RenderThread
+{
+  public:
+    RenderThread(QOpenGLWidget& widget, std::function<void()> renderFrame);
+    ~RenderThread();
+
+    RenderThread(RenderThread const&) = delete;
+    RenderThread(RenderThread&&) = delete;
+    RenderThread& operator=(RenderThread const&) = delete;
+    RenderThread& operator=(RenderThread&&) = delete;
+
+    // Has a frame rendered as soon as possible. Requests pending at the same time result in one frame.
+    void requestFrame();
+
+    // Stops rendering, waiting for the frame currently rendered, if any.
+    void stop();
+
+    // Waits for the frame currently rendered, if any, and keeps the render thread off the widget.
+    void lock();
+    void unlock();
+
+  private:
+    void run();
+    void grabContext();
+
+    QOpenGLWidget& widget_;
+    std::function<void()> renderFrame_;
+    QThread* const guiThread_;
+    QThread* renderThread_ = nullptr;
+
+    // Held while rendering a frame and while the GUI thread works on the widget.
+    std::recursive_mutex renderLock_;
+
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    bool framePending_ = false;
+    bool contextGrabbed_ = false;
+    bool exiting_ = false;
+
+    std::vector<QMetaObject::Connection> connections_;
+    std::thread thread_;
+};
+
+} // namespace contour::display
@@ -18,6 +18,7 @@
 #include <QtGui/QOpenGLContext>
 
 #include <iostream>
+#include <map>
 #include <string>
 #include <string_view>
 #include <tuple>
@@ -111,9 +112,13 @@ std::unique_ptr<QOpenGLShaderProgram> createShader(ShaderConfig const& _shaderCo
         return { source.location.toStdString(), source.contents.toStdString() };
     };
 
+    // Cacheable shaders are compiled when linking, and only if no program binary of the very same sources
+    // has been cached for the current driver (vendor, renderer and version) yet. On a cache miss or
+    // mismatch, they are compiled and linked from source and the resulting binary is written to the
+    // user's cache directory (QStandardPaths::CacheLocation).
     auto [vertexLocation, vertexSource] = extractShaderSource(_shaderConfig.vertexShader);
     DisplayLog()("Loading vertex shader: {}", vertexLocation);
-    if (!shader->addShaderFromSourceCode(QOpenGLShader::Vertex, vertexSource.c_str()))
+    if (!shader->addCacheableShaderFromSourceCode(QOpenGLShader::Vertex, vertexSource.c_str()))
     {
         errorlog()("Compiling vertex shader {} failed. {}", vertexLocation, shader->log().toStdString());
         qDebug() << shader->log();
@@ -122,7 +127,7 @@ std::unique_ptr<QOpenGLShaderProgram> createShader(ShaderConfig const& _shaderCo
 
     auto [fragmentLocation, fragmentSource] = extractShaderSource(_shaderConfig.fragmentShader);
     DisplayLog()("Loading fragment shader: {}", fragmentLocation);
-    if (!shader->addShaderFromSourceCode(QOpenGLShader::Fragment, fragmentSource.c_str()))
+    if (!shader->addCacheableShaderFromSourceCode(QOpenGLShader::Fragment, fragmentSource.c_str()))
     {
         errorlog()("Compiling fragment shader {} failed. {}", fragmentLocation, shader->log().toStdString());
         qDebug() << shader->log();
@@ -145,4 +150,25 @@ std::unique_ptr<QOpenGLShaderProgram> createShader(ShaderConfig const& _shaderCo
     return shader;
 }
 
+std::shared_ptr<QOpenGLShaderProgram> sharedShader(ShaderConfig const& _shaderConfig)
+{
+    using Key = tuple<QOpenGLContextGroup const*, QString, QString>;
+    static auto cache = std::map<Key, std::weak_ptr<QOpenGLShaderProgram>> {};
+
+    auto const key = Key { QOpenGLContextGroup::currentContextGroup(),
+                           _shaderConfig.vertexShader.contents,
+                           _shaderConfig.fragmentShader.contents };
+    if (auto i = cache.find(key); i != cache.end())
+    {
+        if (auto shader = i->second.lock())
+            return shader;
+        cache.erase(i);
+    }
+
+    auto shader = std::shared_ptr<QOpenGLShaderProgram>(createShader(_shaderConfig));
+    if (shader)
+        cache[key] = shader;
+    return shader;
+}
+
 } // namespace contour::display
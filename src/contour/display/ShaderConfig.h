@@ -39,6 +39,9 @@ enum class ShaderClass
 {
     BackgroundImage,
     Background,
+    BlurGaussian,
+    BoxDrawing,
+    CellBackground,
     Text
 };
 
@@ -63,6 +66,9 @@ inline std::string to_string(ShaderClass _shaderClass)
     {
         case ShaderClass::BackgroundImage: return "background_image";
         case ShaderClass::Background: return "background";
+        case ShaderClass::BlurGaussian: return "blur_gaussian";
+        case ShaderClass::BoxDrawing: return "box_drawing";
+        case ShaderClass::CellBackground: return "cell_background";
         case ShaderClass::Text: return "text";
     }
 
@@ -73,4 +79,10 @@ ShaderConfig builtinShaderConfig(ShaderClass shaderClass);
 
 std::unique_ptr<QOpenGLShaderProgram> createShader(ShaderConfig const& _shaderConfig);
 
+// Returns the shader program of the given config that is shared by all contexts in the current
+// context's share group, compiling and linking it only if no other context uses it yet.
+//
+// Uniform values are program state, too, and therefore must be set by each user before drawing.
+std::shared_ptr<QOpenGLShaderProgram> sharedShader(ShaderConfig const& _shaderConfig);
+
 } // namespace contour::display
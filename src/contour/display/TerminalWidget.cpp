@@ -16,6 +16,7 @@
 #include <contour/ContourGuiApp.h>
 #include <contour/display/OpenGLRenderer.h>
 #include <contour/display/TerminalWidget.h>
+#include <contour/display/TimerWheel.h>
 #include <contour/helper.h>
 
 #include <terminal/Color.h>
@@ -23,6 +24,7 @@
 #include <terminal/pty/Pty.h>
 
 #include <crispy/App.h>
+#include <crispy/StartupTrace.h>
 #include <crispy/logstore.h>
 #include <crispy/stdfs.h>
 
@@ -41,8 +43,11 @@
 #include <QtCore/QTimer>
 #include <QtGui/QClipboard>
 #include <QtGui/QDesktopServices>
+#include <QtGui/QFontDatabase>
 #include <QtGui/QGuiApplication>
 #include <QtGui/QKeyEvent>
+#include <QtGui/QOpenGLPaintDevice>
+#include <QtGui/QPainter>
 #include <QtGui/QScreen>
 #include <QtGui/QWindow>
 #include <QtNetwork/QHostInfo>
@@ -53,6 +58,7 @@
 #include <algorithm>
 #include <cstring>
 #include <fstream>
+#include <future>
 #include <stdexcept>
 #include <string_view>
 #include <tuple>
@@ -229,6 +235,35 @@ namespace
         return nullopt;
     }
 
+    /// Formats the percentiles of the recent frame times and PTY pipeline latencies, one stage per line.
+    std::string formatFrameStats(terminal::Terminal const& _terminal,
+                                 terminal::renderer::Renderer const& _renderer,
+                                 OpenGLRenderer const& _renderTarget)
+    {
+        auto text = std::string {};
+        auto const add = [&](std::string_view _name, crispy::LatencyHistogram const& _histogram) {
+            text += fmt::format("{:<20} {}\n", _name, _histogram.summary());
+        };
+
+        auto const& pipeline = _terminal.pipelineStats();
+        add("PTY queueing", pipeline.queueing);
+        add("PTY parsing", pipeline.parsing);
+        add("render buffer", pipeline.refreshRenderBuffer);
+
+        auto const& frame = _renderer.frameStats();
+        add("frame", frame.frame);
+        add("  cells", frame.cells);
+        add("  text", frame.text);
+        add("  images", frame.image);
+        add("  backgrounds", frame.background);
+        add("  cursor", frame.cursor);
+        add("  execute", frame.execute);
+        add("GPU", _renderTarget.gpuTime());
+        add("input latency", _terminal.inputLatency());
+
+        return text;
+    }
+
 } // namespace
 // }}}
 
@@ -247,13 +282,19 @@ TerminalWidget::TerminalWidget():
     setAttribute(Qt::WA_InputMethodEnabled, true);
     setAttribute(Qt::WA_OpaquePaintEvent);
 
+    // Keep the framebuffer contents between frames, so that only damaged lines need to be rendered.
+    setUpdateBehavior(QOpenGLWidget::PartialUpdate);
+
     // setAttribute(Qt::WA_TranslucentBackground);
     // setAttribute(Qt::WA_NoSystemBackground, false);
 
-    updateTimer_.setSingleShot(true);
-    connect(&updateTimer_, &QTimer::timeout, [this]() { scheduleRedraw(); });
-
     connect(this, SIGNAL(frameSwapped()), this, SLOT(onFrameSwapped()));
+
+    // Interactive window drags emit a resize event per mouse move, whereas reflowing the grid and
+    // notifying the PTY only pays off once the window size has settled.
+    resizeTimer_.setSingleShot(true);
+    resizeTimer_.setInterval(ResizeDebounceInterval);
+    connect(&resizeTimer_, &QTimer::timeout, this, &TerminalWidget::applyPendingResize);
 }
 
 void TerminalWidget::setSession(TerminalSession& newSession)
@@ -276,11 +317,22 @@ void TerminalWidget::setSession(TerminalSession& newSession)
         newSession.profile().backgroundOpacity,
         newSession.config().textureAtlasHashtableSlots,
         newSession.config().textureAtlasTileCount,
+        newSession.config().textureAtlasPageLimit,
         newSession.config().textureAtlasDirectMapping,
+        newSession.config().cellBackgroundGrid,
         newSession.profile().hyperlinkDecoration.normal,
         newSession.profile().hyperlinkDecoration.hover
         // TODO: , WindowMargin(windowMargin_.left, windowMargin_.bottom);
     );
+    renderer_->setAsyncRasterization(newSession.config().glyphRasterizerThreads,
+                                     newSession.config().glyphUploadBudget);
+    renderer_->setParallelShaping(newSession.config().textShapingThreads);
+    renderer_->setImageTextureBudget(size_t { newSession.config().imageTextureBudget } << 20);
+    renderer_->setProceduralBoxDrawing(newSession.config().proceduralBoxDrawing);
+    if (newSession.config().glyphDiskCache)
+        renderer_->setGlyphDiskCache(
+            text::glyph_disk_cache::open(config::cacheHome() / "glyphs.bin",
+                                         uint64_t { newSession.config().glyphDiskCacheSizeLimit } << 20));
 
     auto const textureTileSize = gridMetrics().cellSize;
     auto const viewportMargin = terminal::renderer::PageMargin {}; // TODO margin
@@ -292,6 +344,7 @@ void TerminalWidget::setSession(TerminalSession& newSession)
         return uiSize * contentScale();
     }();
 
+    auto startupPhase = std::optional<crispy::StartupTrace::Scope>("Initialize OpenGL renderer");
     renderTarget_ = make_unique<OpenGLRenderer>(
         session_->profile().textShader.value_or(builtinShaderConfig(ShaderClass::Text)),
         session_->profile().backgroundShader.value_or(builtinShaderConfig(ShaderClass::Background)),
@@ -299,17 +352,27 @@ void TerminalWidget::setSession(TerminalSession& newSession)
         precalculatedVieewSize,
         textureTileSize,
         viewportMargin);
+    static_cast<OpenGLRenderer*>(renderTarget_.get())
+        ->setPreservingContents(updateBehavior() == QOpenGLWidget::PartialUpdate);
     renderer_->setRenderTarget(*renderTarget_);
+    startupPhase.reset();
 
     applyFontDPI();
     updateMinimumSize();
     updateGeometry();
 
+    if (newSession.config().renderThread)
+        renderThread_ = make_unique<RenderThread>(*this, [this]() { renderFrame(); });
+
     logDisplayTopInfo();
 }
 
 TerminalWidget::~TerminalWidget()
 {
+    TimerWheel::shared().cancel(this);
+    if (screenshotEncoding_.valid())
+        screenshotEncoding_.wait();
+    renderThread_.reset();
     makeCurrent(); // XXX must be called.
     renderTarget_.reset();
     doneCurrent();
@@ -364,17 +427,32 @@ void TerminalWidget::configureScreenHooks()
     Require(window()->windowHandle());
 
     QWindow* window = this->window()->windowHandle();
-    QScreen* screen = screenOf(this);
 
     connect(window, SIGNAL(screenChanged(QScreen*)), this, SLOT(onScreenChanged()));
-    connect(screen, SIGNAL(refreshRateChanged(qreal)), this, SLOT(onRefreshRateChanged()));
-    connect(screen, SIGNAL(logicalDotsPerInchChanged(qreal)), this, SLOT(applyFontDPI()));
+    configureCurrentScreenHooks();
+}
+
+void TerminalWidget::configureCurrentScreenHooks()
+{
+    // Only listen to the screen the window is currently shown on, so that the refresh rate
+    // (and thus the frame pacing) follows the window when it is moved to another screen.
+    if (hookedScreen_)
+        disconnect(hookedScreen_, nullptr, this, nullptr);
+
+    hookedScreen_ = screenOf(this);
+    if (!hookedScreen_)
+        return;
+
+    connect(hookedScreen_, SIGNAL(refreshRateChanged(qreal)), this, SLOT(onRefreshRateChanged()));
+    connect(hookedScreen_, SIGNAL(logicalDotsPerInchChanged(qreal)), this, SLOT(applyFontDPI()));
     // connect(screen, SIGNAL(physicalDotsPerInchChanged(qreal)), this, SLOT(applyFontDPI()));
 }
 
 void TerminalWidget::onScreenChanged()
 {
     DisplayLog()("Screen changed.");
+    configureCurrentScreenHooks();
+    onRefreshRateChanged();
     applyFontDPI();
 }
 
@@ -384,6 +462,8 @@ void TerminalWidget::applyFontDPI()
     if (newFontDPI == lastFontDPI_)
         return;
 
+    auto const _ = lockRenderer();
+
     DisplayLog()("Applying DPI {}.", newFontDPI);
     lastFontDPI_ = newFontDPI;
 
@@ -394,9 +474,7 @@ void TerminalWidget::applyFontDPI()
 
     Require(renderer_);
 
-    auto fd = renderer_->fontDescriptions();
-    fd.dpi = newFontDPI;
-    renderer_->setFonts(fd);
+    renderer_->setFontDPI(newFontDPI);
 
     session_->setContentScale(contentScale());
 
@@ -535,10 +613,58 @@ void TerminalWidget::resizeGL(int _width, int _height)
         terminal::ImageSize { Width::cast_from(_width), Height::cast_from(_height) };
     auto const newPixelSize = qtBaseWidgetSize * contentScale();
     DisplayLog()("Resizing view to {}x{} virtual ({} actual).", _width, _height, newPixelSize);
-    applyResize(newPixelSize, *session_, *renderer_);
+
+    auto const newPageSize = pageSizeForPixels(newPixelSize, renderer_->gridMetrics().cellSize);
+    if (newPageSize == terminal().pageSize() && !pendingResize_)
+    {
+        // Only the margins change, which is as cheap as a preview.
+        applyResize(newPixelSize, *session_, *renderer_);
+        return;
+    }
+
+    // Until the new size settles, the last grid is shown anchored at the top left corner of the new
+    // viewport, cropped when shrinking and padded with the background when growing.
+    renderer_->renderTarget().setRenderSize(newPixelSize);
+
+    auto const now = steady_clock::now();
+    if (!pendingResize_)
+        pendingResizeSince_ = now;
+    pendingResize_ = newPixelSize;
+
+    // Keep the grid following long drags as well, yet no more often than every ResizeMaxDelay.
+    if (now - pendingResizeSince_ >= ResizeMaxDelay)
+        applyPendingResize();
+    else
+        resizeTimer_.start();
+}
+
+void TerminalWidget::applyPendingResize()
+{
+    resizeTimer_.stop();
+
+    auto const newPixelSize = std::exchange(pendingResize_, nullopt);
+    if (!newPixelSize || !session_)
+        return;
+
+    DisplayLog()("Applying settled resize to {}.", *newPixelSize);
+    auto const _ = lockRenderer();
+    applyResize(*newPixelSize, *session_, *renderer_);
+    scheduleRedraw();
 }
 
 void TerminalWidget::paintGL()
+{
+    renderFrame();
+}
+
+void TerminalWidget::paintEvent(QPaintEvent* _event)
+{
+    // The render thread has the frame composed once rendered, instead of rendering it here.
+    if (!renderThread_)
+        QOpenGLWidget::paintEvent(_event);
+}
+
+void TerminalWidget::renderFrame()
 {
     // We consider *this* the true initial start-time.
     // That shouldn't be significantly different from the object construction
@@ -565,13 +691,43 @@ void TerminalWidget::paintGL()
         }
 #endif
 
-        static_cast<OpenGLRenderer*>(renderTarget_.get())->setTime(steady_clock::now());
+        auto& renderTarget = static_cast<OpenGLRenderer&>(*renderTarget_);
+        auto const frameStatsOverlay = session_->config().frameStatsOverlay;
+        renderTarget.setTime(steady_clock::now());
+        // The overlay is painted on top of the whole frame, which therefore must be rendered in full.
+        renderTarget.setPreservingContents(updateBehavior() == QOpenGLWidget::PartialUpdate
+                                           && !frameStatsOverlay);
 
         renderTarget_->clear(
             terminal().isModeEnabled(terminal::DECMode::ReverseVideo)
                 ? RGBAColor(profile().colors.defaultForeground, uint8_t(renderer_->backgroundOpacity()))
                 : RGBAColor(profile().colors.defaultBackground, uint8_t(renderer_->backgroundOpacity())));
         renderer_->render(terminal(), renderingPressure_);
+        if (auto const keyPress = renderer_->takeRenderedKeyPress())
+            presentingKeyPress_ = keyPress;
+
+        if (frameStatsOverlay)
+        {
+            auto const text = QString::fromStdString(formatFrameStats(terminal(), *renderer_, renderTarget));
+            // Painting onto the widget itself is only possible from the GUI thread.
+            auto paintDevice = std::optional<QOpenGLPaintDevice> {};
+            if (renderThread_)
+            {
+                paintDevice.emplace(size() * devicePixelRatio());
+                paintDevice->setDevicePixelRatio(devicePixelRatio());
+            }
+            QPainter painter;
+            if (paintDevice)
+                painter.begin(&*paintDevice);
+            else
+                painter.begin(this);
+            painter.setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+            auto const textRect =
+                painter.boundingRect(rect().adjusted(8, 8, -8, -8), Qt::AlignTop | Qt::AlignRight, text);
+            painter.fillRect(textRect.adjusted(-4, -4, 4, 4), QColor(0, 0, 0, 192));
+            painter.setPen(Qt::white);
+            painter.drawText(textRect, Qt::AlignLeft, text);
+        }
     }
     catch (exception const& e)
     {
@@ -590,10 +746,20 @@ float TerminalWidget::uptime() const noexcept
 
 void TerminalWidget::onFrameSwapped()
 {
-    if (!state_.finish())
-        update();
+    if (crispy::StartupTrace::get().recording())
+    {
+        crispy::StartupTrace::get().instant("First frame swapped");
+        crispy::StartupTrace::get().finish();
+    }
+
+    if (auto const keyPress = std::exchange(presentingKeyPress_, nullopt))
+        terminal().recordInputLatency(*keyPress, steady_clock::now());
+
+    if (!state_.finish() || renderer_->hasPendingGlyphs()
+        || static_cast<OpenGLRenderer const&>(*renderTarget_).hasPendingScreenshots())
+        requestRedraw();
     else if (auto timeout = terminal().nextRender(); timeout.has_value())
-        updateTimer_.start(timeout.value());
+        TimerWheel::shared().schedule(this, timeout.value(), [this]() { scheduleRedraw(); });
 }
 // }}}
 
@@ -819,6 +985,17 @@ terminal::ImageSize TerminalWidget::cellSize() const
 // }}}
 
 // {{{ TerminalDisplay: (user requested) actions
+void TerminalWidget::releaseCaches()
+{
+    if (!renderer_)
+        return;
+
+    auto const _ = lockRenderer();
+    makeCurrent();
+    renderer_->releaseCaches();
+    doneCurrent();
+}
+
 void TerminalWidget::post(std::function<void()> _fn)
 {
     postToObject(this, std::move(_fn));
@@ -853,6 +1030,7 @@ void TerminalWidget::inspect()
 
 void TerminalWidget::doDumpState()
 {
+    auto const _ = lockRenderer();
     makeCurrent();
 
     Require(session_);
@@ -883,6 +1061,8 @@ void TerminalWidget::doDumpState()
             auto os = std::stringstream {};
             terminal().currentScreen().inspect("Screen state dump.", os);
             renderer_->inspect(os);
+            os << "Frame times and PTY pipeline latencies:\n"
+               << formatFrameStats(terminal(), *renderer_, static_cast<OpenGLRenderer&>(*renderTarget_));
             return os.str();
         }();
 
@@ -922,21 +1102,35 @@ void TerminalWidget::doDumpState()
 
     renderTarget.scheduleScreenshot([this, targetDir](std::vector<uint8_t> const& rgbaPixels,
                                                       ImageSize imageSize) {
-        QImage(
-            rgbaPixels.data(), imageSize.width.as<int>(), imageSize.height.as<int>(), QImage::Format_RGBA8888)
-            .mirrored(false, true)
-            .save(QString::fromStdString((targetDir / "screenshot.png").generic_string()));
-
-        // If this dump-state was triggered due to the PTY being closed
-        // and a dump was requested at the end, then terminate this session here now.
-        if (session_->terminal().device().isClosed() && session_->app().dumpStateAtExit().has_value())
-        {
-            session_->terminate();
-        }
+        // Mirroring copies the pixels, which are then encoded to PNG off the GUI thread.
+        auto image =
+            QImage(
+                rgbaPixels.data(), imageSize.width.as<int>(), imageSize.height.as<int>(), QImage::Format_RGBA8888)
+                .mirrored(false, true);
+        auto const fileName = QString::fromStdString((targetDir / "screenshot.png").generic_string());
+
+        if (screenshotEncoding_.valid())
+            screenshotEncoding_.wait();
+        screenshotEncoding_ = std::async(std::launch::async, [this, image = std::move(image), fileName]() {
+            image.save(fileName);
+
+            // If this dump-state was triggered due to the PTY being closed
+            // and a dump was requested at the end, then terminate this session here now.
+            QMetaObject::invokeMethod(
+                this,
+                [this]() {
+                    if (session_->terminal().device().isClosed()
+                        && session_->app().dumpStateAtExit().has_value())
+                        session_->terminate();
+                },
+                Qt::QueuedConnection);
+        });
     });
 
+    doneCurrent();
+
     // force an update to actually render the screenshot
-    update();
+    requestRedraw();
 }
 
 void TerminalWidget::notify(std::string_view /*_title*/, std::string_view /*_body*/)
@@ -1004,6 +1198,7 @@ void TerminalWidget::setFonts(terminal::renderer::FontDescriptions fonts)
 {
     Require(session_ != nullptr);
 
+    auto const _ = lockRenderer();
     if (applyFontDescription(gridMetrics().cellSize, pageSize(), pixelSize(), fontDPI(), *renderer_, fonts))
     {
         // resize widget (same pixels, but adjusted terminal rows/columns and margin)
@@ -1018,6 +1213,7 @@ bool TerminalWidget::setFontSize(text::font_size _size)
 
     DisplayLog()("Setting display font size and recompute metrics: {}pt", _size.pt);
 
+    auto const _ = lockRenderer();
     if (!renderer_->setFontSize(_size))
         return false;
 
@@ -1037,6 +1233,7 @@ bool TerminalWidget::setPageSize(PageSize _newPageSize)
     if (_newPageSize == terminal().pageSize())
         return false;
 
+    auto const _ = lockRenderer();
     auto const viewSize =
         ImageSize { Width(*gridMetrics().cellSize.width * unbox<unsigned>(profile().terminalSize.columns)),
                     Height(*gridMetrics().cellSize.width * unbox<unsigned>(profile().terminalSize.columns)) };
@@ -1088,6 +1285,7 @@ void TerminalWidget::setBackgroundImage(
     std::shared_ptr<terminal::BackgroundImage const> const& backgroundImage)
 {
     assert(renderTarget_ != nullptr);
+    auto const _ = lockRenderer();
     renderTarget_->setBackgroundImage(backgroundImage);
 }
 
@@ -1135,12 +1333,16 @@ void TerminalWidget::toggleTitleBar()
 void TerminalWidget::setHyperlinkDecoration(terminal::renderer::Decorator _normal,
                                             terminal::renderer::Decorator _hover)
 {
+    auto const _ = lockRenderer();
     renderer_->setHyperlinkDecoration(_normal, _hover);
 }
 
 void TerminalWidget::setBackgroundOpacity(terminal::Opacity _opacity)
 {
-    renderer_->setBackgroundOpacity(_opacity);
+    {
+        auto const _ = lockRenderer();
+        renderer_->setBackgroundOpacity(_opacity);
+    }
 
     if (session_)
         session_->terminal().breakLoopAndRefreshRenderBuffer();
@@ -1152,12 +1354,27 @@ void TerminalWidget::scheduleRedraw()
 {
     if (setScreenDirty())
     {
-        update(); // QCoreApplication::postEvent(this, new QEvent(QEvent::UpdateRequest));
+        requestRedraw();
 
         emit terminalBufferUpdated(); // TODO: should not be invoked, as it's not guarranteed to be updated.
     }
 }
 
+void TerminalWidget::requestRedraw()
+{
+    if (renderThread_)
+        renderThread_->requestFrame();
+    else
+        update(); // QCoreApplication::postEvent(this, new QEvent(QEvent::UpdateRequest));
+}
+
+std::unique_lock<RenderThread> TerminalWidget::lockRenderer()
+{
+    if (!renderThread_)
+        return {};
+    return std::unique_lock { *renderThread_ };
+}
+
 void TerminalWidget::renderBufferUpdated()
 {
     scheduleRedraw();
@@ -16,6 +16,7 @@
 #include <contour/Actions.h>
 #include <contour/Config.h>
 #include <contour/TerminalSession.h>
+#include <contour/display/RenderThread.h>
 #include <contour/helper.h>
 
 #include <terminal/Color.h>
@@ -28,6 +29,7 @@
 
 #include <QtCore/QFileSystemWatcher>
 #include <QtCore/QPoint>
+#include <QtCore/QPointer>
 #include <QtCore/QTimer>
 #include <QtGui/QOpenGLExtraFunctions>
 #include <QtGui/QVector4D>
@@ -42,7 +44,9 @@
 
 #include <atomic>
 #include <fstream>
+#include <future>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <vector>
 
@@ -99,6 +103,7 @@ class TerminalWidget: public QOpenGLWidget, private QOpenGLExtraFunctions
     void initializeGL() override;
     void resizeGL(int _width, int _height) override;
     void paintGL() override;
+    void paintEvent(QPaintEvent* _event) override;
     // }}}
 
     // {{{ Input handling
@@ -134,6 +139,7 @@ class TerminalWidget: public QOpenGLWidget, private QOpenGLExtraFunctions
     void copyToClipboard(std::string_view /*_data*/);
     void inspect();
     void doDumpState();
+    void releaseCaches();
     void notify(std::string_view /*_title*/, std::string_view /*_body*/);
     void resizeWindow(terminal::LineCount, terminal::ColumnCount);
     void resizeWindow(terminal::Width, terminal::Height);
@@ -167,6 +173,7 @@ class TerminalWidget: public QOpenGLWidget, private QOpenGLExtraFunctions
 
   public Q_SLOTS:
     void onFrameSwapped();
+    void applyPendingResize();
     void onScrollBarValueChanged(int _value);
     void onRefreshRateChanged();
     void applyFontDPI();
@@ -186,8 +193,16 @@ class TerminalWidget: public QOpenGLWidget, private QOpenGLExtraFunctions
     // helper methods
     //
     void configureScreenHooks();
+    void configureCurrentScreenHooks();
     void watchKdeDpiSetting();
     void initializeRenderer();
+    void renderFrame();
+
+    /// Triggers the rendering of a frame, on the render thread if there is one.
+    void requestRedraw();
+
+    /// @returns a lock keeping the render thread off the renderer, if rendering on a thread of its own.
+    [[nodiscard]] std::unique_lock<RenderThread> lockRenderer();
     [[nodiscard]] float uptime() const noexcept;
 
     [[nodiscard]] terminal::PageSize pageSize() const
@@ -227,17 +242,34 @@ class TerminalWidget: public QOpenGLWidget, private QOpenGLExtraFunctions
     std::unique_ptr<terminal::renderer::Renderer> renderer_;
     bool renderingPressure_ = false;
     std::unique_ptr<terminal::renderer::RenderTarget> renderTarget_;
+    // Time of the key press whose echo is shown by the frame about to be swapped, if any.
+    std::optional<std::chrono::steady_clock::time_point> presentingKeyPress_;
     PermissionCache rememberedPermissions_ {};
     bool maximizedState_ = false;
     bool framelessWidget_ = false;
 
-    // update() timer used to animate the blinking cursor.
-    QTimer updateTimer_;
+    // Time the window size must stay unchanged before resizing the grid and the PTY.
+    static constexpr std::chrono::milliseconds ResizeDebounceInterval { 20 };
+    // Longest time a grid resize is held back while the window size keeps changing.
+    static constexpr std::chrono::milliseconds ResizeMaxDelay { 150 };
+    // Pixel size of the latest resize event not yet applied to the grid and the PTY, if any.
+    std::optional<terminal::ImageSize> pendingResize_;
+    std::chrono::steady_clock::time_point pendingResizeSince_;
+    QTimer resizeTimer_;
+
+    // PNG encoding of the most recently taken screenshot, running off the GUI thread.
+    std::future<void> screenshotEncoding_;
+
+    // Screen whose refresh rate and DPI changes are currently listened to.
+    QPointer<QScreen> hookedScreen_;
 
     RenderStateManager state_;
 
     QFileSystemWatcher filesystemWatcher_;
 
+    // Renders the frames off the GUI thread, if enabled.
+    std::unique_ptr<RenderThread> renderThread_;
+
     // ======================================================================
 
 #if defined(CONTOUR_PERF_STATS)
@@ -0,0 +1,112 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <contour/display/TimerWheel.h>
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QPointer>
+
+#include <algorithm>
+#include <vector>
+
+using namespace std::chrono;
+
+namespace contour::display
+{
+
+TimerWheel& TimerWheel::shared()
+{
+    static QPointer<TimerWheel> instance;
+    if (!instance)
+        instance = new TimerWheel(QCoreApplication::instance());
+    return *instance;
+}
+
+TimerWheel::TimerWheel(QObject* parent): QObject(parent), epoch_ { Clock::now() }, timer_(this)
+{
+    // Coarse timers may fire early, which would then be a wakeup without any deadline to serve.
+    timer_.setTimerType(Qt::PreciseTimer);
+    timer_.setSingleShot(true);
+    connect(&timer_, &QTimer::timeout, this, [this]() { onTimeout(); });
+}
+
+int64_t TimerWheel::tickAt(Clock::time_point time) const noexcept
+{
+    // Rounded up, such that a deadline is never served before it is due.
+    auto const sinceEpoch = duration_cast<microseconds>(time - epoch_);
+    auto const tick = duration_cast<microseconds>(Tick);
+    return (sinceEpoch.count() + tick.count() - 1) / tick.count();
+}
+
+void TimerWheel::schedule(void const* owner, milliseconds timeout, Callback callback)
+{
+    auto const tick = tickAt(Clock::now() + std::max(timeout, milliseconds(0)));
+    entries_[owner] = Entry { tick, std::move(callback) };
+    rearm();
+}
+
+void TimerWheel::cancel(void const* owner)
+{
+    if (entries_.erase(owner))
+        rearm();
+}
+
+void TimerWheel::onTimeout()
+{
+    armedTick_ = -1;
+
+    // Only the ticks that have begun by now are due.
+    auto const now = duration_cast<microseconds>(Clock::now() - epoch_).count()
+                     / duration_cast<microseconds>(Tick).count();
+
+    // Callbacks may schedule or cancel deadlines, so the due ones are taken out first.
+    auto due = std::vector<Callback> {};
+    for (auto i = entries_.begin(); i != entries_.end();)
+    {
+        if (i->second.tick <= now)
+        {
+            due.emplace_back(std::move(i->second.callback));
+            i = entries_.erase(i);
+        }
+        else
+            ++i;
+    }
+
+    for (auto const& callback: due)
+        callback();
+
+    rearm();
+}
+
+void TimerWheel::rearm()
+{
+    if (entries_.empty())
+    {
+        timer_.stop();
+        armedTick_ = -1;
+        return;
+    }
+
+    auto const next = std::min_element(entries_.begin(), entries_.end(), [](auto const& a, auto const& b) {
+                          return a.second.tick < b.second.tick;
+                      })->second.tick;
+    if (next == armedTick_ && timer_.isActive())
+        return;
+
+    auto const deadline = epoch_ + next * duration_cast<Clock::duration>(Tick);
+    auto const timeout = duration_cast<milliseconds>(deadline - Clock::now()) + milliseconds(1);
+    armedTick_ = next;
+    timer_.start(static_cast<int>(std::max(timeout, milliseconds(0)).count()));
+}
+
+} // namespace contour::display
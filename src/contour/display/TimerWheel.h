@@ -0,0 +1,75 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <QtCore/QObject>
+#include <QtCore/QTimer>
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+
+namespace contour::display
+{
+
+// Process-wide timer for the deadlines of periodic UI updates, such as blinking text,
+// the blinking cursor, and search highlights, of all sessions.
+//
+// Deadlines are rounded up to the next tick, so that the deadlines of all sessions
+// falling into the same tick are served by a single wakeup.
+//
+// Each owner (e.g. a display or a session) has at most one pending deadline,
+// which is replaced when the owner schedules a new one.
+//
+// Must only be used from the GUI thread.
+class TimerWheel: public QObject
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+    using Callback = std::function<void()>;
+
+    static constexpr std::chrono::milliseconds Tick { 50 };
+
+    // Returns the instance shared by all sessions, owned by the application object.
+    static TimerWheel& shared();
+
+    explicit TimerWheel(QObject* parent = nullptr);
+
+    // Invokes the given callback once the given timeout has passed, but not before the tick it ends in.
+    void schedule(void const* owner, std::chrono::milliseconds timeout, Callback callback);
+
+    // Discards the pending deadline of the given owner, if any.
+    void cancel(void const* owner);
+
+    [[nodiscard]] size_t pendingCount() const noexcept { return entries_.size(); }
+
+  private:
+    struct Entry
+    {
+        int64_t tick;
+        Callback callback;
+    };
+
+    [[nodiscard]] int64_t tickAt(Clock::time_point time) const noexcept;
+    void onTimeout();
+    void rearm();
+
+    Clock::time_point const epoch_;
+    std::unordered_map<void const*, Entry> entries_;
+    int64_t armedTick_ = -1;
+    QTimer timer_;
+};
+
+} // namespace contour::display
@@ -1,11 +1,16 @@
 uniform highp mat4 u_projection;
-layout (location = 0) in highp vec3 vs_vertex;    // target vertex coordinates
+
+// Each rectangle is a single instance, whose four corners are drawn as a triangle strip.
+layout (location = 0) in highp vec4 vs_rect;      // target rectangle (x, y, width, height)
 layout (location = 1) in highp vec4 vs_colors;    // custom foreground colors
 
 out mediump vec4 fs_textColor;
 
 void main()
 {
-    gl_Position = u_projection * vec4(vs_vertex.xyz, 1.0);
+    // (0, 0), (1, 0), (0, 1), (1, 1)
+    highp vec2 corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1));
+
+    gl_Position = u_projection * vec4(vs_rect.xy + corner * vs_rect.zw, 0.0, 1.0);
     fs_textColor = vs_colors;
 }
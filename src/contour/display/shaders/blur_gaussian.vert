@@ -0,0 +1,7 @@
+void main()
+{
+    // (-1, -1), (1, -1), (-1, 1), (1, 1), covering the viewport as a triangle strip.
+    highp vec2 corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1));
+
+    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,239 @@
+// Renders box drawing characters, block elements and Powerline separators analytically,
+// from the shape of the character (see BOX_SHAPE_* in shared_defines.h).
+//
+// Axis aligned edges are snapped to whole pixels, such that lines of adjacent cells join seamlessly,
+// whereas diagonal and curved edges are antialiased across about one pixel.
+
+in highp vec2 fs_position;
+flat in highp vec2 fs_cellSize;
+flat in highp float fs_thickness;
+flat in highp uint fs_shape;
+flat in mediump vec4 fs_textColor;
+
+out highp vec4 outColor;
+
+highp float inRange(highp float v, highp float low, highp float high)
+{
+    return (v >= low && v < high) ? 1.0 : 0.0;
+}
+
+// Half of the width a line of the given style takes up across its direction.
+highp float halfWidth(uint style)
+{
+    if (style == uint(BOX_LINE_LIGHT))
+        return 0.5 * fs_thickness;
+    if (style == uint(BOX_LINE_HEAVY))
+        return fs_thickness;
+    if (style == uint(BOX_LINE_DOUBLE))
+        return 1.5 * fs_thickness;
+    return 0.0;
+}
+
+// Coverage of a band of the given half width around the given center line, snapped to whole pixels.
+highp float band(highp float v, highp float center, highp float halfWidth_)
+{
+    highp float low = floor(center - halfWidth_ + 0.5);
+    return inRange(v, low, low + floor(2.0 * halfWidth_ + 0.5));
+}
+
+// Coverage of the dashes of a line along the given axis, dashes being centered within
+// each of the equally long sections of the cell.
+highp float dashes(highp float v, highp float length_, uint count)
+{
+    if (count == 0u)
+        return 1.0;
+    highp float section = length_ / float(count);
+    highp float offset = mod(v, section);
+    return inRange(offset, floor(0.25 * section + 0.5), floor(0.75 * section + 0.5));
+}
+
+// Signed distance of p to the line through a and b, positive to the inside of the
+// triangle with the vertices given in the order of its edges.
+highp float edgeDistance(highp vec2 p, highp vec2 a, highp vec2 b)
+{
+    highp vec2 ab = b - a;
+    return (ab.x * (p.y - a.y) - ab.y * (p.x - a.x)) / length(ab);
+}
+
+highp float strokeCoverage(highp float distance_)
+{
+    return clamp(0.5 * fs_thickness + 0.5 - abs(distance_), 0.0, 1.0);
+}
+
+// How far an arm of the given style reaches beyond the center along its direction, where the lines
+// across it reach out the given distance. Single lines ending in between double lines reach
+// only up to the near one of these.
+highp float armReach(uint style, uint opposite, uint side, uint otherSide, highp float acrossReach)
+{
+    uint doubleStyle = uint(BOX_LINE_DOUBLE);
+    if (style != doubleStyle && opposite == uint(BOX_LINE_NONE) && side == doubleStyle
+        && otherSide == doubleStyle)
+        return -0.5 * fs_thickness;
+    return acrossReach;
+}
+
+// Adds an arm of a line to the coverage of the single lines (x), the double lines including the
+// channel in between them (y), and that channel (z), each spanning the given range along the arm.
+void addArm(inout highp vec3 lines,
+            uint style,
+            highp float along,
+            highp vec2 range,
+            highp vec2 channelRange,
+            highp float across,
+            highp float center,
+            highp float dash)
+{
+    highp float width = halfWidth(style);
+    if (style == uint(BOX_LINE_DOUBLE))
+    {
+        lines.y = max(lines.y, inRange(along, range.x, range.y) * band(across, center, width));
+        highp float channel = band(across, center, 0.5 * fs_thickness);
+        lines.z = max(lines.z, inRange(along, channelRange.x, channelRange.y) * channel);
+    }
+    else if (style != uint(BOX_LINE_NONE))
+        lines.x = max(lines.x, inRange(along, range.x, range.y) * band(across, center, width) * dash);
+}
+
+highp float renderLines(highp vec2 p, highp vec2 size)
+{
+    uint left = (fs_shape >> 4u) & 3u;
+    uint up = (fs_shape >> 6u) & 3u;
+    uint right = (fs_shape >> 8u) & 3u;
+    uint down = (fs_shape >> 10u) & 3u;
+    uint dashCount = (fs_shape >> 12u) & 7u;
+    uint diagonal = (fs_shape >> 15u) & 3u;
+    uint arc = (fs_shape >> 17u) & 7u;
+
+    highp float t = fs_thickness;
+    highp vec2 center = floor(size / 2.0);
+    highp vec2 lightCenter = center - floor(t / 2.0) + 0.5 * t; // center line of light strokes
+
+    // How far horizontal lines reach beyond the center to join the vertical ones, and vice versa.
+    highp float horizontalReach = max(halfWidth(up), halfWidth(down));
+    highp float verticalReach = max(halfWidth(left), halfWidth(right));
+
+    highp float leftReach = armReach(left, right, up, down, horizontalReach);
+    highp float rightReach = armReach(right, left, up, down, horizontalReach);
+    highp float upReach = armReach(up, down, left, right, verticalReach);
+    highp float downReach = armReach(down, up, left, right, verticalReach);
+
+    // The channel in between double lines reaches into the center only as far as the joining channels.
+    highp float channel = 0.5 * t;
+    highp vec3 lines = vec3(0.0);
+    highp float horizontalDashes = dashes(p.x, size.x, dashCount);
+    highp float verticalDashes = dashes(p.y, size.y, dashCount);
+    addArm(lines,
+           left,
+           p.x,
+           vec2(0.0, center.x + leftReach),
+           vec2(0.0, center.x + min(leftReach, channel)),
+           p.y,
+           lightCenter.y,
+           horizontalDashes);
+    addArm(lines,
+           right,
+           p.x,
+           vec2(center.x - rightReach, size.x),
+           vec2(center.x - min(rightReach, channel), size.x),
+           p.y,
+           lightCenter.y,
+           horizontalDashes);
+    addArm(lines,
+           up,
+           p.y,
+           vec2(0.0, center.y + upReach),
+           vec2(0.0, center.y + min(upReach, channel)),
+           p.x,
+           lightCenter.x,
+           verticalDashes);
+    addArm(lines,
+           down,
+           p.y,
+           vec2(center.y - downReach, size.y),
+           vec2(center.y - min(downReach, channel), size.y),
+           p.x,
+           lightCenter.x,
+           verticalDashes);
+
+    highp float coverage = max(lines.x, lines.y * (1.0 - lines.z));
+
+    if ((diagonal & 1u) != 0u) // from the bottom left to the top right
+        coverage = max(coverage, strokeCoverage(edgeDistance(p, vec2(0.0, size.y), vec2(size.x, 0.0))));
+    if ((diagonal & 2u) != 0u) // from the top left to the bottom right
+        coverage = max(coverage, strokeCoverage(edgeDistance(p, vec2(0.0, 0.0), size)));
+
+    if (arc != 0u)
+    {
+        // A quarter of an ellipse around the cell corner the arc bends away from,
+        // ending at the center lines of the edges it joins.
+        highp vec2 corner = vec2(0.0, 0.0);
+        if (arc == 1u) // top left
+            corner = size;
+        else if (arc == 2u) // top right
+            corner = vec2(0.0, size.y);
+        else if (arc == 4u) // bottom left
+            corner = vec2(size.x, 0.0);
+        highp vec2 radius = abs(corner - lightCenter);
+        highp vec2 d = (p - corner) / radius;
+        highp float f = dot(d, d) - 1.0;
+        highp vec2 gradient = 2.0 * d / radius;
+        coverage = max(coverage, strokeCoverage(f / max(length(gradient), 1e-6)));
+    }
+
+    return coverage;
+}
+
+highp float renderBlock(highp vec2 p, highp vec2 size)
+{
+    highp vec2 low = vec2(float((fs_shape >> 4u) & 15u), float((fs_shape >> 8u) & 15u));
+    highp vec2 high = vec2(float((fs_shape >> 12u) & 15u), float((fs_shape >> 16u) & 15u));
+    low = floor(low * size / 8.0 + 0.5);
+    high = floor(high * size / 8.0 + 0.5);
+    return inRange(p.x, low.x, high.x) * inRange(p.y, low.y, high.y);
+}
+
+highp float renderQuadrants(highp vec2 p, highp vec2 size)
+{
+    highp vec2 half_ = floor(size / 2.0 + 0.5);
+    uint quadrant = (p.x >= half_.x ? 1u : 0u) + (p.y >= half_.y ? 2u : 0u);
+    return ((fs_shape >> (4u + quadrant)) & 1u) != 0u ? 1.0 : 0.0;
+}
+
+highp float renderTriangle(highp vec2 p, highp vec2 size)
+{
+    uint kind = (fs_shape >> 4u) & 7u;
+    highp float w = size.x;
+    highp float h = size.y;
+    highp float d = 0.0;
+    if (kind == uint(BOX_TRIANGLE_RIGHT_POINTING))
+        d = min(edgeDistance(p, vec2(0.0, 0.0), vec2(w, 0.5 * h)),
+                edgeDistance(p, vec2(w, 0.5 * h), vec2(0.0, h)));
+    else if (kind == uint(BOX_TRIANGLE_LEFT_POINTING))
+        d = min(edgeDistance(p, vec2(0.0, 0.5 * h), vec2(w, 0.0)),
+                edgeDistance(p, vec2(w, h), vec2(0.0, 0.5 * h)));
+    else if (kind == uint(BOX_TRIANGLE_LOWER_RIGHT))
+        d = edgeDistance(p, vec2(0.0, h), vec2(w, 0.0));
+    else if (kind == uint(BOX_TRIANGLE_UPPER_LEFT))
+        d = edgeDistance(p, vec2(w, 0.0), vec2(0.0, h));
+    else if (kind == uint(BOX_TRIANGLE_UPPER_RIGHT))
+        d = edgeDistance(p, size, vec2(0.0, 0.0));
+    return clamp(0.5 + d, 0.0, 1.0);
+}
+
+void main()
+{
+    uint kind = fs_shape & 15u;
+    highp float coverage = 0.0;
+    if (kind == uint(BOX_SHAPE_LINES))
+        coverage = renderLines(fs_position, fs_cellSize);
+    else if (kind == uint(BOX_SHAPE_BLOCK))
+        coverage = renderBlock(fs_position, fs_cellSize);
+    else if (kind == uint(BOX_SHAPE_QUADRANTS))
+        coverage = renderQuadrants(fs_position, fs_cellSize);
+    else if (kind == uint(BOX_SHAPE_TRIANGLE))
+        coverage = renderTriangle(fs_position, fs_cellSize);
+
+    if (coverage <= 0.0)
+        discard;
+    outColor = vec4(fs_textColor.rgb, fs_textColor.a * coverage);
+}
@@ -0,0 +1,25 @@
+uniform highp mat4 u_projection;
+
+// Each box drawing character is a single instance, whose four corners are drawn as a triangle strip.
+layout (location = 0) in highp vec4 vs_rect;      // target grid cell (x, y, width, height)
+layout (location = 1) in highp vec4 vs_colors;    // foreground color
+layout (location = 2) in highp vec4 vs_shape;     // shape (lower and upper 16 bits), line thickness
+
+out highp vec2 fs_position;                       // position within the grid cell, from its top left
+flat out highp vec2 fs_cellSize;
+flat out highp float fs_thickness;
+flat out highp uint fs_shape;
+flat out mediump vec4 fs_textColor;
+
+void main()
+{
+    // (0, 0), (1, 0), (0, 1), (1, 1)
+    highp vec2 corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1));
+
+    gl_Position = u_projection * vec4(vs_rect.xy + corner * vs_rect.zw, 0.0, 1.0);
+    fs_position = corner * vs_rect.zw;
+    fs_cellSize = vs_rect.zw;
+    fs_thickness = max(vs_shape.z, 1.0);
+    fs_shape = uint(vs_shape.x) | (uint(vs_shape.y) << 16u);
+    fs_textColor = vs_colors;
+}
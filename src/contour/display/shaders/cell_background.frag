@@ -0,0 +1,11 @@
+uniform highp sampler2D u_cellColors; // one texel per grid cell
+uniform highp vec2 u_cellSize;        // cell size in pixels
+
+in highp vec2 fs_position;
+out highp vec4 outColor;
+
+void main()
+{
+    highp ivec2 cell = ivec2(fs_position / u_cellSize);
+    outColor = texelFetch(u_cellColors, cell, 0);
+}
@@ -0,0 +1,13 @@
+uniform highp mat4 u_projection;
+uniform highp vec4 u_rect;      // target rectangle of the grid (x, y, width, height)
+
+out highp vec2 fs_position;     // pixel position relative to the top left of the grid
+
+void main()
+{
+    // (0, 0), (1, 0), (0, 1), (1, 1)
+    highp vec2 corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1));
+
+    fs_position = corner * u_rect.zw;
+    gl_Position = u_projection * vec4(u_rect.xy + fs_position, 0.0, 1.0);
+}
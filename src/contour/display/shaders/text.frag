@@ -1,9 +1,13 @@
 uniform highp float pixel_x;                  // 1.0 / lcdAtlas.width
-uniform highp sampler2D fs_textureAtlas;      // RGBA
+uniform highp sampler2DArray fs_redAtlas;     // one layer per atlas page
+uniform highp sampler2DArray fs_rgbAtlas;
+uniform highp sampler2DArray fs_rgbaAtlas;
+uniform highp sampler2DArray fs_imageTexture; // of the image being rendered, of one layer
 uniform highp float u_time;
 
-in highp vec4 fs_TexCoord;
+in highp vec4 fs_TexCoord; // x, y, atlas page, fragment shader selector
 in highp vec4 fs_textColor;
+flat in highp int fs_texture; // TEXT_TEXTURE_*
 
 // Dual source blending (since OpenGL 3.3)
 // layout (location = 0, index = 0) out highp vec4 color;
@@ -12,6 +16,18 @@ out highp vec4 fragColor;
 
 const highp vec4 TEST_PIXEL = vec4(1.0, 0.0, 0.0, 1.0); // test pixel for debugging
 
+// Samples the texture of the tile, which is the same for all fragments of it.
+highp vec4 sampleTile(highp vec3 coords)
+{
+    if (fs_texture == TEXT_TEXTURE_ATLAS_RGB)
+        return texture(fs_rgbAtlas, coords);
+    if (fs_texture == TEXT_TEXTURE_ATLAS_RGBA)
+        return texture(fs_rgbaAtlas, coords);
+    if (fs_texture == TEXT_TEXTURE_IMAGE)
+        return texture(fs_imageTexture, coords);
+    return texture(fs_redAtlas, coords);
+}
+
 void renderGrayscaleGlyph()
 {
     // XXX monochrome glyph (RGB)
@@ -20,16 +36,27 @@ void renderGrayscaleGlyph()
     //colorMask = alphaMap;
 
     // Using the RED-channel as alpha-mask of an anti-aliases glyph.
-    highp vec4 pixel = texture(fs_textureAtlas, fs_TexCoord.xy);
+    highp vec4 pixel = sampleTile(fs_TexCoord.xyz);
     highp vec4 sampled = vec4(1.0, 1.0, 1.0, pixel.r);
     fragColor = sampled * fs_textColor;
 }
 
+// Renders a glyph from its signed distance field, with the glyph's edge at 0.5 in the red channel.
+// The edge is antialiased across about one pixel on the target surface, regardless of the scale
+// the glyph is rendered with.
+void renderSdfGlyph()
+{
+    highp float distance = sampleTile(fs_TexCoord.xyz).r;
+    highp float width = max(fwidth(distance), 1.0 / 255.0);
+    highp float alpha = smoothstep(0.5 - width, 0.5 + width, distance);
+    fragColor = vec4(fs_textColor.rgb, fs_textColor.a * alpha);
+}
+
 // Renders an RGBA texture. This is used to render images (such as Sixel graphics or Emoji).
 void renderColoredRGBA()
 {
     // colored image (RGBA)
-    highp vec4 v = texture(fs_textureAtlas, fs_TexCoord.xy);
+    highp vec4 v = sampleTile(fs_TexCoord.xyz);
     //v = TEST_PIXEL;
     fragColor = v;
 }
@@ -39,7 +66,7 @@ void renderColoredRGBA()
 void renderLcdGlyphSimple()
 {
     // LCD glyph (RGB)
-    highp vec4 v = texture(fs_textureAtlas, fs_TexCoord.xy); // .rgb ?
+    highp vec4 v = sampleTile(fs_TexCoord.xyz); // .rgb ?
 
     // float a = min(v.r, min(v.g, v.b));
     highp float a = (v.r + v.g + v.b) / 3.0;
@@ -102,12 +129,11 @@ highp vec3 lcdPixelShift(highp vec3 current, highp vec3 previous, highp float sh
 void renderLcdGlyph()
 {
     highp float px = pixel_x;
-    highp vec2 pixelOffset = vec2(1.0, 0.0) * px;
-    //highp vec3 pixelOffset = vec3(1.0, 0.0, 0.0) * px;
+    highp vec3 pixelOffset = vec3(1.0, 0.0, 0.0) * px;
 
     // LCD glyph (RGB)
-    highp vec4 current  = texture(fs_textureAtlas, fs_TexCoord.xy);
-    highp vec4 previous = texture(fs_textureAtlas, fs_TexCoord.xy - pixelOffset);
+    highp vec4 current  = sampleTile(fs_TexCoord.xyz);
+    highp vec4 previous = sampleTile(fs_TexCoord.xyz - pixelOffset);
 
     // The text in a terminal does enforce fixed-width advances, and therefore
     // rendering a glyph should always start at a full pixel with no shift.
@@ -149,6 +175,9 @@ void main()
         case FRAGMENT_SELECTOR_IMAGE_BGRA:
             renderColoredRGBA();
             break;
+        case FRAGMENT_SELECTOR_GLYPH_SDF:
+            renderSdfGlyph();
+            break;
         case FRAGMENT_SELECTOR_GLYPH_ALPHA:
         default:
             renderGrayscaleGlyph();
@@ -1,16 +1,24 @@
 uniform highp mat4 vs_projection;                 // projection matrix (flips around the coordinate system)
 
-layout (location = 0) in highp vec3 vs_vertex;    // target vertex coordinates
-layout (location = 1) in highp vec4 vs_texCoords; // 2D-atlas texture coordinates
+// Each tile is a single instance, whose four corners are drawn as a triangle strip.
+layout (location = 0) in highp vec4 vs_rect;      // target rectangle (x, y, width, height)
+layout (location = 1) in highp vec4 vs_texCoords; // atlas page texture coordinates (x, y, width, height)
 layout (location = 2) in highp vec4 vs_colors;    // custom foreground colors
+layout (location = 3) in highp vec2 vs_selector;  // fragment shader selector and texture (TEXT_TEXTURE_*)
+layout (location = 4) in highp float vs_page;     // atlas page
 
 out highp vec4 fs_TexCoord;
 out highp vec4 fs_textColor;
+flat out highp int fs_texture;
 
 void main()
 {
-    gl_Position = vs_projection * vec4(vs_vertex.xyz, 1.0);
+    // (0, 0), (1, 0), (0, 1), (1, 1)
+    highp vec2 corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1));
 
-    fs_TexCoord = vs_texCoords;
+    gl_Position = vs_projection * vec4(vs_rect.xy + corner * vs_rect.zw, 0.0, 1.0);
+
+    fs_TexCoord = vec4(vs_texCoords.xy + corner * vs_texCoords.zw, vs_page, vs_selector.x);
     fs_textColor = vs_colors;
+    fs_texture = int(vs_selector.y);
 }
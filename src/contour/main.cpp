@@ -13,6 +13,8 @@
  */
 #include <contour/ContourGuiApp.h>
 
+#include <crispy/StartupTrace.h>
+
 #if defined(_WIN32)
     #include <cstdio>
     #include <iostream>
@@ -84,6 +86,8 @@ void tryAttachConsole()
 
 int main(int argc, char const* argv[])
 {
+    crispy::StartupTrace::get().instant("main");
+
 #if defined(_WIN32)
     tryAttachConsole();
 #endif
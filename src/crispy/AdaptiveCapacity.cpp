@@ -0,0 +1,124 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <crispy/AdaptiveCapacity.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#if defined(__linux__)
+    #include <malloc.h>
+#endif
+
+using namespace std::string_view_literals;
+
+namespace crispy
+{
+
+AdaptiveCapacity::AdaptiveCapacity(size_t initial, Limits limits) noexcept:
+    _value { std::clamp(initial, limits.minimum, limits.maximum) }, _limits { limits }
+{
+}
+
+void AdaptiveCapacity::record(LRUHashtableStats stats) noexcept
+{
+    _hits += stats.hits;
+    _misses += stats.misses;
+    _evictions += stats.recycles;
+}
+
+size_t AdaptiveCapacity::adapt(bool memoryPressure) noexcept
+{
+    auto const lookups = _hits + _misses;
+    auto const hitRate = lookups != 0 ? static_cast<double>(_hits) / static_cast<double>(lookups) : 1.0;
+
+    if (memoryPressure)
+        _value = std::max(_value / 2, _limits.minimum);
+    else if (lookups >= MinimumLookups && hitRate < _limits.targetHitRate && _evictions != 0)
+        _value = std::min(_value * 2, _limits.maximum);
+
+    _hits = 0;
+    _misses = 0;
+    _evictions = 0;
+    return _value;
+}
+
+std::optional<double> parsePressureStall(std::string_view text) noexcept
+{
+    // some avg10=0.00 avg60=0.00 avg300=0.00 total=0
+    // full avg10=0.00 avg60=0.00 avg300=0.00 total=0
+    auto constexpr Prefix = "some avg10="sv;
+    if (text.substr(0, Prefix.size()) != Prefix)
+        return std::nullopt;
+
+    auto const valueEnd = text.find(' ', Prefix.size());
+    auto const value = std::string(text.substr(Prefix.size(), valueEnd - Prefix.size()));
+    char* end = nullptr;
+    auto const result = std::strtod(value.c_str(), &end);
+    if (end == value.c_str())
+        return std::nullopt;
+    return result;
+}
+
+#if defined(__linux__)
+namespace
+{
+    std::optional<double> readPressureStall(std::string const& path)
+    {
+        auto file = std::ifstream(path);
+        if (!file.good())
+            return std::nullopt;
+        auto text = std::stringstream {};
+        text << file.rdbuf();
+        return parsePressureStall(text.str());
+    }
+
+    // Path to the memory pressure of the cgroup (v2) this process belongs to, if any.
+    std::string cgroupMemoryPressurePath()
+    {
+        auto file = std::ifstream("/proc/self/cgroup");
+        auto line = std::string {};
+        while (std::getline(file, line))
+            if (line.rfind("0::", 0) == 0)
+                return "/sys/fs/cgroup" + line.substr(3) + "/memory.pressure";
+        return {};
+    }
+} // namespace
+#endif
+
+bool underMemoryPressure(double thresholdPercent)
+{
+#if defined(__linux__)
+    static auto const cgroupPath = cgroupMemoryPressurePath();
+    if (!cgroupPath.empty())
+        if (auto const stall = readPressureStall(cgroupPath))
+            return *stall >= thresholdPercent;
+    if (auto const stall = readPressureStall("/proc/pressure/memory"))
+        return *stall >= thresholdPercent;
+#else
+    (void) thresholdPercent;
+#endif
+    return false;
+}
+
+void releaseFreeHeapMemory() noexcept
+{
+#if defined(__GLIBC__)
+    malloc_trim(0);
+#endif
+}
+
+} // namespace crispy
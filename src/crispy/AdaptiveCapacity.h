@@ -0,0 +1,79 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <crispy/StrongLRUHashtable.h>
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+namespace crispy
+{
+
+/// Capacity of a cache that adapts to how well the cache performs and to the memory available.
+///
+/// The capacity is doubled if the hit rate since the last adaptation dropped below the target
+/// while entries had to be evicted, i.e. if the working set does not fit into the cache,
+/// and it is halved under memory pressure, always staying within the configured limits.
+class AdaptiveCapacity
+{
+  public:
+    struct Limits
+    {
+        size_t minimum;
+        size_t maximum;
+        double targetHitRate = 0.95;
+    };
+
+    /// Number of lookups that must have been recorded for the hit rate to be considered.
+    static constexpr uint64_t MinimumLookups = 100;
+
+    AdaptiveCapacity(size_t initial, Limits limits) noexcept;
+
+    [[nodiscard]] size_t value() const noexcept { return _value; }
+    [[nodiscard]] Limits const& limits() const noexcept { return _limits; }
+
+    /// Accounts the given stats of the cache for the next adaptation.
+    void record(LRUHashtableStats stats) noexcept;
+
+    /// Adapts the capacity to the stats recorded since the last adaptation, and starts recording anew.
+    ///
+    /// @returns the new capacity.
+    size_t adapt(bool memoryPressure) noexcept;
+
+  private:
+    size_t _value;
+    Limits _limits;
+    uint64_t _hits = 0;
+    uint64_t _misses = 0;
+    uint64_t _evictions = 0;
+};
+
+/// Parses the "some avg10" value of Linux' pressure stall information (PSI), e.g. of
+/// /proc/pressure/memory, being the share in percent of the last 10 seconds in which
+/// at least one task was stalled.
+[[nodiscard]] std::optional<double> parsePressureStall(std::string_view text) noexcept;
+
+/// Tests whether the memory cgroup of this process, or the system as a whole, is under memory pressure,
+/// i.e. tasks were stalled waiting for memory for at least @p thresholdPercent of the last 10 seconds.
+///
+/// Always false where the pressure stall information is not available.
+[[nodiscard]] bool underMemoryPressure(double thresholdPercent = 10.0);
+
+/// Returns the memory freed on the heap back to the operating system, where the allocator supports it
+/// (malloc_trim() of glibc), rather than keeping it around for future allocations.
+void releaseFreeHeapMemory() noexcept;
+
+} // namespace crispy
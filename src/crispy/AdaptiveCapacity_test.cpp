@@ -0,0 +1,70 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <crispy/AdaptiveCapacity.h>
+
+#include <catch2/catch.hpp>
+
+using crispy::AdaptiveCapacity;
+using crispy::LRUHashtableStats;
+
+TEST_CASE("AdaptiveCapacity.grow", "[AdaptiveCapacity]")
+{
+    auto capacity = AdaptiveCapacity(100, { 50, 300, 0.9 });
+
+    // Too few lookups to judge the hit rate.
+    capacity.record(LRUHashtableStats { 10, 40, 5 });
+    CHECK(capacity.adapt(false) == 100);
+
+    // Good hit rate.
+    capacity.record(LRUHashtableStats { 950, 50, 50 });
+    CHECK(capacity.adapt(false) == 100);
+
+    // Bad hit rate, but nothing evicted, so the cache is merely warming up.
+    capacity.record(LRUHashtableStats { 50, 100, 0 });
+    CHECK(capacity.adapt(false) == 100);
+
+    capacity.record(LRUHashtableStats { 50, 100, 100 });
+    CHECK(capacity.adapt(false) == 200);
+
+    capacity.record(LRUHashtableStats { 50, 100, 100 });
+    CHECK(capacity.adapt(false) == 300);
+}
+
+TEST_CASE("AdaptiveCapacity.shrink", "[AdaptiveCapacity]")
+{
+    auto capacity = AdaptiveCapacity(400, { 50, 300 });
+    CHECK(capacity.value() == 300);
+
+    // Memory pressure takes precedence over the hit rate.
+    capacity.record(LRUHashtableStats { 50, 100, 100 });
+    CHECK(capacity.adapt(true) == 150);
+    CHECK(capacity.adapt(true) == 75);
+    CHECK(capacity.adapt(true) == 50);
+
+    // Recorded stats are consumed by each adaptation.
+    capacity.record(LRUHashtableStats { 50, 100, 100 });
+    CHECK(capacity.adapt(false) == 100);
+    CHECK(capacity.adapt(false) == 100);
+}
+
+TEST_CASE("AdaptiveCapacity.parsePressureStall", "[AdaptiveCapacity]")
+{
+    CHECK(crispy::parsePressureStall("some avg10=12.50 avg60=1.00 avg300=0.20 total=123\n"
+                                     "full avg10=3.00 avg60=0.00 avg300=0.00 total=45\n")
+          == 12.5);
+    CHECK(crispy::parsePressureStall("some avg10=0.00 avg60=0.00 avg300=0.00 total=0") == 0.0);
+    CHECK(!crispy::parsePressureStall("").has_value());
+    CHECK(!crispy::parsePressureStall("full avg10=3.00").has_value());
+    CHECK(!crispy::parsePressureStall("some avg10=x").has_value());
+}
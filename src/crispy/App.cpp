@@ -12,6 +12,7 @@
  * limitations under the License.
  */
 #include <crispy/App.h>
+#include <crispy/StartupTrace.h>
 #include <crispy/indexed.h>
 #include <crispy/logstore.h>
 #include <crispy/utils.h>
@@ -220,9 +221,11 @@ int App::run(int argc, char const* argv[])
     {
         customizeLogStoreOutput();
 
+        auto startupPhase = optional<StartupTrace::Scope>("Parse command line");
         syntax_ = parameterDefinition();
 
         optional<CLI::FlagStore> flagsOpt = CLI::parse(syntax_.value(), argc, argv);
+        startupPhase.reset();
         if (!flagsOpt.has_value())
         {
             std::cerr << "Failed to parse command line parameters.\n";
@@ -13,7 +13,9 @@
  */
 #pragma once
 
+#include <crispy/HugePages.h>
 #include <crispy/logstore.h>
+#include <crispy/utils.h>
 
 #include <fmt/format.h>
 
@@ -26,6 +28,7 @@
 #include <cstdlib>
 #include <functional>
 #include <iterator>
+#include <limits>
 #include <list>
 #include <memory>
 #include <mutex>
@@ -75,7 +78,13 @@ class BufferObject: public std::enable_shared_from_this<BufferObject<T>>
     explicit BufferObject(size_t capacity) noexcept;
     ~BufferObject();
 
-    static BufferObjectPtr<T> create(size_t capacity, BufferObjectRelease<T> release = {});
+    /// Creates a buffer object of at least the given capacity.
+    ///
+    /// @param hugePages whether to back the buffer object by transparent huge pages where available,
+    ///                  see allocateHugePages().
+    static BufferObjectPtr<T> create(size_t capacity,
+                                     BufferObjectRelease<T> release = {},
+                                     bool hugePages = false);
 
     void reset() noexcept;
 
@@ -139,34 +148,61 @@ class BufferObject: public std::enable_shared_from_this<BufferObject<T>>
     std::mutex mutex_;
 };
 
+/// Statistics of a BufferObjectPool, e.g. for diagnostic dumps.
+struct BufferObjectPoolStats
+{
+    std::size_t liveBuffers = 0;    //!< number of buffer objects currently in use
+    std::size_t unusedBuffers = 0;  //!< number of buffer objects waiting to be recycled
+    std::size_t bufferCapacity = 0; //!< capacity of each buffer object in bytes
+
+    /// Number of bytes held by the buffer objects currently in use.
+    [[nodiscard]] std::size_t bytesPinned() const noexcept { return liveBuffers * bufferCapacity; }
+};
+
 /**
  * BufferObjectPool manages reusable BufferObject objects.
  *
  * BufferObject objects that are about to be disposed
  * are not gettings its resources deleted but ownership moved
  * back to BufferObjectPool.
+ *
+ * Buffer objects may be allocated and released from different threads,
+ * e.g. by the PTY reader thread and the thread parsing its output.
  */
 template <typename T>
 class BufferObjectPool
 {
   public:
-    explicit BufferObjectPool(size_t bufferSize = 4096);
+    explicit BufferObjectPool(size_t bufferSize = 4096, bool hugePages = false);
     ~BufferObjectPool();
 
+    /// Whether buffer objects created from now on are backed by transparent huge pages where available.
+    void setHugePages(bool _enabled) noexcept;
+    [[nodiscard]] bool hugePages() const noexcept;
+
     void releaseUnusedBuffers();
     [[nodiscard]] size_t unusedBuffers() const noexcept;
+    [[nodiscard]] BufferObjectPoolStats stats() const noexcept;
     [[nodiscard]] BufferObjectPtr<T> allocateBufferObject();
 
   private:
     void release(BufferObject<T>* ptr);
 
+    mutable std::mutex lock_;
     bool reuseBuffers_ = true;
+    bool hugePages_;
     size_t bufferSize_;
+    size_t bufferCapacity_ = 0;
+    size_t totalBuffers_ = 0; // buffer objects created by this pool and not yet destroyed
     std::list<BufferObjectPtr<T>> unusedBuffers_;
 };
 
 /**
  * BufferFragment safely holds a reference to a region of BufferObject.
+ *
+ * The region is stored as 32-bit offset and size relative to the buffer object rather than as a span,
+ * as each trivial grid line holds a fragment, which is a noticeable part of the per-line overhead
+ * with a large scrollback.
  */
 template <typename T>
 class BufferFragment
@@ -182,35 +218,52 @@ class BufferFragment
     BufferFragment& operator=(BufferFragment&&) noexcept = default;
     BufferFragment& operator=(BufferFragment const&) noexcept = default;
 
-    void reset() noexcept { region_ = {}; }
+    void reset() noexcept
+    {
+        offset_ = 0;
+        size_ = 0;
+    }
+
+    void growBy(std::size_t byteCount) noexcept { size_ += static_cast<uint32_t>(byteCount); }
+
+    /// Returns a fragment for the sub-region [offset, offset + count) of this fragment,
+    /// sharing ownership of the same underlying buffer object.
+    [[nodiscard]] BufferFragment subfragment(std::size_t offset, std::size_t count) const noexcept
+    {
+        assert(offset + count <= size_);
+        return BufferFragment(buffer_, span().subspan(offset, count));
+    }
 
-    void growBy(std::size_t byteCount) noexcept
+    /// Tests whether the given fragment starts exactly where this fragment ends
+    /// within the same buffer object.
+    [[nodiscard]] bool isContiguousWith(BufferFragment const& next) const noexcept
     {
-        region_ = span_type(region_.data(), region_.size() + byteCount);
+        return buffer_ && buffer_ == next.buffer_ && offset_ + size_ == next.offset_;
     }
 
     [[nodiscard]] std::basic_string_view<T> view() const noexcept
     {
-        return std::basic_string_view<T>(region_.data(), region_.size());
+        return std::basic_string_view<T>(data(), size_);
     }
 
-    [[nodiscard]] span_type span() const noexcept { return region_; }
+    [[nodiscard]] span_type span() const noexcept { return span_type(data(), size_); }
     [[nodiscard]] BufferObjectPtr<T> const& owner() const noexcept { return buffer_; }
 
-    [[nodiscard]] bool empty() const noexcept { return region_.empty(); }
-    [[nodiscard]] std::size_t size() const noexcept { return region_.size(); }
-    [[nodiscard]] T const* data() const noexcept { return region_.data(); }
-    [[nodiscard]] T const& operator[](size_t i) const noexcept { return region_[i]; }
+    [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+    [[nodiscard]] std::size_t size() const noexcept { return size_; }
+    [[nodiscard]] T const* data() const noexcept { return buffer_ ? buffer_->data() + offset_ : nullptr; }
+    [[nodiscard]] T const& operator[](size_t i) const noexcept { return data()[i]; }
 
-    [[nodiscard]] decltype(auto) begin() noexcept { return region_.begin(); }
-    [[nodiscard]] decltype(auto) end() noexcept { return region_.end(); }
+    [[nodiscard]] T const* begin() const noexcept { return data(); }
+    [[nodiscard]] T const* end() const noexcept { return data() + size_; }
 
-    [[nodiscard]] std::size_t startOffset() const noexcept;
-    [[nodiscard]] std::size_t endOffset() const noexcept;
+    [[nodiscard]] std::size_t startOffset() const noexcept { return offset_; }
+    [[nodiscard]] std::size_t endOffset() const noexcept { return offset_ + size_; }
 
   private:
     BufferObjectPtr<T> buffer_;
-    span_type region_;
+    uint32_t offset_ = 0;
+    uint32_t size_ = 0;
 };
 
 template <typename T>
@@ -248,15 +301,27 @@ BufferObject<T>::~BufferObject()
 }
 
 template <typename T>
-BufferObjectPtr<T> BufferObject<T>::create(size_t capacity, BufferObjectRelease<T> release)
+BufferObjectPtr<T> BufferObject<T>::create(size_t capacity, BufferObjectRelease<T> release, bool hugePages)
 {
+    // Buffer objects that are not owned by a pool are simply destroyed once unreferenced.
+    if (!release)
+        release = [](BufferObject<T>* ptr) {
+#if defined(BUFFER_OBJECT_INLINE)
+            std::destroy_n(ptr, 1);
+            free(ptr);
+#else
+            delete ptr;
+#endif
+        };
+
 #if defined(BUFFER_OBJECT_INLINE)
     auto const totalCapacity = nextPowerOfTwo(static_cast<uint32_t>(sizeof(BufferObject) + capacity));
     auto const nettoCapacity = totalCapacity - sizeof(BufferObject);
-    auto ptr = (BufferObject*) malloc(totalCapacity);
+    auto ptr = (BufferObject*) (hugePages ? allocateHugePages(totalCapacity) : malloc(totalCapacity));
     new (ptr) BufferObject(nettoCapacity);
     return BufferObjectPtr<T>(ptr, std::move(release));
 #else
+    (void) hugePages;
     return BufferObjectPtr<T>(new BufferObject<T>(nextPowerOfTwo(capacity)), std::move(release));
 #endif
 }
@@ -327,57 +392,94 @@ inline BufferFragment<T> BufferObject<T>::ref(std::size_t offset, std::size_t si
 // {{{ BufferFragment implementation
 template <typename T>
 BufferFragment<T>::BufferFragment(BufferObjectPtr<T> buffer, gsl::span<T const> region) noexcept:
-    buffer_ { std::move(buffer) }, region_ { region }
+    buffer_ { std::move(buffer) },
+    offset_ { static_cast<uint32_t>(std::distance((T const*) buffer_->data(), region.data())) },
+    size_ { static_cast<uint32_t>(region.size()) }
 {
-    assert(buffer_->begin() <= region_.data() && (region_.data() + region_.size()) <= buffer_->end());
+    assert(buffer_->begin() <= region.data() && (region.data() + region.size()) <= buffer_->end());
+    assert(buffer_->capacity() <= std::numeric_limits<uint32_t>::max());
 }
+// }}}
 
+// {{{ BufferObjectPool implementation
 template <typename T>
-inline std::size_t BufferFragment<T>::startOffset() const noexcept
+BufferObjectPool<T>::BufferObjectPool(size_t bufferSize, bool hugePages):
+    hugePages_ { hugePages }, bufferSize_ { bufferSize }
 {
-    return static_cast<std::size_t>(std::distance((T const*) buffer_->data(), (T const*) data()));
+    BufferObjectLog()("Creating BufferObject pool with chunk size {}",
+                      crispy::humanReadableBytes(bufferSize));
 }
 
 template <typename T>
-inline std::size_t BufferFragment<T>::endOffset() const noexcept
+BufferObjectPool<T>::~BufferObjectPool()
 {
-    return startOffset() + size();
+    auto unused = std::list<BufferObjectPtr<T>> {};
+    {
+        auto const _ = std::lock_guard { lock_ };
+        reuseBuffers_ = false;
+        unused.swap(unusedBuffers_);
+    }
 }
-// }}}
 
-// {{{ BufferObjectPool implementation
 template <typename T>
-BufferObjectPool<T>::BufferObjectPool(size_t bufferSize): bufferSize_ { bufferSize }
+void BufferObjectPool<T>::setHugePages(bool _enabled) noexcept
 {
-    BufferObjectLog()("Creating BufferObject pool with chunk size {}",
-                      crispy::humanReadableBytes(bufferSize));
+    auto const _ = std::lock_guard { lock_ };
+    hugePages_ = _enabled;
 }
 
 template <typename T>
-BufferObjectPool<T>::~BufferObjectPool()
+bool BufferObjectPool<T>::hugePages() const noexcept
 {
-    reuseBuffers_ = false;
+    auto const _ = std::lock_guard { lock_ };
+    return hugePages_;
 }
 
 template <typename T>
 size_t BufferObjectPool<T>::unusedBuffers() const noexcept
 {
+    auto const _ = std::lock_guard { lock_ };
     return unusedBuffers_.size();
 }
 
+template <typename T>
+BufferObjectPoolStats BufferObjectPool<T>::stats() const noexcept
+{
+    auto const _ = std::lock_guard { lock_ };
+    auto result = BufferObjectPoolStats {};
+    result.liveBuffers = totalBuffers_ - unusedBuffers_.size();
+    result.unusedBuffers = unusedBuffers_.size();
+    result.bufferCapacity = bufferCapacity_;
+    return result;
+}
+
 template <typename T>
 void BufferObjectPool<T>::releaseUnusedBuffers()
 {
-    reuseBuffers_ = false;
-    unusedBuffers_.clear();
+    // Destroy the unused buffers without holding the lock, as destroying them calls back into release().
+    auto unused = std::list<BufferObjectPtr<T>> {};
+    {
+        auto const _ = std::lock_guard { lock_ };
+        reuseBuffers_ = false;
+        unused.swap(unusedBuffers_);
+    }
+    unused.clear();
+
+    auto const _ = std::lock_guard { lock_ };
     reuseBuffers_ = true;
 }
 
 template <typename T>
 BufferObjectPtr<T> BufferObjectPool<T>::allocateBufferObject()
 {
+    auto const _ = std::lock_guard { lock_ };
     if (unusedBuffers_.empty())
-        return BufferObject<T>::create(bufferSize_, [this](auto p) { release(p); });
+    {
+        auto buffer = BufferObject<T>::create(bufferSize_, [this](auto p) { release(p); }, hugePages_);
+        bufferCapacity_ = buffer->capacity();
+        ++totalBuffers_;
+        return buffer;
+    }
 
     BufferObjectPtr<T> buffer = std::move(unusedBuffers_.front());
     if (BufferObjectLog)
@@ -389,23 +491,49 @@ BufferObjectPtr<T> BufferObjectPool<T>::allocateBufferObject()
 template <typename T>
 void BufferObjectPool<T>::release(BufferObject<T>* ptr)
 {
-    if (reuseBuffers_)
     {
-        if (BufferObjectLog)
-            BufferObjectLog()("Releasing BufferObject from pool: @{}", (void*) ptr);
-        ptr->reset();
-        unusedBuffers_.emplace_back(ptr, [this](auto p) { release(p); });
+        auto const _ = std::lock_guard { lock_ };
+        if (reuseBuffers_)
+        {
+            if (BufferObjectLog)
+                BufferObjectLog()("Releasing BufferObject from pool: @{}", (void*) ptr);
+            ptr->reset();
+            unusedBuffers_.emplace_back(ptr, [this](auto p) { release(p); });
+            return;
+        }
+        --totalBuffers_;
     }
-    else
-    {
+
 #if defined(BUFFER_OBJECT_INLINE)
-        std::destroy_n(ptr, 1);
-        free(ptr);
+    std::destroy_n(ptr, 1);
+    free(ptr);
 #else
-        delete ptr;
+    delete ptr;
 #endif
-    }
 }
 // }}}
 
 } // namespace crispy
+
+namespace fmt // {{{
+{
+template <>
+struct formatter<crispy::BufferObjectPoolStats>
+{
+    template <typename ParseContext>
+    constexpr auto parse(ParseContext& ctx)
+    {
+        return ctx.begin();
+    }
+    template <typename FormatContext>
+    auto format(crispy::BufferObjectPoolStats const& stats, FormatContext& ctx)
+    {
+        return fmt::format_to(ctx.out(),
+                              "{} in use ({} pinned), {} unused",
+                              stats.liveBuffers,
+                              crispy::humanReadableBytes(stats.bytesPinned()),
+                              stats.unusedBuffers);
+    }
+};
+} // namespace fmt
+// }}}
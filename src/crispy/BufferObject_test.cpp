@@ -16,7 +16,36 @@
 
 #include <catch2/catch.hpp>
 
+#include <cstdint>
+#include <string_view>
+
+using namespace std::string_view_literals;
+
 TEST_CASE("BufferObject", "[BufferObject]")
 {
     // TODO
 }
+
+TEST_CASE("BufferObjectPool.hugePages", "[BufferObject]")
+{
+    auto pool = crispy::BufferObjectPool<char>(1024 * 1024, true);
+    CHECK(pool.hugePages());
+    {
+        auto buffer = pool.allocateBufferObject();
+        crispy::prefaultPages(buffer->data(), buffer->capacity());
+        auto const text = buffer->writeAtEnd("Hello"sv);
+        buffer->advance(text.size());
+        CHECK(buffer->ref(0, 5).view() == "Hello"sv);
+#if defined(__linux__)
+        CHECK(reinterpret_cast<uintptr_t>(buffer.get()) % crispy::HugePageSize == 0);
+#endif
+    }
+    CHECK(pool.stats().unusedBuffers == 1);
+
+    // Buffer objects are recycled regardless of how they have been allocated.
+    pool.setHugePages(false);
+    auto const buffer = pool.allocateBufferObject();
+    CHECK(buffer->bytesUsed() == 0);
+    CHECK(pool.stats().liveBuffers == 1);
+    CHECK(pool.stats().unusedBuffers == 0);
+}
@@ -0,0 +1,86 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <crispy/CacheStats.h>
+
+#include <algorithm>
+#include <mutex>
+
+namespace crispy
+{
+
+namespace
+{
+    struct Registry
+    {
+        std::mutex mutex;
+        std::vector<CacheStats const*> caches;
+    };
+
+    Registry& registry()
+    {
+        // Never destroyed, as caches may be destroyed as late as during static destruction.
+        static auto* instance = new Registry();
+        return *instance;
+    }
+} // namespace
+
+CacheStats::CacheStats(std::string _name): _name { std::move(_name) }
+{
+    auto& r = registry();
+    auto const _ = std::lock_guard { r.mutex };
+    r.caches.push_back(this);
+}
+
+CacheStats::~CacheStats()
+{
+    auto& r = registry();
+    auto const _ = std::lock_guard { r.mutex };
+    r.caches.erase(std::find(r.caches.begin(), r.caches.end(), this));
+}
+
+void CacheStats::update(LRUHashtableStats stats, size_t size, size_t capacity) noexcept
+{
+    _hits.fetch_add(stats.hits, std::memory_order_relaxed);
+    _misses.fetch_add(stats.misses, std::memory_order_relaxed);
+    _evictions.fetch_add(stats.recycles, std::memory_order_relaxed);
+    _size.store(size, std::memory_order_relaxed);
+    _capacity.store(capacity, std::memory_order_relaxed);
+}
+
+std::vector<CacheStats::Snapshot> CacheStats::collect()
+{
+    auto result = std::vector<Snapshot> {};
+
+    auto& r = registry();
+    auto const _ = std::lock_guard { r.mutex };
+    for (CacheStats const* cache: r.caches)
+    {
+        auto i = std::find_if(
+            result.begin(), result.end(), [&](Snapshot const& s) { return s.name == cache->_name; });
+        if (i == result.end())
+            i = result.insert(result.end(), Snapshot { cache->_name });
+        i->hits += cache->_hits.load(std::memory_order_relaxed);
+        i->misses += cache->_misses.load(std::memory_order_relaxed);
+        i->evictions += cache->_evictions.load(std::memory_order_relaxed);
+        i->size += cache->_size.load(std::memory_order_relaxed);
+        i->capacity += cache->_capacity.load(std::memory_order_relaxed);
+    }
+
+    std::sort(result.begin(), result.end(), [](Snapshot const& a, Snapshot const& b) {
+        return a.name < b.name;
+    });
+    return result;
+}
+
+} // namespace crispy
@@ -0,0 +1,100 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <crispy/StrongLRUHashtable.h>
+
+#include <fmt/format.h>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace crispy
+{
+
+/// Running totals of a cache's hits, misses and evictions, registered process-wide by name,
+/// such that the statistics of all caches can be reported from any thread (see collect()).
+///
+/// The owner of the cache periodically adds the stats fetched from its cache on the thread
+/// that uses the cache, as the caches themselves are not thread-safe.
+/// Caches of the same name, e.g. one per terminal session, are reported as one.
+class CacheStats
+{
+  public:
+    struct Snapshot
+    {
+        std::string name;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        size_t size = 0;
+        size_t capacity = 0; // 0 if the cache is not limited by its number of entries
+    };
+
+    explicit CacheStats(std::string _name);
+    ~CacheStats();
+
+    CacheStats(CacheStats const&) = delete;
+    CacheStats& operator=(CacheStats const&) = delete;
+
+    [[nodiscard]] std::string const& name() const noexcept { return _name; }
+
+    /// Adds the given stats, and updates the cache's current number of entries and capacity.
+    void update(LRUHashtableStats stats, size_t size, size_t capacity) noexcept;
+
+    /// @returns the totals of all registered caches, ordered by name.
+    [[nodiscard]] static std::vector<Snapshot> collect();
+
+  private:
+    std::string _name;
+    std::atomic<uint64_t> _hits = 0;
+    std::atomic<uint64_t> _misses = 0;
+    std::atomic<uint64_t> _evictions = 0;
+    std::atomic<size_t> _size = 0;
+    std::atomic<size_t> _capacity = 0;
+};
+
+} // namespace crispy
+
+// {{{ fmt
+namespace fmt
+{
+template <>
+struct formatter<crispy::CacheStats::Snapshot>
+{
+    template <typename ParseContext>
+    constexpr auto parse(ParseContext& ctx)
+    {
+        return ctx.begin();
+    }
+    template <typename FormatContext>
+    auto format(crispy::CacheStats::Snapshot const& stats, FormatContext& ctx)
+    {
+        auto const lookups = stats.hits + stats.misses;
+        return fmt::format_to(
+            ctx.out(),
+            "{}: {}{} entries, {} hits, {} misses, {} evictions, {:.3}% hit rate",
+            stats.name,
+            stats.size,
+            stats.capacity ? fmt::format("/{}", stats.capacity) : std::string(),
+            stats.hits,
+            stats.misses,
+            stats.evictions,
+            lookups != 0 ? 100.0 * (static_cast<double>(stats.hits) / static_cast<double>(lookups)) : 0.0);
+    }
+};
+} // namespace fmt
+// }}}
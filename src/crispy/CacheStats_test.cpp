@@ -0,0 +1,59 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <crispy/CacheStats.h>
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <optional>
+
+using crispy::CacheStats;
+using crispy::LRUHashtableStats;
+
+namespace
+{
+std::optional<CacheStats::Snapshot> find(std::string const& _name)
+{
+    auto const all = CacheStats::collect();
+    auto const i =
+        std::find_if(all.begin(), all.end(), [&](CacheStats::Snapshot const& s) { return s.name == _name; });
+    if (i == all.end())
+        return std::nullopt;
+    return *i;
+}
+} // namespace
+
+TEST_CASE("CacheStats.collect", "[CacheStats]")
+{
+    CHECK(!find("test cache").has_value());
+    {
+        auto a = CacheStats("test cache");
+        auto b = CacheStats("test cache");
+        a.update(LRUHashtableStats { 3, 1, 0 }, 4, 10);
+        a.update(LRUHashtableStats { 2, 0, 1 }, 5, 10);
+        b.update(LRUHashtableStats { 1, 1, 1 }, 2, 10);
+
+        // Caches of the same name are reported as one.
+        auto const stats = find("test cache");
+        REQUIRE(stats.has_value());
+        CHECK(stats->hits == 6);
+        CHECK(stats->misses == 2);
+        CHECK(stats->evictions == 2);
+        CHECK(stats->size == 7);
+        CHECK(stats->capacity == 20);
+        CHECK(fmt::format("{}", *stats)
+              == "test cache: 7/20 entries, 6 hits, 2 misses, 2 evictions, 75% hit rate");
+    }
+    CHECK(!find("test cache").has_value());
+}
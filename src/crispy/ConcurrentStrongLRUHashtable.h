@@ -0,0 +1,300 @@
+/**
+ * This file is part of the "contour" project.
+ *   Copyright (c) 2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <crispy/StrongLRUHashtable.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <shared_mutex>
+#include <string>
+
+namespace crispy
+{
+
+// Number of independently locked shards a ConcurrentStrongLRUHashtable is split into.
+struct ShardCount
+{
+    uint32_t value;
+};
+
+// Thread-safe LRU hashtable, sharded into StrongLRUHashtable instances of their own lock and LRU chain.
+//
+// Lookups only take their shard's lock shared, so that concurrent readers never wait for each other.
+// A hit is moved to the front of its shard's LRU chain only if the shard's lock can be taken
+// exclusively right away, which makes the LRU order approximate under contention.
+//
+// Values are handed out by copy (or visited while the shard is locked),
+// as references would not outlive the lock.
+template <typename Value>
+class ConcurrentStrongLRUHashtable
+{
+  public:
+    using Shard = StrongLRUHashtable<Value>;
+
+    /// Constructs a hashtable of @p hashCount hash slots and @p entryCount entries,
+    /// evenly split across @p shardCount shards.
+    ConcurrentStrongLRUHashtable(StrongHashtableSize hashCount,
+                                 LRUCapacity entryCount,
+                                 ShardCount shardCount,
+                                 std::string name = "");
+
+    [[nodiscard]] size_t shardCount() const noexcept { return _shardCount; }
+
+    /// Returns the actual number of entries currently hold in all shards.
+    [[nodiscard]] size_t size() const;
+
+    /// Returns the maximum number of entries that can be stored in all shards.
+    [[nodiscard]] size_t capacity() const noexcept;
+
+    /// Returns the stats gathered across all shards and clears them.
+    LRUHashtableStats fetchAndClearStats();
+
+    /// Clears all entries from all shards.
+    void clear();
+
+    /// Deletes the hash entry and its associated value.
+    void remove(StrongHash const& hash);
+
+    /// Tests for the exitence of the given hash key, without changing LRU order.
+    [[nodiscard]] bool contains(StrongHash const& hash) const;
+
+    /// Returns a copy of the value for the given hash key if found, std::nullopt otherwise.
+    [[nodiscard]] std::optional<Value> get(StrongHash const& hash);
+
+    /// Invokes @p visitor with the value for the given hash key while its shard is locked shared.
+    ///
+    /// @retval true the hash key was found and visited.
+    template <typename Visitor>
+    bool visit(StrongHash const& hash, Visitor visitor);
+
+    /// Assignes the given value to the given hash key.
+    void emplace(StrongHash const& hash, Value value);
+
+    /// Conditionally creates a new entry iff its hash key was not present yet.
+    ///
+    /// @retval true the hash key did not exist yet, a new value was constructed.
+    template <typename ValueConstructFn>
+    bool try_emplace(StrongHash const& hash, ValueConstructFn constructValue);
+
+    /// Returns a copy of either the existing value by the given hash key,
+    /// or of a newly created one by invoking constructValue().
+    ///
+    /// constructValue() is invoked with the shard locked exclusively, and the index of the entry in its shard.
+    template <typename ValueConstructFn>
+    [[nodiscard]] Value get_or_emplace(StrongHash const& hash, ValueConstructFn constructValue);
+
+    void inspect(std::ostream& output) const;
+
+  private:
+    // Aligned to a cache line each, so that shards locked by different threads do not share one.
+    struct alignas(64) ShardState
+    {
+        mutable std::shared_mutex lock;
+        typename Shard::Ptr table;
+
+        // Lookups under the shared lock count their hits and misses here,
+        // as the shard's own stats must not be modified concurrently.
+        std::atomic<uint32_t> hits = 0;
+        std::atomic<uint32_t> misses = 0;
+    };
+
+    ShardState& shardOf(StrongHash const& hash) noexcept
+    {
+        // The middle bits of the product are used, as the shard's hash slot is chosen by the lower bits.
+        return _shards[((hash.value[0] * 0x9E3779B1u) >> 16) & _shardMask];
+    }
+
+    ShardState const& shardOf(StrongHash const& hash) const noexcept
+    {
+        return const_cast<ConcurrentStrongLRUHashtable*>(this)->shardOf(hash);
+    }
+
+    // Moves the given hash key to the front of its shard's LRU chain, unless that would block.
+    static void tryTouch(ShardState& shard, StrongHash const& hash) noexcept
+    {
+        auto _l = std::unique_lock { shard.lock, std::try_to_lock };
+        if (_l.owns_lock())
+            shard.table->touch(hash);
+    }
+
+    uint32_t _shardCount;
+    uint32_t _shardMask;
+    std::string _name;
+    std::unique_ptr<ShardState[]> _shards;
+};
+
+// {{{ implementation
+
+template <typename Value>
+ConcurrentStrongLRUHashtable<Value>::ConcurrentStrongLRUHashtable(StrongHashtableSize hashCount,
+                                                                  LRUCapacity entryCount,
+                                                                  ShardCount shardCount,
+                                                                  std::string name):
+    _shardCount { std::max(1u, nextPowerOfTwo(shardCount.value)) },
+    _shardMask { _shardCount - 1 },
+    _name { std::move(name) },
+    _shards { std::make_unique<ShardState[]>(_shardCount) }
+{
+    Require(_shardCount <= 0x10000);
+
+    auto const shardHashCount = StrongHashtableSize { std::max(1u, hashCount.value / _shardCount) };
+    auto const shardEntryCount = LRUCapacity { std::max(2u, entryCount.value / _shardCount) };
+    for (uint32_t i = 0; i < _shardCount; ++i)
+        _shards[i].table = Shard::create(shardHashCount, shardEntryCount, fmt::format("{}[{}]", _name, i));
+}
+
+template <typename Value>
+size_t ConcurrentStrongLRUHashtable<Value>::size() const
+{
+    size_t total = 0;
+    for (uint32_t i = 0; i < _shardCount; ++i)
+    {
+        auto _l = std::shared_lock { _shards[i].lock };
+        total += _shards[i].table->size();
+    }
+    return total;
+}
+
+template <typename Value>
+size_t ConcurrentStrongLRUHashtable<Value>::capacity() const noexcept
+{
+    // Capacities are constant, so there is no need to lock.
+    return _shardCount * _shards[0].table->capacity();
+}
+
+template <typename Value>
+LRUHashtableStats ConcurrentStrongLRUHashtable<Value>::fetchAndClearStats()
+{
+    auto total = LRUHashtableStats {};
+    for (uint32_t i = 0; i < _shardCount; ++i)
+    {
+        auto& shard = _shards[i];
+        auto _l = std::unique_lock { shard.lock };
+        // Hits and misses of the shard itself are also counted by the lookups through this class,
+        // so only its evictions are taken.
+        total.recycles += shard.table->fetchAndClearStats().recycles;
+        total.hits += shard.hits.exchange(0, std::memory_order_relaxed);
+        total.misses += shard.misses.exchange(0, std::memory_order_relaxed);
+    }
+    return total;
+}
+
+template <typename Value>
+void ConcurrentStrongLRUHashtable<Value>::clear()
+{
+    for (uint32_t i = 0; i < _shardCount; ++i)
+    {
+        auto _l = std::unique_lock { _shards[i].lock };
+        _shards[i].table->clear();
+    }
+}
+
+template <typename Value>
+void ConcurrentStrongLRUHashtable<Value>::remove(StrongHash const& hash)
+{
+    auto& shard = shardOf(hash);
+    auto _l = std::unique_lock { shard.lock };
+    shard.table->remove(hash);
+}
+
+template <typename Value>
+bool ConcurrentStrongLRUHashtable<Value>::contains(StrongHash const& hash) const
+{
+    auto const& shard = shardOf(hash);
+    auto _l = std::shared_lock { shard.lock };
+    return shard.table->try_peek(hash) != nullptr;
+}
+
+template <typename Value>
+std::optional<Value> ConcurrentStrongLRUHashtable<Value>::get(StrongHash const& hash)
+{
+    auto result = std::optional<Value> {};
+    visit(hash, [&](Value const& value) { result.emplace(value); });
+    return result;
+}
+
+template <typename Value>
+template <typename Visitor>
+bool ConcurrentStrongLRUHashtable<Value>::visit(StrongHash const& hash, Visitor visitor)
+{
+    auto& shard = shardOf(hash);
+    {
+        auto _l = std::shared_lock { shard.lock };
+        Value const* value = shard.table->try_peek(hash);
+        if (!value)
+        {
+            shard.misses.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        shard.hits.fetch_add(1, std::memory_order_relaxed);
+        visitor(*value);
+    }
+    tryTouch(shard, hash);
+    return true;
+}
+
+template <typename Value>
+void ConcurrentStrongLRUHashtable<Value>::emplace(StrongHash const& hash, Value value)
+{
+    auto& shard = shardOf(hash);
+    auto _l = std::unique_lock { shard.lock };
+    shard.table->emplace(hash, std::move(value));
+}
+
+template <typename Value>
+template <typename ValueConstructFn>
+bool ConcurrentStrongLRUHashtable<Value>::try_emplace(StrongHash const& hash, ValueConstructFn constructValue)
+{
+    auto& shard = shardOf(hash);
+    auto _l = std::unique_lock { shard.lock };
+    auto const created = shard.table->try_emplace(hash, std::move(constructValue));
+    (created ? shard.misses : shard.hits).fetch_add(1, std::memory_order_relaxed);
+    return created;
+}
+
+template <typename Value>
+template <typename ValueConstructFn>
+Value ConcurrentStrongLRUHashtable<Value>::get_or_emplace(StrongHash const& hash,
+                                                          ValueConstructFn constructValue)
+{
+    if (auto value = get(hash); value.has_value())
+        return std::move(*value);
+
+    // Another thread may have created the entry in the meantime, which get_or_emplace() accounts for.
+    auto& shard = shardOf(hash);
+    auto _l = std::unique_lock { shard.lock };
+    return shard.table->get_or_emplace(hash, std::move(constructValue));
+}
+
+template <typename Value>
+void ConcurrentStrongLRUHashtable<Value>::inspect(std::ostream& output) const
+{
+    output << fmt::format("Concurrent LRU hashtable \"{}\": {} shards\n", _name, _shardCount);
+    for (uint32_t i = 0; i < _shardCount; ++i)
+    {
+        auto _l = std::shared_lock { _shards[i].lock };
+        _shards[i].table->inspect(output);
+    }
+}
+
+// }}}
+
+} // namespace crispy
@@ -0,0 +1,98 @@
+/**
+ * This file is part of the "contour" project.
+ *   Copyright (c) 2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <crispy/ConcurrentStrongLRUHashtable.h>
+
+#include <catch2/catch.hpp>
+
+#include <thread>
+#include <vector>
+
+using namespace crispy;
+using namespace std;
+
+namespace
+{
+StrongHash h(int v)
+{
+    return StrongHash::compute(v);
+}
+} // namespace
+
+TEST_CASE("ConcurrentStrongLRUHashtable.get_and_emplace", "[lrucache]")
+{
+    auto cache = ConcurrentStrongLRUHashtable<int>(StrongHashtableSize { 64 }, LRUCapacity { 32 }, ShardCount { 4 });
+    CHECK(cache.shardCount() == 4);
+    CHECK(cache.capacity() == 32);
+
+    for (int i = 1; i <= 10; ++i)
+        cache.emplace(h(i), 2 * i);
+    CHECK(cache.size() == 10);
+
+    for (int i = 1; i <= 10; ++i)
+        CHECK(cache.get(h(i)) == 2 * i);
+    CHECK(!cache.get(h(11)).has_value());
+    CHECK(!cache.contains(h(11)));
+
+    CHECK(cache.get_or_emplace(h(11), [](auto) { return 22; }) == 22);
+    CHECK(cache.get_or_emplace(h(11), [](auto) { return 33; }) == 22);
+    CHECK(!cache.try_emplace(h(11), [](auto) { return 44; }));
+
+    cache.remove(h(11));
+    CHECK(!cache.contains(h(11)));
+
+    cache.clear();
+    CHECK(cache.size() == 0);
+}
+
+TEST_CASE("ConcurrentStrongLRUHashtable.stats", "[lrucache]")
+{
+    auto cache = ConcurrentStrongLRUHashtable<int>(StrongHashtableSize { 8 }, LRUCapacity { 8 }, ShardCount { 2 });
+    for (int i = 0; i < 4; ++i)
+        cache.emplace(h(i), i);
+    (void) cache.fetchAndClearStats();
+
+    for (int i = 0; i < 6; ++i)
+        (void) cache.get(h(i));
+
+    auto const stats = cache.fetchAndClearStats();
+    CHECK(stats.hits == 4);
+    CHECK(stats.misses == 2);
+
+    auto const cleared = cache.fetchAndClearStats();
+    CHECK(cleared.hits == 0);
+    CHECK(cleared.misses == 0);
+}
+
+TEST_CASE("ConcurrentStrongLRUHashtable.threads", "[lrucache]")
+{
+    auto constexpr ThreadCount = 4;
+    auto constexpr KeyCount = 256;
+    auto cache = ConcurrentStrongLRUHashtable<int>(
+        StrongHashtableSize { 1024 }, LRUCapacity { 1024 }, ShardCount { 8 });
+
+    auto threads = vector<std::thread> {};
+    for (int t = 0; t < ThreadCount; ++t)
+        threads.emplace_back([&cache]() {
+            for (int round = 0; round < 4; ++round)
+                for (int i = 0; i < KeyCount; ++i)
+                    REQUIRE(cache.get_or_emplace(h(i), [i](auto) { return i * i; }) == i * i);
+        });
+    for (auto& thread: threads)
+        thread.join();
+
+    CHECK(cache.size() == KeyCount);
+    auto const stats = cache.fetchAndClearStats();
+    CHECK(stats.hits + stats.misses == ThreadCount * 4 * KeyCount);
+    CHECK(stats.recycles == 0);
+}
@@ -0,0 +1,52 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <crispy/HugePages.h>
+
+#include <cstdlib>
+
+#if defined(__linux__)
+    #include <sys/mman.h>
+#endif
+
+namespace crispy
+{
+
+void* allocateHugePages(std::size_t _bytes) noexcept
+{
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (_bytes >= HugePageSize)
+    {
+        // Rounded up, as aligned_alloc() requires a multiple of the alignment.
+        auto const alignedBytes = (_bytes + HugePageSize - 1) / HugePageSize * HugePageSize;
+        if (auto* data = std::aligned_alloc(HugePageSize, alignedBytes); data)
+        {
+            // Merely a hint, e.g. ignored if transparent huge pages are disabled system-wide.
+            (void) madvise(data, alignedBytes, MADV_HUGEPAGE);
+            return data;
+        }
+    }
+#endif
+    return std::malloc(_bytes);
+}
+
+void prefaultPages(void* _data, std::size_t _bytes) noexcept
+{
+    constexpr auto PageSize = std::size_t { 4096 };
+
+    auto* bytes = static_cast<char volatile*>(_data);
+    for (auto i = std::size_t { 0 }; i < _bytes; i += PageSize)
+        bytes[i] = 0;
+}
+
+} // namespace crispy
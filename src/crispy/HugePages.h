@@ -0,0 +1,37 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <cstddef>
+
+namespace crispy
+{
+
+/// Size of the transparent huge pages on Linux (x86-64 and most AArch64 kernels).
+constexpr std::size_t HugePageSize = 2 * 1024 * 1024;
+
+/// Allocates memory for large arenas that are streamed through at high rates, such as PTY buffer objects.
+///
+/// On Linux, allocations of at least HugePageSize are aligned to it and advised to be backed
+/// by transparent huge pages, which saves TLB misses. They are allocated as by std::malloc() otherwise.
+/// Either way, the memory is to be released by std::free().
+///
+/// @returns the allocated memory, or nullptr on failure.
+[[nodiscard]] void* allocateHugePages(std::size_t _bytes) noexcept;
+
+/// Writes to each page of the given memory, whose contents are thus undefined,
+/// such that the first writes to it later on do not page-fault each page.
+void prefaultPages(void* _data, std::size_t _bytes) noexcept;
+
+} // namespace crispy
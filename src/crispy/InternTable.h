@@ -0,0 +1,155 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace crispy
+{
+
+struct InternTableStats
+{
+    std::size_t entries = 0;  //!< number of distinct values currently referenced
+    std::size_t capacity = 0; //!< number of values the allocated chunks can hold
+    std::size_t peak = 0;     //!< highest number of values referenced at the same time
+    std::size_t bytes = 0;    //!< estimated number of bytes held by the table
+};
+
+/**
+ * Table of reference counted values, each stored only once and identified by a 32-bit ID.
+ *
+ * Entries are allocated in chunks that are never moved nor freed, so that they can be
+ * looked up by ID without locking. Interning and recycling entries is serialized.
+ * ID 0 is never handed out, such that it can denote a default value.
+ *
+ * @p Value is constructed from the @p Key it is interned by, and @p KeyOf returns that key
+ * again for a stored value (which may refer into it).
+ */
+template <typename Value, typename Key, typename KeyOf, typename Hash = std::hash<Key>>
+class InternTable
+{
+  public:
+    static constexpr size_t ChunkSize = 4096;
+    static constexpr size_t MaxChunks = 4096;
+
+    [[nodiscard]] Value const& get(uint32_t _id) const noexcept { return entry(_id).value; }
+
+    /// @returns the ID of the value of the given key with one more reference,
+    ///          or 0 if the table is exhausted.
+    uint32_t intern(Key const& _key)
+    {
+        auto const _ = std::lock_guard { mutex_ };
+
+        if (auto const i = ids_.find(_key); i != ids_.end())
+        {
+            entry(i->second).references.fetch_add(1, std::memory_order_relaxed);
+            return i->second;
+        }
+
+        auto const id = allocate();
+        if (!id)
+            return 0;
+
+        auto& e = entry(id);
+        e.value = Value(_key);
+        e.references.store(1, std::memory_order_relaxed);
+        ids_.emplace(KeyOf {}(e.value), id);
+        peak_ = std::max(peak_, ids_.size());
+        return id;
+    }
+
+    /// Adds a reference to the given ID, which must be referenced already.
+    void retain(uint32_t _id) noexcept
+    {
+        // Only ever called while holding a reference already, hence no need to synchronize with recycling.
+        entry(_id).references.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void release(uint32_t _id)
+    {
+        auto& e = entry(_id);
+        if (e.references.fetch_sub(1, std::memory_order_acq_rel) != 1)
+            return;
+
+        auto const _ = std::lock_guard { mutex_ };
+
+        // The entry may have been interned again in the meantime,
+        // or already been recycled by whoever released that reference.
+        if (e.references.load(std::memory_order_relaxed) != 0)
+            return;
+        if (auto const i = ids_.find(KeyOf {}(e.value)); i != ids_.end() && i->second == _id)
+        {
+            ids_.erase(i);
+            freeIds_.push_back(_id);
+        }
+    }
+
+    InternTableStats stats()
+    {
+        auto const _ = std::lock_guard { mutex_ };
+        auto const capacity = chunkCount_ ? chunkCount_ * ChunkSize - 1 : 0;
+        auto const bytes = chunkCount_ * ChunkSize * sizeof(Entry) + freeIds_.capacity() * sizeof(uint32_t)
+                           + ids_.size() * (sizeof(*ids_.begin()) + 2 * sizeof(void*))
+                           + ids_.bucket_count() * sizeof(void*);
+        return InternTableStats { ids_.size(), capacity, peak_, bytes };
+    }
+
+  private:
+    struct Entry
+    {
+        std::atomic<uint32_t> references = 0;
+        Value value {};
+    };
+
+    [[nodiscard]] Entry& entry(uint32_t _id) const noexcept
+    {
+        return chunks_[_id / ChunkSize].load(std::memory_order_acquire)[_id % ChunkSize];
+    }
+
+    uint32_t allocate()
+    {
+        if (!freeIds_.empty())
+        {
+            auto const id = freeIds_.back();
+            freeIds_.pop_back();
+            return id;
+        }
+
+        if (nextId_ >= chunkCount_ * ChunkSize)
+        {
+            if (chunkCount_ == MaxChunks)
+                return 0;
+            chunks_[chunkCount_++].store(new Entry[ChunkSize], std::memory_order_release);
+        }
+        return static_cast<uint32_t>(nextId_++);
+    }
+
+    std::array<std::atomic<Entry*>, MaxChunks> chunks_ {};
+    std::mutex mutex_;
+    std::unordered_map<Key, uint32_t, Hash> ids_; //!< IDs by the keys of their entries
+    std::vector<uint32_t> freeIds_;
+    size_t chunkCount_ = 0;
+    size_t nextId_ = 1; //!< ID 0 denotes the default value
+    size_t peak_ = 0;
+};
+
+} // namespace crispy
@@ -0,0 +1,134 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace crispy
+{
+
+/// Rolling window of the most recently measured durations, such as frame times,
+/// to report percentiles of.
+///
+/// Samples are recorded without locking by a single thread at a time, while any thread may
+/// take a summary() concurrently. The cost of recording a sample is that of two atomic stores.
+class LatencyHistogram
+{
+  public:
+    static constexpr size_t Capacity = 256; //!< number of most recent samples kept
+
+    using clock = std::chrono::steady_clock;
+
+    struct Summary
+    {
+        size_t count = 0; //!< number of samples summarized, at most Capacity
+        std::chrono::microseconds p50 {};
+        std::chrono::microseconds p90 {};
+        std::chrono::microseconds p99 {};
+        std::chrono::microseconds max {};
+    };
+
+    /// Records the time elapsed from construction to destruction.
+    class Measurement
+    {
+      public:
+        explicit Measurement(LatencyHistogram& _histogram) noexcept:
+            histogram_ { _histogram }, start_ { clock::now() }
+        {
+        }
+        ~Measurement() { histogram_.record(clock::now() - start_); }
+
+        Measurement(Measurement const&) = delete;
+        Measurement& operator=(Measurement const&) = delete;
+
+      private:
+        LatencyHistogram& histogram_;
+        clock::time_point start_;
+    };
+
+    [[nodiscard]] Measurement measure() noexcept { return Measurement { *this }; }
+
+    void record(clock::duration _elapsed) noexcept
+    {
+        auto const micros = std::chrono::duration_cast<std::chrono::microseconds>(_elapsed).count();
+        auto const value = static_cast<uint32_t>(
+            std::clamp<decltype(micros)>(micros, 0, std::numeric_limits<uint32_t>::max()));
+        auto const index = next_.load(std::memory_order_relaxed);
+        samples_[index % Capacity].store(value, std::memory_order_relaxed);
+        next_.store(index + 1, std::memory_order_release);
+    }
+
+    [[nodiscard]] Summary summary() const
+    {
+        auto const count = std::min(next_.load(std::memory_order_acquire), uint64_t { Capacity });
+        auto values = std::vector<uint32_t>(count);
+        for (size_t i = 0; i < count; ++i)
+            values[i] = samples_[i].load(std::memory_order_relaxed);
+        std::sort(values.begin(), values.end());
+
+        auto const at = [&](double _fraction) {
+            if (values.empty())
+                return std::chrono::microseconds(0);
+            auto const index = static_cast<size_t>(_fraction * static_cast<double>(values.size() - 1) + 0.5);
+            return std::chrono::microseconds(values[index]);
+        };
+
+        return Summary { values.size(), at(0.5), at(0.9), at(0.99), at(1.0) };
+    }
+
+    void clear() noexcept { next_.store(0, std::memory_order_release); }
+
+  private:
+    std::array<std::atomic<uint32_t>, Capacity> samples_ {}; // in microseconds
+    std::atomic<uint64_t> next_ = 0;                         // total number of samples recorded
+};
+
+} // namespace crispy
+
+namespace fmt // {{{
+{
+template <>
+struct formatter<crispy::LatencyHistogram::Summary>
+{
+    template <typename ParseContext>
+    constexpr auto parse(ParseContext& ctx)
+    {
+        return ctx.begin();
+    }
+    template <typename FormatContext>
+    auto format(crispy::LatencyHistogram::Summary const& _summary, FormatContext& ctx)
+    {
+        auto const ms = [](std::chrono::microseconds _value) {
+            return static_cast<double>(_value.count()) / 1000.0;
+        };
+        return fmt::format_to(ctx.out(),
+                              "p50 {:.2f} p90 {:.2f} p99 {:.2f} max {:.2f} ms ({} samples)",
+                              ms(_summary.p50),
+                              ms(_summary.p90),
+                              ms(_summary.p99),
+                              ms(_summary.max),
+                              _summary.count);
+    }
+};
+} // namespace fmt
+// }}}
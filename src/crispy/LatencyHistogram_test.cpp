@@ -0,0 +1,60 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <crispy/LatencyHistogram.h>
+
+#include <catch2/catch.hpp>
+
+#include <chrono>
+
+using crispy::LatencyHistogram;
+using std::chrono::microseconds;
+
+TEST_CASE("LatencyHistogram.summary", "[LatencyHistogram]")
+{
+    auto histogram = LatencyHistogram {};
+    CHECK(histogram.summary().count == 0);
+    CHECK(histogram.summary().max == microseconds(0));
+
+    for (int i = 1; i <= 100; ++i)
+        histogram.record(microseconds(i));
+
+    auto const summary = histogram.summary();
+    CHECK(summary.count == 100);
+    CHECK(summary.p50 == microseconds(51));
+    CHECK(summary.p90 == microseconds(90));
+    CHECK(summary.p99 == microseconds(99));
+    CHECK(summary.max == microseconds(100));
+    CHECK(fmt::format("{}", summary) == "p50 0.05 p90 0.09 p99 0.10 max 0.10 ms (100 samples)");
+}
+
+TEST_CASE("LatencyHistogram.rolling", "[LatencyHistogram]")
+{
+    auto histogram = LatencyHistogram {};
+    for (size_t i = 0; i < LatencyHistogram::Capacity; ++i)
+        histogram.record(microseconds(1000));
+    for (size_t i = 0; i < LatencyHistogram::Capacity; ++i)
+        histogram.record(microseconds(1));
+
+    // Only the most recent samples are kept.
+    CHECK(histogram.summary().count == LatencyHistogram::Capacity);
+    CHECK(histogram.summary().max == microseconds(1));
+
+    {
+        auto const _ = histogram.measure();
+    }
+    CHECK(histogram.summary().max < microseconds(1000));
+
+    histogram.clear();
+    CHECK(histogram.summary().count == 0);
+}
@@ -0,0 +1,165 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <crispy/SpscQueue.h>
+#include <crispy/logstore.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace logstore
+{
+
+/// Takes writing log messages off the threads logging them.
+///
+/// Every thread writing to it appends its messages to a lock-free ring buffer of its own,
+/// which a background thread drains into the wrapped writer, such as a log file.
+/// Messages of different threads are therefore not strictly ordered with respect to each other.
+///
+/// If a thread's ring buffer is full, its messages are dropped and counted rather than
+/// blocking the logging thread.
+class RingBufferWriter
+{
+  public:
+    static constexpr size_t Capacity = 1024; //!< number of messages buffered per thread
+
+    explicit RingBufferWriter(Sink::Writer _writer,
+                              std::chrono::milliseconds _flushInterval = std::chrono::milliseconds(50)):
+        writer_ { std::move(_writer) },
+        flushInterval_ { _flushInterval },
+        flusher_ { [this]() { flushLoop(); } }
+    {
+    }
+
+    ~RingBufferWriter()
+    {
+        {
+            auto const _ = std::lock_guard { wakeupMutex_ };
+            stopping_ = true;
+        }
+        wakeup_.notify_one();
+        flusher_.join();
+        flush();
+    }
+
+    RingBufferWriter(RingBufferWriter const&) = delete;
+    RingBufferWriter& operator=(RingBufferWriter const&) = delete;
+
+    /// Constructs a Sink::Writer that buffers the messages written to it before passing them to @p _writer.
+    static Sink::Writer create(Sink::Writer _writer)
+    {
+        auto ringBuffer = std::make_shared<RingBufferWriter>(std::move(_writer));
+        return [ringBuffer](std::string_view const& _text) { ringBuffer->write(_text); };
+    }
+
+    void write(std::string_view _text)
+    {
+        auto& ring = threadRing();
+        if (!ring.tryPush(std::string(_text)))
+        {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            wakeup_.notify_one();
+        }
+        else if (ring.size() >= Capacity / 2)
+            wakeup_.notify_one();
+    }
+
+    /// Passes all messages buffered so far on to the wrapped writer.
+    void flush()
+    {
+        // Serializes the consumers of the rings, which are single-consumer queues.
+        auto const _ = std::lock_guard { flushMutex_ };
+
+        auto rings = [this]() {
+            auto const _ = std::lock_guard { ringsMutex_ };
+            return rings_;
+        }();
+        for (auto const& ring: rings)
+            while (auto message = ring->tryPop())
+                writer_(*message);
+        rings.clear();
+
+        if (auto const count = dropped_.exchange(0, std::memory_order_relaxed); count)
+            writer_(fmt::format("[logstore] Dropped {} log messages.\n", count));
+
+        // Forgets about the rings of threads that have exited.
+        auto const _r = std::lock_guard { ringsMutex_ };
+        rings_.erase(std::remove_if(rings_.begin(),
+                                    rings_.end(),
+                                    [](auto const& ring) { return ring.use_count() == 1 && ring->empty(); }),
+                     rings_.end());
+    }
+
+  private:
+    using Ring = crispy::SpscQueue<std::string, Capacity>;
+
+    Ring& threadRing()
+    {
+        thread_local auto threadRings = std::vector<std::pair<uint64_t, std::shared_ptr<Ring>>> {};
+        for (auto const& [id, ring]: threadRings)
+            if (id == id_)
+                return *ring;
+
+        auto ring = std::make_shared<Ring>();
+        {
+            auto const _ = std::lock_guard { ringsMutex_ };
+            rings_.push_back(ring);
+        }
+        threadRings.emplace_back(id_, ring);
+        return *ring;
+    }
+
+    void flushLoop()
+    {
+        auto lock = std::unique_lock { wakeupMutex_ };
+        while (!stopping_)
+        {
+            wakeup_.wait_for(lock, flushInterval_);
+            lock.unlock();
+            flush();
+            lock.lock();
+        }
+    }
+
+    static inline std::atomic<uint64_t> nextId_ = 1;
+
+    uint64_t const id_ = nextId_++; //!< distinguishes this writer's rings from those of other writers
+    Sink::Writer writer_;
+    std::chrono::milliseconds flushInterval_;
+
+    std::mutex ringsMutex_;
+    std::vector<std::shared_ptr<Ring>> rings_;
+    std::mutex flushMutex_;
+    std::atomic<uint64_t> dropped_ = 0;
+
+    std::mutex wakeupMutex_;
+    std::condition_variable wakeup_;
+    bool stopping_ = false;
+    std::thread flusher_;
+};
+
+} // namespace logstore
@@ -0,0 +1,88 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <crispy/LogRingBuffer.h>
+
+#include <catch2/catch.hpp>
+
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+using logstore::RingBufferWriter;
+using std::string;
+using std::vector;
+
+using namespace std::string_literals;
+
+TEST_CASE("RingBufferWriter.threads", "[logstore]")
+{
+    auto written = vector<string> {};
+    {
+        // The writer is only ever invoked by a single thread at a time.
+        auto ringBuffer = RingBufferWriter { [&](std::string_view const& _text) {
+            written.emplace_back(_text);
+        } };
+
+        auto threads = vector<std::thread> {};
+        for (int i = 0; i < 4; ++i)
+            threads.emplace_back([&ringBuffer, i]() {
+                for (int k = 0; k < 100; ++k)
+                    ringBuffer.write(fmt::format("{}.{}", i, k));
+            });
+        for (auto& thread: threads)
+            thread.join();
+    }
+
+    REQUIRE(written.size() == 400);
+
+    // Messages of the same thread retain their order.
+    for (int i = 0; i < 4; ++i)
+    {
+        auto last = std::optional<int> {};
+        for (auto const& message: written)
+        {
+            if (message[0] != static_cast<char>('0' + i))
+                continue;
+            auto const k = std::stoi(message.substr(2));
+            CHECK((!last || *last + 1 == k));
+            last = k;
+        }
+        CHECK(last == 99);
+    }
+}
+
+TEST_CASE("RingBufferWriter.overflow", "[logstore]")
+{
+    auto written = vector<string> {};
+    auto ringBuffer = RingBufferWriter { [&](std::string_view const& _text) { written.emplace_back(_text); },
+                                         std::chrono::hours(1) };
+
+    for (size_t i = 0; i < RingBufferWriter::Capacity + 10; ++i)
+        ringBuffer.write("message");
+
+    ringBuffer.flush();
+
+    // Every message got either written or dropped and accounted for.
+    auto const prefix = "[logstore] Dropped "s;
+    auto total = size_t { 0 };
+    for (auto const& text: written)
+    {
+        if (text == "message")
+            ++total;
+        else if (text.substr(0, prefix.size()) == prefix)
+            total += std::stoul(text.substr(prefix.size()));
+    }
+    CHECK(total == RingBufferWriter::Capacity + 10);
+}
@@ -0,0 +1,93 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <crispy/MemoryStats.h>
+
+#include <algorithm>
+#include <mutex>
+
+namespace crispy
+{
+
+namespace
+{
+    struct Registry
+    {
+        std::mutex mutex;
+        std::vector<MemoryStats const*> subsystems;
+    };
+
+    Registry& registry()
+    {
+        // Never destroyed, as subsystems may be destroyed as late as during static destruction.
+        static auto* instance = new Registry();
+        return *instance;
+    }
+} // namespace
+
+MemoryStats::MemoryStats(std::string _name): _name { std::move(_name) }
+{
+    auto& r = registry();
+    auto const _ = std::lock_guard { r.mutex };
+    r.subsystems.push_back(this);
+}
+
+MemoryStats::~MemoryStats()
+{
+    auto& r = registry();
+    auto const _ = std::lock_guard { r.mutex };
+    r.subsystems.erase(std::find(r.subsystems.begin(), r.subsystems.end(), this));
+}
+
+void MemoryStats::update(size_t bytes, size_t count) noexcept
+{
+    _bytes.store(bytes, std::memory_order_relaxed);
+    _count.store(count, std::memory_order_relaxed);
+}
+
+MemoryStats::Snapshot MemoryStats::snapshot() const
+{
+    return Snapshot { _name, _bytes.load(std::memory_order_relaxed), _count.load(std::memory_order_relaxed) };
+}
+
+std::vector<MemoryStats::Snapshot> MemoryStats::collect()
+{
+    auto result = std::vector<Snapshot> {};
+
+    auto& r = registry();
+    auto const _ = std::lock_guard { r.mutex };
+    for (MemoryStats const* subsystem: r.subsystems)
+    {
+        auto i = std::find_if(
+            result.begin(), result.end(), [&](Snapshot const& s) { return s.name == subsystem->_name; });
+        if (i == result.end())
+            i = result.insert(result.end(), Snapshot { subsystem->_name });
+        i->bytes += subsystem->_bytes.load(std::memory_order_relaxed);
+        i->count += subsystem->_count.load(std::memory_order_relaxed);
+    }
+
+    std::sort(result.begin(), result.end(), [](Snapshot const& a, Snapshot const& b) {
+        return a.name < b.name;
+    });
+    return result;
+}
+
+size_t MemoryStats::totalBytes(std::vector<Snapshot> const& _snapshots) noexcept
+{
+    auto total = size_t { 0 };
+    for (auto const& snapshot: _snapshots)
+        total += snapshot.bytes;
+    return total;
+}
+
+} // namespace crispy
@@ -0,0 +1,93 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <crispy/utils.h>
+
+#include <fmt/format.h>
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace crispy
+{
+
+/// Number of bytes (and objects) held by a subsystem, registered process-wide by name,
+/// such that the memory usage of all subsystems can be reported from any thread (see collect()).
+///
+/// The owner of the memory periodically updates it on the thread owning that memory,
+/// with the bytes being an estimate rather than what the allocator actually holds.
+/// Subsystems of the same name, e.g. one per terminal session, are reported as one.
+class MemoryStats
+{
+  public:
+    struct Snapshot
+    {
+        std::string name;
+        size_t bytes = 0;
+        size_t count = 0; // number of objects (lines, buffers, images, ...) the bytes are held by
+    };
+
+    explicit MemoryStats(std::string _name);
+    ~MemoryStats();
+
+    MemoryStats(MemoryStats const&) = delete;
+    MemoryStats& operator=(MemoryStats const&) = delete;
+
+    [[nodiscard]] std::string const& name() const noexcept { return _name; }
+
+    void update(size_t bytes, size_t count) noexcept;
+
+    /// @returns the current usage of this subsystem alone.
+    [[nodiscard]] Snapshot snapshot() const;
+
+    /// @returns the totals of all registered subsystems, ordered by name.
+    [[nodiscard]] static std::vector<Snapshot> collect();
+
+    /// @returns the sum of the bytes of the given snapshots.
+    [[nodiscard]] static size_t totalBytes(std::vector<Snapshot> const& _snapshots) noexcept;
+
+  private:
+    std::string _name;
+    std::atomic<size_t> _bytes = 0;
+    std::atomic<size_t> _count = 0;
+};
+
+} // namespace crispy
+
+// {{{ fmt
+namespace fmt
+{
+template <>
+struct formatter<crispy::MemoryStats::Snapshot>
+{
+    template <typename ParseContext>
+    constexpr auto parse(ParseContext& ctx)
+    {
+        return ctx.begin();
+    }
+    template <typename FormatContext>
+    auto format(crispy::MemoryStats::Snapshot const& stats, FormatContext& ctx)
+    {
+        return fmt::format_to(ctx.out(),
+                              "{}: {} in {} objects",
+                              stats.name,
+                              crispy::humanReadableBytes(static_cast<long double>(stats.bytes)),
+                              stats.count);
+    }
+};
+} // namespace fmt
+// }}}
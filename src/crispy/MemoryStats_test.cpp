@@ -0,0 +1,56 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <crispy/MemoryStats.h>
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <optional>
+
+using crispy::MemoryStats;
+
+namespace
+{
+std::optional<MemoryStats::Snapshot> find(std::string const& _name)
+{
+    auto const all = MemoryStats::collect();
+    auto const i =
+        std::find_if(all.begin(), all.end(), [&](MemoryStats::Snapshot const& s) { return s.name == _name; });
+    if (i == all.end())
+        return std::nullopt;
+    return *i;
+}
+} // namespace
+
+TEST_CASE("MemoryStats.collect", "[MemoryStats]")
+{
+    CHECK(!find("test memory").has_value());
+    {
+        auto a = MemoryStats("test memory");
+        auto b = MemoryStats("test memory");
+        a.update(1000, 10);
+        a.update(2000, 20);
+        b.update(48, 1);
+
+        // The latest update counts, and subsystems of the same name are reported as one.
+        CHECK(a.snapshot().bytes == 2000);
+        auto const stats = find("test memory");
+        REQUIRE(stats.has_value());
+        CHECK(stats->bytes == 2048);
+        CHECK(stats->count == 21);
+        CHECK(MemoryStats::totalBytes({ a.snapshot(), b.snapshot() }) == 2048);
+        CHECK(fmt::format("{}", *stats) == "test memory: 2 KB in 21 objects");
+    }
+    CHECK(!find("test memory").has_value());
+}
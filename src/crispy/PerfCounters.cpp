@@ -0,0 +1,112 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <crispy/PerfCounters.h>
+
+#if defined(__linux__)
+    #include <linux/perf_event.h>
+    #include <sys/ioctl.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
+#include <array>
+#include <cstring>
+#include <utility>
+
+namespace crispy
+{
+
+#if defined(__linux__)
+namespace
+{
+    int openCounter(uint64_t _config, int _groupFd) noexcept
+    {
+        auto attributes = perf_event_attr {};
+        std::memset(&attributes, 0, sizeof(attributes));
+        attributes.type = PERF_TYPE_HARDWARE;
+        attributes.size = sizeof(attributes);
+        attributes.config = _config;
+        attributes.disabled = _groupFd == -1 ? 1 : 0;
+        attributes.exclude_kernel = 1;
+        attributes.exclude_hv = 1;
+        attributes.read_format = PERF_FORMAT_GROUP;
+        return static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, _groupFd, 0));
+    }
+} // namespace
+
+PerfCounters::PerfCounters()
+{
+    auto constexpr Events = std::array<uint64_t, 4> {
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES,
+    };
+
+    for (size_t i = 0; i < Events.size(); ++i)
+    {
+        _fds[i] = openCounter(Events[i], _fds[0]);
+        if (_fds[i] == -1)
+        {
+            // All or nothing, such that samples always mean the same.
+            for (auto& fd: _fds)
+                if (fd != -1)
+                    close(std::exchange(fd, -1));
+            return;
+        }
+    }
+}
+
+PerfCounters::~PerfCounters()
+{
+    for (auto const fd: _fds)
+        if (fd != -1)
+            close(fd);
+}
+
+void PerfCounters::start() noexcept
+{
+    if (!available())
+        return;
+    ioctl(_fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(_fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+PerfCounters::Sample PerfCounters::stop() noexcept
+{
+    if (!available())
+        return {};
+    ioctl(_fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+    // PERF_FORMAT_GROUP reads the number of counters, followed by their values in opening order.
+    auto values = std::array<uint64_t, 1 + 4> {};
+    if (read(_fds[0], values.data(), sizeof(values)) != static_cast<ssize_t>(sizeof(values)))
+        return {};
+    return Sample { values[1], values[2], values[3], values[4] };
+}
+#else
+PerfCounters::PerfCounters() = default;
+PerfCounters::~PerfCounters() = default;
+
+void PerfCounters::start() noexcept
+{
+}
+
+PerfCounters::Sample PerfCounters::stop() noexcept
+{
+    return {};
+}
+#endif
+
+} // namespace crispy
@@ -0,0 +1,75 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace crispy
+{
+
+/// Hardware performance counters of the calling thread, for attributing the cost of
+/// benchmark phases to instructions, cache misses, and branch misses rather than time only.
+///
+/// Counters are only available on Linux via perf_event_open(2). Elsewhere, or if the kernel
+/// denies access (see /proc/sys/kernel/perf_event_paranoid), available() returns false
+/// and all samples read zero.
+class PerfCounters
+{
+  public:
+    struct Sample
+    {
+        uint64_t instructions = 0;
+        uint64_t cycles = 0;
+        uint64_t cacheMisses = 0;
+        uint64_t branchMisses = 0;
+
+        Sample& operator+=(Sample const& _other) noexcept
+        {
+            instructions += _other.instructions;
+            cycles += _other.cycles;
+            cacheMisses += _other.cacheMisses;
+            branchMisses += _other.branchMisses;
+            return *this;
+        }
+    };
+
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(PerfCounters const&) = delete;
+    PerfCounters& operator=(PerfCounters const&) = delete;
+
+    [[nodiscard]] bool available() const noexcept { return _fds[0] != -1; }
+
+    /// Resets the counters to zero and starts counting.
+    void start() noexcept;
+
+    /// Stops counting and returns the events counted since start().
+    Sample stop() noexcept;
+
+    /// Measures the events caused by running @p _operation.
+    template <typename Operation>
+    Sample measure(Operation&& _operation)
+    {
+        start();
+        _operation();
+        return stop();
+    }
+
+  private:
+    std::array<int, 4> _fds { -1, -1, -1, -1 }; // the group leader counts instructions
+};
+
+} // namespace crispy
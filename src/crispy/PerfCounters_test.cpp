@@ -0,0 +1,50 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <crispy/PerfCounters.h>
+
+#include <catch2/catch.hpp>
+
+#include <cstdint>
+
+using crispy::PerfCounters;
+
+namespace
+{
+uint64_t work(int _count)
+{
+    volatile uint64_t sum = 0;
+    for (int i = 0; i < _count; ++i)
+        sum = sum + static_cast<uint64_t>(i);
+    return sum;
+}
+} // namespace
+
+TEST_CASE("PerfCounters.measure", "[perf]")
+{
+    auto counters = PerfCounters {};
+    auto const little = counters.measure([]() { work(1000); });
+    auto const lots = counters.measure([]() { work(100000); });
+
+    if (!counters.available())
+    {
+        // Counters are unsupported here or access is denied, so nothing gets counted.
+        CHECK(lots.instructions == 0);
+        CHECK(lots.cycles == 0);
+        return;
+    }
+
+    CHECK(little.instructions > 0);
+    CHECK(lots.instructions > little.instructions);
+    CHECK(lots.cycles > 0);
+}
@@ -0,0 +1,151 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace crispy
+{
+
+/// Allocation statistics of a SlabPool, e.g. for diagnostic dumps.
+struct SlabPoolStats
+{
+    std::size_t slabCount = 0;        //!< number of slabs allocated from the heap
+    std::size_t capacity = 0;         //!< number of objects that fit into all slabs
+    std::size_t inUse = 0;            //!< number of objects currently allocated
+    std::size_t peakInUse = 0;        //!< highest number of objects allocated at the same time
+    std::size_t totalAllocations = 0; //!< number of allocations served since construction
+};
+
+/**
+ * Fixed-size object allocator that carves storage for objects of type T out of
+ * larger slabs and recycles released storage via an intrusive free list.
+ *
+ * Slabs are never returned to the system while the pool is alive, so that the
+ * memory of objects that got destroyed (e.g. when lines scroll out of the
+ * scrollback) is reused by the next allocation without hitting the heap.
+ *
+ * The pool only manages raw storage; constructing and destroying objects is up
+ * to the caller, typically via a class specific operator new / delete.
+ */
+template <typename T, std::size_t ObjectsPerSlab = 4096>
+class SlabPool
+{
+  public:
+    using Stats = SlabPoolStats;
+
+    SlabPool() = default;
+    SlabPool(SlabPool const&) = delete;
+    SlabPool(SlabPool&&) = delete;
+    SlabPool& operator=(SlabPool const&) = delete;
+    SlabPool& operator=(SlabPool&&) = delete;
+    ~SlabPool() = default;
+
+    /// Returns uninitialized storage for one object of type T.
+    [[nodiscard]] void* allocate()
+    {
+        auto const _ = std::lock_guard { lock_ };
+
+        if (!freeList_)
+            growSlab();
+
+        auto* slot = freeList_;
+        freeList_ = slot->next;
+
+        ++stats_.inUse;
+        ++stats_.totalAllocations;
+        stats_.peakInUse = std::max(stats_.peakInUse, stats_.inUse);
+
+        return slot;
+    }
+
+    /// Gives storage previously obtained via allocate() back to the pool.
+    void deallocate(void* p) noexcept
+    {
+        if (!p)
+            return;
+
+        auto const _ = std::lock_guard { lock_ };
+
+        assert(stats_.inUse > 0);
+        auto* slot = static_cast<Slot*>(p);
+        slot->next = freeList_;
+        freeList_ = slot;
+        --stats_.inUse;
+    }
+
+    [[nodiscard]] Stats stats() const
+    {
+        auto const _ = std::lock_guard { lock_ };
+        return stats_;
+    }
+
+  private:
+    union Slot
+    {
+        Slot* next;
+        alignas(T) std::byte storage[sizeof(T)];
+    };
+
+    void growSlab()
+    {
+        auto slab = std::make_unique<Slot[]>(ObjectsPerSlab);
+        for (std::size_t i = 0; i < ObjectsPerSlab; ++i)
+            slab[i].next = i + 1 < ObjectsPerSlab ? &slab[i + 1] : freeList_;
+        freeList_ = &slab[0];
+        slabs_.emplace_back(std::move(slab));
+
+        ++stats_.slabCount;
+        stats_.capacity += ObjectsPerSlab;
+    }
+
+    mutable std::mutex lock_;
+    std::vector<std::unique_ptr<Slot[]>> slabs_;
+    Slot* freeList_ = nullptr;
+    Stats stats_;
+};
+
+} // namespace crispy
+
+namespace fmt // {{{
+{
+template <>
+struct formatter<crispy::SlabPoolStats>
+{
+    template <typename ParseContext>
+    constexpr auto parse(ParseContext& ctx)
+    {
+        return ctx.begin();
+    }
+    template <typename FormatContext>
+    auto format(crispy::SlabPoolStats const& stats, FormatContext& ctx)
+    {
+        return fmt::format_to(ctx.out(),
+                              "{} of {} in use (peak {}), {} slabs, {} allocations",
+                              stats.inUse,
+                              stats.capacity,
+                              stats.peakInUse,
+                              stats.slabCount,
+                              stats.totalAllocations);
+    }
+};
+} // namespace fmt
+// }}}
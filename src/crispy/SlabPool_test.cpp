@@ -0,0 +1,64 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <crispy/SlabPool.h>
+
+#include <catch2/catch.hpp>
+
+#include <set>
+
+using crispy::SlabPool;
+
+TEST_CASE("SlabPool.recycle", "[SlabPool]")
+{
+    auto pool = SlabPool<int, 4> {};
+
+    auto* a = pool.allocate();
+    auto* b = pool.allocate();
+    CHECK(a != b);
+    CHECK(pool.stats().inUse == 2);
+    CHECK(pool.stats().slabCount == 1);
+
+    pool.deallocate(a);
+    CHECK(pool.stats().inUse == 1);
+
+    // The most recently released storage is handed out first.
+    CHECK(pool.allocate() == a);
+    CHECK(pool.stats().totalAllocations == 3);
+    CHECK(pool.stats().peakInUse == 2);
+
+    pool.deallocate(a);
+    pool.deallocate(b);
+    CHECK(pool.stats().inUse == 0);
+    CHECK(pool.stats().capacity == 4);
+}
+
+TEST_CASE("SlabPool.grow", "[SlabPool]")
+{
+    auto pool = SlabPool<int, 4> {};
+
+    auto pointers = std::set<void*> {};
+    for (int i = 0; i < 10; ++i)
+        pointers.insert(pool.allocate());
+
+    CHECK(pointers.size() == 10);
+    CHECK(pool.stats().slabCount == 3);
+    CHECK(pool.stats().capacity == 12);
+    CHECK(pool.stats().inUse == 10);
+
+    for (auto* p: pointers)
+        pool.deallocate(p);
+
+    CHECK(pool.stats().inUse == 0);
+    CHECK(pool.stats().slabCount == 3);
+}
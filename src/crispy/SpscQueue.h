@@ -0,0 +1,96 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <utility>
+
+namespace crispy
+{
+
+/**
+ * Bounded lock-free queue for handing values from exactly one producer thread
+ * to exactly one consumer thread.
+ *
+ * The queue never blocks nor allocates. Waiting for the queue to become
+ * non-empty (or non-full) is up to the caller.
+ *
+ * @p Capacity must be a power of two.
+ */
+template <typename T, std::size_t Capacity>
+class SpscQueue
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two.");
+
+  public:
+    SpscQueue() = default;
+    SpscQueue(SpscQueue const&) = delete;
+    SpscQueue(SpscQueue&&) = delete;
+    SpscQueue& operator=(SpscQueue const&) = delete;
+    SpscQueue& operator=(SpscQueue&&) = delete;
+    ~SpscQueue() = default;
+
+    [[nodiscard]] static constexpr std::size_t capacity() noexcept { return Capacity; }
+
+    /// Enqueues the given value. Must only be called by the producer thread.
+    ///
+    /// @retval true the value has been enqueued.
+    /// @retval false the queue is full and the value has been left untouched.
+    [[nodiscard]] bool tryPush(T&& value)
+    {
+        auto const tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == Capacity)
+            return false;
+
+        slots_[tail & Mask] = std::move(value);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Dequeues the oldest value. Must only be called by the consumer thread.
+    [[nodiscard]] std::optional<T> tryPop()
+    {
+        auto const head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire))
+            return std::nullopt;
+
+        // Leave a default constructed value behind, such that resources held by
+        // the value are released as soon as it has been consumed.
+        auto value = std::exchange(slots_[head & Mask], T {});
+        head_.store(head + 1, std::memory_order_release);
+        return { std::move(value) };
+    }
+
+    /// Number of enqueued values, as seen by the calling thread.
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+
+    [[nodiscard]] bool empty() const noexcept { return size() == 0; }
+    [[nodiscard]] bool full() const noexcept { return size() == Capacity; }
+
+  private:
+    static constexpr std::size_t Mask = Capacity - 1;
+
+    // Producer and consumer indices live on separate cache lines to avoid false sharing.
+    alignas(64) std::atomic<std::size_t> head_ = 0; //!< next slot to pop, advanced by the consumer
+    alignas(64) std::atomic<std::size_t> tail_ = 0; //!< next slot to push, advanced by the producer
+    alignas(64) std::array<T, Capacity> slots_ {};
+};
+
+} // namespace crispy
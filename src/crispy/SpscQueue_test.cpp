@@ -0,0 +1,89 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <crispy/SpscQueue.h>
+
+#include <catch2/catch.hpp>
+
+#include <memory>
+#include <thread>
+
+using crispy::SpscQueue;
+
+TEST_CASE("SpscQueue.fifo", "[SpscQueue]")
+{
+    auto queue = SpscQueue<int, 4> {};
+    CHECK(queue.empty());
+    CHECK(!queue.tryPop().has_value());
+
+    CHECK(queue.tryPush(1));
+    CHECK(queue.tryPush(2));
+    CHECK(queue.tryPush(3));
+    CHECK(queue.tryPush(4));
+    CHECK(queue.full());
+    CHECK(!queue.tryPush(5));
+
+    CHECK(queue.tryPop() == 1);
+    CHECK(queue.tryPush(5));
+    CHECK(queue.tryPop() == 2);
+    CHECK(queue.tryPop() == 3);
+    CHECK(queue.tryPop() == 4);
+    CHECK(queue.tryPop() == 5);
+    CHECK(queue.empty());
+}
+
+TEST_CASE("SpscQueue.release_consumed", "[SpscQueue]")
+{
+    auto queue = SpscQueue<std::shared_ptr<int>, 2> {};
+    auto value = std::make_shared<int>(42);
+
+    CHECK(queue.tryPush(std::shared_ptr<int>(value)));
+    CHECK(value.use_count() == 2);
+
+    auto popped = queue.tryPop();
+    REQUIRE(popped.has_value());
+    CHECK(**popped == 42);
+    popped.reset();
+
+    // The queue must not keep a reference to values that have been popped already.
+    CHECK(value.use_count() == 1);
+}
+
+TEST_CASE("SpscQueue.threads", "[SpscQueue]")
+{
+    constexpr auto ValueCount = 100'000;
+    auto queue = SpscQueue<int, 64> {};
+
+    auto producer = std::thread([&]() {
+        for (int i = 0; i < ValueCount; ++i)
+            while (!queue.tryPush(int(i)))
+                std::this_thread::yield();
+    });
+
+    auto received = 0;
+    auto ordered = true;
+    while (received < ValueCount)
+    {
+        if (auto const value = queue.tryPop())
+        {
+            ordered = ordered && *value == received;
+            ++received;
+        }
+        else
+            std::this_thread::yield();
+    }
+    producer.join();
+
+    CHECK(ordered);
+    CHECK(queue.empty());
+}
@@ -0,0 +1,137 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <crispy/StartupTrace.h>
+#include <crispy/logstore.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <fstream>
+
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+
+namespace crispy
+{
+
+namespace
+{
+    // Initialized along with the other statics, i.e. before main() runs.
+    auto const processStart = StartupTrace::clock::now();
+
+    std::string escapeJson(std::string_view _text)
+    {
+        auto result = std::string {};
+        result.reserve(_text.size());
+        for (char const ch: _text)
+        {
+            if (ch == '"' || ch == '\\')
+                result += '\\';
+            result += ch;
+        }
+        return result;
+    }
+} // namespace
+
+StartupTrace& StartupTrace::get()
+{
+    static StartupTrace trace(processStart);
+    return trace;
+}
+
+void StartupTrace::setOutputPath(std::string _path)
+{
+    auto const _ = std::lock_guard { _mutex };
+    _outputPath = std::move(_path);
+}
+
+void StartupTrace::instant(std::string_view _name)
+{
+    if (!recording())
+        return;
+
+    auto const now = clock::now();
+    auto const _ = std::lock_guard { _mutex };
+    if (std::none_of(_events.begin(), _events.end(), [&](Event const& e) { return e.name == _name; }))
+        record(_name, 'i', now, now);
+}
+
+void StartupTrace::complete(std::string_view _name, clock::time_point _start, clock::time_point _end)
+{
+    if (!recording())
+        return;
+
+    auto const _ = std::lock_guard { _mutex };
+    record(_name, 'X', _start, _end);
+}
+
+void StartupTrace::record(std::string_view _name,
+                          char _phase,
+                          clock::time_point _start,
+                          clock::time_point _end)
+{
+    auto const threadId = std::this_thread::get_id();
+    auto thread = static_cast<size_t>(std::find(_threads.begin(), _threads.end(), threadId) - _threads.begin());
+    if (thread == _threads.size())
+        _threads.push_back(threadId);
+
+    _events.emplace_back(Event { std::string(_name),
+                                 _phase,
+                                 duration_cast<microseconds>(_start - _origin).count(),
+                                 duration_cast<microseconds>(_end - _start).count(),
+                                 thread });
+}
+
+void StartupTrace::finish()
+{
+    if (!_recording.exchange(false))
+        return;
+
+    auto const outputPath = [this]() {
+        auto const _ = std::lock_guard { _mutex };
+        return _outputPath;
+    }();
+    if (outputPath.empty())
+        return;
+
+    auto output = std::ofstream(outputPath, std::ios::binary | std::ios::trunc);
+    output << json();
+    if (!output)
+        errorlog()("Failed to write startup trace to {}.", outputPath);
+}
+
+std::string StartupTrace::json() const
+{
+    auto const _ = std::lock_guard { _mutex };
+
+    auto result = std::string { "{\"traceEvents\":[\n" };
+    for (size_t i = 0; i < _events.size(); ++i)
+    {
+        auto const& event = _events[i];
+        result += fmt::format(R"(  {{"name":"{}","cat":"startup","ph":"{}","ts":{},"pid":1,"tid":{})",
+                              escapeJson(event.name),
+                              event.phase,
+                              event.start,
+                              event.thread);
+        if (event.phase == 'X')
+            result += fmt::format(R"(,"dur":{})", event.duration);
+        else
+            result += R"(,"s":"p")";
+        result += i + 1 < _events.size() ? "},\n" : "}\n";
+    }
+    result += "],\"displayTimeUnit\":\"ms\"}\n";
+    return result;
+}
+
+} // namespace crispy
@@ -0,0 +1,107 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace crispy
+{
+
+/// Records the phases of the application startup as Chrome trace events,
+/// which can be inspected in chrome://tracing or https://ui.perfetto.dev.
+///
+/// Recording starts with the process and stops at finish(), usually once the first frame has been
+/// presented. The handful of events is kept in memory and only written out if an output path has been
+/// set by then, so recording is cheap enough to always happen.
+class StartupTrace
+{
+  public:
+    using clock = std::chrono::steady_clock;
+
+    explicit StartupTrace(clock::time_point origin = clock::now()): _origin { origin } {}
+
+    /// @returns the trace of this process, whose timestamps are relative to the process start.
+    static StartupTrace& get();
+
+    /// Sets the file the trace is written to at finish().
+    void setOutputPath(std::string _path);
+
+    [[nodiscard]] bool recording() const noexcept { return _recording.load(std::memory_order_relaxed); }
+
+    /// Records a point in time. Only the first occurrence of each name is recorded,
+    /// as startup is about the first time something happens.
+    void instant(std::string_view _name);
+
+    /// Records a phase that lasted from @p _start until @p _end.
+    void complete(std::string_view _name, clock::time_point _start, clock::time_point _end);
+
+    /// Records the phase from construction until destruction.
+    class Scope
+    {
+      public:
+        explicit Scope(std::string_view name, StartupTrace& trace = get()):
+            _trace { trace }, _name { name }, _start { trace.recording() ? clock::now() : clock::time_point {} }
+        {
+        }
+        ~Scope()
+        {
+            if (_start != clock::time_point {})
+                _trace.complete(_name, _start, clock::now());
+        }
+
+        Scope(Scope const&) = delete;
+        Scope& operator=(Scope const&) = delete;
+
+      private:
+        StartupTrace& _trace;
+        std::string_view _name;
+        clock::time_point _start;
+    };
+
+    /// Stops recording and writes the trace if an output path has been set.
+    /// Calling it again has no effect.
+    void finish();
+
+    /// @returns the recorded events in Chrome's trace event format.
+    [[nodiscard]] std::string json() const;
+
+  private:
+    struct Event
+    {
+        std::string name;
+        char phase; // 'X' for complete events, 'i' for instant events
+        int64_t start;
+        int64_t duration;
+        size_t thread;
+    };
+
+    // Requires _mutex to be locked.
+    void record(std::string_view _name, char _phase, clock::time_point _start, clock::time_point _end);
+
+    clock::time_point const _origin;
+    std::atomic<bool> _recording { true };
+    mutable std::mutex _mutex;
+    std::string _outputPath;
+    std::vector<Event> _events;
+    std::vector<std::thread::id> _threads; // index is the trace's thread ID
+};
+
+} // namespace crispy
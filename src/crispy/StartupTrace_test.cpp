@@ -0,0 +1,65 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <crispy/StartupTrace.h>
+
+#include <catch2/catch.hpp>
+
+using crispy::StartupTrace;
+using std::chrono::milliseconds;
+
+TEST_CASE("StartupTrace.json", "[startup]")
+{
+    auto const origin = StartupTrace::clock::now();
+    auto trace = StartupTrace(origin);
+
+    trace.complete("Load \"config\"", origin + milliseconds(1), origin + milliseconds(3));
+    trace.instant("First PTY output");
+
+    auto const json = trace.json();
+    CHECK(json.find(R"({"name":"Load \"config\"","cat":"startup","ph":"X","ts":1000,"pid":1,"tid":0,"dur":2000})")
+          != std::string::npos);
+    CHECK(json.find(R"("name":"First PTY output","cat":"startup","ph":"i")") != std::string::npos);
+}
+
+TEST_CASE("StartupTrace.instant_first_only", "[startup]")
+{
+    auto trace = StartupTrace();
+    trace.instant("First frame");
+    trace.instant("First frame");
+
+    auto const json = trace.json();
+    auto const first = json.find("First frame");
+    REQUIRE(first != std::string::npos);
+    CHECK(json.find("First frame", first + 1) == std::string::npos);
+}
+
+TEST_CASE("StartupTrace.finish", "[startup]")
+{
+    auto trace = StartupTrace();
+    {
+        auto const _ = StartupTrace::Scope("Phase", trace);
+    }
+    trace.finish();
+    CHECK(!trace.recording());
+
+    // Events after finishing are not recorded anymore.
+    trace.instant("Late");
+    {
+        auto const _ = StartupTrace::Scope("Late phase", trace);
+    }
+
+    auto const json = trace.json();
+    CHECK(json.find("\"Phase\"") != std::string::npos);
+    CHECK(json.find("Late") == std::string::npos);
+}
@@ -0,0 +1,180 @@
+/**
+ * This file is part of the "contour" project.
+ *   Copyright (c) 2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <crispy/StrongHash.h>
+
+#if defined(CRISPY_STRONGHASH_AESNI) && defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
+#if defined(CRISPY_STRONGHASH_AESNI) && (defined(__GNUC__) || defined(__clang__))
+    #define CRISPY_TARGET_AES __attribute__((target("aes")))
+#else
+    #define CRISPY_TARGET_AES
+#endif
+
+namespace crispy::detail
+{
+
+namespace
+{
+    // clang-format off
+    constexpr std::array<uint8_t, 256> InverseSBox = {
+        0x52, 0x09, 0x6a, 0xd5, 0x30, 0x36, 0xa5, 0x38, 0xbf, 0x40, 0xa3, 0x9e, 0x81, 0xf3, 0xd7, 0xfb,
+        0x7c, 0xe3, 0x39, 0x82, 0x9b, 0x2f, 0xff, 0x87, 0x34, 0x8e, 0x43, 0x44, 0xc4, 0xde, 0xe9, 0xcb,
+        0x54, 0x7b, 0x94, 0x32, 0xa6, 0xc2, 0x23, 0x3d, 0xee, 0x4c, 0x95, 0x0b, 0x42, 0xfa, 0xc3, 0x4e,
+        0x08, 0x2e, 0xa1, 0x66, 0x28, 0xd9, 0x24, 0xb2, 0x76, 0x5b, 0xa2, 0x49, 0x6d, 0x8b, 0xd1, 0x25,
+        0x72, 0xf8, 0xf6, 0x64, 0x86, 0x68, 0x98, 0x16, 0xd4, 0xa4, 0x5c, 0xcc, 0x5d, 0x65, 0xb6, 0x92,
+        0x6c, 0x70, 0x48, 0x50, 0xfd, 0xed, 0xb9, 0xda, 0x5e, 0x15, 0x46, 0x57, 0xa7, 0x8d, 0x9d, 0x84,
+        0x90, 0xd8, 0xab, 0x00, 0x8c, 0xbc, 0xd3, 0x0a, 0xf7, 0xe4, 0x58, 0x05, 0xb8, 0xb3, 0x45, 0x06,
+        0xd0, 0x2c, 0x1e, 0x8f, 0xca, 0x3f, 0x0f, 0x02, 0xc1, 0xaf, 0xbd, 0x03, 0x01, 0x13, 0x8a, 0x6b,
+        0x3a, 0x91, 0x11, 0x41, 0x4f, 0x67, 0xdc, 0xea, 0x97, 0xf2, 0xcf, 0xce, 0xf0, 0xb4, 0xe6, 0x73,
+        0x96, 0xac, 0x74, 0x22, 0xe7, 0xad, 0x35, 0x85, 0xe2, 0xf9, 0x37, 0xe8, 0x1c, 0x75, 0xdf, 0x6e,
+        0x47, 0xf1, 0x1a, 0x71, 0x1d, 0x29, 0xc5, 0x89, 0x6f, 0xb7, 0x62, 0x0e, 0xaa, 0x18, 0xbe, 0x1b,
+        0xfc, 0x56, 0x3e, 0x4b, 0xc6, 0xd2, 0x79, 0x20, 0x9a, 0xdb, 0xc0, 0xfe, 0x78, 0xcd, 0x5a, 0xf4,
+        0x1f, 0xdd, 0xa8, 0x33, 0x88, 0x07, 0xc7, 0x31, 0xb1, 0x12, 0x10, 0x59, 0x27, 0x80, 0xec, 0x5f,
+        0x60, 0x51, 0x7f, 0xa9, 0x19, 0xb5, 0x4a, 0x0d, 0x2d, 0xe5, 0x7a, 0x9f, 0x93, 0xc9, 0x9c, 0xef,
+        0xa0, 0xe0, 0x3b, 0x4d, 0xae, 0x2a, 0xf5, 0xb0, 0xc8, 0xeb, 0xbb, 0x3c, 0x83, 0x53, 0x99, 0x61,
+        0x17, 0x2b, 0x04, 0x7e, 0xba, 0x77, 0xd6, 0x26, 0xe1, 0x69, 0x14, 0x63, 0x55, 0x21, 0x0c, 0x7d,
+    };
+    // clang-format on
+
+    // Multiplication by x in GF(2^8) modulo the AES polynomial.
+    constexpr uint8_t xtime(uint8_t _value) noexcept
+    {
+        return static_cast<uint8_t>((_value << 1) ^ ((_value & 0x80) ? 0x1b : 0x00));
+    }
+
+    // Multiplication in GF(2^8), as needed by InvMixColumns for the factors 9, 11, 13, and 14.
+    constexpr uint8_t multiply(uint8_t _value, uint8_t _factor) noexcept
+    {
+        auto result = uint8_t { 0 };
+        for (; _factor != 0; _factor >>= 1, _value = xtime(_value))
+            if (_factor & 1)
+                result ^= _value;
+        return result;
+    }
+
+    using DecryptionTable = std::array<std::array<uint32_t, 256>, 4>;
+
+    // InvSubBytes followed by InvMixColumns of a single byte, for each row of the input column,
+    // with the resulting column having row 0 in its least significant byte.
+    constexpr DecryptionTable makeDecryptionTable() noexcept
+    {
+        constexpr uint8_t Factors[4] = { 14, 9, 13, 11 };
+        auto table = DecryptionTable {};
+        for (size_t row = 0; row < 4; ++row)
+            for (size_t value = 0; value < 256; ++value)
+                for (size_t i = 0; i < 4; ++i)
+                {
+                    auto const product = multiply(InverseSBox[value], Factors[(i + 4 - row) % 4]);
+                    table[row][value] |= uint32_t { product } << (8 * i);
+                }
+        return table;
+    }
+
+    constexpr DecryptionTable DecryptionTables = makeDecryptionTable();
+
+    // One AES decryption round (InvShiftRows, InvSubBytes, InvMixColumns) with an all-zero round key,
+    // as computed by AESDEC. The state is stored column by column.
+    void decryptRound(std::array<uint8_t, 16>& _state) noexcept
+    {
+        auto columns = std::array<uint32_t, 4> {};
+        for (size_t column = 0; column < 4; ++column)
+            for (size_t row = 0; row < 4; ++row)
+                columns[column] ^= DecryptionTables[row][_state[row + 4 * ((column + 4 - row) % 4)]];
+
+        for (size_t column = 0; column < 4; ++column)
+            for (size_t row = 0; row < 4; ++row)
+                _state[row + 4 * column] = static_cast<uint8_t>(columns[column] >> (8 * row));
+    }
+
+#if defined(CRISPY_STRONGHASH_AESNI)
+    // Compiled for AES-NI regardless of the compiler flags, as it is only called if supported.
+    CRISPY_TARGET_AES StrongHashState mixAesNiBlocks(StrongHashState _state,
+                                                     void const* _blocks,
+                                                     size_t _count) noexcept
+    {
+        auto const* blocks = static_cast<__m128i const*>(_blocks);
+        auto value = _mm_loadu_si128(reinterpret_cast<__m128i const*>(_state.data()));
+        for (size_t i = 0; i < _count; ++i)
+        {
+            value = _mm_xor_si128(value, _mm_loadu_si128(blocks + i));
+            value = _mm_aesdec_si128(value, _mm_setzero_si128());
+            value = _mm_aesdec_si128(value, _mm_setzero_si128());
+            value = _mm_aesdec_si128(value, _mm_setzero_si128());
+            value = _mm_aesdec_si128(value, _mm_setzero_si128());
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(_state.data()), value);
+        return _state;
+    }
+#endif
+
+    StrongHashMixer selectMixer() noexcept
+    {
+#if defined(CRISPY_STRONGHASH_AESNI)
+        if (aesInstructionsSupported())
+            return &mixAesNi;
+#endif
+        return &mixSoftware;
+    }
+
+    StrongHashState selectMixerAndMix(StrongHashState _state, void const* _blocks, size_t _count) noexcept
+    {
+        auto const mixer = selectMixer();
+        strongHashMixer.store(mixer, std::memory_order_relaxed);
+        return mixer(_state, _blocks, _count);
+    }
+} // namespace
+
+std::atomic<StrongHashMixer> strongHashMixer = &selectMixerAndMix;
+
+StrongHashState mixSoftware(StrongHashState _state, void const* _blocks, size_t _count) noexcept
+{
+    auto const* blocks = static_cast<uint8_t const*>(_blocks);
+    auto bytes = std::array<uint8_t, 16> {};
+    std::memcpy(bytes.data(), _state.data(), sizeof(bytes));
+    for (size_t i = 0; i < _count; ++i, blocks += bytes.size())
+    {
+        for (size_t k = 0; k < bytes.size(); ++k)
+            bytes[k] ^= blocks[k];
+        for (int round = 0; round < 4; ++round)
+            decryptRound(bytes);
+    }
+    std::memcpy(_state.data(), bytes.data(), sizeof(bytes));
+    return _state;
+}
+
+#if defined(CRISPY_STRONGHASH_AESNI)
+StrongHashState mixAesNi(StrongHashState _state, void const* _blocks, size_t _count) noexcept
+{
+    return mixAesNiBlocks(_state, _blocks, _count);
+}
+#endif
+
+bool aesInstructionsSupported() noexcept
+{
+#if defined(CRISPY_STRONGHASH_ARMV8)
+    return true;
+#elif defined(CRISPY_STRONGHASH_AESNI) && defined(_MSC_VER)
+    int info[4] {};
+    __cpuid(info, 1);
+    return (info[2] & (1 << 25)) != 0;
+#elif defined(CRISPY_STRONGHASH_AESNI)
+    return __builtin_cpu_supports("aes");
+#else
+    return false;
+#endif
+}
+
+} // namespace crispy::detail
@@ -15,41 +15,100 @@
 
 #include <crispy/assert.h>
 
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <cstdint>
 #include <cstring>
 #include <string>
 #include <string_view>
 #include <type_traits>
 
-#if defined(__x86_64__)
+#if defined(__aarch64__) && (defined(__ARM_FEATURE_AES) || defined(__ARM_FEATURE_CRYPTO))
+    #include <arm_neon.h>
+    #define CRISPY_STRONGHASH_ARMV8 1
+#elif defined(__x86_64__) || defined(_M_X64)
     #include <immintrin.h>
+    #include <wmmintrin.h>
+    #define CRISPY_STRONGHASH_AESNI 1
+#endif
 
-    #if defined(__AES__)
-        #include <wmmintrin.h>
-    #endif
-#elif defined(__aarch64__)
-    #include <crispy/sse2neon.h>
-// The following inline functions were borrowed from:
-// https://github.com/f1ed/emp/blob/master/emp-tool/utils/block.h
-inline __m128i _mm_aesimc_si128(__m128i a) noexcept
-{
-    return vreinterpretq_m128i_u8(vaesimcq_u8(vreinterpretq_u8_m128i(a)));
-}
-inline __m128i _mm_aesdec_si128(__m128i a, __m128i RoundKey) noexcept
+namespace crispy
 {
-    return vreinterpretq_m128i_u8(
-        vaesimcq_u8(vaesdq_u8(vreinterpretq_u8_m128i(a), vdupq_n_u8(0)) ^ vreinterpretq_u8_m128i(RoundKey)));
-}
 
-inline __m128i _mm_aesdeclast_si128(__m128i a, __m128i RoundKey) noexcept
+namespace detail
 {
-    return vreinterpretq_m128i_u8(vaesdq_u8(vreinterpretq_u8_m128i(a), vdupq_n_u8(0))
-                                  ^ vreinterpretq_u8_m128i(RoundKey));
-}
+    /// 128 bit hash state, laid out in memory like an AES state.
+    using StrongHashState = std::array<uint32_t, 4>;
+
+    /// Mixes @p _count blocks of 16 bytes at @p _blocks into the hash state, one after another, each by
+    /// XOR-ing it into the state, followed by four AES decryption rounds with an all-zero round key.
+    ///
+    /// All implementations compute the very same result, as hashes are also persisted,
+    /// e.g. as keys of the glyph disk cache.
+    using StrongHashMixer = StrongHashState (*)(StrongHashState _state,
+                                                void const* _blocks,
+                                                size_t _count) noexcept;
+
+    /// Portable implementation, for CPUs without AES instructions.
+    StrongHashState mixSoftware(StrongHashState _state, void const* _blocks, size_t _count) noexcept;
+
+#if defined(CRISPY_STRONGHASH_AESNI)
+    /// Implementation using AES-NI. Must only be called if aesInstructionsSupported().
+    StrongHashState mixAesNi(StrongHashState _state, void const* _blocks, size_t _count) noexcept;
 #endif
 
-namespace crispy
-{
+    /// Tests whether the running CPU supports the AES instructions used by the fastest mixer.
+    bool aesInstructionsSupported() noexcept;
+
+    /// The mixer chosen for the running CPU, which is selected upon first use.
+    ///
+    /// Initially points to a function that selects the mixer, such that hashes can also be computed
+    /// during static initialization.
+    extern std::atomic<StrongHashMixer> strongHashMixer;
+
+    inline StrongHashState mix(StrongHashState _state, void const* _blocks, size_t _count) noexcept
+    {
+#if defined(CRISPY_STRONGHASH_ARMV8)
+        // AESD (AddRoundKey, InvShiftRows, InvSubBytes) followed by AESIMC (InvMixColumns)
+        // is an AESDEC round of AES-NI when using an all-zero round key.
+        auto const zero = vdupq_n_u8(0);
+        auto const* blocks = static_cast<uint8_t const*>(_blocks);
+        auto value = vld1q_u8(reinterpret_cast<uint8_t const*>(_state.data()));
+        for (size_t i = 0; i < _count; ++i, blocks += sizeof(StrongHashState))
+        {
+            value = veorq_u8(value, vld1q_u8(blocks));
+            value = vaesimcq_u8(vaesdq_u8(value, zero));
+            value = vaesimcq_u8(vaesdq_u8(value, zero));
+            value = vaesimcq_u8(vaesdq_u8(value, zero));
+            value = vaesimcq_u8(vaesdq_u8(value, zero));
+        }
+        vst1q_u8(reinterpret_cast<uint8_t*>(_state.data()), value);
+        return _state;
+#elif defined(CRISPY_STRONGHASH_AESNI) && defined(__AES__)
+        // AES-NI is available at compile time, so no need to dispatch at runtime.
+        auto const* blocks = static_cast<__m128i const*>(_blocks);
+        auto value = _mm_loadu_si128(reinterpret_cast<__m128i const*>(_state.data()));
+        for (size_t i = 0; i < _count; ++i)
+        {
+            value = _mm_xor_si128(value, _mm_loadu_si128(blocks + i));
+            value = _mm_aesdec_si128(value, _mm_setzero_si128());
+            value = _mm_aesdec_si128(value, _mm_setzero_si128());
+            value = _mm_aesdec_si128(value, _mm_setzero_si128());
+            value = _mm_aesdec_si128(value, _mm_setzero_si128());
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(_state.data()), value);
+        return _state;
+#else
+        return strongHashMixer.load(std::memory_order_relaxed)(_state, _blocks, _count);
+#endif
+    }
+
+    inline StrongHashState mix(StrongHashState _state, StrongHashState const& _block) noexcept
+    {
+        return mix(_state, _block.data(), 1);
+    }
+} // namespace detail
 
 struct StrongHash
 {
@@ -58,9 +117,12 @@ struct StrongHash
         114, 188, 209, 2, 232, 4, 178, 176, 240, 216, 201, 127, 40, 41, 95, 143,
     };
 
+    /// Constructs a hash from the given 32 bit values, @p a being the most significant one,
+    /// mixed with the DefaultSeed.
     StrongHash(uint32_t a, uint32_t b, uint32_t c, uint32_t d) noexcept;
 
-    explicit StrongHash(__m128i v) noexcept;
+    /// Constructs a hash of the given value, the first element being the least significant 32 bits.
+    explicit StrongHash(detail::StrongHashState v) noexcept;
 
     StrongHash() = default;
     StrongHash(StrongHash const&) = default;
@@ -79,23 +141,35 @@ struct StrongHash
 
     static StrongHash compute(void const* data, size_t n) noexcept;
 
-    __m128i value {};
+    alignas(16) detail::StrongHashState value {};
 };
 
+namespace detail
+{
+    inline StrongHashState seedState() noexcept
+    {
+        auto seed = StrongHashState {};
+        std::memcpy(seed.data(), StrongHash::DefaultSeed.data(), sizeof(seed));
+        return seed;
+    }
+} // namespace detail
+
 inline StrongHash::StrongHash(uint32_t a, uint32_t b, uint32_t c, uint32_t d) noexcept:
-    StrongHash(_mm_xor_si128(
-        _mm_set_epi32(static_cast<int>(a), static_cast<int>(b), static_cast<int>(c), static_cast<int>(d)),
-        _mm_loadu_si128((__m128i const*) DefaultSeed.data())))
+    value { detail::seedState() }
 {
+    value[0] ^= d;
+    value[1] ^= c;
+    value[2] ^= b;
+    value[3] ^= a;
 }
 
-inline StrongHash::StrongHash(__m128i v) noexcept: value { v }
+inline StrongHash::StrongHash(detail::StrongHashState v) noexcept: value { v }
 {
 }
 
 inline bool operator==(StrongHash a, StrongHash b) noexcept
 {
-    return _mm_movemask_epi8(_mm_cmpeq_epi32(a.value, b.value)) == 0xFFFF;
+    return a.value == b.value;
 }
 
 inline bool operator!=(StrongHash a, StrongHash b) noexcept
@@ -105,16 +179,7 @@ inline bool operator!=(StrongHash a, StrongHash b) noexcept
 
 inline StrongHash operator*(StrongHash const& a, StrongHash const& b) noexcept
 {
-    // TODO AES-NI fallback
-    __m128i hashValue = a.value;
-
-    hashValue = _mm_xor_si128(hashValue, b.value);
-    hashValue = _mm_aesdec_si128(hashValue, _mm_setzero_si128());
-    hashValue = _mm_aesdec_si128(hashValue, _mm_setzero_si128());
-    hashValue = _mm_aesdec_si128(hashValue, _mm_setzero_si128());
-    hashValue = _mm_aesdec_si128(hashValue, _mm_setzero_si128());
-
-    return StrongHash { hashValue };
+    return StrongHash { detail::mix(a.value, b.value) };
 }
 
 inline StrongHash operator*(StrongHash a, uint32_t b) noexcept
@@ -125,23 +190,30 @@ inline StrongHash operator*(StrongHash a, uint32_t b) noexcept
 template <typename T>
 StrongHash StrongHash::compute(std::basic_string_view<T> text) noexcept
 {
-    // return compute(value.data(), value.size());
-    StrongHash hash;
-    hash = StrongHash(0, 0, 0, static_cast<uint32_t>(text.size()));
-    for (auto const codepoint: text)
-        hash = hash * codepoint; // StrongHash(0, 0, 0, static_cast<uint32_t>(codepoint));
+    // Equivalent to multiplying the hash by each codepoint in turn, but mixing in the codepoints
+    // in batches, such that the mixer is dispatched once per batch only.
+    auto constexpr BatchSize = size_t { 32 };
+    auto const seed = detail::seedState();
+    auto blocks = std::array<detail::StrongHashState, BatchSize> {};
+
+    auto hash = StrongHash(0, 0, 0, static_cast<uint32_t>(text.size()));
+    for (size_t offset = 0; offset < text.size(); offset += BatchSize)
+    {
+        auto const count = std::min(BatchSize, text.size() - offset);
+        for (size_t i = 0; i < count; ++i)
+        {
+            blocks[i] = seed;
+            blocks[i][0] ^= static_cast<uint32_t>(text[offset + i]);
+        }
+        hash.value = detail::mix(hash.value, blocks.data(), count);
+    }
     return hash;
 }
 
 template <typename T, typename Alloc>
 StrongHash StrongHash::compute(std::basic_string<T, Alloc> const& text) noexcept
 {
-    // return compute(value.data(), value.size());
-    StrongHash hash;
-    hash = StrongHash(0, 0, 0, static_cast<uint32_t>(text.size()));
-    for (T const codepoint: text)
-        hash = hash * static_cast<uint32_t>(codepoint);
-    return hash;
+    return compute(std::basic_string_view<T>(text));
 }
 
 template <typename T>
@@ -152,39 +224,25 @@ StrongHash StrongHash::compute(T const& value) noexcept
 
 inline StrongHash StrongHash::compute(void const* data, size_t n) noexcept
 {
-    // TODO AES-NI fallback
-
-    static_assert(sizeof(__m128i) == 16);
-    auto constexpr ChunkSize = static_cast<int>(sizeof(__m128i));
+    auto constexpr ChunkSize = sizeof(detail::StrongHashState);
 
-    __m128i hashValue = _mm_cvtsi64_si128(static_cast<long long>(n));
-    hashValue = _mm_xor_si128(hashValue, _mm_loadu_si128((__m128i const*) DefaultSeed.data()));
+    auto hashValue = detail::StrongHashState {};
+    auto const length = static_cast<uint64_t>(n);
+    std::memcpy(hashValue.data(), &length, sizeof(length));
+    auto const seed = detail::seedState();
+    for (size_t i = 0; i < hashValue.size(); ++i)
+        hashValue[i] ^= seed[i];
 
-    char const* inputPtr = (char const*) data;
-    for (int chunkIndex = 0; chunkIndex < static_cast<int>(n) / ChunkSize; chunkIndex++)
-    {
-        __m128i chunk = _mm_loadu_si128((__m128i const*) inputPtr);
-
-        hashValue = _mm_xor_si128(hashValue, chunk);
-        hashValue = _mm_aesdec_si128(hashValue, _mm_setzero_si128());
-        hashValue = _mm_aesdec_si128(hashValue, _mm_setzero_si128());
-        hashValue = _mm_aesdec_si128(hashValue, _mm_setzero_si128());
-        hashValue = _mm_aesdec_si128(hashValue, _mm_setzero_si128());
-
-        inputPtr += ChunkSize;
-    }
+    hashValue = detail::mix(hashValue, data, n / ChunkSize);
 
     auto const remainingByteCount = n % ChunkSize;
     if (remainingByteCount)
     {
         char lastChunk[ChunkSize] { 0 };
-        std::memcpy(lastChunk + ChunkSize - remainingByteCount, inputPtr, remainingByteCount);
-        __m128i chunk = _mm_loadu_si128((__m128i*) lastChunk);
-        hashValue = _mm_xor_si128(hashValue, chunk);
-        hashValue = _mm_aesdec_si128(hashValue, _mm_setzero_si128());
-        hashValue = _mm_aesdec_si128(hashValue, _mm_setzero_si128());
-        hashValue = _mm_aesdec_si128(hashValue, _mm_setzero_si128());
-        hashValue = _mm_aesdec_si128(hashValue, _mm_setzero_si128());
+        std::memcpy(lastChunk + ChunkSize - remainingByteCount,
+                    static_cast<char const*>(data) + n - remainingByteCount,
+                    remainingByteCount);
+        hashValue = detail::mix(hashValue, lastChunk, 1);
     }
 
     return StrongHash { hashValue };
@@ -215,7 +273,7 @@ inline std::string to_structured_string(StrongHash const& hash)
 
 inline int to_integer(StrongHash hash) noexcept
 {
-    return _mm_cvtsi128_si32(hash.value);
+    return static_cast<int>(hash.value[0]);
 }
 
 template <typename T>
@@ -230,7 +288,10 @@ namespace detail
     template <typename T>
     struct StdHash32
     {
-        inline StrongHash operator()(T v) noexcept { return StrongHash { _mm_set_epi32(0, 0, 0, v) }; }
+        inline StrongHash operator()(T v) noexcept
+        {
+            return StrongHash { StrongHashState { static_cast<uint32_t>(v), 0, 0, 0 } };
+        }
     };
 } // namespace detail
 
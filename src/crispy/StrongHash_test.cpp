@@ -0,0 +1,73 @@
+/**
+ * This file is part of the "contour" project.
+ *   Copyright (c) 2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <crispy/StrongHash.h>
+
+#include <catch2/catch.hpp>
+
+#include <array>
+#include <random>
+#include <string_view>
+#include <vector>
+
+using namespace crispy;
+using namespace std::string_view_literals;
+
+namespace
+{
+using State = detail::StrongHashState;
+
+State bytesState()
+{
+    auto bytes = std::array<unsigned char, 40> {};
+    for (size_t i = 0; i < bytes.size(); ++i)
+        bytes[i] = static_cast<unsigned char>(i);
+    return StrongHash::compute(bytes.data(), bytes.size()).value;
+}
+} // namespace
+
+// Hashes are persisted (e.g. by the glyph disk cache), so they must not change across implementations.
+TEST_CASE("StrongHash.stable", "[StrongHash]")
+{
+    CHECK(StrongHash(1, 2, 3, 4).value == State { 0x02D1BC76, 0xB0B204EB, 0x7FC9D8F2, 0x8F5F2929 });
+    CHECK((StrongHash(1, 2, 3, 4) * StrongHash(5, 6, 7, 8)).value
+          == State { 0x17CFD40E, 0xA9DD2C71, 0xDB1DE44C, 0x121BFE93 });
+    CHECK(StrongHash::compute("Hello, World!"sv).value
+          == State { 0x26FAE625, 0x6B4651C4, 0x81366793, 0x6869AD16 });
+    CHECK(bytesState() == State { 0x8178FE31, 0x91EED0BF, 0x49A40337, 0x88502A45 });
+}
+
+TEST_CASE("StrongHash.mixers", "[StrongHash]")
+{
+    auto rng = std::mt19937 { 42 };
+    auto const next = [&]() {
+        return static_cast<uint32_t>(rng());
+    };
+    for (size_t count = 0; count < 100; ++count)
+    {
+        auto const state = State { next(), next(), next(), next() };
+        auto blocks = std::vector<State>(count);
+        for (auto& block: blocks)
+            block = State { next(), next(), next(), next() };
+
+        auto const expected = detail::mixSoftware(state, blocks.data(), count);
+        INFO(fmt::format("{:08X} {:08X} {:08X} {:08X}", state[0], state[1], state[2], state[3]));
+        INFO(fmt::format("{} blocks", count));
+        CHECK(detail::mix(state, blocks.data(), count) == expected);
+        CHECK(detail::strongHashMixer.load()(state, blocks.data(), count) == expected);
+#if defined(CRISPY_STRONGHASH_AESNI)
+        if (detail::aesInstructionsSupported())
+            CHECK(detail::mixAesNi(state, blocks.data(), count) == expected);
+#endif
+    }
+}
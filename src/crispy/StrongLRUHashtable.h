@@ -22,12 +22,6 @@
 #include <stdexcept>
 #include <vector>
 
-#if defined(__x86_64__)
-    #include <immintrin.h>
-#elif defined(__aarch64__)
-    #include <crispy/sse2neon.h>
-#endif
-
 #define DEBUG_STRONG_LRU_HASHTABLE 1
 
 #if defined(NDEBUG) && defined(DEBUG_STRONG_LRU_HASHTABLE)
@@ -164,6 +158,9 @@ class StrongLRUHashtable
     [[nodiscard]] Value& peek(StrongHash const& hash);
     [[nodiscard]] Value const& peek(StrongHash const& hash) const;
 
+    /// like try_get() but neither changes LRU order nor the stats, and thus never modifies the hashtable.
+    [[nodiscard]] Value const* try_peek(StrongHash const& hash) const noexcept;
+
     /// Returns the value for the given hash key, default-constructing it in case
     /// if it wasn't in the hashtable just yet.
     [[nodiscard]] Value& operator[](StrongHash const& hash) noexcept;
@@ -414,7 +411,7 @@ inline size_t StrongLRUHashtable<Value>::storageSize() const noexcept
 template <typename Value>
 inline uint32_t* StrongLRUHashtable<Value>::hashTableSlot(StrongHash const& hash) noexcept
 {
-    uint32_t const index = static_cast<uint32_t>(_mm_cvtsi128_si32(hash.value));
+    uint32_t const index = hash.value[0];
     uint32_t const slot = index & _hashMask;
     return _hashTable + slot;
 }
@@ -557,6 +554,20 @@ inline Value const& StrongLRUHashtable<Value>::peek(StrongHash const& hash) cons
     return const_cast<StrongLRUHashtable*>(this)->peek(hash);
 }
 
+template <typename Value>
+inline Value const* StrongLRUHashtable<Value>::try_peek(StrongHash const& hash) const noexcept
+{
+    uint32_t entryIndex = _hashTable[hash.value[0] & _hashMask];
+    while (entryIndex)
+    {
+        Entry const& entry = _entries[entryIndex];
+        if (entry.hashValue == hash)
+            return &*entry.value;
+        entryIndex = entry.nextWithSameHash;
+    }
+    return nullptr;
+}
+
 template <typename Value>
 inline Value& StrongLRUHashtable<Value>::operator[](StrongHash const& hash) noexcept
 {
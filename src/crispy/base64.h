@@ -14,9 +14,18 @@
 #pragma once
 
 #include <array>
+#include <cstdint>
 #include <string>
 #include <string_view>
 
+#if defined(__SSE2__)
+    #include <immintrin.h>
+    #define CRISPY_BASE64_SIMD 1
+#elif defined(__aarch64__)
+    #include <crispy/sse2neon.h>
+    #define CRISPY_BASE64_SIMD 1
+#endif
+
 namespace crispy::base64
 {
 
@@ -56,6 +65,107 @@ namespace detail
             s += c;
         return s;
     }
+
+#if defined(CRISPY_BASE64_SIMD)
+    /// Encodes the leading 12 byte blocks of the input into 16 characters each.
+    ///
+    /// @returns the number of input bytes consumed, a multiple of 12.
+    inline size_t encodeBlocks(uint8_t const* _input, size_t _size, char* _output) noexcept
+    {
+        size_t consumed = 0;
+        for (; consumed + 12 <= _size; consumed += 12, _output += 16)
+        {
+            auto const* in = _input + consumed;
+            auto const lane = [in](int i) {
+                return static_cast<int>((in[3 * i] << 16) | (in[3 * i + 1] << 8) | in[3 * i + 2]);
+            };
+            auto const bits = _mm_setr_epi32(lane(0), lane(1), lane(2), lane(3));
+
+            // Split each 24 bit lane into its four 6 bit values, one per byte, in output order.
+            auto const sextet = [](__m128i _shifted, int _mask) {
+                return _mm_and_si128(_shifted, _mm_set1_epi32(_mask));
+            };
+            auto const values = _mm_or_si128(_mm_or_si128(sextet(_mm_srli_epi32(bits, 18), 0x3F),
+                                                          sextet(_mm_srli_epi32(bits, 4), 0x3F00)),
+                                             _mm_or_si128(sextet(_mm_slli_epi32(bits, 10), 0x3F0000),
+                                                          sextet(_mm_slli_epi32(bits, 24), 0x3F000000)));
+
+            // Map the values to the alphabet by adding the offset of the range they fall into.
+            auto const above = [&](char _value, char _offset) {
+                return _mm_and_si128(_mm_cmpgt_epi8(values, _mm_set1_epi8(_value)), _mm_set1_epi8(_offset));
+            };
+            auto const offset = _mm_add_epi8(
+                _mm_add_epi8(_mm_set1_epi8('A'), above(25, 'a' - 26 - 'A')),
+                _mm_add_epi8(_mm_add_epi8(above(51, '0' - 52 - ('a' - 26)), above(61, '+' - 62 - ('0' - 52))),
+                             above(62, '/' - 63 - ('+' - 62))));
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(_output), _mm_add_epi8(values, offset));
+        }
+        return consumed;
+    }
+
+    /// Decodes the leading 16 character blocks of the input into 12 bytes each, for as long as
+    /// they consist of alphabet characters only.
+    ///
+    /// @returns the number of input characters consumed, a multiple of 16.
+    inline size_t decodeBlocks(char const* _input, size_t _size, char* _output) noexcept
+    {
+        size_t consumed = 0;
+        for (; consumed + 16 <= _size; consumed += 16)
+        {
+            auto const input = _mm_loadu_si128(reinterpret_cast<__m128i const*>(_input + consumed));
+            auto const range = [&](char _first, char _last) {
+                return _mm_and_si128(_mm_cmpgt_epi8(input, _mm_set1_epi8(static_cast<char>(_first - 1))),
+                                     _mm_cmplt_epi8(input, _mm_set1_epi8(static_cast<char>(_last + 1))));
+            };
+            auto const upper = range('A', 'Z');
+            auto const lower = range('a', 'z');
+            auto const digit = range('0', '9');
+            auto const plus = _mm_cmpeq_epi8(input, _mm_set1_epi8('+'));
+            auto const slash = _mm_cmpeq_epi8(input, _mm_set1_epi8('/'));
+
+            auto const valid =
+                _mm_or_si128(_mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(digit, plus)), slash);
+            if (_mm_movemask_epi8(valid) != 0xFFFF)
+                break; // Padding or other characters are left to the scalar decoder.
+
+            // Map each character to its 6 bit value by adding the offset of its range.
+            auto const offset = _mm_or_si128(
+                _mm_or_si128(_mm_and_si128(upper, _mm_set1_epi8(-'A')),
+                             _mm_and_si128(lower, _mm_set1_epi8(26 - 'a'))),
+                _mm_or_si128(_mm_or_si128(_mm_and_si128(digit, _mm_set1_epi8(52 - '0')),
+                                          _mm_and_si128(plus, _mm_set1_epi8(62 - '+'))),
+                             _mm_and_si128(slash, _mm_set1_epi8(63 - '/'))));
+            auto const values = _mm_add_epi8(input, offset);
+
+            // Merge the four 6 bit values of each 32 bit lane into 24 bits.
+            auto const pairs = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(values, _mm_set1_epi16(0x00FF)), 6),
+                                            _mm_srli_epi16(values, 8));
+            auto const merged = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(pairs, _mm_set1_epi32(0xFFFF)), 12),
+                                             _mm_srli_epi32(pairs, 16));
+
+            alignas(16) uint32_t lanes[4];
+            _mm_store_si128(reinterpret_cast<__m128i*>(lanes), merged);
+            for (uint32_t const lane: lanes)
+            {
+                *_output++ = static_cast<char>(lane >> 16);
+                *_output++ = static_cast<char>(lane >> 8);
+                *_output++ = static_cast<char>(lane);
+            }
+        }
+        return consumed;
+    }
+#else
+    inline size_t encodeBlocks(uint8_t const*, size_t, char*) noexcept
+    {
+        return 0;
+    }
+
+    inline size_t decodeBlocks(char const*, size_t, char*) noexcept
+    {
+        return 0;
+    }
+#endif
 } // namespace detail
 
 struct EncoderState
@@ -121,7 +231,7 @@ constexpr void encode(uint8_t _byte, EncoderState& _state, Sink&& _sink)
 template <typename Sink>
 constexpr void finish(EncoderState& _state, Sink&& _sink)
 {
-    finish(detail::indexmap, _state, std::forward<Sink>(_sink));
+    finish(detail::Base64Alphabet, _state, std::forward<Sink>(_sink));
 }
 
 template <typename Iterator, typename Alphabet>
@@ -153,7 +263,26 @@ std::string encode(Iterator begin, Iterator end)
 
 inline std::string encode(std::string_view _value)
 {
-    return encode(_value.begin(), _value.end());
+    std::string output;
+    output.resize((_value.size() + 2) / 3 * 4);
+
+    auto const* input = reinterpret_cast<uint8_t const*>(_value.data());
+    auto const consumed = detail::encodeBlocks(input, _value.size(), output.data());
+
+    auto written = consumed / 3 * 4;
+    auto const flusher = [&](char a, char b, char c, char d) {
+        output[written++] = a;
+        output[written++] = b;
+        output[written++] = c;
+        output[written++] = d;
+    };
+
+    auto state = EncoderState {};
+    for (auto i = consumed; i < _value.size(); ++i)
+        encode(input[i], state, flusher);
+    finish(state, flusher);
+
+    return output;
 }
 
 template <typename Iterator, typename IndexTable>
@@ -246,12 +375,83 @@ size_t decode(std::string_view input, Output output)
     return decode(input.begin(), input.end(), output);
 }
 
+/// Decodes the given input into @p output, which must be able to hold decodeLength(input) bytes.
+inline size_t decode(std::string_view input, char* output)
+{
+    auto const consumed = detail::decodeBlocks(input.data(), input.size(), output);
+    auto const written = consumed / 4 * 3;
+    return written + decode(input.begin() + consumed, input.end(), detail::indexmap, output + written);
+}
+
 inline std::string decode(std::string_view input)
 {
     std::string output;
-    output.resize(decodeLength(input));
-    output.resize(decode(input, &output[0]));
+    output.resize((input.size() + 3) / 4 * 3);
+    output.resize(decode(input, output.data()));
     return output;
 }
 
+/// State of decoding an input that is received in chunks, such as the BufferFragments it is read into.
+struct DecoderState
+{
+    uint8_t pending[4] {};
+    uint8_t count = 0;
+};
+
+/// Decodes the next chunk of the input, appending the decoded bytes to @p _output.
+///
+/// The input may be split at any position. Padding and any characters not part of the alphabet,
+/// such as line breaks, are skipped.
+template <typename Container>
+void decode(std::string_view _chunk, DecoderState& _state, Container& _output)
+{
+    auto const offset = _output.size();
+    _output.resize(offset + (_state.count + _chunk.size()) / 4 * 3);
+    auto* const begin = reinterpret_cast<char*>(_output.data());
+    auto* out = begin + offset;
+
+    auto const feed = [&](char _char) {
+        auto const value = detail::indexmap[static_cast<uint8_t>(_char)];
+        if (value > 63)
+            return;
+        _state.pending[_state.count++] = value;
+        if (_state.count != 4)
+            return;
+        auto const* p = _state.pending;
+        *out++ = static_cast<char>(p[0] << 2 | p[1] >> 4);
+        *out++ = static_cast<char>(p[1] << 4 | p[2] >> 2);
+        *out++ = static_cast<char>(p[2] << 6 | p[3]);
+        _state.count = 0;
+    };
+
+    size_t i = 0;
+    while (i < _chunk.size())
+    {
+        if (_state.count == 0)
+        {
+            auto const consumed = detail::decodeBlocks(_chunk.data() + i, _chunk.size() - i, out);
+            i += consumed;
+            out += consumed / 4 * 3;
+            if (i == _chunk.size())
+                break;
+        }
+        feed(_chunk[i++]);
+    }
+
+    _output.resize(static_cast<size_t>(out - begin));
+}
+
+/// Appends the bytes of an incomplete trailing quad, i.e. when the input's padding has been omitted.
+template <typename Container>
+void finish(DecoderState& _state, Container& _output)
+{
+    using Value = typename Container::value_type;
+    auto const* p = _state.pending;
+    if (_state.count >= 2)
+        _output.push_back(static_cast<Value>(p[0] << 2 | p[1] >> 4));
+    if (_state.count >= 3)
+        _output.push_back(static_cast<Value>(p[1] << 4 | p[2] >> 2));
+    _state.count = 0;
+}
+
 } // namespace crispy::base64
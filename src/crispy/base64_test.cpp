@@ -34,3 +34,44 @@ TEST_CASE("base64.decode", "[base64]")
     CHECK("abcd" == base64::decode("YWJjZA=="));
     CHECK("foo:bar" == base64::decode("Zm9vOmJhcg=="));
 }
+
+TEST_CASE("base64.long", "[base64]")
+{
+    // Long enough to be processed in blocks, while still having a tail of varying length.
+    for (size_t length = 0; length < 100; ++length)
+    {
+        auto input = std::string {};
+        for (size_t i = 0; i < length; ++i)
+            input += static_cast<char>((i * 37 + length) & 0xFF);
+
+        auto const encoded = base64::encode(input);
+        CHECK(encoded == base64::encode(input.begin(), input.end()));
+        CHECK(base64::decode(encoded) == input);
+    }
+}
+
+TEST_CASE("base64.decode.chunked", "[base64]")
+{
+    auto input = std::string {};
+    for (int i = 0; i < 256; ++i)
+        input += static_cast<char>(i);
+    auto const encoded = base64::encode(input);
+
+    for (size_t const chunkSize: { 1, 3, 7, 16, 50, 1000 })
+    {
+        auto state = base64::DecoderState {};
+        auto output = std::string {};
+        for (size_t i = 0; i < encoded.size(); i += chunkSize)
+            base64::decode(std::string_view(encoded).substr(i, chunkSize), state, output);
+        base64::finish(state, output);
+        CHECK(output == input);
+    }
+
+    // Line breaks are skipped and padding may be omitted.
+    auto state = base64::DecoderState {};
+    auto output = std::string {};
+    base64::decode("Zm9vOmJh\nYmFyYmFyYmFyYmFyYmFyYmFyYmFy\r\nYmFy", state, output);
+    base64::decode("Zm9vOmJhcg", state, output);
+    base64::finish(state, output);
+    CHECK(output == "foo:babarbarbarbarbarbarbarbarfoo:bar");
+}
@@ -0,0 +1,486 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <crispy/BufferObject.h>
+#include <crispy/LRUCache.h>
+#include <crispy/StrongHash.h>
+#include <crispy/StrongLRUCache.h>
+#include <crispy/StrongLRUHashtable.h>
+#include <crispy/ring.h>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <new>
+#include <numeric>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Microbenchmarks of the containers on the hot paths of shaping, the texture atlas, the grid,
+// and PTY buffers, along with std::unordered_map as baseline.
+// StrongHash, which all of the Strong containers are keyed by, is measured per implementation,
+// along with its inline AES-NI implementation from before it dispatched at runtime as baseline.
+//
+// Each container is measured with 1k up to 1M entries for
+// - lookups of existing keys ("Hit"),
+// - lookups of keys that are not present ("Miss"),
+// - inserting new keys into a full container, evicting the least recently used ones ("InsertEvict").
+// The memory allocated per entry is reported as the "bytes/entry" counter.
+//
+// Build in Release mode, as debug builds validate the LRU chain of StrongLRUHashtable on every access.
+
+// {{{ allocation counting
+namespace
+{
+std::atomic<size_t> allocatedBytes = 0;
+}
+
+// Not inlined, so that compilers do not mistake the pairing with the replaced operator delete.
+[[gnu::noinline]] void* operator new(size_t _size)
+{
+    allocatedBytes.fetch_add(_size, std::memory_order_relaxed);
+    if (void* p = std::malloc(_size))
+        return p;
+    throw std::bad_alloc();
+}
+
+[[gnu::noinline]] void operator delete(void* _p) noexcept
+{
+    std::free(_p);
+}
+
+[[gnu::noinline]] void operator delete(void* _p, size_t) noexcept
+{
+    std::free(_p);
+}
+// }}}
+
+using namespace crispy;
+
+namespace
+{
+
+constexpr auto MinEntries = 1 << 10;
+constexpr auto MaxEntries = 1 << 20;
+
+/// Returns the keys 0..N-1 in random order, such that lookups do not walk memory sequentially.
+std::vector<uint32_t> shuffledKeys(size_t _count, uint32_t _offset = 0)
+{
+    auto keys = std::vector<uint32_t>(_count);
+    std::iota(keys.begin(), keys.end(), _offset);
+    std::shuffle(keys.begin(), keys.end(), std::mt19937 { 42 });
+    return keys;
+}
+
+std::vector<StrongHash> hashesOf(std::vector<uint32_t> const& _keys)
+{
+    auto hashes = std::vector<StrongHash>();
+    hashes.reserve(_keys.size());
+    for (auto const key: _keys)
+        hashes.emplace_back(StrongHash::compute(key));
+    return hashes;
+}
+
+StrongHashtableSize hashtableSizeFor(size_t _entries)
+{
+    // Twice as many slots as entries, as configured for the texture atlas.
+    return StrongHashtableSize { static_cast<uint32_t>(2 * _entries) };
+}
+
+/// Tracks the memory allocated while filling a container.
+class MemoryUsage
+{
+  public:
+    MemoryUsage(): start_ { allocatedBytes.load() } {}
+
+    void report(benchmark::State& _state, size_t _entries) const
+    {
+        _state.counters["bytes/entry"] = static_cast<double>(allocatedBytes.load() - start_)
+                                         / static_cast<double>(_entries);
+    }
+
+  private:
+    size_t start_;
+};
+
+// {{{ StrongLRUHashtable
+template <bool Hit>
+void StrongLRUHashtable_Lookup(benchmark::State& _state)
+{
+    auto const entries = static_cast<size_t>(_state.range(0));
+    auto const memory = MemoryUsage {};
+    auto table = StrongLRUHashtable<uint32_t>::create(
+        hashtableSizeFor(entries), LRUCapacity { static_cast<uint32_t>(entries) });
+    auto const keys = shuffledKeys(entries);
+    for (auto const& hash: hashesOf(keys))
+        table->emplace(hash, 1u);
+    memory.report(_state, entries);
+
+    auto const lookups = hashesOf(Hit ? keys : shuffledKeys(entries, static_cast<uint32_t>(entries)));
+    size_t i = 0;
+    for (auto _: _state)
+    {
+        benchmark::DoNotOptimize(table->try_get(lookups[i]));
+        i = (i + 1) % lookups.size();
+    }
+    _state.SetItemsProcessed(static_cast<int64_t>(_state.iterations()));
+}
+
+void StrongLRUHashtable_InsertEvict(benchmark::State& _state)
+{
+    auto const entries = static_cast<size_t>(_state.range(0));
+    auto table = StrongLRUHashtable<uint32_t>::create(
+        hashtableSizeFor(entries), LRUCapacity { static_cast<uint32_t>(entries) });
+    auto const hashes = hashesOf(shuffledKeys(2 * entries));
+    for (size_t i = 0; i < entries; ++i)
+        table->emplace(hashes[i], 1u);
+
+    size_t i = entries;
+    for (auto _: _state)
+    {
+        benchmark::DoNotOptimize(table->emplace(hashes[i], 1u));
+        i = (i + 1) % hashes.size();
+    }
+    _state.SetItemsProcessed(static_cast<int64_t>(_state.iterations()));
+}
+// }}}
+
+// {{{ StrongLRUCache
+template <bool Hit>
+void StrongLRUCache_Lookup(benchmark::State& _state)
+{
+    auto const entries = static_cast<size_t>(_state.range(0));
+    auto const memory = MemoryUsage {};
+    auto cache = StrongLRUCache<uint32_t, uint32_t>(hashtableSizeFor(entries),
+                                                    LRUCapacity { static_cast<uint32_t>(entries) });
+    auto const keys = shuffledKeys(entries);
+    for (auto const key: keys)
+        cache.emplace(key, key);
+    memory.report(_state, entries);
+
+    auto const lookups = Hit ? keys : shuffledKeys(entries, static_cast<uint32_t>(entries));
+    size_t i = 0;
+    for (auto _: _state)
+    {
+        benchmark::DoNotOptimize(cache.try_get(lookups[i]));
+        i = (i + 1) % lookups.size();
+    }
+    _state.SetItemsProcessed(static_cast<int64_t>(_state.iterations()));
+}
+
+void StrongLRUCache_InsertEvict(benchmark::State& _state)
+{
+    auto const entries = static_cast<size_t>(_state.range(0));
+    auto cache = StrongLRUCache<uint32_t, uint32_t>(hashtableSizeFor(entries),
+                                                    LRUCapacity { static_cast<uint32_t>(entries) });
+    auto const keys = shuffledKeys(2 * entries);
+    for (size_t i = 0; i < entries; ++i)
+        cache.emplace(keys[i], keys[i]);
+
+    size_t i = entries;
+    for (auto _: _state)
+    {
+        benchmark::DoNotOptimize(cache.emplace(keys[i], keys[i]));
+        i = (i + 1) % keys.size();
+    }
+    _state.SetItemsProcessed(static_cast<int64_t>(_state.iterations()));
+}
+// }}}
+
+// {{{ LRUCache
+template <bool Hit>
+void LRUCache_Lookup(benchmark::State& _state)
+{
+    auto const entries = static_cast<size_t>(_state.range(0));
+    auto const memory = MemoryUsage {};
+    auto cache = LRUCache<uint32_t, uint32_t>(entries);
+    auto const keys = shuffledKeys(entries);
+    for (auto const key: keys)
+        cache.emplace(key, uint32_t { key });
+    memory.report(_state, entries);
+
+    auto const lookups = Hit ? keys : shuffledKeys(entries, static_cast<uint32_t>(entries));
+    size_t i = 0;
+    for (auto _: _state)
+    {
+        benchmark::DoNotOptimize(cache.try_get(lookups[i]));
+        i = (i + 1) % lookups.size();
+    }
+    _state.SetItemsProcessed(static_cast<int64_t>(_state.iterations()));
+}
+
+void LRUCache_InsertEvict(benchmark::State& _state)
+{
+    auto const entries = static_cast<size_t>(_state.range(0));
+    auto cache = LRUCache<uint32_t, uint32_t>(entries);
+    auto const keys = shuffledKeys(2 * entries);
+    for (size_t i = 0; i < entries; ++i)
+        cache.emplace(keys[i], uint32_t { keys[i] });
+
+    size_t i = entries;
+    for (auto _: _state)
+    {
+        benchmark::DoNotOptimize(cache.emplace(keys[i], uint32_t { keys[i] }));
+        i = (i + 1) % keys.size();
+    }
+    _state.SetItemsProcessed(static_cast<int64_t>(_state.iterations()));
+}
+// }}}
+
+// {{{ std::unordered_map (baseline)
+template <bool Hit>
+void UnorderedMap_Lookup(benchmark::State& _state)
+{
+    auto const entries = static_cast<size_t>(_state.range(0));
+    auto const memory = MemoryUsage {};
+    auto map = std::unordered_map<uint32_t, uint32_t>();
+    auto const keys = shuffledKeys(entries);
+    for (auto const key: keys)
+        map.emplace(key, key);
+    memory.report(_state, entries);
+
+    auto const lookups = Hit ? keys : shuffledKeys(entries, static_cast<uint32_t>(entries));
+    size_t i = 0;
+    for (auto _: _state)
+    {
+        benchmark::DoNotOptimize(map.find(lookups[i]));
+        i = (i + 1) % lookups.size();
+    }
+    _state.SetItemsProcessed(static_cast<int64_t>(_state.iterations()));
+}
+
+void UnorderedMap_InsertEvict(benchmark::State& _state)
+{
+    // Evicts the oldest key for every key inserted, like an LRU cache that is never hit.
+    auto const entries = static_cast<size_t>(_state.range(0));
+    auto map = std::unordered_map<uint32_t, uint32_t>();
+    auto const keys = shuffledKeys(2 * entries);
+    for (size_t i = 0; i < entries; ++i)
+        map.emplace(keys[i], keys[i]);
+
+    size_t i = entries;
+    for (auto _: _state)
+    {
+        map.erase(keys[(i + keys.size() - entries) % keys.size()]);
+        benchmark::DoNotOptimize(map.emplace(keys[i], keys[i]));
+        i = (i + 1) % keys.size();
+    }
+    _state.SetItemsProcessed(static_cast<int64_t>(_state.iterations()));
+}
+// }}}
+
+// {{{ ring
+void Ring_Scroll(benchmark::State& _state)
+{
+    // Scrolls by one line and resets the new bottom line, as the grid does.
+    auto const entries = static_cast<size_t>(_state.range(0));
+    auto lines = ring<uint64_t>(entries);
+    for (auto _: _state)
+    {
+        lines.rotate_left(1);
+        lines[static_cast<ring<uint64_t>::offset_type>(entries - 1)] = 0;
+        benchmark::ClobberMemory();
+    }
+    _state.SetItemsProcessed(static_cast<int64_t>(_state.iterations()));
+}
+
+void Ring_RandomAccess(benchmark::State& _state)
+{
+    auto const entries = static_cast<size_t>(_state.range(0));
+    auto lines = ring<uint64_t>(entries);
+    lines.rotate_left(entries / 3);
+    auto const offsets = shuffledKeys(entries);
+    size_t i = 0;
+    for (auto _: _state)
+    {
+        benchmark::DoNotOptimize(lines[static_cast<ring<uint64_t>::offset_type>(offsets[i])]);
+        i = (i + 1) % offsets.size();
+    }
+    _state.SetItemsProcessed(static_cast<int64_t>(_state.iterations()));
+}
+
+void Deque_Scroll(benchmark::State& _state)
+{
+    auto const entries = static_cast<size_t>(_state.range(0));
+    auto lines = std::deque<uint64_t>(entries);
+    for (auto _: _state)
+    {
+        lines.pop_front();
+        lines.push_back(0);
+        benchmark::ClobberMemory();
+    }
+    _state.SetItemsProcessed(static_cast<int64_t>(_state.iterations()));
+}
+// }}}
+
+// {{{ BufferObjectPool
+void BufferObjectPool_AllocateRelease(benchmark::State& _state)
+{
+    auto pool = BufferObjectPool<char>(static_cast<size_t>(_state.range(0)));
+    for (auto _: _state)
+        benchmark::DoNotOptimize(pool.allocateBufferObject());
+    _state.SetItemsProcessed(static_cast<int64_t>(_state.iterations()));
+}
+
+void BufferObject_Write(benchmark::State& _state)
+{
+    // Appends PTY reads of 4 KiB each, taking the next buffer from the pool once one is full.
+    auto pool = BufferObjectPool<char>(static_cast<size_t>(_state.range(0)));
+    auto const data = std::vector<char>(4096, 'x');
+    auto buffer = pool.allocateBufferObject();
+    for (auto _: _state)
+    {
+        if (buffer->bytesAvailable() < data.size())
+            buffer = pool.allocateBufferObject();
+        benchmark::DoNotOptimize(buffer->writeAtEnd(data));
+    }
+    _state.SetBytesProcessed(static_cast<int64_t>(_state.iterations() * data.size()));
+}
+// }}}
+
+// {{{ StrongHash
+template <detail::StrongHashMixer Mix>
+void StrongHash_Mix(benchmark::State& _state)
+{
+    // Each mix depends on the previous one, as when combining hashes with operator*().
+    auto value = detail::StrongHashState { 1, 2, 3, 4 };
+    auto const block = detail::StrongHashState { 5, 6, 7, 8 };
+    for (auto _: _state)
+    {
+        value = Mix(value, block.data(), 1);
+        benchmark::DoNotOptimize(value);
+    }
+    _state.SetItemsProcessed(static_cast<int64_t>(_state.iterations()));
+}
+
+detail::StrongHashState mixDispatched(detail::StrongHashState _value,
+                                      void const* _blocks,
+                                      size_t _count) noexcept
+{
+    return detail::mix(_value, _blocks, _count);
+}
+
+void StrongHash_Compute(benchmark::State& _state)
+{
+    // Each hash is fed into the next one's input, measuring the latency rather than the throughput.
+    auto data = std::vector<char>(static_cast<size_t>(_state.range(0)), 'x');
+    for (auto _: _state)
+        data[0] = static_cast<char>(StrongHash::compute(data.data(), data.size()).value[0]);
+    benchmark::DoNotOptimize(data);
+    _state.SetBytesProcessed(static_cast<int64_t>(_state.iterations() * data.size()));
+}
+
+void StrongHash_ComputeText(benchmark::State& _state)
+{
+    auto text = std::u32string(static_cast<size_t>(_state.range(0)), U'x');
+    for (auto _: _state)
+        text[0] = static_cast<char32_t>(StrongHash::compute(text).value[0]);
+    benchmark::DoNotOptimize(text);
+    _state.SetItemsProcessed(static_cast<int64_t>(_state.iterations() * text.size()));
+}
+
+#if defined(CRISPY_STRONGHASH_AESNI) && (defined(__GNUC__) || defined(__clang__))
+void StrongHash_MixAesNi(benchmark::State& _state)
+{
+    if (!detail::aesInstructionsSupported())
+        return _state.SkipWithError("AES-NI is not supported.");
+    StrongHash_Mix<&detail::mixAesNi>(_state);
+}
+
+[[gnu::target("aes")]] inline __m128i aesdec(__m128i _value) noexcept
+{
+    _value = _mm_aesdec_si128(_value, _mm_setzero_si128());
+    _value = _mm_aesdec_si128(_value, _mm_setzero_si128());
+    _value = _mm_aesdec_si128(_value, _mm_setzero_si128());
+    return _mm_aesdec_si128(_value, _mm_setzero_si128());
+}
+
+// StrongHash::compute() as implemented before it dispatched at runtime, requiring AES-NI at compile time.
+[[gnu::target("aes")]] __m128i computeInlineAesNi(void const* _data, size_t _n) noexcept
+{
+    auto constexpr ChunkSize = sizeof(__m128i);
+
+    __m128i hashValue = _mm_cvtsi64_si128(static_cast<long long>(_n));
+    hashValue = _mm_xor_si128(hashValue, _mm_loadu_si128((__m128i const*) StrongHash::DefaultSeed.data()));
+
+    char const* inputPtr = (char const*) _data;
+    for (size_t chunkIndex = 0; chunkIndex < _n / ChunkSize; chunkIndex++, inputPtr += ChunkSize)
+        hashValue = aesdec(_mm_xor_si128(hashValue, _mm_loadu_si128((__m128i const*) inputPtr)));
+
+    if (auto const remainingByteCount = _n % ChunkSize)
+    {
+        char lastChunk[ChunkSize] { 0 };
+        std::memcpy(lastChunk + ChunkSize - remainingByteCount, inputPtr, remainingByteCount);
+        hashValue = aesdec(_mm_xor_si128(hashValue, _mm_loadu_si128((__m128i const*) lastChunk)));
+    }
+    return hashValue;
+}
+
+void StrongHash_ComputeBaseline(benchmark::State& _state)
+{
+    if (!detail::aesInstructionsSupported())
+        return _state.SkipWithError("AES-NI is not supported.");
+    auto data = std::vector<char>(static_cast<size_t>(_state.range(0)), 'x');
+    for (auto _: _state)
+        data[0] = static_cast<char>(_mm_cvtsi128_si32(computeInlineAesNi(data.data(), data.size())));
+    benchmark::DoNotOptimize(data);
+    _state.SetBytesProcessed(static_cast<int64_t>(_state.iterations() * data.size()));
+}
+#endif
+// }}}
+
+} // namespace
+
+// clang-format off
+BENCHMARK_TEMPLATE(StrongLRUHashtable_Lookup, true)->Name("StrongLRUHashtable/Hit")->RangeMultiplier(8)->Range(MinEntries, MaxEntries);
+BENCHMARK_TEMPLATE(StrongLRUHashtable_Lookup, false)->Name("StrongLRUHashtable/Miss")->RangeMultiplier(8)->Range(MinEntries, MaxEntries);
+BENCHMARK(StrongLRUHashtable_InsertEvict)->Name("StrongLRUHashtable/InsertEvict")->RangeMultiplier(8)->Range(MinEntries, MaxEntries);
+
+BENCHMARK_TEMPLATE(StrongLRUCache_Lookup, true)->Name("StrongLRUCache/Hit")->RangeMultiplier(8)->Range(MinEntries, MaxEntries);
+BENCHMARK_TEMPLATE(StrongLRUCache_Lookup, false)->Name("StrongLRUCache/Miss")->RangeMultiplier(8)->Range(MinEntries, MaxEntries);
+BENCHMARK(StrongLRUCache_InsertEvict)->Name("StrongLRUCache/InsertEvict")->RangeMultiplier(8)->Range(MinEntries, MaxEntries);
+
+BENCHMARK_TEMPLATE(LRUCache_Lookup, true)->Name("LRUCache/Hit")->RangeMultiplier(8)->Range(MinEntries, MaxEntries);
+BENCHMARK_TEMPLATE(LRUCache_Lookup, false)->Name("LRUCache/Miss")->RangeMultiplier(8)->Range(MinEntries, MaxEntries);
+BENCHMARK(LRUCache_InsertEvict)->Name("LRUCache/InsertEvict")->RangeMultiplier(8)->Range(MinEntries, MaxEntries);
+
+BENCHMARK_TEMPLATE(UnorderedMap_Lookup, true)->Name("std::unordered_map/Hit")->RangeMultiplier(8)->Range(MinEntries, MaxEntries);
+BENCHMARK_TEMPLATE(UnorderedMap_Lookup, false)->Name("std::unordered_map/Miss")->RangeMultiplier(8)->Range(MinEntries, MaxEntries);
+BENCHMARK(UnorderedMap_InsertEvict)->Name("std::unordered_map/InsertEvict")->RangeMultiplier(8)->Range(MinEntries, MaxEntries);
+
+BENCHMARK(Ring_Scroll)->Name("ring/Scroll")->RangeMultiplier(8)->Range(MinEntries, MaxEntries);
+BENCHMARK(Ring_RandomAccess)->Name("ring/RandomAccess")->RangeMultiplier(8)->Range(MinEntries, MaxEntries);
+BENCHMARK(Deque_Scroll)->Name("std::deque/Scroll")->RangeMultiplier(8)->Range(MinEntries, MaxEntries);
+
+BENCHMARK(BufferObjectPool_AllocateRelease)->Name("BufferObjectPool/AllocateRelease")->Arg(4096)->Arg(1 << 20);
+BENCHMARK(BufferObject_Write)->Name("BufferObject/Write")->Arg(1 << 16)->Arg(1 << 20);
+
+BENCHMARK_TEMPLATE(StrongHash_Mix, &mixDispatched)->Name("StrongHash/Mix");
+BENCHMARK_TEMPLATE(StrongHash_Mix, &detail::mixSoftware)->Name("StrongHash/Mix/Software");
+BENCHMARK(StrongHash_Compute)->Name("StrongHash/Compute")->Arg(16)->Arg(64)->Arg(1024);
+BENCHMARK(StrongHash_ComputeText)->Name("StrongHash/ComputeText")->Arg(4)->Arg(80);
+#if defined(CRISPY_STRONGHASH_AESNI) && (defined(__GNUC__) || defined(__clang__))
+BENCHMARK(StrongHash_MixAesNi)->Name("StrongHash/Mix/AesNi");
+BENCHMARK(StrongHash_ComputeBaseline)->Name("StrongHash/Compute/Baseline")->Arg(16)->Arg(64)->Arg(1024);
+#endif
+// clang-format on
+
+BENCHMARK_MAIN();
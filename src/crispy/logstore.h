@@ -19,7 +19,10 @@
 #include <fmt/format.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <cstdint>
 #include <functional>
 #include <iostream>
 #include <iterator>
@@ -81,6 +84,7 @@ class MessageBuilder
   private:
     Category const& _category;
     source_location _location;
+    bool _enabled; //!< category enabled and message not suppressed by the category's rate limit
     std::string _buffer;
 
   public:
@@ -91,34 +95,43 @@ class MessageBuilder
 
     [[nodiscard]] std::string const& text() const noexcept { return _buffer; }
 
+    // The message is only formatted if it is to be logged, as it would be discarded otherwise.
+
     MessageBuilder& append(std::string_view msg)
     {
-        _buffer += msg;
+        if (enabled())
+            _buffer += msg;
         return *this;
     }
 
     template <typename... T>
     MessageBuilder& append(fmt::format_string<T...> fmt, T&&... args)
     {
-        _buffer += fmt::vformat(fmt, fmt::make_format_args(args...));
+        if (enabled())
+            _buffer += fmt::vformat(fmt, fmt::make_format_args(args...));
         return *this;
     }
 
     MessageBuilder& operator()(std::string const& msg)
     {
-        _buffer += msg;
+        if (enabled())
+            _buffer += msg;
         return *this;
     }
     template <typename... T>
     MessageBuilder& operator()(fmt::format_string<T...> fmt, T&&... args)
     {
-        _buffer += fmt::vformat(fmt, fmt::make_format_args(args...));
+        if (enabled())
+            _buffer += fmt::vformat(fmt, fmt::make_format_args(args...));
         return *this;
     }
 
     [[nodiscard]] std::string message() const;
 
     ~MessageBuilder();
+
+  private:
+    [[nodiscard]] bool enabled() const noexcept { return _enabled; }
 };
 
 /// Defines a logging Category, such as: error, warning, metrics, vt.backend, or renderer.
@@ -156,6 +169,23 @@ class Category
     [[nodiscard]] bool visible() const noexcept { return _visibility == Visibility::Public; }
     void set_visible(bool visible) { _visibility = visible ? Visibility::Public : Visibility::Hidden; }
 
+    /// Limits the number of messages logged, such that very verbose categories can be enabled
+    /// without the application spending all of its time logging.
+    ///
+    /// @param sampling     only every n-th message is logged, or every message if 0 or 1.
+    /// @param maxPerSecond at most this many messages are logged per second, or unlimited if 0.
+    void set_rate_limit(unsigned sampling, unsigned maxPerSecond) noexcept
+    {
+        _sampling = sampling;
+        _maxPerSecond = maxPerSecond;
+    }
+
+    /// Decides whether the next message is to be logged with respect to the rate limit.
+    ///
+    /// @param suppressed receives the number of messages that have been suppressed
+    ///                   since the last one that was admitted.
+    [[nodiscard]] bool admit(uint64_t& suppressed) const noexcept;
+
     operator bool() const noexcept { return is_enabled(); }
 
     [[nodiscard]] Formatter const& formatter() const { return _formatter; }
@@ -183,6 +213,46 @@ class Category
     Visibility _visibility;
     Formatter _formatter;
     std::reference_wrapper<logstore::Sink> _sink;
+
+    unsigned _sampling = 0;
+    unsigned _maxPerSecond = 0;
+    mutable std::atomic<uint64_t> _sampleCount = 0;
+    mutable std::atomic<int64_t> _currentSecond = 0;
+    mutable std::atomic<unsigned> _currentSecondCount = 0;
+    mutable std::atomic<uint64_t> _suppressedCount = 0;
+};
+
+/// Stands in for a Category that has been compiled out, such that logging to it compiles to nothing.
+///
+/// Example:
+///   #if defined(WITH_TRACING)
+///   auto const inline TraceLog = logstore::Category("trace", "Logs traces.");
+///   #else
+///   auto constexpr inline TraceLog = logstore::DisabledCategory {};
+///   #endif
+class DisabledCategory
+{
+  public:
+    struct MessageBuilder
+    {
+        template <typename... T>
+        constexpr MessageBuilder& append(T&&...) noexcept
+        {
+            return *this;
+        }
+
+        template <typename... T>
+        constexpr MessageBuilder& operator()(T&&...) noexcept
+        {
+            return *this;
+        }
+    };
+
+    [[nodiscard]] constexpr bool is_enabled() const noexcept { return false; }
+    constexpr operator bool() const noexcept { return false; }
+
+    [[nodiscard]] constexpr MessageBuilder build() const noexcept { return {}; }
+    [[nodiscard]] constexpr MessageBuilder operator()() const noexcept { return {}; }
 };
 
 /// Logging Sink API.
@@ -244,6 +314,10 @@ void enable(std::string_view categoryName, bool enabled = true);
 void disable(std::string_view categoryName);
 void configure(std::string_view filterString);
 
+auto inline ErrorLog = logstore::Category("error", "Error Logger", Category::State::Enabled);
+
+#define errorlog() (::logstore::ErrorLog())
+
 // {{{ implementation
 inline std::string MessageBuilder::message() const
 {
@@ -295,38 +369,74 @@ inline void disable(std::string_view categoryName)
     enable(categoryName, false);
 }
 
+/// Enables the categories matching the given comma separated list of filters, disabling all others.
+///
+/// A filter is either a category name, or a prefix of it followed by '*'.
+/// It can be followed by a rate limit, either "NAME:K/s" to log at most K messages
+/// per second, or "NAME:1/N" to log only every N-th message.
 inline void configure(std::string_view filterString)
 {
     if (filterString == "all")
     {
         for (auto& category: logstore::get())
             category.get().enable();
+        return;
     }
-    else
+
+    struct Filter
     {
-        auto const filters = crispy::split(filterString, ',');
-        for (auto& category: logstore::get())
-        {
-            category.get().enable(crispy::any_of(filters, [&](std::string_view filterPattern) -> bool {
-                if (filterPattern.back() != '*')
-                    return category.get().name() == filterPattern;
-                // TODO: '*' excludes hidden categories
-                return std::equal(std::begin(filterPattern),
-                                  std::prev(end(filterPattern)),
-                                  std::begin(category.get().name()));
-            }));
-        }
+        std::string_view pattern;
+        unsigned sampling = 0;
+        unsigned maxPerSecond = 0;
+    };
+    auto filters = std::vector<Filter> {};
+    for (auto const filter: crispy::split(filterString, ','))
+    {
+        auto const colon = filter.find(':');
+        auto& entry = filters.emplace_back(Filter { filter.substr(0, colon) });
+        if (colon == std::string_view::npos)
+            continue;
+
+        auto const limit = filter.substr(colon + 1);
+        auto const slash = limit.find('/');
+        auto const numerator = crispy::to_integer<10, unsigned>(limit.substr(0, slash));
+        auto const denominator =
+            slash != std::string_view::npos ? limit.substr(slash + 1) : std::string_view {};
+        if (numerator && denominator == "s")
+            entry.maxPerSecond = *numerator;
+        else if (numerator == 1u && crispy::to_integer<10, unsigned>(denominator))
+            entry.sampling = *crispy::to_integer<10, unsigned>(denominator);
+        else
+            ErrorLog()("Invalid rate limit in logging filter: {}", filter);
+    }
+
+    for (auto& category: logstore::get())
+    {
+        auto const name = category.get().name();
+        auto const filter = std::find_if(filters.begin(), filters.end(), [&](Filter const& f) {
+            if (f.pattern.empty() || f.pattern.back() != '*')
+                return name == f.pattern;
+            return name.substr(0, f.pattern.size() - 1) == f.pattern.substr(0, f.pattern.size() - 1);
+        });
+        category.get().enable(filter != filters.end());
+        if (filter != filters.end())
+            category.get().set_rate_limit(filter->sampling, filter->maxPerSecond);
     }
 }
 
 inline MessageBuilder::MessageBuilder(logstore::Category const& cat, source_location location):
-    _category { cat }, _location { location }
+    _category { cat }, _location { location }, _enabled { false }
 {
+    auto suppressed = uint64_t { 0 };
+    _enabled = cat.is_enabled() && cat.admit(suppressed);
+    if (suppressed)
+        _buffer = fmt::format("({} messages suppressed) ", suppressed);
 }
 
 inline MessageBuilder::~MessageBuilder()
 {
-    _category.sink().write(*this);
+    if (_enabled)
+        _category.sink().write(*this);
 }
 
 inline Category::Category(std::string_view name,
@@ -355,6 +465,37 @@ inline Category::~Category()
     }
 }
 
+inline bool Category::admit(uint64_t& suppressed) const noexcept
+{
+    suppressed = 0;
+    if (_sampling <= 1 && !_maxPerSecond)
+        return true;
+
+    if (_sampling > 1 && _sampleCount.fetch_add(1, std::memory_order_relaxed) % _sampling != 0)
+    {
+        _suppressedCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    if (_maxPerSecond)
+    {
+        auto const now = std::chrono::duration_cast<std::chrono::seconds>(
+                             std::chrono::steady_clock::now().time_since_epoch())
+                             .count();
+        auto second = _currentSecond.load(std::memory_order_relaxed);
+        if (second != now && _currentSecond.compare_exchange_strong(second, now, std::memory_order_relaxed))
+            _currentSecondCount.store(0, std::memory_order_relaxed);
+        if (_currentSecondCount.fetch_add(1, std::memory_order_relaxed) >= _maxPerSecond)
+        {
+            _suppressedCount.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+    }
+
+    suppressed = _suppressedCount.exchange(0, std::memory_order_relaxed);
+    return true;
+}
+
 inline std::string Category::default_formatter(MessageBuilder const& _message)
 {
     return fmt::format("[{}:{}:{}]: {}\n",
@@ -376,8 +517,4 @@ inline void Sink::set_writer(Writer _writer)
 }
 // }}}
 
-auto inline ErrorLog = logstore::Category("error", "Error Logger", Category::State::Enabled);
-
-#define errorlog() (::logstore::ErrorLog())
-
 } // namespace logstore
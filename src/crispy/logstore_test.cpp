@@ -0,0 +1,66 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <crispy/logstore.h>
+
+#include <catch2/catch.hpp>
+
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+TEST_CASE("logstore.rate_limit", "[logstore]")
+{
+    auto written = vector<string> {};
+    auto sink = logstore::Sink(true, [&](std::string_view const& _text) { written.emplace_back(_text); });
+    auto category = logstore::Category("test.rate_limit", "Rate limited test category.");
+    category.set_sink(sink);
+
+    SECTION("sampling")
+    {
+        logstore::configure("test.*:1/10");
+        REQUIRE(category.is_enabled());
+        for (int i = 0; i < 100; ++i)
+            category()("message {}", i);
+        REQUIRE(written.size() == 10);
+        CHECK(written[0] == "message 0\n");
+        CHECK(written[1] == "(9 messages suppressed) message 10\n");
+    }
+
+    SECTION("per second")
+    {
+        logstore::configure("test.rate_limit:5/s");
+        auto formatted = 0;
+        auto const format = [&]() {
+            ++formatted;
+            return formatted;
+        };
+        for (int i = 0; i < 100; ++i)
+            category()("message {}", format());
+        // Arguments are still evaluated, but messages in excess of the limit are not written.
+        CHECK(formatted == 100);
+        CHECK(written.size() <= 10); // The test might cross the boundary of a second.
+    }
+
+    SECTION("invalid")
+    {
+        logstore::configure("other,test.rate_limit:fast");
+        CHECK(category.is_enabled());
+        category()("message");
+        CHECK(written.size() == 1);
+    }
+
+    logstore::configure("error");
+}
@@ -0,0 +1,181 @@
+/**
+ * This file is part of the "contour" project.
+ *   Copyright (c) 2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <crispy/qoi.h>
+
+#include <array>
+#include <cstring>
+
+namespace crispy::qoi
+{
+
+namespace
+{
+    constexpr uint8_t OpIndex = 0x00; // 00xxxxxx: index into the previously seen pixels
+    constexpr uint8_t OpDiff = 0x40;  // 01rrggbb: small difference to the previous pixel
+    constexpr uint8_t OpLuma = 0x80;  // 10gggggg rrrrbbbb: difference relative to the green one
+    constexpr uint8_t OpRun = 0xC0;   // 11xxxxxx: repeats the previous pixel 1..62 times
+    constexpr uint8_t OpRGB = 0xFE;
+    constexpr uint8_t OpRGBA = 0xFF;
+    constexpr uint8_t OpMask = 0xC0;
+    constexpr unsigned MaxRun = 62;
+
+    struct Pixel
+    {
+        uint8_t r = 0;
+        uint8_t g = 0;
+        uint8_t b = 0;
+        uint8_t a = 0;
+
+        bool operator==(Pixel const&) const noexcept = default;
+    };
+
+    unsigned indexOf(Pixel _pixel) noexcept
+    {
+        return (_pixel.r * 3u + _pixel.g * 5u + _pixel.b * 7u + _pixel.a * 11u) % 64u;
+    }
+} // namespace
+
+std::vector<uint8_t> encode(uint8_t const* _pixels, size_t _pixelCount)
+{
+    auto result = std::vector<uint8_t> {};
+    result.reserve(_pixelCount / 2 + 16);
+
+    auto seen = std::array<Pixel, 64> {};
+    auto previous = Pixel { 0, 0, 0, 255 };
+    unsigned run = 0;
+
+    for (size_t i = 0; i < _pixelCount; ++i)
+    {
+        auto const* p = _pixels + i * 4;
+        auto const pixel = Pixel { p[0], p[1], p[2], p[3] };
+
+        if (pixel == previous)
+        {
+            if (++run == MaxRun)
+            {
+                result.push_back(static_cast<uint8_t>(OpRun | (run - 1)));
+                run = 0;
+            }
+            continue;
+        }
+
+        if (run)
+        {
+            result.push_back(static_cast<uint8_t>(OpRun | (run - 1)));
+            run = 0;
+        }
+
+        auto const index = indexOf(pixel);
+        if (seen[index] == pixel)
+            result.push_back(static_cast<uint8_t>(OpIndex | index));
+        else
+        {
+            seen[index] = pixel;
+            if (pixel.a == previous.a)
+            {
+                auto const dr = static_cast<int8_t>(pixel.r - previous.r);
+                auto const dg = static_cast<int8_t>(pixel.g - previous.g);
+                auto const db = static_cast<int8_t>(pixel.b - previous.b);
+                auto const drg = dr - dg;
+                auto const dbg = db - dg;
+
+                if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+                    result.push_back(static_cast<uint8_t>(OpDiff | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2)));
+                else if (drg >= -8 && drg <= 7 && dg >= -32 && dg <= 31 && dbg >= -8 && dbg <= 7)
+                {
+                    result.push_back(static_cast<uint8_t>(OpLuma | (dg + 32)));
+                    result.push_back(static_cast<uint8_t>((drg + 8) << 4 | (dbg + 8)));
+                }
+                else
+                    result.insert(result.end(), { OpRGB, pixel.r, pixel.g, pixel.b });
+            }
+            else
+                result.insert(result.end(), { OpRGBA, pixel.r, pixel.g, pixel.b, pixel.a });
+        }
+        previous = pixel;
+    }
+
+    if (run)
+        result.push_back(static_cast<uint8_t>(OpRun | (run - 1)));
+
+    result.shrink_to_fit();
+    return result;
+}
+
+std::vector<uint8_t> decode(uint8_t const* _data, size_t _size, size_t _pixelCount)
+{
+    auto result = std::vector<uint8_t>(_pixelCount * 4);
+
+    auto seen = std::array<Pixel, 64> {};
+    auto pixel = Pixel { 0, 0, 0, 255 };
+    unsigned run = 0;
+    size_t k = 0;
+
+    for (size_t i = 0; i < _pixelCount; ++i)
+    {
+        if (run)
+            --run;
+        else
+        {
+            if (k == _size)
+                break;
+
+            auto const op = _data[k++];
+            auto const available = _size - k;
+            if (op == OpRGB && available >= 3)
+            {
+                pixel.r = _data[k++];
+                pixel.g = _data[k++];
+                pixel.b = _data[k++];
+            }
+            else if (op == OpRGBA && available >= 4)
+            {
+                pixel.r = _data[k++];
+                pixel.g = _data[k++];
+                pixel.b = _data[k++];
+                pixel.a = _data[k++];
+            }
+            else if (op == OpRGB || op == OpRGBA)
+                break;
+            else if ((op & OpMask) == OpIndex)
+                pixel = seen[op];
+            else if ((op & OpMask) == OpDiff)
+            {
+                pixel.r = static_cast<uint8_t>(pixel.r + ((op >> 4) & 0x03) - 2);
+                pixel.g = static_cast<uint8_t>(pixel.g + ((op >> 2) & 0x03) - 2);
+                pixel.b = static_cast<uint8_t>(pixel.b + (op & 0x03) - 2);
+            }
+            else if ((op & OpMask) == OpLuma)
+            {
+                if (!available)
+                    break;
+                auto const next = _data[k++];
+                auto const dg = (op & 0x3F) - 32;
+                pixel.r = static_cast<uint8_t>(pixel.r + dg - 8 + ((next >> 4) & 0x0F));
+                pixel.g = static_cast<uint8_t>(pixel.g + dg);
+                pixel.b = static_cast<uint8_t>(pixel.b + dg - 8 + (next & 0x0F));
+            }
+            else
+                run = op & 0x3F;
+
+            seen[indexOf(pixel)] = pixel;
+        }
+
+        std::memcpy(result.data() + i * 4, &pixel, 4);
+    }
+
+    return result;
+}
+
+} // namespace crispy::qoi
@@ -0,0 +1,37 @@
+/**
+ * This file is part of the "contour" project.
+ *   Copyright (c) 2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// Lossless compression of RGBA pixels, encoded as the chunks of the QOI image format
+/// ("Quite OK Image", https://qoiformat.org), but without its header and end marker,
+/// as the number of pixels is known to the caller.
+///
+/// It compresses typical terminal images (screenshots, plots, previews) to a fraction of their size,
+/// about as fast as they could be copied.
+namespace crispy::qoi
+{
+
+/// Encodes @p _pixelCount RGBA pixels.
+std::vector<uint8_t> encode(uint8_t const* _pixels, size_t _pixelCount);
+
+/// Decodes @p _pixelCount RGBA pixels from the result of encode().
+///
+/// Pixels missing in truncated input are left transparent black.
+std::vector<uint8_t> decode(uint8_t const* _data, size_t _size, size_t _pixelCount);
+
+} // namespace crispy::qoi
@@ -0,0 +1,73 @@
+/**
+ * This file is part of the "contour" project.
+ *   Copyright (c) 2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <crispy/qoi.h>
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <random>
+
+using namespace crispy;
+
+namespace
+{
+std::vector<uint8_t> roundtrip(std::vector<uint8_t> const& _pixels)
+{
+    auto const encoded = qoi::encode(_pixels.data(), _pixels.size() / 4);
+    return qoi::decode(encoded.data(), encoded.size(), _pixels.size() / 4);
+}
+} // namespace
+
+TEST_CASE("qoi.roundtrip.uniform", "[qoi]")
+{
+    // Runs longer than a single chunk can hold.
+    auto const pixels = std::vector<uint8_t>(1000 * 4, 0x80);
+    auto const encoded = qoi::encode(pixels.data(), pixels.size() / 4);
+    CHECK(encoded.size() < 32);
+    CHECK(qoi::decode(encoded.data(), encoded.size(), pixels.size() / 4) == pixels);
+}
+
+TEST_CASE("qoi.roundtrip.gradient", "[qoi]")
+{
+    // Small and larger differences between neighbouring pixels, as well as alpha changes.
+    auto pixels = std::vector<uint8_t> {};
+    for (unsigned i = 0; i < 2048; ++i)
+    {
+        pixels.push_back(static_cast<uint8_t>(i));
+        pixels.push_back(static_cast<uint8_t>(i * 7));
+        pixels.push_back(static_cast<uint8_t>(i * 3 + 1));
+        pixels.push_back(static_cast<uint8_t>(i / 256 * 16));
+    }
+    CHECK(roundtrip(pixels) == pixels);
+}
+
+TEST_CASE("qoi.roundtrip.noise", "[qoi]")
+{
+    auto random = std::mt19937 { 42 };
+    auto pixels = std::vector<uint8_t>(4096 * 4);
+    for (auto& value: pixels)
+        value = static_cast<uint8_t>(random() % 4 == 0 ? random() : 0x20);
+    CHECK(roundtrip(pixels) == pixels);
+}
+
+TEST_CASE("qoi.decode.truncated", "[qoi]")
+{
+    auto const pixels = std::vector<uint8_t> { 1, 2, 3, 4, 200, 100, 50, 25 };
+    auto encoded = qoi::encode(pixels.data(), 2);
+    encoded.pop_back();
+    auto const decoded = qoi::decode(encoded.data(), encoded.size(), 2);
+    REQUIRE(decoded.size() == pixels.size());
+    CHECK(std::equal(decoded.begin(), decoded.begin() + 4, pixels.begin()));
+    CHECK(std::all_of(decoded.begin() + 4, decoded.end(), [](auto v) { return v == 0; }));
+}
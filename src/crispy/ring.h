@@ -17,9 +17,13 @@
 #include <gsl/span_ext>
 
 #include <algorithm>
+#include <array>
+#include <bit>
 #include <cassert>
 #include <iterator>
+#include <memory>
 #include <stdexcept>
+#include <type_traits>
 #include <vector>
 
 namespace crispy
@@ -29,6 +33,8 @@ template <typename T, typename Vector>
 struct RingIterator;
 template <typename T, typename Vector>
 struct RingReverseIterator;
+template <typename Ring, typename T>
+struct ChunkedRingIterator;
 
 /**
  * Implements an efficient ring buffer over type T
@@ -190,6 +196,283 @@ class ring: public basic_ring<T, Container<T, Allocator>>
     void pop_front() { this->_storage.erase(this->_storage.begin()); }
 };
 
+/**
+ * Implements a ring buffer over type T with a power-of-two capacity,
+ * stored in chunks of ChunkSize elements each.
+ *
+ * Unlike basic_ring, the ring's size may be less than its capacity,
+ * such that elements are located by masking rather than by a modulo division.
+ * Growing the capacity only allocates new chunks, and moves at most one chunk's worth of elements,
+ * rather than reallocating and moving all of them.
+ *
+ * Rotating a ring whose size is less than its capacity moves the rotated elements
+ * into the free slots at the other end of the ring, and thus costs one move per rotated element.
+ */
+template <typename T, std::size_t ChunkSize = 256>
+class chunked_ring
+{
+    static_assert(std::has_single_bit(ChunkSize), "ChunkSize must be a power of two.");
+
+  public:
+    using value_type = T;
+    using iterator = ChunkedRingIterator<chunked_ring, T>;
+    using const_iterator = ChunkedRingIterator<chunked_ring const, T const>;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+    using difference_type = long;
+    using offset_type = long;
+
+    chunked_ring() = default;
+    chunked_ring(chunked_ring&&) noexcept = default;
+    chunked_ring& operator=(chunked_ring&&) noexcept = default;
+    ~chunked_ring() = default;
+
+    chunked_ring(chunked_ring const& other): _zero { other._zero }, _size { other._size }
+    {
+        _chunks.reserve(other._chunks.size());
+        for (auto const& chunk: other._chunks)
+            _chunks.emplace_back(std::make_unique<Chunk>(*chunk));
+    }
+
+    chunked_ring& operator=(chunked_ring const& other)
+    {
+        if (this != &other)
+            *this = chunked_ring(other);
+        return *this;
+    }
+
+    chunked_ring(size_t count, T const& value)
+    {
+        grow(count);
+        for (size_t i = 0; i < count; ++i)
+            slot(i) = value;
+        _size = count;
+    }
+    explicit chunked_ring(size_t count): chunked_ring(count, T {}) {}
+
+    /// Accesses the element at the given offset, which must be within [-size(), size()).
+    /// Negative offsets are relative to the end of the ring.
+    value_type const& operator[](offset_type i) const noexcept { return slot(_zero + logical(i)); }
+    value_type& operator[](offset_type i) noexcept { return slot(_zero + logical(i)); }
+
+    value_type const& at(offset_type i) const noexcept { return (*this)[i]; }
+    value_type& at(offset_type i) noexcept { return (*this)[i]; }
+
+    [[nodiscard]] std::size_t zero_index() const noexcept { return _zero; }
+    [[nodiscard]] std::size_t size() const noexcept { return _size; }
+    [[nodiscard]] std::size_t capacity() const noexcept { return _chunks.size() * ChunkSize; }
+    [[nodiscard]] bool empty() const noexcept { return _size == 0; }
+
+    /// Moves the elements in storage such that the front element is stored first,
+    /// without changing their order.
+    void rezero()
+    {
+        if (_zero == 0)
+            return;
+        auto const size = _size;
+        _size = capacity();
+        std::rotate(begin(), std::next(begin(), static_cast<difference_type>(_zero)), end());
+        _size = size;
+        _zero = 0;
+    }
+
+    // positvie count rotates right, negative count rotates left
+    void rotate(int count)
+    {
+        if (count >= 0)
+            rotate_right(static_cast<size_t>(count));
+        else
+            rotate_left(static_cast<size_t>(-count));
+    }
+
+    void rotate_left(std::size_t count)
+    {
+        if (empty())
+            return;
+        count %= _size;
+        if (_size == capacity())
+        {
+            _zero = (_zero + count) & mask();
+            return;
+        }
+        for (size_t i = 0; i < count; ++i)
+        {
+            slot(_zero + _size) = std::move(slot(_zero));
+            _zero = (_zero + 1) & mask();
+        }
+    }
+
+    void rotate_right(std::size_t count)
+    {
+        if (empty())
+            return;
+        count %= _size;
+        if (_size == capacity())
+        {
+            _zero = (_zero - count) & mask();
+            return;
+        }
+        for (size_t i = 0; i < count; ++i)
+        {
+            _zero = (_zero - 1) & mask();
+            slot(_zero) = std::move(slot(_zero + _size));
+        }
+    }
+
+    value_type& front() noexcept { return at(0); }
+    value_type const& front() const noexcept { return at(0); }
+
+    value_type& back()
+    {
+        if (empty())
+            throw std::length_error("empty");
+
+        return at(static_cast<offset_type>(_size) - 1);
+    }
+
+    value_type const& back() const
+    {
+        if (empty())
+            throw std::length_error("empty");
+
+        return at(static_cast<offset_type>(_size) - 1);
+    }
+
+    iterator begin() noexcept { return iterator { this, 0 }; }
+    iterator end() noexcept { return iterator { this, static_cast<difference_type>(_size) }; }
+
+    const_iterator cbegin() const noexcept { return const_iterator { this, 0 }; }
+    const_iterator cend() const noexcept
+    {
+        return const_iterator { this, static_cast<difference_type>(_size) };
+    }
+
+    const_iterator begin() const noexcept { return cbegin(); }
+    const_iterator end() const noexcept { return cend(); }
+
+    reverse_iterator rbegin() noexcept { return reverse_iterator { end() }; }
+    reverse_iterator rend() noexcept { return reverse_iterator { begin() }; }
+
+    const_reverse_iterator rbegin() const noexcept { return const_reverse_iterator { end() }; }
+    const_reverse_iterator rend() const noexcept { return const_reverse_iterator { begin() }; }
+
+    void reserve(size_t capacity) { grow(capacity); }
+
+    /// Resizes the ring at its end, without moving any of the elements that are kept.
+    void resize(size_t newSize)
+    {
+        grow(newSize);
+        for (size_t i = std::min(newSize, _size); i < std::max(newSize, _size); ++i)
+            slot(_zero + i) = T {};
+        _size = newSize;
+    }
+
+    void clear()
+    {
+        resize(0);
+        _zero = 0;
+    }
+
+    void push_back(T const& _value) { emplace_back(_value); }
+
+    void push_back(T&& _value) { emplace_back(std::move(_value)); }
+
+    template <typename... Args>
+    value_type& emplace_back(Args&&... args)
+    {
+        grow(_size + 1);
+        auto& element = slot(_zero + _size);
+        element = T(std::forward<Args>(args)...);
+        ++_size;
+        return element;
+    }
+
+    void pop_front()
+    {
+        slot(_zero) = T {};
+        _zero = (_zero + 1) & mask();
+        --_size;
+    }
+
+    /// Inserts @p count copies of @p value before the element at offset @p pos,
+    /// moving the elements of whichever side of @p pos is the shorter one.
+    void insert(offset_type pos, size_t count, T const& value)
+    {
+        auto const offset = static_cast<size_t>(pos);
+        grow(_size + count);
+        if (offset <= _size - offset)
+        {
+            _zero = (_zero - count) & mask();
+            _size += count;
+            std::rotate(begin(),
+                        std::next(begin(), static_cast<difference_type>(count)),
+                        std::next(begin(), static_cast<difference_type>(offset + count)));
+        }
+        else
+        {
+            _size += count;
+            std::rotate(std::next(begin(), pos),
+                        std::next(begin(), static_cast<difference_type>(_size - count)),
+                        end());
+        }
+        std::fill_n(std::next(begin(), pos), count, value);
+    }
+
+  private:
+    using Chunk = std::array<T, ChunkSize>;
+
+    [[nodiscard]] size_t mask() const noexcept { return capacity() - 1; }
+
+    [[nodiscard]] size_t logical(offset_type i) const noexcept
+    {
+        return static_cast<size_t>(i < 0 ? i + static_cast<offset_type>(_size) : i);
+    }
+
+    [[nodiscard]] T& slot(size_t physical) noexcept
+    {
+        physical &= mask();
+        return (*_chunks[physical / ChunkSize])[physical % ChunkSize];
+    }
+
+    [[nodiscard]] T const& slot(size_t physical) const noexcept
+    {
+        physical &= mask();
+        return (*_chunks[physical / ChunkSize])[physical % ChunkSize];
+    }
+
+    // Ensures a capacity of at least the given number of elements, by doubling the capacity as needed.
+    void grow(size_t minCapacity)
+    {
+        if (minCapacity <= capacity())
+            return;
+
+        auto const newCapacity = std::max(ChunkSize, std::bit_ceil(minCapacity));
+        while (capacity() < newCapacity)
+        {
+            auto const oldCapacity = capacity();
+            auto const oldChunkCount = _chunks.size();
+            for (size_t i = 0; i < std::max(oldChunkCount, size_t { 1 }); ++i)
+                _chunks.emplace_back(std::make_unique<Chunk>());
+
+            // The elements that wrapped around the end of the old capacity are moved right behind it,
+            // which are whole chunks, except for the one the wrapped elements end in.
+            if (_zero + _size <= oldCapacity)
+                continue;
+            auto const wrapped = _zero + _size - oldCapacity;
+            auto const wholeChunks = wrapped / ChunkSize;
+            for (size_t i = 0; i < wholeChunks; ++i)
+                std::swap(_chunks[i], _chunks[oldChunkCount + i]);
+            auto& from = *_chunks[wholeChunks];
+            auto& to = *_chunks[oldChunkCount + wholeChunks];
+            std::move(from.begin(), std::next(from.begin(), wrapped % ChunkSize), to.begin());
+        }
+    }
+
+    std::vector<std::unique_ptr<Chunk>> _chunks;
+    std::size_t _zero = 0; //!< storage index of the front element
+    std::size_t _size = 0;
+};
+
 /// Fixed-size basic_ring<T> implementation
 template <typename T, std::size_t N>
 using fixed_size_ring = basic_ring<T, std::array<T, N>>;
@@ -373,6 +656,96 @@ struct RingReverseIterator
 };
 // }}}
 
+// {{{ chunked_ring iterator
+template <typename Ring, typename T>
+struct ChunkedRingIterator
+{
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = std::remove_const_t<T>;
+    using difference_type = long;
+    using pointer = T*;
+    using reference = T&;
+
+    Ring* ring {};
+    difference_type current {};
+
+    ChunkedRingIterator(Ring* aRing, difference_type aCurrent): ring { aRing }, current { aCurrent } {}
+
+    // Converts a mutable iterator into a const one.
+    template <typename OtherRing, typename U>
+    // NOLINTNEXTLINE(google-explicit-constructor)
+    ChunkedRingIterator(ChunkedRingIterator<OtherRing, U> const& other):
+        ring { other.ring }, current { other.current }
+    {
+    }
+
+    ChunkedRingIterator() = default;
+
+    ChunkedRingIterator& operator++() noexcept
+    {
+        ++current;
+        return *this;
+    }
+
+    ChunkedRingIterator operator++(int) noexcept
+    {
+        auto old = *this;
+        ++(*this);
+        return old;
+    }
+
+    ChunkedRingIterator& operator--() noexcept
+    {
+        --current;
+        return *this;
+    }
+
+    ChunkedRingIterator operator--(int) noexcept
+    {
+        auto old = *this;
+        --(*this);
+        return old;
+    }
+
+    ChunkedRingIterator& operator+=(difference_type n) noexcept
+    {
+        current += n;
+        return *this;
+    }
+    ChunkedRingIterator& operator-=(difference_type n) noexcept
+    {
+        current -= n;
+        return *this;
+    }
+
+    ChunkedRingIterator operator+(difference_type n) const noexcept
+    {
+        return ChunkedRingIterator { ring, current + n };
+    }
+    ChunkedRingIterator operator-(difference_type n) const noexcept
+    {
+        return ChunkedRingIterator { ring, current - n };
+    }
+    difference_type operator-(ChunkedRingIterator const& rhs) const noexcept { return current - rhs.current; }
+
+    friend ChunkedRingIterator operator+(difference_type n, ChunkedRingIterator a)
+    {
+        return ChunkedRingIterator { a.ring, n + a.current };
+    }
+
+    bool operator==(ChunkedRingIterator const& rhs) const noexcept { return current == rhs.current; }
+    bool operator!=(ChunkedRingIterator const& rhs) const noexcept { return current != rhs.current; }
+    bool operator<(ChunkedRingIterator const& rhs) const noexcept { return current < rhs.current; }
+    bool operator>(ChunkedRingIterator const& rhs) const noexcept { return current > rhs.current; }
+    bool operator<=(ChunkedRingIterator const& rhs) const noexcept { return current <= rhs.current; }
+    bool operator>=(ChunkedRingIterator const& rhs) const noexcept { return current >= rhs.current; }
+
+    T& operator*() const noexcept { return (*ring)[current]; }
+    T* operator->() const noexcept { return &(*ring)[current]; }
+    T& operator[](difference_type n) const noexcept { return (*ring)[current + n]; }
+};
+// }}}
+
 // {{{ basic_ring<T> impl
 template <typename T, typename Vector>
 typename basic_ring<T, Vector>::reverse_iterator basic_ring<T, Vector>::rbegin() noexcept
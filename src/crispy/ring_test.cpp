@@ -18,7 +18,9 @@
 #include <catch2/catch.hpp>
 
 #include <array>
+#include <string>
 
+using crispy::chunked_ring;
 using crispy::fixed_size_ring;
 using crispy::ring;
 using std::generate_n;
@@ -174,3 +176,85 @@ TEST_CASE("ring.offset_negative")
     REQUIRE(r[-2] == 'b');
     REQUIRE(r[-3] == 'a');
 }
+
+TEST_CASE("chunked_ring.capacity")
+{
+    chunked_ring<int, 4> r(3);
+    REQUIRE(r.size() == 3);
+    REQUIRE(r.capacity() == 4);
+    r.resize(5);
+    REQUIRE(r.size() == 5);
+    REQUIRE(r.capacity() == 8);
+    r.resize(9);
+    REQUIRE(r.capacity() == 16);
+}
+
+TEST_CASE("chunked_ring.rotate")
+{
+    chunked_ring<char, 4> r;
+    for (auto const c: std::string("abcde"))
+        r.push_back(c);
+    REQUIRE(r.capacity() == 8);
+
+    r.rotate_left(2);
+    REQUIRE(std::string(r.begin(), r.end()) == "cdeab");
+    REQUIRE(r[-1] == 'b');
+    REQUIRE(r[-5] == 'c');
+
+    r.rotate_right(3);
+    REQUIRE(std::string(r.begin(), r.end()) == "eabcd");
+
+    r.rotate(-1);
+    REQUIRE(std::string(r.begin(), r.end()) == "abcde");
+    REQUIRE(std::string(r.rbegin(), r.rend()) == "edcba");
+}
+
+TEST_CASE("chunked_ring.grow_wrapped")
+{
+    // Rotates the elements around the end of the storage, such that growing has to move them.
+    chunked_ring<char, 2> r;
+    for (auto const c: std::string("abcdefgh"))
+        r.push_back(c);
+    r.rotate_left(5);
+    REQUIRE(std::string(r.begin(), r.end()) == "fghabcde");
+    REQUIRE(r.zero_index() == 5);
+
+    r.push_back('x');
+    REQUIRE(r.capacity() == 16);
+    REQUIRE(r.zero_index() == 5);
+    REQUIRE(std::string(r.begin(), r.end()) == "fghabcdex");
+
+    r.rezero();
+    REQUIRE(r.zero_index() == 0);
+    REQUIRE(std::string(r.begin(), r.end()) == "fghabcdex");
+}
+
+TEST_CASE("chunked_ring.insert")
+{
+    chunked_ring<char, 4> r;
+    for (auto const c: std::string("abcdef"))
+        r.push_back(c);
+
+    r.insert(1, 2, '-');
+    REQUIRE(std::string(r.begin(), r.end()) == "a--bcdef");
+
+    r.insert(7, 1, '+');
+    REQUIRE(std::string(r.begin(), r.end()) == "a--bcde+f");
+    REQUIRE(r.capacity() == 16);
+}
+
+TEST_CASE("chunked_ring.pop_front")
+{
+    chunked_ring<char, 4> r;
+    for (auto const c: std::string("abc"))
+        r.push_back(c);
+    r.pop_front();
+    r.push_back('d');
+    r.push_back('e');
+    REQUIRE(std::string(r.begin(), r.end()) == "bcde");
+    REQUIRE(r.capacity() == 4);
+
+    auto const copy = r;
+    r.front() = 'x';
+    REQUIRE(std::string(copy.begin(), copy.end()) == "bcde");
+}
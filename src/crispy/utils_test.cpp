@@ -120,6 +120,15 @@ TEST_CASE("utils.to_integer.16")
     CHECK(crispy::to_integer<16>("12345"sv).value_or(-1) == 0x12345);
 }
 
+TEST_CASE("utils.nextPowerOfTwo")
+{
+    CHECK(crispy::nextPowerOfTwo(1u) == 1u);
+    CHECK(crispy::nextPowerOfTwo(3u) == 4u);
+    CHECK(crispy::nextPowerOfTwo(4096u) == 4096u);
+    CHECK(crispy::nextPowerOfTwo(uint32_t { 1024 * 1024 + 72 }) == 2 * 1024 * 1024);
+    CHECK(crispy::nextPowerOfTwo(uint64_t { 0x1'0000'0001 }) == 0x2'0000'0000);
+}
+
 TEST_CASE("fromHexString")
 {
     CHECK(!crispy::fromHexString("abc"sv));
@@ -14,6 +14,7 @@
 #include <terminal/Capabilities.h>
 
 #include <crispy/escape.h>
+#include <crispy/utils.h>
 
 #include <range/v3/action/sort.hpp>
 #include <range/v3/action/transform.hpp>
@@ -22,6 +23,7 @@
 #include <range/v3/view/transform.hpp>
 
 #include <sstream>
+#include <vector>
 
 using std::nullopt;
 using std::optional;
@@ -449,6 +451,174 @@ namespace
         // Only a terminfo name is provided, since termcap applica-
         // tions cannot use this information
         String { Undefined, "RGB"sv, "8/8/8"sv }); // }}}
+
+    // {{{ perfect hash of the names capabilities are requested by
+    /// A name a capability can be requested by via XTGETTCAP, i.e. its terminfo name or termcap code.
+    struct RequestName
+    {
+        std::string_view name {}; // empty for a termcap code
+        std::array<char, 2> code {};
+
+        [[nodiscard]] constexpr std::string_view text() const noexcept
+        {
+            return name.empty() ? std::string_view(code.data(), code.size()) : name;
+        }
+    };
+
+    constexpr uint32_t hashName(std::string_view _name) noexcept
+    {
+        auto hash = 2166136261u; // FNV-1a
+        for (char const ch: _name)
+            hash = (hash ^ static_cast<uint8_t>(ch)) * 16777619u;
+        return hash;
+    }
+
+    /// Derives the hash selecting a bucket (seed 0) or slot from the hash of a name, such that finding
+    /// a seed does not need to hash the names again.
+    constexpr uint32_t mixHash(uint32_t _hash, uint32_t _seed) noexcept
+    {
+        auto hash = _hash ^ (_seed * 0x9E3779B9u);
+        hash ^= hash >> 16;
+        hash *= 0x7FEB352Du;
+        hash ^= hash >> 15;
+        hash *= 0x846CA68Bu;
+        hash ^= hash >> 16;
+        return hash;
+    }
+
+    /// Maps each name capabilities are requested by onto a slot of its own, by means of a seed per
+    /// bucket of names (hash and displace), such that a lookup takes one hash and one comparison.
+    class RequestNameHash
+    {
+      public:
+        static constexpr size_t BucketCount = 128;
+        static constexpr size_t SlotCount = 1024;
+        static constexpr size_t MaxBucketSize = 16;
+
+        constexpr RequestNameHash()
+        {
+            auto buckets = std::array<std::array<Entry, MaxBucketSize>, BucketCount> {};
+            auto bucketSizes = std::array<size_t, BucketCount> {};
+            auto const add = [&](RequestName _name) {
+                auto const hash = hashName(_name.text());
+                auto const bucket = mixHash(hash, 0) % BucketCount;
+                for (size_t i = 0; i < bucketSizes[bucket]; ++i)
+                    if (buckets[bucket][i].hash == hash && buckets[bucket][i].name.text() == _name.text())
+                        return;
+                if (bucketSizes[bucket] == MaxBucketSize)
+                {
+                    valid_ = false;
+                    return;
+                }
+                buckets[bucket][bucketSizes[bucket]++] = Entry { _name, hash };
+            };
+            auto const addCapability = [&](Code _code, std::string_view _name) {
+                if (!_name.empty())
+                    add(RequestName { _name });
+                if (_code != Undefined)
+                {
+                    auto const code = std::array { static_cast<char>(_code.code >> 8),
+                                                   static_cast<char>(_code.code & 0xFF) };
+                    add(RequestName { {}, code });
+                }
+            };
+            for (auto const& cap: booleanCaps)
+                addCapability(cap.code, cap.name);
+            for (auto const& cap: numericalCaps)
+                addCapability(cap.code, cap.name);
+            for (auto const& cap: stringCaps)
+                addCapability(cap.code, cap.name);
+
+            // Places the largest buckets first, while most slots are still free.
+            for (auto bucketSize = MaxBucketSize; bucketSize > 0; --bucketSize)
+                for (size_t bucket = 0; bucket < BucketCount; ++bucket)
+                    if (bucketSizes[bucket] == bucketSize)
+                        place(bucket, buckets[bucket], bucketSize);
+        }
+
+        [[nodiscard]] constexpr bool valid() const noexcept { return valid_; }
+
+        /// @returns the slot of the given name, or SlotCount if it is not the name of any capability.
+        [[nodiscard]] constexpr size_t find(std::string_view _name) const noexcept
+        {
+            auto const hash = hashName(_name);
+            auto const slot = mixHash(hash, seeds_[mixHash(hash, 0) % BucketCount]) % SlotCount;
+            if (used_[slot] && slots_[slot].text() == _name)
+                return slot;
+            return SlotCount;
+        }
+
+        [[nodiscard]] constexpr bool used(size_t _slot) const noexcept { return used_[_slot]; }
+        [[nodiscard]] constexpr std::string_view name(size_t _slot) const noexcept
+        {
+            return slots_[_slot].text();
+        }
+
+      private:
+        struct Entry
+        {
+            RequestName name;
+            uint32_t hash = 0;
+        };
+
+        constexpr void place(size_t _bucket, std::array<Entry, MaxBucketSize> const& _entries, size_t _count)
+        {
+            auto slots = std::array<size_t, MaxBucketSize> {};
+            for (uint32_t seed = 1; seed < 0x10000; ++seed)
+            {
+                auto placeable = true;
+                for (size_t i = 0; i < _count && placeable; ++i)
+                {
+                    slots[i] = mixHash(_entries[i].hash, seed) % SlotCount;
+                    placeable = !used_[slots[i]];
+                    for (size_t k = 0; k < i && placeable; ++k)
+                        placeable = slots[k] != slots[i];
+                }
+                if (!placeable)
+                    continue;
+
+                seeds_[_bucket] = seed;
+                for (size_t i = 0; i < _count; ++i)
+                {
+                    used_[slots[i]] = true;
+                    slots_[slots[i]] = _entries[i].name;
+                }
+                return;
+            }
+            valid_ = false;
+        }
+
+        std::array<uint32_t, BucketCount> seeds_ {};
+        std::array<RequestName, SlotCount> slots_ {};
+        std::array<bool, SlotCount> used_ {};
+        bool valid_ = true;
+    };
+
+    constexpr auto inline requestNames = RequestNameHash {};
+    static_assert(requestNames.valid(), "No perfect hash found for the capability names.");
+
+    /// Encodes the XTGETTCAP reply to the request of the given capability name.
+    string encodeCapabilityReply(StaticDatabase const& _database, string_view _name)
+    {
+        using crispy::toHexString;
+
+        if (_database.booleanCapability(_name))
+            return fmt::format("\033P1+r{}\033\\", toHexString(_name));
+
+        if (auto const value = _database.numericCapability(_name); value != Database::npos)
+        {
+            auto hexValue = fmt::format("{:X}", value);
+            if (hexValue.size() % 2)
+                hexValue.insert(hexValue.begin(), '0');
+            return fmt::format("\033P1+r{}={}\033\\", toHexString(_name), hexValue);
+        }
+
+        if (auto const value = _database.stringCapability(_name); !value.empty())
+            return fmt::format("\033P1+r{}={}\033\\", toHexString(_name), toHexString(value));
+
+        return "\033P0+r\033\\";
+    }
+    // }}}
 } // namespace
 
 bool StaticDatabase::booleanCapability(Code _cap) const
@@ -529,6 +699,24 @@ optional<Code> StaticDatabase::codeFromName(string_view _name) const
     return nullopt;
 }
 
+string_view StaticDatabase::capabilityReply(string_view _name) const
+{
+    // The replies to all names are encoded once, as they never change.
+    static auto const replies = []() {
+        auto const database = StaticDatabase {};
+        auto replies = std::vector<string>(RequestNameHash::SlotCount);
+        for (size_t slot = 0; slot < replies.size(); ++slot)
+            if (requestNames.used(slot))
+                replies[slot] = encodeCapabilityReply(database, requestNames.name(slot));
+        return replies;
+    }();
+
+    if (auto const slot = requestNames.find(_name); slot != RequestNameHash::SlotCount)
+        return replies[slot];
+
+    return "\033P0+r\033\\"sv;
+}
+
 string StaticDatabase::terminfo() const
 {
     using namespace ranges;
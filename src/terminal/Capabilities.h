@@ -115,6 +115,12 @@ class StaticDatabase: public Database
 
     std::optional<Code> codeFromName(std::string_view _name) const override;
 
+    /// Returns the XTGETTCAP reply to the request of the capability of the given terminfo name or
+    /// termcap code, i.e. DCS 1 + r name = value ST, or DCS 0 + r ST if unknown.
+    ///
+    /// The replies are encoded once, and looked up through a perfect hash of all names.
+    [[nodiscard]] std::string_view capabilityReply(std::string_view _name) const;
+
     std::string terminfo() const override;
 };
 
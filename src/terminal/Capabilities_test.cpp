@@ -44,3 +44,15 @@ TEST_CASE("Capabilities.get")
     auto const bce = tcap.numericCapability("bce");
     REQUIRE(bce);
 }
+
+TEST_CASE("Capabilities.capabilityReply")
+{
+    terminal::capabilities::StaticDatabase tcap;
+    CHECK(tcap.capabilityReply("RGB") == "\033P1+r524742=382F382F38\033\\");
+    CHECK(tcap.capabilityReply("colors") == "\033P1+r636F6C6F7273=0100\033\\");
+    CHECK(tcap.capabilityReply("Co") == "\033P1+r436F=0100\033\\");
+    CHECK(tcap.capabilityReply("bce") == "\033P1+r626365\033\\");
+    CHECK(tcap.capabilityReply("hpa") == "\033P1+r687061=1B5B2569257031256447\033\\");
+    CHECK(tcap.capabilityReply("nonexistent") == "\033P0+r\033\\");
+    CHECK(tcap.capabilityReply("") == "\033P0+r\033\\");
+}
@@ -44,6 +44,7 @@ enum class CellFlags : uint32_t
     Overline = (1 << 14),
     RapidBlinking = (1 << 15),
     CharacterProtected = (1 << 16), // Character is protected by selective erase operations.
+    Image = (1 << 17),              // Cell displays an image placed onto its line.
 };
 
 constexpr CellFlags& operator|=(CellFlags& a, CellFlags b) noexcept
@@ -102,7 +103,7 @@ struct formatter<terminal::CellFlags>
     template <typename FormatContext>
     auto format(const terminal::CellFlags _flags, FormatContext& ctx)
     {
-        static const std::array<std::pair<terminal::CellFlags, std::string_view>, 17> nameMap = {
+        static const std::array<std::pair<terminal::CellFlags, std::string_view>, 18> nameMap = {
             std::pair { terminal::CellFlags::Bold, std::string_view("Bold") },
             std::pair { terminal::CellFlags::Faint, std::string_view("Faint") },
             std::pair { terminal::CellFlags::Italic, std::string_view("Italic") },
@@ -120,6 +121,7 @@ struct formatter<terminal::CellFlags>
             std::pair { terminal::CellFlags::Encircled, std::string_view("Encircled") },
             std::pair { terminal::CellFlags::Overline, std::string_view("Overline") },
             std::pair { terminal::CellFlags::CharacterProtected, std::string_view("CharacterProtected") },
+            std::pair { terminal::CellFlags::Image, std::string_view("Image") },
         };
         std::string s;
         for (auto const& mapping: nameMap)
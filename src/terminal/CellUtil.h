@@ -95,7 +95,7 @@ template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
 [[nodiscard]] inline bool empty(Cell const& cell) noexcept
 {
-    return (cell.codepointCount() == 0 || cell.codepoint(0) == 0x20) && !cell.imageFragment();
+    return (cell.codepointCount() == 0 || cell.codepoint(0) == 0x20) && !cell.hasImage();
 }
 
 template <typename Cell>
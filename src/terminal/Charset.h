@@ -105,6 +105,10 @@ class CharsetMapping
 
     [[nodiscard]] bool isSelected(CharsetId _id) const noexcept { return isSelected(currentTable(), _id); }
 
+    /// Tests whether a single shift is pending, i.e. the next character is mapped by another table
+    /// than the ones following it.
+    [[nodiscard]] bool isSingleShifted() const noexcept { return shift_ != selected_; }
+
     void select(CharsetTable _table, CharsetId _id) noexcept
     {
         tables_[static_cast<size_t>(_table)] = charsetMap(_id);
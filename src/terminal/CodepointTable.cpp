@@ -0,0 +1,100 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/CodepointTable.h>
+
+#include <unicode/width.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace terminal
+{
+
+namespace
+{
+    // One codepoint of every grapheme cluster break property value (CR, LF, Control, Extend, ZWJ,
+    // Regional_Indicator, Prepend, SpacingMark, L, V, T, LV, LVT, Other), plus Extended_Pictographic
+    // and an emoji modifier, as the rules of UAX #29 only depend on these properties.
+    constexpr std::array<char32_t, 16> GraphemeBreakProbes = {
+        0x000D,  // CR
+        0x000A,  // LF
+        0x0001,  // Control
+        0x0300,  // Extend
+        0x200D,  // ZWJ
+        0x1F1E6, // Regional_Indicator
+        0x0600,  // Prepend
+        0x0903,  // SpacingMark
+        0x1100,  // L
+        0x1160,  // V
+        0x11A8,  // T
+        0xAC00,  // LV
+        0xAC01,  // LVT
+        U'a',    // Other
+        0x1F600, // Extended_Pictographic
+        0x1F3FB, // Emoji modifier
+    };
+
+    // A codepoint breaks by default if it is not kept together with itself, nor with any of the probes
+    // that are not kept together with themselves. Two such codepoints then always break, as they are
+    // each of a property value (represented by a probe) the other one breaks with.
+    bool breaksByDefault(char32_t _codepoint) noexcept
+    {
+        using unicode::grapheme_segmenter;
+        static auto const selfBreakingProbes = []() {
+            auto probes = std::vector<char32_t> {};
+            for (char32_t const probe: GraphemeBreakProbes)
+                if (grapheme_segmenter::breakable(probe, probe))
+                    probes.push_back(probe);
+            return probes;
+        }();
+
+        if (!grapheme_segmenter::breakable(_codepoint, _codepoint))
+            return false;
+        return std::all_of(selfBreakingProbes.begin(), selfBreakingProbes.end(), [=](char32_t _probe) {
+            return grapheme_segmenter::breakable(_probe, _codepoint)
+                   && grapheme_segmenter::breakable(_codepoint, _probe);
+        });
+    }
+
+    std::array<std::atomic<CodepointTable::Block const*>, CodepointTable::BlockCount> blocks {};
+} // namespace
+
+CodepointInfo CodepointTable::compute(char32_t _codepoint) noexcept
+{
+    auto const width = std::clamp(unicode::width(_codepoint), 0, int { CodepointInfo::WidthMask });
+    auto info = CodepointInfo { static_cast<uint8_t>(width) };
+    if (breaksByDefault(_codepoint))
+        info.value |= CodepointInfo::BreaksByDefaultFlag;
+    return info;
+}
+
+CodepointTable::Block const& CodepointTable::block(size_t _index) noexcept
+{
+    if (auto const* existing = blocks[_index].load(std::memory_order_acquire))
+        return *existing;
+
+    auto computed = std::make_unique<Block>();
+    for (size_t i = 0; i < BlockSize; ++i)
+        (*computed)[i] = compute(static_cast<char32_t>(_index * BlockSize + i));
+
+    // Another thread might have computed the same block meanwhile, in which case that one is used.
+    auto const* expected = static_cast<Block const*>(nullptr);
+    if (blocks[_index].compare_exchange_strong(expected, computed.get(), std::memory_order_acq_rel))
+        return *computed.release();
+    return *expected;
+}
+
+} // namespace terminal
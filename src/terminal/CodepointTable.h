@@ -0,0 +1,95 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <unicode/grapheme_segmenter.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace terminal
+{
+
+/// The Unicode properties of a single codepoint as needed when writing text to the screen,
+/// packed into one byte.
+struct CodepointInfo
+{
+    static constexpr uint8_t WidthMask = 0x03;
+    static constexpr uint8_t BreaksByDefaultFlag = 0x04;
+
+    uint8_t value = 0;
+
+    /// Number of grid cells the codepoint occupies, as of unicode::width().
+    [[nodiscard]] int width() const noexcept { return value & WidthMask; }
+
+    /// Whether the codepoint is subject to none of the grapheme cluster rules other than
+    /// "break everywhere else", i.e. a grapheme cluster boundary is always on both sides
+    /// of it if the adjacent codepoint is such, too.
+    [[nodiscard]] bool breaksByDefault() const noexcept { return value & BreaksByDefaultFlag; }
+};
+
+/**
+ * Two-level lookup table of CodepointInfo, derived from libunicode.
+ *
+ * The table is split into blocks of 256 consecutive codepoints. Each block is computed upon first
+ * use and is then shared across all instances (and threads) for the lifetime of the process.
+ * Each instance additionally remembers the block it used last, as text usually is made of
+ * codepoints of the same script and thus of the same few blocks.
+ *
+ * Codepoints beyond the Unicode range are not tabled but computed each time.
+ */
+class CodepointTable
+{
+  public:
+    static constexpr size_t BlockSize = 256;
+    static constexpr size_t BlockCount = (0x10FFFF + 1) / BlockSize;
+
+    using Block = std::array<CodepointInfo, BlockSize>;
+
+    [[nodiscard]] CodepointInfo get(char32_t _codepoint) noexcept
+    {
+        auto const blockIndex = static_cast<size_t>(_codepoint / BlockSize);
+        if (blockIndex != lastBlockIndex_)
+        {
+            if (blockIndex >= BlockCount)
+                return compute(_codepoint);
+            lastBlock_ = &block(blockIndex);
+            lastBlockIndex_ = blockIndex;
+        }
+        return (*lastBlock_)[_codepoint % BlockSize];
+    }
+
+    [[nodiscard]] int width(char32_t _codepoint) noexcept { return get(_codepoint).width(); }
+
+    /// Same as unicode::grapheme_segmenter::breakable(), but without consulting libunicode
+    /// if both codepoints break by default.
+    [[nodiscard]] bool breakable(char32_t _a, char32_t _b) noexcept
+    {
+        if (get(_a).breaksByDefault() && get(_b).breaksByDefault())
+            return true;
+        return unicode::grapheme_segmenter::breakable(_a, _b);
+    }
+
+    /// Computes the properties of the given codepoint without looking it up.
+    static CodepointInfo compute(char32_t _codepoint) noexcept;
+
+  private:
+    static Block const& block(size_t _index) noexcept;
+
+    size_t lastBlockIndex_ = BlockCount;
+    Block const* lastBlock_ = nullptr;
+};
+
+} // namespace terminal
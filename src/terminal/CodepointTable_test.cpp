@@ -0,0 +1,67 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/CodepointTable.h>
+
+#include <unicode/grapheme_segmenter.h>
+#include <unicode/width.h>
+
+#include <fmt/format.h>
+
+#include <catch2/catch.hpp>
+
+#include <string_view>
+
+using namespace terminal;
+using namespace std::string_view_literals;
+
+TEST_CASE("CodepointTable.width", "[unicode]")
+{
+    auto table = CodepointTable {};
+    for (char32_t codepoint = 0; codepoint < 0x30000; ++codepoint)
+    {
+        INFO(fmt::format("U+{:04X}", static_cast<uint32_t>(codepoint)));
+        REQUIRE(table.width(codepoint) == unicode::width(codepoint));
+    }
+
+    // Beyond the Unicode range.
+    CHECK(table.width(0x110000) == unicode::width(0x110000));
+}
+
+TEST_CASE("CodepointTable.breakable", "[unicode]")
+{
+    // Latin, combining marks, CJK, Hangul syllables and jamo, emoji with modifiers and ZWJ sequences,
+    // regional indicators, and variation selectors.
+    auto constexpr Text = U"ab́c中文。가각"
+                          U"\U0001F44D\U0001F3FD\U0001F468‍\U0001F469\U0001F1E9\U0001F1EA"
+                          U"❤️\u0001\r\n"sv;
+
+    auto table = CodepointTable {};
+    for (char32_t const a: Text)
+        for (char32_t const b: Text)
+        {
+            INFO(fmt::format("U+{:04X} U+{:04X}", static_cast<uint32_t>(a), static_cast<uint32_t>(b)));
+            CHECK(table.breakable(a, b) == unicode::grapheme_segmenter::breakable(a, b));
+        }
+}
+
+TEST_CASE("CodepointTable.shared", "[unicode]")
+{
+    // Blocks are computed once and then shared by all tables.
+    auto a = CodepointTable {};
+    auto b = CodepointTable {};
+    CHECK(a.get(0x4E2D).value == b.get(0x4E2D).value);
+    CHECK(a.get(0x4E2D).value == CodepointTable::compute(0x4E2D).value);
+    CHECK(a.get(U'x').breaksByDefault());
+    CHECK(!a.get(0x0301).breaksByDefault());
+}
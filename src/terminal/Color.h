@@ -383,6 +383,14 @@ struct CellForegroundColor
 struct CellBackgroundColor
 {
 };
+constexpr bool operator==(CellForegroundColor, CellForegroundColor) noexcept
+{
+    return true;
+}
+constexpr bool operator==(CellBackgroundColor, CellBackgroundColor) noexcept
+{
+    return true;
+}
 using CellRGBColor = std::variant<RGBColor, CellForegroundColor, CellBackgroundColor>;
 
 struct CellRGBColorPair
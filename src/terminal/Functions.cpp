@@ -26,6 +26,7 @@
 #include <algorithm>
 #include <array>
 #include <numeric>
+#include <optional>
 #include <sstream>
 #include <string>
 
@@ -44,32 +45,119 @@ using std::stringstream;
 namespace terminal
 {
 
-FunctionDefinition const* select(FunctionSelector const& _selector) noexcept
+namespace
 {
-    auto static const& funcs = functions();
+    // {{{ dispatch table
+    /// Range of function definitions within functions() that share the same category, leader,
+    /// intermediate and final character, and thus only differ in their number of parameters.
+    struct FunctionRange
+    {
+        uint8_t first = 0;
+        uint8_t count = 0;
+    };
+
+    constexpr size_t CategoryCount = 5;
+    constexpr size_t LeaderCount = 5;        // none, or one of: < = > ?
+    constexpr size_t IntermediateCount = 17; // none, or 0x20..0x2F
+    constexpr size_t FinalSymbolCount = 128;
+    constexpr size_t OSCodeCount = 1024;
+    constexpr size_t MaxPrefixCount = 32;
+    constexpr uint8_t None = 0xFF;
+
+    /// Maps category, leader and intermediate to a unique key, if within range.
+    constexpr std::optional<size_t> prefixKey(FunctionCategory _category,
+                                              char _leader,
+                                              char _intermediate) noexcept
+    {
+        auto const leader = !_leader                               ? 0
+                            : _leader >= 0x3C && _leader <= 0x3F ? _leader - 0x3C + 1
+                                                                 : -1;
+        auto const intermediate = !_intermediate                                     ? 0
+                                  : _intermediate >= 0x20 && _intermediate <= 0x2F ? _intermediate - 0x20 + 1
+                                                                                   : -1;
+        if (leader < 0 || intermediate < 0)
+            return std::nullopt;
 
-    // std::cout << fmt::format("select: {}\n", _selector);
+        return (static_cast<size_t>(_category) * LeaderCount + static_cast<size_t>(leader))
+                   * IntermediateCount
+               + static_cast<size_t>(intermediate);
+    }
+
+    /// Lookup tables for select(), indexing into functions().
+    struct FunctionIndex
+    {
+        // Maps prefixKey() to the prefix' row in ranges.
+        std::array<uint8_t, CategoryCount * LeaderCount * IntermediateCount> prefixes {};
+        std::array<std::array<FunctionRange, FinalSymbolCount>, MaxPrefixCount> ranges {};
+        std::array<uint8_t, OSCodeCount> operatingSystemCommands {};
+        size_t prefixCount = 0;
+    };
 
-    auto a = size_t { 0 };
-    auto b = funcs.size() - 1;
-    while (a <= b)
+    constexpr FunctionIndex makeFunctionIndex() noexcept
     {
-        auto const i = (a + b) / 2;
-        auto const& I = funcs[i];
-        auto const rel = compare(_selector, I);
-        // std::cout << fmt::format(" - a:{:>2} b:{:>2} i:{} rel:{} I: {}\n", a, b, i, rel < 0 ? '<' : rel > 0
-        // ? '>' : '=', I);
-        if (rel > 0)
-            a = i + 1;
-        else if (rel < 0)
+        auto const funcs = detail::makeFunctions();
+        static_assert(std::tuple_size_v<decltype(funcs)> < None);
+
+        auto index = FunctionIndex {};
+        for (auto& prefix: index.prefixes)
+            prefix = None;
+        for (auto& command: index.operatingSystemCommands)
+            command = None;
+
+        for (size_t i = 0; i < funcs.size(); ++i)
         {
-            if (i == 0)
-                return nullptr;
-            b = i - 1;
+            auto const& f = funcs[i];
+            if (f.category == FunctionCategory::OSC)
+            {
+                index.operatingSystemCommands.at(f.maximumParameters) = static_cast<uint8_t>(i);
+                continue;
+            }
+
+            auto& prefix = index.prefixes.at(*prefixKey(f.category, f.leader, f.intermediate));
+            if (prefix == None)
+                prefix = static_cast<uint8_t>(index.prefixCount++);
+
+            // Functions sharing the same prefix and final character are adjacent due to their sort order.
+            auto& range = index.ranges.at(prefix).at(static_cast<size_t>(f.finalSymbol));
+            if (!range.count)
+                range.first = static_cast<uint8_t>(i);
+            ++range.count;
         }
-        else
-            return &I;
+        return index;
+    }
+
+    constexpr auto functionIndex = makeFunctionIndex();
+    static_assert(functionIndex.prefixCount <= MaxPrefixCount);
+    // }}}
+} // namespace
+
+FunctionDefinition const* select(FunctionSelector const& _selector) noexcept
+{
+    auto static const& funcs = functions();
+
+    if (_selector.category == FunctionCategory::OSC)
+    {
+        if (_selector.argc < 0 || static_cast<size_t>(_selector.argc) >= OSCodeCount || _selector.leader
+            || _selector.intermediate || _selector.finalSymbol)
+            return nullptr;
+        auto const i = functionIndex.operatingSystemCommands[static_cast<size_t>(_selector.argc)];
+        return i != None ? &funcs[i] : nullptr;
     }
+
+    auto const key = prefixKey(_selector.category, _selector.leader, _selector.intermediate);
+    auto const finalSymbol = static_cast<unsigned char>(_selector.finalSymbol);
+    if (!key || finalSymbol >= FinalSymbolCount)
+        return nullptr;
+
+    auto const prefix = functionIndex.prefixes[*key];
+    if (prefix == None)
+        return nullptr;
+
+    // Usually there is only one candidate, that just needs its number of parameters to be checked.
+    auto const range = functionIndex.ranges[prefix][finalSymbol];
+    for (auto i = range.first; i < range.first + range.count; ++i)
+        if (compare(_selector, funcs[i]) == 0)
+            return &funcs[i];
     return nullptr;
 }
 
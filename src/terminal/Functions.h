@@ -422,6 +422,9 @@ constexpr inline auto XTREPORTCOLORS = detail::CSI(std::nullopt, 0, 0, '#', 'R',
 constexpr inline auto XTSHIFTESCAPE=detail::CSI('>', 0, 1, std::nullopt, 's', VTExtension::XTerm, "XTSHIFTESCAPE", "Set/reset shift-escape options.");
 constexpr inline auto XTVERSION   = detail::CSI('>', 0, 1, std::nullopt, 'q', VTExtension::XTerm, "XTVERSION", "Query terminal name and version");
 constexpr inline auto XTCAPTURE   = detail::CSI('>', 0, 2, std::nullopt, 't', VTExtension::Contour, "XTCAPTURE", "Report screen buffer capture.");
+constexpr inline auto XTLATENCY   = detail::CSI('>', 0, 1, std::nullopt, 'z', VTExtension::Contour, "XTLATENCY", "Report input latency statistics.");
+constexpr inline auto XTCACHESTATS= detail::CSI('>', 0, 0, std::nullopt, 'y', VTExtension::Contour, "XTCACHESTATS", "Report cache statistics.");
+constexpr inline auto XTMEMSTATS  = detail::CSI('>', 0, 0, std::nullopt, 'w', VTExtension::Contour, "XTMEMSTATS", "Report memory usage.");
 
 constexpr inline auto DECSSDT     = detail::CSI(std::nullopt, 0, 1, '$', '~', VTType::VT320, "DECSSDT", "Select Status Display (Line) Type");
 constexpr inline auto DECSASD     = detail::CSI(std::nullopt, 0, 1, '$', '}', VTType::VT420, "DECSASD", "Select Active Status Display");
@@ -432,6 +435,7 @@ constexpr inline auto STP         = detail::DCS(std::nullopt, 0, 0, '$', 'p', VT
 constexpr inline auto DECRQSS     = detail::DCS(std::nullopt, 0, 0, '$', 'q', VTType::VT420, "DECRQSS", "Request Status String");
 constexpr inline auto DECSIXEL    = detail::DCS(std::nullopt, 0, 3, std::nullopt, 'q', VTType::VT330, "DECSIXEL", "Sixel Graphics Image");
 constexpr inline auto XTGETTCAP   = detail::DCS(std::nullopt, 0, 0, '+', 'q', VTExtension::XTerm, "XTGETTCAP", "Request Termcap/Terminfo String");
+constexpr inline auto TMUXCC      = detail::DCS(std::nullopt, 1, 1, std::nullopt, 'p', VTExtension::Unknown, "TMUXCC", "tmux Control Mode");
 
 // OSC
 constexpr inline auto SETTITLE      = detail::OSC(0, VTExtension::XTerm, "SETINICON", "Change Window & Icon Title");
@@ -454,6 +458,7 @@ constexpr inline auto SETFONT       = detail::OSC(50, VTExtension::XTerm, "SETFO
 constexpr inline auto SETFONTALL    = detail::OSC(60, VTExtension::Contour, "SETFONTALL", "Get or set all font faces, styles, size.");
 // printf "\033]52;c;$(printf "%s" "blabla" | base64)\a"
 constexpr inline auto CLIPBOARD     = detail::OSC(52, VTExtension::XTerm, "CLIPBOARD", "Clipboard management.");
+constexpr inline auto SHELLINTEGRATION = detail::OSC(133, VTExtension::Unknown, "SHELLINTEGRATION", "Shell integration: prompt, command and output boundaries");
 constexpr inline auto RCOLPAL       = detail::OSC(104, VTExtension::XTerm, "RCOLPAL", "Reset color full palette or entry");
 constexpr inline auto COLORSPECIAL  = detail::OSC(106, VTExtension::XTerm, "COLORSPECIAL", "Enable/disable Special Color Number c.");
 constexpr inline auto RCOLORFG      = detail::OSC(110, VTExtension::XTerm, "RCOLORFG", "Reset VT100 text foreground color.");
@@ -467,12 +472,16 @@ constexpr inline auto NOTIFY        = detail::OSC(777, VTExtension::XTerm,"NOTIF
 constexpr inline auto DUMPSTATE     = detail::OSC(888, VTExtension::Contour, "DUMPSTATE", "Dumps internal state to debug stream.");
 
 constexpr inline auto CaptureBufferCode = 314;
+constexpr inline auto InputLatencyCode = 315;
+constexpr inline auto CacheStatsCode = 316;
+constexpr inline auto MemoryStatsCode = 317;
 
 // clang-format on
 
-inline auto const& functions() noexcept
+namespace detail
 {
-    static auto const funcs = []() constexpr
+    /// Returns all supported functions, sorted such that they can be looked up by select().
+    constexpr auto makeFunctions() noexcept
     { // {{{
         auto f = std::array {
             // C0
@@ -510,6 +519,9 @@ inline auto const& functions() noexcept
             // CSI
             ANSISYSSC,
             XTCAPTURE,
+            XTLATENCY,
+            XTCACHESTATS,
+            XTMEMSTATS,
             CBT,
             CHA,
             CHT,
@@ -585,6 +597,7 @@ inline auto const& functions() noexcept
             DECRQSS,
             DECSIXEL,
             XTGETTCAP,
+            TMUXCC,
 
             // OSC
             SETICON,
@@ -604,6 +617,7 @@ inline auto const& functions() noexcept
             CLIPBOARD,
             RCOLPAL,
             COLORSPECIAL,
+            SHELLINTEGRATION,
             RCOLORFG,
             RCOLORBG,
             RCOLORCURSOR,
@@ -618,8 +632,12 @@ inline auto const& functions() noexcept
             f,
             [](FunctionDefinition const& a, FunctionDefinition const& b) constexpr { return compare(a, b); });
         return f;
-    }
-    (); // }}}
+    } // }}}
+} // namespace detail
+
+inline auto const& functions() noexcept
+{
+    static constexpr auto funcs = detail::makeFunctions();
 
 #if 0
     for (auto [a, b] : crispy::indexed(funcs))
@@ -72,3 +72,36 @@ TEST_CASE("Functions.OSC777", "[Functions]")
     REQUIRE(osc);
     CHECK(*osc == NOTIFY);
 }
+
+TEST_CASE("Functions.select_all", "[Functions]")
+{
+    // Every function must be found by its own syntax, with any number of parameters it accepts.
+    for (auto const& f: functions())
+    {
+        INFO(fmt::format("{}", f));
+        if (f.category == FunctionCategory::OSC)
+        {
+            auto const* g = selectOSCommand(f.maximumParameters);
+            REQUIRE(g);
+            CHECK(*g == f);
+            continue;
+        }
+
+        for (auto const argc: { int(f.minimumParameters), int(f.maximumParameters) })
+        {
+            auto const* g = select({ f.category, f.leader, argc, f.intermediate, f.finalSymbol });
+            REQUIRE(g);
+            CHECK(*g == f);
+        }
+    }
+}
+
+TEST_CASE("Functions.select_unknown", "[Functions]")
+{
+    CHECK(selectControl(0, 3, 0, 's') == nullptr);
+    CHECK(selectControl('!', 0, 0, 'm') == nullptr);
+    CHECK(selectControl(0, 0, 0, '\x7F') == nullptr);
+    CHECK(selectEscape(0, 'x') == nullptr);
+    CHECK(selectOSCommand(-1) == nullptr);
+    CHECK(selectOSCommand(9999) == nullptr);
+}
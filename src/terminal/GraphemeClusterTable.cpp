@@ -0,0 +1,113 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/GraphemeClusterTable.h>
+
+#include <crispy/InternTable.h>
+
+#include <algorithm>
+#include <array>
+
+using std::u32string_view;
+
+namespace terminal
+{
+
+namespace
+{
+    struct Codepoints
+    {
+        uint8_t length = 0;
+        std::array<char32_t, GraphemeCluster::MaxLength> codepoints {};
+
+        Codepoints() = default;
+        explicit Codepoints(u32string_view _codepoints): length { static_cast<uint8_t>(_codepoints.size()) }
+        {
+            std::copy(_codepoints.begin(), _codepoints.end(), codepoints.begin());
+        }
+
+        [[nodiscard]] u32string_view view() const noexcept
+        {
+            return u32string_view(codepoints.data(), length);
+        }
+    };
+
+    struct ViewOf
+    {
+        u32string_view operator()(Codepoints const& _codepoints) const noexcept
+        {
+            return _codepoints.view();
+        }
+    };
+
+    using Table = crispy::InternTable<Codepoints, u32string_view, ViewOf>;
+
+    Table& table() noexcept
+    {
+        // Intentionally never destroyed, as cells in static storage may outlive it.
+        static auto* table = new Table();
+        return *table;
+    }
+} // namespace
+
+GraphemeCluster::GraphemeCluster(u32string_view _codepoints) noexcept
+{
+    _codepoints = _codepoints.substr(0, MaxLength);
+    if (!_codepoints.empty())
+        id_ = table().intern(_codepoints);
+}
+
+u32string_view GraphemeCluster::codepoints() const noexcept
+{
+    if (!id_)
+        return {};
+    return table().get(id_).view();
+}
+
+bool GraphemeCluster::append(char32_t _codepoint) noexcept
+{
+    auto const current = codepoints();
+    if (current.size() == MaxLength)
+        return false;
+
+    auto buffer = std::array<char32_t, MaxLength> {};
+    std::copy(current.begin(), current.end(), buffer.begin());
+    buffer[current.size()] = _codepoint;
+
+    auto const id = table().intern(u32string_view(buffer.data(), current.size() + 1));
+    if (!id)
+        return false;
+
+    release(std::exchange(id_, id));
+    return true;
+}
+
+GraphemeClusterStats GraphemeCluster::stats()
+{
+    auto const stats = table().stats();
+    return GraphemeClusterStats { stats.entries, stats.capacity, stats.peak, stats.bytes };
+}
+
+void GraphemeCluster::retain(uint32_t _id) noexcept
+{
+    if (_id)
+        table().retain(_id);
+}
+
+void GraphemeCluster::release(uint32_t _id) noexcept
+{
+    if (_id)
+        table().release(_id);
+}
+
+} // namespace terminal
@@ -0,0 +1,128 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <fmt/format.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+
+namespace terminal
+{
+
+struct GraphemeClusterStats
+{
+    std::size_t clusters = 0; //!< number of distinct clusters currently referenced
+    std::size_t capacity = 0; //!< number of clusters the allocated table chunks can hold
+    std::size_t peak = 0;     //!< highest number of clusters referenced at the same time
+    std::size_t bytes = 0;    //!< estimated number of bytes held by the table
+};
+
+/**
+ * Reference to a sequence of codepoints that is interned in a process-wide table,
+ * shared across all terminals (and threads).
+ *
+ * Equal sequences are stored only once and are identified by the same 32-bit ID,
+ * so that cells holding the same grapheme cluster (such as a combining mark or an emoji
+ * with its modifiers) neither allocate nor store it each. An entry is recycled as soon as
+ * the last reference to it goes away, e.g. when its lines get dropped off the scrollback.
+ *
+ * The default constructed (empty) sequence is not stored in the table and has the ID 0.
+ */
+class GraphemeCluster
+{
+  public:
+    /// Maximum number of codepoints a cluster can hold.
+    static constexpr std::size_t MaxLength = 8;
+
+    GraphemeCluster() noexcept = default;
+
+    /// Interns the given codepoints, which are cut off at MaxLength.
+    explicit GraphemeCluster(std::u32string_view _codepoints) noexcept;
+
+    GraphemeCluster(GraphemeCluster const& _other) noexcept: id_ { _other.id_ } { retain(id_); }
+    GraphemeCluster(GraphemeCluster&& _other) noexcept: id_ { std::exchange(_other.id_, 0) } {}
+
+    GraphemeCluster& operator=(GraphemeCluster const& _other) noexcept
+    {
+        retain(_other.id_);
+        release(std::exchange(id_, _other.id_));
+        return *this;
+    }
+
+    GraphemeCluster& operator=(GraphemeCluster&& _other) noexcept
+    {
+        if (this != &_other)
+            release(std::exchange(id_, std::exchange(_other.id_, 0)));
+        return *this;
+    }
+
+    ~GraphemeCluster() { release(id_); }
+
+    [[nodiscard]] uint32_t id() const noexcept { return id_; }
+    [[nodiscard]] bool empty() const noexcept { return id_ == 0; }
+
+    /// The codepoints, which stay valid as long as this reference.
+    [[nodiscard]] std::u32string_view codepoints() const noexcept;
+    [[nodiscard]] std::size_t size() const noexcept { return codepoints().size(); }
+    [[nodiscard]] char32_t operator[](std::size_t _index) const noexcept { return codepoints()[_index]; }
+
+    /// Replaces this reference with one to the cluster extended by the given codepoint.
+    ///
+    /// @retval false the cluster is left as is, because it is full or the table is exhausted.
+    bool append(char32_t _codepoint) noexcept;
+
+    /// Returns statistics of the process-wide table.
+    static GraphemeClusterStats stats();
+
+  private:
+    static void retain(uint32_t _id) noexcept;
+    static void release(uint32_t _id) noexcept;
+
+    uint32_t id_ = 0;
+};
+
+inline bool operator==(GraphemeCluster const& a, GraphemeCluster const& b) noexcept
+{
+    return a.id() == b.id();
+}
+
+inline bool operator!=(GraphemeCluster const& a, GraphemeCluster const& b) noexcept
+{
+    return !(a == b);
+}
+
+} // namespace terminal
+
+namespace fmt // {{{
+{
+template <>
+struct formatter<terminal::GraphemeClusterStats>
+{
+    template <typename ParseContext>
+    constexpr auto parse(ParseContext& ctx)
+    {
+        return ctx.begin();
+    }
+    template <typename FormatContext>
+    auto format(terminal::GraphemeClusterStats const& stats, FormatContext& ctx)
+    {
+        return fmt::format_to(
+            ctx.out(), "{} of {} in use (peak {})", stats.clusters, stats.capacity, stats.peak);
+    }
+};
+} // namespace fmt
+// }}}
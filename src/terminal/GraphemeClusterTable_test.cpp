@@ -0,0 +1,99 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/GraphemeClusterTable.h>
+#include <terminal/cell/CompactCell.h>
+
+#include <catch2/catch.hpp>
+
+#include <optional>
+#include <string_view>
+
+using namespace terminal;
+using namespace std::string_view_literals;
+
+TEST_CASE("GraphemeCluster.intern", "[unicode]")
+{
+    auto const empty = GraphemeCluster {};
+    CHECK(empty.empty());
+    CHECK(empty.codepoints().empty());
+    CHECK(GraphemeCluster(U""sv).empty());
+
+    auto const clustersBefore = GraphemeCluster::stats().clusters;
+
+    auto const a = GraphemeCluster(U"\u200D\U0001F469"sv);
+    auto const b = GraphemeCluster(U"\u200D\U0001F469"sv);
+    auto const c = GraphemeCluster(U"\u0301"sv);
+    CHECK(a.codepoints() == U"\u200D\U0001F469"sv);
+    CHECK(a.id() == b.id());
+    CHECK(a != c);
+    CHECK(GraphemeCluster::stats().clusters == clustersBefore + 2);
+
+    // Too long sequences are cut off.
+    auto const d = GraphemeCluster(U"0123456789"sv);
+    CHECK(d.codepoints() == U"01234567"sv);
+}
+
+TEST_CASE("GraphemeCluster.append", "[unicode]")
+{
+    auto cluster = GraphemeCluster(U"\u200D"sv);
+    CHECK(cluster.append(U'\U0001F469'));
+    CHECK(cluster == GraphemeCluster(U"\u200D\U0001F469"sv));
+
+    auto full = GraphemeCluster(U"01234567"sv);
+    CHECK_FALSE(full.append(U'8'));
+    CHECK(full.codepoints() == U"01234567"sv);
+}
+
+TEST_CASE("GraphemeCluster.recycle", "[unicode]")
+{
+    auto const clustersBefore = GraphemeCluster::stats().clusters;
+    {
+        auto a = std::optional<GraphemeCluster>(GraphemeCluster(U"\u0300\u0301\u0302"sv));
+        auto const b = *a;
+        a.reset();
+        // Still referenced by the copy.
+        CHECK(b.codepoints() == U"\u0300\u0301\u0302"sv);
+        CHECK(GraphemeCluster::stats().clusters == clustersBefore + 1);
+    }
+    CHECK(GraphemeCluster::stats().clusters == clustersBefore);
+
+    // Recycled IDs are handed out again.
+    auto const id = GraphemeCluster(U"\u0303"sv).id();
+    CHECK(GraphemeCluster(U"\u0304"sv).id() == id);
+}
+
+TEST_CASE("GraphemeCluster.CompactCell", "[unicode]")
+{
+    auto const clustersBefore = GraphemeCluster::stats().clusters;
+    {
+        auto a = CompactCell {};
+        a.write(GraphicsAttributes {}, U'e', 1);
+        (void) a.appendCharacter(U'\u0301');
+        auto b = CompactCell {};
+        b.write(GraphicsAttributes {}, U'a', 1);
+        (void) b.appendCharacter(U'\u0301');
+        auto const c = a;
+
+        CHECK(a.codepoints() == U"e\u0301");
+        CHECK(b.codepoints() == U"a\u0301");
+        CHECK(c.codepointCount() == 2);
+        CHECK(c.codepoint(1) == U'\u0301');
+        CHECK(GraphemeCluster::stats().clusters == clustersBefore + 1);
+
+        a.write(GraphicsAttributes {}, U'x', 1);
+        CHECK(a.codepointCount() == 1);
+        CHECK(c.codepoints() == U"e\u0301");
+    }
+    CHECK(GraphemeCluster::stats().clusters == clustersBefore);
+}
@@ -0,0 +1,102 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/GraphicsAttributesTable.h>
+
+#include <crispy/InternTable.h>
+
+using std::nullopt;
+using std::optional;
+
+namespace terminal
+{
+
+namespace
+{
+    struct AttributesHash
+    {
+        size_t operator()(GraphicsAttributes const& _attributes) const noexcept
+        {
+            auto const colors = (uint64_t(_attributes.foregroundColor.content) << 32)
+                                ^ (uint64_t(_attributes.backgroundColor.content) << 16)
+                                ^ _attributes.underlineColor.content;
+            auto const flags = static_cast<uint32_t>(_attributes.flags);
+            return static_cast<size_t>((colors ^ flags) * 0x9E3779B97F4A7C15ull);
+        }
+    };
+
+    struct Identity
+    {
+        GraphicsAttributes const& operator()(GraphicsAttributes const& _attributes) const noexcept
+        {
+            return _attributes;
+        }
+    };
+
+    using Table = crispy::InternTable<GraphicsAttributes, GraphicsAttributes, Identity, AttributesHash>;
+
+    Table& table() noexcept
+    {
+        // Intentionally never destroyed, as lines in static storage may outlive it.
+        static auto* table = new Table();
+        return *table;
+    }
+
+    constexpr auto DefaultAttributes = GraphicsAttributes {};
+} // namespace
+
+optional<InternedGraphicsAttributes> InternedGraphicsAttributes::intern(
+    GraphicsAttributes const& _attributes) noexcept
+{
+    if (_attributes == DefaultAttributes)
+        return InternedGraphicsAttributes {};
+
+    // Lines written in a row mostly share their attributes, which then do not need to be looked up.
+    thread_local auto lastInterned = InternedGraphicsAttributes {};
+    if (lastInterned.id_ && lastInterned.get() == _attributes)
+        return lastInterned;
+
+    auto const id = table().intern(_attributes);
+    if (!id)
+        return nullopt;
+
+    lastInterned = InternedGraphicsAttributes(id);
+    return lastInterned;
+}
+
+GraphicsAttributes const& InternedGraphicsAttributes::get() const noexcept
+{
+    if (!id_)
+        return DefaultAttributes;
+    return table().get(id_);
+}
+
+GraphicsAttributesStats InternedGraphicsAttributes::stats()
+{
+    auto const stats = table().stats();
+    return GraphicsAttributesStats { stats.entries, stats.capacity, stats.peak };
+}
+
+void InternedGraphicsAttributes::retain(uint32_t _id) noexcept
+{
+    if (_id)
+        table().retain(_id);
+}
+
+void InternedGraphicsAttributes::release(uint32_t _id) noexcept
+{
+    if (_id)
+        table().release(_id);
+}
+
+} // namespace terminal
@@ -0,0 +1,143 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <terminal/GraphicsAttributes.h>
+
+#include <fmt/format.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+namespace terminal
+{
+
+struct GraphicsAttributesStats
+{
+    std::size_t attributes = 0; //!< number of distinct attributes currently referenced
+    std::size_t capacity = 0;   //!< number of attributes the allocated table chunks can hold
+    std::size_t peak = 0;       //!< highest number of attributes referenced at the same time
+};
+
+/**
+ * Reference to graphics attributes that are interned in a process-wide table,
+ * shared across all terminals (and threads).
+ *
+ * Line buffers of a single SGR (such as TrivialLineBuffer) store their attributes this way,
+ * as most lines share the same few ones, so that each line only holds a 32-bit ID instead.
+ * An entry is recycled as soon as the last reference to it goes away.
+ *
+ * The default graphics attributes are not stored in the table and have the ID 0.
+ * Other attributes cannot be interned once the table is exhausted, in which case their lines
+ * keep them in their cells instead.
+ */
+class InternedGraphicsAttributes
+{
+  public:
+    InternedGraphicsAttributes() noexcept = default;
+
+    /// Interns the given attributes.
+    ///
+    /// @returns the reference to them, or std::nullopt if the table is exhausted.
+    [[nodiscard]] static std::optional<InternedGraphicsAttributes> intern(
+        GraphicsAttributes const& _attributes) noexcept;
+
+    InternedGraphicsAttributes(InternedGraphicsAttributes const& _other) noexcept: id_ { _other.id_ }
+    {
+        retain(id_);
+    }
+    InternedGraphicsAttributes(InternedGraphicsAttributes&& _other) noexcept:
+        id_ { std::exchange(_other.id_, 0) }
+    {
+    }
+
+    InternedGraphicsAttributes& operator=(InternedGraphicsAttributes const& _other) noexcept
+    {
+        retain(_other.id_);
+        release(std::exchange(id_, _other.id_));
+        return *this;
+    }
+
+    InternedGraphicsAttributes& operator=(InternedGraphicsAttributes&& _other) noexcept
+    {
+        if (this != &_other)
+            release(std::exchange(id_, std::exchange(_other.id_, 0)));
+        return *this;
+    }
+
+    ~InternedGraphicsAttributes() { release(id_); }
+
+    [[nodiscard]] uint32_t id() const noexcept { return id_; }
+
+    /// The attributes, which stay valid as long as this reference.
+    [[nodiscard]] GraphicsAttributes const& get() const noexcept;
+
+    operator GraphicsAttributes const&() const noexcept { return get(); }
+    GraphicsAttributes const* operator->() const noexcept { return &get(); }
+
+    /// Returns statistics of the process-wide table.
+    static GraphicsAttributesStats stats();
+
+  private:
+    explicit InternedGraphicsAttributes(uint32_t _id) noexcept: id_ { _id } {}
+
+    static void retain(uint32_t _id) noexcept;
+    static void release(uint32_t _id) noexcept;
+
+    uint32_t id_ = 0;
+};
+
+inline bool operator==(InternedGraphicsAttributes const& a, InternedGraphicsAttributes const& b) noexcept
+{
+    return a.id() == b.id();
+}
+
+inline bool operator!=(InternedGraphicsAttributes const& a, InternedGraphicsAttributes const& b) noexcept
+{
+    return !(a == b);
+}
+
+inline bool operator==(InternedGraphicsAttributes const& a, GraphicsAttributes const& b) noexcept
+{
+    return a.get() == b;
+}
+
+inline bool operator!=(InternedGraphicsAttributes const& a, GraphicsAttributes const& b) noexcept
+{
+    return !(a == b);
+}
+
+} // namespace terminal
+
+namespace fmt // {{{
+{
+template <>
+struct formatter<terminal::GraphicsAttributesStats>
+{
+    template <typename ParseContext>
+    constexpr auto parse(ParseContext& ctx)
+    {
+        return ctx.begin();
+    }
+    template <typename FormatContext>
+    auto format(terminal::GraphicsAttributesStats const& stats, FormatContext& ctx)
+    {
+        return fmt::format_to(
+            ctx.out(), "{} of {} in use (peak {})", stats.attributes, stats.capacity, stats.peak);
+    }
+};
+} // namespace fmt
+// }}}
@@ -0,0 +1,73 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/GraphicsAttributesTable.h>
+
+#include <catch2/catch.hpp>
+
+#include <optional>
+
+using namespace terminal;
+
+namespace
+{
+GraphicsAttributes colored(uint8_t _index)
+{
+    auto attributes = GraphicsAttributes {};
+    attributes.foregroundColor = Color::Indexed(_index);
+    attributes.flags = CellFlags::Bold;
+    return attributes;
+}
+} // namespace
+
+TEST_CASE("InternedGraphicsAttributes.intern")
+{
+    auto const defaulted = InternedGraphicsAttributes {};
+    CHECK(defaulted.id() == 0);
+    CHECK(defaulted == GraphicsAttributes {});
+    CHECK(InternedGraphicsAttributes::intern(GraphicsAttributes {})->id() == 0);
+
+    // Interned first, as the previously interned attributes may only be referenced by the interning thread.
+    auto const a = *InternedGraphicsAttributes::intern(colored(1));
+    auto const attributesBefore = InternedGraphicsAttributes::stats().attributes;
+
+    auto const b = *InternedGraphicsAttributes::intern(colored(1));
+    auto const c = *InternedGraphicsAttributes::intern(colored(2));
+    CHECK(a.id() != 0);
+    CHECK(a.id() == b.id());
+    CHECK(a != c);
+    CHECK(a == colored(1));
+    CHECK(a->foregroundColor == Color::Indexed(1));
+    CHECK(InternedGraphicsAttributes::stats().attributes == attributesBefore + 1);
+}
+
+TEST_CASE("InternedGraphicsAttributes.recycle")
+{
+    auto id = uint32_t { 0 };
+    {
+        auto a = InternedGraphicsAttributes::intern(colored(203));
+        auto const b = *a;
+        id = b.id();
+        a.reset();
+        // Still referenced by the copy.
+        CHECK(b == colored(203));
+    }
+
+    // The most recently interned attributes stay referenced by the interning thread,
+    // until it interns other ones.
+    auto const c = *InternedGraphicsAttributes::intern(colored(204));
+    CHECK(c.id() != id);
+
+    // Recycled IDs are handed out again.
+    CHECK(InternedGraphicsAttributes::intern(colored(205))->id() == id);
+}
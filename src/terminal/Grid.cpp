@@ -20,7 +20,12 @@
 #include <fmt/format.h>
 
 #include <algorithm>
+#include <future>
 #include <iostream>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
 
 using std::max;
 using std::min;
@@ -67,7 +72,7 @@ namespace detail
         lines.reserve(totalLineCount);
 
         for ([[maybe_unused]] auto const _: ranges::views::iota(0u, totalLineCount))
-            lines.emplace_back(defaultLineFlags, TrivialLineBuffer { _pageSize.columns, _initialSGR });
+            lines.emplace_back(defaultLineFlags, _pageSize.columns, _initialSGR);
 
         return lines;
     }
@@ -117,6 +122,235 @@ namespace detail
         return LineCount::cast_from(i);
     }
 
+    /// Finds the bottom-most physical line of the logical line that starts at @p _top.
+    template <typename Cell>
+    int logicalLineBottom(Lines<Cell> const& _lines, int _top, int _bottomMost) noexcept
+    {
+        auto bottom = _top;
+        while (bottom + 1 <= _bottomMost && _lines[bottom + 1].wrapped())
+            ++bottom;
+        return bottom;
+    }
+
+    /**
+     * Attempts to join the physical lines [_top, _bottom] of a logical line into a single
+     * TrivialLineBuffer without inflating any of them.
+     *
+     * This is only possible if all lines are trivial, share the same attributes, and their text is
+     * stored contiguously in the same buffer object, which is the case for text that has been
+     * written in one go and got auto-wrapped.
+     *
+     * @param _lines          the grid lines
+     * @param _top            top-most physical line of the logical line
+     * @param _bottom         bottom-most physical line of the logical line
+     * @param _columnCount    the current column count, each line but the last one must be fully used
+     * @param _newColumnCount the new column count the logical line is about to be rewrapped to
+     *
+     * @returns the joined trivial line buffer or std::nullopt if the logical line must be inflated.
+     */
+    template <typename Cell>
+    std::optional<TrivialLineBuffer> joinTrivialLines(Lines<Cell> const& _lines,
+                                                      int _top,
+                                                      int _bottom,
+                                                      ColumnCount _columnCount,
+                                                      ColumnCount _newColumnCount)
+    {
+        auto const& head = _lines[_top];
+        if (!head.isTrivialBuffer())
+            return std::nullopt;
+
+        auto joined = head.trivialBuffer();
+        for (auto i = _top + 1; i <= _bottom; ++i)
+        {
+            auto const& line = _lines[i];
+            if (!line.isTrivialBuffer() || line.inheritableFlags() != head.inheritableFlags())
+                return std::nullopt;
+
+            auto const& buffer = line.trivialBuffer();
+            auto const& previous = _lines[i - 1].trivialBuffer();
+            if (!buffer.isASCII() || !previous.isASCII() || previous.usedColumns != _columnCount
+                || buffer.textAttributes != joined.textAttributes || buffer.hyperlink != joined.hyperlink
+                || !joined.text.isContiguousWith(buffer.text))
+                return std::nullopt;
+
+            joined.text.growBy(buffer.text.size());
+            joined.usedColumns += buffer.usedColumns;
+            joined.fillAttributes = buffer.fillAttributes;
+        }
+
+        if (joined.usedColumns > _newColumnCount)
+        {
+            // The line needs to be split, which is only possible if columns map to bytes.
+            if (!joined.isASCII() || !head.wrappable())
+                return std::nullopt;
+
+            // Trailing blanks are not carried over into wrapped lines.
+            auto const text = joined.text.view();
+            auto const trimmedSize = text.find_last_not_of(' ') + 1; // npos + 1 == 0
+            joined.text = joined.text.subfragment(0, trimmedSize);
+            joined.usedColumns = ColumnCount::cast_from(trimmedSize);
+        }
+
+        return joined;
+    }
+
+    /**
+     * Appends a trivial logical line by splitting it into fixed-width trivial lines.
+     *
+     * This is the counterpart to addNewWrappedLines() for logical lines that did not need to be
+     * inflated, see joinTrivialLines().
+     *
+     * @returns number of inserted lines
+     */
+    template <typename Cell>
+    LineCount addNewWrappedTrivialLines(Lines<Cell>& _targetLines,
+                                        ColumnCount _newColumnCount,
+                                        TrivialLineBuffer const& _logicalLineBuffer,
+                                        LineFlags _baseFlags,
+                                        bool _initialNoWrap)
+    {
+        auto const flagsAt = [&](int i) {
+            return _baseFlags | (i == 0 && _initialNoWrap ? LineFlags::None : LineFlags::Wrapped);
+        };
+
+        if (_logicalLineBuffer.usedColumns <= _newColumnCount)
+        {
+            auto buffer = _logicalLineBuffer;
+            buffer.displayWidth = _newColumnCount;
+            _targetLines.emplace_back(flagsAt(0), std::move(buffer));
+            return LineCount(1);
+        }
+
+        auto const columnsPerLine = unbox<size_t>(_newColumnCount);
+        auto const totalColumns = unbox<size_t>(_logicalLineBuffer.usedColumns);
+        int i = 0;
+        for (size_t offset = 0; offset < totalColumns; offset += columnsPerLine, ++i)
+        {
+            auto const count = std::min(columnsPerLine, totalColumns - offset);
+            auto buffer = TrivialLineBuffer { _newColumnCount,
+                                              _logicalLineBuffer.textAttributes,
+                                              _logicalLineBuffer.fillAttributes,
+                                              _logicalLineBuffer.hyperlink,
+                                              ColumnCount::cast_from(count),
+                                              _logicalLineBuffer.text.subfragment(offset, count) };
+            _targetLines.emplace_back(flagsAt(i), std::move(buffer));
+        }
+        return LineCount::cast_from(i);
+    }
+
+    /// Minimum number of scrollback lines per chunk when reflowing concurrently.
+    constexpr int MinReflowChunkSize = 4096;
+
+    /// Size of the buffer objects holding the text of compacted scrollback lines.
+    constexpr size_t CompactedTextBufferSize = 64 * 1024;
+
+    /// Sums up the number of bytes referenced by trivial lines per buffer object.
+    template <typename Cell>
+    std::unordered_map<crispy::BufferObject<char> const*, size_t> referencedTextBytes(
+        Lines<Cell> const& _lines)
+    {
+        auto referenced = std::unordered_map<crispy::BufferObject<char> const*, size_t> {};
+        for (auto const& line: _lines)
+            if (line.isTrivialBuffer())
+                if (auto const& text = line.trivialBuffer().text; text.owner())
+                    referenced[text.owner().get()] += text.size();
+        return referenced;
+    }
+
+    /// Number of scrollback lines right above the main page that are reflowed on resize right away.
+    /// The reflow of any older lines is deferred until needed.
+    constexpr int EagerReflowLineCount = 1000;
+
+    /**
+     * Rewraps the lines [_begin, _end) to the given column count.
+     *
+     * Unlike the reflow in Grid::resize(), each line may have been wrapped for a different
+     * column count before, which is the case for lines whose reflow has been deferred.
+     */
+    template <typename Cell>
+    Lines<Cell> rewrapLines(Lines<Cell>& _lines, int _begin, int _end, ColumnCount _newColumnCount)
+    {
+        Lines<Cell> result;
+        for (int i = _begin; i < _end;)
+        {
+            auto const bottom = logicalLineBottom(_lines, i, _end - 1);
+            auto& head = _lines[i];
+            if (i == bottom && (head.size() == _newColumnCount || !head.wrappable()))
+            {
+                if (head.size() != _newColumnCount)
+                    head.resize(_newColumnCount);
+                result.emplace_back(std::move(head));
+            }
+            else
+            {
+                auto logicalLine = typename Line<Cell>::InflatedBuffer {};
+                for (auto k = i; k <= bottom; ++k)
+                {
+                    auto const cells = k == bottom ? _lines[k].trim_blank_right() : _lines[k].cells();
+                    logicalLine.insert(logicalLine.end(), cells.begin(), cells.end());
+                }
+                if (logicalLine.empty())
+                    logicalLine.resize(unbox<size_t>(_newColumnCount));
+                addNewWrappedLines(
+                    result, _newColumnCount, std::move(logicalLine), head.flags() & ~LineFlags::Wrapped, true);
+            }
+            i = bottom + 1;
+        }
+        return result;
+    }
+
+    /**
+     * Reflows the lines [_begin, _end) by means of @p _reflow, concurrently for large scrollbacks.
+     *
+     * The scrollback is partitioned into chunks on logical line boundaries that are reflowed on
+     * worker threads, while the main page is reflowed on the calling thread right away.
+     * The results are concatenated in order.
+     *
+     * @param _reflow callable of signature Lines<Cell>(int begin, int end) that reflows the given
+     *                range of lines, which starts at a logical line boundary.
+     */
+    template <typename Cell, typename Reflow>
+    Lines<Cell> reflowConcurrently(Lines<Cell> const& _lines, int _begin, int _end, Reflow const& _reflow)
+    {
+        // Returns the offset of the first physical line of the logical line at the given offset.
+        auto const logicalLineTop = [&](int i) {
+            while (i > _begin && _lines[i].wrapped())
+                --i;
+            return i;
+        };
+
+        auto const pageStart = std::max(_begin, 0);
+        auto const pageTop = pageStart < _end ? logicalLineTop(pageStart) : _end;
+        auto const historyLineCount = pageTop - _begin;
+        auto const chunkCount = std::min(static_cast<int>(std::max(1u, std::thread::hardware_concurrency())),
+                                         historyLineCount / MinReflowChunkSize);
+        if (chunkCount <= 1)
+            return _reflow(_begin, _end);
+
+        auto boundaries = std::vector<int> { _begin };
+        for (int k = 1; k < chunkCount; ++k)
+            if (auto const top = logicalLineTop(_begin + historyLineCount / chunkCount * k);
+                top > boundaries.back())
+                boundaries.push_back(top);
+        boundaries.push_back(pageTop);
+
+        auto chunks = std::vector<std::future<Lines<Cell>>> {};
+        for (size_t k = 0; k + 1 < boundaries.size(); ++k)
+            chunks.emplace_back(std::async(std::launch::async, [&_reflow, &boundaries, k]() {
+                return _reflow(boundaries[k], boundaries[k + 1]);
+            }));
+
+        auto pageLines = pageTop < _end ? _reflow(pageTop, _end) : Lines<Cell> {};
+
+        Lines<Cell> result;
+        for (auto& chunk: chunks)
+            for (auto& line: chunk.get())
+                result.emplace_back(std::move(line));
+        for (auto& line: pageLines)
+            result.emplace_back(std::move(line));
+        return result;
+    }
+
 } // namespace detail
 // {{{ Grid impl
 template <typename Cell>
@@ -145,8 +379,9 @@ CRISPY_REQUIRES(CellConcept<Cell>)
 void Grid<Cell>::setMaxHistoryLineCount(MaxHistoryLineCount _maxHistoryLineCount)
 {
     verifyState();
-    rezeroBuffers();
+    reflowDeferredLines();
     historyLimit_ = _maxHistoryLineCount;
+    invalidateMarkIndex();
     lines_.resize(unbox<size_t>(pageSize_.lines + maxHistoryLineCount()));
     linesUsed_ = min(linesUsed_, pageSize_.lines + maxHistoryLineCount());
     verifyState();
@@ -156,7 +391,26 @@ template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
 void Grid<Cell>::clearHistory()
 {
+    // Bounded scrollback lines are simply recycled by the lines to scroll into the history next.
+    // An unbounded scrollback is cut down to the main page instead, as it may have grown huge,
+    // with the old lines being destroyed in the background.
+    if (std::holds_alternative<Infinite>(historyLimit_)
+        && lines_.size() > unbox<size_t>(pageSize_.lines + BackgroundReleaseThreshold))
+    {
+        auto pageLines = Lines<Cell> {};
+        pageLines.reserve(unbox<size_t>(pageSize_.lines));
+        for (auto y = LineOffset(0); y < boxed_cast<LineOffset>(pageSize_.lines); ++y)
+            pageLines.emplace_back(std::move(lineAt(y)));
+
+        // Waits for the lines of a previous clear to be released, if still in progress.
+        historyRelease_ = std::async(std::launch::async,
+                                     [lines = std::exchange(lines_, std::move(pageLines))]() mutable {
+                                         auto const released = std::move(lines);
+                                     });
+    }
+
     linesUsed_ = pageSize_.lines;
+    deferredReflowLineCount_ = LineCount(0);
     verifyState();
 }
 
@@ -219,6 +473,110 @@ Line<Cell> const& Grid<Cell>::lineAt(LineOffset _line) const noexcept
     return const_cast<Grid&>(*this).lineAt(_line);
 }
 
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+GridSnapshot<Cell> Grid<Cell>::snapshot()
+{
+    reflowDeferredLines();
+
+    auto const top = -boxed_cast<LineOffset>(historyLineCount());
+    auto const bottom = boxed_cast<LineOffset>(pageSize_.lines);
+
+    auto lines = std::vector<Line<Cell>> {};
+    lines.reserve(unbox<size_t>(bottom - top));
+    for (auto line = top; line < bottom; ++line)
+        lines.emplace_back(lineAt(line));
+    return GridSnapshot<Cell> { pageSize_, historyLineCount(), std::move(lines) };
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::restore(GridSnapshot<Cell> _snapshot)
+{
+    Require(_snapshot.pageSize() == pageSize_);
+    reset();
+
+    auto const historyLineCount = std::holds_alternative<Infinite>(historyLimit_)
+                                      ? _snapshot.historyLineCount()
+                                      : std::min(_snapshot.historyLineCount(), maxHistoryLineCount());
+
+    // Makes room for the history lines, which are then replaced along with the main page lines.
+    if (historyLineCount != LineCount(0))
+        scrollUp(historyLineCount);
+
+    auto& lines = _snapshot.lines();
+    auto line = -boxed_cast<LineOffset>(historyLineCount);
+    for (auto i = unbox<size_t>(_snapshot.historyLineCount() - historyLineCount); i < lines.size(); ++i)
+        lineAt(line++) = std::move(lines[i]);
+
+    invalidateMarkIndex();
+    verifyState();
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::markReferencedHyperlinks(std::vector<bool>& _referenced) const
+{
+    auto const mark = [&](HyperlinkId _id) {
+        if (auto const index = unbox<size_t>(_id); index < _referenced.size())
+            _referenced[index] = true;
+    };
+
+    auto const top = -boxed_cast<LineOffset>(historyLineCount());
+    auto const bottom = boxed_cast<LineOffset>(pageSize_.lines);
+    for (auto line = top; line < bottom; ++line)
+    {
+        // Trivial lines are not inflated just for looking at their cells.
+        auto const& currentLine = lineAt(line);
+        if (currentLine.isTrivialBuffer())
+            mark(currentLine.trivialBuffer().hyperlink);
+        else if (currentLine.isAttributedBuffer())
+            for (auto const& run: currentLine.attributedBuffer().runs)
+                mark(run.hyperlink);
+        else
+            for (auto const& cell: currentLine.inflatedBuffer())
+                mark(cell.hyperlink());
+    }
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::collectHyperlinkSpans(ScrollOffset _scrollOffset, HyperlinkSpans& _output) const
+{
+    _output.reset(pageSize_.lines);
+
+    auto const columns = boxed_cast<ColumnOffset>(pageSize_.columns);
+    for (auto y = LineOffset(0); y < boxed_cast<LineOffset>(pageSize_.lines); ++y)
+    {
+        // Trivial lines are not inflated just for looking at their cells.
+        auto const& line = lineAt(y - boxed_cast<LineOffset>(_scrollOffset));
+        if (line.isTrivialBuffer())
+        {
+            auto const& buffer = line.trivialBuffer();
+            _output.add(y,
+                        ColumnOffset(0),
+                        min(columns, boxed_cast<ColumnOffset>(buffer.usedColumns)),
+                        buffer.hyperlink);
+        }
+        else if (line.isAttributedBuffer())
+        {
+            auto const& buffer = line.attributedBuffer();
+            for (size_t i = 0; i < buffer.runs.size(); ++i)
+            {
+                auto const& run = buffer.runs[i];
+                _output.add(y, run.start, min(columns, buffer.runEnd(i)), run.hyperlink);
+            }
+        }
+        else
+        {
+            auto const& cells = line.inflatedBuffer();
+            auto const end = min(columns, ColumnOffset::cast_from(cells.size()));
+            for (auto column = ColumnOffset(0); column < end; ++column)
+                _output.add(y, column, column + 1, cells[unbox<size_t>(column)].hyperlink());
+        }
+    }
+}
+
 template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
 Cell& Grid<Cell>::at(LineOffset _line, ColumnOffset _column) noexcept
@@ -237,45 +595,42 @@ template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
 Cell const& Grid<Cell>::at(LineOffset _line, ColumnOffset _column) const noexcept
 {
-    return const_cast<Grid&>(*this).at(_line, _column);
+    // Not going through the mutable accessor, as that would mark the line as damaged.
+    return lineAt(_line).inflatedBuffer()[unbox<size_t>(_column)];
 }
 
 template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
-gsl::span<Line<Cell>> Grid<Cell>::pageAtScrollOffset(ScrollOffset _scrollOffset)
+typename Grid<Cell>::PageLines Grid<Cell>::pageAtScrollOffset(ScrollOffset _scrollOffset)
 {
     Require(unbox<LineCount>(_scrollOffset) <= historyLineCount());
 
-    int const offset = -*_scrollOffset;
-    Line<Cell>* startLine = &lines_[offset];
-    auto const count = unbox<size_t>(pageSize_.lines);
-
-    return gsl::span<Line<Cell>> { startLine, count };
+    // The page's lines are not necessarily stored contiguously, and scrolled up pages start at
+    // negative offsets, which the ring resolves relative to its end.
+    auto const top = std::next(lines_.begin(), -*_scrollOffset);
+    return PageLines { top, std::next(top, unbox<long>(pageSize_.lines)) };
 }
 
 template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
-gsl::span<Line<Cell> const> Grid<Cell>::pageAtScrollOffset(ScrollOffset _scrollOffset) const
+typename Grid<Cell>::ConstPageLines Grid<Cell>::pageAtScrollOffset(ScrollOffset _scrollOffset) const
 {
     Require(unbox<LineCount>(_scrollOffset) <= historyLineCount());
 
-    int const offset = -*_scrollOffset;
-    Line<Cell> const* startLine = &lines_[offset];
-    auto const count = unbox<size_t>(pageSize_.lines);
-
-    return gsl::span<Line<Cell> const> { startLine, count };
+    auto const top = std::next(lines_.begin(), -*_scrollOffset);
+    return ConstPageLines { top, std::next(top, unbox<long>(pageSize_.lines)) };
 }
 
 template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
-gsl::span<Line<Cell> const> Grid<Cell>::mainPage() const
+typename Grid<Cell>::ConstPageLines Grid<Cell>::mainPage() const
 {
     return pageAtScrollOffset({});
 }
 
 template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
-gsl::span<Line<Cell>> Grid<Cell>::mainPage()
+typename Grid<Cell>::PageLines Grid<Cell>::mainPage()
 {
     return pageAtScrollOffset({});
 }
@@ -292,6 +647,9 @@ template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
 std::string Grid<Cell>::lineText(LineOffset _line) const
 {
+    if (!lineAt(_line).isInflatedBuffer())
+        return lineAt(_line).toUtf8();
+
     std::string line;
     line.reserve(unbox<size_t>(pageSize_.columns));
 
@@ -318,6 +676,9 @@ template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
 std::string Grid<Cell>::lineText(Line<Cell> const& _line) const
 {
+    if (!_line.isInflatedBuffer())
+        return _line.toUtf8();
+
     std::stringstream sstr;
     for (Cell const& cell: _line.inflatedBuffer())
     {
@@ -342,6 +703,13 @@ template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
 bool Grid<Cell>::isLineBlank(LineOffset _line) const noexcept
 {
+    if (auto const& line = lineAt(_line); !line.isInflatedBuffer())
+    {
+        auto const text = line.isTrivialBuffer() ? line.trivialBuffer().text.view()
+                                                 : std::string_view(line.attributedBuffer().text);
+        return std::all_of(text.begin(), text.end(), [](char ch) { return ch == 0x20; });
+    }
+
     auto const is_blank = [](auto const& _cell) noexcept {
         return CellUtil::empty(_cell);
     };
@@ -393,20 +761,28 @@ LineCount Grid<Cell>::scrollUp(LineCount linesCountToScrollUp, GraphicsAttribute
     {
         if (std::get_if<Infinite>(&historyLimit_))
         {
-            for ([[maybe_unused]] auto const _: ranges::views::iota(0, unbox<int>(linesCountToScrollUp)))
-                lines_.emplace_back(defaultLineFlags(),
-                                    TrivialLineBuffer { pageSize_.columns, GraphicsAttributes {} });
+            // The new lines are unused lines right below the main page, as are the ones the
+            // recursion below expects to scroll into the main page.
+            lines_.insert(unbox<long>(pageSize_.lines),
+                          unbox<size_t>(linesCountToScrollUp),
+                          Line<Cell> { defaultLineFlags(), pageSize_.columns, GraphicsAttributes {} });
             return scrollUp(linesCountToScrollUp, _defaultAttributes);
         }
         // TODO: ensure explicit test for this case
+        notifyEvictedLines(linesCountToScrollUp);
         rotateBuffersLeft(linesCountToScrollUp);
+        deferredReflowLineCount_ -= std::min(deferredReflowLineCount_, linesCountToScrollUp);
 
         // Initialize (/reset) new lines.
+        // The recycled lines may have been wrapped for a different width if their reflow was deferred.
         for (auto y = boxed_cast<LineOffset>(pageSize_.lines - linesCountToScrollUp);
              y < boxed_cast<LineOffset>(pageSize_.lines);
              ++y)
-            lineAt(y).reset(defaultLineFlags(), _defaultAttributes);
+            lineAt(y).reset(defaultLineFlags(), _defaultAttributes, pageSize_.columns);
 
+        scrolledUpLineCount_ += unbox<uint64_t>(linesCountToScrollUp);
+        compactColdHistory(linesCountToScrollUp);
+        releaseScrolledImages(linesCountToScrollUp);
         return linesCountToScrollUp;
     }
     else
@@ -424,23 +800,27 @@ LineCount Grid<Cell>::scrollUp(LineCount linesCountToScrollUp, GraphicsAttribute
         {
             linesUsed_ += linesAppendCount;
             Require(unbox<size_t>(linesUsed_) <= lines_.size());
-            fill_n(next(lines_.begin(), *pageSize_.lines),
-                   unbox<size_t>(linesAppendCount),
-                   Line<Cell> { defaultLineFlags(),
-                                TrivialLineBuffer { pageSize_.columns, _defaultAttributes } });
+            std::fill_n(std::next(lines_.begin(), *pageSize_.lines),
+                        unbox<size_t>(linesAppendCount),
+                        Line<Cell> { defaultLineFlags(), pageSize_.columns, _defaultAttributes });
             rotateBuffersLeft(linesAppendCount);
         }
         if (linesAppendCount < linesCountToScrollUp)
         {
             auto const incrementCount = linesCountToScrollUp - linesAppendCount;
+            notifyEvictedLines(incrementCount);
             rotateBuffersLeft(incrementCount);
+            deferredReflowLineCount_ -= std::min(deferredReflowLineCount_, incrementCount);
 
             // Initialize (/reset) new lines.
             for (auto y = boxed_cast<LineOffset>(pageSize_.lines - linesCountToScrollUp);
                  y < boxed_cast<LineOffset>(pageSize_.lines);
                  ++y)
-                lineAt(y).reset(defaultLineFlags(), _defaultAttributes);
+                lineAt(y).reset(defaultLineFlags(), _defaultAttributes, pageSize_.columns);
         }
+        scrolledUpLineCount_ += unbox<uint64_t>(linesCountToScrollUp);
+        compactColdHistory(linesCountToScrollUp);
+        releaseScrolledImages(linesCountToScrollUp);
         return LineCount::cast_from(linesAppendCount);
     }
 }
@@ -471,18 +851,19 @@ LineCount Grid<Cell>::scrollUp(LineCount _n, GraphicsAttributes _defaultAttribut
         auto const n = std::min(_n, marginHeight);
         if (*n && n < marginHeight)
         {
-            // rotate line attribs
-            for (auto topLineOffset = *_margin.vertical.from; topLineOffset <= *_margin.vertical.to - *n;
-                 ++topLineOffset)
-                lines_[topLineOffset] = std::move(lines_[topLineOffset + *n]);
+            // Rotates the lines rather than their cells, recycling the lines scrolled out
+            // at the top as the new lines at the bottom.
+            auto a = std::next(lines_.begin(), *_margin.vertical.from);
+            auto b = std::next(lines_.begin(), *_margin.vertical.from + *n);
+            auto c = std::next(lines_.begin(), *_margin.vertical.to + 1);
+            std::rotate(a, b, c);
         }
 
         auto const topEmptyLineNr = *_margin.vertical.to - *n + 1;
         auto const bottomLineNumber = *_margin.vertical.to;
         for (auto lineNumber = topEmptyLineNr; lineNumber <= bottomLineNumber; ++lineNumber)
-        {
             lines_[lineNumber].reset(defaultLineFlags(), _defaultAttributes, pageSize_.columns);
-        }
+        reindexMainPageMarks();
     }
     else
     {
@@ -493,25 +874,36 @@ LineCount Grid<Cell>::scrollUp(LineCount _n, GraphicsAttributes _defaultAttribut
         auto const topTargetLineOffset = _margin.vertical.from;
         auto const bottomTargetLineOffset = _margin.vertical.to - *n;
         auto const columnsToMove = unbox<size_t>(_margin.horizontal.length());
+        auto const left = _margin.horizontal.from;
+        auto const right = _margin.horizontal.to;
 
         for (LineOffset targetLineOffset = topTargetLineOffset; targetLineOffset <= bottomTargetLineOffset;
              ++targetLineOffset)
         {
-            auto const sourceLineOffset = targetLineOffset + *n;
-            auto t = &useCellAt(targetLineOffset, _margin.horizontal.from);
-            auto s = &at(sourceLineOffset, _margin.horizontal.from);
-            std::copy_n(s, columnsToMove, t);
-        }
+            auto& target = lineAt(targetLineOffset);
+            auto& source = lineAt(targetLineOffset + *n);
 
-        for (LineOffset line = _margin.vertical.to - *n + 1; line <= _margin.vertical.to; ++line)
-        {
-            auto a = &useCellAt(line, _margin.horizontal.from);
-            auto b = a + unbox<int>(_margin.horizontal.length());
-            while (a != b)
+            // Moving blank columns of a trivial line does not need to inflate either line.
+            if (source.isTrivialBlankFrom(left))
             {
-                a->reset(_defaultAttributes);
-                a++;
+                auto const& fillAttributes = std::as_const(source).trivialBuffer().fillAttributes;
+                if (target.tryClearTrivialRange(left, right, fillAttributes))
+                    continue;
             }
+
+            // Source cells are either overwritten by a later iteration or reset below.
+            auto s = &source.useCellAt(left);
+            Cell::moveRange(s, s + columnsToMove, &target.useCellAt(left));
+        }
+
+        for (LineOffset lineOffset = _margin.vertical.to - *n + 1; lineOffset <= _margin.vertical.to;
+             ++lineOffset)
+        {
+            auto& line = lineAt(lineOffset);
+            if (line.tryClearTrivialRange(left, right, _defaultAttributes))
+                continue;
+            auto a = &line.useCellAt(left);
+            Cell::resetRange(a, a + columnsToMove, _defaultAttributes);
         }
     }
     verifyState();
@@ -548,21 +940,23 @@ void Grid<Cell>::scrollDown(LineCount v_n,
         // bottom N lines are wiped out
 
         rotateBuffersRight(n);
+        invalidateMarkIndex();
 
-        for (Line<Cell>& line: mainPage().subspan(0, unbox<size_t>(n)))
-            line.reset(defaultLineFlags(), _defaultAttributes);
+        for (auto const i: ranges::views::iota(0, *n))
+            lines_[i].reset(defaultLineFlags(), _defaultAttributes);
         return;
     }
 
     if (fullHorizontal) // => but ont fully vertical
     {
         // scroll down only inside vertical margin with full horizontal extend
-        auto a = std::next(begin(lines_), *_margin.vertical.from);
-        auto b = std::next(begin(lines_), *_margin.vertical.to + 1 - *n);
-        auto c = std::next(begin(lines_), *_margin.vertical.to + 1);
+        auto a = std::next(lines_.begin(), *_margin.vertical.from);
+        auto b = std::next(lines_.begin(), *_margin.vertical.to + 1 - *n);
+        auto c = std::next(lines_.begin(), *_margin.vertical.to + 1);
         std::rotate(a, b, c);
         for (auto const i: ranges::views::iota(*_margin.vertical.from, *_margin.vertical.from + *n))
             lines_[i].reset(defaultLineFlags(), _defaultAttributes);
+        reindexMainPageMarks();
     }
     else
     {
@@ -580,11 +974,7 @@ void Grid<Cell>::scrollDown(LineCount v_n,
             {
                 auto a = &at(line, _margin.horizontal.from);
                 auto b = &at(line, _margin.horizontal.to + 1);
-                while (a != b)
-                {
-                    *a = Cell { _defaultAttributes };
-                    a++;
-                }
+                Cell::resetRange(a, b, _defaultAttributes);
             }
         }
     }
@@ -608,14 +998,180 @@ void Grid<Cell>::scrollLeft(GraphicsAttributes _defaultAttributes, Margin _margi
     }
 }
 
+// }}}
+// {{{ Grid impl: marks
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::setMarked(LineOffset _line)
+{
+    auto& line = lineAt(_line);
+    if (line.marked())
+        return;
+
+    line.setMarked(true);
+    if (!markIndexValid_)
+        return;
+
+    auto const lineNumber = absoluteLineNumber(_line);
+    auto const i = std::lower_bound(markedLines_.begin(), markedLines_.end(), lineNumber);
+    if (i == markedLines_.end() || *i != lineNumber)
+        markedLines_.insert(i, lineNumber);
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+std::optional<LineOffset> Grid<Cell>::findMarkedLineAbove(LineOffset _line) const
+{
+    updateMarkIndex();
+
+    auto i = std::lower_bound(markedLines_.begin(), markedLines_.end(), absoluteLineNumber(_line));
+    while (i != markedLines_.begin())
+    {
+        --i;
+        auto const line = relativeLineOffset(*i);
+        if (lineAt(line).marked())
+            return line;
+        i = markedLines_.erase(i);
+    }
+    return std::nullopt;
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+std::optional<LineOffset> Grid<Cell>::findMarkedLineBelow(LineOffset _line, LineOffset _bottom) const
+{
+    updateMarkIndex();
+
+    auto const bottom = absoluteLineNumber(_bottom);
+    auto i = std::upper_bound(markedLines_.begin(), markedLines_.end(), absoluteLineNumber(_line));
+    while (i != markedLines_.end() && *i <= bottom)
+    {
+        auto const line = relativeLineOffset(*i);
+        if (lineAt(line).marked())
+            return line;
+        i = markedLines_.erase(i);
+    }
+    return std::nullopt;
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::updateMarkIndex() const
+{
+    auto const top = -boxed_cast<LineOffset>(historyLineCount());
+    if (!markIndexValid_)
+    {
+        markedLines_.clear();
+        for (auto line = top; line < boxed_cast<LineOffset>(pageSize_.lines); ++line)
+            if (lineAt(line).marked())
+                markedLines_.push_back(absoluteLineNumber(line));
+        markIndexValid_ = true;
+        return;
+    }
+
+    // Lines that have scrolled off the top of the scrollback, or that have been cleared, are gone.
+    markedLines_.erase(
+        markedLines_.begin(),
+        std::lower_bound(markedLines_.begin(), markedLines_.end(), absoluteLineNumber(top)));
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::reindexMainPageMarks()
+{
+    if (!markIndexValid_)
+        return;
+
+    markedLines_.erase(
+        std::lower_bound(markedLines_.begin(), markedLines_.end(), absoluteLineNumber(LineOffset(0))),
+        markedLines_.end());
+    for (auto line = LineOffset(0); line < boxed_cast<LineOffset>(pageSize_.lines); ++line)
+        if (lineAt(line).marked())
+            markedLines_.push_back(absoluteLineNumber(line));
+}
+// }}}
+// {{{ Grid impl: shell integration
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::beginCommandPrompt(LineOffset _line)
+{
+    auto const promptLine = absoluteLineNumber(_line);
+    auto const top = absoluteLineNumber(-boxed_cast<LineOffset>(historyLineCount()));
+    while (!commands_.empty() && commands_.front().promptLine < top)
+        commands_.pop_front();
+    while (!commands_.empty() && commands_.back().promptLine >= promptLine)
+        commands_.pop_back();
+
+    commands_.emplace_back(CommandRecord { promptLine, std::nullopt, std::nullopt, std::nullopt });
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::beginCommandOutput(LineOffset _line)
+{
+    if (!commands_.empty() && !commands_.back().outputEnd)
+        commands_.back().outputStart = absoluteLineNumber(_line);
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::endCommand(LineOffset _line, std::optional<int> _exitCode)
+{
+    // Shells report the end of the previous command before every prompt, including the first one.
+    if (commands_.empty() || !commands_.back().outputStart || commands_.back().outputEnd)
+        return;
+
+    auto& command = commands_.back();
+    command.outputEnd = std::max(*command.outputStart, absoluteLineNumber(_line));
+    command.exitCode = _exitCode;
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+std::optional<Range> Grid<Cell>::lastCommandOutput() const
+{
+    auto const top = absoluteLineNumber(-boxed_cast<LineOffset>(historyLineCount()));
+    auto const command = std::find_if(
+        commands_.rbegin(), commands_.rend(), [](CommandRecord const& c) { return c.outputEnd.has_value(); });
+    if (command == commands_.rend() || *command->outputEnd <= std::max(*command->outputStart, top))
+        return std::nullopt;
+
+    // Output that has partially scrolled off the top of the scrollback is cut off.
+    auto const first = relativeLineOffset(std::max(*command->outputStart, top));
+    auto const last = relativeLineOffset(*command->outputEnd - 1);
+    return Range { From { unbox<int>(first) }, To { unbox<int>(last) } };
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+std::optional<LineOffset> Grid<Cell>::findFailedCommandAbove(LineOffset _line) const
+{
+    auto const top = absoluteLineNumber(-boxed_cast<LineOffset>(historyLineCount()));
+    auto i = std::lower_bound(commands_.begin(),
+                              commands_.end(),
+                              absoluteLineNumber(_line),
+                              [](CommandRecord const& c, int64_t line) { return c.promptLine < line; });
+    while (i != commands_.begin())
+    {
+        --i;
+        if (i->promptLine < top)
+            break;
+        if (i->exitCode.value_or(0) != 0)
+            return relativeLineOffset(i->promptLine);
+    }
+    return std::nullopt;
+}
 // }}}
 // {{{ Grid impl: resize
 template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
 void Grid<Cell>::reset()
 {
+    invalidateMarkIndex();
+    commands_.clear();
     linesUsed_ = pageSize_.lines;
-    lines_.rotate_right(lines_.zero_index());
+    deferredReflowLineCount_ = LineCount(0);
+    rezeroBuffers();
     for (int i = 0; i < unbox<int>(pageSize_.lines); ++i)
         lines_[i].reset(defaultLineFlags(), GraphicsAttributes {});
     verifyState();
@@ -631,6 +1187,9 @@ CellLocation Grid<Cell>::growLines(LineCount _newHeight, CellLocation _cursor)
     Require(_newHeight > pageSize_.lines);
     // lines_.reserve(unbox<size_t>(maxHistoryLineCount_ + _newHeight));
 
+    // Lines moving from the scrollback into the main page must have been reflowed.
+    reflowDeferredLines(boxed_cast<LineOffset>(pageSize_.lines - _newHeight));
+
     // Pull down from history if cursor is at bottom and if scrollback available.
     CellLocation cursorMove {};
     if (*_cursor.line + 1 == *pageSize_.lines)
@@ -653,8 +1212,11 @@ CellLocation Grid<Cell>::growLines(LineCount _newHeight, CellLocation _cursor)
     auto const currentTotalLineCount = LineCount::cast_from(lines_.size());
     auto const linesToFill = max(0, *newTotalLineCount - *currentTotalLineCount);
 
-    for ([[maybe_unused]] auto const _: ranges::views::iota(0, linesToFill))
-        lines_.emplace_back(wrappableFlag, TrivialLineBuffer { pageSize_.columns, GraphicsAttributes {} });
+    // The new lines are unused lines right below the main page, which the main page grows into.
+    lines_.insert(unbox<long>(pageSize_.lines),
+                  static_cast<size_t>(linesToFill),
+                  Line<Cell> { wrappableFlag,
+                               TrivialLineBuffer { pageSize_.columns, InternedGraphicsAttributes {} } });
 
     pageSize_.lines += totalLinesToExtend;
     linesUsed_ = min(linesUsed_ + totalLinesToExtend, LineCount::cast_from(lines_.size()));
@@ -674,6 +1236,9 @@ CellLocation Grid<Cell>::resize(PageSize _newSize, CellLocation _currentCursorPo
         return _currentCursorPos;
 
     GridLog()("resize {} -> {} (cursor {})", pageSize_, _newSize, _currentCursorPos);
+    invalidateMarkIndex();
+    commands_.clear();
+    textBufferCompaction_.reset(); // Reflowing may move text out of the scanned buffer objects.
 
     // Growing in line count with scrollback lines present will move
     // the scrollback lines into the visible area.
@@ -682,6 +1247,29 @@ CellLocation Grid<Cell>::resize(PageSize _newSize, CellLocation _currentCursorPo
     // the top lines into the scrollback area.
 
     // {{{ helper methods
+    // Reflows all used lines by means of the given range reflow function, except for the scrollback
+    // lines above the most recent EagerReflowLineCount ones, whose reflow is deferred.
+    auto const reflowUsedLines = [this](auto const& _reflowRange) -> Lines<Cell> {
+        auto const historyTop = -*historyLineCount();
+        auto const deferredEnd = historyTop + *deferredReflowLineCount_;
+        auto reflowBegin = std::max(deferredEnd, -detail::EagerReflowLineCount);
+        while (reflowBegin > deferredEnd && lines_[reflowBegin].wrapped())
+            --reflowBegin;
+
+        auto reflowedLines = detail::reflowConcurrently(lines_, reflowBegin, *pageSize_.lines, _reflowRange);
+        deferredReflowLineCount_ = LineCount::cast_from(reflowBegin - historyTop);
+        if (!*deferredReflowLineCount_)
+            return reflowedLines;
+
+        Lines<Cell> result;
+        result.reserve(unbox<size_t>(deferredReflowLineCount_) + reflowedLines.size());
+        for (auto i = historyTop; i < reflowBegin; ++i)
+            result.emplace_back(std::move(lines_[i]));
+        for (auto& line: reflowedLines)
+            result.emplace_back(std::move(line));
+        return result;
+    };
+
     auto const shrinkLines = [this](LineCount _newHeight, CellLocation _cursor) -> CellLocation {
         // Shrink existing line count to _newSize.lines
         // by splicing the number of lines to be shrinked by into savedLines bottom.
@@ -734,11 +1322,13 @@ CellLocation Grid<Cell>::resize(PageSize _newSize, CellLocation _currentCursorPo
         return CellLocation {};
     };
 
-    auto const growColumns = [this, _wrapPending](ColumnCount _newColumnCount) -> CellLocation {
+    auto const growColumns = [this, _wrapPending, &reflowUsedLines](
+                                 ColumnCount _newColumnCount) -> CellLocation {
         using LineBuffer = typename Line<Cell>::InflatedBuffer;
 
         if (!reflowOnResize_)
         {
+            reflowDeferredLines();
             for (auto& line: lines_)
                 if (line.size() < _newColumnCount)
                     line.resize(_newColumnCount);
@@ -754,66 +1344,79 @@ CellLocation Grid<Cell>::resize(PageSize _newSize, CellLocation _currentCursorPo
             auto const extendCount = _newColumnCount - pageSize_.columns;
             Require(*extendCount > 0);
 
-            Lines<Cell> grownLines;
-            LineBuffer
-                logicalLineBuffer; // Temporary state, representing wrapped columns from the line "below".
-            LineFlags logicalLineFlags = LineFlags::None;
-
-            auto const appendToLogicalLine = [&logicalLineBuffer](gsl::span<Cell const> cells) {
-                for (auto const& cell: cells)
-                    logicalLineBuffer.push_back(cell);
-            };
+            // Reflows the lines [_begin, _end), which must start at a logical line boundary.
+            auto const reflowLines = [&](int _begin, int _end) -> Lines<Cell> {
+                Lines<Cell> grownLines;
+                LineBuffer
+                    logicalLineBuffer; // Temporary state, representing wrapped columns from the line "below".
+                LineFlags logicalLineFlags = LineFlags::None;
 
-            auto const flushLogicalLine = [_newColumnCount,
-                                           &grownLines,
-                                           &logicalLineBuffer,
-                                           &logicalLineFlags]() {
-                if (!logicalLineBuffer.empty())
-                {
-                    detail::addNewWrappedLines(
-                        grownLines, _newColumnCount, std::move(logicalLineBuffer), logicalLineFlags, true);
-                    logicalLineBuffer.clear();
-                }
-            };
+                auto const appendToLogicalLine = [&logicalLineBuffer](gsl::span<Cell const> cells) {
+                    for (auto const& cell: cells)
+                        logicalLineBuffer.push_back(cell);
+                };
 
-            [[maybe_unused]] auto const logLogicalLine =
-                [&logicalLineBuffer]([[maybe_unused]] LineFlags lineFlags,
-                                     [[maybe_unused]] std::string_view msg) {
-                    GridLog()("{} |> \"{}\"", msg, Line<Cell>(lineFlags, logicalLineBuffer).toUtf8());
+                auto const flushLogicalLine = [_newColumnCount,
+                                               &grownLines,
+                                               &logicalLineBuffer,
+                                               &logicalLineFlags]() {
+                    if (!logicalLineBuffer.empty())
+                    {
+                        detail::addNewWrappedLines(grownLines,
+                                                   _newColumnCount,
+                                                   std::move(logicalLineBuffer),
+                                                   logicalLineFlags,
+                                                   true);
+                        logicalLineBuffer.clear();
+                    }
                 };
 
-            for (int i = -*historyLineCount(); i < *pageSize_.lines; ++i)
-            {
-                auto& line = lines_[i];
-                // logLogicalLine(line.flags(), fmt::format("Line[{:>2}]: next line: \"{}\"", i,
-                // line.toUtf8()));
-                Require(line.size() >= pageSize_.columns);
+                [[maybe_unused]] auto const logLogicalLine =
+                    [&logicalLineBuffer]([[maybe_unused]] LineFlags lineFlags,
+                                         [[maybe_unused]] std::string_view msg) {
+                        GridLog()("{} |> \"{}\"", msg, Line<Cell>(lineFlags, logicalLineBuffer).toUtf8());
+                    };
 
-                if (line.wrapped())
-                {
-                    // logLogicalLine(line.flags(), fmt::format(" - appending: \"{}\"",
-                    // line.toUtf8Trimmed()));
-                    appendToLogicalLine(line.trim_blank_right());
-                }
-                else // line is not wrapped
+                for (int i = _begin; i < _end; ++i)
                 {
-                    if (line.isTrivialBuffer())
+                    auto& line = lines_[i];
+                    // logLogicalLine(line.flags(), fmt::format("Line[{:>2}]: next line: \"{}\"", i,
+                    // line.toUtf8()));
+                    Require(line.size() >= pageSize_.columns);
+
+                    if (line.wrapped())
                     {
-                        auto& buffer = line.trivialBuffer();
-                        buffer.displayWidth = _newColumnCount;
-                        grownLines.emplace_back(line);
+                        // logLogicalLine(line.flags(), fmt::format(" - appending: \"{}\"",
+                        // line.toUtf8Trimmed()));
+                        appendToLogicalLine(line.trim_blank_right());
                     }
-                    else
+                    else // line is not wrapped
                     {
                         flushLogicalLine();
-                        // logLogicalLine(line.flags(), " - start new logical line");
-                        appendToLogicalLine(line.cells());
-                        logicalLineFlags = line.flags() & ~LineFlags::Wrapped;
+                        auto const bottom = detail::logicalLineBottom(lines_, i, _end - 1);
+                        if (auto const joined = detail::joinTrivialLines(
+                                lines_, i, bottom, pageSize_.columns, _newColumnCount))
+                        {
+                            // Rewrap the logical line without inflating it.
+                            auto const flags = line.flags() & ~LineFlags::Wrapped;
+                            detail::addNewWrappedTrivialLines(
+                                grownLines, _newColumnCount, *joined, flags, true);
+                            i = bottom;
+                        }
+                        else
+                        {
+                            // logLogicalLine(line.flags(), " - start new logical line");
+                            appendToLogicalLine(line.cells());
+                            logicalLineFlags = line.flags() & ~LineFlags::Wrapped;
+                        }
                     }
                 }
-            }
 
-            flushLogicalLine(); // Flush last (bottom) line, if anything pending.
+                flushLogicalLine(); // Flush last (bottom) line, if anything pending.
+                return grownLines;
+            };
+
+            Lines<Cell> grownLines = reflowUsedLines(reflowLines);
 
             // auto diff = int(lines_.size()) - unbox<int>(pageSize_.lines);
             auto cy = LineCount(0);
@@ -825,7 +1428,7 @@ CellLocation Grid<Cell>::resize(PageSize _newSize, CellLocation _currentCursorPo
                 while (LineCount::cast_from(grownLines.size()) < pageSize_.lines)
                     grownLines.emplace_back(
                         defaultLineFlags(),
-                        TrivialLineBuffer { _newColumnCount, GraphicsAttributes {}, GraphicsAttributes {} });
+                        TrivialLineBuffer { _newColumnCount, InternedGraphicsAttributes {} });
 
                 Ensures(LineCount::cast_from(grownLines.size()) == pageSize_.lines);
             }
@@ -837,7 +1440,7 @@ CellLocation Grid<Cell>::resize(PageSize _newSize, CellLocation _currentCursorPo
             while (grownLines.size() < totalLineCount)
                 grownLines.emplace_back(
                     defaultLineFlags(),
-                    TrivialLineBuffer { _newColumnCount, GraphicsAttributes {}, GraphicsAttributes {} });
+                    TrivialLineBuffer { _newColumnCount, InternedGraphicsAttributes {} });
 
             lines_ = std::move(grownLines);
             pageSize_.columns = _newColumnCount;
@@ -850,13 +1453,14 @@ CellLocation Grid<Cell>::resize(PageSize _newSize, CellLocation _currentCursorPo
         }
     };
 
-    auto const shrinkColumns = [this](ColumnCount _newColumnCount,
-                                      LineCount /*_newLineCount*/,
-                                      CellLocation _cursor) -> CellLocation {
+    auto const shrinkColumns = [this, &reflowUsedLines](ColumnCount _newColumnCount,
+                                                        LineCount /*_newLineCount*/,
+                                                        CellLocation _cursor) -> CellLocation {
         using LineBuffer = typename Line<Cell>::InflatedBuffer;
 
         if (!reflowOnResize_)
         {
+            reflowDeferredLines();
             pageSize_.columns = _newColumnCount;
             crispy::for_each(lines_, [=](Line<Cell>& line) {
                 if (_newColumnCount < line.size())
@@ -892,57 +1496,96 @@ CellLocation Grid<Cell>::resize(PageSize _newSize, CellLocation _currentCursorPo
             // "e "     Wrapped
             // }}}
 
-            Lines<Cell> shrinkedLines;
-            LineBuffer wrappedColumns;
-            LineFlags previousFlags = lines_.front().inheritableFlags();
-
             auto const totalLineCount = unbox<size_t>(pageSize_.lines + maxHistoryLineCount());
-            shrinkedLines.reserve(totalLineCount);
             Require(totalLineCount == unbox<size_t>(this->totalLineCount()));
 
-            auto numLinesWritten = LineCount(0);
-            for (auto i = -*historyLineCount(); i < *pageSize_.lines; ++i)
-            {
-                auto& line = lines_[i];
+            // Reflows the lines [_begin, _end), which must start at a logical line boundary.
+            auto const reflowLines = [&](int _begin, int _end) -> Lines<Cell> {
+                Lines<Cell> shrinkedLines;
+                LineBuffer wrappedColumns;
+                LineFlags previousFlags = lines_[_begin].inheritableFlags();
 
-                // do we have previous columns carried?
-                if (!wrappedColumns.empty())
+                auto numLinesWritten = LineCount(0);
+                for (auto i = _begin; i < _end; ++i)
                 {
-                    if (line.wrapped() && line.inheritableFlags() == previousFlags)
+                    auto& line = lines_[i];
+
+                    if (!line.wrapped())
                     {
-                        // Prepend previously wrapped columns into current line.
-                        auto& editable = line.inflatedBuffer();
-                        editable.insert(editable.begin(), wrappedColumns.begin(), wrappedColumns.end());
+                        auto const bottom = detail::logicalLineBottom(lines_, i, _end - 1);
+                        if (auto const joined = detail::joinTrivialLines(
+                                lines_, i, bottom, pageSize_.columns, _newColumnCount))
+                        {
+                            // Rewrap the logical line without inflating it,
+                            // after flushing the columns carried from the line above, if any.
+                            if (!wrappedColumns.empty())
+                            {
+                                numLinesWritten += detail::addNewWrappedLines(shrinkedLines,
+                                                                              _newColumnCount,
+                                                                              std::move(wrappedColumns),
+                                                                              previousFlags,
+                                                                              false);
+                                wrappedColumns.clear();
+                            }
+                            auto const flags = line.flags() & ~LineFlags::Wrapped;
+                            numLinesWritten += detail::addNewWrappedTrivialLines(
+                                shrinkedLines, _newColumnCount, *joined, flags, true);
+                            previousFlags = line.inheritableFlags();
+                            i = bottom;
+                            continue;
+                        }
+                    }
+
+                    // do we have previous columns carried?
+                    if (!wrappedColumns.empty())
+                    {
+                        if (line.wrapped() && line.inheritableFlags() == previousFlags)
+                        {
+                            // Prepend previously wrapped columns into current line.
+                            auto& editable = line.inflatedBuffer();
+                            editable.insert(editable.begin(), wrappedColumns.begin(), wrappedColumns.end());
+                        }
+                        else
+                        {
+                            // Insert NEW line(s) between previous and this line with previously wrapped
+                            // columns.
+                            auto const numLinesInserted =
+                                detail::addNewWrappedLines(shrinkedLines,
+                                                           _newColumnCount,
+                                                           std::move(wrappedColumns),
+                                                           previousFlags,
+                                                           false);
+                            numLinesWritten += numLinesInserted;
+                            previousFlags = line.inheritableFlags();
+                        }
                     }
                     else
                     {
-                        // Insert NEW line(s) between previous and this line with previously wrapped columns.
-                        auto const numLinesInserted = detail::addNewWrappedLines(
-                            shrinkedLines, _newColumnCount, std::move(wrappedColumns), previousFlags, false);
-                        numLinesWritten += numLinesInserted;
                         previousFlags = line.inheritableFlags();
                     }
+
+                    wrappedColumns = line.reflow(_newColumnCount);
+
+                    shrinkedLines.emplace_back(std::move(line));
+                    numLinesWritten++;
+                    Ensures(shrinkedLines.back().size() >= _newColumnCount);
                 }
-                else
-                {
-                    previousFlags = line.inheritableFlags();
-                }
+                numLinesWritten += detail::addNewWrappedLines(
+                    shrinkedLines, _newColumnCount, std::move(wrappedColumns), previousFlags, false);
+                Require(unbox<size_t>(numLinesWritten) == shrinkedLines.size());
+                return shrinkedLines;
+            };
 
-                wrappedColumns = line.reflow(_newColumnCount);
+            Lines<Cell> shrinkedLines = reflowUsedLines(reflowLines);
+            shrinkedLines.reserve(totalLineCount);
 
-                shrinkedLines.emplace_back(std::move(line));
-                numLinesWritten++;
-                Ensures(shrinkedLines.back().size() >= _newColumnCount);
-            }
-            numLinesWritten += detail::addNewWrappedLines(
-                shrinkedLines, _newColumnCount, std::move(wrappedColumns), previousFlags, false);
-            Require(unbox<size_t>(numLinesWritten) == shrinkedLines.size());
+            auto const numLinesWritten = LineCount::cast_from(shrinkedLines.size());
             Require(numLinesWritten >= pageSize_.lines);
 
             while (shrinkedLines.size() < totalLineCount)
                 shrinkedLines.emplace_back(
                     LineFlags::None,
-                    TrivialLineBuffer { _newColumnCount, GraphicsAttributes {}, GraphicsAttributes {} });
+                    TrivialLineBuffer { _newColumnCount, InternedGraphicsAttributes {} });
 
             shrinkedLines.rotate_left(
                 unbox<size_t>(numLinesWritten - pageSize_.lines)); // maybe to be done outisde?
@@ -989,6 +1632,347 @@ CellLocation Grid<Cell>::resize(PageSize _newSize, CellLocation _currentCursorPo
     return cursor;
 }
 
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::reflowDeferredLines(LineOffset _top)
+{
+    auto const historyTop = -*historyLineCount();
+    auto const deferredEnd = historyTop + *deferredReflowLineCount_;
+    if (*_top >= deferredEnd)
+        return;
+
+    GridLog()("Reflowing {} deferred scrollback lines.", deferredReflowLineCount_);
+    invalidateMarkIndex();
+
+    // The lines of the commands within the rewrapped lines are not known anymore.
+    auto const rewrappedEnd = absoluteLineNumber(LineOffset(deferredEnd));
+    while (!commands_.empty() && commands_.front().promptLine < rewrappedEnd)
+        commands_.pop_front();
+
+    auto reflowedLines =
+        detail::reflowConcurrently(lines_, historyTop, deferredEnd, [&](int _begin, int _end) {
+            return detail::rewrapLines(lines_, _begin, _end, pageSize_.columns);
+        });
+
+    // Rewrapping to a narrower width may have produced more lines than the scrollback can hold.
+    auto const remainingLineCount = unbox<size_t>(linesUsed_ - deferredReflowLineCount_);
+    auto const maxReflowedLineCount =
+        std::holds_alternative<Infinite>(historyLimit_)
+            ? reflowedLines.size()
+            : std::min(reflowedLines.size(),
+                       unbox<size_t>(maxHistoryLineCount() + pageSize_.lines) - remainingLineCount);
+    auto const droppedLineCount = reflowedLines.size() - maxReflowedLineCount;
+
+    Lines<Cell> newLines;
+    auto const totalLineCount =
+        std::max(maxReflowedLineCount + remainingLineCount,
+                 unbox<size_t>(maxHistoryLineCount() + pageSize_.lines));
+    newLines.reserve(totalLineCount);
+    for (auto i = droppedLineCount; i < reflowedLines.size(); ++i)
+        newLines.emplace_back(std::move(reflowedLines[i]));
+    for (auto i = deferredEnd; i < *pageSize_.lines; ++i)
+        newLines.emplace_back(std::move(lines_[i]));
+
+    auto const newLinesUsed = LineCount::cast_from(newLines.size());
+    while (newLines.size() < totalLineCount)
+        newLines.emplace_back(
+            defaultLineFlags(),
+            TrivialLineBuffer { pageSize_.columns, InternedGraphicsAttributes {} });
+    newLines.rotate_left(unbox<size_t>(newLinesUsed - pageSize_.lines));
+
+    lines_ = std::move(newLines);
+    linesUsed_ = newLinesUsed;
+    deferredReflowLineCount_ = LineCount(0);
+    verifyState();
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::compactColdHistory(LineCount _scrolledLineCount)
+{
+    if (!historyCompactionThreshold_)
+        return;
+
+    // Only the lines that just scrolled beyond the threshold need to be looked at.
+    auto const bottom = -unbox<int>(*historyCompactionThreshold_);
+    auto const top = std::max(-unbox<int>(historyLineCount()), bottom - unbox<int>(_scrolledLineCount));
+    compactLines(top, bottom);
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::releaseScrolledImages(LineCount _scrolledLineCount)
+{
+    // Images are never rasterized again once placed, such that only their rasterized pixels,
+    // being of the size displayed, are needed for those scrolled into history.
+    auto const count = std::min(_scrolledLineCount, historyLineCount());
+    for (auto y = -unbox<int>(count); y < 0; ++y)
+        for (auto const& placement: lineAt(LineOffset(y)).imagePlacements())
+            placement.image->releaseImage();
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+size_t Grid<Cell>::compactHistory()
+{
+    return compactLines(-unbox<int>(historyLineCount()), 0);
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+LineCount Grid<Cell>::evictOldestLines(LineCount _count)
+{
+    auto const count = std::min(_count, historyLineCount());
+    if (!*count)
+        return count;
+
+    notifyEvictedLines(count);
+
+    // The dropped lines become unused lines above the scrollback, to be recycled by scrollUp().
+    auto const top = -unbox<int>(historyLineCount());
+    for (auto i = top; i < top + unbox<int>(count); ++i)
+        lines_[i].reset(defaultLineFlags(), GraphicsAttributes {});
+
+    linesUsed_ -= count;
+    deferredReflowLineCount_ -= std::min(deferredReflowLineCount_, count);
+    invalidateMarkIndex();
+    verifyState();
+    return count;
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+size_t Grid<Cell>::compactLines(int _top, int _bottom)
+{
+    auto compactedLines = size_t { 0 };
+    for (auto i = _top; i < _bottom; ++i)
+    {
+        auto& line = lines_[i];
+        if (!line.isInflatedBuffer())
+            continue;
+
+        auto const columnCount = unbox<size_t>(line.size());
+        if (!compactedTextBuffer_ || compactedTextBuffer_->bytesAvailable() < columnCount)
+            compactedTextBuffer_ =
+                crispy::BufferObject<char>::create(std::max(detail::CompactedTextBufferSize, columnCount));
+        if (line.tryDeflate(*compactedTextBuffer_))
+            ++compactedLines;
+    }
+    return compactedLines;
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+TextBufferUsage Grid<Cell>::textBufferUsage() const
+{
+    auto usage = TextBufferUsage {};
+    auto const referenced = detail::referencedTextBytes(lines_);
+
+    for (auto const& [buffer, bytes]: referenced)
+    {
+        ++usage.bufferObjects;
+        usage.bytesPinned += buffer->capacity();
+        usage.bytesReferenced += bytes;
+    }
+    return usage;
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+GridMemoryUsage Grid<Cell>::memoryUsage() const
+{
+    auto usage = GridMemoryUsage {};
+    for (auto const& line: lines_)
+    {
+        if (line.isTrivialBuffer())
+        {
+            ++usage.trivialLines;
+            usage.trivialBytes += sizeof(Line<Cell>);
+        }
+        else if (line.isInflatedBuffer())
+        {
+            ++usage.inflatedLines;
+            usage.inflatedBytes += sizeof(Line<Cell>) + line.inflatedBuffer().capacity() * sizeof(Cell);
+        }
+        else
+        {
+            auto const& buffer = line.attributedBuffer();
+            ++usage.attributedLines;
+            usage.attributedBytes += sizeof(Line<Cell>) + buffer.runs.capacity() * sizeof(AttributeRun)
+                                     + buffer.text.capacity();
+        }
+    }
+    return usage;
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+size_t Grid<Cell>::compactTextBuffers(float _maxLoadFactor)
+{
+    auto referenced = detail::referencedTextBytes(lines_);
+
+    for (auto line = LineOffset(0); line < boxed_cast<LineOffset>(pageSize_.lines); ++line)
+        if (lineAt(line).isTrivialBuffer())
+            if (auto const& text = lineAt(line).trivialBuffer().text; text.owner())
+                referenced.erase(text.owner().get());
+
+    // The buffer object currently being filled with compacted text is not a candidate either.
+    referenced.erase(compactedTextBuffer_.get());
+
+    // Keep the candidates alive until all lines have been looked at, such that their addresses cannot be reused
+    // by a new buffer object in the mean time.
+    auto candidates = std::vector<std::shared_ptr<crispy::BufferObject<char> const>> {};
+    for (auto i = referenced.begin(); i != referenced.end();)
+    {
+        if (float(i->second) < _maxLoadFactor * float(i->first->capacity()))
+        {
+            candidates.emplace_back(i->first->shared_from_this());
+            ++i;
+        }
+        else
+            i = referenced.erase(i);
+    }
+
+    if (referenced.empty())
+        return 0;
+
+    // Superseded by this pass.
+    textBufferCompaction_.reset();
+
+    auto movedBytes = size_t { 0 };
+    for (auto& line: lines_)
+        movedBytes += moveSparseText(line, referenced);
+
+    GridLog()("Compacted {} bytes of scrollback text out of {} sparsely used buffer objects.",
+              movedBytes,
+              referenced.size());
+    return referenced.size();
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+bool Grid<Cell>::compactTextBuffersStep(float _maxLoadFactor, float _minGridLoadFactor, LineCount _lineCount)
+{
+    // Lines are visited by their absolute line number, which they keep while scrolling up.
+    auto const oldestLine = absoluteLineNumber(-boxed_cast<LineOffset>(historyLineCount()));
+    auto const pageTop = absoluteLineNumber(LineOffset(0));
+
+    if (!textBufferCompaction_)
+        textBufferCompaction_ = TextBufferCompaction { false, oldestLine, {}, {}, 0 };
+    auto& pass = *textBufferCompaction_;
+
+    pass.nextLine = std::max(pass.nextLine, oldestLine);
+    auto const end = std::min(pass.nextLine + unbox<int64_t>(_lineCount), pageTop);
+    for (; pass.nextLine < end; ++pass.nextLine)
+    {
+        auto& line = lineAt(relativeLineOffset(pass.nextLine));
+        if (!pass.scanned)
+        {
+            // Buffer objects are kept alive until the pass is done, such that their address cannot be
+            // reused meanwhile.
+            if (line.isTrivialBuffer())
+                if (auto const& text = std::as_const(line).trivialBuffer().text; text.owner())
+                {
+                    auto const [i, inserted] = pass.referenced.try_emplace(text.owner().get(), 0);
+                    if (inserted)
+                        pass.buffers.emplace_back(text.owner());
+                    i->second += text.size();
+                }
+        }
+        else
+            pass.movedBytes += moveSparseText(line, pass.referenced);
+    }
+    if (pass.nextLine < pageTop)
+        return false;
+
+    if (pass.scanned)
+    {
+        GridLog()("Compacted {} bytes of scrollback text out of {} sparsely used buffer objects.",
+                  pass.movedBytes,
+                  pass.referenced.size());
+        textBufferCompaction_.reset();
+        return true;
+    }
+
+    // Buffer objects referenced by the main page are likely still being filled with PTY output,
+    // and the one currently being filled with compacted text is not a candidate either.
+    for (auto line = LineOffset(0); line < boxed_cast<LineOffset>(pageSize_.lines); ++line)
+        if (lineAt(line).isTrivialBuffer())
+            if (auto const& text = std::as_const(*this).lineAt(line).trivialBuffer().text; text.owner())
+                pass.referenced.erase(text.owner().get());
+    pass.referenced.erase(compactedTextBuffer_.get());
+
+    auto usage = TextBufferUsage {};
+    for (auto const& [buffer, bytes]: pass.referenced)
+    {
+        usage.bytesPinned += buffer->capacity();
+        usage.bytesReferenced += bytes;
+    }
+
+    if (usage.loadFactor() >= _minGridLoadFactor)
+        pass.referenced.clear();
+    for (auto i = pass.referenced.begin(); i != pass.referenced.end();)
+    {
+        if (float(i->second) < _maxLoadFactor * float(i->first->capacity()))
+            ++i;
+        else
+            i = pass.referenced.erase(i);
+    }
+    std::erase_if(pass.buffers, [&](auto const& buffer) { return !pass.referenced.count(buffer.get()); });
+
+    if (pass.referenced.empty())
+    {
+        textBufferCompaction_.reset();
+        return true;
+    }
+
+    pass.scanned = true;
+    pass.nextLine = oldestLine;
+    return false;
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+size_t Grid<Cell>::moveSparseText(
+    Line<Cell>& _line, std::unordered_map<crispy::BufferObject<char> const*, size_t> const& _sparse)
+{
+    if (!_line.isTrivialBuffer())
+        return 0;
+
+    auto const& text = std::as_const(_line).trivialBuffer().text;
+    if (!text.owner() || !_sparse.count(text.owner().get()))
+        return 0;
+
+    auto& buffer = _line.trivialBuffer();
+    if (buffer.text.empty())
+    {
+        // Lines that got reset still hold on to their buffer object without referencing any of it.
+        buffer.text = {};
+        return 0;
+    }
+
+    if (!compactedTextBuffer_ || compactedTextBuffer_->bytesAvailable() < buffer.text.size())
+        compactedTextBuffer_ =
+            crispy::BufferObject<char>::create(std::max(detail::CompactedTextBufferSize, buffer.text.size()));
+    auto const copy = compactedTextBuffer_->writeAtEnd(buffer.text.span());
+    compactedTextBuffer_->advance(copy.size());
+    buffer.text = crispy::BufferFragment<char>(compactedTextBuffer_, copy);
+    return copy.size();
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::notifyEvictedLines(LineCount _count)
+{
+    if (!evictedLineHandler_)
+        return;
+
+    auto const top = -unbox<int>(historyLineCount());
+    auto const bottom = top + unbox<int>(std::min(_count, linesUsed_));
+    for (auto i = top; i < bottom; ++i)
+        evictedLineHandler_(lines_[i]);
+}
+
 template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
 void Grid<Cell>::clampHistory()
@@ -1019,8 +2003,8 @@ void Grid<Cell>::appendNewLines(LineCount _count, GraphicsAttributes _attr)
 
     if (auto const n = std::min(_count, pageSize_.lines); *n > 0)
     {
-        generate_n(back_inserter(lines_), *n, [&]() {
-            return Line<Cell>(wrappableFlag, TrivialLineBuffer { pageSize_.columns, _attr, _attr });
+        std::generate_n(std::back_inserter(lines_), *n, [&]() {
+            return Line<Cell>(wrappableFlag, pageSize_.columns, _attr);
         });
         clampHistory();
     }
@@ -1064,9 +2048,9 @@ std::string dumpGrid(Grid<Cell> const& grid)
 template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
 CellLocationRange Grid<Cell>::wordRangeUnderCursor(CellLocation position,
-                                                   u32string_view wordDelimiters) const noexcept
+                                                   WordDelimiters const& wordDelimiters) const
 {
-    auto const left = [this, wordDelimiters, position]() {
+    auto const left = [this, &wordDelimiters, position]() {
         auto last = position;
         auto current = last;
 
@@ -1091,7 +2075,7 @@ CellLocationRange Grid<Cell>::wordRangeUnderCursor(CellLocation position,
         return last;
     }();
 
-    auto const right = [this, wordDelimiters, position]() {
+    auto const right = [this, &wordDelimiters, position]() {
         auto last = position;
         auto current = last;
 
@@ -1130,13 +2114,12 @@ CellLocationRange Grid<Cell>::wordRangeUnderCursor(CellLocation position,
 
 template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
-bool Grid<Cell>::cellEmptyOrContainsOneOf(CellLocation position, u32string_view delimiters) const noexcept
+bool Grid<Cell>::cellEmptyOrContainsOneOf(CellLocation position, WordDelimiters const& delimiters) const
 {
     // Word selection may be off by one
     position.column = min(position.column, boxed_cast<ColumnOffset>(pageSize().columns - 1));
 
-    auto const& cell = at(position.line, position.column);
-    return CellUtil::empty(cell) || delimiters.find(cell.codepoint(0)) != delimiters.npos;
+    return lineAt(position.line).wordDelimitedAt(position.column, delimiters);
 }
 
 template <typename Cell>
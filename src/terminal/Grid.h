@@ -34,10 +34,18 @@
 
 #include <algorithm>
 #include <array>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <optional>
+#include <ranges>
 #include <sstream>
 #include <string>
 #include <string_view>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 namespace terminal
 {
@@ -107,13 +115,49 @@ constexpr bool operator!=(Margin const& a, PageSize b) noexcept
 // }}}
 
 template <typename Cell>
-using Lines = crispy::ring<Line<Cell>>;
+using Lines = crispy::chunked_ring<Line<Cell>>;
 
 struct RenderPassHints
 {
     bool containsBlinkingCells = false;
 };
 
+/// Memory held by the buffer objects that the text of trivial line buffers refers to.
+struct TextBufferUsage
+{
+    size_t bufferObjects = 0;   //!< number of distinct buffer objects referenced
+    size_t bytesPinned = 0;     //!< total capacity of these buffer objects
+    size_t bytesReferenced = 0; //!< number of bytes actually referenced by lines
+
+    [[nodiscard]] float loadFactor() const noexcept
+    {
+        return bytesPinned ? float(bytesReferenced) / float(bytesPinned) : 1.0f;
+    }
+};
+
+/// Estimated memory held by the lines of a grid, by the kind of their line buffer.
+///
+/// The text of trivial lines is held by buffer objects, which are summed up by TextBufferUsage instead.
+struct GridMemoryUsage
+{
+    size_t trivialLines = 0;
+    size_t trivialBytes = 0;
+    size_t inflatedLines = 0;
+    size_t inflatedBytes = 0;
+    size_t attributedLines = 0;
+    size_t attributedBytes = 0;
+};
+
+/// Shell command as announced by the shell via shell integration (OSC 133),
+/// with its lines counted like Grid::scrolledUpLineCount() rather than relative to the main page.
+struct CommandRecord
+{
+    int64_t promptLine;                 //!< line the prompt starts on (OSC 133;A)
+    std::optional<int64_t> outputStart; //!< line the command output starts on (OSC 133;C)
+    std::optional<int64_t> outputEnd;   //!< line right below the command output (OSC 133;D)
+    std::optional<int> exitCode;        //!< exit code of the command, if reported (OSC 133;D)
+};
+
 /**
  * Represents a logical grid line, i.e. a sequence lines that were written without
  * an explicit linefeed, triggering an auto-wrap.
@@ -354,6 +398,45 @@ struct ReverseLogicalLines
     iterator end() const { return iterator(lines, topMostLine, topMostLine - 1, bottomMostLine); }
 };
 
+/**
+ * Read-only copy of the scrollback history and main page lines of a Grid, as taken by Grid::snapshot().
+ *
+ * The copied lines share their line buffers with the grid's lines, until these are modified.
+ * Taking a snapshot thus only costs copying the line objects, and the snapshot can then be read
+ * without holding the terminal lock while the terminal keeps processing output.
+ *
+ * Reading lines may update their caches, so a snapshot must not be read by multiple threads at once.
+ */
+template <typename Cell>
+class GridSnapshot
+{
+  public:
+    GridSnapshot() = default;
+
+    GridSnapshot(PageSize _pageSize, LineCount _historyLineCount, std::vector<Line<Cell>> _lines):
+        pageSize_ { _pageSize }, historyLineCount_ { _historyLineCount }, lines_ { std::move(_lines) }
+    {
+    }
+
+    [[nodiscard]] PageSize pageSize() const noexcept { return pageSize_; }
+    [[nodiscard]] LineCount historyLineCount() const noexcept { return historyLineCount_; }
+
+    /// @returns the line at the given offset, relative to the main page's top line like Grid::lineAt().
+    [[nodiscard]] Line<Cell> const& lineAt(LineOffset _line) const noexcept
+    {
+        return lines_[unbox<size_t>(_line + boxed_cast<LineOffset>(historyLineCount_))];
+    }
+
+    /// @returns all lines, the oldest scrollback line first.
+    [[nodiscard]] std::vector<Line<Cell>>& lines() noexcept { return lines_; }
+    [[nodiscard]] std::vector<Line<Cell>> const& lines() const noexcept { return lines_; }
+
+  private:
+    PageSize pageSize_ {};
+    LineCount historyLineCount_ {};
+    std::vector<Line<Cell>> lines_ {};
+};
+
 /**
  * Manages the screen grid buffer (main screen + scrollback history).
  *
@@ -403,6 +486,72 @@ class Grid
 
     void setMaxHistoryLineCount(MaxHistoryLineCount _maxHistoryLineCount);
 
+    /// Scrollback lines that scroll further up than the given number of lines are packed into a
+    /// compact representation where possible, see Line::tryDeflate(). They are unpacked again on access.
+    ///
+    /// std::nullopt disables compacting cold scrollback lines.
+    void setHistoryCompactionThreshold(std::optional<LineCount> _threshold) noexcept
+    {
+        historyCompactionThreshold_ = _threshold;
+    }
+
+    [[nodiscard]] std::optional<LineCount> historyCompactionThreshold() const noexcept
+    {
+        return historyCompactionThreshold_;
+    }
+
+    /// Packs all scrollback lines into a compact representation where possible, regardless of the
+    /// compaction threshold, e.g. once the terminal has been idle for a while.
+    ///
+    /// @returns the number of lines that have been packed.
+    size_t compactHistory();
+
+    /// Drops up to the given number of the oldest scrollback lines, handing them to the evicted line
+    /// handler first, if any, e.g. to stay within a scrollback memory budget.
+    ///
+    /// @returns the number of lines that have been dropped.
+    LineCount evictOldestLines(LineCount _count);
+
+    /// Sums up the buffer objects the text of trivial lines is referring to.
+    [[nodiscard]] TextBufferUsage textBufferUsage() const;
+
+    /// Sums up the memory held by all lines, including the unused ones.
+    [[nodiscard]] GridMemoryUsage memoryUsage() const;
+
+    /// Copies the text of scrollback lines out of buffer objects that are only sparsely referenced,
+    /// i.e. less than @p _maxLoadFactor of their capacity, into densely packed buffer objects,
+    /// such that a few long-lived lines do not keep whole buffer objects alive.
+    ///
+    /// Buffer objects still referenced by the main page are left alone, as they are likely
+    /// still being filled with PTY output.
+    ///
+    /// @returns the number of buffer objects no longer referenced by this grid.
+    size_t compactTextBuffers(float _maxLoadFactor);
+
+    /// Does the work of compactTextBuffers() in steps that each look at up to @p _lineCount lines,
+    /// resuming where the previous step left off, such that it can be done while processing output.
+    ///
+    /// A pass first sums up the bytes referenced per buffer object. Unless the scrollback uses at least
+    /// @p _minGridLoadFactor of the capacity of these buffer objects overall, it then moves the text
+    /// out of the sparsely referenced ones.
+    ///
+    /// @returns whether the pass has been completed, such that the next step starts a new one.
+    bool compactTextBuffersStep(float _maxLoadFactor, float _minGridLoadFactor, LineCount _lineCount);
+
+    /// Tests whether a pass of compactTextBuffersStep() is in progress.
+    [[nodiscard]] bool compactingTextBuffers() const noexcept { return textBufferCompaction_.has_value(); }
+
+    /// Total number of lines scrolled up from the main page so far.
+    ///
+    /// This allows keeping track of a line's offset while the grid keeps on scrolling.
+    [[nodiscard]] uint64_t scrolledUpLineCount() const noexcept { return scrolledUpLineCount_; }
+
+    using EvictedLineHandler = std::function<void(Line<Cell> const&)>;
+
+    /// Hands each scrollback line that is about to be evicted because the history limit has been
+    /// reached to the given handler, oldest line first.
+    void setEvictedLineHandler(EvictedLineHandler _handler) { evictedLineHandler_ = std::move(_handler); }
+
     [[nodiscard]] LineCount totalLineCount() const noexcept
     {
         return maxHistoryLineCount() + pageSize_.lines;
@@ -417,12 +566,30 @@ class Grid
 
     /// Resizes the main page area of the grid and adapts the scrollback area's width accordingly.
     ///
+    /// When reflowing, only the main page and the most recent scrollback lines are reflowed right away.
+    /// The reflow of older scrollback lines is deferred, see reflowDeferredLines().
+    ///
     /// @param _pageSize          new size of the main page area
     /// @param _currentCursorPos  current cursor position
     /// @param _wrapPending       AutoWrap is on and a wrap is pending
     ///
     /// @returns updated cursor position.
     [[nodiscard]] CellLocation resize(PageSize _pageSize, CellLocation _currentCursorPos, bool _wrapPending);
+
+    /// Number of the oldest scrollback lines whose reflow has been deferred by resize().
+    ///
+    /// These lines retain the width they have been wrapped for until reflowed on demand.
+    [[nodiscard]] LineCount deferredReflowLineCount() const noexcept { return deferredReflowLineCount_; }
+
+    /// Reflows the scrollback lines whose reflow has been deferred by resize(),
+    /// if any of them is at or below the given line offset @p _top.
+    ///
+    /// This changes the number of scrollback lines, but leaves the offsets of all lines
+    /// below the formerly deferred ones intact.
+    void reflowDeferredLines(LineOffset _top);
+
+    /// Reflows all scrollback lines whose reflow has been deferred by resize().
+    void reflowDeferredLines() { reflowDeferredLines(-boxed_cast<LineOffset>(historyLineCount())); }
     // }}}
 
     // {{{ Line API
@@ -430,6 +597,23 @@ class Grid
     Line<Cell>& lineAt(LineOffset _line) noexcept;
     Line<Cell> const& lineAt(LineOffset _line) const noexcept;
 
+    /// Takes a snapshot of the scrollback history and main page lines, reflowing deferred lines first.
+    [[nodiscard]] GridSnapshot<Cell> snapshot();
+
+    /// Replaces the scrollback history and main page lines with the ones of the given snapshot,
+    /// which must have the same page size as this grid.
+    ///
+    /// History lines exceeding the history limit are dropped, the oldest ones first.
+    void restore(GridSnapshot<Cell> _snapshot);
+
+    /// Marks the IDs of the hyperlinks referred to by the history and main page lines in @p _referenced,
+    /// which is indexed by ID.
+    void markReferencedHyperlinks(std::vector<bool>& _referenced) const;
+
+    /// Collects the hyperlinks shown on the page lines, as seen at the given scroll offset,
+    /// into @p _output, which is reset beforehand.
+    void collectHyperlinkSpans(ScrollOffset _scrollOffset, HyperlinkSpans& _output) const;
+
     gsl::span<Cell const> lineBuffer(LineOffset _line) const noexcept { return lineAt(_line).cells(); }
     gsl::span<Cell const> lineBufferRightTrimmed(LineOffset _line) const noexcept;
 
@@ -451,16 +635,54 @@ class Grid
     [[nodiscard]] size_t zero_index() const noexcept { return lines_.zero_index(); }
     // }}}
 
+    // {{{ marks
+    /// Marks the given line, see Line::marked().
+    void setMarked(LineOffset _line);
+
+    /// Finds the closest marked line above @p _line, up to the top of the scrollback.
+    [[nodiscard]] std::optional<LineOffset> findMarkedLineAbove(LineOffset _line) const;
+
+    /// Finds the closest marked line below @p _line, down to @p _bottom inclusively.
+    [[nodiscard]] std::optional<LineOffset> findMarkedLineBelow(LineOffset _line, LineOffset _bottom) const;
+    // }}}
+
+    // {{{ shell integration
+    /// Starts a new command record with its prompt on the given line (OSC 133;A).
+    ///
+    /// Records of commands at or below that line are dropped, as these lines have been overwritten.
+    void beginCommandPrompt(LineOffset _line);
+
+    /// Starts the output of the current command on the given line (OSC 133;C).
+    void beginCommandOutput(LineOffset _line);
+
+    /// Finishes the current command with its output ending right above @p _line (OSC 133;D).
+    void endCommand(LineOffset _line, std::optional<int> _exitCode);
+
+    /// Command records, the most recent one last.
+    ///
+    /// These are dropped on resize, as the lines they refer to may have been rewrapped.
+    [[nodiscard]] std::deque<CommandRecord> const& commands() const noexcept { return commands_; }
+
+    /// @returns the lines of the output of the most recent finished command, if still within the grid.
+    [[nodiscard]] std::optional<Range> lastCommandOutput() const;
+
+    /// Finds the prompt line of the closest command above @p _line that has failed,
+    /// i.e. reported a non-zero exit code.
+    [[nodiscard]] std::optional<LineOffset> findFailedCommandAbove(LineOffset _line) const;
+    // }}}
+
     /// Gets a reference to the cell relative to screen origin (top left, 0:0).
     [[nodiscard]] Cell& useCellAt(LineOffset _line, ColumnOffset _column) noexcept;
     [[nodiscard]] Cell& at(LineOffset _line, ColumnOffset _column) noexcept;
     [[nodiscard]] Cell const& at(LineOffset _line, ColumnOffset _column) const noexcept;
 
     // page view API
-    gsl::span<Line<Cell>> pageAtScrollOffset(ScrollOffset _scrollOffset);
-    gsl::span<Line<Cell> const> pageAtScrollOffset(ScrollOffset _scrollOffset) const;
-    gsl::span<Line<Cell>> mainPage();
-    gsl::span<Line<Cell> const> mainPage() const;
+    using PageLines = std::ranges::subrange<typename Lines<Cell>::iterator>;
+    using ConstPageLines = std::ranges::subrange<typename Lines<Cell>::const_iterator>;
+    PageLines pageAtScrollOffset(ScrollOffset _scrollOffset);
+    ConstPageLines pageAtScrollOffset(ScrollOffset _scrollOffset) const;
+    PageLines mainPage();
+    ConstPageLines mainPage() const;
 
     LogicalLines<Cell> logicalLines()
     {
@@ -479,8 +701,13 @@ class Grid
     // {{{ buffer manipulation
 
     /// Completely deletes all scrollback lines.
+    ///
+    /// This is constant-time, except for releasing an unbounded scrollback of more than
+    /// BackgroundReleaseThreshold lines, which is done on a background thread.
     void clearHistory();
 
+    static constexpr LineCount BackgroundReleaseThreshold = LineCount(4096);
+
     /// Scrolls up by @p _n lines within the given margin.
     ///
     /// @param _n number of lines to scroll up within the given margin.
@@ -507,7 +734,19 @@ class Grid
     // {{{ Rendering API
     /// Renders the full screen by passing every grid cell to the callback.
     template <typename RendererT>
-    [[nodiscard]] RenderPassHints render(RendererT&& _render, ScrollOffset _scrollOffset = {}) const;
+    [[nodiscard]] RenderPassHints render(RendererT&& _render, ScrollOffset _scrollOffset = {}) const
+    {
+        return renderLines(std::forward<RendererT>(_render), _scrollOffset, LineOffset(0), pageSize_.lines);
+    }
+
+    /// Renders the given band of lines of the screen by passing every grid cell to the callback.
+    ///
+    /// The lines are passed with their screen line offsets, starting at @p _first.
+    template <typename RendererT>
+    [[nodiscard]] RenderPassHints renderLines(RendererT&& _render,
+                                              ScrollOffset _scrollOffset,
+                                              LineOffset _first,
+                                              LineCount _count) const;
 
     /// Takes text-screenshot of the main page.
     [[nodiscard]] std::string renderMainPageText() const;
@@ -526,10 +765,10 @@ class Grid
 
     // Retrieves the cell location range of the underlying word at the given cursor position.
     [[nodiscard]] CellLocationRange wordRangeUnderCursor(CellLocation position,
-                                                         std::u32string_view delimiters) const noexcept;
+                                                         WordDelimiters const& delimiters) const;
 
     [[nodiscard]] bool cellEmptyOrContainsOneOf(CellLocation position,
-                                                std::u32string_view delimiters) const noexcept;
+                                                WordDelimiters const& delimiters) const;
 
     // Lineary extracts the text of a given grid cell range.
     [[nodiscard]] std::u32string extractText(CellLocationRange range) const noexcept;
@@ -557,6 +796,33 @@ class Grid
     CellLocation growLines(LineCount _newHeight, CellLocation _cursor);
     void appendNewLines(LineCount _count, GraphicsAttributes _attr);
     void clampHistory();
+    void compactColdHistory(LineCount _scrolledLineCount);
+    void releaseScrolledImages(LineCount _scrolledLineCount);
+    size_t compactLines(int _top, int _bottom);
+    void notifyEvictedLines(LineCount _count);
+    size_t moveSparseText(Line<Cell>& _line,
+                          std::unordered_map<crispy::BufferObject<char> const*, size_t> const& _sparse);
+
+    // {{{ mark index helpers
+    [[nodiscard]] int64_t absoluteLineNumber(LineOffset _line) const noexcept
+    {
+        return static_cast<int64_t>(scrolledUpLineCount_) + unbox<int64_t>(_line);
+    }
+
+    [[nodiscard]] LineOffset relativeLineOffset(int64_t _absoluteLineNumber) const noexcept
+    {
+        return LineOffset::cast_from(_absoluteLineNumber - static_cast<int64_t>(scrolledUpLineCount_));
+    }
+
+    /// Rebuilds the mark index from the line flags if it has been invalidated,
+    /// and drops the marks that have scrolled off the top of the scrollback.
+    void updateMarkIndex() const;
+
+    /// Reindexes the marks of the main page lines, after these have been moved around.
+    void reindexMainPageMarks();
+
+    void invalidateMarkIndex() noexcept { markIndexValid_ = false; }
+    // }}}
 
     // {{{ buffer helpers
     void resizeBuffers(PageSize _newSize)
@@ -588,8 +854,91 @@ class Grid
 
     // Number of lines used in the Lines buffer.
     LineCount linesUsed_;
+
+    // Number of lines at the top of the scrollback that still need to be reflowed to the page width.
+    LineCount deferredReflowLineCount_ {};
+
+    // Distance from the main page beyond which scrollback lines get compacted, if enabled.
+    std::optional<LineCount> historyCompactionThreshold_ {};
+
+    // Storage for the text of compacted scrollback lines.
+    crispy::BufferObjectPtr<char> compactedTextBuffer_ {};
+
+    // Pass of compactTextBuffersStep() in progress, if any.
+    struct TextBufferCompaction
+    {
+        bool scanned = false;    //!< whether the referenced bytes have been summed up already
+        int64_t nextLine = 0;    //!< absolute line number of the next line to look at
+        std::unordered_map<crispy::BufferObject<char> const*, size_t> referenced;
+        std::vector<std::shared_ptr<crispy::BufferObject<char> const>> buffers; //!< kept alive until done
+        size_t movedBytes = 0;
+    };
+    std::optional<TextBufferCompaction> textBufferCompaction_ {};
+
+    // Receives the lines evicted from the scrollback, if enabled.
+    EvictedLineHandler evictedLineHandler_ {};
+
+    uint64_t scrolledUpLineCount_ = 0;
+
+    // Absolute line numbers (counted like scrolledUpLineCount_) of the marked lines, in ascending order.
+    //
+    // Lines scrolling up keep their absolute line number, so the index only needs to be rebuilt
+    // when lines are moved otherwise. Marks cleared by resetting a line are dropped on lookup.
+    mutable std::vector<int64_t> markedLines_;
+    mutable bool markIndexValid_ = false;
+
+    // Commands announced via shell integration, in ascending order of their prompt lines.
+    std::deque<CommandRecord> commands_;
+
+    // Releases the scrollback lines cut off by clearHistory(), which is waited for on destruction
+    // as the lines may refer to buffer objects of pools not outliving the grid.
+    std::future<void> historyRelease_;
 };
 
+/// Searches reverse for @p _searchText, starting at @p _startPosition, through at most @p _maxLineCount
+/// lines of @p _lines, which is either a Grid or a GridSnapshot.
+///
+/// @returns the position of the first match found.
+template <typename LineSource>
+std::optional<CellLocation> searchReverse(LineSource const& _lines,
+                                          std::u32string_view _searchText,
+                                          CellLocation _startPosition,
+                                          LineCount _maxLineCount)
+{
+    // TODO use LogicalLinesReverse to spawn logical lines for improving the search on wrapped lines.
+
+    if (_searchText.empty())
+        return std::nullopt;
+
+    // First try match at start location.
+    if (_lines.lineAt(_startPosition.line).matchTextAt(_searchText, _startPosition.column))
+        return _startPosition;
+
+    // Search reverse until found or exhausted.
+    auto const needle = LineSearchSignature::of(_searchText);
+    auto position = _startPosition;
+    auto const topLine = std::max(-boxed_cast<LineOffset>(_lines.historyLineCount()),
+                                  _startPosition.line - boxed_cast<LineOffset>(_maxLineCount) + 1);
+    while (position.line >= topLine)
+    {
+        auto const& line = _lines.lineAt(position.line);
+        if (line.mayContain(needle))
+        {
+            auto newColumn = line.searchReverse(_searchText, position.column);
+            if (newColumn != position.column)
+            {
+                position.column = newColumn;
+                return position; // new match found
+            }
+        }
+
+        position.column = boxed_cast<ColumnOffset>(_lines.pageSize().columns) - 1;
+        position.line--;
+    }
+
+    return std::nullopt;
+}
+
 template <typename Cell>
 std::ostream& dumpGrid(std::ostream& os, Grid<Cell> const& grid);
 
@@ -622,23 +971,35 @@ bool Grid<Cell>::isLineWrapped(LineOffset _line) const noexcept
 template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
 template <typename RendererT>
-[[nodiscard]] RenderPassHints Grid<Cell>::render(RendererT&& _render, ScrollOffset _scrollOffset) const
+[[nodiscard]] RenderPassHints Grid<Cell>::renderLines(RendererT&& _render,
+                                                      ScrollOffset _scrollOffset,
+                                                      LineOffset _first,
+                                                      LineCount _count) const
 {
     assert(!_scrollOffset || unbox<LineCount>(_scrollOffset) <= historyLineCount());
+    assert(_first >= LineOffset(0) && boxed_cast<LineCount>(_first) + _count <= pageSize_.lines);
 
-    auto y = LineOffset(0);
+    auto y = _first;
     auto hints = RenderPassHints {};
-    for (int i = -*_scrollOffset, e = i + *pageSize_.lines; i != e; ++i, ++y)
+    for (int i = *_first - *_scrollOffset, e = i + *_count; i != e; ++i, ++y)
     {
         auto x = ColumnOffset(0);
         Line<Cell> const& line = lines_[i];
         if (line.isTrivialBuffer())
         {
-            auto const cellFlags = line.trivialBuffer().textAttributes.flags;
+            auto const cellFlags = line.trivialBuffer().textAttributes->flags;
             hints.containsBlinkingCells = hints.containsBlinkingCells || (CellFlags::Blinking & cellFlags)
                                           || (CellFlags::RapidBlinking & cellFlags);
             _render.renderTrivialLine(line.trivialBuffer(), y);
         }
+        else if (line.isAttributedBuffer())
+        {
+            for (auto const& run: line.attributedBuffer().runs)
+                hints.containsBlinkingCells = hints.containsBlinkingCells
+                                              || (CellFlags::Blinking & run.attributes.flags)
+                                              || (CellFlags::RapidBlinking & run.attributes.flags);
+            _render.renderAttributedLine(line.attributedBuffer(), y);
+        }
         else
         {
             _render.startLine(y);
@@ -649,6 +1010,7 @@ template <typename RendererT>
                                               || (CellFlags::RapidBlinking & cell.flags());
                 _render.renderCell(cell, y, x++);
             }
+            line.visitDisplayedImages([&](ImagePlacement const& _image) { _render.renderImage(_image, y); });
             _render.endLine();
         }
     }
@@ -33,6 +33,11 @@ using Cell = PrimaryScreenCell;
 
 namespace
 {
+InternedGraphicsAttributes interned(GraphicsAttributes const& _attributes)
+{
+    return *InternedGraphicsAttributes::intern(_attributes);
+}
+
 void logGridText(Grid<Cell> const& _grid, string const& _headline = "")
 {
     UNSCOPED_INFO(fmt::format("Grid.dump(hist {}, max hist {}, size {}, ZI {}): {}",
@@ -183,6 +188,63 @@ TEST_CASE("Grid.writeAndScrollUp", "[grid]")
     CHECK(grid.lineText(LineOffset(1)) == "     ");
 }
 
+TEST_CASE("Grid.scrollUp.verticalMargin", "[grid]")
+{
+    auto constexpr pageSize = PageSize { LineCount(5), ColumnCount(3) };
+    // The history lines wrap the line ring around, such that the rotated lines do too.
+    auto grid = setupGrid(
+        pageSize, true, LineCount(2), { "000", "111", "222", "333", "AAA", "BBB", "CCC", "DDD", "EEE" });
+    auto margin = fullPageMargin(pageSize);
+    margin.vertical = Margin::Vertical { LineOffset(1), LineOffset(3) };
+
+    auto const scrolledUp = grid.scrollUp(LineCount(2), GraphicsAttributes {}, margin);
+    logGridText(grid, "after scrolling up within the vertical margin");
+
+    CHECK(scrolledUp == LineCount(0));
+    CHECK(grid.historyLineCount() == LineCount(2));
+    CHECK(grid.lineText(LineOffset(-2)) == "222");
+    CHECK(grid.lineText(LineOffset(-1)) == "333");
+    CHECK(grid.lineText(LineOffset(0)) == "AAA");
+    CHECK(grid.lineText(LineOffset(1)) == "DDD");
+    CHECK(grid.lineText(LineOffset(2)) == "   ");
+    CHECK(grid.lineText(LineOffset(3)) == "   ");
+    CHECK(grid.lineText(LineOffset(4)) == "EEE");
+}
+
+TEST_CASE("Grid.scrollUp.horizontalMargin", "[grid]")
+{
+    auto constexpr pageSize = PageSize { LineCount(4), ColumnCount(5) };
+    auto grid = setupGrid(pageSize, true, LineCount(0), { "ABCDE", "FGHIJ", "", "PQRST" });
+    auto margin = fullPageMargin(pageSize);
+    margin.horizontal = Margin::Horizontal { ColumnOffset(1), ColumnOffset(3) };
+
+    auto const scrolledUp = grid.scrollUp(LineCount(1), GraphicsAttributes {}, margin);
+    logGridText(grid, "after scrolling up within the horizontal margin");
+
+    CHECK(scrolledUp == LineCount(0));
+    CHECK(grid.lineText(LineOffset(0)) == "AGHIE");
+    CHECK(grid.lineText(LineOffset(1)) == "F   J");
+    CHECK(grid.lineText(LineOffset(2)) == " QRS ");
+    CHECK(grid.lineText(LineOffset(3)) == "P   T");
+}
+
+TEST_CASE("Grid.scrollUp.horizontalMargin.trivial", "[grid]")
+{
+    auto constexpr pageSize = PageSize { LineCount(3), ColumnCount(5) };
+    auto grid = setupGrid(pageSize, true, LineCount(0), { "", "", "ABCDE" });
+    auto margin = fullPageMargin(pageSize);
+    margin.horizontal = Margin::Horizontal { ColumnOffset(1), ColumnOffset(4) };
+
+    grid.scrollUp(LineCount(1), GraphicsAttributes {}, margin);
+    logGridText(grid, "after scrolling up within the horizontal margin");
+
+    // Blank columns got moved into blank columns, without inflating the lines.
+    CHECK(grid.lineAt(LineOffset(0)).isTrivialBuffer());
+    CHECK(grid.lineText(LineOffset(0)) == "     ");
+    CHECK(grid.lineText(LineOffset(1)) == " BCDE");
+    CHECK(grid.lineText(LineOffset(2)) == "A    ");
+}
+
 TEST_CASE("iteratorAt", "[grid]")
 {
     auto grid = Grid<Cell>(PageSize { LineCount(3), ColumnCount(3) }, true, LineCount(0));
@@ -851,6 +913,321 @@ TEST_CASE("Grid.reflow.tripple", "[grid]")
     }
 }
 
+TEST_CASE("Grid.reflow.huge_scrollback", "[grid]")
+{
+    // Large enough for the scrollback to be reflowed in multiple chunks concurrently.
+    auto constexpr LineCountTotal = 12'000;
+    auto grid = Grid<Cell>(PageSize { LineCount(2), ColumnCount(6) }, true, LineCount(30'000));
+    for (int n = 0; n < LineCountTotal; ++n)
+    {
+        if (n >= 2)
+            grid.scrollUp(LineCount(1));
+        grid.setLineText(LineOffset(std::min(n, 1)), fmt::format("{:06}", n));
+    }
+    REQUIRE(grid.historyLineCount() == LineCount(LineCountTotal - 2));
+
+    (void) grid.resize(PageSize { LineCount(2), ColumnCount(3) }, CellLocation {}, false);
+    CHECK(grid.deferredReflowLineCount() > LineCount(0));
+    grid.reflowDeferredLines();
+    REQUIRE(grid.historyLineCount() == LineCount(2 * LineCountTotal - 2));
+    auto mismatches = 0;
+    for (int n = 0; n < LineCountTotal; ++n)
+    {
+        auto const text = fmt::format("{:06}", n);
+        auto const top = LineOffset(2 * n - (2 * LineCountTotal - 2));
+        if (grid.lineText(top) != text.substr(0, 3) || grid.lineText(top + 1) != text.substr(3)
+            || grid.lineAt(top).wrapped() || !grid.lineAt(top + 1).wrapped())
+            ++mismatches;
+    }
+    CHECK(mismatches == 0);
+
+    (void) grid.resize(PageSize { LineCount(2), ColumnCount(6) }, CellLocation {}, false);
+    CHECK(grid.deferredReflowLineCount() > LineCount(0));
+    grid.reflowDeferredLines();
+    REQUIRE(grid.historyLineCount() == LineCount(LineCountTotal - 2));
+    mismatches = 0;
+    for (int n = 0; n < LineCountTotal; ++n)
+        if (grid.lineText(LineOffset(n - LineCountTotal + 2)) != fmt::format("{:06}", n))
+            ++mismatches;
+    CHECK(mismatches == 0);
+}
+
+TEST_CASE("Grid.reflow.deferred", "[grid]")
+{
+    auto constexpr LineCountTotal = 3'000;
+    auto grid = Grid<Cell>(PageSize { LineCount(2), ColumnCount(4) }, true, LineCount(10'000));
+    for (int n = 0; n < LineCountTotal; ++n)
+    {
+        if (n >= 2)
+            grid.scrollUp(LineCount(1));
+        grid.setLineText(LineOffset(std::min(n, 1)), fmt::format("{:04}", n));
+    }
+
+    (void) grid.resize(PageSize { LineCount(2), ColumnCount(2) }, CellLocation {}, false);
+    auto const deferredLineCount = grid.deferredReflowLineCount();
+    REQUIRE(deferredLineCount > LineCount(0));
+
+    // The most recent lines are reflowed right away, the oldest ones keep their former width.
+    CHECK(grid.lineText(LineOffset(0)) == "29");
+    CHECK(grid.lineText(LineOffset(1)) == "99");
+    auto const oldestLine = -boxed_cast<LineOffset>(grid.historyLineCount());
+    CHECK(grid.lineText(oldestLine) == "0000");
+
+    // Accessing lines below the deferred ones does not reflow them.
+    grid.reflowDeferredLines(oldestLine + boxed_cast<LineOffset>(deferredLineCount));
+    CHECK(grid.deferredReflowLineCount() == deferredLineCount);
+
+    // Resizing again leaves the deferred lines wrapped for mixed widths.
+    (void) grid.resize(PageSize { LineCount(2), ColumnCount(4) }, CellLocation {}, false);
+    CHECK(grid.deferredReflowLineCount() > deferredLineCount);
+
+    grid.reflowDeferredLines();
+    CHECK(grid.deferredReflowLineCount() == LineCount(0));
+    REQUIRE(grid.historyLineCount() == LineCount(LineCountTotal - 2));
+    auto mismatches = 0;
+    for (int n = 0; n < LineCountTotal; ++n)
+        if (grid.lineText(LineOffset(n - LineCountTotal + 2)) != fmt::format("{:04}", n)
+            || grid.lineAt(LineOffset(n - LineCountTotal + 2)).wrapped())
+            ++mismatches;
+    CHECK(mismatches == 0);
+}
+
+TEST_CASE("Grid.compactColdHistory", "[grid]")
+{
+    auto grid = Grid<Cell>(PageSize { LineCount(2), ColumnCount(4) }, true, LineCount(10));
+    grid.setHistoryCompactionThreshold(LineCount(2));
+    grid.setLineText(LineOffset(0), "ABCD");
+    grid.setLineText(LineOffset(1), "abcd");
+    grid.lineAt(LineOffset(1)).useCellAt(ColumnOffset(2)).setForegroundColor(
+        Color::Indexed(IndexedColor::Red));
+    REQUIRE(grid.lineAt(LineOffset(0)).isInflatedBuffer());
+
+    // Lines within the threshold are left as-is.
+    grid.scrollUp(LineCount(2));
+    CHECK(grid.lineAt(LineOffset(-2)).isInflatedBuffer());
+    CHECK(grid.lineAt(LineOffset(-1)).isInflatedBuffer());
+
+    // Lines beyond the threshold are compacted, those of mixed graphics attributes into attribute runs.
+    grid.scrollUp(LineCount(2));
+    CHECK(grid.lineAt(LineOffset(-4)).isTrivialBuffer());
+    CHECK(grid.lineAt(LineOffset(-3)).isAttributedBuffer());
+    CHECK(grid.lineText(LineOffset(-4)) == "ABCD");
+    CHECK(grid.lineText(LineOffset(-3)) == "abcd");
+}
+
+TEST_CASE("Grid.compactHistory", "[grid]")
+{
+    auto grid = Grid<Cell>(PageSize { LineCount(2), ColumnCount(4) }, true, LineCount(10));
+    grid.setLineText(LineOffset(0), "ABCD");
+    grid.setLineText(LineOffset(1), "abcd");
+    grid.scrollUp(LineCount(2));
+    grid.setLineText(LineOffset(0), "EFGH");
+    REQUIRE(grid.lineAt(LineOffset(-2)).isInflatedBuffer());
+    REQUIRE(grid.lineAt(LineOffset(-1)).isInflatedBuffer());
+
+    // All scrollback lines are compacted, regardless of the (disabled) threshold, the main page is left as-is.
+    CHECK(grid.compactHistory() == 2);
+    CHECK(grid.lineAt(LineOffset(-2)).isTrivialBuffer());
+    CHECK(grid.lineAt(LineOffset(-1)).isTrivialBuffer());
+    CHECK(grid.lineAt(LineOffset(0)).isInflatedBuffer());
+    CHECK(grid.lineText(LineOffset(-2)) == "ABCD");
+    CHECK(grid.lineText(LineOffset(-1)) == "abcd");
+    CHECK(grid.compactHistory() == 0);
+}
+
+TEST_CASE("Grid.scrollUp.releaseImages", "[grid]")
+{
+    auto grid = Grid<Cell>(PageSize { LineCount(2), ColumnCount(4) }, true, LineCount(10));
+    auto image = std::make_shared<Image>(
+        ImageId(1), ImageFormat::RGBA, Image::Data(64, 0xFF), ImageSize { Width(4), Height(4) }, [](auto) {});
+    auto const source = std::weak_ptr<Image const>(image);
+    auto const rasterizedImage = std::make_shared<RasterizedImage>(std::move(image),
+                                                                   ImageAlignment::TopStart,
+                                                                   ImageResize::NoResize,
+                                                                   RGBAColor {},
+                                                                   GridSize { LineCount(1), ColumnCount(4) },
+                                                                   ImageSize { Width(1), Height(4) });
+    rasterizedImage->rasterize();
+    grid.lineAt(LineOffset(1)).placeImage(
+        ImagePlacement { rasterizedImage, ColumnOffset(0), ColumnCount(4), CellLocation {} }, {});
+
+    // Images on the main page keep their source image.
+    grid.scrollUp(LineCount(1));
+    CHECK(!rasterizedImage->imageReleased());
+    CHECK(!source.expired());
+
+    // Images scrolled into history release it, keeping only the pixels displayed.
+    grid.scrollUp(LineCount(1));
+    CHECK(rasterizedImage->imageReleased());
+    CHECK(source.expired());
+    CHECK(rasterizedImage->imageId() == ImageId(1));
+    CHECK(*rasterizedImage->pixels() == Image::Data(64, 0xFF));
+}
+
+TEST_CASE("Grid.evictOldestLines", "[grid]")
+{
+    auto grid = Grid<Cell>(PageSize { LineCount(2), ColumnCount(4) }, true, LineCount(10));
+    grid.setLineText(LineOffset(0), "ABCD");
+    grid.setLineText(LineOffset(1), "abcd");
+    grid.scrollUp(LineCount(2));
+    grid.setLineText(LineOffset(0), "EFGH");
+    grid.setLineText(LineOffset(1), "efgh");
+    grid.scrollUp(LineCount(1));
+    REQUIRE(grid.historyLineCount() == LineCount(3));
+
+    // The oldest lines go first, the main page is left as-is.
+    CHECK(grid.evictOldestLines(LineCount(2)) == LineCount(2));
+    CHECK(grid.historyLineCount() == LineCount(1));
+    CHECK(grid.lineText(LineOffset(-1)) == "EFGH");
+    CHECK(grid.lineText(LineOffset(0)) == "efgh");
+
+    // No more than the scrollback lines are dropped.
+    CHECK(grid.evictOldestLines(LineCount(5)) == LineCount(1));
+    CHECK(grid.historyLineCount() == LineCount(0));
+    CHECK(grid.lineText(LineOffset(0)) == "efgh");
+
+    // The dropped lines are taken up again.
+    grid.scrollUp(LineCount(1));
+    CHECK(grid.historyLineCount() == LineCount(1));
+    CHECK(grid.lineText(LineOffset(-1)) == "efgh");
+}
+
+TEST_CASE("Grid.compactTextBuffers", "[grid]")
+{
+    auto const width = ColumnCount(4);
+    auto grid = Grid<Cell>(PageSize { LineCount(2), width }, true, LineCount(10));
+    auto pool = crispy::BufferObjectPool<char>(4096);
+    auto const sgr = GraphicsAttributes {};
+    {
+        auto bufferObject = pool.allocateBufferObject();
+        bufferObject->writeAtEnd("ABCD"sv);
+        grid.lineAt(LineOffset(0)) =
+            Line<Cell>(LineFlags::None,
+                       TrivialLineBuffer { width,
+                                           interned(sgr),
+                                           interned(sgr),
+                                           HyperlinkId {},
+                                           width,
+                                           bufferObject->ref(0, 4) });
+    }
+
+    // While on the main page, the line's buffer object is left alone.
+    CHECK(grid.compactTextBuffers(0.5f) == 0);
+    CHECK(pool.stats().liveBuffers == 1);
+
+    grid.scrollUp(LineCount(2));
+    auto const usage = grid.textBufferUsage();
+    CHECK(usage.bufferObjects == 1);
+    CHECK(usage.bytesReferenced == 4);
+    CHECK(usage.loadFactor() < 0.01f);
+
+    // The only line referencing the buffer object moves its text elsewhere, freeing up the buffer object.
+    CHECK(grid.compactTextBuffers(0.5f) == 1);
+    CHECK(pool.stats().liveBuffers == 0);
+    CHECK(pool.stats().unusedBuffers == 1);
+    CHECK(grid.lineAt(LineOffset(-2)).isTrivialBuffer());
+    CHECK(grid.lineText(LineOffset(-2)) == "ABCD");
+
+    // Compacted text is not moved again while its buffer object is still being filled.
+    CHECK(grid.compactTextBuffers(0.5f) == 0);
+}
+
+TEST_CASE("Grid.compactTextBuffersStep", "[grid]")
+{
+    auto const width = ColumnCount(4);
+    auto grid = Grid<Cell>(PageSize { LineCount(2), width }, true, LineCount(10));
+    auto pool = crispy::BufferObjectPool<char>(4096);
+    auto const sgr = GraphicsAttributes {};
+    {
+        auto bufferObject = pool.allocateBufferObject();
+        bufferObject->writeAtEnd("ABCDEFGH"sv);
+        for (auto const i: { 0, 1 })
+            grid.lineAt(LineOffset(i)) =
+                Line<Cell>(LineFlags::None,
+                           TrivialLineBuffer { width,
+                                               interned(sgr),
+                                               interned(sgr),
+                                               HyperlinkId {},
+                                               width,
+                                               bufferObject->ref(size_t(i) * 4, 4) });
+    }
+
+    // While on the main page, the lines' buffer object is left alone.
+    CHECK(grid.compactTextBuffersStep(0.5f, 0.5f, LineCount(1)));
+    CHECK(!grid.compactingTextBuffers());
+    CHECK(pool.stats().liveBuffers == 1);
+
+    grid.scrollUp(LineCount(2));
+
+    // One line per step: scanning both lines, then moving the text of both.
+    CHECK(!grid.compactTextBuffersStep(0.5f, 0.5f, LineCount(1)));
+    CHECK(!grid.compactTextBuffersStep(0.5f, 0.5f, LineCount(1)));
+    CHECK(grid.compactingTextBuffers());
+    CHECK(!grid.compactTextBuffersStep(0.5f, 0.5f, LineCount(1)));
+    CHECK(pool.stats().liveBuffers == 1);
+    CHECK(grid.compactTextBuffersStep(0.5f, 0.5f, LineCount(1)));
+    CHECK(!grid.compactingTextBuffers());
+    CHECK(pool.stats().liveBuffers == 0);
+    CHECK(grid.lineText(LineOffset(-2)) == "ABCD");
+    CHECK(grid.lineText(LineOffset(-1)) == "EFGH");
+
+    // Compacted text is not moved again while its buffer object is still being filled.
+    CHECK(grid.compactTextBuffersStep(0.5f, 0.5f, LineCount(10)));
+    CHECK(!grid.compactingTextBuffers());
+}
+
+TEST_CASE("Grid.marks", "[grid]")
+{
+    auto constexpr pageSize = PageSize { LineCount(3), ColumnCount(4) };
+    auto grid = Grid<Cell>(pageSize, true, LineCount(2));
+    grid.setMarked(LineOffset(0));
+    CHECK(grid.findMarkedLineAbove(LineOffset(2)) == LineOffset(0));
+    CHECK_FALSE(grid.findMarkedLineBelow(LineOffset(0), LineOffset(2)).has_value());
+
+    // Marks stay with their lines while scrolling up, ...
+    grid.scrollUp(LineCount(1));
+    grid.setMarked(LineOffset(2));
+    CHECK(grid.findMarkedLineAbove(LineOffset(2)) == LineOffset(-1));
+    CHECK(grid.findMarkedLineBelow(LineOffset(-1), LineOffset(2)) == LineOffset(2));
+
+    // ... while scrolling within the margins, ...
+    auto margin = fullPageMargin(pageSize);
+    margin.vertical = Margin::Vertical { LineOffset(1), LineOffset(2) };
+    grid.scrollUp(LineCount(1), GraphicsAttributes {}, margin);
+    CHECK(grid.findMarkedLineBelow(LineOffset(-1), LineOffset(2)) == LineOffset(1));
+
+    // ... and are gone along with the lines they are on.
+    grid.lineAt(LineOffset(1)).reset(grid.defaultLineFlags(), GraphicsAttributes {});
+    CHECK_FALSE(grid.findMarkedLineBelow(LineOffset(-1), LineOffset(2)).has_value());
+    grid.scrollUp(LineCount(2));
+    CHECK(grid.historyLineCount() == LineCount(2));
+    CHECK_FALSE(grid.findMarkedLineAbove(LineOffset(2)).has_value());
+}
+
+TEST_CASE("Grid.snapshot", "[grid]")
+{
+    auto grid = Grid<Cell>(PageSize { LineCount(2), ColumnCount(4) }, true, LineCount(5));
+    grid.setLineText(LineOffset(0), "ABCD");
+    grid.scrollUp(LineCount(1));
+    grid.setLineText(LineOffset(1), "EFGH");
+
+    auto const snapshot = grid.snapshot();
+    REQUIRE(snapshot.historyLineCount() == LineCount(1));
+    REQUIRE(snapshot.lines().size() == 3);
+    CHECK(snapshot.lineAt(LineOffset(-1)).toUtf8() == "ABCD");
+    CHECK(snapshot.lineAt(LineOffset(1)).toUtf8() == "EFGH");
+
+    // Modifying the grid does not affect the snapshot.
+    grid.setLineText(LineOffset(1), "IJKL");
+    grid.scrollUp(LineCount(1));
+    CHECK(grid.lineText(LineOffset(0)) == "IJKL");
+    CHECK(snapshot.lineAt(LineOffset(1)).toUtf8() == "EFGH");
+
+    auto const match =
+        searchReverse(snapshot, U"FG", CellLocation { LineOffset(1), ColumnOffset(3) }, LineCount(3));
+    CHECK(match == CellLocation { LineOffset(1), ColumnOffset(1) });
+}
+
 TEST_CASE("Grid infinite", "[grid]")
 {
     auto grid_finite = Grid<Cell>(PageSize { LineCount(2), ColumnCount(8) }, true, LineCount(0));
@@ -871,6 +1248,27 @@ TEST_CASE("Grid infinite", "[grid]")
     REQUIRE(grid_infinite.lineText(LineOffset(-98)) == "ABCDEFGH");
 }
 
+TEST_CASE("Grid.clearHistory.infinite", "[grid]")
+{
+    auto grid = Grid<Cell>(PageSize { LineCount(2), ColumnCount(8) }, true, Infinite());
+    grid.scrollUp(Grid<Cell>::BackgroundReleaseThreshold + LineCount(1));
+    grid.setLineText(LineOffset { 0 }, "ABCDEFGH"sv);
+    grid.setLineText(LineOffset { 1 }, "abcdefgh"sv);
+    REQUIRE(grid.historyLineCount() == Grid<Cell>::BackgroundReleaseThreshold + LineCount(1));
+
+    // The main page is kept, while the scrollback is released.
+    grid.clearHistory();
+    CHECK(grid.historyLineCount() == LineCount(0));
+    CHECK(grid.maxHistoryLineCount() == LineCount(0));
+    CHECK(grid.lineText(LineOffset(0)) == "ABCDEFGH");
+    CHECK(grid.lineText(LineOffset(1)) == "abcdefgh");
+
+    grid.scrollUp(LineCount { 1 });
+    CHECK(grid.historyLineCount() == LineCount(1));
+    CHECK(grid.lineText(LineOffset(-1)) == "ABCDEFGH");
+    CHECK(grid.lineText(LineOffset(0)) == "abcdefgh");
+}
+
 TEST_CASE("Grid resize with wrap", "[grid]")
 {
     auto grid = Grid<Cell>(PageSize { LineCount(3), ColumnCount(5) }, true, LineCount(0));
@@ -898,7 +1296,12 @@ TEST_CASE("Grid resize", "[grid]")
     bufferObject->writeAtEnd(text);
     auto const bufferFragment = bufferObject->ref(0, 4);
     auto const sgr = GraphicsAttributes {};
-    auto const trivial = TrivialLineBuffer { width, sgr, sgr, HyperlinkId {}, width, bufferFragment };
+    auto const trivial = TrivialLineBuffer { width,
+                                             interned(sgr),
+                                             interned(sgr),
+                                             HyperlinkId {},
+                                             width,
+                                             bufferFragment };
     auto line_trivial = Line<Cell>(LineFlags::None, trivial);
     grid.lineAt(LineOffset(0)) = line_trivial;
     REQUIRE(grid.lineAt(LineOffset(0)).isTrivialBuffer());
@@ -911,4 +1314,46 @@ TEST_CASE("Grid resize", "[grid]")
     REQUIRE(grid.lineAt(LineOffset(1)).isTrivialBuffer());
 }
 
+TEST_CASE("Grid resize with wrapped trivial lines", "[grid]")
+{
+    auto const width = ColumnCount(4);
+    auto grid = Grid<Cell>(PageSize { LineCount(2), width }, true, LineCount(5));
+    auto pool = crispy::BufferObjectPool<char>(32);
+    auto bufferObject = pool.allocateBufferObject();
+    bufferObject->writeAtEnd("abcdefgh"sv);
+    auto const sgr = GraphicsAttributes {};
+    grid.lineAt(LineOffset(0)) =
+        Line<Cell>(LineFlags::Wrappable,
+                   TrivialLineBuffer { width,
+                                       interned(sgr),
+                                       interned(sgr),
+                                       HyperlinkId {},
+                                       width,
+                                       bufferObject->ref(0, 4) });
+    grid.lineAt(LineOffset(1)) =
+        Line<Cell>(LineFlags::Wrappable | LineFlags::Wrapped,
+                   TrivialLineBuffer { width,
+                                       interned(sgr),
+                                       interned(sgr),
+                                       HyperlinkId {},
+                                       width,
+                                       bufferObject->ref(4, 4) });
+
+    // Growing joins the wrapped lines without inflating them.
+    (void) grid.resize(PageSize { LineCount(2), ColumnCount(8) }, CellLocation {}, false);
+    CHECK(grid.lineAt(LineOffset(0)).isTrivialBuffer());
+    CHECK(grid.lineText(LineOffset(0)) == "abcdefgh");
+    CHECK(!grid.lineAt(LineOffset(0)).wrapped());
+
+    // Shrinking splits them up again, still without inflating.
+    // The trailing empty line pushes the first half into the scrollback.
+    (void) grid.resize(PageSize { LineCount(2), width }, CellLocation {}, false);
+    REQUIRE(grid.historyLineCount() == LineCount(1));
+    CHECK(grid.lineAt(LineOffset(-1)).isTrivialBuffer());
+    CHECK(grid.lineAt(LineOffset(0)).isTrivialBuffer());
+    CHECK(grid.lineText(LineOffset(-1)) == "abcd");
+    CHECK(grid.lineText(LineOffset(0)) == "efgh");
+    CHECK(grid.lineAt(LineOffset(0)).wrapped());
+}
+
 // }}}
@@ -0,0 +1,81 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/HeadlessTerminal.h>
+#include <terminal/pty/MockPty.h>
+
+#include <memory>
+#include <utility>
+
+namespace terminal
+{
+
+HeadlessTerminal::HeadlessTerminal(): HeadlessTerminal(Settings {})
+{
+}
+
+HeadlessTerminal::HeadlessTerminal(Settings const& _settings):
+    terminal_ { std::make_unique<MockPty>(_settings.pageSize),
+                _settings.bufferObjectSize,
+                _settings.bufferObjectSize,
+                *this,
+                _settings.maxHistoryLineCount,
+                LineOffset(0),
+                std::chrono::milliseconds { 500 },
+                std::chrono::steady_clock::now(),
+                "",
+                Modifier::Shift,
+                ImageSize { Width(800), Height(600) },
+                256,
+                true,
+                _settings.colorPalette }
+{
+}
+
+void HeadlessTerminal::write(std::string_view _bytes)
+{
+    terminal_.writeToScreen(_bytes);
+}
+
+std::string HeadlessTerminal::takeReplies()
+{
+    auto& pty = static_cast<MockPty&>(terminal_.device());
+    return std::exchange(pty.stdinBuffer(), std::string {});
+}
+
+LineCount HeadlessTerminal::historyLineCount() const noexcept
+{
+    return terminal_.currentScreen().historyLineCount();
+}
+
+std::string HeadlessTerminal::lineText(LineOffset _line) const
+{
+    return terminal_.currentScreen().lineTextAt(_line);
+}
+
+std::string HeadlessTerminal::cellText(CellLocation _position) const
+{
+    return terminal_.currentScreen().cellTextAt(_position);
+}
+
+void HeadlessTerminal::exportTo(HistoryExportFormat _format, std::ostream& _output)
+{
+    auto const lines = snapshotLines(terminal_.primaryScreen().grid());
+    exportLines(gsl::span<Line<PrimaryScreenCell> const>(lines),
+                _format,
+                terminal_.colorPalette(),
+                _output,
+                1);
+}
+
+} // namespace terminal
@@ -0,0 +1,98 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <terminal/ColorPalette.h>
+#include <terminal/HistoryExport.h>
+#include <terminal/Terminal.h>
+#include <terminal/primitives.h>
+
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace terminal
+{
+
+/// Terminal emulation without a PTY, GUI, or threads of its own, for processing VT output in bulk,
+/// such as rendering build logs with escape sequences into plain text or HTML.
+///
+/// Any number of instances may exist in a process. Each one is driven by its caller only,
+/// so it may be used from any thread, but by one thread at a time.
+class HeadlessTerminal: private Terminal::Events
+{
+  public:
+    struct Settings
+    {
+        PageSize pageSize { LineCount(25), ColumnCount(80) };
+        MaxHistoryLineCount maxHistoryLineCount = LineCount(1000);
+        ColorPalette colorPalette {};
+
+        /// Size of the buffer objects the written bytes are kept in while lines refer to them.
+        /// Small buffers keep the footprint of many short-lived instances low.
+        size_t bufferObjectSize = 64 * 1024;
+    };
+
+    HeadlessTerminal();
+    explicit HeadlessTerminal(Settings const& _settings);
+
+    HeadlessTerminal(HeadlessTerminal const&) = delete;
+    HeadlessTerminal& operator=(HeadlessTerminal const&) = delete;
+
+    /// Processes the given bytes as if the application had written them to the terminal.
+    ///
+    /// Sequences may be split at any byte across consecutive calls.
+    void write(std::string_view _bytes);
+
+    /// @returns the bytes the terminal replied to the application, such as status reports,
+    ///          and clears them.
+    [[nodiscard]] std::string takeReplies();
+
+    [[nodiscard]] PageSize pageSize() const noexcept { return terminal_.pageSize(); }
+    [[nodiscard]] LineCount historyLineCount() const noexcept;
+    [[nodiscard]] CellLocation cursorPosition() const noexcept { return terminal_.realCursorPosition(); }
+    [[nodiscard]] std::string const& windowTitle() const noexcept { return windowTitle_; }
+
+    /// @returns the text of the given line of the current screen without surrounding whitespace,
+    ///          with negative offsets referring to the history.
+    [[nodiscard]] std::string lineText(LineOffset _line) const;
+
+    /// @returns the text of the given cell of the current screen.
+    [[nodiscard]] std::string cellText(CellLocation _position) const;
+
+    /// Writes the history and main page of the primary screen in the given format,
+    /// serialized on the calling thread.
+    void exportTo(HistoryExportFormat _format, std::ostream& _output);
+
+    /// Hands each line that leaves the history of the primary screen to the given handler,
+    /// such that input larger than the history can be processed in full.
+    void setEvictedLineHandler(Grid<PrimaryScreenCell>::EvictedLineHandler _handler)
+    {
+        terminal_.primaryScreen().grid().setEvictedLineHandler(std::move(_handler));
+    }
+
+    /// Provides the emulation for anything not covered above.
+    [[nodiscard]] Terminal& terminal() noexcept { return terminal_; }
+    [[nodiscard]] Terminal const& terminal() const noexcept { return terminal_; }
+
+  private:
+    // Events overrides
+    void setWindowTitle(std::string_view _title) override { windowTitle_ = _title; }
+
+    std::string windowTitle_;
+    Terminal terminal_;
+};
+
+} // namespace terminal
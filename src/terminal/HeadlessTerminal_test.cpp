@@ -0,0 +1,95 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/HeadlessTerminal.h>
+
+#include <catch2/catch.hpp>
+
+#include <sstream>
+#include <string>
+
+using namespace terminal;
+using namespace std::string_literals;
+
+namespace
+{
+HeadlessTerminal::Settings smallSettings()
+{
+    auto settings = HeadlessTerminal::Settings {};
+    settings.pageSize = PageSize { LineCount(2), ColumnCount(5) };
+    settings.maxHistoryLineCount = LineCount(10);
+    return settings;
+}
+} // namespace
+
+TEST_CASE("HeadlessTerminal.write", "[headless]")
+{
+    auto vt = HeadlessTerminal(smallSettings());
+
+    // Sequences may be split across writes.
+    vt.write("\033[3");
+    vt.write("1mAB\033[mC\r\n");
+    vt.write("DE\r\nFG");
+
+    CHECK(vt.historyLineCount() == LineCount(1));
+    CHECK(vt.lineText(LineOffset(-1)) == "ABC");
+    CHECK(vt.lineText(LineOffset(0)) == "DE");
+    CHECK(vt.lineText(LineOffset(1)) == "FG");
+    CHECK(vt.cellText(CellLocation { LineOffset(1), ColumnOffset(1) }) == "G");
+    CHECK(vt.cursorPosition() == CellLocation { LineOffset(1), ColumnOffset(2) });
+}
+
+TEST_CASE("HeadlessTerminal.replies", "[headless]")
+{
+    auto vt = HeadlessTerminal(smallSettings());
+    vt.write("\033]2;Build\033\\AB\033[6n");
+
+    CHECK(vt.windowTitle() == "Build");
+    CHECK(vt.takeReplies() == "\033[1;3R");
+    CHECK(vt.takeReplies().empty());
+}
+
+TEST_CASE("HeadlessTerminal.exportTo", "[headless]")
+{
+    auto vt = HeadlessTerminal(smallSettings());
+    vt.write("one\r\ntwo\r\nthree");
+
+    auto output = std::ostringstream {};
+    vt.exportTo(HistoryExportFormat::Text, output);
+    CHECK(output.str() == "one\ntwo\nthree\n");
+}
+
+TEST_CASE("HeadlessTerminal.independent_instances", "[headless]")
+{
+    auto a = HeadlessTerminal(smallSettings());
+    auto b = HeadlessTerminal(smallSettings());
+    a.write("A");
+    b.write("B");
+    CHECK(a.lineText(LineOffset(0)) == "A");
+    CHECK(b.lineText(LineOffset(0)) == "B");
+}
+
+TEST_CASE("HeadlessTerminal.evicted_lines", "[headless]")
+{
+    auto settings = smallSettings();
+    settings.maxHistoryLineCount = LineCount(1);
+    auto vt = HeadlessTerminal(settings);
+
+    auto evicted = std::string {};
+    vt.setEvictedLineHandler(
+        [&](Line<PrimaryScreenCell> const& line) { evicted += line.toUtf8Trimmed() + ";"; });
+    vt.write("1\r\n2\r\n3\r\n4\r\n5");
+
+    CHECK(evicted == "1;2;");
+    CHECK(vt.lineText(LineOffset(-1)) == "3");
+}
@@ -0,0 +1,417 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/CellUtil.h>
+#include <terminal/HistoryExport.h>
+#include <terminal/VTWriter.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <future>
+#include <string>
+#include <thread>
+
+using std::nullopt;
+using std::optional;
+using std::string;
+using std::string_view;
+using std::vector;
+
+namespace terminal
+{
+
+namespace
+{
+    // Number of lines serialized by a single worker at a time.
+    auto constexpr RangeLineCount = size_t { 4096 };
+
+    // {{{ text
+    template <typename Cell>
+    void appendText(Line<Cell> const& _line, string& _output)
+    {
+        if (_line.isTrivialBuffer())
+        {
+            auto const& buffer = _line.trivialBuffer();
+            _output += buffer.text.view();
+            _output.append(unbox<size_t>(buffer.displayWidth - buffer.usedColumns), ' ');
+            return;
+        }
+
+        auto const& cells = _line.inflatedBuffer();
+        for (size_t i = 0; i < cells.size();)
+        {
+            auto const& cell = cells[i];
+            if (cell.codepointCount() == 0)
+            {
+                _output += ' ';
+                ++i;
+            }
+            else
+            {
+                // The columns covered by a wide character are not written separately.
+                _output += cell.toUtf8();
+                i += std::max(size_t { 1 }, static_cast<size_t>(cell.width()));
+            }
+        }
+    }
+
+    void trimRight(string& _output, size_t _lineStart)
+    {
+        auto const end = _output.find_last_not_of(' ');
+        _output.resize(end == string::npos || end < _lineStart ? _lineStart : end + 1);
+    }
+    // }}}
+
+    // {{{ HTML
+    struct HtmlStyle
+    {
+        RGBColorPair colors;
+        CellFlags flags;
+
+        bool operator==(HtmlStyle const& _other) const noexcept
+        {
+            return colors.foreground == _other.colors.foreground
+                   && colors.background == _other.colors.background && flags == _other.flags;
+        }
+        bool operator!=(HtmlStyle const& _other) const noexcept { return !(*this == _other); }
+    };
+
+    HtmlStyle makeHtmlStyle(ColorPalette const& _colorPalette, GraphicsAttributes const& _attributes)
+    {
+        auto const colors = CellUtil::makeColors(_colorPalette,
+                                                 _attributes.flags,
+                                                 false,
+                                                 _attributes.foregroundColor,
+                                                 _attributes.backgroundColor,
+                                                 true,
+                                                 true);
+        return HtmlStyle { colors, _attributes.flags };
+    }
+
+    template <typename Cell>
+    HtmlStyle makeHtmlStyle(ColorPalette const& _colorPalette, Cell const& _cell)
+    {
+        return makeHtmlStyle(_colorPalette,
+                             GraphicsAttributes { _cell.foregroundColor(),
+                                                  _cell.backgroundColor(),
+                                                  _cell.underlineColor(),
+                                                  _cell.flags() });
+    }
+
+    void appendStyleOpening(ColorPalette const& _colorPalette, HtmlStyle const& _style, string& _output)
+    {
+        auto style = string {};
+        if (_style.colors.foreground != _colorPalette.defaultForeground)
+            style += fmt::format("color:{};", to_string(_style.colors.foreground));
+        if (_style.colors.background != _colorPalette.defaultBackground)
+            style += fmt::format("background-color:{};", to_string(_style.colors.background));
+        if (_style.flags & CellFlags::Bold)
+            style += "font-weight:bold;";
+        if (_style.flags & CellFlags::Italic)
+            style += "font-style:italic;";
+        if (_style.flags
+            & (CellFlags::Underline | CellFlags::DoublyUnderlined | CellFlags::CurlyUnderlined
+               | CellFlags::DottedUnderline | CellFlags::DashedUnderline))
+            style += "text-decoration:underline;";
+        else if (_style.flags & CellFlags::CrossedOut)
+            style += "text-decoration:line-through;";
+
+        _output += style.empty() ? "<span>" : fmt::format("<span style=\"{}\">", style);
+    }
+
+    void appendEscaped(string_view _text, string& _output)
+    {
+        for (auto const ch: _text)
+        {
+            switch (ch)
+            {
+                case '&': _output += "&amp;"; break;
+                case '<': _output += "&lt;"; break;
+                case '>': _output += "&gt;"; break;
+                case '"': _output += "&quot;"; break;
+                default: _output += ch; break;
+            }
+        }
+    }
+
+    /// Appends the given line as sequence of spans, each covering the cells sharing the same style.
+    template <typename Cell>
+    void appendHtml(Line<Cell> const& _line,
+                    bool _continued,
+                    ColorPalette const& _colorPalette,
+                    string& _output)
+    {
+        if (_line.isTrivialBuffer())
+        {
+            auto const& buffer = _line.trivialBuffer();
+            auto text = string(buffer.text.view());
+            if (_continued)
+                text.append(unbox<size_t>(buffer.displayWidth - buffer.usedColumns), ' ');
+            else
+                trimRight(text, 0);
+            if (text.empty())
+                return;
+            appendStyleOpening(_colorPalette, makeHtmlStyle(_colorPalette, buffer.textAttributes.get()), _output);
+            appendEscaped(text, _output);
+            _output += "</span>";
+            return;
+        }
+
+        auto const& cells = _line.inflatedBuffer();
+        auto end = cells.size();
+        if (!_continued)
+            while (end != 0 && cells[end - 1].empty())
+                --end;
+
+        auto currentStyle = optional<HtmlStyle> {};
+        for (size_t i = 0; i < end;)
+        {
+            auto const& cell = cells[i];
+            if (auto const style = makeHtmlStyle(_colorPalette, cell); style != currentStyle)
+            {
+                if (currentStyle)
+                    _output += "</span>";
+                appendStyleOpening(_colorPalette, style, _output);
+                currentStyle = style;
+            }
+
+            if (cell.codepointCount() == 0)
+            {
+                _output += ' ';
+                ++i;
+            }
+            else
+            {
+                appendEscaped(cell.toUtf8(), _output);
+                i += std::max(size_t { 1 }, static_cast<size_t>(cell.width()));
+            }
+        }
+        if (currentStyle)
+            _output += "</span>";
+    }
+    // }}}
+
+    template <typename Cell>
+    void appendLine(Line<Cell> const& _line,
+                    bool _continued,
+                    HistoryExportFormat _format,
+                    ColorPalette const& _colorPalette,
+                    string& _output)
+    {
+        if (_format == HistoryExportFormat::HTML)
+            appendHtml(_line, _continued, _colorPalette, _output);
+        else
+        {
+            auto const lineStart = _output.size();
+            appendText(_line, _output);
+            if (!_continued)
+                trimRight(_output, lineStart);
+        }
+        if (!_continued)
+            _output += '\n';
+    }
+
+    template <typename Cell>
+    string serializeRange(gsl::span<Line<Cell> const> _lines,
+                          size_t _begin,
+                          size_t _end,
+                          HistoryExportFormat _format,
+                          ColorPalette const& _colorPalette)
+    {
+        auto output = string {};
+
+        if (_format == HistoryExportFormat::VT)
+        {
+            auto writer = VTWriter([&](char const* _data, size_t _size) { output.append(_data, _size); });
+            for (auto i = _begin; i < _end; ++i)
+            {
+                writer.write(_lines[i]);
+                writer.crlf();
+            }
+            writer.flush();
+            return output;
+        }
+
+        for (auto i = _begin; i < _end; ++i)
+        {
+            // Lines that are continued by the next (wrapped) line are joined with it.
+            auto const continued = i + 1 < _lines.size() && _lines[i + 1].wrapped();
+            appendLine(_lines[i], continued, _format, _colorPalette, output);
+        }
+        return output;
+    }
+
+    void writeHeader(HistoryExportFormat _format, ColorPalette const& _colorPalette, std::ostream& _output)
+    {
+        if (_format == HistoryExportFormat::HTML)
+            _output << fmt::format("<!DOCTYPE html>\n<html>\n<head>\n<meta charset=\"utf-8\">\n"
+                                   "<title>Scrollback</title>\n</head>\n"
+                                   "<body style=\"color:{};background-color:{};\">\n<pre>",
+                                   to_string(_colorPalette.defaultForeground),
+                                   to_string(_colorPalette.defaultBackground));
+    }
+
+    void writeFooter(HistoryExportFormat _format, std::ostream& _output)
+    {
+        if (_format == HistoryExportFormat::HTML)
+            _output << "</pre>\n</body>\n</html>\n";
+    }
+} // namespace
+
+optional<HistoryExportFormat> parseHistoryExportFormat(string_view _name) noexcept
+{
+    if (_name == "text")
+        return HistoryExportFormat::Text;
+    if (_name == "vt")
+        return HistoryExportFormat::VT;
+    if (_name == "html")
+        return HistoryExportFormat::HTML;
+    return nullopt;
+}
+
+string_view fileExtension(HistoryExportFormat _format) noexcept
+{
+    switch (_format)
+    {
+        case HistoryExportFormat::Text: return "txt";
+        case HistoryExportFormat::VT: return "vt";
+        case HistoryExportFormat::HTML: return "html";
+    }
+    return "txt";
+}
+
+template <typename Cell>
+vector<Line<Cell>> snapshotLines(Grid<Cell>& _grid)
+{
+    return std::move(_grid.snapshot().lines());
+}
+
+template <typename Cell>
+void exportLines(gsl::span<Line<Cell> const> _lines,
+                 HistoryExportFormat _format,
+                 ColorPalette const& _colorPalette,
+                 std::ostream& _output,
+                 size_t _workerCount)
+{
+    writeHeader(_format, _colorPalette, _output);
+
+    auto const workerCount =
+        _workerCount ? _workerCount : size_t { std::max(1u, std::thread::hardware_concurrency()) };
+    auto const launchPolicy = workerCount > 1 ? std::launch::async : std::launch::deferred;
+    auto const batchLineCount = RangeLineCount * workerCount;
+
+    for (size_t batch = 0; batch < _lines.size(); batch += batchLineCount)
+    {
+        auto const batchEnd = std::min(batch + batchLineCount, _lines.size());
+
+        auto ranges = vector<std::future<string>> {};
+        for (auto begin = batch; begin < batchEnd; begin += RangeLineCount)
+        {
+            auto const end = std::min(begin + RangeLineCount, batchEnd);
+            ranges.emplace_back(std::async(launchPolicy, [=, &_colorPalette]() {
+                return serializeRange(_lines, begin, end, _format, _colorPalette);
+            }));
+        }
+
+        for (auto& range: ranges)
+        {
+            auto const text = range.get();
+            _output.write(text.data(), static_cast<std::streamsize>(text.size()));
+        }
+    }
+
+    writeFooter(_format, _output);
+}
+
+// {{{ LineExporter
+// Number of bytes collected before they are written to the output stream.
+constexpr auto LineExporterBufferSize = size_t { 64 * 1024 };
+
+template <typename Cell>
+LineExporter<Cell>::LineExporter(HistoryExportFormat _format,
+                                 ColorPalette const& _colorPalette,
+                                 std::ostream& _output):
+    format_ { _format }, colorPalette_ { _colorPalette }, output_ { _output }
+{
+    if (format_ == HistoryExportFormat::VT)
+        vtWriter_ = std::make_unique<VTWriter>(output_);
+    writeHeader(format_, colorPalette_, output_);
+}
+
+template <typename Cell>
+LineExporter<Cell>::~LineExporter() = default;
+
+template <typename Cell>
+void LineExporter<Cell>::write(Line<Cell> const& _line)
+{
+    if (vtWriter_)
+    {
+        vtWriter_->write(_line);
+        vtWriter_->crlf();
+        return;
+    }
+
+    if (pending_)
+        writePending(_line.wrapped());
+    pending_ = _line;
+}
+
+template <typename Cell>
+void LineExporter<Cell>::writePending(bool _continued)
+{
+    appendLine(*pending_, _continued, format_, colorPalette_, buffer_);
+    if (buffer_.size() >= LineExporterBufferSize)
+    {
+        output_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+        buffer_.clear();
+    }
+}
+
+template <typename Cell>
+void LineExporter<Cell>::finish()
+{
+    if (vtWriter_)
+        vtWriter_->flush();
+    if (pending_)
+    {
+        writePending(false);
+        pending_.reset();
+    }
+    output_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+    buffer_.clear();
+    writeFooter(format_, output_);
+}
+// }}}
+
+} // namespace terminal
+
+#include <terminal/cell/CompactCell.h>
+template std::vector<terminal::Line<terminal::CompactCell>> terminal::snapshotLines<terminal::CompactCell>(
+    Grid<CompactCell>&);
+template void terminal::exportLines<terminal::CompactCell>(gsl::span<Line<CompactCell> const>,
+                                                           HistoryExportFormat,
+                                                           ColorPalette const&,
+                                                           std::ostream&,
+                                                           size_t);
+template class terminal::LineExporter<terminal::CompactCell>;
+
+#include <terminal/cell/SimpleCell.h>
+template std::vector<terminal::Line<terminal::SimpleCell>> terminal::snapshotLines<terminal::SimpleCell>(
+    Grid<SimpleCell>&);
+template void terminal::exportLines<terminal::SimpleCell>(gsl::span<Line<SimpleCell> const>,
+                                                          HistoryExportFormat,
+                                                          ColorPalette const&,
+                                                          std::ostream&,
+                                                          size_t);
+template class terminal::LineExporter<terminal::SimpleCell>;
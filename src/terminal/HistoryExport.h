@@ -0,0 +1,107 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <terminal/ColorPalette.h>
+#include <terminal/Grid.h>
+#include <terminal/Line.h>
+
+#include <gsl/span>
+
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace terminal
+{
+
+class VTWriter;
+
+enum class HistoryExportFormat
+{
+    Text,
+    VT,
+    HTML,
+};
+
+/// Parses the given format name, which is one of "text", "vt", or "html".
+std::optional<HistoryExportFormat> parseHistoryExportFormat(std::string_view _name) noexcept;
+
+/// Returns the file name extension (without the leading dot) commonly used for the given format.
+std::string_view fileExtension(HistoryExportFormat _format) noexcept;
+
+/// Copies the history and main page lines of the given grid, oldest line first.
+///
+/// The copy serves as snapshot that can be exported without keeping the terminal locked.
+///
+/// @see Grid::snapshot()
+template <typename Cell>
+std::vector<Line<Cell>> snapshotLines(Grid<Cell>& _grid);
+
+/**
+ * Writes the given lines to @p _output in the given format.
+ *
+ * The lines are split into ranges that are serialized concurrently, each into its own buffer,
+ * which are then written in order. Only a bounded number of ranges is serialized at a time,
+ * such that the memory overhead does not grow with the number of lines.
+ *
+ * Plain text and HTML join wrapped lines into their logical lines, whereas VT keeps the line breaks.
+ * Colors in HTML are resolved against @p _colorPalette.
+ *
+ * At most @p _workerCount ranges are serialized at a time, defaulting to the number of CPU cores if 0.
+ * With a single worker, all ranges are serialized on the calling thread.
+ */
+template <typename Cell>
+void exportLines(gsl::span<Line<Cell> const> _lines,
+                 HistoryExportFormat _format,
+                 ColorPalette const& _colorPalette,
+                 std::ostream& _output,
+                 size_t _workerCount = 0);
+
+/**
+ * Writes lines one by one in the given format, such as lines evicted from the scrollback,
+ * such that the output does not require all lines to be kept in memory at once.
+ *
+ * The output is the same as of exportLines() for all lines written.
+ */
+template <typename Cell>
+class LineExporter
+{
+  public:
+    LineExporter(HistoryExportFormat _format, ColorPalette const& _colorPalette, std::ostream& _output);
+    ~LineExporter();
+
+    LineExporter(LineExporter const&) = delete;
+    LineExporter& operator=(LineExporter const&) = delete;
+
+    void write(Line<Cell> const& _line);
+
+    /// Writes the remaining output. No lines must be written afterwards.
+    void finish();
+
+  private:
+    void writePending(bool _continued);
+
+    HistoryExportFormat format_;
+    ColorPalette const& colorPalette_;
+    std::ostream& output_;
+    std::unique_ptr<VTWriter> vtWriter_;
+    std::optional<Line<Cell>> pending_; // whether a line is continued is only known with the next line
+    std::string buffer_;
+};
+
+} // namespace terminal
@@ -0,0 +1,136 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/HistoryExport.h>
+#include <terminal/cell/CellConfig.h>
+
+#include <fmt/format.h>
+
+#include <catch2/catch.hpp>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace terminal;
+using namespace std::string_literals;
+using namespace std::string_view_literals;
+using std::string;
+using std::string_view;
+using std::vector;
+
+// Default cell type for testing.
+using Cell = PrimaryScreenCell;
+
+namespace
+{
+Line<Cell> makeLine(string_view _text, LineFlags _flags = LineFlags::None)
+{
+    auto line = Line<Cell>(_flags, Line<Cell>::InflatedBuffer(5, Cell {}));
+    line.fill(ColumnOffset(0), GraphicsAttributes {}, _text);
+    return line;
+}
+
+string exportToString(vector<Line<Cell>> const& _lines, HistoryExportFormat _format)
+{
+    auto output = std::ostringstream {};
+    exportLines(gsl::span<Line<Cell> const>(_lines), _format, ColorPalette {}, output);
+    return output.str();
+}
+} // namespace
+
+TEST_CASE("HistoryExport.parseFormat", "[export]")
+{
+    CHECK(parseHistoryExportFormat("text") == HistoryExportFormat::Text);
+    CHECK(parseHistoryExportFormat("vt") == HistoryExportFormat::VT);
+    CHECK(parseHistoryExportFormat("html") == HistoryExportFormat::HTML);
+    CHECK_FALSE(parseHistoryExportFormat("pdf").has_value());
+}
+
+TEST_CASE("HistoryExport.text", "[export]")
+{
+    auto const lines = vector { makeLine("ABC"), makeLine(""), makeLine("D E") };
+    CHECK(exportToString(lines, HistoryExportFormat::Text) == "ABC\n\nD E\n");
+}
+
+TEST_CASE("HistoryExport.text.trivial", "[export]")
+{
+    auto pool = crispy::BufferObjectPool<char>(4096);
+    auto bufferObject = pool.allocateBufferObject();
+    bufferObject->writeAtEnd("AB"sv);
+    auto const sgr = InternedGraphicsAttributes {};
+    auto const trivialLine = Line<Cell>(
+        LineFlags::None,
+        TrivialLineBuffer {
+            ColumnCount(5), sgr, sgr, HyperlinkId {}, ColumnCount(2), bufferObject->ref(0, 2) });
+
+    auto const lines = vector { trivialLine, makeLine("CD") };
+    CHECK(exportToString(lines, HistoryExportFormat::Text) == "AB\nCD\n");
+    CHECK(lines[0].isTrivialBuffer());
+}
+
+TEST_CASE("HistoryExport.text.wrapped", "[export]")
+{
+    auto const lines = vector { makeLine("ABCDE"), makeLine("FG", LineFlags::Wrapped), makeLine("HI") };
+    CHECK(exportToString(lines, HistoryExportFormat::Text) == "ABCDEFG\nHI\n");
+}
+
+TEST_CASE("HistoryExport.text.concurrent", "[export]")
+{
+    // Spans multiple ranges, which must be written in order.
+    auto lines = vector<Line<Cell>> {};
+    auto expected = string {};
+    for (int i = 0; i < 20000; ++i)
+    {
+        lines.emplace_back(makeLine(fmt::format("{:05}", i)));
+        expected += fmt::format("{:05}\n", i);
+    }
+    CHECK(exportToString(lines, HistoryExportFormat::Text) == expected);
+}
+
+TEST_CASE("HistoryExport.html", "[export]")
+{
+    auto const lines = vector { makeLine("<a&b>") };
+    auto const html = exportToString(lines, HistoryExportFormat::HTML);
+    INFO(html);
+    CHECK(html.find("<pre><span>&lt;a&amp;b&gt;</span>\n</pre>") != string::npos);
+}
+
+TEST_CASE("HistoryExport.snapshotLines", "[export]")
+{
+    auto grid = Grid<Cell>(PageSize { LineCount(2), ColumnCount(5) }, true, LineCount(5));
+    grid.setLineText(LineOffset(0), "ABC");
+    grid.setLineText(LineOffset(1), "DEF");
+    grid.scrollUp(LineCount(1));
+    grid.setLineText(LineOffset(1), "GHI");
+
+    auto const lines = snapshotLines(grid);
+    REQUIRE(lines.size() == 3);
+    CHECK(exportToString(lines, HistoryExportFormat::Text) == "ABC\nDEF\nGHI\n");
+}
+
+TEST_CASE("HistoryExport.LineExporter", "[export]")
+{
+    auto const lines = vector { makeLine("ABCDE"), makeLine("FG", LineFlags::Wrapped), makeLine("H<I") };
+
+    for (auto const format: { HistoryExportFormat::Text, HistoryExportFormat::VT, HistoryExportFormat::HTML })
+    {
+        auto const colorPalette = ColorPalette {};
+        auto output = std::ostringstream {};
+        auto exporter = LineExporter<Cell>(format, colorPalette, output);
+        for (auto const& line: lines)
+            exporter.write(line);
+        exporter.finish();
+        CHECK(output.str() == exportToString(lines, format));
+    }
+}
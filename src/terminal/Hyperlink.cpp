@@ -0,0 +1,290 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/Hyperlink.h>
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+
+using std::string;
+
+namespace terminal
+{
+
+namespace
+{
+    template <typename Char>
+    constexpr Char WwwPrefix[] = { 'w', 'w', 'w', '.' };
+
+    template <typename Char>
+    constexpr bool isAlpha(Char _ch) noexcept
+    {
+        return (_ch >= 'a' && _ch <= 'z') || (_ch >= 'A' && _ch <= 'Z');
+    }
+
+    template <typename Char>
+    constexpr bool isSchemeChar(Char _ch) noexcept
+    {
+        return isAlpha(_ch) || (_ch >= '0' && _ch <= '9') || _ch == '+' || _ch == '-' || _ch == '.';
+    }
+
+    template <typename Char>
+    constexpr bool isUrlChar(Char _ch) noexcept
+    {
+        auto const ch = static_cast<char32_t>(static_cast<std::make_unsigned_t<Char>>(_ch));
+        if (ch > 0x7F)
+            return true;
+        if (ch <= 0x20 || ch == 0x7F)
+            return false;
+        switch (ch)
+        {
+            case '"':
+            case '\'':
+            case '`':
+            case '<':
+            case '>': return false;
+            default: return true;
+        }
+    }
+
+    template <typename Char>
+    constexpr bool isTrailingPunctuation(Char _ch) noexcept
+    {
+        switch (_ch)
+        {
+            case '.':
+            case ',':
+            case ':':
+            case ';':
+            case '!':
+            case '?': return true;
+            default: return false;
+        }
+    }
+
+    /// @returns the end of the URL within [_start, _end), without any trailing punctuation
+    ///          or closing brackets that have not been opened within the URL.
+    template <typename Char>
+    size_t trimUrl(std::basic_string_view<Char> _text, size_t _start, size_t _end) noexcept
+    {
+        auto const unbalanced = [&](Char _open, Char _close) {
+            auto const url = _text.substr(_start, _end - _start);
+            return std::count(url.begin(), url.end(), _close) > std::count(url.begin(), url.end(), _open);
+        };
+
+        while (_end > _start)
+        {
+            auto const last = _text[_end - 1];
+            if (isTrailingPunctuation(last) || (last == ')' && unbalanced('(', ')'))
+                || (last == ']' && unbalanced('[', ']')) || (last == '}' && unbalanced('{', '}')))
+                --_end;
+            else
+                break;
+        }
+        return _end;
+    }
+
+    template <typename Char>
+    void findUrls(std::basic_string_view<Char> _text, std::vector<PlainTextUrl>& _output)
+    {
+        auto constexpr npos = std::basic_string_view<Char>::npos;
+        auto const www = std::basic_string_view<Char>(WwwPrefix<Char>, std::size(WwwPrefix<Char>));
+
+        // Scanning for the colon and the prefix first keeps lines without URLs cheap,
+        // as finding a character in a string of bytes boils down to memchr().
+        auto nextSeparator = [&](size_t _pos) {
+            for (auto i = _text.find(Char(':'), _pos); i != npos; i = _text.find(Char(':'), i + 1))
+                if (i + 2 < _text.size() && _text[i + 1] == '/' && _text[i + 2] == '/')
+                    return i;
+            return npos;
+        };
+
+        auto pos = size_t { 0 };
+        auto separator = nextSeparator(0);
+        auto prefix = _text.find(www);
+        while (separator != npos || prefix != npos)
+        {
+            auto start = size_t { 0 };
+            auto bodyStart = size_t { 0 };
+            if (separator < prefix)
+            {
+                start = separator;
+                while (start > pos && isSchemeChar(_text[start - 1]))
+                    --start;
+                while (start < separator && !isAlpha(_text[start]))
+                    ++start;
+                bodyStart = separator + 3;
+            }
+            else
+            {
+                start = prefix;
+                bodyStart = prefix + www.size();
+                if (start > pos && isSchemeChar(_text[start - 1]))
+                    start = npos; // in the middle of a word, such as "awww."
+            }
+
+            auto end = bodyStart;
+            while (end < _text.size() && isUrlChar(_text[end]))
+                ++end;
+
+            if (start != npos && start != separator)
+            {
+                end = trimUrl(_text, start, end);
+                if (end > bodyStart)
+                    _output.emplace_back(PlainTextUrl { start, end - start });
+            }
+
+            pos = std::max(end, bodyStart);
+            if (separator != npos && separator < pos)
+                separator = nextSeparator(pos);
+            if (prefix != npos && prefix < pos)
+                prefix = _text.find(www, pos);
+        }
+    }
+} // namespace
+
+void findPlainTextUrls(std::string_view _text, std::vector<PlainTextUrl>& _output)
+{
+    findUrls(_text, _output);
+}
+
+void findPlainTextUrls(std::u32string_view _text, std::vector<PlainTextUrl>& _output)
+{
+    findUrls(_text, _output);
+}
+
+HyperlinkId HyperlinkStorage::intern(string _userId, URI _uri)
+{
+    auto key = string {};
+    key.reserve(_userId.size() + 1 + _uri.size());
+    key += _userId;
+    key += '\0';
+    key += _uri;
+
+    if (auto const i = ids_.find(key); i != ids_.end())
+    {
+        ++stats_.hits;
+        return i->second;
+    }
+    ++stats_.misses;
+
+    auto id = HyperlinkId {};
+    if (!freeIds_.empty())
+    {
+        id = freeIds_.back();
+        freeIds_.pop_back();
+    }
+    else if (entries_.size() <= std::numeric_limits<HyperlinkId::inner_type>::max())
+    {
+        id = HyperlinkId::cast_from(entries_.size());
+        entries_.emplace_back();
+    }
+    else
+        return HyperlinkId {};
+
+    auto& entry = entries_[unbox<size_t>(id)];
+    entry.info = HyperlinkInfo { std::move(_userId), std::move(_uri) };
+    entry.used = true;
+    ids_.emplace(std::move(key), id);
+    return id;
+}
+
+void HyperlinkStorage::releaseUnreferenced(std::vector<bool> const& _referenced)
+{
+    for (auto i = ids_.begin(); i != ids_.end();)
+    {
+        auto const index = unbox<size_t>(i->second);
+        if (index < _referenced.size() && _referenced[index])
+        {
+            ++i;
+            continue;
+        }
+
+        auto& entry = entries_[index];
+        entry.info = HyperlinkInfo {};
+        entry.used = false;
+        freeIds_.push_back(i->second);
+        i = ids_.erase(i);
+        ++stats_.recycles;
+    }
+
+    // Looks again only once as many hyperlinks have been added as are still referenced,
+    // such that the cost of looking is amortized over the hyperlinks added meanwhile.
+    collectionThreshold_ = std::max(InitialCollectionThreshold, size() * 2);
+}
+
+size_t HyperlinkStorage::memoryUsage() const noexcept
+{
+    auto bytes = entries_.size() * sizeof(Entry) + freeIds_.capacity() * sizeof(HyperlinkId)
+                 + ids_.bucket_count() * sizeof(void*);
+    for (auto const& [key, id]: ids_)
+    {
+        auto const& info = entries_[unbox<size_t>(id)].info;
+        // The key and its node, and the strings of the entry.
+        bytes += sizeof(*ids_.begin()) + 2 * sizeof(void*) + key.capacity() + info.userId.capacity()
+                 + info.uri.capacity();
+    }
+    return bytes;
+}
+
+void HyperlinkSpans::reset(LineCount _lines)
+{
+    // Keeps the spans' storage of each line for the next refresh.
+    lines_.resize(unbox<size_t>(_lines));
+    for (auto& spans: lines_)
+        spans.clear();
+}
+
+void HyperlinkSpans::add(LineOffset _line, ColumnOffset _start, ColumnOffset _end, HyperlinkId _id)
+{
+    if (!_id || _start >= _end || _line < LineOffset(0) || unbox<size_t>(_line) >= lines_.size())
+        return;
+
+    auto& spans = lines_[unbox<size_t>(_line)];
+    assert(spans.empty() || spans.back().end <= _start);
+    if (!spans.empty() && spans.back().end == _start && spans.back().id == _id)
+        spans.back().end = _end;
+    else
+        spans.emplace_back(HyperlinkSpan { _start, _end, _id });
+}
+
+HyperlinkId HyperlinkSpans::at(CellLocation _position) const noexcept
+{
+    if (_position.line < LineOffset(0) || unbox<size_t>(_position.line) >= lines_.size())
+        return {};
+
+    auto const& spans = lines_[unbox<size_t>(_position.line)];
+    auto const i = std::upper_bound(spans.begin(),
+                                    spans.end(),
+                                    _position.column,
+                                    [](ColumnOffset _column, HyperlinkSpan const& _span) {
+                                        return _column < _span.start;
+                                    });
+    if (i == spans.begin() || _position.column >= std::prev(i)->end)
+        return {};
+    return std::prev(i)->id;
+}
+
+bool HyperlinkSpans::contains(LineOffset _line, HyperlinkId _id) const noexcept
+{
+    if (!_id || _line < LineOffset(0) || unbox<size_t>(_line) >= lines_.size())
+        return false;
+
+    auto const& spans = lines_[unbox<size_t>(_line)];
+    return std::any_of(spans.begin(), spans.end(), [&](auto const& _span) { return _span.id == _id; });
+}
+
+} // namespace terminal
@@ -13,13 +13,18 @@
  */
 #pragma once
 
-#include <crispy/LRUCache.h>
+#include <terminal/primitives.h>
+
+#include <crispy/StrongLRUHashtable.h>
 #include <crispy/boxed.h>
 
-#include <list>
-#include <memory>
+#include <cstddef>
+#include <deque>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace terminal
 {
@@ -83,41 +88,119 @@ using HyperlinkId = crispy::boxed<uint16_t, detail::HyperlinkTag>;
 
 bool is_local(HyperlinkInfo const& _hyperlink);
 
-using HyperlinkCache = crispy::LRUCache<HyperlinkId, std::shared_ptr<HyperlinkInfo>>;
+/// Columns of a URL shown as plain text, i.e. not being an OSC 8 hyperlink.
+struct PlainTextUrl
+{
+    std::size_t offset = 0;
+    std::size_t length = 0;
+};
+
+/// Appends the plain-text URLs found in the given text of one character per column to @p _output.
+///
+/// URLs start with a scheme followed by "://", or with "www.", and end before whitespace, quotes
+/// or angle brackets. Trailing punctuation and unbalanced closing brackets are not taken as part
+/// of the URL.
+void findPlainTextUrls(std::string_view _text, std::vector<PlainTextUrl>& _output);
+void findPlainTextUrls(std::u32string_view _text, std::vector<PlainTextUrl>& _output);
 
-struct HyperlinkStorage
+/**
+ * Interning table of all hyperlinks referred to by cells, indexed by their HyperlinkId.
+ *
+ * Identical hyperlinks share the same ID, and looking up a hyperlink by its ID is a plain table
+ * access. Hyperlinks are never evicted while still being referred to. Instead,
+ * releaseUnreferenced() frees the IDs no longer referred to by any cell, e.g. because their lines
+ * have left the history, such that their IDs can be reused.
+ *
+ * References to hyperlinks stay valid until released.
+ */
+class HyperlinkStorage
 {
-    HyperlinkCache cache { 1024 };
-    HyperlinkId nextHyperlinkId = HyperlinkId(1);
+  public:
+    /// Number of hyperlinks to hold before unreferenced ones are looked for again.
+    static constexpr size_t InitialCollectionThreshold = 1024;
 
-    std::shared_ptr<HyperlinkInfo> hyperlinkById(HyperlinkId _id) noexcept
+    [[nodiscard]] HyperlinkInfo const* hyperlinkById(HyperlinkId _id) const noexcept
     {
-        if (!!_id)
-            if (auto href = cache.try_get(_id))
-                return *href;
-        return {};
+        auto const index = unbox<size_t>(_id);
+        if (index == 0 || index >= entries_.size() || !entries_[index].used)
+            return nullptr;
+        return &entries_[index].info;
     }
 
-    std::shared_ptr<HyperlinkInfo const> hyperlinkById(HyperlinkId _id) const noexcept
-    {
-        if (!!_id)
-            if (auto href = cache.try_get(_id))
-                return *href;
-        return {};
-    }
+    /// @returns the ID of the hyperlink with the given ID and URI, which is allocated if new,
+    ///          or an invalid ID if all IDs are in use.
+    [[nodiscard]] HyperlinkId intern(std::string _userId, URI _uri);
+
+    /// @returns the number of hyperlinks held.
+    [[nodiscard]] size_t size() const noexcept { return ids_.size(); }
+
+    /// Tests whether enough hyperlinks have been interned to look for unreferenced ones.
+    [[nodiscard]] bool needsCollection() const noexcept { return size() >= collectionThreshold_; }
+
+    /// Releases all hyperlinks whose IDs are not set in @p _referenced, which is indexed by ID.
+    void releaseUnreferenced(std::vector<bool> const& _referenced);
+
+    /// @returns the number of IDs to be marked when passed to releaseUnreferenced().
+    [[nodiscard]] size_t idCount() const noexcept { return entries_.size(); }
+
+    /// @returns the estimated number of bytes held by the hyperlinks and their lookup tables.
+    [[nodiscard]] size_t memoryUsage() const noexcept;
+
+    /// Returns the hits and misses of intern() and the hyperlinks released since the last call.
+    crispy::LRUHashtableStats fetchAndClearStats() noexcept { return std::exchange(stats_, {}); }
 
-    HyperlinkId hyperlinkIdByUserId(std::string const& _id) noexcept
+  private:
+    struct Entry
     {
-        for (auto& href: cache)
-        {
-            if (href.value->userId == _id)
-            {
-                cache.touch(href.key);
-                return href.key;
-            }
-        }
-        return HyperlinkId {};
-    }
+        HyperlinkInfo info;
+        bool used = false;
+    };
+
+    // Entries indexed by ID, with the invalid ID 0 never being used.
+    // A deque keeps references to the entries stable while new ones are added.
+    std::deque<Entry> entries_ = std::deque<Entry>(1);
+    std::vector<HyperlinkId> freeIds_;
+    // Maps the application provided ID and URI, joined by a NUL character, to the hyperlink's ID.
+    std::unordered_map<std::string, HyperlinkId> ids_;
+    size_t collectionThreshold_ = InitialCollectionThreshold;
+    crispy::LRUHashtableStats stats_ {};
+};
+
+/// Columns of a screen line showing the same hyperlink.
+struct HyperlinkSpan
+{
+    ColumnOffset start;
+    ColumnOffset end; //!< column right behind the span
+    HyperlinkId id;
+};
+
+/**
+ * Hyperlinks shown on the visible page, as spans of columns per screen line, ordered by column.
+ *
+ * The spans are collected once per render buffer refresh, such that the hyperlink under the mouse
+ * is found by a binary search, and the lines showing a hyperlink are known without looking at
+ * any grid cell.
+ */
+class HyperlinkSpans
+{
+  public:
+    /// Drops all spans, providing for a page of the given number of lines.
+    void reset(LineCount _lines);
+
+    /// Adds the given columns of the given screen line showing the given hyperlink, if valid.
+    ///
+    /// Spans are to be added from left to right per line, and adjacent spans of the same hyperlink
+    /// are joined.
+    void add(LineOffset _line, ColumnOffset _start, ColumnOffset _end, HyperlinkId _id);
+
+    /// @returns the ID of the hyperlink shown at the given screen position, or an invalid ID if none.
+    [[nodiscard]] HyperlinkId at(CellLocation _position) const noexcept;
+
+    /// Tests whether the given hyperlink is shown on the given screen line.
+    [[nodiscard]] bool contains(LineOffset _line, HyperlinkId _id) const noexcept;
+
+  private:
+    std::vector<std::vector<HyperlinkSpan>> lines_;
 };
 
 } // namespace terminal
@@ -0,0 +1,187 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/Hyperlink.h>
+#include <terminal/MockTerm.h>
+
+#include <catch2/catch.hpp>
+
+#include <vector>
+
+using namespace terminal;
+using std::vector;
+
+TEST_CASE("HyperlinkStorage.intern", "[hyperlink]")
+{
+    auto storage = HyperlinkStorage {};
+    auto const a = storage.intern("", "https://a");
+    auto const b = storage.intern("", "https://b");
+    REQUIRE(!!a);
+    REQUIRE(!!b);
+    CHECK(a != b);
+
+    // Identical hyperlinks share the same ID, whereas the application provided ID tells them apart.
+    CHECK(storage.intern("", "https://a") == a);
+    CHECK(storage.intern("x", "https://a") != a);
+    CHECK(storage.size() == 3);
+
+    REQUIRE(storage.hyperlinkById(a) != nullptr);
+    CHECK(storage.hyperlinkById(a)->uri == "https://a");
+    CHECK(storage.hyperlinkById(HyperlinkId {}) == nullptr);
+}
+
+TEST_CASE("HyperlinkStorage.releaseUnreferenced", "[hyperlink]")
+{
+    auto storage = HyperlinkStorage {};
+    auto const a = storage.intern("", "https://a");
+    auto const b = storage.intern("", "https://b");
+
+    auto referenced = vector<bool>(storage.idCount());
+    referenced[unbox<size_t>(a)] = true;
+    storage.releaseUnreferenced(referenced);
+
+    CHECK(storage.size() == 1);
+    CHECK(storage.hyperlinkById(a) != nullptr);
+    CHECK(storage.hyperlinkById(b) == nullptr);
+
+    // Released IDs are reused.
+    CHECK(storage.intern("", "https://c") == b);
+    CHECK(storage.hyperlinkById(b)->uri == "https://c");
+
+    auto const stats = storage.fetchAndClearStats();
+    CHECK(stats.hits == 0);
+    CHECK(stats.misses == 3);
+    CHECK(stats.recycles == 1);
+    CHECK(storage.fetchAndClearStats().misses == 0);
+}
+
+TEST_CASE("Terminal.releaseUnreferencedHyperlinks", "[hyperlink]")
+{
+    auto mock = MockTerm { PageSize { LineCount(2), ColumnCount(5) }, LineCount(1) };
+    auto const& hyperlinks = mock.terminal.state().hyperlinks;
+    mock.writeToScreen("\033]8;;https://a\033\\A\033]8;;\033\\\r\n");
+    mock.writeToScreen("\033]8;;https://b\033\\B\033]8;;\033\\");
+    REQUIRE(hyperlinks.size() == 2);
+
+    // Still referred to from the history.
+    mock.writeToScreen("\r\n");
+    mock.terminal.releaseUnreferencedHyperlinks();
+    CHECK(hyperlinks.size() == 2);
+
+    // The line referring to the first hyperlink has left the history.
+    mock.writeToScreen("\r\n");
+    mock.terminal.releaseUnreferencedHyperlinks();
+    REQUIRE(hyperlinks.size() == 1);
+    auto const* info =
+        mock.terminal.primaryScreen().hyperlinkAt(CellLocation { LineOffset(-1), ColumnOffset(0) });
+    REQUIRE(info != nullptr);
+    CHECK(info->uri == "https://b");
+}
+
+TEST_CASE("HyperlinkSpans.at", "[hyperlink]")
+{
+    auto const a = HyperlinkId(1);
+    auto const b = HyperlinkId(2);
+    auto spans = HyperlinkSpans {};
+    spans.reset(LineCount(2));
+    spans.add(LineOffset(0), ColumnOffset(2), ColumnOffset(4), a);
+    spans.add(LineOffset(0), ColumnOffset(4), ColumnOffset(5), a); // joined with the span before
+    spans.add(LineOffset(0), ColumnOffset(5), ColumnOffset(6), HyperlinkId {});
+    spans.add(LineOffset(0), ColumnOffset(7), ColumnOffset(9), b);
+
+    auto const at = [&](int _line, int _column) {
+        return spans.at(CellLocation { LineOffset(_line), ColumnOffset(_column) });
+    };
+    CHECK(at(0, 1) == HyperlinkId {});
+    CHECK(at(0, 2) == a);
+    CHECK(at(0, 4) == a);
+    CHECK(at(0, 5) == HyperlinkId {});
+    CHECK(at(0, 6) == HyperlinkId {});
+    CHECK(at(0, 8) == b);
+    CHECK(at(0, 9) == HyperlinkId {});
+    CHECK(at(1, 2) == HyperlinkId {});
+    CHECK(at(2, 2) == HyperlinkId {});
+    CHECK(at(-1, 2) == HyperlinkId {});
+
+    CHECK(spans.contains(LineOffset(0), b));
+    CHECK(!spans.contains(LineOffset(1), b));
+
+    spans.reset(LineCount(2));
+    CHECK(at(0, 2) == HyperlinkId {});
+}
+
+TEST_CASE("Grid.collectHyperlinkSpans", "[hyperlink]")
+{
+    auto mock = MockTerm { PageSize { LineCount(3), ColumnCount(6) }, LineCount(2) };
+    mock.writeToScreen("\033]8;;https://a\033\\AB\033]8;;\033\\\r\n");
+    mock.writeToScreen("x\033]8;;https://b\033\\C\033]8;;\033\\y\r\n");
+    mock.writeToScreen("\033]8;;https://c\033\\\xC3\xA4\033]8;;\033\\");
+
+    auto const& grid = mock.terminal.primaryScreen().grid();
+    auto const& hyperlinks = mock.terminal.state().hyperlinks;
+    auto spans = HyperlinkSpans {};
+    auto const uriAt = [&](int _line, int _column) -> std::string {
+        auto const* info =
+            hyperlinks.hyperlinkById(spans.at(CellLocation { LineOffset(_line), ColumnOffset(_column) }));
+        return info ? info->uri : "";
+    };
+
+    grid.collectHyperlinkSpans(ScrollOffset(0), spans);
+    CHECK(uriAt(0, 0) == "https://a");
+    CHECK(uriAt(0, 1) == "https://a");
+    CHECK(uriAt(0, 2).empty());
+    CHECK(uriAt(1, 0).empty());
+    CHECK(uriAt(1, 1) == "https://b");
+    CHECK(uriAt(1, 2).empty());
+    CHECK(uriAt(2, 0) == "https://c");
+    CHECK(uriAt(2, 1).empty());
+
+    // Scrolled into the history, where nothing is shown above the first line.
+    mock.writeToScreen("\r\n");
+    grid.collectHyperlinkSpans(ScrollOffset(1), spans);
+    CHECK(uriAt(0, 0) == "https://a");
+    CHECK(uriAt(1, 1) == "https://b");
+}
+
+namespace
+{
+vector<std::string_view> plainTextUrls(std::string_view _text)
+{
+    auto spans = vector<PlainTextUrl> {};
+    findPlainTextUrls(_text, spans);
+    auto urls = vector<std::string_view> {};
+    for (auto const& span: spans)
+        urls.push_back(_text.substr(span.offset, span.length));
+    return urls;
+}
+} // namespace
+
+TEST_CASE("findPlainTextUrls", "[hyperlink]")
+{
+    using V = vector<std::string_view>;
+    CHECK(plainTextUrls("no links here: just text") == V {});
+    CHECK(plainTextUrls("see https://example.com/a?b=c#d for details")
+          == V { "https://example.com/a?b=c#d" });
+    CHECK(plainTextUrls("www.example.com, and file:///etc/hosts.")
+          == V { "www.example.com", "file:///etc/hosts" });
+    CHECK(plainTextUrls("(https://en.wikipedia.org/wiki/Foo_(bar))")
+          == V { "https://en.wikipedia.org/wiki/Foo_(bar)" });
+    CHECK(plainTextUrls("<http://a.b/c>\"https://d.e\"") == V { "http://a.b/c", "https://d.e" });
+    CHECK(plainTextUrls(":// awww.a x://") == V {});
+
+    auto spans = vector<PlainTextUrl> {};
+    findPlainTextUrls(U"\u2192 https://\u00E4.de \u2190", spans);
+    REQUIRE(spans.size() == 1);
+    CHECK(spans[0].offset == 2);
+    CHECK(spans[0].length == 12);
+}
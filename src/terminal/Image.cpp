@@ -13,16 +13,26 @@
  */
 #include <terminal/Image.h>
 
+#include <crispy/qoi.h>
+#include <crispy/utils.h>
+
 #include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <iterator>
 #include <memory>
+#include <mutex>
+#include <thread>
 
 using std::copy;
 using std::make_shared;
+using std::max;
 using std::min;
 using std::move;
 using std::ostream;
 using std::shared_ptr;
 using std::string;
+using std::vector;
 
 using crispy::LRUCapacity;
 using crispy::StrongHashtableSize;
@@ -30,6 +40,135 @@ using crispy::StrongHashtableSize;
 namespace terminal
 {
 
+namespace
+{
+    /// Fills the given RGBA buffer with the given color.
+    void fill(Image::Data& _pixels, RGBAColor _color)
+    {
+        for (size_t i = 0; i + 3 < _pixels.size(); i += 4)
+        {
+            _pixels[i + 0] = _color.red();
+            _pixels[i + 1] = _color.green();
+            _pixels[i + 2] = _color.blue();
+            _pixels[i + 3] = _color.alpha();
+        }
+    }
+
+    /// @returns the offset of an extent of @p _size aligned within @p _available,
+    ///          being negative when it does not fit.
+    int alignedOffset(int _available, int _size, int _alignment) noexcept
+    {
+        switch (_alignment)
+        {
+            case 0: return 0;
+            case 1: return (_available - _size) / 2;
+            default: return _available - _size;
+        }
+    }
+
+    /// @returns the size an image of @p _size is to be resized to for the given area and policy.
+    ImageSize resizedSize(ImageSize _size, ImageSize _area, ImageResize _policy) noexcept
+    {
+        auto const w = unbox<uint64_t>(_size.width);
+        auto const h = unbox<uint64_t>(_size.height);
+        auto const areaWidth = unbox<uint64_t>(_area.width);
+        auto const areaHeight = unbox<uint64_t>(_area.height);
+
+        // Whether the image is, relative to the area, narrower than it, i.e. limited by its height.
+        auto const narrower = w * areaHeight <= h * areaWidth;
+        auto const toHeight = [&]() {
+            return ImageSize { Width::cast_from(max(uint64_t { 1 }, w * areaHeight / h)), _area.height };
+        };
+        auto const toWidth = [&]() {
+            return ImageSize { _area.width, Height::cast_from(max(uint64_t { 1 }, h * areaWidth / w)) };
+        };
+
+        switch (_policy)
+        {
+            case ImageResize::NoResize: break;
+            case ImageResize::ResizeToFit: return narrower ? toHeight() : toWidth();
+            case ImageResize::ResizeToFill: return narrower ? toWidth() : toHeight();
+            case ImageResize::StretchToFill: return _area;
+        }
+        return _size;
+    }
+} // namespace
+
+// {{{ CompressibleImageData
+namespace
+{
+    std::atomic<uint64_t> lastImageDataUse = 0;
+}
+
+void CompressibleImageData::reset(Data _pixels)
+{
+    auto const _ = std::lock_guard { mutex_ };
+    pixelCount_ = _pixels.size() / 4;
+    pixels_ = make_shared<Data const>(std::move(_pixels));
+    compressed_.clear();
+    compressed_.shrink_to_fit();
+    incompressible_ = false;
+    lastUse_.store(++lastImageDataUse, std::memory_order_relaxed);
+}
+
+shared_ptr<CompressibleImageData::Data const> CompressibleImageData::get() const
+{
+    lastUse_.store(++lastImageDataUse, std::memory_order_relaxed);
+
+    auto const _ = std::lock_guard { mutex_ };
+    if (!pixels_ && !compressed_.empty())
+        pixels_ =
+            make_shared<Data const>(crispy::qoi::decode(compressed_.data(), compressed_.size(), pixelCount_));
+    return pixels_;
+}
+
+size_t CompressibleImageData::compress() const
+{
+    auto pixels = shared_ptr<Data const> {};
+    {
+        auto const _ = std::lock_guard { mutex_ };
+        if (!pixels_ || incompressible_)
+            return 0;
+
+        // Pixels decompressed on demand are still available compressed.
+        if (!compressed_.empty())
+        {
+            auto const freed = pixels_->capacity();
+            pixels_.reset();
+            return freed;
+        }
+        pixels = pixels_;
+    }
+
+    // Encoding large images takes a while, during which the pixels remain accessible.
+    auto compressed = crispy::qoi::encode(pixels->data(), pixels->size() / 4);
+
+    auto const _ = std::lock_guard { mutex_ };
+    if (pixels_ != pixels)
+        return 0;
+    if (compressed.size() >= pixels->size())
+    {
+        incompressible_ = true;
+        return 0;
+    }
+    compressed_ = std::move(compressed);
+    pixels_.reset();
+    return pixels->capacity() - compressed_.capacity();
+}
+
+bool CompressibleImageData::compressed() const
+{
+    auto const _ = std::lock_guard { mutex_ };
+    return !pixels_ && !compressed_.empty();
+}
+
+size_t CompressibleImageData::memoryUsage() const
+{
+    auto const _ = std::lock_guard { mutex_ };
+    return (pixels_ ? pixels_->capacity() : 0) + compressed_.capacity();
+}
+// }}}
+
 ImageStats& ImageStats::get()
 {
     static ImageStats stats {};
@@ -47,10 +186,85 @@ RasterizedImage::~RasterizedImage()
     --ImageStats::get().rasterized;
 }
 
-ImageFragment::~ImageFragment()
+// {{{ ImagePool::Rasterizer
+/// Rasterizes images on a pool of worker threads, such that resizing large images
+/// never blocks the terminal thread.
+class ImagePool::Rasterizer
 {
-    --ImageStats::get().fragments;
-}
+  public:
+    Rasterizer(size_t _threadCount, OnImageRasterized _onRasterized):
+        onRasterized_ { std::move(_onRasterized) }
+    {
+        for (size_t i = 0; i < _threadCount; ++i)
+            threads_.emplace_back([this]() { workerLoop(); });
+    }
+
+    ~Rasterizer() { stop(); }
+
+    /// Stops all worker threads, waiting for the images in progress.
+    ///
+    /// @returns the images that have not been rasterized yet.
+    std::deque<shared_ptr<RasterizedImage>> stop()
+    {
+        auto pending = std::deque<shared_ptr<RasterizedImage>> {};
+        {
+            auto const _ = std::lock_guard { mutex_ };
+            stopping_ = true;
+            std::swap(pending, requests_);
+        }
+        wakeup_.notify_all();
+        for (auto& thread: threads_)
+            thread.join();
+        threads_.clear();
+        return pending;
+    }
+
+    Rasterizer(Rasterizer const&) = delete;
+    Rasterizer& operator=(Rasterizer const&) = delete;
+
+    void request(shared_ptr<RasterizedImage> _image)
+    {
+        {
+            auto const _ = std::lock_guard { mutex_ };
+            requests_.emplace_back(std::move(_image));
+        }
+        wakeup_.notify_one();
+    }
+
+  private:
+    void workerLoop()
+    {
+        auto lock = std::unique_lock { mutex_ };
+        while (true)
+        {
+            wakeup_.wait(lock, [this]() { return stopping_ || !requests_.empty(); });
+            if (stopping_)
+                return;
+
+            auto image = std::move(requests_.front());
+            requests_.pop_front();
+            lock.unlock();
+
+            // Images no longer referenced by any grid cell are not worth rasterizing.
+            auto const referenced = image.use_count() > 1;
+            if (referenced)
+                image->rasterize();
+            image.reset();
+            if (referenced)
+                onRasterized_();
+
+            lock.lock();
+        }
+    }
+
+    OnImageRasterized const onRasterized_;
+    std::mutex mutex_;
+    std::condition_variable wakeup_;
+    bool stopping_ = false;
+    std::deque<shared_ptr<RasterizedImage>> requests_;
+    vector<std::thread> threads_;
+};
+// }}}
 
 ImagePool::ImagePool(OnImageRemove _onImageRemove, ImageId _nextImageId):
     nextImageId_ { _nextImageId },
@@ -61,21 +275,175 @@ ImagePool::ImagePool(OnImageRemove _onImageRemove, ImageId _nextImageId):
 {
 }
 
+ImagePool::~ImagePool() = default;
+
+void ImagePool::setAsyncRasterization(size_t _threadCount, OnImageRasterized _onRasterized)
+{
+    if (rasterizer_)
+    {
+        // Images still waiting for the previous worker threads are rasterized right away instead.
+        for (auto const& image: rasterizer_->stop())
+            image->rasterize();
+        rasterizer_.reset();
+    }
+    if (_threadCount)
+        rasterizer_ = std::make_unique<Rasterizer>(_threadCount, std::move(_onRasterized));
+}
+
+Image::Data resizeImage(Image::Data const& _pixels, ImageSize _size, ImageSize _newSize)
+{
+    auto const width = unbox<size_t>(_size.width);
+    auto const height = unbox<size_t>(_size.height);
+    auto const newWidth = unbox<size_t>(_newSize.width);
+    auto const newHeight = unbox<size_t>(_newSize.height);
+
+    if (_size == _newSize)
+        return _pixels;
+
+    auto resized = Image::Data(_newSize.area() * 4);
+    if (!width || !height)
+        return resized;
+
+    auto* target = resized.data();
+    if (newWidth >= width && newHeight >= height)
+    {
+        // Bilinear filter in 8 bit fixed point, sampling at the pixel centers.
+        struct Sample
+        {
+            size_t first;
+            size_t second;
+            uint32_t weight; // of the second sample, 0..256
+        };
+        auto const samples = [](size_t _count, size_t _newCount) {
+            auto result = vector<Sample>(_newCount);
+            for (size_t i = 0; i < _newCount; ++i)
+            {
+                auto const center = static_cast<int64_t>(((2 * i + 1) * _count << 8) / (2 * _newCount)) - 128;
+                auto const position = static_cast<size_t>(max(int64_t { 0 }, center));
+                auto const first = min(position >> 8, _count - 1);
+                auto const second = min(first + 1, _count - 1);
+                result[i] = Sample { first, second, static_cast<uint32_t>(position & 0xFF) };
+            }
+            return result;
+        };
+        auto const columns = samples(width, newWidth);
+        auto const rows = samples(height, newHeight);
+
+        for (auto const& row: rows)
+        {
+            auto const* top = _pixels.data() + row.first * width * 4;
+            auto const* bottom = _pixels.data() + row.second * width * 4;
+            for (auto const& column: columns)
+            {
+                for (size_t i = 0; i < 4; ++i)
+                {
+                    auto const mix = [&](uint8_t const* _row) {
+                        return _row[column.first * 4 + i] * (256 - column.weight)
+                               + _row[column.second * 4 + i] * column.weight;
+                    };
+                    auto const value = mix(top) * (256 - row.weight) + mix(bottom) * row.weight;
+                    *target++ = static_cast<uint8_t>((value + 32768) >> 16);
+                }
+            }
+        }
+        return resized;
+    }
+
+    // Box filter, averaging all pixels covered by a target pixel.
+    for (size_t y = 0; y < newHeight; ++y)
+    {
+        auto const top = y * height / newHeight;
+        auto const bottom = max(top + 1, (y + 1) * height / newHeight);
+        for (size_t x = 0; x < newWidth; ++x)
+        {
+            auto const left = x * width / newWidth;
+            auto const right = max(left + 1, (x + 1) * width / newWidth);
+
+            uint32_t sum[4] = {};
+            for (auto sy = top; sy < bottom; ++sy)
+            {
+                auto const* pixel = _pixels.data() + (sy * width + left) * 4;
+                for (auto sx = left; sx < right; ++sx)
+                    for (size_t i = 0; i < 4; ++i)
+                        sum[i] += *pixel++;
+            }
+
+            auto const count = static_cast<uint32_t>((bottom - top) * (right - left));
+            for (uint32_t const value: sum)
+                *target++ = static_cast<uint8_t>(value / count);
+        }
+    }
+    return resized;
+}
+
+void RasterizedImage::rasterize()
+{
+    auto const area = pixelSize();
+    auto pixels = Image::Data(area.area() * 4);
+    fill(pixels, defaultColor_);
+
+    auto const size = resizedSize(image_->size(), area, resizePolicy_);
+    if (image_->size().area() && size.area())
+    {
+        auto const resized = resizeImage(*image_->data(), image_->size(), size);
+
+        auto const alignment = static_cast<int>(alignmentPolicy_);
+        auto const areaWidth = unbox<int>(area.width);
+        auto const areaHeight = unbox<int>(area.height);
+        auto const width = unbox<int>(size.width);
+        auto const height = unbox<int>(size.height);
+        auto const xOffset = alignedOffset(areaWidth, width, alignment % 3);
+        auto const yOffset = alignedOffset(areaHeight, height, alignment / 3);
+
+        // Copy the part of the resized image that overlaps with the area.
+        auto const left = max(0, xOffset);
+        auto const right = min(areaWidth, xOffset + width);
+        for (auto y = max(0, yOffset); y < min(areaHeight, yOffset + height) && left < right; ++y)
+        {
+            auto const* source = resized.data() + ((y - yOffset) * width + (left - xOffset)) * 4;
+            copy(source, source + (right - left) * 4, pixels.data() + (y * areaWidth + left) * 4);
+        }
+    }
+
+    pixels_.reset(std::move(pixels));
+    ready_.store(true);
+    releaseImageIfRequested();
+}
+
+void RasterizedImage::releaseImage() const
+{
+    // Whichever of this and rasterize() observes the other one last releases the image.
+    imageReleaseRequested_.store(true);
+    if (ready_.load())
+        releaseImageIfRequested();
+}
+
+void RasterizedImage::releaseImageIfRequested() const
+{
+    if (imageReleaseRequested_.load() && !imageReleased_.exchange(true))
+        image_.reset();
+}
+
 Image::Data RasterizedImage::fragment(CellLocation _pos) const
 {
-    // TODO: respect alignment hint
-    // TODO: respect resize hint
+    Image::Data fragData;
+    fragData.resize(cellSize_.area() * 4); // RGBA
+    if (!ready())
+    {
+        fill(fragData, defaultColor_);
+        return fragData;
+    }
 
     auto const xOffset = _pos.column * unbox<int>(cellSize_.width);
     auto const yOffset = _pos.line * unbox<int>(cellSize_.height);
     auto const pixelOffset = CellLocation { yOffset, xOffset };
+    auto const pixels = pixels_.get();
 
-    Image::Data fragData;
-    fragData.resize(cellSize_.area() * 4); // RGBA
+    auto const pixelWidth = unbox<int>(pixelSize().width);
     auto const availableWidth =
-        min(unbox<int>(image_->width()) - *pixelOffset.column, unbox<int>(cellSize_.width));
+        max(0, min(pixelWidth - *pixelOffset.column, unbox<int>(cellSize_.width)));
     auto const availableHeight =
-        min(unbox<int>(image_->height()) - *pixelOffset.line, unbox<int>(cellSize_.height));
+        max(0, min(unbox<int>(pixelSize().height) - *pixelOffset.line, unbox<int>(cellSize_.height)));
 
     // auto const availableSize = Size{availableWidth, availableHeight};
     // std::cout << fmt::format(
@@ -102,9 +470,9 @@ Image::Data RasterizedImage::fragment(CellLocation _pos) const
 
     for (int y = 0; y < availableHeight; ++y)
     {
-        auto const startOffset = static_cast<size_t>(
-            ((*pixelOffset.line + y) * unbox<int>(image_->width()) + *pixelOffset.column) * 4);
-        auto const source = &image_->data()[startOffset];
+        auto const startOffset =
+            static_cast<size_t>(((*pixelOffset.line + y) * pixelWidth + *pixelOffset.column) * 4);
+        auto const source = &(*pixels)[startOffset];
         target = copy(source, source + static_cast<ptrdiff_t>(availableWidth) * 4, target);
 
         // fill vertical gap on right
@@ -131,10 +499,27 @@ Image::Data RasterizedImage::fragment(CellLocation _pos) const
 
 shared_ptr<Image const> ImagePool::create(ImageFormat _format, ImageSize _size, Image::Data&& _data)
 {
-    // TODO: This operation should be idempotent, i.e. if that image has been created already, return a
-    // reference to that.
+    auto const hash = crispy::StrongHash::compute(_data.data(), _data.size())
+                      * crispy::StrongHash(static_cast<uint32_t>(_format),
+                                           unbox<uint32_t>(_size.width),
+                                           unbox<uint32_t>(_size.height),
+                                           0);
+
+    auto& knownImage = imagesByContent_[hash];
+    if (auto image = knownImage.lock())
+    {
+        // Guard against hash collisions, comparing being cheap compared to having decoded the image.
+        if (image->format() == _format && image->size() == _size && *image->data() == _data)
+            return image;
+    }
+
+    sweepExpiredImages();
+
     auto const id = nextImageId_++;
-    return make_shared<Image>(id, _format, std::move(_data), _size, onImageRemove_);
+    auto image = make_shared<Image>(id, _format, std::move(_data), _size, onImageRemove_);
+    imagesByContent_[hash] = image;
+    enforceMemoryBudget();
+    return image;
 }
 
 shared_ptr<RasterizedImage> ImagePool::rasterize(shared_ptr<Image const> _image,
@@ -144,8 +529,85 @@ shared_ptr<RasterizedImage> ImagePool::rasterize(shared_ptr<Image const> _image,
                                                  GridSize _cellSpan,
                                                  ImageSize _cellSize)
 {
-    return make_shared<RasterizedImage>(
+    auto const key = RasterizedImageKey { _image->id().value,
+                                          _alignmentPolicy,
+                                          _resizePolicy,
+                                          _defaultColor.value,
+                                          unbox<int>(_cellSpan.lines),
+                                          unbox<int>(_cellSpan.columns),
+                                          unbox<unsigned>(_cellSize.width),
+                                          unbox<unsigned>(_cellSize.height) };
+    if (auto const i = rasterizedImages_.find(key); i != rasterizedImages_.end())
+        if (auto rasterizedImage = i->second.lock())
+            return rasterizedImage;
+
+    sweepExpiredImages();
+
+    auto rasterizedImage = make_shared<RasterizedImage>(
         std::move(_image), _alignmentPolicy, _resizePolicy, _defaultColor, _cellSpan, _cellSize);
+    rasterizedImages_[key] = rasterizedImage;
+    if (rasterizer_)
+        rasterizer_->request(rasterizedImage);
+    else
+        rasterizedImage->rasterize();
+    enforceMemoryBudget();
+    return rasterizedImage;
+}
+
+void ImagePool::sweepExpiredImages()
+{
+    if (imagesByContent_.size() + rasterizedImages_.size() < sweepThreshold_)
+        return;
+
+    auto const sweep = [](auto& _map) {
+        for (auto i = _map.begin(); i != _map.end();)
+            i = i->second.expired() ? _map.erase(i) : std::next(i);
+    };
+    sweep(imagesByContent_);
+    sweep(rasterizedImages_);
+
+    sweepThreshold_ = max(size_t { 64 }, 2 * (imagesByContent_.size() + rasterizedImages_.size()));
+}
+
+void ImagePool::setMemoryBudget(size_t _bytes)
+{
+    memoryBudget_ = _bytes;
+    enforceMemoryBudget();
+}
+
+void ImagePool::enforceMemoryBudget()
+{
+    if (!memoryBudget_)
+        return;
+
+    // Holds on to the images while compressing their pixels.
+    auto images = vector<shared_ptr<Image const>> {};
+    auto rasterizedImages = vector<shared_ptr<RasterizedImage>> {};
+    auto candidates = vector<std::pair<uint64_t, CompressibleImageData const*>> {};
+    size_t bytes = 0;
+
+    auto const consider = [&](CompressibleImageData const& _storage) {
+        bytes += _storage.memoryUsage();
+        if (!_storage.compressed())
+            candidates.emplace_back(_storage.lastUse(), &_storage);
+    };
+    for (auto const& [hash, weakImage]: imagesByContent_)
+        if (auto image = weakImage.lock())
+            consider(images.emplace_back(std::move(image))->storage());
+    for (auto const& [key, weakImage]: rasterizedImages_)
+        if (auto image = weakImage.lock())
+            consider(rasterizedImages.emplace_back(std::move(image))->storage());
+
+    if (bytes <= memoryBudget_)
+        return;
+
+    std::sort(candidates.begin(), candidates.end());
+    for (auto const& [lastUse, storage]: candidates)
+    {
+        if (bytes <= memoryBudget_)
+            break;
+        bytes -= min(bytes, storage->compress());
+    }
 }
 
 void ImagePool::link(string const& _name, shared_ptr<Image const> _imageRef)
@@ -169,13 +631,48 @@ void ImagePool::unlink(string const& _name)
 void ImagePool::clear()
 {
     imageNameToImageCache_.clear();
+    imagesByContent_.clear();
+    rasterizedImages_.clear();
 }
 
 void ImagePool::inspect(ostream& os) const
 {
     os << "Image pool:\n";
     os << fmt::format("global image stats: {}\n", ImageStats::get());
+    os << fmt::format("{} images and {} rasterized images known by content\n",
+                      imagesByContent_.size(),
+                      rasterizedImages_.size());
+    auto const usage = memoryUsage();
+    os << fmt::format("{} images in use, holding {} ({} compressed)\n",
+                      usage.images,
+                      crispy::humanReadableBytes(usage.bytes),
+                      usage.compressed);
+    if (memoryBudget_)
+        os << fmt::format("memory budget: {}\n", crispy::humanReadableBytes(memoryBudget_));
     imageNameToImageCache_.inspect(os);
 }
 
+ImageMemoryUsage ImagePool::memoryUsage() const
+{
+    auto usage = ImageMemoryUsage {};
+    for (auto const& [hash, weakImage]: imagesByContent_)
+    {
+        if (auto const image = weakImage.lock())
+        {
+            ++usage.images;
+            usage.bytes += sizeof(Image) + image->storage().memoryUsage();
+            usage.compressed += image->storage().compressed() ? 1 : 0;
+        }
+    }
+    for (auto const& [key, weakImage]: rasterizedImages_)
+    {
+        if (auto const image = weakImage.lock())
+        {
+            usage.bytes += sizeof(RasterizedImage) + image->storage().memoryUsage();
+            usage.compressed += image->storage().compressed() ? 1 : 0;
+        }
+    }
+    return usage;
+}
+
 } // namespace terminal
@@ -21,11 +21,15 @@
 
 #include <fmt/format.h>
 
+#include <atomic>
 #include <cstdint>
 #include <functional>
 #include <list>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <tuple>
+#include <unordered_map>
 #include <vector>
 
 namespace terminal
@@ -52,18 +56,74 @@ struct ImageStats
 {
     uint32_t instances = 0;
     uint32_t rasterized = 0;
-    uint32_t fragments = 0;
 
     static ImageStats& get();
 };
 
+struct ImageMemoryUsage
+{
+    size_t images = 0;     //!< number of images still alive
+    size_t bytes = 0;      //!< bytes of their pixel data and their rasterizations, compressed or not
+    size_t compressed = 0; //!< number of images and rasterizations held compressed
+};
+
+/**
+ * RGBA pixels that can be compressed in memory while not in use, being decompressed on demand.
+ *
+ * The pixels may be accessed, compressed, and replaced from any thread.
+ *
+ * @see ImagePool::setMemoryBudget()
+ */
+class CompressibleImageData
+{
+  public:
+    using Data = std::vector<uint8_t>; // raw RGBA data
+
+    CompressibleImageData() = default;
+    explicit CompressibleImageData(Data _pixels) { reset(std::move(_pixels)); }
+
+    CompressibleImageData(CompressibleImageData const&) = delete;
+    CompressibleImageData& operator=(CompressibleImageData const&) = delete;
+
+    /// Replaces the pixels.
+    void reset(Data _pixels);
+
+    /// @returns the pixels, decompressing them first if needed, or nullptr if none have been set yet.
+    ///
+    /// The pixels stay valid as long as the returned pointer, even when being compressed meanwhile.
+    [[nodiscard]] std::shared_ptr<Data const> get() const;
+
+    /// Compresses the pixels, unless already compressed or not compressing well.
+    ///
+    /// This does not change the pixels observed, and is thus considered const.
+    ///
+    /// @returns the number of bytes freed.
+    size_t compress() const;
+
+    [[nodiscard]] bool compressed() const;
+
+    /// @returns the number of bytes held, either compressed or not.
+    [[nodiscard]] size_t memoryUsage() const;
+
+    /// @returns a process-wide sequence number of the last get(), ordering pixels by their last use.
+    [[nodiscard]] uint64_t lastUse() const noexcept { return lastUse_.load(std::memory_order_relaxed); }
+
+  private:
+    mutable std::mutex mutex_;
+    mutable std::shared_ptr<Data const> pixels_; //!< the pixels, unless compressed
+    mutable std::vector<uint8_t> compressed_;    //!< the compressed pixels, once compressed
+    mutable bool incompressible_ = false;        //!< whether compressing did not pay off
+    size_t pixelCount_ = 0;
+    mutable std::atomic<uint64_t> lastUse_ = 0;
+};
+
 /**
  * Represents an image that can be displayed in the terminal by being placed into the grid cells
  */
 class Image: public std::enable_shared_from_this<Image>
 {
   public:
-    using Data = std::vector<uint8_t>; // raw RGBA data
+    using Data = CompressibleImageData::Data; // raw RGBA data
     using OnImageRemove = std::function<void(Image const*)>;
     /// Constructs an RGBA image.
     ///
@@ -83,12 +143,14 @@ class Image: public std::enable_shared_from_this<Image>
 
     Image(Image const&) = delete;
     Image& operator=(Image const&) = delete;
-    Image(Image&&) = default;
-    Image& operator=(Image&&) = default;
+    Image(Image&&) = delete;
+    Image& operator=(Image&&) = delete;
 
     constexpr ImageId id() const noexcept { return id_; }
     constexpr ImageFormat format() const noexcept { return format_; }
-    Data const& data() const noexcept { return data_; }
+    /// @returns the RGBA data, decompressing it first if needed.
+    std::shared_ptr<Data const> data() const { return data_.get(); }
+    CompressibleImageData const& storage() const noexcept { return data_; }
     constexpr ImageSize size() const noexcept { return size_; }
     constexpr Width width() const noexcept { return size_.width; }
     constexpr Height height() const noexcept { return size_.height; }
@@ -96,7 +158,7 @@ class Image: public std::enable_shared_from_this<Image>
   private:
     ImageId id_;
     ImageFormat format_;
-    Data data_;
+    CompressibleImageData data_;
     ImageSize size_;
     OnImageRemove onImageRemove_;
 };
@@ -128,6 +190,12 @@ enum class ImageAlignment
 /**
  * RasterizedImage wraps an Image into a fixed-size grid with some additional graphical properties for
  * rasterization.
+ *
+ * The image is resized and aligned to the grid cells it spans by rasterize(), which may run on a
+ * worker thread. Until then, fragments are filled with the default color.
+ *
+ * Once rasterized, the pixels are of the size displayed, such that the source image can be released,
+ * see releaseImage().
  */
 class RasterizedImage: public std::enable_shared_from_this<RasterizedImage>
 {
@@ -138,6 +206,7 @@ class RasterizedImage: public std::enable_shared_from_this<RasterizedImage>
                     RGBAColor _defaultColor,
                     GridSize _cellSpan,
                     ImageSize _cellSize):
+        imageId_ { _image->id() },
         image_ { std::move(_image) },
         alignmentPolicy_ { _alignmentPolicy },
         resizePolicy_ { _resizePolicy },
@@ -155,8 +224,10 @@ class RasterizedImage: public std::enable_shared_from_this<RasterizedImage>
     RasterizedImage& operator=(RasterizedImage const&) = delete;
     RasterizedImage& operator=(RasterizedImage&&) = delete;
 
-    bool valid() const noexcept { return !!image_; }
+    /// @returns the ID of the source image, which remains valid after releasing it.
+    ImageId imageId() const noexcept { return imageId_; }
 
+    /// @returns the source image, unless released.
     std::shared_ptr<Image const> const& imagePointer() const noexcept { return image_; }
     Image const& image() const noexcept { return *image_; }
     ImageAlignment alignmentPolicy() const noexcept { return alignmentPolicy_; }
@@ -165,91 +236,102 @@ class RasterizedImage: public std::enable_shared_from_this<RasterizedImage>
     GridSize cellSpan() const noexcept { return cellSpan_; }
     ImageSize cellSize() const noexcept { return cellSize_; }
 
-    /// @returns an RGBA buffer for a grid cell at given coordinate @p _pos of the rasterized image.
-    Image::Data fragment(CellLocation _pos) const;
-
-  private:
-    std::shared_ptr<Image const> const image_; //!< Reference to the Image to be rasterized.
-    ImageAlignment const alignmentPolicy_;     //!< Alignment policy of the image inside the raster size.
-    ImageResize const resizePolicy_;           //!< Image resize policy
-    RGBAColor const defaultColor_;             //!< Default color to be applied at corners when needed.
-    GridSize const cellSpan_;                  //!< Number of grid cells to span the pixel image onto.
-    ImageSize const cellSize_; //!< number of pixels in X and Y dimension one grid cell has to fill.
-};
-
-/// An ImageFragment holds a graphical image that ocupies one full grid cell.
-class ImageFragment
-{
-  public:
-    ImageFragment() = delete;
-
-    /// @param _image  the Image this fragment is being cut off from
-    /// @param _offset 0-based grid-offset into the rasterized image
-    ImageFragment(std::shared_ptr<RasterizedImage const> _image, CellLocation _offset):
-        rasterizedImage_ { std::move(_image) }, offset_ { _offset }
+    /// @returns the size in pixels of the area spanned by all grid cells.
+    ImageSize pixelSize() const noexcept
     {
-        ++ImageStats::get().fragments;
+        return ImageSize { cellSize_.width * boxed_cast<Width>(cellSpan_.columns),
+                           cellSize_.height * boxed_cast<Height>(cellSpan_.lines) };
     }
 
-    ImageFragment(ImageFragment const&) = delete;
-    ImageFragment& operator=(ImageFragment const&) = delete;
+    /// Resizes and aligns the image into the RGBA buffer of pixelSize(), according to the policies.
+    ///
+    /// This must be invoked once, and may be invoked from any thread.
+    void rasterize();
 
-    ImageFragment(ImageFragment&&) noexcept = default;
-    ImageFragment& operator=(ImageFragment&&) noexcept = default;
+    /// @returns whether rasterize() has completed.
+    bool ready() const noexcept { return ready_.load(std::memory_order_acquire); }
 
-    ~ImageFragment();
+    /// Releases the reference to the source image once ready(), such as when the image scrolls into
+    /// history, as the rasterized pixels are all that is needed to display it from then on.
+    /// The source image itself is freed as soon as no other placement references it.
+    ///
+    /// This does not change the pixels displayed, and is thus considered const.
+    void releaseImage() const;
 
-    [[nodiscard]] RasterizedImage const& rasterizedImage() const noexcept { return *rasterizedImage_; }
+    /// @returns whether the source image has been released.
+    bool imageReleased() const noexcept { return imageReleased_.load(); }
 
-    /// @returns offset of this image fragment in pixels into the underlying image.
-    CellLocation offset() const noexcept { return offset_; }
+    /// @returns the RGBA buffer of pixelSize() once ready(), decompressing it first if needed.
+    std::shared_ptr<Image::Data const> pixels() const { return pixels_.get(); }
+    CompressibleImageData const& storage() const noexcept { return pixels_; }
 
-    /// Extracts the data from the image that is to be rendered.
-    [[nodiscard]] Image::Data data() const { return rasterizedImage_->fragment(offset_); }
+    /// @returns an RGBA buffer for a grid cell at given coordinate @p _pos of the rasterized image.
+    Image::Data fragment(CellLocation _pos) const;
 
   private:
-    std::shared_ptr<RasterizedImage const> rasterizedImage_;
-    CellLocation offset_;
-};
+    void releaseImageIfRequested() const;
 
-namespace detail
-{
-    struct ImageFragmentId;
-}
-using ImageFragmentId = crispy::boxed<uint16_t, detail::ImageFragmentId>;
+    ImageId const imageId_;                        //!< ID of the Image to be rasterized.
+    mutable std::shared_ptr<Image const> image_;   //!< Reference to the Image to be rasterized.
+    ImageAlignment const alignmentPolicy_;     //!< Alignment policy of the image inside the raster size.
+    ImageResize const resizePolicy_;           //!< Image resize policy
+    RGBAColor const defaultColor_;             //!< Default color to be applied at corners when needed.
+    GridSize const cellSpan_;                  //!< Number of grid cells to span the pixel image onto.
+    ImageSize const cellSize_; //!< number of pixels in X and Y dimension one grid cell has to fill.
+    CompressibleImageData pixels_; //!< the resized and aligned image, once ready
+    std::atomic<bool> ready_ = false;
+    mutable std::atomic<bool> imageReleaseRequested_ = false;
+    mutable std::atomic<bool> imageReleased_ = false;
+};
 
-inline bool operator==(ImageFragment const& a, ImageFragment const& b) noexcept
-{
-    return a.rasterizedImage().image().id() == b.rasterizedImage().image().id() && a.offset() == b.offset();
-}
+/// Resizes the given RGBA image, using a bilinear filter to enlarge, and a box filter to shrink it.
+Image::Data resizeImage(Image::Data const& _pixels, ImageSize _size, ImageSize _newSize);
 
-inline bool operator!=(ImageFragment const& a, ImageFragment const& b) noexcept
+/// An ImagePlacement displays a row of a rasterized image in consecutive columns of a line,
+/// each column displaying one grid cell of the image.
+struct ImagePlacement
 {
-    return !(a == b);
-}
+    std::shared_ptr<RasterizedImage const> image;
+    ColumnOffset column;  //!< first column of the line displaying the image
+    ColumnCount columns;  //!< number of columns displaying the image
+    CellLocation offset;  //!< 0-based grid-offset into the rasterized image displayed at @c column
 
-inline bool operator<(ImageFragment const& a, ImageFragment const& b) noexcept
-{
-    return (a.rasterizedImage().image().id() < b.rasterizedImage().image().id())
-           || (a.rasterizedImage().image().id() == b.rasterizedImage().image().id()
-               && a.offset() < b.offset());
-}
+    [[nodiscard]] ColumnOffset end() const noexcept { return column + boxed_cast<ColumnOffset>(columns); }
+};
 
 /// Highlevel Image Storage Pool.
 ///
 /// Stores RGBA images in host memory, also taking care of eviction.
+///
+/// Images are deduplicated by their content, such that an image being sent repeatedly
+/// (e.g. on every redraw of the application) shares one Image, one RasterizedImage per
+/// placement, and thus one set of GPU tiles.
 class ImagePool
 {
   public:
     using OnImageRemove = std::function<void(Image const*)>;
+    using OnImageRasterized = std::function<void()>;
 
     ImagePool(
         OnImageRemove _onImageRemove = [](auto) {}, ImageId _nextImageId = ImageId(1));
+    ~ImagePool();
+
+    ImagePool(ImagePool const&) = delete;
+    ImagePool& operator=(ImagePool const&) = delete;
+
+    /// Configures images to be rasterized on @p _threadCount worker threads,
+    /// or synchronously by rasterize() if @p _threadCount is 0.
+    ///
+    /// @param _onRasterized invoked on the worker thread whenever an image has been rasterized.
+    void setAsyncRasterization(size_t _threadCount, OnImageRasterized _onRasterized);
 
-    /// Creates an RGBA image of given size in pixels.
+    /// Creates an RGBA image of given size in pixels,
+    /// or returns the existing image of identical format, size, and pixels.
     std::shared_ptr<Image const> create(ImageFormat _format, ImageSize _pixelSize, Image::Data&& _data);
 
-    /// Rasterizes an Image.
+    /// Rasterizes an Image, which might not be ready() yet when rasterizing asynchronously.
+    ///
+    /// Rasterizing the same image with the same properties again returns the existing RasterizedImage.
     std::shared_ptr<RasterizedImage> rasterize(std::shared_ptr<Image const> _image,
                                                ImageAlignment _alignmentPolicy,
                                                ImageResize _resizePolicy,
@@ -265,6 +347,17 @@ class ImagePool
 
     void inspect(std::ostream& os) const;
 
+    /// Sums up the pixel data of the images created by this pool that are still alive,
+    /// and of their rasterizations.
+    [[nodiscard]] ImageMemoryUsage memoryUsage() const;
+
+    /// Limits the pixel data held by this pool's images and their rasterizations to about @p _bytes,
+    /// or does not limit it if 0.
+    ///
+    /// Whenever exceeding the budget, the least recently used pixels are compressed in memory,
+    /// such as those of images scrolled out of view, and decompressed again once needed.
+    void setMemoryBudget(size_t _bytes);
+
     void clear();
 
   private:
@@ -272,11 +365,40 @@ class ImagePool
 
     using NameToImageIdCache = crispy::StrongLRUCache<std::string, std::shared_ptr<Image const>>;
 
+    struct ContentHasher
+    {
+        size_t operator()(crispy::StrongHash const& _hash) const noexcept
+        {
+            return static_cast<size_t>(crispy::to_integer(_hash));
+        }
+    };
+    using ContentHashToImageMap =
+        std::unordered_map<crispy::StrongHash, std::weak_ptr<Image const>, ContentHasher>;
+
+    // image ID, alignment, resize, default color, lines, columns, cell width, cell height
+    using RasterizedImageKey =
+        std::tuple<uint32_t, ImageAlignment, ImageResize, uint32_t, int, int, unsigned, unsigned>;
+    using RasterizedImageMap = std::map<RasterizedImageKey, std::weak_ptr<RasterizedImage>>;
+
+    /// Forgets about images and rasterized images that are not referenced anymore,
+    /// once there are about twice as many of them as after the last sweep.
+    void sweepExpiredImages();
+
+    /// Compresses the least recently used pixels while exceeding the memory budget.
+    void enforceMemoryBudget();
+
+    class Rasterizer;
+
     // data members
     //
     ImageId nextImageId_;                      //!< ID for next image to be put into the pool
     NameToImageIdCache imageNameToImageCache_; //!< keeps mapping from name to raw image
     OnImageRemove const onImageRemove_;        //!< Callback to be invoked when image gets removed from pool.
+    ContentHashToImageMap imagesByContent_;    //!< images created so far, by the hash of their content
+    RasterizedImageMap rasterizedImages_;      //!< rasterized images created so far, by their properties
+    size_t sweepThreshold_ = 64;               //!< number of mappings at which to sweep expired ones
+    size_t memoryBudget_ = 0;                  //!< bytes of pixel data to compress beyond, if any
+    std::unique_ptr<Rasterizer> rasterizer_;   //!< Worker threads rasterizing images, if any.
 };
 
 } // namespace terminal
@@ -318,10 +440,9 @@ struct formatter<terminal::ImageStats>
     auto format(terminal::ImageStats stats, FormatContext& ctx)
     {
         return fmt::format_to(ctx.out(),
-                              "{} instances, {} raster, {} fragments",
+                              "{} instances, {} raster",
                               stats.instances,
-                              stats.rasterized,
-                              stats.fragments);
+                              stats.rasterized);
     }
 };
 
@@ -410,17 +531,18 @@ struct formatter<terminal::RasterizedImage>
     auto format(const terminal::RasterizedImage& _image, FormatContext& ctx)
     {
         return fmt::format_to(ctx.out(),
-                              "RasterizedImage<{}, {}, {}, {}, {}>",
+                              "RasterizedImage<{}, {}, {}, {}, image #{}{}>",
                               _image.weak_from_this().use_count(),
                               _image.cellSpan(),
                               _image.resizePolicy(),
                               _image.alignmentPolicy(),
-                              _image.image());
+                              _image.imageId(),
+                              _image.imageReleased() ? " (released)" : "");
     }
 };
 
 template <>
-struct formatter<terminal::ImageFragment>
+struct formatter<terminal::ImagePlacement>
 {
     template <typename ParseContext>
     constexpr auto parse(ParseContext& ctx)
@@ -429,10 +551,14 @@ struct formatter<terminal::ImageFragment>
     }
 
     template <typename FormatContext>
-    auto format(const terminal::ImageFragment& _fragment, FormatContext& ctx)
+    auto format(const terminal::ImagePlacement& _placement, FormatContext& ctx)
     {
-        return fmt::format_to(
-            ctx.out(), "ImageFragment<offset={}, {}>", _fragment.offset(), _fragment.rasterizedImage());
+        return fmt::format_to(ctx.out(),
+                              "ImagePlacement<column={}, columns={}, offset={}, {}>",
+                              _placement.column,
+                              _placement.columns,
+                              _placement.offset,
+                              *_placement.image);
     }
 };
 } // namespace fmt
@@ -0,0 +1,221 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/Image.h>
+
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace terminal;
+
+namespace
+{
+
+auto constexpr Red = RGBAColor { 0xFF0000FF };
+auto constexpr Blank = RGBAColor { 0x00000000 };
+
+Image::Data filled(ImageSize _size, RGBAColor _color)
+{
+    auto data = Image::Data {};
+    for (size_t i = 0; i < _size.area(); ++i)
+        data.insert(data.end(), { _color.red(), _color.green(), _color.blue(), _color.alpha() });
+    return data;
+}
+
+RGBAColor pixelAt(RasterizedImage const& _image, int _x, int _y)
+{
+    auto const* p = _image.pixels()->data() + (_y * unbox<int>(_image.pixelSize().width) + _x) * 4;
+    return RGBAColor { p[0], p[1], p[2], p[3] };
+}
+
+} // namespace
+
+TEST_CASE("Image.resizeImage", "[image]")
+{
+    // A 2x1 image of a black and a white pixel.
+    auto const pixels = Image::Data { 0, 0, 0, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+
+    auto const shrunk =
+        resizeImage(pixels, ImageSize { Width(2), Height(1) }, ImageSize { Width(1), Height(1) });
+    CHECK(shrunk == Image::Data { 0x7F, 0x7F, 0x7F, 0xFF });
+
+    auto const enlarged =
+        resizeImage(pixels, ImageSize { Width(2), Height(1) }, ImageSize { Width(4), Height(1) });
+    REQUIRE(enlarged.size() == 16);
+    CHECK(enlarged[0] == 0x00);
+    CHECK(enlarged[4] < enlarged[8]);
+    CHECK(enlarged[12] == 0xFF);
+}
+
+TEST_CASE("Image.rasterize.policies", "[image]")
+{
+    auto pool = ImagePool {};
+    auto const image = pool.create(ImageFormat::RGBA,
+                                   ImageSize { Width(2), Height(1) },
+                                   filled(ImageSize { Width(2), Height(1) }, Red));
+    auto const cellSize = ImageSize { Width(2), Height(2) };
+    auto const cellSpan = GridSize { LineCount(2), ColumnCount(2) }; // 4x4 pixels
+
+    SECTION("NoResize")
+    {
+        auto const raster =
+            pool.rasterize(image, ImageAlignment::TopStart, ImageResize::NoResize, Blank, cellSpan, cellSize);
+        REQUIRE(raster->ready());
+        CHECK(pixelAt(*raster, 1, 0) == Red);
+        CHECK(pixelAt(*raster, 2, 0) == Blank);
+        CHECK(pixelAt(*raster, 0, 1) == Blank);
+    }
+
+    SECTION("ResizeToFit")
+    {
+        auto const raster = pool.rasterize(
+            image, ImageAlignment::MiddleCenter, ImageResize::ResizeToFit, Blank, cellSpan, cellSize);
+        // 4x2 image, centered vertically.
+        CHECK(pixelAt(*raster, 0, 0) == Blank);
+        CHECK(pixelAt(*raster, 0, 1) == Red);
+        CHECK(pixelAt(*raster, 3, 2) == Red);
+        CHECK(pixelAt(*raster, 3, 3) == Blank);
+    }
+
+    SECTION("ResizeToFill")
+    {
+        auto const raster = pool.rasterize(
+            image, ImageAlignment::TopStart, ImageResize::ResizeToFill, Blank, cellSpan, cellSize);
+        // 8x4 image, cropped to the area.
+        CHECK(pixelAt(*raster, 0, 0) == Red);
+        CHECK(pixelAt(*raster, 3, 3) == Red);
+    }
+
+    SECTION("StretchToFill")
+    {
+        auto const raster = pool.rasterize(
+            image, ImageAlignment::BottomEnd, ImageResize::StretchToFill, Blank, cellSpan, cellSize);
+        CHECK(pixelAt(*raster, 0, 0) == Red);
+        CHECK(pixelAt(*raster, 3, 3) == Red);
+        CHECK(raster->fragment(CellLocation { LineOffset(1), ColumnOffset(1) }) == filled(cellSize, Red));
+    }
+}
+
+TEST_CASE("Image.rasterize.async", "[image]")
+{
+    auto rasterized = std::atomic<int> { 0 };
+    auto pool = ImagePool {};
+    pool.setAsyncRasterization(2, [&]() { ++rasterized; });
+
+    auto const size = ImageSize { Width(64), Height(64) };
+    auto const raster = pool.rasterize(pool.create(ImageFormat::RGBA, size, filled(size, Red)),
+                                       ImageAlignment::TopStart,
+                                       ImageResize::ResizeToFit,
+                                       Blank,
+                                       GridSize { LineCount(2), ColumnCount(2) },
+                                       ImageSize { Width(8), Height(16) });
+
+    for (int i = 0; i < 1000 && !raster->ready(); ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    REQUIRE(raster->ready());
+    CHECK(pixelAt(*raster, 15, 15) == Red);
+    CHECK(pixelAt(*raster, 0, 16) == Blank);
+
+    pool.setAsyncRasterization(0, {});
+    CHECK(rasterized == 1);
+}
+
+TEST_CASE("Image.create.deduplicate", "[image]")
+{
+    auto pool = ImagePool {};
+    auto const size = ImageSize { Width(2), Height(2) };
+    auto const image = pool.create(ImageFormat::RGBA, size, filled(size, Red));
+
+    CHECK(pool.create(ImageFormat::RGBA, size, filled(size, Red)) == image);
+    CHECK(pool.create(ImageFormat::RGBA, size, filled(size, Blank)) != image);
+    CHECK(pool.create(ImageFormat::RGBA, ImageSize { Width(4), Height(1) }, filled(size, Red)) != image);
+
+    auto const cellSpan = GridSize { LineCount(1), ColumnCount(1) };
+    auto const raster =
+        pool.rasterize(image, ImageAlignment::TopStart, ImageResize::NoResize, Blank, cellSpan, size);
+    CHECK(pool.rasterize(image, ImageAlignment::TopStart, ImageResize::NoResize, Blank, cellSpan, size)
+          == raster);
+    CHECK(pool.rasterize(image, ImageAlignment::TopStart, ImageResize::ResizeToFit, Blank, cellSpan, size)
+          != raster);
+
+    // Images no longer referenced are created anew.
+    auto const blueSize = ImageSize { Width(1), Height(1) };
+    auto const blue = RGBAColor { 0, 0, 0xFF, 0xFF };
+    auto const firstBlue = pool.create(ImageFormat::RGBA, blueSize, filled(blueSize, blue))->id();
+    CHECK(pool.create(ImageFormat::RGBA, blueSize, filled(blueSize, blue))->id() != firstBlue);
+}
+
+TEST_CASE("Image.memoryBudget", "[image]")
+{
+    auto pool = ImagePool {};
+    auto const size = ImageSize { Width(64), Height(64) };
+    auto const cellSpan = GridSize { LineCount(4), ColumnCount(4) };
+    auto const cellSize = ImageSize { Width(16), Height(16) };
+    auto const blue = RGBAColor { 0, 0, 0xFF, 0xFF };
+
+    auto const red = pool.create(ImageFormat::RGBA, size, filled(size, Red));
+    auto const redRaster =
+        pool.rasterize(red, ImageAlignment::TopStart, ImageResize::NoResize, Blank, cellSpan, cellSize);
+    auto const uncompressed = pool.memoryUsage();
+    CHECK(uncompressed.compressed == 0);
+
+    // Exceeding the budget compresses the least recently used pixels first.
+    pool.setMemoryBudget(2 * size.area() * 4 + 1024);
+    auto const other = pool.create(ImageFormat::RGBA, size, filled(size, blue));
+    CHECK(red->storage().compressed());
+    CHECK(!redRaster->storage().compressed());
+    CHECK(!other->storage().compressed());
+    CHECK(pool.memoryUsage().compressed == 1);
+
+    // Compressed pixels are decompressed on demand.
+    auto const otherRaster =
+        pool.rasterize(other, ImageAlignment::TopStart, ImageResize::NoResize, Blank, cellSpan, cellSize);
+    CHECK(redRaster->storage().compressed());
+    CHECK(!otherRaster->storage().compressed());
+    CHECK(*red->data() == filled(size, Red));
+    CHECK(pixelAt(*redRaster, 63, 63) == Red);
+    CHECK(pixelAt(*otherRaster, 63, 63) == blue);
+    CHECK(redRaster->fragment(CellLocation { LineOffset(3), ColumnOffset(3) }) == filled(cellSize, Red));
+}
+
+TEST_CASE("Image.rasterize.releaseImage", "[image]")
+{
+    auto pool = ImagePool {};
+    auto const size = ImageSize { Width(16), Height(16) };
+    auto const cellSpan = GridSize { LineCount(1), ColumnCount(1) };
+    auto const cellSize = ImageSize { Width(8), Height(8) };
+    auto image = pool.create(ImageFormat::RGBA, size, filled(size, Red));
+    auto const source = std::weak_ptr<Image const>(image);
+    auto const raster = pool.rasterize(
+        image, ImageAlignment::TopStart, ImageResize::ResizeToFit, Blank, cellSpan, cellSize);
+
+    // Releasing is deferred until rasterized.
+    auto const pending = std::make_shared<RasterizedImage>(
+        std::move(image), ImageAlignment::TopStart, ImageResize::NoResize, Blank, cellSpan, cellSize);
+    pending->releaseImage();
+    CHECK(!pending->imageReleased());
+    pending->rasterize();
+    CHECK(pending->imageReleased());
+
+    // Only the rasterized pixels, of the size displayed, are kept.
+    CHECK(!source.expired());
+    raster->releaseImage();
+    CHECK(raster->imageReleased());
+    CHECK(source.expired());
+    CHECK(raster->imageId() == pending->imageId());
+    CHECK(pixelAt(*raster, 7, 7) == Red);
+    CHECK(pixelAt(*pending, 7, 7) == Red);
+}
@@ -18,6 +18,10 @@
 
 #include <fmt/format.h>
 
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
 namespace terminal
 {
 
@@ -67,6 +71,61 @@ bool operator<(InputBinding<I, O> const& a, InputBinding<I, O> const& b) noexcep
     return false;
 }
 
+/// Input bindings compiled for matching input events against them, e.g. while processing
+/// high-rate mouse move events against large keymaps.
+///
+/// Bindings are hashed by their input and modifier, and the match modes of the bindings
+/// sharing the same input and modifier are tested as bitmasks, in the order given.
+template <typename Input, typename Binding>
+class InputBindingTable
+{
+  public:
+    InputBindingTable() = default;
+
+    explicit InputBindingTable(std::vector<InputBinding<Input, Binding>> const& _bindings)
+    {
+        for (InputBinding<Input, Binding> const& binding: _bindings)
+        {
+            auto const enabled = static_cast<uint8_t>(binding.modes.enabled());
+            auto const disabled = static_cast<uint8_t>(binding.modes.disabled() & ~enabled);
+            candidates_[key(binding.input, binding.modifier)].push_back(
+                Candidate { enabled, disabled, binding.binding });
+        }
+    }
+
+    /// Returns the first binding matching the given input event, or nullptr if none matches.
+    [[nodiscard]] Binding const* find(Input _input, Modifier _modifier, uint8_t _actualModeFlags) const
+    {
+        auto const i = candidates_.find(key(_input, _modifier));
+        if (i == candidates_.end())
+            return nullptr;
+
+        for (Candidate const& candidate: i->second)
+            if ((_actualModeFlags & candidate.enabled) == candidate.enabled
+                && (_actualModeFlags & candidate.disabled) == 0)
+                return &candidate.binding;
+
+        return nullptr;
+    }
+
+    [[nodiscard]] bool empty() const noexcept { return candidates_.empty(); }
+
+  private:
+    struct Candidate
+    {
+        uint8_t enabled;  // mode flags that must be set
+        uint8_t disabled; // mode flags that must not be set
+        Binding binding;
+    };
+
+    static uint64_t key(Input _input, Modifier _modifier) noexcept
+    {
+        return static_cast<uint64_t>(_input) << 32 | _modifier.value();
+    }
+
+    std::unordered_map<uint64_t, std::vector<Candidate>> candidates_;
+};
+
 } // namespace terminal
 
 namespace fmt
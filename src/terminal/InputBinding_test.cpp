@@ -0,0 +1,79 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/InputBinding.h>
+
+#include <catch2/catch.hpp>
+
+#include <string>
+#include <vector>
+
+using namespace terminal;
+
+namespace
+{
+MatchModes modes(MatchModes::Flag _enabled, MatchModes::Flag _disabled = MatchModes::Default)
+{
+    auto result = MatchModes {};
+    if (_enabled != MatchModes::Default)
+        result.enable(_enabled);
+    if (_disabled != MatchModes::Default)
+        result.disable(_disabled);
+    return result;
+}
+} // namespace
+
+TEST_CASE("InputBindingTable.find", "[input]")
+{
+    using Binding = InputBinding<Key, std::string>;
+    auto const control = Modifier { Modifier::Control };
+    auto const bindings = std::vector<Binding> {
+        Binding { modes(MatchModes::AlternateScreen), control, Key::F1, "alt" },
+        Binding { modes(MatchModes::Default, MatchModes::Select), control, Key::F1, "not-select" },
+        Binding { MatchModes {}, control, Key::F1, "any" },
+        Binding { MatchModes {}, Modifier {}, Key::F2, "plain" },
+    };
+    auto const table = InputBindingTable<Key, std::string> { bindings };
+
+    auto const find = [&](Key _key, Modifier _modifier, uint8_t _flags) -> std::string {
+        auto const* binding = table.find(_key, _modifier, _flags);
+        return binding ? *binding : "none";
+    };
+
+    // The first matching binding wins.
+    CHECK(find(Key::F1, control, MatchModes::AlternateScreen) == "alt");
+    CHECK(find(Key::F1, control, MatchModes::AlternateScreen | MatchModes::Select) == "alt");
+    CHECK(find(Key::F1, control, 0) == "not-select");
+    CHECK(find(Key::F1, control, MatchModes::Select) == "any");
+
+    CHECK(find(Key::F2, Modifier {}, MatchModes::Search) == "plain");
+    CHECK(find(Key::F2, control, 0) == "none");
+    CHECK(find(Key::F3, Modifier {}, 0) == "none");
+}
+
+TEST_CASE("InputBindingTable.char", "[input]")
+{
+    using Binding = InputBinding<char32_t, int>;
+    auto controlShift = Modifier { Modifier::Control };
+    controlShift |= Modifier::Shift;
+    auto const bindings = std::vector<Binding> {
+        Binding { MatchModes {}, Modifier { Modifier::Control }, U'c', 1 },
+        Binding { MatchModes {}, controlShift, U'c', 2 },
+    };
+    auto const table = InputBindingTable<char32_t, int> { bindings };
+
+    CHECK(*table.find(U'c', Modifier { Modifier::Control }, 0) == 1);
+    CHECK(*table.find(U'c', controlShift, 0) == 2);
+    CHECK(table.find(U'c', Modifier {}, 0) == nullptr);
+    CHECK(table.find(U'C', Modifier { Modifier::Control }, 0) == nullptr);
+}
@@ -292,6 +292,8 @@ void InputGenerator::reset()
     mouseProtocol_ = std::nullopt;
     mouseTransport_ = MouseTransport::Default;
     mouseWheelMode_ = MouseWheelMode::Default;
+    lastMouseMoveReport_ = std::nullopt;
+    pendingMouseMove_ = std::nullopt;
 
     // pendingSequence_ = {};
     // currentlyPressedMouseButtons_ = {};
@@ -410,30 +412,50 @@ void InputGenerator::generatePaste(std::string_view const& _text)
     if (_text.empty())
         return;
 
+    generatePasteBegin();
+    generatePasteChunk(_text);
+    generatePasteEnd();
+}
+
+void InputGenerator::generatePasteBegin()
+{
     if (bracketedPaste_)
         append("\033[200~"sv);
+    streamingPaste_ = true;
+}
 
-    append(_text);
+void InputGenerator::generatePasteChunk(std::string_view _text)
+{
+    pendingSequence_.insert(end(pendingSequence_), begin(_text), end(_text));
+}
 
+void InputGenerator::generatePasteEnd()
+{
+    streamingPaste_ = false;
     if (bracketedPaste_)
         append("\033[201~"sv);
+
+    // Input held back while streaming would have ended up in the middle of the paste otherwise.
+    pendingSequence_.insert(end(pendingSequence_), begin(heldBackSequence_), end(heldBackSequence_));
+    heldBackSequence_.clear();
 }
 
 inline bool InputGenerator::append(std::string_view _sequence)
 {
-    pendingSequence_.insert(end(pendingSequence_), begin(_sequence), end(_sequence));
+    auto& sequence = streamingPaste_ ? heldBackSequence_ : pendingSequence_;
+    sequence.insert(end(sequence), begin(_sequence), end(_sequence));
     return true;
 }
 
 inline bool InputGenerator::append(char _asciiChar)
 {
-    pendingSequence_.push_back(_asciiChar);
+    (streamingPaste_ ? heldBackSequence_ : pendingSequence_).push_back(_asciiChar);
     return true;
 }
 
 inline bool InputGenerator::append(uint8_t _byte)
 {
-    pendingSequence_.push_back(static_cast<char>(_byte));
+    (streamingPaste_ ? heldBackSequence_ : pendingSequence_).push_back(static_cast<char>(_byte));
     return true;
 }
 
@@ -715,6 +737,10 @@ bool InputGenerator::generateMousePress(Modifier _modifier,
     if (!mouseProtocol_.has_value())
         return false;
 
+    // The application must see where the mouse was moved to before it got pressed there.
+    if (auto const pending = std::exchange(pendingMouseMove_, std::nullopt))
+        generateMouseMove(*pending, lastMouseMoveReportTime_ + mouseMoveReportInterval_);
+
     switch (mouseWheelMode())
     {
         case MouseWheelMode::NormalCursorKeys:
@@ -757,6 +783,9 @@ bool InputGenerator::generateMouseRelease(Modifier _modifier,
 
     currentMousePosition_ = _pos;
 
+    if (auto const pending = std::exchange(pendingMouseMove_, std::nullopt))
+        generateMouseMove(*pending, lastMouseMoveReportTime_ + mouseMoveReportInterval_);
+
     if (auto i = currentlyPressedMouseButtons_.find(_button); i != currentlyPressedMouseButtons_.end())
         currentlyPressedMouseButtons_.erase(i);
 
@@ -764,21 +793,11 @@ bool InputGenerator::generateMouseRelease(Modifier _modifier,
         generateMouse(MouseEventType::Release, _modifier, _button, currentMousePosition_, _pixelPosition));
 }
 
-bool InputGenerator::generateMouseMove(Modifier _modifier, CellLocation _pos, PixelCoordinate _pixelPosition)
+bool InputGenerator::generateMouseMove(Modifier _modifier,
+                                       CellLocation _pos,
+                                       PixelCoordinate _pixelPosition,
+                                       std::chrono::steady_clock::time_point _now)
 {
-    auto const logged = [&](bool success) -> bool {
-        if (success)
-        {
-            InputLog()("[{}:{}] Sending mouse move at {} ({}:{}).",
-                       mouseProtocol_.value(),
-                       mouseTransport_,
-                       _pos,
-                       _pixelPosition.x.value,
-                       _pixelPosition.y.value);
-        }
-        return success;
-    };
-
     currentMousePosition_ = _pos;
 
     if (!mouseProtocol_.has_value())
@@ -789,16 +808,73 @@ bool InputGenerator::generateMouseMove(Modifier _modifier, CellLocation _pos, Pi
     bool const report = (mouseProtocol_.value() == MouseProtocol::ButtonTracking && buttonsPressed)
                         || mouseProtocol_.value() == MouseProtocol::AnyEventTracking;
 
-    if (report)
-        return logged(generateMouse(
-            MouseEventType::Drag,
-            _modifier,
-            buttonsPressed ? *currentlyPressedMouseButtons_.begin() // what if multiple are pressed?
-                           : MouseButton::Release,
-            _pos,
-            _pixelPosition));
+    if (!report)
+        return false;
 
-    return false;
+    auto const move = MouseMove {
+        _modifier,
+        buttonsPressed ? *currentlyPressedMouseButtons_.begin() // what if multiple are pressed?
+                       : MouseButton::Release,
+        _pos,
+        _pixelPosition,
+    };
+
+    if (lastMouseMoveReport_ && isSameMouseMoveReport(move, *lastMouseMoveReport_))
+    {
+        // Nothing to report, or moved back to where it was reported last before the pending move
+        // got reported.
+        pendingMouseMove_ = std::nullopt;
+        return true;
+    }
+
+    if (_now < lastMouseMoveReportTime_ + mouseMoveReportInterval_)
+    {
+        pendingMouseMove_ = move;
+        return true;
+    }
+
+    pendingMouseMove_ = std::nullopt;
+    generateMouseMove(move, _now);
+    return true;
+}
+
+bool InputGenerator::generatePendingMouseMove(std::chrono::steady_clock::time_point _now)
+{
+    if (!pendingMouseMove_ || _now < lastMouseMoveReportTime_ + mouseMoveReportInterval_)
+        return false;
+
+    auto const move = *std::exchange(pendingMouseMove_, std::nullopt);
+    return generateMouseMove(move, _now);
+}
+
+bool InputGenerator::isSameMouseMoveReport(MouseMove const& _a, MouseMove const& _b) const noexcept
+{
+    if (_a.modifier != _b.modifier || _a.button != _b.button)
+        return false;
+
+    if (mouseTransport_ == MouseTransport::SGRPixels)
+        return _a.pixelPosition.x.value == _b.pixelPosition.x.value
+               && _a.pixelPosition.y.value == _b.pixelPosition.y.value;
+
+    return _a.position == _b.position;
+}
+
+bool InputGenerator::generateMouseMove(MouseMove const& _move, std::chrono::steady_clock::time_point _now)
+{
+    if (!generateMouse(
+            MouseEventType::Drag, _move.modifier, _move.button, _move.position, _move.pixelPosition))
+        return false;
+
+    InputLog()("[{}:{}] Sending mouse move at {} ({}:{}).",
+               mouseProtocol_.value(),
+               mouseTransport_,
+               _move.position,
+               _move.pixelPosition.x.value,
+               _move.pixelPosition.y.value);
+
+    lastMouseMoveReport_ = _move;
+    lastMouseMoveReportTime_ = _now;
+    return true;
 }
 // }}}
 
@@ -20,6 +20,7 @@
 
 #include <unicode/convert.h>
 
+#include <chrono>
 #include <mutex>
 #include <optional>
 #include <set>
@@ -292,16 +293,47 @@ class InputGenerator
     bool generate(std::u32string const& _characterEvent, Modifier _modifier);
     bool generate(Key _key, Modifier _modifier);
     void generatePaste(std::string_view const& _text);
+
+    /// Generates a paste that is streamed in multiple chunks.
+    ///
+    /// The chunks in between generatePasteBegin() and generatePasteEnd() are enclosed
+    /// into a single bracketed paste, if enabled. Any other input generated meanwhile, such as
+    /// key presses or mouse reports, is held back until generatePasteEnd().
+    void generatePasteBegin();
+    void generatePasteChunk(std::string_view _text);
+    void generatePasteEnd();
     bool generateMousePress(Modifier _modifier,
                             MouseButton _button,
                             CellLocation _pos,
                             PixelCoordinate _pixelPosition);
-    bool generateMouseMove(Modifier _modifier, CellLocation _pos, PixelCoordinate _pixelPosition);
+
+    /// Reports the mouse move to the application, if the mouse protocol asks for it.
+    ///
+    /// @return true if the mouse move is consumed by the mouse protocol, whether it got reported,
+    ///         deferred (see setMouseMoveReportInterval()), or was redundant.
+    bool generateMouseMove(Modifier _modifier,
+                           CellLocation _pos,
+                           PixelCoordinate _pixelPosition,
+                           std::chrono::steady_clock::time_point _now);
     bool generateMouseRelease(Modifier _modifier,
                               MouseButton _button,
                               CellLocation _pos,
                               PixelCoordinate _pixelPosition);
 
+    /// Sets the minimum time between two mouse move reports, usually the duration of one display frame.
+    ///
+    /// Mouse moves within that time are coalesced into a single report of the latest one,
+    /// which is then generated by generatePendingMouseMove() once due.
+    /// Mouse moves within the same grid cell are not reported, unless reporting pixel positions.
+    void setMouseMoveReportInterval(std::chrono::microseconds _interval) noexcept
+    {
+        mouseMoveReportInterval_ = _interval;
+    }
+
+    /// Generates the mouse move report deferred by generateMouseMove(), if any and due by now.
+    bool generatePendingMouseMove(std::chrono::steady_clock::time_point _now);
+    [[nodiscard]] bool hasPendingMouseMove() const noexcept { return pendingMouseMove_.has_value(); }
+
     bool generateFocusInEvent();
     bool generateFocusOutEvent();
 
@@ -338,6 +370,17 @@ class InputGenerator
     void reset();
 
   private:
+    struct MouseMove
+    {
+        Modifier modifier;
+        MouseButton button;
+        CellLocation position;
+        PixelCoordinate pixelPosition;
+    };
+
+    [[nodiscard]] bool isSameMouseMoveReport(MouseMove const& _a, MouseMove const& _b) const noexcept;
+    bool generateMouseMove(MouseMove const& _move, std::chrono::steady_clock::time_point _now);
+
     bool generateMouse(MouseEventType _eventType,
                        Modifier _modifier,
                        MouseButton _button,
@@ -372,9 +415,16 @@ class InputGenerator
     MouseWheelMode mouseWheelMode_ = MouseWheelMode::Default;
     Sequence pendingSequence_ {};
     int consumedBytes_ {};
+    bool streamingPaste_ = false;
+    Sequence heldBackSequence_ {}; // input generated while streaming a paste
 
     std::set<MouseButton> currentlyPressedMouseButtons_ {};
     CellLocation currentMousePosition_ {}; // current mouse position
+
+    std::chrono::microseconds mouseMoveReportInterval_ {};
+    std::chrono::steady_clock::time_point lastMouseMoveReportTime_ {};
+    std::optional<MouseMove> lastMouseMoveReport_ {};
+    std::optional<MouseMove> pendingMouseMove_ {};
 };
 
 inline std::string to_string(InputGenerator::MouseEventType _value)
@@ -20,6 +20,7 @@
 #include <catch2/catch.hpp>
 
 #include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <iterator>
 #include <string>
@@ -48,6 +49,22 @@ TEST_CASE("InputGenerator.consume")
     REQUIRE(input.peek() == ""sv);
 }
 
+TEST_CASE("InputGenerator.streamedPaste", "[terminal,input]")
+{
+    auto input = InputGenerator {};
+    input.setBracketedPaste(true);
+    input.generatePasteBegin();
+    input.generatePasteChunk("ab"sv);
+
+    // Input generated while streaming the paste is held back until it is complete.
+    input.generate(U'x', Modifier::None);
+    input.generatePasteChunk("cd"sv);
+    CHECK(escape(input.peek()) == escape("\033[200~abcd"sv));
+
+    input.generatePasteEnd();
+    CHECK(escape(input.peek()) == escape("\033[200~abcd\033[201~x"sv));
+}
+
 TEST_CASE("InputGenerator.Ctrl+Space", "[terminal,input]")
 {
     auto input = InputGenerator {};
@@ -122,3 +139,53 @@ TEST_CASE("InputGenerator.all(Ctrl + A..Z)", "[terminal,input]")
         REQUIRE(escape(input.peek()) == escape(c0));
     }
 }
+
+TEST_CASE("InputGenerator.mouseMove.coalesced", "[terminal,input]")
+{
+    using namespace std::chrono_literals;
+    using terminal::CellLocation;
+    using terminal::ColumnOffset;
+    using terminal::LineOffset;
+    using terminal::MouseProtocol;
+    using terminal::MouseTransport;
+    using terminal::PixelCoordinate;
+
+    auto input = InputGenerator {};
+    input.setMouseProtocol(MouseProtocol::AnyEventTracking, true);
+    input.setMouseTransport(MouseTransport::SGR);
+    input.setMouseMoveReportInterval(10ms);
+
+    auto const clockBase = chrono::steady_clock::time_point();
+    auto const cell = [](int column) {
+        return CellLocation { LineOffset(0), ColumnOffset(column) };
+    };
+    auto const take = [&]() {
+        auto const text = string(input.peek());
+        input.consume(static_cast<int>(text.size()));
+        return escape(text);
+    };
+
+    REQUIRE(input.generateMouseMove(Modifier {}, cell(1), PixelCoordinate {}, clockBase + 10ms));
+    CHECK(take() == escape("\033[<35;2;1M"));
+
+    // Moves within the same frame are coalesced into the latest one.
+    REQUIRE(input.generateMouseMove(Modifier {}, cell(2), PixelCoordinate {}, clockBase + 12ms));
+    REQUIRE(input.generateMouseMove(Modifier {}, cell(3), PixelCoordinate {}, clockBase + 14ms));
+    CHECK(take().empty());
+    CHECK(input.hasPendingMouseMove());
+    CHECK(!input.generatePendingMouseMove(clockBase + 16ms));
+    CHECK(input.generatePendingMouseMove(clockBase + 20ms));
+    CHECK(take() == escape("\033[<35;4;1M"));
+    CHECK(!input.hasPendingMouseMove());
+
+    // Moving back to the last reported cell within the same frame reports nothing.
+    REQUIRE(input.generateMouseMove(Modifier {}, cell(4), PixelCoordinate {}, clockBase + 22ms));
+    REQUIRE(input.generateMouseMove(Modifier {}, cell(3), PixelCoordinate {}, clockBase + 24ms));
+    CHECK(!input.hasPendingMouseMove());
+    CHECK(take().empty());
+
+    // A mouse press first reports where the mouse was moved to.
+    REQUIRE(input.generateMouseMove(Modifier {}, cell(5), PixelCoordinate {}, clockBase + 26ms));
+    input.generateMousePress(Modifier {}, terminal::MouseButton::Left, cell(5), PixelCoordinate {});
+    CHECK(take() == escape("\033[<35;6;1M\033[<0;6;1M"));
+}
@@ -0,0 +1,224 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/KittyGraphics.h>
+
+#include <crispy/utils.h>
+
+#include <fmt/format.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#if !defined(_WIN32)
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+using std::nullopt;
+using std::optional;
+using std::string;
+using std::string_view;
+
+namespace terminal
+{
+
+namespace
+{
+    template <typename T>
+    T toNumber(string_view _value) noexcept
+    {
+        return crispy::to_integer<10, T>(_value).value_or(T {});
+    }
+
+#if !defined(_WIN32)
+    KittyGraphicsError systemError(string_view _what)
+    {
+        return KittyGraphicsError { fmt::format(
+            "{}:{}: {}", errno == ENOENT ? "ENOENT" : "EBADF", _what, strerror(errno)) };
+    }
+
+    /// Tests whether the given path is one that may be removed after reading its contents.
+    ///
+    /// Just like kitty, only files in a temporary directory whose name contains
+    /// "tty-graphics-protocol" are accepted.
+    bool isTemporaryImageFile(string const& _path)
+    {
+        if (_path.find("tty-graphics-protocol") == string::npos || _path.find("..") != string::npos)
+            return false;
+
+        auto const startsWith = [&](string_view _prefix) {
+            return !_prefix.empty() && string_view(_path).substr(0, _prefix.size()) == _prefix;
+        };
+
+        if (startsWith("/tmp/") || startsWith("/dev/shm/"))
+            return true;
+
+        if (char const* tempDir = getenv("TMPDIR"); tempDir && *tempDir)
+        {
+            auto prefix = string(tempDir);
+            if (prefix.back() != '/')
+                prefix += '/';
+            return startsWith(prefix);
+        }
+
+        return false;
+    }
+#endif
+} // namespace
+
+optional<KittyGraphicsCommand> KittyGraphicsCommand::parse(string_view _apc)
+{
+    if (_apc.empty() || _apc.front() != 'G')
+        return nullopt;
+
+    auto command = KittyGraphicsCommand {};
+
+    auto const separator = _apc.find(';');
+    auto control = _apc.substr(1, separator == string_view::npos ? string_view::npos : separator - 1);
+    if (separator != string_view::npos)
+        command.payload = _apc.substr(separator + 1);
+
+    while (!control.empty())
+    {
+        auto const comma = control.find(',');
+        auto const keyValue = control.substr(0, comma);
+        control = comma == string_view::npos ? string_view {} : control.substr(comma + 1);
+
+        if (keyValue.size() < 3 || keyValue[1] != '=')
+            continue;
+
+        auto const value = keyValue.substr(2);
+        switch (keyValue[0])
+        {
+            case 'a': command.action = value.front(); break;
+            case 'f': command.format = toNumber<unsigned>(value); break;
+            case 't': command.medium = value.front(); break;
+            case 's': command.width = toNumber<unsigned>(value); break;
+            case 'v': command.height = toNumber<unsigned>(value); break;
+            case 'S': command.dataSize = toNumber<size_t>(value); break;
+            case 'O': command.dataOffset = toNumber<size_t>(value); break;
+            case 'i': command.imageId = toNumber<unsigned>(value); break;
+            case 'm': command.more = toNumber<unsigned>(value) != 0; break;
+            case 'q': command.quiet = toNumber<unsigned>(value); break;
+            case 'c': command.columns = toNumber<unsigned>(value); break;
+            case 'r': command.rows = toNumber<unsigned>(value); break;
+            case 'C': command.moveCursor = toNumber<unsigned>(value) == 0; break;
+            case 'd': command.deleteWhat = value.front(); break;
+            default: break; // Ignore keys not understood.
+        }
+    }
+
+    return command;
+}
+
+std::variant<Image::Data, KittyGraphicsError> toRGBA(KittyGraphicsCommand const& _command,
+                                                     string_view _pixels)
+{
+    if (_command.format != 24 && _command.format != 32)
+        return KittyGraphicsError { fmt::format("EINVAL:unsupported format {}", _command.format) };
+
+    if (!_command.width || !_command.height)
+        return KittyGraphicsError { "EINVAL:image width and height are required" };
+
+    auto const pixelCount = static_cast<size_t>(_command.width) * _command.height;
+    if (_pixels.size() < pixelCount * _command.bytesPerPixel())
+        return KittyGraphicsError { "ENODATA:insufficient image data" };
+
+    auto rgba = Image::Data(pixelCount * 4);
+    if (_command.format == 32)
+    {
+        std::memcpy(rgba.data(), _pixels.data(), rgba.size());
+        return rgba;
+    }
+
+    auto const* source = reinterpret_cast<uint8_t const*>(_pixels.data());
+    auto* target = rgba.data();
+    for (size_t i = 0; i < pixelCount; ++i, source += 3, target += 4)
+    {
+        target[0] = source[0];
+        target[1] = source[1];
+        target[2] = source[2];
+        target[3] = 0xFF;
+    }
+    return rgba;
+}
+
+std::variant<Image::Data, KittyGraphicsError> loadKittyImageData(KittyGraphicsCommand const& _command,
+                                                                 string const& _source)
+{
+#if defined(_WIN32)
+    (void) _source;
+    return KittyGraphicsError { fmt::format("EINVAL:transmission medium {} not supported",
+                                            _command.medium) };
+#else
+    int fd = -1;
+    switch (_command.medium)
+    {
+        case 't':
+            if (!isTemporaryImageFile(_source))
+                return KittyGraphicsError { "EPERM:not a temporary image file" };
+            [[fallthrough]];
+        case 'f':
+            // Non-blocking, such that a FIFO being passed cannot stall the terminal.
+            fd = ::open(_source.c_str(), O_RDONLY | O_CLOEXEC | O_NONBLOCK);
+            break;
+        case 's': fd = ::shm_open(_source.c_str(), O_RDONLY, 0); break;
+        default:
+            return KittyGraphicsError { fmt::format("EINVAL:transmission medium {} not supported",
+                                                    _command.medium) };
+    }
+
+    if (fd < 0)
+        return systemError(_source);
+
+    auto const _ = crispy::finally { [&]() {
+        ::close(fd);
+        if (_command.medium == 't')
+            ::unlink(_source.c_str());
+        else if (_command.medium == 's')
+            ::shm_unlink(_source.c_str());
+    } };
+
+    struct stat st
+    {
+    };
+    if (fstat(fd, &st) != 0)
+        return systemError(_source);
+
+    if (_command.medium != 's' && !S_ISREG(st.st_mode))
+        return KittyGraphicsError { "EINVAL:not a regular file" };
+
+    auto const fileSize = static_cast<size_t>(st.st_size);
+    auto const offset = _command.dataOffset;
+    if (offset >= fileSize)
+        return KittyGraphicsError { "EINVAL:offset out of bounds" };
+    auto const size = _command.dataSize ? _command.dataSize : fileSize - offset;
+    if (size > fileSize - offset)
+        return KittyGraphicsError { "EINVAL:size out of bounds" };
+
+    auto* mapping = ::mmap(nullptr, offset + size, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED)
+        return systemError(_source);
+
+    auto result = toRGBA(_command, string_view(static_cast<char const*>(mapping) + offset, size));
+    ::munmap(mapping, offset + size);
+    return result;
+#endif
+}
+
+} // namespace terminal
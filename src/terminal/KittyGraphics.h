@@ -0,0 +1,83 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <terminal/Image.h>
+#include <terminal/primitives.h>
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <variant>
+
+namespace terminal
+{
+
+/// A command of the kitty graphics protocol.
+///
+///     APC G <key>=<value>,... ; <payload> ST
+///
+/// Only the keys needed to transmit RGB(A) images and to display them at the cursor position
+/// are understood, see https://sw.kovidgoyal.net/kitty/graphics-protocol/.
+struct KittyGraphicsCommand
+{
+    char action = 't';           //!< a: t(ransmit), T(ransmit and display), p(ut), d(elete), q(uery)
+    unsigned format = 32;        //!< f: 24 (RGB) or 32 (RGBA)
+    char medium = 'd';           //!< t: d(irect), f(ile), t(emporary file), s(hared memory)
+    unsigned width = 0;          //!< s: image width in pixels
+    unsigned height = 0;         //!< v: image height in pixels
+    size_t dataSize = 0;         //!< S: number of bytes to read from a file or shared memory object
+    size_t dataOffset = 0;       //!< O: offset to start reading from a file or shared memory object
+    unsigned imageId = 0;        //!< i: client chosen image ID
+    bool more = false;           //!< m: whether more chunks of a direct transmission follow
+    unsigned quiet = 0;          //!< q: 1 suppresses OK responses, 2 also suppresses errors
+    unsigned columns = 0;        //!< c: number of grid columns to display the image in
+    unsigned rows = 0;           //!< r: number of grid lines to display the image in
+    bool moveCursor = true;      //!< C: whether to move the cursor past the displayed image
+    char deleteWhat = 'a';       //!< d: what to delete
+    std::string_view payload {}; //!< base64 encoded pixels (direct), path, or shared memory name.
+
+    /// Parses the given APC string, including its leading 'G'.
+    ///
+    /// @returns the command or std::nullopt if the APC string is not a graphics command.
+    [[nodiscard]] static std::optional<KittyGraphicsCommand> parse(std::string_view _apc);
+
+    [[nodiscard]] unsigned bytesPerPixel() const noexcept { return format == 24 ? 3 : 4; }
+};
+
+/// Error response of a kitty graphics command, such as "ENOENT:no such file".
+struct KittyGraphicsError
+{
+    std::string message;
+};
+
+/// Converts the transmitted pixels of the given command into an RGBA image buffer.
+///
+/// @param _command the (first) command of the transmission, defining format and image size
+/// @param _pixels  the raw pixels, as sent directly or read via loadKittyImageData()
+std::variant<Image::Data, KittyGraphicsError> toRGBA(KittyGraphicsCommand const& _command,
+                                                     std::string_view _pixels);
+
+/// Loads the pixels referred to by a file, temporary file, or shared memory transmission.
+///
+/// The pixels are read straight from a memory mapping of the file or shared memory object rather
+/// than being passed through the PTY. As in kitty, temporary files and shared memory objects are
+/// removed after being read, and only regular files are accepted.
+///
+/// @param _command the command of the transmission, defining medium, format, size, and offset
+/// @param _source  the decoded payload of the command, i.e. the path or shared memory object name
+std::variant<Image::Data, KittyGraphicsError> loadKittyImageData(KittyGraphicsCommand const& _command,
+                                                                 std::string const& _source);
+
+} // namespace terminal
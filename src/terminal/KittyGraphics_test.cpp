@@ -0,0 +1,162 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/KittyGraphics.h>
+
+#include <catch2/catch.hpp>
+
+#include <cstdlib>
+#include <string>
+#include <string_view>
+
+#if !defined(_WIN32)
+    #include <sys/mman.h>
+
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+using namespace terminal;
+using std::string;
+using std::string_view;
+
+namespace
+{
+
+#if !defined(_WIN32)
+bool exists(string const& _path)
+{
+    return ::access(_path.c_str(), F_OK) == 0;
+}
+
+void writeAll(int _fd, string_view _data)
+{
+    REQUIRE(::write(_fd, _data.data(), _data.size()) == static_cast<ssize_t>(_data.size()));
+}
+#endif
+
+} // namespace
+
+TEST_CASE("KittyGraphics.parse", "[kitty]")
+{
+    CHECK(!KittyGraphicsCommand::parse("Xa=T;"));
+
+    auto const command = KittyGraphicsCommand::parse("Ga=T,f=24,t=s,s=2,v=3,i=42,q=1,C=1,m=1;abc");
+    REQUIRE(command);
+    CHECK(command->action == 'T');
+    CHECK(command->format == 24);
+    CHECK(command->medium == 's');
+    CHECK(command->width == 2);
+    CHECK(command->height == 3);
+    CHECK(command->imageId == 42);
+    CHECK(command->quiet == 1);
+    CHECK(!command->moveCursor);
+    CHECK(command->more);
+    CHECK(command->payload == "abc");
+
+    auto const defaults = KittyGraphicsCommand::parse("G");
+    REQUIRE(defaults);
+    CHECK(defaults->action == 't');
+    CHECK(defaults->format == 32);
+    CHECK(defaults->medium == 'd');
+    CHECK(defaults->moveCursor);
+    CHECK(defaults->payload.empty());
+}
+
+TEST_CASE("KittyGraphics.toRGBA", "[kitty]")
+{
+    auto command = KittyGraphicsCommand {};
+    command.format = 24;
+    command.width = 2;
+    command.height = 1;
+
+    auto const rgba = toRGBA(command, "\x01\x02\x03\x04\x05\x06");
+    REQUIRE(std::holds_alternative<Image::Data>(rgba));
+    CHECK(std::get<Image::Data>(rgba) == Image::Data { 1, 2, 3, 0xFF, 4, 5, 6, 0xFF });
+
+    auto const insufficient = toRGBA(command, "\x01\x02\x03");
+    REQUIRE(std::holds_alternative<KittyGraphicsError>(insufficient));
+    CHECK(std::get<KittyGraphicsError>(insufficient).message.substr(0, 7) == "ENODATA");
+}
+
+#if !defined(_WIN32)
+TEST_CASE("KittyGraphics.load.temporary_file", "[kitty]")
+{
+    char path[] = "/tmp/tty-graphics-protocol-XXXXXX";
+    auto const fd = ::mkstemp(path);
+    REQUIRE(fd >= 0);
+    writeAll(fd, "skip\x01\x02\x03\x04");
+    ::close(fd);
+
+    auto command = KittyGraphicsCommand {};
+    command.medium = 't';
+    command.width = 1;
+    command.height = 1;
+    command.dataOffset = 4;
+
+    auto const rgba = loadKittyImageData(command, path);
+    REQUIRE(std::holds_alternative<Image::Data>(rgba));
+    CHECK(std::get<Image::Data>(rgba) == Image::Data { 1, 2, 3, 4 });
+    CHECK(!exists(path));
+}
+
+TEST_CASE("KittyGraphics.load.file", "[kitty]")
+{
+    char path[] = "/tmp/contour-kitty-graphics-XXXXXX";
+    auto const fd = ::mkstemp(path);
+    REQUIRE(fd >= 0);
+    writeAll(fd, "\x01\x02\x03\x04");
+    ::close(fd);
+
+    auto command = KittyGraphicsCommand {};
+    command.width = 1;
+    command.height = 1;
+
+    // Only files explicitly marked as such are removed after reading them.
+    command.medium = 't';
+    CHECK(std::holds_alternative<KittyGraphicsError>(loadKittyImageData(command, path)));
+    CHECK(exists(path));
+
+    command.medium = 'f';
+    auto const rgba = loadKittyImageData(command, path);
+    REQUIRE(std::holds_alternative<Image::Data>(rgba));
+    CHECK(std::get<Image::Data>(rgba) == Image::Data { 1, 2, 3, 4 });
+    CHECK(exists(path));
+    ::unlink(path);
+
+    CHECK(std::holds_alternative<KittyGraphicsError>(loadKittyImageData(command, "/dev/null")));
+    CHECK(std::holds_alternative<KittyGraphicsError>(loadKittyImageData(command, path)));
+}
+
+TEST_CASE("KittyGraphics.load.shared_memory", "[kitty]")
+{
+    auto const name = "/contour-kitty-graphics-test-" + std::to_string(::getpid());
+    auto const fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    REQUIRE(fd >= 0);
+    writeAll(fd, "\x01\x02\x03\x04\x05\x06");
+    ::close(fd);
+
+    auto command = KittyGraphicsCommand {};
+    command.medium = 's';
+    command.format = 24;
+    command.width = 2;
+    command.height = 1;
+
+    auto const rgba = loadKittyImageData(command, name);
+    REQUIRE(std::holds_alternative<Image::Data>(rgba));
+    CHECK(std::get<Image::Data>(rgba) == Image::Data { 1, 2, 3, 0xFF, 4, 5, 6, 0xFF });
+
+    // The shared memory object is released once read.
+    CHECK(::shm_open(name.c_str(), O_RDONLY, 0) < 0);
+}
+#endif
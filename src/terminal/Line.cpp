@@ -11,13 +11,12 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <terminal/CodepointTable.h>
 #include <terminal/GraphicsAttributes.h>
 #include <terminal/Line.h>
 #include <terminal/primitives.h>
 
-#include <unicode/grapheme_segmenter.h>
 #include <unicode/utf8.h>
-#include <unicode/width.h>
 
 using std::get;
 using std::holds_alternative;
@@ -26,6 +25,17 @@ using std::min;
 namespace terminal
 {
 
+namespace
+{
+    template <typename Cell>
+    GraphicsAttributes graphicsAttributesOf(Cell const& cell) noexcept
+    {
+        return GraphicsAttributes {
+            cell.foregroundColor(), cell.backgroundColor(), cell.underlineColor(), cell.flags()
+        };
+    }
+} // namespace
+
 template <typename Cell>
 typename Line<Cell>::InflatedBuffer Line<Cell>::reflow(ColumnCount _newColumnCount)
 {
@@ -39,6 +49,12 @@ typename Line<Cell>::InflatedBuffer Line<Cell>::reflow(ColumnCount _newColumnCou
             case Comparison::Less:;
         }
     }
+    else if (isAttributedBuffer() && _newColumnCount >= attributedBuffer().usedColumns())
+    {
+        std::get<AttributedBuffer>(storage_).displayWidth = _newColumnCount;
+        damage_.value = true;
+        return {};
+    }
     auto& buffer = inflatedBuffer();
     // TODO: Efficiently handle TrivialBuffer-case.
     switch (crispy::strongCompare(_newColumnCount, size()))
@@ -91,6 +107,296 @@ typename Line<Cell>::InflatedBuffer Line<Cell>::reflow(ColumnCount _newColumnCou
     return {};
 }
 
+template <typename Cell>
+bool Line<Cell>::tryDeflate(crispy::BufferObject<char>& _textBuffer)
+{
+    if (!isInflatedBuffer())
+        return true;
+
+    // Does not damage (nor copy) the line buffer unless it can actually be deflated.
+    auto const& cells = std::as_const(*this).inflatedBuffer();
+    Require(cells.size() <= _textBuffer.bytesAvailable());
+
+    auto usedColumns = cells.size();
+    while (usedColumns != 0 && cells[usedColumns - 1].empty())
+        --usedColumns;
+
+    auto const isPlain = [](Cell const& cell) {
+        return !cell.hasImage() && cell.width() <= 1;
+    };
+
+    auto runs = std::vector<AttributeRun> {};
+    auto* text = _textBuffer.hotEnd();
+    for (size_t i = 0; i < usedColumns; ++i)
+    {
+        auto const& cell = cells[i];
+        auto const codepoint = cell.codepointCount() == 0 ? char32_t { ' ' } : cell.codepoint(0);
+        if (cell.codepointCount() > 1 || codepoint < 0x20 || codepoint > 0x7E || !isPlain(cell))
+            return false;
+        if (auto const attributes = graphicsAttributesOf(cell);
+            runs.empty() || runs.back().attributes != attributes || runs.back().hyperlink != cell.hyperlink())
+        {
+            if (runs.size() == AttributedLineBuffer::MaxRuns)
+                return false;
+            runs.emplace_back(AttributeRun { ColumnOffset::cast_from(i), attributes, cell.hyperlink() });
+        }
+        text[i] = static_cast<char>(codepoint);
+    }
+
+    auto const textAttributes = runs.empty() ? GraphicsAttributes {} : runs.front().attributes;
+    auto const hyperlink = runs.empty() ? HyperlinkId {} : runs.front().hyperlink;
+
+    auto const fillAttributes =
+        usedColumns < cells.size() ? graphicsAttributesOf(cells[usedColumns]) : textAttributes;
+    for (size_t i = usedColumns; i < cells.size(); ++i)
+        if (!isPlain(cells[i]) || cells[i].hyperlink() != HyperlinkId {}
+            || graphicsAttributesOf(cells[i]) != fillAttributes)
+            return false;
+
+    // Lines keep their attributes in their cells if these cannot be interned.
+    auto internedFill = InternedGraphicsAttributes::intern(fillAttributes);
+    if (!internedFill)
+        return false;
+
+    if (runs.size() > 1)
+    {
+        // The text is kept by the line itself, as the buffer object is only meant for trivial lines' text.
+        setBuffer(AttributedBuffer { ColumnCount::cast_from(cells.size()),
+                                     std::move(*internedFill),
+                                     std::move(runs),
+                                     std::string(text, usedColumns) });
+        return true;
+    }
+
+    auto internedText = InternedGraphicsAttributes::intern(textAttributes);
+    if (!internedText)
+        return false;
+
+    auto const offset = _textBuffer.bytesUsed();
+    (void) _textBuffer.advance(usedColumns);
+    setBuffer(TrivialBuffer { ColumnCount::cast_from(cells.size()),
+                              std::move(*internedText),
+                              std::move(*internedFill),
+                              hyperlink,
+                              ColumnCount::cast_from(usedColumns),
+                              _textBuffer.ref(offset, usedColumns) });
+    return true;
+}
+
+template <typename Cell>
+bool Line<Cell>::tryAppendAttributedText(ColumnOffset _start,
+                                         std::string_view _ascii,
+                                         GraphicsAttributes const& _attributes,
+                                         HyperlinkId _hyperlink)
+{
+    if (!isPackedASCII() || ColumnCount::cast_from(_start) != packedUsedColumns())
+        return false;
+
+    Require(packedUsedColumns() + ColumnCount::cast_from(_ascii.size()) <= size());
+
+    if (isTrivialBuffer())
+    {
+        auto const& buffer = std::as_const(*this).trivialBuffer();
+        auto attributed = AttributedBuffer {
+            buffer.displayWidth, buffer.fillAttributes, {}, std::string(buffer.text.view())
+        };
+        if (!buffer.text.empty())
+            attributed.runs.emplace_back(
+                AttributeRun { ColumnOffset(0), buffer.textAttributes, buffer.hyperlink });
+        if (!attributed.append(_ascii, _attributes, _hyperlink))
+            return false;
+        setBuffer(std::move(attributed));
+        return true;
+    }
+
+    if (!std::get<AttributedBuffer>(storage_).append(_ascii, _attributes, _hyperlink))
+        return false;
+
+    searchSignatureValid_ = false;
+    urlsValid_ = false;
+    searchMatchesValid_ = false;
+    wordBoundariesValid_ = false;
+    damage_.value = true;
+    return true;
+}
+
+template <typename Cell>
+LineSearchSignature const& Line<Cell>::searchSignature() const noexcept
+{
+    if (searchSignatureValid_)
+        return searchSignature_;
+
+    searchSignature_ = {};
+    if (isTrivialBuffer())
+    {
+        auto const& buffer = trivialBuffer();
+        if (buffer.isASCII())
+            for (char const ch: buffer.text.view())
+                searchSignature_.add(static_cast<unsigned char>(ch));
+        else
+            for (char32_t const codepoint: unicode::convert_to<char32_t>(buffer.text.view()))
+                searchSignature_.add(codepoint);
+    }
+    else if (isAttributedBuffer())
+    {
+        for (char const ch: attributedBuffer().text)
+            searchSignature_.add(static_cast<unsigned char>(ch));
+    }
+    else
+    {
+        for (Cell const& cell: inflatedBuffer())
+            for (size_t i = 0; i < cell.codepointCount(); ++i)
+                searchSignature_.add(cell.codepoint(i));
+    }
+    searchSignatureValid_ = true;
+    return searchSignature_;
+}
+
+template <typename Cell>
+gsl::span<PlainTextUrl const> Line<Cell>::plainTextUrls() const
+{
+    if (!urlsValid_)
+    {
+        auto urls = std::vector<PlainTextUrl> {};
+        if (isPackedASCII())
+            findPlainTextUrls(packedText(), urls);
+        else
+        {
+            // One character per column, with wide characters repeated in the columns they cover.
+            auto text = std::u32string {};
+            text.reserve(inflatedBuffer().size());
+            auto coveredColumns = 0;
+            for (Cell const& cell: inflatedBuffer())
+            {
+                if (cell.codepointCount())
+                {
+                    text.push_back(cell.codepoint(0));
+                    coveredColumns = cell.width() - 1;
+                }
+                else if (coveredColumns > 0)
+                {
+                    text.push_back(text.back());
+                    --coveredColumns;
+                }
+                else
+                    text.push_back(U' ');
+            }
+            findPlainTextUrls(text, urls);
+        }
+        urls_ = urls.empty() ? nullptr : std::make_shared<std::vector<PlainTextUrl> const>(std::move(urls));
+        urlsValid_ = true;
+    }
+    if (!urls_)
+        return {};
+    return gsl::span(*urls_);
+}
+
+template <typename Cell>
+gsl::span<LineSearchMatch const> Line<Cell>::searchMatches(std::u32string_view _pattern) const
+{
+    if (!searchMatchesValid_ || !searchMatches_ || searchMatches_->pattern != _pattern)
+    {
+        auto result = LineSearchMatches { std::u32string(_pattern), {} };
+        if (!_pattern.empty() && mayContain(_pattern))
+        {
+            if (isPackedASCII())
+            {
+                auto const text = packedText();
+                auto const needle = unicode::convert_to<char>(_pattern);
+                auto const length = ColumnCount::cast_from(needle.size());
+                for (auto i = text.find(needle); i != std::string_view::npos;
+                     i = text.find(needle, i + needle.size()))
+                    result.matches.emplace_back(LineSearchMatch { ColumnOffset::cast_from(i), length });
+            }
+            else if (auto const codepoints = inflatedCodepoints(_pattern))
+            {
+                auto const length = ColumnCount::cast_from(_pattern.size());
+                for (auto i = codepoints->find(_pattern); i != std::u32string_view::npos;
+                     i = codepoints->find(_pattern, i + _pattern.size()))
+                    result.matches.emplace_back(LineSearchMatch { ColumnOffset::cast_from(i), length });
+            }
+            else
+            {
+                // Like matchTextAt(), each codepoint of the pattern is matched against a column.
+                auto const columns = inflatedBuffer().size();
+                auto const length = ColumnCount::cast_from(_pattern.size());
+                auto column = size_t { 0 };
+                while (column + _pattern.size() <= columns)
+                {
+                    if (matchTextAt(_pattern, ColumnOffset::cast_from(column)))
+                    {
+                        result.matches.emplace_back(
+                            LineSearchMatch { ColumnOffset::cast_from(column), length });
+                        column += _pattern.size();
+                    }
+                    else
+                        ++column;
+                }
+            }
+        }
+        searchMatches_ = std::make_shared<LineSearchMatches const>(std::move(result));
+        searchMatchesValid_ = true;
+    }
+    return gsl::span(searchMatches_->matches);
+}
+
+template <typename Cell>
+std::optional<std::u32string_view> Line<Cell>::inflatedCodepoints(std::u32string_view _pattern) const
+{
+    if (_pattern.find(U'\0') != std::u32string_view::npos)
+        return std::nullopt;
+
+    // Only needed while scanning a line, and thus shared by all lines.
+    thread_local auto codepoints = std::u32string {};
+
+    auto const& cells = inflatedBuffer();
+    codepoints.resize(cells.size());
+    for (size_t column = 0; column < cells.size(); ++column)
+    {
+        auto const count = cells[column].codepointCount();
+        if (count > 1)
+            return std::nullopt;
+        codepoints[column] = count ? cells[column].codepoint(0) : U'\0';
+    }
+    return std::u32string_view(codepoints);
+}
+
+template <typename Cell>
+bool Line<Cell>::wordDelimitedAt(ColumnOffset _column, WordDelimiters const& _delimiters) const
+{
+    if (!wordBoundariesValid_ || !wordBoundaries_ || wordBoundaries_->delimitersId != _delimiters.id())
+    {
+        auto result = LineWordBoundaries { _delimiters.id(), {} };
+        if (isPackedASCII())
+        {
+            auto const text = packedText();
+            result.resize(text.size());
+            _delimiters.classify(text, result);
+        }
+        else
+        {
+            auto const& cells = inflatedBuffer();
+            result.resize(cells.size());
+            for (size_t column = 0; column < cells.size(); ++column)
+                if (CellUtil::empty(cells[column]) || _delimiters.delimits(cells[column].codepoint(0)))
+                    result.set(column);
+        }
+        wordBoundaries_ = std::make_shared<LineWordBoundaries const>(std::move(result));
+        wordBoundariesValid_ = true;
+    }
+    return wordBoundaries_->test(unbox<size_t>(_column));
+}
+
+template <typename Cell>
+PlainTextUrl const* Line<Cell>::plainTextUrlAt(ColumnOffset _column) const
+{
+    auto const column = unbox<size_t>(_column);
+    for (auto const& url: plainTextUrls())
+        if (url.offset <= column && column < url.offset + url.length)
+            return &url;
+    return nullptr;
+}
+
 template <typename Cell>
 inline void Line<Cell>::resize(ColumnCount _count)
 {
@@ -103,6 +409,12 @@ inline void Line<Cell>::resize(ColumnCount _count)
             buffer.displayWidth = _count;
             return;
         }
+        if (isAttributedBuffer() && _count >= attributedBuffer().usedColumns())
+        {
+            std::get<AttributedBuffer>(storage_).displayWidth = _count;
+            damage_.value = true;
+            return;
+        }
     }
     inflatedBuffer().resize(unbox<size_t>(_count));
 }
@@ -119,6 +431,68 @@ gsl::span<Cell const> Line<Cell>::trim_blank_right() const noexcept
     return gsl::make_span(i, e);
 }
 
+template <typename Cell>
+void Line<Cell>::placeImage(ImagePlacement _placement, HyperlinkId _hyperlink)
+{
+    auto& cells = inflatedBuffer();
+    auto const end = min(_placement.end(), ColumnOffset::cast_from(cells.size()));
+    if (_placement.column >= end)
+        return;
+    _placement.columns = boxed_cast<ColumnCount>(end - _placement.column);
+
+    for (auto column = _placement.column; column < end; ++column)
+    {
+        auto& cell = cells[unbox<size_t>(column)];
+        cell.setImage(true);
+        cell.setHyperlink(_hyperlink);
+    }
+
+    auto const displaysImage = [&](ColumnOffset _from, ColumnOffset _to) {
+        for (auto column = _from; column < _to; ++column)
+            if (cells[unbox<size_t>(column)].hasImage())
+                return true;
+        return false;
+    };
+
+    // The placements are replaced rather than modified, as copies of this line may share them.
+    // Of the placements displayed so far, only the columns left and right of the new one are kept,
+    // as far as they still display their image.
+    auto placements = std::vector<ImagePlacement> {};
+    for (auto const& other: imagePlacements())
+    {
+        if (auto const leftEnd = min(other.end(), _placement.column);
+            other.column < leftEnd && displaysImage(other.column, leftEnd))
+        {
+            placements.emplace_back(other);
+            placements.back().columns = boxed_cast<ColumnCount>(leftEnd - other.column);
+        }
+        if (auto const rightStart = std::max(other.column, end);
+            rightStart < other.end() && displaysImage(rightStart, other.end()))
+        {
+            placements.emplace_back(ImagePlacement { other.image,
+                                                     rightStart,
+                                                     boxed_cast<ColumnCount>(other.end() - rightStart),
+                                                     other.offset });
+            placements.back().offset.column += rightStart - other.column;
+        }
+    }
+    placements.emplace_back(std::move(_placement));
+    imagePlacements_ = std::make_shared<std::vector<ImagePlacement> const>(std::move(placements));
+}
+
+template <typename Cell>
+ImagePlacement const* Line<Cell>::imagePlacementAt(ColumnOffset _column) const noexcept
+{
+    if (!isInflatedBuffer() || _column >= ColumnOffset::cast_from(size())
+        || !inflatedBuffer()[unbox<size_t>(_column)].hasImage())
+        return nullptr;
+
+    for (auto const& placement: imagePlacements())
+        if (placement.column <= _column && _column < placement.end())
+            return &placement;
+    return nullptr;
+}
+
 template <typename Cell>
 std::string Line<Cell>::toUtf8() const
 {
@@ -131,6 +505,14 @@ std::string Line<Cell>::toUtf8() const
         return str;
     }
 
+    if (isAttributedBuffer())
+    {
+        auto const& lineBuffer = attributedBuffer();
+        auto str = lineBuffer.text;
+        str.resize(unbox<size_t>(lineBuffer.displayWidth), ' ');
+        return str;
+    }
+
     std::string str;
     for (Cell const& cell: inflatedBuffer())
     {
@@ -157,16 +539,92 @@ std::string Line<Cell>::toUtf8Trimmed() const
     return output;
 }
 
+template <typename Cell>
+InflatedLineBufferPool<Cell>& InflatedLineBufferPool<Cell>::get()
+{
+    // Intentionally never destroyed, as lines in static storage may outlive it.
+    static auto* pool = new InflatedLineBufferPool();
+    return *pool;
+}
+
+template <typename Cell>
+SharedInflatedLineBuffer<Cell> InflatedLineBufferPool<Cell>::acquire(size_t _columns)
+{
+    auto buffer = SharedInflatedLineBuffer<Cell> {};
+    {
+        auto const _ = std::lock_guard { mutex_ };
+        if (!buffers_.empty())
+        {
+            buffer = std::move(buffers_.back());
+            buffers_.pop_back();
+        }
+        if (buffer && buffer->capacity() >= _columns)
+        {
+            ++hits_;
+            return buffer;
+        }
+        ++misses_;
+    }
+
+    // Too narrow buffers, e.g. of lines from before the terminal got resized, are dropped.
+    buffer = std::make_shared<InflatedLineBuffer<Cell>>();
+    buffer->reserve(_columns);
+    return buffer;
+}
+
+template <typename Cell>
+void InflatedLineBufferPool<Cell>::release(SharedInflatedLineBuffer<Cell>& _buffer) noexcept
+{
+    if (_buffer.use_count() != 1)
+        return;
+
+    _buffer->clear();
+
+    auto const _ = std::lock_guard { mutex_ };
+    if (buffers_.size() < MaxBuffers)
+        buffers_.emplace_back(std::move(_buffer));
+}
+
+template <typename Cell>
+void InflatedLineBufferPool<Cell>::releaseBuffers()
+{
+    // The buffers are destroyed without holding the lock.
+    auto buffers = std::vector<SharedInflatedLineBuffer<Cell>> {};
+    {
+        auto const _ = std::lock_guard { mutex_ };
+        buffers.swap(buffers_);
+        buffers_.reserve(MaxBuffers);
+    }
+}
+
+template <typename Cell>
+InflatedLineBufferPoolStats InflatedLineBufferPool<Cell>::stats() const
+{
+    auto const _ = std::lock_guard { mutex_ };
+    auto bytes = size_t { 0 };
+    for (auto const& buffer: buffers_)
+        bytes += sizeof(InflatedLineBuffer<Cell>) + buffer->capacity() * sizeof(Cell);
+    return InflatedLineBufferPoolStats { buffers_.size(), hits_, misses_, bytes };
+}
+
 template <typename Cell>
 InflatedLineBuffer<Cell> inflate(TrivialLineBuffer const& input)
+{
+    auto columns = InflatedLineBuffer<Cell> {};
+    inflate<Cell>(input, columns);
+    return columns;
+}
+
+template <typename Cell>
+void inflate(TrivialLineBuffer const& input, InflatedLineBuffer<Cell>& columns)
 {
     static constexpr char32_t ReplacementCharacter { 0xFFFD };
 
-    auto columns = InflatedLineBuffer<Cell> {};
     columns.reserve(unbox<size_t>(input.displayWidth));
 
     auto lastChar = char32_t { 0 };
     auto utf8DecoderState = unicode::utf8_decoder_state {};
+    auto codepointTable = CodepointTable {};
     auto gapPending = 0;
 
     for (char const ch: input.text.view())
@@ -178,14 +636,14 @@ InflatedLineBuffer<Cell> inflate(TrivialLineBuffer const& input)
         auto const nextChar =
             holds_alternative<unicode::Success>(r) ? get<unicode::Success>(r).value : ReplacementCharacter;
 
-        if (unicode::grapheme_segmenter::breakable(lastChar, nextChar))
+        if (codepointTable.breakable(lastChar, nextChar))
         {
             while (gapPending > 0)
             {
                 columns.emplace_back(Cell { input.textAttributes, input.hyperlink });
                 --gapPending;
             }
-            auto const charWidth = unicode::width(nextChar);
+            auto const charWidth = codepointTable.width(nextChar);
             columns.emplace_back(Cell {});
             columns.back().setHyperlink(input.hyperlink);
             columns.back().write(input.textAttributes, nextChar, static_cast<uint8_t>(charWidth));
@@ -219,13 +677,49 @@ InflatedLineBuffer<Cell> inflate(TrivialLineBuffer const& input)
 
     while (columns.size() < unbox<size_t>(input.displayWidth))
         columns.emplace_back(Cell { input.fillAttributes });
+}
 
+template <typename Cell>
+InflatedLineBuffer<Cell> inflate(AttributedLineBuffer const& input)
+{
+    auto columns = InflatedLineBuffer<Cell> {};
+    inflate<Cell>(input, columns);
     return columns;
 }
+
+template <typename Cell>
+void inflate(AttributedLineBuffer const& input, InflatedLineBuffer<Cell>& columns)
+{
+    columns.reserve(unbox<size_t>(input.displayWidth));
+
+    for (size_t i = 0; i < input.runs.size(); ++i)
+    {
+        auto const& run = input.runs[i];
+        for (auto column = run.start; column < input.runEnd(i); ++column)
+        {
+            columns.emplace_back(Cell {});
+            columns.back().setHyperlink(run.hyperlink);
+            columns.back().write(run.attributes, static_cast<char32_t>(input.text[unbox<size_t>(column)]), 1);
+        }
+    }
+
+    while (columns.size() < unbox<size_t>(input.displayWidth))
+        columns.emplace_back(Cell { input.fillAttributes });
+}
 } // end namespace terminal
 
 #include <terminal/cell/CompactCell.h>
 template class terminal::Line<terminal::CompactCell>;
+template class terminal::InflatedLineBufferPool<terminal::CompactCell>;
+template terminal::InflatedLineBuffer<terminal::CompactCell> terminal::inflate<terminal::CompactCell>(
+    terminal::TrivialLineBuffer const&);
+template terminal::InflatedLineBuffer<terminal::CompactCell> terminal::inflate<terminal::CompactCell>(
+    terminal::AttributedLineBuffer const&);
 
 #include <terminal/cell/SimpleCell.h>
 template class terminal::Line<terminal::SimpleCell>;
+template class terminal::InflatedLineBufferPool<terminal::SimpleCell>;
+template terminal::InflatedLineBuffer<terminal::SimpleCell> terminal::inflate<terminal::SimpleCell>(
+    terminal::TrivialLineBuffer const&);
+template terminal::InflatedLineBuffer<terminal::SimpleCell> terminal::inflate<terminal::SimpleCell>(
+    terminal::AttributedLineBuffer const&);
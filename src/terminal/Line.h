@@ -15,7 +15,10 @@
 
 #include <terminal/CellUtil.h>
 #include <terminal/GraphicsAttributes.h>
+#include <terminal/GraphicsAttributesTable.h>
 #include <terminal/Hyperlink.h>
+#include <terminal/Image.h>
+#include <terminal/WordDelimiters.h>
 #include <terminal/primitives.h>
 
 #include <crispy/BufferObject.h>
@@ -27,9 +30,14 @@
 #include <gsl/span>
 #include <gsl/span_ext>
 
+#include <array>
+#include <atomic>
 #include <iterator>
+#include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace terminal
@@ -53,27 +61,162 @@ template <typename T> struct OptionalProperty<T, true> { T value; };
 
 /**
  * Line storage with call columns sharing the same SGR attributes.
+ *
+ * This is how most lines of the scrollback are stored, which is why the attributes are interned
+ * rather than stored inline.
  */
 struct TrivialLineBuffer
 {
     ColumnCount displayWidth;
-    GraphicsAttributes textAttributes;
-    GraphicsAttributes fillAttributes = textAttributes;
+    InternedGraphicsAttributes textAttributes;
+    InternedGraphicsAttributes fillAttributes = textAttributes;
     HyperlinkId hyperlink {};
 
     ColumnCount usedColumns {};
     crispy::BufferFragment<char> text {};
 
-    void reset(GraphicsAttributes _attributes) noexcept
+    /// Tests whether every used column is represented by exactly one US-ASCII byte,
+    /// in which case column offsets can be used as byte offsets into the text and vice versa.
+    ///
+    /// Any non-ASCII codepoint takes at least two bytes but at most two columns,
+    /// so byte count and used column count can only match for pure US-ASCII text.
+    [[nodiscard]] bool isASCII() const noexcept { return text.size() == unbox<size_t>(usedColumns); }
+
+    void reset(InternedGraphicsAttributes _attributes) noexcept
     {
-        textAttributes = _attributes;
-        fillAttributes = _attributes;
+        textAttributes = std::move(_attributes);
+        fillAttributes = textAttributes;
         hyperlink = {};
         usedColumns = {};
         text.reset();
     }
 };
 
+/// Graphics attributes and hyperlink of the columns of an AttributedLineBuffer, starting at the given
+/// column up to the start of the next run.
+struct AttributeRun
+{
+    ColumnOffset start;
+    GraphicsAttributes attributes;
+    HyperlinkId hyperlink {};
+};
+
+/**
+ * Line storage of US-ASCII text with a few runs of differing SGR attributes,
+ * such as colorized compiler output or `ls --color` lines.
+ *
+ * Every used column is represented by exactly one byte of text.
+ */
+struct AttributedLineBuffer
+{
+    /// Lines that would take more runs than this are inflated instead.
+    static constexpr size_t MaxRuns = 16;
+
+    ColumnCount displayWidth;
+    InternedGraphicsAttributes fillAttributes;
+    std::vector<AttributeRun> runs {}; // ordered by start column, the first one starting at column 0
+    std::string text {};
+
+    [[nodiscard]] ColumnCount usedColumns() const noexcept { return ColumnCount::cast_from(text.size()); }
+
+    /// Returns the column right behind the run of the given index.
+    [[nodiscard]] ColumnOffset runEnd(size_t _index) const noexcept
+    {
+        return _index + 1 < runs.size() ? runs[_index + 1].start : ColumnOffset::cast_from(text.size());
+    }
+
+    /// Appends the given US-ASCII text, starting a new run unless the last one shares the given
+    /// attributes and hyperlink.
+    ///
+    /// @retval false the text would take more than MaxRuns runs, and has not been appended.
+    [[nodiscard]] bool append(std::string_view _ascii,
+                              GraphicsAttributes const& _attributes,
+                              HyperlinkId _hyperlink)
+    {
+        if (_ascii.empty())
+            return true;
+
+        if (runs.empty() || runs.back().attributes != _attributes || runs.back().hyperlink != _hyperlink)
+        {
+            if (runs.size() == MaxRuns)
+                return false;
+            runs.emplace_back(AttributeRun { ColumnOffset::cast_from(text.size()), _attributes, _hyperlink });
+        }
+        text += _ascii;
+        return true;
+    }
+};
+
+/**
+ * Bloom filter over the codepoints of a line.
+ *
+ * Used for skipping lines that cannot contain a search term without looking at their cells.
+ */
+struct LineSearchSignature
+{
+    std::array<uint64_t, 2> bits {};
+
+    void add(char32_t _codepoint) noexcept
+    {
+        auto const bit = (static_cast<uint32_t>(_codepoint) * 0x9E3779B1u) >> 25; // 0..127
+        bits[bit / 64] |= uint64_t { 1 } << (bit % 64);
+    }
+
+    /// Tests if all codepoints of @p _other may be contained in this signature.
+    [[nodiscard]] bool containsAll(LineSearchSignature const& _other) const noexcept
+    {
+        return (bits[0] & _other.bits[0]) == _other.bits[0] && (bits[1] & _other.bits[1]) == _other.bits[1];
+    }
+
+    [[nodiscard]] static LineSearchSignature of(std::u32string_view _text) noexcept
+    {
+        auto signature = LineSearchSignature {};
+        for (auto const codepoint: _text)
+            signature.add(codepoint);
+        return signature;
+    }
+};
+
+/**
+ * Tells whether a line may differ from what has been rendered of it.
+ *
+ * Copied and moved lines (as well as the lines moved from) are always damaged, as having been rendered
+ * is a property of the line object at its place in the grid rather than of its contents.
+ */
+struct LineDamage
+{
+    bool value = true;
+
+    LineDamage() noexcept = default;
+    LineDamage(LineDamage const&) noexcept {}
+    LineDamage(LineDamage&& _other) noexcept { _other.value = true; }
+    LineDamage& operator=(LineDamage const&) noexcept
+    {
+        value = true;
+        return *this;
+    }
+    LineDamage& operator=(LineDamage&& _other) noexcept
+    {
+        value = true;
+        _other.value = true;
+        return *this;
+    }
+};
+
+/// Columns of a match of the search pattern on a line.
+struct LineSearchMatch
+{
+    ColumnOffset start;
+    ColumnCount length;
+};
+
+/// Matches of a search pattern on a line, as cached by the line.
+struct LineSearchMatches
+{
+    std::u32string pattern;
+    std::vector<LineSearchMatch> matches;
+};
+
 template <typename Cell>
 using InflatedLineBuffer = std::vector<Cell>;
 
@@ -81,12 +224,77 @@ using InflatedLineBuffer = std::vector<Cell>;
 template <typename Cell>
 InflatedLineBuffer<Cell> inflate(TrivialLineBuffer const& input);
 
+/// Unpacks a TrivialLineBuffer into the given empty buffer, reusing its capacity.
+template <typename Cell>
+void inflate(TrivialLineBuffer const& input, InflatedLineBuffer<Cell>& output);
+
+/// Unpacks an AttributedLineBuffer into an InflatedLineBuffer<Cell>.
+template <typename Cell>
+InflatedLineBuffer<Cell> inflate(AttributedLineBuffer const& input);
+
+/// Unpacks an AttributedLineBuffer into the given empty buffer, reusing its capacity.
+template <typename Cell>
+void inflate(AttributedLineBuffer const& input, InflatedLineBuffer<Cell>& output);
+
+/// Inflated line buffer that is shared between copies of a line until one of them is modified.
 template <typename Cell>
-using LineStorage = std::variant<TrivialLineBuffer, InflatedLineBuffer<Cell>>;
+using SharedInflatedLineBuffer = std::shared_ptr<InflatedLineBuffer<Cell>>;
+
+struct InflatedLineBufferPoolStats
+{
+    std::size_t buffers = 0; //!< number of buffers currently pooled
+    std::size_t hits = 0;    //!< number of buffers handed out without allocating
+    std::size_t misses = 0;  //!< number of buffers that had to be allocated
+    std::size_t bytes = 0;   //!< number of bytes held by the pooled buffers
+};
+
+/**
+ * Process-wide pool of the inflated buffers of lines that have been reset, e.g. when being
+ * recycled by scrolling or erased, such that inflating lines over and over again
+ * (as with colored output scrolling through the screen) does not allocate their buffers each time.
+ *
+ * Only buffers not shared with any other line are taken back. Lines of all terminals
+ * (and threads) share the pool, hence buffers handed out may be wider than asked for.
+ */
+template <typename Cell>
+class InflatedLineBufferPool
+{
+  public:
+    /// Maximum number of buffers kept, which is plenty for the pages of a few terminals.
+    static constexpr std::size_t MaxBuffers = 1024;
+
+    static InflatedLineBufferPool& get();
+
+    /// @returns an empty buffer with room for at least @p _columns cells.
+    [[nodiscard]] SharedInflatedLineBuffer<Cell> acquire(std::size_t _columns);
+
+    /// Takes the given buffer back, leaving it empty, unless it is still shared or the pool is full.
+    void release(SharedInflatedLineBuffer<Cell>& _buffer) noexcept;
+
+    /// Frees all buffers kept, e.g. once all terminals have been idle for a while.
+    void releaseBuffers();
+
+    [[nodiscard]] InflatedLineBufferPoolStats stats() const;
+
+  private:
+    InflatedLineBufferPool() { buffers_.reserve(MaxBuffers); }
+
+    mutable std::mutex mutex_;
+    std::vector<SharedInflatedLineBuffer<Cell>> buffers_;
+    std::size_t hits_ = 0;
+    std::size_t misses_ = 0;
+};
+
+template <typename Cell>
+using LineStorage = std::variant<TrivialLineBuffer, SharedInflatedLineBuffer<Cell>, AttributedLineBuffer>;
 
 /**
  * Line<Cell> API.
  *
+ * Copying a line is cheap, as copies share their inflated line buffer (and trivial line buffers
+ * share their text anyway). The buffer is copied on the first mutable access of a line sharing it,
+ * such that copies taken by readers (e.g. a GridSnapshot) are never modified.
+ *
  * TODO: Use custom allocator for ensuring cache locality of Cells to sibling lines.
  * TODO: Make the line optimization work.
  */
@@ -101,7 +309,9 @@ class Line
     Line& operator=(Line&&) noexcept = default;
 
     using TrivialBuffer = TrivialLineBuffer;
+    using AttributedBuffer = AttributedLineBuffer;
     using InflatedBuffer = InflatedLineBuffer<Cell>;
+    using SharedInflatedBuffer = SharedInflatedLineBuffer<Cell>;
     using Storage = LineStorage<Cell>;
     using value_type = Cell;
     using iterator = typename InflatedBuffer::iterator;
@@ -109,28 +319,38 @@ class Line
     using const_iterator = typename InflatedBuffer::const_iterator;
 
     Line(LineFlags _flags, TrivialBuffer _buffer):
-        storage_ { std::move(_buffer) }, flags_ { static_cast<unsigned>(_flags) }
+        storage_ { std::move(_buffer) }, flags_ { static_cast<uint8_t>(_flags) }
     {
     }
 
     Line(LineFlags _flags, InflatedBuffer _buffer):
-        storage_ { std::move(_buffer) }, flags_ { static_cast<unsigned>(_flags) }
+        storage_ { std::make_shared<InflatedBuffer>(std::move(_buffer)) },
+        flags_ { static_cast<uint8_t>(_flags) }
     {
     }
 
-    void reset(LineFlags _flags, GraphicsAttributes _attributes) noexcept
+    /// Constructs a blank line of the given attributes.
+    Line(LineFlags _flags, ColumnCount _count, GraphicsAttributes const& _attributes):
+        flags_ { static_cast<uint8_t>(_flags) }
     {
-        flags_ = static_cast<unsigned>(_flags);
-        if (isTrivialBuffer())
-            trivialBuffer().reset(_attributes);
+        setBlankBuffer(_count, _attributes);
+    }
+
+    void reset(LineFlags _flags, GraphicsAttributes const& _attributes) noexcept
+    {
+        flags_ = static_cast<uint8_t>(_flags);
+        if (!isTrivialBuffer())
+            setBlankBuffer(size(), _attributes);
+        else if (auto interned = InternedGraphicsAttributes::intern(_attributes))
+            trivialBuffer().reset(std::move(*interned));
         else
-            setBuffer(TrivialBuffer { ColumnCount::cast_from(inflatedBuffer().size()), _attributes });
+            setBlankBuffer(size(), _attributes);
     }
 
-    void reset(LineFlags _flags, GraphicsAttributes _attributes, ColumnCount count) noexcept
+    void reset(LineFlags _flags, GraphicsAttributes const& _attributes, ColumnCount count) noexcept
     {
-        flags_ = static_cast<unsigned>(_flags);
-        setBuffer(TrivialBuffer { count, _attributes });
+        flags_ = static_cast<uint8_t>(_flags);
+        setBlankBuffer(count, _attributes);
     }
 
     void fill(LineFlags _flags,
@@ -142,7 +362,7 @@ class Line
             reset(_flags, _attributes);
         else
         {
-            flags_ = static_cast<unsigned>(_flags);
+            flags_ = static_cast<uint8_t>(_flags);
             for (Cell& cell: inflatedBuffer())
             {
                 cell.reset();
@@ -154,8 +374,8 @@ class Line
     /// Tests if all cells are empty.
     [[nodiscard]] bool empty() const noexcept
     {
-        if (isTrivialBuffer())
-            return trivialBuffer().text.empty();
+        if (!isInflatedBuffer())
+            return packedText().empty();
 
         for (auto const& cell: inflatedBuffer())
             if (!cell.empty())
@@ -184,15 +404,15 @@ class Line
         while (i != e)
             (i++)->write(_sgr, static_cast<char32_t>(*s++), ASCII_Width);
 
-        auto const e2 = buffer.data() + buffer.size();
-        while (i != e2)
-            (i++)->reset();
+        Cell::resetRange(i, buffer.data() + buffer.size(), GraphicsAttributes {});
     }
 
     [[nodiscard]] ColumnCount size() const noexcept
     {
         if (isTrivialBuffer())
             return trivialBuffer().displayWidth;
+        else if (isAttributedBuffer())
+            return attributedBuffer().displayWidth;
         else
             return ColumnCount::cast_from(inflatedBuffer().size());
     }
@@ -223,29 +443,103 @@ class Line
 
     [[nodiscard]] uint8_t cellEmptyAt(ColumnOffset column) const noexcept
     {
-        if (isTrivialBuffer())
+        if (!isInflatedBuffer())
         {
             Require(ColumnOffset(0) <= column);
             Require(column < ColumnOffset::cast_from(size()));
-            return unbox<size_t>(column) >= trivialBuffer().text.size()
-                   || trivialBuffer().text[column.as<size_t>()] == 0x20;
+            auto const text = packedText();
+            return unbox<size_t>(column) >= text.size() || text[column.as<size_t>()] == 0x20;
         }
         return inflatedBuffer().at(unbox<size_t>(column)).empty();
     }
 
     [[nodiscard]] uint8_t cellWidthAt(ColumnOffset column) const noexcept
     {
-#if 0 // TODO: This optimization - but only when we return actual widths and not always 1.
-        if (isTrivialBuffer())
+        if (isPackedASCII())
         {
             Require(ColumnOffset(0) <= column);
             Require(column < ColumnOffset::cast_from(size()));
-            return 1; // TODO: When trivial line is to support Unicode, this should be adapted here.
+            return 1;
         }
-#endif
         return inflatedBuffer().at(unbox<size_t>(column)).width();
     }
 
+    /// Tests if the cell at the given column contains exactly the given US-ASCII character,
+    /// or is empty if @p asciiCharacter is 0.
+    [[nodiscard]] bool compareCellTextAt(ColumnOffset column, char asciiCharacter) const noexcept
+    {
+        if (isPackedASCII())
+        {
+            auto const text = packedText();
+            if (unbox<size_t>(column) < text.size())
+                return text[unbox<size_t>(column)] == asciiCharacter;
+            return asciiCharacter == 0;
+        }
+        return CellUtil::compareText(inflatedBuffer().at(unbox<size_t>(column)), asciiCharacter);
+    }
+
+    [[nodiscard]] std::string cellTextAt(ColumnOffset column) const
+    {
+        if (isPackedASCII())
+        {
+            auto const text = packedText();
+            if (unbox<size_t>(column) < text.size())
+                return std::string(1, text[unbox<size_t>(column)]);
+            return {};
+        }
+        return inflatedBuffer().at(unbox<size_t>(column)).toUtf8();
+    }
+
+    /// Attempts to reset all columns starting at @p _start to empty cells with the given
+    /// graphics attributes, without inflating the trivial line buffer.
+    ///
+    /// @retval true the columns have been reset.
+    /// @retval false the line is not trivial or the operation cannot be represented trivially.
+    [[nodiscard]] bool tryClearTrivialToEnd(ColumnOffset _start,
+                                            GraphicsAttributes const& _attributes) noexcept
+    {
+        if (!isTrivialBuffer())
+            return false;
+
+        auto& buffer = trivialBuffer();
+        if (buffer.fillAttributes != _attributes)
+            return false;
+
+        if (ColumnCount::cast_from(_start) >= buffer.usedColumns)
+            return true;
+
+        if (!buffer.isASCII())
+            return false;
+
+        buffer.text = buffer.text.subfragment(0, unbox<size_t>(_start));
+        buffer.usedColumns = ColumnCount::cast_from(_start);
+        return true;
+    }
+
+    /// Attempts to reset the columns from @p _start to @p _end (inclusive) to empty cells with the given
+    /// graphics attributes, without inflating the trivial line buffer.
+    ///
+    /// @retval true the columns have been reset.
+    /// @retval false the line is not trivial or the operation cannot be represented trivially.
+    [[nodiscard]] bool tryClearTrivialRange(ColumnOffset _start,
+                                            ColumnOffset _end,
+                                            GraphicsAttributes const& _attributes) noexcept
+    {
+        if (_end + 1 == ColumnOffset::cast_from(size()))
+            return tryClearTrivialToEnd(_start, _attributes);
+
+        // Columns before the right edge can only be cleared trivially if they are empty already.
+        return isTrivialBlankFrom(_start)
+               && std::as_const(*this).trivialBuffer().fillAttributes == _attributes;
+    }
+
+    /// Tests whether all columns starting at @p _start are empty cells of a trivial line buffer,
+    /// all sharing its fill attributes.
+    [[nodiscard]] bool isTrivialBlankFrom(ColumnOffset _start) const noexcept
+    {
+        return isTrivialBuffer() && ColumnCount::cast_from(_start) >= trivialBuffer().usedColumns;
+    }
+
     [[nodiscard]] LineFlags flags() const noexcept
     {
         return static_cast<LineFlags>(flags_);
@@ -300,9 +594,9 @@ class Line
     void setFlag(LineFlags _flag, bool _enable) noexcept
     {
         if (_enable)
-            flags_ |= static_cast<unsigned>(_flag);
+            flags_ = static_cast<uint8_t>(flags_ | static_cast<unsigned>(_flag));
         else
-            flags_ &= ~static_cast<unsigned>(_flag);
+            flags_ = static_cast<uint8_t>(flags_ & ~static_cast<unsigned>(_flag));
     }
 
     [[nodiscard]] bool isFlagEnabled(LineFlags _flag) const noexcept
@@ -311,6 +605,32 @@ class Line
     }
 
     [[nodiscard]] InflatedBuffer reflow(ColumnCount _newColumnCount);
+
+    /// Packs an inflated line back into a trivial line buffer, storing its text in @p _textBuffer.
+    ///
+    /// This only succeeds if the line consists of single-column US-ASCII characters,
+    /// followed by empty cells sharing the same fill attributes.
+    /// If the characters do not all share the same graphics attributes and hyperlink,
+    /// the line is packed into an attributed line buffer of up to AttributedLineBuffer::MaxRuns runs
+    /// instead, which keeps its own text.
+    ///
+    /// @p _textBuffer must have at least size() bytes available.
+    ///
+    /// @retval true the line is stored as trivial or attributed line buffer.
+    /// @retval false the line's contents cannot be represented by either.
+    [[nodiscard]] bool tryDeflate(crispy::BufferObject<char>& _textBuffer);
+
+    /// Writes US-ASCII text with the given attributes and hyperlink at @p _start, which must be right
+    /// behind the used columns of a trivial or attributed line buffer, without inflating the line.
+    /// A trivial line buffer is turned into an attributed one for that matter.
+    ///
+    /// @retval true the text has been appended.
+    /// @retval false the line is inflated, its text is not US-ASCII, @p _start is not right behind its text,
+    ///               or it would take too many runs.
+    [[nodiscard]] bool tryAppendAttributedText(ColumnOffset _start,
+                                               std::string_view _ascii,
+                                               GraphicsAttributes const& _attributes,
+                                               HyperlinkId _hyperlink);
     [[nodiscard]] std::string toUtf8() const;
     [[nodiscard]] std::string toUtf8Trimmed() const;
 
@@ -323,6 +643,11 @@ class Line
 
     [[nodiscard]] TrivialBuffer& trivialBuffer() noexcept
     {
+        searchSignatureValid_ = false;
+        urlsValid_ = false;
+        searchMatchesValid_ = false;
+        wordBoundariesValid_ = false;
+        damage_.value = true;
         return std::get<TrivialBuffer>(storage_);
     }
     [[nodiscard]] TrivialBuffer const& trivialBuffer() const noexcept
@@ -330,38 +655,132 @@ class Line
         return std::get<TrivialBuffer>(storage_);
     }
 
+    [[nodiscard]] AttributedBuffer const& attributedBuffer() const noexcept
+    {
+        return std::get<AttributedBuffer>(storage_);
+    }
+
     [[nodiscard]] bool isTrivialBuffer() const noexcept
     {
         return std::holds_alternative<TrivialBuffer>(storage_);
     }
+    [[nodiscard]] bool isAttributedBuffer() const noexcept
+    {
+        return std::holds_alternative<AttributedBuffer>(storage_);
+    }
     [[nodiscard]] bool isInflatedBuffer() const noexcept
     {
-        return !std::holds_alternative<TrivialBuffer>(storage_);
+        return std::holds_alternative<SharedInflatedBuffer>(storage_);
+    }
+
+    /// Replaces the contents by the given number of blank columns of the given attributes.
+    ///
+    /// The attributes are kept in the cells of an inflated buffer if they cannot be interned.
+    void setBlankBuffer(ColumnCount _count, GraphicsAttributes const& _attributes) noexcept
+    {
+        if (auto interned = InternedGraphicsAttributes::intern(_attributes))
+        {
+            setBuffer(TrivialBuffer { _count, std::move(*interned) });
+            return;
+        }
+        auto buffer = InflatedLineBufferPool<Cell>::get().acquire(unbox<size_t>(_count));
+        buffer->assign(unbox<size_t>(_count), Cell { _attributes });
+        setBuffer(std::move(buffer));
     }
 
     void setBuffer(Storage buffer) noexcept
     {
+        searchSignatureValid_ = false;
+        urlsValid_ = false;
+        searchMatchesValid_ = false;
+        wordBoundariesValid_ = false;
+        damage_.value = true;
+        if (auto* inflated = std::get_if<SharedInflatedBuffer>(&storage_); inflated && *inflated)
+            InflatedLineBufferPool<Cell>::get().release(*inflated);
         storage_ = std::move(buffer);
+
+        // Only inflated line buffers can display images.
+        if (!isInflatedBuffer())
+            imagePlacements_.reset();
+    }
+
+    /// Tests whether this line may contain all codepoints of the given search signature.
+    ///
+    /// False positives are possible, false negatives are not.
+    /// The line's own signature is computed on first use and kept until the line is modified.
+    [[nodiscard]] bool mayContain(LineSearchSignature const& _needle) const noexcept
+    {
+        return searchSignature().containsAll(_needle);
     }
 
+    [[nodiscard]] bool mayContain(std::u32string_view _text) const noexcept
+    {
+        return mayContain(LineSearchSignature::of(_text));
+    }
+
+    [[nodiscard]] LineSearchSignature const& searchSignature() const noexcept;
+
+    /// Returns the URLs shown as plain text on this line, which are found on first use
+    /// and kept until the line is modified.
+    [[nodiscard]] gsl::span<PlainTextUrl const> plainTextUrls() const;
+
+    /// Returns the plain-text URL shown in the given column, if any.
+    [[nodiscard]] PlainTextUrl const* plainTextUrlAt(ColumnOffset _column) const;
+
+    /// Returns the non-overlapping matches of the given search pattern on this line, which are found
+    /// on first use and kept until the line is modified or matched against another pattern.
+    [[nodiscard]] gsl::span<LineSearchMatch const> searchMatches(std::u32string_view _pattern) const;
+
+    /// Tests whether the cell in the given column is empty or holds one of the given word delimiters.
+    ///
+    /// The columns delimiting words are found for the whole line on first use and kept until
+    /// the line is modified or tested against other delimiters.
+    [[nodiscard]] bool wordDelimitedAt(ColumnOffset _column, WordDelimiters const& _delimiters) const;
+
+    /// Tests whether this line may have been modified since it has been marked as rendered.
+    ///
+    /// Any mutable access to the line buffer damages the line.
+    [[nodiscard]] bool damaged() const noexcept { return damage_.value; }
+
+    /// Marks the current contents of this line as rendered.
+    void markRendered() const noexcept { damage_.value = false; }
+
+    /// Returns the rows of images placed onto this line, none of them overlapping another.
+    ///
+    /// Cells that have been overwritten since are still covered by their placement, but no longer
+    /// display its image (see Cell::hasImage()).
+    [[nodiscard]] gsl::span<ImagePlacement const> imagePlacements() const noexcept
+    {
+        if (!imagePlacements_)
+            return {};
+        return gsl::span(*imagePlacements_);
+    }
+
+    /// Displays the given row of an image in the columns of the given placement, clipped to this line,
+    /// replacing whatever image has been displayed there before.
+    void placeImage(ImagePlacement _placement, HyperlinkId _hyperlink);
+
+    /// Returns the placement of the image displayed in the given column, if any.
+    [[nodiscard]] ImagePlacement const* imagePlacementAt(ColumnOffset _column) const noexcept;
+
+    /// Invokes @p _visit with each run of consecutive cells still displaying the same image,
+    /// passed as an ImagePlacement of its own.
+    template <typename Visitor>
+    void visitDisplayedImages(Visitor&& _visit) const;
+
     // Tests if the given text can be matched in this line at the exact given start column.
     [[nodiscard]] bool matchTextAt(std::u32string_view text, ColumnOffset startColumn) const noexcept
     {
-        if (isTrivialBuffer())
+        if (!isInflatedBuffer())
         {
             auto const u8Text = unicode::convert_to<char>(text);
-            TrivialBuffer const& buffer = trivialBuffer();
-            if (!buffer.usedColumns)
+            if (ColumnCount::cast_from(startColumn) >= packedUsedColumns())
                 return false;
-            auto const column = std::min(startColumn, boxed_cast<ColumnOffset>(buffer.usedColumns - 1));
-            auto const resultIndex = buffer.text.view()
-                                         .substr(unbox<size_t>(column))
-                                         .find(std::string_view(u8Text), unbox<size_t>(column));
-            return resultIndex == 0;
+            auto const candidate = packedText().substr(unbox<size_t>(startColumn));
+            return candidate.substr(0, u8Text.size()) == std::string_view(u8Text);
         }
         else
         {
-            auto const u8Text = unicode::convert_to<char>(text);
             InflatedBuffer const& cells = inflatedBuffer();
             auto const baseColumn = unbox<size_t>(startColumn);
             size_t i = 0;
@@ -381,14 +800,14 @@ class Line
     [[nodiscard]] std::optional<ColumnOffset> search(std::u32string_view text,
                                                      ColumnOffset startColumn) const noexcept
     {
-        if (isTrivialBuffer())
+        if (!isInflatedBuffer())
         {
             auto const u8Text = unicode::convert_to<char>(text);
-            TrivialBuffer const& buffer = trivialBuffer();
-            if (!buffer.usedColumns)
+            auto const usedColumns = packedUsedColumns();
+            if (!usedColumns)
                 return std::nullopt;
-            auto const column = std::min(startColumn, boxed_cast<ColumnOffset>(buffer.usedColumns - 1));
-            auto const resultIndex = buffer.text.view().find(std::string_view(u8Text), unbox<size_t>(column));
+            auto const column = std::min(startColumn, boxed_cast<ColumnOffset>(usedColumns - 1));
+            auto const resultIndex = packedText().find(std::string_view(u8Text), unbox<size_t>(column));
             if (resultIndex != std::string_view::npos)
                 return ColumnOffset::cast_from(resultIndex);
             else
@@ -400,16 +819,20 @@ class Line
             if (buffer.size() < text.size())
                 return std::nullopt; // not found: line is smaller than search term
 
-            auto baseColumn = std::min(startColumn, ColumnOffset::cast_from(buffer.size() - text.size()));
-            auto rightMostSearchPosition =
-                std::max(startColumn, ColumnOffset::cast_from(buffer.size() - text.size()));
-            while (baseColumn < rightMostSearchPosition)
+            auto const lastColumn = ColumnOffset::cast_from(buffer.size() - text.size());
+            auto const firstColumn = std::min(startColumn, lastColumn);
+            if (auto const codepoints = inflatedCodepoints(text))
             {
-                if (matchTextAt(text, baseColumn))
-                    return baseColumn;
-                baseColumn++;
+                auto const resultIndex = codepoints->find(text, unbox<size_t>(firstColumn));
+                if (resultIndex != std::u32string_view::npos)
+                    return ColumnOffset::cast_from(resultIndex);
+                return std::nullopt;
             }
 
+            for (auto column = firstColumn; column <= lastColumn; ++column)
+                if (matchTextAt(text, column))
+                    return column;
+
             return std::nullopt; // Not found, so stay with initial column as result.
         }
     }
@@ -421,15 +844,14 @@ class Line
     [[nodiscard]] ColumnOffset searchReverse(std::u32string_view text,
                                              ColumnOffset startColumn) const noexcept
     {
-        if (isTrivialBuffer())
+        if (!isInflatedBuffer())
         {
             auto const u8Text = unicode::convert_to<char>(text);
-            TrivialBuffer const& buffer = trivialBuffer();
-            if (!buffer.usedColumns)
+            auto const usedColumns = packedUsedColumns();
+            if (!usedColumns)
                 return startColumn;
-            auto const column = std::min(startColumn, boxed_cast<ColumnOffset>(buffer.usedColumns - 1));
-            auto const resultIndex =
-                buffer.text.view().rfind(std::string_view(u8Text), unbox<size_t>(column));
+            auto const column = std::min(startColumn, boxed_cast<ColumnOffset>(usedColumns - 1));
+            auto const resultIndex = packedText().rfind(std::string_view(u8Text), unbox<size_t>(column));
             if (resultIndex != std::string_view::npos)
                 return ColumnOffset::cast_from(resultIndex);
             else
@@ -443,6 +865,14 @@ class Line
 
             // reverse search from right@column to left until match is complete.
             auto baseColumn = std::min(startColumn, ColumnOffset::cast_from(buffer.size() - text.size()));
+            if (auto const codepoints = inflatedCodepoints(text))
+            {
+                auto const resultIndex = codepoints->rfind(text, unbox<size_t>(baseColumn));
+                if (resultIndex != std::u32string_view::npos)
+                    return ColumnOffset::cast_from(resultIndex);
+                return startColumn;
+            }
+
             while (baseColumn >= ColumnOffset(0))
             {
                 if (matchTextAt(text, baseColumn))
@@ -455,8 +885,60 @@ class Line
     }
 
   private:
+    InflatedBuffer& inflatedStorage();
+
+    /// Gathers the codepoints of the inflated line buffer's columns into one contiguous array,
+    /// such that @p _pattern can be searched for with string algorithms, comparing many columns at once,
+    /// rather than by striding over the cells and their attributes.
+    ///
+    /// Empty columns are represented by U'\0'. The array is reused by the next call on the same thread.
+    ///
+    /// @returns the codepoints, or nullopt if a column holds more than one codepoint,
+    ///          or @p _pattern contains U'\0', as they cannot be matched that way.
+    [[nodiscard]] std::optional<std::u32string_view> inflatedCodepoints(std::u32string_view _pattern) const;
+
+    /// Returns the text of a trivial or attributed line buffer.
+    [[nodiscard]] std::string_view packedText() const noexcept
+    {
+        if (isTrivialBuffer())
+            return trivialBuffer().text.view();
+        return attributedBuffer().text;
+    }
+
+    /// Returns the number of used columns of a trivial or attributed line buffer.
+    [[nodiscard]] ColumnCount packedUsedColumns() const noexcept
+    {
+        if (isTrivialBuffer())
+            return trivialBuffer().usedColumns;
+        return attributedBuffer().usedColumns();
+    }
+
+    /// Tests whether this is a trivial or attributed line buffer of one byte of text per used column.
+    [[nodiscard]] bool isPackedASCII() const noexcept
+    {
+        return isAttributedBuffer() || (isTrivialBuffer() && trivialBuffer().isASCII());
+    }
+
     Storage storage_;
-    unsigned flags_ = 0;
+
+    // Image rows placed onto this line, shared between copies of the line until one of them
+    // places another image.
+    std::shared_ptr<std::vector<ImagePlacement> const> imagePlacements_ {};
+
+    // Packed along with the cache flags below, as there are as many lines as the scrollback holds.
+    uint8_t flags_ = 0;
+
+    // Cached search signature, plain-text URLs (if any), matches of the latest search pattern,
+    // and word boundaries of this line, invalidated by any mutable access to the line buffer.
+    mutable bool searchSignatureValid_ = false;
+    mutable bool urlsValid_ = false;
+    mutable bool searchMatchesValid_ = false;
+    mutable bool wordBoundariesValid_ = false;
+    mutable LineDamage damage_ {};
+    mutable LineSearchSignature searchSignature_ {};
+    mutable std::shared_ptr<std::vector<PlainTextUrl> const> urls_ {};
+    mutable std::shared_ptr<LineSearchMatches const> searchMatches_ {};
+    mutable std::shared_ptr<LineWordBoundaries const> wordBoundaries_ {};
 };
 
 constexpr LineFlags operator|(LineFlags a, LineFlags b) noexcept
@@ -474,18 +956,96 @@ constexpr LineFlags operator&(LineFlags a, LineFlags b) noexcept
     return LineFlags(unsigned(a) & unsigned(b));
 }
 
+template <typename Cell>
+inline typename Line<Cell>::InflatedBuffer& Line<Cell>::inflatedStorage()
+{
+    if (auto const* trivial = std::get_if<TrivialBuffer>(&storage_))
+    {
+        auto buffer = InflatedLineBufferPool<Cell>::get().acquire(unbox<size_t>(trivial->displayWidth));
+        inflate<Cell>(*trivial, *buffer);
+        storage_ = std::move(buffer);
+
+        // What has been rendered may still refer to the text of the trivial line buffer.
+        damage_.value = true;
+    }
+    else if (auto const* attributed = std::get_if<AttributedBuffer>(&storage_))
+    {
+        auto buffer = InflatedLineBufferPool<Cell>::get().acquire(unbox<size_t>(attributed->displayWidth));
+        inflate<Cell>(*attributed, *buffer);
+        storage_ = std::move(buffer);
+        damage_.value = true;
+    }
+
+    auto& buffer = std::get<SharedInflatedBuffer>(storage_);
+    if (!buffer) // moved from
+        buffer = std::make_shared<InflatedBuffer>();
+    return *buffer;
+}
+
 template <typename Cell>
 inline typename Line<Cell>::InflatedBuffer& Line<Cell>::inflatedBuffer()
 {
-    if (std::holds_alternative<TrivialBuffer>(storage_))
-        storage_ = inflate<Cell>(std::get<TrivialBuffer>(storage_));
-    return std::get<InflatedBuffer>(storage_);
+    searchSignatureValid_ = false;
+    urlsValid_ = false;
+    searchMatchesValid_ = false;
+    wordBoundariesValid_ = false;
+    damage_.value = true;
+    (void) inflatedStorage();
+
+    auto& buffer = std::get<SharedInflatedBuffer>(storage_);
+    if (buffer.use_count() > 1)
+    {
+        // Other copies of this line keep seeing the contents they have been taken with.
+        auto copy = InflatedLineBufferPool<Cell>::get().acquire(buffer->size());
+        copy->assign(buffer->begin(), buffer->end());
+        buffer = std::move(copy);
+    }
+    else
+    {
+        // Orders the reads through a copy that has just been destroyed before the writes to follow.
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    return *buffer;
 }
 
 template <typename Cell>
 inline typename Line<Cell>::InflatedBuffer const& Line<Cell>::inflatedBuffer() const
 {
-    return const_cast<Line<Cell>*>(this)->inflatedBuffer();
+    // Inflating does not change the line's contents, so the search signature remains valid.
+    return const_cast<Line<Cell>*>(this)->inflatedStorage();
+}
+
+template <typename Cell>
+template <typename Visitor>
+void Line<Cell>::visitDisplayedImages(Visitor&& _visit) const
+{
+    if (!imagePlacements_ || !isInflatedBuffer())
+        return;
+
+    auto const& cells = inflatedBuffer();
+    for (auto const& placement: *imagePlacements_)
+    {
+        auto const end = std::min(unbox<size_t>(placement.end()), cells.size());
+        auto column = unbox<size_t>(placement.column);
+        while (column < end)
+        {
+            if (!cells[column].hasImage())
+            {
+                ++column;
+                continue;
+            }
+            auto const first = column;
+            while (column < end && cells[column].hasImage())
+                ++column;
+            auto const offset =
+                CellLocation { placement.offset.line,
+                               placement.offset.column + ColumnOffset::cast_from(first) - placement.column };
+            _visit(ImagePlacement { placement.image,
+                                    ColumnOffset::cast_from(first),
+                                    ColumnCount::cast_from(column - first),
+                                    offset });
+        }
+    }
 }
 
 } // namespace terminal
@@ -521,4 +1081,25 @@ struct formatter<terminal::LineFlags>
         return fmt::format_to(ctx.out(), "{}", s);
     }
 };
+
+template <>
+struct formatter<terminal::InflatedLineBufferPoolStats>
+{
+    template <typename ParseContext>
+    auto parse(ParseContext& ctx)
+    {
+        return ctx.begin();
+    }
+    template <typename FormatContext>
+    auto format(terminal::InflatedLineBufferPoolStats const& stats, FormatContext& ctx) const
+    {
+        auto const requests = stats.hits + stats.misses;
+        return fmt::format_to(ctx.out(),
+                              "{} pooled, {} hits, {} misses ({:.1f}% hit rate)",
+                              stats.buffers,
+                              stats.hits,
+                              stats.misses,
+                              requests ? 100.0 * double(stats.hits) / double(requests) : 0.0);
+    }
+};
 } // namespace fmt
@@ -18,6 +18,10 @@
 
 #include <catch2/catch.hpp>
 
+#include <algorithm>
+#include <tuple>
+#include <vector>
+
 using namespace std;
 
 using namespace terminal;
@@ -26,6 +30,14 @@ using namespace crispy;
 // Default cell type for testing.
 using Cell = PrimaryScreenCell;
 
+namespace
+{
+InternedGraphicsAttributes interned(GraphicsAttributes const& _attributes)
+{
+    return *InternedGraphicsAttributes::intern(_attributes);
+}
+} // namespace
+
 TEST_CASE("Line.BufferFragment", "[Line]")
 {
     auto constexpr testText = "0123456789ABCDEF"sv;
@@ -51,7 +63,12 @@ TEST_CASE("Line.resize", "[Line]")
 
     auto const sgr = GraphicsAttributes {};
     auto const trivial =
-        TrivialLineBuffer { DisplayWidth, sgr, sgr, HyperlinkId {}, DisplayWidth, bufferFragment };
+        TrivialLineBuffer { DisplayWidth,
+                            interned(sgr),
+                            interned(sgr),
+                            HyperlinkId {},
+                            DisplayWidth,
+                            bufferFragment };
     CHECK(trivial.text.view() == string_view(text.data()));
     auto line_trivial = Line<Cell>(LineFlags::None, trivial);
     CHECK(line_trivial.isTrivialBuffer());
@@ -78,7 +95,12 @@ TEST_CASE("Line.reflow", "[Line]")
 
     auto const sgr = GraphicsAttributes {};
     auto const trivial =
-        TrivialLineBuffer { DisplayWidth, sgr, sgr, HyperlinkId {}, DisplayWidth, bufferFragment };
+        TrivialLineBuffer { DisplayWidth,
+                            interned(sgr),
+                            interned(sgr),
+                            HyperlinkId {},
+                            DisplayWidth,
+                            bufferFragment };
     CHECK(trivial.text.view() == string_view(text.data()));
     auto line_trivial = Line<Cell>(LineFlags::None, trivial);
     CHECK(line_trivial.isTrivialBuffer());
@@ -104,7 +126,12 @@ TEST_CASE("Line.inflate", "[Line]")
     sgr.underlineColor = Color::Indexed(IndexedColor::Red);
     sgr.flags |= CellFlags::CurlyUnderlined;
     auto const trivial =
-        TrivialLineBuffer { ColumnCount(10), sgr, sgr, HyperlinkId {}, ColumnCount(10), bufferFragment };
+        TrivialLineBuffer { ColumnCount(10),
+                            interned(sgr),
+                            interned(sgr),
+                            HyperlinkId {},
+                            ColumnCount(10),
+                            bufferFragment };
 
     auto const inflated = inflate<Cell>(trivial);
 
@@ -140,7 +167,12 @@ TEST_CASE("Line.inflate.Unicode", "[Line]")
     sgr.underlineColor = Color::Indexed(IndexedColor::Red);
     sgr.flags |= CellFlags::CurlyUnderlined;
     auto const trivial =
-        TrivialLineBuffer { DisplayWidth, sgr, sgr, HyperlinkId {}, DisplayWidth, bufferFragment };
+        TrivialLineBuffer { DisplayWidth,
+                            interned(sgr),
+                            interned(sgr),
+                            HyperlinkId {},
+                            DisplayWidth,
+                            bufferFragment };
 
     auto const inflated = inflate<Cell>(trivial);
 
@@ -197,7 +229,12 @@ TEST_CASE("Line.inflate.Unicode.FamilyEmoji", "[Line]")
     fillSGR.flags |= CellFlags::CurlyUnderlined;
 
     auto const trivial =
-        TrivialLineBuffer { DisplayWidth, sgr, fillSGR, HyperlinkId {}, UsedColumnCount, bufferFragment };
+        TrivialLineBuffer { DisplayWidth,
+                            interned(sgr),
+                            interned(fillSGR),
+                            HyperlinkId {},
+                            UsedColumnCount,
+                            bufferFragment };
 
     auto const inflated = inflate<Cell>(trivial);
 
@@ -227,3 +264,311 @@ TEST_CASE("Line.inflate.Unicode.FamilyEmoji", "[Line]")
     REQUIRE(cell.backgroundColor() == fillSGR.backgroundColor);
     REQUIRE(cell.underlineColor() == fillSGR.underlineColor);
 }
+
+TEST_CASE("Line.tryDeflate", "[Line]")
+{
+    auto sgr = GraphicsAttributes {};
+    sgr.foregroundColor = RGBColor(0x123456);
+    auto fillSGR = GraphicsAttributes {};
+    fillSGR.backgroundColor = Color::Indexed(IndexedColor::Yellow);
+
+    auto line = Line<Cell>(LineFlags::Wrappable, Line<Cell>::InflatedBuffer(6, Cell { fillSGR }));
+    line.fill(ColumnOffset(0), sgr, "abc"sv);
+    for (auto i = ColumnOffset(3); i < ColumnOffset(6); ++i)
+        line.useCellAt(i).reset(fillSGR);
+    REQUIRE(line.isInflatedBuffer());
+
+    auto bufferObject = BufferObject<char>::create(16);
+    REQUIRE(line.tryDeflate(*bufferObject));
+    REQUIRE(line.isTrivialBuffer());
+    CHECK(line.size() == ColumnCount(6));
+    CHECK(line.toUtf8() == "abc   ");
+    CHECK(line.trivialBuffer().textAttributes == sgr);
+    CHECK(line.trivialBuffer().fillAttributes == fillSGR);
+    CHECK(bufferObject->bytesUsed() == 3);
+
+    auto const& cells = line.inflatedBuffer();
+    CHECK(cells[2].foregroundColor() == sgr.foregroundColor);
+    CHECK(cells[5].backgroundColor() == fillSGR.backgroundColor);
+
+    // Mixed graphics attributes are represented by an attributed line buffer, keeping its own text.
+    line.useCellAt(ColumnOffset(1)).setForegroundColor(Color::Indexed(IndexedColor::Red));
+    REQUIRE(line.tryDeflate(*bufferObject));
+    REQUIRE(line.isAttributedBuffer());
+    CHECK(line.attributedBuffer().runs.size() == 3);
+    CHECK(line.attributedBuffer().runs[1].start == ColumnOffset(1));
+    CHECK(line.attributedBuffer().runs[2].start == ColumnOffset(2));
+    CHECK(line.attributedBuffer().fillAttributes == fillSGR);
+    CHECK(line.toUtf8() == "abc   ");
+    CHECK(bufferObject->bytesUsed() == 3);
+
+    auto const& reinflated = line.inflatedBuffer();
+    CHECK(reinflated[0].foregroundColor() == sgr.foregroundColor);
+    CHECK(reinflated[1].foregroundColor() == Color::Indexed(IndexedColor::Red));
+    CHECK(reinflated[2].foregroundColor() == sgr.foregroundColor);
+    CHECK(reinflated[5].backgroundColor() == fillSGR.backgroundColor);
+
+    // Non-ASCII text cannot be represented by either.
+    line.useCellAt(ColumnOffset(1)).setCharacter(U'\u00E4');
+    CHECK_FALSE(line.tryDeflate(*bufferObject));
+    CHECK(line.isInflatedBuffer());
+    CHECK(bufferObject->bytesUsed() == 3);
+}
+
+TEST_CASE("Line.tryAppendAttributedText", "[Line]")
+{
+    auto red = GraphicsAttributes {};
+    red.foregroundColor = Color::Indexed(IndexedColor::Red);
+
+    auto line = Line<Cell>(LineFlags::None, TrivialLineBuffer { ColumnCount(10),
+                                                                InternedGraphicsAttributes {} });
+    CHECK_FALSE(line.tryAppendAttributedText(ColumnOffset(1), "x"sv, red, HyperlinkId {}));
+
+    REQUIRE(line.tryAppendAttributedText(ColumnOffset(0), "ls"sv, GraphicsAttributes {}, HyperlinkId {}));
+    REQUIRE(line.tryAppendAttributedText(ColumnOffset(2), " dir"sv, red, HyperlinkId {}));
+    REQUIRE(line.tryAppendAttributedText(ColumnOffset(6), "/"sv, red, HyperlinkId {}));
+    REQUIRE(line.isAttributedBuffer());
+    CHECK(line.attributedBuffer().runs.size() == 2);
+    CHECK(line.toUtf8() == "ls dir/   ");
+    CHECK(!line.empty());
+    CHECK(line.cellTextAt(ColumnOffset(3)) == "d");
+    CHECK(line.search(U"dir", ColumnOffset(0)) == ColumnOffset(3));
+
+    // Growing keeps the line attributed, whereas accessing its cells inflates it.
+    line.resize(ColumnCount(12));
+    CHECK(line.isAttributedBuffer());
+    CHECK(line.size() == ColumnCount(12));
+    CHECK(line.useCellAt(ColumnOffset(4)).foregroundColor() == red.foregroundColor);
+    CHECK(line.isInflatedBuffer());
+    CHECK_FALSE(line.tryAppendAttributedText(ColumnOffset(7), "x"sv, red, HyperlinkId {}));
+}
+
+TEST_CASE("Line.mayContain", "[Line]")
+{
+    auto constexpr testText = "Hello, World"sv;
+    auto pool = BufferObjectPool<char>(16);
+    auto bufferObject = pool.allocateBufferObject();
+    bufferObject->writeAtEnd(testText);
+    auto const sgr = GraphicsAttributes {};
+    auto line = Line<Cell>(LineFlags::None,
+                           TrivialLineBuffer { ColumnCount(16),
+                                               interned(sgr),
+                                               interned(sgr),
+                                               HyperlinkId {},
+                                               ColumnCount(12),
+                                               bufferObject->ref(0, testText.size()) });
+
+    CHECK(line.mayContain(U"World"sv));
+    CHECK(line.mayContain(U"lo, W"sv));
+    CHECK_FALSE(line.mayContain(U"xyz"sv));
+
+    // Writing to the line invalidates its search signature.
+    line.useCellAt(ColumnOffset(13)).write(sgr, U'x', 1);
+    line.useCellAt(ColumnOffset(14)).write(sgr, U'y', 1);
+    line.useCellAt(ColumnOffset(15)).write(sgr, U'z', 1);
+    CHECK(line.mayContain(U"xyz"sv));
+    CHECK(line.mayContain(U"World"sv));
+}
+
+TEST_CASE("Line.plainTextUrls", "[Line]")
+{
+    auto constexpr testText = "see https://a.b/c."sv;
+    auto pool = BufferObjectPool<char>(32);
+    auto bufferObject = pool.allocateBufferObject();
+    bufferObject->writeAtEnd(testText);
+    auto const sgr = GraphicsAttributes {};
+    auto line = Line<Cell>(LineFlags::None,
+                           TrivialLineBuffer { ColumnCount(24),
+                                               interned(sgr),
+                                               interned(sgr),
+                                               HyperlinkId {},
+                                               ColumnCount(18),
+                                               bufferObject->ref(0, testText.size()) });
+
+    REQUIRE(line.plainTextUrls().size() == 1);
+    CHECK(line.plainTextUrls()[0].offset == 4);
+    CHECK(line.plainTextUrls()[0].length == 13);
+    CHECK(line.plainTextUrlAt(ColumnOffset(4)) == line.plainTextUrls().data());
+    CHECK(line.plainTextUrlAt(ColumnOffset(3)) == nullptr);
+    CHECK(line.plainTextUrlAt(ColumnOffset(17)) == nullptr);
+
+    // Writing to the line invalidates its URLs.
+    line.useCellAt(ColumnOffset(17)).write(sgr, U'd', 1);
+    REQUIRE(line.plainTextUrls().size() == 1);
+    CHECK(line.plainTextUrls()[0].length == 14);
+    line.useCellAt(ColumnOffset(12)).write(sgr, U' ', 1);
+    CHECK(line.plainTextUrls().empty());
+}
+
+TEST_CASE("Line.searchMatches", "[Line]")
+{
+    auto constexpr testText = "abc xabc ab abcabc"sv;
+    auto pool = BufferObjectPool<char>(32);
+    auto bufferObject = pool.allocateBufferObject();
+    bufferObject->writeAtEnd(testText);
+    auto const sgr = GraphicsAttributes {};
+    auto line = Line<Cell>(LineFlags::None,
+                           TrivialLineBuffer { ColumnCount(24),
+                                               interned(sgr),
+                                               interned(sgr),
+                                               HyperlinkId {},
+                                               ColumnCount(18),
+                                               bufferObject->ref(0, testText.size()) });
+
+    auto matches = line.searchMatches(U"abc");
+    REQUIRE(matches.size() == 4);
+    CHECK(matches[0].start == ColumnOffset(0));
+    CHECK(matches[1].start == ColumnOffset(5));
+    CHECK(matches[2].start == ColumnOffset(12));
+    CHECK(matches[3].start == ColumnOffset(15));
+    CHECK(matches[3].length == ColumnCount(3));
+
+    // The matches are kept as long as neither the line nor the pattern changes.
+    CHECK(line.searchMatches(U"abc").data() == matches.data());
+    CHECK(line.searchMatches(U"xyz").empty());
+
+    line.useCellAt(ColumnOffset(1)).write(sgr, U'x', 1);
+    matches = line.searchMatches(U"abc");
+    REQUIRE(matches.size() == 3);
+    CHECK(matches[0].start == ColumnOffset(5));
+}
+
+TEST_CASE("Line.search.inflated", "[Line]")
+{
+    auto const sgr = GraphicsAttributes {};
+    auto line = Line<Cell>(LineFlags::None, Line<Cell>::InflatedBuffer(8, Cell {}));
+    auto column = 0;
+    for (auto const ch: U"ab  xyab"sv)
+        line.useCellAt(ColumnOffset(column++)).write(sgr, ch, 1);
+
+    // Matches are found up to the very end of the line.
+    CHECK(line.search(U"ab", ColumnOffset(1)) == ColumnOffset(6));
+    CHECK(!line.search(U"b ", ColumnOffset(2)).has_value());
+    CHECK(line.searchReverse(U"ab", ColumnOffset(7)) == ColumnOffset(6));
+    CHECK(line.searchReverse(U"ab", ColumnOffset(5)) == ColumnOffset(0));
+    CHECK(line.searchReverse(U"yx", ColumnOffset(5)) == ColumnOffset(5));
+    CHECK(line.searchMatches(U"ab").size() == 2);
+
+    // Lines with grapheme clusters are matched column by column instead, with the same results.
+    (void) line.useCellAt(ColumnOffset(2)).appendCharacter(U'\u0301');
+    CHECK(line.search(U"ab", ColumnOffset(1)) == ColumnOffset(6));
+    CHECK(!line.search(U"b ", ColumnOffset(2)).has_value());
+    CHECK(line.searchReverse(U"ab", ColumnOffset(7)) == ColumnOffset(6));
+    CHECK(line.searchReverse(U"ab", ColumnOffset(5)) == ColumnOffset(0));
+    CHECK(line.searchMatches(U"ab").size() == 2);
+}
+
+TEST_CASE("Line.wordDelimitedAt", "[Line]")
+{
+    auto constexpr testText = "ls -l /usr/bin"sv;
+    auto pool = BufferObjectPool<char>(32);
+    auto bufferObject = pool.allocateBufferObject();
+    bufferObject->writeAtEnd(testText);
+    auto const sgr = GraphicsAttributes {};
+    auto line = Line<Cell>(LineFlags::None,
+                           TrivialLineBuffer { ColumnCount(20),
+                                               interned(sgr),
+                                               interned(sgr),
+                                               HyperlinkId {},
+                                               ColumnCount(14),
+                                               bufferObject->ref(0, testText.size()) });
+
+    auto const delimiters = WordDelimiters(U"/-"sv);
+    auto const delimited = [&](WordDelimiters const& _delimiters) {
+        auto result = std::string {};
+        for (auto column = ColumnOffset(0); column < ColumnOffset(20); ++column)
+            result += line.wordDelimitedAt(column, _delimiters) ? '|' : '.';
+        return result;
+    };
+    CHECK(delimited(delimiters) == "..||.||...|...||||||");
+    CHECK(delimited(WordDelimiters(U""sv)) == "..|..|........||||||");
+    CHECK(line.isTrivialBuffer());
+
+    // The boundaries are found again once the line changes.
+    line.useCellAt(ColumnOffset(1)).write(sgr, U'/', 1);
+    CHECK(delimited(delimiters) == ".|||.||...|...||||||");
+}
+
+TEST_CASE("Line.copyOnWrite", "[Line]")
+{
+    auto line = Line<Cell>(LineFlags::None, Line<Cell>::InflatedBuffer(4, Cell {}));
+    line.fill(ColumnOffset(0), GraphicsAttributes {}, "AB");
+
+    // Copies share the line buffer until one of them is modified.
+    auto const copy = line;
+    CHECK(&copy.inflatedBuffer() == &std::as_const(line).inflatedBuffer());
+
+    line.useCellAt(ColumnOffset(0)).write(GraphicsAttributes {}, U'X', 1);
+    CHECK(&copy.inflatedBuffer() != &std::as_const(line).inflatedBuffer());
+    CHECK(line.toUtf8() == "XB  ");
+    CHECK(copy.toUtf8() == "AB  ");
+}
+
+TEST_CASE("Line.placeImage", "[Line]")
+{
+    auto const image = std::make_shared<Image>(
+        ImageId(1), ImageFormat::RGBA, Image::Data(64), ImageSize { Width(4), Height(4) }, [](auto) {});
+    auto const rasterizedImage = std::make_shared<RasterizedImage>(image,
+                                                                   ImageAlignment::TopStart,
+                                                                   ImageResize::NoResize,
+                                                                   RGBAColor {},
+                                                                   GridSize { LineCount(1), ColumnCount(4) },
+                                                                   ImageSize { Width(1), Height(4) });
+    auto const displayed = [](Line<Cell> const& line) {
+        auto spans = std::vector<std::tuple<int, int, int>> {};
+        line.visitDisplayedImages([&](ImagePlacement const& _image) {
+            spans.emplace_back(
+                unbox<int>(_image.column), unbox<int>(_image.columns), unbox<int>(_image.offset.column));
+        });
+        std::sort(spans.begin(), spans.end());
+        return spans;
+    };
+
+    auto line = Line<Cell>(LineFlags::None, Line<Cell>::InflatedBuffer(8, Cell {}));
+    line.placeImage(ImagePlacement { rasterizedImage, ColumnOffset(2), ColumnCount(4), CellLocation {} }, {});
+    REQUIRE(line.imagePlacements().size() == 1);
+    CHECK(line.useCellAt(ColumnOffset(2)).hasImage());
+    CHECK_FALSE(line.useCellAt(ColumnOffset(1)).hasImage());
+    CHECK((displayed(line) == std::vector<std::tuple<int, int, int>> { { 2, 4, 0 } }));
+
+    // Text written over an image splits what is displayed of it.
+    line.useCellAt(ColumnOffset(3)).write(GraphicsAttributes {}, U'x', 1);
+    CHECK(line.imagePlacementAt(ColumnOffset(3)) == nullptr);
+    CHECK(line.imagePlacementAt(ColumnOffset(4)) == &line.imagePlacements()[0]);
+    CHECK((displayed(line) == std::vector<std::tuple<int, int, int>> { { 2, 1, 0 }, { 4, 2, 2 } }));
+
+    // Placing an image replaces the columns it overlaps, and is clipped to the line.
+    line.placeImage(ImagePlacement { rasterizedImage, ColumnOffset(5), ColumnCount(4), CellLocation {} }, {});
+    CHECK(line.imagePlacements().size() == 2);
+    CHECK((displayed(line)
+           == std::vector<std::tuple<int, int, int>> { { 2, 1, 0 }, { 4, 1, 2 }, { 5, 3, 0 } }));
+
+    // Lines no longer displaying any image drop their placements.
+    line.reset(LineFlags::None, GraphicsAttributes {});
+    CHECK(line.imagePlacements().empty());
+    CHECK(displayed(line).empty());
+}
+
+TEST_CASE("Line.InflatedLineBufferPool", "[Line]")
+{
+    auto& pool = InflatedLineBufferPool<Cell>::get();
+    auto const before = pool.stats();
+
+    auto line = Line<Cell>(LineFlags::None, Line<Cell>::InflatedBuffer(10, Cell {}));
+    auto const copy = line;
+
+    // Buffers still shared with a copy are not taken back.
+    line.reset(LineFlags::None, GraphicsAttributes {}, ColumnCount(10));
+    CHECK(pool.stats().buffers == before.buffers);
+
+    auto other = Line<Cell>(LineFlags::None, Line<Cell>::InflatedBuffer(10, Cell {}));
+    other.reset(LineFlags::None, GraphicsAttributes {}, ColumnCount(10));
+    CHECK(pool.stats().buffers == before.buffers + 1);
+
+    // Inflating a line again reuses the buffer.
+    other.useCellAt(ColumnOffset(0)).write(GraphicsAttributes {}, U'x', 1);
+    CHECK(other.isInflatedBuffer());
+    CHECK(other.size() == ColumnCount(10));
+    CHECK(pool.stats().buffers == before.buffers);
+    CHECK(pool.stats().hits == before.hits + 1);
+}
@@ -0,0 +1,429 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/OpStream.h>
+#include <terminal/Sequencer.h>
+#include <terminal/logging.h>
+
+#include <unicode/utf8.h>
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+#include <variant>
+
+using std::string;
+using std::string_view;
+
+namespace terminal
+{
+
+namespace
+{
+    constexpr auto ReplacementCharacter = char32_t { 0xFFFD };
+
+    /// Sequential reader of the operands of an op stream.
+    class OpStreamReader
+    {
+      public:
+        explicit OpStreamReader(string_view _ops) noexcept: ops_ { _ops } {}
+
+        [[nodiscard]] bool empty() const noexcept { return offset_ == ops_.size(); }
+
+        template <typename T>
+        [[nodiscard]] T read() noexcept
+        {
+            assert(offset_ + sizeof(T) <= ops_.size());
+            auto value = T {};
+            std::memcpy(&value, ops_.data() + offset_, sizeof(T));
+            offset_ += sizeof(T);
+            return value;
+        }
+
+        [[nodiscard]] string_view read(size_t _length) noexcept
+        {
+            assert(offset_ + _length <= ops_.size());
+            auto const bytes = ops_.substr(offset_, _length);
+            offset_ += _length;
+            return bytes;
+        }
+
+      private:
+        string_view ops_;
+        size_t offset_ = 0;
+    };
+
+    void readSequence(OpStreamReader& _reader, Sequence& _sequence)
+    {
+        _sequence.clear();
+        _sequence.setCategory(_reader.read<FunctionCategory>());
+        _sequence.setLeader(_reader.read<char>());
+        _sequence.setFinalChar(_reader.read<char>());
+        _sequence.intermediateCharacters() = _reader.read(_reader.read<uint16_t>());
+        _sequence.dataString() = _reader.read(_reader.read<uint32_t>());
+
+        auto const parameterCount = _reader.read<uint8_t>();
+        auto builder = SequenceParameterBuilder { _sequence.parameters() };
+        builder.reset();
+        for (size_t i = 0; i < parameterCount; ++i)
+        {
+            auto const isSubParameter = _reader.read<bool>();
+            if (i != 0)
+            {
+                if (isSubParameter)
+                    builder.nextSubParameter();
+                else
+                    builder.nextParameter();
+            }
+            builder.set(_reader.read<Sequence::Parameter>());
+        }
+        builder.fixiate();
+    }
+
+    /// @returns the last codepoint of the given UTF-8 text, which must not end incomplete.
+    char32_t lastCodepoint(string_view _text) noexcept
+    {
+        auto start = _text.size() - 1;
+        auto const isContinuationByte = [&](size_t i) {
+            return (static_cast<uint8_t>(_text[i]) & 0xC0) == 0x80;
+        };
+        while (start != 0 && _text.size() - start < 4 && isContinuationByte(start))
+            --start;
+
+        auto state = unicode::utf8_decoder_state {};
+        auto codepoint = char32_t { 0 };
+        for (char const ch: _text.substr(start))
+        {
+            unicode::ConvertResult const r = unicode::from_utf8(state, static_cast<uint8_t>(ch));
+            if (std::holds_alternative<unicode::Success>(r))
+                codepoint = std::get<unicode::Success>(r).value;
+            else if (std::holds_alternative<unicode::Invalid>(r))
+                codepoint = ReplacementCharacter;
+        }
+        return codepoint;
+    }
+
+    void applyText(string_view _text,
+                   size_t _cellCount,
+                   Sequencer& _sequencer,
+                   parser::Parser<Sequencer>& _parser)
+    {
+        if (_cellCount <= _sequencer.maxBulkTextSequenceWidth())
+        {
+            _sequencer.print(_text, _cellCount);
+            _parser.setPrecedingGraphicCharacter(lastCodepoint(_text));
+            return;
+        }
+
+        // Plain US-ASCII takes one cell per byte, so it can be split at any point.
+        if (_text.size() == _cellCount)
+        {
+            while (!_text.empty())
+            {
+                auto const width = std::min(_text.size(), _sequencer.maxBulkTextSequenceWidth());
+                if (width == 0)
+                    break;
+                _sequencer.print(_text.substr(0, width), width);
+                _parser.setPrecedingGraphicCharacter(static_cast<char32_t>(_text[width - 1]));
+                _text.remove_prefix(width);
+            }
+        }
+
+        // Otherwise write the text codepoint by codepoint, exactly like the parser does
+        // if bulk text is not possible.
+        auto state = unicode::utf8_decoder_state {};
+        for (char const ch: _text)
+        {
+            unicode::ConvertResult const r = unicode::from_utf8(state, static_cast<uint8_t>(ch));
+            if (std::holds_alternative<unicode::Incomplete>(r))
+                continue;
+
+            auto const codepoint = std::holds_alternative<unicode::Success>(r)
+                                       ? std::get<unicode::Success>(r).value
+                                       : ReplacementCharacter;
+            _sequencer.print(codepoint);
+            _parser.setPrecedingGraphicCharacter(codepoint);
+        }
+    }
+} // namespace
+
+// {{{ OpStreamWriter
+void OpStreamWriter::begin(string_view _input) noexcept
+{
+    input_ = _input;
+}
+
+string OpStreamWriter::finish()
+{
+    flushPut();
+    input_ = {};
+    return std::exchange(ops_, string {});
+}
+
+void OpStreamWriter::writeOp(Op _op)
+{
+    flushPut();
+    write(_op);
+}
+
+void OpStreamWriter::writeSequence()
+{
+    parameterBuilder_.fixiate();
+
+    auto const& intermediates = sequence_.intermediateCharacters();
+    writeOp(Op::Sequence);
+    write(sequence_.category());
+    write(sequence_.leaderSymbol());
+    write(sequence_.finalChar());
+    write(static_cast<uint16_t>(intermediates.size()));
+    ops_ += intermediates.view();
+    write(static_cast<uint32_t>(sequence_.dataString().size()));
+    ops_ += sequence_.dataString();
+
+    auto const& parameters = sequence_.parameters();
+    write(static_cast<uint8_t>(parameters.count()));
+    for (size_t i = 0; i < parameters.count(); ++i)
+    {
+        write(parameters.isSubParameter(i));
+        write(parameters.at(i));
+    }
+}
+
+void OpStreamWriter::flushPut()
+{
+    if (pendingPut_.empty())
+        return;
+
+    write(Op::Put);
+    write(static_cast<uint32_t>(pendingPut_.size()));
+    ops_ += pendingPut_;
+    pendingPut_.clear();
+}
+
+void OpStreamWriter::error(string_view const& _errorString)
+{
+    if (VTParserLog)
+        VTParserLog()("Parser error: {}", _errorString);
+}
+
+void OpStreamWriter::print(char32_t _codepoint)
+{
+    writeOp(Op::Codepoint);
+    write(_codepoint);
+}
+
+size_t OpStreamWriter::print(string_view _chars, size_t _cellCount)
+{
+    assert(input_.data() <= _chars.data());
+    assert(_chars.data() + _chars.size() <= input_.data() + input_.size());
+
+    writeOp(Op::Text);
+    write(static_cast<uint32_t>(_chars.data() - input_.data()));
+    write(static_cast<uint32_t>(_chars.size()));
+    write(static_cast<uint32_t>(_cellCount));
+    return MaxTextRunWidth;
+}
+
+void OpStreamWriter::execute(char _controlCode)
+{
+    writeOp(Op::Execute);
+    write(_controlCode);
+}
+
+void OpStreamWriter::clear()
+{
+    sequence_.clearExceptParameters();
+    parameterBuilder_.reset();
+}
+
+void OpStreamWriter::collect(char _char)
+{
+    sequence_.intermediateCharacters().push_back(_char);
+}
+
+void OpStreamWriter::collectLeader(char _leader)
+{
+    sequence_.setLeader(_leader);
+}
+
+void OpStreamWriter::param(char _char)
+{
+    switch (_char)
+    {
+        case ';': paramSeparator(); break;
+        case ':': paramSubSeparator(); break;
+        default:
+            if ('0' <= _char && _char <= '9')
+                paramDigit(_char);
+            break;
+    }
+}
+
+void OpStreamWriter::paramDigit(char _char)
+{
+    parameterBuilder_.multiplyBy10AndAdd(static_cast<uint8_t>(_char - '0'));
+}
+
+void OpStreamWriter::paramSeparator()
+{
+    parameterBuilder_.nextParameter();
+}
+
+void OpStreamWriter::paramSubSeparator()
+{
+    parameterBuilder_.nextSubParameter();
+}
+
+void OpStreamWriter::dispatchESC(char _function)
+{
+    sequence_.setCategory(FunctionCategory::ESC);
+    sequence_.setFinalChar(_function);
+    writeSequence();
+}
+
+void OpStreamWriter::dispatchCSI(char _function)
+{
+    sequence_.setCategory(FunctionCategory::CSI);
+    sequence_.setFinalChar(_function);
+    writeSequence();
+}
+
+bool OpStreamWriter::dispatchSGR(string_view _parameters)
+{
+    writeOp(Op::SGR);
+    write(static_cast<uint8_t>(_parameters.size()));
+    ops_ += _parameters;
+    return true;
+}
+
+void OpStreamWriter::startOSC()
+{
+    sequence_.setCategory(FunctionCategory::OSC);
+}
+
+void OpStreamWriter::putOSC(char _char)
+{
+    if (sequence_.dataString().size() < Sequence::MaxOscLength)
+        sequence_.dataString().push_back(_char);
+}
+
+void OpStreamWriter::dispatchOSC()
+{
+    auto const [code, skipCount] = parser::extractCodePrefix(sequence_.dataString());
+    parameterBuilder_.set(static_cast<Sequence::Parameter>(code));
+    sequence_.dataString().erase(0, skipCount);
+    writeSequence();
+    clear();
+}
+
+void OpStreamWriter::hook(char _function)
+{
+    sequence_.setCategory(FunctionCategory::DCS);
+    sequence_.setFinalChar(_function);
+    writeSequence();
+}
+
+void OpStreamWriter::put(char _char)
+{
+    pendingPut_.push_back(_char);
+}
+
+void OpStreamWriter::unhook()
+{
+    writeOp(Op::Unhook);
+}
+
+void OpStreamWriter::startAPC()
+{
+    pendingApc_.clear();
+}
+
+void OpStreamWriter::putAPC(char _char)
+{
+    if (pendingApc_.size() < Sequence::MaxApcLength)
+        pendingApc_.push_back(_char);
+}
+
+void OpStreamWriter::dispatchAPC()
+{
+    writeOp(Op::APC);
+    write(static_cast<uint32_t>(pendingApc_.size()));
+    ops_ += pendingApc_;
+    pendingApc_.clear();
+}
+// }}}
+
+void applyOpStream(string_view _ops,
+                   string_view _input,
+                   Sequencer& _sequencer,
+                   parser::Parser<Sequencer>& _parser)
+{
+    auto reader = OpStreamReader { _ops };
+    auto sequence = Sequence {};
+
+    while (!reader.empty())
+    {
+        switch (reader.read<Op>())
+        {
+            case Op::Text: {
+                auto const offset = reader.read<uint32_t>();
+                auto const length = reader.read<uint32_t>();
+                auto const cellCount = reader.read<uint32_t>();
+                applyText(_input.substr(offset, length), cellCount, _sequencer, _parser);
+                break;
+            }
+            case Op::Codepoint: {
+                auto const codepoint = reader.read<char32_t>();
+                _sequencer.print(codepoint);
+                _parser.setPrecedingGraphicCharacter(codepoint);
+                break;
+            }
+            case Op::Execute: _sequencer.execute(reader.read<char>()); break;
+            case Op::Sequence:
+                readSequence(reader, sequence);
+                _sequencer.dispatch(sequence);
+                // Dispatching a sequence leaves the parser in ground state.
+                _parser.setPrecedingGraphicCharacter(0);
+                break;
+            case Op::SGR: {
+                auto const parameters = reader.read(reader.read<uint8_t>());
+                if (!_sequencer.dispatchSGR(parameters))
+                {
+                    _sequencer.clear();
+                    for (char const ch: parameters)
+                        _sequencer.param(ch);
+                    _sequencer.dispatchCSI('m');
+                }
+                _parser.setPrecedingGraphicCharacter(0);
+                break;
+            }
+            case Op::Put:
+                for (char const ch: reader.read(reader.read<uint32_t>()))
+                    _sequencer.put(ch);
+                break;
+            case Op::Unhook:
+                _sequencer.unhook();
+                _parser.setPrecedingGraphicCharacter(0);
+                break;
+            case Op::APC:
+                _sequencer.startAPC();
+                for (char const ch: reader.read(reader.read<uint32_t>()))
+                    _sequencer.putAPC(ch);
+                _sequencer.dispatchAPC();
+                _parser.setPrecedingGraphicCharacter(0);
+                break;
+        }
+    }
+}
+
+} // namespace terminal
@@ -0,0 +1,133 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <terminal/Parser.h>
+#include <terminal/ParserEvents.h>
+#include <terminal/Sequence.h>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+namespace terminal
+{
+
+class Sequencer;
+
+/// Operations of an op stream, each followed by its operands.
+///
+/// The op stream is a compact binary form of the parsed VT input, with sequences already decoded,
+/// such that parsing and applying the input to the screen can happen on different threads.
+/// Operands are stored in native byte order, as the stream is not meant to leave the process.
+enum class Op : uint8_t
+{
+    Text,      //!< offset, length, and cell count of a text run within the recorded input
+    Codepoint, //!< a single codepoint that was not part of a bulk text run
+    Execute,   //!< a C0 control code
+    Sequence,  //!< a decoded ESC, CSI, OSC sequence, or the DCS sequence hooking its data string
+    SGR,       //!< the parameter bytes of a plain SGR sequence
+    Put,       //!< length and bytes of a DCS data string (chunk)
+    Unhook,    //!< the end of a DCS data string
+    APC,       //!< length and bytes of an APC string
+};
+
+/// Records the events of a Parser as op stream, on a per input chunk basis.
+///
+/// The writer keeps the state of sequences that are still being parsed across chunks,
+/// whereas text operations refer to the input chunk they have been recorded from.
+///
+/// PM strings are not recorded, as the Sequencer ignores them, too.
+class OpStreamWriter final: public ParserEvents
+{
+  public:
+    /// Largest text run to be recorded at once.
+    ///
+    /// The screen state that determines how much text fits into the current line at the time
+    /// the text is applied is not known while recording. Text runs not fitting are split up
+    /// while being applied.
+    static constexpr size_t MaxTextRunWidth = 4096;
+
+    /// Starts recording the operations of the given input chunk, which is about to be parsed.
+    void begin(std::string_view _input) noexcept;
+
+    /// Finishes recording the current input chunk.
+    ///
+    /// @returns the op stream of the chunk.
+    [[nodiscard]] std::string finish();
+
+    // ParserEvents
+    //
+    void error(std::string_view const& _errorString) override;
+    void print(char32_t _codepoint) override;
+    size_t print(std::string_view _chars, size_t _cellCount) override;
+    [[nodiscard]] size_t maxBulkTextSequenceWidth() const noexcept override { return MaxTextRunWidth; }
+    void execute(char _controlCode) override;
+    void clear() override;
+    void collect(char _char) override;
+    void collectLeader(char _leader) override;
+    void param(char _char) override;
+    void paramDigit(char _char) override;
+    void paramSeparator() override;
+    void paramSubSeparator() override;
+    void dispatchESC(char _function) override;
+    void dispatchCSI(char _function) override;
+    bool dispatchSGR(std::string_view _parameters) override;
+    void startOSC() override;
+    void putOSC(char _char) override;
+    void dispatchOSC() override;
+    void hook(char _function) override;
+    void put(char _char) override;
+    void unhook() override;
+    void startAPC() override;
+    void putAPC(char _char) override;
+    void dispatchAPC() override;
+    void startPM() override {}
+    void putPM(char) override {}
+    void dispatchPM() override {}
+
+  private:
+    void writeOp(Op _op);
+    void writeSequence();
+    void flushPut();
+
+    template <typename T>
+    void write(T _value)
+    {
+        auto const offset = ops_.size();
+        ops_.resize(offset + sizeof(T));
+        std::memcpy(ops_.data() + offset, &_value, sizeof(T));
+    }
+
+    std::string_view input_;
+    std::string ops_;
+    std::string pendingPut_;
+    std::string pendingApc_;
+    Sequence sequence_ {};
+    SequenceParameterBuilder parameterBuilder_ { sequence_.parameters() };
+};
+
+/// Applies an op stream, as recorded by OpStreamWriter, to the screen.
+///
+/// @param _ops       the op stream to apply
+/// @param _input     the input chunk the op stream has been recorded from
+/// @param _sequencer the sequencer to apply the operations with
+/// @param _parser    the sequencer's parser, which keeps track of the preceding graphic character
+void applyOpStream(std::string_view _ops,
+                   std::string_view _input,
+                   Sequencer& _sequencer,
+                   parser::Parser<Sequencer>& _parser);
+
+} // namespace terminal
@@ -26,8 +26,11 @@
 
 #include <fmt/format.h>
 
+#include <algorithm>
 #include <array>
+#include <bit>
 #include <cctype>
+#include <cstddef>
 #include <cstdio>
 #include <map>
 #include <ostream>
@@ -36,6 +39,10 @@
 
 #if defined(__SSE2__)
     #include <immintrin.h>
+    #define LIBTERMINAL_PARSER_SIMD 1
+#elif defined(__aarch64__)
+    #include <crispy/sse2neon.h>
+    #define LIBTERMINAL_PARSER_SIMD 1
 #endif
 
 using namespace std;
@@ -51,6 +58,55 @@ namespace
         return static_cast<uint8_t>(_value);
     }
     // clang-format on
+
+    constexpr bool isPrintableASCII(char ch) noexcept
+    {
+        auto const value = static_cast<uint8_t>(ch);
+        return 0x20 <= value && value < 0x7F;
+    }
+
+    /// Scans for the first byte that is not printable US-ASCII, i.e. a C0 control code,
+    /// DEL, or any byte that is part of a UTF-8 multi-byte sequence.
+    ///
+    /// @returns the number of leading bytes in [begin, begin + maxCount) that are printable US-ASCII.
+    size_t scanPrintableASCII(char const* begin, char const* end, size_t maxCount) noexcept
+    {
+        auto const count = std::min(maxCount, static_cast<size_t>(std::distance(begin, end)));
+        auto i = size_t { 0 };
+
+        // NB: The comparisons below are signed, so that bytes >= 0x80 are negative
+        // and thus also treated as being less than 0x20.
+
+#if defined(__AVX2__)
+        auto const space256 = _mm256_set1_epi8(0x20);
+        auto const del256 = _mm256_set1_epi8(0x7F);
+        for (; i + sizeof(__m256i) <= count; i += sizeof(__m256i))
+        {
+            auto const batch = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(begin + i));
+            auto const stop =
+                _mm256_or_si256(_mm256_cmpgt_epi8(space256, batch), _mm256_cmpeq_epi8(batch, del256));
+            if (auto const mask = static_cast<uint32_t>(_mm256_movemask_epi8(stop)); mask != 0)
+                return i + static_cast<size_t>(std::countr_zero(mask));
+        }
+#endif
+
+#if defined(LIBTERMINAL_PARSER_SIMD)
+        auto const space128 = _mm_set1_epi8(0x20);
+        auto const del128 = _mm_set1_epi8(0x7F);
+        for (; i + sizeof(__m128i) <= count; i += sizeof(__m128i))
+        {
+            auto const batch = _mm_loadu_si128(reinterpret_cast<__m128i const*>(begin + i));
+            auto const stop = _mm_or_si128(_mm_cmplt_epi8(batch, space128), _mm_cmpeq_epi8(batch, del128));
+            if (auto const mask = static_cast<uint32_t>(_mm_movemask_epi8(stop)); mask != 0)
+                return i + static_cast<size_t>(std::countr_zero(mask));
+        }
+#endif
+
+        while (i != count && isPrintableASCII(begin[i]))
+            ++i;
+
+        return i;
+    }
 } // namespace
 
 struct ParserTable
@@ -236,6 +292,8 @@ constexpr ParserTable ParserTable::get() // {{{
             Range { 0x1C_b, 0x1F_b },
             Range { 0x20_b, 0x7E_b });
     t.event(State::DCS_PassThrough, Action::Ignore, 0x7F_b);
+    // Dropped by the sequencer unless the hooked parser takes UTF-8, see ParserExtension::passesUnicode().
+    t.event(State::DCS_PassThrough, Action::Put, UnicodeRange);
     t.exit(State::DCS_PassThrough, Action::Unhook);
     // t.transition(State::DCS_PassThrough, State::Ground, 0x9C_b);
 
@@ -343,11 +401,119 @@ constexpr ParserTable ParserTable::get() // {{{
     }
 
     // TODO: verify the above is correct (programatically as much as possible)
-    // TODO: see if we can reduce the preassure on L2 caches (is this even an issue?)
 
     return t;
 } // }}}
 
+/// Compact form of the ParserTable, as consulted by the state machine for each input byte.
+///
+/// Input bytes that behave the same in every state are folded into one byte class, so that
+/// all transitions and actions of a state fit into a single cache line. The rows of the hot
+/// states (Ground, Escape, CSI_Entry, CSI_Param) are adjacent, and the whole table takes
+/// about 1.4 KB, as opposed to the 9 KB of the table it is derived from.
+struct alignas(64) PackedParserTable
+{
+    static constexpr size_t MaxByteClasses = 32;
+
+    struct Entry
+    {
+        State transition; //!< target state, or State::Undefined if the input does not change state
+        Action action;
+    };
+
+    // Transitions and actions are kept in separate halves of a row rather than interleaved,
+    // which keeps the address computation on the state-dependent path down to a shift.
+    struct Row
+    {
+        std::array<State, MaxByteClasses> transitions;
+        std::array<Action, MaxByteClasses> actions;
+    };
+
+    std::array<Row, std::numeric_limits<State>::size()> rows {};
+    std::array<uint8_t, 256> byteClasses {};
+    std::array<Action, std::numeric_limits<State>::size()> entryEvents {};
+    std::array<Action, std::numeric_limits<State>::size()> exitEvents {};
+    size_t byteClassCount = 0;
+
+    [[nodiscard]] constexpr Entry entry(State _state, uint8_t _input) const noexcept
+    {
+        auto const byteClass = byteClasses[_input];
+        auto const& row = rows[static_cast<size_t>(_state)];
+        return Entry { row.transitions[byteClass], row.actions[byteClass] };
+    }
+
+    static constexpr PackedParserTable get();
+};
+
+static_assert(sizeof(PackedParserTable::Row) == 64);
+
+constexpr PackedParserTable PackedParserTable::get() // {{{
+{
+    auto constexpr StateCount = std::numeric_limits<State>::size();
+    auto const source = ParserTable::get();
+    auto const sameColumn = [&](uint8_t a, uint8_t b) {
+        for (size_t s = 0; s < StateCount; ++s)
+            if (source.transitions[s][a] != source.transitions[s][b]
+                || source.events[s][a] != source.events[s][b])
+                return false;
+        return true;
+    };
+
+    auto t = PackedParserTable {};
+    auto representatives = std::array<uint8_t, MaxByteClasses> {};
+    for (unsigned input = 0; input < 256; ++input)
+    {
+        auto const ch = static_cast<uint8_t>(input);
+        auto byteClass = size_t { 0 };
+        while (byteClass != t.byteClassCount && !sameColumn(representatives[byteClass], ch))
+            ++byteClass;
+
+        if (byteClass == t.byteClassCount)
+        {
+            // Exceeding MaxByteClasses fails the constant evaluation, and thus the build.
+            representatives.at(byteClass) = ch;
+            for (size_t s = 0; s < StateCount; ++s)
+            {
+                t.rows[s].transitions[byteClass] = source.transitions[s][ch];
+                t.rows[s].actions[byteClass] = source.events[s][ch];
+            }
+            ++t.byteClassCount;
+        }
+        t.byteClasses[ch] = static_cast<uint8_t>(byteClass);
+    }
+
+    for (size_t s = 0; s < StateCount; ++s)
+    {
+        t.entryEvents[s] = source.entryEvents[s];
+        t.exitEvents[s] = source.exitEvents[s];
+    }
+
+    return t;
+} // }}}
+
+namespace
+{
+    constexpr bool isEquivalentTo(PackedParserTable const& _packed, ParserTable const& _table) noexcept
+    {
+        for (size_t s = 0; s < std::numeric_limits<State>::size(); ++s)
+        {
+            for (unsigned input = 0; input < 256; ++input)
+            {
+                auto const e = _packed.entry(static_cast<State>(s), static_cast<uint8_t>(input));
+                if (e.transition != _table.transitions[s][input] || e.action != _table.events[s][input])
+                    return false;
+            }
+            if (_packed.entryEvents[s] != _table.entryEvents[s]
+                || _packed.exitEvents[s] != _table.exitEvents[s])
+                return false;
+        }
+        return true;
+    }
+
+    constexpr auto packedParserTable = PackedParserTable::get();
+    static_assert(isEquivalentTo(packedParserTable, ParserTable::get()));
+} // namespace
+
 template <typename EventListener, bool TraceStateChanges>
 void Parser<EventListener, TraceStateChanges>::parseFragment(gsl::span<char const> data)
 {
@@ -365,28 +531,62 @@ void Parser<EventListener, TraceStateChanges>::parseFragment(gsl::span<char cons
                 break;
                 // clang-format on
             case ProcessKind::FallbackToFSM:
-                processOnceViaStateMachine(static_cast<uint8_t>(*input++));
+                if (auto const sgrByteCount = parseSGR(input, end); sgrByteCount != 0)
+                    input += sgrByteCount;
+                else
+                    processOnceViaStateMachine(static_cast<uint8_t>(*input++));
                 break;
         }
     }
 }
 
+template <typename EventListener, bool TraceStateChanges>
+size_t Parser<EventListener, TraceStateChanges>::parseSGR(char const* input, char const* end) noexcept
+{
+    // Upper bound on the parameter string length to look ahead for the final character.
+    constexpr auto MaxParameterLength = 64;
+
+    if constexpr (TraceStateChanges)
+        return 0;
+
+    if (state_ != State::Ground || end - input < 3 || input[0] != '\033' || input[1] != '[')
+        return 0;
+
+    auto const* const parameters = input + 2;
+    auto const* const parametersEnd =
+        parameters + std::min(end - parameters, std::ptrdiff_t { MaxParameterLength });
+    auto const* i = parameters;
+    while (i != parametersEnd && ((*i >= '0' && *i <= '9') || *i == ';'))
+        ++i;
+
+    if (i == parametersEnd || *i != 'm')
+        return 0;
+
+    if (!eventListener_.dispatchSGR(std::string_view(parameters, static_cast<size_t>(i - parameters))))
+        return 0;
+
+    // Same as the state machine does when returning to ground state after the sequence.
+    scanState_.lastCodepointHint = 0;
+
+    return static_cast<size_t>(i + 1 - input);
+}
+
 template <typename EventListener, bool TraceStateChanges>
 void Parser<EventListener, TraceStateChanges>::processOnceViaStateMachine(uint8_t ch)
 {
-    auto const s = static_cast<size_t>(state_);
-    ParserTable static constexpr table = ParserTable::get();
+    auto const& table = packedParserTable;
+    auto const entry = table.entry(state_, ch);
 
-    if (auto const t = table.transitions[s][static_cast<uint8_t>(ch)]; t != State::Undefined)
+    if (auto const t = entry.transition; t != State::Undefined)
     {
         // fmt::print("VTParser: Transitioning from {} to {}", state_, t);
         // handle(_actionClass, _action, currentChar());
-        handle(ActionClass::Leave, table.exitEvents[s], ch);
-        handle(ActionClass::Transition, table.events[s][static_cast<size_t>(ch)], ch);
+        handle(ActionClass::Leave, table.exitEvents[static_cast<size_t>(state_)], ch);
+        handle(ActionClass::Transition, entry.action, ch);
         state_ = t;
         handle(ActionClass::Enter, table.entryEvents[static_cast<size_t>(t)], ch);
     }
-    else if (Action const a = table.events[s][ch]; a != Action::Undefined)
+    else if (Action const a = entry.action; a != Action::Undefined)
         handle(ActionClass::Event, a, ch);
     else
         eventListener_.error(
@@ -408,6 +608,38 @@ auto Parser<EventListener, TraceStateChanges>::parseBulkText(char const* begin,
     if (!maxCharCount)
         return { ProcessKind::FallbackToFSM, 0 };
 
+    if (scanState_.utf8.expectedLength == 0)
+    {
+        // Fast path for pure US-ASCII runs, as they are the vast majority of what gets written
+        // to the terminal (e.g. compiler output or logs). Each byte maps to exactly one cell here.
+        auto asciiCount = scanPrintableASCII(input, end, maxCharCount);
+
+        // If the run is followed by non-ASCII, leave its last character to the Unicode scanner,
+        // as it might form a grapheme cluster with what follows (e.g. combining characters).
+        if (asciiCount != 0 && input + asciiCount != end && static_cast<uint8_t>(input[asciiCount]) >= 0x80)
+            --asciiCount;
+
+        if (asciiCount != 0)
+        {
+#if defined(LIBTERMINAL_LOG_TRACE)
+            if (VTTraceParserLog)
+                VTTraceParserLog()("[Unicode] Scanned ASCII text: maxCharCount {}; cells {}: \"{}\"",
+                                   maxCharCount,
+                                   asciiCount,
+                                   crispy::escape(std::string_view { input, asciiCount }));
+#endif
+            eventListener_.print(std::string_view { input, asciiCount }, asciiCount);
+            scanState_.lastCodepointHint = static_cast<char32_t>(input[asciiCount - 1]);
+            input += asciiCount;
+
+            // Same `(TEXT LF+)+` optimization for the `cat`-people as below.
+            if (input != end && *input == '\n')
+                eventListener_.execute(*input++);
+
+            return { ProcessKind::ContinueBulk, static_cast<size_t>(std::distance(begin, input)) };
+        }
+    }
+
     auto const chunk = std::string_view(input, static_cast<size_t>(std::distance(input, end)));
     auto const [cellCount, next, subStart, subEnd] = unicode::scan_for_text(scanState_, chunk, maxCharCount);
 
@@ -561,6 +561,12 @@ class Parser
 
     [[nodiscard]] char32_t precedingGraphicCharacter() const noexcept { return scanState_.lastCodepointHint; }
 
+    /// Overrides the preceding graphic character, for input that has been parsed elsewhere.
+    void setPrecedingGraphicCharacter(char32_t _codepoint) noexcept
+    {
+        scanState_.lastCodepointHint = _codepoint;
+    }
+
     void printUtf8Byte(char ch);
 
   private:
@@ -573,6 +579,13 @@ class Parser
     };
 
     std::tuple<ProcessKind, size_t> parseBulkText(char const* input, char const* end) noexcept;
+
+    /// Dispatches a complete "CSI Ps ; ... m" sequence at the given input in one go,
+    /// bypassing the state machine and the generic sequence dispatch.
+    ///
+    /// @returns the number of bytes consumed, or 0 if the input does not start with such a sequence
+    ///          or the event listener rejected it.
+    size_t parseSGR(char const* input, char const* end) noexcept;
     void processOnceViaStateMachine(uint8_t input);
 
     void handle(ActionClass _actionClass, Action _action, uint8_t _char);
@@ -117,6 +117,15 @@ class ParserEvents
      */
     virtual void dispatchCSI(char _function) = 0;
 
+    /**
+     * Optimization that passes in the parameters of a complete SGR sequence (`CSI Ps ; ... m`),
+     * consisting of digits and semicolons only, without going through the other CSI events.
+     *
+     * @retval true the sequence has been handled.
+     * @retval false the sequence has not been handled and must be processed as usual.
+     */
+    virtual bool dispatchSGR(std::string_view /*_parameters*/) { return false; }
+
     /**
      * When the control function OSC (Operating System Command) is recognised,
      * this action initializes an external parser (the “OSC Handler”)
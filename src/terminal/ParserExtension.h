@@ -2,6 +2,7 @@
 
 #include <functional>
 #include <string>
+#include <string_view>
 
 namespace terminal
 {
@@ -18,14 +19,28 @@ class ParserExtension
 
     virtual void pass(char _char) = 0;
     virtual void finalize() = 0;
+
+    /// Whether bytes of 0x80 and above are passed on, e.g. for UTF-8 encoded data strings.
+    /// These are dropped otherwise.
+    [[nodiscard]] virtual bool passesUnicode() const noexcept { return false; }
 };
 
+/// Collects the data string of a DCS sequence, passing it on once finalized.
+///
+/// The collected data is capped at MaxDataLength bytes, such that a DCS sequence that is never
+/// terminated by ST cannot grow it without bounds.
 class SimpleStringCollector: public ParserExtension
 {
   public:
+    static constexpr size_t MaxDataLength = 64 * 1024;
+
     explicit SimpleStringCollector(std::function<void(std::string_view)> _done): done_ { std::move(_done) } {}
 
-    void pass(char _char) override { data_.push_back(_char); }
+    void pass(char _char) override
+    {
+        if (data_.size() < MaxDataLength)
+            data_.push_back(_char);
+    }
 
     void finalize() override
     {
@@ -14,6 +14,8 @@
 #include <terminal/Parser.h>
 #include <terminal/ParserEvents.h>
 
+#include <crispy/escape.h>
+
 #include <unicode/convert.h>
 
 #include <catch2/catch.hpp>
@@ -78,3 +80,25 @@ TEST_CASE("Parser.APC")
     REQUIRE(listener.apc == "{Gi=1,a=q;}");
     REQUIRE(listener.text == "ABCDEF");
 }
+
+TEST_CASE("Parser.bulk_ascii")
+{
+    // Ensures the vectorized ASCII scan stops exactly at the first non-printable byte,
+    // regardless of where it lands relative to the SIMD block boundaries.
+    for (auto const length: { 1, 15, 16, 17, 31, 32, 33, 100 })
+    {
+        for (auto const stopper: { "\033[m"sv, "\r"sv, "\x7F"sv, "\xC3\xB6"sv })
+        {
+            INFO(fmt::format("length: {}, stopper: {}", length, crispy::escape(stopper)));
+            MockParserEvents listener;
+            auto p = parser::Parser<ParserEvents>(listener);
+            auto const text = std::string(static_cast<size_t>(length), 'a');
+            p.parseFragment(fmt::format("{}{}{}", text, stopper, text));
+            CHECK(p.state() == parser::State::Ground);
+            if (stopper == "\xC3\xB6"sv || stopper == "\x7F"sv)
+                CHECK(listener.text == text + string(stopper) + text);
+            else
+                CHECK(listener.text == text + text);
+        }
+    }
+}
@@ -20,6 +20,7 @@
 
 #include <fmt/format.h>
 
+#include <functional>
 #include <map>
 #include <memory>
 #include <optional>
@@ -91,6 +92,13 @@ class [[nodiscard]] Process: public Pty
     [[nodiscard]] std::optional<ExitStatus> checkStatus() const;
     [[nodiscard]] ExitStatus wait();
 
+    /// Has the given handler invoked once the started process exited, on a thread shared by
+    /// all processes, or right away if it exited already.
+    ///
+    /// The exit is only reported where the system allows watching for it (see ProcessExitWatcher),
+    /// and is otherwise to be noticed by means of checkStatus().
+    void setExitHandler(std::function<void(ExitStatus)> _handler);
+
     [[nodiscard]] std::string workingDirectory() const;
 
     enum class TerminationHint
@@ -104,6 +112,10 @@ class [[nodiscard]] Process: public Pty
     [[nodiscard]] Pty const& pty() const noexcept;
 
     // Pty overrides
+    //
+    // Starting a process that has been started already has no effect,
+    // such that processes can be started ahead of time.
+    //
     // clang-format off
     void start() override;
     [[nodiscard]] PtySlave& slave() noexcept override { return pty().slave(); }
@@ -111,6 +123,7 @@ class [[nodiscard]] Process: public Pty
     [[nodiscard]] bool isClosed() const noexcept override { return pty().isClosed(); }
     [[nodiscard]] ReadResult read(crispy::BufferObject<char>& storage, std::chrono::milliseconds timeout, size_t n) override { return pty().read(storage, timeout, n); }
     void wakeupReader() override { return pty().wakeupReader(); }
+    [[nodiscard]] std::vector<int> readableFileDescriptors() override { return pty().readableFileDescriptors(); }
     [[nodiscard]] int write(char const* buf, size_t size) override { return pty().write(buf, size); }
     [[nodiscard]] PageSize pageSize() const noexcept override { return pty().pageSize(); }
     void resizeScreen(PageSize _cells, std::optional<ImageSize> _pixels = std::nullopt) override { pty().resizeScreen(_cells, _pixels); }
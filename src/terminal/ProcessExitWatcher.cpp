@@ -0,0 +1,328 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/ProcessExitWatcher.h>
+#include <terminal/pty/Pty.h>
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+#if defined(_WIN32)
+    #include <Windows.h>
+#else
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+#if defined(__linux__)
+    #include <sys/epoll.h>
+    #include <sys/syscall.h>
+    #if defined(SYS_pidfd_open)
+        #define LIBTERMINAL_EXIT_WATCHER_EPOLL 1
+    #endif
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__)
+    #include <sys/event.h>
+    #define LIBTERMINAL_EXIT_WATCHER_KQUEUE 1
+#endif
+
+using std::unique_lock;
+using std::vector;
+
+namespace terminal
+{
+
+ProcessExitWatcher& ProcessExitWatcher::shared()
+{
+    static ProcessExitWatcher watcher;
+    return watcher;
+}
+
+ProcessExitWatcher::ProcessExitWatcher()
+{
+#if defined(LIBTERMINAL_EXIT_WATCHER_EPOLL) || defined(LIBTERMINAL_EXIT_WATCHER_KQUEUE)
+    if (::pipe(wakeupPipe_) != 0)
+    {
+        PtyLog()("Failed to create process exit watcher wakeup pipe. {}", strerror(errno));
+        return;
+    }
+    for (auto const fd: wakeupPipe_)
+        ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    #if defined(LIBTERMINAL_EXIT_WATCHER_EPOLL)
+    queue_ = ::epoll_create1(EPOLL_CLOEXEC);
+    auto event = epoll_event {};
+    event.events = EPOLLIN;
+    event.data.u64 = 0;
+    if (queue_ != -1 && ::epoll_ctl(queue_, EPOLL_CTL_ADD, wakeupPipe_[0], &event) != 0)
+    {
+        ::close(queue_);
+        queue_ = -1;
+    }
+    #else
+    queue_ = ::kqueue();
+    if (queue_ != -1)
+    {
+        ::fcntl(queue_, F_SETFD, FD_CLOEXEC);
+        struct kevent change;
+        EV_SET(&change, wakeupPipe_[0], EVFILT_READ, EV_ADD, 0, 0, nullptr);
+        if (::kevent(queue_, &change, 1, nullptr, 0, nullptr) == -1)
+        {
+            ::close(queue_);
+            queue_ = -1;
+        }
+    }
+    #endif
+
+    if (queue_ == -1)
+    {
+        PtyLog()("Failed to create process exit watcher queue. {}", strerror(errno));
+        return;
+    }
+
+    thread_ = std::thread(&ProcessExitWatcher::watchLoop, this);
+#endif
+}
+
+ProcessExitWatcher::~ProcessExitWatcher()
+{
+    wakeupWatchLoop();
+    if (thread_.joinable())
+        thread_.join();
+
+    auto entries = std::map<uint64_t, Entry> {};
+    {
+        auto const _ = std::lock_guard { mutex_ };
+        entries.swap(entries_);
+    }
+    for (auto& [id, entry]: entries)
+        release(std::move(entry), false);
+
+#if !defined(_WIN32)
+    if (queue_ != -1)
+        ::close(queue_);
+    for (auto const fd: wakeupPipe_)
+        if (fd != -1)
+            ::close(fd);
+#endif
+}
+
+uint64_t ProcessExitWatcher::add(NativeHandle _process, Handler _handler)
+{
+    // Registering while holding the lock keeps an exit that is reported right away from being
+    // looked up before its entry has been added.
+    auto const _ = std::lock_guard { mutex_ };
+    auto const id = nextId_;
+    auto entry = Entry { std::move(_handler) };
+
+#if defined(LIBTERMINAL_EXIT_WATCHER_EPOLL)
+    if (!thread_.joinable())
+        return 0;
+    auto const pidfd = static_cast<int>(::syscall(SYS_pidfd_open, _process, 0));
+    if (pidfd == -1)
+    {
+        PtyLog()("Cannot watch process {} for exit. {}", _process, strerror(errno));
+        return 0;
+    }
+    ::fcntl(pidfd, F_SETFD, FD_CLOEXEC);
+    auto event = epoll_event {};
+    event.events = EPOLLIN;
+    event.data.u64 = id;
+    if (::epoll_ctl(queue_, EPOLL_CTL_ADD, pidfd, &event) != 0)
+    {
+        ::close(pidfd);
+        return 0;
+    }
+    entry.native = pidfd;
+#elif defined(LIBTERMINAL_EXIT_WATCHER_KQUEUE)
+    if (!thread_.joinable())
+        return 0;
+    struct kevent change;
+    EV_SET(&change,
+           _process,
+           EVFILT_PROC,
+           EV_ADD | EV_ONESHOT,
+           NOTE_EXIT,
+           0,
+           reinterpret_cast<void*>(static_cast<uintptr_t>(id)));
+    if (::kevent(queue_, &change, 1, nullptr, 0, nullptr) == -1)
+    {
+        PtyLog()("Cannot watch process {} for exit. {}", _process, strerror(errno));
+        return 0;
+    }
+    entry.native = _process;
+#elif defined(_WIN32)
+    entry.context = std::make_unique<WaitContext>(WaitContext { this, id });
+    auto const onExited = [](void* _context, BOOLEAN) {
+        auto const* context = static_cast<WaitContext const*>(_context);
+        context->watcher->notify(context->id);
+    };
+    HANDLE wait = nullptr;
+    if (!RegisterWaitForSingleObject(
+            &wait, _process, onExited, entry.context.get(), INFINITE, WT_EXECUTEONLYONCE))
+    {
+        PtyLog()("Cannot watch process for exit. Error code {}.", GetLastError());
+        return 0;
+    }
+    entry.native = reinterpret_cast<std::intptr_t>(wait);
+#else
+    (void) _process;
+    return 0;
+#endif
+
+    entries_.emplace(id, std::move(entry));
+    return nextId_++;
+}
+
+void ProcessExitWatcher::remove(uint64_t _id)
+{
+    auto entry = Entry {};
+    {
+        auto lock = unique_lock { mutex_ };
+        auto i = entries_.find(_id);
+        if (i == entries_.end())
+            return;
+
+        if (i->second.running)
+        {
+            handlerReturned_.wait(lock, [&]() {
+                i = entries_.find(_id);
+                return i == entries_.end() || !i->second.running;
+            });
+            if (i == entries_.end())
+                return; // The process exited, and its handler has been invoked.
+        }
+
+        entry = std::move(i->second);
+        entries_.erase(i);
+    }
+    release(std::move(entry), false);
+}
+
+size_t ProcessExitWatcher::size() const
+{
+    auto const _ = std::lock_guard { mutex_ };
+    return entries_.size();
+}
+
+void ProcessExitWatcher::notify(uint64_t _id)
+{
+    auto handler = Handler {};
+    {
+        auto const _ = std::lock_guard { mutex_ };
+        auto const i = entries_.find(_id);
+        if (i == entries_.end())
+            return; // Removed while the exit was being reported.
+        i->second.running = true;
+        handler = i->second.handler;
+    }
+
+    handler();
+
+    auto entry = Entry {};
+    {
+        auto const _ = std::lock_guard { mutex_ };
+        auto const i = entries_.find(_id);
+        entry = std::move(i->second);
+        entries_.erase(i);
+    }
+    handlerReturned_.notify_all();
+    release(std::move(entry), true);
+}
+
+void ProcessExitWatcher::release(Entry _entry, bool _exited) noexcept
+{
+    if (_entry.native == -1)
+        return;
+
+#if defined(LIBTERMINAL_EXIT_WATCHER_EPOLL)
+    (void) _exited;
+    ::close(static_cast<int>(_entry.native)); // Also removes it from the epoll set.
+#elif defined(LIBTERMINAL_EXIT_WATCHER_KQUEUE)
+    if (_exited)
+        return; // The one-shot event has been removed already.
+    struct kevent change;
+    EV_SET(&change, static_cast<uintptr_t>(_entry.native), EVFILT_PROC, EV_DELETE, 0, 0, nullptr);
+    (void) ::kevent(queue_, &change, 1, nullptr, 0, nullptr);
+#elif defined(_WIN32)
+    // The callback cannot wait for itself to return, and is done with the context once the exit
+    // has been reported, though.
+    auto const wait = reinterpret_cast<HANDLE>(_entry.native);
+    UnregisterWaitEx(wait, _exited ? nullptr : INVALID_HANDLE_VALUE);
+#else
+    (void) _exited;
+#endif
+}
+
+void ProcessExitWatcher::wakeupWatchLoop() noexcept
+{
+#if !defined(_WIN32)
+    if (wakeupPipe_[1] == -1)
+        return;
+    char const dummy {};
+    auto const rv = ::write(wakeupPipe_[1], &dummy, sizeof(dummy));
+    (void) rv;
+#endif
+}
+
+void ProcessExitWatcher::watchLoop()
+{
+#if defined(LIBTERMINAL_EXIT_WATCHER_EPOLL)
+    auto events = std::array<epoll_event, 64> {};
+    for (;;)
+    {
+        auto const count = ::epoll_wait(queue_, events.data(), static_cast<int>(events.size()), -1);
+        if (count < 0 && errno != EINTR)
+        {
+            PtyLog()("Process exit watcher failed to wait. {}", strerror(errno));
+            return;
+        }
+
+        auto exited = vector<uint64_t> {};
+        for (auto i = 0; i < count; ++i)
+        {
+            if (events[static_cast<size_t>(i)].data.u64 == 0)
+                return; // Woken up for stopping.
+            exited.push_back(events[static_cast<size_t>(i)].data.u64);
+        }
+        for (auto const id: exited)
+            notify(id);
+    }
+#elif defined(LIBTERMINAL_EXIT_WATCHER_KQUEUE)
+    auto events = std::array<struct kevent, 64> {};
+    for (;;)
+    {
+        auto const count =
+            ::kevent(queue_, nullptr, 0, events.data(), static_cast<int>(events.size()), nullptr);
+        if (count < 0 && errno != EINTR)
+        {
+            PtyLog()("Process exit watcher failed to wait. {}", strerror(errno));
+            return;
+        }
+
+        auto exited = vector<uint64_t> {};
+        for (auto i = 0; i < count; ++i)
+        {
+            auto const& event = events[static_cast<size_t>(i)];
+            if (event.filter == EVFILT_READ)
+                return; // Woken up for stopping.
+            exited.push_back(static_cast<uint64_t>(reinterpret_cast<uintptr_t>(event.udata)));
+        }
+        for (auto const id: exited)
+            notify(id);
+    }
+#endif
+}
+
+} // namespace terminal
@@ -0,0 +1,98 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace terminal
+{
+
+/// Notifies about child processes having exited, without a thread or polling per process.
+///
+/// A single thread waits for all watched processes, by means of pidfd and epoll on Linux, and
+/// of kqueue on macOS and the BSDs. On Windows, the waits are registered with the system thread
+/// pool instead.
+///
+/// The handler of a process is invoked at most once, on the watcher's thread, and the process is
+/// no longer watched afterwards. The handler is to reap the process itself, if needed.
+class ProcessExitWatcher
+{
+  public:
+#if defined(_WIN32)
+    using NativeHandle = void*; //!< process HANDLE
+#else
+    using NativeHandle = int; //!< process ID
+#endif
+    using Handler = std::function<void()>;
+
+    /// Returns the watcher shared by all processes, which is started when first used.
+    static ProcessExitWatcher& shared();
+
+    ProcessExitWatcher();
+    ~ProcessExitWatcher();
+
+    ProcessExitWatcher(ProcessExitWatcher const&) = delete;
+    ProcessExitWatcher& operator=(ProcessExitWatcher const&) = delete;
+
+    /// Starts waiting for the given child process to exit, invoking @p _handler once it did.
+    ///
+    /// @returns the ID to pass to remove(), or 0 if the process cannot be watched on this system,
+    ///          in which case its exit has to be checked for otherwise.
+    [[nodiscard]] uint64_t add(NativeHandle _process, Handler _handler);
+
+    /// Stops waiting for the process of the given ID, waiting for its handler to return if it is
+    /// currently running.
+    ///
+    /// This must not be invoked from within that handler.
+    void remove(uint64_t _id);
+
+    /// @returns the number of processes currently watched.
+    [[nodiscard]] size_t size() const;
+
+  private:
+    struct WaitContext
+    {
+        ProcessExitWatcher* watcher;
+        uint64_t id;
+    };
+
+    struct Entry
+    {
+        Handler handler;
+        std::intptr_t native = -1; //!< pidfd, process ID or thread pool wait handle
+        std::unique_ptr<WaitContext> context {}; //!< passed to the thread pool wait, if any
+        bool running = false;                    //!< handler being invoked
+    };
+
+    void watchLoop();
+    void notify(uint64_t _id);
+    void release(Entry _entry, bool _exited) noexcept;
+    void wakeupWatchLoop() noexcept;
+
+    mutable std::mutex mutex_;
+    std::condition_variable handlerReturned_;
+    std::map<uint64_t, Entry> entries_;
+    uint64_t nextId_ = 1;
+    int queue_ = -1;                  //!< epoll or kqueue descriptor
+    int wakeupPipe_[2] = { -1, -1 }; //!< wakes up the watch loop for stopping
+    std::thread thread_;
+};
+
+} // namespace terminal
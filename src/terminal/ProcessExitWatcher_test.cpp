@@ -0,0 +1,112 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/ProcessExitWatcher.h>
+
+#include <catch2/catch.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#if !defined(_WIN32)
+    #include <sys/wait.h>
+
+    #include <unistd.h>
+
+using namespace terminal;
+using namespace std::chrono_literals;
+
+namespace
+{
+
+/// Spawns a child process that exits with the given code once the returned pipe is closed.
+pid_t spawnChild(int _exitCode, int& _releaseFd)
+{
+    int fds[2];
+    REQUIRE(::pipe(fds) == 0);
+    auto const pid = ::fork();
+    REQUIRE(pid != -1);
+    if (pid == 0)
+    {
+        ::close(fds[1]);
+        char buffer {};
+        while (::read(fds[0], &buffer, 1) > 0)
+            ;
+        ::_exit(_exitCode);
+    }
+    ::close(fds[0]);
+    _releaseFd = fds[1];
+    return pid;
+}
+
+} // namespace
+
+TEST_CASE("ProcessExitWatcher.exit", "[process]")
+{
+    auto watcher = ProcessExitWatcher {};
+    auto releaseFd = -1;
+    auto const pid = spawnChild(7, releaseFd);
+
+    auto mutex = std::mutex {};
+    auto exited = std::condition_variable {};
+    auto status = -1;
+    auto const id = watcher.add(pid, [&]() {
+        int waitStatus = 0;
+        auto const reaped = ::waitpid(pid, &waitStatus, WNOHANG) == pid;
+        auto const _ = std::lock_guard { mutex };
+        status = reaped ? WEXITSTATUS(waitStatus) : -2;
+        exited.notify_all();
+    });
+    if (!id)
+    {
+        WARN("Watching processes for exit is not supported on this system.");
+        ::close(releaseFd);
+        ::waitpid(pid, nullptr, 0);
+        return;
+    }
+    CHECK(watcher.size() == 1);
+
+    ::close(releaseFd);
+
+    auto lock = std::unique_lock { mutex };
+    REQUIRE(exited.wait_for(lock, 5s, [&]() { return status != -1; }));
+    CHECK(status == 7);
+    lock.unlock();
+
+    // The entry is removed right after the handler returned.
+    for (auto i = 0; i < 100 && watcher.size() != 0; ++i)
+        std::this_thread::sleep_for(10ms);
+    CHECK(watcher.size() == 0);
+    watcher.remove(id); // no effect
+}
+
+TEST_CASE("ProcessExitWatcher.remove", "[process]")
+{
+    auto watcher = ProcessExitWatcher {};
+    auto releaseFd = -1;
+    auto const pid = spawnChild(0, releaseFd);
+
+    auto invoked = false;
+    auto const id = watcher.add(pid, [&]() { invoked = true; });
+    watcher.remove(id);
+    CHECK(watcher.size() == 0);
+
+    ::close(releaseFd);
+    REQUIRE(::waitpid(pid, nullptr, 0) == pid);
+    std::this_thread::sleep_for(50ms);
+    CHECK(!invoked);
+}
+
+#endif
@@ -12,6 +12,7 @@
  * limitations under the License.
  */
 #include <terminal/Process.h>
+#include <terminal/ProcessExitWatcher.h>
 #include <terminal/pty/Pty.h>
 #include <terminal/pty/UnixPty.h>
 
@@ -19,6 +20,7 @@
     #include <terminal/pty/LinuxPty.h>
 #endif
 
+#include <crispy/StartupTrace.h>
 #include <crispy/overloaded.h>
 #include <crispy/stdfs.h>
 #include <crispy/utils.h>
@@ -54,10 +56,26 @@
 #include <sys/wait.h>
 
 #include <csignal>
+#include <map>
 
 #include <pwd.h>
 #include <unistd.h>
 
+// posix_spawn() is implemented via clone(CLONE_VM | CLONE_VFORK) in glibc, and since 2.34 it also
+// provides the file actions needed to replace the work done in the forked child.
+#if defined(__GLIBC__)
+    #if __GLIBC_PREREQ(2, 34)
+        #define LIBTERMINAL_POSIX_SPAWN 1
+    #endif
+#endif
+
+#if defined(LIBTERMINAL_POSIX_SPAWN)
+    #include <climits>
+
+    #include <fcntl.h>
+    #include <spawn.h>
+#endif
+
 using namespace std;
 using namespace std::string_view_literals;
 using crispy::trimRight;
@@ -117,8 +135,16 @@ struct Process::Private
     mutable pid_t pid {};
     mutable std::mutex exitStatusMutex {};
     mutable std::optional<Process::ExitStatus> exitStatus {};
+    std::function<void(ExitStatus)> exitHandler {}; // guarded by exitStatusMutex
+    mutable std::mutex waitMutex {};                // serializes reaping the process
+    uint64_t exitWatch = 0;                         // ProcessExitWatcher ID, 0 if not watched
 
     [[nodiscard]] std::optional<ExitStatus> checkStatus(bool _waitForExit) const;
+    void watchExit();
+
+#if defined(LIBTERMINAL_POSIX_SPAWN)
+    [[nodiscard]] pid_t spawn(UnixPipe* _stdoutFastPipe) const;
+#endif
 };
 
 Process::Process(string const& _path,
@@ -139,9 +165,12 @@ bool Process::isFlatpak()
 
 void Process::start()
 {
-    d->pty->start();
+    if (d->pid != 0) // running, or exited and reaped already
+        return;
 
-    d->pid = fork();
+    auto const _ = crispy::StartupTrace::Scope("Spawn shell process");
+
+    d->pty->start();
 
     UnixPipe* stdoutFastPipe = [this]() -> UnixPipe* {
         if (auto* p = dynamic_cast<SystemPty*>(d->pty.get()))
@@ -149,12 +178,29 @@ void Process::start()
         return nullptr;
     }();
 
+#if defined(LIBTERMINAL_POSIX_SPAWN)
+    // Avoids duplicating the page tables of a large parent process. Whenever spawning is not
+    // possible, the fork() path below takes over and also reports failures to the user.
+    if (auto const pid = d->spawn(stdoutFastPipe); pid > 0)
+    {
+        d->pid = pid;
+        d->pty->slave().close();
+        if (stdoutFastPipe)
+            stdoutFastPipe->closeWriter();
+        d->watchExit();
+        return;
+    }
+#endif
+
+    d->pid = fork();
+
     switch (d->pid)
     {
         default: // in parent
             d->pty->slave().close();
             if (stdoutFastPipe)
                 stdoutFastPipe->closeWriter();
+            d->watchExit();
             break;
         case -1: // fork error
             throw runtime_error { getLastErrorAsString() };
@@ -262,6 +308,8 @@ void Process::start()
 
 Process::~Process()
 {
+    if (d->exitWatch)
+        ProcessExitWatcher::shared().remove(d->exitWatch);
     if (d->pid != -1)
         (void) wait();
 }
@@ -276,13 +324,149 @@ Pty const& Process::pty() const noexcept
     return *d->pty;
 }
 
+#if defined(LIBTERMINAL_POSIX_SPAWN)
+pid_t Process::Private::spawn(UnixPipe* _stdoutFastPipe) const
+{
+    // Escaping the sandbox and the sandboxed TERMINFO are left to the fork() path.
+    if (isFlatpak())
+        return -1;
+
+    // posix_spawnp() searches the parent's PATH, whereas the child would use the overridden one.
+    if (env.count("PATH"))
+        return -1;
+
+    auto* slave = dynamic_cast<SystemPty::Slave*>(&pty->slave());
+    if (!slave || !slave->configure())
+        return -1;
+
+    // The slave is opened by name rather than duplicated, as only opening it as the new
+    // session leader makes it the controlling terminal.
+    char ttyName[PATH_MAX];
+    if (ttyname_r(unbox<int>(slave->handle()), ttyName, sizeof(ttyName)) != 0)
+        return -1;
+
+    auto const useFastPipe = _stdoutFastPipe && _stdoutFastPipe->writer() != -1;
+
+    auto variables = map<string, string> {};
+    for (char** entry = environ; *entry; ++entry)
+    {
+        auto const text = string_view(*entry);
+        if (auto const i = text.find('='); i != string_view::npos)
+            variables[string(text.substr(0, i))] = string(text.substr(i + 1));
+    }
+    for (auto&& [name, value]: env)
+        variables[name] = value;
+    if (_stdoutFastPipe)
+        variables[string(StdoutFastPipeEnvironmentName)] = string(StdoutFastPipeFdStr);
+
+    auto environment = vector<string> {};
+    for (auto&& [name, value]: variables)
+        environment.emplace_back(fmt::format("{}={}", name, value));
+    auto envp = vector<char*> {};
+    for (auto& entry: environment)
+        envp.push_back(entry.data());
+    envp.push_back(nullptr);
+
+    auto arguments = vector<string> {};
+    arguments.push_back(path);
+    arguments.insert(arguments.end(), args.begin(), args.end());
+    auto argv = vector<char*> {};
+    for (auto& argument: arguments)
+        argv.push_back(argument.data());
+    argv.push_back(nullptr);
+
+    posix_spawn_file_actions_t actions;
+    if (posix_spawn_file_actions_init(&actions) != 0)
+        return -1;
+    auto const actionsCleanup = crispy::finally { [&]() {
+        posix_spawn_file_actions_destroy(&actions);
+    } };
+
+    posix_spawnattr_t attributes;
+    if (posix_spawnattr_init(&attributes) != 0)
+        return -1;
+    auto const attributesCleanup = crispy::finally { [&]() {
+        posix_spawnattr_destroy(&attributes);
+    } };
+
+    // Reset signal(s) to default that may have been changed in the parent process.
+    sigset_t defaultSignals;
+    sigemptyset(&defaultSignals);
+    sigaddset(&defaultSignals, SIGPIPE);
+
+    auto const fdStart = useFastPipe ? StdoutFastPipeFd + 1 : StdoutFastPipeFd;
+
+    // Mirrors Slave::login() and the descriptor setup of the forked child.
+    bool const prepared =
+        posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETSID | POSIX_SPAWN_SETSIGDEF) == 0
+        && posix_spawnattr_setsigdefault(&attributes, &defaultSignals) == 0
+        && posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, ttyName, O_RDWR, 0) == 0
+        && posix_spawn_file_actions_adddup2(&actions, STDIN_FILENO, STDOUT_FILENO) == 0
+        && posix_spawn_file_actions_adddup2(&actions, STDIN_FILENO, STDERR_FILENO) == 0
+        && (!useFastPipe
+            || posix_spawn_file_actions_adddup2(&actions, _stdoutFastPipe->writer(), StdoutFastPipeFd) == 0)
+        && (cwd.empty() || posix_spawn_file_actions_addchdir_np(&actions, cwd.c_str()) == 0)
+        && posix_spawn_file_actions_addclosefrom_np(&actions, fdStart) == 0;
+    if (!prepared)
+        return -1;
+
+    pid_t pid = -1;
+    if (posix_spawnp(&pid, argv[0], &actions, &attributes, argv.data(), envp.data()) != 0)
+        return -1;
+
+    return pid;
+}
+#endif
+
+void Process::Private::watchExit()
+{
+    exitWatch = ProcessExitWatcher::shared().add(pid, [this]() {
+        try
+        {
+            // The process exited, so that reaping it does not block.
+            auto const status = checkStatus(true);
+            auto handler = std::function<void(ExitStatus)> {};
+            {
+                auto const _ = lock_guard { exitStatusMutex };
+                handler = std::move(exitHandler);
+            }
+            if (handler && status)
+                handler(*status);
+        }
+        catch (std::exception const& e)
+        {
+            PtyLog()("Failed to reap exited process. {}", e.what());
+        }
+    });
+}
+
+void Process::setExitHandler(std::function<void(ExitStatus)> _handler)
+{
+    auto lock = unique_lock { d->exitStatusMutex };
+    if (!d->exitStatus)
+    {
+        d->exitHandler = std::move(_handler);
+        return;
+    }
+    auto const status = *d->exitStatus;
+    lock.unlock();
+    _handler(status);
+}
+
 optional<Process::ExitStatus> Process::checkStatus() const
 {
+    // A watched process is reaped as soon as it exited, which saves polling for it.
+    if (d->exitWatch)
+    {
+        auto const _ = lock_guard { d->exitStatusMutex };
+        return d->exitStatus;
+    }
     return d->checkStatus(false);
 }
 
 optional<Process::ExitStatus> Process::Private::checkStatus(bool _waitForExit) const
 {
+    auto const waitLock = lock_guard { waitMutex };
     {
         auto const _ = lock_guard { exitStatusMutex };
         if (exitStatus.has_value())
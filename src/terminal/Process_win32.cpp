@@ -12,6 +12,7 @@
  * limitations under the License.
  */
 #include <terminal/Process.h>
+#include <terminal/ProcessExitWatcher.h>
 #include <terminal/pty/ConPty.h>
 #include <terminal/pty/Pty.h>
 
@@ -163,12 +164,15 @@ struct Process::Private
     mutable HANDLE pid {};
     mutable std::mutex exitStatusMutex {};
     mutable std::optional<Process::ExitStatus> exitStatus {};
-    std::optional<std::thread> exitWatcher;
+    std::function<void(ExitStatus)> exitHandler {}; // guarded by exitStatusMutex
+    uint64_t exitWatch = 0;                         // ProcessExitWatcher ID, 0 if not watched
+    std::optional<std::thread> exitWatcher;         // in case the process cannot be watched otherwise
 
     PROCESS_INFORMATION processInfo {};
     STARTUPINFOEX startupInfo {};
 
     [[nodiscard]] optional<Process::ExitStatus> checkStatus(bool _waitForExit) const;
+    void onExited();
 };
 
 Process::Process(string const& _path,
@@ -189,6 +193,9 @@ bool Process::isFlatpak()
 
 void Process::start()
 {
+    if (d->processInfo.hProcess)
+        return;
+
     Require(static_cast<ConPty const*>(d->pty.get()));
 
     d->pty->start();
@@ -237,11 +244,43 @@ void Process::start()
     if (!success)
         throw runtime_error { "Could not create process. "s + getLastErrorAsString() };
 
-    d->exitWatcher = std::thread([this]() {
-        (void) wait();
-        PtyLog()("Process terminated with exit code {}.", checkStatus().value());
-        d->pty->close();
-    });
+    // Only the spawned process writes to the pseudo console from now on.
+    d->pty->slave().close();
+
+    d->exitWatch = ProcessExitWatcher::shared().add(d->processInfo.hProcess, [this]() { d->onExited(); });
+    if (!d->exitWatch)
+        d->exitWatcher = std::thread([this]() {
+            (void) wait();
+            d->onExited();
+        });
+}
+
+void Process::Private::onExited()
+{
+    auto const status = checkStatus(false).value();
+    PtyLog()("Process terminated with exit code {}.", status);
+    pty->close();
+
+    auto handler = std::function<void(ExitStatus)> {};
+    {
+        auto const _ = lock_guard { exitStatusMutex };
+        handler = std::move(exitHandler);
+    }
+    if (handler)
+        handler(status);
+}
+
+void Process::setExitHandler(std::function<void(ExitStatus)> _handler)
+{
+    auto lock = unique_lock { d->exitStatusMutex };
+    if (!d->exitStatus)
+    {
+        d->exitHandler = std::move(_handler);
+        return;
+    }
+    auto const status = *d->exitStatus;
+    lock.unlock();
+    _handler(status);
 }
 
 Pty& Process::pty() noexcept
@@ -256,6 +295,8 @@ Pty const& Process::pty() const noexcept
 
 Process::~Process()
 {
+    if (d->exitWatch)
+        ProcessExitWatcher::shared().remove(d->exitWatch);
     if (d->exitWatcher)
         d->exitWatcher.value().join();
 
@@ -287,9 +328,10 @@ optional<Process::ExitStatus> Process::Private::checkStatus(bool _waitForExit) c
     if (!GetExitCodeProcess(processInfo.hProcess, &exitCode))
         throw runtime_error { getLastErrorAsString() };
     else if (exitCode == STILL_ACTIVE)
-        return exitStatus;
-    else
-        return exitStatus = ExitStatus { NormalExit { static_cast<int>(exitCode) } };
+        return nullopt;
+
+    auto const _ = lock_guard { exitStatusMutex };
+    return exitStatus = ExitStatus { NormalExit { static_cast<int>(exitCode) } };
 }
 
 void Process::terminate(TerminationHint _terminationHint)
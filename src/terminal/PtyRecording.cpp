@@ -0,0 +1,193 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/PtyRecording.h>
+#include <terminal/logging.h>
+
+#include <cerrno>
+#include <cstring>
+#include <iterator>
+
+using std::optional;
+using std::string;
+using std::string_view;
+using std::unique_ptr;
+using std::chrono::microseconds;
+
+namespace terminal
+{
+
+namespace
+{
+    constexpr auto Magic = string_view { "CTPTYREC" };
+    constexpr uint32_t Version = 1;
+    constexpr size_t ChunkHeaderSize = 1 + 8 + 4;
+
+    template <typename T>
+    void appendLittleEndian(string& _out, T _value)
+    {
+        for (size_t i = 0; i < sizeof(T); ++i)
+            _out.push_back(static_cast<char>((static_cast<uint64_t>(_value) >> (8 * i)) & 0xFF));
+    }
+
+    template <typename T>
+    T readLittleEndian(string_view _in) noexcept
+    {
+        auto value = uint64_t { 0 };
+        for (size_t i = 0; i < sizeof(T); ++i)
+            value |= static_cast<uint64_t>(static_cast<uint8_t>(_in[i])) << (8 * i);
+        return static_cast<T>(value);
+    }
+
+    void appendPageSize(string& _out, PageSize _pageSize)
+    {
+        appendLittleEndian(_out, static_cast<uint16_t>(unbox<int>(_pageSize.lines)));
+        appendLittleEndian(_out, static_cast<uint16_t>(unbox<int>(_pageSize.columns)));
+    }
+
+    PageSize readPageSize(string_view _in) noexcept
+    {
+        return PageSize { LineCount(readLittleEndian<uint16_t>(_in)),
+                          ColumnCount(readLittleEndian<uint16_t>(_in.substr(2))) };
+    }
+} // namespace
+
+size_t PtyRecording::outputSize() const noexcept
+{
+    auto total = size_t { 0 };
+    for (auto const& chunk: chunks)
+        if (chunk.type == PtyRecordingChunk::Type::Output)
+            total += chunk.data.size();
+    return total;
+}
+
+optional<PtyRecording> loadPtyRecording(FileSystem::path const& _path)
+{
+    auto file = std::ifstream { _path, std::ios::binary };
+    if (!file)
+    {
+        TerminalLog()("Failed to open PTY recording {}. {}", _path.string(), strerror(errno));
+        return std::nullopt;
+    }
+
+    auto const contents = string { std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+    auto input = string_view { contents };
+
+    auto constexpr HeaderSize = Magic.size() + 4 + 4;
+    if (input.size() < HeaderSize || input.substr(0, Magic.size()) != Magic
+        || readLittleEndian<uint32_t>(input.substr(Magic.size())) != Version)
+    {
+        TerminalLog()("Failed to load PTY recording {}. Unsupported file format.", _path.string());
+        return std::nullopt;
+    }
+
+    auto recording = PtyRecording {};
+    recording.pageSize = readPageSize(input.substr(Magic.size() + 4));
+    input.remove_prefix(HeaderSize);
+
+    while (input.size() >= ChunkHeaderSize)
+    {
+        auto chunk = PtyRecordingChunk {};
+        chunk.type = static_cast<PtyRecordingChunk::Type>(input[0]);
+        chunk.time = microseconds(readLittleEndian<uint64_t>(input.substr(1)));
+        auto const length = readLittleEndian<uint32_t>(input.substr(9));
+        input.remove_prefix(ChunkHeaderSize);
+        if (input.size() < length)
+            break;
+
+        auto const payload = input.substr(0, length);
+        input.remove_prefix(length);
+
+        switch (chunk.type)
+        {
+            case PtyRecordingChunk::Type::Output: chunk.data = string(payload); break;
+            case PtyRecordingChunk::Type::Resize:
+                if (payload.size() < 4)
+                    continue;
+                chunk.pageSize = readPageSize(payload);
+                break;
+            default:
+                // Skip chunk types of future versions.
+                continue;
+        }
+        recording.chunks.emplace_back(std::move(chunk));
+    }
+
+    if (!input.empty())
+        TerminalLog()("PTY recording {} is truncated. Ignoring the incomplete last chunk.", _path.string());
+
+    return recording;
+}
+
+unique_ptr<PtyRecorder> PtyRecorder::create(FileSystem::path const& _path, PageSize _pageSize)
+{
+    auto file = std::ofstream { _path, std::ios::binary | std::ios::trunc };
+    if (!file)
+    {
+        TerminalLog()("Failed to create PTY recording {}. {}", _path.string(), strerror(errno));
+        return nullptr;
+    }
+
+    auto header = string { Magic };
+    appendLittleEndian(header, Version);
+    appendPageSize(header, _pageSize);
+    file.write(header.data(), static_cast<std::streamsize>(header.size()));
+
+    TerminalLog()("Recording PTY output to {}.", _path.string());
+    return unique_ptr<PtyRecorder>(new PtyRecorder(_path, std::move(file)));
+}
+
+PtyRecorder::PtyRecorder(FileSystem::path _path, std::ofstream _file):
+    path_ { std::move(_path) }, file_ { std::move(_file) }, startTime_ { std::chrono::steady_clock::now() }
+{
+}
+
+void PtyRecorder::recordOutput(string_view _data)
+{
+    writeChunk(PtyRecordingChunk::Type::Output, _data);
+}
+
+void PtyRecorder::recordResize(PageSize _pageSize)
+{
+    auto payload = string {};
+    appendPageSize(payload, _pageSize);
+    writeChunk(PtyRecordingChunk::Type::Resize, payload);
+}
+
+void PtyRecorder::writeChunk(PtyRecordingChunk::Type _type, string_view _payload)
+{
+    auto const time = std::chrono::duration_cast<microseconds>(std::chrono::steady_clock::now() - startTime_);
+
+    auto header = string {};
+    appendLittleEndian(header, static_cast<uint8_t>(_type));
+    appendLittleEndian(header, static_cast<uint64_t>(time.count()));
+    appendLittleEndian(header, static_cast<uint32_t>(_payload.size()));
+
+    auto const _ = std::lock_guard { mutex_ };
+    if (failed_)
+        return;
+
+    file_.write(header.data(), static_cast<std::streamsize>(header.size()));
+    file_.write(_payload.data(), static_cast<std::streamsize>(_payload.size()));
+
+    // Keep the recording usable even if the terminal does not exit gracefully.
+    file_.flush();
+
+    if (!file_)
+    {
+        TerminalLog()("Failed to write to PTY recording {}. Stopping recording.", path_.string());
+        failed_ = true;
+    }
+}
+
+} // namespace terminal
@@ -0,0 +1,99 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <terminal/primitives.h>
+
+#include <crispy/stdfs.h>
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace terminal
+{
+
+/// A single event of a PTY recording.
+struct PtyRecordingChunk
+{
+    enum class Type : uint8_t
+    {
+        Output = 0, //!< data read from the PTY
+        Resize = 1, //!< the page size has changed
+    };
+
+    Type type = Type::Output;
+    std::chrono::microseconds time {};
+    std::string data {}; //!< the PTY output, if type is Output
+    PageSize pageSize {}; //!< the new page size, if type is Resize
+};
+
+struct PtyRecording
+{
+    PageSize pageSize;
+    std::vector<PtyRecordingChunk> chunks;
+
+    /// @returns the total number of bytes of PTY output.
+    [[nodiscard]] size_t outputSize() const noexcept;
+};
+
+/// Loads a recording as written by PtyRecorder.
+///
+/// @returns the recording or std::nullopt if the file could not be read or is not a recording.
+std::optional<PtyRecording> loadPtyRecording(FileSystem::path const& _path);
+
+/**
+ * Records the raw PTY output of a terminal session, such that it can be replayed later on,
+ * e.g. for reproducing performance regressions with real world traffic.
+ *
+ * The recording file starts with a header holding the magic bytes, the format version,
+ * and the initial page size, followed by the recorded chunks, each consisting of its type,
+ * its time in microseconds since the start of the recording, and its payload.
+ * All numbers are stored in little endian byte order.
+ */
+class PtyRecorder
+{
+  public:
+    /// Creates (or truncates) the recording file at the given path.
+    ///
+    /// @returns the recorder or nullptr if the file could not be created.
+    static std::unique_ptr<PtyRecorder> create(FileSystem::path const& _path, PageSize _pageSize);
+
+    [[nodiscard]] FileSystem::path const& path() const noexcept { return path_; }
+
+    /// Appends data read from the PTY. This may be called from any thread.
+    void recordOutput(std::string_view _data);
+
+    /// Appends a change of the page size. This may be called from any thread.
+    void recordResize(PageSize _pageSize);
+
+  private:
+    PtyRecorder(FileSystem::path _path, std::ofstream _file);
+
+    void writeChunk(PtyRecordingChunk::Type _type, std::string_view _payload);
+
+    FileSystem::path path_;
+    std::mutex mutex_;
+    std::ofstream file_;
+    std::chrono::steady_clock::time_point startTime_;
+    bool failed_ = false;
+};
+
+} // namespace terminal
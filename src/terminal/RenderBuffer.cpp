@@ -11,38 +11,272 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <terminal/CellUtil.h>
 #include <terminal/RenderBuffer.h>
 
 #include <fmt/format.h>
 
-#include <mutex>
-
 namespace terminal
 {
 
-bool RenderDoubleBuffer::swapBuffers(std::chrono::steady_clock::time_point _now) noexcept
+namespace
 {
-    // If the terminal thread (writer) cannot try_lock (w/o wait time)
-    // the front buffer, it'll just flush back buffer instead of swapping
-    // buffers as the front buffer is apparently still in use by the
-    // renderer thread and we want to avoid render-thread imposed
-    // wait times in the terminal thread as much as possible.
+    bool sameCursor(std::optional<RenderCursor> const& a, std::optional<RenderCursor> const& b) noexcept
+    {
+        if (!a || !b)
+            return a.has_value() == b.has_value();
+        return a->position == b->position && a->shape == b->shape && a->width == b->width;
+    }
 
-    if (!readerLock.try_lock())
-        return false;
+    bool operator==(RenderLineCache::Cursor const& a, RenderLineCache::Cursor const& b) noexcept
+    {
+        return a.position == b.position && a.scrollOffset == b.scrollOffset && sameCursor(a.cursor, b.cursor);
+    }
+
+    /// Compares the parts of the color palette that are used to render the main page.
+    bool sameColors(ColorPalette const& a, ColorPalette const& b) noexcept
+    {
+        return a.palette == b.palette && a.useBrightColors == b.useBrightColors
+               && a.defaultForeground == b.defaultForeground && a.defaultBackground == b.defaultBackground
+               && a.cursor.color == b.cursor.color && a.cursor.textOverrideColor == b.cursor.textOverrideColor
+               && a.hyperlinkDecoration.normal == b.hyperlinkDecoration.normal
+               && a.hyperlinkDecoration.hover == b.hyperlinkDecoration.hover;
+    }
 
-    auto const _l = std::lock_guard<decltype(readerLock)>(readerLock, std::adopt_lock);
+    bool operator==(RenderLineCache::Settings const& a, RenderLineCache::Settings const& b) noexcept
+    {
+        return a.screen == b.screen && a.pageSize == b.pageSize && a.reverseVideo == b.reverseVideo
+               && sameColors(a.colorPalette, b.colorPalette);
+    }
+} // namespace
+
+void ResolvedColorCache::validate(ColorPalette const& _colorPalette)
+{
+    if (validated_ && sameColors(colorPalette_, _colorPalette))
+        return;
+
+    validated_ = true;
+    colorPalette_ = _colorPalette;
+    entries_.fill(Entry {});
+}
+
+void ResolvedColorCache::fill(Entry& _entry, uint32_t _flags, uint8_t _modes, Color _fg, Color _bg) noexcept
+{
+    _entry = Entry { _fg,
+                     _bg,
+                     _flags,
+                     _modes,
+                     true,
+                     CellUtil::makeColors(colorPalette_,
+                                          static_cast<CellFlags>(_flags),
+                                          (_modes & 1) != 0,
+                                          _fg,
+                                          _bg,
+                                          (_modes & 2) != 0,
+                                          (_modes & 4) != 0) };
+}
 
-    for (;;)
+RenderBufferRef RenderTripleBuffer::frontBuffer() const noexcept
+{
+    if (pendingBufferIndex_.load(std::memory_order_relaxed) & FreshBit)
     {
-        auto current = currentBackBufferIndex.load();
-        if (currentBackBufferIndex.compare_exchange_weak(current, (current + 1) % 2))
-            break;
+        auto const front = static_cast<uint8_t>(frontBufferIndex_);
+        frontBufferIndex_ = pendingBufferIndex_.exchange(front, std::memory_order_acq_rel) & IndexMask;
     }
+    return RenderBufferRef { buffers[frontBufferIndex_] };
+}
+
+bool RenderTripleBuffer::swapBuffers(std::chrono::steady_clock::time_point _now) noexcept
+{
+    // The buffer handed back is either the one the reader has just released,
+    // or the pending one the reader has skipped.
+    auto const back = static_cast<uint8_t>(backBufferIndex_ | FreshBit);
+    backBufferIndex_ = pendingBufferIndex_.exchange(back, std::memory_order_acq_rel) & IndexMask;
 
     lastUpdate = _now;
     state = RenderBufferState::WaitingForRefresh;
     return true;
 }
 
+// {{{ RenderLineCache
+bool RenderLineCache::planRows(Settings _settings,
+                               Cursor _cursor,
+                               HyperlinkId _hoveringHyperlink,
+                               HyperlinkSpans const& _hyperlinkSpans,
+                               RenderBuffer const& _output)
+{
+    auto const pageLines = sources_.size();
+    auto const rebuildAll = rows_.size() != pageLines || !(_settings == settings_);
+    auto const cursorChanged = !(_cursor == cursor_);
+
+    plan_.resize(pageLines);
+    for (size_t y = 0; y < pageLines; ++y)
+    {
+        if (rebuildAll || damaged_[y])
+        {
+            plan_[y] = Rebuild;
+        }
+        else
+        {
+            // Lines that have been scrolled are most likely to follow the line above.
+            auto const hint = y != 0 && plan_[y - 1] != Rebuild ? static_cast<size_t>(plan_[y - 1] + 1) : y;
+            plan_[y] = findRow(sources_[y], hint);
+        }
+    }
+
+    if (cursorChanged)
+    {
+        // The line under the cursor is rendered differently, and so are the lines the cursor has
+        // just left.
+        rebuildCursorRows(cursor_);
+        rebuildCursorRows(_cursor);
+    }
+
+    if (_hoveringHyperlink != hoveringHyperlink_)
+    {
+        // Only the lines showing the hyperlink that is hovered now, or has been hovered so far,
+        // change their underline. Reused lines show what they did before, so they are found by
+        // the spans of the current page as well.
+        for (size_t y = 0; y < pageLines; ++y)
+        {
+            auto const line = LineOffset::cast_from(y);
+            if (_hyperlinkSpans.contains(line, hoveringHyperlink_)
+                || _hyperlinkSpans.contains(line, _hoveringHyperlink))
+                plan_[y] = Rebuild;
+        }
+        hoveringHyperlink_ = _hoveringHyperlink;
+    }
+
+    auto changed = false;
+    for (size_t y = 0; y < pageLines; ++y)
+        changed = changed || plan_[y] != static_cast<int>(y);
+
+    settings_ = std::move(_settings);
+    cursor_ = std::move(_cursor);
+    lastSources_.swap(sources_);
+
+    if (changed)
+        ++version_;
+    else if (_output.mainPageVersion == version_)
+        return true;
+
+    nextRows_.clear();
+    nextRows_.resize(pageLines);
+    return false;
+}
+
+int RenderLineCache::findRow(void const* _source, size_t _hint) const noexcept
+{
+    if (_hint < lastSources_.size() && lastSources_[_hint] == _source)
+        return static_cast<int>(_hint);
+
+    for (size_t row = 0; row < lastSources_.size(); ++row)
+        if (lastSources_[row] == _source)
+            return static_cast<int>(row);
+
+    return Rebuild;
+}
+
+void RenderLineCache::rebuildCursorRows(Cursor const& _cursor) noexcept
+{
+    auto const rebuild = [this](LineOffset _line) {
+        if (LineOffset(0) <= _line && unbox<size_t>(_line) < plan_.size())
+            plan_[unbox<size_t>(_line)] = Rebuild;
+    };
+
+    // Besides coloring the cursor cell, a line containing the cursor is never rendered as a single
+    // trivial line. This is testing the cursor's grid line against screen lines, too.
+    rebuild(_cursor.position.line + boxed_cast<LineOffset>(_cursor.scrollOffset));
+    rebuild(_cursor.position.line);
+}
+
+bool RenderLineCache::tryReuse(LineOffset _line, RenderBuffer& _output)
+{
+    auto const y = unbox<size_t>(_line);
+    auto const source = plan_[y];
+    if (source == Rebuild)
+        return false;
+
+    auto& row = rows_[static_cast<size_t>(source)];
+    auto const shift = LineOffset::cast_from(static_cast<int>(y) - source);
+    if (shift != LineOffset(0))
+    {
+        for (auto& cell: row.cells)
+            cell.position.line += shift;
+        if (row.line)
+            row.line->lineOffset += shift;
+        for (auto& image: row.images)
+            image.position.line += shift;
+    }
+
+    _output.cells.insert(_output.cells.end(), row.cells.begin(), row.cells.end());
+    if (row.line)
+        _output.lines.emplace_back(*row.line);
+    _output.images.insert(_output.images.end(), row.images.begin(), row.images.end());
+
+    nextRows_[y] = std::move(row);
+    return true;
+}
+
+void RenderLineCache::store(LineOffset _line,
+                            RenderBuffer const& _output,
+                            size_t _firstCell,
+                            size_t _firstLine,
+                            size_t _firstImage)
+{
+    auto& row = nextRows_[unbox<size_t>(_line)];
+    row.cells.assign(_output.cells.begin() + static_cast<std::ptrdiff_t>(_firstCell), _output.cells.end());
+    if (_firstLine < _output.lines.size())
+        row.line = _output.lines.back();
+    else
+        row.line.reset();
+    row.images.assign(_output.images.begin() + static_cast<std::ptrdiff_t>(_firstImage),
+                      _output.images.end());
+}
+
+void RenderLineCache::finish(RenderBuffer& _output)
+{
+    rows_.swap(nextRows_);
+
+    _output.mainPageVersion = version_;
+    _output.mainPageCellCount = _output.cells.size();
+    _output.mainPageLineCount = _output.lines.size();
+    _output.mainPageImageCount = _output.images.size();
+
+    // The offset most reused rows have moved by is taken as the page's scroll shift, such that
+    // the renderer can move these rows as a whole rather than rendering them again.
+    auto shift = 0;
+    auto votes = 0;
+    for (size_t y = 0; y < plan_.size(); ++y)
+    {
+        if (plan_[y] == Rebuild)
+            continue;
+        auto const offset = static_cast<int>(y) - plan_[y];
+        if (votes == 0)
+            shift = offset;
+        votes += offset == shift ? 1 : -1;
+    }
+    _output.scrollShift = LineOffset(shift);
+    _output.scrollRegion = LineCount::cast_from(plan_.size());
+
+    _output.damagedLines.clear();
+    for (size_t y = 0; y < plan_.size(); ++y)
+        if (plan_[y] != static_cast<int>(y) - shift)
+            _output.damagedLines.emplace_back(LineOffset::cast_from(y));
+}
+
+void RenderLineCache::bypass(RenderBuffer& _output, LineCount _pageLines)
+{
+    rows_.clear();
+    lastSources_.clear();
+    ++version_;
+
+    _output.mainPageVersion = 0;
+    _output.scrollShift = LineOffset(0);
+    _output.damagedLines.clear();
+    for (auto y = LineOffset(0); y < boxed_cast<LineOffset>(_pageLines); ++y)
+        _output.damagedLines.emplace_back(y);
+}
+// }}}
+
 } // namespace terminal
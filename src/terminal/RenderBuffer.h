@@ -15,16 +15,24 @@
 
 #include <terminal/CellFlags.h>
 #include <terminal/Color.h>
+#include <terminal/ColorPalette.h>
+#include <terminal/GraphemeClusterTable.h>
 #include <terminal/Grid.h>
+#include <terminal/Hyperlink.h>
 #include <terminal/Image.h>
 #include <terminal/primitives.h>
 
 #include <terminal_renderer/RenderTarget.h>
 
+#include <algorithm>
+#include <array>
 #include <atomic>
 #include <chrono>
 #include <mutex>
 #include <optional>
+#include <string_view>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace terminal
@@ -41,19 +49,45 @@ struct RenderAttributes
 /**
  * Renderable representation of a grid cell with color-altering pre-applied and
  * additional information for cell ranges that can be text-shaped together.
+ *
+ * The codepoints are stored inline, such that render cells are trivially copyable,
+ * and building or clearing a render buffer does not allocate nor free them one by one.
  */
 struct RenderCell
 {
-    std::u32string codepoints;
-    std::shared_ptr<ImageFragment> image;
+    /// Maximum number of codepoints of a cell, as many as a grapheme cluster in the grid holds.
+    static constexpr size_t MaxCodepoints = GraphemeCluster::MaxLength;
+
+    std::array<char32_t, MaxCodepoints> codepointStorage {};
     CellLocation position;
     RenderAttributes attributes;
+    uint8_t codepointCount = 0;
     uint8_t width = 1;
 
     bool groupStart = false;
     bool groupEnd = false;
+
+    [[nodiscard]] std::u32string_view codepoints() const noexcept
+    {
+        return std::u32string_view(codepointStorage.data(), codepointCount);
+    }
+
+    /// Assigns the given codepoints, which are cut off at MaxCodepoints.
+    void setCodepoints(std::u32string_view _codepoints) noexcept
+    {
+        codepointCount = static_cast<uint8_t>(std::min(_codepoints.size(), MaxCodepoints));
+        std::copy_n(_codepoints.begin(), codepointCount, codepointStorage.begin());
+    }
+
+    void appendCodepoint(char32_t _codepoint) noexcept
+    {
+        if (codepointCount < MaxCodepoints)
+            codepointStorage[codepointCount++] = _codepoint;
+    }
 };
 
+static_assert(std::is_trivially_copyable_v<RenderCell>);
+
 /**
  * Renderable representation of a grid line with monochrome SGR styling.
  */
@@ -67,6 +101,17 @@ struct RenderLine
     RenderAttributes fillAttributes;
 };
 
+/**
+ * Renderable representation of a row of an image, displayed in consecutive cells of a line.
+ */
+struct RenderImage
+{
+    std::shared_ptr<RasterizedImage const> image;
+    CellLocation position; //!< screen position of the first cell displaying the image
+    ColumnCount columns;   //!< number of cells displaying the image
+    CellLocation offset;   //!< grid-offset into the rasterized image displayed at @c position
+};
+
 struct RenderCursor
 {
     CellLocation position;
@@ -78,36 +123,269 @@ struct RenderBuffer
 {
     std::vector<RenderCell> cells {};
     std::vector<RenderLine> lines {};
+    std::vector<RenderImage> images {};
     std::optional<RenderCursor> cursor {};
     uint64_t frameID {};
 
+    /// Screen lines that have changed since the previous frame, in ascending order.
+    ///
+    /// The previous frame is the one with frameID - 1. If that one has not been seen,
+    /// all lines must be considered damaged.
+    std::vector<LineOffset> damagedLines {};
+
+    /// Number of lines the main page has moved down by since the previous frame (up if negative),
+    /// e.g. due to scrolling. Lines that have moved by exactly that many lines are not damaged.
+    ///
+    /// The renderer is expected to move what it has rendered of the first scrollRegion lines
+    /// along, or else to consider all of these lines damaged.
+    LineOffset scrollShift {};
+    LineCount scrollRegion {};
+
+    /// Time of the key press whose echo is shown for the first time with this frame, if any.
+    std::optional<std::chrono::steady_clock::time_point> echoedKeyPress {};
+
+    // Bookkeeping of the RenderLineCache the main page has been rendered with.
+    uint64_t mainPageVersion = 0;
+    size_t mainPageCellCount = 0;
+    size_t mainPageLineCount = 0;
+    size_t mainPageImageCount = 0;
+
     void clear()
     {
         cells.clear();
         lines.clear();
+        images.clear();
         cursor.reset();
+        damagedLines.clear();
+        scrollShift = LineOffset(0);
+        scrollRegion = LineCount(0);
+        echoedKeyPress.reset();
+        mainPageVersion = 0;
+        mainPageCellCount = 0;
+        mainPageLineCount = 0;
+        mainPageImageCount = 0;
     }
 };
 
-/// Lock-guarded handle to a read-only RenderBuffer object.
+/**
+ * Keeps the rendered lines of the main page of the previous frame, such that a frame only needs to
+ * rebuild the lines that have been damaged since.
+ *
+ * Lines that have only moved, e.g. due to scrolling, are reused as well.
+ * If nothing has changed at all, the main page of a render buffer is not touched.
+ *
+ * @see Line::damaged()
+ */
+class RenderLineCache
+{
+  public:
+    /// Everything besides the lines themselves that affects how all lines are rendered,
+    /// apart from the blink states and the hovered hyperlink, which only affect the lines containing
+    /// blinking cells or showing that hyperlink.
+    struct Settings
+    {
+        void const* screen = nullptr;
+        PageSize pageSize {};
+        bool reverseVideo = false;
+        bool blink = false;
+        bool rapidBlink = false;
+        ColorPalette colorPalette {};
+    };
+
+    /// The state of the cursor, which affects how the lines containing it are rendered.
+    struct Cursor
+    {
+        std::optional<RenderCursor> cursor {};
+        CellLocation position {}; //!< the real cursor position in grid coordinates
+        ScrollOffset scrollOffset {};
+    };
+
+    /// Plans the rendering of the main page of the given grid into @p _output, and marks the
+    /// grid's visible lines as rendered.
+    ///
+    /// The lines showing the hovered hyperlink, or the one hovered before, are looked up in
+    /// @p _hyperlinkSpans, which must have been collected from the same grid.
+    ///
+    /// @retval true the main page of @p _output is up to date already and must not be rendered.
+    /// @retval false the main page is to be rendered, using tryReuse(), store(), and finish().
+    template <typename Cell>
+    [[nodiscard]] bool plan(Grid<Cell> const& _grid,
+                            Settings _settings,
+                            Cursor _cursor,
+                            HyperlinkId _hoveringHyperlink,
+                            HyperlinkSpans const& _hyperlinkSpans,
+                            RenderBuffer const& _output);
+
+    /// Appends the cached rendering of the given screen line to @p _output, if it can be reused.
+    ///
+    /// @retval true the line has been appended to @p _output.
+    /// @retval false the line must be rendered and then passed to store().
+    bool tryReuse(LineOffset _line, RenderBuffer& _output);
+
+    /// Remembers the rendering of the given screen line, which has been appended to @p _output,
+    /// starting at the given cell, render line, and image.
+    void store(LineOffset _line,
+               RenderBuffer const& _output,
+               size_t _firstCell,
+               size_t _firstLine,
+               size_t _firstImage);
+
+    /// Completes rendering the main page into @p _output.
+    void finish(RenderBuffer& _output);
+
+    /// Drops all cached lines, as the main page of @p _output has been rendered without the cache,
+    /// e.g. while a selection is shown.
+    void bypass(RenderBuffer& _output, LineCount _pageLines);
+
+  private:
+    static constexpr int Rebuild = -1;
+
+    struct Row
+    {
+        std::vector<RenderCell> cells {};
+        std::optional<RenderLine> line {};
+        std::vector<RenderImage> images {};
+    };
+
+    [[nodiscard]] bool planRows(Settings _settings,
+                                Cursor _cursor,
+                                HyperlinkId _hoveringHyperlink,
+                                HyperlinkSpans const& _hyperlinkSpans,
+                                RenderBuffer const& _output);
+    template <typename Cell>
+    [[nodiscard]] static bool containsBlinkingCells(Line<Cell> const& _line) noexcept;
+    [[nodiscard]] int findRow(void const* _source, size_t _hint) const noexcept;
+    void rebuildCursorRows(Cursor const& _cursor) noexcept;
+
+    Settings settings_;
+    Cursor cursor_;
+    HyperlinkId hoveringHyperlink_ {};
+    uint64_t version_ = 0;
+    std::vector<void const*> sources_;     // grid line rendered into each row of the current frame
+    std::vector<void const*> lastSources_; // grid line rendered into each row of the previous frame
+    std::vector<bool> damaged_;            // whether the grid line of each row has been damaged
+    std::vector<int> plan_;                // row of the previous frame to reuse, or Rebuild
+    std::vector<Row> rows_;
+    std::vector<Row> nextRows_;
+};
+
+template <typename Cell>
+bool RenderLineCache::plan(Grid<Cell> const& _grid,
+                           Settings _settings,
+                           Cursor _cursor,
+                           HyperlinkId _hoveringHyperlink,
+                           HyperlinkSpans const& _hyperlinkSpans,
+                           RenderBuffer const& _output)
+{
+    // Toggling the blink state only affects the lines containing blinking cells, which are then
+    // rebuilt on top of the cached rendering of all other lines.
+    auto const blinkChanged =
+        _settings.blink != settings_.blink || _settings.rapidBlink != settings_.rapidBlink;
+
+    auto const pageLines = unbox<size_t>(_settings.pageSize.lines);
+    sources_.resize(pageLines);
+    damaged_.resize(pageLines);
+    for (size_t y = 0; y < pageLines; ++y)
+    {
+        auto const& line =
+            _grid.lineAt(LineOffset::cast_from(y) - boxed_cast<LineOffset>(_cursor.scrollOffset));
+        sources_[y] = &line;
+        damaged_[y] = line.damaged() || (blinkChanged && containsBlinkingCells(line));
+        line.markRendered();
+    }
+    return planRows(
+        std::move(_settings), std::move(_cursor), _hoveringHyperlink, _hyperlinkSpans, _output);
+}
+
+template <typename Cell>
+bool RenderLineCache::containsBlinkingCells(Line<Cell> const& _line) noexcept
+{
+    auto const blinking = [](CellFlags _flags) {
+        return (CellFlags::Blinking & _flags) || (CellFlags::RapidBlinking & _flags);
+    };
+
+    if (_line.isTrivialBuffer())
+        return blinking(_line.trivialBuffer().textAttributes->flags);
+
+    if (_line.isAttributedBuffer())
+    {
+        auto const& runs = _line.attributedBuffer().runs;
+        return std::any_of(
+            runs.begin(), runs.end(), [&](auto const& run) { return blinking(run.attributes.flags); });
+    }
+
+    auto const& cells = _line.cells();
+    return std::any_of(cells.begin(), cells.end(), [&](Cell const& cell) { return blinking(cell.flags()); });
+}
+
+/**
+ * Caches the colors that cells resolve to by their SGR colors and flags,
+ * which only change along with the color palette.
+ *
+ * A page usually consists of only a few such combinations, each of which is then resolved once
+ * rather than for every cell of every frame.
+ *
+ * Not thread-safe, so concurrently rendered bands of a page each use their own cache.
+ */
+class ResolvedColorCache
+{
+  public:
+    /// Drops all cached colors, unless they have been resolved with the same colors
+    /// as in the given palette.
+    void validate(ColorPalette const& _colorPalette);
+
+    /// @returns the colors of a cell with the given SGR colors and flags, as by CellUtil::makeColors().
+    [[nodiscard]] RGBColorPair resolve(
+        CellFlags _flags, bool _reverseVideo, Color _fg, Color _bg, bool _blink, bool _rapidBlink) noexcept
+    {
+        auto const flags = static_cast<uint32_t>(_flags) & ColorFlagsMask;
+        auto const modes =
+            static_cast<uint8_t>((_reverseVideo ? 1 : 0) | (_blink ? 2 : 0) | (_rapidBlink ? 4 : 0));
+        auto const hash = (_fg.content * 0x9E3779B1u) ^ (_bg.content * 0x85EBCA77u) ^ (flags << 3) ^ modes;
+        auto& entry = entries_[(hash ^ (hash >> 16)) % EntryCount];
+        if (!entry.valid || entry.fg != _fg || entry.bg != _bg || entry.flags != flags || entry.modes != modes)
+            fill(entry, flags, modes, _fg, _bg);
+        return entry.colors;
+    }
+
+  private:
+    static constexpr size_t EntryCount = 256;
+
+    // The cell flags that affect the resolved colors.
+    static constexpr uint32_t ColorFlagsMask =
+        static_cast<uint32_t>(CellFlags::Bold | CellFlags::Faint | CellFlags::Inverse | CellFlags::Hidden
+                              | CellFlags::Blinking | CellFlags::RapidBlinking);
+
+    struct Entry
+    {
+        Color fg {};
+        Color bg {};
+        uint32_t flags = 0;
+        uint8_t modes = 0;
+        bool valid = false;
+        RGBColorPair colors {};
+    };
+
+    void fill(Entry& _entry, uint32_t _flags, uint8_t _modes, Color _fg, Color _bg) noexcept;
+
+    bool validated_ = false;
+    ColorPalette colorPalette_ {};
+    std::array<Entry, EntryCount> entries_ {};
+};
+
+/// Handle to the read-only front RenderBuffer object.
+///
+/// The referenced buffer is owned by the reader until it acquires the next front buffer.
 ///
 /// @see RenderBuffer
 struct RenderBufferRef
 {
     RenderBuffer const& buffer;
-    std::mutex& guard;
 
     [[nodiscard]] RenderBuffer const& get() const noexcept { return buffer; }
-
-    RenderBufferRef(RenderBuffer const& _buf, std::mutex& _lock): buffer { _buf }, guard { _lock }
-    {
-        guard.lock();
-    }
-
-    ~RenderBufferRef() { guard.unlock(); }
 };
 
-/// Reflects the current state of a RenderDoubleBuffer object.
+/// Reflects the current state of a RenderTripleBuffer object.
 ///
 enum class RenderBufferState
 {
@@ -127,28 +405,40 @@ constexpr std::string_view to_string(RenderBufferState _state) noexcept
     return "INVALID";
 }
 
-struct RenderDoubleBuffer
+/**
+ * Lock-free triple buffer of RenderBuffer objects.
+ *
+ * The writer (terminal thread) always owns a back buffer to render into, and the reader
+ * (render thread) always owns a front buffer to read from. The third buffer holds the latest
+ * completed frame and is atomically exchanged by either side, so that a slow render pass
+ * never stalls the terminal thread and vice versa.
+ */
+struct RenderTripleBuffer
 {
-    std::mutex mutable readerLock;
-    std::atomic<size_t> currentBackBufferIndex = 0;
-    std::array<RenderBuffer, 2> buffers {};
+    std::array<RenderBuffer, 3> buffers {};
     std::atomic<RenderBufferState> state = RenderBufferState::WaitingForRefresh;
     std::chrono::steady_clock::time_point lastUpdate {};
 
-    RenderBuffer& backBuffer() noexcept { return buffers[currentBackBufferIndex]; }
+    RenderBuffer& backBuffer() noexcept { return buffers[backBufferIndex_]; }
 
-    RenderBufferRef frontBuffer() const
-    {
-        // if (state == RenderBufferState::TrySwapBuffers)
-        //     const_cast<RenderDoubleBuffer*>(this)->swapBuffers(lastUpdate);
-        RenderBuffer const& frontBuffer = buffers.at((currentBackBufferIndex + 1) % 2);
-        return RenderBufferRef(frontBuffer, readerLock);
-    }
+    /// Acquires the latest completed render buffer. May only be invoked by the reader thread.
+    RenderBufferRef frontBuffer() const noexcept;
 
     void clear() { backBuffer().clear(); }
 
-    // Swaps front with back buffer. May only be invoked by the writer thread.
+    /// Publishes the back buffer as the latest completed one. May only be invoked by the writer thread.
+    ///
+    /// This never fails, as the writer is always handed back a buffer that is not in use by the reader.
     bool swapBuffers(std::chrono::steady_clock::time_point _now) noexcept;
+
+  private:
+    // The pending buffer index is tagged with this bit as long as the reader has not acquired it yet.
+    static constexpr uint8_t FreshBit = 0x04;
+    static constexpr uint8_t IndexMask = 0x03;
+
+    size_t backBufferIndex_ = 0;
+    mutable size_t frontBufferIndex_ = 1;
+    mutable std::atomic<uint8_t> pendingBufferIndex_ = 2;
 };
 
 } // namespace terminal
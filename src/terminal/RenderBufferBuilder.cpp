@@ -22,6 +22,8 @@
 #include <unicode/convert.h>
 #include <unicode/utf8_grapheme_segmenter.h>
 
+#include <algorithm>
+
 using namespace std;
 
 namespace terminal
@@ -62,20 +64,13 @@ namespace
             .distinct();
     }
 
+    /// Applies the selection, cursor, and highlight colors to the colors resolved by SGR.
     RGBColorPair makeColors(ColorPalette const& _colorPalette,
-                            CellFlags _cellFlags,
-                            bool _reverseVideo,
-                            Color foregroundColor,
-                            Color backgroundColor,
+                            RGBColorPair sgrColors,
                             bool _selected,
                             bool _isCursor,
-                            bool _isHighlighted,
-                            bool _blink,
-                            bool _rapidBlink) noexcept
+                            bool _isHighlighted) noexcept
     {
-        auto const sgrColors = CellUtil::makeColors(
-            _colorPalette, _cellFlags, _reverseVideo, foregroundColor, backgroundColor, _blink, _rapidBlink);
-
         if (!_selected && !_isCursor && !_isHighlighted)
             return sgrColors;
 
@@ -129,6 +124,20 @@ RenderBufferBuilder<Cell>::RenderBufferBuilder(Terminal const& _terminal,
 {
     output.frameID = _terminal.lastFrameID();
     output.cursor = renderCursor();
+
+    auto const topLine = -boxed_cast<LineOffset>(_terminal.viewport().scrollOffset());
+    auto const bottomLine = topLine + boxed_cast<LineOffset>(_terminal.pageSize().lines) - 1;
+    selectedRanges = _terminal.selectedRanges(topLine, bottomLine);
+    highlightedRanges = _terminal.highlightedRanges(topLine, bottomLine);
+
+    if (_highlightSearchMatches == HighlightSearchMatches::Yes)
+    {
+        searchMatchRanges = _terminal.searchMatchRanges();
+        auto const viCursor = _terminal.state().viCommands.cursorPosition;
+        for (size_t i = 0; i < searchMatchRanges.size(); ++i)
+            if (searchMatchRanges[i].contains(viCursor))
+                focusedSearchMatch = i;
+    }
 }
 
 template <typename Cell>
@@ -153,7 +162,7 @@ optional<RenderCursor> RenderBufferBuilder<Cell>::renderCursor() const
 
 template <typename Cell>
 RenderCell RenderBufferBuilder<Cell>::makeRenderCellExplicit(ColorPalette const& _colorPalette,
-                                                             u32string graphemeCluster,
+                                                             u32string_view graphemeCluster,
                                                              ColumnCount width,
                                                              CellFlags flags,
                                                              RGBColor fg,
@@ -170,7 +179,7 @@ RenderCell RenderBufferBuilder<Cell>::makeRenderCellExplicit(ColorPalette const&
     renderCell.position.line = _line;
     renderCell.position.column = _column;
     renderCell.width = unbox<uint8_t>(width);
-    renderCell.codepoints = std::move(graphemeCluster);
+    renderCell.setCodepoints(graphemeCluster);
     return renderCell;
 }
 
@@ -193,7 +202,7 @@ RenderCell RenderBufferBuilder<Cell>::makeRenderCellExplicit(ColorPalette const&
     renderCell.position.column = _column;
     renderCell.width = 1;
     if (codepoint)
-        renderCell.codepoints.push_back(codepoint);
+        renderCell.appendCodepoint(codepoint);
     return renderCell;
 }
 
@@ -218,12 +227,10 @@ RenderCell RenderBufferBuilder<Cell>::makeRenderCell(ColorPalette const& _colorP
     if (screenCell.codepointCount() != 0)
     {
         for (size_t i = 0; i < screenCell.codepointCount(); ++i)
-            renderCell.codepoints.push_back(screenCell.codepoint(i));
+            renderCell.appendCodepoint(screenCell.codepoint(i));
     }
 
-    renderCell.image = screenCell.imageFragment();
-
-    if (auto href = _hyperlinks.hyperlinkById(screenCell.hyperlink()))
+    if (auto const* href = _hyperlinks.hyperlinkById(screenCell.hyperlink()))
     {
         auto const& color = href->state == HyperlinkState::Hover ? _colorPalette.hyperlinkDecoration.hover
                                                                  : _colorPalette.hyperlinkDecoration.normal;
@@ -254,21 +261,58 @@ RGBColorPair RenderBufferBuilder<Cell>::makeColorsForCell(CellLocation gridPosit
             && output.cursor->shape == CursorShape::Block;
     // clang-format on
 
-    auto const selected = terminal.isSelected(CellLocation { gridPosition.line, gridPosition.column });
-    auto const highlighted = terminal.isHighlighted(CellLocation { gridPosition.line, gridPosition.column });
+    auto const selected = containedInRanges(selectedRanges, selectedRangeIndex, gridPosition);
+    auto const highlighted = containedInRanges(highlightedRanges, highlightedRangeIndex, gridPosition);
     auto const blink = terminal.blinkState();
     auto const rapidBlink = terminal.rapidBlinkState();
 
-    return makeColors(terminal.colorPalette(),
-                      cellFlags,
-                      reverseVideo,
-                      foregroundColor,
-                      backgroundColor,
-                      selected,
-                      paintCursor,
-                      highlighted,
-                      blink,
-                      rapidBlink);
+    auto const sgrColors =
+        colorCache ? colorCache->resolve(
+            cellFlags, reverseVideo, foregroundColor, backgroundColor, blink, rapidBlink)
+                   : CellUtil::makeColors(terminal.colorPalette(),
+                                          cellFlags,
+                                          reverseVideo,
+                                          foregroundColor,
+                                          backgroundColor,
+                                          blink,
+                                          rapidBlink);
+
+    auto const colors = makeColors(terminal.colorPalette(), sgrColors, selected, paintCursor, highlighted);
+
+    if (!containedInRanges(searchMatchRanges, searchMatchRangeIndex, gridPosition))
+        return colors;
+
+    auto const isFocusedMatch = focusedSearchMatch == searchMatchRangeIndex;
+    return makeRGBColorPair(colors,
+                            isFocusedMatch ? terminal.colorPalette().searchHighlightFocused
+                                           : terminal.colorPalette().searchHighlight);
+}
+
+template <typename Cell>
+bool RenderBufferBuilder<Cell>::containsSearchMatches(LineOffset _line) const noexcept
+{
+    auto const lineLess = [](ColumnRange const& _range, LineOffset _value) {
+        return _range.line < _value;
+    };
+    auto const i = std::lower_bound(searchMatchRanges.begin(), searchMatchRanges.end(), _line, lineLess);
+    return i != searchMatchRanges.end() && i->line == _line;
+}
+
+template <typename Cell>
+bool RenderBufferBuilder<Cell>::containedInRanges(vector<ColumnRange> const& _ranges,
+                                                  size_t& _index,
+                                                  CellLocation _position) noexcept
+{
+    // Rewind in case a position above the last one is queried.
+    while (_index > 0 && _position.line <= _ranges[_index - 1].line)
+        --_index;
+
+    while (_index < _ranges.size()
+           && (_ranges[_index].line < _position.line
+               || (_ranges[_index].line == _position.line && _ranges[_index].toColumn < _position.column)))
+        ++_index;
+
+    return _index < _ranges.size() && _ranges[_index].contains(_position);
 }
 
 template <typename Cell>
@@ -333,7 +377,11 @@ void RenderBufferBuilder<Cell>::renderTrivialLine(TrivialLineBuffer const& lineB
     //                lineBuffer.text.size(),
     //                lineBuffer.text.view());
 
+    if (lineCache && lineCache->tryReuse(lineOffset, output))
+        return;
+
     auto const frontIndex = output.cells.size();
+    auto const frontLineIndex = output.lines.size();
 
     // Visual selection can alter colors for some columns in this line.
     // In that case, it seems like we cannot just pass it bare over but have to take the slower path.
@@ -343,8 +391,12 @@ void RenderBufferBuilder<Cell>::renderTrivialLine(TrivialLineBuffer const& lineB
     // which affects background/foreground color again.
     // We're not testing for cursor shape (which should be done in order to be 100% correct)
     // because it's not really draining performance.
-    bool const canRenderViaSimpleLine =
-        !terminal.isSelected(lineOffset) && !gridLineContainsCursor(lineOffset);
+    auto const gridLine = terminal.viewport()
+                              .translateScreenToGridCoordinate(CellLocation { lineOffset, ColumnOffset(0) })
+                              .line;
+    bool const canRenderViaSimpleLine = !terminal.isSelected(lineOffset)
+                                        && !gridLineContainsCursor(lineOffset)
+                                        && !containsSearchMatches(gridLine);
 
     if (canRenderViaSimpleLine)
     {
@@ -352,110 +404,88 @@ void RenderBufferBuilder<Cell>::renderTrivialLine(TrivialLineBuffer const& lineB
         lineNr = lineOffset;
         prevWidth = 0;
         prevHasCursor = false;
+        if (lineCache)
+            lineCache->store(lineOffset, output, frontIndex, frontLineIndex, output.images.size());
         return;
     }
 
     auto const textMargin = min(boxed_cast<ColumnOffset>(terminal.pageSize().columns),
                                 ColumnOffset::cast_from(lineBuffer.usedColumns));
-    auto const pageColumnsEnd = boxed_cast<ColumnOffset>(terminal.pageSize().columns);
 
     // render text
-    searchPatternOffset = 0;
-    renderUtf8Text(CellLocation { lineOffset, ColumnOffset(0) },
-                   lineBuffer.textAttributes,
-                   lineBuffer.text.view(),
-                   true);
-
-    // {{{ fill the remaining empty cells
-    for (auto columnOffset = textMargin; columnOffset < pageColumnsEnd; ++columnOffset)
-    {
-        auto const pos = CellLocation { lineOffset, columnOffset };
-        auto const gridPosition = terminal.viewport().translateScreenToGridCoordinate(pos);
-        auto renderAttributes = createRenderAttributes(gridPosition, lineBuffer.fillAttributes);
+    renderUtf8Text(
+        CellLocation { lineOffset, ColumnOffset(0) }, lineBuffer.textAttributes, lineBuffer.text.view());
 
-        output.cells.emplace_back(makeRenderCellExplicit(terminal.colorPalette(),
-                                                         char32_t { 0 },
-                                                         lineBuffer.fillAttributes.flags,
-                                                         renderAttributes.foregroundColor,
-                                                         renderAttributes.backgroundColor,
-                                                         lineBuffer.fillAttributes.underlineColor,
-                                                         baseLine + lineOffset,
-                                                         columnOffset));
-    }
-    // }}}
+    renderFillCells(lineOffset, textMargin, lineBuffer.fillAttributes);
 
     auto const backIndex = output.cells.size() - 1;
 
     output.cells[frontIndex].groupStart = true;
     output.cells[backIndex].groupEnd = true;
+
+    if (lineCache)
+        lineCache->store(lineOffset, output, frontIndex, frontLineIndex, output.images.size());
 }
 
 template <typename Cell>
-template <typename T>
-void RenderBufferBuilder<Cell>::matchSearchPattern(T const& textCell)
+void RenderBufferBuilder<Cell>::renderAttributedLine(AttributedLineBuffer const& lineBuffer,
+                                                     LineOffset lineOffset)
 {
-    if (_highlightSearchMatches == HighlightSearchMatches::No)
-        return;
-
-    auto const& searchMode = terminal.state().searchMode;
-    if (searchMode.pattern.empty())
+    if (lineCache && lineCache->tryReuse(lineOffset, output))
         return;
 
-    auto const isFullMatch = [&]() -> bool {
-        if constexpr (std::is_same_v<Cell, T>)
-        {
-            return !CellUtil::beginsWith(u32string_view(searchMode.pattern.data() + searchPatternOffset,
-                                                        searchMode.pattern.size() - searchPatternOffset),
-                                         textCell);
-        }
-        else
-        {
-            return crispy::beginsWith(u32string_view(searchMode.pattern.data() + searchPatternOffset,
-                                                     searchMode.pattern.size() - searchPatternOffset),
-                                      textCell);
-        }
-    }();
+    auto const frontIndex = output.cells.size();
+    auto const frontLineIndex = output.lines.size();
+    auto const pageColumnsEnd = boxed_cast<ColumnOffset>(terminal.pageSize().columns);
+    auto const text = std::string_view(lineBuffer.text);
 
-    if (isFullMatch)
+    // Each run is rendered like the text of a trivial line, with the colors of selection and cursor
+    // being taken care of per cell.
+    for (size_t i = 0; i < lineBuffer.runs.size(); ++i)
     {
-        // match fail
-        searchPatternOffset = 0;
-        return;
+        auto const& run = lineBuffer.runs[i];
+        if (run.start >= pageColumnsEnd)
+            break;
+        auto const end = min(lineBuffer.runEnd(i), pageColumnsEnd);
+        renderUtf8Text(CellLocation { lineOffset, run.start },
+                       run.attributes,
+                       text.substr(unbox<size_t>(run.start), unbox<size_t>(end - run.start)));
     }
 
-    if constexpr (std::is_same_v<Cell, T>)
-        searchPatternOffset += textCell.codepointCount();
-    else
-        searchPatternOffset += textCell.size();
-
-    if (searchPatternOffset < searchMode.pattern.size())
-        return; // match incomplete
+    renderFillCells(lineOffset,
+                    min(pageColumnsEnd, ColumnOffset::cast_from(lineBuffer.usedColumns())),
+                    lineBuffer.fillAttributes);
 
-    // match complete
+    auto const backIndex = output.cells.size() - 1;
 
-    auto const offsetIntoFront = output.cells.size() - searchPatternOffset;
+    output.cells[frontIndex].groupStart = true;
+    output.cells[backIndex].groupEnd = true;
 
-    auto const isFocusedMatch =
-        CellLocationRange {
-            output.cells[offsetIntoFront].position,
-            output.cells.back().position,
-        }
-            .contains(terminal.viewport().translateGridToScreenCoordinate(
-                terminal.state().viCommands.cursorPosition));
+    if (lineCache)
+        lineCache->store(lineOffset, output, frontIndex, frontLineIndex, output.images.size());
+}
 
-    for (size_t i = offsetIntoFront; i < output.cells.size(); ++i)
+template <typename Cell>
+void RenderBufferBuilder<Cell>::renderFillCells(LineOffset lineOffset,
+                                                ColumnOffset from,
+                                                GraphicsAttributes const& fillAttributes)
+{
+    auto const pageColumnsEnd = boxed_cast<ColumnOffset>(terminal.pageSize().columns);
+    for (auto columnOffset = from; columnOffset < pageColumnsEnd; ++columnOffset)
     {
-        auto& cellAttributes = output.cells[i].attributes;
-
-        auto const searchMatchColors =
-            makeRGBColorPair(RGBColorPair { cellAttributes.foregroundColor, cellAttributes.backgroundColor },
-                             isFocusedMatch ? terminal.colorPalette().searchHighlightFocused
-                                            : terminal.colorPalette().searchHighlight);
+        auto const pos = CellLocation { lineOffset, columnOffset };
+        auto const gridPosition = terminal.viewport().translateScreenToGridCoordinate(pos);
+        auto renderAttributes = createRenderAttributes(gridPosition, fillAttributes);
 
-        cellAttributes.backgroundColor = searchMatchColors.background;
-        cellAttributes.foregroundColor = searchMatchColors.foreground;
+        output.cells.emplace_back(makeRenderCellExplicit(terminal.colorPalette(),
+                                                         char32_t { 0 },
+                                                         fillAttributes.flags,
+                                                         renderAttributes.foregroundColor,
+                                                         renderAttributes.backgroundColor,
+                                                         fillAttributes.underlineColor,
+                                                         baseLine + lineOffset,
+                                                         columnOffset));
     }
-    searchPatternOffset = 0;
 }
 
 template <typename Cell>
@@ -465,6 +495,26 @@ void RenderBufferBuilder<Cell>::startLine(LineOffset _line) noexcept
     lineNr = _line;
     prevWidth = 0;
     prevHasCursor = false;
+
+    if (lineCache)
+    {
+        lineFirstCell = output.cells.size();
+        lineFirstRenderLine = output.lines.size();
+        lineFirstImage = output.images.size();
+        reusingLine = lineCache->tryReuse(_line, output);
+    }
+}
+
+template <typename Cell>
+void RenderBufferBuilder<Cell>::renderImage(ImagePlacement const& _image, LineOffset _line)
+{
+    if (reusingLine)
+        return;
+
+    output.images.emplace_back(RenderImage { _image.image,
+                                             CellLocation { baseLine + _line, _image.column },
+                                             _image.columns,
+                                             _image.offset });
 }
 
 template <typename Cell>
@@ -474,13 +524,16 @@ void RenderBufferBuilder<Cell>::endLine() noexcept
     {
         output.cells.back().groupEnd = true;
     }
+
+    if (lineCache && !reusingLine)
+        lineCache->store(lineNr, output, lineFirstCell, lineFirstRenderLine, lineFirstImage);
+    reusingLine = false;
 }
 
 template <typename Cell>
 ColumnCount RenderBufferBuilder<Cell>::renderUtf8Text(CellLocation screenPosition,
                                                       GraphicsAttributes textAttributes,
-                                                      std::string_view text,
-                                                      bool allowMatchSearchPattern)
+                                                      std::string_view text)
 {
     auto columnCountRendered = ColumnCount(0);
 
@@ -530,9 +583,6 @@ ColumnCount RenderBufferBuilder<Cell>::renderUtf8Text(CellLocation screenPositio
         lineNr = screenPosition.line;
         prevWidth = 0;
         prevHasCursor = false;
-
-        if (allowMatchSearchPattern)
-            matchSearchPattern(u32string_view(graphemeCluster));
     }
     return columnCountRendered;
 }
@@ -553,7 +603,7 @@ bool RenderBufferBuilder<Cell>::tryRenderInputMethodEditor(CellLocation screenPo
             output.cells.back().groupEnd = true;
 
         _inputMethodSkipColumns =
-            renderUtf8Text(screenPosition, textAttributes, _inputMethodData.preeditString, false);
+            renderUtf8Text(screenPosition, textAttributes, _inputMethodData.preeditString);
         if (_inputMethodSkipColumns > ColumnCount(0))
         {
             output.cursor->position.column += ColumnOffset::cast_from(_inputMethodSkipColumns);
@@ -575,6 +625,9 @@ bool RenderBufferBuilder<Cell>::tryRenderInputMethodEditor(CellLocation screenPo
 template <typename Cell>
 void RenderBufferBuilder<Cell>::renderCell(Cell const& screenCell, LineOffset _line, ColumnOffset _column)
 {
+    if (reusingLine)
+        return;
+
     auto const screenPosition = CellLocation { _line, _column };
     auto const gridPosition = terminal.viewport().translateScreenToGridCoordinate(screenPosition);
 
@@ -628,8 +681,6 @@ void RenderBufferBuilder<Cell>::renderCell(Cell const& screenCell, LineOffset _l
             break;
     }
     isNewLine = false;
-
-    matchSearchPattern(screenCell);
 }
 
 } // namespace terminal
@@ -4,6 +4,7 @@
 #include <terminal/Terminal.h>
 
 #include <optional>
+#include <vector>
 
 namespace terminal
 {
@@ -39,6 +40,11 @@ class RenderBufferBuilder
     void startLine(LineOffset _line) noexcept;
     void endLine() noexcept;
 
+    /// Renders a row of an image, displayed in consecutive cells of the current non-trivial line.
+    ///
+    /// This call is invoked after the cells of that line have been rendered.
+    void renderImage(ImagePlacement const& _image, LineOffset _line);
+
     /// Renders a trivial line.
     ///
     /// This call is guaranteed to be invoked sequencially from page top
@@ -49,14 +55,27 @@ class RenderBufferBuilder
     /// @see renderCell
     void renderTrivialLine(TrivialLineBuffer const& lineBuffer, LineOffset lineNo);
 
+    /// Renders an attributed line run by run, without inflating it into grid cells.
+    ///
+    /// The same ordering guarantees apply as for renderTrivialLine().
+    void renderAttributedLine(AttributedLineBuffer const& lineBuffer, LineOffset lineNo);
+
     /// This call is guaranteed to be invoked when the the full page has been rendered.
     void finish() noexcept {}
 
+    /// Reuses the lines the given cache has planned to reuse, and stores all other rendered lines
+    /// in the cache.
+    void useLineCache(RenderLineCache& _cache) noexcept { lineCache = &_cache; }
+
+    /// Resolves the colors of cells by means of the given cache, which must have been validated against
+    /// the terminal's current color palette.
+    void useColorCache(ResolvedColorCache& _cache) noexcept { colorCache = &_cache; }
+
   private:
     [[nodiscard]] std::optional<RenderCursor> renderCursor() const;
 
     [[nodiscard]] static RenderCell makeRenderCellExplicit(ColorPalette const& _colorPalette,
-                                                           std::u32string graphemeCluster,
+                                                           std::u32string_view graphemeCluster,
                                                            ColumnCount width,
                                                            CellFlags flags,
                                                            RGBColor fg,
@@ -99,13 +118,24 @@ class RenderBufferBuilder
 
     [[nodiscard]] bool tryRenderInputMethodEditor(CellLocation screenPosition, CellLocation gridPosition);
 
+    /// Renders the empty cells from the given column up to the right page margin.
+    void renderFillCells(LineOffset lineOffset, ColumnOffset from, GraphicsAttributes const& fillAttributes);
+
     ColumnCount renderUtf8Text(CellLocation screenPosition,
                                GraphicsAttributes attributes,
-                               std::string_view text,
-                               bool allowMatchSearchPattern);
+                               std::string_view text);
 
-    template <typename T>
-    void matchSearchPattern(T const& cellText);
+    /// Tests whether any search match is shown on the given grid line.
+    [[nodiscard]] bool containsSearchMatches(LineOffset _line) const noexcept;
+
+    /// Tests whether the given grid position is covered by any of the given ranges, which must be
+    /// ordered by line.
+    ///
+    /// The cells of a page are queried in ascending order, so the index of the range that has been
+    /// looked at last is just moved forward, instead of searching all ranges for every cell.
+    [[nodiscard]] static bool containedInRanges(std::vector<ColumnRange> const& _ranges,
+                                                size_t& _index,
+                                                CellLocation _position) noexcept;
 
     /// Tests if the given screen line offset does contain a cursor (either ANSI cursor or vi cursor, if
     /// shown) and returns false otherwise, which guarantees that no cursor is to be rendered
@@ -131,8 +161,24 @@ class RenderBufferBuilder
     LineOffset lineNr = LineOffset(0);
     bool isNewLine = false;
 
-    // Offset into the search pattern that has been already matched.
-    size_t searchPatternOffset = 0;
+    // Selected, highlighted, and search matching column ranges of the visible page, with the index
+    // of the range each of them has been looked at last.
+    std::vector<ColumnRange> selectedRanges;
+    std::vector<ColumnRange> highlightedRanges;
+    std::vector<ColumnRange> searchMatchRanges;
+    mutable size_t selectedRangeIndex = 0;
+    mutable size_t highlightedRangeIndex = 0;
+    mutable size_t searchMatchRangeIndex = 0;
+
+    // Index of the search match the vi cursor is in, if any.
+    std::optional<size_t> focusedSearchMatch;
+
+    RenderLineCache* lineCache = nullptr;
+    ResolvedColorCache* colorCache = nullptr;
+    bool reusingLine = false;
+    size_t lineFirstCell = 0;
+    size_t lineFirstRenderLine = 0;
+    size_t lineFirstImage = 0;
 };
 
 } // namespace terminal
@@ -17,6 +17,7 @@
 #include <terminal/Terminal.h>
 #include <terminal/VTType.h>
 #include <terminal/VTWriter.h>
+#include <terminal/cell/CompactCell.h>
 #include <terminal/logging.h>
 
 #include <crispy/App.h>
@@ -50,7 +51,6 @@ using namespace std::string_view_literals;
 using crispy::escape;
 using crispy::for_each;
 using crispy::times;
-using crispy::toHexString;
 
 using gsl::span;
 
@@ -75,7 +75,6 @@ using std::ostringstream;
 using std::pair;
 using std::prev;
 using std::ref;
-using std::rotate;
 using std::shared_ptr;
 using std::string;
 using std::string_view;
@@ -240,6 +239,70 @@ namespace // {{{ helper
     //             return nullopt;
     //     }
     // }
+
+    /// @returns the line offset, relative to the image's top line, the text cursor is to be placed at
+    ///          after rendering an image of the given height.
+    LineOffset sixelTextCursorOffset(Height _imageHeight, Height _cellHeight) noexcept
+    {
+        const auto lastSixelBand = _imageHeight.value % 6;
+        auto offset =
+            LineOffset::cast_from(std::ceil(static_cast<float>(_imageHeight.value - lastSixelBand)
+                                            / float(*_cellHeight)))
+            - 1 * (lastSixelBand == 0);
+        auto const h = _imageHeight.value - 1;
+        // VT340 has this behavior where for some heights it text cursor is placed not
+        // at the final sixel line but a line above it.
+        // See
+        // https://github.com/hackerb9/vt340test/blob/main/glitches.md#text-cursor-is-left-one-row-too-high-for-certain-sixel-heights
+        if (h % 6 > h % _cellHeight.value)
+            return offset - 1;
+        return offset;
+    }
+
+    /// Decodes the UTF-8 sequence at the front of the given text.
+    ///
+    /// @returns the codepoint and the length of its sequence, or a length of 0 if the text does not start
+    ///          with a complete and well-formed sequence (which overlong encodings, surrogates, and values
+    ///          beyond U+10FFFF are not).
+    pair<char32_t, size_t> decodeUtf8(string_view _text) noexcept
+    {
+        auto const byteAt = [&](size_t i) -> char32_t {
+            return static_cast<uint8_t>(_text[i]);
+        };
+        auto const continuation = [&](size_t _count) {
+            for (size_t i = 1; i <= _count; ++i)
+                if (i >= _text.size() || (byteAt(i) & 0xC0) != 0x80)
+                    return false;
+            return true;
+        };
+
+        if (_text.empty())
+            return { 0, 0 };
+
+        auto const lead = byteAt(0);
+        if (lead < 0x80)
+            return { lead, 1 };
+
+        if (0xC2 <= lead && lead < 0xE0 && continuation(1))
+            return { ((lead & 0x1F) << 6) | (byteAt(1) & 0x3F), 2 };
+
+        if (0xE0 <= lead && lead < 0xF0 && continuation(2))
+        {
+            auto const codepoint = ((lead & 0x0F) << 12) | ((byteAt(1) & 0x3F) << 6) | (byteAt(2) & 0x3F);
+            if (codepoint >= 0x800 && !(0xD800 <= codepoint && codepoint <= 0xDFFF))
+                return { codepoint, 3 };
+        }
+
+        if (0xF0 <= lead && lead < 0xF5 && continuation(3))
+        {
+            auto const codepoint = ((lead & 0x07) << 18) | ((byteAt(1) & 0x3F) << 12)
+                                   | ((byteAt(2) & 0x3F) << 6) | (byteAt(3) & 0x3F);
+            if (0x10000 <= codepoint && codepoint <= 0x10FFFF)
+                return { codepoint, 4 };
+        }
+
+        return { 0, 0 };
+    }
 } // namespace
 // }}}
 
@@ -309,7 +372,7 @@ string_view Screen<Cell>::tryEmplaceChars(string_view _chars, size_t cellCount)
         if (currentLine().empty())
         {
             auto const numberOfBytesEmplaced = emplaceCharsIntoCurrentLine(_chars, cellCount);
-            _terminal.currentPtyBuffer()->advanceHotEndUntil(_chars.data() + numberOfBytesEmplaced);
+            _terminal.advanceCurrentPtyBufferUntil(_chars.data() + numberOfBytesEmplaced);
             _chars.remove_prefix(numberOfBytesEmplaced);
             assert(_chars.empty());
         }
@@ -324,7 +387,18 @@ string_view Screen<Cell>::tryEmplaceChars(string_view _chars, size_t cellCount)
         lineBuffer.text.growBy(_chars.size());
         lineBuffer.usedColumns += ColumnCount::cast_from(cellCount);
         advanceCursorAfterWrite(ColumnCount::cast_from(cellCount));
-        _terminal.currentPtyBuffer()->advanceHotEndUntil(_chars.data() + _chars.size());
+        _terminal.advanceCurrentPtyBufferUntil(_chars.data() + _chars.size());
+        _chars.remove_prefix(_chars.size());
+        return _chars;
+    }
+
+    // US-ASCII text written right behind the text of a line, but with other graphics attributes (such as
+    // colorized compiler output), is kept in an attributed line buffer instead of inflating the line.
+    if (_chars.size() == cellCount
+        && currentLine().tryAppendAttributedText(
+            _state.cursor.position.column, _chars, _state.cursor.graphicsRendition, _state.cursor.hyperlink))
+    {
+        advanceCursorAfterWrite(ColumnCount::cast_from(cellCount));
         _chars.remove_prefix(_chars.size());
         return _chars;
     }
@@ -341,12 +415,16 @@ size_t Screen<Cell>::emplaceCharsIntoCurrentLine(string_view _chars, size_t cell
     assert(cellCount <= static_cast<size_t>(columnsAvailable));
 
     Line<Cell>& line = currentLine();
-    if (line.isTrivialBuffer() && line.empty())
+    auto attributes = line.isTrivialBuffer() && line.empty()
+                          ? InternedGraphicsAttributes::intern(_state.cursor.graphicsRendition)
+                          : nullopt;
+    if (attributes)
     {
         // Only use fastpath if the currently line hasn't been inflated already.
         // Because we might lose prior-written textual/SGR information otherwise.
+        // Attributes that cannot be interned are written into the cells the generic way instead.
         line.setBuffer(TrivialLineBuffer { line.trivialBuffer().displayWidth,
-                                           _state.cursor.graphicsRendition,
+                                           std::move(*attributes),
                                            line.trivialBuffer().fillAttributes,
                                            _state.cursor.hyperlink,
                                            ColumnCount::cast_from(cellCount),
@@ -355,16 +433,98 @@ size_t Screen<Cell>::emplaceCharsIntoCurrentLine(string_view _chars, size_t cell
     }
     else
     {
-        // Transforming _chars input from UTF-8 to UTF-32 even though right now it should only
-        // be containing US-ASCII, but soon it'll be any arbitrary textual Unicode codepoints.
-        for (char const ch: _chars)
-        {
-            _state.parser.printUtf8Byte(ch);
-        }
+        writeTextBulk(_chars);
     }
     return _chars.size();
 }
 
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Screen<Cell>::writeTextBulk(string_view _chars)
+{
+    while (!_chars.empty())
+    {
+        _chars.remove_prefix(writeCodepointsIntoCurrentLine(_chars));
+        if (_chars.empty())
+            break;
+
+        // The next codepoint needs to go the generic way. If it is malformed, so is the rest.
+        auto const length = decodeUtf8(_chars).second;
+        auto const byteCount = length != 0 ? length : _chars.size();
+        for (char const ch: _chars.substr(0, byteCount))
+            _state.parser.printUtf8Byte(ch);
+        _chars.remove_prefix(byteCount);
+    }
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+size_t Screen<Cell>::writeCodepointsIntoCurrentLine(string_view _chars) noexcept
+{
+    // A pending single shift only applies to the very next character, which is left to writeTextInternal().
+    auto const& charsets = _state.cursor.charsets;
+    if (charsets.isSingleShifted())
+        return 0;
+
+    crlfIfWrapPending();
+
+    // Same as in clearAndAdvance(), the right margin only applies if the cursor is inside the margins.
+    auto const insideMargins =
+        _terminal.isModeEnabled(DECMode::LeftRightMargin) && _terminal.isCursorInsideMargins();
+    auto const rightColumn = insideMargins ? *_state.margin.horizontal.to : *_state.pageSize.columns - 1;
+
+    auto& line = currentLine();
+    auto& codepointTable = _state.codepointTable;
+    auto const& sgr = _state.cursor.graphicsRendition;
+    auto const hyperlink = _state.cursor.hyperlink;
+    auto const charsetTable = charsets.currentTable();
+    auto const firstColumn = *_state.cursor.position.column;
+    auto column = firstColumn;
+    auto lastWrittenColumn = column;
+    auto precedingCodepoint = precedingGraphicCharacter();
+    auto input = _chars;
+
+    while (!input.empty())
+    {
+        auto const [inputCodepoint, length] = decodeUtf8(input);
+        if (length == 0 || inputCodepoint < 0x20 || inputCodepoint == 0x7F)
+            break;
+        auto const codepoint = inputCodepoint < 0x7F
+                                   ? charsets.map(charsetTable, static_cast<char>(inputCodepoint))
+                                   : inputCodepoint;
+
+        // Zero-width codepoints do not advance the cursor, and writing into the right-most column sets
+        // the wrap pending, either of which is handled by writeTextInternal().
+        auto const width = codepointTable.width(codepoint);
+        if (width == 0 || width > rightColumn - column
+            || !codepointTable.breakable(precedingCodepoint, codepoint))
+            break;
+
+        line.useCellAt(ColumnOffset::cast_from(column))
+            .write(sgr, codepoint, static_cast<uint8_t>(width), hyperlink);
+        lastWrittenColumn = column++;
+        for (int i = 1; i < width; ++i)
+            line.useCellAt(ColumnOffset::cast_from(column++)).reset(sgr, hyperlink);
+
+        // As with writeTextInternal(), the preceding graphic character is the one before charset mapping.
+        precedingCodepoint = inputCodepoint;
+        input.remove_prefix(length);
+    }
+
+    if (column == firstColumn)
+        return 0;
+
+    auto const lineOffset = *_state.cursor.position.line;
+    _state.lastCursorPosition = CellLocation { _state.cursor.position.line, ColumnOffset(lastWrittenColumn) };
+    _state.cursor.position.column = ColumnOffset(column);
+    _state.parser.setPrecedingGraphicCharacter(precedingCodepoint);
+    _terminal.markRegionDirty(
+        Rect { Top(lineOffset), Left(firstColumn), Bottom(lineOffset), Right(column - 1) });
+    resetInstructionCounter();
+
+    return _chars.size() - input.size();
+}
+
 template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
 void Screen<Cell>::advanceCursorAfterWrite(ColumnCount n) noexcept
@@ -395,12 +555,9 @@ void Screen<Cell>::writeText(string_view _chars, size_t cellCount)
     if (_chars.empty())
         return;
 
-    // Making use of the optimized code path for the input characters did NOT work, so we need to first
-    // convert UTF-8 to UTF-32 codepoints (reusing the logic in VT parser) and pass these codepoints
-    // to the grapheme cluster processor.
-
-    for (char const ch: _chars)
-        _state.parser.printUtf8Byte(ch);
+    // Making use of the optimized code path for the input characters did NOT work, so the codepoints
+    // are written into the (inflated) line instead.
+    writeTextBulk(_chars);
 }
 
 template <typename Cell>
@@ -449,7 +606,7 @@ void Screen<Cell>::writeTextInternal(char32_t _char)
 
     char32_t const codepoint = _state.cursor.charsets.map(_char);
 
-    if (unicode::grapheme_segmenter::breakable(precedingGraphicCharacter(), codepoint))
+    if (_state.codepointTable.breakable(precedingGraphicCharacter(), codepoint))
     {
         writeCharToCurrentAndAdvance(codepoint);
     }
@@ -480,7 +637,7 @@ void Screen<Cell>::writeCharToCurrentAndAdvance(char32_t _character) noexcept
 
     cell.write(_state.cursor.graphicsRendition,
                _character,
-               (uint8_t) unicode::width(_character),
+               static_cast<uint8_t>(_state.codepointTable.width(_character)),
                _state.cursor.hyperlink);
 
     _state.lastCursorPosition = _state.cursor.position;
@@ -540,6 +697,7 @@ std::string Screen<Cell>::screenshot(function<string(LineOffset)> const& _postLi
             writer.write(_postLine(LineOffset(line)));
         writer.crlf();
     }
+    writer.flush();
 
     return result.str();
 }
@@ -556,11 +714,7 @@ optional<LineOffset> Screen<Cell>::findMarkerUpwards(LineOffset _startLine) cons
 
     _startLine = min(_startLine, boxed_cast<LineOffset>(_state.pageSize.lines - 1));
 
-    for (LineOffset i = _startLine - 1; i >= -boxed_cast<LineOffset>(historyLineCount()); --i)
-        if (grid().lineAt(i).marked())
-            return { i };
-
-    return nullopt;
+    return grid().findMarkedLineAbove(_startLine);
 }
 
 template <typename Cell>
@@ -576,11 +730,7 @@ optional<LineOffset> Screen<Cell>::findMarkerDownwards(LineOffset _lineOffset) c
 
     auto const bottom = LineOffset(0);
 
-    for (LineOffset i = top + 1; i <= bottom; ++i)
-        if (grid().lineAt(i).marked())
-            return { i };
-
-    return nullopt;
+    return grid().findMarkedLineBelow(top, bottom);
 }
 
 // {{{ tabs related
@@ -761,34 +911,42 @@ void Screen<Cell>::sendDeviceAttributes()
 {
     // See https://vt100.net/docs/vt510-rm/DA1.html
 
-    auto const id = [&]() -> string_view {
+    // The attributes never change, so the replies are encoded once per conformance level.
+    static auto const replies = []() {
+        auto const attrs = to_params(DeviceAttributes::AnsiColor |
+                                     // DeviceAttributes::AnsiTextLocator |
+                                     DeviceAttributes::CaptureScreenBuffer | DeviceAttributes::Columns132 |
+                                     // TODO: DeviceAttributes::NationalReplacementCharacterSets |
+                                     DeviceAttributes::RectangularEditing |
+                                     // TODO: DeviceAttributes::SelectiveErase |
+                                     DeviceAttributes::SixelGraphics |
+                                     // TODO: DeviceAttributes::TechnicalCharacters |
+                                     DeviceAttributes::UserDefinedKeys);
+        std::array<std::string, 5> replies;
+        auto const ids = std::array { "1"sv, "62"sv, "63"sv, "64"sv, "65"sv };
+        for (size_t i = 0; i < ids.size(); ++i)
+            replies[i] = fmt::format("\033[?{};{}c", ids[i], attrs);
+        return replies;
+    }();
+
+    auto const level = [&]() -> size_t {
         switch (_state.terminalId)
         {
-            case VTType::VT100: return "1";
+            case VTType::VT100: return 0;
             case VTType::VT220:
-            case VTType::VT240: return "62";
+            case VTType::VT240: return 1;
             case VTType::VT320:
             case VTType::VT330:
-            case VTType::VT340: return "63";
-            case VTType::VT420: return "64";
+            case VTType::VT340: return 2;
+            case VTType::VT420: return 3;
             case VTType::VT510:
             case VTType::VT520:
-            case VTType::VT525: return "65";
+            case VTType::VT525: return 4;
         }
-        return "1"; // Should never be reached.
+        return 0; // Should never be reached.
     }();
 
-    auto const attrs = to_params(DeviceAttributes::AnsiColor |
-                                 // DeviceAttributes::AnsiTextLocator |
-                                 DeviceAttributes::CaptureScreenBuffer | DeviceAttributes::Columns132 |
-                                 // TODO: DeviceAttributes::NationalReplacementCharacterSets |
-                                 DeviceAttributes::RectangularEditing |
-                                 // TODO: DeviceAttributes::SelectiveErase |
-                                 DeviceAttributes::SixelGraphics |
-                                 // TODO: DeviceAttributes::TechnicalCharacters |
-                                 DeviceAttributes::UserDefinedKeys);
-
-    _terminal.reply("\033[?{};{}c", id, attrs);
+    _terminal.reply(replies[level]);
 }
 
 template <typename Cell>
@@ -809,7 +967,8 @@ void Screen<Cell>::sendTerminalId()
     // ROM cardridge registration number (always 0)
     auto constexpr Pc = 0;
 
-    _terminal.reply("\033[>{};{};{}c", Pp, Pv, Pc);
+    static auto const versionAndCartridge = fmt::format(";{};{}c", Pv, Pc);
+    _terminal.reply("\033[>{}{}", Pp, versionAndCartridge);
 }
 
 // {{{ ED
@@ -865,9 +1024,8 @@ void Screen<Cell>::eraseCharacters(ColumnCount _n)
         _state.pageSize.columns - boxed_cast<ColumnCount>(realCursorPosition().column);
     auto const n = unbox<long>(clamp(_n, ColumnCount(1), columnsAvailable));
 
-    auto& line = currentLine();
-    for (int i = 0; i < n; ++i)
-        line.useCellAt(_state.cursor.position.column + i).reset(_state.cursor.graphicsRendition);
+    Cell* first = &currentLine().useCellAt(_state.cursor.position.column);
+    Cell::resetRange(first, first + n, _state.cursor.graphicsRendition);
 }
 
 // {{{ DECSEL
@@ -1022,18 +1180,21 @@ void Screen<Cell>::clearToEndOfLine()
         return;
     }
 
-    Cell* i = &at(_state.cursor.position);
-    Cell* e = i + unbox<int>(_state.pageSize.columns) - unbox<int>(_state.cursor.position.column);
-    while (i != e)
-    {
-        i->reset(_state.cursor.graphicsRendition);
-        ++i;
-    }
-
     auto const line = _state.cursor.position.line;
     auto const left = _state.cursor.position.column;
     auto const right = boxed_cast<ColumnOffset>(_state.pageSize.columns - 1);
     auto const area = Rect { Top(*line), Left(*left), Bottom(*line), Right(*right) };
+
+    if (currentLine().tryClearTrivialToEnd(left, _state.cursor.graphicsRendition))
+    {
+        _terminal.markRegionDirty(area);
+        return;
+    }
+
+    Cell* i = &at(_state.cursor.position);
+    Cell* e = i + unbox<int>(_state.pageSize.columns) - unbox<int>(_state.cursor.position.column);
+    Cell::resetRange(i, e, _state.cursor.graphicsRendition);
+
     _terminal.markRegionDirty(area);
 }
 
@@ -1043,11 +1204,7 @@ void Screen<Cell>::clearToBeginOfLine()
 {
     Cell* i = &at(_state.cursor.position.line, ColumnOffset(0));
     Cell* e = i + unbox<int>(_state.cursor.position.column) + 1;
-    while (i != e)
-    {
-        i->reset(_state.cursor.graphicsRendition);
-        ++i;
-    }
+    Cell::resetRange(i, e, _state.cursor.graphicsRendition);
 
     auto const line = _state.cursor.position.line;
     auto const left = ColumnOffset(0);
@@ -1100,17 +1257,11 @@ void Screen<Cell>::insertChars(LineOffset _lineNo, ColumnCount _n)
 {
     auto const n = min(*_n, *_state.margin.horizontal.to - *logicalCursorPosition().column + 1);
 
-    auto column0 = grid().lineAt(_lineNo).inflatedBuffer().begin() + *realCursorPosition().column;
-    auto column1 = grid().lineAt(_lineNo).inflatedBuffer().begin() + *_state.margin.horizontal.to - n + 1;
-    auto column2 = grid().lineAt(_lineNo).inflatedBuffer().begin() + *_state.margin.horizontal.to + 1;
+    Cell* cells = grid().lineAt(_lineNo).inflatedBuffer().data();
+    Cell* column0 = cells + *realCursorPosition().column;
+    Cell* column2 = cells + *_state.margin.horizontal.to + 1;
 
-    rotate(column0, column1, column2);
-
-    for (Cell& cell: grid().lineAt(_lineNo).useRange(boxed_cast<ColumnOffset>(_state.cursor.position.column),
-                                                     ColumnCount::cast_from(n)))
-    {
-        cell.write(_state.cursor.graphicsRendition, L' ', 1);
-    }
+    Cell::insertRange(column0, column2, static_cast<size_t>(n), _state.cursor.graphicsRendition, L' ');
 }
 
 template <typename Cell>
@@ -1246,20 +1397,11 @@ template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
 void Screen<Cell>::deleteChars(LineOffset _line, ColumnOffset _column, ColumnCount _n)
 {
-    auto& line = grid().lineAt(_line);
-    auto lineBuffer = line.cells();
-
-    Cell* left = const_cast<Cell*>(lineBuffer.data() + _column.as<size_t>());
-    Cell* right = const_cast<Cell*>(lineBuffer.data() + *_state.margin.horizontal.to + 1);
-    long const n = min(_n.as<long>(), static_cast<long>(std::distance(left, right)));
-    Cell* mid = left + n;
-
-    rotate(left, mid, right);
+    Cell* cells = grid().lineAt(_line).inflatedBuffer().data();
+    Cell* left = cells + _column.as<size_t>();
+    Cell* right = cells + *_state.margin.horizontal.to + 1;
 
-    for (Cell& cell: gsl::make_span(right - n, right))
-    {
-        cell.write(_state.cursor.graphicsRendition, L' ', 1);
-    }
+    Cell::deleteRange(left, right, _n.as<size_t>(), _state.cursor.graphicsRendition, L' ');
 }
 
 template <typename Cell>
@@ -1296,23 +1438,52 @@ void Screen<Cell>::setCurrentWorkingDirectory(string const& _url)
     _state.currentWorkingDirectory = _url;
 }
 
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Screen<Cell>::beginCommandPrompt()
+{
+    if (_state.screenType != ScreenType::Primary)
+        return;
+
+    // The prompt is marked as well, such that marks can be navigated without shell integration, too.
+    setMark();
+    grid().beginCommandPrompt(_state.cursor.position.line);
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Screen<Cell>::beginCommandOutput()
+{
+    if (_state.screenType == ScreenType::Primary)
+        grid().beginCommandOutput(_state.cursor.position.line);
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Screen<Cell>::endCommand(std::optional<int> _exitCode)
+{
+    if (_state.screenType != ScreenType::Primary)
+        return;
+
+    // Output not terminated by a newline ends on the cursor's line.
+    auto const line = _state.cursor.position.column.value != 0 ? _state.cursor.position.line + 1
+                                                               : _state.cursor.position.line;
+    grid().endCommand(line, _exitCode);
+}
+
 template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
 void Screen<Cell>::hyperlink(string _id, string _uri)
 {
     if (_uri.empty())
         _state.cursor.hyperlink = {};
-    else if (!_id.empty())
-        _state.cursor.hyperlink = _state.hyperlinks.hyperlinkIdByUserId(_id);
     else
     {
-        _state.cursor.hyperlink = _state.hyperlinks.nextHyperlinkId++;
-        _state.hyperlinks.cache.emplace(
-            _state.cursor.hyperlink,
-            make_shared<HyperlinkInfo>(HyperlinkInfo { std::move(_id), std::move(_uri) }));
+        if (_state.hyperlinks.needsCollection())
+            _terminal.releaseUnreferencedHyperlinks();
+        _state.cursor.hyperlink = _state.hyperlinks.intern(std::move(_id), std::move(_uri));
     }
     // TODO:
-    // Care about eviction.
     // Move hyperlink store into ScreenBuffer, so it gets reset upon every switch into
     // alternate screen (not for main screen!)
 }
@@ -1447,69 +1618,84 @@ template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
 void Screen<Cell>::captureBuffer(LineCount _lineCount, bool _logicalLines)
 {
-    // TODO: Unit test case! (for ensuring line numbering and limits are working as expected)
+    VTCaptureBufferLog()("Capture buffer: {} lines {}", _lineCount, _logicalLines ? "logical" : "actual");
 
-    auto capturedBuffer = std::string();
+    auto line = optional { captureBufferTop(_lineCount, _logicalLines) };
+    while (line)
+        line = captureBufferChunk(*line, _logicalLines);
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+LineOffset Screen<Cell>::captureBufferTop(LineCount _lineCount, bool _logicalLines)
+{
+    grid().reflowDeferredLines();
 
     // TODO: when capturing _lineCount < screenSize.lines, start at the lowest non-empty line.
     auto const relativeStartLine =
         _logicalLines ? grid().computeLogicalLineNumberFromBottom(LineCount::cast_from(_lineCount))
                       : unbox<int>(_state.pageSize.lines - _lineCount);
-    auto const startLine = LineOffset::cast_from(
+    return LineOffset::cast_from(
         clamp(relativeStartLine, -unbox<int>(historyLineCount()), unbox<int>(_state.pageSize.lines)));
+}
 
-    VTCaptureBufferLog()("Capture buffer: {} lines {}", _lineCount, _logicalLines ? "logical" : "actual");
-
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+optional<LineOffset> Screen<Cell>::captureBufferChunk(LineOffset _line, bool _logicalLines)
+{
     size_t constexpr MaxChunkSize = 4096;
-    size_t currentChunkSize = 0;
-    auto const pushContent = [&](auto const data) -> void {
-        if (data.empty())
-            return;
-        if (currentChunkSize == 0) // initiate chunk
-            _terminal.reply("\033^{};", CaptureBufferCode);
-        else if (currentChunkSize + data.size() >= MaxChunkSize)
-        {
-            VTCaptureBufferLog()("Transferred chunk of {} bytes.", currentChunkSize);
-            _terminal.reply("\033\\"); // ST
-            _terminal.reply("\033^{};", CaptureBufferCode);
-            currentChunkSize = 0;
-        }
-        _terminal.reply(data);
-        currentChunkSize += data.size();
-    };
+
+    grid().reflowDeferredLines();
+
     LineOffset const bottomLine = boxed_cast<LineOffset>(_state.pageSize.lines - 1);
-    VTCaptureBufferLog()("Capturing buffer. top: {}, bottom: {}", relativeStartLine, bottomLine);
+    auto line = clamp(_line, LineOffset::cast_from(-unbox<int>(historyLineCount())), bottomLine + 1);
+    VTCaptureBufferLog()("Capturing buffer chunk. top: {}, bottom: {}", line, bottomLine);
 
-    for (LineOffset line = startLine; line <= bottomLine; ++line)
+    // A chunk ends after the line that filled it up, so a single very long line may exceed its size.
+    auto chunk = std::string();
+    for (; line <= bottomLine && chunk.size() < MaxChunkSize; ++line)
     {
-        if (_logicalLines && grid().lineAt(line).wrapped() && !capturedBuffer.empty())
-            capturedBuffer.pop_back();
-
         auto const& lineBuffer = grid().lineAt(line);
-        auto lineCellsTrimmed = lineBuffer.trim_blank_right();
-        if (lineCellsTrimmed.empty())
+        auto const lineStart = chunk.size();
+        if (lineBuffer.isTrivialBuffer())
         {
-            VTCaptureBufferLog()("Skipping blank line {}", line);
-            continue;
+            // Serializing the text directly avoids inflating every captured line.
+            auto text = lineBuffer.trivialBuffer().text.view();
+            while (!text.empty() && text.back() == ' ')
+                text.remove_suffix(1);
+            chunk += text;
+        }
+        else
+        {
+            for (auto const& cell: lineBuffer.trim_blank_right())
+                chunk += cell.toUtf8();
         }
-        auto const tl = lineCellsTrimmed.size();
-        while (!lineCellsTrimmed.empty())
+
+        if (chunk.size() == lineStart)
         {
-            auto const available = MaxChunkSize - currentChunkSize;
-            auto const n = min(available, lineCellsTrimmed.size());
-            for (auto const& cell: lineCellsTrimmed.subspan(0, n))
-                pushContent(cell.toUtf8());
-            lineCellsTrimmed = lineCellsTrimmed.subspan(n);
+            VTCaptureBufferLog()("Skipping blank line {}", line);
+            continue;
         }
-        VTCaptureBufferLog()("NL ({} len)", tl);
-        pushContent("\n"sv);
+
+        // Logical lines continue on the next line if that one has been wrapped into.
+        if (!_logicalLines || line == bottomLine || !grid().lineAt(line + 1).wrapped())
+            chunk += '\n';
     }
 
-    if (currentChunkSize != 0)
+    if (!chunk.empty())
+    {
+        VTCaptureBufferLog()("Transferred chunk of {} bytes.", chunk.size());
+        _terminal.reply("\033^{};", CaptureBufferCode);
+        _terminal.reply(chunk);
         _terminal.reply("\033\\"); // ST
+    }
+
+    if (line <= bottomLine)
+        return line;
 
     VTCaptureBufferLog()("Capturing buffer finished.");
     _terminal.reply("\033^{};\033\\", CaptureBufferCode); // mark the end
+    return nullopt;
 }
 
 template <typename Cell>
@@ -1648,7 +1834,7 @@ template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
 void Screen<Cell>::setMark()
 {
-    currentLine().setMarked(true);
+    grid().setMarked(_state.cursor.position.line);
 }
 
 template <typename Cell>
@@ -1778,6 +1964,77 @@ void Screen<Cell>::sixelImage(ImageSize _pixelSize, Image::Data&& _data)
         linefeed(topLeft.column);
 }
 
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Screen<Cell>::commitSixelBands(bool _final)
+{
+    auto& builder = *sixelImageBuilder_;
+    auto const cellHeight = unbox<unsigned int>(_state.cellPixelSize.height);
+    if (!_final && !cellHeight)
+        return;
+
+    // Only full grid lines are committed while the image is still being received.
+    auto const rowCount = _final ? unbox<unsigned int>(builder.size().height) - builder.takenRowCount()
+                                 : builder.completedRowCount() / cellHeight * cellHeight;
+    auto const autoScroll = !_terminal.isModeEnabled(DECMode::NoSixelScrolling);
+    auto const bottomLine = boxed_cast<LineOffset>(_state.pageSize.lines) - 1;
+
+    if (rowCount != 0)
+    {
+        auto const pixelSize = ImageSize { builder.size().width, Height::cast_from(rowCount) };
+        auto const extent = GridSize {
+            LineCount::cast_from(ceilf(float(rowCount) / float(cellHeight))),
+            ColumnCount::cast_from(ceilf(float(*pixelSize.width) / float(*_state.cellPixelSize.width))),
+        };
+        auto const columnsToBeRendered =
+            ColumnCount(min(*_state.pageSize.columns - *sixelTopLeft_.column, *extent.columns));
+
+        auto rows = _final ? std::move(builder.data()) : builder.takeRows(rowCount);
+        auto const rasterizedImage =
+            _state.imagePool.rasterize(uploadImage(ImageFormat::RGBA, pixelSize, std::move(rows)),
+                                       ImageAlignment::TopStart,
+                                       ImageResize::NoResize,
+                                       RGBAColor {},
+                                       extent,
+                                       _state.cellPixelSize);
+
+        for (auto const lineOffset: crispy::views::iota_as<LineOffset>(*extent.lines))
+        {
+            auto line = sixelTopLeft_.line + boxed_cast<LineOffset>(sixelLinesCommitted_);
+            if (line > bottomLine)
+            {
+                if (!autoScroll)
+                    break;
+                moveCursorTo(bottomLine, sixelTopLeft_.column);
+                linefeed(sixelTopLeft_.column);
+                --sixelTopLeft_.line;
+                sixelScrolled_ = true;
+                line = bottomLine;
+            }
+            grid().lineAt(line).placeImage(ImagePlacement { rasterizedImage,
+                                                            sixelTopLeft_.column,
+                                                            columnsToBeRendered,
+                                                            CellLocation { lineOffset, {} } },
+                                           _state.cursor.hyperlink);
+            ++sixelLinesCommitted_;
+        }
+    }
+
+    if (!_final)
+        return;
+
+    // Place the text cursor as if the image had been rendered at once.
+    if (sixelScrolled_)
+        moveCursorTo(bottomLine, sixelTopLeft_.column);
+    else
+        moveCursorTo(sixelTopLeft_.line
+                         + sixelTextCursorOffset(builder.size().height, _state.cellPixelSize.height),
+                     sixelTopLeft_.column);
+
+    if (!_terminal.isModeEnabled(DECMode::SixelCursorNextToGraphic))
+        linefeed(sixelTopLeft_.column);
+}
+
 template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
 shared_ptr<Image const> Screen<Cell>::uploadImage(ImageFormat _format,
@@ -1810,29 +2067,16 @@ void Screen<Cell>::renderImage(shared_ptr<Image const> _image,
     // TODO: make use of _imageOffset and _imageSize
     auto const rasterizedImage = _state.imagePool.rasterize(
         std::move(_image), _alignmentPolicy, _resizePolicy, gapColor, _gridSize, _state.cellPixelSize);
-    const auto lastSixelBand = _imageSize.height.value % 6;
-    const LineOffset offset = [&]() {
-        auto offset =
-            LineOffset::cast_from(std::ceil(static_cast<float>(_imageSize.height.value - lastSixelBand)
-                                            / float(*_state.cellPixelSize.height)))
-            - 1 * (lastSixelBand == 0);
-        auto const h = _imageSize.height.value - 1;
-        // VT340 has this behavior where for some heights it text cursor is placed not
-        // at the final sixel line but a line above it.
-        // See
-        // https://github.com/hackerb9/vt340test/blob/main/glitches.md#text-cursor-is-left-one-row-too-high-for-certain-sixel-heights
-        if (h % 6 > h % _state.cellPixelSize.height.value)
-            return offset - 1;
-        return offset;
-    }();
+    auto const offset = sixelTextCursorOffset(_imageSize.height, _state.cellPixelSize.height);
     if (*linesToBeRendered)
     {
-        for (GridSize::Offset const offset: GridSize { linesToBeRendered, columnsToBeRendered })
-        {
-            Cell& cell = at(_topLeft + offset);
-            cell.setImageFragment(rasterizedImage, CellLocation { offset.line, offset.column });
-            cell.setHyperlink(_state.cursor.hyperlink);
-        };
+        for (auto const lineOffset: crispy::views::iota_as<LineOffset>(*linesToBeRendered))
+            grid().lineAt(_topLeft.line + lineOffset)
+                .placeImage(ImagePlacement { rasterizedImage,
+                                             _topLeft.column,
+                                             columnsToBeRendered,
+                                             CellLocation { lineOffset, {} } },
+                            _state.cursor.hyperlink);
         moveCursorTo(_topLeft.line + offset, _topLeft.column);
     }
 
@@ -1845,15 +2089,15 @@ void Screen<Cell>::renderImage(shared_ptr<Image const> _image,
         for (auto const lineOffset: crispy::times(*remainingLineCount))
         {
             linefeed(_topLeft.column);
-            for (auto const columnOffset: crispy::views::iota_as<ColumnOffset>(*columnsToBeRendered))
-            {
-                auto const offset =
-                    CellLocation { boxed_cast<LineOffset>(linesToBeRendered) + lineOffset, columnOffset };
-                Cell& cell =
-                    at(boxed_cast<LineOffset>(_state.pageSize.lines) - 1, _topLeft.column + columnOffset);
-                cell.setImageFragment(rasterizedImage, offset);
-                cell.setHyperlink(_state.cursor.hyperlink);
-            };
+            grid()
+                .lineAt(boxed_cast<LineOffset>(_state.pageSize.lines) - 1)
+                .placeImage(ImagePlacement { rasterizedImage,
+                                             _topLeft.column,
+                                             columnsToBeRendered,
+                                             CellLocation { boxed_cast<LineOffset>(linesToBeRendered)
+                                                                + LineOffset::cast_from(lineOffset),
+                                                            {} } },
+                            _state.cursor.hyperlink);
         }
     }
     // move ansi text cursor to position of the sixel cursor
@@ -2071,19 +2315,8 @@ template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
 void Screen<Cell>::requestCapability(std::string_view _name)
 {
-    if (booleanCapability(_name))
-        _terminal.reply("\033P1+r{}\033\\", toHexString(_name));
-    else if (auto const value = numericCapability(_name); value != Database::npos)
-    {
-        auto hexValue = fmt::format("{:X}", value);
-        if (hexValue.size() % 2)
-            hexValue.insert(hexValue.begin(), '0');
-        _terminal.reply("\033P1+r{}={}\033\\", toHexString(_name), hexValue);
-    }
-    else if (auto const value = stringCapability(_name); !value.empty())
-        _terminal.reply("\033P1+r{}={}\033\\", toHexString(_name), asHex(value));
-    else
-        _terminal.reply("\033P0+r\033\\");
+    // Capabilities requested by name are the static ones, whose replies have been encoded already.
+    _terminal.reply(capabilityReply(_name));
 }
 
 template <typename Cell>
@@ -2210,7 +2443,31 @@ void Screen<Cell>::inspect(std::string const& _message, std::ostream& _os) const
     });
     hline();
     _state.imagePool.inspect(_os);
+    _os << fmt::format("cell extra pool      : {}\n", CellExtra::allocationStats());
+    _os << fmt::format("grapheme clusters    : {}\n", GraphemeCluster::stats());
+    _os << fmt::format("interned attributes  : {}\n", InternedGraphicsAttributes::stats());
+    _os << fmt::format("line buffer pool     : {}\n", InflatedLineBufferPool<Cell>::get().stats());
+    _os << fmt::format("PTY read size        : {} (max {})\n",
+                       crispy::humanReadableBytes(_terminal.ptyReadSize()),
+                       crispy::humanReadableBytes(_terminal.maxPtyReadSize()));
+    _os << fmt::format("PTY buffer objects   : {}\n", _terminal.ptyBufferPoolStats());
+    auto const textBufferUsage = grid().textBufferUsage();
+    _os << fmt::format("line text buffers    : {} referenced of {} pinned in {} buffer objects\n",
+                       crispy::humanReadableBytes(textBufferUsage.bytesReferenced),
+                       crispy::humanReadableBytes(textBufferUsage.bytesPinned),
+                       textBufferUsage.bufferObjects);
     hline();
+    auto const memoryStats = _terminal.memoryStats();
+    _os << fmt::format("Memory usage (this session): {}\n",
+                       crispy::humanReadableBytes(crispy::MemoryStats::totalBytes(memoryStats)));
+    for (auto const& stats: memoryStats)
+        _os << fmt::format("- {}\n", stats);
+    hline();
+    if (_state.sequenceProfiler)
+    {
+        _state.sequenceProfiler->inspect(_os);
+        hline();
+    }
 
     // TODO: print more useful debug information
     // - screen size
@@ -2760,7 +3017,7 @@ namespace impl
                                              Screen<Cell>& _screen,
                                              DynamicColorName _name)
         {
-            auto const& value = _seq.intermediateCharacters();
+            auto const& value = _seq.dataString();
             if (value == "?")
                 _screen.requestDynamicColor(_name);
             else if (auto color = parseColor(value); color.has_value())
@@ -2810,13 +3067,13 @@ namespace impl
         template <typename Cell>
         ApplyResult RCOLPAL(Sequence const& _seq, Screen<Cell>& _screen)
         {
-            if (_seq.intermediateCharacters().empty())
+            if (_seq.dataString().empty())
             {
                 _screen.colorPalette() = _screen.defaultColorPalette();
                 return ApplyResult::Ok;
             }
 
-            auto const index = crispy::to_integer<10, uint8_t>(_seq.intermediateCharacters());
+            auto const index = crispy::to_integer<10, uint8_t>(_seq.dataString());
             if (!index.has_value())
                 return ApplyResult::Invalid;
 
@@ -2828,7 +3085,7 @@ namespace impl
         ApplyResult SETCOLPAL(Sequence const& _seq, Terminal& _terminal)
         {
             bool const ok = queryOrSetColorPalette(
-                _seq.intermediateCharacters(),
+                _seq.dataString(),
                 [&](uint8_t index) {
                     auto const color = _terminal.colorPalette().palette.at(index);
                     _terminal.reply("\033]4;{};rgb:{:04x}/{:04x}/{:04x}\033\\",
@@ -2859,7 +3116,7 @@ namespace impl
         {
             // [read]  OSC 60 ST
             // [write] OSC 60 ; size ; regular ; bold ; italic ; bold italic ST
-            auto const& params = _seq.intermediateCharacters();
+            auto const& params = _seq.dataString();
             auto const splits = crispy::split(params, ';');
             auto const param = [&](unsigned _index) -> string_view {
                 if (_index < splits.size())
@@ -2899,7 +3156,7 @@ namespace impl
 
         ApplyResult setFont(Sequence const& _seq, Terminal& terminal)
         {
-            auto const& params = _seq.intermediateCharacters();
+            auto const& params = _seq.dataString();
             auto const splits = crispy::split(params, ';');
 
             if (splits.size() != 1)
@@ -2923,7 +3180,7 @@ namespace impl
         ApplyResult clipboard(Sequence const& _seq, Terminal& terminal)
         {
             // Only setting clipboard contents is supported, not reading.
-            auto const& params = _seq.intermediateCharacters();
+            auto const& params = _seq.dataString();
             if (auto const splits = crispy::split(params, ';'); splits.size() == 2 && splits[0] == "c")
             {
                 terminal.copyToClipboard(crispy::base64::decode(splits[1]));
@@ -2936,7 +3193,7 @@ namespace impl
         template <typename Cell>
         ApplyResult NOTIFY(Sequence const& _seq, Screen<Cell>& _screen)
         {
-            auto const& value = _seq.intermediateCharacters();
+            auto const& value = _seq.dataString();
             if (auto const splits = crispy::split(value, ';'); splits.size() == 3 && splits[0] == "notify")
             {
                 _screen.notify(string(splits[1]), string(splits[2]));
@@ -2946,10 +3203,35 @@ namespace impl
                 return ApplyResult::Unsupported;
         }
 
+        template <typename Cell>
+        ApplyResult SHELLINTEGRATION(Sequence const& _seq, Screen<Cell>& _screen)
+        {
+            // OSC 133 ; <command> [; <parameter>...] ST
+            auto const splits = crispy::split(_seq.dataString(), ';');
+            if (splits.empty() || splits[0].size() != 1)
+                return ApplyResult::Invalid;
+
+            switch (splits[0][0])
+            {
+                case 'A': _screen.beginCommandPrompt(); return ApplyResult::Ok;
+                case 'B': return ApplyResult::Ok; // command input follows the prompt, nothing to record
+                case 'C': _screen.beginCommandOutput(); return ApplyResult::Ok;
+                case 'D': {
+                    auto exitCode = optional<int> {};
+                    if (splits.size() > 1)
+                        if (auto const value = crispy::to_integer<10, unsigned>(splits[1]); value)
+                            exitCode = static_cast<int>(*value);
+                    _screen.endCommand(exitCode);
+                    return ApplyResult::Ok;
+                }
+                default: return ApplyResult::Unsupported;
+            }
+        }
+
         template <typename Cell>
         ApplyResult SETCWD(Sequence const& _seq, Screen<Cell>& _screen)
         {
-            string const& url = _seq.intermediateCharacters();
+            string const& url = _seq.dataString();
             _screen.setCurrentWorkingDirectory(url);
             return ApplyResult::Ok;
         }
@@ -2975,10 +3257,26 @@ namespace impl
             return ApplyResult::Ok;
         }
 
+        ApplyResult LATENCY(Sequence const& _seq, Terminal& terminal)
+        {
+            // CSI > Ps z
+            //
+            // Ps: 0 = report input latency statistics (default)
+            //     1 = report input latency statistics and reset them
+
+            auto const reset = _seq.param_or(0, 0);
+            if (reset != 0 && reset != 1)
+                return ApplyResult::Invalid;
+
+            terminal.reportInputLatency(reset == 1);
+
+            return ApplyResult::Ok;
+        }
+
         template <typename Cell>
         ApplyResult HYPERLINK(Sequence const& _seq, Screen<Cell>& _screen)
         {
-            auto const& value = _seq.intermediateCharacters();
+            auto const& value = _seq.dataString();
             // hyperlink_OSC ::= OSC '8' ';' params ';' URI
             // params := pair (':' pair)*
             // pair := TEXT '=' TEXT
@@ -3217,11 +3515,27 @@ void Screen<Cell>::processSequence(Sequence const& seq)
 
     _terminal.state().instructionCounter++;
     if (FunctionDefinition const* funcSpec = seq.functionDefinition(); funcSpec != nullptr)
-        applyAndLog(*funcSpec, seq);
+    {
+        if (auto* profiler = _state.sequenceProfiler.get(); profiler)
+            profiler->apply(*funcSpec, [&]() { applyAndLog(*funcSpec, seq); });
+        else
+            applyAndLog(*funcSpec, seq);
+    }
     else if (VTParserLog)
         VTParserLog()("Unknown VT sequence: {}", seq);
 }
 
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Screen<Cell>::applicationProgramCommand(string_view _command)
+{
+    _terminal.state().instructionCounter++;
+    if (auto const command = KittyGraphicsCommand::parse(_command); command)
+        kittyGraphics(*command);
+    else if (VTParserLog)
+        VTParserLog()("Unknown APC: {}", escape(_command.substr(0, 32)));
+}
+
 template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
 void Screen<Cell>::applyAndLog(FunctionDefinition const& _function, Sequence const& _seq)
@@ -3560,7 +3874,7 @@ ApplyResult Screen<Cell>::apply(FunctionDefinition const& function, Sequence con
         case XTREPORTCOLORS: _terminal.reportColorPaletteStack(); return ApplyResult::Ok;
         case XTSMGRAPHICS: return impl::XTSMGRAPHICS(seq, *this);
         case XTVERSION:
-            _terminal.reply(fmt::format("\033P>|{} {}\033\\", LIBTERMINAL_NAME, LIBTERMINAL_VERSION_STRING));
+            _terminal.reply("\033P>|" LIBTERMINAL_NAME " " LIBTERMINAL_VERSION_STRING "\033\\"sv);
             return ApplyResult::Ok;
         case DECSSDT: {
             // Changes the status line display type.
@@ -3586,17 +3900,21 @@ ApplyResult Screen<Cell>::apply(FunctionDefinition const& function, Sequence con
         case DECPS: _terminal.playSound(seq.parameters()); break;
         // OSC
         case SETTITLE:
-            //(not supported) ChangeIconTitle(seq.intermediateCharacters());
-            _terminal.setWindowTitle(seq.intermediateCharacters());
+            //(not supported) ChangeIconTitle(seq.dataString());
+            _terminal.setWindowTitle(seq.dataString());
             return ApplyResult::Ok;
         case SETICON: return ApplyResult::Ok; // NB: Silently ignore!
-        case SETWINTITLE: _terminal.setWindowTitle(seq.intermediateCharacters()); break;
+        case SETWINTITLE: _terminal.setWindowTitle(seq.dataString()); break;
         case SETXPROP: return ApplyResult::Unsupported;
         case SETCOLPAL: return impl::SETCOLPAL(seq, _terminal);
         case RCOLPAL: return impl::RCOLPAL(seq, *this);
         case SETCWD: return impl::SETCWD(seq, *this);
+        case SHELLINTEGRATION: return impl::SHELLINTEGRATION(seq, *this);
         case HYPERLINK: return impl::HYPERLINK(seq, *this);
         case XTCAPTURE: return impl::CAPTURE(seq, _terminal);
+        case XTLATENCY: return impl::LATENCY(seq, _terminal);
+        case XTCACHESTATS: _terminal.reportCacheStats(); break;
+        case XTMEMSTATS: _terminal.reportMemoryStats(); break;
         case COLORFG:
             return impl::setOrRequestDynamicColor(seq, *this, DynamicColorName::DefaultForegroundColor);
         case COLORBG:
@@ -3627,6 +3945,7 @@ ApplyResult Screen<Cell>::apply(FunctionDefinition const& function, Sequence con
         case STP: _state.sequencer.hookParser(hookSTP(seq)); break;
         case DECRQSS: _state.sequencer.hookParser(hookDECRQSS(seq)); break;
         case XTGETTCAP: _state.sequencer.hookParser(hookXTGETTCAP(seq)); break;
+        case TMUXCC: _state.sequencer.hookParser(hookTmuxControlMode(seq)); break;
 
         default: return ApplyResult::Unsupported;
     }
@@ -3670,11 +3989,160 @@ unique_ptr<ParserExtension> Screen<Cell>::hookSixel(Sequence const& _seq)
                                              clamp(_terminal.state().maxImageRegisterCount, 0u, 16384u))
             : _terminal.state().imageColorPalette);
 
-    return make_unique<SixelParser>(*sixelImageBuilder_, [this]() {
-        {
+    if (_terminal.state().progressiveSixel)
+    {
+        sixelTopLeft_ =
+            _terminal.isModeEnabled(DECMode::NoSixelScrolling) ? CellLocation {} : logicalCursorPosition();
+        sixelLinesCommitted_ = LineCount(0);
+        sixelScrolled_ = false;
+        sixelImageBuilder_->setBandCompletedHandler([this]() { commitSixelBands(false); });
+    }
+
+    auto finalizer = [this]() {
+        if (sixelImageBuilder_->takenRowCount() != 0)
+            commitSixelBands(true);
+        else
             sixelImage(sixelImageBuilder_->size(), std::move(sixelImageBuilder_->data()));
+    };
+
+    // Images displayed progressively are decoded as they are received, band by band.
+    if (!_terminal.state().progressiveSixel && _terminal.state().sixelDecoderThreads > 1)
+        return make_unique<ParallelSixelParser>(
+            *sixelImageBuilder_, _terminal.state().sixelDecoderThreads, std::move(finalizer));
+
+    return make_unique<SixelParser>(*sixelImageBuilder_, std::move(finalizer));
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Screen<Cell>::kittyGraphics(KittyGraphicsCommand _command)
+{
+    // Only the first chunk of a chunked transmission carries the keys, all others just the data.
+    // Chunks are decoded as they arrive, such that the base64 data is never held in full.
+    auto payload = string {};
+    if (kittyTransmission_ || (_command.more && _command.medium == 'd'))
+    {
+        if (!kittyTransmission_)
+        {
+            kittyTransmission_ = _command;
+            kittyTransmissionDecoder_ = {};
+            kittyTransmissionData_.clear();
         }
-    });
+        crispy::base64::decode(_command.payload, kittyTransmissionDecoder_, kittyTransmissionData_);
+        if (kittyTransmissionData_.size() > _state.maxImageSize.area() * 4)
+        {
+            replyKittyGraphics(*kittyTransmission_, "EFBIG:image data too large");
+            kittyTransmission_.reset();
+            kittyTransmissionData_.clear();
+            return;
+        }
+        if (_command.more)
+            return;
+        crispy::base64::finish(kittyTransmissionDecoder_, kittyTransmissionData_);
+        _command = *kittyTransmission_;
+        kittyTransmission_.reset();
+        payload = std::exchange(kittyTransmissionData_, string {});
+    }
+    else
+        payload = crispy::base64::decode(_command.payload);
+    _command.payload = {};
+
+    auto const imageName = fmt::format("kitty:{}", _command.imageId);
+    switch (_command.action)
+    {
+        case 't':
+        case 'T':
+        case 'q': {
+            if (Width(_command.width) > _state.maxImageSize.width
+                || Height(_command.height) > _state.maxImageSize.height)
+            {
+                replyKittyGraphics(_command, "EFBIG:image exceeds the maximum image size");
+                return;
+            }
+
+            // Files and shared memory objects are read directly by path or name,
+            // rather than having their pixels passed through the PTY.
+            auto pixels = _command.medium == 'd'
+                              ? toRGBA(_command, payload)
+                              : loadKittyImageData(_command, payload);
+            if (auto const* error = std::get_if<KittyGraphicsError>(&pixels))
+            {
+                replyKittyGraphics(_command, error->message);
+                return;
+            }
+            if (_command.action == 'q')
+            {
+                replyKittyGraphics(_command, "OK");
+                return;
+            }
+
+            auto image = uploadImage(ImageFormat::RGBA,
+                                     ImageSize { Width(_command.width), Height(_command.height) },
+                                     std::move(std::get<Image::Data>(pixels)));
+            if (_command.imageId)
+                _state.imagePool.link(imageName, image);
+            if (_command.action == 'T')
+                displayKittyImage(_command, std::move(image));
+            replyKittyGraphics(_command, "OK");
+            break;
+        }
+        case 'p':
+            if (auto image = _state.imagePool.findImageByName(imageName); image)
+            {
+                displayKittyImage(_command, std::move(image));
+                replyKittyGraphics(_command, "OK");
+            }
+            else
+                replyKittyGraphics(_command, "ENOENT:no such image");
+            break;
+        case 'd':
+            // Only the stored images can be deleted. Images already displayed stay in the grid.
+            if (_command.deleteWhat == 'i' || _command.deleteWhat == 'I')
+                _state.imagePool.unlink(imageName);
+            break;
+        default: replyKittyGraphics(_command, "EINVAL:unsupported action"); break;
+    }
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Screen<Cell>::displayKittyImage(KittyGraphicsCommand const& _command, shared_ptr<Image const> _image)
+{
+    auto const cellSize = _state.cellPixelSize;
+    auto const extent = GridSize {
+        _command.rows ? LineCount::cast_from(_command.rows)
+                      : LineCount::cast_from(ceilf(float(*_image->height()) / float(*cellSize.height))),
+        _command.columns ? ColumnCount::cast_from(_command.columns)
+                         : ColumnCount::cast_from(ceilf(float(*_image->width()) / float(*cellSize.width))),
+    };
+    auto const topLeft = logicalCursorPosition();
+    auto const imageSize = _image->size();
+    renderImage(std::move(_image),
+                topLeft,
+                extent,
+                PixelCoordinate {},
+                imageSize,
+                ImageAlignment::TopStart,
+                _command.rows || _command.columns ? ImageResize::ResizeToFit : ImageResize::NoResize,
+                true);
+
+    // Like kitty, leave the cursor right after the image or where it was.
+    if (_command.moveCursor)
+        moveCursorToColumn(topLeft.column + boxed_cast<ColumnOffset>(extent.columns));
+    else
+        moveCursorTo(topLeft.line, topLeft.column);
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Screen<Cell>::replyKittyGraphics(KittyGraphicsCommand const& _command, string_view _message)
+{
+    // As in kitty, only commands with an image ID are responded to, unless asked to be quiet.
+    auto const isOk = _message == "OK";
+    if (!_command.imageId || _command.quiet >= (isOk ? 1u : 2u))
+        return;
+
+    _terminal.reply("\033_Gi={};{}\033\\", _command.imageId, _message);
 }
 
 template <typename Cell>
@@ -3751,6 +4219,22 @@ unique_ptr<ParserExtension> Screen<Cell>::hookDECRQSS(Sequence const& /*_seq*/)
     });
 }
 
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+unique_ptr<ParserExtension> Screen<Cell>::hookTmuxControlMode(Sequence const& _seq)
+{
+    // DCS 1000 p ... ST
+    //           tmux control mode (tmux -CC), with all of its notifications in the data string.
+    if (_seq.param(0) != 1000)
+        return nullptr;
+
+    auto* events = _terminal.startTmuxControlMode();
+    if (!events)
+        return nullptr;
+
+    return make_unique<TmuxControlParser>(*events);
+}
+
 template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
 optional<CellLocation> Screen<Cell>::search(std::u32string_view searchText, CellLocation startPosition)
@@ -3760,20 +4244,26 @@ optional<CellLocation> Screen<Cell>::search(std::u32string_view searchText, Cell
     if (searchText.empty())
         return nullopt;
 
+    _grid.reflowDeferredLines();
+
     // First try match at start location.
     if (_grid.lineAt(startPosition.line).matchTextAt(searchText, startPosition.column))
         return startPosition;
 
     // Search reverse until found or exhausted.
+    auto const needle = LineSearchSignature::of(searchText);
     auto position = startPosition;
     while (position.line < boxed_cast<LineOffset>(_state.pageSize.lines))
     {
         Line<Cell> const& line = _grid.lineAt(position.line);
-        auto newColumn = line.search(searchText, position.column);
-        if (newColumn.has_value())
+        if (line.mayContain(needle))
         {
-            position.column = *newColumn;
-            return position; // new match found
+            auto newColumn = line.search(searchText, position.column);
+            if (newColumn.has_value())
+            {
+                position.column = *newColumn;
+                return position; // new match found
+            }
         }
 
         position.column = ColumnOffset(0);
@@ -3786,32 +4276,20 @@ template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
 optional<CellLocation> Screen<Cell>::searchReverse(std::u32string_view searchText, CellLocation startPosition)
 {
-    // TODO use LogicalLinesReverse to spawn logical lines for improving the search on wrapped lines.
+    return searchReverse(searchText, startPosition, historyLineCount() + _state.pageSize.lines);
+}
 
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+optional<CellLocation> Screen<Cell>::searchReverse(std::u32string_view searchText,
+                                                   CellLocation startPosition,
+                                                   LineCount maxLineCount)
+{
     if (searchText.empty())
         return nullopt;
 
-    // First try match at start location.
-    if (_grid.lineAt(startPosition.line).matchTextAt(searchText, startPosition.column))
-        return startPosition;
-
-    // Search reverse until found or exhausted.
-    auto position = startPosition;
-    while (position.line >= -boxed_cast<LineOffset>(historyLineCount()))
-    {
-        Line<Cell> const& line = _grid.lineAt(position.line);
-        auto newColumn = line.searchReverse(searchText, position.column);
-        if (newColumn != position.column)
-        {
-            position.column = newColumn;
-            return position; // new match found
-        }
-
-        position.column = boxed_cast<ColumnOffset>(pageSize().columns) - 1;
-        position.line--;
-    }
-
-    return nullopt;
+    _grid.reflowDeferredLines();
+    return terminal::searchReverse(std::as_const(_grid), searchText, startPosition, maxLineCount);
 }
 
 } // namespace terminal
@@ -20,6 +20,7 @@
 #include <terminal/Grid.h>
 #include <terminal/Hyperlink.h>
 #include <terminal/Image.h>
+#include <terminal/KittyGraphics.h>
 #include <terminal/Parser.h>
 #include <terminal/ScreenEvents.h>
 #include <terminal/TerminalState.h>
@@ -28,6 +29,7 @@
 
 #include <crispy/StrongLRUCache.h>
 #include <crispy/algorithm.h>
+#include <crispy/base64.h>
 #include <crispy/logstore.h>
 #include <crispy/size.h>
 #include <crispy/utils.h>
@@ -68,9 +70,12 @@ class ScreenBase: public SequenceHandler
     [[nodiscard]] virtual bool isLineEmpty(LineOffset line) const noexcept = 0;
     [[nodiscard]] virtual uint8_t cellWidthAt(CellLocation position) const noexcept = 0;
     [[nodiscard]] virtual LineCount historyLineCount() const noexcept = 0;
+    /// Reflows any scrollback lines at or below @p top whose reflow has been deferred on resize.
+    virtual void reflowDeferredLines(LineOffset top) = 0;
     [[nodiscard]] virtual HyperlinkId hyperlinkIdAt(CellLocation position) const noexcept = 0;
-    [[nodiscard]] virtual std::shared_ptr<HyperlinkInfo const> hyperlinkAt(
-        CellLocation pos) const noexcept = 0;
+    [[nodiscard]] virtual HyperlinkInfo const* hyperlinkAt(CellLocation pos) const noexcept = 0;
+    /// Returns the URL shown as plain text at the given position, if any.
+    [[nodiscard]] virtual std::optional<std::string> plainTextUrlAt(CellLocation pos) const = 0;
     virtual void inspect(std::string const& _message, std::ostream& _os) const = 0;
     virtual void moveCursorTo(LineOffset line, ColumnOffset column) = 0; // CUP
     virtual void updateCursorIterator() noexcept = 0;
@@ -79,6 +84,12 @@ class ScreenBase: public SequenceHandler
                                                              CellLocation startPosition) = 0;
     [[nodiscard]] virtual std::optional<CellLocation> searchReverse(std::u32string_view searchText,
                                                                     CellLocation startPosition) = 0;
+
+    /// Searches reverse like searchReverse(searchText, startPosition), but only looks at the
+    /// @p maxLineCount lines starting at the start position's line upwards.
+    [[nodiscard]] virtual std::optional<CellLocation> searchReverse(std::u32string_view searchText,
+                                                                    CellLocation startPosition,
+                                                                    LineCount maxLineCount) = 0;
 };
 
 /**
@@ -110,6 +121,7 @@ class Screen final: public ScreenBase, public capabilities::StaticDatabase
     void writeText(std::string_view _chars, size_t cellCount) override;
     void executeControlCode(char controlCode) override;
     void processSequence(Sequence const& seq) override;
+    void applicationProgramCommand(std::string_view _command) override;
     // }}}
 
     void writeTextFromExternal(std::string_view _chars);
@@ -121,6 +133,16 @@ class Screen final: public ScreenBase, public capabilities::StaticDatabase
         return _grid.render(std::forward<Renderer>(_render), _scrollOffset);
     }
 
+    /// Renders the given band of lines of the screen, see Grid::renderLines().
+    template <typename Renderer>
+    RenderPassHints renderLines(Renderer&& _render,
+                                ScrollOffset _scrollOffset,
+                                LineOffset _first,
+                                LineCount _count) const
+    {
+        return _grid.renderLines(std::forward<Renderer>(_render), _scrollOffset, _first, _count);
+    }
+
     /// Renders the full screen as text into the given string. Each line will be terminated by LF.
     [[nodiscard]] std::string renderMainPageText() const;
 
@@ -217,10 +239,24 @@ class Screen final: public ScreenBase, public capabilities::StaticDatabase
     void setCurrentWorkingDirectory(std::string const& _url); // OSC 7
 
     void hyperlink(std::string _id, std::string _uri);                   // OSC 8
+
+    // Shell integration, recording the primary screen's commands in its grid.
+    void beginCommandPrompt();                     // OSC 133;A
+    void beginCommandOutput();                     // OSC 133;C
+    void endCommand(std::optional<int> _exitCode); // OSC 133;D
     void notify(std::string const& _title, std::string const& _content); // OSC 777
 
+    /// Replies the bottom @p _lineCount lines as buffer capture, all chunks at once.
     void captureBuffer(LineCount _lineCount, bool _logicalLines);
 
+    /// Returns the top line of a buffer capture of the bottom @p _lineCount lines.
+    [[nodiscard]] LineOffset captureBufferTop(LineCount _lineCount, bool _logicalLines);
+
+    /// Replies the next chunk of a buffer capture, starting at @p _line.
+    ///
+    /// @returns the line to continue the capture at, or std::nullopt if the capture is complete.
+    std::optional<LineOffset> captureBufferChunk(LineOffset _line, bool _logicalLines);
+
     void setForegroundColor(Color _color);
     void setBackgroundColor(Color _color);
     void setUnderlineColor(Color _color);
@@ -385,6 +421,9 @@ class Screen final: public ScreenBase, public capabilities::StaticDatabase
                                                      CellLocation startPosition) override;
     [[nodiscard]] std::optional<CellLocation> searchReverse(std::u32string_view searchText,
                                                             CellLocation startPosition) override;
+    [[nodiscard]] std::optional<CellLocation> searchReverse(std::u32string_view searchText,
+                                                            CellLocation startPosition,
+                                                            LineCount maxLineCount) override;
 
     Cell& usePreviousCell() noexcept
     {
@@ -533,14 +572,13 @@ class Screen final: public ScreenBase, public capabilities::StaticDatabase
 
     [[nodiscard]] bool compareCellTextAt(CellLocation position, char codepoint) const noexcept override
     {
-        auto const& cell = grid().lineAt(position.line).inflatedBuffer().at(position.column.as<size_t>());
-        return CellUtil::compareText(cell, codepoint);
+        return grid().lineAt(position.line).compareCellTextAt(position.column, codepoint);
     }
 
-    // IMPORTANT: Invokig inflatedBuffer() is expensive. This function should be invoked with caution.
+    // IMPORTANT: This may inflate non-ASCII trivial lines. This function should be invoked with caution.
     [[nodiscard]] std::string cellTextAt(CellLocation position) const noexcept override
     {
-        return grid().lineAt(position.line).inflatedBuffer().at(position.column.as<size_t>()).toUtf8();
+        return grid().lineAt(position.line).cellTextAt(position.column);
     }
 
     [[nodiscard]] std::string lineTextAt(LineOffset line) const noexcept override
@@ -563,6 +601,8 @@ class Screen final: public ScreenBase, public capabilities::StaticDatabase
         return grid().historyLineCount();
     }
 
+    void reflowDeferredLines(LineOffset top) override { grid().reflowDeferredLines(top); }
+
     [[nodiscard]] HyperlinkId hyperlinkIdAt(CellLocation position) const noexcept override
     {
         auto const& line = grid().lineAt(position.line);
@@ -574,11 +614,23 @@ class Screen final: public ScreenBase, public capabilities::StaticDatabase
         return at(position).hyperlink();
     }
 
-    [[nodiscard]] std::shared_ptr<HyperlinkInfo const> hyperlinkAt(CellLocation pos) const noexcept override
+    [[nodiscard]] HyperlinkInfo const* hyperlinkAt(CellLocation pos) const noexcept override
     {
         return _state.hyperlinks.hyperlinkById(hyperlinkIdAt(pos));
     }
 
+    [[nodiscard]] std::optional<std::string> plainTextUrlAt(CellLocation pos) const override
+    {
+        auto const& line = grid().lineAt(pos.line);
+        auto const* url = line.plainTextUrlAt(pos.column);
+        if (!url)
+            return std::nullopt;
+        auto text = std::string {};
+        for (auto column = url->offset; column < url->offset + url->length; ++column)
+            text += line.cellTextAt(ColumnOffset::cast_from(column));
+        return text;
+    }
+
     [[nodiscard]] HyperlinkStorage const& hyperlinks() const noexcept
     {
         return _state.hyperlinks;
@@ -611,6 +663,23 @@ class Screen final: public ScreenBase, public capabilities::StaticDatabase
     /// @returns the string view of the UTF-8 text that could not be emplaced.
     std::string_view tryEmplaceChars(std::string_view chars, size_t cellCount) noexcept;
     size_t emplaceCharsIntoCurrentLine(std::string_view chars, size_t cellCount) noexcept;
+
+    /// Writes the given UTF-8 text, made of complete codepoints, at the cursor position.
+    ///
+    /// Runs of codepoints that each begin a new grapheme cluster are written into the current line
+    /// in one go, whereas everything else (grapheme cluster joins, zero-width codepoints, wrapping,
+    /// pending single shifts, and malformed UTF-8) is passed on to writeTextInternal() codepoint
+    /// by codepoint.
+    void writeTextBulk(std::string_view chars);
+
+    /// Writes the longest prefix of the given UTF-8 text into the current line whose codepoints each
+    /// begin a new grapheme cluster of width 1 or 2 and fit left of the right margin without wrapping.
+    ///
+    /// SGR, hyperlink, and character set are looked up once, as is the right margin, and the cursor
+    /// is updated once at the end.
+    ///
+    /// @returns the number of bytes written.
+    size_t writeCodepointsIntoCurrentLine(std::string_view chars) noexcept;
     [[nodiscard]] bool isContiguousToCurrentLine(std::string_view continuationChars) const noexcept;
     void advanceCursorAfterWrite(ColumnCount n) noexcept;
 
@@ -635,8 +704,19 @@ class Screen final: public ScreenBase, public capabilities::StaticDatabase
 
     [[nodiscard]] std::unique_ptr<ParserExtension> hookSTP(Sequence const& seq);
     [[nodiscard]] std::unique_ptr<ParserExtension> hookSixel(Sequence const& seq);
+
+    /// Places the sixel bands completed so far of the image currently being received onto the grid.
+    ///
+    /// @param _final whether the image has been received completely, in which case all its remaining
+    ///               rows are placed and the text cursor is moved past the image.
+    void commitSixelBands(bool _final);
     [[nodiscard]] std::unique_ptr<ParserExtension> hookDECRQSS(Sequence const& seq);
     [[nodiscard]] std::unique_ptr<ParserExtension> hookXTGETTCAP(Sequence const& seq);
+    [[nodiscard]] std::unique_ptr<ParserExtension> hookTmuxControlMode(Sequence const& seq);
+
+    void kittyGraphics(KittyGraphicsCommand _command);
+    void displayKittyImage(KittyGraphicsCommand const& _command, std::shared_ptr<Image const> _image);
+    void replyKittyGraphics(KittyGraphicsCommand const& _command, std::string_view _message);
 
     Terminal& _terminal;
     TerminalState& _state;
@@ -645,6 +725,16 @@ class Screen final: public ScreenBase, public capabilities::StaticDatabase
     Line<Cell>* _currentLine = nullptr;
 #endif
     std::unique_ptr<SixelImageBuilder> sixelImageBuilder_;
+
+    // State of the sixel image being displayed progressively while it is being received.
+    CellLocation sixelTopLeft_;
+    LineCount sixelLinesCommitted_;
+    bool sixelScrolled_ = false;
+
+    // Chunked direct kitty graphics transmission currently being received.
+    std::optional<KittyGraphicsCommand> kittyTransmission_;
+    crispy::base64::DecoderState kittyTransmissionDecoder_;
+    std::string kittyTransmissionData_; // decoded pixels received so far
 };
 
 template <typename Cell>
@@ -106,6 +106,8 @@ struct TextRenderBuilder
     void renderCell(PrimaryScreenCell const& cell, LineOffset lineOffset, ColumnOffset columnOffset);
     void endLine();
     void renderTrivialLine(TrivialLineBuffer const& lineBuffer, LineOffset lineOffset);
+    void renderAttributedLine(AttributedLineBuffer const& lineBuffer, LineOffset lineOffset);
+    void renderImage(ImagePlacement const&, LineOffset) {}
     void finish();
 };
 
@@ -134,10 +136,31 @@ void TextRenderBuilder::renderTrivialLine(TrivialLineBuffer const& lineBuffer, L
     text += '\n';
 }
 
+void TextRenderBuilder::renderAttributedLine(AttributedLineBuffer const& lineBuffer, LineOffset lineOffset)
+{
+    if (!*lineOffset)
+        text.clear();
+
+    text += lineBuffer.text;
+    text += '\n';
+}
+
 void TextRenderBuilder::finish()
 {
 }
 
+/// Returns the image displayed in the given cell, as a placement of just that cell.
+template <typename T>
+optional<ImagePlacement> imageAt(Screen<T> const& screen, LineOffset line, ColumnOffset column)
+{
+    auto const* placement = screen.grid().lineAt(line).imagePlacementAt(column);
+    if (!placement)
+        return nullopt;
+    auto const offset = CellLocation { placement->offset.line,
+                                       placement->offset.column + (column - placement->column) };
+    return ImagePlacement { placement->image, column, ColumnCount(1), offset };
+}
+
 MockTerm<MockPty> screenForDECRA()
 {
     return MockTerm<MockPty> { PageSize { LineCount(5), ColumnCount(6) }, {}, 1024, [](auto& mock) {
@@ -343,6 +366,62 @@ TEST_CASE("writeText.bulk.H", "[screen]")
     CHECK(screen.cursor().position == CellLocation { LineOffset(1), ColumnOffset(9) });
 }
 
+// Non-ASCII text written into a line that is not trivial anymore, with grapheme cluster joins in between.
+TEST_CASE("writeText.bulk.Unicode", "[screen]")
+{
+    auto mock = MockTerm { PageSize { LineCount(2), ColumnCount(10) }, LineCount(1) };
+    auto& screen = mock.terminal.primaryScreen();
+    mock.writeToScreen("ABCDEFGH\r");
+    mock.writeToScreen(U"\u00E4\u4E2De\u0301\u6587");
+    logScreenText(screen, "final state");
+
+    CHECK(screen.at(LineOffset(0), ColumnOffset(0)).codepoints() == U"\u00E4");
+    CHECK(screen.at(LineOffset(0), ColumnOffset(1)).codepoints() == U"\u4E2D");
+    CHECK(screen.at(LineOffset(0), ColumnOffset(1)).width() == 2);
+    CHECK(screen.at(LineOffset(0), ColumnOffset(2)).codepointCount() == 0);
+    CHECK(screen.at(LineOffset(0), ColumnOffset(3)).codepoints() == U"e\u0301");
+    CHECK(screen.at(LineOffset(0), ColumnOffset(4)).codepoints() == U"\u6587");
+    CHECK(screen.at(LineOffset(0), ColumnOffset(6)).codepoints() == U"G");
+    CHECK(screen.cursor().position == CellLocation { LineOffset(0), ColumnOffset(6) });
+
+    // A combining character at the beginning of the text joins the last written grapheme cluster.
+    mock.writeToScreen(U"\u0308x");
+    CHECK(screen.at(LineOffset(0), ColumnOffset(4)).codepoints() == U"\u6587\u0308");
+    CHECK(screen.at(LineOffset(0), ColumnOffset(6)).codepoints() == U"x");
+    CHECK(screen.cursor().position == CellLocation { LineOffset(0), ColumnOffset(7) });
+}
+
+// Text written with the DEC Special Graphics character set selected.
+TEST_CASE("writeText.bulk.Charset", "[screen]")
+{
+    auto mock = MockTerm { PageSize { LineCount(2), ColumnCount(10) }, LineCount(1) };
+    auto& screen = mock.terminal.primaryScreen();
+    mock.writeToScreen("\033(0");
+    mock.writeToScreen("lqqk");
+    mock.writeToScreen("\033(B");
+    mock.writeToScreen("ok");
+    logScreenText(screen, "final state");
+
+    CHECK(screen.grid().lineText(LineOffset(0)) == "┌──┐ok    ");
+    CHECK(screen.cursor().position == CellLocation { LineOffset(0), ColumnOffset(6) });
+}
+
+// Text written within left/right margins wraps at the right margin.
+TEST_CASE("writeText.bulk.Margins", "[screen]")
+{
+    auto mock = MockTerm { PageSize { LineCount(3), ColumnCount(10) }, LineCount(1) };
+    auto& screen = mock.terminal.primaryScreen();
+    mock.writeToScreen("\033[?69h"); // DECLRMM
+    mock.writeToScreen("\033[3;6s"); // DECSLRM
+    mock.writeToScreen("\033[1;3H");
+    mock.writeToScreen("abcdef");
+    logScreenText(screen, "final state");
+
+    CHECK(screen.grid().lineText(LineOffset(0)) == "  abcd    ");
+    CHECK(screen.grid().lineText(LineOffset(1)) == "  ef      ");
+    CHECK(screen.cursor().position == CellLocation { LineOffset(1), ColumnOffset(4) });
+}
+
 // TODO: Test spanning writes over all history and then reusing old lines.
 // Verify we do not leak any old cell attribs.
 
@@ -2669,6 +2748,23 @@ TEST_CASE("captureBuffer", "[screen]")
     }
 }
 
+TEST_CASE("captureBuffer.continued", "[screen]")
+{
+    auto mock = MockTerm { PageSize { LineCount(2), ColumnCount(5) }, LineCount { 5 } };
+    mock.writeToScreen("12345\r\n67890\r\nABCDE\r\nFGHIJ\r\nKLMNO");
+
+    mock.terminal.startCaptureBuffer(LineCount(3), false);
+
+    // Scrolling while the capture is in progress does not shift the captured lines.
+    mock.writeToScreen("\r\nPQRST");
+    while (mock.terminal.continueCaptureBuffer())
+        ;
+
+    INFO(e(mock.terminal.peekInput()));
+    CHECK(e(mock.terminal.peekInput()) == e("\033^314;ABCDE\nFGHIJ\nKLMNO\nPQRST\n\033\\\033^314;\033\\"));
+    CHECK_FALSE(mock.terminal.continueCaptureBuffer());
+}
+
 TEST_CASE("render into history", "[screen]")
 {
     auto mock = MockTerm { PageSize { LineCount(2), ColumnCount(5) }, LineCount { 5 } };
@@ -2923,6 +3019,26 @@ TEST_CASE("CursorBackwardTab.manualTabs", "[screen]")
     }
 }
 
+TEST_CASE("writeText.attributeRuns", "[screen]")
+{
+    auto mock = MockTerm { PageSize { LineCount(2), ColumnCount(16) } };
+    mock.writeToScreen("ls \033[1;34mdir\033[0m/ \033[32mrun.sh\033[0m");
+
+    auto& screen = mock.terminal.primaryScreen();
+    auto const& line = screen.grid().lineAt(LineOffset(0));
+    REQUIRE(line.isAttributedBuffer());
+    CHECK(line.attributedBuffer().runs.size() == 4);
+    CHECK(screen.renderMainPageText() == "ls dir/ run.sh  \n                \n");
+    CHECK(screen.cursor().position == CellLocation { LineOffset(0), ColumnOffset(14) });
+
+    // Writing anywhere but behind the text inflates the line.
+    mock.writeToScreen("\033[1;1HL");
+    CHECK(screen.grid().lineAt(LineOffset(0)).isInflatedBuffer());
+    CHECK(screen.grid().lineText(LineOffset(0)) == "Ls dir/ run.sh  ");
+    CHECK(screen.at(LineOffset(0), ColumnOffset(3)).isFlagEnabled(CellFlags::Bold));
+    CHECK(!screen.at(LineOffset(0), ColumnOffset(6)).isFlagEnabled(CellFlags::Bold));
+}
+
 TEST_CASE("searchReverse", "[screen]")
 {
     auto mock = MockTerm { PageSize { LineCount(3), ColumnCount(4) }, LineCount(10) };
@@ -3141,6 +3257,39 @@ TEST_CASE("findMarkerUpwards", "[screen]")
     }
 }
 
+TEST_CASE("OSC.133.ShellIntegration", "[screen]")
+{
+    auto mock = MockTerm { PageSize { LineCount(4), ColumnCount(10) }, LineCount(10) };
+    auto& screen = mock.terminal.primaryScreen();
+
+    // The end of a command is reported before every prompt, including the first one.
+    mock.writeToScreen("\033]133;D;0\033\\\033]133;A\033\\$ false\r\n\033]133;C\033\\");
+    mock.writeToScreen("\033]133;D;1\033\\\033]133;A\033\\$ ls\r\n\033]133;C\033\\a\r\nb\r\n");
+    mock.writeToScreen("\033]133;D;0\033\\\033]133;A\033\\$ ");
+
+    REQUIRE(screen.grid().lineText(LineOffset(-1)) == "$ false   ");
+    REQUIRE(screen.grid().lineText(LineOffset(0)) == "$ ls      ");
+    REQUIRE(screen.grid().lineText(LineOffset(3)) == "$         ");
+
+    auto const& commands = screen.grid().commands();
+    REQUIRE(commands.size() == 3);
+    CHECK(commands[0].exitCode == 1);
+    CHECK(commands[1].exitCode == 0);
+    CHECK(!commands[2].outputStart.has_value());
+
+    auto const output = screen.grid().lastCommandOutput();
+    REQUIRE(output.has_value());
+    CHECK(output->from.value == 1);
+    CHECK(output->to.value == 2);
+    CHECK(mock.terminal.extractLastCommandOutput() == "a\nb\n");
+
+    CHECK(screen.grid().findFailedCommandAbove(LineOffset(3)) == LineOffset(-1));
+    CHECK_FALSE(screen.grid().findFailedCommandAbove(LineOffset(-1)).has_value());
+
+    // Prompts are marked as well.
+    CHECK(screen.findMarkerUpwards(LineOffset(3)) == LineOffset(0));
+}
+
 TEST_CASE("DECTABSR", "[screen]")
 {
     auto mock = MockTerm { PageSize { LineCount(2), ColumnCount(35) } };
@@ -3195,6 +3344,37 @@ TEST_CASE("save_restore_DEC_modes", "[screen]")
     CHECK_FALSE(mock.terminal.isModeEnabled(DECMode::MouseProtocolHighlightTracking));
 }
 
+TEST_CASE("save_restore_DEC_modes.nested", "[screen]")
+{
+    auto mock = MockTerm { PageSize { LineCount(2), ColumnCount(2) } };
+    auto& screen = mock.terminal.primaryScreen();
+    auto const modes = vector { DECMode::Origin, DECMode::SixelCursorNextToGraphic };
+
+    mock.terminal.setMode(DECMode::Origin, true);
+    mock.terminal.setMode(DECMode::SixelCursorNextToGraphic, false);
+    screen.saveModes(modes);
+
+    mock.terminal.setMode(DECMode::Origin, false);
+    mock.terminal.setMode(DECMode::SixelCursorNextToGraphic, true);
+    screen.saveModes(modes);
+
+    mock.terminal.setMode(DECMode::Origin, true);
+    mock.terminal.setMode(DECMode::SixelCursorNextToGraphic, false);
+
+    screen.restoreModes(modes);
+    CHECK_FALSE(mock.terminal.isModeEnabled(DECMode::Origin));
+    CHECK(mock.terminal.isModeEnabled(DECMode::SixelCursorNextToGraphic));
+
+    screen.restoreModes(modes);
+    CHECK(mock.terminal.isModeEnabled(DECMode::Origin));
+    CHECK_FALSE(mock.terminal.isModeEnabled(DECMode::SixelCursorNextToGraphic));
+
+    // Nothing left to restore.
+    screen.restoreModes(modes);
+    CHECK(mock.terminal.isModeEnabled(DECMode::Origin));
+    CHECK_FALSE(mock.terminal.isModeEnabled(DECMode::SixelCursorNextToGraphic));
+}
+
 TEST_CASE("OSC.2.Unicode")
 {
     auto mock = MockTerm { PageSize { LineCount(2), ColumnCount(2) } };
@@ -3207,6 +3387,19 @@ TEST_CASE("OSC.2.Unicode")
     CHECK(e(mock.windowTitle) == e(title));
 }
 
+TEST_CASE("OSC.2.long")
+{
+    auto mock = MockTerm { PageSize { LineCount(2), ColumnCount(2) } };
+
+    auto const title = std::string(2000, 'T');
+    mock.writeToScreen(fmt::format("\033]2;{}\033\\", title));
+    CHECK(mock.windowTitle == title);
+
+    // Payloads beyond the maximum OSC length are truncated.
+    mock.writeToScreen(fmt::format("\033]2;{}\033\\", std::string(Sequence::MaxOscLength + 10, 'U')));
+    CHECK(mock.windowTitle.size() == Sequence::MaxOscLength - 2);
+}
+
 TEST_CASE("OSC.4")
 {
     auto mock = MockTerm { PageSize { LineCount(2), ColumnCount(2) } };
@@ -3248,9 +3441,7 @@ TEST_CASE("XTGETTCAP")
     auto mock = MockTerm { PageSize { LineCount(2), ColumnCount(2) } };
     auto const queryStr = fmt::format("\033P+q{:02X}{:02X}{:02X}\033\\", 'R', 'G', 'B');
     mock.writeToScreen(queryStr);
-    INFO(fmt::format("Reply data: {}", mock.terminal.peekInput()));
-    // "\033P1+r8/8/8\033\\"
-    // TODO: CHECK(...)
+    REQUIRE(e(mock.terminal.peekInput()) == e("\033P1+r524742=382F382F38\033\\"));
 }
 
 TEST_CASE("setMaxHistoryLineCount", "[screen]")
@@ -3531,11 +3722,11 @@ TEST_CASE("Sixel.simple", "[screen]")
             auto const& cell = mock.terminal.primaryScreen().at(line, column);
             if (line <= LineOffset(4) && column <= ColumnOffset(7))
             {
-                auto fragment = cell.imageFragment();
-                REQUIRE(fragment);
-                CHECK(fragment->offset().line == line);
-                CHECK(fragment->offset().column == column);
-                CHECK(fragment->data().size() != 0);
+                auto const image = imageAt(mock.terminal.primaryScreen(), line, column);
+                REQUIRE(image);
+                CHECK(image->offset.line == line);
+                CHECK(image->offset.column == column);
+                CHECK(image->image->fragment(image->offset).size() != 0);
             }
             else
             {
@@ -3544,6 +3735,15 @@ TEST_CASE("Sixel.simple", "[screen]")
         }
     }
 
+    // Each line displays its row of the image by a single placement rather than by each of its cells.
+    for (auto line = LineOffset(0); line <= LineOffset(4); ++line)
+    {
+        auto const placements = mock.terminal.primaryScreen().grid().lineAt(line).imagePlacements();
+        REQUIRE(placements.size() == 1);
+        CHECK(placements[0].column == ColumnOffset(0));
+        CHECK(placements[0].columns == ColumnCount(8));
+    }
+
     // Um, we could actually test more precise here by validating the grid cell contents.
 }
 
@@ -3571,11 +3771,11 @@ TEST_CASE("Sixel.AutoScroll-1", "[screen]")
             auto const& cell = mock.terminal.primaryScreen().at(line, column);
             if (line <= LineOffset(4) && column <= ColumnOffset(7))
             {
-                auto fragment = cell.imageFragment();
-                REQUIRE(fragment);
-                CHECK(fragment->offset().line == line + 1);
-                CHECK(fragment->offset().column == column);
-                CHECK(fragment->data().size() != 0);
+                auto const image = imageAt(mock.terminal.primaryScreen(), line, column);
+                REQUIRE(image);
+                CHECK(image->offset.line == line + 1);
+                CHECK(image->offset.column == column);
+                CHECK(image->image->fragment(image->offset).size() != 0);
             }
             else
             {
@@ -3587,6 +3787,71 @@ TEST_CASE("Sixel.AutoScroll-1", "[screen]")
     // Um, we could actually test more precise here by validating the grid cell contents.
 }
 
+TEST_CASE("Sixel.progressive", "[screen]")
+{
+    auto const pageSize = PageSize { LineCount(10), ColumnCount(10) };
+    auto mock = MockTerm { pageSize, LineCount(10) };
+    mock.terminal.setCellPixelSize(ImageSize { Width(10), Height(10) });
+    mock.terminal.setProgressiveSixel(true);
+
+    auto const sixelData = crispy::readFileAsString("./test/images/squirrel-50.sixel");
+
+    // The top of the image is displayed already while the rest is still being received.
+    mock.writeToScreen(string_view(sixelData).substr(0, sixelData.size() / 2));
+    CHECK(imageAt(mock.terminal.primaryScreen(), LineOffset(0), ColumnOffset(0)));
+    CHECK(!imageAt(mock.terminal.primaryScreen(), LineOffset(4), ColumnOffset(0)));
+
+    mock.writeToScreen(string_view(sixelData).substr(sixelData.size() / 2));
+
+    CHECK(mock.terminal.primaryScreen().cursor().position.column == ColumnOffset(0));
+    CHECK(mock.terminal.primaryScreen().cursor().position.line == LineOffset(5));
+
+    for (auto line = LineOffset(0); line < boxed_cast<LineOffset>(pageSize.lines); ++line)
+    {
+        for (auto column = ColumnOffset(0); column < boxed_cast<ColumnOffset>(pageSize.columns); ++column)
+        {
+            auto const& cell = mock.terminal.primaryScreen().at(line, column);
+            if (line <= LineOffset(4) && column <= ColumnOffset(7))
+            {
+                // Each grid line of this image has been received as a band of its own.
+                auto const image = imageAt(mock.terminal.primaryScreen(), line, column);
+                REQUIRE(image);
+                CHECK(image->offset.line == LineOffset(0));
+                CHECK(image->offset.column == column);
+                CHECK(image->image->fragment(image->offset).size() != 0);
+            }
+            else
+            {
+                CHECK(cell.empty());
+            }
+        }
+    }
+}
+
+TEST_CASE("KittyGraphics.transmit_and_display", "[screen]")
+{
+    auto mock = MockTerm { PageSize { LineCount(4), ColumnCount(10) }, LineCount(5) };
+    mock.terminal.setCellPixelSize(ImageSize { Width(10), Height(10) });
+
+    // A 1x1 RGBA image, sent base64 encoded in two chunks.
+    mock.writeToScreen("\033_Ga=T,f=32,s=1,v=1,i=7,m=1;AQID\033\\");
+    CHECK(!imageAt(mock.terminal.primaryScreen(), LineOffset(0), ColumnOffset(0)));
+    mock.writeToScreen("\033_Gm=0;BA==\033\\");
+
+    CHECK(e(mock.terminal.peekInput()) == e("\033_Gi=7;OK\033\\"));
+    CHECK(mock.terminal.primaryScreen().cursor().position == CellLocation { LineOffset(0), ColumnOffset(1) });
+
+    auto const image = imageAt(mock.terminal.primaryScreen(), LineOffset(0), ColumnOffset(0));
+    REQUIRE(image);
+    CHECK(*image->image->image().data() == Image::Data { 1, 2, 3, 4 });
+
+    // Display the stored image once more without moving the cursor.
+    mock.writeToScreen("\033_Ga=p,i=7,C=1,q=1\033\\");
+    CHECK(e(mock.terminal.peekInput()) == e("\033_Gi=7;OK\033\\")); // nothing new, as asked to be quiet
+    CHECK(imageAt(mock.terminal.primaryScreen(), LineOffset(0), ColumnOffset(1)));
+    CHECK(mock.terminal.primaryScreen().cursor().position == CellLocation { LineOffset(0), ColumnOffset(1) });
+}
+
 // TODO: Sixel: image that exceeds available lines
 
 // TODO: SetForegroundColor
@@ -39,13 +39,17 @@ std::string Sequence::raw() const
         }
     }
 
-    sstr << intermediateCharacters();
+    sstr << intermediateCharacters().view();
 
     if (finalChar_)
         sstr << finalChar_;
 
     if (!dataString_.empty())
+    {
+        if (category_ == FunctionCategory::OSC)
+            sstr << ';';
         sstr << dataString_ << "\033\\";
+    }
 
     return sstr.str();
 }
@@ -63,7 +67,7 @@ string Sequence::text() const
         sstr << ' ' << parameters_.str();
 
     if (!intermediateCharacters().empty())
-        sstr << ' ' << intermediateCharacters();
+        sstr << ' ' << intermediateCharacters().view();
 
     if (finalChar_)
         sstr << ' ' << finalChar_;
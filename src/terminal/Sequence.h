@@ -21,6 +21,7 @@
 #include <gsl/span>
 
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <iterator>
 #include <memory>
@@ -203,16 +204,62 @@ class SequenceParameterBuilder
     Storage::iterator _currentParameter;
 };
 
+/// Intermediate characters of a VT sequence.
+///
+/// Sequences carry at most a few intermediate characters, so they are stored inline rather than
+/// in a heap allocated string. Characters exceeding the capacity are dropped.
+class SequenceIntermediates
+{
+  public:
+    static constexpr size_t Capacity = 7;
+
+    [[nodiscard]] constexpr size_t size() const noexcept { return size_; }
+    [[nodiscard]] constexpr bool empty() const noexcept { return size_ == 0; }
+    [[nodiscard]] constexpr char operator[](size_t i) const noexcept { return chars_[i]; }
+
+    constexpr void clear() noexcept { size_ = 0; }
+
+    constexpr void push_back(char _char) noexcept
+    {
+        if (size_ < Capacity)
+            chars_[size_++] = _char;
+    }
+
+    constexpr SequenceIntermediates& operator=(std::string_view _chars) noexcept
+    {
+        size_ = static_cast<uint8_t>(std::min(_chars.size(), Capacity));
+        std::copy_n(_chars.data(), size_, chars_.data());
+        return *this;
+    }
+
+    [[nodiscard]] constexpr std::string_view view() const noexcept { return { chars_.data(), size_ }; }
+    constexpr operator std::string_view() const noexcept { return view(); }
+
+  private:
+    std::array<char, Capacity> chars_ {};
+    uint8_t size_ = 0;
+};
+
 /**
  * Helps constructing VT functions as they're being parsed by the VT parser.
  */
 class Sequence
 {
   public:
-    size_t constexpr static MaxOscLength = 512;
+    /// Largest OSC string accepted, large enough for OSC 52 clipboard transfers.
+    size_t constexpr static MaxOscLength = 64 * 1024;
+
+    /// Capacity of the data string that is kept for reuse by the following sequences.
+    ///
+    /// A data string that has grown beyond this (such as by a clipboard transfer) is released
+    /// when the sequence is cleared, so that a single large payload does not stay resident.
+    size_t constexpr static RetainedDataStringCapacity = 4096;
+
+    /// Largest APC string accepted, large enough for unchunked direct image transmissions.
+    size_t constexpr static MaxApcLength = 16 * 1024 * 1024;
 
     using Parameter = uint16_t;
-    using Intermediaries = std::string;
+    using Intermediaries = SequenceIntermediates;
     using DataString = std::string;
     using Parameters = SequenceParameters;
 
@@ -251,7 +298,10 @@ class Sequence
         leaderSymbol_ = 0;
         intermediateCharacters_.clear();
         finalChar_ = 0;
-        dataString_.clear();
+        if (dataString_.capacity() > RetainedDataStringCapacity)
+            DataString {}.swap(dataString_);
+        else
+            dataString_.clear();
     }
 
     void setCategory(FunctionCategory _cat) noexcept { category_ = _cat; }
@@ -282,9 +332,8 @@ class Sequence
                 };
             default: {
                 // Only support CSI sequences with 0 or 1 intermediate characters.
-                char const intermediate = intermediateCharacters_.size() == 1
-                                              ? static_cast<char>(intermediateCharacters_[0])
-                                              : char {};
+                char const intermediate =
+                    intermediateCharacters_.size() == 1 ? intermediateCharacters_[0] : char {};
 
                 return FunctionSelector {
                     category_, leaderSymbol_, static_cast<int>(parameterCount()), intermediate, finalChar_
@@ -371,6 +420,7 @@ class SequenceHandler
     virtual void processSequence(Sequence const& sequence) = 0;
     virtual void writeText(char32_t codepoint) = 0;
     virtual void writeText(std::string_view codepoints, size_t cellCount) = 0;
+    virtual void applicationProgramCommand(std::string_view command) = 0;
 };
 
 } // namespace terminal
@@ -0,0 +1,82 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/SequenceProfiler.h>
+
+#include <crispy/utils.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+
+namespace terminal
+{
+
+SequenceProfiler::FunctionStats const* SequenceProfiler::stats(
+    FunctionDefinition const& _function) const noexcept
+{
+    if (auto const i = functions_.find(_function.id()); i != functions_.end())
+        return &i->second;
+    return nullptr;
+}
+
+std::vector<SequenceProfiler::FunctionStats> SequenceProfiler::functions() const
+{
+    auto result = std::vector<FunctionStats> {};
+    result.reserve(functions_.size());
+    for (auto const& [id, stats]: functions_)
+        result.push_back(stats);
+
+    std::sort(result.begin(), result.end(), [](FunctionStats const& a, FunctionStats const& b) {
+        if (a.estimatedTime() != b.estimatedTime())
+            return a.estimatedTime() > b.estimatedTime();
+        return a.count > b.count;
+    });
+    return result;
+}
+
+void SequenceProfiler::reset()
+{
+    functions_.clear();
+    sequenceCount_ = 0;
+    textRuns_ = 0;
+    textBytes_ = 0;
+    inputBytes_ = 0;
+}
+
+void SequenceProfiler::inspect(std::ostream& _os) const
+{
+    _os << fmt::format("VT sequence profile  : {} input, {} text in {} runs, {} control sequences\n",
+                       crispy::humanReadableBytes(static_cast<long double>(inputBytes_)),
+                       crispy::humanReadableBytes(static_cast<long double>(textBytes_)),
+                       textRuns_,
+                       crispy::humanReadableBytes(static_cast<long double>(controlBytes())));
+    _os << fmt::format("  {:<8} {:<16} {:>12} {:>14}  {}\n",
+                       "Function",
+                       "Sequence",
+                       "Count",
+                       "Time (us)",
+                       "Description");
+    for (FunctionStats const& stats: functions())
+        _os << fmt::format("  {:<8} {:<16} {:>12} {:>14}  {}\n",
+                           stats.function->mnemonic,
+                           fmt::format("{}", *stats.function),
+                           stats.count,
+                           duration_cast<microseconds>(stats.estimatedTime()).count(),
+                           stats.function->comment);
+}
+
+} // namespace terminal
@@ -0,0 +1,110 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <terminal/Functions.h>
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+namespace terminal
+{
+
+/// Profiles the VT sequences applied to the screen, telling which of them dominate a workload.
+///
+/// Each VT function is counted, whereas only every SampleInterval-th sequence is timed, which keeps
+/// the overhead of reading the clock low. The input bytes are split up into text and control
+/// sequences (including C0 control codes).
+///
+/// The profiler is opt-in (see Terminal::setSequenceProfiling()) and only used on the terminal thread.
+class SequenceProfiler
+{
+  public:
+    static constexpr uint64_t SampleInterval = 16;
+
+    struct FunctionStats
+    {
+        FunctionDefinition const* function = nullptr;
+        uint64_t count = 0;
+        uint64_t sampledCount = 0;
+        std::chrono::nanoseconds sampledTime {};
+
+        /// @returns the time spent on all invocations, extrapolated from the sampled ones.
+        [[nodiscard]] std::chrono::nanoseconds estimatedTime() const noexcept
+        {
+            if (!sampledCount)
+                return {};
+            return sampledTime * count / sampledCount;
+        }
+    };
+
+    /// Applies the given VT function by invoking @p _apply, timing it if it is sampled.
+    template <typename F>
+    void apply(FunctionDefinition const& _function, F&& _apply)
+    {
+        auto& stats = functions_[_function.id()];
+        stats.function = &_function;
+        ++stats.count;
+
+        if (++sequenceCount_ % SampleInterval != 0)
+        {
+            _apply();
+            return;
+        }
+
+        auto const start = std::chrono::steady_clock::now();
+        _apply();
+        stats.sampledTime += std::chrono::steady_clock::now() - start;
+        ++stats.sampledCount;
+    }
+
+    /// Records the bytes of a text run written to the screen.
+    void recordText(size_t _bytes) noexcept
+    {
+        ++textRuns_;
+        textBytes_ += _bytes;
+    }
+
+    /// Records the bytes about to be parsed, i.e. text and control sequences.
+    void recordInput(size_t _bytes) noexcept { inputBytes_ += _bytes; }
+
+    [[nodiscard]] uint64_t textRuns() const noexcept { return textRuns_; }
+    [[nodiscard]] uint64_t textBytes() const noexcept { return textBytes_; }
+    [[nodiscard]] uint64_t inputBytes() const noexcept { return inputBytes_; }
+    [[nodiscard]] uint64_t controlBytes() const noexcept
+    {
+        return inputBytes_ > textBytes_ ? inputBytes_ - textBytes_ : 0;
+    }
+
+    /// @returns the stats of the given function, or nullptr if it has not been applied yet.
+    [[nodiscard]] FunctionStats const* stats(FunctionDefinition const& _function) const noexcept;
+
+    /// @returns the stats of all applied functions, ordered by their estimated time (most first).
+    [[nodiscard]] std::vector<FunctionStats> functions() const;
+
+    void reset();
+    void inspect(std::ostream& _os) const;
+
+  private:
+    std::unordered_map<FunctionDefinition::id_type, FunctionStats> functions_;
+    uint64_t sequenceCount_ = 0;
+    uint64_t textRuns_ = 0;
+    uint64_t textBytes_ = 0;
+    uint64_t inputBytes_ = 0;
+};
+
+} // namespace terminal
@@ -17,6 +17,8 @@
 
 #include <string_view>
 
+using terminal::Sequence;
+using terminal::SequenceIntermediates;
 using terminal::SequenceParameterBuilder;
 using terminal::SequenceParameters;
 using namespace std::string_view_literals;
@@ -136,3 +138,35 @@ TEST_CASE("SequenceParameterBuilder.complex.2")
     INFO(parameters.subParameterBitString());
     CHECK(parameters.str() == "0;12::34:56;7;89");
 }
+
+TEST_CASE("SequenceIntermediates")
+{
+    auto intermediates = SequenceIntermediates {};
+    CHECK(intermediates.empty());
+
+    intermediates.push_back('$');
+    intermediates.push_back('"');
+    CHECK(intermediates.view() == "$\"");
+
+    for (size_t i = 0; i < SequenceIntermediates::Capacity; ++i)
+        intermediates.push_back('!');
+    CHECK(intermediates.size() == SequenceIntermediates::Capacity);
+
+    intermediates.clear();
+    CHECK(intermediates.empty());
+}
+
+TEST_CASE("Sequence.dataString.capacity")
+{
+    auto sequence = Sequence {};
+    sequence.dataString().assign(Sequence::RetainedDataStringCapacity / 2, 'x');
+    auto const* const retained = sequence.dataString().data();
+    sequence.clear();
+    CHECK(sequence.dataString().empty());
+    CHECK(sequence.dataString().data() == retained);
+
+    sequence.dataString().assign(Sequence::RetainedDataStringCapacity * 2, 'x');
+    sequence.clear();
+    CHECK(sequence.dataString().empty());
+    CHECK(sequence.dataString().capacity() <= Sequence::RetainedDataStringCapacity);
+}
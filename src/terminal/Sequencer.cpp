@@ -11,6 +11,7 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <terminal/CellUtil.h>
 #include <terminal/Screen.h>
 #include <terminal/Sequencer.h>
 #include <terminal/SixelParser.h>
@@ -18,6 +19,8 @@
 #include <terminal/logging.h>
 #include <terminal/primitives.h>
 
+#include <algorithm>
+#include <optional>
 #include <string_view>
 #include <utility>
 
@@ -30,6 +33,165 @@ using namespace std::string_view_literals;
 namespace terminal
 {
 
+namespace
+{
+    /// Sequential reader of decimal, ';'-separated SGR parameters.
+    class SGRParameterReader
+    {
+      public:
+        explicit SGRParameterReader(string_view _parameters) noexcept: input_ { _parameters } {}
+
+        [[nodiscard]] bool empty() const noexcept { return !pending_; }
+
+        /// Reads the next parameter, with empty parameters defaulting to 0.
+        ///
+        /// @returns the parameter, or std::nullopt if there is none left or its value is out of range.
+        [[nodiscard]] std::optional<unsigned> next() noexcept
+        {
+            if (!pending_)
+                return std::nullopt;
+
+            auto value = 0u;
+            while (offset_ < input_.size() && input_[offset_] != ';')
+            {
+                value = value * 10 + static_cast<unsigned>(input_[offset_++] - '0');
+                if (value > 0xFFFF)
+                    return std::nullopt;
+            }
+
+            pending_ = offset_ < input_.size();
+            ++offset_;
+            return value;
+        }
+
+      private:
+        string_view input_;
+        size_t offset_ = 0;
+        bool pending_ = true;
+    };
+
+    /// Reads the color of "38;5;P" or "38;2;R;G;B" (and their 48 and 58 counterparts),
+    /// right after the 38.
+    std::optional<Color> readSGRColor(SGRParameterReader& _reader) noexcept
+    {
+        switch (_reader.next().value_or(0))
+        {
+            case 5:
+                if (auto const index = _reader.next(); index && *index <= 255)
+                    return static_cast<IndexedColor>(*index);
+                break;
+            case 2: {
+                auto const r = _reader.next();
+                auto const g = _reader.next();
+                auto const b = _reader.next();
+                if (r && g && b && *r <= 255 && *g <= 255 && *b <= 255)
+                    return RGBColor { static_cast<uint8_t>(*r),
+                                      static_cast<uint8_t>(*g),
+                                      static_cast<uint8_t>(*b) };
+                break;
+            }
+            default: break;
+        }
+        return std::nullopt;
+    }
+
+    /// Applies the given SGR parameters to @p _attributes in a single pass.
+    ///
+    /// Only the common forms of SGR are handled here. For anything else, such as sub-parameters,
+    /// more parameters than a Sequence can hold, or malformed colors, false is returned,
+    /// leaving it up to the generic Sequence dispatch, which knows how to deal with these.
+    bool applySGR(GraphicsAttributes& _attributes, string_view _parameters) noexcept
+    {
+        if (std::count(_parameters.begin(), _parameters.end(), ';') >= 16)
+            return false;
+
+        auto const setFlags = [&](GraphicsRendition rendition) {
+            _attributes.flags = CellUtil::makeCellFlags(rendition, _attributes.flags);
+        };
+
+        auto reader = SGRParameterReader { _parameters };
+        while (!reader.empty())
+        {
+            auto const parameter = reader.next();
+            if (!parameter)
+                return false;
+
+            switch (*parameter)
+            {
+                case 0: _attributes = {}; break;
+                case 1: setFlags(GraphicsRendition::Bold); break;
+                case 2: setFlags(GraphicsRendition::Faint); break;
+                case 3: setFlags(GraphicsRendition::Italic); break;
+                case 4: setFlags(GraphicsRendition::Underline); break;
+                case 5: setFlags(GraphicsRendition::Blinking); break;
+                case 6: setFlags(GraphicsRendition::RapidBlinking); break;
+                case 7: setFlags(GraphicsRendition::Inverse); break;
+                case 8: setFlags(GraphicsRendition::Hidden); break;
+                case 9: setFlags(GraphicsRendition::CrossedOut); break;
+                case 21: setFlags(GraphicsRendition::DoublyUnderlined); break;
+                case 22: setFlags(GraphicsRendition::Normal); break;
+                case 23: setFlags(GraphicsRendition::NoItalic); break;
+                case 24: setFlags(GraphicsRendition::NoUnderline); break;
+                case 25: setFlags(GraphicsRendition::NoBlinking); break;
+                case 27: setFlags(GraphicsRendition::NoInverse); break;
+                case 28: setFlags(GraphicsRendition::NoHidden); break;
+                case 29: setFlags(GraphicsRendition::NoCrossedOut); break;
+                case 30:
+                case 31:
+                case 32:
+                case 33:
+                case 34:
+                case 35:
+                case 36:
+                case 37: _attributes.foregroundColor = static_cast<IndexedColor>(*parameter - 30); break;
+                case 39: _attributes.foregroundColor = DefaultColor(); break;
+                case 40:
+                case 41:
+                case 42:
+                case 43:
+                case 44:
+                case 45:
+                case 46:
+                case 47: _attributes.backgroundColor = static_cast<IndexedColor>(*parameter - 40); break;
+                case 49: _attributes.backgroundColor = DefaultColor(); break;
+                case 51: setFlags(GraphicsRendition::Framed); break;
+                case 53: setFlags(GraphicsRendition::Overline); break;
+                case 54: setFlags(GraphicsRendition::NoFramed); break;
+                case 55: setFlags(GraphicsRendition::NoOverline); break;
+                case 90:
+                case 91:
+                case 92:
+                case 93:
+                case 94:
+                case 95:
+                case 96:
+                case 97: _attributes.foregroundColor = static_cast<BrightColor>(*parameter - 90); break;
+                case 100:
+                case 101:
+                case 102:
+                case 103:
+                case 104:
+                case 105:
+                case 106:
+                case 107: _attributes.backgroundColor = static_cast<BrightColor>(*parameter - 100); break;
+                case 38:
+                case 48:
+                case 58: {
+                    auto const color = readSGRColor(reader);
+                    if (!color)
+                        return false;
+                    (*parameter == 38   ? _attributes.foregroundColor
+                     : *parameter == 48 ? _attributes.backgroundColor
+                                        : _attributes.underlineColor) = *color;
+                    break;
+                }
+                default: break;
+            }
+        }
+        return true;
+    }
+} // namespace
+
 Sequencer::Sequencer(Terminal& _terminal):
     terminal_ { _terminal }, parameterBuilder_ { sequence_.parameters() }
 {
@@ -44,6 +206,8 @@ void Sequencer::error(std::string_view _errorString)
 void Sequencer::print(char32_t codepoint)
 {
     terminal_.state().instructionCounter++;
+    if (auto* profiler = terminal_.state().sequenceProfiler.get(); profiler)
+        profiler->recordText(codepoint < 0x80 ? 1 : codepoint < 0x800 ? 2 : codepoint < 0x10000 ? 3 : 4);
     terminal_.activeDisplay().writeText(codepoint);
 }
 
@@ -52,6 +216,8 @@ size_t Sequencer::print(string_view _chars, size_t cellCount)
     assert(_chars.size() != 0);
 
     terminal_.state().instructionCounter += _chars.size();
+    if (auto* profiler = terminal_.state().sequenceProfiler.get(); profiler)
+        profiler->recordText(_chars.size());
     terminal_.activeDisplay().writeText(_chars, cellCount);
 
     return terminal_.state().pageSize.columns.as<size_t>()
@@ -106,6 +272,28 @@ void Sequencer::dispatchCSI(char _finalChar)
     handleSequence();
 }
 
+bool Sequencer::dispatchSGR(string_view _parameters) noexcept
+{
+#if defined(LIBTERMINAL_LOG_TRACE)
+    // Leave it to the generic dispatch, which is logging every sequence.
+    if (VTTraceSequenceLog)
+        return false;
+#endif
+
+    // Leave it to the generic dispatch, too, which is profiling every sequence.
+    if (terminal_.state().sequenceProfiler)
+        return false;
+
+    auto& cursor = terminal_.state().cursor;
+    auto attributes = cursor.graphicsRendition;
+    if (!applySGR(attributes, _parameters))
+        return false;
+
+    cursor.graphicsRendition = attributes;
+    terminal_.state().instructionCounter++;
+    return true;
+}
+
 void Sequencer::startOSC()
 {
     sequence_.setCategory(FunctionCategory::OSC);
@@ -113,15 +301,15 @@ void Sequencer::startOSC()
 
 void Sequencer::putOSC(char _char)
 {
-    if (sequence_.intermediateCharacters().size() + 1 < Sequence::MaxOscLength)
-        sequence_.intermediateCharacters().push_back(_char);
+    if (sequence_.dataString().size() < Sequence::MaxOscLength)
+        sequence_.dataString().push_back(_char);
 }
 
 void Sequencer::dispatchOSC()
 {
-    auto const [code, skipCount] = parser::extractCodePrefix(sequence_.intermediateCharacters());
+    auto const [code, skipCount] = parser::extractCodePrefix(sequence_.dataString());
     parameterBuilder_.set(static_cast<Sequence::Parameter>(code));
-    sequence_.intermediateCharacters().erase(0, skipCount);
+    sequence_.dataString().erase(0, skipCount);
     handleSequence();
     clear();
 }
@@ -137,7 +325,7 @@ void Sequencer::hook(char _finalChar)
 
 void Sequencer::put(char _char)
 {
-    if (hookedParser_)
+    if (hookedParser_ && (static_cast<uint8_t>(_char) < 0x80 || hookedParser_->passesUnicode()))
         hookedParser_->pass(_char);
 }
 
@@ -150,18 +338,38 @@ void Sequencer::unhook()
     }
 }
 
+void Sequencer::putAPC(char _char)
+{
+    if (apcString_.size() < Sequence::MaxApcLength)
+        apcString_.push_back(_char);
+}
+
+void Sequencer::dispatchAPC()
+{
+    terminal_.activeDisplay().applicationProgramCommand(apcString_);
+    apcString_.clear();
+}
+
 size_t Sequencer::maxBulkTextSequenceWidth() const noexcept
 {
     if (!terminal_.isPrimaryScreen())
         return 0;
 
-    if (!terminal_.primaryScreen().currentLine().isTrivialBuffer())
+    if (terminal_.primaryScreen().currentLine().isInflatedBuffer())
         return 0;
 
     assert(terminal_.state().margin.horizontal.to >= terminal_.cursor().position.column);
     return unbox<size_t>(terminal_.state().margin.horizontal.to - terminal_.cursor().position.column);
 }
 
+void Sequencer::dispatch(Sequence const& _sequence)
+{
+    if (_sequence.category() == FunctionCategory::DCS)
+        terminal_.state().instructionCounter++;
+
+    terminal_.activeDisplay().processSequence(_sequence);
+}
+
 void Sequencer::handleSequence()
 {
     parameterBuilder_.fixiate();
@@ -150,15 +150,16 @@ class Sequencer
     void paramSubSeparator() noexcept;
     void dispatchESC(char _function);
     void dispatchCSI(char _function);
+    [[nodiscard]] bool dispatchSGR(std::string_view _parameters) noexcept;
     void startOSC();
     void putOSC(char _char);
     void dispatchOSC();
     void hook(char _function);
     void put(char _char);
     void unhook();
-    void startAPC() {}
-    void putAPC(char) {}
-    void dispatchAPC() {}
+    void startAPC() { apcString_.clear(); }
+    void putAPC(char _char);
+    void dispatchAPC();
     void startPM() {}
     void putPM(char) {}
     void dispatchPM() {}
@@ -170,6 +171,9 @@ class Sequencer
 
     [[nodiscard]] size_t maxBulkTextSequenceWidth() const noexcept;
 
+    /// Dispatches a sequence that has been decoded already, e.g. by the PTY reader thread.
+    void dispatch(Sequence const& _sequence);
+
   private:
     void handleSequence();
 
@@ -181,6 +185,7 @@ class Sequencer
 
     std::unique_ptr<ParserExtension> hookedParser_;
     std::unique_ptr<SixelImageBuilder> sixelImageBuilder_;
+    std::string apcString_;
 };
 
 // {{{ inlines
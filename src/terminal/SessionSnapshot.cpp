@@ -0,0 +1,687 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/GraphemeClusterTable.h>
+#include <terminal/SessionSnapshot.h>
+#include <terminal/Terminal.h>
+
+#include <crispy/BufferObject.h>
+#include <crispy/utils.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#if !defined(_WIN32)
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+using std::nullopt;
+using std::optional;
+using std::string;
+using std::string_view;
+using std::vector;
+
+namespace terminal
+{
+
+namespace
+{
+    constexpr uint32_t Magic = 0x50534E43; // "CNSP"
+    constexpr uint32_t FormatVersion = 1;
+
+    // {{{ records
+    struct FileHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+    };
+
+    struct AttributesRecord
+    {
+        uint32_t foreground;
+        uint32_t background;
+        uint32_t underline;
+        uint32_t flags;
+    };
+
+    enum class LineKind : uint8_t
+    {
+        Trivial,
+        Attributed,
+        Inflated,
+    };
+
+    struct LineRecord
+    {
+        uint8_t flags;
+        LineKind kind;
+        uint32_t displayWidth;
+        uint32_t usedColumns;
+        uint32_t count; //!< number of attribute runs or cells of the line
+        uint64_t textOffset;
+        uint32_t textSize;
+        AttributesRecord textAttributes;
+        AttributesRecord fillAttributes;
+    };
+
+    struct RunRecord
+    {
+        uint32_t start;
+        AttributesRecord attributes;
+    };
+
+    struct CellRecord
+    {
+        AttributesRecord attributes;
+        uint32_t codepointOffset;
+        uint8_t codepointCount;
+        uint8_t width;
+    };
+
+    /// Precedes the arrays of the lines of a grid.
+    struct GridHeader
+    {
+        uint32_t lines;
+        uint32_t columns;
+        uint32_t historyLineCount;
+        uint32_t lineCount;
+        uint64_t runCount;
+        uint64_t cellCount;
+        uint64_t codepointCount;
+        uint64_t textSize;
+    };
+
+    struct StateRecord
+    {
+        uint32_t pageLines;
+        uint32_t pageColumns;
+        uint8_t alternateScreen;
+        uint8_t cursorShape;
+        uint8_t cursorDisplay;
+        uint8_t autoWrap;
+        uint8_t originMode;
+        uint8_t wrapPending;
+        uint8_t useBrightColors;
+        int32_t cursorLine;
+        int32_t cursorColumn;
+        AttributesRecord graphicsRendition;
+        ColorPalette::Palette palette;
+        RGBColor defaultForeground;
+        RGBColor defaultBackground;
+    };
+
+    static_assert(std::is_trivially_copyable_v<LineRecord>);
+    static_assert(std::is_trivially_copyable_v<CellRecord>);
+    static_assert(std::is_trivially_copyable_v<StateRecord>);
+
+    AttributesRecord toRecord(GraphicsAttributes const& _attributes) noexcept
+    {
+        return AttributesRecord { _attributes.foregroundColor.content,
+                                  _attributes.backgroundColor.content,
+                                  _attributes.underlineColor.content,
+                                  static_cast<uint32_t>(_attributes.flags) };
+    }
+
+    GraphicsAttributes fromRecord(AttributesRecord const& _record) noexcept
+    {
+        auto attributes = GraphicsAttributes {};
+        attributes.foregroundColor.content = _record.foreground;
+        attributes.backgroundColor.content = _record.background;
+        attributes.underlineColor.content = _record.underline;
+        attributes.flags = static_cast<CellFlags>(_record.flags);
+        return attributes;
+    }
+    // }}}
+
+    // {{{ modes
+    constexpr unsigned MaxDECModeValue = static_cast<unsigned>(DECMode::SixelCursorNextToGraphic);
+
+    constexpr AnsiMode AnsiModes[] = {
+        AnsiMode::KeyboardAction,
+        AnsiMode::Insert,
+        AnsiMode::SendReceive,
+        AnsiMode::AutomaticNewLine,
+    };
+
+    vector<DECMode> const& decModes()
+    {
+        static auto const modes = []() {
+            auto result = vector<DECMode> {};
+            for (unsigned value = 0; value <= MaxDECModeValue; ++value)
+                if (isValidDECMode(value))
+                    result.emplace_back(static_cast<DECMode>(value));
+            return result;
+        }();
+        return modes;
+    }
+
+    /// Tests whether the given mode is restored through the terminal, as it configures the input
+    /// generator or the cursor. All other modes merely have their value restored.
+    bool restoredThroughTerminal(DECMode _mode) noexcept
+    {
+        switch (_mode)
+        {
+            case DECMode::UseApplicationCursorKeys:
+            case DECMode::BracketedPaste:
+            case DECMode::FocusTracking:
+            case DECMode::VisibleCursor:
+            case DECMode::MouseExtended:
+            case DECMode::MouseSGR:
+            case DECMode::MouseURXVT:
+            case DECMode::MouseSGRPixels:
+            case DECMode::MouseAlternateScroll:
+            case DECMode::MouseProtocolX10:
+            case DECMode::MouseProtocolNormalTracking:
+            case DECMode::MouseProtocolHighlightTracking:
+            case DECMode::MouseProtocolButtonTracking:
+            case DECMode::MouseProtocolAnyEventTracking: return true;
+            default: return false;
+        }
+    }
+    // }}}
+
+    // {{{ Reader
+    /// Bounds-checked sequential reads from a snapshot.
+    class Reader
+    {
+      public:
+        explicit Reader(gsl::span<char const> _data) noexcept: data_ { _data } {}
+
+        template <typename T>
+        [[nodiscard]] bool read(T& _value) noexcept
+        {
+            if (remaining() < sizeof(T))
+                return false;
+            std::memcpy(&_value, data_.data() + offset_, sizeof(T));
+            offset_ += sizeof(T);
+            return true;
+        }
+
+        template <typename T>
+        [[nodiscard]] bool read(vector<T>& _values, uint64_t _count)
+        {
+            if (_count > remaining() / sizeof(T))
+                return false;
+            _values.resize(static_cast<size_t>(_count));
+            std::memcpy(_values.data(), data_.data() + offset_, _values.size() * sizeof(T));
+            offset_ += _values.size() * sizeof(T);
+            return true;
+        }
+
+        [[nodiscard]] optional<string_view> view(uint64_t _size) noexcept
+        {
+            if (_size > remaining())
+                return nullopt;
+            auto const result = string_view(data_.data() + offset_, static_cast<size_t>(_size));
+            offset_ += result.size();
+            return result;
+        }
+
+        [[nodiscard]] bool read(string& _value)
+        {
+            auto size = uint32_t {};
+            if (!read(size))
+                return false;
+            auto const text = view(size);
+            if (!text)
+                return false;
+            _value = string(*text);
+            return true;
+        }
+
+      private:
+        [[nodiscard]] size_t remaining() const noexcept { return data_.size() - offset_; }
+
+        gsl::span<char const> data_;
+        size_t offset_ = 0;
+    };
+    // }}}
+
+    // {{{ writing
+    template <typename T>
+    void write(std::ostream& _output, T const& _value)
+    {
+        _output.write(reinterpret_cast<char const*>(&_value), sizeof(T));
+    }
+
+    template <typename T>
+    void write(std::ostream& _output, vector<T> const& _values)
+    {
+        _output.write(reinterpret_cast<char const*>(_values.data()),
+                      static_cast<std::streamsize>(_values.size() * sizeof(T)));
+    }
+
+    void write(std::ostream& _output, string_view _text)
+    {
+        write(_output, static_cast<uint32_t>(_text.size()));
+        _output.write(_text.data(), static_cast<std::streamsize>(_text.size()));
+    }
+
+    template <typename Cell>
+    void write(std::ostream& _output, GridSnapshot<Cell> const& _snapshot)
+    {
+        auto lines = vector<LineRecord> {};
+        auto runs = vector<RunRecord> {};
+        auto cells = vector<CellRecord> {};
+        auto codepoints = vector<char32_t> {};
+        auto text = string {};
+
+        lines.reserve(_snapshot.lines().size());
+        for (auto const& line: _snapshot.lines())
+        {
+            auto record = LineRecord {};
+            record.flags = static_cast<uint8_t>(line.flags());
+            if (line.isTrivialBuffer())
+            {
+                auto const& buffer = line.trivialBuffer();
+                record.kind = LineKind::Trivial;
+                record.displayWidth = unbox<uint32_t>(buffer.displayWidth);
+                record.usedColumns = unbox<uint32_t>(buffer.usedColumns);
+                record.textOffset = text.size();
+                record.textSize = static_cast<uint32_t>(buffer.text.size());
+                record.textAttributes = toRecord(buffer.textAttributes);
+                record.fillAttributes = toRecord(buffer.fillAttributes);
+                text += buffer.text.view();
+            }
+            else if (line.isAttributedBuffer())
+            {
+                auto const& buffer = line.attributedBuffer();
+                record.kind = LineKind::Attributed;
+                record.displayWidth = unbox<uint32_t>(buffer.displayWidth);
+                record.usedColumns = unbox<uint32_t>(buffer.usedColumns());
+                record.count = static_cast<uint32_t>(buffer.runs.size());
+                record.textOffset = text.size();
+                record.textSize = static_cast<uint32_t>(buffer.text.size());
+                record.fillAttributes = toRecord(buffer.fillAttributes);
+                text += buffer.text;
+                for (auto const& run: buffer.runs)
+                    runs.emplace_back(RunRecord { unbox<uint32_t>(run.start), toRecord(run.attributes) });
+            }
+            else
+            {
+                auto const& buffer = line.inflatedBuffer();
+                record.kind = LineKind::Inflated;
+                record.displayWidth = static_cast<uint32_t>(buffer.size());
+                record.count = static_cast<uint32_t>(buffer.size());
+                for (auto const& cell: buffer)
+                {
+                    auto const codepointCount = std::min(cell.codepointCount(), GraphemeCluster::MaxLength);
+                    auto cellRecord = CellRecord {};
+                    cellRecord.attributes =
+                        AttributesRecord { cell.foregroundColor().content,
+                                           cell.backgroundColor().content,
+                                           cell.underlineColor().content,
+                                           static_cast<uint32_t>(cell.flags()) };
+                    cellRecord.codepointOffset = static_cast<uint32_t>(codepoints.size());
+                    cellRecord.codepointCount = static_cast<uint8_t>(codepointCount);
+                    cellRecord.width = static_cast<uint8_t>(cell.width());
+                    cells.emplace_back(cellRecord);
+                    for (size_t i = 0; i < codepointCount; ++i)
+                        codepoints.emplace_back(cell.codepoint(i));
+                }
+            }
+            lines.emplace_back(record);
+        }
+
+        write(_output,
+              GridHeader { unbox<uint32_t>(_snapshot.pageSize().lines),
+                           unbox<uint32_t>(_snapshot.pageSize().columns),
+                           unbox<uint32_t>(_snapshot.historyLineCount()),
+                           static_cast<uint32_t>(lines.size()),
+                           runs.size(),
+                           cells.size(),
+                           codepoints.size(),
+                           text.size() });
+        write(_output, lines);
+        write(_output, runs);
+        write(_output, cells);
+        write(_output, codepoints);
+        _output.write(text.data(), static_cast<std::streamsize>(text.size()));
+    }
+    // }}}
+
+    // {{{ reading
+    /// Widest a cell with any codepoints can be.
+    constexpr auto MaxCellWidth = uint8_t { 2 };
+
+    /// Tests that the attribute runs of a line start at its first column, in ascending order,
+    /// each within the line's @p _columns.
+    bool validRuns(gsl::span<RunRecord const> _runs, uint32_t _columns) noexcept
+    {
+        if (_runs.empty() || _runs[0].start != 0)
+            return false;
+        for (size_t i = 1; i < _runs.size(); ++i)
+            if (_runs[i].start <= _runs[i - 1].start || _runs[i].start >= _columns)
+                return false;
+        return true;
+    }
+
+    template <typename Cell>
+    optional<GridSnapshot<Cell>> readGrid(Reader& _input)
+    {
+        auto header = GridHeader {};
+        auto lineRecords = vector<LineRecord> {};
+        auto runRecords = vector<RunRecord> {};
+        auto cellRecords = vector<CellRecord> {};
+        auto codepoints = vector<char32_t> {};
+        if (!_input.read(header) || !_input.read(lineRecords, header.lineCount)
+            || !_input.read(runRecords, header.runCount) || !_input.read(cellRecords, header.cellCount)
+            || !_input.read(codepoints, header.codepointCount))
+            return nullopt;
+        auto const text = _input.view(header.textSize);
+        if (!text || header.lines == 0 || header.columns == 0
+            || header.lineCount != header.historyLineCount + header.lines)
+            return nullopt;
+
+        // The text of all trivial lines is kept in a single buffer object.
+        auto textBuffer = crispy::BufferObject<char>::create(std::max(text->size(), size_t { 1 }));
+        textBuffer->advance(textBuffer->writeAtEnd(gsl::span<char const>(text->data(), text->size())).size());
+
+        auto const columns = ColumnCount::cast_from(header.columns);
+        auto lines = vector<Line<Cell>> {};
+        lines.reserve(lineRecords.size());
+        auto nextRun = size_t { 0 };
+        auto nextCell = size_t { 0 };
+        for (auto const& record: lineRecords)
+        {
+            auto const flags = static_cast<LineFlags>(record.flags);
+            if (record.displayWidth != header.columns || record.usedColumns > header.columns
+                || record.textOffset > text->size() || record.textSize > text->size() - record.textOffset)
+                return nullopt;
+
+            switch (record.kind)
+            {
+                case LineKind::Trivial: {
+                    auto textAttributes =
+                        InternedGraphicsAttributes::intern(fromRecord(record.textAttributes));
+                    auto fillAttributes =
+                        InternedGraphicsAttributes::intern(fromRecord(record.fillAttributes));
+                    if (!textAttributes || !fillAttributes)
+                        return nullopt;
+                    lines.emplace_back(flags,
+                                       TrivialLineBuffer { columns,
+                                                           std::move(*textAttributes),
+                                                           std::move(*fillAttributes),
+                                                           HyperlinkId {},
+                                                           ColumnCount::cast_from(record.usedColumns),
+                                                           textBuffer->ref(record.textOffset, record.textSize) });
+                    break;
+                }
+                case LineKind::Attributed: {
+                    if (record.count == 0 || record.count > runRecords.size() - nextRun
+                        || record.textSize != record.usedColumns
+                        || !validRuns(gsl::span(runRecords).subspan(nextRun, record.count), header.columns))
+                        return nullopt;
+                    auto fillAttributes =
+                        InternedGraphicsAttributes::intern(fromRecord(record.fillAttributes));
+                    if (!fillAttributes)
+                        return nullopt;
+                    auto buffer = AttributedLineBuffer { columns, std::move(*fillAttributes) };
+                    buffer.text = string(text->substr(record.textOffset, record.textSize));
+                    for (auto i = nextRun; i < nextRun + record.count; ++i)
+                        buffer.runs.emplace_back(AttributeRun { ColumnOffset::cast_from(runRecords[i].start),
+                                                                fromRecord(runRecords[i].attributes) });
+                    nextRun += record.count;
+                    auto& line = lines.emplace_back(flags, columns, GraphicsAttributes {});
+                    line.setBuffer(std::move(buffer));
+                    break;
+                }
+                case LineKind::Inflated: {
+                    if (record.count != header.columns || record.count > cellRecords.size() - nextCell)
+                        return nullopt;
+                    auto buffer = typename Line<Cell>::InflatedBuffer {};
+                    buffer.reserve(record.count);
+                    for (auto i = nextCell; i < nextCell + record.count; ++i)
+                    {
+                        auto const& cellRecord = cellRecords[i];
+                        if (cellRecord.codepointOffset > codepoints.size()
+                            || cellRecord.codepointCount > codepoints.size() - cellRecord.codepointOffset
+                            || cellRecord.codepointCount > GraphemeCluster::MaxLength
+                            || (cellRecord.codepointCount != 0
+                                && (cellRecord.width == 0 || cellRecord.width > MaxCellWidth)))
+                            return nullopt;
+                        auto const attributes = fromRecord(cellRecord.attributes);
+                        auto& cell = buffer.emplace_back(attributes);
+                        if (cellRecord.codepointCount == 0)
+                            continue;
+                        cell.write(attributes, codepoints[cellRecord.codepointOffset], cellRecord.width);
+                        for (auto k = 1u; k < cellRecord.codepointCount; ++k)
+                            cell.appendCharacter(codepoints[cellRecord.codepointOffset + k]);
+                        cell.setWidth(cellRecord.width);
+                    }
+                    nextCell += record.count;
+                    lines.emplace_back(flags, std::move(buffer));
+                    break;
+                }
+                default: return nullopt;
+            }
+        }
+
+        return GridSnapshot<Cell> { PageSize { LineCount::cast_from(header.lines), columns },
+                                    LineCount::cast_from(header.historyLineCount),
+                                    std::move(lines) };
+    }
+    // }}}
+
+#if !defined(_WIN32)
+    /// Calls @p _callback with the contents of the given file, which is memory mapped.
+    template <typename Callback>
+    optional<bool> withMappedFile(FileSystem::path const& _path, Callback _callback)
+    {
+        auto const fd = ::open(_path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return nullopt;
+        auto const fdCloser = crispy::finally { [fd]() {
+            ::close(fd);
+        } };
+
+        struct stat st {};
+        if (::fstat(fd, &st) < 0 || st.st_size <= 0)
+            return nullopt;
+        auto const size = static_cast<size_t>(st.st_size);
+
+        auto* mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED)
+            return nullopt;
+        auto const unmapper = crispy::finally { [mapping, size]() {
+            ::munmap(mapping, size);
+        } };
+        ::madvise(mapping, size, MADV_SEQUENTIAL | MADV_WILLNEED);
+
+        return _callback(gsl::span<char const>(static_cast<char const*>(mapping), size));
+    }
+#endif
+} // namespace
+
+bool saveSessionSnapshot(Terminal& _terminal, std::ostream& _output)
+{
+    auto state = StateRecord {};
+    auto primary = GridSnapshot<PrimaryScreenCell> {};
+    auto alternate = optional<GridSnapshot<AlternateScreenCell>> {};
+    auto ansiModes = vector<uint32_t> {};
+    auto decModeNumbers = vector<uint32_t> {};
+    auto windowTitle = string {};
+    auto workingDirectory = string {};
+
+    {
+        auto const _l = std::lock_guard { _terminal };
+        auto& terminalState = _terminal.state();
+
+        primary = _terminal.primaryScreen().grid().snapshot();
+        if (_terminal.isAlternateScreen())
+            alternate = _terminal.alternateScreen().grid().snapshot();
+
+        auto const& cursor = terminalState.cursor;
+        auto const& colors = terminalState.colorPalette;
+        state.pageLines = unbox<uint32_t>(terminalState.pageSize.lines);
+        state.pageColumns = unbox<uint32_t>(terminalState.pageSize.columns);
+        state.alternateScreen = alternate.has_value();
+        state.cursorShape = static_cast<uint8_t>(_terminal.cursorShape());
+        state.cursorDisplay = static_cast<uint8_t>(_terminal.cursorDisplay());
+        state.autoWrap = cursor.autoWrap;
+        state.originMode = cursor.originMode;
+        state.wrapPending = terminalState.wrapPending;
+        state.useBrightColors = colors.useBrightColors;
+        state.cursorLine = unbox<int32_t>(cursor.position.line);
+        state.cursorColumn = unbox<int32_t>(cursor.position.column);
+        state.graphicsRendition = toRecord(cursor.graphicsRendition);
+        state.palette = colors.palette;
+        state.defaultForeground = colors.defaultForeground;
+        state.defaultBackground = colors.defaultBackground;
+
+        for (auto const mode: AnsiModes)
+            if (_terminal.isModeEnabled(mode))
+                ansiModes.emplace_back(toAnsiModeNum(mode));
+        for (auto const mode: decModes())
+            if (_terminal.isModeEnabled(mode))
+                decModeNumbers.emplace_back(toDECModeNum(mode));
+
+        windowTitle = _terminal.windowTitle();
+        workingDirectory = _terminal.currentWorkingDirectory();
+    }
+
+    write(_output, FileHeader { Magic, FormatVersion });
+    write(_output, state);
+    write(_output, static_cast<uint32_t>(ansiModes.size()));
+    write(_output, ansiModes);
+    write(_output, static_cast<uint32_t>(decModeNumbers.size()));
+    write(_output, decModeNumbers);
+    write(_output, string_view(windowTitle));
+    write(_output, string_view(workingDirectory));
+    write(_output, primary);
+    if (alternate)
+        write(_output, *alternate);
+
+    return static_cast<bool>(_output);
+}
+
+bool restoreSessionSnapshot(Terminal& _terminal, gsl::span<char const> _data)
+{
+    auto input = Reader(_data);
+
+    auto header = FileHeader {};
+    auto state = StateRecord {};
+    auto ansiModeCount = uint32_t {};
+    auto ansiModes = vector<uint32_t> {};
+    auto decModeCount = uint32_t {};
+    auto decModeNumbers = vector<uint32_t> {};
+    auto windowTitle = string {};
+    auto workingDirectory = string {};
+    if (!input.read(header) || header.magic != Magic || header.version != FormatVersion
+        || !input.read(state) || !input.read(ansiModeCount) || !input.read(ansiModes, ansiModeCount)
+        || !input.read(decModeCount) || !input.read(decModeNumbers, decModeCount) || !input.read(windowTitle)
+        || !input.read(workingDirectory))
+        return false;
+
+    auto primary = readGrid<PrimaryScreenCell>(input);
+    auto alternate = optional<GridSnapshot<AlternateScreenCell>> {};
+    if (state.alternateScreen)
+        alternate = readGrid<AlternateScreenCell>(input);
+
+    auto const pageSize = PageSize { LineCount::cast_from(state.pageLines),
+                                     ColumnCount::cast_from(state.pageColumns) };
+    if (!primary || primary->pageSize() != pageSize || (state.alternateScreen && !alternate)
+        || (alternate && alternate->pageSize() != pageSize) || state.cursorLine < 0
+        || static_cast<uint32_t>(state.cursorLine) >= state.pageLines || state.cursorColumn < 0
+        || static_cast<uint32_t>(state.cursorColumn) >= state.pageColumns
+        || state.cursorShape > static_cast<uint8_t>(CursorShape::Bar)
+        || state.cursorDisplay > static_cast<uint8_t>(CursorDisplay::Blink))
+        return false;
+
+    if (!_terminal.isPrimaryScreen())
+    {
+        auto const _l = std::lock_guard { _terminal };
+        _terminal.setScreen(ScreenType::Primary);
+    }
+
+    if (_terminal.state().pageSize != pageSize)
+    {
+        auto totalPageSize = _terminal.totalPageSize();
+        totalPageSize.lines = totalPageSize.lines - _terminal.state().pageSize.lines + pageSize.lines;
+        totalPageSize.columns = pageSize.columns;
+        _terminal.resizeScreen(totalPageSize);
+    }
+
+    auto const _l = std::lock_guard { _terminal };
+    auto& terminalState = _terminal.state();
+    if (_terminal.primaryScreen().grid().pageSize() != pageSize)
+        return false;
+
+    _terminal.primaryScreen().grid().restore(std::move(*primary));
+    if (alternate)
+    {
+        _terminal.setScreen(ScreenType::Alternate);
+        _terminal.alternateScreen().grid().restore(std::move(*alternate));
+    }
+
+    auto& cursor = terminalState.cursor;
+    cursor.position = CellLocation { LineOffset(state.cursorLine), ColumnOffset(state.cursorColumn) };
+    cursor.autoWrap = state.autoWrap != 0;
+    cursor.originMode = state.originMode != 0;
+    cursor.graphicsRendition = fromRecord(state.graphicsRendition);
+    terminalState.wrapPending = state.wrapPending != 0;
+    _terminal.setCursorStyle(static_cast<CursorDisplay>(state.cursorDisplay),
+                             static_cast<CursorShape>(state.cursorShape));
+
+    auto& colors = terminalState.colorPalette;
+    colors.useBrightColors = state.useBrightColors != 0;
+    colors.palette = state.palette;
+    colors.defaultForeground = state.defaultForeground;
+    colors.defaultBackground = state.defaultBackground;
+
+    auto const enabled = [](vector<uint32_t> const& _numbers, unsigned _number) {
+        return std::find(_numbers.begin(), _numbers.end(), _number) != _numbers.end();
+    };
+    for (auto const mode: AnsiModes)
+        terminalState.modes.set(mode, enabled(ansiModes, toAnsiModeNum(mode)));
+    for (auto const mode: decModes())
+    {
+        auto const value = enabled(decModeNumbers, toDECModeNum(mode));
+        if (!restoredThroughTerminal(mode))
+            terminalState.modes.set(mode, value);
+        else if (_terminal.isModeEnabled(mode) != value)
+            _terminal.setMode(mode, value);
+    }
+
+    _terminal.setWindowTitle(windowTitle);
+    terminalState.currentWorkingDirectory = std::move(workingDirectory);
+    _terminal.markScreenDirty();
+    return true;
+}
+
+bool restoreSessionSnapshot(Terminal& _terminal, FileSystem::path const& _path)
+{
+#if !defined(_WIN32)
+    return withMappedFile(_path, [&](gsl::span<char const> _data) {
+               return restoreSessionSnapshot(_terminal, _data);
+           }).value_or(false);
+#else
+    auto input = std::ifstream(_path, std::ios::binary);
+    if (!input)
+        return false;
+    auto const data = string(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char> {});
+    return restoreSessionSnapshot(_terminal, gsl::span<char const>(data.data(), data.size()));
+#endif
+}
+
+} // namespace terminal
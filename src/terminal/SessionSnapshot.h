@@ -0,0 +1,57 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <crispy/stdfs.h>
+
+#include <gsl/span>
+
+#include <ostream>
+
+namespace terminal
+{
+
+class Terminal;
+
+/**
+ * Binary snapshots of a terminal session, for restoring sessions after the application restarts.
+ *
+ * A snapshot contains both screens' lines including the scrollback history, the cursor, the modes,
+ * the color palette, the window title, and the working directory.
+ * Images and hyperlinks are not contained, and neither are saved cursors and saved modes.
+ *
+ * Lines are stored column-wise, as flat arrays of fixed-size line, attribute run, and cell records
+ * followed by the text of all lines, such that both saving and restoring are mostly bulk copies.
+ * Snapshots are meant to be restored on the same machine and use its byte order.
+ */
+
+/// Writes a snapshot of the given terminal to @p _output.
+///
+/// The terminal is only locked for taking a copy of its lines and state.
+///
+/// @retval false the snapshot could not be written completely.
+bool saveSessionSnapshot(Terminal& _terminal, std::ostream& _output);
+
+/// Restores the given terminal from a snapshot, resizing it to the snapshot's page size.
+///
+/// @retval false @p _data is not a valid snapshot, and the terminal has been left unchanged.
+bool restoreSessionSnapshot(Terminal& _terminal, gsl::span<char const> _data);
+
+/// Restores the given terminal from a snapshot file, which is memory mapped where supported.
+///
+/// @retval false the file could not be read or is not a valid snapshot,
+///               and the terminal has been left unchanged.
+bool restoreSessionSnapshot(Terminal& _terminal, FileSystem::path const& _path);
+
+} // namespace terminal
@@ -0,0 +1,128 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/MockTerm.h>
+#include <terminal/SessionSnapshot.h>
+
+#include <catch2/catch.hpp>
+
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+
+using namespace terminal;
+
+namespace
+{
+std::string snapshotOf(MockTerm<>& _mock)
+{
+    auto output = std::ostringstream {};
+    REQUIRE(saveSessionSnapshot(_mock.terminal, output));
+    return output.str();
+}
+
+bool restore(MockTerm<>& _mock, std::string const& _snapshot)
+{
+    return restoreSessionSnapshot(_mock.terminal, gsl::span<char const>(_snapshot.data(), _snapshot.size()));
+}
+
+std::string primaryText(MockTerm<>& _mock)
+{
+    auto const& screen = _mock.terminal.primaryScreen();
+    auto text = std::string {};
+    for (auto line = -boxed_cast<LineOffset>(screen.historyLineCount());
+         line < boxed_cast<LineOffset>(screen.pageSize().lines);
+         ++line)
+        text += screen.lineTextAt(line) + '\n';
+    return text;
+}
+} // namespace
+
+TEST_CASE("SessionSnapshot.primary_screen", "[snapshot]")
+{
+    auto source = MockTerm(PageSize { LineCount(3), ColumnCount(10) }, LineCount(5));
+    source.writeToScreen("\033]2;Title\033\\\033[?2004h");
+    source.writeToScreen("1\r\n2\r\n\033[31mred\033[m text\r\nä中\r\n5\r\n6");
+
+    auto const snapshot = snapshotOf(source);
+
+    auto target = MockTerm(PageSize { LineCount(2), ColumnCount(5) }, LineCount(5));
+    REQUIRE(restore(target, snapshot));
+
+    CHECK((target.terminal.state().pageSize == PageSize { LineCount(3), ColumnCount(10) }));
+    CHECK(target.terminal.primaryScreen().historyLineCount() == LineCount(3));
+    CHECK(primaryText(target) == primaryText(source));
+    CHECK(target.terminal.realCursorPosition() == source.terminal.realCursorPosition());
+    CHECK(target.terminal.isModeEnabled(DECMode::BracketedPaste));
+    CHECK(target.windowTitle == "Title");
+
+    auto const& red = std::as_const(target.terminal).primaryScreen().at(LineOffset(-1), ColumnOffset(0));
+    CHECK(red.foregroundColor() == Color::Indexed(IndexedColor::Red));
+    CHECK(red.codepoints() == U"r");
+}
+
+TEST_CASE("SessionSnapshot.alternate_screen", "[snapshot]")
+{
+    auto source = MockTerm(PageSize { LineCount(2), ColumnCount(5) }, LineCount(5));
+    source.writeToScreen("main\033[?1049h\033[Halt");
+
+    auto target = MockTerm(PageSize { LineCount(2), ColumnCount(5) }, LineCount(5));
+    REQUIRE(restore(target, snapshotOf(source)));
+
+    CHECK(target.terminal.isAlternateScreen());
+    CHECK(target.terminal.alternateScreen().lineTextAt(LineOffset(0)) == "alt");
+    CHECK(target.terminal.primaryScreen().lineTextAt(LineOffset(0)) == "main");
+    CHECK((target.terminal.realCursorPosition() == CellLocation { LineOffset(0), ColumnOffset(3) }));
+}
+
+TEST_CASE("SessionSnapshot.invalid", "[snapshot]")
+{
+    auto source = MockTerm(PageSize { LineCount(2), ColumnCount(5) }, LineCount(5));
+    source.writeToScreen("text");
+    auto const snapshot = snapshotOf(source);
+
+    auto target = MockTerm(PageSize { LineCount(3), ColumnCount(7) }, LineCount(5));
+    target.writeToScreen("kept");
+
+    CHECK_FALSE(restore(target, std::string("garbage")));
+    CHECK_FALSE(restore(target, snapshot.substr(0, snapshot.size() - 1)));
+    CHECK((target.terminal.state().pageSize == PageSize { LineCount(3), ColumnCount(7) }));
+    CHECK(target.terminal.primaryScreen().lineTextAt(LineOffset(0)) == "kept");
+}
+
+TEST_CASE("SessionSnapshot.invalid_cell", "[snapshot]")
+{
+    auto source = MockTerm(PageSize { LineCount(2), ColumnCount(5) }, LineCount(5));
+    source.writeToScreen("abcde\xCC\x81"); // e and U+0301 COMBINING ACUTE ACCENT in the last cell
+    auto snapshot = snapshotOf(source);
+
+    // The codepoints of the inflated line follow right after its cell records,
+    // the last of which ends with the cell's width and two bytes of padding.
+    auto const codepoints = std::u32string_view(U"abcde\u0301");
+    auto const* const codepointBytes = reinterpret_cast<char const*>(codepoints.data());
+    auto const codepointsOffset =
+        snapshot.find(std::string_view(codepointBytes, codepoints.size() * sizeof(char32_t)));
+    REQUIRE(codepointsOffset != std::string::npos);
+    auto const widthOffset = codepointsOffset - 3;
+    REQUIRE(snapshot[widthOffset] == 1);
+
+    snapshot[widthOffset] = 7;
+    auto target = MockTerm(PageSize { LineCount(2), ColumnCount(5) }, LineCount(5));
+    target.writeToScreen("kept");
+    CHECK_FALSE(restore(target, snapshot));
+    CHECK(target.terminal.primaryScreen().lineTextAt(LineOffset(0)) == "kept");
+
+    snapshot[widthOffset] = 1;
+    CHECK(restore(target, snapshot));
+}
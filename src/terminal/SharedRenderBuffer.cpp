@@ -0,0 +1,295 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/SharedRenderBuffer.h>
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+namespace terminal::shared_render
+{
+
+namespace
+{
+    constexpr uint32_t Magic = 0x43525342; // "CRSB"
+    constexpr uint32_t LayoutVersion = 1;
+
+    // The slot index is tagged with this bit as long as the reader has not acquired it yet.
+    constexpr uint8_t FreshBit = 0x04;
+    constexpr uint8_t IndexMask = 0x03;
+    constexpr size_t SlotCount = 3;
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t layoutVersion;
+        Capacity capacity;
+        std::atomic<uint8_t> pendingSlot;
+    };
+
+    constexpr size_t alignUp(size_t _value, size_t _alignment = 64) noexcept
+    {
+        return (_value + _alignment - 1) / _alignment * _alignment;
+    }
+
+    // Offsets of the arrays within a frame slot.
+    struct SlotLayout
+    {
+        size_t cells;
+        size_t lines;
+        size_t damagedLines;
+        size_t codepoints;
+        size_t text;
+        size_t size;
+
+        explicit SlotLayout(Capacity _capacity) noexcept:
+            cells { alignUp(sizeof(Frame)) },
+            lines { alignUp(cells + _capacity.cells * sizeof(Cell)) },
+            damagedLines { alignUp(lines + _capacity.lines * sizeof(Line)) },
+            codepoints { alignUp(damagedLines + _capacity.lines * sizeof(LineOffset)) },
+            text { alignUp(codepoints + _capacity.codepoints * sizeof(char32_t)) },
+            size { alignUp(text + _capacity.textBytes) }
+        {
+        }
+    };
+
+    constexpr size_t SlotsOffset = alignUp(sizeof(Header));
+
+    Header& header(gsl::span<std::byte> _region) noexcept
+    {
+        return *reinterpret_cast<Header*>(_region.data());
+    }
+
+    std::byte* slot(gsl::span<std::byte> _region, Capacity _capacity, size_t _index) noexcept
+    {
+        return _region.data() + SlotsOffset + _index * SlotLayout(_capacity).size;
+    }
+
+    template <typename T>
+    T* at(std::byte* _slot, size_t _offset) noexcept
+    {
+        return reinterpret_cast<T*>(_slot + _offset);
+    }
+
+    template <typename T>
+    T const* at(std::byte const* _slot, size_t _offset) noexcept
+    {
+        return reinterpret_cast<T const*>(_slot + _offset);
+    }
+} // namespace
+
+Capacity Capacity::forPageSize(PageSize _pageSize) noexcept
+{
+    auto const lines = unbox<uint32_t>(_pageSize.lines) + 1;
+    auto const cells = lines * unbox<uint32_t>(_pageSize.columns);
+    return Capacity { cells, lines, cells * 4, cells * 4 };
+}
+
+size_t regionSize(Capacity _capacity) noexcept
+{
+    return SlotsOffset + SlotCount * SlotLayout(_capacity).size;
+}
+
+// {{{ FrameView
+FrameView::FrameView(std::byte const* _slot, Capacity _capacity) noexcept
+{
+    auto const layout = SlotLayout(_capacity);
+    frame_ = at<Frame>(_slot, 0);
+    cells_ = at<Cell>(_slot, layout.cells);
+    lines_ = at<Line>(_slot, layout.lines);
+    damagedLines_ = at<LineOffset>(_slot, layout.damagedLines);
+    codepoints_ = at<char32_t>(_slot, layout.codepoints);
+    text_ = at<char>(_slot, layout.text);
+}
+
+gsl::span<Cell const> FrameView::cells() const noexcept
+{
+    return gsl::span<Cell const>(cells_, frame_->cellCount);
+}
+
+gsl::span<Line const> FrameView::lines() const noexcept
+{
+    return gsl::span<Line const>(lines_, frame_->lineCount);
+}
+
+gsl::span<LineOffset const> FrameView::damagedLines() const noexcept
+{
+    return gsl::span<LineOffset const>(damagedLines_, frame_->damagedLineCount);
+}
+
+std::u32string_view FrameView::codepoints(Cell const& _cell) const noexcept
+{
+    return std::u32string_view(codepoints_ + _cell.codepointsOffset, _cell.codepointCount);
+}
+
+std::string_view FrameView::text(Line const& _line) const noexcept
+{
+    return std::string_view(text_ + _line.textOffset, _line.textSize);
+}
+
+void FrameView::copyTo(RenderBuffer& _output) const
+{
+    // RenderLine::text refers to the frame's text arena, which must outlive the copy.
+    _output.clear();
+    _output.frameID = frame_->frameID;
+    for (auto const& cell: cells())
+    {
+        auto& renderCell = _output.cells.emplace_back();
+        renderCell.setCodepoints(codepoints(cell));
+        renderCell.position = cell.position;
+        renderCell.attributes = cell.attributes;
+        renderCell.width = cell.width;
+        renderCell.groupStart = (cell.group & Cell::GroupStart) != 0;
+        renderCell.groupEnd = (cell.group & Cell::GroupEnd) != 0;
+    }
+    for (auto const& line: lines())
+        _output.lines.emplace_back(RenderLine { text(line),
+                                                line.lineOffset,
+                                                line.usedColumns,
+                                                line.displayWidth,
+                                                line.textAttributes,
+                                                line.fillAttributes });
+    if (frame_->hasCursor)
+        _output.cursor = RenderCursor { frame_->cursorPosition, frame_->cursorShape, frame_->cursorWidth };
+    auto const damaged = damagedLines();
+    _output.damagedLines.assign(damaged.begin(), damaged.end());
+    _output.scrollShift = frame_->scrollShift;
+    _output.scrollRegion = frame_->scrollRegion;
+}
+// }}}
+
+// {{{ Writer
+Writer::Writer(gsl::span<std::byte> _region, Capacity _capacity): region_ { _region }, capacity_ { _capacity }
+{
+    if (region_.size() < regionSize(capacity_))
+        throw std::invalid_argument("Shared render buffer region is too small.");
+
+    auto* h = new (region_.data()) Header {};
+    h->magic = Magic;
+    h->layoutVersion = LayoutVersion;
+    h->capacity = capacity_;
+    h->pendingSlot.store(2, std::memory_order_release);
+}
+
+bool Writer::publish(RenderBuffer const& _buffer) noexcept
+{
+    auto codepointCount = size_t { 0 };
+    for (auto const& cell: _buffer.cells)
+        codepointCount += cell.codepointCount;
+    auto textSize = size_t { 0 };
+    for (auto const& line: _buffer.lines)
+        textSize += line.text.size();
+
+    if (_buffer.cells.size() > capacity_.cells || _buffer.lines.size() > capacity_.lines
+        || _buffer.damagedLines.size() > capacity_.lines || codepointCount > capacity_.codepoints
+        || textSize > capacity_.textBytes)
+        return false;
+
+    auto const layout = SlotLayout(capacity_);
+    auto* const target = slot(region_, capacity_, backSlot_);
+
+    auto* const codepoints = at<char32_t>(target, layout.codepoints);
+    auto* cells = at<Cell>(target, layout.cells);
+    auto codepointOffset = uint32_t { 0 };
+    for (auto const& cell: _buffer.cells)
+    {
+        std::copy_n(cell.codepointStorage.begin(), cell.codepointCount, codepoints + codepointOffset);
+        *cells++ = Cell { codepointOffset,
+                          cell.codepointCount,
+                          cell.width,
+                          static_cast<uint8_t>((cell.groupStart ? Cell::GroupStart : 0)
+                                               | (cell.groupEnd ? Cell::GroupEnd : 0)),
+                          cell.position,
+                          cell.attributes };
+        codepointOffset += cell.codepointCount;
+    }
+
+    auto* const text = at<char>(target, layout.text);
+    auto* lines = at<Line>(target, layout.lines);
+    auto textOffset = uint32_t { 0 };
+    for (auto const& line: _buffer.lines)
+    {
+        std::memcpy(text + textOffset, line.text.data(), line.text.size());
+        *lines++ = Line { textOffset,
+                          static_cast<uint32_t>(line.text.size()),
+                          line.lineOffset,
+                          line.usedColumns,
+                          line.displayWidth,
+                          line.textAttributes,
+                          line.fillAttributes };
+        textOffset += static_cast<uint32_t>(line.text.size());
+    }
+
+    std::copy(_buffer.damagedLines.begin(),
+              _buffer.damagedLines.end(),
+              at<LineOffset>(target, layout.damagedLines));
+
+    auto& frame = *at<Frame>(target, 0);
+    frame = Frame { _buffer.frameID,
+                    static_cast<uint32_t>(_buffer.cells.size()),
+                    static_cast<uint32_t>(_buffer.lines.size()),
+                    codepointOffset,
+                    textOffset,
+                    static_cast<uint32_t>(_buffer.damagedLines.size()),
+                    _buffer.scrollShift,
+                    _buffer.scrollRegion,
+                    _buffer.cursor.has_value(),
+                    _buffer.cursor ? _buffer.cursor->shape : CursorShape::Block,
+                    _buffer.cursor ? _buffer.cursor->position : CellLocation {},
+                    _buffer.cursor ? _buffer.cursor->width : 1 };
+
+    // The slot handed back is either the one the reader has just released,
+    // or the pending one the reader has skipped.
+    auto const back = static_cast<uint8_t>(backSlot_ | FreshBit);
+    backSlot_ = header(region_).pendingSlot.exchange(back, std::memory_order_acq_rel) & IndexMask;
+    return true;
+}
+// }}}
+
+// {{{ Reader
+Reader::Reader(gsl::span<std::byte> _region): region_ { _region }
+{
+    if (region_.size() < SlotsOffset)
+        throw std::runtime_error("Shared render buffer region is too small.");
+
+    auto const& h = header(region_);
+    if (h.magic != Magic || h.layoutVersion != LayoutVersion)
+        throw std::runtime_error("Shared render buffer region has an incompatible layout.");
+
+    capacity_ = h.capacity;
+    if (region_.size() < regionSize(capacity_))
+        throw std::runtime_error("Shared render buffer region is too small.");
+}
+
+bool Reader::hasNewFrame() const noexcept
+{
+    return (header(region_).pendingSlot.load(std::memory_order_relaxed) & FreshBit) != 0;
+}
+
+std::optional<FrameView> Reader::acquire() noexcept
+{
+    auto& pendingSlot = header(region_).pendingSlot;
+    if (pendingSlot.load(std::memory_order_relaxed) & FreshBit)
+    {
+        frontSlot_ = pendingSlot.exchange(frontSlot_, std::memory_order_acq_rel) & IndexMask;
+        acquired_ = true;
+    }
+    if (!acquired_)
+        return std::nullopt;
+    return FrameView(slot(region_, capacity_, frontSlot_), capacity_);
+}
+// }}}
+
+} // namespace terminal::shared_render
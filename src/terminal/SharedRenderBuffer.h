@@ -0,0 +1,178 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <terminal/RenderBuffer.h>
+#include <terminal/primitives.h>
+
+#include <gsl/span>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <type_traits>
+
+namespace terminal
+{
+
+/**
+ * Render frames laid out in a single flat memory region, such that the terminal and the renderer
+ * can live in different processes that share that region, e.g. via shm_open() or memfd_create().
+ *
+ * The region contains no pointers. Cells and lines are POD records, and their text lives in arenas
+ * that are addressed by offset. Frames are handed over the same way as by RenderTripleBuffer,
+ * using three frame slots and an atomic slot index in the region, so neither side ever waits for
+ * the other, and the reader reads the frame it has acquired in place.
+ *
+ * Images cannot be shared this way and are left out.
+ */
+namespace shared_render
+{
+    /// Upper bounds of the contents of a single frame.
+    struct Capacity
+    {
+        uint32_t cells = 0;
+        uint32_t lines = 0;
+        uint32_t codepoints = 0; //!< total number of codepoints of all cells
+        uint32_t textBytes = 0;  //!< total text size of all lines
+
+        /// @returns the capacity sufficient for all pages of the given size,
+        ///          including a status line of the same width.
+        static Capacity forPageSize(PageSize _pageSize) noexcept;
+    };
+
+    /// RenderCell, with its codepoints stored in the frame's codepoint arena.
+    struct Cell
+    {
+        uint32_t codepointsOffset;
+        uint16_t codepointCount;
+        uint8_t width;
+        uint8_t group; //!< bitmask of GroupStart and GroupEnd
+        CellLocation position;
+        RenderAttributes attributes;
+
+        static constexpr uint8_t GroupStart = 0x01;
+        static constexpr uint8_t GroupEnd = 0x02;
+    };
+
+    /// RenderLine, with its text stored in the frame's text arena.
+    struct Line
+    {
+        uint32_t textOffset;
+        uint32_t textSize;
+        LineOffset lineOffset;
+        ColumnCount usedColumns;
+        ColumnCount displayWidth;
+        RenderAttributes textAttributes;
+        RenderAttributes fillAttributes;
+    };
+
+    struct Frame
+    {
+        uint64_t frameID;
+        uint32_t cellCount;
+        uint32_t lineCount;
+        uint32_t codepointCount;
+        uint32_t textSize;
+        uint32_t damagedLineCount;
+        LineOffset scrollShift;
+        LineCount scrollRegion;
+        bool hasCursor;
+        CursorShape cursorShape;
+        CellLocation cursorPosition;
+        int32_t cursorWidth;
+    };
+
+    static_assert(std::is_trivially_copyable_v<Cell>);
+    static_assert(std::is_trivially_copyable_v<Line>);
+    static_assert(std::is_trivially_copyable_v<Frame>);
+    static_assert(std::atomic<uint8_t>::is_always_lock_free);
+
+    /// Read-only view of a frame in the shared region.
+    class FrameView
+    {
+      public:
+        FrameView(std::byte const* _slot, Capacity _capacity) noexcept;
+
+        [[nodiscard]] Frame const& frame() const noexcept { return *frame_; }
+        [[nodiscard]] gsl::span<Cell const> cells() const noexcept;
+        [[nodiscard]] gsl::span<Line const> lines() const noexcept;
+        [[nodiscard]] gsl::span<LineOffset const> damagedLines() const noexcept;
+        [[nodiscard]] std::u32string_view codepoints(Cell const& _cell) const noexcept;
+        [[nodiscard]] std::string_view text(Line const& _line) const noexcept;
+
+        /// Copies the frame into @p _output, e.g. for a renderer that consumes RenderBuffer objects.
+        void copyTo(RenderBuffer& _output) const;
+
+      private:
+        Frame const* frame_;
+        Cell const* cells_;
+        Line const* lines_;
+        LineOffset const* damagedLines_;
+        char32_t const* codepoints_;
+        char const* text_;
+    };
+
+    /// @returns the size of the memory region required for frames of the given capacity.
+    [[nodiscard]] size_t regionSize(Capacity _capacity) noexcept;
+
+    /// Publishes frames into the shared region. There must be only one writer per region.
+    class Writer
+    {
+      public:
+        /// Initializes the given region, which must be at least regionSize(_capacity) bytes large
+        /// and suitably aligned for any type, as is any mapping.
+        Writer(gsl::span<std::byte> _region, Capacity _capacity);
+
+        [[nodiscard]] Capacity capacity() const noexcept { return capacity_; }
+
+        /// Writes the given frame into the back slot and publishes it as the latest frame.
+        ///
+        /// @retval false the frame exceeds the region's capacity and has not been published.
+        bool publish(RenderBuffer const& _buffer) noexcept;
+
+      private:
+        gsl::span<std::byte> region_;
+        Capacity capacity_;
+        uint8_t backSlot_ = 0;
+    };
+
+    /// Acquires the frames published into a shared region. There must be only one reader per region.
+    class Reader
+    {
+      public:
+        /// Attaches to a region that has been initialized by a Writer.
+        ///
+        /// @throws std::runtime_error if the region does not contain frames of a compatible layout.
+        explicit Reader(gsl::span<std::byte> _region);
+
+        /// @returns whether a frame newer than the one last acquired has been published.
+        [[nodiscard]] bool hasNewFrame() const noexcept;
+
+        /// Acquires the latest published frame, which remains valid and unchanged until the next call.
+        ///
+        /// @returns the acquired frame, or std::nullopt if no frame has been published yet.
+        [[nodiscard]] std::optional<FrameView> acquire() noexcept;
+
+      private:
+        gsl::span<std::byte> region_;
+        Capacity capacity_;
+        uint8_t frontSlot_ = 1;
+        bool acquired_ = false;
+    };
+} // namespace shared_render
+
+} // namespace terminal
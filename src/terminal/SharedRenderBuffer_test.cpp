@@ -0,0 +1,128 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/SharedRenderBuffer.h>
+
+#include <catch2/catch.hpp>
+
+#include <vector>
+
+using namespace terminal;
+
+namespace
+{
+RenderBuffer makeFrame(uint64_t _frameID)
+{
+    auto buffer = RenderBuffer {};
+    buffer.frameID = _frameID;
+    auto& first = buffer.cells.emplace_back();
+    first.setCodepoints(U"é");
+    first.position = CellLocation { LineOffset(0), ColumnOffset(1) };
+    first.attributes = RenderAttributes { RGBColor(1, 2, 3) };
+    first.groupStart = true;
+    auto& second = buffer.cells.emplace_back();
+    second.setCodepoints(U"\U0001F600");
+    second.position = CellLocation { LineOffset(0), ColumnOffset(2) };
+    second.width = 2;
+    second.groupEnd = true;
+    buffer.lines.emplace_back(RenderLine { "hello", LineOffset(1), ColumnCount(5), ColumnCount(10) });
+    buffer.cursor = RenderCursor { CellLocation { LineOffset(1), ColumnOffset(5) }, CursorShape::Bar, 1 };
+    buffer.damagedLines = { LineOffset(0), LineOffset(1) };
+    buffer.scrollShift = LineOffset(-1);
+    buffer.scrollRegion = LineCount(2);
+    return buffer;
+}
+} // namespace
+
+TEST_CASE("SharedRenderBuffer.roundtrip", "[render]")
+{
+    auto const capacity = shared_render::Capacity::forPageSize(PageSize { LineCount(2), ColumnCount(10) });
+    auto region = std::vector<std::byte>(shared_render::regionSize(capacity));
+    auto writer = shared_render::Writer(region, capacity);
+    auto reader = shared_render::Reader(region);
+
+    CHECK_FALSE(reader.hasNewFrame());
+    CHECK_FALSE(reader.acquire().has_value());
+
+    REQUIRE(writer.publish(makeFrame(1)));
+    REQUIRE(reader.hasNewFrame());
+
+    auto const view = reader.acquire();
+    REQUIRE(view.has_value());
+    CHECK_FALSE(reader.hasNewFrame());
+    CHECK(view->frame().frameID == 1);
+
+    REQUIRE(view->cells().size() == 2);
+    CHECK(view->codepoints(view->cells()[0]) == U"é");
+    CHECK(view->codepoints(view->cells()[1]) == U"\U0001F600");
+    CHECK(view->cells()[0].attributes.foregroundColor == RGBColor(1, 2, 3));
+    CHECK(view->cells()[1].width == 2);
+
+    REQUIRE(view->lines().size() == 1);
+    CHECK(view->text(view->lines()[0]) == "hello");
+
+    auto copy = RenderBuffer {};
+    view->copyTo(copy);
+    REQUIRE(copy.cells.size() == 2);
+    CHECK(copy.cells[0].codepoints() == U"é");
+    CHECK(copy.cells[0].groupStart);
+    CHECK(copy.cells[1].groupEnd);
+    CHECK((copy.cells[1].position == CellLocation { LineOffset(0), ColumnOffset(2) }));
+    REQUIRE(copy.lines.size() == 1);
+    CHECK(copy.lines[0].text == "hello");
+    CHECK(copy.lines[0].displayWidth == ColumnCount(10));
+    REQUIRE(copy.cursor.has_value());
+    CHECK(copy.cursor->shape == CursorShape::Bar);
+    CHECK(copy.damagedLines.size() == 2);
+    CHECK(copy.scrollShift == LineOffset(-1));
+}
+
+TEST_CASE("SharedRenderBuffer.latest_frame_wins", "[render]")
+{
+    auto const capacity = shared_render::Capacity::forPageSize(PageSize { LineCount(2), ColumnCount(10) });
+    auto region = std::vector<std::byte>(shared_render::regionSize(capacity));
+    auto writer = shared_render::Writer(region, capacity);
+    auto reader = shared_render::Reader(region);
+
+    REQUIRE(writer.publish(makeFrame(1)));
+    auto const first = reader.acquire();
+    REQUIRE(first.has_value());
+
+    // The acquired frame stays intact while the writer keeps publishing.
+    REQUIRE(writer.publish(makeFrame(2)));
+    REQUIRE(writer.publish(makeFrame(3)));
+    REQUIRE(writer.publish(makeFrame(4)));
+    CHECK(first->frame().frameID == 1);
+    CHECK(first->text(first->lines()[0]) == "hello");
+
+    auto const latest = reader.acquire();
+    REQUIRE(latest.has_value());
+    CHECK(latest->frame().frameID == 4);
+
+    // Without a new frame, the same frame is acquired again.
+    CHECK(reader.acquire()->frame().frameID == 4);
+}
+
+TEST_CASE("SharedRenderBuffer.capacity", "[render]")
+{
+    auto const capacity = shared_render::Capacity { 1, 1, 1, 4 };
+    auto region = std::vector<std::byte>(shared_render::regionSize(capacity));
+    auto writer = shared_render::Writer(region, capacity);
+    auto reader = shared_render::Reader(region);
+
+    CHECK_FALSE(writer.publish(makeFrame(1)));
+    CHECK_FALSE(reader.hasNewFrame());
+
+    auto tooSmall = std::vector<std::byte>(8);
+    CHECK_THROWS(shared_render::Reader(tooSmall));
+}
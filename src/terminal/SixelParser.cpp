@@ -14,6 +14,9 @@
 #include <terminal/SixelParser.h>
 
 #include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <future>
 
 using std::clamp;
 using std::fill;
@@ -93,6 +96,66 @@ namespace
         }
     }
 
+    /// Resolves the color registers and the color each sixel band starts with, skipping the pixels.
+    class SixelBandScanner: public SixelParser::Events
+    {
+      public:
+        struct Band
+        {
+            std::shared_ptr<SixelColorPalette const> colors;
+            unsigned currentColor;
+            bool painted = false;
+        };
+
+        struct Raster
+        {
+            unsigned int pan;
+            unsigned int pad;
+            optional<ImageSize> imageSize;
+        };
+
+        SixelBandScanner(SixelColorPalette const& _colors, unsigned _currentColor):
+            colors_ { make_shared<SixelColorPalette>(_colors) }, currentColor_ { _currentColor }
+        {
+            newline();
+        }
+
+        [[nodiscard]] vector<Band> const& bands() const noexcept { return bands_; }
+        [[nodiscard]] SixelColorPalette const& colors() const noexcept { return *colors_; }
+        [[nodiscard]] unsigned currentColor() const noexcept { return currentColor_; }
+        [[nodiscard]] optional<Raster> const& raster() const noexcept { return raster_; }
+        [[nodiscard]] bool lateRaster() const noexcept { return lateRaster_; }
+
+        void setColor(unsigned _index, RGBColor const& _color) override
+        {
+            // Bands started already keep the registers they started with.
+            if (colors_.use_count() > 1)
+                colors_ = make_shared<SixelColorPalette>(*colors_);
+            colors_->setColor(_index, _color);
+        }
+
+        void useColor(unsigned _index) override { currentColor_ = _index % colors_->size(); }
+        void rewind() override {}
+        void newline() override { bands_.emplace_back(Band { colors_, currentColor_ }); }
+
+        void setRaster(unsigned int _pan, unsigned int _pad, optional<ImageSize> _imageSize) override
+        {
+            if (bands_.size() > 1 || bands_.back().painted)
+                lateRaster_ = true;
+            raster_ = Raster { _pan, _pad, _imageSize };
+        }
+
+        void render(int8_t /*_sixel*/, unsigned /*_count*/) override { bands_.back().painted = true; }
+        void finalize() override {}
+
+      private:
+        vector<Band> bands_;
+        std::shared_ptr<SixelColorPalette> colors_;
+        unsigned currentColor_;
+        optional<Raster> raster_;
+        bool lateRaster_ = false;
+    };
+
 } // namespace
 
 // VT 340 default color palette (https://www.vt100.net/docs/vt3xx-gp/chapter2.html#S2.4)
@@ -163,8 +226,25 @@ SixelParser::SixelParser(Events& _events, OnFinalize _finalizer):
 {
 }
 
+void SixelParser::parseFragment(iterator _begin, iterator _end)
+{
+    for (auto const ch: crispy::range(_begin, _end))
+        parse(ch);
+    flushPendingSixels();
+}
+
 void SixelParser::parse(char _value)
 {
+    if (pendingSixelCount_ != 0)
+    {
+        if (_value == pendingSixel_ && state_ == State::Ground)
+        {
+            ++pendingSixelCount_;
+            return;
+        }
+        flushPendingSixels();
+    }
+
     switch (state_)
     {
         case State::Ground: fallback(_value); break;
@@ -175,9 +255,7 @@ void SixelParser::parse(char _value)
                 paramShiftAndAddDigit(toDigit(_value));
             else if (isSixel(_value))
             {
-                auto const sixel = toSixel(_value);
-                for (unsigned i = 0; i < params_[0]; ++i)
-                    events_.render(sixel);
+                events_.render(toSixel(_value), params_[0]);
                 transitionTo(State::Ground);
             }
             else
@@ -238,14 +316,27 @@ void SixelParser::fallback(char _value)
             transitionTo(State::Ground);
 
         if (isSixel(_value))
-            events_.render(toSixel(_value));
+        {
+            pendingSixel_ = _value;
+            pendingSixelCount_ = 1;
+        }
     }
 
     // ignore any other input value
 }
 
+void SixelParser::flushPendingSixels()
+{
+    if (pendingSixelCount_ == 0)
+        return;
+
+    events_.render(toSixel(pendingSixel_), pendingSixelCount_);
+    pendingSixelCount_ = 0;
+}
+
 void SixelParser::done()
 {
+    flushPendingSixels();
     transitionTo(State::Ground); // this also ensures current state's leave action is invoked
     events_.finalize();
     if (finalizer_)
@@ -373,7 +464,7 @@ SixelImageBuilder::SixelImageBuilder(ImageSize _maxSize,
     maxSize_ { _maxSize },
     colors_ { std::move(_colorPalette) },
     size_ { ImageSize { Width { 1 }, Height { 1 } } },
-    buffer_(maxSize_.area() * 4),
+    backgroundColor_ { _backgroundColor },
     sixelCursor_ {},
     currentColor_ { 0 },
     aspectRatio_(static_cast<unsigned int>(
@@ -386,49 +477,99 @@ SixelImageBuilder::SixelImageBuilder(ImageSize _maxSize,
 void SixelImageBuilder::clear(RGBAColor _fillColor)
 {
     sixelCursor_ = {};
+    backgroundColor_ = _fillColor;
+    buffer_.clear();
+    takenRows_ = 0;
+}
 
-    auto p = buffer_.data();
-    auto const e = p + maxSize_.area() * 4;
-    while (p != e)
-    {
-        *p++ = _fillColor.red();
-        *p++ = _fillColor.green();
-        *p++ = _fillColor.blue();
-        *p++ = _fillColor.alpha();
-    }
+void SixelImageBuilder::allocateRows(unsigned int _rowEnd)
+{
+    if (_rowEnd <= takenRows_)
+        return;
+
+    auto const size = static_cast<size_t>(_rowEnd - takenRows_) * pitch();
+    if (buffer_.size() >= size)
+        return;
+
+    auto const pixel = std::array<uint8_t, 4> {
+        backgroundColor_.red(), backgroundColor_.green(), backgroundColor_.blue(), backgroundColor_.alpha()
+    };
+    auto offset = buffer_.size();
+    buffer_.resize(size);
+    for (; offset < size; offset += 4)
+        std::memcpy(buffer_.data() + offset, pixel.data(), 4);
 }
 
 RGBAColor SixelImageBuilder::at(CellLocation _coord) const noexcept
 {
     auto const line = unbox<unsigned>(_coord.line) % unbox<unsigned>(size_.height);
     auto const col = unbox<unsigned>(_coord.column) % unbox<unsigned>(size_.width);
-    auto const base = line * unbox<unsigned>(size_.width) * 4 + col * 4;
+    if (line < takenRows_)
+        return backgroundColor_;
+    auto const base = static_cast<size_t>(line - takenRows_) * unbox<unsigned>(size_.width) * 4 + col * 4;
+    if (base + 4 > buffer_.size())
+        return backgroundColor_;
     auto const color = &buffer_[base];
     return RGBAColor { color[0], color[1], color[2], color[3] };
 }
 
-void SixelImageBuilder::write(CellLocation const& _coord, RGBColor const& _value) noexcept
+unsigned int SixelImageBuilder::completedRowCount() const noexcept
+{
+    if (!explicitSize_)
+        return 0;
+
+    auto const completed = min(sixelCursor_.line.as<unsigned int>(), unbox<unsigned int>(size_.height));
+    return completed > takenRows_ ? completed - takenRows_ : 0;
+}
+
+SixelImageBuilder::Buffer SixelImageBuilder::takeRows(unsigned int _count)
+{
+    _count = min(_count, completedRowCount());
+    allocateRows(takenRows_ + _count);
+
+    auto const end = buffer_.begin() + static_cast<long>(_count * pitch());
+    auto rows = Buffer(buffer_.begin(), end);
+    // Only the rows of the current sixel band remain, so this is cheap.
+    buffer_.erase(buffer_.begin(), end);
+    takenRows_ += _count;
+    return rows;
+}
+
+void SixelImageBuilder::write(CellLocation const& _coord, unsigned _count, RGBColor const& _value)
 {
     if (unbox<int>(_coord.line) >= 0 && unbox<int>(_coord.line) < unbox<int>(maxSize_.height)
         && unbox<int>(_coord.column) >= 0 && unbox<int>(_coord.column) < unbox<int>(maxSize_.width))
     {
+        auto const column = unbox<unsigned int>(_coord.column);
+        auto const count = min(_count, unbox<unsigned int>(maxSize_.width) - column);
+
         if (!explicitSize_)
         {
             if (unbox<int>(_coord.line) >= unbox<int>(size_.height))
                 size_.height = Height::cast_from(_coord.line.as<unsigned int>() + aspectRatio_);
-            if (unbox<int>(_coord.column) >= unbox<int>(size_.width))
-                size_.width = Width::cast_from(_coord.column + 1);
+            if (column + count > unbox<unsigned int>(size_.width))
+                size_.width = Width::cast_from(column + count);
         }
 
+        auto const line = _coord.line.as<unsigned int>();
+        if (line < takenRows_)
+            return;
+
+        auto const rowEnd = explicitSize_ ? min(line + aspectRatio_, unbox<unsigned int>(size_.height))
+                                          : line + aspectRatio_;
+        allocateRows(rowEnd);
+
+        auto const pixel = std::array<uint8_t, 4> { _value.red, _value.green, _value.blue, 0xFF };
         for (unsigned int i = 0; i < aspectRatio_; ++i)
         {
-            auto const base = (_coord.line.as<unsigned int>() + i)
-                                  * unbox<unsigned int>((explicitSize_ ? size_.width : maxSize_.width)) * 4u
-                              + unbox<unsigned int>(_coord.column) * 4u;
-            buffer_[base + 0] = _value.red;
-            buffer_[base + 1] = _value.green;
-            buffer_[base + 2] = _value.blue;
-            buffer_[base + 3] = 0xFF;
+            auto const base = static_cast<size_t>(line - takenRows_ + i) * pitch() + column * 4u;
+            if (base + count * 4u > buffer_.size())
+                break;
+
+            // Fill the whole run at once, which the compiler is free to vectorize.
+            uint8_t* target = buffer_.data() + base;
+            for (unsigned int k = 0; k < count; ++k, target += 4)
+                std::memcpy(target, pixel.data(), 4);
         }
     }
 }
@@ -453,7 +594,11 @@ void SixelImageBuilder::newline()
     sixelCursor_.column = {};
     if (unbox<unsigned int>(sixelCursor_.line) + sixelBandHeight_
         < unbox<unsigned int>(explicitSize_ ? size_.height : maxSize_.height))
+    {
         sixelCursor_.line = LineOffset::cast_from(sixelCursor_.line.as<unsigned int>() + sixelBandHeight_);
+        if (bandCompleted_)
+            bandCompleted_();
+    }
 }
 
 void SixelImageBuilder::setRaster(unsigned int _pan, unsigned int _pad, optional<ImageSize> _imageSize)
@@ -467,28 +612,36 @@ void SixelImageBuilder::setRaster(unsigned int _pan, unsigned int _pad, optional
         _imageSize->height = Height::cast_from(_imageSize->height.value * aspectRatio_);
         size_.width = clamp(_imageSize->width, Width(0), maxSize_.width);
         size_.height = clamp(_imageSize->height, Height(0), maxSize_.height);
-        buffer_.resize(size_.area() * 4);
         explicitSize_ = true;
+        // The row pitch has changed, so the rows are allocated anew as they are painted to.
+        buffer_.clear();
+        takenRows_ = 0;
     }
 }
 
-void SixelImageBuilder::render(int8_t _sixel)
+void SixelImageBuilder::render(int8_t _sixel, unsigned _count)
+{
+    sixelCursor_.column += ColumnOffset::cast_from(paint(sixelCursor_, _sixel, _count, currentColor()));
+}
+
+unsigned SixelImageBuilder::paint(CellLocation _cursor, int8_t _sixel, unsigned _count, RGBColor _color)
 {
     // TODO: respect aspect ratio!
-    auto const x = sixelCursor_.column;
-    if (unbox<int>(x) < unbox<int>((explicitSize_ ? size_.width : maxSize_.width)))
+    auto const x = _cursor.column;
+    auto const width = unbox<int>(explicitSize_ ? size_.width : maxSize_.width);
+    if (unbox<int>(x) >= width)
+        return 0;
+
+    auto const count = min(_count, static_cast<unsigned>(width - unbox<int>(x)));
+    for (unsigned int i = 0; i < 6; ++i)
     {
-        for (unsigned int i = 0; i < 6; ++i)
-        {
-            auto const y = sixelCursor_.line + static_cast<int>(i * aspectRatio_);
-            auto const pos = CellLocation { y, x };
-            auto const pin = 1 << i;
-            auto const pinned = (_sixel & pin) != 0;
-            if (pinned)
-                write(pos, currentColor());
-        }
-        sixelCursor_.column++;
+        auto const y = _cursor.line + static_cast<int>(i * aspectRatio_);
+        auto const pin = 1 << i;
+        auto const pinned = (_sixel & pin) != 0;
+        if (pinned)
+            write(CellLocation { y, x }, count, _color);
     }
+    return count;
 }
 
 void SixelImageBuilder::finalize()
@@ -496,9 +649,11 @@ void SixelImageBuilder::finalize()
     if (unbox<int>(size_.height) == 1)
     {
         size_.height = Height::cast_from(sixelCursor_.line.as<unsigned int>() * aspectRatio_);
+        allocateRows(unbox<unsigned int>(size_.height));
         buffer_.resize(size_.area() * 4);
         return;
     }
+    allocateRows(unbox<unsigned int>(size_.height));
     if (!explicitSize_)
     {
         Buffer tempBuffer(static_cast<size_t>(size_.height.value * size_.width.value) * 4);
@@ -516,4 +671,160 @@ void SixelImageBuilder::finalize()
     }
 }
 
+// {{{ band-parallel decoding
+class SixelImageBuilder::BandDecoder: public SixelParser::Events
+{
+  public:
+    BandDecoder(SixelImageBuilder& _image,
+                LineOffset _top,
+                std::shared_ptr<SixelColorPalette const> _colors,
+                unsigned _currentColor):
+        image_ { _image },
+        cursor_ { _top, ColumnOffset(0) },
+        colors_ { std::move(_colors) },
+        currentColor_ { _currentColor }
+    {
+    }
+
+    void setColor(unsigned _index, RGBColor const& _color) override
+    {
+        // The registers are shared with the other bands, so they are copied once they are modified.
+        if (!ownColors_)
+        {
+            ownColors_ = make_shared<SixelColorPalette>(*colors_);
+            colors_ = ownColors_;
+        }
+        ownColors_->setColor(_index, _color);
+    }
+
+    void useColor(unsigned _index) override { currentColor_ = _index % colors_->size(); }
+    void rewind() override { cursor_.column = {}; }
+    void newline() override {}
+    void setRaster(unsigned int, unsigned int, optional<ImageSize>) override {}
+
+    void render(int8_t _sixel, unsigned _count) override
+    {
+        auto const color = colors_->at(currentColor_);
+        cursor_.column += ColumnOffset::cast_from(image_.paint(cursor_, _sixel, _count, color));
+    }
+
+    void finalize() override {}
+
+  private:
+    SixelImageBuilder& image_;
+    CellLocation cursor_;
+    std::shared_ptr<SixelColorPalette const> colors_;
+    std::shared_ptr<SixelColorPalette> ownColors_;
+    unsigned currentColor_;
+};
+
+bool SixelImageBuilder::renderBands(string_view _data, unsigned _threadCount)
+{
+    auto scanner = SixelBandScanner(*colors_, currentColor_);
+    SixelParser::parse(_data, scanner);
+
+    auto const& raster = scanner.raster();
+    if (!raster || !raster->imageSize || scanner.lateRaster())
+        return false;
+
+    setRaster(raster->pan, raster->pad, raster->imageSize);
+
+    // The sixel-cursor stays on the last band once the image height has been reached,
+    // such that all further bands are painted onto the same rows, in order.
+    auto const& bands = scanner.bands();
+    auto lastPaintedBand = size_t { 0 };
+    for (size_t i = 0; i < bands.size(); ++i)
+        if (bands[i].painted)
+            lastPaintedBand = i;
+    if (lastPaintedBand * sixelBandHeight_ >= unbox<unsigned int>(size_.height))
+        return false;
+
+    // With all rows allocated upfront, the bands write to disjoint parts of the buffer only.
+    allocateRows(unbox<unsigned int>(size_.height));
+
+    auto bandData = vector<string_view> {};
+    bandData.reserve(bands.size());
+    for (size_t offset = 0;;)
+    {
+        auto const end = _data.find('-', offset);
+        bandData.emplace_back(_data.substr(offset, end - offset));
+        if (end == string_view::npos)
+            break;
+        offset = end + 1;
+    }
+    assert(bandData.size() == bands.size());
+
+    auto const decode = [&](size_t _begin, size_t _end) {
+        for (auto i = _begin; i < _end; ++i)
+        {
+            auto const top = LineOffset::cast_from(i * sixelBandHeight_);
+            auto decoder = BandDecoder(*this, top, bands[i].colors, bands[i].currentColor);
+            SixelParser::parse(bandData[i], decoder);
+        }
+    };
+
+    // The first range of bands is decoded on the calling thread, all others concurrently.
+    auto const bandCount = lastPaintedBand + 1;
+    auto const threadCount = clamp(static_cast<size_t>(_threadCount), size_t { 1 }, bandCount);
+    auto ranges = vector<std::future<void>> {};
+    for (size_t k = 1; k < threadCount; ++k)
+        ranges.emplace_back(std::async(
+            std::launch::async, decode, bandCount * k / threadCount, bandCount * (k + 1) / threadCount));
+    decode(0, bandCount / threadCount);
+    for (auto& range: ranges)
+        range.get();
+
+    // Leave the builder as if the data had been rendered sequentially.
+    *colors_ = scanner.colors();
+    currentColor_ = scanner.currentColor();
+    sixelCursor_.line = LineOffset::cast_from(lastPaintedBand * sixelBandHeight_);
+    sixelCursor_.column = {};
+    return true;
+}
+
+ParallelSixelParser::ParallelSixelParser(SixelImageBuilder& _builder,
+                                         unsigned _threadCount,
+                                         SixelParser::OnFinalize _finalizer):
+    builder_ { _builder }, threadCount_ { _threadCount }, finalizer_ { std::move(_finalizer) }
+{
+}
+
+void ParallelSixelParser::startStreaming()
+{
+    streaming_ = make_unique<SixelParser>(builder_, std::move(finalizer_));
+    streaming_->parseFragment(data_);
+    data_ = {};
+}
+
+void ParallelSixelParser::pass(char _char)
+{
+    if (streaming_)
+    {
+        streaming_->pass(_char);
+        return;
+    }
+
+    data_.push_back(_char);
+    if (data_.size() > MaxDataSize)
+        startStreaming();
+}
+
+void ParallelSixelParser::finalize()
+{
+    if (!streaming_ && (data_.size() < MinDataSize || !builder_.renderBands(data_, threadCount_)))
+        startStreaming();
+
+    if (streaming_)
+    {
+        streaming_->done();
+        return;
+    }
+
+    data_ = {};
+    builder_.finalize();
+    if (finalizer_)
+        finalizer_();
+}
+// }}}
+
 } // namespace terminal
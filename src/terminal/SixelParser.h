@@ -20,8 +20,10 @@
 #include <crispy/range.h>
 
 #include <array>
+#include <functional>
 #include <memory>
 #include <optional>
+#include <string>
 #include <string_view>
 #include <vector>
 
@@ -74,8 +76,11 @@ class SixelParser: public ParserExtension
         /// the upcoming pixel data.
         virtual void setRaster(unsigned int _pan, unsigned int _pad, std::optional<ImageSize> _imageSize) = 0;
 
-        /// renders a given sixel at the current sixel-cursor position.
-        virtual void render(int8_t _sixel) = 0;
+        /// Renders the given sixel @p _count times, starting at the current sixel-cursor position.
+        ///
+        /// Runs of the same sixel, either repeated explicitly ('!') or implicitly (by sending
+        /// the same sixel multiple times in a row), are passed at once.
+        virtual void render(int8_t _sixel, unsigned _count) = 0;
 
         /// Finalizes the image by optimizing the underlying storage to its minimal dimension in storage.
         virtual void finalize() = 0;
@@ -86,11 +91,7 @@ class SixelParser: public ParserExtension
 
     using iterator = char const*;
 
-    void parseFragment(iterator _begin, iterator _end)
-    {
-        for (auto const ch: crispy::range(_begin, _end))
-            parse(ch);
-    }
+    void parseFragment(iterator _begin, iterator _end);
 
     void parseFragment(std::string_view _range)
     {
@@ -117,11 +118,16 @@ class SixelParser: public ParserExtension
     void enterState();
     void leaveState();
     void fallback(char _value);
+    void flushPendingSixels();
 
   private:
     State state_ = State::Ground;
     std::vector<unsigned> params_;
 
+    // Run of the same sixel not yet passed to the events handler.
+    char pendingSixel_ = 0;
+    unsigned pendingSixelCount_ = 0;
+
     Events& events_;
     OnFinalize finalizer_;
 };
@@ -150,10 +156,15 @@ class SixelColorPalette
 /// Sixel Image Builder API
 ///
 /// Implements the SixelParser::Events event listener to construct a Sixel image.
+///
+/// Pixel rows are allocated as they are painted to, and rows that no sixel can be painted to anymore
+/// may be taken off the image while it is still being received (see takeRows()),
+/// allowing the image to be displayed progressively.
 class SixelImageBuilder: public SixelParser::Events
 {
   public:
     using Buffer = std::vector<uint8_t>;
+    using OnBandCompleted = std::function<void()>;
 
     SixelImageBuilder(ImageSize _maxSize,
                       int _aspectVertical,
@@ -163,34 +174,82 @@ class SixelImageBuilder: public SixelParser::Events
 
     [[nodiscard]] ImageSize maxSize() const noexcept { return maxSize_; }
     [[nodiscard]] ImageSize size() const noexcept { return size_; }
+    [[nodiscard]] bool explicitSize() const noexcept { return explicitSize_; }
     [[nodiscard]] unsigned int aspectRatio() const noexcept { return aspectRatio_; }
     [[nodiscard]] RGBColor currentColor() const noexcept { return colors_->at(currentColor_); }
 
     [[nodiscard]] RGBAColor at(CellLocation _coord) const noexcept;
 
+    /// @returns the RGBA pixels of all rows that have not been taken off yet.
     [[nodiscard]] Buffer const& data() const noexcept { return buffer_; }
     [[nodiscard]] Buffer& data() noexcept { return buffer_; }
 
     void clear(RGBAColor _fillColor);
 
+    /// Sets the handler to be invoked each time the sixel-cursor has moved on to the next sixel band.
+    void setBandCompletedHandler(OnBandCompleted _handler) { bandCompleted_ = std::move(_handler); }
+
+    /// @returns the number of pixel rows already taken off the top of the image.
+    [[nodiscard]] unsigned int takenRowCount() const noexcept { return takenRows_; }
+
+    /// @returns the number of pixel rows above the current sixel band that have not been taken yet.
+    ///
+    /// This is always 0 unless the image size was given via raster attributes, because only then
+    /// the final width of those rows is known in advance.
+    [[nodiscard]] unsigned int completedRowCount() const noexcept;
+
+    /// Takes the first @p _count completed rows off the image.
+    ///
+    /// @returns the RGBA pixels of the taken rows.
+    [[nodiscard]] Buffer takeRows(unsigned int _count);
+
+    /// Renders a complete sixel data string, decoding its sixel bands concurrently on up to
+    /// @p _threadCount threads, each band directly into its own pixel rows.
+    ///
+    /// Bands only depend on each other by the color registers and the color they start with.
+    /// These are resolved by a sequential pass over the data first, which skips the pixels.
+    ///
+    /// @retval false the image does not give its size upfront via raster attributes, which is required
+    ///               to know the rows of each band in advance, and nothing has been rendered.
+    bool renderBands(std::string_view _data, unsigned _threadCount);
+
     void setColor(unsigned _index, RGBColor const& _color) override;
     void useColor(unsigned _index) override;
     void rewind() override;
     void newline() override;
     void setRaster(unsigned int _pan, unsigned int _pad, std::optional<ImageSize> _imageSize) override;
-    void render(int8_t _sixel) override;
+    void render(int8_t _sixel, unsigned _count) override;
     void finalize() override;
 
     [[nodiscard]] CellLocation const& sixelCursor() const noexcept { return sixelCursor_; }
 
   private:
-    void write(CellLocation const& _coord, RGBColor const& _value) noexcept;
+    class BandDecoder;
+
+    /// Writes @p _count pixels of the given color, starting at the given position to the right.
+    void write(CellLocation const& _coord, unsigned _count, RGBColor const& _value);
+
+    /// Paints the given sixel @p _count times, starting at the given sixel-cursor position.
+    ///
+    /// @returns the number of columns painted.
+    unsigned paint(CellLocation _cursor, int8_t _sixel, unsigned _count, RGBColor _color);
+
+    /// Ensures the pixel rows up to (excluding) @p _rowEnd are allocated.
+    void allocateRows(unsigned int _rowEnd);
+
+    [[nodiscard]] unsigned int pitch() const noexcept
+    {
+        return unbox<unsigned int>(explicitSize_ ? size_.width : maxSize_.width) * 4u;
+    }
 
   private:
     ImageSize const maxSize_;
     std::shared_ptr<SixelColorPalette> colors_;
     ImageSize size_;
-    Buffer buffer_; /// RGBA buffer
+    RGBAColor backgroundColor_;
+    Buffer buffer_;              /// RGBA buffer, starting at pixel row takenRows_.
+    unsigned int takenRows_ = 0; /// Number of pixel rows already taken off the top of the image.
+    OnBandCompleted bandCompleted_;
     CellLocation sixelCursor_;
     unsigned currentColor_;
     bool explicitSize_ = false;
@@ -201,4 +260,33 @@ class SixelImageBuilder: public SixelParser::Events
     unsigned int sixelBandHeight_;
 };
 
+/// Collects a complete sixel data string, to have its bands decoded in parallel once it has been
+/// received (see SixelImageBuilder::renderBands()).
+///
+/// Small images, and images whose bands cannot be decoded in parallel, are parsed just like
+/// by SixelParser. So are data strings exceeding MaxDataSize, as soon as they do, rather than
+/// holding them in memory in full.
+class ParallelSixelParser: public ParserExtension
+{
+  public:
+    static constexpr size_t MinDataSize = 64 * 1024;
+    static constexpr size_t MaxDataSize = 64 * 1024 * 1024;
+
+    ParallelSixelParser(SixelImageBuilder& _builder,
+                        unsigned _threadCount,
+                        SixelParser::OnFinalize _finalizer = {});
+
+    void pass(char _char) override;
+    void finalize() override;
+
+  private:
+    void startStreaming();
+
+    SixelImageBuilder& builder_;
+    unsigned threadCount_;
+    SixelParser::OnFinalize finalizer_;
+    std::string data_;
+    std::unique_ptr<SixelParser> streaming_; //!< parses the data as it is received, if set
+};
+
 } // namespace terminal
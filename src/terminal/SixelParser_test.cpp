@@ -249,6 +249,36 @@ TEST_CASE("SixelParser.rep", "[sixel]")
     }
 }
 
+TEST_CASE("SixelParser.run", "[sixel]")
+{
+    auto constexpr defaultColor = RGBAColor { 0, 0, 0, 0xFF };
+    auto constexpr pinColor = RGBColor { 0x10, 0x20, 0x30 };
+    auto ib = sixelImageBuilder(ImageSize { Width(6), Height(8) }, defaultColor);
+    auto sp = SixelParser { ib };
+
+    ib.setColor(0, pinColor);
+
+    // Passed one by one, as the VT parser does, and running past the right edge of the image.
+    for (char const ch: std::string_view { "A~~~~~~~~" })
+        sp.pass(ch);
+    sp.finalize();
+
+    CHECK(ib.sixelCursor() == CellLocation { LineOffset(0), ColumnOffset(6) });
+
+    for (int x = 0; x < ib.size().width.as<int>(); ++x)
+    {
+        for (int y = 0; y < ib.size().height.as<int>(); ++y)
+        {
+            auto const& actualColor = ib.at(CellLocation { LineOffset(y), ColumnOffset(x) });
+            auto const pinned = x == 0 ? y == 1 : y < 6;
+            if (pinned)
+                CHECK(actualColor.rgb() == pinColor);
+            else
+                CHECK(actualColor == defaultColor);
+        }
+    }
+}
+
 TEST_CASE("SixelParser.setAndUseColor", "[sixel]")
 {
     auto constexpr pinColors = std::array<RGBAColor, 5> { RGBAColor { 255, 255, 255, 255 },
@@ -374,3 +404,36 @@ TEST_CASE("SixelParser.vertical_cursor_advance", "[sixel]")
     REQUIRE(ib.size() == terminal::ImageSize { Width(1), Height(24) });
     REQUIRE(ib.sixelCursor() == CellLocation { LineOffset(24), ColumnOffset { 0 } });
 }
+
+TEST_CASE("SixelParser.renderBands", "[sixel]")
+{
+    auto constexpr defaultColor = RGBAColor { 0, 0, 0, 255 };
+    auto const makeBuilder = [&]() {
+        return SixelImageBuilder(
+            { Width(8), Height(30) }, 1, 1, defaultColor, std::make_shared<SixelColorPalette>(16, 256));
+    };
+
+    // The color of the first band carries over to the second one, and color #1 is redefined
+    // in the third band, which must not affect the bands before.
+    auto constexpr data = std::string_view { "\"1;1;8;24#1;2;100;0;0#2;2;0;100;0#1!8~-"
+                                             "!4~#2!4~-"
+                                             "#1!2~#1;2;0;0;100!6~-"
+                                             "#2~~$#1@@-" };
+
+    auto sequential = makeBuilder();
+    SixelParser::parse(data, sequential);
+
+    auto parallel = makeBuilder();
+    REQUIRE(parallel.renderBands(data, 4));
+    parallel.finalize();
+
+    CHECK(parallel.size() == sequential.size());
+    CHECK(parallel.data() == sequential.data());
+    CHECK(parallel.currentColor() == sequential.currentColor());
+    CHECK(parallel.at(CellLocation { LineOffset(6), ColumnOffset(0) }) == RGBAColor { 255, 0, 0, 255 });
+    CHECK(parallel.at(CellLocation { LineOffset(12), ColumnOffset(7) }) == RGBAColor { 0, 0, 255, 255 });
+
+    // Without the image size given upfront, the rows of the bands are not known in advance.
+    auto unsized = makeBuilder();
+    CHECK_FALSE(unsized.renderBands("#1~~-~~", 4));
+}
@@ -13,12 +13,15 @@
  */
 #include <terminal/ControlCode.h>
 #include <terminal/InputGenerator.h>
+#include <terminal/OpStream.h>
 #include <terminal/RenderBuffer.h>
 #include <terminal/RenderBufferBuilder.h>
 #include <terminal/Terminal.h>
 #include <terminal/logging.h>
 #include <terminal/pty/MockPty.h>
 
+#include <crispy/HugePages.h>
+#include <crispy/StartupTrace.h>
 #include <crispy/escape.h>
 #include <crispy/stdfs.h>
 #include <crispy/utils.h>
@@ -29,6 +32,8 @@
 
 #include <sys/types.h>
 
+#include <algorithm>
+#include <array>
 #include <chrono>
 #include <csignal>
 #include <iostream>
@@ -49,10 +54,18 @@ namespace // {{{ helpers
 {
     constexpr size_t MaxColorPaletteSaveStackSize = 10;
 
-    void trimSpaceRight(string& value)
+    // Minimum number of lines per band when building the render buffer concurrently.
+    constexpr int MinRenderBandLines = 16;
+
+    // Share of a buffer object's capacity that scrollback lines must reference at least,
+    // below which their text is copied out of it, see Grid::compactTextBuffers().
+    constexpr float TextBufferLoadFactor = 0.25f;
+
+    template <typename Cell>
+    size_t linesMemory(Grid<Cell> const& _grid)
     {
-        while (!value.empty() && value.back() == ' ')
-            value.pop_back();
+        auto const usage = _grid.memoryUsage();
+        return usage.trivialBytes + usage.inflatedBytes + usage.attributedBytes;
     }
 
     string_view modeString(ViMode mode) noexcept
@@ -68,6 +81,13 @@ namespace // {{{ helpers
         crispy::unreachable();
     }
 
+    std::chrono::microseconds refreshIntervalOf(double _refreshRate) noexcept
+    {
+        if (_refreshRate <= 0.0)
+            _refreshRate = 30.0;
+        return std::chrono::microseconds(static_cast<long long>(1'000'000.0 / _refreshRate));
+    }
+
     std::string codepointText(std::u32string const& codepoints)
     {
         std::string text;
@@ -80,6 +100,21 @@ namespace // {{{ helpers
         return text;
     }
 
+    /// Memory of the subsystems shared by all sessions of the process.
+    struct ProcessMemoryStats
+    {
+        crispy::MemoryStats cellExtras { "Cell extras" };
+        crispy::MemoryStats graphemeClusters { "Grapheme clusters" };
+        crispy::MemoryStats lineBufferPool { "Line buffer pool" };
+
+        static ProcessMemoryStats& get()
+        {
+            // Intentionally never destroyed, as sessions may publish as late as during static destruction.
+            static auto* instance = new ProcessMemoryStats();
+            return *instance;
+        }
+    };
+
 #if defined(CONTOUR_PERF_STATS)
     void logRenderBufferSwap(bool _success, uint64_t _frameID)
     {
@@ -114,7 +149,7 @@ Terminal::Terminal(unique_ptr<Pty> _pty,
                    chrono::milliseconds _highlightTimeout):
     changes_ { 0 },
     eventListener_ { _eventListener },
-    refreshInterval_ { static_cast<long long>(1000.0 / _refreshRate) },
+    refreshInterval_ { refreshIntervalOf(_refreshRate) },
     renderBuffer_ {},
     pty_ { std::move(_pty) },
     startTime_ { _now },
@@ -139,7 +174,11 @@ Terminal::Terminal(unique_ptr<Pty> _pty,
     // clang-format on
     ptyBufferPool_ { crispy::nextPowerOfTwo(ptyBufferObjectSize) },
     currentPtyBuffer_ { ptyBufferPool_.allocateBufferObject() },
-    ptyReadBufferSize_ { crispy::nextPowerOfTwo(_ptyReadBufferSize) },
+    maxPtyReadSize_ { std::max(crispy::nextPowerOfTwo(_ptyReadBufferSize),
+                               crispy::nextPowerOfTwo(ptyBufferObjectSize) / 4) },
+    ptyReadSize_ {
+        std::clamp(crispy::nextPowerOfTwo(_ptyReadBufferSize), MinimumPtyReadSize, maxPtyReadSize_)
+    },
     primaryScreen_ { state_, state_.primaryBuffer },
     alternateScreen_ { state_, state_.alternateBuffer },
     hostWritableStatusLineScreen_ { state_, state_.hostWritableStatusBuffer },
@@ -154,6 +193,7 @@ Terminal::Terminal(unique_ptr<Pty> _pty,
     highlightTimeout_(_highlightTimeout)
 {
     state_.savedColorPalettes.reserve(MaxColorPaletteSaveStackSize);
+    state_.inputGenerator.setMouseMoveReportInterval(refreshInterval_);
 #if 0
     hardReset();
 #else
@@ -165,9 +205,24 @@ Terminal::Terminal(unique_ptr<Pty> _pty,
 #endif
 }
 
+Terminal::~Terminal()
+{
+    {
+        auto const _ = std::lock_guard { liveness_->lock };
+        liveness_->alive = false;
+    }
+    stopPtyReaderThread();
+    cancelSearchInBackground();
+    for (auto& job: searchJobs_)
+        job.wait();
+    if (selectionJob_.valid())
+        selectionJob_.wait();
+}
+
 void Terminal::setRefreshRate(double _refreshRate)
 {
-    refreshInterval_ = std::chrono::milliseconds(static_cast<long long>(1000.0 / _refreshRate));
+    refreshInterval_ = refreshIntervalOf(_refreshRate);
+    state_.inputGenerator.setMouseMoveReportInterval(refreshInterval_);
 }
 
 void Terminal::setLastMarkRangeOffset(LineOffset _value) noexcept
@@ -175,13 +230,16 @@ void Terminal::setLastMarkRangeOffset(LineOffset _value) noexcept
     copyLastMarkRangeOffset_ = _value;
 }
 
-Pty::ReadResult Terminal::readFromPty()
+std::chrono::milliseconds Terminal::ptyReadTimeout() const noexcept
 {
-    auto const timeout = renderBuffer_.state == RenderBufferState::WaitingForRefresh && !screenDirty_
-                             ? std::chrono::seconds(4)
-                             //: refreshInterval_ : std::chrono::seconds(0)
-                             : std::chrono::seconds(30);
+    return renderBuffer_.state == RenderBufferState::WaitingForRefresh && !screenDirty_
+               ? std::chrono::seconds(4)
+               //: refreshInterval_ : std::chrono::seconds(0)
+               : std::chrono::seconds(30);
+}
 
+Pty::ReadResult Terminal::readFromPty(std::chrono::milliseconds _timeout)
+{
     // Request a new Buffer Object if the current one cannot sufficiently
     // store a single text line.
     if (currentPtyBuffer_->bytesAvailable() < unbox<size_t>(state_.pageSize.columns))
@@ -192,12 +250,95 @@ Pty::ReadResult Terminal::readFromPty()
         currentPtyBuffer_ = ptyBufferPool_.allocateBufferObject();
     }
 
-    return pty_->read(*currentPtyBuffer_, timeout, ptyReadBufferSize_);
+    auto result = pty_->read(*currentPtyBuffer_, _timeout, ptyReadSize_);
+    if (result)
+    {
+        crispy::StartupTrace::get().instant("First PTY output");
+        adaptPtyReadSize(get<0>(*result).size());
+    }
+    return result;
+}
+
+void Terminal::adaptPtyReadSize(size_t _bytesRead) noexcept
+{
+    // Number of consecutive reads of the same kind before changing the read size,
+    // such that a single burst of output does not flip-flop the read size.
+    constexpr unsigned Hysteresis = 4;
+
+    auto const readSize = ptyReadSize_.load();
+    if (_bytesRead >= readSize)
+    {
+        smallPtyReadCount_ = 0;
+        if (++fullPtyReadCount_ >= Hysteresis / 2 && readSize < maxPtyReadSize_)
+        {
+            fullPtyReadCount_ = 0;
+            ptyReadSize_ = std::min(readSize * 2, maxPtyReadSize_);
+            if (PtyInLog)
+                PtyInLog()("Growing PTY read size to {}.", ptyReadSize_.load());
+        }
+    }
+    else if (_bytesRead < readSize / 8)
+    {
+        fullPtyReadCount_ = 0;
+        if (++smallPtyReadCount_ >= Hysteresis && readSize > MinimumPtyReadSize)
+        {
+            smallPtyReadCount_ = 0;
+            ptyReadSize_ = std::max(readSize / 2, MinimumPtyReadSize);
+            if (PtyInLog)
+                PtyInLog()("Shrinking PTY read size to {}.", ptyReadSize_.load());
+        }
+    }
+    else
+    {
+        fullPtyReadCount_ = 0;
+        smallPtyReadCount_ = 0;
+    }
+}
+
+void Terminal::compactPtyBuffersIfNeeded()
+{
+    // Number of additional buffer objects in use before looking for sparsely referenced ones again.
+    constexpr size_t CompactionInterval = 4;
+
+    // Overall share of the referenced buffer objects' capacity actually used by lines,
+    // below which buffer objects that are referenced less than TextBufferLoadFactor get compacted.
+    constexpr float GridLoadFactor = 0.5f;
+
+    // Number of scrollback lines looked at per call, such that a pass over a large scrollback
+    // is spread over several reads rather than stalling one of them.
+    constexpr auto CompactionLinesPerStep = LineCount(4096);
+
+    auto& grid = primaryScreen_.grid();
+    if (!grid.compactingTextBuffers())
+    {
+        auto const liveBuffers = ptyBufferPool_.stats().liveBuffers;
+        ptyBuffersAtLastCompaction_ = std::min(ptyBuffersAtLastCompaction_, liveBuffers);
+        if (liveBuffers < ptyBuffersAtLastCompaction_ + CompactionInterval)
+            return;
+    }
+
+    if (grid.compactTextBuffersStep(TextBufferLoadFactor, GridLoadFactor, CompactionLinesPerStep))
+        ptyBuffersAtLastCompaction_ = ptyBufferPool_.stats().liveBuffers;
 }
 
 bool Terminal::processInputOnce()
 {
-    auto const readResult = readFromPty();
+    if (ptyReaderThread_)
+        return processQueuedInputOnce();
+
+    return processPtyInput(ptyReadTimeout());
+}
+
+bool Terminal::processAvailableInput()
+{
+    assert(!ptyReaderThread_);
+    return processPtyInput(std::chrono::milliseconds(0));
+}
+
+bool Terminal::processPtyInput(std::chrono::milliseconds _timeout)
+{
+    auto const readSize = ptyReadSize_.load();
+    auto const readResult = readFromPty(_timeout);
 
     if (!readResult)
     {
@@ -205,8 +346,14 @@ bool Terminal::processInputOnce()
         {
             TerminalLog()("PTY read failed. {}", strerror(errno));
             pty_->close();
+            return false;
         }
-        return errno == EINTR || errno == EAGAIN;
+
+        // The previous read filled the whole read buffer, but there was no more output after all.
+        // The final screen state is reported now, which fast-forwarding may have held back.
+        if (fastForwarding_)
+            ptyInputProcessed(false);
+        return true;
     }
     string_view const buf = get<0>(*readResult);
     state_.usingStdoutFastPipe = get<1>(*readResult);
@@ -218,20 +365,281 @@ bool Terminal::processInputOnce()
         return true;
     }
 
+    if (ptyRecorder_)
+        ptyRecorder_->recordOutput(buf);
+
+    if (state_.sequenceProfiler)
+        state_.sequenceProfiler->recordInput(buf.size());
+
     {
-        auto const _l = std::lock_guard { *this };
-        state_.parser.parseFragment(buf);
+        auto const _m = pipelineStats_.parsing.measure();
+        for (auto output = buf; !output.empty();)
+        {
+            auto const slice = output.substr(0, ParseSliceSize);
+            output.remove_prefix(slice.size());
+            {
+                auto const _l = std::lock_guard { *this };
+                state_.parser.parseFragment(slice);
+                if (output.empty())
+                {
+                    compactPtyBuffersIfNeeded();
+                    detectKeyPressEcho(steady_clock::now());
+                }
+            }
+            yieldToPendingInput();
+        }
     }
 
-    if (!state_.modes.enabled(DECMode::BatchedRendering))
-        screenUpdated();
+    // A read that filled the whole read buffer most likely left more output behind in the PTY.
+    ptyInputProcessed(buf.size() >= readSize);
+
+#if defined(LIBTERMINAL_PASSIVE_RENDER_BUFFER_UPDATE)
+    if (visible_)
+        ensureFreshRenderBuffer();
+#endif
+
+    return true;
+}
+
+void Terminal::yieldToPendingInput()
+{
+    // Unlocking the mutex alone does not hand it over to a waiting thread,
+    // which would mostly lose the race against relocking it for the next slice.
+    if (inputPending_.exchange(false, std::memory_order_relaxed))
+        std::this_thread::yield();
+}
+
+void Terminal::ptyInputProcessed(bool _moreInputPending)
+{
+    if (fastForwarding_ != _moreInputPending)
+    {
+        fastForwarding_ = _moreInputPending;
+        if (PtyInLog)
+            PtyInLog()("{} fast-forwarding.", _moreInputPending ? "Start" : "Stop");
+    }
+
+    // While flooded, intermediate screen states are not worth rendering, as they would be
+    // outdated by the time they are presented anyways.
+    if (_moreInputPending)
+    {
+        auto const now = steady_clock::now();
+        if (now - lastFastForwardFrame_ < FastForwardFrameInterval)
+            return;
+        lastFastForwardFrame_ = now;
+    }
+
+    screenUpdated();
+}
+
+// {{{ PTY reader thread
+void Terminal::startPtyReaderThread(bool _pipelinedParsing)
+{
+    assert(!ptyReaderThread_);
+    ptyInputPipelined_ = _pipelinedParsing;
+    ptyReaderThread_ = make_unique<std::thread>(&Terminal::ptyReaderLoop, this);
+}
+
+void Terminal::stopPtyReaderThread()
+{
+    if (!ptyReaderThread_)
+        return;
+
+    ptyReaderStopping_ = true;
+    {
+        auto const _ = std::lock_guard { ptyInputMutex_ };
+    }
+    ptyInputCondition_.notify_all();
+    pty_->wakeupReader();
+    ptyReaderThread_->join();
+    ptyReaderThread_.reset();
+}
+
+void Terminal::ptyReaderLoop()
+{
+    TerminalLog()("PTY reader thread started{}.", ptyInputPipelined_ ? " (pipelined parsing)" : "");
+
+    // Only used for pipelined parsing.
+    auto opStreamWriter = OpStreamWriter {};
+    auto opStreamParser = parser::Parser<ParserEvents> { opStreamWriter };
+
+    auto buffer = ptyBufferPool_.allocateBufferObject();
+    while (!ptyReaderStopping_)
+    {
+        // Every read claims its region of the buffer object until it has been parsed,
+        // so continue with a fresh buffer object once the current one cannot hold a reasonably sized read.
+        if (buffer->bytesAvailable() < std::min(ptyReadSize_.load(), buffer->capacity() / 4))
+            buffer = ptyBufferPool_.allocateBufferObject();
+
+        auto const readResult = pty_->read(*buffer, std::chrono::seconds(30), ptyReadSize_);
+        if (!readResult)
+        {
+            if (errno == EINTR)
+            {
+                // Someone wants the input loop to wake up, e.g. for refreshing the render buffer.
+                wakeupPtyInputConsumer();
+                continue;
+            }
+            if (errno == EAGAIN)
+                continue;
+            TerminalLog()("PTY read failed. {}", strerror(errno));
+            break;
+        }
+
+        auto const [data, fromStdoutFastPipe] = *readResult;
+        if (data.empty())
+        {
+            TerminalLog()("PTY read returned with zero bytes.");
+            break;
+        }
+        crispy::StartupTrace::get().instant("First PTY output");
+        adaptPtyReadSize(data.size());
+
+        if (ptyRecorder_)
+            ptyRecorder_->recordOutput(data);
+
+        {
+            auto const _l = scoped_lock { *buffer };
+            buffer->advance(data.size());
+        }
+
+        auto ops = string {};
+        if (ptyInputPipelined_)
+        {
+            opStreamWriter.begin(data);
+            opStreamParser.parseFragment(data);
+            ops = opStreamWriter.finish();
+        }
+        pushPtyInput(buffer, data, fromStdoutFastPipe, std::move(ops));
+    }
+
+    // Signal the end of input to the consumer.
+    if (!ptyReaderStopping_)
+        pushPtyInput(nullptr, {}, false, {});
+
+    TerminalLog()("PTY reader thread terminated.");
+}
+
+void Terminal::pushPtyInput(crispy::BufferObjectPtr<char> _buffer,
+                            std::string_view _data,
+                            bool _fromStdoutFastPipe,
+                            std::string _ops)
+{
+    auto chunk = PtyInputChunk {
+        std::move(_buffer), _data, _fromStdoutFastPipe, std::move(_ops), std::chrono::steady_clock::now()
+    };
+    while (!ptyInputQueue_.tryPush(std::move(chunk)))
+    {
+        // The parser is falling behind; wait for it rather than reading further ahead.
+        auto lock = std::unique_lock { ptyInputMutex_ };
+        ptyInputProducerParked_ = true;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        ptyInputCondition_.wait(lock, [this]() { return !ptyInputQueue_.full() || ptyReaderStopping_; });
+        ptyInputProducerParked_ = false;
+        if (ptyReaderStopping_)
+            return;
+    }
+
+    // Only touch the mutex if the consumer is actually waiting for input.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (ptyInputConsumerParked_)
+    {
+        {
+            auto const _ = std::lock_guard { ptyInputMutex_ };
+        }
+        ptyInputCondition_.notify_all();
+    }
+}
+
+void Terminal::wakeupPtyInputConsumer()
+{
+    {
+        auto const _ = std::lock_guard { ptyInputMutex_ };
+        ptyInputWakeupPending_ = true;
+    }
+    ptyInputCondition_.notify_all();
+}
+
+bool Terminal::processQueuedInputOnce()
+{
+    auto chunk = ptyInputQueue_.tryPop();
+    if (!chunk)
+    {
+        auto lock = std::unique_lock { ptyInputMutex_ };
+        ptyInputConsumerParked_ = true;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        ptyInputCondition_.wait_for(lock, ptyReadTimeout(), [this]() {
+            return ptyInputWakeupPending_ || !ptyInputQueue_.empty();
+        });
+        ptyInputConsumerParked_ = false;
+        ptyInputWakeupPending_ = false;
+        lock.unlock();
+
+        chunk = ptyInputQueue_.tryPop();
+        if (!chunk)
+            return true; // Timed out or woken up.
+    }
+
+    // Only touch the mutex if the reader is actually waiting for the queue to drain.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (ptyInputProducerParked_)
+    {
+        {
+            auto const _ = std::lock_guard { ptyInputMutex_ };
+        }
+        ptyInputCondition_.notify_all();
+    }
+
+    if (!chunk->buffer)
+    {
+        TerminalLog()("PTY reader reached end of input. Closing PTY.");
+        pty_->close();
+        return false;
+    }
+
+    state_.usingStdoutFastPipe = chunk->fromStdoutFastPipe;
+
+    {
+        pipelineStats_.queueing.record(std::chrono::steady_clock::now() - chunk->readTime);
+        if (state_.sequenceProfiler)
+            state_.sequenceProfiler->recordInput(chunk->data.size());
+        auto const _m = pipelineStats_.parsing.measure();
+        // An op stream is applied as a whole, as it cannot be split up at arbitrary offsets.
+        auto const sliceSize = ptyInputPipelined_ ? chunk->data.size() : ParseSliceSize;
+        for (auto output = chunk->data; !output.empty();)
+        {
+            auto const slice = output.substr(0, sliceSize);
+            output.remove_prefix(slice.size());
+            {
+                auto const _l = std::lock_guard { *this };
+                // Let the grid reference the text right within the reader's buffer object.
+                auto const ownBuffer = std::exchange(currentPtyBuffer_, chunk->buffer);
+                parsingQueuedPtyInput_ = true;
+                if (ptyInputPipelined_)
+                    applyOpStream(chunk->ops, slice, state_.sequencer, state_.parser);
+                else
+                    state_.parser.parseFragment(slice);
+                parsingQueuedPtyInput_ = false;
+                currentPtyBuffer_ = ownBuffer;
+                if (output.empty())
+                {
+                    compactPtyBuffersIfNeeded();
+                    detectKeyPressEcho(chunk->readTime);
+                }
+            }
+            yieldToPendingInput();
+        }
+    }
+
+    ptyInputProcessed(!ptyInputQueue_.empty());
 
 #if defined(LIBTERMINAL_PASSIVE_RENDER_BUFFER_UPDATE)
-    ensureFreshRenderBuffer();
+    if (visible_)
+        ensureFreshRenderBuffer();
 #endif
 
     return true;
 }
+// }}}
 
 // {{{ RenderBuffer synchronization
 void Terminal::breakLoopAndRefreshRenderBuffer()
@@ -239,10 +647,9 @@ void Terminal::breakLoopAndRefreshRenderBuffer()
     changes_++;
     renderBuffer_.state = RenderBufferState::RefreshBuffersAndTrySwap;
 
-    // if (this_thread::get_id() == mainLoopThreadID_)
-    //     return;
-
+#if defined(LIBTERMINAL_PASSIVE_RENDER_BUFFER_UPDATE)
     pty_->wakeupReader();
+#endif
 }
 
 bool Terminal::refreshRenderBuffer(bool _locked)
@@ -254,14 +661,17 @@ bool Terminal::refreshRenderBuffer(bool _locked)
 
 bool Terminal::ensureFreshRenderBuffer(bool _locked)
 {
-    if (!renderBufferUpdateEnabled_)
+    if (renderBufferUpdateHeldBack(currentTime_))
     {
         // renderBuffer_.state = RenderBufferState::WaitingForRefresh;
         return false;
     }
 
     auto const elapsed = currentTime_ - renderBuffer_.lastUpdate;
-    auto const avoidRefresh = elapsed < refreshInterval_;
+    auto const interval =
+        fastForwarding_ ? max(refreshInterval_, microseconds(FastForwardFrameInterval))
+                        : refreshInterval_;
+    auto const avoidRefresh = elapsed < interval;
 
     switch (renderBuffer_.state)
     {
@@ -338,10 +748,10 @@ int Terminal::SelectionHelper::cellWidth(CellLocation _pos) const noexcept
  */
 struct ScopedHyperlinkHover
 {
-    shared_ptr<HyperlinkInfo const> const href;
+    HyperlinkInfo const* const href;
 
     ScopedHyperlinkHover(Terminal const& terminal, ScreenBase const& /*screen*/):
-        href { terminal.tryGetHoveringHyperlink() }
+        href { terminal.state().hyperlinks.hyperlinkById(terminal.hoveringHyperlinkId()) }
     {
         if (href)
             href->state = HyperlinkState::Hover; // TODO: Left-Ctrl pressed?
@@ -365,10 +775,13 @@ void Terminal::updateInputMethodPreeditString(std::string preeditString)
 
 void Terminal::refreshRenderBufferInternal(RenderBuffer& _output)
 {
+    auto const _m = pipelineStats_.refreshRenderBuffer.measure();
     verifyState();
 
     auto const lastCursorPos = std::move(_output.cursor);
-    _output.clear();
+
+    // A render buffer that got refreshed again before being rendered drops the measurement.
+    _output.echoedKeyPress = std::exchange(echoedKeyPress_, nullopt);
 
     changes_.store(0);
     screenDirty_ = false;
@@ -379,27 +792,22 @@ void Terminal::refreshRenderBufferInternal(RenderBuffer& _output)
         TerminalLog()("{}: Refreshing render buffer.\n", lastFrameID_.load());
 #endif
 
+    updateHyperlinkSpans();
     auto const hoveringHyperlinkGuard = ScopedHyperlinkHover { *this, currentScreen_ };
     auto const mainDisplayReverseVideo = isModeEnabled(terminal::DECMode::ReverseVideo);
 
     if (isPrimaryScreen())
-        _lastRenderPassHints =
-            primaryScreen_.render(RenderBufferBuilder<PrimaryScreenCell> { *this,
-                                                                           _output,
-                                                                           LineOffset(0),
-                                                                           mainDisplayReverseVideo,
-                                                                           HighlightSearchMatches::Yes,
-                                                                           inputMethodData_ },
-                                  viewport_.scrollOffset());
+        _lastRenderPassHints = renderMainPage(primaryScreen_, _output, mainDisplayReverseVideo);
     else
-        _lastRenderPassHints =
-            alternateScreen_.render(RenderBufferBuilder<AlternateScreenCell> { *this,
-                                                                               _output,
-                                                                               LineOffset(0),
-                                                                               mainDisplayReverseVideo,
-                                                                               HighlightSearchMatches::Yes,
-                                                                               inputMethodData_ },
-                                    viewport_.scrollOffset());
+        _lastRenderPassHints = renderMainPage(alternateScreen_, _output, mainDisplayReverseVideo);
+
+    // The status line is rendered from scratch with every frame.
+    if (state_.statusDisplayType != StatusDisplayType::None)
+    {
+        auto const statusLineHeight = hostWritableStatusLineScreen_.pageSize().lines;
+        for (auto line = LineOffset(0); line < statusLineHeight.as<LineOffset>(); ++line)
+            _output.damagedLines.emplace_back(state_.pageSize.lines.as<LineOffset>() + line);
+    }
 
     switch (state_.statusDisplayType)
     {
@@ -435,8 +843,187 @@ void Terminal::refreshRenderBufferInternal(RenderBuffer& _output)
         eventListener_.cursorPositionChanged();
     }
 }
+
+template <typename Cell>
+RenderPassHints Terminal::renderMainPage(Screen<Cell> const& _screen,
+                                         RenderBuffer& _output,
+                                         bool _reverseVideo)
+{
+    // Selections, highlights, search matches, the vi cursor, and the IME preedit string are
+    // rendered across lines, so lines cannot be reused while any of them is shown.
+    bool const cacheable = !isSelectionAvailable() && !highlightRange_ && state_.searchMode.pattern.empty()
+                           && inputHandler().mode() == ViMode::Insert
+                           && inputMethodData_.preeditString.empty();
+
+    if (!cacheable)
+    {
+        _output.clear();
+        auto const hints = buildMainPage(_screen, _output, _reverseVideo, nullptr);
+        renderLineCache_.bypass(_output, state_.pageSize.lines);
+        return hints;
+    }
+
+    // Sets up frame ID and cursor of the output.
+    RenderBufferBuilder<Cell> {
+        *this, _output, LineOffset(0), _reverseVideo, HighlightSearchMatches::Yes, inputMethodData_
+    };
+
+    auto settings = RenderLineCache::Settings {};
+    settings.screen = &_screen;
+    settings.pageSize = state_.pageSize;
+    settings.reverseVideo = _reverseVideo;
+    settings.blink = _lastRenderPassHints.containsBlinkingCells && blinkState();
+    settings.rapidBlink = _lastRenderPassHints.containsBlinkingCells && rapidBlinkState();
+    settings.colorPalette = colorPalette();
+
+    auto cursor = RenderLineCache::Cursor { _output.cursor, realCursorPosition(), viewport_.scrollOffset() };
+
+    if (renderLineCache_.plan(_screen.grid(),
+                              std::move(settings),
+                              std::move(cursor),
+                              hoveringHyperlinkId(),
+                              hyperlinkSpans_,
+                              _output))
+    {
+        // Nothing has changed, only the status line is to be rendered again.
+        _output.cells.resize(_output.mainPageCellCount);
+        _output.lines.resize(_output.mainPageLineCount);
+        _output.images.resize(_output.mainPageImageCount);
+        _output.damagedLines.clear();
+        _output.scrollShift = LineOffset(0);
+        return _lastRenderPassHints;
+    }
+
+    _output.cells.clear();
+    _output.lines.clear();
+    _output.images.clear();
+    auto const hints = buildMainPage(_screen, _output, _reverseVideo, &renderLineCache_);
+    renderLineCache_.finish(_output);
+    return hints;
+}
+
+void Terminal::updateHyperlinkSpans()
+{
+    if (isPrimaryScreen())
+        primaryScreen_.grid().collectHyperlinkSpans(viewport_.scrollOffset(), hyperlinkSpans_);
+    else
+        alternateScreen_.grid().collectHyperlinkSpans(viewport_.scrollOffset(), hyperlinkSpans_);
+}
+
+template <typename Cell>
+RenderPassHints Terminal::buildMainPage(Screen<Cell> const& _screen,
+                                        RenderBuffer& _output,
+                                        bool _reverseVideo,
+                                        RenderLineCache* _lineCache)
+{
+    updateSearchMatchRanges(_screen);
+
+    auto const pageLines = unbox<int>(state_.pageSize.lines);
+    auto const bandCount =
+        std::min(static_cast<int>(renderBufferThreadCount_), pageLines / MinRenderBandLines);
+
+    // Bands are rendered concurrently, so each of them resolves colors through its own cache.
+    colorCaches_.resize(static_cast<size_t>(std::max(bandCount, 1)));
+    for (auto& colorCache: colorCaches_)
+        colorCache.validate(colorPalette());
+
+    auto const makeBuilder = [&](RenderBuffer& _buffer, int _band) {
+        auto builder = RenderBufferBuilder<Cell> {
+            *this, _buffer, LineOffset(0), _reverseVideo, HighlightSearchMatches::Yes, inputMethodData_
+        };
+        if (_lineCache)
+            builder.useLineCache(*_lineCache);
+        builder.useColorCache(colorCaches_[static_cast<size_t>(_band)]);
+        return builder;
+    };
+
+    if (bandCount <= 1)
+    {
+        renderBands_.clear();
+        return _screen.render(makeBuilder(_output, 0), viewport_.scrollOffset());
+    }
+
+    // The first band is rendered into the output right away on the calling thread,
+    // all other bands are rendered concurrently into their own buffers and appended afterwards.
+    renderBands_.resize(static_cast<size_t>(bandCount - 1));
+    auto const bandTop = [&](int k) {
+        return LineOffset::cast_from(pageLines * k / bandCount);
+    };
+    auto const bandLines = [&](int k) {
+        return LineCount::cast_from(unbox<int>(bandTop(k + 1)) - unbox<int>(bandTop(k)));
+    };
+
+    auto bands = std::vector<std::future<RenderPassHints>> {};
+    for (int k = 1; k < bandCount; ++k)
+    {
+        auto* band = &renderBands_[static_cast<size_t>(k - 1)];
+        band->cells.clear();
+        band->lines.clear();
+        band->images.clear();
+        bands.emplace_back(std::async(std::launch::async, [&, band, k]() {
+            return _screen.renderLines(
+                makeBuilder(*band, k), viewport_.scrollOffset(), bandTop(k), bandLines(k));
+        }));
+    }
+
+    auto hints =
+        _screen.renderLines(makeBuilder(_output, 0), viewport_.scrollOffset(), bandTop(0), bandLines(0));
+
+    for (size_t k = 0; k < bands.size(); ++k)
+    {
+        auto const bandHints = bands[k].get();
+        hints.containsBlinkingCells = hints.containsBlinkingCells || bandHints.containsBlinkingCells;
+
+        auto const& band = renderBands_[k];
+        _output.cells.insert(_output.cells.end(), band.cells.begin(), band.cells.end());
+        _output.lines.insert(_output.lines.end(), band.lines.begin(), band.lines.end());
+        _output.images.insert(_output.images.end(), band.images.begin(), band.images.end());
+    }
+    return hints;
+}
+
+template <typename Cell>
+void Terminal::updateSearchMatchRanges(Screen<Cell> const& _screen)
+{
+    searchMatchRanges_.clear();
+
+    auto const& pattern = state_.searchMode.pattern;
+    if (pattern.empty())
+        return;
+
+    auto const top = -boxed_cast<LineOffset>(viewport_.scrollOffset());
+    auto const bottom = top + boxed_cast<LineOffset>(state_.pageSize.lines);
+    for (auto line = top; line < bottom; ++line)
+        for (auto const& match: _screen.grid().lineAt(line).searchMatches(pattern))
+            searchMatchRanges_.emplace_back(
+                ColumnRange { line, match.start, match.start + boxed_cast<ColumnOffset>(match.length) - 1 });
+}
 // }}}
 
+void Terminal::releaseUnreferencedHyperlinks()
+{
+    auto referenced = std::vector<bool>(state_.hyperlinks.idCount());
+    for (auto const* cursor:
+         { &state_.cursor, &state_.savedCursor, &state_.savedPrimaryCursor, &state_.savedCursorStatusLine })
+        if (auto const index = unbox<size_t>(cursor->hyperlink); index < referenced.size())
+            referenced[index] = true;
+
+    primaryScreen_.grid().markReferencedHyperlinks(referenced);
+    alternateScreen_.grid().markReferencedHyperlinks(referenced);
+    hostWritableStatusLineScreen_.grid().markReferencedHyperlinks(referenced);
+    indicatorStatusScreen_.grid().markReferencedHyperlinks(referenced);
+
+    auto const heldCount = state_.hyperlinks.size();
+    state_.hyperlinks.releaseUnreferenced(referenced);
+    TerminalLog()("Released {} of {} hyperlinks.", heldCount - state_.hyperlinks.size(), heldCount);
+    publishHyperlinkStats();
+}
+
+void Terminal::publishHyperlinkStats()
+{
+    hyperlinkCacheStats_.update(state_.hyperlinks.fetchAndClearStats(), state_.hyperlinks.size(), 0);
+}
+
 void Terminal::updateIndicatorStatusLine()
 {
     assert(&currentScreen_.get() != &indicatorStatusScreen_);
@@ -465,6 +1052,9 @@ void Terminal::updateIndicatorStatusLine()
     if (!state_.searchMode.pattern.empty() || state_.inputHandler.isEditingSearch())
         indicatorStatusScreen_.writeTextFromExternal(" SEARCH");
 
+    if (auto const progress = pasteProgress())
+        indicatorStatusScreen_.writeTextFromExternal(fmt::format(" PASTE {:.0f}%", *progress * 100));
+
     if (!allowInput())
     {
         state_.cursor.graphicsRendition.foregroundColor = BrightColor::Red;
@@ -504,6 +1094,7 @@ void Terminal::updateIndicatorStatusLine()
 
 bool Terminal::sendKeyPressEvent(Key _key, Modifier _modifier, Timestamp _now)
 {
+    inputPending_.store(true, std::memory_order_relaxed);
     cursorBlinkState_ = 1;
     lastCursorBlink_ = _now;
 
@@ -516,6 +1107,8 @@ bool Terminal::sendKeyPressEvent(Key _key, Modifier _modifier, Timestamp _now)
 
     viewport_.scrollToBottom();
     bool const success = state_.inputGenerator.generate(_key, _modifier);
+    if (success)
+        markKeyPress(_now);
     flushInput();
     viewport_.scrollToBottom();
     return success;
@@ -523,6 +1116,7 @@ bool Terminal::sendKeyPressEvent(Key _key, Modifier _modifier, Timestamp _now)
 
 bool Terminal::sendCharPressEvent(char32_t _value, Modifier _modifier, Timestamp _now)
 {
+    inputPending_.store(true, std::memory_order_relaxed);
     cursorBlinkState_ = 1;
     lastCursorBlink_ = _now;
 
@@ -533,13 +1127,134 @@ bool Terminal::sendCharPressEvent(char32_t _value, Modifier _modifier, Timestamp
     if (state_.inputHandler.sendCharPressEvent(_value, _modifier))
         return true;
 
+    if (_modifier == Modifier::Control && (_value == 'C' || _value == 'c' || _value == 0x03) && cancelPaste())
+    {
+        flushInput();
+        return true;
+    }
+
     auto const success = state_.inputGenerator.generate(_value, _modifier);
+    if (success)
+        markKeyPress(_now);
 
     flushInput();
     viewport_.scrollToBottom();
     return success;
 }
 
+void Terminal::markKeyPress(Timestamp _now) noexcept
+{
+    auto const pending = unechoedKeyPress_.load(std::memory_order_relaxed);
+    if (pending && _now - Timestamp(Timestamp::duration(pending)) < MaxKeyPressEchoDelay)
+        return;
+
+    // No echo is awaited, or the awaited one never came, e.g. because the application does not echo.
+    unechoedKeyPress_.store(_now.time_since_epoch().count(), std::memory_order_relaxed);
+}
+
+void Terminal::detectKeyPressEcho(Timestamp _readTime)
+{
+    auto pending = unechoedKeyPress_.load(std::memory_order_relaxed);
+    if (!pending)
+        return;
+
+    // Output read before the key press cannot be its echo.
+    auto const keyPress = Timestamp(Timestamp::duration(pending));
+    if (_readTime < keyPress)
+        return;
+
+    if (!unechoedKeyPress_.compare_exchange_strong(pending, 0, std::memory_order_relaxed))
+        return;
+
+    if (_readTime - keyPress < MaxKeyPressEchoDelay)
+        echoedKeyPress_ = keyPress;
+}
+
+void Terminal::reportInputLatency(bool _reset)
+{
+    // PM 315 ; count ; p50 ; p90 ; p99 ; max ST, with all durations in microseconds.
+    auto const summary = inputLatency_.summary();
+    reply("\033^{};{};{};{};{};{}\033\\",
+          InputLatencyCode,
+          summary.count,
+          summary.p50.count(),
+          summary.p90.count(),
+          summary.p99.count(),
+          summary.max.count());
+
+    if (_reset)
+        inputLatency_.clear();
+}
+
+void Terminal::reportCacheStats()
+{
+    // PM 316 ; name ; hits ; misses ; evictions ; size ; capacity ST for each cache,
+    // terminated by an empty PM 316 ST.
+    publishHyperlinkStats();
+    for (auto const& stats: crispy::CacheStats::collect())
+        reply("\033^{};{};{};{};{};{};{}\033\\",
+              CacheStatsCode,
+              stats.name,
+              stats.hits,
+              stats.misses,
+              stats.evictions,
+              stats.size,
+              stats.capacity);
+    reply("\033^{}\033\\", CacheStatsCode);
+}
+
+void Terminal::reportMemoryStats()
+{
+    // PM 317 ; name ; bytes ; count ST for each subsystem, terminated by an empty PM 317 ST.
+    publishMemoryStats();
+    for (auto const& stats: crispy::MemoryStats::collect())
+        reply("\033^{};{};{};{}\033\\", MemoryStatsCode, stats.name, stats.bytes, stats.count);
+    reply("\033^{}\033\\", MemoryStatsCode);
+}
+
+void Terminal::publishMemoryStats()
+{
+    auto lines = GridMemoryUsage {};
+    for (auto const& usage: { primaryScreen_.grid().memoryUsage(), alternateScreen_.grid().memoryUsage() })
+    {
+        lines.trivialLines += usage.trivialLines;
+        lines.trivialBytes += usage.trivialBytes;
+        lines.inflatedLines += usage.inflatedLines;
+        lines.inflatedBytes += usage.inflatedBytes;
+        lines.attributedLines += usage.attributedLines;
+        lines.attributedBytes += usage.attributedBytes;
+    }
+    trivialLinesMemory_.update(lines.trivialBytes, lines.trivialLines);
+    inflatedLinesMemory_.update(lines.inflatedBytes, lines.inflatedLines);
+    attributedLinesMemory_.update(lines.attributedBytes, lines.attributedLines);
+
+    // The text of trivial lines is held by the PTY buffer objects in use.
+    auto const ptyBuffers = ptyBufferPool_.stats();
+    ptyBuffersInUseMemory_.update(ptyBuffers.bytesPinned(), ptyBuffers.liveBuffers);
+    ptyBuffersPooledMemory_.update(ptyBuffers.unusedBuffers * ptyBuffers.bufferCapacity,
+                                   ptyBuffers.unusedBuffers);
+
+    hyperlinksMemory_.update(state_.hyperlinks.memoryUsage(), state_.hyperlinks.size());
+    auto const images = state_.imagePool.memoryUsage();
+    imagesMemory_.update(images.bytes, images.images);
+
+    auto& process = ProcessMemoryStats::get();
+    auto const cellExtras = CellExtra::allocationStats();
+    process.cellExtras.update(cellExtras.capacity * sizeof(CellExtra), cellExtras.inUse);
+    auto const clusters = GraphemeCluster::stats();
+    process.graphemeClusters.update(clusters.bytes, clusters.clusters);
+    auto const lineBuffers = InflatedLineBufferPool<PrimaryScreenCell>::get().stats();
+    process.lineBufferPool.update(lineBuffers.bytes, lineBuffers.buffers);
+}
+
+std::vector<crispy::MemoryStats::Snapshot> Terminal::memoryStats() const
+{
+    return { trivialLinesMemory_.snapshot(),     inflatedLinesMemory_.snapshot(),
+             attributedLinesMemory_.snapshot(),  ptyBuffersInUseMemory_.snapshot(),
+             ptyBuffersPooledMemory_.snapshot(), hyperlinksMemory_.snapshot(),
+             imagesMemory_.snapshot() };
+}
+
 bool Terminal::sendMousePressEvent(Modifier _modifier,
                                    MouseButton _button,
                                    PixelCoordinate _pixelPosition,
@@ -616,7 +1331,7 @@ void Terminal::clearSelection()
 bool Terminal::sendMouseMoveEvent(Modifier _modifier,
                                   CellLocation newPosition,
                                   PixelCoordinate _pixelPosition,
-                                  Timestamp /*_now*/)
+                                  Timestamp _now)
 {
     speedClicks_ = 0;
 
@@ -629,13 +1344,12 @@ bool Terminal::sendMouseMoveEvent(Modifier _modifier,
     auto const uiMaybeDisplayingMousePosition = state_.statusDisplayType == StatusDisplayType::Indicator;
     if (cursorPositionHasChanged && uiMaybeDisplayingMousePosition)
     {
-        currentMousePosition_ = newPosition;
         markScreenDirty();
         eventListener_.renderBufferUpdated();
         changed = true;
     }
 
-    if (newPosition == currentMousePosition_ && !isModeEnabled(DECMode::MouseSGRPixels))
+    if (!cursorPositionHasChanged && !isModeEnabled(DECMode::MouseSGRPixels))
         return false;
 
     currentMousePosition_ = newPosition;
@@ -646,9 +1360,13 @@ bool Terminal::sendMouseMoveEvent(Modifier _modifier,
 
     // Do not handle mouse-move events in sub-cell dimensions.
     if (allowInput() && respectMouseProtocol_
-        && state_.inputGenerator.generateMouseMove(_modifier, currentMousePosition_, _pixelPosition))
+        && state_.inputGenerator.generateMouseMove(_modifier, currentMousePosition_, _pixelPosition, _now))
     {
         flushInput();
+
+        // The deferred mouse move gets reported upon the next frame, see tick().
+        if (state_.inputGenerator.hasPendingMouseMove())
+            eventListener_.renderBufferUpdated();
         return true;
     }
 
@@ -752,36 +1470,142 @@ void Terminal::sendPaste(string_view _text)
         return;
     }
 
-    state_.inputGenerator.generatePaste(_text);
+    {
+        auto const _ = std::lock_guard { pendingRepliesLock_ };
+        if (paste_)
+        {
+            // Joins the paste in progress, such that it does not end up in the middle of it.
+            paste_->text += _text;
+        }
+        else if (_text.size() <= PasteChunkSize)
+            state_.inputGenerator.generatePaste(_text);
+        else
+        {
+            InputLog()("Streaming paste of {} bytes.", _text.size());
+            state_.inputGenerator.generatePasteBegin();
+            paste_ = PasteState { string(_text), 0 };
+        }
+    }
     flushInput();
 }
 
+bool Terminal::cancelPaste()
+{
+    auto const _ = std::lock_guard { pendingRepliesLock_ };
+    if (!paste_)
+        return false;
+
+    InputLog()("Cancelling paste after {} of {} bytes.", paste_->offset, paste_->text.size());
+    state_.inputGenerator.generatePasteEnd();
+    paste_.reset();
+    return true;
+}
+
+optional<double> Terminal::pasteProgress() const
+{
+    auto const _ = std::lock_guard { pendingRepliesLock_ };
+    if (!paste_)
+        return nullopt;
+    return static_cast<double>(paste_->offset) / static_cast<double>(paste_->text.size());
+}
+
+void Terminal::streamPaste()
+{
+    // Only a single chunk is queued ahead of the application reading it, so that a huge paste
+    // neither piles up in memory nor keeps the application from having its output read meanwhile.
+    if (!paste_ || state_.inputGenerator.peek().size() >= PasteChunkSize)
+        return;
+
+    auto const chunkSize = std::min(PasteChunkSize, paste_->text.size() - paste_->offset);
+    state_.inputGenerator.generatePasteChunk(string_view(paste_->text).substr(paste_->offset, chunkSize));
+    paste_->offset += chunkSize;
+
+    if (paste_->offset == paste_->text.size())
+    {
+        state_.inputGenerator.generatePasteEnd();
+        paste_.reset();
+    }
+}
+
 bool Terminal::hasInput() const noexcept
 {
-    return !state_.inputGenerator.peek().empty();
+    return pendingInputBytes() != 0;
 }
 
 size_t Terminal::pendingInputBytes() const noexcept
 {
-    return !state_.inputGenerator.peek().size();
+    auto const _ = std::lock_guard { pendingRepliesLock_ };
+    auto const pastePending = paste_ ? paste_->text.size() - paste_->offset : 0;
+    return pendingReplies_.size() + state_.inputGenerator.peek().size() + pastePending;
 }
 
-void Terminal::flushInput()
+std::string Terminal::peekInput() const
 {
-    if (state_.inputGenerator.peek().empty())
-        return;
+    auto const _ = std::lock_guard { pendingRepliesLock_ };
+    return pendingReplies_ + std::string(state_.inputGenerator.peek());
+}
 
+void Terminal::flushInput()
+{
     // XXX Should be the only location that does write to the PTY's stdin to avoid race conditions.
+    auto const _ = std::lock_guard { pendingRepliesLock_ };
+
+    streamPaste();
+
     auto const input = state_.inputGenerator.peek();
-    auto const rv = pty_->write(input.data(), input.size());
-    if (rv > 0)
-        state_.inputGenerator.consume(rv);
+    if (pendingReplies_.empty() && input.empty())
+        return;
+
+    // Replies are answering output the application sent earlier, so they go first.
+    auto const buffers = std::array<std::string_view, 2> { pendingReplies_, input };
+    auto const rv = pty_->writeVectored(buffers);
+    if (rv <= 0)
+        return;
+
+    auto const written = static_cast<size_t>(rv);
+    auto const repliesWritten = std::min(written, pendingReplies_.size());
+    pendingReplies_.erase(0, repliesWritten);
+    if (written > repliesWritten)
+        state_.inputGenerator.consume(static_cast<int>(written - repliesWritten));
+}
+
+void Terminal::startCaptureBuffer(LineCount _lines, bool _logical)
+{
+    auto const _l = std::lock_guard { *this };
+    captureBuffer_ = CaptureBufferState { primaryScreen_.captureBufferTop(_lines, _logical),
+                                          _logical,
+                                          primaryScreen_.grid().scrolledUpLineCount() };
+}
+
+bool Terminal::continueCaptureBuffer()
+{
+    auto const _l = std::lock_guard { *this };
+    if (!captureBuffer_)
+        return false;
+
+    // Keep track of the next line to capture while new output keeps scrolling the screen.
+    auto const scrolledUpLineCount = primaryScreen_.grid().scrolledUpLineCount();
+    captureBuffer_->nextLine -=
+        LineOffset::cast_from(scrolledUpLineCount - captureBuffer_->scrolledUpLineCount);
+    captureBuffer_->scrolledUpLineCount = scrolledUpLineCount;
+
+    if (auto const nextLine = primaryScreen_.captureBufferChunk(captureBuffer_->nextLine,
+                                                                captureBuffer_->logicalLines))
+    {
+        captureBuffer_->nextLine = *nextLine;
+        return true;
+    }
+
+    captureBuffer_.reset();
+    return false;
 }
 
 void Terminal::writeToScreen(string_view _data)
 {
     {
         auto const _l = std::lock_guard { *this };
+        if (state_.sequenceProfiler)
+            state_.sequenceProfiler->recordInput(_data.size());
         while (!_data.empty())
         {
             if (currentPtyBuffer_->bytesAvailable() < 64
@@ -812,6 +1636,8 @@ string_view Terminal::lockedWriteToPtyBuffer(string_view data)
 
 void Terminal::writeToScreenInternal(std::string_view data)
 {
+    if (state_.sequenceProfiler)
+        state_.sequenceProfiler->recordInput(data.size());
     while (!data.empty())
     {
         auto const chunk = lockedWriteToPtyBuffer(data);
@@ -833,6 +1659,14 @@ void Terminal::updateCursorVisibilityState() const
     cursorBlinkState_ = (cursorBlinkState_ + 1) % 2;
 }
 
+void Terminal::flushPendingMouseMove()
+{
+    if (state_.inputGenerator.generatePendingMouseMove(currentTime_))
+        flushInput();
+    else if (state_.inputGenerator.hasPendingMouseMove())
+        eventListener_.renderBufferUpdated(); // Not due yet, so try again upon the next frame.
+}
+
 bool Terminal::updateCursorHoveringState()
 {
     verifyState();
@@ -844,7 +1678,11 @@ bool Terminal::updateCursorHoveringState()
 
     auto const relCursorPos = viewport_.translateScreenToGridCoordinate(currentMousePosition_);
     auto const mouseInView2 = currentScreen_.get().contains(currentMousePosition_);
-    auto const newState = mouseInView2 && !!currentScreen_.get().hyperlinkIdAt(relCursorPos);
+    // Hyperlinks are looked up in the spans collected with the last render buffer refresh, and
+    // plain-text URLs in the URLs cached by each line until it is modified.
+    auto const newState = mouseInView2
+                          && (!!hoveringHyperlinkId()
+                              || currentScreen_.get().plainTextUrlAt(relCursorPos).has_value());
 
     auto const oldState = hoveringHyperlink_.exchange(newState);
     return newState != oldState;
@@ -852,7 +1690,7 @@ bool Terminal::updateCursorHoveringState()
 
 optional<chrono::milliseconds> Terminal::nextRender() const
 {
-    if (!isModeEnabled(DECMode::VisibleCursor))
+    if (!visible_ || !isModeEnabled(DECMode::VisibleCursor))
         return nullopt;
 
     if (cursorDisplay_ != CursorDisplay::Blink && !isBlinkOnScreen())
@@ -862,20 +1700,30 @@ optional<chrono::milliseconds> Terminal::nextRender() const
     auto const passedSlowBlink = chrono::duration_cast<chrono::milliseconds>(currentTime_ - _lastBlink);
     auto const passedRapidBlink = chrono::duration_cast<chrono::milliseconds>(currentTime_ - _lastRapidBlink);
     auto nextBlink = chrono::milliseconds::max();
-    if (passedCursor <= cursorBlinkInterval_)
+    if (cursorDisplay_ == CursorDisplay::Blink && passedCursor <= cursorBlinkInterval_)
         nextBlink = std::min(nextBlink, cursorBlinkInterval_ - passedCursor);
-    if (passedSlowBlink <= _slowBlinker.interval)
-        nextBlink = std::min(nextBlink, _slowBlinker.interval - passedSlowBlink);
-    if (passedRapidBlink <= _rapidBlinker.interval)
-        nextBlink = std::min(nextBlink, _rapidBlinker.interval - passedRapidBlink);
+
+    // The blinkers are only advanced while blinking cells are on screen (see tick()),
+    // so they must not wake up the display otherwise.
+    if (isBlinkOnScreen())
+    {
+        if (passedSlowBlink <= _slowBlinker.interval)
+            nextBlink = std::min(nextBlink, _slowBlinker.interval - passedSlowBlink);
+        if (passedRapidBlink <= _rapidBlinker.interval)
+            nextBlink = std::min(nextBlink, _rapidBlinker.interval - passedRapidBlink);
+    }
+
     if (nextBlink != std::chrono::milliseconds::max())
         return nextBlink;
     else
-        return chrono::milliseconds::min();
+        return chrono::milliseconds(0);
 }
 
 void Terminal::resizeScreen(PageSize totalPageSize, optional<ImageSize> _pixels)
 {
+    if (ptyRecorder_)
+        ptyRecorder_->recordResize(totalPageSize);
+
     auto const _l = lock_guard { *this };
     resizeScreenInternal(totalPageSize, _pixels);
 }
@@ -904,6 +1752,9 @@ void Terminal::resizeScreenInternal(PageSize totalPageSize, std::optional<ImageS
 
     applyPageSizeToCurrentBuffer();
 
+    // Keep the scrolled-up viewport showing reflowed lines.
+    currentScreen().reflowDeferredLines(-boxed_cast<LineOffset>(viewport_.scrollOffset()));
+
     pty_->resizeScreen(mainDisplayPageSize, _pixels);
 
     // Adjust Normal-mode's cursor in order to avoid drift when growing/shrinking in main page line count.
@@ -990,45 +1841,104 @@ void Terminal::setCursorShape(CursorShape _shape)
 
 void Terminal::setWordDelimiters(string const& _wordDelimiters)
 {
-    wordDelimiters_ = unicode::from_utf8(_wordDelimiters);
+    wordDelimiters_ = WordDelimiters(unicode::from_utf8(_wordDelimiters));
 }
 
 namespace
 {
+    /// @returns the byte range of the trivial line buffer's US-ASCII text that is covered by @p _range.
+    std::pair<size_t, size_t> selectedTextRange(TrivialLineBuffer const& _buffer,
+                                                Selection::Range const& _range) noexcept
+    {
+        auto const begin = std::min(unbox<size_t>(_range.fromColumn), _buffer.text.size());
+        auto const end = std::min(unbox<size_t>(_range.toColumn) + 1, _buffer.text.size());
+        return { begin, std::max(begin, end) };
+    }
+
+    /// @returns an upper bound of the number of bytes the selected text of the given line takes.
+    template <typename Cell>
+    size_t selectedTextSize(Line<Cell> const& _line, Selection::Range const& _range)
+    {
+        if (_line.isTrivialBuffer() && _line.trivialBuffer().isASCII())
+        {
+            auto const [begin, end] = selectedTextRange(_line.trivialBuffer(), _range);
+            return end - begin;
+        }
+
+        auto const cells = _line.cells();
+        auto const end = std::min(unbox<size_t>(_range.toColumn) + 1, cells.size());
+        auto size = size_t { 0 };
+        for (auto column = unbox<size_t>(_range.fromColumn); column < end; ++column)
+            size += cells[column].codepointCount() * 4; // UTF-8 takes up to 4 bytes per codepoint.
+        return size;
+    }
+
     template <typename Cell>
-    struct SelectionRenderer
+    void appendSelectedText(Line<Cell> const& _line, Selection::Range const& _range, string& _text)
     {
-        Terminal const& term;
-        ColumnOffset const rightPage;
-        ColumnOffset lastColumn {};
-        string text {};
-        string currentLine {};
+        if (_line.isTrivialBuffer() && _line.trivialBuffer().isASCII())
+        {
+            auto const& buffer = _line.trivialBuffer();
+            auto const [begin, end] = selectedTextRange(buffer, _range);
+            _text.append(buffer.text.data() + begin, end - begin);
+            return;
+        }
 
-        void operator()(CellLocation _pos, Cell const& _cell)
+        auto const cells = _line.cells();
+        auto const end = std::min(unbox<size_t>(_range.toColumn) + 1, cells.size());
+        auto encoder = unicode::encoder<char> {};
+        for (auto column = unbox<size_t>(_range.fromColumn); column < end; ++column)
         {
-            auto const isNewLine = _pos.column < lastColumn || (_pos.column == lastColumn && !text.empty());
-            bool const touchesRightPage = term.isSelected({ _pos.line, rightPage });
-            if (isNewLine && (!term.isLineWrapped(_pos.line) || !touchesRightPage))
-            {
-                // TODO: handle logical line in word-selection (don't include LF in wrapped lines)
-                trimSpaceRight(currentLine);
-                text += currentLine;
-                text += '\n';
-                currentLine.clear();
-            }
-            currentLine += _cell.toUtf8();
-            lastColumn = _pos.column;
+            auto const& cell = cells[column];
+            for (size_t i = 0; i < cell.codepointCount(); ++i)
+                encoder(cell.codepoint(i), back_inserter(_text));
         }
+    }
+
+    void trimSpaceRight(string& _text, size_t _lineStart) noexcept
+    {
+        auto end = _text.size();
+        while (end > _lineStart && _text[end - 1] == ' ')
+            --end;
+        _text.resize(end);
+    }
 
-        std::string finish()
+    /// Extracts the text of the given selection ranges of @p _lines, which is a Grid or a GridSnapshot.
+    ///
+    /// The size of the text is computed first, such that the text is filled in without reallocating,
+    /// even for a selection spanning the whole scrollback.
+    template <typename LineSource>
+    string extractSelectedText(LineSource const& _lines,
+                               vector<Selection::Range> const& _ranges,
+                               ColumnOffset _rightPage,
+                               bool _fullLines)
+    {
+        auto size = size_t { 1 };
+        for (auto const& range: _ranges)
+            size += selectedTextSize(_lines.lineAt(range.line), range) + 1;
+
+        auto text = string {};
+        text.reserve(size);
+        auto lineStart = size_t { 0 };
+        for (size_t i = 0; i < _ranges.size(); ++i)
         {
-            trimSpaceRight(currentLine);
-            text += currentLine;
-            if (dynamic_cast<FullLineSelection const*>(term.selector()))
+            auto const& range = _ranges[i];
+            auto const& line = _lines.lineAt(range.line);
+
+            // TODO: handle logical line in word-selection (don't include LF in wrapped lines)
+            if (i != 0 && (!line.wrapped() || !range.contains({ range.line, _rightPage })))
+            {
+                trimSpaceRight(text, lineStart);
                 text += '\n';
-            return std::move(text);
+                lineStart = text.size();
+            }
+            appendSelectedText(line, range, text);
         }
-    };
+        trimSpaceRight(text, lineStart);
+        if (_fullLines)
+            text += '\n';
+        return text;
+    }
 } // namespace
 
 string Terminal::extractSelectionText() const
@@ -1038,19 +1948,57 @@ string Terminal::extractSelectionText() const
     if (!selection_)
         return "";
 
+    auto const ranges = selection_->ranges();
+    auto const rightPage = pageSize().columns.as<ColumnOffset>() - 1;
+    auto const fullLines = dynamic_cast<FullLineSelection const*>(selector()) != nullptr;
     if (isPrimaryScreen())
-    {
-        auto se = SelectionRenderer<PrimaryScreenCell> { *this, pageSize().columns.as<ColumnOffset>() - 1 };
-        terminal::renderSelection(*selection_, [&](CellLocation _pos) { se(_pos, primaryScreen_.at(_pos)); });
-        return se.finish();
-    }
+        return extractSelectedText(primaryScreen_.grid(), ranges, rightPage, fullLines);
     else
+        return extractSelectedText(alternateScreen_.grid(), ranges, rightPage, fullLines);
+}
+
+void Terminal::extractSelectionTextInBackground(std::function<void(std::string)> _onDone)
+{
+    auto job = [&]() -> std::function<void()> {
+        auto const _lock = scoped_lock { *this };
+
+        auto ranges = selection_ ? selection_->ranges() : vector<Selection::Range> {};
+        auto const rightPage = pageSize().columns.as<ColumnOffset>() - 1;
+        auto const fullLines = dynamic_cast<FullLineSelection const*>(selector()) != nullptr;
+        auto const makeJob = [&](auto& _screen) {
+            return [snapshot = _screen.grid().snapshot(),
+                    ranges = std::move(ranges),
+                    rightPage,
+                    fullLines,
+                    onDone = std::move(_onDone)]() {
+                onDone(extractSelectedText(snapshot, ranges, rightPage, fullLines));
+            };
+        };
+        if (isPrimaryScreen())
+            return makeJob(primaryScreen_);
+        else
+            return makeJob(alternateScreen_);
+    }();
+
+    // Waits for a previous extraction to complete, which is done without holding the lock.
+    selectionJob_ = std::async(std::launch::async, std::move(job));
+}
+
+string Terminal::extractLastCommandOutput() const
+{
+    auto const _l = std::lock_guard { *this };
+
+    auto const output = primaryScreen_.grid().lastCommandOutput();
+    if (!output)
+        return {};
+
+    string text;
+    for (auto const line: *output)
     {
-        auto se = SelectionRenderer<AlternateScreenCell> { *this, pageSize().columns.as<ColumnOffset>() - 1 };
-        terminal::renderSelection(*selection_,
-                                  [&](CellLocation _pos) { se(_pos, alternateScreen_.at(_pos)); });
-        return se.finish();
+        text += primaryScreen_.grid().lineAt(LineOffset(line)).toUtf8Trimmed();
+        text += '\n';
     }
+    return text;
 }
 
 string Terminal::extractLastMarkRange() const
@@ -1109,7 +2057,7 @@ void Terminal::scrollbackBufferCleared()
 
 void Terminal::screenUpdated()
 {
-    if (!renderBufferUpdateEnabled_)
+    if (renderBufferUpdateHeldBack(steady_clock::now()))
         return;
 
     if (renderBuffer_.state == RenderBufferState::TrySwapBuffers)
@@ -1139,6 +2087,8 @@ void Terminal::copyToClipboard(string_view _data)
 
 void Terminal::inspect()
 {
+    publishHyperlinkStats();
+    publishMemoryStats();
     eventListener_.inspect();
 }
 
@@ -1149,11 +2099,11 @@ void Terminal::notify(string_view _title, string_view _body)
 
 void Terminal::reply(string_view _reply)
 {
-    // this is invoked from within the terminal thread.
-    // most likely that's not the main thread, which will however write
-    // the actual input events.
-    // TODO: introduce new mutex to guard terminal writes.
-    state_.inputGenerator.generateRaw(_reply);
+    // This is invoked from within the terminal thread, which must not block on writing to the PTY.
+    // The reply is therefore only queued, and written along with any pending input by the next
+    // flushInput(), which is triggered by screenUpdated() at the end of the current parse pass.
+    auto const _ = std::lock_guard { pendingRepliesLock_ };
+    pendingReplies_ += _reply;
 }
 
 void Terminal::requestWindowResize(PageSize _size)
@@ -1238,6 +2188,11 @@ void Terminal::setTerminalProfile(string const& _configProfileName)
     eventListener_.setTerminalProfile(_configProfileName);
 }
 
+TmuxControlParser::Events* Terminal::startTmuxControlMode()
+{
+    return eventListener_.tmuxControlModeStarted();
+}
+
 void Terminal::useApplicationCursorKeys(bool _enable)
 {
     auto const keyMode = _enable ? KeyMode::Application : KeyMode::Normal;
@@ -1572,8 +2527,14 @@ void Terminal::setScreen(ScreenType _type)
         case ScreenType::Primary:
             currentScreen_ = primaryScreen_;
             setMouseWheelMode(InputGenerator::MouseWheelMode::Default);
+            state_.alternateBufferLeft = currentTime_;
             break;
         case ScreenType::Alternate:
+            if (!state_.alternateBufferAllocated)
+            {
+                state_.alternateBuffer = Grid<AlternateScreenCell>(state_.pageSize, false, LineCount(0));
+                state_.alternateBufferAllocated = true;
+            }
             currentScreen_ = alternateScreen_;
             if (isModeEnabled(DECMode::MouseAlternateScroll))
                 setMouseWheelMode(InputGenerator::MouseWheelMode::ApplicationCursorKeys);
@@ -1596,6 +2557,114 @@ void Terminal::setScreen(ScreenType _type)
     bufferChanged(_type);
 }
 
+void Terminal::releaseIdleAlternateScreen()
+{
+    if (!state_.alternateBufferAllocated || !isPrimaryScreen()
+        || currentTime_ - state_.alternateBufferLeft < AlternateScreenIdleTimeout)
+        return;
+
+    auto const _l = std::lock_guard { *this };
+    if (!state_.alternateBufferAllocated || !isPrimaryScreen())
+        return;
+
+    TerminalLog()("Releasing alternate screen, idle for {}.",
+                  chrono::duration_cast<chrono::seconds>(currentTime_ - state_.alternateBufferLeft));
+    state_.alternateBuffer = Grid<AlternateScreenCell>(UnallocatedAlternateBufferSize, false, LineCount(0));
+    state_.alternateBufferAllocated = false;
+}
+
+void Terminal::trimMemory()
+{
+    auto const _l = std::lock_guard { *this };
+
+    auto& grid = primaryScreen_.grid();
+    auto const compactedLines = grid.compactHistory();
+    auto const releasedBuffers = grid.compactTextBuffers(TextBufferLoadFactor);
+    ptyBufferPool_.releaseUnusedBuffers();
+    ptyBuffersAtLastCompaction_ = ptyBufferPool_.stats().liveBuffers;
+
+    TerminalLog()("Trimmed memory: {} scrollback lines compacted, {} buffer objects released.",
+                  compactedLines,
+                  releasedBuffers);
+}
+
+void Terminal::releasePooledMemory()
+{
+    InflatedLineBufferPool<PrimaryScreenCell>::get().releaseBuffers();
+}
+
+void Terminal::setSequenceProfiling(bool _enabled)
+{
+    auto const _l = std::lock_guard { *this };
+    if (!_enabled)
+        state_.sequenceProfiler.reset();
+    else if (!state_.sequenceProfiler)
+        state_.sequenceProfiler = std::make_unique<SequenceProfiler>();
+}
+
+void Terminal::setPtyBufferHugePages(bool _enabled)
+{
+    if (ptyBufferPool_.hugePages() == _enabled)
+        return;
+
+    ptyBufferPool_.setHugePages(_enabled);
+    if (!_enabled || currentPtyBuffer_->bytesUsed())
+        return;
+
+    currentPtyBuffer_.reset();
+    ptyBufferPool_.releaseUnusedBuffers();
+    currentPtyBuffer_ = ptyBufferPool_.allocateBufferObject();
+    crispy::prefaultPages(currentPtyBuffer_->data(), currentPtyBuffer_->capacity());
+}
+
+size_t Terminal::historyMemoryUsage()
+{
+    auto const _l = std::lock_guard { *this };
+    return linesMemory(primaryScreen_.grid()) + ptyBufferPool_.stats().bytesPinned();
+}
+
+size_t Terminal::trimHistory(size_t _maxBytes)
+{
+    auto const _l = std::lock_guard { *this };
+
+    auto& grid = primaryScreen_.grid();
+    auto const usage = [&]() { return linesMemory(grid) + ptyBufferPool_.stats().bytesPinned(); };
+
+    auto const bytesBefore = usage();
+    if (bytesBefore <= _maxBytes)
+        return 0;
+
+    grid.compactHistory();
+    grid.compactTextBuffers(TextBufferLoadFactor);
+    ptyBufferPool_.releaseUnusedBuffers();
+    auto bytes = usage();
+
+    if (bytes > _maxBytes && *grid.historyLineCount())
+    {
+        // Assuming all lines to take about the same, which rather drops too few lines than too many,
+        // as the unused lines are accounted for as well.
+        auto const bytesPerLine = std::max(size_t { 1 }, bytes / unbox<size_t>(grid.linesUsed()));
+        auto const excessLines = LineCount::cast_from((bytes - _maxBytes + bytesPerLine - 1) / bytesPerLine);
+        auto const evictedLines = grid.evictOldestLines(excessLines);
+        ptyBufferPool_.releaseUnusedBuffers();
+
+        auto const historyLineCount = grid.historyLineCount();
+        if (viewport_.scrollOffset() > boxed_cast<ScrollOffset>(historyLineCount))
+            viewport_.scrollTo(boxed_cast<ScrollOffset>(historyLineCount));
+        if (isPrimaryScreen() && selection_
+            && std::min(selection_->from().line, selection_->to().line)
+                   < -boxed_cast<LineOffset>(historyLineCount))
+            selection_.reset();
+
+        TerminalLog()("Dropped {} scrollback lines to stay within the scrollback memory budget.",
+                      evictedLines);
+        bytes = usage();
+    }
+    ptyBuffersAtLastCompaction_ = ptyBufferPool_.stats().liveBuffers;
+
+    return bytesBefore - std::min(bytesBefore, bytes);
+}
+
 void Terminal::applyPageSizeToCurrentBuffer()
 {
     auto cursorPosition = state_.cursor.position;
@@ -1640,6 +2709,32 @@ void Terminal::discardImage(Image const& _image)
     eventListener_.discardImage(_image);
 }
 
+void Terminal::setImageRasterizerThreads(size_t _threadCount)
+{
+    state_.imagePool.setAsyncRasterization(_threadCount, [this]() { imageRasterized(); });
+}
+
+void Terminal::imageRasterized()
+{
+    // Invoked on an image rasterizer thread. The grid itself did not change,
+    // but the cells of the image are to be rendered with their actual pixels now.
+    markScreenDirty();
+    if (!visible_)
+        return;
+    breakLoopAndRefreshRenderBuffer();
+    eventListener_.renderBufferUpdated();
+}
+
+void Terminal::setVisible(bool _visible)
+{
+    if (visible_.exchange(_visible) == _visible || !_visible)
+        return;
+
+    // Catch up with whatever has been processed while not being visible.
+    markScreenDirty();
+    breakLoopAndRefreshRenderBuffer();
+}
+
 void Terminal::markCellDirty(CellLocation _position) noexcept
 {
     if (state_.activeStatusDisplay != ActiveStatusDisplay::Main)
@@ -1666,6 +2761,9 @@ void Terminal::markRegionDirty(Rect _area) noexcept
 
 void Terminal::synchronizedOutput(bool _enabled)
 {
+    // The lines changed in the meantime stay damaged until the next render buffer refresh,
+    // which thus rebuilds all of them at once, and only them.
+    synchronizedOutputStart_ = steady_clock::now().time_since_epoch().count();
     renderBufferUpdateEnabled_ = !_enabled;
     if (_enabled)
         return;
@@ -1674,7 +2772,11 @@ void Terminal::synchronizedOutput(bool _enabled)
 
     auto const diff = currentTime_ - renderBuffer_.lastUpdate;
     if (diff < refreshInterval_)
+    {
+        // Refreshed along with the next frame.
+        screenUpdated();
         return;
+    }
 
     if (renderBuffer_.state == RenderBufferState::TrySwapBuffers)
         return;
@@ -1683,6 +2785,15 @@ void Terminal::synchronizedOutput(bool _enabled)
     eventListener_.screenUpdated();
 }
 
+bool Terminal::renderBufferUpdateHeldBack(Timestamp _now) const noexcept
+{
+    if (renderBufferUpdateEnabled_)
+        return false;
+
+    auto const start = Timestamp(Timestamp::duration(synchronizedOutputStart_.load()));
+    return _now - start < SynchronizedOutputTimeout;
+}
+
 void Terminal::onBufferScrolled(LineCount _n) noexcept
 {
     // Adjust Normal-mode's cursor accordingly to make it fixed at the scroll-offset as if nothing has
@@ -1811,6 +2922,7 @@ optional<CellLocation> Terminal::search(std::u32string text, CellLocation search
 
 optional<CellLocation> Terminal::search(CellLocation searchPosition)
 {
+    cancelSearchInBackground();
     auto const searchText = u32string_view(state_.searchMode.pattern);
     auto const matchLocation = currentScreen().search(searchText, searchPosition);
 
@@ -1837,20 +2949,19 @@ std::tuple<std::u32string, CellLocationRange> Terminal::extractWordUnderCursor(
 {
     if (isPrimaryScreen())
     {
-        auto const range =
-            primaryScreen_.grid().wordRangeUnderCursor(position, u32string_view(wordDelimiters_));
+        auto const range = primaryScreen_.grid().wordRangeUnderCursor(position, wordDelimiters_);
         return { primaryScreen_.grid().extractText(range), range };
     }
     else
     {
-        auto const range =
-            alternateScreen_.grid().wordRangeUnderCursor(position, u32string_view(wordDelimiters_));
+        auto const range = alternateScreen_.grid().wordRangeUnderCursor(position, wordDelimiters_);
         return { alternateScreen_.grid().extractText(range), range };
     }
 }
 
 optional<CellLocation> Terminal::searchReverse(CellLocation searchPosition)
 {
+    cancelSearchInBackground();
     auto const searchText = u32string_view(state_.searchMode.pattern);
     auto const matchLocation = currentScreen().searchReverse(searchText, searchPosition);
 
@@ -1861,6 +2972,102 @@ optional<CellLocation> Terminal::searchReverse(CellLocation searchPosition)
     return matchLocation;
 }
 
+void Terminal::searchReverseInBackground(u32string text,
+                                         CellLocation searchPosition,
+                                         std::function<void(CellLocation)> _onMatch)
+{
+    auto const generation = ++searchGeneration_;
+    state_.searchMode.pattern = text;
+    screenUpdated();
+
+    if (text.empty())
+        return;
+
+    auto job = [this, generation, text = std::move(text), searchPosition, onMatch = std::move(_onMatch)]() {
+        auto const primary = [this]() {
+            auto const _l = std::lock_guard { *this };
+            return isPrimaryScreen();
+        }();
+        if (primary)
+            searchReverseInSnapshot(primaryScreen_, generation, text, searchPosition, onMatch);
+        else
+            searchReverseInSnapshot(alternateScreen_, generation, text, searchPosition, onMatch);
+    };
+
+    // Previous searches notice their cancellation within a chunk. These are not waited for here,
+    // such that handling the input is not held up.
+    auto const finished = [](std::future<void> const& _job) {
+        return _job.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    };
+    searchJobs_.erase(std::remove_if(searchJobs_.begin(), searchJobs_.end(), finished), searchJobs_.end());
+    searchJobs_.emplace_back(std::async(std::launch::async, std::move(job)));
+}
+
+template <typename Cell>
+void Terminal::searchReverseInSnapshot(Screen<Cell>& _screen,
+                                       uint64_t _generation,
+                                       u32string const& _text,
+                                       CellLocation _position,
+                                       std::function<void(CellLocation)> const& _onMatch)
+{
+    // Number of lines to search through at a time, before checking whether the search got cancelled.
+    static auto constexpr SearchChunkLineCount = LineCount(4096);
+
+    auto snapshot = GridSnapshot<Cell> {};
+    auto snapshotScrolledUpLineCount = uint64_t { 0 };
+    {
+        auto const _l = std::lock_guard { *this };
+        if (_generation != searchGeneration_ || &_screen != &currentScreen())
+            return;
+        snapshot = _screen.grid().snapshot();
+        snapshotScrolledUpLineCount = _screen.grid().scrolledUpLineCount();
+    }
+
+    auto const topLine = -boxed_cast<LineOffset>(snapshot.historyLineCount());
+    auto match = optional<CellLocation> {};
+    while (!match && _position.line >= topLine)
+    {
+        if (_generation != searchGeneration_)
+            return;
+        match = terminal::searchReverse(snapshot, _text, _position, SearchChunkLineCount);
+        _position.line -= boxed_cast<LineOffset>(SearchChunkLineCount);
+        _position.column = boxed_cast<ColumnOffset>(snapshot.pageSize().columns) - 1;
+    }
+    if (!match)
+        return;
+
+    // The match is applied on the thread handling the input, which also modifies the vi cursor.
+    // The terminal may have been destroyed by then, which is kept from happening while it is applied.
+    eventListener_.post([this,
+                         liveness = liveness_,
+                         screen = &_screen,
+                         _generation,
+                         match = *match,
+                         pageSize = snapshot.pageSize(),
+                         snapshotScrolledUpLineCount,
+                         onMatch = _onMatch]() mutable {
+        auto const _ = std::lock_guard { liveness->lock };
+        if (!liveness->alive || _generation != searchGeneration_)
+            return;
+
+        {
+            auto const _l = std::lock_guard { *this };
+            if (screen != &currentScreen() || pageSize != state_.pageSize)
+                return;
+
+            // Keep track of the match while output processed meanwhile keeps scrolling the screen.
+            match.line -=
+                LineOffset::cast_from(screen->grid().scrolledUpLineCount() - snapshotScrolledUpLineCount);
+            if (match.line < -boxed_cast<LineOffset>(screen->historyLineCount()))
+                return;
+        }
+
+        onMatch(match);
+        updateHighlights();
+        screenUpdated();
+    });
+}
+
 bool Terminal::isHighlighted(CellLocation _cell) const noexcept
 {
     return highlightRange_.has_value()
@@ -1882,6 +3089,56 @@ bool Terminal::isHighlighted(CellLocation _cell) const noexcept
                highlightRange_.value());
 }
 
+std::vector<ColumnRange> Terminal::selectedRanges(LineOffset _top, LineOffset _bottom) const
+{
+    auto result = std::vector<ColumnRange> {};
+    if (!selection_ || selection_->state() == Selection::State::Waiting)
+        return result;
+
+    auto const first = std::min(selection_->from().line, selection_->to().line);
+    auto const last = std::max(selection_->from().line, selection_->to().line);
+    if (last < _top || _bottom < first)
+        return result;
+
+    for (auto const& range: selection_->ranges())
+        if (_top <= range.line && range.line <= _bottom)
+            result.emplace_back(range);
+    return result;
+}
+
+std::vector<ColumnRange> Terminal::highlightedRanges(LineOffset _top, LineOffset _bottom) const
+{
+    auto result = std::vector<ColumnRange> {};
+    if (!highlightRange_.has_value())
+        return result;
+
+    auto const rightMargin = boxed_cast<ColumnOffset>(pageSize().columns - 1);
+    std::visit(
+        [&](auto&& highlightRange) {
+            using T = std::decay_t<decltype(highlightRange)>;
+            if constexpr (std::is_same_v<T, LinearHighlight>)
+            {
+                auto const from = std::min(highlightRange.from, highlightRange.to);
+                auto const to = std::max(highlightRange.from, highlightRange.to);
+                for (auto line = std::max(from.line, _top); line <= std::min(to.line, _bottom); ++line)
+                    result.emplace_back(ColumnRange { line,
+                                                      line == from.line ? from.column : ColumnOffset(0),
+                                                      line == to.line ? to.column : rightMargin });
+            }
+            else
+            {
+                auto const from = highlightRange.from;
+                auto const to = highlightRange.to;
+                if (from.column > to.column)
+                    return;
+                for (auto line = std::max(from.line, _top); line <= std::min(to.line, _bottom); ++line)
+                    result.emplace_back(ColumnRange { line, from.column, to.column });
+            }
+        },
+        highlightRange_.value());
+    return result;
+}
+
 void Terminal::resetHighlight()
 {
     highlightRange_ = std::nullopt;
@@ -15,28 +15,41 @@
 
 #include <terminal/InputGenerator.h>
 #include <terminal/InputHandler.h>
+#include <terminal/PtyRecording.h>
 #include <terminal/RenderBuffer.h>
 #include <terminal/ScreenEvents.h>
 #include <terminal/Selector.h>
 #include <terminal/Sequence.h>
 #include <terminal/TerminalState.h>
+#include <terminal/TmuxControlMode.h>
 #include <terminal/ViInputHandler.h>
 #include <terminal/Viewport.h>
+#include <terminal/WordDelimiters.h>
 #include <terminal/cell/CellConcept.h>
 #include <terminal/cell/CellConfig.h>
 #include <terminal/primitives.h>
 #include <terminal/pty/Pty.h>
 
+#include <crispy/CacheStats.h>
+#include <crispy/LatencyHistogram.h>
+#include <crispy/MemoryStats.h>
+#include <crispy/SpscQueue.h>
 #include <crispy/defines.h>
 
 #include <fmt/format.h>
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <functional>
+#include <future>
 #include <memory>
 #include <mutex>
+#include <optional>
+#include <string>
 #include <string_view>
+#include <thread>
 #include <type_traits>
 #include <vector>
 
@@ -92,6 +105,16 @@ class Terminal
         virtual void playSound(Sequence::Parameters const&) {}
         virtual void cursorPositionChanged() {}
         virtual void onScrollOffsetChanged(ScrollOffset) {}
+
+        /// Runs the given function later on the thread handling the input events (e.g. the GUI thread),
+        /// or right away if there is no such thread.
+        virtual void post(std::function<void()> _fn) { _fn(); }
+
+        /// tmux has been started in control mode (tmux -CC) on this terminal.
+        ///
+        /// @returns the receiver of its notifications until it exits,
+        ///          or nullptr for not supporting control mode, in which case its output is ignored.
+        virtual TmuxControlParser::Events* tmuxControlModeStarted() { return nullptr; }
     };
 
     Terminal(std::unique_ptr<Pty> _pty,
@@ -111,18 +134,56 @@ class Terminal
              double _refreshRate = 30.0,
              bool _allowReflowOnResize = true,
              std::chrono::milliseconds _highlightTimeout = std::chrono::milliseconds { 150 });
-    ~Terminal() = default;
+    ~Terminal();
 
     void start();
 
     void setRefreshRate(double _refreshRate);
+    std::chrono::microseconds refreshInterval() const noexcept { return refreshInterval_; }
     void setLastMarkRangeOffset(LineOffset _value) noexcept;
 
     void setMaxHistoryLineCount(MaxHistoryLineCount _maxHistoryLineCount);
     LineCount maxHistoryLineCount() const noexcept;
 
+    /// Sets the number of threads that build the main page of the render buffer in bands of lines.
+    ///
+    /// The page is only split into bands if it is large enough to benefit from it.
+    void setRenderBufferThreadCount(unsigned _count) noexcept
+    {
+        renderBufferThreadCount_ = std::max(1u, _count);
+    }
+
+    void setHistoryCompactionThreshold(std::optional<LineCount> _threshold) noexcept
+    {
+        primaryScreen_.grid().setHistoryCompactionThreshold(_threshold);
+    }
+
+    /// Backs the PTY buffer objects by transparent huge pages where available, and faults in
+    /// the one to be filled first, such that the first burst of output does not page-fault.
+    ///
+    /// Must be called before start().
+    void setPtyBufferHugePages(bool _enabled);
+
+    /// Enables or disables profiling the VT sequences applied to the screen (see SequenceProfiler),
+    /// whose results are part of the screen's inspect dump.
+    void setSequenceProfiling(bool _enabled);
+    [[nodiscard]] SequenceProfiler const* sequenceProfiler() const noexcept
+    {
+        return state_.sequenceProfiler.get();
+    }
+
     void setTerminalId(VTType _id) noexcept { state_.terminalId = _id; }
     void setSixelCursorConformance(bool _value) noexcept { state_.sixelCursorConformance = _value; }
+    void setProgressiveSixel(bool _value) noexcept { state_.progressiveSixel = _value; }
+    void setSixelDecoderThreads(unsigned _count) noexcept { state_.sixelDecoderThreads = std::max(1u, _count); }
+
+    /// Configures images to be resized on @p _threadCount worker threads, or synchronously if 0.
+    ///
+    /// Asynchronously resized images are left blank until ready, rather than blocking text output.
+    void setImageRasterizerThreads(size_t _threadCount);
+
+    /// Compresses the least recently used images beyond @p _bytes, see ImagePool::setMemoryBudget().
+    void setImageMemoryBudget(size_t _bytes) { state_.imagePool.setMemoryBudget(_bytes); }
 
     void setMaxImageSize(ImageSize size) noexcept { state_.maxImageSize = size; }
 
@@ -285,7 +346,25 @@ class Terminal
                                Timestamp _now);
     bool sendFocusInEvent();
     bool sendFocusOutEvent();
-    void sendPaste(std::string_view _text); // Sends verbatim text in bracketed mode to application.
+    /// Number of bytes of a paste queued for the application at a time.
+    static constexpr size_t PasteChunkSize = 64 * 1024;
+
+    /// Sends verbatim text in bracketed mode to application.
+    ///
+    /// Pastes larger than PasteChunkSize are streamed to the application chunk by chunk
+    /// by subsequent calls to flushInput(), interleaved with reading its output.
+    void sendPaste(std::string_view _text);
+
+    /// Cancels the paste currently being streamed, if any.
+    ///
+    /// The part of the paste not yet queued for the application is discarded.
+    /// @returns whether a paste was cancelled.
+    bool cancelPaste();
+
+    /// @returns the fraction of the paste currently being streamed that has been queued so far,
+    ///          or nothing if no paste is being streamed.
+    [[nodiscard]] std::optional<double> pasteProgress() const;
+
     void sendPasteFromClipboard(unsigned count = 1) { eventListener_.pasteFromClipboard(count); }
 
     bool handleMouseSelection(Modifier _modifier, Timestamp _now);
@@ -299,9 +378,27 @@ class Terminal
 
     bool hasInput() const noexcept;
     size_t pendingInputBytes() const noexcept;
+
+    /// Writes pending replies and generated input to the PTY, coalesced into a single write.
+    ///
+    /// Whatever the PTY does not accept right now stays queued for the next call.
     void flushInput();
 
-    std::string_view peekInput() const noexcept { return state_.inputGenerator.peek(); }
+    /// Returns the pending replies and generated input that have not been written to the PTY yet.
+    [[nodiscard]] std::string peekInput() const;
+
+    /// Starts replying a buffer capture of the bottom @p _lines lines of the primary screen.
+    ///
+    /// The capture is replied chunk by chunk via continueCaptureBuffer(), such that neither the
+    /// whole capture is held in memory, nor the terminal is locked for the duration of the capture.
+    /// Lines scrolling into the history meanwhile do not shift the captured lines.
+    void startCaptureBuffer(LineCount _lines, bool _logical);
+
+    /// Replies the next chunk of the buffer capture in progress, with the terminal locked.
+    ///
+    /// @retval true the capture is still in progress.
+    /// @retval false the capture has been completed, or none has been started.
+    bool continueCaptureBuffer();
     // }}}
 
     /// Writes a given VT-sequence to screen.
@@ -321,7 +418,10 @@ class Terminal
     {
         auto const changes = changes_.exchange(0);
         currentTime_ = _now;
+        if (state_.inputGenerator.hasPendingMouseMove())
+            flushPendingMouseMove();
         updateCursorVisibilityState();
+        releaseIdleAlternateScreen();
         if (isBlinkOnScreen())
         {
             tie(_rapidBlinker.state, _lastRapidBlink) = nextBlinkState(_rapidBlinker, _lastRapidBlink);
@@ -333,28 +433,26 @@ class Terminal
 
     // {{{ RenderBuffer synchronization API
 
-    /// Ensures the terminals event loop is interrupted
-    /// and the render buffer is refreshed.
+    /// Ensures the render buffer is refreshed.
     ///
+    /// The terminals event loop is only interrupted if it is the one refreshing the render buffer
+    /// (LIBTERMINAL_PASSIVE_RENDER_BUFFER_UPDATE), as otherwise the render thread does so
+    /// upon its next frame anyways.
     void breakLoopAndRefreshRenderBuffer();
 
     /// Refreshes the render buffer.
     /// When this function returns, the back buffer is updated
-    /// and it is attempted to swap the back/front buffers.
-    /// but the swap has NOT been invoked yet.
+    /// and published as the latest completed render buffer.
     ///
     /// @param _locked whether or not the Terminal object's lock is already held by the caller.
     ///
-    /// @retval true   front buffer now contains the refreshed render buffer.
-    /// @retval false  back buffer contains the refreshed render buffer,
-    ///                and RenderDoubleBuffer::swapBuffers() must again
-    ///                be successfully invoked to swap back/front buffers
-    ///                in order to access the refreshed render buffer.
+    /// @retval true   the refreshed render buffer is available via renderBuffer().
+    /// @retval false  render buffer updates are currently disabled, e.g. due to synchronized output.
     ///
     /// @note The current time must have been updated in order to get the
     ///       correct cursor blinking state drawn.
     ///
-    /// @see RenderDoubleBuffer::swapBuffers()
+    /// @see RenderTripleBuffer::swapBuffers()
     /// @see renderBuffer()
     ///
     bool refreshRenderBuffer(bool _locked = false);
@@ -367,14 +465,14 @@ class Terminal
     /// @param _now    the current time
     /// @param _locked whether or not the Terminal object's lock is already held by the caller.
     ///
-    /// @see RenderDoubleBuffer::swapBuffers()
+    /// @see RenderTripleBuffer::swapBuffers()
     /// @see renderBuffer()
     bool ensureFreshRenderBuffer(bool _locked = false);
 
-    /// Aquuires read-access handle to front render buffer.
+    /// Aquuires read-access handle to the latest completed render buffer.
     ///
-    /// This also acquires the reader lock and releases it automatically
-    /// upon RenderBufferRef destruction.
+    /// This must only be invoked by the render thread, and the handle is valid
+    /// until the next call.
     ///
     /// @see ensureFreshRenderBuffer()
     /// @see refreshRenderBuffer()
@@ -382,6 +480,67 @@ class Terminal
 
     [[nodiscard]] RenderBufferState renderBufferState() const noexcept { return renderBuffer_.state; }
 
+    /// Tests whether the application is flooding the terminal with output faster than it can be
+    /// parsed, in which case intermediate screen states are skipped (jump scrolling), and the render
+    /// buffer is only refreshed every FastForwardFrameInterval until the flood subsides.
+    [[nodiscard]] bool fastForwarding() const noexcept { return fastForwarding_; }
+
+    /// Durations of the stages that PTY output passes through until it is ready to be rendered.
+    struct PipelineStats
+    {
+        crispy::LatencyHistogram queueing;            //!< from being read until parsed, if read ahead
+        crispy::LatencyHistogram parsing;             //!< parsing a PTY read and applying it to the screen
+        crispy::LatencyHistogram refreshRenderBuffer; //!< building a render buffer from the screen
+    };
+
+    [[nodiscard]] PipelineStats const& pipelineStats() const noexcept { return pipelineStats_; }
+
+    /// Durations from key presses until the frames showing their echo have been presented.
+    [[nodiscard]] crispy::LatencyHistogram const& inputLatency() const noexcept { return inputLatency_; }
+
+    /// Records the presentation of a frame showing the echo of the key press at @p _keyPress.
+    void recordInputLatency(Timestamp _keyPress, Timestamp _presented) noexcept
+    {
+        inputLatency_.record(_presented - _keyPress);
+    }
+
+    /// Replies the input latency statistics to the application, and optionally resets them.
+    void reportInputLatency(bool _reset);
+
+    /// Replies the statistics of all caches of this process to the application.
+    void reportCacheStats();
+
+    /// Replies the memory usage of all subsystems of this process to the application.
+    void reportMemoryStats();
+
+    /// Updates the estimated memory usage of this session's subsystems (and of the process-wide ones).
+    void publishMemoryStats();
+
+    /// @returns the memory usage of this session's subsystems as of the last publishMemoryStats().
+    [[nodiscard]] std::vector<crispy::MemoryStats::Snapshot> memoryStats() const;
+
+    /// Releases the memory this terminal only holds on to for speed, e.g. once it has been idle for a while.
+    ///
+    /// Scrollback lines are packed into their compact representation where possible,
+    /// and unused PTY buffer objects are freed. Locks the terminal.
+    void trimMemory();
+
+    /// Releases the memory pooled for all terminals of the process, e.g. once all of them are idle.
+    static void releasePooledMemory();
+
+    /// @returns the memory held by the lines of the primary screen, including the text they refer to
+    ///          in PTY buffer objects. Locks the terminal.
+    [[nodiscard]] size_t historyMemoryUsage();
+
+    /// Shrinks the memory held by the lines of the primary screen to at most the given number of bytes,
+    /// e.g. to stay within a scrollback memory budget shared with other terminals.
+    ///
+    /// Scrollback lines are packed into their compact representation first, and only if that does
+    /// not suffice, the oldest of them are dropped. Locks the terminal.
+    ///
+    /// @returns the number of bytes released.
+    size_t trimHistory(size_t _maxBytes);
+
     /// Updates the IME preedit-string to be rendered when IME is composing a new input.
     /// Passing an empty string effectively disables IME rendering.
     void updateInputMethodPreeditString(std::string preeditString);
@@ -479,7 +638,7 @@ class Terminal
     // {{{ selection management
     // TODO: move you, too?
     void setWordDelimiters(std::string const& _wordDelimiters);
-    std::u32string const& wordDelimiters() const noexcept { return wordDelimiters_; }
+    std::u32string const& wordDelimiters() const noexcept { return wordDelimiters_.codepoints(); }
 
     Selection const* selector() const noexcept { return selection_.get(); }
     Selection* selector() noexcept { return selection_.get(); }
@@ -529,6 +688,17 @@ class Terminal
     }
 
     bool isHighlighted(CellLocation _cell) const noexcept;
+
+    /// @returns the column ranges of the current selection within the given grid lines, ordered by line.
+    std::vector<ColumnRange> selectedRanges(LineOffset _top, LineOffset _bottom) const;
+
+    /// @returns the column ranges of the current highlight within the given grid lines, ordered by line.
+    std::vector<ColumnRange> highlightedRanges(LineOffset _top, LineOffset _bottom) const;
+
+    /// @returns the column ranges of the matches of the search pattern on the page being rendered,
+    ///          ordered by line.
+    std::vector<ColumnRange> const& searchMatchRanges() const noexcept { return searchMatchRanges_; }
+
     bool blinkState() const noexcept { return _slowBlinker.state; }
     bool rapidBlinkState() const noexcept { return _rapidBlinker.state; }
 
@@ -540,22 +710,90 @@ class Terminal
     // }}}
 
     [[nodiscard]] std::string extractSelectionText() const;
+
+    /// Extracts the selected text like extractSelectionText(), but on a worker thread.
+    ///
+    /// The terminal is only locked for taking a snapshot of the screen's lines, so that extracting
+    /// a selection of the whole scrollback does not hold up the caller nor processing PTY output.
+    /// @p _onDone is invoked on the worker thread.
+    void extractSelectionTextInBackground(std::function<void(std::string)> _onDone);
     [[nodiscard]] std::string extractLastMarkRange() const;
 
-    /// Tests whether or not the mouse is currently hovering a hyperlink.
+    /// Extracts the output of the most recent command, as reported via shell integration (OSC 133).
+    [[nodiscard]] std::string extractLastCommandOutput() const;
+
+    /// Tests whether or not the mouse is currently hovering a hyperlink or a plain-text URL.
     [[nodiscard]] bool isMouseHoveringHyperlink() const noexcept { return hoveringHyperlink_.load(); }
 
     /// Retrieves the HyperlinkInfo that is currently behing hovered by the mouse, if so,
     /// or a nothing otherwise.
-    [[nodiscard]] std::shared_ptr<HyperlinkInfo const> tryGetHoveringHyperlink() const noexcept
+    ///
+    /// The returned hyperlink is only valid as long as the terminal is locked.
+    [[nodiscard]] HyperlinkInfo const* tryGetHoveringHyperlink() const noexcept
     {
         if (auto const gridPosition = currentMouseGridPosition())
             return currentScreen_.get().hyperlinkAt(*gridPosition);
-        return {};
+        return nullptr;
+    }
+
+    /// Retrieves the ID of the hyperlink the mouse is hovering on the page as shown with the most recent
+    /// render buffer refresh, or an invalid ID if none.
+    [[nodiscard]] HyperlinkId hoveringHyperlinkId() const noexcept
+    {
+        return hyperlinkSpans_.at(currentMousePosition_);
+    }
+
+    /// Retrieves the URL shown as plain text that is currently being hovered by the mouse, if so,
+    /// or nothing otherwise.
+    [[nodiscard]] std::optional<std::string> tryGetHoveringPlainTextUrl() const
+    {
+        if (auto const gridPosition = currentMouseGridPosition())
+            return currentScreen_.get().plainTextUrlAt(*gridPosition);
+        return std::nullopt;
     }
 
+    /// Releases the hyperlinks no longer referred to by any screen's cells or cursors.
+    void releaseUnreferencedHyperlinks();
+
+    /// Adds the hyperlink storage's stats to the process-wide cache stats.
+    void publishHyperlinkStats();
+
     bool processInputOnce();
 
+    /// Processes the input that is readily available from the PTY, without waiting for any.
+    ///
+    /// This is to be used instead of processInputOnce() when a PtyReactor waits for the PTY to
+    /// become readable, rather than the PTY being read by a thread of its own.
+    ///
+    /// @returns false once the PTY has been closed.
+    bool processAvailableInput();
+
+    /// Starts a dedicated thread that reads from the PTY and hands the data over to
+    /// processInputOnce() via a lock-free queue.
+    ///
+    /// This keeps the PTY drained while the terminal is locked, e.g. while a frame is being built,
+    /// such that the client application does not block on a full PTY.
+    ///
+    /// With @p _pipelinedParsing, the reader thread also parses the data into an op stream
+    /// (see OpStreamWriter), such that processInputOnce() only needs to apply it to the screen,
+    /// and parsing overlaps with screen updates.
+    void startPtyReaderThread(bool _pipelinedParsing = false);
+
+    /// Tees all data read from the PTY, as well as screen resizes, into the given recorder.
+    ///
+    /// This must be called before reading from the PTY has been started.
+    void setPtyRecorder(std::unique_ptr<PtyRecorder> _recorder) noexcept
+    {
+        ptyRecorder_ = std::move(_recorder);
+    }
+
+    /// Marks the terminal as being visible, or not (e.g. its window being minimized).
+    ///
+    /// While not visible, the terminal keeps processing its input, but neither asks for blinking
+    /// to be rendered nor refreshes its render buffer by itself.
+    void setVisible(bool _visible);
+    [[nodiscard]] bool isVisible() const noexcept { return visible_.load(); }
+
     void markScreenDirty() { screenDirty_ = true; }
     [[nodiscard]] bool screenDirty() const noexcept { return screenDirty_; }
 
@@ -596,13 +834,16 @@ class Terminal
     void saveWindowTitle();
     void restoreWindowTitle();
     void setTerminalProfile(std::string const& _configProfileName);
+    [[nodiscard]] TmuxControlParser::Events* startTmuxControlMode();
     void useApplicationCursorKeys(bool _enabled);
     void softReset();
     void hardReset();
     void discardImage(Image const&);
+    void imageRasterized();
     void markCellDirty(CellLocation _position) noexcept;
     void markRegionDirty(Rect _area) noexcept;
     void synchronizedOutput(bool _enabled);
+    [[nodiscard]] bool renderBufferUpdateHeldBack(Timestamp _now) const noexcept;
     void onBufferScrolled(LineCount _n) noexcept;
 
     void setMaxImageColorRegisters(unsigned value) noexcept { state_.maxImageColorRegisters = value; }
@@ -625,6 +866,24 @@ class Terminal
         return currentPtyBuffer_;
     }
 
+    /// Number of bytes currently requested per PTY read, adapted to the output rate.
+    [[nodiscard]] size_t ptyReadSize() const noexcept { return ptyReadSize_.load(); }
+    [[nodiscard]] size_t maxPtyReadSize() const noexcept { return maxPtyReadSize_; }
+
+    [[nodiscard]] crispy::BufferObjectPoolStats ptyBufferPoolStats() const noexcept
+    {
+        return ptyBufferPool_.stats();
+    }
+
+    /// Marks the current PTY buffer as used up to the given position,
+    /// such that the next PTY read does not overwrite text that is referenced by the grid.
+    void advanceCurrentPtyBufferUntil(char const* _end) noexcept
+    {
+        // Data handed over by the PTY reader thread has been claimed by the reader already.
+        if (!parsingQueuedPtyInput_)
+            currentPtyBuffer_->advanceHotEndUntil(_end);
+    }
+
     [[nodiscard]] terminal::SelectionHelper& selectionHelper() noexcept { return selectionHelper_; }
 
     [[nodiscard]] ViInputHandler& inputHandler() noexcept { return state_.inputHandler; }
@@ -651,6 +910,19 @@ class Terminal
     [[nodiscard]] std::optional<CellLocation> search(std::u32string text, CellLocation searchPosition);
     [[nodiscard]] std::optional<CellLocation> search(CellLocation searchPosition);
 
+    // Sets the current search term to the given text and searches reverse for it on a worker thread.
+    //
+    // The lines are searched on a snapshot of the grid, so that processing PTY output is not held up
+    // by searching a huge scrollback, as the terminal is only locked for taking the snapshot.
+    // Once found, @p _onMatch is posted to the thread handling the input events (see Events::post()),
+    // unless the search has been cancelled meanwhile.
+    //
+    // Any search started later on, including synchronous ones, cancels the running search.
+    void searchReverseInBackground(std::u32string text,
+                                   CellLocation searchPosition,
+                                   std::function<void(CellLocation)> _onMatch);
+    void cancelSearchInBackground() noexcept { ++searchGeneration_; }
+
     // Tests if the grid cell at the given location does contain a word delimiter.
     [[nodiscard]] bool wordDelimited(CellLocation position) const noexcept;
 
@@ -661,8 +933,31 @@ class Terminal
     void mainLoop();
     void refreshRenderBuffer(RenderBuffer& _output); // <- acquires the lock
     void refreshRenderBufferInternal(RenderBuffer& _output);
+    template <typename Cell>
+    RenderPassHints renderMainPage(Screen<Cell> const& _screen, RenderBuffer& _output, bool _reverseVideo);
+    template <typename Cell>
+    RenderPassHints buildMainPage(Screen<Cell> const& _screen,
+                                  RenderBuffer& _output,
+                                  bool _reverseVideo,
+                                  RenderLineCache* _lineCache);
+    /// Collects the hyperlinks shown on the visible page into hyperlinkSpans_.
+    void updateHyperlinkSpans();
+    /// Collects the matches of the search pattern on the visible page into searchMatchRanges_,
+    /// reusing the matches each line has cached since it has last been modified.
+    template <typename Cell>
+    void updateSearchMatchRanges(Screen<Cell> const& _screen);
+    template <typename Cell>
+    void searchReverseInSnapshot(Screen<Cell>& _screen,
+                                 uint64_t _generation,
+                                 std::u32string const& _text,
+                                 CellLocation _position,
+                                 std::function<void(CellLocation)> const& _onMatch);
     void updateIndicatorStatusLine();
+    void streamPaste(); // Requires pendingRepliesLock_ to be held.
     void updateCursorVisibilityState() const;
+    // Frees the alternate screen's grid once the primary screen has been in use for a while.
+    void releaseIdleAlternateScreen();
+    void flushPendingMouseMove();
     bool updateCursorHoveringState();
 
     template <typename BlinkerState>
@@ -675,8 +970,26 @@ class Terminal
         return { !blinker.state, currentTime_ };
     }
 
-    // Reads from PTY.
-    [[nodiscard]] Pty::ReadResult readFromPty();
+    // Reads from PTY, and processes what has been read.
+    [[nodiscard]] Pty::ReadResult readFromPty(std::chrono::milliseconds _timeout);
+    bool processPtyInput(std::chrono::milliseconds _timeout);
+    [[nodiscard]] std::chrono::milliseconds ptyReadTimeout() const noexcept;
+    void adaptPtyReadSize(size_t _bytesRead) noexcept;
+    void compactPtyBuffersIfNeeded();
+    void markKeyPress(Timestamp _now) noexcept;
+    void detectKeyPressEcho(Timestamp _readTime);
+    void ptyInputProcessed(bool _moreInputPending);
+    void yieldToPendingInput();
+
+    // Reads from the PTY on the PTY reader thread until the PTY is closed or the terminal is destroyed.
+    void ptyReaderLoop();
+    void pushPtyInput(crispy::BufferObjectPtr<char> _buffer,
+                      std::string_view _data,
+                      bool _fromStdoutFastPipe,
+                      std::string _ops);
+    void wakeupPtyInputConsumer();
+    bool processQueuedInputOnce();
+    void stopPtyReaderThread();
 
     // Writes partially or all input data to the PTY buffer object and returns a string view to it.
     [[nodiscard]] std::string_view lockedWriteToPtyBuffer(std::string_view data);
@@ -689,9 +1002,11 @@ class Terminal
 
     Events& eventListener_;
 
-    std::chrono::milliseconds refreshInterval_;
+    // Duration of one display frame, i.e. the minimum time between two render buffer refreshes.
+    // Kept in microseconds, as high refresh rates (e.g. 144 Hz) are not a whole number of milliseconds.
+    std::chrono::microseconds refreshInterval_;
     bool screenDirty_ = false;
-    RenderDoubleBuffer renderBuffer_ {};
+    RenderTripleBuffer renderBuffer_ {};
 
     std::unique_ptr<Pty> pty_;
 
@@ -704,7 +1019,7 @@ class Terminal
     std::chrono::milliseconds cursorBlinkInterval_;
     mutable unsigned cursorBlinkState_;
 
-    std::u32string wordDelimiters_;
+    WordDelimiters wordDelimiters_;
 
     // helpers for detecting double/tripple clicks
     std::chrono::steady_clock::time_point lastClick_ {};
@@ -721,7 +1036,81 @@ class Terminal
     TerminalState state_;
     crispy::BufferObjectPool<char> ptyBufferPool_;
     crispy::BufferObjectPtr<char> currentPtyBuffer_;
-    size_t ptyReadBufferSize_;
+    // The PTY read size starts at the configured read buffer size and grows towards maxPtyReadSize_
+    // while consecutive reads come back full (bulk output), and shrinks again towards
+    // MinimumPtyReadSize while reads come back small (interactive use).
+    static constexpr size_t MinimumPtyReadSize = 4096;
+    size_t maxPtyReadSize_;
+    std::atomic<size_t> ptyReadSize_;
+    unsigned fullPtyReadCount_ = 0;
+    unsigned smallPtyReadCount_ = 0;
+    // Number of PTY buffer objects in use after the last look for sparsely referenced ones.
+    size_t ptyBuffersAtLastCompaction_ = 0;
+    PipelineStats pipelineStats_;
+    static constexpr auto AlternateScreenIdleTimeout = std::chrono::minutes(1);
+
+    // {{{ input priority
+    // PTY output is parsed in slices of at most this size, each with the terminal lock held,
+    // such that user input is not held up by a whole read buffer's worth of output.
+    static constexpr size_t ParseSliceSize = 64 * 1024;
+    // Set by key presses, and reset by the terminal thread when yielding the lock to them.
+    std::atomic<bool> inputPending_ = false;
+    // }}}
+
+    // {{{ fast-forward (jump scrolling)
+    static constexpr auto FastForwardFrameInterval = std::chrono::milliseconds(100);
+    // Set by the terminal thread while PTY output is pending right after having processed some.
+    std::atomic<bool> fastForwarding_ = false;
+    // Time the screen was last reported updated while fast-forwarding.
+    Timestamp lastFastForwardFrame_ {};
+    // }}}
+
+    // {{{ input latency measurement
+    // The output parsed first after a key press is taken as its echo. Only one key press is measured
+    // at a time, so that the echo of one key press cannot be mistaken for another one's.
+    static constexpr auto MaxKeyPressEchoDelay = std::chrono::seconds(1);
+    // Time of the key press whose echo has not been parsed yet, in steady clock ticks, or 0 if none.
+    std::atomic<Timestamp::rep> unechoedKeyPress_ = 0;
+    // Time of the key press whose echo has been parsed but not yet put into a render buffer.
+    std::optional<Timestamp> echoedKeyPress_;
+    crispy::LatencyHistogram inputLatency_;
+    crispy::CacheStats hyperlinkCacheStats_ { "Hyperlinks" };
+    // }}}
+
+    // {{{ memory accounting, see publishMemoryStats()
+    crispy::MemoryStats trivialLinesMemory_ { "Grid lines (trivial)" };
+    crispy::MemoryStats inflatedLinesMemory_ { "Grid lines (inflated)" };
+    crispy::MemoryStats attributedLinesMemory_ { "Grid lines (attributed)" };
+    crispy::MemoryStats ptyBuffersInUseMemory_ { "PTY buffer objects (in use)" };
+    crispy::MemoryStats ptyBuffersPooledMemory_ { "PTY buffer objects (pooled)" };
+    crispy::MemoryStats hyperlinksMemory_ { "Hyperlinks" };
+    crispy::MemoryStats imagesMemory_ { "Images" };
+    // }}}
+
+    // {{{ PTY reader thread
+    struct PtyInputChunk
+    {
+        crispy::BufferObjectPtr<char> buffer; // keeps the data alive; nullptr if the PTY reached its end
+        std::string_view data;
+        bool fromStdoutFastPipe = false;
+        std::string ops; // op stream of the data, if parsed by the reader thread already
+        std::chrono::steady_clock::time_point readTime {};
+    };
+    static constexpr size_t PtyInputQueueCapacity = 64;
+    crispy::SpscQueue<PtyInputChunk, PtyInputQueueCapacity> ptyInputQueue_;
+    // The mutex and condition variable are only used for parking either side
+    // while the queue is empty (or full), never for handing over data.
+    std::mutex ptyInputMutex_;
+    std::condition_variable ptyInputCondition_;
+    std::atomic<bool> ptyInputConsumerParked_ = false;
+    std::atomic<bool> ptyInputProducerParked_ = false;
+    bool ptyInputWakeupPending_ = false; // guarded by ptyInputMutex_
+    std::atomic<bool> ptyReaderStopping_ = false;
+    bool ptyInputPipelined_ = false;
+    bool parsingQueuedPtyInput_ = false;
+    std::unique_ptr<std::thread> ptyReaderThread_;
+    std::unique_ptr<PtyRecorder> ptyRecorder_;
+    // }}}
     Screen<PrimaryScreenCell> primaryScreen_;
     Screen<AlternateScreenCell> alternateScreen_;
     Screen<StatusDisplayCell> hostWritableStatusLineScreen_;
@@ -736,9 +1125,50 @@ class Terminal
     std::unique_ptr<Selection> selection_;
     std::atomic<bool> hoveringHyperlink_ = false;
     std::atomic<bool> renderBufferUpdateEnabled_ = true;
+    std::atomic<bool> visible_ = true;
+
+    // Render buffer updates are held back by synchronized output for at most this long, such that
+    // an application that never ends its batch does not freeze the screen.
+    static constexpr auto SynchronizedOutputTimeout = std::chrono::milliseconds(200);
+    // Time synchronized output has been enabled at, in steady clock ticks.
+    std::atomic<Timestamp::rep> synchronizedOutputStart_ = 0;
+
+    // Replies to the application (e.g. DA or DSR), generated while parsing, and queued for flushInput().
+    // Guarded by its own mutex, as replies are generated on the parser thread
+    // while input is generated and flushed by the GUI thread.
+    mutable std::mutex pendingRepliesLock_;
+    std::string pendingReplies_;
+
+    // Paste being streamed to the application by flushInput(), guarded by pendingRepliesLock_.
+    struct PasteState
+    {
+        std::string text;
+        size_t offset = 0;
+    };
+    std::optional<PasteState> paste_;
+
+    // Buffer capture in progress, continued by continueCaptureBuffer().
+    struct CaptureBufferState
+    {
+        LineOffset nextLine;
+        bool logicalLines;
+        uint64_t scrolledUpLineCount;
+    };
+    std::optional<CaptureBufferState> captureBuffer_;
 
     std::atomic<uint64_t> lastFrameID_ = 0;
 
+    // Incremented for cancelling the current background search, if any.
+    std::atomic<uint64_t> searchGeneration_ = 0;
+
+    // Shared with the functions posted to the input thread, which may only run after this terminal is gone.
+    struct Liveness
+    {
+        std::mutex lock;
+        bool alive = true; //!< false once the terminal is being destroyed
+    };
+    std::shared_ptr<Liveness> liveness_ = std::make_shared<Liveness>();
+
     struct SelectionHelper: public terminal::SelectionHelper
     {
         Terminal* terminal;
@@ -758,10 +1188,20 @@ class Terminal
         std::chrono::milliseconds const interval;
     };
     RenderPassHints _lastRenderPassHints;
+    RenderLineCache renderLineCache_;
+    HyperlinkSpans hyperlinkSpans_; // hyperlinks on the visible page as of the last render buffer refresh
+    std::vector<ResolvedColorCache> colorCaches_; // one per band of the main page
+    unsigned renderBufferThreadCount_ = 1;
+    std::vector<RenderBuffer> renderBands_; // render buffers of all but the first band of the main page
+    std::vector<ColumnRange> searchMatchRanges_;
     mutable BlinkerState _slowBlinker { false, std::chrono::milliseconds { 500 } };
     mutable BlinkerState _rapidBlinker { false, std::chrono::milliseconds { 300 } };
     mutable std::chrono::steady_clock::time_point _lastBlink;
     mutable std::chrono::steady_clock::time_point _lastRapidBlink;
+
+    // Kept last, so that a running background search is finished before anything else is destroyed.
+    std::vector<std::future<void>> searchJobs_; //!< background searches, pruned of finished ones on every new search
+    std::future<void> selectionJob_;
 };
 
 } // namespace terminal
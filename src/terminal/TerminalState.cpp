@@ -45,14 +45,14 @@ TerminalState::TerminalState(Terminal& _terminal,
     sixelCursorConformance { _sixelCursorConformance },
     allowReflowOnResize { _allowReflowOnResize },
     primaryBuffer { _pageSize, _allowReflowOnResize, _maxHistoryLineCount },
-    alternateBuffer { _pageSize, false, LineCount(0) },
+    alternateBuffer { UnallocatedAlternateBufferSize, false, LineCount(0) },
     hostWritableStatusBuffer { PageSize { LineCount(1), _pageSize.columns }, false, LineCount(0) },
     indicatorStatusBuffer { PageSize { LineCount(1), _pageSize.columns }, false, LineCount(0) },
     statusDisplayType { StatusDisplayType::None },
     activeStatusDisplay { ActiveStatusDisplay::Main },
     cursor {},
     lastCursorPosition {},
-    hyperlinks { HyperlinkCache { 1024 } },
+    hyperlinks {},
     sequencer { _terminal },
     parser { std::ref(sequencer) },
     viCommands { terminal },
@@ -14,6 +14,7 @@
 #pragma once
 
 #include <terminal/Charset.h>
+#include <terminal/CodepointTable.h>
 #include <terminal/ColorPalette.h>
 #include <terminal/GraphicsAttributes.h>
 #include <terminal/Grid.h>
@@ -22,6 +23,7 @@
 #include <terminal/InputHandler.h>
 #include <terminal/Parser.h>
 #include <terminal/ScreenEvents.h> // ScreenType
+#include <terminal/SequenceProfiler.h>
 #include <terminal/Sequencer.h>
 #include <terminal/ViCommands.h>
 #include <terminal/ViInputHandler.h>
@@ -32,7 +34,12 @@
 
 #include <fmt/format.h>
 
+#include <algorithm>
+#include <array>
 #include <bitset>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <stack>
@@ -50,42 +57,69 @@ class Terminal;
 class Modes
 {
   public:
+    /// Number of nested saves per DEC mode that can be restored. Older saves are forgotten.
+    static constexpr size_t MaxSaveDepth = 32;
+
+    static_assert(DECModeCount <= 64, "All DEC modes must fit into one bitmask.");
+    static_assert(MaxSaveDepth <= 32, "All saved values of a mode must fit into one bitmask.");
+
     void set(AnsiMode _mode, bool _enabled) { ansi_.set(static_cast<size_t>(_mode), _enabled); }
 
-    void set(DECMode _mode, bool _enabled) { dec_.set(static_cast<size_t>(_mode), _enabled); }
+    void set(DECMode _mode, bool _enabled)
+    {
+        if (_enabled)
+            dec_ |= bit(_mode);
+        else
+            dec_ &= ~bit(_mode);
+    }
 
     [[nodiscard]] bool enabled(AnsiMode _mode) const noexcept
     {
         return ansi_.test(static_cast<size_t>(_mode));
     }
 
-    [[nodiscard]] bool enabled(DECMode _mode) const noexcept { return dec_.test(static_cast<size_t>(_mode)); }
+    [[nodiscard]] bool enabled(DECMode _mode) const noexcept { return (dec_ & bit(_mode)) != 0; }
 
     void save(std::vector<DECMode> const& _modes)
     {
         for (DECMode const mode: _modes)
-            savedModes_[mode].push_back(enabled(mode));
+        {
+            auto& saved = savedModes_[toDECModeIndex(mode)];
+            saved.values = (saved.values << 1) | (enabled(mode) ? 1 : 0);
+            saved.depth = std::min(saved.depth + 1, MaxSaveDepth);
+        }
     }
 
     void restore(std::vector<DECMode> const& _modes)
     {
         for (DECMode const mode: _modes)
         {
-            if (auto i = savedModes_.find(mode); i != savedModes_.end() && !i->second.empty())
-            {
-                auto& saved = i->second;
-                set(mode, saved.back());
-                saved.pop_back();
-            }
+            auto& saved = savedModes_[toDECModeIndex(mode)];
+            if (saved.depth == 0)
+                continue;
+            set(mode, (saved.values & 1) != 0);
+            saved.values >>= 1;
+            --saved.depth;
         }
     }
 
   private:
-    // TODO: make this a vector<bool> by casting from Mode, but that requires ensured small linearity in Mode
-    // enum values.
-    std::bitset<32> ansi_;                            // AnsiMode
-    std::bitset<8452 + 1> dec_;                       // DECMode
-    std::map<DECMode, std::vector<bool>> savedModes_; //!< saved DEC modes
+    [[nodiscard]] static uint64_t bit(DECMode _mode) noexcept
+    {
+        assert(toDECModeIndex(_mode) < DECModeCount);
+        return uint64_t { 1 } << toDECModeIndex(_mode);
+    }
+
+    /// Stack of saved values of one DEC mode, the most recently saved one in the least significant bit.
+    struct SavedMode
+    {
+        uint32_t values = 0;
+        size_t depth = 0;
+    };
+
+    std::bitset<32> ansi_; // AnsiMode
+    uint64_t dec_ = 0;     // DECMode, by toDECModeIndex()
+    std::array<SavedMode, DECModeCount> savedModes_ {}; //!< saved DEC modes
 };
 // }}}
 
@@ -113,6 +147,9 @@ struct Search
     ScrollOffset initialScrollOffset {};
 };
 
+// Page size of the alternate screen's grid while it is not in use.
+constexpr PageSize UnallocatedAlternateBufferSize { LineCount(1), ColumnCount(1) };
+
 /**
  * Defines the state of a terminal.
  * All those data members used to live in Screen, but are moved
@@ -150,7 +187,6 @@ struct TerminalState
     VTType terminalId = VTType::VT525;
 
     Modes modes;
-    std::map<DECMode, std::vector<bool>> savedModes; //!< saved DEC modes
 
     unsigned maxImageColorRegisters;
     ImageSize maxImageSize;
@@ -159,6 +195,8 @@ struct TerminalState
     ImagePool imagePool;
 
     bool sixelCursorConformance = true;
+    bool progressiveSixel = false; //!< Display sixel images band by band while they are being received.
+    unsigned sixelDecoderThreads = 1; //!< Threads to decode the bands of large sixel images on.
 
     std::vector<ColumnOffset> tabs;
 
@@ -166,7 +204,11 @@ struct TerminalState
 
     ScreenType screenType = ScreenType::Primary;
     Grid<PrimaryScreenCell> primaryBuffer;
+    // The alternate screen's grid is only allocated in full when switching to it, as most sessions
+    // never use it, and released again after it has been idle for a while (see Terminal::tick()).
     Grid<AlternateScreenCell> alternateBuffer;
+    bool alternateBufferAllocated = false;
+    std::chrono::steady_clock::time_point alternateBufferLeft {};
     Grid<StatusDisplayCell> hostWritableStatusBuffer; // writable status-display, see DECSASD and DECSSDT.
     Grid<StatusDisplayCell>
         indicatorStatusBuffer; // status buffer as used for indicator status line AND error lines.
@@ -204,7 +246,9 @@ struct TerminalState
 
     Sequencer sequencer;
     parser::Parser<Sequencer, false> parser;
+    CodepointTable codepointTable {}; //!< Unicode properties of the codepoints written to the screen.
     uint64_t instructionCounter = 0;
+    std::unique_ptr<SequenceProfiler> sequenceProfiler; //!< opt-in, see Terminal::setSequenceProfiling()
 
     InputGenerator inputGenerator {};
 
@@ -22,9 +22,16 @@
 #include <catch2/catch.hpp>
 
 #include <algorithm>
+#include <array>
+#include <cerrno>
+#include <functional>
+#include <future>
 #include <iostream>
 #include <iterator>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <thread>
 #include <vector>
 
 using namespace std;
@@ -61,7 +68,7 @@ vector<string> textScreenshot(terminal::Terminal const& _terminal)
         if (*gap > 0) // Did we jump?
             currentLine.insert(currentLine.end(), unbox<size_t>(gap) - 1, ' ');
 
-        currentLine += unicode::convert_to<char>(u32string_view(cell.codepoints));
+        currentLine += unicode::convert_to<char>(cell.codepoints());
         lastPos = cell.position;
         lastCount = 1;
     }
@@ -218,6 +225,30 @@ TEST_CASE("Terminal.BlinkingCursor", "[terminal]")
     }
 }
 
+TEST_CASE("Terminal.nextRender", "[terminal]")
+{
+    auto mc = MockTerm { ColumnCount { 6 }, LineCount { 4 } };
+    auto& terminal = mc.terminal();
+    auto constexpr BlinkInterval = chrono::milliseconds(500);
+    terminal.setCursorBlinkingInterval(BlinkInterval);
+    auto const clockBase = chrono::steady_clock::time_point();
+
+    SECTION("steady cursor")
+    {
+        terminal.setCursorDisplay(terminal::CursorDisplay::Steady);
+        terminal.tick(clockBase + chrono::milliseconds(100));
+        CHECK(!terminal.nextRender().has_value());
+    }
+
+    SECTION("blinking cursor")
+    {
+        // The text blinkers (e.g. 300ms for rapid blink) must not matter without blinking cells on screen.
+        terminal.setCursorDisplay(terminal::CursorDisplay::Blink);
+        terminal.tick(clockBase + chrono::milliseconds(100));
+        CHECK(terminal.nextRender() == BlinkInterval - chrono::milliseconds(100));
+    }
+}
+
 TEST_CASE("Terminal.DECCARA", "[terminal]")
 {
     auto mock = MockTerm { ColumnCount(5), LineCount(5) };
@@ -303,6 +334,232 @@ TEST_CASE("Terminal.CaptureScreenBuffer")
     // But here we test the full cycle.
 }
 
+TEST_CASE("Terminal.searchReverseInBackground", "[terminal]")
+{
+    auto mock = MockTerm { ColumnCount(10), LineCount(3) };
+    mock.writeToStdout("needle");
+    for (int i = 1; i <= 20; ++i)
+        mock.writeToStdout(fmt::format("\r\n{}", i));
+
+    auto match = promise<terminal::CellLocation>();
+    mock.terminal().searchReverseInBackground(
+        U"needle", terminal::CellLocation { LineOffset(2), ColumnOffset(0) }, [&](auto location) {
+            match.set_value(location);
+        });
+
+    auto result = match.get_future();
+    REQUIRE(result.wait_for(chrono::seconds(5)) == future_status::ready);
+    CHECK(result.get() == terminal::CellLocation { LineOffset(-18), ColumnOffset(0) });
+    CHECK(mock.terminal().state().searchMode.pattern == U"needle");
+}
+
+TEST_CASE("Terminal.searchReverseInBackground.destroyed", "[terminal]")
+{
+    // Keeps the functions posted to the input thread until after the terminal is gone.
+    struct DeferringEvents: public terminal::Terminal::Events
+    {
+        std::mutex lock;
+        std::vector<std::function<void()>> posted;
+
+        void post(std::function<void()> _fn) override
+        {
+            auto const _ = std::lock_guard { lock };
+            posted.emplace_back(std::move(_fn));
+        }
+    };
+
+    auto events = DeferringEvents {};
+    auto const pageSize = PageSize { LineCount(3), ColumnCount(10) };
+    auto terminal = make_unique<terminal::Terminal>(make_unique<terminal::MockPty>(pageSize),
+                                                    1024 * 1024,
+                                                    1024,
+                                                    events,
+                                                    LineCount(1024),
+                                                    LineOffset(0),
+                                                    chrono::milliseconds(500),
+                                                    chrono::steady_clock::time_point());
+    static_cast<terminal::MockPty&>(terminal->device()).appendStdOutBuffer("needle");
+    terminal->processInputOnce();
+
+    auto matched = false;
+    terminal->searchReverseInBackground(
+        U"needle", terminal::CellLocation { LineOffset(0), ColumnOffset(0) }, [&](auto) { matched = true; });
+
+    auto const deadline = chrono::steady_clock::now() + chrono::seconds(5);
+    auto const postedCount = [&]() {
+        auto const _ = std::lock_guard { events.lock };
+        return events.posted.size();
+    };
+    while (postedCount() == 0 && chrono::steady_clock::now() < deadline)
+        this_thread::sleep_for(chrono::milliseconds(1));
+    REQUIRE(postedCount() == 1);
+
+    terminal.reset();
+    for (auto& fn: events.posted)
+        fn();
+    CHECK(!matched);
+}
+
+TEST_CASE("Terminal.extractSelectionText", "[terminal]")
+{
+    auto mock = MockTerm { ColumnCount(10), LineCount(3) };
+    mock.writeToStdout("ABC  \r\nD\u00E9F\r\nGHIJ");
+
+    auto& terminal = mock.terminal();
+    auto const from = terminal::CellLocation { LineOffset(0), ColumnOffset(1) };
+    terminal.setSelector(make_unique<terminal::LinearSelection>(terminal.selectionHelper(), from));
+    terminal.selector()->extend(terminal::CellLocation { LineOffset(2), ColumnOffset(1) });
+    CHECK(terminal.extractSelectionText() == "BC\nD\u00E9F\nGH");
+
+    auto text = promise<string>();
+    terminal.extractSelectionTextInBackground([&](string _text) { text.set_value(std::move(_text)); });
+    auto result = text.get_future();
+    REQUIRE(result.wait_for(chrono::seconds(5)) == future_status::ready);
+    CHECK(result.get() == "BC\nD\u00E9F\nGH");
+}
+
+TEST_CASE("Terminal.sendPaste.streamed", "[terminal]")
+{
+    auto mock = MockTerm { ColumnCount(10), LineCount(3) };
+    mock.writeToStdout("\033[?2004h");
+
+    auto& terminal = mock.terminal();
+    auto constexpr ChunkSize = terminal::Terminal::PasteChunkSize;
+    auto const text = string(ChunkSize * 2 + 10, 'x');
+    terminal.sendPaste(text);
+
+    // Only a single chunk is queued for the application at a time.
+    CHECK(mock.replyData() == "\033[200~" + text.substr(0, ChunkSize));
+    REQUIRE(terminal.pasteProgress().has_value());
+    CHECK(terminal.hasInput());
+
+    while (terminal.hasInput())
+        terminal.flushInput();
+    CHECK(mock.replyData() == "\033[200~" + text + "\033[201~");
+    CHECK_FALSE(terminal.pasteProgress().has_value());
+}
+
+TEST_CASE("Terminal.sendPaste.cancel", "[terminal]")
+{
+    auto mock = MockTerm { ColumnCount(10), LineCount(3) };
+    mock.writeToStdout("\033[?2004h");
+
+    auto& terminal = mock.terminal();
+    auto constexpr ChunkSize = terminal::Terminal::PasteChunkSize;
+    auto const text = string(ChunkSize * 2, 'x');
+    terminal.sendPaste(text);
+
+    // Ctrl+C cancels the paste, which is still closed properly, instead of being sent.
+    auto const now = chrono::steady_clock::now();
+    CHECK(terminal.sendCharPressEvent('C', terminal::Modifier::Control, now));
+    CHECK_FALSE(terminal.pasteProgress().has_value());
+    CHECK_FALSE(terminal.hasInput());
+    CHECK(mock.replyData() == "\033[200~" + text.substr(0, ChunkSize) + "\033[201~");
+
+    // Without a paste in progress, Ctrl+C is sent as usual.
+    terminal.sendCharPressEvent('C', terminal::Modifier::Control, now);
+    CHECK(mock.replyData().back() == '\x03');
+
+    // Ctrl+C cancels the paste regardless of the case of the key's character.
+    terminal.sendPaste(text);
+    CHECK(terminal.sendCharPressEvent('c', terminal::Modifier::Control, now));
+    CHECK_FALSE(terminal.pasteProgress().has_value());
+    CHECK(mock.replyData().back() == '~');
+}
+
+TEST_CASE("Terminal.sendPaste.streamed.input", "[terminal]")
+{
+    auto mock = MockTerm { ColumnCount(10), LineCount(3) };
+    mock.writeToStdout("\033[?2004h");
+
+    auto& terminal = mock.terminal();
+    auto constexpr ChunkSize = terminal::Terminal::PasteChunkSize;
+    auto const text = string(ChunkSize * 3, 'x');
+    terminal.sendPaste(text);
+
+    // Key presses while the paste is being streamed are sent once it is complete,
+    // rather than ending up in the middle of it.
+    auto const now = chrono::steady_clock::now();
+    CHECK(terminal.sendCharPressEvent('a', terminal::Modifier::None, now));
+    REQUIRE(terminal.pasteProgress().has_value());
+    CHECK(mock.replyData().find('a') == string::npos);
+
+    while (terminal.hasInput())
+        terminal.flushInput();
+    CHECK(mock.replyData() == "\033[200~" + text + "\033[201~a");
+}
+
+TEST_CASE("Terminal.adaptivePtyReadSize", "[terminal]")
+{
+    auto mock = MockTerm { ColumnCount(80), LineCount(25) };
+    auto const initialReadSize = mock.terminal().ptyReadSize();
+    CHECK(initialReadSize == 4096);
+
+    // Bulk output makes consecutive reads come back full.
+    mock.pty().appendStdOutBuffer(string(256 * 1024, 'a'));
+    while (mock.pty().isStdoutDataAvailable())
+        mock.terminal().processInputOnce();
+    auto const bulkReadSize = mock.terminal().ptyReadSize();
+    CHECK(bulkReadSize > initialReadSize);
+    CHECK(bulkReadSize <= mock.terminal().maxPtyReadSize());
+
+    // Interactive use, such as echoing keystrokes.
+    for (int i = 0; i < 16; ++i)
+        mock.writeToStdout("x");
+    CHECK(mock.terminal().ptyReadSize() < bulkReadSize);
+}
+
+TEST_CASE("Terminal.fastForwarding.finalReadFillsBuffer", "[terminal]")
+{
+    // Times out like a real PTY once all output has been read, rather than reporting the end of it.
+    class TimingOutPty: public terminal::MockPty
+    {
+      public:
+        using MockPty::MockPty;
+
+        ReadResult read(crispy::BufferObject<char>& storage,
+                        std::chrono::milliseconds timeout,
+                        size_t size) override
+        {
+            if (!isStdoutDataAvailable())
+            {
+                errno = EAGAIN;
+                return std::nullopt;
+            }
+            return MockPty::read(storage, timeout, size);
+        }
+    };
+
+    struct Events: public terminal::Terminal::Events
+    {
+        int screenUpdates = 0;
+        void screenUpdated() override { ++screenUpdates; }
+    };
+
+    auto events = Events {};
+    auto const pageSize = PageSize { LineCount(25), ColumnCount(80) };
+    auto terminal = terminal::Terminal(make_unique<TimingOutPty>(pageSize),
+                                       1024 * 1024,
+                                       1024,
+                                       events,
+                                       LineCount(1024),
+                                       LineOffset(0),
+                                       chrono::milliseconds(500),
+                                       chrono::steady_clock::time_point());
+    auto& pty = static_cast<TimingOutPty&>(terminal.device());
+
+    // The last output fills the whole read buffer, so more of it is expected to follow.
+    pty.appendStdOutBuffer(string(terminal.ptyReadSize(), 'a'));
+    REQUIRE(terminal.processInputOnce());
+    CHECK(terminal.fastForwarding());
+
+    // There is none though, after which the final screen state still needs to be rendered.
+    auto const screenUpdates = events.screenUpdates;
+    REQUIRE(terminal.processInputOnce());
+    CHECK(!terminal.fastForwarding());
+    CHECK(events.screenUpdates > screenUpdates);
+}
+
 TEST_CASE("Terminal.SynchronizedOutput", "[terminal]")
 {
     constexpr auto BatchOn = "\033[?2026h"sv;
@@ -328,6 +585,42 @@ TEST_CASE("Terminal.SynchronizedOutput", "[terminal]")
     CHECK("Hello  World" == trimmedTextScreenshot(mc));
 }
 
+TEST_CASE("Terminal.SynchronizedOutput.timeout", "[terminal]")
+{
+    auto mc = MockTerm { ColumnCount(20), LineCount(1) };
+
+    mc.writeToStdout("\033[?2026hHello");
+    mc.terminal().tick(chrono::steady_clock::now());
+    mc.terminal().ensureFreshRenderBuffer();
+    CHECK("" == trimmedTextScreenshot(mc));
+
+    // The application never ends its batch.
+    mc.terminal().tick(chrono::steady_clock::now() + chrono::seconds(1));
+    mc.terminal().ensureFreshRenderBuffer();
+    CHECK("Hello" == trimmedTextScreenshot(mc));
+}
+
+TEST_CASE("Terminal.SynchronizedOutput.damage", "[terminal]")
+{
+    auto mc = MockTerm { ColumnCount(10), LineCount(4) };
+    auto const damagedLines = [&]() {
+        mc.terminal().refreshRenderBuffer();
+        return mc.terminal().renderBuffer().buffer.damagedLines;
+    };
+
+    mc.writeToStdout("AB\r\nCD\r\nEF\033[4;5H");
+    CHECK(damagedLines().size() == 4);
+
+    // The lines changed throughout the batch are rebuilt with the frame after it, and only these.
+    mc.writeToStdout("\033[?2026h\033[1;1HXY\033[4;5H");
+    mc.terminal().refreshRenderBuffer();
+    CHECK("AB\nCD\nEF" == trimmedTextScreenshot(mc));
+    mc.writeToStdout("\033[3;1HGH\033[4;5H");
+    mc.writeToStdout("\033[?2026l");
+    CHECK(damagedLines() == vector<LineOffset> { LineOffset(0), LineOffset(2) });
+    CHECK("XY\nCD\nGH" == trimmedTextScreenshot(mc));
+}
+
 TEST_CASE("Terminal.XTPUSHCOLORS_and_XTPOPCOLORS", "[terminal]")
 {
     using namespace terminal;
@@ -467,3 +760,276 @@ TEST_CASE("Terminal.CurlyUnderline", "[terminal]")
     CHECK(!screen.at(LineOffset(0), ColumnOffset(2)).isFlagEnabled(CellFlags::Italic));
     CHECK(!screen.at(LineOffset(0), ColumnOffset(3)).isFlagEnabled(CellFlags::Italic));
 }
+
+TEST_CASE("Terminal.SGR_fast_path", "[terminal]")
+{
+    // Complete SGR sequences take the fast path, whereas sequences split across two reads
+    // are dispatched generically. Both must end up with the same graphics rendition.
+    auto const parameters = std::array<std::string_view, 12> {
+        "",         "0",         "1;31",          "1;",        ";4",       "22;39;49",
+        "38;5;200", "48;5;255",  "38;2;10;20;30", "58;2;1;2;3", "97;107;9", "1;38;5;256",
+    };
+
+    for (auto const& parameter: parameters)
+    {
+        INFO(fmt::format("SGR parameters: \"{}\"", parameter));
+        auto fast = MockTerm { ColumnCount(10), LineCount(2) };
+        auto generic = MockTerm { ColumnCount(10), LineCount(2) };
+
+        // REP must not repeat the text preceding the SGR sequence.
+        fast.writeToStdout("\033[3;44mA");
+        fast.writeToStdout(fmt::format("\033[{}m\033[2b", parameter));
+
+        generic.writeToStdout("\033[3;44mA");
+        generic.writeToStdout("\033");
+        generic.writeToStdout(fmt::format("[{}m\033[2b", parameter));
+
+        CHECK(fast.terminal().state().cursor.graphicsRendition
+              == generic.terminal().state().cursor.graphicsRendition);
+        CHECK(fast.terminal().state().instructionCounter
+              == generic.terminal().state().instructionCounter);
+        CHECK(trimmedTextScreenshot(fast) == trimmedTextScreenshot(generic));
+    }
+}
+
+TEST_CASE("Terminal.PipelinedParsing", "[terminal]")
+{
+    // Large enough to be read in several chunks, splitting sequences and UTF-8 text at chunk boundaries.
+    auto text = string {};
+    for (int i = 0; i < 400; ++i)
+    {
+        text += fmt::format("\033[{};{}H", 1 + i % 10, 1 + i % 7);
+        text += fmt::format("\033[1;{}mline {} ", 31 + i % 7, i);
+        text += fmt::format("\033[38:2::{}:{}:42m", i % 256, 2 * i % 256);
+        text += "Ünicode text ✓, wrapping across the right margin";
+        text += fmt::format("\033[m\033[{}b\033]2;title {}\033\\\r\n", 1 + i % 3, i);
+    }
+    text += "\033[5;3HThe end.\033[1;4;38;5;123m";
+
+    auto inline_ = MockTerm { ColumnCount(30), LineCount(10) };
+    inline_.pty().appendStdOutBuffer(text);
+    while (inline_.pty().isStdoutDataAvailable())
+        inline_.terminal().processInputOnce();
+
+    auto pipelined = MockTerm { ColumnCount(30), LineCount(10) };
+    pipelined.pty().appendStdOutBuffer(text);
+    pipelined.terminal().startPtyReaderThread(true);
+    while (pipelined.terminal().processInputOnce())
+        ;
+
+    CHECK(trimmedTextScreenshot(pipelined) == trimmedTextScreenshot(inline_));
+    CHECK(pipelined.terminal().windowTitle() == inline_.terminal().windowTitle());
+    CHECK(pipelined.terminal().state().cursor.position == inline_.terminal().state().cursor.position);
+    CHECK(pipelined.terminal().state().cursor.graphicsRendition
+          == inline_.terminal().state().cursor.graphicsRendition);
+}
+
+TEST_CASE("Terminal.PtyRecording", "[terminal]")
+{
+    using terminal::PtyRecordingChunk;
+
+    auto const path = FileSystem::temp_directory_path() / "libterminal-Terminal-PtyRecording.rec";
+    {
+        auto mock = MockTerm { ColumnCount(20), LineCount(5) };
+        mock.terminal().setPtyRecorder(terminal::PtyRecorder::create(path, mock.terminal().totalPageSize()));
+        mock.writeToStdout("Hello,\r\n");
+        mock.terminal().resizeScreen(PageSize { LineCount(6), ColumnCount(30) });
+        mock.writeToStdout("\033[1mWorld!");
+    }
+
+    auto const recording = terminal::loadPtyRecording(path);
+    FileSystem::remove(path);
+
+    REQUIRE(recording.has_value());
+    CHECK(recording->pageSize.lines == LineCount(5));
+    CHECK(recording->pageSize.columns == ColumnCount(20));
+    CHECK(recording->outputSize() == 8 + 10);
+    REQUIRE(recording->chunks.size() == 3);
+
+    CHECK(recording->chunks[0].type == PtyRecordingChunk::Type::Output);
+    CHECK(recording->chunks[0].data == "Hello,\r\n");
+    CHECK(recording->chunks[1].type == PtyRecordingChunk::Type::Resize);
+    CHECK(recording->chunks[1].pageSize.lines == LineCount(6));
+    CHECK(recording->chunks[1].pageSize.columns == ColumnCount(30));
+    CHECK(recording->chunks[2].type == PtyRecordingChunk::Type::Output);
+    CHECK(recording->chunks[2].data == "\033[1mWorld!");
+    CHECK(recording->chunks[0].time <= recording->chunks[2].time);
+}
+
+TEST_CASE("Terminal.RenderBufferDamage", "[terminal]")
+{
+    auto mc = MockTerm { ColumnCount(10), LineCount(4) };
+    auto const damagedLines = [&]() {
+        mc.terminal().refreshRenderBuffer();
+        return mc.terminal().renderBuffer().buffer.damagedLines;
+    };
+
+    mc.writeToStdout("AB\r\nCD\r\nEF\033[4;5H");
+    CHECK(damagedLines().size() == 4);
+    CHECK("AB\nCD\nEF" == trimmedTextScreenshot(mc));
+
+    // Only the modified line is rebuilt, as the cursor is placed back where it has been.
+    mc.writeToStdout("\033[1;1HXY\033[4;5H");
+    CHECK(damagedLines() == vector<LineOffset> { LineOffset(0) });
+    CHECK("XY\nCD\nEF" == trimmedTextScreenshot(mc));
+
+    // Unmodified lines are reused, even if the frame is rendered into the other render buffer.
+    CHECK(damagedLines().empty());
+    CHECK(damagedLines().empty());
+    CHECK("XY\nCD\nEF" == trimmedTextScreenshot(mc));
+
+    // Scrolling moves all lines on the screen, reusing the ones that have been rendered before.
+    // Only the newly exposed line is damaged, as the others are moved along by the renderer.
+    mc.writeToStdout("\033[4;1H\nGH\033[4;5H");
+    CHECK(damagedLines() == vector<LineOffset> { LineOffset(3) });
+    CHECK(mc.terminal().renderBuffer().buffer.scrollShift == LineOffset(-1));
+    CHECK(mc.terminal().renderBuffer().buffer.scrollRegion == LineCount(4));
+    CHECK("CD\nEF\n\nGH" == trimmedTextScreenshot(mc));
+}
+
+TEST_CASE("Terminal.RenderBufferDamage.blink", "[terminal]")
+{
+    auto mc = MockTerm { ColumnCount(10), LineCount(4) };
+    auto now = chrono::steady_clock::now();
+    auto const damagedLines = [&]() {
+        mc.terminal().tick(now);
+        mc.terminal().refreshRenderBuffer();
+        return mc.terminal().renderBuffer().buffer.damagedLines;
+    };
+
+    mc.writeToStdout("AB\r\n\033[5mCD\033[m\r\nEF\033[4;5H");
+    CHECK(damagedLines().size() == 4);
+
+    // Only the line with blinking text is rebuilt as it blinks.
+    now += chrono::milliseconds(600);
+    CHECK(damagedLines() == vector<LineOffset> { LineOffset(1) });
+    CHECK(damagedLines().empty());
+}
+
+TEST_CASE("Terminal.RenderBufferBands", "[terminal]")
+{
+    // Renders the same screen contents with the given number of render buffer threads.
+    auto const render = [](unsigned threadCount) {
+        auto mc = MockTerm { ColumnCount(20), LineCount(64) };
+        mc.terminal().setRenderBufferThreadCount(threadCount);
+        for (int i = 0; i < 64; ++i)
+            mc.writeToStdout(
+                fmt::format("\033[{};1H\033[3{}mline {}\033[m{}", i + 1, i % 8, i, i % 3 ? "" : "\u00E9"));
+        mc.terminal().refreshRenderBuffer();
+
+        auto text = string {};
+        auto const& buffer = mc.terminal().renderBuffer().buffer;
+        for (auto const& cell: buffer.cells)
+            text += fmt::format("{}:{}:{};",
+                                unbox<int>(cell.position.line),
+                                unbox<int>(cell.position.column),
+                                cell.codepoints().size());
+        for (auto const& line: buffer.lines)
+            text += fmt::format("{}:{};", unbox<int>(line.lineOffset), line.text);
+        return text;
+    };
+
+    auto const singleThreaded = render(1);
+    CHECK(!singleThreaded.empty());
+    CHECK(render(4) == singleThreaded);
+}
+
+TEST_CASE("Terminal.InputLatency", "[terminal]")
+{
+    auto mc = MockTerm { ColumnCount(10), LineCount(4) };
+    auto const keyPress = chrono::steady_clock::now();
+    mc.terminal().sendCharPressEvent('a', terminal::Modifier {}, keyPress);
+    CHECK(mc.replyData() == "a");
+
+    // The output following the key press is taken as its echo and shows up with the next frame only.
+    mc.writeToStdout("a");
+    mc.terminal().refreshRenderBuffer();
+    CHECK(mc.terminal().renderBuffer().buffer.echoedKeyPress == keyPress);
+    mc.writeToStdout("b");
+    mc.terminal().refreshRenderBuffer();
+    CHECK(!mc.terminal().renderBuffer().buffer.echoedKeyPress.has_value());
+
+    mc.terminal().recordInputLatency(keyPress, keyPress + chrono::milliseconds(5));
+    mc.pty().stdinBuffer().clear();
+    mc.writeToStdout("\033[>1z");
+    mc.terminal().flushInput();
+    CHECK(e(mc.replyData()) == e("\033^315;1;5000;5000;5000;5000\033\\"));
+
+    mc.pty().stdinBuffer().clear();
+    mc.writeToStdout("\033[>z");
+    mc.terminal().flushInput();
+    CHECK(e(mc.replyData()) == e("\033^315;0;0;0;0;0\033\\"));
+}
+
+TEST_CASE("Terminal.CacheStats", "[terminal]")
+{
+    auto mc = MockTerm { ColumnCount(10), LineCount(4) };
+    mc.writeToStdout("\033]8;;https://a\033\\A\033]8;;https://a\033\\B\033]8;;\033\\");
+
+    mc.pty().stdinBuffer().clear();
+    mc.writeToStdout("\033[>y");
+    mc.terminal().flushInput();
+
+    // Each cache is reported by name, followed by an empty report terminating the list.
+    auto const reply = mc.replyData();
+    CHECK(reply.find("\033^316;Hyperlinks;1;1;0;1;0\033\\") != std::string::npos);
+    CHECK(e(reply.substr(reply.size() - 7)) == e("\033^316\033\\"));
+}
+
+TEST_CASE("Terminal.LazyAlternateScreen", "[terminal]")
+{
+    auto constexpr ClockBase = chrono::steady_clock::time_point();
+    auto mc = MockTerm { ColumnCount(10), LineCount(4) };
+    auto const& state = mc.terminal().state();
+    mc.terminal().tick(ClockBase);
+    CHECK(state.alternateBuffer.pageSize() == terminal::UnallocatedAlternateBufferSize);
+
+    mc.writeToStdout("\033[?1049hAlt");
+    CHECK(state.alternateBuffer.pageSize() == PageSize { LineCount(4), ColumnCount(10) });
+    CHECK(mc.terminal().alternateScreen().grid().lineText(LineOffset(0)) == "Alt       ");
+
+    // Idling on the alternate screen keeps it.
+    mc.terminal().tick(ClockBase + chrono::minutes(5));
+    CHECK(state.alternateBufferAllocated);
+
+    mc.writeToStdout("\033[?1049l");
+    mc.terminal().tick(ClockBase + chrono::minutes(5) + chrono::seconds(30));
+    CHECK(state.alternateBufferAllocated);
+
+    mc.terminal().tick(ClockBase + chrono::minutes(6));
+    CHECK(!state.alternateBufferAllocated);
+    CHECK(state.alternateBuffer.pageSize() == terminal::UnallocatedAlternateBufferSize);
+
+    mc.writeToStdout("\033[?1049h");
+    CHECK(state.alternateBuffer.pageSize() == PageSize { LineCount(4), ColumnCount(10) });
+}
+
+TEST_CASE("Terminal.SequenceProfiler", "[terminal]")
+{
+    auto mc = MockTerm { ColumnCount(20), LineCount(4) };
+    CHECK(mc.terminal().sequenceProfiler() == nullptr);
+
+    mc.terminal().setSequenceProfiling(true);
+    mc.writeToStdout("\033[1mHello\033[m\r\n\033[2J");
+
+    auto const* profiler = mc.terminal().sequenceProfiler();
+    REQUIRE(profiler != nullptr);
+    CHECK(profiler->inputBytes() == 18);
+    CHECK(profiler->textBytes() == 5);
+    CHECK(profiler->controlBytes() == 13);
+
+    // SGR is profiled, too, rather than taking its fast path.
+    auto const* sgr = profiler->stats(terminal::SGR);
+    REQUIRE(sgr != nullptr);
+    CHECK(sgr->count == 2);
+    auto const* ed = profiler->stats(terminal::ED);
+    REQUIRE(ed != nullptr);
+    CHECK(ed->count == 1);
+    CHECK(profiler->stats(terminal::CUP) == nullptr);
+
+    auto const functions = profiler->functions();
+    CHECK(functions.size() == 2);
+
+    mc.terminal().setSequenceProfiling(false);
+    CHECK(mc.terminal().sequenceProfiler() == nullptr);
+}
@@ -0,0 +1,281 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/TmuxControlMode.h>
+
+#include <fmt/format.h>
+
+#include <charconv>
+#include <cstdint>
+
+using std::nullopt;
+using std::optional;
+using std::string;
+using std::string_view;
+using std::vector;
+
+namespace terminal
+{
+
+namespace
+{
+    /// Splits off the first space separated word of @p _text.
+    string_view nextWord(string_view& _text) noexcept
+    {
+        auto const space = _text.find(' ');
+        auto const word = _text.substr(0, space);
+        _text = space != string_view::npos ? _text.substr(space + 1) : string_view {};
+        return word;
+    }
+
+    /// Parses a tmux object ID, such as "%1" for panes or "@1" for windows.
+    optional<unsigned> parseId(string_view _text, char _prefix) noexcept
+    {
+        if (_text.size() < 2 || _text.front() != _prefix)
+            return nullopt;
+        auto value = 0u;
+        auto const* const end = _text.data() + _text.size();
+        auto const [ptr, ec] = std::from_chars(_text.data() + 1, end, value);
+        if (ec != std::errc() || ptr != end)
+            return nullopt;
+        return value;
+    }
+
+    class LayoutParser
+    {
+      public:
+        explicit LayoutParser(string_view _text): text_ { _text } {}
+
+        /// Parses a layout cell, which is either "WxH,X,Y,ID" for a pane,
+        /// or "WxH,X,Y{...}" respectively "WxH,X,Y[...]" for cells split horizontally or vertically.
+        bool parseCell(vector<unsigned>& _panes)
+        {
+            if (!number() || !expect('x') || !number() || !expect(',') || !number() || !expect(',')
+                || !number())
+                return false;
+
+            if (peek('{') || peek('['))
+            {
+                auto const close = text_[pos_] == '{' ? '}' : ']';
+                ++pos_;
+                do
+                {
+                    if (!parseCell(_panes))
+                        return false;
+                } while (expect(','));
+                return expect(close);
+            }
+
+            if (!expect(','))
+                return false;
+            auto const id = number();
+            if (!id)
+                return false;
+            _panes.push_back(*id);
+            return true;
+        }
+
+        [[nodiscard]] bool atEnd() const noexcept { return pos_ == text_.size(); }
+
+      private:
+        bool peek(char _char) const noexcept { return pos_ < text_.size() && text_[pos_] == _char; }
+
+        bool expect(char _char) noexcept
+        {
+            if (!peek(_char))
+                return false;
+            ++pos_;
+            return true;
+        }
+
+        optional<unsigned> number() noexcept
+        {
+            auto value = 0u;
+            auto const* const begin = text_.data() + pos_;
+            auto const [ptr, ec] = std::from_chars(begin, text_.data() + text_.size(), value);
+            if (ec != std::errc())
+                return nullopt;
+            pos_ += static_cast<size_t>(ptr - begin);
+            return value;
+        }
+
+        string_view text_;
+        size_t pos_ = 0;
+    };
+} // namespace
+
+void TmuxControlParser::pass(char _char)
+{
+    if (_char != '\n')
+    {
+        if (line_.size() < MaxLineLength)
+            line_.push_back(_char);
+        return;
+    }
+
+    if (!line_.empty() && line_.back() == '\r')
+        line_.pop_back();
+    handleLine(line_);
+    line_.clear();
+}
+
+void TmuxControlParser::finalize()
+{
+    if (!line_.empty())
+    {
+        handleLine(line_);
+        line_.clear();
+    }
+
+    if (!exited_)
+    {
+        exited_ = true;
+        events_.tmuxExited({});
+    }
+}
+
+void TmuxControlParser::handleLine(string_view _line)
+{
+    if (reply_)
+    {
+        // Lines of a reply may begin with '%' too, but only %end and %error terminate it.
+        auto arguments = _line;
+        auto const name = nextWord(arguments);
+        if (name == "%end" || name == "%error")
+        {
+            if (!reply_->empty())
+                reply_->pop_back();
+            events_.tmuxCommandReply(name == "%end", *reply_);
+            reply_.reset();
+        }
+        else
+        {
+            *reply_ += _line;
+            *reply_ += '\n';
+        }
+        return;
+    }
+
+    if (_line.empty() || _line.front() != '%')
+        return;
+
+    auto arguments = _line;
+    auto const name = nextWord(arguments);
+    handleNotification(name, arguments);
+}
+
+void TmuxControlParser::handleNotification(string_view _name, string_view _arguments)
+{
+    if (_name == "%output")
+    {
+        auto const paneId = parseId(nextWord(_arguments), '%');
+        if (paneId)
+            events_.tmuxPaneOutput(*paneId, decodeTmuxOutput(_arguments));
+    }
+    else if (_name == "%extended-output")
+    {
+        // %extended-output %<pane> <age> ... : <value>
+        auto const paneId = parseId(nextWord(_arguments), '%');
+        auto const separator = _arguments.find(" : ");
+        if (paneId && separator != string_view::npos)
+            events_.tmuxPaneOutput(*paneId, decodeTmuxOutput(_arguments.substr(separator + 3)));
+    }
+    else if (_name == "%layout-change")
+    {
+        auto const windowId = parseId(nextWord(_arguments), '@');
+        auto const panes = tmuxLayoutPanes(nextWord(_arguments));
+        if (windowId && panes)
+            events_.tmuxLayoutChanged(*windowId, *panes);
+    }
+    else if (_name == "%window-close" || _name == "%unlinked-window-close")
+    {
+        if (auto const windowId = parseId(nextWord(_arguments), '@'))
+            events_.tmuxWindowClosed(*windowId);
+    }
+    else if (_name == "%begin")
+    {
+        reply_.emplace();
+    }
+    else if (_name == "%exit")
+    {
+        exited_ = true;
+        events_.tmuxExited(_arguments);
+    }
+}
+
+string decodeTmuxOutput(string_view _value)
+{
+    auto const isOctal = [](char _char) noexcept {
+        return '0' <= _char && _char <= '7';
+    };
+
+    auto output = string {};
+    output.reserve(_value.size());
+    for (size_t i = 0; i < _value.size(); ++i)
+    {
+        if (_value[i] == '\\' && i + 3 < _value.size() && isOctal(_value[i + 1])
+            && isOctal(_value[i + 2]) && isOctal(_value[i + 3]))
+        {
+            output.push_back(static_cast<char>(((_value[i + 1] - '0') << 6) | ((_value[i + 2] - '0') << 3)
+                                               | (_value[i + 3] - '0')));
+            i += 3;
+        }
+        else
+            output.push_back(_value[i]);
+    }
+    return output;
+}
+
+optional<vector<unsigned>> tmuxLayoutPanes(string_view _layout)
+{
+    // The layout is prefixed by its checksum.
+    auto const comma = _layout.find(',');
+    if (comma == string_view::npos)
+        return nullopt;
+
+    auto parser = LayoutParser(_layout.substr(comma + 1));
+    auto panes = vector<unsigned> {};
+    if (!parser.parseCell(panes) || !parser.atEnd())
+        return nullopt;
+    return panes;
+}
+
+string tmuxSendKeysCommand(unsigned _paneId, std::string_view _input)
+{
+    // Keys are sent hex encoded, such that no input needs to be quoted for the tmux command parser,
+    // and in chunks, to keep the command lines short.
+    constexpr auto ChunkSize = size_t { 256 };
+    constexpr auto HexDigits = string_view { "0123456789abcdef" };
+
+    auto commands = string {};
+    for (size_t offset = 0; offset < _input.size(); offset += ChunkSize)
+    {
+        commands += fmt::format("send-keys -t %{} -H", _paneId);
+        for (auto const ch: _input.substr(offset, ChunkSize))
+        {
+            auto const byte = static_cast<uint8_t>(ch);
+            commands += ' ';
+            commands += HexDigits[byte >> 4];
+            commands += HexDigits[byte & 0x0F];
+        }
+        commands += '\n';
+    }
+    return commands;
+}
+
+string tmuxResizeCommand(unsigned _columns, unsigned _lines)
+{
+    return fmt::format("refresh-client -C {},{}\n", _columns, _lines);
+}
+
+} // namespace terminal
@@ -0,0 +1,94 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <terminal/ParserExtension.h>
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace terminal
+{
+
+/**
+ * Decodes the notifications of tmux running in control mode (tmux -CC).
+ *
+ * tmux wraps the whole control-mode session into a single DCS sequence (DCS 1000 p ... ST),
+ * whose data string is a sequence of lines, each being either a notification starting with '%',
+ * or a line of the reply to a command that has been sent to tmux, enclosed in %begin and %end
+ * (or %error) lines.
+ *
+ * The contents of the panes are not rendered by tmux but passed through as they are
+ * in %output notifications, such that each pane can be fed into a terminal of its own.
+ */
+class TmuxControlParser: public ParserExtension
+{
+  public:
+    class Events
+    {
+      public:
+        virtual ~Events() = default;
+
+        /// Output of the given pane, decoded already.
+        virtual void tmuxPaneOutput(unsigned _paneId, std::string_view _data) = 0;
+
+        /// The layout of the given window changed, now consisting of the given panes.
+        virtual void tmuxLayoutChanged(unsigned /*_windowId*/, std::vector<unsigned> const& /*_paneIds*/) {}
+
+        virtual void tmuxWindowClosed(unsigned /*_windowId*/) {}
+
+        /// Reply to a command that has been sent to tmux, with its output lines joined by LF.
+        virtual void tmuxCommandReply(bool /*_success*/, std::string_view /*_output*/) {}
+
+        /// The control-mode client exited, either by %exit or by the end of the DCS sequence.
+        virtual void tmuxExited(std::string_view _reason) = 0;
+    };
+
+    /// Lines longer than this are truncated.
+    static constexpr size_t MaxLineLength = 1024 * 1024;
+
+    explicit TmuxControlParser(Events& _events): events_ { _events } {}
+
+    void pass(char _char) override;
+    void finalize() override;
+
+    /// tmux writes the output of its panes as UTF-8, leaving bytes of 0x80 and above unescaped.
+    [[nodiscard]] bool passesUnicode() const noexcept override { return true; }
+
+  private:
+    void handleLine(std::string_view _line);
+    void handleNotification(std::string_view _name, std::string_view _arguments);
+
+    Events& events_;
+    std::string line_;
+    std::optional<std::string> reply_; //!< collected lines of the current %begin block, if any
+    bool exited_ = false;
+};
+
+/// @returns the value of an %output notification with its octal escapes (\ooo) decoded.
+std::string decodeTmuxOutput(std::string_view _value);
+
+/// @returns the IDs of the panes of a tmux window layout (e.g. "b25f,80x24,0,0{40x24,0,0,1,39x24,41,0,2}"),
+///          in layout order, or std::nullopt if the layout is malformed.
+std::optional<std::vector<unsigned>> tmuxLayoutPanes(std::string_view _layout);
+
+/// @returns the tmux commands that send the given input as-is to the given pane.
+std::string tmuxSendKeysCommand(unsigned _paneId, std::string_view _input);
+
+/// @returns the tmux command that sets the size of the control-mode client.
+std::string tmuxResizeCommand(unsigned _columns, unsigned _lines);
+
+} // namespace terminal
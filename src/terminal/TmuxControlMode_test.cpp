@@ -0,0 +1,161 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/TmuxControlMode.h>
+#include <terminal/pty/TmuxPanePty.h>
+
+#include <catch2/catch.hpp>
+
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace terminal;
+
+namespace
+{
+struct RecordingEvents: public TmuxControlParser::Events
+{
+    std::vector<std::pair<unsigned, std::string>> output;
+    std::vector<std::pair<unsigned, std::vector<unsigned>>> layouts;
+    std::vector<unsigned> closedWindows;
+    std::vector<std::pair<bool, std::string>> replies;
+    std::optional<std::string> exitReason;
+
+    void tmuxPaneOutput(unsigned _paneId, std::string_view _data) override
+    {
+        output.emplace_back(_paneId, std::string(_data));
+    }
+
+    void tmuxLayoutChanged(unsigned _windowId, std::vector<unsigned> const& _paneIds) override
+    {
+        layouts.emplace_back(_windowId, _paneIds);
+    }
+
+    void tmuxWindowClosed(unsigned _windowId) override { closedWindows.push_back(_windowId); }
+
+    void tmuxCommandReply(bool _success, std::string_view _output) override
+    {
+        replies.emplace_back(_success, std::string(_output));
+    }
+
+    void tmuxExited(std::string_view _reason) override { exitReason = std::string(_reason); }
+};
+
+void feed(TmuxControlParser& _parser, std::string_view _data)
+{
+    for (auto const ch: _data)
+        _parser.pass(ch);
+}
+} // namespace
+
+TEST_CASE("TmuxControlMode.notifications", "[tmux]")
+{
+    auto events = RecordingEvents {};
+    auto parser = TmuxControlParser(events);
+
+    feed(parser,
+         "%begin 1 1 0\r\n"
+         "%end 1 1 0\r\n"
+         "%layout-change @1 b25f,80x24,0,0{40x24,0,0,1,39x24,41,0[39x12,41,0,2,39x11,41,13,3]} "
+         "b25f,80x24,0,0,1 *\r\n"
+         "%output %1 hello\\015\\012w\\134rld\r\n"
+         "%output %2 \\033[31mred\r\n"
+         "%unknown-notification ignored\r\n"
+         "%window-close @1\r\n"
+         "%exit detached\r\n");
+    parser.finalize();
+
+    REQUIRE(events.replies.size() == 1);
+    CHECK(events.replies[0].first);
+    CHECK(events.replies[0].second.empty());
+
+    REQUIRE(events.layouts.size() == 1);
+    CHECK(events.layouts[0].first == 1);
+    CHECK((events.layouts[0].second == std::vector<unsigned> { 1, 2, 3 }));
+
+    REQUIRE(events.output.size() == 2);
+    CHECK(events.output[0].first == 1);
+    CHECK(events.output[0].second == "hello\r\nw\\rld");
+    CHECK(events.output[1].first == 2);
+    CHECK(events.output[1].second == "\033[31mred");
+
+    CHECK((events.closedWindows == std::vector<unsigned> { 1 }));
+    CHECK(events.exitReason == "detached");
+}
+
+TEST_CASE("TmuxControlMode.command_reply", "[tmux]")
+{
+    auto events = RecordingEvents {};
+    auto parser = TmuxControlParser(events);
+
+    feed(parser,
+         "%begin 1 2 1\n%1: bash*\nsecond line\n%end 1 2 1\n"
+         "%begin 1 3 1\nunknown command\n%error 1 3 1\n");
+
+    REQUIRE(events.replies.size() == 2);
+    CHECK(events.replies[0] == std::pair { true, std::string("%1: bash*\nsecond line") });
+    CHECK(events.replies[1] == std::pair { false, std::string("unknown command") });
+    CHECK(events.output.empty());
+
+    // The end of the DCS sequence ends control mode too.
+    CHECK_FALSE(events.exitReason.has_value());
+    parser.finalize();
+    CHECK(events.exitReason == "");
+}
+
+TEST_CASE("TmuxControlMode.layout", "[tmux]")
+{
+    CHECK((tmuxLayoutPanes("b25f,80x24,0,0,7") == std::vector<unsigned> { 7 }));
+    CHECK((tmuxLayoutPanes("1234,80x24,0,0[80x12,0,0,4,80x11,0,13{40x11,0,13,5,39x11,41,13,6}]")
+           == std::vector<unsigned> { 4, 5, 6 }));
+    CHECK_FALSE(tmuxLayoutPanes("80x24,0,0,7").has_value());
+    CHECK_FALSE(tmuxLayoutPanes("b25f,80x24,0,0{40x24,0,0,1").has_value());
+}
+
+TEST_CASE("TmuxControlMode.commands", "[tmux]")
+{
+    CHECK(tmuxSendKeysCommand(3, "ls\r") == "send-keys -t %3 -H 6c 73 0d\n");
+    CHECK(tmuxSendKeysCommand(3, "") == "");
+    CHECK(tmuxSendKeysCommand(1, std::string(300, 'a')).find("\nsend-keys -t %1 -H 61") == 18 + 256 * 3);
+    CHECK(tmuxResizeCommand(80, 24) == "refresh-client -C 80,24\n");
+}
+
+TEST_CASE("TmuxPanePty", "[tmux]")
+{
+    auto commands = std::string {};
+    auto pty = TmuxPanePty(2, PageSize { LineCount(24), ColumnCount(80) }, [&](std::string_view _commands) {
+        commands += _commands;
+    });
+    auto storage = crispy::BufferObjectPool<char>(4096);
+    auto buffer = storage.allocateBufferObject();
+
+    // Nothing to read yet.
+    CHECK_FALSE(pty.read(*buffer, std::chrono::milliseconds(0), 4096).has_value());
+
+    pty.appendOutput("hello");
+    auto const result = pty.read(*buffer, std::chrono::milliseconds(0), 4096);
+    REQUIRE(result.has_value());
+    CHECK(std::get<0>(*result) == "hello");
+
+    CHECK(pty.write("x", 1) == 1);
+    pty.resizeScreen(PageSize { LineCount(10), ColumnCount(40) });
+    CHECK(commands == "send-keys -t %2 -H 78\nrefresh-client -C 40,10\n");
+
+    // Once closed, the terminal reads end-of-file.
+    pty.close();
+    auto const eof = pty.read(*buffer, std::chrono::milliseconds(0), 4096);
+    REQUIRE(eof.has_value());
+    CHECK(std::get<0>(*eof).empty());
+}
@@ -13,8 +13,12 @@
  */
 #include <terminal/VTWriter.h>
 
-#include <numeric>
+#include <array>
+#include <iterator>
+#include <utility>
 
+using namespace std::string_view_literals;
+using std::pair;
 using std::string;
 using std::string_view;
 using std::vector;
@@ -22,10 +26,170 @@ using std::vector;
 namespace terminal
 {
 
-// TODO: compare with old sgr value set instead to be more generic in reusing stuff
+namespace
+{
+    // The cell flags that can be expressed in SGR, along with the parameter enabling each.
+    auto constexpr FlagParameters = std::array {
+        pair { CellFlags::Bold, "1"sv },
+        pair { CellFlags::Faint, "2"sv },
+        pair { CellFlags::Italic, "3"sv },
+        pair { CellFlags::Underline, "4"sv },
+        pair { CellFlags::DoublyUnderlined, "4:2"sv },
+        pair { CellFlags::CurlyUnderlined, "4:3"sv },
+        pair { CellFlags::DottedUnderline, "4:4"sv },
+        pair { CellFlags::DashedUnderline, "4:5"sv },
+        pair { CellFlags::Blinking, "5"sv },
+        pair { CellFlags::RapidBlinking, "6"sv },
+        pair { CellFlags::Inverse, "7"sv },
+        pair { CellFlags::Hidden, "8"sv },
+        pair { CellFlags::CrossedOut, "9"sv },
+        pair { CellFlags::Framed, "51"sv },
+        pair { CellFlags::Overline, "53"sv },
+    };
+
+    // The groups of cell flags that are cleared together by a single SGR parameter.
+    auto constexpr FlagResetParameters = std::array {
+        pair { CellFlags::Bold | CellFlags::Faint, "22"sv },
+        pair { CellFlags::Italic, "23"sv },
+        pair { CellFlags::Underline | CellFlags::DoublyUnderlined | CellFlags::CurlyUnderlined
+                   | CellFlags::DottedUnderline | CellFlags::DashedUnderline,
+               "24"sv },
+        pair { CellFlags::Blinking | CellFlags::RapidBlinking, "25"sv },
+        pair { CellFlags::Inverse, "27"sv },
+        pair { CellFlags::Hidden, "28"sv },
+        pair { CellFlags::CrossedOut, "29"sv },
+        pair { CellFlags::Framed, "54"sv },
+        pair { CellFlags::Overline, "55"sv },
+    };
+
+    constexpr CellFlags serializableFlags(CellFlags _flags) noexcept
+    {
+        auto result = CellFlags::None;
+        for (auto const& [flag, parameter]: FlagParameters)
+            if (_flags & flag)
+                result |= flag;
+        return result;
+    }
+
+    constexpr GraphicsAttributes serializableAttributes(GraphicsAttributes _attributes) noexcept
+    {
+        _attributes.flags = serializableFlags(_attributes.flags);
+        return _attributes;
+    }
+
+    // Builds the parameter list of SGR sequences, starting a new sequence
+    // whenever a single one would exceed VTWriter::MaxParameterCount parameters.
+    class SGRBuilder
+    {
+      public:
+        explicit SGRBuilder(string& _output): output_ { _output } { output_.clear(); }
+
+        void add(string_view _parameter) { append(1, [&]() { output_ += _parameter; }); }
+
+        void add(unsigned _value)
+        {
+            append(1, [&]() { fmt::format_to(std::back_inserter(output_), "{}", _value); });
+        }
+
+        void addColor(unsigned _base, Color _color)
+        {
+            // _base is 30 (foreground), 40 (background), or 50 (underline, which has no 8-color form).
+            switch (_color.type())
+            {
+                case ColorType::Default: add(_base + 9); break;
+                case ColorType::Indexed:
+                    if (_base != 50 && static_cast<unsigned>(_color.index()) < 8)
+                        add(_base + static_cast<unsigned>(_color.index()));
+                    else
+                        append(3, [&]() {
+                            fmt::format_to(std::back_inserter(output_),
+                                           "{};5;{}",
+                                           _base + 8,
+                                           static_cast<unsigned>(_color.index()));
+                        });
+                    break;
+                case ColorType::Bright:
+                    if (_base == 50)
+                        append(3, [&]() {
+                            fmt::format_to(std::back_inserter(output_),
+                                           "58;5;{}",
+                                           8 + static_cast<unsigned>(getBrightColor(_color)));
+                        });
+                    else
+                        add(_base + 60 + static_cast<unsigned>(getBrightColor(_color)));
+                    break;
+                case ColorType::RGB:
+                    append(5, [&]() {
+                        fmt::format_to(std::back_inserter(output_),
+                                       "{};2;{};{};{}",
+                                       _base + 8,
+                                       static_cast<unsigned>(_color.rgb().red),
+                                       static_cast<unsigned>(_color.rgb().green),
+                                       static_cast<unsigned>(_color.rgb().blue));
+                    });
+                    break;
+                case ColorType::Undefined: break;
+            }
+        }
+
+      private:
+        template <typename Append>
+        void append(int _count, Append const& _append)
+        {
+            if (count_ + _count > VTWriter::MaxParameterCount)
+            {
+                output_ += "m\033[";
+                count_ = 0;
+            }
+            else if (count_ != 0)
+                output_ += ';';
+            _append();
+            count_ += _count;
+        }
+
+        string& output_;
+        int count_ = 0;
+    };
+
+    // Appends the SGR parameters changing the attributes from @p _from to @p _to.
+    //
+    // The underline color cannot be reset to its default, which is why it is assumed to match.
+    void appendDelta(GraphicsAttributes const& _from, GraphicsAttributes const& _to, SGRBuilder& _builder)
+    {
+        auto const from = static_cast<unsigned>(_from.flags);
+        auto const to = static_cast<unsigned>(_to.flags);
+
+        // Clearing a group of flags also clears the ones of that group that are to be kept,
+        // which are therefore set again below.
+        auto reapplied = 0u;
+        for (auto const& [group, parameter]: FlagResetParameters)
+        {
+            auto const mask = static_cast<unsigned>(group);
+            if ((from & ~to & mask) == 0)
+                continue;
+            _builder.add(parameter);
+            reapplied |= to & mask;
+        }
+
+        for (auto const& [flag, parameter]: FlagParameters)
+        {
+            auto const bit = static_cast<unsigned>(flag);
+            if ((to & bit) && (!(from & bit) || (reapplied & bit)))
+                _builder.add(parameter);
+        }
+
+        if (_to.foregroundColor != _from.foregroundColor)
+            _builder.addColor(30, _to.foregroundColor);
+        if (_to.backgroundColor != _from.backgroundColor)
+            _builder.addColor(40, _to.backgroundColor);
+        if (_to.underlineColor != _from.underlineColor)
+            _builder.addColor(50, _to.underlineColor);
+    }
+} // namespace
 
 VTWriter::VTWriter(Writer writer): writer_ { std::move(writer) }
 {
+    buffer_.reserve(BufferSize);
 }
 
 VTWriter::VTWriter(std::ostream& output):
@@ -42,161 +206,81 @@ VTWriter::VTWriter(std::vector<char>& output):
 {
 }
 
-void VTWriter::write(char32_t v)
-{
-    sgrFlush();
-    char buf[4];
-    auto enc = unicode::encoder<char> {};
-    auto count = std::distance(buf, enc(v, buf));
-    write(string_view(buf, static_cast<size_t>(count)));
-}
-
-void VTWriter::write(string_view s)
+VTWriter::~VTWriter()
 {
-    sgrFlush();
-    writer_(s.data(), s.size());
+    flush();
 }
 
-void VTWriter::sgrFlush()
+void VTWriter::flush()
 {
-    if (sgr_.empty())
+    if (buffer_.empty())
         return;
 
-    auto const f = sgrFlush(sgr_);
-    if (sgr_ != lastSGR_)
-        writer_(f.data(), f.size());
-
-    sgrRewind();
+    writer_(buffer_.data(), buffer_.size());
+    buffer_.clear();
 }
 
-string VTWriter::sgrFlush(vector<unsigned> const& sgr)
+void VTWriter::write(char32_t v)
 {
-    if (sgr.empty())
-        return "";
-
-    auto const params =
-        sgr.size() != 1 || sgr[0] != 0 ? accumulate(
-            begin(sgr),
-            end(sgr),
-            string {},
-            [](auto a, auto b) { return a.empty() ? fmt::format("{}", b) : fmt::format("{};{}", a, b); })
-                                       : string();
-
-    return fmt::format("\033[{}m", params);
+    char buf[4];
+    auto enc = unicode::encoder<char> {};
+    auto count = std::distance(buf, enc(v, buf));
+    write(string_view(buf, static_cast<size_t>(count)));
 }
 
-void VTWriter::sgrAddExplicit(unsigned n)
+void VTWriter::write(string_view s)
 {
-    if (n == 0)
-    {
-        currentForegroundColor_ = DefaultColor();
-        currentBackgroundColor_ = DefaultColor();
-        currentUnderlineColor_ = DefaultColor();
-    }
-
-    sgr_.push_back(n);
+    buffer_ += s;
+    if (buffer_.size() >= BufferSize)
+        flush();
 }
 
-void VTWriter::sgrAdd(unsigned n)
+void VTWriter::setGraphicsAttributes(GraphicsAttributes const& _attributes)
 {
-    if (n == 0)
-    {
-        sgr_.clear();
-        sgr_.push_back(n);
-        currentForegroundColor_ = DefaultColor();
-        currentBackgroundColor_ = DefaultColor();
-        currentUnderlineColor_ = DefaultColor();
-    }
+    auto const attributes = serializableAttributes(_attributes);
+    if (attributes == currentAttributes_)
+        return;
+
+    if (attributes == GraphicsAttributes {})
+        buffer_ += "\033[m";
     else
     {
-        if (sgr_.empty() || sgr_.back() != n)
-            sgr_.push_back(n);
-
-        if (sgr_.size() == MaxParameterCount)
-        {
-            sgrFlush();
-        }
+        // Either the changed parameters only, or a full reset followed by all non-default parameters,
+        // whichever is shorter.
+        auto resetBuilder = SGRBuilder { resetParameters_ };
+        resetBuilder.add("0"sv);
+        appendDelta(GraphicsAttributes {}, attributes, resetBuilder);
+
+        auto const canDelta = attributes.underlineColor == currentAttributes_.underlineColor
+                              || attributes.underlineColor != DefaultColor();
+        auto const& parameters = [&]() -> string const& {
+            if (!canDelta)
+                return resetParameters_;
+            auto deltaBuilder = SGRBuilder { deltaParameters_ };
+            appendDelta(currentAttributes_, attributes, deltaBuilder);
+            return deltaParameters_.size() < resetParameters_.size() ? deltaParameters_ : resetParameters_;
+        }();
+
+        buffer_ += "\033[";
+        buffer_ += parameters;
+        buffer_ += 'm';
     }
-}
 
-void VTWriter::sgrRewind()
-{
-    swap(lastSGR_, sgr_);
-    sgr_.clear();
-}
-
-void VTWriter::sgrAdd(GraphicsRendition m)
-{
-    sgrAdd(static_cast<unsigned>(m));
+    currentAttributes_ = attributes;
 }
 
 void VTWriter::setForegroundColor(Color _color)
 {
-    // if (_color == currentForegroundColor_)
-    //     return;
-
-    currentForegroundColor_ = _color;
-    switch (_color.type())
-    {
-        case ColorType::Default:
-            //.
-            sgrAdd(39);
-            break;
-        case ColorType::Indexed:
-            if (static_cast<unsigned>(_color.index()) < 8)
-                sgrAdd(30 + static_cast<unsigned>(_color.index()));
-            else
-                sgrAdd(38, 5, static_cast<unsigned>(_color.index()));
-            break;
-        case ColorType::Bright:
-            //.
-            sgrAdd(90 + static_cast<unsigned>(getBrightColor(_color)));
-            break;
-        case ColorType::RGB:
-            // clang-format off
-            sgrAdd(38, 2, static_cast<unsigned>(_color.rgb().red),
-                          static_cast<unsigned>(_color.rgb().green),
-                          static_cast<unsigned>(_color.rgb().blue));
-            // clang-format on
-            break;
-        case ColorType::Undefined: break;
-    }
+    auto attributes = currentAttributes_;
+    attributes.foregroundColor = _color;
+    setGraphicsAttributes(attributes);
 }
 
 void VTWriter::setBackgroundColor(Color _color)
 {
-    // if (_color == currentBackgroundColor_)
-    //     return;
-
-    currentBackgroundColor_ = _color;
-    switch (_color.type())
-    {
-        case ColorType::Default: sgrAdd(49); break;
-        case ColorType::Indexed:
-            if (static_cast<unsigned>(_color.index()) < 8)
-                sgrAdd(40 + static_cast<unsigned>(_color.index()));
-            else
-            {
-                sgrAdd(48);
-                sgrAdd(5);
-                sgrAdd(static_cast<unsigned>(_color.index()));
-            }
-            break;
-        case ColorType::Bright:
-            //.
-            sgrAdd(100 + static_cast<unsigned>(getBrightColor(_color)));
-            break;
-        case ColorType::RGB:
-            sgrAdd(48);
-            sgrAdd(2);
-            sgrAdd(static_cast<unsigned>(_color.rgb().red));
-            sgrAdd(static_cast<unsigned>(_color.rgb().green));
-            sgrAdd(static_cast<unsigned>(_color.rgb().blue));
-            break;
-        case ColorType::Undefined:
-            //.
-            break;
-    }
+    auto attributes = currentAttributes_;
+    attributes.backgroundColor = _color;
+    setGraphicsAttributes(attributes);
 }
 
 template <typename Cell>
@@ -205,33 +289,54 @@ void VTWriter::write(Line<Cell> const& line)
     if (line.isTrivialBuffer())
     {
         TrivialLineBuffer const& lineBuffer = line.trivialBuffer();
-        setForegroundColor(lineBuffer.textAttributes.foregroundColor);
-        setBackgroundColor(lineBuffer.textAttributes.backgroundColor);
-        // TODO: hyperlinks, underlineColor and other flags (curly underline etc.)
-        write(line.toUtf8());
-        // TODO: Write fill columns.
+        // TODO: hyperlinks
+        if (!lineBuffer.text.empty())
+        {
+            setGraphicsAttributes(lineBuffer.textAttributes);
+            buffer_ += lineBuffer.text.view();
+        }
+        if (serializableAttributes(lineBuffer.fillAttributes) != GraphicsAttributes {})
+        {
+            setGraphicsAttributes(lineBuffer.fillAttributes);
+            buffer_.append(unbox<size_t>(lineBuffer.displayWidth - lineBuffer.usedColumns), ' ');
+        }
     }
     else
     {
-        for (Cell const& cell: line.inflatedBuffer())
+        auto const attributesOf = [](Cell const& cell) {
+            return serializableAttributes(GraphicsAttributes {
+                cell.foregroundColor(), cell.backgroundColor(), cell.underlineColor(), cell.flags() });
+        };
+
+        // Trailing blank cells are indistinguishable from the ones not written at all.
+        auto const& cells = line.inflatedBuffer();
+        auto end = cells.size();
+        while (end != 0 && cells[end - 1].empty() && attributesOf(cells[end - 1]) == GraphicsAttributes {})
+            --end;
+
+        for (size_t i = 0; i < end;)
         {
-            if (cell.flags() & CellFlags::Bold)
-                sgrAdd(GraphicsRendition::Bold);
-            else
-                sgrAdd(GraphicsRendition::Normal);
-
-            setForegroundColor(cell.foregroundColor());
-            setBackgroundColor(cell.backgroundColor());
-            // TODO: other flags (such as underline), hyperlinks, image fragments.
-
+            // TODO: hyperlinks, image fragments.
+            Cell const& cell = cells[i];
+            setGraphicsAttributes(attributesOf(cell));
             if (!cell.codepointCount())
-                write(' ');
+            {
+                buffer_ += ' ';
+                ++i;
+            }
             else
-                write(cell.toUtf8());
+            {
+                // The columns covered by a wide character are not written separately.
+                buffer_ += cell.toUtf8();
+                i += std::max(size_t { 1 }, static_cast<size_t>(cell.width()));
+            }
         }
     }
 
-    sgrAdd(GraphicsRendition::Reset);
+    setGraphicsAttributes(GraphicsAttributes {});
+
+    if (buffer_.size() >= BufferSize)
+        flush();
 }
 
 } // namespace terminal
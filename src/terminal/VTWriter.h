@@ -14,6 +14,7 @@
 #pragma once
 
 #include <terminal/Color.h>
+#include <terminal/GraphicsAttributes.h>
 #include <terminal/Line.h>
 #include <terminal/primitives.h>
 
@@ -23,13 +24,17 @@
 
 #include <functional>
 #include <ostream>
-#include <sstream>
+#include <string>
 #include <vector>
 
 namespace terminal
 {
 
 // Serializes text and SGR attributes into a valid VT stream.
+//
+// The graphics attributes of the output are tracked, such that only the SGR parameters
+// that actually change are written. The output is collected in a reused buffer,
+// which is handed to the writer in larger blocks.
 class VTWriter
 {
   public:
@@ -37,13 +42,22 @@ class VTWriter
 
     static constexpr inline auto MaxParameterCount = 16;
 
+    // Number of bytes collected before they are handed to the writer.
+    static constexpr inline auto BufferSize = size_t { 16 * 1024 };
+
     explicit VTWriter(Writer writer);
     explicit VTWriter(std::ostream& output);
     explicit VTWriter(std::vector<char>& output);
+    ~VTWriter();
+
+    VTWriter(VTWriter const&) = delete;
+    VTWriter& operator=(VTWriter const&) = delete;
 
     void crlf();
 
     // Writes the given Line<> to the output stream without the trailing newline.
+    //
+    // Trailing blank cells are omitted and the graphics attributes are reset at the end of the line.
     template <typename Cell>
     void write(Line<Cell> const& line);
 
@@ -52,34 +66,22 @@ class VTWriter
     void write(std::string_view s);
     void write(char32_t v);
 
-    void sgrFlush();
-    std::string sgrFlush(std::vector<unsigned> const& sgr);
-    void sgrAdd(unsigned n);
-    void sgrRewind();
-    void sgrAdd(GraphicsRendition m);
+    // Changes the graphics attributes of the output, using the shortest SGR sequence available.
+    void setGraphicsAttributes(GraphicsAttributes const& attributes);
     void setForegroundColor(Color color);
     void setBackgroundColor(Color color);
 
-    void sgrAddExplicit(unsigned n);
-
-    template <typename... Args>
-    void sgrAdd(unsigned n, Args... values)
-    {
-        if (sgr_.size() + sizeof...(values) > MaxParameterCount)
-            sgrFlush();
-
-        sgrAddExplicit(n);
-        (sgrAddExplicit(static_cast<unsigned>(values)), ...);
-    }
+    // Hands all buffered output to the writer.
+    void flush();
 
   private:
     Writer writer_;
-    std::vector<unsigned> sgr_;
-    std::stringstream sstr;
-    std::vector<unsigned> lastSGR_;
-    Color currentForegroundColor_ = DefaultColor();
-    Color currentUnderlineColor_ = DefaultColor();
-    Color currentBackgroundColor_ = DefaultColor();
+    std::string buffer_;
+    GraphicsAttributes currentAttributes_ {};
+
+    // Reused scratch buffers for the SGR parameters of both candidate encodings.
+    std::string deltaParameters_;
+    std::string resetParameters_;
 };
 
 template <typename... T>
@@ -90,7 +92,7 @@ inline void VTWriter::write(fmt::format_string<T...> fmt, T&&... args)
 
 inline void VTWriter::crlf()
 {
-    write("\r\n");
+    buffer_ += "\r\n";
 }
 
 } // namespace terminal
@@ -0,0 +1,138 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/VTWriter.h>
+#include <terminal/cell/CellConfig.h>
+
+#include <crispy/escape.h>
+
+#include <catch2/catch.hpp>
+
+#include <string>
+#include <utility>
+
+using namespace std;
+using namespace terminal;
+
+// Default cell type for testing.
+using Cell = PrimaryScreenCell;
+
+namespace
+{
+InternedGraphicsAttributes interned(GraphicsAttributes const& _attributes)
+{
+    return *InternedGraphicsAttributes::intern(_attributes);
+}
+
+struct Output
+{
+    string text;
+    VTWriter writer { [this](char const* _data, size_t _size) {
+        text.append(_data, _size);
+    } };
+
+    string take()
+    {
+        writer.flush();
+        return std::exchange(text, string {});
+    }
+};
+} // namespace
+
+TEST_CASE("VTWriter.setGraphicsAttributes", "[VTWriter]")
+{
+    auto output = Output {};
+    auto sgr = GraphicsAttributes {};
+
+    output.writer.setGraphicsAttributes(sgr);
+    CHECK(output.take().empty());
+
+    sgr.foregroundColor = Color::Indexed(IndexedColor::Red);
+    output.writer.setGraphicsAttributes(sgr);
+    CHECK(crispy::escape(output.take()) == crispy::escape("\033[31m"));
+
+    sgr.flags = CellFlags::Bold | CellFlags::Faint;
+    output.writer.setGraphicsAttributes(sgr);
+    CHECK(crispy::escape(output.take()) == crispy::escape("\033[1;2m"));
+
+    // Clearing Bold also clears Faint, which must be set again.
+    sgr.flags = CellFlags::Faint;
+    output.writer.setGraphicsAttributes(sgr);
+    CHECK(crispy::escape(output.take()) == crispy::escape("\033[22;2m"));
+
+    // A reset is shorter than clearing each attribute.
+    sgr = GraphicsAttributes {};
+    sgr.flags = CellFlags::Italic;
+    output.writer.setGraphicsAttributes(sgr);
+    CHECK(crispy::escape(output.take()) == crispy::escape("\033[0;3m"));
+
+    output.writer.setGraphicsAttributes(GraphicsAttributes {});
+    CHECK(crispy::escape(output.take()) == crispy::escape("\033[m"));
+}
+
+TEST_CASE("VTWriter.setGraphicsAttributes.split", "[VTWriter]")
+{
+    auto output = Output {};
+    auto const sgr = GraphicsAttributes { RGBColor { 1, 2, 3 },
+                                          RGBColor { 4, 5, 6 },
+                                          RGBColor { 7, 8, 9 },
+                                          CellFlags::Bold | CellFlags::Italic };
+
+    // More than VTWriter::MaxParameterCount parameters are split into multiple sequences.
+    output.writer.setGraphicsAttributes(sgr);
+    CHECK(crispy::escape(output.take())
+          == crispy::escape("\033[1;3;38;2;1;2;3;48;2;4;5;6m\033[58;2;7;8;9m"));
+}
+
+TEST_CASE("VTWriter.write.inflated", "[VTWriter]")
+{
+    auto line = Line<Cell>(LineFlags::None, Line<Cell>::InflatedBuffer(5, Cell {}));
+    line.fill(ColumnOffset(0), GraphicsAttributes {}, "ABC");
+    line.useCellAt(ColumnOffset(0)).setForegroundColor(Color::Indexed(IndexedColor::Red));
+    line.useCellAt(ColumnOffset(1)).setForegroundColor(Color::Indexed(IndexedColor::Red));
+
+    auto output = Output {};
+    output.writer.write(line);
+    CHECK(crispy::escape(output.take()) == crispy::escape("\033[31mAB\033[mC"));
+}
+
+TEST_CASE("VTWriter.write.trivial", "[VTWriter]")
+{
+    auto pool = crispy::BufferObjectPool<char>(4096);
+    auto bufferObject = pool.allocateBufferObject();
+    bufferObject->writeAtEnd("AB"sv);
+    auto const sgr = GraphicsAttributes { Color::Indexed(IndexedColor::Red) };
+    auto const fillSGR = GraphicsAttributes { DefaultColor(), Color::Indexed(IndexedColor::Blue) };
+
+    auto output = Output {};
+    output.writer.write(Line<Cell>(
+        LineFlags::None,
+        TrivialLineBuffer { ColumnCount(5),
+                            interned(sgr),
+                            InternedGraphicsAttributes {},
+                            HyperlinkId {},
+                            ColumnCount(2),
+                            bufferObject->ref(0, 2) }));
+    CHECK(crispy::escape(output.take()) == crispy::escape("\033[31mAB\033[m"));
+
+    // Non-default fill attributes are written as well.
+    output.writer.write(Line<Cell>(
+        LineFlags::None,
+        TrivialLineBuffer { ColumnCount(5),
+                            interned(sgr),
+                            interned(fillSGR),
+                            HyperlinkId {},
+                            ColumnCount(2),
+                            bufferObject->ref(0, 2) }));
+    CHECK(crispy::escape(output.take()) == crispy::escape("\033[31mAB\033[0;44m   \033[m"));
+}
@@ -38,6 +38,7 @@ void ViCommands::scrollViewport(ScrollOffset delta)
 
 void ViCommands::searchStart()
 {
+    terminal.cancelSearchInBackground();
     terminal.state().searchMode.pattern.clear();
     terminal.screenUpdated();
 }
@@ -49,6 +50,7 @@ void ViCommands::searchDone()
 
 void ViCommands::searchCancel()
 {
+    terminal.cancelSearchInBackground();
     terminal.state().searchMode.pattern.clear();
     terminal.screenUpdated();
 }
@@ -99,8 +101,10 @@ bool ViCommands::jumpToPreviousMatch(unsigned count)
 
 void ViCommands::updateSearchTerm(std::u32string const& text)
 {
-    if (auto const newLocation = terminal.searchReverse(text, cursorPosition))
-        moveCursorTo(newLocation.value());
+    // Searching the history may take a while, so don't block handling of any further keystrokes,
+    // which in turn cancel the running search when updating the search term again.
+    terminal.searchReverseInBackground(
+        text, cursorPosition, [this](CellLocation location) { moveCursorTo(location); });
 }
 
 void ViCommands::modeChanged(ViMode mode)
@@ -164,7 +168,7 @@ void ViCommands::reverseSearchCurrentWord()
     assert(range.contains(cursorPosition));
     cursorPosition = range.first;
 
-    updateSearchTerm(wordUnderCursor);
+    (void) terminal.searchReverse(wordUnderCursor, cursorPosition);
     jumpToPreviousMatch(1);
 }
 
@@ -173,7 +177,7 @@ void ViCommands::searchCurrentWord()
     auto const [wordUnderCursor, range] = terminal.extractWordUnderCursor(cursorPosition);
     assert(range.contains(cursorPosition));
     cursorPosition = range.second;
-    updateSearchTerm(wordUnderCursor);
+    (void) terminal.searchReverse(wordUnderCursor, cursorPosition);
     jumpToNextMatch(1);
 }
 
@@ -189,7 +193,8 @@ void ViCommands::executeYank(ViMotion motion, unsigned count)
             else
                 terminal.setHighlightRange(
                     LinearHighlight { { terminal.selector()->from(), terminal.selector()->to() } });
-            terminal.copyToClipboard(terminal.extractSelectionText());
+            terminal.extractSelectionTextInBackground(
+                [this](std::string _text) { terminal.copyToClipboard(_text); });
             terminal.inputHandler().setMode(ViMode::Normal);
             break;
         }
@@ -36,6 +36,7 @@ bool Viewport::scrollDown(LineCount _numLines)
 
 bool Viewport::scrollToTop()
 {
+    terminal_.currentScreen().reflowDeferredLines(-boxed_cast<LineOffset>(historyLineCount()));
     return scrollTo(boxed_cast<ScrollOffset>(historyLineCount()));
 }
 
@@ -77,6 +78,9 @@ bool Viewport::scrollTo(ScrollOffset _offset)
     if (_offset == scrollOffset_)
         return false;
 
+    // Scrollback lines must have been reflowed before they can be shown.
+    terminal_.currentScreen().reflowDeferredLines(-boxed_cast<LineOffset>(_offset));
+
     if (0 <= *_offset && _offset <= boxed_cast<ScrollOffset>(historyLineCount()))
     {
 #if defined(CONTOUR_LOG_VIEWPORT)
@@ -98,6 +102,7 @@ bool Viewport::scrollMarkUp()
     if (scrollingDisabled())
         return false;
 
+    terminal_.primaryScreen().grid().reflowDeferredLines();
     auto const newScrollOffset =
         terminal_.primaryScreen().findMarkerUpwards(-boxed_cast<LineOffset>(scrollOffset_));
     if (newScrollOffset.has_value())
@@ -121,6 +126,19 @@ bool Viewport::scrollMarkDown()
     return true;
 }
 
+bool Viewport::scrollToPreviousFailedCommand()
+{
+    if (scrollingDisabled())
+        return false;
+
+    auto const promptLine =
+        terminal_.primaryScreen().grid().findFailedCommandAbove(-boxed_cast<LineOffset>(scrollOffset_));
+    if (promptLine.has_value())
+        return scrollTo(boxed_cast<ScrollOffset>(-*promptLine));
+
+    return false;
+}
+
 LineCount Viewport::historyLineCount() const noexcept
 {
     return terminal_.currentScreen().historyLineCount();
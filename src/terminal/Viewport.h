@@ -83,6 +83,10 @@ class Viewport
     bool scrollMarkUp();
     bool scrollMarkDown();
 
+    /// Scrolls up to the prompt of the closest command above the viewport that has failed,
+    /// as reported via shell integration (OSC 133).
+    bool scrollToPreviousFailedCommand();
+
     /// Ensures given line is visible by optionally scrolling the
     /// screen's viewport up or down in order to make that line visible.
     ///
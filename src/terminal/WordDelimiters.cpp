@@ -0,0 +1,107 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/WordDelimiters.h>
+
+#include <atomic>
+#include <bit>
+
+#if defined(__SSE2__)
+    #include <immintrin.h>
+    #define LIBTERMINAL_WORD_DELIMITERS_SIMD 1
+#elif defined(__aarch64__)
+    #include <crispy/sse2neon.h>
+    #define LIBTERMINAL_WORD_DELIMITERS_SIMD 1
+#endif
+
+using std::u32string_view;
+
+namespace terminal
+{
+
+namespace
+{
+    uint64_t nextId() noexcept
+    {
+        static auto counter = std::atomic<uint64_t> { 0 };
+        return ++counter;
+    }
+
+    constexpr bool isAlphanumericASCII(char32_t _codepoint) noexcept
+    {
+        return (U'0' <= _codepoint && _codepoint <= U'9') || (U'A' <= _codepoint && _codepoint <= U'Z')
+               || (U'a' <= _codepoint && _codepoint <= U'z');
+    }
+} // namespace
+
+WordDelimiters::WordDelimiters(): WordDelimiters(u32string_view {})
+{
+}
+
+WordDelimiters::WordDelimiters(u32string_view _codepoints): codepoints_ { _codepoints }, id_ { nextId() }
+{
+    ascii_[0] = true;
+    ascii_[0x20] = true;
+    for (char32_t const codepoint: _codepoints)
+    {
+        if (codepoint < ascii_.size())
+        {
+            ascii_[codepoint] = true;
+            alphanumericDelimiters_ = alphanumericDelimiters_ || isAlphanumericASCII(codepoint);
+        }
+        else
+            nonASCII_.push_back(codepoint);
+    }
+}
+
+void WordDelimiters::classify(std::string_view _ascii, LineWordBoundaries& _boundaries) const noexcept
+{
+    auto const* const text = _ascii.data();
+    auto const count = _ascii.size();
+    auto i = size_t { 0 };
+
+    auto const classifyByte = [&](size_t _column) {
+        if (ascii_[static_cast<unsigned char>(text[_column]) & 0x7F])
+            _boundaries.set(_column);
+    };
+
+#if defined(LIBTERMINAL_WORD_DELIMITERS_SIMD)
+    // Letters and digits never delimit words (unless configured so), which leaves only the
+    // remaining bytes of each batch to be looked up.
+    if (!alphanumericDelimiters_)
+    {
+        auto const inRange = [](__m128i _batch, char _first, char _last) {
+            return _mm_and_si128(_mm_cmpgt_epi8(_batch, _mm_set1_epi8(static_cast<char>(_first - 1))),
+                                 _mm_cmplt_epi8(_batch, _mm_set1_epi8(static_cast<char>(_last + 1))));
+        };
+        auto const lowercase = _mm_set1_epi8(0x20);
+        for (; i + sizeof(__m128i) <= count; i += sizeof(__m128i))
+        {
+            auto const batch = _mm_loadu_si128(reinterpret_cast<__m128i const*>(text + i));
+            auto const alphanumeric =
+                _mm_or_si128(inRange(batch, '0', '9'), inRange(_mm_or_si128(batch, lowercase), 'a', 'z'));
+            auto others = ~static_cast<uint32_t>(_mm_movemask_epi8(alphanumeric)) & 0xFFFF;
+            while (others)
+            {
+                classifyByte(i + static_cast<size_t>(std::countr_zero(others)));
+                others &= others - 1;
+            }
+        }
+    }
+#endif
+
+    for (; i < count; ++i)
+        classifyByte(i);
+}
+
+} // namespace terminal
@@ -0,0 +1,86 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace terminal
+{
+
+/// Columns of a line that delimit words, i.e. that are empty or hold a word delimiter,
+/// as cached by the line.
+struct LineWordBoundaries
+{
+    uint64_t delimitersId = 0; //!< WordDelimiters::id() of the delimiters these have been found with
+    std::vector<uint64_t> bits {}; //!< one bit per column, columns beyond these all delimit words
+
+    void resize(size_t _columns)
+    {
+        bits.assign((_columns + 63) / 64, 0);
+        if (_columns % 64)
+            bits.back() = ~uint64_t { 0 } << (_columns % 64);
+    }
+    void set(size_t _column) noexcept { bits[_column / 64] |= uint64_t { 1 } << (_column % 64); }
+
+    [[nodiscard]] bool test(size_t _column) const noexcept
+    {
+        return _column / 64 >= bits.size() || ((bits[_column / 64] >> (_column % 64)) & 1) != 0;
+    }
+};
+
+/**
+ * Set of codepoints delimiting words, such as for word-wise selection.
+ *
+ * Empty cells (including cells holding a space) always delimit words.
+ * US-ASCII delimiters are looked up in a table, and runs of letters and digits in US-ASCII text
+ * are skipped 16 bytes at a time, where supported.
+ */
+class WordDelimiters
+{
+  public:
+    WordDelimiters();
+    explicit WordDelimiters(std::u32string_view _codepoints);
+
+    [[nodiscard]] std::u32string const& codepoints() const noexcept { return codepoints_; }
+
+    /// Identifies this set of delimiters, such that results cached for it can be told apart
+    /// from those of another set.
+    [[nodiscard]] uint64_t id() const noexcept { return id_; }
+
+    /// Tests whether a cell starting with the given codepoint, or 0 if empty, delimits words.
+    [[nodiscard]] bool delimits(char32_t _codepoint) const noexcept
+    {
+        if (_codepoint < ascii_.size())
+            return ascii_[_codepoint];
+        return nonASCII_.find(_codepoint) != std::u32string::npos;
+    }
+
+    /// Marks the columns of the given US-ASCII text (one byte per column, starting at column 0)
+    /// that delimit words.
+    void classify(std::string_view _ascii, LineWordBoundaries& _boundaries) const noexcept;
+
+  private:
+    std::u32string codepoints_;
+    uint64_t id_;
+    std::array<bool, 128> ascii_ {}; // delimiting US-ASCII characters, including NUL and space
+    std::u32string nonASCII_;
+    bool alphanumericDelimiters_ = false; // whether any letter or digit is a delimiter
+};
+
+} // namespace terminal
@@ -0,0 +1,71 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/WordDelimiters.h>
+
+#include <catch2/catch.hpp>
+
+#include <string>
+#include <string_view>
+
+using namespace terminal;
+using namespace std::string_view_literals;
+
+namespace
+{
+std::string delimitedColumns(WordDelimiters const& delimiters, std::string_view text)
+{
+    auto boundaries = LineWordBoundaries {};
+    boundaries.resize(text.size());
+    delimiters.classify(text, boundaries);
+
+    auto result = std::string {};
+    for (size_t column = 0; column < text.size(); ++column)
+        result += boundaries.test(column) ? '|' : '.';
+    return result;
+}
+} // namespace
+
+TEST_CASE("WordDelimiters.delimits", "[selector]")
+{
+    auto const delimiters = WordDelimiters(U",:│"sv);
+    CHECK(delimiters.delimits(0));
+    CHECK(delimiters.delimits(U' '));
+    CHECK(delimiters.delimits(U','));
+    CHECK(delimiters.delimits(U'│'));
+    CHECK_FALSE(delimiters.delimits(U'a'));
+    CHECK_FALSE(delimiters.delimits(U'ä'));
+
+    // Each set of delimiters is told apart from any other one.
+    CHECK(delimiters.id() != WordDelimiters(U",:│"sv).id());
+}
+
+TEST_CASE("WordDelimiters.classify", "[selector]")
+{
+    auto const delimiters = WordDelimiters(U"\",:{}[]"sv);
+
+    // Longer than a batch of 16 bytes, with a tail to be classified one by one.
+    auto constexpr Text = R"({"key":"value", "list":[1,2,3], "more":{}})"sv;
+    CHECK(delimitedColumns(delimiters, Text) == "||...|||.....||||....|||.|.|.||||....|||||");
+
+    // Letters and digits may delimit words, too.
+    auto const digits = WordDelimiters(U"0123456789"sv);
+    CHECK(delimitedColumns(digits, "abc1def2ghi3jkl4mno5pqr6"sv) == "...|...|...|...|...|...|");
+
+    // Columns beyond the classified text delimit words.
+    auto boundaries = LineWordBoundaries {};
+    boundaries.resize(3);
+    delimiters.classify("abc"sv, boundaries);
+    CHECK_FALSE(boundaries.test(2));
+    CHECK(boundaries.test(64));
+}
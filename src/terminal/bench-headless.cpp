@@ -20,14 +20,22 @@
 
 #include <crispy/App.h>
 #include <crispy/CLI.h>
+#include <crispy/PerfCounters.h>
 #include <crispy/utils.h>
 
 #include <fmt/format.h>
 
+#include <chrono>
+#include <fstream>
+#include <functional>
 #include <iostream>
 #include <optional>
 #include <random>
+#include <sstream>
+#include <string>
 #include <thread>
+#include <type_traits>
+#include <vector>
 
 #include <libtermbench/termbench.h>
 
@@ -109,6 +117,616 @@ int baseBenchmark(Writer&& _writer, BenchOptions _options, string_view _title)
     return EXIT_SUCCESS;
 }
 
+// {{{ screen operation benchmarks
+namespace
+{
+
+struct ScreenBenchResult
+{
+    std::string name;
+    uint64_t bytes = 0;      // VT stream bytes processed, or 0 for tests not measuring a stream
+    uint64_t iterations = 0; // number of chunks or operations processed
+    std::chrono::nanoseconds elapsed {};
+    std::optional<crispy::PerfCounters::Sample> counters; // hardware events, if requested and available
+    std::optional<size_t> bytesPerLine; // memory taken by a written line, for the cell layout tests
+};
+
+using BenchTerminal = terminal::MockTerm<terminal::MockViewPty>;
+
+constexpr auto BenchPageSize = terminal::PageSize { terminal::LineCount(25), terminal::ColumnCount(80) };
+constexpr size_t BenchChunkSize = 64 * 1024;
+
+void writeToScreen(BenchTerminal& _vt, std::string_view _text)
+{
+    // Reading nothing from the PTY would close it.
+    if (_text.empty())
+        return;
+
+    auto& pty = _vt.mockPty();
+    pty.setReadData(_text);
+    // clang-format off
+    do _vt.terminal.processInputOnce();
+    while (!pty.isClosed() && !pty.stdoutBuffer().empty());
+    // clang-format on
+}
+
+/// Measures running @p _operation @p _iterations times, counting hardware events via
+/// @p _perfCounters unless nullptr.
+template <typename Operation>
+ScreenBenchResult measure(crispy::PerfCounters* _perfCounters,
+                          std::string _name,
+                          uint64_t _iterations,
+                          Operation&& _operation)
+{
+    auto result = ScreenBenchResult { std::move(_name) };
+    if (_perfCounters)
+        _perfCounters->start();
+    auto const startTime = chrono::steady_clock::now();
+    for (result.iterations = 0; result.iterations < _iterations; ++result.iterations)
+        _operation();
+    result.elapsed = chrono::steady_clock::now() - startTime;
+    if (_perfCounters)
+        result.counters = _perfCounters->stop();
+    return result;
+}
+
+/// Repeats the given text up to the size of a chunk to be processed at once.
+std::string makeChunk(std::function<std::string(size_t)> const& _generate)
+{
+    auto chunk = std::string {};
+    for (size_t i = 0; chunk.size() < BenchChunkSize; ++i)
+        chunk += _generate(i);
+    return chunk;
+}
+
+/// Measures processing @p _chunk until @p _totalBytes have been processed,
+/// after @p _setup has been processed.
+ScreenBenchResult benchStream(crispy::PerfCounters* _perfCounters,
+                              std::string _name,
+                              std::string_view _setup,
+                              std::string const& _chunk,
+                              uint64_t _totalBytes)
+{
+    auto vt = BenchTerminal { BenchPageSize, terminal::LineCount(4000), 1'000'000 };
+    vt.terminal.setMode(terminal::DECMode::AutoWrap, true);
+    writeToScreen(vt, _setup);
+
+    auto const iterations = std::max(uint64_t { 1 }, _totalBytes / _chunk.size());
+    auto result =
+        measure(_perfCounters, std::move(_name), iterations, [&]() { writeToScreen(vt, _chunk); });
+    result.bytes = result.iterations * _chunk.size();
+    return result;
+}
+
+/// Measures writing lines of text into a grid of @p Cell, scrolling each line into the history,
+/// with every other line styled. Styling makes CompactCell allocate its CellExtra.
+template <typename Cell>
+ScreenBenchResult benchCellLayout(crispy::PerfCounters* _perfCounters,
+                                  std::string _name,
+                                  uint64_t _totalBytes)
+{
+    auto grid = terminal::Grid<Cell>(BenchPageSize, false, terminal::LineCount(4000));
+    auto styled = terminal::GraphicsAttributes {};
+    styled.foregroundColor = terminal::IndexedColor::Red;
+    styled.flags = terminal::CellFlags::Bold;
+    auto const bottomLine = BenchPageSize.lines.as<terminal::LineOffset>() - 1;
+    auto const columns = unbox<int>(BenchPageSize.columns);
+
+    auto lineNumber = uint64_t { 0 };
+    auto const iterations = std::max(uint64_t { 1 }, _totalBytes / unbox<uint64_t>(BenchPageSize.columns));
+    auto result = measure(_perfCounters, std::move(_name), iterations, [&]() {
+        auto const sgr = lineNumber++ % 2 ? styled : terminal::GraphicsAttributes {};
+        for (int column = 0; column < columns; ++column)
+            grid.useCellAt(bottomLine, terminal::ColumnOffset(column))
+                .write(sgr, static_cast<char32_t>('A' + (unsigned(column) + lineNumber) % 26), 1);
+        grid.scrollUp(terminal::LineCount(1));
+    });
+    result.bytes = result.iterations * unbox<uint64_t>(BenchPageSize.columns);
+
+    // On average, every other line's cells also hold a CellExtra.
+    auto const extraBytesPerCell =
+        std::is_same_v<Cell, terminal::CompactCell> ? sizeof(terminal::CellExtra) / 2 : size_t { 0 };
+    result.bytesPerLine = sizeof(terminal::Line<Cell>)
+                          + unbox<size_t>(BenchPageSize.columns) * (sizeof(Cell) + extraBytesPerCell);
+    return result;
+}
+
+std::string sixelImage(int _width, int _height)
+{
+    // Sixel rows of alternating colors, each sixel row being 6 pixels high.
+    auto image = std::string { "\033Pq#0;2;100;0;0#1;2;0;0;100" };
+    for (int row = 0; row < (_height + 5) / 6; ++row)
+    {
+        image += fmt::format("#{}", row % 2);
+        for (int x = 0; x < _width; ++x)
+            image += static_cast<char>('?' + (x + row) % 64);
+        image += '-';
+    }
+    image += "\033\\";
+    return image;
+}
+
+/// Fills the scrollback of @p _vt with @p _lineCount lines, each wrapping into multiple screen lines.
+void fillHistory(BenchTerminal& _vt, int _lineCount)
+{
+    auto text = std::string {};
+    for (int i = 0; i < _lineCount; ++i)
+        text += fmt::format("{:05} {}\r\n", i, std::string(200, static_cast<char>('a' + i % 26)));
+    writeToScreen(_vt, text);
+}
+
+std::vector<ScreenBenchResult> runScreenBenchmarks(uint64_t _totalBytes,
+                                                   std::string_view _filter,
+                                                   crispy::PerfCounters* _perfCounters,
+                                                   std::ostream& _progress)
+{
+    auto const selected = [&](std::string_view _name) {
+        if (_filter.empty() || _name.find(_filter) != std::string_view::npos)
+        {
+            _progress << fmt::format("Running test {} ...\n", _name);
+            return true;
+        }
+        return false;
+    };
+
+    auto results = std::vector<ScreenBenchResult> {};
+
+    // {{{ VT streams
+    struct StreamTest
+    {
+        std::string_view name;
+        std::string_view setup;
+        std::function<std::string(size_t)> generate; // generates the i-th part of the stream
+    };
+
+    auto const sixel = "\033[H" + sixelImage(160, 96);
+    auto const streamTests = std::vector<StreamTest> {
+        { "scroll-region",
+          "\033[5;20r\033[20;1H",
+          [](size_t i) { return fmt::format("line {} scrolling within the margins\r\n", i); } },
+        { "scroll-region-left-right",
+          // The right one of two side by side panes, as laid out by tmux.
+          "\033[?69h\033[5;20r\033[41;80s\033[20;41H",
+          [](size_t i) { return fmt::format("line {} scrolling in the right pane\r\n", i); } },
+        { "insert-delete-chars",
+          "",
+          [](size_t i) {
+              return fmt::format("\033[{};{}H\033[4@ABCD\033[{};{}H\033[4P",
+                                 1 + i % 25,
+                                 1 + i % 80,
+                                 1 + (i * 7) % 25,
+                                 1 + (i * 13) % 80);
+          } },
+        { "insert-delete-lines",
+          "",
+          [](size_t i) {
+              return fmt::format(
+                  "\033[{};1H\033[2Lline {}\033[{};1H\033[2M", 1 + i % 25, i, 1 + (i * 7) % 25);
+          } },
+        { "unicode",
+          "",
+          [](size_t i) {
+              // Combining characters, emoji, emoji modifiers, and ZWJ sequences.
+              return fmt::format("Gr\u00FC\u00DFe cafe\u0301 na\u00EFve \U0001F600 \U0001F44D\U0001F3FD "
+                                 "\U0001F468\u200D\U0001F469\u200D\U0001F467{}",
+                                 i % 3 ? " " : "\r\n");
+          } },
+        { "wide-cjk",
+          "",
+          [](size_t i) {
+              return fmt::format("\u6F22\u5B57\u4EEE\u540D\u4EA4\u3058\u308A\uD55C\uAD6D\uC5B4\u4E2D\u6587{}",
+                                 i % 3 ? "\u3001" : "\r\n");
+          } },
+        { "hyperlinks",
+          "",
+          [](size_t i) {
+              return fmt::format("\033]8;id={};https://example.com/{}\033\\link {}\033]8;;\033\\{}",
+                                 i,
+                                 i,
+                                 i,
+                                 i % 4 ? " " : "\r\n");
+          } },
+        { "sixel", "", [&](size_t) { return sixel; } },
+    };
+
+    for (auto const& test: streamTests)
+        if (selected(test.name))
+            results.emplace_back(benchStream(
+                _perfCounters, std::string(test.name), test.setup, makeChunk(test.generate), _totalBytes));
+    // }}}
+
+    // {{{ cell layouts
+    if (selected("cells-compact"))
+        results.emplace_back(
+            benchCellLayout<terminal::CompactCell>(_perfCounters, "cells-compact", _totalBytes));
+
+    if (selected("cells-simple"))
+        results.emplace_back(
+            benchCellLayout<terminal::SimpleCell>(_perfCounters, "cells-simple", _totalBytes));
+    // }}}
+
+    // {{{ operations
+    if (selected("resize-reflow"))
+    {
+        auto vt = BenchTerminal { BenchPageSize, terminal::LineCount(10'000), 1'000'000 };
+        vt.terminal.setMode(terminal::DECMode::AutoWrap, true);
+        fillHistory(vt, 3'000);
+        auto columns = BenchPageSize.columns;
+        results.emplace_back(measure(_perfCounters, "resize-reflow", 20, [&]() {
+            columns = columns == BenchPageSize.columns ? terminal::ColumnCount(120) : BenchPageSize.columns;
+            vt.terminal.resizeScreen(terminal::PageSize { BenchPageSize.lines, columns });
+        }));
+    }
+
+    if (selected("search-history"))
+    {
+        auto vt = BenchTerminal { BenchPageSize, terminal::LineCount(10'000), 1'000'000 };
+        vt.terminal.setMode(terminal::DECMode::AutoWrap, true);
+        fillHistory(vt, 3'000);
+        auto const bottomRight = terminal::CellLocation {
+            BenchPageSize.lines.as<terminal::LineOffset>() - 1,
+            BenchPageSize.columns.as<terminal::ColumnOffset>() - 1,
+        };
+        // Searching for a term that does not exist, scans the whole history.
+        results.emplace_back(measure(_perfCounters, "search-history", 20, [&]() {
+            (void) vt.terminal.searchReverse(U"not to be found", bottomRight);
+        }));
+    }
+
+    if (selected("render-buffer"))
+    {
+        auto const pageSize = terminal::PageSize { terminal::LineCount(60), terminal::ColumnCount(200) };
+        auto vt = BenchTerminal { pageSize, terminal::LineCount(0), 1'000'000 };
+        auto text = std::string {};
+        for (int line = 0; line < unbox<int>(pageSize.lines); ++line)
+            for (int column = 0; column < unbox<int>(pageSize.columns); ++column)
+                text += fmt::format("\033[{};{}H\033[3{};4{}m{}",
+                                    line + 1,
+                                    column + 1,
+                                    column % 8,
+                                    (line + column) % 8,
+                                    static_cast<char>('A' + (line + column) % 26));
+        writeToScreen(vt, text);
+        vt.terminal.refreshRenderBuffer();
+
+        // Toggling reverse video invalidates all lines of the render buffer.
+        auto reverseVideo = false;
+        results.emplace_back(measure(_perfCounters, "render-buffer-full", 200, [&]() {
+            reverseVideo = !reverseVideo;
+            writeToScreen(vt, reverseVideo ? "\033[?5h" : "\033[?5l");
+            vt.terminal.refreshRenderBuffer();
+        }));
+
+        auto line = 0;
+        results.emplace_back(measure(_perfCounters, "render-buffer-line", 2000, [&]() {
+            line = (line + 1) % unbox<int>(pageSize.lines);
+            writeToScreen(vt, fmt::format("\033[{};1H\033[2K{} modified", line + 1, line));
+            vt.terminal.refreshRenderBuffer();
+        }));
+    }
+
+    if (selected("screenshot"))
+    {
+        auto vt = BenchTerminal { BenchPageSize, terminal::LineCount(0), 1'000'000 };
+        auto text = std::string {};
+        for (int line = 0; line < unbox<int>(BenchPageSize.lines); ++line)
+            for (int column = 0; column < unbox<int>(BenchPageSize.columns); column += 8)
+                text += fmt::format("\033[{};{}H\033[{};3{}mcolumn{:02}",
+                                    line + 1,
+                                    column + 1,
+                                    line % 2 + 1,
+                                    column / 8 % 8,
+                                    column);
+        writeToScreen(vt, text);
+
+        auto screenshotSize = size_t { 0 };
+        results.emplace_back(measure(_perfCounters, "screenshot", 2000, [&]() {
+            screenshotSize = vt.terminal.primaryScreen().screenshot().size();
+        }));
+        _progress << fmt::format("screenshot: {} bytes\n", screenshotSize);
+    }
+    // }}}
+
+    return results;
+}
+
+void printScreenBenchResults(std::vector<ScreenBenchResult> const& _results, std::ostream& _output)
+{
+    for (auto const& result: _results)
+    {
+        auto const seconds = chrono::duration<double>(result.elapsed).count();
+        auto const perIteration = chrono::duration<double, std::micro>(result.elapsed).count()
+                                  / static_cast<double>(std::max(result.iterations, uint64_t { 1 }));
+        if (result.bytes)
+            _output << fmt::format("{:>20}: {:>8.3f} s, {}/s\n",
+                                   result.name,
+                                   seconds,
+                                   crispy::humanReadableBytes(static_cast<long double>(result.bytes)
+                                                              / static_cast<long double>(seconds)));
+        else
+            _output << fmt::format("{:>20}: {:>8.3f} s, {:.1f} us per iteration ({} iterations)\n",
+                                   result.name,
+                                   seconds,
+                                   perIteration,
+                                   result.iterations);
+
+        if (result.bytesPerLine)
+            _output << fmt::format("{:>20}  {} bytes per line\n", "", *result.bytesPerLine);
+
+        if (result.counters)
+        {
+            auto const perIterationCount = [&](uint64_t _count) {
+                return static_cast<double>(_count)
+                       / static_cast<double>(std::max(result.iterations, uint64_t { 1 }));
+            };
+            _output << fmt::format("{:>20}  per iteration: {:.0f} instructions, {:.0f} cycles, "
+                                   "{:.0f} cache misses, {:.0f} branch misses\n",
+                                   "",
+                                   perIterationCount(result.counters->instructions),
+                                   perIterationCount(result.counters->cycles),
+                                   perIterationCount(result.counters->cacheMisses),
+                                   perIterationCount(result.counters->branchMisses));
+        }
+    }
+}
+
+void writeScreenBenchResultsJson(std::vector<ScreenBenchResult> const& _results, std::ostream& _output)
+{
+    // The names of the tests do not need any escaping.
+    _output << "{\n";
+    _output << fmt::format("  \"version\": \"{}\",\n", CONTOUR_VERSION_STRING);
+    _output << "  \"results\": [\n";
+    for (size_t i = 0; i < _results.size(); ++i)
+    {
+        auto const& result = _results[i];
+        auto const seconds = chrono::duration<double>(result.elapsed).count();
+        auto const counters =
+            result.counters ? fmt::format(", \"instructions\": {}, \"cycles\": {}, \"cacheMisses\": {}, "
+                                          "\"branchMisses\": {}",
+                                          result.counters->instructions,
+                                          result.counters->cycles,
+                                          result.counters->cacheMisses,
+                                          result.counters->branchMisses)
+                            : std::string {};
+        auto const memory = result.bytesPerLine
+                                ? fmt::format(", \"bytesPerLine\": {}", *result.bytesPerLine)
+                                : std::string {};
+        _output << fmt::format("    {{ \"name\": \"{}\", \"bytes\": {}, \"iterations\": {}, "
+                               "\"seconds\": {:.6f}, \"bytesPerSecond\": {:.0f}{}{} }}{}\n",
+                               result.name,
+                               result.bytes,
+                               result.iterations,
+                               seconds,
+                               seconds > 0 ? static_cast<double>(result.bytes) / seconds : 0.0,
+                               counters,
+                               memory,
+                               i + 1 < _results.size() ? "," : "");
+    }
+    _output << "  ]\n";
+    _output << "}\n";
+}
+
+} // namespace
+// }}}
+
+// {{{ worst-case latency benchmarks
+namespace
+{
+
+/// Number of bytes handed to the parser at once, as read from the PTY.
+constexpr size_t WorstCaseFragmentSize = 4096;
+
+struct WorstCaseResult
+{
+    std::string name;
+    uint64_t bytes = 0;     // VT stream bytes processed, or 0 for tests not measuring a stream
+    uint64_t steps = 0;     // number of fragments or operations processed
+    std::chrono::nanoseconds maxElapsed {};
+    std::chrono::nanoseconds totalElapsed {};
+    std::optional<size_t> peakMemory; // growth of the resident set size, if known
+};
+
+/// @returns the value of the given entry of /proc/self/status in bytes, if available (Linux only).
+std::optional<size_t> processMemoryStatus([[maybe_unused]] std::string_view _key)
+{
+#if defined(__linux__)
+    auto file = std::ifstream { "/proc/self/status" };
+    for (auto line = std::string {}; std::getline(file, line);)
+        if (line.size() > _key.size() && line.compare(0, _key.size(), _key) == 0 && line[_key.size()] == ':')
+            return static_cast<size_t>(std::stoull(line.substr(_key.size() + 1))) * 1024;
+#endif
+    return std::nullopt;
+}
+
+/// Resets the peak resident set size of this process to its current one, if supported (Linux only).
+void resetPeakMemory()
+{
+#if defined(__linux__)
+    auto file = std::ofstream { "/proc/self/clear_refs" };
+    file << "5";
+#endif
+}
+
+/// Measures the time each step of a test takes, and the memory the test takes at most.
+class WorstCaseRecorder
+{
+  public:
+    explicit WorstCaseRecorder(std::string _name): result_ { std::move(_name) }
+    {
+        resetPeakMemory();
+        initialMemory_ = processMemoryStatus("VmRSS");
+    }
+
+    template <typename Step>
+    void step(Step&& _step)
+    {
+        auto const startTime = chrono::steady_clock::now();
+        _step();
+        auto const elapsed = chrono::steady_clock::now() - startTime;
+        result_.maxElapsed =
+            std::max(result_.maxElapsed, chrono::duration_cast<chrono::nanoseconds>(elapsed));
+        result_.totalElapsed += elapsed;
+        ++result_.steps;
+    }
+
+    /// Processes @p _stream in fragments as read from the PTY, each being one step.
+    void feed(BenchTerminal& _vt, std::string_view _stream)
+    {
+        result_.bytes += _stream.size();
+        while (!_stream.empty())
+        {
+            auto const fragment = _stream.substr(0, WorstCaseFragmentSize);
+            _stream.remove_prefix(fragment.size());
+            step([&]() { _vt.terminal.writeToScreen(fragment); });
+        }
+    }
+
+    WorstCaseResult finish()
+    {
+        auto const peak = processMemoryStatus("VmHWM");
+        if (peak && initialMemory_)
+            result_.peakMemory = *peak - std::min(*peak, *initialMemory_);
+        return std::move(result_);
+    }
+
+  private:
+    WorstCaseResult result_;
+    std::optional<size_t> initialMemory_;
+};
+
+std::string repeat(std::string_view _text, size_t _count)
+{
+    auto result = std::string {};
+    result.reserve(_text.size() * _count);
+    for (size_t i = 0; i < _count; ++i)
+        result += _text;
+    return result;
+}
+
+std::vector<WorstCaseResult> runWorstCaseBenchmarks(std::string_view _filter, std::ostream& _progress)
+{
+    struct WorstCaseTest
+    {
+        std::string_view name;
+        std::function<void(BenchTerminal&, WorstCaseRecorder&)> run;
+    };
+
+    auto const tests = std::vector<WorstCaseTest> {
+        { "csi-many-parameters",
+          [](BenchTerminal& _vt, WorstCaseRecorder& _recorder) {
+              auto const sequence = "\033[" + repeat("1;", 10'000) + "31mA";
+              _recorder.feed(_vt, repeat(sequence, 100));
+          } },
+        { "csi-huge-parameter",
+          [](BenchTerminal& _vt, WorstCaseRecorder& _recorder) {
+              _recorder.feed(_vt, repeat("\033[" + std::string(10'000, '9') + "CA", 100));
+          } },
+        { "grapheme-cluster",
+          [](BenchTerminal& _vt, WorstCaseRecorder& _recorder) {
+              // Thousands of combining marks on a single base character.
+              _recorder.feed(_vt, repeat("e" + repeat("\u0301", 5'000) + "\r\n", 100));
+          } },
+        { "osc-unterminated",
+          [](BenchTerminal& _vt, WorstCaseRecorder& _recorder) {
+              _recorder.feed(_vt, "\033]2;" + std::string(16 << 20, 'A'));
+              _recorder.feed(_vt, "\033\\done\r\n");
+          } },
+        { "dcs-unterminated",
+          [](BenchTerminal& _vt, WorstCaseRecorder& _recorder) {
+              _recorder.feed(_vt, "\033P1$r" + std::string(16 << 20, 'A'));
+              _recorder.feed(_vt, "\033\\done\r\n");
+          } },
+        { "decsc-decrc-nested",
+          [](BenchTerminal& _vt, WorstCaseRecorder& _recorder) {
+              auto const nested = repeat("\0337\033[5;5H\033[1;33m", 10'000) + repeat("\0338X", 10'000);
+              _recorder.feed(_vt, repeat(nested, 10));
+          } },
+        { "alt-screen-toggle",
+          [](BenchTerminal& _vt, WorstCaseRecorder& _recorder) {
+              _recorder.feed(_vt, repeat("\033[?1049hfull screen app\033[?1049lshell\r\n", 100'000));
+          } },
+        { "sixel-huge-raster",
+          [](BenchTerminal& _vt, WorstCaseRecorder& _recorder) {
+              // Announces an image far beyond the maximum image size, but only paints a few sixels of it.
+              auto const image = "\033Pq\"1;1;100000;100000#0;2;100;0;0#0!100000~-!100000~\033\\"sv;
+              _recorder.feed(_vt, repeat(image, 10));
+          } },
+        { "resize-image",
+          [](BenchTerminal& _vt, WorstCaseRecorder& _recorder) {
+              _vt.terminal.writeToScreen("\033[H" + sixelImage(640, 480));
+              auto columns = BenchPageSize.columns;
+              for (int i = 0; i < 100; ++i)
+              {
+                  columns =
+                      columns == BenchPageSize.columns ? terminal::ColumnCount(37) : BenchPageSize.columns;
+                  _recorder.step([&]() {
+                      _vt.terminal.resizeScreen(terminal::PageSize { BenchPageSize.lines, columns });
+                  });
+              }
+          } },
+    };
+
+    auto results = std::vector<WorstCaseResult> {};
+    for (auto const& test: tests)
+    {
+        if (!_filter.empty() && test.name.find(_filter) == std::string_view::npos)
+            continue;
+        _progress << fmt::format("Running test {} ...\n", test.name);
+
+        auto vt = BenchTerminal { BenchPageSize, terminal::LineCount(4000), 1'000'000 };
+        vt.terminal.setMode(terminal::DECMode::AutoWrap, true);
+        auto recorder = WorstCaseRecorder { std::string(test.name) };
+        test.run(vt, recorder);
+        results.emplace_back(recorder.finish());
+    }
+    return results;
+}
+
+void printWorstCaseResults(std::vector<WorstCaseResult> const& _results, std::ostream& _output)
+{
+    for (auto const& result: _results)
+    {
+        auto const average = chrono::duration<double, std::micro>(result.totalElapsed).count()
+                             / static_cast<double>(std::max(result.steps, uint64_t { 1 }));
+        _output << fmt::format("{:>20}: {:>10.1f} us max, {:>8.1f} us average ({} steps), peak memory: {}\n",
+                               result.name,
+                               chrono::duration<double, std::micro>(result.maxElapsed).count(),
+                               average,
+                               result.steps,
+                               result.peakMemory
+                                   ? crispy::humanReadableBytes(static_cast<long double>(*result.peakMemory))
+                                   : "n/a"s);
+    }
+}
+
+void writeWorstCaseResultsJson(std::vector<WorstCaseResult> const& _results, std::ostream& _output)
+{
+    // The names of the tests do not need any escaping.
+    _output << "{\n";
+    _output << fmt::format("  \"version\": \"{}\",\n", CONTOUR_VERSION_STRING);
+    _output << "  \"results\": [\n";
+    for (size_t i = 0; i < _results.size(); ++i)
+    {
+        auto const& result = _results[i];
+        auto const memory = result.peakMemory ? fmt::format(", \"peakMemory\": {}", *result.peakMemory)
+                                              : std::string {};
+        _output << fmt::format("    {{ \"name\": \"{}\", \"bytes\": {}, \"steps\": {}, "
+                               "\"maxSeconds\": {:.6f}, \"totalSeconds\": {:.6f}{} }}{}\n",
+                               result.name,
+                               result.bytes,
+                               result.steps,
+                               chrono::duration<double>(result.maxElapsed).count(),
+                               chrono::duration<double>(result.totalElapsed).count(),
+                               memory,
+                               i + 1 < _results.size() ? "," : "");
+    }
+    _output << "  ]\n";
+    _output << "}\n";
+}
+
+} // namespace
+// }}}
+
 namespace CLI = crispy::cli;
 
 class ContourHeadlessBench: public crispy::App
@@ -129,6 +747,8 @@ class ContourHeadlessBench: public crispy::App
         link("bench-headless.parser", bind(&ContourHeadlessBench::benchParserOnly, this));
         link("bench-headless.grid", bind(&ContourHeadlessBench::benchGrid, this));
         link("bench-headless.pty", bind(&ContourHeadlessBench::benchPTY, this));
+        link("bench-headless.screen", bind(&ContourHeadlessBench::benchScreen, this));
+        link("bench-headless.worst-case", bind(&ContourHeadlessBench::benchWorstCase, this));
         link("bench-headless.meta", bind(&ContourHeadlessBench::showMetaInfo, this));
 
         char const* logFilterString = getenv("LOG");
@@ -168,6 +788,47 @@ class ContourHeadlessBench: public crispy::App
                 CLI::Command {
                     "pty",
                     "Performs performance tests utilizing the underlying operating system's PTY only." },
+                CLI::Command {
+                    "screen",
+                    "Performs performance tests of screen operations, such as scrolling regions, inserting "
+                    "and deleting, complex and wide text, hyperlinks, Sixel images, reflow, search, and "
+                    "building render buffers, as well as the throughput and memory use of each cell layout.",
+                    CLI::OptionList {
+                        CLI::Option { "size",
+                                      CLI::Value { 8u },
+                                      "Number of megabyte to process per stream test.",
+                                      "MB" },
+                        CLI::Option { "filter",
+                                      CLI::Value { ""s },
+                                      "Only runs the tests whose name contains the given text.",
+                                      "TEXT" },
+                        CLI::Option { "json",
+                                      CLI::Value { ""s },
+                                      "Also writes the results in JSON format to the given file. If - (dash) "
+                                      "is given, only the JSON results are written to standard output.",
+                                      "FILE" },
+                        CLI::Option { "perf-counters",
+                                      CLI::Value { false },
+                                      "Also counts instructions, cycles, cache misses, and branch misses of "
+                                      "each test via hardware performance counters (Linux only)." },
+                    } },
+                CLI::Command {
+                    "worst-case",
+                    "Performs latency tests on adversarial input, such as CSI sequences with thousands of "
+                    "parameters, huge grapheme clusters, unterminated OSC strings, nested DECSC/DECRC, "
+                    "alternate screen toggling, and Sixel images, reporting the maximum time taken per "
+                    "parsed fragment and the peak memory (Linux only) of each test.",
+                    CLI::OptionList {
+                        CLI::Option { "filter",
+                                      CLI::Value { ""s },
+                                      "Only runs the tests whose name contains the given text.",
+                                      "TEXT" },
+                        CLI::Option { "json",
+                                      CLI::Value { ""s },
+                                      "Also writes the results in JSON format to the given file. If - (dash) "
+                                      "is given, only the JSON results are written to standard output.",
+                                      "FILE" },
+                    } },
             }
         };
     }
@@ -243,6 +904,7 @@ class ContourHeadlessBench: public crispy::App
         std::string const text = createText(PtyWriteSize);
         unique_ptr<Pty> ptyObject = createPty(PageSize { LineCount(25), ColumnCount(80) }, std::nullopt);
         auto& pty = *ptyObject;
+        pty.start();
         auto& ptySlave = pty.slave();
         (void) ptySlave.configure();
 
@@ -306,6 +968,85 @@ class ContourHeadlessBench: public crispy::App
         return EXIT_SUCCESS;
     }
 
+    int benchScreen()
+    {
+        auto const totalBytes = uint64_t { parameters().uint("bench-headless.screen.size") } << 20;
+        auto const& filter = parameters().str("bench-headless.screen.filter");
+        auto const& jsonFileName = parameters().str("bench-headless.screen.json");
+
+        auto perfCounters = std::optional<crispy::PerfCounters> {};
+        if (parameters().boolean("bench-headless.screen.perf-counters"))
+        {
+            perfCounters.emplace();
+            if (!perfCounters->available())
+            {
+                cerr << "Hardware performance counters are not available. "
+                        "Check /proc/sys/kernel/perf_event_paranoid.\n";
+                return EXIT_FAILURE;
+            }
+        }
+        auto* const counters = perfCounters ? &*perfCounters : nullptr;
+
+        if (jsonFileName == "-")
+        {
+            auto progress = std::ostringstream {};
+            writeScreenBenchResultsJson(runScreenBenchmarks(totalBytes, filter, counters, progress), cout);
+            return EXIT_SUCCESS;
+        }
+
+        auto const titleText = fmt::format("Running screen benchmark (stream size: {} MB)", totalBytes >> 20);
+        cout << titleText << '\n' << string(titleText.size(), '=') << '\n';
+
+        auto const results = runScreenBenchmarks(totalBytes, filter, counters, cout);
+
+        cout << '\n';
+        cout << "Results\n";
+        cout << "-------\n";
+        printScreenBenchResults(results, cout);
+        cout << '\n';
+
+        if (!jsonFileName.empty())
+        {
+            auto output = std::ofstream { jsonFileName, std::ios::trunc };
+            writeScreenBenchResultsJson(results, output);
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    int benchWorstCase()
+    {
+        auto const& filter = parameters().str("bench-headless.worst-case.filter");
+        auto const& jsonFileName = parameters().str("bench-headless.worst-case.json");
+
+        if (jsonFileName == "-")
+        {
+            auto progress = std::ostringstream {};
+            writeWorstCaseResultsJson(runWorstCaseBenchmarks(filter, progress), cout);
+            return EXIT_SUCCESS;
+        }
+
+        auto const titleText = fmt::format("Running worst-case latency benchmark (fragment size: {} bytes)",
+                                           WorstCaseFragmentSize);
+        cout << titleText << '\n' << string(titleText.size(), '=') << '\n';
+
+        auto const results = runWorstCaseBenchmarks(filter, cout);
+
+        cout << '\n';
+        cout << "Results\n";
+        cout << "-------\n";
+        printWorstCaseResults(results, cout);
+        cout << '\n';
+
+        if (!jsonFileName.empty())
+        {
+            auto output = std::ofstream { jsonFileName, std::ios::trunc };
+            writeWorstCaseResultsJson(results, output);
+        }
+
+        return EXIT_SUCCESS;
+    }
+
     int benchParserOnly()
     {
         auto po = terminal::NullParserEvents {};
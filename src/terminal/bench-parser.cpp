@@ -0,0 +1,128 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Microbenchmark of the VT parser, measuring the state machine separately from the bulk text path.
+//
+// Usage: bench-parser [MEGABYTES]
+
+#include <terminal/Parser.h>
+#include <terminal/ParserEvents.h>
+
+#include <crispy/utils.h>
+
+#include <fmt/format.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+
+struct Workload
+{
+    string_view name;
+    string_view description;
+    string (*generate)(size_t);
+};
+
+string repeatUntil(size_t _size, function<void(string&, unsigned)> const& _append)
+{
+    auto text = string {};
+    for (unsigned i = 0; text.size() < _size; ++i)
+        _append(text, i);
+    return text;
+}
+
+/// Plain ASCII lines, which are consumed by the bulk text path.
+string bulkText(size_t _size)
+{
+    return repeatUntil(_size, [](string& text, unsigned i) {
+        for (unsigned k = 0; k < 79; ++k)
+            text += static_cast<char>('A' + (i + k) % 26);
+        text += '\n';
+    });
+}
+
+/// Control sequences only, such that every byte goes through the state machine.
+string controlSequences(size_t _size)
+{
+    return repeatUntil(_size, [](string& text, unsigned i) {
+        text += fmt::format("\033[{};{}H", 1 + i % 25, 1 + i % 80); // CUP
+        text += fmt::format("\033[38:2::{}:{}:{}m", i % 256, (i / 3) % 256, (i / 7) % 256);
+        text += "\033[K\033[?25l\033[?2026h\0337\0338\033[2;3r";
+        text += fmt::format("\033]2;title {}\033\\", i); // OSC
+    });
+}
+
+/// Colored text, alternating between both paths.
+string mixed(size_t _size)
+{
+    return repeatUntil(_size, [](string& text, unsigned i) {
+        text += fmt::format("\033[{}m", 31 + i % 7);
+        text += "Hello, World";
+        text += "\033[m; ";
+        if (i % 6 == 5)
+            text += '\n';
+    });
+}
+
+void run(Workload const& _workload, size_t _size)
+{
+    auto const input = _workload.generate(_size);
+    auto events = terminal::NullParserEvents {};
+    auto parser = terminal::parser::Parser<terminal::ParserEvents> { events };
+
+    // Warm up caches and branch predictors.
+    parser.parseFragment(string_view(input).substr(0, input.size() / 16));
+
+    auto constexpr Rounds = 4;
+    auto const startTime = chrono::steady_clock::now();
+    for (int round = 0; round < Rounds; ++round)
+        parser.parseFragment(input);
+    auto const elapsed = chrono::duration<double>(chrono::steady_clock::now() - startTime);
+
+    auto const bytes = static_cast<double>(input.size()) * Rounds;
+    fmt::print("{:<18} {:>10.3f} s {:>12}/s {:>8.2f} ns/byte  ({})\n",
+               _workload.name,
+               elapsed.count(),
+               crispy::humanReadableBytes(static_cast<long double>(bytes / elapsed.count())),
+               elapsed.count() * 1e9 / bytes,
+               _workload.description);
+}
+
+} // namespace
+
+int main(int argc, char const* argv[])
+{
+    auto const megabytes = argc > 1 ? strtoul(argv[1], nullptr, 10) : 64ul;
+    auto const size = static_cast<size_t>(megabytes) * 1024 * 1024;
+
+    auto const workloads = vector<Workload> {
+        { "bulk-text", "printable ASCII lines", &bulkText },
+        { "state-machine", "CSI, ESC and OSC sequences", &controlSequences },
+        { "mixed", "SGR colored text", &mixed },
+    };
+
+    fmt::print("Parsing {} MB per round.\n\n", megabytes);
+    for (auto const& workload: workloads)
+        run(workload, size);
+
+    return EXIT_SUCCESS;
+}
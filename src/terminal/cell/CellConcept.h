@@ -29,7 +29,6 @@
 #include <terminal/ColorPalette.h>
 #include <terminal/GraphicsAttributes.h>
 #include <terminal/Hyperlink.h>
-#include <terminal/Image.h>
 #include <terminal/primitives.h>
 
 namespace terminal
@@ -94,11 +93,16 @@ concept CellConcept = requires(T t, T const& u)
     t.setUnderlineColor(Color{});
     { u.underlineColor() } noexcept -> std::same_as<Color>;
 
-    { u.imageFragment() } -> std::same_as<std::shared_ptr<ImageFragment>>;
-    t.setImageFragment(std::shared_ptr<RasterizedImage>{}, CellLocation{} /*offset*/);
+    { u.hasImage() } noexcept -> std::same_as<bool>;
+    t.setImage(bool{});
 
     { u.hyperlink() } -> std::same_as<HyperlinkId>;
     t.setHyperlink(HyperlinkId{});
+
+    T::resetRange(&t, &t, GraphicsAttributes{}, char32_t{});
+    T::insertRange(&t, &t, size_t{}, GraphicsAttributes{}, char32_t{});
+    T::deleteRange(&t, &t, size_t{}, GraphicsAttributes{}, char32_t{});
+    T::moveRange(&t, &t, &t);
 };
 
 
@@ -19,11 +19,23 @@
 namespace terminal
 {
 
+// CompactCell keeps everything but the first codepoint and the colors out of line, which makes plain
+// text lines (such as tailed logs) small. SimpleCell stores all of it inline, which is larger, but
+// faster to write styled text into (such as drawn by TUI applications).
+// See the cells-compact and cells-simple tests of `bench-headless screen` for the numbers.
+#if defined(LIBTERMINAL_SIMPLE_SCREEN_CELL)
+/// Type of cell to be used with the primary screen.
+using PrimaryScreenCell = SimpleCell;
+
+/// Type of cell to be used with the alternate screen.
+using AlternateScreenCell = SimpleCell;
+#else
 /// Type of cell to be used with the primary screen.
 using PrimaryScreenCell = CompactCell;
 
 /// Type of cell to be used with the alternate screen.
 using AlternateScreenCell = CompactCell;
+#endif
 
 /// The Cell to be used with the indicator (and host writable) status line.
 using StatusDisplayCell = SimpleCell;
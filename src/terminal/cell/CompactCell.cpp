@@ -16,6 +16,32 @@
 namespace terminal
 {
 
+namespace
+{
+    crispy::SlabPool<CellExtra>& cellExtraPool() noexcept
+    {
+        // Intentionally never destroyed, as cells in static storage may outlive it.
+        static auto* pool = new crispy::SlabPool<CellExtra>();
+        return *pool;
+    }
+} // namespace
+
+void* CellExtra::operator new(std::size_t size)
+{
+    Require(size == sizeof(CellExtra));
+    return cellExtraPool().allocate();
+}
+
+void CellExtra::operator delete(void* p) noexcept
+{
+    cellExtraPool().deallocate(p);
+}
+
+crispy::SlabPoolStats CellExtra::allocationStats()
+{
+    return cellExtraPool().stats();
+}
+
 std::u32string CompactCell::codepoints() const
 {
     std::u32string s;
@@ -24,7 +50,7 @@ std::u32string CompactCell::codepoints() const
         s += codepoint_;
         if (extra_)
         {
-            for (char32_t const cp: extra_->codepoints)
+            for (char32_t const cp: extra_->cluster.codepoints())
             {
                 s += cp;
             }
@@ -41,7 +67,7 @@ std::string CompactCell::toUtf8() const
     std::string text;
     text += unicode::convert_to<char>(codepoint_);
     if (extra_)
-        for (char32_t const cp: extra_->codepoints)
+        for (char32_t const cp: extra_->cluster.codepoints())
             text += unicode::convert_to<char>(cp);
     return text;
 }
@@ -16,12 +16,13 @@
 #include <terminal/CellFlags.h>
 #include <terminal/CellUtil.h>
 #include <terminal/ColorPalette.h>
+#include <terminal/GraphemeClusterTable.h>
 #include <terminal/GraphicsAttributes.h>
 #include <terminal/Hyperlink.h>
-#include <terminal/Image.h>
 #include <terminal/primitives.h>
 
 #include <crispy/Owned.h>
+#include <crispy/SlabPool.h>
 #include <crispy/defines.h>
 #include <crispy/times.h>
 
@@ -29,6 +30,9 @@
 #include <unicode/convert.h>
 #include <unicode/width.h>
 
+#include <algorithm>
+#include <cstring>
+#include <iterator>
 #include <memory>
 #include <string>
 
@@ -50,8 +54,8 @@ struct CellExtra
     /// character in this terminal cell.
     ///
     /// Since MOST content in the terminal is US-ASCII, all codepoints except the first one of a grapheme
-    /// cluster is stored in CellExtra.
-    std::u32string codepoints = {};
+    /// cluster is stored in CellExtra, interned so that cells holding the same ones share them.
+    GraphemeCluster cluster = {};
 
     /// Color for underline decoration (such as curly underline).
     Color underlineColor = DefaultColor();
@@ -59,9 +63,6 @@ struct CellExtra
     /// With OSC-8 a hyperlink can be associated with a range of terminal cells.
     HyperlinkId hyperlink = {};
 
-    /// Holds a reference to an image tile to be rendered (above the text, if any).
-    std::shared_ptr<ImageFragment> imageFragment = nullptr;
-
     /// Cell flags.
     CellFlags flags = CellFlags::None;
 
@@ -70,16 +71,28 @@ struct CellExtra
     /// Since most graphical characters in a terminal will be US-ASCII, this width property
     /// will be only used when NOT being 1.
     uint8_t width = 1;
+
+    /// CellExtra objects are created and destroyed at a high rate (e.g. for every cell that
+    /// carries a hyperlink), so their storage is served from a slab pool that is recycled
+    /// as cells get reset, instead of one heap allocation each.
+    static void* operator new(std::size_t size);
+    static void operator delete(void* p) noexcept;
+
+    /// Returns allocation statistics of the CellExtra storage pool.
+    static crispy::SlabPoolStats allocationStats();
 };
 
 /// Grid cell with character and graphics rendition information.
 ///
-/// TODO(perf): ensure POD'ness so that we can SIMD-copy it.
-/// - Requires moving out CellExtra into Line<T>?
+/// Apart from plain data, a CompactCell only holds an owning pointer to its out-of-line CellExtra,
+/// which makes it trivially relocatable. The range operations below make use of that to clear
+/// and shift cells with plain stores and memmove rather than going through each cell's
+/// constructor and assignment operators.
 class CRISPY_PACKED CompactCell
 {
   public:
     static uint8_t constexpr MaxCodepoints = 7;
+    static_assert(MaxCodepoints - 1 <= GraphemeCluster::MaxLength);
 
     CompactCell() noexcept;
     CompactCell(CompactCell const& v) noexcept;
@@ -128,8 +141,9 @@ class CRISPY_PACKED CompactCell
     [[nodiscard]] Color backgroundColor() const noexcept;
     void setBackgroundColor(Color color) noexcept;
 
-    [[nodiscard]] std::shared_ptr<ImageFragment> imageFragment() const noexcept;
-    void setImageFragment(std::shared_ptr<RasterizedImage> rasterizedImage, CellLocation offset);
+    /// Tests whether this cell displays the image placed onto its line (see Line::imagePlacements()).
+    [[nodiscard]] bool hasImage() const noexcept { return isFlagEnabled(CellFlags::Image); }
+    void setImage(bool _enable) noexcept;
 
     void setCharacter(char32_t _codepoint) noexcept;
     [[nodiscard]] int appendCharacter(char32_t _codepoint) noexcept;
@@ -142,6 +156,33 @@ class CRISPY_PACKED CompactCell
 
     void setGraphicsRendition(GraphicsRendition sgr) noexcept;
 
+    /// Resets all cells in [first, last) with the given attributes and (optional) codepoint.
+    static void resetRange(CompactCell* first,
+                           CompactCell* last,
+                           GraphicsAttributes const& _attributes,
+                           char32_t _codepoint = 0) noexcept;
+
+    /// Shifts the cells in [first, last) by @p n cells to the right, dropping those shifted past @p last,
+    /// and fills the gap at @p first with cells reset with the given attributes and codepoint.
+    static void insertRange(CompactCell* first,
+                            CompactCell* last,
+                            size_t n,
+                            GraphicsAttributes const& _attributes,
+                            char32_t _codepoint = 0) noexcept;
+
+    /// Deletes @p n cells at @p first, shifting the cells up to @p last to the left,
+    /// and fills the gap at @p last with cells reset with the given attributes and codepoint.
+    static void deleteRange(CompactCell* first,
+                            CompactCell* last,
+                            size_t n,
+                            GraphicsAttributes const& _attributes,
+                            char32_t _codepoint = 0) noexcept;
+
+    /// Moves the cells in [first, last) to @p target, which must not overlap with them.
+    ///
+    /// The source cells are left valid but with unspecified contents.
+    static void moveRange(CompactCell* first, CompactCell* last, CompactCell* target) noexcept;
+
   private:
     [[nodiscard]] CellExtra& extra() noexcept;
 
@@ -153,7 +194,6 @@ class CRISPY_PACKED CompactCell
     Color foregroundColor_ = DefaultColor();
     Color backgroundColor_ = DefaultColor();
     crispy::Owned<CellExtra> extra_ = {};
-    // TODO(perf) ^^ use CellExtraId = boxed<int24_t> into pre-alloc'ed vector<CellExtra>.
 };
 
 // {{{ impl: ctor's
@@ -204,6 +244,8 @@ inline CompactCell& CompactCell::operator=(CompactCell const& v) noexcept
     backgroundColor_ = v.backgroundColor_;
     if (v.extra_)
         createExtra(*v.extra_);
+    else
+        extra_.reset();
     return *this;
 }
 // }}}
@@ -234,10 +276,7 @@ inline void CompactCell::write(GraphicsAttributes const& _attributes, char32_t _
 
     codepoint_ = _ch;
     if (extra_)
-    {
-        extra_->codepoints.clear();
-        extra_->imageFragment = {};
-    }
+        extra_->cluster = {};
 
     foregroundColor_ = _attributes.foregroundColor;
     backgroundColor_ = _attributes.backgroundColor;
@@ -254,12 +293,8 @@ inline void CompactCell::write(GraphicsAttributes const& _attributes,
                                uint8_t _width,
                                HyperlinkId _hyperlink) noexcept
 {
+    // Writing text into a cell destroys its image (at least for Sixels), as its flags are replaced below.
     writeTextOnly(_ch, _width);
-    if (extra_)
-    {
-        // Writing text into a cell destroys the image fragment (as least for Sixels).
-        extra_->imageFragment = {};
-    }
 
     foregroundColor_ = _attributes.foregroundColor;
     backgroundColor_ = _attributes.backgroundColor;
@@ -279,7 +314,7 @@ inline void CompactCell::writeTextOnly(char32_t _ch, uint8_t _width) noexcept
     setWidth(_width);
     codepoint_ = _ch;
     if (extra_)
-        extra_->codepoints.clear();
+        extra_->cluster = {};
 }
 
 inline void CompactCell::reset(GraphicsAttributes const& _attributes, HyperlinkId _hyperlink) noexcept
@@ -297,6 +332,95 @@ inline void CompactCell::reset(GraphicsAttributes const& _attributes, HyperlinkI
         extra().hyperlink = _hyperlink;
 }
 // }}}
+// {{{ impl: range operations
+inline void CompactCell::resetRange(CompactCell* first,
+                                    CompactCell* last,
+                                    GraphicsAttributes const& _attributes,
+                                    char32_t _codepoint) noexcept
+{
+    if (_attributes.flags != CellFlags::None || _attributes.underlineColor != DefaultColor())
+    {
+        // Every cell needs its own CellExtra to carry the attributes.
+        for (auto* i = first; i != last; ++i)
+        {
+            i->reset(_attributes);
+            if (_codepoint)
+                i->writeTextOnly(_codepoint, 1);
+        }
+        return;
+    }
+
+    for (auto* i = first; i != last; ++i)
+        if (i->extra_)
+            i->extra_.reset();
+
+    // Branch-free plain stores that the compiler can turn into vector stores.
+    for (auto* i = first; i != last; ++i)
+    {
+        i->codepoint_ = _codepoint;
+        i->foregroundColor_ = _attributes.foregroundColor;
+        i->backgroundColor_ = _attributes.backgroundColor;
+    }
+}
+
+inline void CompactCell::insertRange(CompactCell* first,
+                                     CompactCell* last,
+                                     size_t n,
+                                     GraphicsAttributes const& _attributes,
+                                     char32_t _codepoint) noexcept
+{
+    n = std::min(n, static_cast<size_t>(std::distance(first, last)));
+
+    for (auto* i = last - n; i != last; ++i)
+        i->extra_.reset();
+
+    std::memmove(static_cast<void*>(first + n),
+                 static_cast<void const*>(first),
+                 static_cast<size_t>(std::distance(first, last - n)) * sizeof(CompactCell));
+
+    // The gap now holds bitwise copies of cells that got relocated, so it must not release their extras.
+    for (auto* i = first; i != first + n; ++i)
+        (void) i->extra_.release();
+
+    resetRange(first, first + n, _attributes, _codepoint);
+}
+
+inline void CompactCell::deleteRange(CompactCell* first,
+                                     CompactCell* last,
+                                     size_t n,
+                                     GraphicsAttributes const& _attributes,
+                                     char32_t _codepoint) noexcept
+{
+    n = std::min(n, static_cast<size_t>(std::distance(first, last)));
+
+    for (auto* i = first; i != first + n; ++i)
+        i->extra_.reset();
+
+    std::memmove(static_cast<void*>(first),
+                 static_cast<void const*>(first + n),
+                 static_cast<size_t>(std::distance(first + n, last)) * sizeof(CompactCell));
+
+    // The gap now holds bitwise copies of cells that got relocated, so it must not release their extras.
+    for (auto* i = last - n; i != last; ++i)
+        (void) i->extra_.release();
+
+    resetRange(last - n, last, _attributes, _codepoint);
+}
+
+inline void CompactCell::moveRange(CompactCell* first, CompactCell* last, CompactCell* target) noexcept
+{
+    auto const count = static_cast<size_t>(std::distance(first, last));
+
+    for (auto* i = target; i != target + count; ++i)
+        i->extra_.reset();
+
+    std::memcpy(static_cast<void*>(target), static_cast<void const*>(first), count * sizeof(CompactCell));
+
+    // The source cells are bitwise copies of the relocated ones now, so they must not release their extras.
+    for (auto* i = first; i != last; ++i)
+        (void) i->extra_.release();
+}
+// }}}
 // {{{ impl: character
 inline constexpr uint8_t CompactCell::width() const noexcept
 {
@@ -318,8 +442,8 @@ inline void CompactCell::setCharacter(char32_t _codepoint) noexcept
     codepoint_ = _codepoint;
     if (extra_)
     {
-        extra_->codepoints.clear();
-        extra_->imageFragment = {};
+        extra_->cluster = {};
+        extra_->flags &= ~CellFlags::Image;
     }
     if (_codepoint)
         setWidth(static_cast<uint8_t>(std::max(unicode::width(_codepoint), 1)));
@@ -332,9 +456,8 @@ inline int CompactCell::appendCharacter(char32_t _codepoint) noexcept
     assert(_codepoint != 0);
 
     CellExtra& ext = extra();
-    if (ext.codepoints.size() < MaxCodepoints - 1)
+    if (ext.cluster.size() < MaxCodepoints - 1 && ext.cluster.append(_codepoint))
     {
-        ext.codepoints.push_back(_codepoint);
         if (auto const diff = CellUtil::computeWidthChange(*this, _codepoint))
         {
             setWidth(static_cast<uint8_t>(static_cast<int>(width()) + diff));
@@ -351,7 +474,7 @@ inline std::size_t CompactCell::codepointCount() const noexcept
         if (!extra_)
             return 1;
 
-        return 1 + extra_->codepoints.size();
+        return 1 + extra_->cluster.size();
     }
     return 0;
 }
@@ -365,9 +488,9 @@ inline char32_t CompactCell::codepoint(size_t i) const noexcept
         return 0;
 
 #if !defined(NDEBUG)
-    return extra_->codepoints.at(i - 1);
+    return extra_->cluster.codepoints().at(i - 1);
 #else
-    return extra_->codepoints[i - 1];
+    return extra_->cluster[i - 1];
 #endif
 }
 // }}}
@@ -424,19 +547,12 @@ inline void CompactCell::setUnderlineColor(Color color) noexcept
         extra().underlineColor = color;
 }
 
-inline std::shared_ptr<ImageFragment> CompactCell::imageFragment() const noexcept
-{
-    if (extra_)
-        return extra_->imageFragment;
-    else
-        return {};
-}
-
-inline void CompactCell::setImageFragment(std::shared_ptr<RasterizedImage> rasterizedImage,
-                                          CellLocation offset)
+inline void CompactCell::setImage(bool _enable) noexcept
 {
-    CellExtra& ext = extra();
-    ext.imageFragment = std::make_shared<ImageFragment>(rasterizedImage, offset);
+    if (_enable)
+        extra().flags |= CellFlags::Image;
+    else if (extra_)
+        extra_->flags &= ~CellFlags::Image;
 }
 
 inline HyperlinkId CompactCell::hyperlink() const noexcept
@@ -19,11 +19,12 @@
 #include <terminal/ColorPalette.h>
 #include <terminal/GraphicsAttributes.h>
 #include <terminal/Hyperlink.h>
-#include <terminal/Image.h>
 
 #include <unicode/convert.h>
 #include <unicode/width.h>
 
+#include <algorithm>
+#include <iterator>
 #include <string>
 #include <utility>
 
@@ -77,21 +78,39 @@ class SimpleCell
     [[nodiscard]] Color backgroundColor() const noexcept;
     [[nodiscard]] Color underlineColor() const noexcept;
 
-    [[nodiscard]] std::shared_ptr<ImageFragment> imageFragment() const noexcept;
-    void setImageFragment(std::shared_ptr<RasterizedImage> image, CellLocation offset);
+    [[nodiscard]] bool hasImage() const noexcept { return isFlagEnabled(CellFlags::Image); }
+    void setImage(bool enable) noexcept;
 
     [[nodiscard]] HyperlinkId hyperlink() const noexcept;
     void setHyperlink(HyperlinkId hyperlink) noexcept;
 
     [[nodiscard]] bool empty() const noexcept { return CellUtil::empty(*this); }
 
+    static void resetRange(SimpleCell* first,
+                           SimpleCell* last,
+                           GraphicsAttributes const& sgr,
+                           char32_t codepoint = 0) noexcept;
+
+    static void insertRange(SimpleCell* first,
+                            SimpleCell* last,
+                            size_t n,
+                            GraphicsAttributes const& sgr,
+                            char32_t codepoint = 0) noexcept;
+
+    static void deleteRange(SimpleCell* first,
+                            SimpleCell* last,
+                            size_t n,
+                            GraphicsAttributes const& sgr,
+                            char32_t codepoint = 0) noexcept;
+
+    static void moveRange(SimpleCell* first, SimpleCell* last, SimpleCell* target) noexcept;
+
   private:
     std::u32string _codepoints {};
     GraphicsAttributes _graphicsAttributes {};
     CellFlags _flags {};
     uint8_t _width = 1;
     HyperlinkId _hyperlink {};
-    std::shared_ptr<ImageFragment> _imageFragment {};
 };
 
 // {{{ implementation
@@ -167,7 +186,7 @@ inline size_t SimpleCell::codepointCount() const noexcept
 inline void SimpleCell::setCharacter(char32_t codepoint)
 {
     _codepoints.clear();
-    _imageFragment = {};
+    _flags &= ~CellFlags::Image;
     if (codepoint)
     {
         _codepoints.push_back(codepoint);
@@ -253,15 +272,12 @@ inline Color SimpleCell::underlineColor() const noexcept
     return _graphicsAttributes.underlineColor;
 }
 
-inline std::shared_ptr<ImageFragment> SimpleCell::imageFragment() const noexcept
+inline void SimpleCell::setImage(bool enable) noexcept
 {
-    return _imageFragment;
-}
-
-inline void SimpleCell::setImageFragment(std::shared_ptr<RasterizedImage> rasterizedImage,
-                                         CellLocation offset)
-{
-    _imageFragment = std::make_shared<ImageFragment>(rasterizedImage, offset);
+    if (enable)
+        _flags |= CellFlags::Image;
+    else
+        _flags &= ~CellFlags::Image;
 }
 
 inline HyperlinkId SimpleCell::hyperlink() const noexcept
@@ -274,6 +290,46 @@ inline void SimpleCell::setHyperlink(HyperlinkId hyperlink) noexcept
     _hyperlink = hyperlink;
 }
 
+inline void SimpleCell::resetRange(SimpleCell* first,
+                                   SimpleCell* last,
+                                   GraphicsAttributes const& sgr,
+                                   char32_t codepoint) noexcept
+{
+    for (auto* i = first; i != last; ++i)
+    {
+        i->reset(sgr);
+        if (codepoint)
+            i->writeTextOnly(codepoint, 1);
+    }
+}
+
+inline void SimpleCell::insertRange(SimpleCell* first,
+                                    SimpleCell* last,
+                                    size_t n,
+                                    GraphicsAttributes const& sgr,
+                                    char32_t codepoint) noexcept
+{
+    n = std::min(n, static_cast<size_t>(std::distance(first, last)));
+    std::move_backward(first, last - n, last);
+    resetRange(first, first + n, sgr, codepoint);
+}
+
+inline void SimpleCell::deleteRange(SimpleCell* first,
+                                    SimpleCell* last,
+                                    size_t n,
+                                    GraphicsAttributes const& sgr,
+                                    char32_t codepoint) noexcept
+{
+    n = std::min(n, static_cast<size_t>(std::distance(first, last)));
+    std::move(first + n, last, first);
+    resetRange(last - n, last, sgr, codepoint);
+}
+
+inline void SimpleCell::moveRange(SimpleCell* first, SimpleCell* last, SimpleCell* target) noexcept
+{
+    std::move(first, last, target);
+}
+
 // }}}
 
 // {{{ Optimized version for helpers from CellUtil
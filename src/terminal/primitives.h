@@ -863,6 +863,30 @@ constexpr bool isValidDECMode(unsigned int _mode) noexcept
     return false;
 }
 
+/// Maps the given DEC mode to a dense index in [0, DECModeCount), for use in flat tables.
+///
+/// The modes up to UsePrivateColorRegisters are numbered consecutively already,
+/// and the remaining ones, numbered after their sparse VT mode numbers, are appended.
+constexpr size_t toDECModeIndex(DECMode m) noexcept
+{
+    constexpr auto ConsecutiveModes = static_cast<size_t>(DECMode::UsePrivateColorRegisters) + 1;
+    switch (m)
+    {
+        case DECMode::MouseExtended: return ConsecutiveModes + 0;
+        case DECMode::MouseSGR: return ConsecutiveModes + 1;
+        case DECMode::MouseURXVT: return ConsecutiveModes + 2;
+        case DECMode::MouseSGRPixels: return ConsecutiveModes + 3;
+        case DECMode::MouseAlternateScroll: return ConsecutiveModes + 4;
+        case DECMode::BatchedRendering: return ConsecutiveModes + 5;
+        case DECMode::Unicode: return ConsecutiveModes + 6;
+        case DECMode::TextReflow: return ConsecutiveModes + 7;
+        case DECMode::SixelCursorNextToGraphic: return ConsecutiveModes + 8;
+        default: return static_cast<size_t>(m);
+    }
+}
+
+constexpr size_t DECModeCount = toDECModeIndex(DECMode::SixelCursorNextToGraphic) + 1;
+
 constexpr DynamicColorName getChangeDynamicColorCommand(unsigned value)
 {
     switch (value)
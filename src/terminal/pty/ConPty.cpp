@@ -13,6 +13,10 @@
  */
 #include <terminal/pty/ConPty.h>
 
+#include <fmt/format.h>
+
+#include <atomic>
+#include <cerrno>
 #include <utility>
 
 #include <Windows.h>
@@ -43,16 +47,66 @@ string GetLastErrorAsString()
 
     return message;
 }
+
+// Size of the pipe buffer the pseudo console writes its output to.
+constexpr DWORD OutputPipeBufferSize = 128 * 1024;
+
+/// Creates a pipe whose reading end supports overlapped I/O, which anonymous pipes do not.
+///
+/// @returns false on failure, with GetLastError() telling why.
+bool createOverlappedPipe(HANDLE& _reader, HANDLE& _writer)
+{
+    static auto serial = std::atomic<unsigned> { 0 };
+    auto const name = fmt::format(R"(\\.\pipe\contour-conpty-{}-{})", GetCurrentProcessId(), serial++);
+
+    _reader = CreateNamedPipeA(name.c_str(),
+                               PIPE_ACCESS_INBOUND | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE,
+                               PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+                               1,
+                               0,
+                               OutputPipeBufferSize,
+                               0,
+                               nullptr);
+    if (_reader == INVALID_HANDLE_VALUE)
+        return false;
+
+    _writer = CreateFileA(name.c_str(), GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (_writer == INVALID_HANDLE_VALUE)
+    {
+        auto const error = GetLastError();
+        CloseHandle(_reader);
+        _reader = INVALID_HANDLE_VALUE;
+        SetLastError(error);
+        return false;
+    }
+
+    return true;
+}
 } // anonymous namespace
 
 namespace terminal
 {
 
+// The slave side writes to the pipe the pseudo console writes its output to,
+// such that whatever is written can be read() from the ConPty,
+// just like writing to the slave device of a Unix PTY.
 struct ConPtySlave: public PtySlaveDummy
 {
     HANDLE output_;
 
     explicit ConPtySlave(HANDLE output): output_ { output } {}
+    ~ConPtySlave() override { close(); }
+
+    void close() override
+    {
+        if (output_ != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(output_);
+            output_ = INVALID_HANDLE_VALUE;
+        }
+    }
+
+    [[nodiscard]] bool isClosed() const noexcept override { return output_ == INVALID_HANDLE_VALUE; }
 
     int write(std::string_view text) noexcept override
     {
@@ -69,13 +123,21 @@ ConPty::ConPty(PageSize const& _windowSize): size_ { _windowSize }
     master_ = INVALID_HANDLE_VALUE;
     input_ = INVALID_HANDLE_VALUE;
     output_ = INVALID_HANDLE_VALUE;
-    buffer_.resize(10240);
+
+    // A manual-reset event, as required for overlapped I/O, and an auto-reset event for waking up,
+    // such that a wakeup is consumed by the read() it interrupts.
+    readOverlapped_.hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+    wakeupEvent_ = CreateEventA(nullptr, FALSE, FALSE, nullptr);
+    if (!readOverlapped_.hEvent || !wakeupEvent_)
+        throw runtime_error { GetLastErrorAsString() };
 }
 
 ConPty::~ConPty()
 {
     PtyLog()("~ConPty()");
     close();
+    CloseHandle(readOverlapped_.hEvent);
+    CloseHandle(wakeupEvent_);
 }
 
 bool ConPty::isClosed() const noexcept
@@ -88,8 +150,6 @@ void ConPty::start()
     PtyLog()("Starting ConPTY");
     assert(!slave_);
 
-    slave_ = make_unique<ConPtySlave>(output_);
-
     HANDLE hPipePTYIn { INVALID_HANDLE_VALUE };
     HANDLE hPipePTYOut { INVALID_HANDLE_VALUE };
 
@@ -97,7 +157,7 @@ void ConPty::start()
     if (!CreatePipe(&hPipePTYIn, &output_, NULL, 0))
         throw runtime_error { GetLastErrorAsString() };
 
-    if (!CreatePipe(&input_, &hPipePTYOut, NULL, 0))
+    if (!createOverlappedPipe(input_, hPipePTYOut))
     {
         CloseHandle(hPipePTYIn);
         throw runtime_error { GetLastErrorAsString() };
@@ -110,11 +170,15 @@ void ConPty::start()
     if (hPipePTYIn != INVALID_HANDLE_VALUE)
         CloseHandle(hPipePTYIn);
 
-    if (hPipePTYOut != INVALID_HANDLE_VALUE)
-        CloseHandle(hPipePTYOut);
-
     if (hr != S_OK)
+    {
+        CloseHandle(hPipePTYOut);
         throw runtime_error { GetLastErrorAsString() };
+    }
+
+    // The pseudo console holds its own handle to the output pipe. Ours is passed on to the slave,
+    // which is closed once the process has been spawned.
+    slave_ = make_unique<ConPtySlave>(hPipePTYOut);
 }
 
 void ConPty::close()
@@ -130,6 +194,8 @@ void ConPty::close()
 
     if (input_ != INVALID_HANDLE_VALUE)
     {
+        // Lets a pending read() return.
+        CancelIoEx(input_, nullptr);
         CloseHandle(input_);
         input_ = INVALID_HANDLE_VALUE;
     }
@@ -139,28 +205,67 @@ void ConPty::close()
         CloseHandle(output_);
         output_ = INVALID_HANDLE_VALUE;
     }
+
+    if (slave_)
+        slave_->close();
 }
 
 Pty::ReadResult ConPty::read(crispy::BufferObject<char>& buffer,
                              std::chrono::milliseconds timeout,
                              size_t size)
 {
-    // TODO: wait for timeout time at most AND got woken up upon wakeupReader() invokcation.
-    (void) timeout;
+    if (input_ == INVALID_HANDLE_VALUE)
+    {
+        errno = ENODEV;
+        return nullopt;
+    }
 
+    auto const _l = scoped_lock { buffer };
     auto const n = static_cast<DWORD>(min(size, buffer.bytesAvailable()));
 
     DWORD nread {};
-    if (!ReadFile(input_, buffer.hotEnd(), n, &nread, nullptr))
+    if (!ReadFile(input_, buffer.hotEnd(), n, nullptr, &readOverlapped_))
+    {
+        if (GetLastError() != ERROR_IO_PENDING)
+        {
+            PtyInLog()("PTY read() failed. {}", GetLastErrorAsString());
+            errno = EIO;
+            return nullopt;
+        }
+
+        HANDLE const events[2] = { readOverlapped_.hEvent, wakeupEvent_ };
+        auto const waitResult =
+            WaitForMultipleObjects(2, events, FALSE, static_cast<DWORD>(timeout.count()));
+        if (waitResult != WAIT_OBJECT_0)
+            CancelIoEx(input_, &readOverlapped_);
+
+        // Waits for the read to be completed or cancelled, as the buffer must not be written to
+        // after returning. Data may still have been read if the read completed meanwhile.
+        if (!GetOverlappedResult(input_, &readOverlapped_, &nread, TRUE))
+        {
+            auto const error = GetLastError();
+            if (error != ERROR_OPERATION_ABORTED)
+            {
+                PtyInLog()("PTY read() failed. {}", GetLastErrorAsString());
+                errno = error == ERROR_BROKEN_PIPE ? EPIPE : EIO;
+                return nullopt;
+            }
+            errno = waitResult == WAIT_OBJECT_0 + 1 ? EINTR : EAGAIN;
+            return nullopt;
+        }
+    }
+    else if (!GetOverlappedResult(input_, &readOverlapped_, &nread, FALSE))
+    {
+        errno = EIO;
         return nullopt;
+    }
 
     return { tuple { string_view { buffer.hotEnd(), nread }, false } };
 }
 
 void ConPty::wakeupReader()
 {
-    // TODO: Windows ConPTY does *NOT* support non-blocking / overlapped I/O.
-    // How can we make ReadFile() return early? We could maybe WriteFile() to it?
+    SetEvent(wakeupEvent_);
 }
 
 int ConPty::write(char const* buf, size_t size)
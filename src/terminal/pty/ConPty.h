@@ -17,7 +17,6 @@
 
 #include <memory>
 #include <mutex>
-#include <vector>
 
 #include <Windows.h>
 
@@ -25,6 +24,9 @@ namespace terminal
 {
 
 /// ConPty implementation for newer Windows 10 versions.
+///
+/// The output of the pseudo console is read through a named pipe opened for overlapped I/O,
+/// such that reads can time out and be woken up, and read straight into the caller's buffer.
 class ConPty: public Pty
 {
   public:
@@ -50,9 +52,10 @@ class ConPty: public Pty
     std::mutex mutex_; // used to guard close()
     PageSize size_;
     HPCON master_;
-    HANDLE input_;
-    HANDLE output_;
-    std::vector<char> buffer_;
+    HANDLE input_;  // reading end of the pseudo console's output, opened for overlapped I/O
+    HANDLE output_; // writing end of the pseudo console's input
+    OVERLAPPED readOverlapped_ {};
+    HANDLE wakeupEvent_; // signalled by wakeupReader()
     std::unique_ptr<PtySlave> slave_;
 };
 
@@ -0,0 +1,178 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/pty/LinuxIoUring.h>
+#include <terminal/pty/Pty.h>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+
+using std::unique_ptr;
+
+namespace terminal
+{
+
+namespace
+{
+    int ioUringSetup(unsigned _entries, io_uring_params* _params) noexcept
+    {
+#if defined(__NR_io_uring_setup)
+        return static_cast<int>(syscall(__NR_io_uring_setup, _entries, _params));
+#else
+        (void) _entries;
+        (void) _params;
+        errno = ENOSYS;
+        return -1;
+#endif
+    }
+
+    int ioUringEnter(int _fd, unsigned _toSubmit, unsigned _minComplete, unsigned _flags) noexcept
+    {
+#if defined(__NR_io_uring_enter)
+        return static_cast<int>(
+            syscall(__NR_io_uring_enter, _fd, _toSubmit, _minComplete, _flags, nullptr, 0));
+#else
+        (void) _fd;
+        (void) _toSubmit;
+        (void) _minComplete;
+        (void) _flags;
+        errno = ENOSYS;
+        return -1;
+#endif
+    }
+
+    template <typename T>
+    T* at(void* _base, uint32_t _offset) noexcept
+    {
+        return reinterpret_cast<T*>(static_cast<char*>(_base) + _offset);
+    }
+} // namespace
+
+unique_ptr<LinuxIoUring> LinuxIoUring::create(unsigned _entries)
+{
+    auto params = io_uring_params {};
+    auto const fd = ioUringSetup(_entries, &params);
+    if (fd < 0)
+    {
+        PtyLog()("io_uring is not available. {}", strerror(errno));
+        return nullptr;
+    }
+
+    auto ring = unique_ptr<LinuxIoUring>(new LinuxIoUring());
+    ring->fd_ = fd;
+    ring->entries_ = params.sq_entries;
+
+    ring->sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool const singleMapping = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (singleMapping)
+        ring->sqRingSize_ = ring->cqRingSize_ = std::max(ring->sqRingSize_, ring->cqRingSize_);
+
+    auto const mapRing = [fd](size_t size, off_t offset) -> void* {
+        auto* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+        return p != MAP_FAILED ? p : nullptr;
+    };
+
+    ring->sqRing_ = mapRing(ring->sqRingSize_, IORING_OFF_SQ_RING);
+    if (!ring->sqRing_)
+    {
+        PtyLog()("Failed to map io_uring submission queue. {}", strerror(errno));
+        return nullptr;
+    }
+
+    ring->cqRing_ = singleMapping ? ring->sqRing_ : mapRing(ring->cqRingSize_, IORING_OFF_CQ_RING);
+    if (!ring->cqRing_)
+    {
+        PtyLog()("Failed to map io_uring completion queue. {}", strerror(errno));
+        return nullptr;
+    }
+
+    ring->sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+    ring->sqes_ = static_cast<io_uring_sqe*>(mapRing(ring->sqesSize_, IORING_OFF_SQES));
+    if (!ring->sqes_)
+    {
+        PtyLog()("Failed to map io_uring submission queue entries. {}", strerror(errno));
+        return nullptr;
+    }
+
+    ring->sqHead_ = at<unsigned>(ring->sqRing_, params.sq_off.head);
+    ring->sqTail_ = at<unsigned>(ring->sqRing_, params.sq_off.tail);
+    ring->sqMask_ = *at<unsigned>(ring->sqRing_, params.sq_off.ring_mask);
+    ring->cqHead_ = at<unsigned>(ring->cqRing_, params.cq_off.head);
+    ring->cqTail_ = at<unsigned>(ring->cqRing_, params.cq_off.tail);
+    ring->cqMask_ = *at<unsigned>(ring->cqRing_, params.cq_off.ring_mask);
+    ring->cqes_ = at<io_uring_cqe>(ring->cqRing_, params.cq_off.cqes);
+
+    // Submission queue slots are used in order, so the indirection array is an identity mapping.
+    auto* const sqArray = at<unsigned>(ring->sqRing_, params.sq_off.array);
+    for (unsigned i = 0; i < params.sq_entries; ++i)
+        sqArray[i] = i;
+
+    PtyLog()("io_uring set up with {} entries (features: {:#x}).", params.sq_entries, params.features);
+    return ring;
+}
+
+LinuxIoUring::~LinuxIoUring()
+{
+    if (sqes_)
+        munmap(sqes_, sqesSize_);
+    if (cqRing_ && cqRing_ != sqRing_)
+        munmap(cqRing_, cqRingSize_);
+    if (sqRing_)
+        munmap(sqRing_, sqRingSize_);
+    if (fd_ != -1)
+        ::close(fd_);
+}
+
+io_uring_sqe* LinuxIoUring::prepare(uint8_t _opcode, int _fd, uint64_t _userData) noexcept
+{
+    if (sqTailLocal_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) >= entries_)
+        return nullptr;
+
+    auto* sqe = &sqes_[sqTailLocal_ & sqMask_];
+    *sqe = io_uring_sqe {};
+    sqe->opcode = _opcode;
+    sqe->fd = _fd;
+    sqe->user_data = _userData;
+    ++sqTailLocal_;
+    return sqe;
+}
+
+int LinuxIoUring::submitAndWait(unsigned _minComplete) noexcept
+{
+    __atomic_store_n(sqTail_, sqTailLocal_, __ATOMIC_RELEASE);
+
+    for (;;)
+    {
+        auto const toSubmit = sqTailLocal_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+        auto const rv = ioUringEnter(fd_, toSubmit, _minComplete, IORING_ENTER_GETEVENTS);
+        if (rv >= 0)
+        {
+            // Not everything may have been consumed, e.g. because the completion queue is congested.
+            if (sqTailLocal_ == __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE))
+                return 0;
+            continue;
+        }
+
+        if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+            return -1;
+    }
+}
+
+} // namespace terminal
@@ -0,0 +1,96 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <linux/io_uring.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace terminal
+{
+
+/**
+ * Minimal io_uring submission/completion queue pair, talking to the kernel via raw system calls,
+ * so that no additional library is required.
+ *
+ * Not thread-safe; meant to be driven by a single thread, such as the PTY reader.
+ */
+class LinuxIoUring
+{
+  public:
+    /// Sets up a new io_uring instance.
+    ///
+    /// @returns the ring, or nullptr if io_uring is not available, e.g. on older kernels
+    ///          or if it has been disabled via seccomp or sysctl.
+    static std::unique_ptr<LinuxIoUring> create(unsigned _entries);
+
+    LinuxIoUring(LinuxIoUring const&) = delete;
+    LinuxIoUring(LinuxIoUring&&) = delete;
+    LinuxIoUring& operator=(LinuxIoUring const&) = delete;
+    LinuxIoUring& operator=(LinuxIoUring&&) = delete;
+    ~LinuxIoUring();
+
+    /// Returns a zero-initialized submission queue entry for the given operation,
+    /// or nullptr if the submission queue is full.
+    ///
+    /// The entry is handed to the kernel with the next call to submitAndWait().
+    [[nodiscard]] io_uring_sqe* prepare(uint8_t _opcode, int _fd, uint64_t _userData) noexcept;
+
+    /// Submits all prepared entries and waits until at least @p _minComplete completions are available.
+    ///
+    /// @returns 0 on success, -1 on failure with errno set accordingly.
+    int submitAndWait(unsigned _minComplete) noexcept;
+
+    /// Invokes @p _handler with the user data and result of each available completion.
+    template <typename Handler>
+    void reapCompletions(Handler&& _handler)
+    {
+        auto head = *cqHead_;
+        auto const tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+        while (head != tail)
+        {
+            auto const& cqe = cqes_[head & cqMask_];
+            _handler(cqe.user_data, cqe.res);
+            ++head;
+        }
+        __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+    }
+
+  private:
+    LinuxIoUring() = default;
+
+    int fd_ = -1;
+    unsigned entries_ = 0;
+    unsigned sqTailLocal_ = 0; // tail including entries not yet handed to the kernel
+
+    void* sqRing_ = nullptr;
+    size_t sqRingSize_ = 0;
+    void* cqRing_ = nullptr;
+    size_t cqRingSize_ = 0;
+
+    unsigned* sqHead_ = nullptr;
+    unsigned* sqTail_ = nullptr;
+    unsigned sqMask_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    size_t sqesSize_ = 0;
+
+    unsigned* cqHead_ = nullptr;
+    unsigned* cqTail_ = nullptr;
+    unsigned cqMask_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+};
+
+} // namespace terminal
@@ -19,11 +19,16 @@
 #include <crispy/escape.h>
 #include <crispy/logstore.h>
 
+#if defined(LIBTERMINAL_IO_URING)
+    #include <poll.h>
+#endif
+
 #include <sys/epoll.h>
 #include <sys/eventfd.h>
 #include <sys/ioctl.h>
 #include <sys/select.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <sys/wait.h>
 
 #include <cassert>
@@ -51,6 +56,7 @@ using std::runtime_error;
 using std::scoped_lock;
 using std::string_view;
 using std::tuple;
+using std::vector;
 
 using namespace std::string_literals;
 
@@ -87,6 +93,26 @@ namespace
         return { PtyMasterHandle::cast_from(masterFd), PtySlaveHandle::cast_from(slaveFd) };
     }
 
+#if defined(LIBTERMINAL_IO_URING)
+    // Identifies the operation an io_uring completion belongs to (stored in the low byte of its user data).
+    enum class UringTag : uint8_t
+    {
+        Other,
+        MasterPoll,
+        MasterRead,
+        Timeout,
+        Wakeup,
+        FastPipe,
+    };
+
+    // Operations issued per read() call carry a generation number in the upper bits of their user data,
+    // such that late completions of a previous read() call can be told apart.
+    constexpr uint64_t uringUserData(uint64_t _generation, UringTag _tag) noexcept
+    {
+        return (_generation << 8) | static_cast<uint8_t>(_tag);
+    }
+#endif
+
 } // namespace
 
 // {{{ LinuxPty::Slave
@@ -217,11 +243,20 @@ void LinuxPty::start()
     ev.data.fd = _stdoutFastPipe.reader();
     if (epoll_ctl(_epollFd, EPOLL_CTL_ADD, _stdoutFastPipe.reader(), &ev) < 0)
         throw runtime_error { "epoll setup failed to add stdout-fastpipe. "s + strerror(errno) };
+
+#if defined(LIBTERMINAL_IO_URING)
+    _uring = LinuxIoUring::create(16);
+    if (!_uring)
+        PtyLog()("Falling back to epoll for reading from the PTY.");
+#endif
 }
 
 LinuxPty::~LinuxPty()
 {
     PtyLog()("PTY destroying master (file descriptor {}).", _masterFd);
+#if defined(LIBTERMINAL_IO_URING)
+    _uring.reset();
+#endif
     detail::saveClose(&_eventFd);
     detail::saveClose(&_epollFd);
     detail::saveClose(&_masterFd);
@@ -252,11 +287,27 @@ bool LinuxPty::isClosed() const noexcept
 
 void LinuxPty::wakeupReader() noexcept
 {
-    uint64_t dummy {};
-    auto const rv = ::write(_eventFd, &dummy, sizeof(dummy));
+    // Adding zero to the eventfd counter would not make it readable.
+    uint64_t const increment = 1;
+    auto const rv = ::write(_eventFd, &increment, sizeof(increment));
     (void) rv;
 }
 
+vector<int> LinuxPty::readableFileDescriptors()
+{
+    if (_masterFd < 0)
+        return {};
+
+#if defined(LIBTERMINAL_IO_URING)
+    // Waiting is done by the caller from now on, so io_uring would not save any system call anymore,
+    // whereas its pending reads would consume the data the caller is waiting for.
+    _uring.reset();
+#endif
+
+    // The epoll handle is readable as soon as any of the file descriptors it watches is.
+    return { _epollFd };
+}
+
 optional<string_view> LinuxPty::readSome(int fd, char* target, size_t n) noexcept
 {
     auto const rv = static_cast<int>(::read(fd, target, n));
@@ -336,6 +387,11 @@ Pty::ReadResult LinuxPty::read(crispy::BufferObject<char>& sink,
                                std::chrono::milliseconds timeout,
                                size_t size)
 {
+#if defined(LIBTERMINAL_IO_URING)
+    if (_uring)
+        return readViaIoUring(sink, timeout, size);
+#endif
+
     if (int fd = waitForReadable(timeout); fd != -1)
     {
         auto const _l = scoped_lock { sink };
@@ -346,7 +402,171 @@ Pty::ReadResult LinuxPty::read(crispy::BufferObject<char>& sink,
     return nullopt;
 }
 
-int LinuxPty::write(char const* buf, size_t size)
+#if defined(LIBTERMINAL_IO_URING)
+Pty::ReadResult LinuxPty::readViaIoUring(crispy::BufferObject<char>& sink,
+                                         std::chrono::milliseconds timeout,
+                                         size_t size)
+{
+    if (_masterFd < 0)
+    {
+        if (PtyInLog)
+            PtyInLog()("read() called with closed PTY master.");
+        errno = ENODEV;
+        return nullopt;
+    }
+
+    auto const _l = scoped_lock { sink };
+    auto& ring = *_uring;
+
+    auto const generation = ++_uringGeneration;
+    auto const pollTag = uringUserData(generation, UringTag::MasterPoll);
+    auto const readTag = uringUserData(generation, UringTag::MasterRead);
+    auto const timeoutTag = uringUserData(generation, UringTag::Timeout);
+
+    // All entries are submitted before returning, so there is always enough room in the submission
+    // queue for the at most six entries of a single read() call.
+    auto const prepare = [&](uint8_t opcode, int fd, uint64_t userData) -> io_uring_sqe& {
+        auto* sqe = ring.prepare(opcode, fd, userData);
+        assert(sqe);
+        return *sqe;
+    };
+
+    // The timeout of the previous read is still armed if that read completed in time.
+    if (_uringPendingTimeout)
+    {
+        prepare(IORING_OP_TIMEOUT_REMOVE, -1, uringUserData(0, UringTag::Other)).addr = *_uringPendingTimeout;
+        _uringPendingTimeout.reset();
+    }
+
+    if (!_uringWakeupArmed)
+    {
+        prepare(IORING_OP_POLL_ADD, _eventFd, uringUserData(0, UringTag::Wakeup)).poll32_events = POLLIN;
+        _uringWakeupArmed = true;
+    }
+
+    if (!_uringFastPipeArmed && _stdoutFastPipe.reader() != -1)
+    {
+        prepare(IORING_OP_POLL_ADD, _stdoutFastPipe.reader(), uringUserData(0, UringTag::FastPipe))
+            .poll32_events = POLLIN;
+        _uringFastPipeArmed = true;
+    }
+
+    // Wait for the PTY master to become readable and read from it, all within a single system call.
+    auto& pollSqe = prepare(IORING_OP_POLL_ADD, _masterFd, pollTag);
+    pollSqe.poll32_events = POLLIN;
+    pollSqe.flags |= IOSQE_IO_LINK;
+
+    auto& readSqe = prepare(IORING_OP_READ, _masterFd, readTag);
+    readSqe.addr = reinterpret_cast<uintptr_t>(sink.hotEnd());
+    readSqe.len = static_cast<uint32_t>(min(size, sink.bytesAvailable()));
+
+    _uringTimeout.tv_sec = timeout.count() / 1000;
+    _uringTimeout.tv_nsec = (timeout.count() % 1000) * 1'000'000;
+    auto& timeoutSqe = prepare(IORING_OP_TIMEOUT, -1, timeoutTag);
+    timeoutSqe.addr = reinterpret_cast<uintptr_t>(&_uringTimeout);
+    timeoutSqe.len = 1;
+    _uringPendingTimeout = timeoutTag;
+
+    // The kernel writes into the sink for as long as the read is in flight,
+    // so do not return before it has completed (or got cancelled).
+    auto readResult = optional<int> {};
+    auto pollResult = 0;
+    auto woken = false;
+    auto fastPipeReadable = false;
+    auto timedOut = false;
+    auto cancelling = false;
+    while (!readResult)
+    {
+        if ((woken || fastPipeReadable || timedOut) && !cancelling)
+        {
+            // Cancelling the poll also cancels the read that is linked to it.
+            prepare(IORING_OP_ASYNC_CANCEL, -1, uringUserData(0, UringTag::Other)).addr = pollTag;
+            cancelling = true;
+        }
+
+        if (ring.submitAndWait(1) < 0)
+        {
+            if (PtyInLog)
+                PtyInLog()("PTY read() failed. {}", strerror(errno));
+            return nullopt;
+        }
+
+        ring.reapCompletions([&](uint64_t userData, int result) {
+            switch (static_cast<UringTag>(userData & 0xFF))
+            {
+                case UringTag::MasterPoll:
+                    if (userData == pollTag)
+                        pollResult = result;
+                    break;
+                case UringTag::MasterRead:
+                    if (userData == readTag)
+                        readResult = result;
+                    break;
+                case UringTag::Timeout:
+                    if (userData == timeoutTag)
+                    {
+                        _uringPendingTimeout.reset();
+                        timedOut = result == -ETIME;
+                    }
+                    break;
+                case UringTag::Wakeup: {
+                    _uringWakeupArmed = false;
+                    uint64_t dummy {};
+                    woken = ::read(_eventFd, &dummy, sizeof(dummy)) > 0;
+                    break;
+                }
+                case UringTag::FastPipe:
+                    _uringFastPipeArmed = false;
+                    fastPipeReadable = result > 0;
+                    break;
+                case UringTag::Other: break;
+            }
+        });
+    }
+
+    if (*readResult >= 0)
+    {
+        auto const data = string_view { sink.hotEnd(), static_cast<size_t>(*readResult) };
+        if (PtyInLog)
+            PtyInLog()("master received: \"{}\"", crispy::escape(data));
+        return { tuple { data, false } };
+    }
+
+    if (*readResult == -EINVAL || *readResult == -EOPNOTSUPP)
+    {
+        // Older kernels do not know about IORING_OP_READ.
+        PtyLog()("io_uring cannot read from the PTY. Falling back to epoll.");
+        _uring.reset();
+        errno = EINTR;
+        return nullopt;
+    }
+
+    if (*readResult == -ECANCELED)
+    {
+        if (fastPipeReadable)
+        {
+            if (auto x = readSome(_stdoutFastPipe.reader(), sink.hotEnd(), min(size, sink.bytesAvailable())))
+                return { tuple { x.value(), true } };
+            return nullopt;
+        }
+
+        if (pollResult < 0 && pollResult != -ECANCELED)
+            errno = -pollResult;
+        else
+            errno = woken ? EINTR : EAGAIN;
+        if (PtyInLog && errno != EINTR && errno != EAGAIN)
+            PtyInLog()("PTY read() failed. {}", strerror(errno));
+        return nullopt;
+    }
+
+    errno = -*readResult;
+    if (PtyInLog)
+        PtyInLog()("PTY read() failed. {}", strerror(errno));
+    return nullopt;
+}
+#endif
+
+int LinuxPty::waitForWritable(size_t size) noexcept
 {
     timeval tv {};
     tv.tv_sec = 1;
@@ -369,6 +589,14 @@ int LinuxPty::write(char const* buf, size_t size)
         return 0;
     }
 
+    return 1;
+}
+
+int LinuxPty::write(char const* buf, size_t size)
+{
+    if (auto const rv = waitForWritable(size); rv <= 0)
+        return rv;
+
     ssize_t rv = ::write(_masterFd, buf, size);
     if (PtyOutLog)
     {
@@ -389,6 +617,42 @@ int LinuxPty::write(char const* buf, size_t size)
     return static_cast<int>(rv);
 }
 
+int LinuxPty::writeVectored(gsl::span<string_view const> buffers)
+{
+    auto vectors = array<iovec, 4> {};
+    auto vectorCount = size_t { 0 };
+    auto size = size_t { 0 };
+    for (auto const buffer: buffers)
+    {
+        if (buffer.empty())
+            continue;
+        if (vectorCount == vectors.size())
+            break;
+        vectors[vectorCount++] = iovec { const_cast<char*>(buffer.data()), buffer.size() };
+        size += buffer.size();
+    }
+
+    if (vectorCount == 0)
+        return 0;
+
+    if (vectorCount == 1)
+        return write(static_cast<char const*>(vectors[0].iov_base), vectors[0].iov_len);
+
+    if (auto const rv = waitForWritable(size); rv <= 0)
+        return rv;
+
+    ssize_t rv = ::writev(_masterFd, vectors.data(), static_cast<int>(vectorCount));
+    if (PtyOutLog)
+    {
+        if (rv < 0)
+            PtyOutLog()("PTY write of {} bytes failed. {}\n", size, strerror(errno));
+        else
+            PtyOutLog()("Sending {} of {} bytes from {} buffers.", rv, size, vectorCount);
+    }
+
+    return static_cast<int>(rv);
+}
+
 PageSize LinuxPty::pageSize() const noexcept
 {
     return _pageSize;
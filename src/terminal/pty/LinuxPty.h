@@ -16,6 +16,12 @@
 #include <terminal/pty/Pty.h>
 #include <terminal/pty/UnixPty.h> // UnixPipe (TODO: move somewhere else)
 
+#if defined(LIBTERMINAL_IO_URING)
+    #include <terminal/pty/LinuxIoUring.h>
+
+    #include <linux/time_types.h>
+#endif
+
 #include <array>
 #include <memory>
 #include <optional>
@@ -28,7 +34,7 @@ namespace terminal
 
 class LinuxPty: public Pty
 {
-  private:
+  public:
     class Slave: public PtySlave
     {
       public:
@@ -43,7 +49,6 @@ class LinuxPty: public Pty
         [[nodiscard]] int write(std::string_view) noexcept override;
     };
 
-  public:
     struct PtyHandles
     {
         PtyMasterHandle master;
@@ -60,10 +65,12 @@ class LinuxPty: public Pty
     void close() override;
     [[nodiscard]] bool isClosed() const noexcept override;
     void wakeupReader() noexcept override;
+    [[nodiscard]] std::vector<int> readableFileDescriptors() override;
     [[nodiscard]] ReadResult read(crispy::BufferObject<char>& storage,
                                   std::chrono::milliseconds timeout,
                                   size_t size) override;
     int write(char const* buf, size_t size) override;
+    int writeVectored(gsl::span<std::string_view const> buffers) override;
     [[nodiscard]] PageSize pageSize() const noexcept override;
     void resizeScreen(PageSize _cells, std::optional<ImageSize> _pixels = std::nullopt) override;
 
@@ -72,6 +79,12 @@ class LinuxPty: public Pty
   private:
     std::optional<std::string_view> readSome(int fd, char* target, size_t n) noexcept;
     int waitForReadable(std::chrono::milliseconds timeout) noexcept;
+    int waitForWritable(size_t size) noexcept;
+#if defined(LIBTERMINAL_IO_URING)
+    [[nodiscard]] ReadResult readViaIoUring(crispy::BufferObject<char>& storage,
+                                            std::chrono::milliseconds timeout,
+                                            size_t size);
+#endif
 
     int _masterFd = -1;
     int _epollFd = -1;
@@ -80,6 +93,17 @@ class LinuxPty: public Pty
     PageSize _pageSize;
     std::optional<ImageSize> _pixels;
     std::unique_ptr<Slave> _slave;
+
+#if defined(LIBTERMINAL_IO_URING)
+    // If available, reads are performed via io_uring, such that waiting for and reading from
+    // the PTY only takes a single system call. Falls back to epoll otherwise.
+    std::unique_ptr<LinuxIoUring> _uring;
+    uint64_t _uringGeneration = 0;
+    bool _uringWakeupArmed = false;
+    bool _uringFastPipeArmed = false;
+    std::optional<uint64_t> _uringPendingTimeout; // user data of the timeout of the previous read
+    __kernel_timespec _uringTimeout {};
+#endif
 };
 
 } // namespace terminal
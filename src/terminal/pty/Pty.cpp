@@ -28,6 +28,25 @@ using std::unique_ptr;
 namespace terminal
 {
 
+int Pty::writeVectored(gsl::span<std::string_view const> buffers)
+{
+    auto total = 0;
+    for (auto const buffer: buffers)
+    {
+        if (buffer.empty())
+            continue;
+
+        auto const rv = write(buffer.data(), buffer.size());
+        if (rv < 0)
+            return total != 0 ? total : rv;
+
+        total += rv;
+        if (static_cast<size_t>(rv) < buffer.size())
+            break;
+    }
+    return total;
+}
+
 unique_ptr<Pty> createPty(PageSize pageSize, optional<ImageSize> viewSize)
 {
 #if defined(__linux__)
@@ -19,9 +19,12 @@
 #include <crispy/boxed.h>
 #include <crispy/logstore.h>
 
+#include <gsl/span>
+
 #include <chrono>
 #include <optional>
 #include <string_view>
+#include <vector>
 
 namespace terminal
 {
@@ -101,6 +104,13 @@ class Pty
     /// @notice This is typically implemented using non-blocking I/O.
     virtual void wakeupReader() = 0;
 
+    /// Returns the file descriptors that become readable whenever read() can make progress,
+    /// including wakeupReader() having been invoked, such that a PtyReactor can wait for many
+    /// PTYs at once and then read() from them without blocking.
+    ///
+    /// @returns the file descriptors, or an empty list if this PTY cannot be waited for that way.
+    [[nodiscard]] virtual std::vector<int> readableFileDescriptors() { return {}; }
+
     /// Writes to the PTY device, so the other end can read from it.
     ///
     /// @param buf    Buffer of data to be written.
@@ -109,6 +119,13 @@ class Pty
     /// @returns Number of bytes written or -1 on error.
     [[nodiscard]] virtual int write(char const* buf, size_t size) = 0;
 
+    /// Writes the given buffers to the PTY device, in order, as if they were one contiguous buffer.
+    ///
+    /// The default implementation writes one buffer after another and stops at the first partial write.
+    ///
+    /// @returns Number of bytes written or -1 on error.
+    [[nodiscard]] virtual int writeVectored(gsl::span<std::string_view const> buffers);
+
     /// @returns current underlying window size in characters width and height.
     [[nodiscard]] virtual PageSize pageSize() const noexcept = 0;
 
@@ -119,7 +136,12 @@ class Pty
 [[nodiscard]] std::unique_ptr<Pty> createPty(PageSize pageSize, std::optional<ImageSize> viewSize);
 
 auto const inline PtyLog = logstore::Category("pty", "Logs general PTY informations.");
+#if defined(LIBTERMINAL_LOG_TRACE)
 auto const inline PtyInLog = logstore::Category("pty.input", "Logs PTY raw input.");
 auto const inline PtyOutLog = logstore::Category("pty.output", "Logs PTY raw output.");
+#else
+auto constexpr inline PtyInLog = logstore::DisabledCategory {};
+auto constexpr inline PtyOutLog = logstore::DisabledCategory {};
+#endif
 
 } // namespace terminal
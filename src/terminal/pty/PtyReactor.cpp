@@ -0,0 +1,235 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/pty/PtyReactor.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#if !defined(_WIN32)
+    #include <fcntl.h>
+    #include <poll.h>
+    #include <unistd.h>
+#endif
+
+using std::max;
+using std::unique_lock;
+using std::vector;
+
+namespace terminal
+{
+
+PtyReactor::PtyReactor(size_t _workerCount)
+{
+#if !defined(_WIN32)
+    if (::pipe(wakeupPipe_) != 0)
+    {
+        PtyLog()("Failed to create PTY reactor wakeup pipe. {}", strerror(errno));
+        return;
+    }
+    for (auto const fd: wakeupPipe_)
+        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+    for (auto const fd: wakeupPipe_)
+        ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    ioThread_ = std::thread(&PtyReactor::ioLoop, this);
+    for (size_t i = 0; i < max(size_t { 1 }, _workerCount); ++i)
+        workers_.emplace_back(&PtyReactor::workerLoop, this);
+#else
+    (void) _workerCount;
+#endif
+}
+
+PtyReactor::~PtyReactor()
+{
+    {
+        auto const _ = std::lock_guard { mutex_ };
+        stopping_ = true;
+    }
+    workAvailable_.notify_all();
+    wakeupIoLoop();
+
+    if (ioThread_.joinable())
+        ioThread_.join();
+    for (auto& worker: workers_)
+        worker.join();
+
+#if !defined(_WIN32)
+    for (auto const fd: wakeupPipe_)
+        if (fd != -1)
+            ::close(fd);
+#endif
+}
+
+bool PtyReactor::add(Pty& _pty, Handler _handler)
+{
+    if (!ioThread_.joinable() || _pty.readableFileDescriptors().empty())
+        return false;
+
+    {
+        auto const _ = std::lock_guard { mutex_ };
+        entries_.emplace(nextId_++, Entry { &_pty, std::move(_handler) });
+    }
+    wakeupIoLoop();
+    return true;
+}
+
+void PtyReactor::remove(Pty& _pty)
+{
+    {
+        auto lock = unique_lock { mutex_ };
+        auto i = find(_pty);
+        if (i == entries_.end())
+            return;
+
+        if (i->second.running)
+        {
+            handlerReturned_.wait(lock, [&]() {
+                i = find(_pty);
+                return i == entries_.end() || !i->second.running;
+            });
+            if (i == entries_.end())
+                return; // The handler asked for its removal itself.
+        }
+
+        work_.erase(std::remove(work_.begin(), work_.end(), i->first), work_.end());
+        entries_.erase(i);
+    }
+    wakeupIoLoop();
+}
+
+size_t PtyReactor::size() const
+{
+    auto const _ = std::lock_guard { mutex_ };
+    return entries_.size();
+}
+
+std::map<uint64_t, PtyReactor::Entry>::iterator PtyReactor::find(Pty& _pty)
+{
+    return std::find_if(entries_.begin(), entries_.end(), [&](auto const& entry) {
+        return entry.second.pty == &_pty;
+    });
+}
+
+void PtyReactor::schedule(uint64_t _id, Entry& _entry)
+{
+    _entry.scheduled = true;
+    work_.push_back(_id);
+    workAvailable_.notify_one();
+}
+
+void PtyReactor::wakeupIoLoop() noexcept
+{
+#if !defined(_WIN32)
+    if (wakeupPipe_[1] == -1)
+        return;
+    char const dummy {};
+    auto const rv = ::write(wakeupPipe_[1], &dummy, sizeof(dummy));
+    (void) rv;
+#endif
+}
+
+void PtyReactor::ioLoop()
+{
+#if !defined(_WIN32)
+    auto fds = vector<pollfd> {};
+    auto owners = vector<uint64_t> {}; // entry ID for each of fds, but the wakeup pipe
+    for (;;)
+    {
+        fds.clear();
+        owners.clear();
+        fds.push_back(pollfd { wakeupPipe_[0], POLLIN, 0 });
+        {
+            auto const _ = std::lock_guard { mutex_ };
+            if (stopping_)
+                break;
+
+            for (auto& [id, entry]: entries_)
+            {
+                if (entry.scheduled)
+                    continue;
+
+                auto const readable = entry.pty->readableFileDescriptors();
+                if (readable.empty())
+                {
+                    // Closed, which the handler is to find out when trying to read from it.
+                    schedule(id, entry);
+                    continue;
+                }
+                for (auto const fd: readable)
+                {
+                    fds.push_back(pollfd { fd, POLLIN, 0 });
+                    owners.push_back(id);
+                }
+            }
+        }
+
+        if (::poll(fds.data(), static_cast<nfds_t>(fds.size()), -1) < 0)
+        {
+            if (errno != EINTR)
+                PtyLog()("PTY reactor failed to wait for input. {}", strerror(errno));
+            continue;
+        }
+
+        if (fds[0].revents)
+        {
+            char dummy[256];
+            while (::read(wakeupPipe_[0], dummy, sizeof(dummy)) > 0)
+                ;
+        }
+
+        auto const _ = std::lock_guard { mutex_ };
+        for (size_t i = 1; i < fds.size(); ++i)
+        {
+            if (!fds[i].revents)
+                continue;
+            if (auto entry = entries_.find(owners[i - 1]); entry != entries_.end() && !entry->second.scheduled)
+                schedule(entry->first, entry->second);
+        }
+    }
+#endif
+}
+
+void PtyReactor::workerLoop()
+{
+    auto lock = unique_lock { mutex_ };
+    for (;;)
+    {
+        workAvailable_.wait(lock, [this]() { return stopping_ || !work_.empty(); });
+        if (stopping_)
+            break;
+
+        auto const id = work_.front();
+        work_.pop_front();
+        auto i = entries_.find(id);
+        if (i == entries_.end())
+            continue;
+
+        // The entry is not erased while running, see remove().
+        auto& entry = i->second;
+        entry.running = true;
+        lock.unlock();
+        auto const keep = entry.handler();
+        lock.lock();
+
+        entry.running = false;
+        entry.scheduled = false;
+        if (!keep)
+            entries_.erase(id);
+        handlerReturned_.notify_all();
+        wakeupIoLoop();
+    }
+}
+
+} // namespace terminal
@@ -0,0 +1,94 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <terminal/pty/Pty.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace terminal
+{
+
+/// Multiplexes the input of many PTYs onto a fixed number of threads.
+///
+/// Rather than every terminal session running threads of its own that mostly wait for input,
+/// a single I/O thread waits for all registered PTYs to become readable, and dispatches
+/// processing their input onto a small pool of worker threads.
+///
+/// The handler of a PTY is never invoked concurrently with itself, and the PTY is not waited for
+/// while its handler is queued or running. Handlers of different PTYs run in parallel.
+class PtyReactor
+{
+  public:
+    /// Processes the input that is available on a PTY, without blocking.
+    ///
+    /// @returns false if the PTY is to be removed from the reactor, e.g. because it has been closed.
+    using Handler = std::function<bool()>;
+
+    /// @param _workerCount number of threads to invoke handlers on, at least one.
+    explicit PtyReactor(size_t _workerCount);
+    ~PtyReactor();
+
+    PtyReactor(PtyReactor const&) = delete;
+    PtyReactor& operator=(PtyReactor const&) = delete;
+
+    /// Starts waiting for the given PTY to become readable, invoking @p _handler whenever it did.
+    ///
+    /// @returns false if the PTY does not provide any readableFileDescriptors() to wait for,
+    ///          in which case it has to be read from by a thread of its own.
+    [[nodiscard]] bool add(Pty& _pty, Handler _handler);
+
+    /// Stops waiting for the given PTY, waiting for its handler to return if it is currently running.
+    ///
+    /// This must not be invoked from within the handler of that PTY.
+    void remove(Pty& _pty);
+
+    /// @returns the number of PTYs currently registered.
+    [[nodiscard]] size_t size() const;
+
+  private:
+    struct Entry
+    {
+        Pty* pty;
+        Handler handler;
+        bool scheduled = false; //!< queued for or being processed by a worker thread
+        bool running = false;   //!< handler being invoked by a worker thread
+    };
+
+    void ioLoop();
+    void workerLoop();
+    void wakeupIoLoop() noexcept;
+    void schedule(uint64_t _id, Entry& _entry);
+    std::map<uint64_t, Entry>::iterator find(Pty& _pty);
+
+    mutable std::mutex mutex_;
+    std::condition_variable workAvailable_;
+    std::condition_variable handlerReturned_;
+    std::map<uint64_t, Entry> entries_;
+    std::deque<uint64_t> work_; //!< IDs of the entries whose handler is to be invoked
+    uint64_t nextId_ = 1;
+    bool stopping_ = false;
+    int wakeupPipe_[2] = { -1, -1 };
+    std::thread ioThread_;
+    std::vector<std::thread> workers_;
+};
+
+} // namespace terminal
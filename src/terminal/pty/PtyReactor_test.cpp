@@ -0,0 +1,120 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/pty/MockPty.h>
+#include <terminal/pty/PtyReactor.h>
+
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if !defined(_WIN32)
+    #include <unistd.h>
+
+using namespace terminal;
+using std::string;
+
+namespace
+{
+
+/// A mock PTY whose output is to be read from a pipe.
+class PipePty: public MockPty
+{
+  public:
+    PipePty(): MockPty { PageSize { LineCount(25), ColumnCount(80) } }
+    {
+        REQUIRE(::pipe(pipe_) == 0);
+    }
+
+    ~PipePty() override
+    {
+        ::close(pipe_[0]);
+        ::close(pipe_[1]);
+    }
+
+    std::vector<int> readableFileDescriptors() override { return { pipe_[0] }; }
+
+    void send(string const& _text)
+    {
+        REQUIRE(::write(pipe_[1], _text.data(), _text.size()) == static_cast<ssize_t>(_text.size()));
+    }
+
+    /// Reads everything that has been sent, and returns false once "quit" has been received.
+    bool receive()
+    {
+        char buffer[256];
+        auto const n = ::read(pipe_[0], buffer, sizeof(buffer));
+        REQUIRE(n > 0);
+        auto const _ = std::lock_guard { mutex_ };
+        received_.append(buffer, static_cast<size_t>(n));
+        return received_.find("quit") == string::npos;
+    }
+
+    string received() const
+    {
+        auto const _ = std::lock_guard { mutex_ };
+        return received_;
+    }
+
+  private:
+    int pipe_[2] = { -1, -1 };
+    mutable std::mutex mutex_;
+    string received_;
+};
+
+template <typename Predicate>
+bool eventually(Predicate _predicate)
+{
+    for (int i = 0; i < 1000 && !_predicate(); ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    return _predicate();
+}
+
+} // namespace
+
+TEST_CASE("PtyReactor.dispatch", "[pty]")
+{
+    auto reactor = PtyReactor { 2 };
+
+    auto unpollable = MockPty { PageSize { LineCount(25), ColumnCount(80) } };
+    CHECK(!reactor.add(unpollable, []() { return true; }));
+
+    auto first = PipePty {};
+    auto second = PipePty {};
+    REQUIRE(reactor.add(first, [&]() { return first.receive(); }));
+    REQUIRE(reactor.add(second, [&]() { return second.receive(); }));
+    CHECK(reactor.size() == 2);
+
+    first.send("hello");
+    second.send("world");
+    CHECK(eventually([&]() { return first.received() == "hello" && second.received() == "world"; }));
+
+    first.send(", again");
+    CHECK(eventually([&]() { return first.received() == "hello, again"; }));
+
+    // A handler returning false removes its own PTY.
+    second.send(" quit");
+    CHECK(eventually([&]() { return reactor.size() == 1; }));
+
+    reactor.remove(first);
+    CHECK(reactor.size() == 0);
+    first.send("ignored");
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    CHECK(first.received() == "hello, again");
+}
+#endif
@@ -0,0 +1,130 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/TmuxControlMode.h>
+#include <terminal/pty/TmuxPanePty.h>
+
+#include <algorithm>
+#include <cerrno>
+
+using std::min;
+using std::string_view;
+using std::tuple;
+
+namespace terminal
+{
+
+TmuxPanePty::TmuxPanePty(unsigned _paneId, PageSize _pageSize, CommandWriter _writeCommands):
+    paneId_ { _paneId }, pageSize_ { _pageSize }, writeCommands_ { std::move(_writeCommands) }
+{
+}
+
+TmuxPanePty::~TmuxPanePty()
+{
+    close();
+}
+
+void TmuxPanePty::appendOutput(string_view _data)
+{
+    {
+        auto const _ = std::lock_guard { mutex_ };
+        output_ += _data;
+    }
+    condition_.notify_one();
+}
+
+void TmuxPanePty::start()
+{
+}
+
+PtySlave& TmuxPanePty::slave() noexcept
+{
+    return slave_;
+}
+
+void TmuxPanePty::close()
+{
+    {
+        auto const _ = std::lock_guard { mutex_ };
+        closed_ = true;
+    }
+    condition_.notify_one();
+}
+
+bool TmuxPanePty::isClosed() const noexcept
+{
+    auto const _ = std::lock_guard { mutex_ };
+    return closed_;
+}
+
+Pty::ReadResult TmuxPanePty::read(crispy::BufferObject<char>& storage,
+                                  std::chrono::milliseconds timeout,
+                                  size_t size)
+{
+    auto lock = std::unique_lock { mutex_ };
+    condition_.wait_for(lock, timeout, [this]() { return !output_.empty() || closed_ || wakeup_; });
+    wakeup_ = false;
+
+    if (output_.empty())
+    {
+        if (closed_)
+            // Reading zero bytes tells the terminal that the other side has gone.
+            return { tuple { string_view {}, false } };
+        errno = EAGAIN;
+        return std::nullopt;
+    }
+
+    auto const n = min(size, min(output_.size(), storage.bytesAvailable()));
+    auto const pooled = storage.writeAtEnd(string_view(output_.data(), n));
+    output_.erase(0, n);
+    return { tuple { string_view(pooled.data(), pooled.size()), false } };
+}
+
+void TmuxPanePty::wakeupReader()
+{
+    {
+        auto const _ = std::lock_guard { mutex_ };
+        wakeup_ = true;
+    }
+    condition_.notify_one();
+}
+
+int TmuxPanePty::write(char const* buf, size_t size)
+{
+    if (isClosed())
+        return -1;
+    writeCommands_(tmuxSendKeysCommand(paneId_, string_view(buf, size)));
+    return static_cast<int>(size);
+}
+
+PageSize TmuxPanePty::pageSize() const noexcept
+{
+    auto const _ = std::lock_guard { mutex_ };
+    return pageSize_;
+}
+
+void TmuxPanePty::resizeScreen(PageSize _cells, std::optional<ImageSize> /*_pixels*/)
+{
+    {
+        auto const _ = std::lock_guard { mutex_ };
+        if (pageSize_ == _cells)
+            return;
+        pageSize_ = _cells;
+    }
+
+    // The panes of a tmux window share the size of the client, which therefore follows
+    // the most recently resized pane.
+    writeCommands_(tmuxResizeCommand(unbox<unsigned>(_cells.columns), unbox<unsigned>(_cells.lines)));
+}
+
+} // namespace terminal
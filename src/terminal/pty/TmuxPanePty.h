@@ -0,0 +1,69 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <terminal/pty/Pty.h>
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+
+namespace terminal
+{
+
+/// PTY of a single pane of tmux running in control mode (see TmuxControlParser).
+///
+/// Reads return the output of the pane, as passed in by appendOutput().
+/// Writes and resizes are turned into tmux commands and passed on to the control-mode client.
+class TmuxPanePty: public Pty
+{
+  public:
+    /// Sends the given tmux command lines to the control-mode client.
+    using CommandWriter = std::function<void(std::string_view)>;
+
+    TmuxPanePty(unsigned _paneId, PageSize _pageSize, CommandWriter _writeCommands);
+    ~TmuxPanePty() override;
+
+    [[nodiscard]] unsigned paneId() const noexcept { return paneId_; }
+
+    /// Queues output of the pane to be read by the terminal. May be called from any thread.
+    void appendOutput(std::string_view _data);
+
+    void start() override;
+    PtySlave& slave() noexcept override;
+    void close() override;
+    [[nodiscard]] bool isClosed() const noexcept override;
+    [[nodiscard]] ReadResult read(crispy::BufferObject<char>& storage,
+                                  std::chrono::milliseconds timeout,
+                                  size_t size) override;
+    void wakeupReader() override;
+    [[nodiscard]] int write(char const* buf, size_t size) override;
+    [[nodiscard]] PageSize pageSize() const noexcept override;
+    void resizeScreen(PageSize _cells, std::optional<ImageSize> _pixels = std::nullopt) override;
+
+  private:
+    unsigned paneId_;
+    PageSize pageSize_;
+    CommandWriter writeCommands_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable condition_;
+    std::string output_; //!< output not read yet
+    bool wakeup_ = false;
+    bool closed_ = false;
+    PtySlaveDummy slave_;
+};
+
+} // namespace terminal
@@ -57,6 +57,7 @@ using std::runtime_error;
 using std::scoped_lock;
 using std::string_view;
 using std::tuple;
+using std::vector;
 
 using namespace std::string_literals;
 
@@ -365,6 +366,17 @@ void UnixPty::wakeupReader() noexcept
     (void) rv;
 }
 
+vector<int> UnixPty::readableFileDescriptors()
+{
+    if (_masterFd < 0)
+        return {};
+
+    auto fds = vector<int> { _masterFd, _pipe[0] };
+    if (_stdoutFastPipe.reader() != -1)
+        fds.push_back(_stdoutFastPipe.reader());
+    return fds;
+}
+
 optional<string_view> UnixPty::readSome(int fd, char* target, size_t n) noexcept
 {
     auto const rv = static_cast<int>(::read(fd, target, n));
@@ -85,6 +85,7 @@ class UnixPty: public Pty
     void close() override;
     bool isClosed() const noexcept override;
     void wakeupReader() noexcept override;
+    [[nodiscard]] std::vector<int> readableFileDescriptors() override;
     [[nodiscard]] ReadResult read(crispy::BufferObject<char>& storage,
                                   std::chrono::milliseconds timeout,
                                   size_t size) override;
@@ -19,6 +19,7 @@
 
 #include <algorithm>
 #include <iostream>
+#include <tuple>
 
 namespace terminal::renderer
 {
@@ -34,48 +35,113 @@ void BackgroundRenderer::setRenderTarget(RenderTarget& renderTarget,
     Renderable::setRenderTarget(renderTarget, directMappingAllocator);
 }
 
-void BackgroundRenderer::renderLine(RenderLine const& line)
+void BackgroundRenderer::beginFrame()
 {
-    if (line.textAttributes.backgroundColor != defaultColor_)
-    {
-        auto const position = CellLocation { line.lineOffset, ColumnOffset(0) };
-        auto const pos = _gridMetrics.mapTopLeft(position);
-        auto const width = _gridMetrics.cellSize.width * Width::cast_from(line.usedColumns);
+    spans_.clear();
 
-        renderTarget().renderRectangle(pos.x,
-                                       pos.y,
-                                       width,
-                                       _gridMetrics.cellSize.height,
-                                       RGBAColor(line.textAttributes.backgroundColor, opacity_));
-    }
+    if (!cellGridEnabled_)
+        return;
 
-    if (line.fillAttributes.backgroundColor != defaultColor_)
-    {
-        auto const position = CellLocation { line.lineOffset, boxed_cast<ColumnOffset>(line.usedColumns) };
-        auto const pos = _gridMetrics.mapTopLeft(position);
-        auto const width =
-            _gridMetrics.cellSize.width * Width::cast_from(line.displayWidth - line.usedColumns);
+    auto const origin = _gridMetrics.mapTopLeft(CellLocation {});
+    cellGrid_.x = origin.x;
+    cellGrid_.y = origin.y;
+    cellGrid_.cellSize = _gridMetrics.cellSize;
+    cellGrid_.pageSize = _gridMetrics.pageSize;
+    cellGrid_.colors.assign(static_cast<size_t>(_gridMetrics.pageSize.area()), RGBAColor {});
+}
 
+void BackgroundRenderer::endFrame()
+{
+    if (cellGridEnabled_)
+        renderTarget().renderCellBackgrounds(cellGrid_);
+    else
+        renderSpans();
+}
+
+void BackgroundRenderer::renderSpans()
+{
+    if (spans_.empty())
+        return;
+
+    // Identical spans on consecutive lines become adjacent by this order and are merged into one quad.
+    std::sort(spans_.begin(), spans_.end(), [](Span const& a, Span const& b) {
+        return std::tuple(a.column, a.width, a.color.value(), a.line)
+               < std::tuple(b.column, b.width, b.color.value(), b.line);
+    });
+
+    auto const emit = [&](Span const& span) {
+        auto const pos = _gridMetrics.mapTopLeft(LineOffset(span.line), ColumnOffset(span.column));
         renderTarget().renderRectangle(pos.x,
                                        pos.y,
-                                       width,
-                                       _gridMetrics.cellSize.height,
-                                       RGBAColor(line.fillAttributes.backgroundColor, opacity_));
+                                       _gridMetrics.cellSize.width * Width::cast_from(span.width),
+                                       _gridMetrics.cellSize.height * Height::cast_from(span.height),
+                                       RGBAColor(span.color, opacity_));
+    };
+
+    auto current = spans_.front();
+    for (auto i = std::next(spans_.begin()); i != spans_.end(); ++i)
+    {
+        if (i->column == current.column && i->width == current.width && i->color == current.color
+            && i->line == current.line + current.height)
+        {
+            current.height += i->height;
+            continue;
+        }
+        emit(current);
+        current = *i;
     }
+    emit(current);
+    spans_.clear();
 }
 
-void BackgroundRenderer::renderCell(RenderCell const& _cell)
+void BackgroundRenderer::renderBackground(CellLocation _position, ColumnCount _width, RGBColor _color)
 {
-    if (_cell.attributes.backgroundColor == defaultColor_)
+    if (_color == defaultColor_)
+        return;
+
+    if (!cellGridEnabled_)
+    {
+        // Cells are rendered left to right, so a cell continuing the last span on its line is merged into it.
+        auto const line = _position.line.as<int>();
+        auto const column = _position.column.as<int>();
+        auto const width = unbox<int>(_width);
+        if (!spans_.empty())
+        {
+            auto& last = spans_.back();
+            if (last.line == line && last.column + last.width == column && last.color == _color)
+            {
+                last.width += width;
+                return;
+            }
+        }
+        spans_.emplace_back(Span { line, column, width, 1, _color });
+        return;
+    }
+
+    auto const columns = unbox<int>(cellGrid_.pageSize.columns);
+    if (_position.line < LineOffset(0) || _position.line.as<int>() >= unbox<int>(cellGrid_.pageSize.lines))
         return;
 
-    auto const pos = _gridMetrics.mapTopLeft(_cell.position);
+    auto const first = std::clamp(_position.column.as<int>(), 0, columns);
+    auto const last = std::clamp(_position.column.as<int>() + unbox<int>(_width), 0, columns);
+    auto const row = cellGrid_.colors.begin() + _position.line.as<int>() * columns;
+    std::fill(row + first, row + last, RGBAColor(_color, opacity_));
+}
+
+void BackgroundRenderer::renderLine(RenderLine const& line)
+{
+    renderBackground(CellLocation { line.lineOffset, ColumnOffset(0) },
+                     line.usedColumns,
+                     line.textAttributes.backgroundColor);
 
-    renderTarget().renderRectangle(pos.x,
-                                   pos.y,
-                                   _gridMetrics.cellSize.width * Width::cast_from(_cell.width),
-                                   _gridMetrics.cellSize.height,
-                                   RGBAColor(_cell.attributes.backgroundColor, opacity_));
+    renderBackground(CellLocation { line.lineOffset, boxed_cast<ColumnOffset>(line.usedColumns) },
+                     line.displayWidth - line.usedColumns,
+                     line.fillAttributes.backgroundColor);
+}
+
+void BackgroundRenderer::renderCell(RenderCell const& _cell)
+{
+    renderBackground(_cell.position, ColumnCount::cast_from(_cell.width), _cell.attributes.backgroundColor);
 }
 
 void BackgroundRenderer::inspect(std::ostream& /*output*/) const
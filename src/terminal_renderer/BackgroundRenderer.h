@@ -19,6 +19,7 @@
 #include <terminal_renderer/RenderTarget.h>
 
 #include <memory>
+#include <vector>
 
 namespace terminal::renderer
 {
@@ -39,6 +40,13 @@ class BackgroundRenderer: public Renderable
 
     constexpr void setOpacity(float _value) noexcept { opacity_ = static_cast<uint8_t>(_value * 255.f); }
 
+    /// Enables or disables collecting the cell backgrounds of a frame into a single grid,
+    /// that is rendered in one go, instead of rendering one rectangle per cell.
+    void setCellGrid(bool _enabled) noexcept { cellGridEnabled_ = _enabled; }
+
+    void beginFrame();
+    void endFrame();
+
     // TODO: pass background color directly (instead of whole grid cell),
     // because there is no need to detect bg/fg color more than once per grid cell!
 
@@ -50,9 +58,28 @@ class BackgroundRenderer: public Renderable
     void inspect(std::ostream& output) const override;
 
   private:
+    /// A horizontal run of cells with the same background color, spanning one or more lines.
+    struct Span
+    {
+        int line;
+        int column;
+        int width;
+        int height;
+        RGBColor color;
+    };
+
+    void renderBackground(CellLocation _position, ColumnCount _width, RGBColor _color);
+    void renderSpans();
+
     // private data
     RGBColor const& defaultColor_;
     uint8_t opacity_ = 255;
+
+    bool cellGridEnabled_ = false;
+    CellBackgroundGrid cellGrid_ {};
+
+    // Backgrounds of the current frame that are not rendered via the cell grid.
+    std::vector<Span> spans_;
 };
 
 } // namespace terminal::renderer
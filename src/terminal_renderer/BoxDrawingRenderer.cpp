@@ -13,6 +13,7 @@
  */
 #include <terminal_renderer/BoxDrawingRenderer.h>
 #include <terminal_renderer/Pixmap.h>
+#include <terminal_renderer/shared_defines.h>
 #include <terminal_renderer/utils.h>
 
 #include <crispy/logstore.h>
@@ -23,7 +24,10 @@
 #include <range/v3/view/iota.hpp>
 #include <range/v3/view/zip.hpp>
 
+#include <algorithm>
 #include <array>
+#include <thread>
+#include <vector>
 
 using namespace std::string_view_literals;
 
@@ -53,6 +57,20 @@ namespace
                                                          logstore::Category::State::Disabled,
                                                          logstore::Category::Visibility::Hidden);
 
+    // Codepoint ranges to look for renderable characters when prewarming.
+    constexpr auto PrewarmedRanges = std::array<pair<char32_t, char32_t>, 5> { {
+        { 0x23A1, 0x23A6 },   // mathematical square brackets
+        { 0x2500, 0x259F },   // box drawing, block elements
+        { 0x1FB00, 0x1FBF9 }, // symbols for legacy computing
+        { 0xE0B0, 0xE0BE },   // Powerline
+        { 0xEE00, 0xEE05 },   // progress bar (Fira Code)
+    } };
+
+    crispy::StrongHash tileHash(char32_t codepoint) noexcept
+    {
+        return crispy::StrongHash { 31, 13, 8, static_cast<uint32_t>(codepoint) };
+    }
+
     // TODO: Do not depend on this function but rather construct the pixmaps using the correct Y-coordinates.
     atlas::Buffer invertY(atlas::Buffer const& image, ImageSize cellSize)
     {
@@ -924,6 +942,17 @@ void BoxDrawingRenderer::clearCache()
 
 bool BoxDrawingRenderer::render(LineOffset _line, ColumnOffset _column, char32_t _codepoint, RGBColor _color)
 {
+    if (procedural_)
+    {
+        if (auto const shape = proceduralShape(_codepoint))
+        {
+            auto const pos = _gridMetrics.map(_line, _column);
+            renderTarget().renderBoxDrawing(
+                pos.x, pos.y, _gridMetrics.cellSize, _gridMetrics.underline.thickness, *shape, _color);
+            return true;
+        }
+    }
+
     Renderable::AtlasTileAttributes const* data = getOrCreateCachedTileAttributes(_codepoint);
     if (!data)
         return false;
@@ -944,6 +973,88 @@ bool BoxDrawingRenderer::render(LineOffset _line, ColumnOffset _column, char32_t
     return true;
 }
 
+optional<uint32_t> BoxDrawingRenderer::proceduralShape(char32_t codepoint) noexcept
+{
+    using namespace detail;
+
+    // Left, top, right and bottom of a filled rectangle in eighths of the cell.
+    auto const block = [](uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1) -> uint32_t {
+        return BOX_SHAPE_BLOCK | x0 << 4 | y0 << 8 | x1 << 12 | y1 << 16;
+    };
+    auto const quadrants = [](uint32_t mask) -> uint32_t {
+        return BOX_SHAPE_QUADRANTS | mask << 4;
+    };
+    auto const triangle = [](uint32_t kind) -> uint32_t {
+        return BOX_SHAPE_TRIANGLE | kind << 4;
+    };
+
+    if (0x2500 <= codepoint && codepoint <= 0x257F)
+    {
+        auto const& box = boxDrawingDefinitions[codepoint - 0x2500];
+        auto dashes = uint32_t { 0 };
+        auto const style = [&](Line _line) -> uint32_t {
+            switch (_line)
+            {
+                case NoLine: return BOX_LINE_NONE;
+                case Light: return BOX_LINE_LIGHT;
+                case Double: return BOX_LINE_DOUBLE;
+                case Heavy: return BOX_LINE_HEAVY;
+                case Light2:
+                case Light3:
+                case Light4: dashes = 2u + unsigned(_line - Light2); return BOX_LINE_LIGHT;
+                case Heavy2:
+                case Heavy3:
+                case Heavy4: dashes = 2u + unsigned(_line - Heavy2); return BOX_LINE_HEAVY;
+            }
+            return BOX_LINE_NONE;
+        };
+        auto shape = uint32_t { BOX_SHAPE_LINES };
+        shape |= style(box.left_) << 4 | style(box.up_) << 6;
+        shape |= style(box.right_) << 8 | style(box.down_) << 10;
+        shape |= dashes << 12 | uint32_t(box.diagonal_) << 15 | uint32_t(box.arc_) << 17;
+        return shape;
+    }
+
+    switch (codepoint)
+    {
+        case 0x2580: return block(0, 0, 8, 4); // ▀ UPPER HALF BLOCK
+        case 0x2581: return block(0, 7, 8, 8); // ▁ LOWER ONE EIGHTH BLOCK
+        case 0x2582: return block(0, 6, 8, 8); // ▂ LOWER ONE QUARTER BLOCK
+        case 0x2583: return block(0, 5, 8, 8); // ▃ LOWER THREE EIGHTHS BLOCK
+        case 0x2584: return block(0, 4, 8, 8); // ▄ LOWER HALF BLOCK
+        case 0x2585: return block(0, 3, 8, 8); // ▅ LOWER FIVE EIGHTHS BLOCK
+        case 0x2586: return block(0, 2, 8, 8); // ▆ LOWER THREE QUARTERS BLOCK
+        case 0x2587: return block(0, 1, 8, 8); // ▇ LOWER SEVEN EIGHTHS BLOCK
+        case 0x2588: return block(0, 0, 8, 8); // █ FULL BLOCK
+        case 0x2589: return block(0, 0, 7, 8); // ▉ LEFT SEVEN EIGHTHS BLOCK
+        case 0x258A: return block(0, 0, 6, 8); // ▊ LEFT THREE QUARTERS BLOCK
+        case 0x258B: return block(0, 0, 5, 8); // ▋ LEFT FIVE EIGHTHS BLOCK
+        case 0x258C: return block(0, 0, 4, 8); // ▌ LEFT HALF BLOCK
+        case 0x258D: return block(0, 0, 3, 8); // ▍ LEFT THREE EIGHTHS BLOCK
+        case 0x258E: return block(0, 0, 2, 8); // ▎ LEFT ONE QUARTER BLOCK
+        case 0x258F: return block(0, 0, 1, 8); // ▏ LEFT ONE EIGHTH BLOCK
+        case 0x2590: return block(4, 0, 8, 8); // ▐ RIGHT HALF BLOCK
+        case 0x2594: return block(0, 0, 8, 1); // ▔ UPPER ONE EIGHTH BLOCK
+        case 0x2595: return block(7, 0, 8, 8); // ▕ RIGHT ONE EIGHTH BLOCK
+        case 0x2596: return quadrants(0b0100); // ▖ QUADRANT LOWER LEFT
+        case 0x2597: return quadrants(0b1000); // ▗ QUADRANT LOWER RIGHT
+        case 0x2598: return quadrants(0b0001); // ▘ QUADRANT UPPER LEFT
+        case 0x2599: return quadrants(0b1101); // ▙ QUADRANT UPPER LEFT AND LOWER LEFT AND LOWER RIGHT
+        case 0x259A: return quadrants(0b1001); // ▚ QUADRANT UPPER LEFT AND LOWER RIGHT
+        case 0x259B: return quadrants(0b0111); // ▛ QUADRANT UPPER LEFT AND UPPER RIGHT AND LOWER LEFT
+        case 0x259C: return quadrants(0b1011); // ▜ QUADRANT UPPER LEFT AND UPPER RIGHT AND LOWER RIGHT
+        case 0x259D: return quadrants(0b0010); // ▝ QUADRANT UPPER RIGHT
+        case 0x259E: return quadrants(0b0110); // ▞ QUADRANT UPPER RIGHT AND LOWER LEFT
+        case 0x259F: return quadrants(0b1110); // ▟ QUADRANT UPPER RIGHT AND LOWER LEFT AND LOWER RIGHT
+        case 0xE0B0: return triangle(BOX_TRIANGLE_RIGHT_POINTING); // 
+        case 0xE0B2: return triangle(BOX_TRIANGLE_LEFT_POINTING);  // 
+        case 0xE0BA: return triangle(BOX_TRIANGLE_LOWER_RIGHT);    // 
+        case 0xE0BC: return triangle(BOX_TRIANGLE_UPPER_LEFT);     // 
+        case 0xE0BE: return triangle(BOX_TRIANGLE_UPPER_RIGHT);    // 
+        default: return nullopt;
+    }
+}
+
 constexpr inline bool containsNonCanonicalLines(char32_t codepoint)
 {
     if (codepoint < 0x2500 || codepoint > 0x257F)
@@ -952,20 +1063,22 @@ constexpr inline bool containsNonCanonicalLines(char32_t codepoint)
     return box.diagonal_ != detail::NoDiagonal || box.arc_ != NoArc;
 }
 
-auto BoxDrawingRenderer::createTileData(char32_t codepoint, atlas::TileLocation tileLocation)
-    -> optional<TextureAtlas::TileCreateData>
+auto BoxDrawingRenderer::createTileData(atlas::Buffer bitmap, atlas::TileLocation tileLocation)
+    -> TextureAtlas::TileCreateData
+{
+    return createTileData(tileLocation,
+                          std::move(bitmap),
+                          atlas::Format::Red,
+                          _gridMetrics.cellSize,
+                          RenderTileAttributes::X { 0 },
+                          RenderTileAttributes::Y { 0 },
+                          FRAGMENT_SELECTOR_GLYPH_ALPHA);
+}
+
+optional<atlas::Buffer> BoxDrawingRenderer::buildBitmap(char32_t codepoint) const
 {
     if (optional<atlas::Buffer> image = buildElements(codepoint))
-    {
-        *image = invertY(*image, _gridMetrics.cellSize);
-        return { createTileData(tileLocation,
-                                std::move(*image),
-                                atlas::Format::Red,
-                                _gridMetrics.cellSize,
-                                RenderTileAttributes::X { 0 },
-                                RenderTileAttributes::Y { 0 },
-                                FRAGMENT_SELECTOR_GLYPH_ALPHA) };
-    }
+        return invertY(*image, _gridMetrics.cellSize);
 
     auto const antialiasing = containsNonCanonicalLines(codepoint);
     atlas::Buffer pixels;
@@ -997,26 +1110,70 @@ auto BoxDrawingRenderer::createTileData(char32_t codepoint, atlas::TileLocation
         pixels = std::move(*tmp);
     }
 
-    pixels = invertY(pixels, _gridMetrics.cellSize);
-
-    return { createTileData(tileLocation,
-                            std::move(pixels),
-                            atlas::Format::Red,
-                            _gridMetrics.cellSize,
-                            RenderTileAttributes::X { 0 },
-                            RenderTileAttributes::Y { 0 },
-                            FRAGMENT_SELECTOR_GLYPH_ALPHA) };
+    return invertY(pixels, _gridMetrics.cellSize);
 }
 
 Renderable::AtlasTileAttributes const* BoxDrawingRenderer::getOrCreateCachedTileAttributes(char32_t codepoint)
 {
     return textureAtlas().get_or_try_emplace(
-        crispy::StrongHash { 31, 13, 8, static_cast<uint32_t>(codepoint) },
+        tileHash(codepoint),
+        atlas::Format::Red,
         [this, codepoint](atlas::TileLocation tileLocation) -> optional<TextureAtlas::TileCreateData> {
-            return createTileData(codepoint, tileLocation);
+            if (optional<atlas::Buffer> bitmap = buildBitmap(codepoint))
+                return createTileData(std::move(*bitmap), tileLocation);
+            return nullopt;
         });
 }
 
+size_t BoxDrawingRenderer::prewarm(size_t _threadCount)
+{
+    auto codepoints = std::vector<char32_t> {};
+    for (auto const& [first, last]: PrewarmedRanges)
+        for (char32_t codepoint = first; codepoint <= last; ++codepoint)
+            if (renderable(codepoint) && !textureAtlas().contains(tileHash(codepoint)))
+                codepoints.emplace_back(codepoint);
+
+    // Characters rendered analytically never take up any tiles.
+    if (procedural_)
+    {
+        auto const isProcedural = [](char32_t _codepoint) {
+            return proceduralShape(_codepoint).has_value();
+        };
+        codepoints.erase(std::remove_if(codepoints.begin(), codepoints.end(), isProcedural), codepoints.end());
+    }
+
+    // Do not let the prewarmed tiles push out a significant share of the text glyphs.
+    if (codepoints.empty() || codepoints.size() * 4 > textureAtlas().capacity(atlas::Format::Red))
+        return 0;
+
+    auto bitmaps = std::vector<optional<atlas::Buffer>>(codepoints.size());
+    auto const threadCount = clamp(_threadCount, size_t { 1 }, codepoints.size());
+    auto const buildBitmaps = [&](size_t _first) {
+        for (size_t i = _first; i < codepoints.size(); i += threadCount)
+            bitmaps[i] = buildBitmap(codepoints[i]);
+    };
+
+    auto threads = std::vector<std::thread> {};
+    for (size_t i = 1; i < threadCount; ++i)
+        threads.emplace_back(buildBitmaps, i);
+    buildBitmaps(0);
+    for (auto& thread: threads)
+        thread.join();
+
+    size_t count = 0;
+    for (size_t i = 0; i < codepoints.size(); ++i)
+    {
+        if (!bitmaps[i])
+            continue;
+        textureAtlas().emplace(
+            tileHash(codepoints[i]), atlas::Format::Red, [&](atlas::TileLocation tileLocation) {
+                return createTileData(std::move(*bitmaps[i]), tileLocation);
+            });
+        ++count;
+    }
+    return count;
+}
+
 bool BoxDrawingRenderer::renderable(char32_t codepoint) const noexcept
 {
     auto const ascending = [codepoint](char32_t a, char32_t b) noexcept -> bool {
@@ -1039,7 +1196,7 @@ bool BoxDrawingRenderer::renderable(char32_t codepoint) const noexcept
         ;
 }
 
-optional<atlas::Buffer> BoxDrawingRenderer::buildElements(char32_t codepoint)
+optional<atlas::Buffer> BoxDrawingRenderer::buildElements(char32_t codepoint) const
 {
     using namespace detail;
 
@@ -1550,7 +1707,7 @@ optional<atlas::Buffer> BoxDrawingRenderer::buildElements(char32_t codepoint)
 
 optional<atlas::Buffer> BoxDrawingRenderer::buildBoxElements(char32_t _codepoint,
                                                              ImageSize _size,
-                                                             int _lineThickness)
+                                                             int _lineThickness) const
 {
     if (!(_codepoint >= 0x2500 && _codepoint <= 0x257F))
         return nullopt;
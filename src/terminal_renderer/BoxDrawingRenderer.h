@@ -22,6 +22,7 @@
 #include <crispy/point.h>
 
 #include <array>
+#include <optional>
 
 namespace terminal::renderer
 {
@@ -45,24 +46,46 @@ class BoxDrawingRenderer: public Renderable
 
     [[nodiscard]] bool renderable(char32_t codepoint) const noexcept;
 
+    /// Enables rendering the characters that have a shape (see proceduralShape()) analytically
+    /// on the render target, rather than rasterizing them into the texture atlas.
+    void setProcedural(bool _enabled) noexcept { procedural_ = _enabled; }
+
+    /// @returns the shape to render the given character by (see BOX_SHAPE_* in shared_defines.h),
+    ///          or nothing if it can only be rasterized.
+    [[nodiscard]] static std::optional<uint32_t> proceduralShape(char32_t codepoint) noexcept;
+
     /// Renders boxdrawing character.
     ///
     /// @param _char the boxdrawing character's codepoint.
     [[nodiscard]] bool render(LineOffset _line, ColumnOffset _column, char32_t codepoint, RGBColor _color);
 
+    /// Rasterizes all renderable characters for the current cell size that are not in the
+    /// texture atlas yet, such that rendering them later on never has to rasterize.
+    ///
+    /// The bitmaps are built on up to @p _threadCount threads and then uploaded at once.
+    ///
+    /// @returns the number of tiles created.
+    size_t prewarm(size_t _threadCount);
+
     void inspect(std::ostream& output) const override;
 
   private:
     AtlasTileAttributes const* getOrCreateCachedTileAttributes(char32_t codepoint);
 
     using Renderable::createTileData;
-    [[nodiscard]] std::optional<TextureAtlas::TileCreateData> createTileData(
-        char32_t codepoint, atlas::TileLocation tileLocation);
+    [[nodiscard]] TextureAtlas::TileCreateData createTileData(atlas::Buffer bitmap,
+                                                              atlas::TileLocation tileLocation);
+
+    /// Builds the bitmap of the given character. Only depends on the grid metrics,
+    /// and thus may be invoked from any thread.
+    [[nodiscard]] std::optional<atlas::Buffer> buildBitmap(char32_t codepoint) const;
 
     [[nodiscard]] std::optional<atlas::Buffer> buildBoxElements(char32_t codepoint,
                                                                 ImageSize _size,
-                                                                int _lineThickness);
-    [[nodiscard]] std::optional<atlas::Buffer> buildElements(char32_t codepoint);
+                                                                int _lineThickness) const;
+    [[nodiscard]] std::optional<atlas::Buffer> buildElements(char32_t codepoint) const;
+
+    bool procedural_ = false;
 };
 
 } // namespace terminal::renderer
@@ -57,7 +57,23 @@ namespace
         pair { CellFlags::Framed, Decorator::Framed },
         pair { CellFlags::Encircled, Decorator::Encircle },
     };
-}
+
+    /// Tests whether the decoration's tile is the same in every pixel column,
+    /// so that it can be stretched across multiple grid cells.
+    constexpr bool isHorizontallyUniform(Decorator decoration) noexcept
+    {
+        switch (decoration)
+        {
+            case Decorator::Underline:
+            case Decorator::DoubleUnderline:
+            case Decorator::Overline:
+            case Decorator::CrossedOut:
+            case Decorator::Encircle: // rendered as Underline
+                return true;
+            default: return false;
+        }
+    }
+} // namespace
 
 DecorationRenderer::DecorationRenderer(GridMetrics const& _gridMetrics,
                                        Decorator _hyperlinkNormal,
@@ -116,11 +132,39 @@ void DecorationRenderer::renderLine(RenderLine const& line)
 void DecorationRenderer::renderCell(RenderCell const& _cell)
 {
     for (auto const& mapping: CellFlagDecorationMappings)
-        if (_cell.attributes.flags & mapping.first)
-            renderDecoration(mapping.second,
-                             _gridMetrics.mapBottomLeft(_cell.position),
-                             ColumnCount(1),
-                             _cell.attributes.decorationColor);
+    {
+        if (!(_cell.attributes.flags & mapping.first))
+            continue;
+
+        // Consecutive cells of a line with the same decoration are rendered as one run.
+        auto& run = pendingRuns_[static_cast<size_t>(mapping.second)];
+        if (run && run->position.line == _cell.position.line
+            && run->position.column + boxed_cast<ColumnOffset>(run->columnCount) == _cell.position.column
+            && run->color == _cell.attributes.decorationColor)
+        {
+            ++run->columnCount;
+            continue;
+        }
+
+        flushRun(mapping.second);
+        run = PendingRun { _cell.position, ColumnCount(1), _cell.attributes.decorationColor };
+    }
+}
+
+void DecorationRenderer::endFrame()
+{
+    for (Decorator const decoration: each_element<Decorator>())
+        flushRun(decoration);
+}
+
+void DecorationRenderer::flushRun(Decorator decoration)
+{
+    auto& run = pendingRuns_[static_cast<size_t>(decoration)];
+    if (!run)
+        return;
+
+    renderDecoration(decoration, _gridMetrics.mapBottomLeft(run->position), run->columnCount, run->color);
+    run.reset();
 }
 
 auto DecorationRenderer::createTileData(Decorator decoration, atlas::TileLocation tileLocation)
@@ -305,17 +349,24 @@ void DecorationRenderer::renderDecoration(Decorator decoration,
                                           ColumnCount columnCount,
                                           RGBColor const& color)
 {
-    for (auto i = ColumnCount(0); i < columnCount; ++i)
+    auto const tileIndex = _directMapping.toTileIndex(static_cast<uint32_t>(decoration));
+    AtlasTileAttributes const& tileAttributes = _textureAtlas->directMapped(tileIndex);
+    auto const y = atlas::RenderTile::Y { pos.y - unbox<int>(tileAttributes.bitmapSize.height) };
+
+    if (isHorizontallyUniform(decoration))
     {
-        auto const tileIndex = _directMapping.toTileIndex(static_cast<uint32_t>(decoration));
-        auto const tileLocation = _textureAtlas->tileLocation(tileIndex);
-        TextureAtlas::TileCreateData tileData = createTileData(decoration, tileLocation);
-        AtlasTileAttributes const& tileAttributes = _textureAtlas->directMapped(tileIndex);
+        // The tile looks the same in every column, so it is stretched across the whole run.
+        auto tile = createRenderTile({ pos.x }, y, color, tileAttributes);
+        tile.targetSize.width = _gridMetrics.cellSize.width * Width::cast_from(columnCount);
+        textureScheduler().renderTile(std::move(tile));
+        return;
+    }
+
+    for (auto i = ColumnCount(0); i < columnCount; ++i)
         renderTile({ pos.x + unbox<int>(i) * unbox<int>(_gridMetrics.cellSize.width) },
-                   { pos.y - unbox<int>(tileAttributes.bitmapSize.height) },
+                   y,
                    color,
                    tileAttributes);
-    }
 }
 
 } // namespace terminal::renderer
@@ -20,6 +20,10 @@
 #include <terminal_renderer/RenderTarget.h>
 #include <terminal_renderer/TextureAtlas.h>
 
+#include <array>
+#include <limits>
+#include <optional>
+
 namespace terminal::renderer
 {
 
@@ -52,6 +56,9 @@ class DecorationRenderer: public Renderable
     void renderCell(RenderCell const& _cell);
     void renderLine(RenderLine const& line);
 
+    /// Renders the decorations of cells that are still pending to be merged with their successors.
+    void endFrame();
+
     void renderDecoration(Decorator _decoration,
                           crispy::Point _pos,
                           ColumnCount columnCount,
@@ -67,12 +74,22 @@ class DecorationRenderer: public Renderable
     void initializeDirectMapping();
     using Renderable::createTileData;
     TextureAtlas::TileCreateData createTileData(Decorator decoration, atlas::TileLocation tileLocation);
+    void flushRun(Decorator decoration);
+
+    /// A run of consecutive cells on a line with the same decoration and decoration color.
+    struct PendingRun
+    {
+        CellLocation position;
+        ColumnCount columnCount;
+        RGBColor color;
+    };
 
     // private data members
     //
     DirectMapping _directMapping;
     Decorator hyperlinkNormal_ = Decorator::DottedUnderline;
     Decorator hyperlinkHover_ = Decorator::Underline;
+    std::array<std::optional<PendingRun>, std::numeric_limits<Decorator>::count()> pendingRuns_ {};
 };
 
 } // namespace terminal::renderer
@@ -0,0 +1,137 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal_renderer/GlyphRasterizerPool.h>
+#include <terminal_renderer/utils.h>
+
+#include <algorithm>
+#include <iterator>
+
+using std::lock_guard;
+using std::optional;
+using std::unique_lock;
+using std::vector;
+
+namespace terminal::renderer
+{
+
+GlyphRasterizerPool::GlyphRasterizerPool(size_t _threadCount, RasterizeFn _rasterize):
+    rasterize_ { std::move(_rasterize) },
+    requested_ { crispy::StrongLRUHashtable<bool>::create(crispy::StrongHashtableSize { 8192 },
+                                                          crispy::LRUCapacity { 4096 },
+                                                          "Requested glyph rasterizations") }
+{
+    RendererLog()("Rasterizing glyphs on {} worker threads.", _threadCount);
+    for (size_t i = 0; i < _threadCount; ++i)
+        threads_.emplace_back(&GlyphRasterizerPool::workerLoop, this);
+}
+
+GlyphRasterizerPool::~GlyphRasterizerPool()
+{
+    {
+        auto const _ = lock_guard { mutex_ };
+        stopping_ = true;
+    }
+    wakeup_.notify_all();
+
+    for (auto& thread: threads_)
+        thread.join();
+}
+
+bool GlyphRasterizerPool::request(crispy::StrongHash const& _hash,
+                                  text::glyph_key const& _glyph,
+                                  unicode::PresentationStyle _presentation)
+{
+    {
+        auto const _ = lock_guard { mutex_ };
+        if (bool const* pending = requested_->try_get(_hash))
+            return *pending;
+        requested_->emplace(_hash, true);
+        requests_.emplace_back(Request { _hash, _glyph, _presentation, generation_.load() });
+    }
+    wakeup_.notify_one();
+    return true;
+}
+
+size_t GlyphRasterizerPool::fetchResults(vector<Result>& _output, size_t _limit)
+{
+    auto const _ = lock_guard { mutex_ };
+
+    auto const count = std::min(_limit, results_.size());
+    for (size_t i = 0; i < count; ++i)
+    {
+        Result& result = results_[i];
+        // Failed glyphs stay marked as requested, so that they are not attempted again.
+        if (result.bitmap)
+            requested_->remove(result.hash);
+        else
+            requested_->emplace(result.hash, false);
+        _output.emplace_back(std::move(result));
+    }
+    results_.erase(results_.begin(), std::next(results_.begin(), static_cast<std::ptrdiff_t>(count)));
+    return count;
+}
+
+bool GlyphRasterizerPool::pending() const
+{
+    auto const _ = lock_guard { mutex_ };
+    return !requests_.empty() || inProgress_ != 0 || !results_.empty();
+}
+
+void GlyphRasterizerPool::discard()
+{
+    ++generation_;
+    {
+        auto const _ = lock_guard { mutex_ };
+        requests_.clear();
+        results_.clear();
+        requested_->clear();
+    }
+
+    // Wait for the rasterization in progress, if any. Workers that have not started yet
+    // will see the new generation and skip their request.
+    auto const _ = lock_guard { shaperLock_ };
+}
+
+void GlyphRasterizerPool::workerLoop()
+{
+    auto lock = unique_lock { mutex_ };
+    while (true)
+    {
+        wakeup_.wait(lock, [this]() { return stopping_ || !requests_.empty(); });
+        if (stopping_)
+            return;
+
+        auto const request = requests_.front();
+        requests_.pop_front();
+        ++inProgress_;
+        lock.unlock();
+
+        auto bitmap = optional<text::rasterized_glyph> {};
+        auto stale = false;
+        {
+            auto const _ = lock_guard { shaperLock_ };
+            stale = request.generation != generation_.load();
+            if (!stale)
+                bitmap = rasterize_(request.glyph, request.presentation);
+        }
+
+        lock.lock();
+        --inProgress_;
+        if (!stale && request.generation == generation_.load())
+            results_.emplace_back(
+                Result { request.hash, request.glyph, request.presentation, std::move(bitmap) });
+    }
+}
+
+} // namespace terminal::renderer
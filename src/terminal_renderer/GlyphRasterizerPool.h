@@ -0,0 +1,117 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <text_shaper/shaper.h>
+
+#include <crispy/StrongHash.h>
+#include <crispy/StrongLRUHashtable.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace terminal::renderer
+{
+
+/**
+ * Rasterizes glyphs on a pool of worker threads, such that glyphs missing in the
+ * texture atlas do not stall the render thread.
+ *
+ * The text shaper is not thread-safe. Therefore the rasterize function is always invoked
+ * with shaperLock() held, and any other use of the shaper must hold it, too,
+ * for as long as the pool is running.
+ */
+class GlyphRasterizerPool
+{
+  public:
+    using RasterizeFn = std::function<std::optional<text::rasterized_glyph>(text::glyph_key const&,
+                                                                            unicode::PresentationStyle)>;
+
+    struct Result
+    {
+        crispy::StrongHash hash;
+        text::glyph_key glyph;
+        unicode::PresentationStyle presentation;
+        std::optional<text::rasterized_glyph> bitmap; // std::nullopt if rasterization failed
+    };
+
+    GlyphRasterizerPool(size_t _threadCount, RasterizeFn _rasterize);
+    ~GlyphRasterizerPool();
+
+    GlyphRasterizerPool(GlyphRasterizerPool const&) = delete;
+    GlyphRasterizerPool& operator=(GlyphRasterizerPool const&) = delete;
+
+    [[nodiscard]] std::mutex& shaperLock() noexcept { return shaperLock_; }
+
+    /// Queues the given glyph for rasterization, unless it has been requested already.
+    ///
+    /// Glyphs that failed to rasterize are not requested again until discard() is called.
+    ///
+    /// @retval true  the glyph is (or has just been) queued for rasterization.
+    /// @retval false the glyph failed to rasterize before.
+    bool request(crispy::StrongHash const& _hash,
+                 text::glyph_key const& _glyph,
+                 unicode::PresentationStyle _presentation);
+
+    /// Moves up to @p _limit rasterized glyphs into @p _output.
+    ///
+    /// @returns the number of glyphs moved.
+    size_t fetchResults(std::vector<Result>& _output, size_t _limit);
+
+    /// @returns whether there are glyphs still being rasterized or waiting to be fetched.
+    [[nodiscard]] bool pending() const;
+
+    /// Drops all queued and finished rasterizations and waits for the ones in progress.
+    ///
+    /// Afterwards the shaper may be reconfigured, e.g. due to a change of the font size.
+    void discard();
+
+  private:
+    struct Request
+    {
+        crispy::StrongHash hash;
+        text::glyph_key glyph;
+        unicode::PresentationStyle presentation;
+        uint64_t generation;
+    };
+
+    void workerLoop();
+
+    RasterizeFn rasterize_;
+    std::mutex shaperLock_;
+
+    // Incremented by discard(), such that requests queued before are skipped.
+    std::atomic<uint64_t> generation_ = 0;
+
+    mutable std::mutex mutex_; // guards all members below
+    std::condition_variable wakeup_;
+    bool stopping_ = false;
+    std::deque<Request> requests_;
+    std::vector<Result> results_;
+    size_t inProgress_ = 0;
+
+    // Glyphs that have been requested and not been fetched yet (true), or that failed to rasterize (false).
+    crispy::StrongLRUHashtable<bool>::Ptr requested_;
+
+    std::vector<std::thread> threads_;
+};
+
+} // namespace terminal::renderer
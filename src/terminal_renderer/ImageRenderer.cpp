@@ -16,19 +16,46 @@
 #include <crispy/algorithm.h>
 #include <crispy/times.h>
 
+#include <fmt/format.h>
+
+#include <algorithm>
 #include <array>
+#include <utility>
 
 using crispy::times;
 
 using std::array;
+using std::min;
 using std::nullopt;
 using std::optional;
 
 namespace terminal::renderer
 {
 
+namespace
+{
+    // Maximum texture size in either dimension, as supported by any OpenGL (ES) 3 implementation.
+    constexpr auto MaxImageTextureSize = 2048u;
+
+    /// @returns the size in pixels of the given number of grid cells.
+    ImageSize spannedSize(ImageSize _cellSize, GridSize _cellSpan) noexcept
+    {
+        return ImageSize { _cellSize.width * boxed_cast<Width>(_cellSpan.columns),
+                           _cellSize.height * boxed_cast<Height>(_cellSpan.lines) };
+    }
+
+    /// @returns the bounds the texture memory budget is adapted within, given the configured budget.
+    crispy::AdaptiveCapacity::Limits textureMemoryBudgetLimits(size_t _bytes) noexcept
+    {
+        return crispy::AdaptiveCapacity::Limits { _bytes / 4, _bytes * 4 };
+    }
+} // namespace
+
 ImageRenderer::ImageRenderer(GridMetrics const& gridMetrics, ImageSize cellSize):
-    Renderable { gridMetrics }, cellSize_ { cellSize }
+    Renderable { gridMetrics },
+    cellSize_ { cellSize },
+    adaptiveTextureMemoryBudget_ { DefaultTextureMemoryBudget,
+                                   textureMemoryBudgetLimits(DefaultTextureMemoryBudget) }
 {
 }
 
@@ -45,19 +72,70 @@ void ImageRenderer::setCellSize(ImageSize _cellSize)
     // TODO: recompute rasterized images slices here?
 }
 
-void ImageRenderer::renderImage(crispy::Point _pos, ImageFragment const& fragment)
+void ImageRenderer::setTextureMemoryBudget(size_t _bytes)
+{
+    adaptiveTextureMemoryBudget_ = crispy::AdaptiveCapacity(_bytes, textureMemoryBudgetLimits(_bytes));
+    imageTextureMemoryBudget_ = _bytes;
+    enforceTextureMemoryBudget();
+}
+
+void ImageRenderer::adaptTextureMemoryBudget(bool _memoryPressure)
 {
-    // std::cout << fmt::format("ImageRenderer.renderImage: {}\n", fragment);
+    imageTextureMemoryBudget_ = adaptiveTextureMemoryBudget_.adapt(_memoryPressure);
+    enforceTextureMemoryBudget();
+}
+
+void ImageRenderer::renderImage(crispy::Point _pos, RenderImage const& _renderImage)
+{
+    auto const& image = *_renderImage.image;
+    if (!image.ready())
+    {
+        // The image is still being resized, leave its cells blank until it is ready.
+        placeholdersRendered_ = true;
+        return;
+    }
 
-    AtlasTileAttributes const* tileAttributes = getOrCreateCachedTileAttributes(fragment);
-    if (!tileAttributes)
+    if (ImageTexture const* texture = getOrCreateImageTexture(image))
+    {
+        // The whole row of cells is rendered as one sub-rectangle of the image's texture.
+        auto const columns = unbox<float>(image.cellSpan().columns);
+        auto const lines = unbox<float>(image.cellSpan().lines);
+        auto const size = spannedSize(cellSize_, GridSize { LineCount(1), _renderImage.columns });
+
+        auto tile = atlas::RenderTile {};
+        tile.x = atlas::RenderTile::X { _pos.x };
+        tile.y = atlas::RenderTile::Y { _pos.y };
+        tile.bitmapSize = size;
+        tile.targetSize = size;
+        tile.color = atlas::normalize(RGBAColor::White);
+        tile.normalizedLocation = atlas::NormalizedTileLocation {
+            unbox<float>(_renderImage.offset.column) / columns,
+            unbox<float>(_renderImage.offset.line) / lines,
+            unbox<float>(_renderImage.columns) / columns,
+            1.0f / lines,
+        };
+        tile.fragmentShaderSelector = FRAGMENT_SELECTOR_IMAGE_BGRA;
+        tile.imageTextureId = texture->id;
+        pendingRenderTilesAboveText_.emplace_back(tile);
         return;
+    }
 
-    // clang-format off
-    pendingRenderTilesAboveText_.emplace_back(createRenderTile(atlas::RenderTile::X { _pos.x },
-                                                               atlas::RenderTile::Y { _pos.y },
-                                                               RGBAColor::White, *tileAttributes));
-    // clang-format on
+    // Texture atlas tiles are of the size of one grid cell.
+    for (auto const i: times(unbox<int>(_renderImage.columns)))
+    {
+        auto const offset = CellLocation { _renderImage.offset.line,
+                                           _renderImage.offset.column + ColumnOffset::cast_from(i) };
+        AtlasTileAttributes const* tileAttributes = getOrCreateCachedTileAttributes(image, offset);
+        if (!tileAttributes)
+            continue;
+
+        // clang-format off
+        pendingRenderTilesAboveText_.emplace_back(
+            createRenderTile(atlas::RenderTile::X { _pos.x + i * unbox<int>(cellSize_.width) },
+                             atlas::RenderTile::Y { _pos.y },
+                             RGBAColor::White, *tileAttributes));
+        // clang-format on
+    }
 }
 
 void ImageRenderer::onBeforeRenderingText()
@@ -78,6 +156,8 @@ void ImageRenderer::onAfterRenderingText()
 void ImageRenderer::beginFrame()
 {
     assert(pendingRenderTilesAboveText_.empty());
+    ++frame_;
+    placeholdersRendered_ = false;
 }
 
 void ImageRenderer::endFrame()
@@ -90,27 +170,25 @@ void ImageRenderer::endFrame()
             textureScheduler().renderTile(std::move(tile));
         pendingRenderTilesAboveText_.clear();
     }
+
+    // The image textures are limited by their memory rather than by their number.
+    adaptiveTextureMemoryBudget_.record(imageTextureStats_);
+    imageTextureCacheStats_.update(std::exchange(imageTextureStats_, {}), imageTextures_.size(), 0);
+    imageTextureMemoryStats_.update(imageTextureMemory_, imageTextures_.size());
 }
 
 Renderable::AtlasTileAttributes const* ImageRenderer::getOrCreateCachedTileAttributes(
-    ImageFragment const& fragment)
-{
-    // using crispy::StrongHash;
-    // auto const hash = StrongHash::compute(fragment.rasterizedImage().image().id().value)
-    //                   * fragment.offset().column.value * fragment.offset().line.value
-    //                   * fragment.rasterizedImage().cellSize().width.value
-    //                   * fragment.rasterizedImage().cellSize().height.value;
-    auto const key = ImageFragmentKey { fragment.rasterizedImage().image().id(),
-                                        fragment.offset(),
-                                        fragment.rasterizedImage().cellSize() };
+    RasterizedImage const& image, CellLocation offset)
+{
+    auto const key = ImageFragmentKey { image.imageId(), offset, image.cellSize() };
     auto const hash = crispy::StrongHash::compute(key);
 
     return textureAtlas().get_or_try_emplace(
-        hash, [&](atlas::TileLocation tileLocation) -> optional<TextureAtlas::TileCreateData> {
+        hash, atlas::Format::RGBA, [&](atlas::TileLocation tileLocation) -> optional<TextureAtlas::TileCreateData> {
             return createTileData(tileLocation,
-                                  fragment.data(),
+                                  image.fragment(offset),
                                   atlas::Format::RGBA,
-                                  fragment.rasterizedImage().cellSize(),
+                                  image.cellSize(),
                                   cellSize_,
                                   RenderTileAttributes::X { 0 },
                                   RenderTileAttributes::Y { 0 },
@@ -118,20 +196,98 @@ Renderable::AtlasTileAttributes const* ImageRenderer::getOrCreateCachedTileAttri
         });
 }
 
-void ImageRenderer::discardImage(ImageId /*_imageId*/)
+auto ImageRenderer::getOrCreateImageTexture(RasterizedImage const& image) -> ImageTexture const*
+{
+    if (!imageTextureMemoryBudget_ || !image.cellSpan().lines || !image.cellSpan().columns)
+        return nullptr;
+
+    // The texture is never larger than the image is displayed with, nor larger than the image.
+    auto const sourceSize = image.pixelSize();
+    auto const displaySize = spannedSize(cellSize_, image.cellSpan());
+    auto const textureSize =
+        ImageSize { Width(min({ sourceSize.width.value, displaySize.width.value, MaxImageTextureSize })),
+                    Height(min({ sourceSize.height.value, displaySize.height.value, MaxImageTextureSize })) };
+
+    auto const key = ImageTextureKey {
+        image.imageId(), image.cellSpan(), image.cellSize(), image.defaultColor().value
+    };
+
+    if (auto const i = imageTextureByKey_.find(key); i != imageTextureByKey_.end())
+    {
+        auto const texture = i->second;
+        // Smaller cells are rendered from the mipmaps, whereas larger ones need more pixels.
+        if (texture->size.width >= textureSize.width && texture->size.height >= textureSize.height)
+        {
+            texture->lastFrame = frame_;
+            imageTextures_.splice(imageTextures_.begin(), imageTextures_, texture);
+            ++imageTextureStats_.hits;
+            return &*texture;
+        }
+        destroyImageTexture(texture);
+    }
+    ++imageTextureStats_.misses;
+
+    auto const memorySize = textureSize.area() * 4 * 4 / 3;
+    if (!textureSize.area() || memorySize > imageTextureMemoryBudget_)
+        return nullptr;
+
+    auto const id = nextImageTextureId_++;
+    textureScheduler().uploadImage(
+        atlas::UploadImage { id, resizeImage(*image.pixels(), sourceSize, textureSize), textureSize });
+
+    imageTextures_.emplace_front(ImageTexture { key, id, textureSize, memorySize, frame_ });
+    imageTextureByKey_.emplace(key, imageTextures_.begin());
+    imageTextureMemory_ += memorySize;
+    enforceTextureMemoryBudget();
+
+    return &imageTextures_.front();
+}
+
+void ImageRenderer::destroyImageTexture(std::list<ImageTexture>::iterator texture)
+{
+    if (renderTargetAvailable())
+        textureScheduler().destroyImage(texture->id);
+    imageTextureMemory_ -= texture->memorySize;
+    imageTextureByKey_.erase(texture->key);
+    imageTextures_.erase(texture);
+}
+
+void ImageRenderer::enforceTextureMemoryBudget()
+{
+    // Textures rendered in the current frame are kept, as they are still to be drawn.
+    while (imageTextureMemory_ > imageTextureMemoryBudget_ && !imageTextures_.empty()
+           && imageTextures_.back().lastFrame != frame_)
+    {
+        destroyImageTexture(std::prev(imageTextures_.end()));
+        ++imageTextureStats_.recycles;
+    }
+}
+
+void ImageRenderer::discardImage(ImageId _imageId)
 {
-    // We currently don't really discard.
-    // Because the GPU texture atlas is resource-guarded by an LRU hashtable.
+    // Atlas tiles are resource-guarded by the atlas' LRU hashtable,
+    // whereas image textures are released right away.
+    for (auto i = imageTextures_.begin(); i != imageTextures_.end();)
+    {
+        auto const texture = i++;
+        if (texture->key.imageId == _imageId)
+            destroyImageTexture(texture);
+    }
 }
 
 void ImageRenderer::clearCache()
 {
-    // We currently don't really clean up anything.
-    // Because the GPU texture atlas is resource-guarded by an LRU hashtable.
+    // Atlas tiles are resource-guarded by the atlas' LRU hashtable.
+    while (!imageTextures_.empty())
+        destroyImageTexture(imageTextures_.begin());
 }
 
-void ImageRenderer::inspect(std::ostream& /*output*/) const
+void ImageRenderer::inspect(std::ostream& output) const
 {
+    output << fmt::format("Image textures: {} using {} of {} bytes\n",
+                          imageTextures_.size(),
+                          imageTextureMemory_,
+                          imageTextureMemoryBudget_);
 }
 
 } // namespace terminal::renderer
@@ -14,15 +14,22 @@
 #pragma once
 
 #include <terminal/Image.h>
+#include <terminal/RenderBuffer.h>
 
 #include <terminal_renderer/RenderTarget.h>
 #include <terminal_renderer/TextRenderer.h>
 
+#include <crispy/AdaptiveCapacity.h>
+#include <crispy/CacheStats.h>
+#include <crispy/MemoryStats.h>
 #include <crispy/FNV.h>
 #include <crispy/point.h>
 #include <crispy/size.h>
 
+#include <list>
+#include <map>
 #include <memory>
+#include <tuple>
 #include <unordered_map>
 #include <vector>
 
@@ -49,12 +56,42 @@ struct ImageFragmentKey
     }
 };
 
+/// Identifies a rasterized image that is uploaded into a texture of its own.
+struct ImageTextureKey
+{
+    ImageId imageId;
+    GridSize cellSpan;
+    ImageSize cellSize;
+    uint32_t defaultColor;
+
+    bool operator<(ImageTextureKey const& b) const noexcept
+    {
+        auto const tied = [](ImageTextureKey const& k) {
+            return std::tie(k.imageId,
+                            k.cellSpan.lines,
+                            k.cellSpan.columns,
+                            k.cellSize.width,
+                            k.cellSize.height,
+                            k.defaultColor);
+        };
+        return tied(*this) < tied(b);
+    }
+};
+
 /// Image Rendering API.
 ///
 /// Can render any arbitrary RGBA image (for example Sixel Graphics images).
+///
+/// Each rasterized image is uploaded once into a texture of its own, downscaled to the size it is
+/// displayed with, and each row of cells displaying it is rendered as one sub-rectangle of that texture.
+/// The textures are bounded by a memory budget, evicting the least recently used ones.
+/// Fragments of images that do not fit into the budget are uploaded as texture atlas tiles instead.
 class ImageRenderer: public Renderable, public TextRendererEvents
 {
   public:
+    /// Default GPU memory budget for image textures, in bytes.
+    static constexpr size_t DefaultTextureMemoryBudget = 256 * 1024 * 1024;
+
     ImageRenderer(GridMetrics const& gridMetrics, ImageSize cellSize);
 
     void setRenderTarget(RenderTarget& renderTarget, DirectMappingAllocator& directMappingAllocator) override;
@@ -63,7 +100,20 @@ class ImageRenderer: public Renderable, public TextRendererEvents
     /// Reconfigures the slicing properties of existing images.
     void setCellSize(ImageSize _cellSize);
 
-    void renderImage(crispy::Point _pos, ImageFragment const& fragment);
+    /// Limits the GPU memory used for image textures to the given number of bytes.
+    ///
+    /// A budget of 0 uploads all images as texture atlas tiles.
+    ///
+    /// The budget is adapted at runtime between a fourth and four times the given one,
+    /// see adaptTextureMemoryBudget().
+    void setTextureMemoryBudget(size_t _bytes);
+
+    /// Grows or shrinks the texture memory budget according to the hit rate of the image textures
+    /// since the last call and the memory pressure.
+    void adaptTextureMemoryBudget(bool _memoryPressure);
+
+    /// Renders the given row of an image, with its first cell at the given pixel position.
+    void renderImage(crispy::Point _pos, RenderImage const& _renderImage);
 
     /// notify underlying cache that this fragment is not going to be rendered anymore, maybe freeing up some
     /// GPU caches.
@@ -74,16 +124,48 @@ class ImageRenderer: public Renderable, public TextRendererEvents
     void beginFrame();
     void endFrame();
 
+    /// @returns whether the last frame left the cells of images blank that were not ready yet.
+    [[nodiscard]] bool placeholdersRendered() const noexcept { return placeholdersRendered_; }
+
     void onBeforeRenderingText() override;
     void onAfterRenderingText() override;
 
   private:
-    AtlasTileAttributes const* getOrCreateCachedTileAttributes(ImageFragment const& fragment);
+    struct ImageTexture
+    {
+        ImageTextureKey key;
+        uint32_t id;        // image texture ID at the render target
+        ImageSize size;     // texture size in pixels
+        size_t memorySize;  // estimated GPU memory in bytes, including mipmaps
+        uint64_t lastFrame; // frame the texture was last rendered in
+    };
+
+    /// Returns the texture atlas tile of the given grid cell of an image.
+    AtlasTileAttributes const* getOrCreateCachedTileAttributes(RasterizedImage const& image,
+                                                               CellLocation offset);
+    ImageTexture const* getOrCreateImageTexture(RasterizedImage const& image);
+    void destroyImageTexture(std::list<ImageTexture>::iterator texture);
+    void enforceTextureMemoryBudget();
+
     std::vector<atlas::RenderTile> pendingRenderTilesAboveText_;
 
     // private data
     //
     ImageSize cellSize_;
+
+    std::list<ImageTexture> imageTextures_; // most recently used first
+    std::map<ImageTextureKey, std::list<ImageTexture>::iterator> imageTextureByKey_;
+    size_t imageTextureMemory_ = 0;
+    size_t imageTextureMemoryBudget_ = DefaultTextureMemoryBudget;
+    crispy::AdaptiveCapacity adaptiveTextureMemoryBudget_;
+    uint32_t nextImageTextureId_ = 1;
+    uint64_t frame_ = 0;
+    bool placeholdersRendered_ = false;
+
+    // Image texture lookups since the stats have last been published at the end of a frame.
+    crispy::LRUHashtableStats imageTextureStats_ {};
+    crispy::CacheStats imageTextureCacheStats_ { "Image textures" };
+    crispy::MemoryStats imageTextureMemoryStats_ { "Image textures (GPU)" };
 };
 
 } // namespace terminal::renderer
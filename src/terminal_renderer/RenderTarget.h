@@ -92,6 +92,28 @@ struct RenderTileAttributes
     ImageSize targetSize {};
 };
 
+/**
+ * Horizontal stripe of the render target that has to be rendered again,
+ * spanning the full width of the render target.
+ */
+struct DamagedArea
+{
+    int top;       //!< pixel row of the top of the area, counted from the top of the render target
+    Height height; //!< height of the area in pixels
+};
+
+/**
+ * Background colors of the grid cells, to be rendered in one go rather than cell by cell.
+ */
+struct CellBackgroundGrid
+{
+    int x;                         //!< left pixel of the first cell
+    int y;                         //!< top pixel of the first cell
+    ImageSize cellSize;            //!< size of a single cell in pixels
+    PageSize pageSize;             //!< number of cells
+    std::vector<RGBAColor> colors; //!< one color per cell, line by line; transparent for no background
+};
+
 /**
  * Terminal render target interface, for example OpenGL, DirectX, or software-rasterization.
  *
@@ -121,15 +143,47 @@ class RenderTarget
     /// Fills a rectangular area with the given solid color.
     virtual void renderRectangle(int x, int y, Width, Height, RGBAColor color) = 0;
 
+    /// Fills the cells of the given grid with their respective background colors.
+    virtual void renderCellBackgrounds(CellBackgroundGrid const& _grid) = 0;
+
+    /// Renders a box drawing character filling the grid cell at the given position, evaluating
+    /// its shape (see BOX_SHAPE_* in shared_defines.h) analytically instead of from a texture atlas tile.
+    virtual void renderBoxDrawing(
+        int x, int y, ImageSize _cellSize, int _lineThickness, uint32_t _shape, RGBAColor _color) = 0;
+
     using ScreenshotCallback =
         std::function<void(std::vector<uint8_t> const& /*_rgbaBuffer*/, ImageSize /*_pixelSize*/)>;
 
     /// Schedules taking a screenshot of the current scene and forwards it to the given callback.
+    ///
+    /// The callback may be invoked a few frames later, once the pixels have been read back.
     virtual void scheduleScreenshot(ScreenshotCallback _callback) = 0;
 
     /// Clears the target surface with the given fill color.
     virtual void clear(terminal::RGBAColor _fillColor) = 0;
 
+    /// Tests whether the render target still holds the previously rendered frame,
+    /// such that the next frame may only render the areas that have changed.
+    ///
+    /// @see setDamage()
+    [[nodiscard]] virtual bool preservesContents() const noexcept = 0;
+
+    /// Restricts the next execute() call, including clearing the surface, to the given areas.
+    /// Everything outside of these areas is kept from the previous frame.
+    ///
+    /// Without this call, execute() renders the full render target.
+    /// This must only be called if preservesContents() is true.
+    virtual void setDamage(std::vector<DamagedArea> _areas) = 0;
+
+    /// Moves the previously rendered contents of the given area down by the given number of pixels,
+    /// or up if negative, as the first step of the next execute() call.
+    /// Whatever is moved out of the area is dropped, and whatever is exposed must be damaged.
+    ///
+    /// @retval false the render target cannot move its contents, and the area must be damaged instead.
+    ///
+    /// This must only be called if preservesContents() is true.
+    [[nodiscard]] virtual bool scrollContents(DamagedArea _area, int _offset) = 0;
+
     /// Executes all previously scheduled render commands.
     virtual void execute() = 0;
 
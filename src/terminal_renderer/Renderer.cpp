@@ -22,7 +22,13 @@
     #include <text_shaper/directwrite_shaper.h>
 #endif
 
+#include <crispy/StartupTrace.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
 #include <array>
+#include <chrono>
 #include <functional>
 #include <memory>
 
@@ -46,6 +52,14 @@ namespace terminal::renderer
 
 namespace
 {
+    // Interval in which the cache stats are logged, if enabled.
+    constexpr auto CacheStatsLogInterval = std::chrono::seconds(10);
+
+    // Interval in which the cache capacities are adapted to their hit rates and the memory pressure.
+    constexpr auto CacheAdaptationInterval = std::chrono::seconds(5);
+
+    // The number of array texture layers every OpenGL 3.3 (or OpenGL ES 3.0) driver supports.
+    constexpr uint32_t MaxAtlasPageCount = 256;
 
     void loadGridMetricsFromFont(text::font_key _font, GridMetrics& _gm, text::shaper& _textShaper)
     {
@@ -91,6 +105,8 @@ namespace
                                               DPI _dpi,
                                               text::font_locator& _locator)
     {
+        auto const _ = crispy::StartupTrace::Scope("Create text shaper");
+
         switch (_engine)
         {
             case TextShapingEngine::DWrite:
@@ -127,11 +143,14 @@ Renderer::Renderer(PageSize pageSize,
                    terminal::Opacity backgroundOpacity,
                    crispy::StrongHashtableSize atlasHashtableSlotCount,
                    crispy::LRUCapacity atlasTileCount,
+                   uint32_t atlasPageLimit,
                    bool atlasDirectMapping,
+                   bool cellBackgroundGrid,
                    Decorator hyperlinkNormal,
                    Decorator hyperlinkHover):
     _atlasHashtableSlotCount { crispy::nextPowerOfTwo(atlasHashtableSlotCount.value) },
     _atlasTileCount { std::max(atlasTileCount.value, static_cast<uint32_t>(pageSize.area())) },
+    _atlasPageLimit { std::clamp(atlasPageLimit, 1u, MaxAtlasPageCount) },
     _atlasDirectMapping { atlasDirectMapping },
     _renderTarget { nullptr },
     //.
@@ -148,16 +167,21 @@ Renderer::Renderer(PageSize pageSize,
     imageRenderer_ { gridMetrics_, cellSize() },
     textRenderer_ { gridMetrics_, *textShaper_, fontDescriptions_, fonts_, imageRenderer_ },
     decorationRenderer_ { gridMetrics_, hyperlinkNormal, hyperlinkHover },
-    cursorRenderer_ { gridMetrics_, CursorShape::Block }
+    cursorRenderer_ { gridMetrics_, CursorShape::Block },
+    atlasPageCapacity_ { _atlasPageLimit, { 1, _atlasPageLimit } }
 {
     textRenderer_.updateFontMetrics();
     imageRenderer_.setCellSize(cellSize());
+    backgroundRenderer_.setCellGrid(cellBackgroundGrid);
 
     // clang-format off
     if (_atlasTileCount.value > atlasTileCount.value)
         RendererLog()("Increasing atlas tile count configuration to {} to satisfy worst-case rendering scenario.",
                               _atlasTileCount.value);
 
+    if (_atlasPageLimit != atlasPageLimit)
+        RendererLog()("Adjusting atlas page limit configuration to {}.", _atlasPageLimit);
+
     if (_atlasHashtableSlotCount.value > atlasHashtableSlotCount.value)
         RendererLog()("Increasing atlas hashtable slot count configuration to the next power of two: {}.",
                               _atlasHashtableSlotCount.value);
@@ -167,6 +191,7 @@ Renderer::Renderer(PageSize pageSize,
 void Renderer::setRenderTarget(RenderTarget& renderTarget)
 {
     _renderTarget = &renderTarget;
+    fullRedraw_ = true;
 
     // Reset DirectMappingAllocator (also skipping zero-tile).
     directMappingAllocator_ = atlas::DirectMappingAllocator<RenderTileAttributes> { 1 };
@@ -181,6 +206,7 @@ void Renderer::setRenderTarget(RenderTarget& renderTarget)
     textRenderer_.setRenderTarget(renderTarget, directMappingAllocator_);
 
     configureTextureAtlas();
+    textRenderer_.prewarm();
 
     if (colorPalette_.backgroundImage)
         renderTarget.setBackgroundImage(colorPalette_.backgroundImage);
@@ -191,22 +217,23 @@ void Renderer::configureTextureAtlas()
     Require(_renderTarget);
 
     auto atlasProperties =
-        atlas::AtlasProperties { atlas::Format::RGBA,
-                                 gridMetrics_.cellSize, // Cell size is used as GPU tile size.
+        atlas::AtlasProperties { gridMetrics_.cellSize, // Cell size is used as GPU tile size.
                                  _atlasHashtableSlotCount,
                                  _atlasTileCount,
-                                 directMappingAllocator_.currentlyAllocatedCount };
+                                 directMappingAllocator_.currentlyAllocatedCount,
+                                 _atlasPageLimit };
 
     Require(atlasProperties.tileCount.value > 0);
 
     textureAtlas_ = make_unique<Renderable::TextureAtlas>(_renderTarget->textureScheduler(), atlasProperties);
+    atlasPageCapacity_ = crispy::AdaptiveCapacity(_atlasPageLimit, { 1, _atlasPageLimit });
 
     // clang-format off
     RendererLog()("Configuring texture atlas.\n", atlasProperties);
     RendererLog()("- Atlas properties     : {}\n", atlasProperties);
     RendererLog()("- Atlas texture size   : {} pixels\n", textureAtlas_->atlasSize());
     RendererLog()("- Atlas hashtable      : {} slots\n", _atlasHashtableSlotCount.value);
-    RendererLog()("- Atlas tile count     : {} = {}x * {}y\n", textureAtlas_->capacity(), textureAtlas_->tilesInX(), textureAtlas_->tilesInY());
+    RendererLog()("- Atlas tile count     : {} = {}x * {}y * {} pages * {} formats\n", textureAtlas_->capacity(), textureAtlas_->tilesInX(), textureAtlas_->tilesInY(), _atlasPageLimit, atlas::AtlasFormats.size());
     RendererLog()("- Atlas direct mapping : {} (for text rendering)", _atlasDirectMapping ? "enabled" : "disabled");
     // clang-format on
 
@@ -234,6 +261,8 @@ void Renderer::executeImageDiscards()
 
 void Renderer::clearCache()
 {
+    fullRedraw_ = true;
+
     if (!_renderTarget)
         return;
 
@@ -243,10 +272,32 @@ void Renderer::clearCache()
     // functions for that) either that, or only the render target is allowed to clear the actual atlas caches.
     for (auto& renderable: renderables())
         renderable.get().clearCache();
+
+    textRenderer_.prewarm();
+}
+
+void Renderer::releaseCaches()
+{
+    if (!_renderTarget)
+        return;
+
+    // A new texture atlas only allocates the pages of its direct-mapped tiles.
+    textRenderer_.discardPendingGlyphs();
+    configureTextureAtlas();
+
+    fullRedraw_ = true;
+    _renderTarget->clearCache();
+    for (auto& renderable: renderables())
+        renderable.get().clearCache();
+
+    // Prewarming right away would allocate atlas pages again.
+    prewarmPending_ = true;
 }
 
 void Renderer::setFonts(FontDescriptions _fontDescriptions)
 {
+    textRenderer_.discardPendingGlyphs();
+
     if (fontDescriptions_.textShapingEngine == _fontDescriptions.textShapingEngine)
     {
         textShaper_->clear_cache();
@@ -255,15 +306,57 @@ void Renderer::setFonts(FontDescriptions _fontDescriptions)
             textShaper_->set_locator(createFontLocator(_fontDescriptions.fontLocator));
     }
     else
+    {
         textShaper_ = createTextShaper(_fontDescriptions.textShapingEngine,
                                        _fontDescriptions.dpi,
                                        createFontLocator(_fontDescriptions.fontLocator));
+        textShaper_->set_glyph_cache(glyphDiskCache_.get());
+    }
 
     fontDescriptions_ = std::move(_fontDescriptions);
     fonts_ = loadFontKeys(fontDescriptions_, *textShaper_);
     updateFontMetrics();
 }
 
+void Renderer::setFontDPI(text::DPI _dpi)
+{
+    if (fontDescriptions_.dpi == _dpi)
+        return;
+
+    textRenderer_.discardPendingGlyphs();
+    textShaper_->set_dpi(_dpi);
+    fontDescriptions_.dpi = _dpi;
+    fonts_ = loadFontKeys(fontDescriptions_, *textShaper_);
+    updateFontMetrics();
+}
+
+void Renderer::setParallelShaping(size_t threadCount)
+{
+    textRenderer_.setParallelShaping(threadCount, [this]() -> unique_ptr<text::shaper> {
+        auto shaper = createTextShaper(fontDescriptions_.textShapingEngine,
+                                       fontDescriptions_.dpi,
+                                       createFontLocator(fontDescriptions_.fontLocator));
+        if (!shaper || !shaper->has_shared_font_keys())
+            return nullptr;
+
+        // The shaping results are only interchangeable if both shapers identify the fonts alike.
+        auto const fonts = loadFontKeys(fontDescriptions_, *shaper);
+        if (fonts.regular != fonts_.regular || fonts.bold != fonts_.bold || fonts.italic != fonts_.italic
+            || fonts.boldItalic != fonts_.boldItalic || fonts.emoji != fonts_.emoji)
+            return nullptr;
+
+        return shaper;
+    });
+}
+
+void Renderer::setGlyphDiskCache(unique_ptr<text::glyph_disk_cache> _cache)
+{
+    textRenderer_.discardPendingGlyphs();
+    glyphDiskCache_ = std::move(_cache);
+    textShaper_->set_glyph_cache(glyphDiskCache_.get());
+    textRenderer_.setGlyphDiskCache(glyphDiskCache_.get());
+}
+
 bool Renderer::setFontSize(text::font_size _fontSize)
 {
     if (_fontSize.pt < 5.) // Let's not be crazy.
@@ -272,6 +365,7 @@ bool Renderer::setFontSize(text::font_size _fontSize)
     if (_fontSize.pt > 200.)
         return false;
 
+    textRenderer_.discardPendingGlyphs();
     fontDescriptions_.size = _fontSize;
     fonts_ = loadFontKeys(fontDescriptions_, *textShaper_);
     updateFontMetrics();
@@ -283,6 +377,8 @@ void Renderer::updateFontMetrics()
 {
     RendererLog()("Updating grid metrics: {}", gridMetrics_);
 
+    textRenderer_.discardPendingGlyphs();
+
     gridMetrics_ = loadGridMetrics(fonts_.regular, gridMetrics_.pageSize, *textShaper_);
 
     if (_renderTarget)
@@ -296,15 +392,21 @@ void Renderer::updateFontMetrics()
 
 uint64_t Renderer::render(Terminal& _terminal, bool _pressure)
 {
+    auto const _frame = frameStats_.frame.measure();
+
     auto const statusLineHeight = _terminal.state().statusDisplayType == StatusDisplayType::None
                                       ? LineCount(0)
                                       : _terminal.state().hostWritableStatusBuffer.pageSize().lines;
-    gridMetrics_.pageSize = _terminal.pageSize() + statusLineHeight;
+    if (auto const pageSize = _terminal.pageSize() + statusLineHeight; pageSize != gridMetrics_.pageSize)
+        setPageSize(pageSize);
 
     auto const changes = _terminal.tick(steady_clock::now());
 
     executeImageDiscards();
 
+    if (std::exchange(prewarmPending_, false))
+        textRenderer_.prewarm();
+
 #if !defined(LIBTERMINAL_PASSIVE_RENDER_BUFFER_UPDATE) // {{{
     // Windows 10 (ConPTY) workaround. ConPTY can't handle non-blocking I/O,
     // so we have to explicitly refresh the render buffer
@@ -313,21 +415,43 @@ uint64_t Renderer::render(Terminal& _terminal, bool _pressure)
 #endif // }}}
 
     optional<terminal::RenderCursor> cursorOpt;
+
+    // Glyphs and images rendered as blank placeholders in the last frame may be ready by now.
+    if (textRenderer_.placeholdersRendered() || imageRenderer_.placeholdersRendered())
+        fullRedraw_ = true;
+    backgroundRenderer_.beginFrame();
     imageRenderer_.beginFrame();
     textRenderer_.beginFrame();
     textRenderer_.setPressure(_pressure && _terminal.isPrimaryScreen());
     {
+        auto const _ = frameStats_.cells.measure();
         RenderBufferRef const renderBuffer = _terminal.renderBuffer();
         cursorOpt = renderBuffer.get().cursor;
+        if (renderBuffer.get().frameID != lastFrameID_ && renderBuffer.get().echoedKeyPress)
+            renderedKeyPress_ = renderBuffer.get().echoedKeyPress;
+        planRedraw(renderBuffer.get());
         renderCells(renderBuffer.get().cells);
         renderLines(renderBuffer.get().lines);
+        renderImages(renderBuffer.get().images);
+        decorationRenderer_.endFrame();
+    }
+    {
+        auto const _ = frameStats_.text.measure();
+        textRenderer_.endFrame();
+    }
+    {
+        auto const _ = frameStats_.image.measure();
+        imageRenderer_.endFrame();
+    }
+    {
+        auto const _ = frameStats_.background.measure();
+        backgroundRenderer_.endFrame();
     }
-    textRenderer_.endFrame();
-    imageRenderer_.endFrame();
 
-    if (cursorOpt && cursorOpt.value().shape != CursorShape::Block)
+    if (cursorOpt && cursorOpt.value().shape != CursorShape::Block && isRedrawn(cursorOpt->position.line))
     {
         // Note. Block cursor is implicitly rendered via standard grid cell rendering.
+        auto const _ = frameStats_.cursor.measure();
         auto const cursor = *cursorOpt;
         cursorRenderer_.setShape(cursor.shape);
         auto const cursorColor = [&]() {
@@ -341,27 +465,146 @@ uint64_t Renderer::render(Terminal& _terminal, bool _pressure)
         cursorRenderer_.render(gridMetrics_.map(cursor.position), cursor.width, cursorColor);
     }
 
-    _renderTarget->execute();
+    {
+        auto const _ = frameStats_.execute.measure();
+        _renderTarget->execute();
+    }
+
+    publishCacheStats();
 
     return changes;
 }
 
+void Renderer::publishCacheStats()
+{
+    auto const atlasStats = textureAtlas_->fetchAndClearStats();
+    atlasCacheStats_.update(atlasStats, textureAtlas_->tileCount(), textureAtlas_->capacity());
+    atlasPageCapacity_.record(atlasStats);
+
+    auto pages = size_t { 0 };
+    for (auto const format: atlas::AtlasFormats)
+        pages += textureAtlas_->pageCount(format);
+    atlasMemory_.update(textureAtlas_->textureBytes(), pages);
+
+    adaptCacheCapacities();
+
+    if (!CacheStatsLog)
+        return;
+
+    auto const now = steady_clock::now();
+    if (now - lastCacheStatsLog_ < CacheStatsLogInterval)
+        return;
+
+    lastCacheStatsLog_ = now;
+    for (auto const& stats: crispy::CacheStats::collect())
+        CacheStatsLog()("{}", stats);
+}
+
+void Renderer::adaptCacheCapacities()
+{
+    auto const now = steady_clock::now();
+    if (now - lastCacheAdaptation_ < CacheAdaptationInterval)
+        return;
+
+    lastCacheAdaptation_ = now;
+    auto const memoryPressure = crispy::underMemoryPressure();
+    textRenderer_.adaptCacheCapacity(memoryPressure);
+    imageRenderer_.adaptTextureMemoryBudget(memoryPressure);
+    textureAtlas_->setPageLimit(static_cast<uint32_t>(atlasPageCapacity_.adapt(memoryPressure)));
+}
+
+void Renderer::planRedraw(RenderBuffer const& _renderBuffer)
+{
+    auto const pageLines = unbox<size_t>(gridMetrics_.pageSize.lines);
+    auto const sameFrame = _renderBuffer.frameID == lastFrameID_;
+    auto const nextFrame = _renderBuffer.frameID == lastFrameID_ + 1;
+    auto const partial = !fullRedraw_ && (sameFrame || nextFrame) && _renderTarget->preservesContents();
+
+    auto const lastCursorLine = lastCursorLine_;
+    fullRedraw_ = false;
+    lastFrameID_ = _renderBuffer.frameID;
+    lastCursorLine_ = _renderBuffer.cursor ? optional { _renderBuffer.cursor->position.line } : nullopt;
+    redrawnLines_.assign(pageLines, !partial);
+    if (!partial)
+        return;
+
+    // Rendering the same frame again does not damage anything.
+    damagedLines_.assign(pageLines, false);
+    auto const damage = [&](LineOffset line) {
+        if (LineOffset(0) <= line && unbox<size_t>(line) < pageLines)
+            damagedLines_[unbox<size_t>(line)] = true;
+    };
+    if (nextFrame)
+        for (auto const line: _renderBuffer.damagedLines)
+            damage(line);
+
+    if (auto const shift = _renderBuffer.scrollShift; nextFrame && shift != LineOffset(0))
+    {
+        // Lines that have merely been scrolled are taken over from the previous frame, moved along.
+        auto const regionLines = std::min(unbox<size_t>(_renderBuffer.scrollRegion), pageLines);
+        auto const cellHeight = unbox<int>(gridMetrics_.cellSize.height);
+        auto const area =
+            DamagedArea { gridMetrics_.mapTopLeft(LineOffset(0), ColumnOffset(0)).y,
+                          Height::cast_from(cellHeight * static_cast<int>(regionLines)) };
+        if (!_renderTarget->scrollContents(area, unbox<int>(shift) * cellHeight))
+            for (auto line = LineOffset(0); line < LineOffset::cast_from(regionLines); ++line)
+                damage(line);
+
+        // The cursor is drawn on top of the lines, and must neither be moved along nor be lost.
+        if (lastCursorLine)
+            damage(*lastCursorLine + shift);
+        if (lastCursorLine_)
+            damage(*lastCursorLine_);
+    }
+
+    auto areas = vector<DamagedArea> {};
+    for (size_t y = 0; y < pageLines; ++y)
+    {
+        if (!damagedLines_[y])
+            continue;
+
+        // Glyphs may exceed the line they belong to, so the neighbouring lines
+        // are rendered as well, clipped to the damaged area.
+        redrawnLines_[y] = true;
+        if (y != 0)
+            redrawnLines_[y - 1] = true;
+        if (y + 1 != pageLines)
+            redrawnLines_[y + 1] = true;
+
+        auto const top = gridMetrics_.mapTopLeft(LineOffset::cast_from(y), ColumnOffset(0)).y;
+        if (!areas.empty() && areas.back().top + areas.back().height.as<int>() == top)
+            areas.back().height += gridMetrics_.cellSize.height;
+        else
+            areas.emplace_back(DamagedArea { top, gridMetrics_.cellSize.height });
+    }
+    _renderTarget->setDamage(std::move(areas));
+}
+
 void Renderer::renderCells(vector<RenderCell> const& _renderableCells)
 {
     for (RenderCell const& cell: _renderableCells)
     {
+        if (!isRedrawn(cell.position.line))
+            continue;
         backgroundRenderer_.renderCell(cell);
         decorationRenderer_.renderCell(cell);
         textRenderer_.renderCell(cell);
-        if (cell.image)
-            imageRenderer_.renderImage(gridMetrics_.map(cell.position), *cell.image);
     }
 }
 
+void Renderer::renderImages(vector<RenderImage> const& _renderableImages)
+{
+    for (RenderImage const& image: _renderableImages)
+        if (isRedrawn(image.position.line))
+            imageRenderer_.renderImage(gridMetrics_.map(image.position), image);
+}
+
 void Renderer::renderLines(vector<RenderLine> const& renderableLines)
 {
     for (RenderLine const& line: renderableLines)
     {
+        if (!isRedrawn(line.lineOffset))
+            continue;
         backgroundRenderer_.renderLine(line);
         decorationRenderer_.renderLine(line);
         textRenderer_.renderLine(line);
@@ -373,6 +616,17 @@ void Renderer::inspect(std::ostream& _textOutput) const
     textureAtlas_->inspect(_textOutput);
     for (auto const& renderable: renderables())
         renderable.get().inspect(_textOutput);
+
+    _textOutput << "Cache statistics (all sessions):\n";
+    for (auto const& stats: crispy::CacheStats::collect())
+        _textOutput << fmt::format("- {}\n", stats);
+
+    auto const memoryStats = crispy::MemoryStats::collect();
+    _textOutput << fmt::format("Memory usage (all sessions): {}\n",
+                               crispy::humanReadableBytes(
+                                   static_cast<long double>(crispy::MemoryStats::totalBytes(memoryStats))));
+    for (auto const& stats: memoryStats)
+        _textOutput << fmt::format("- {}\n", stats);
 }
 
 } // namespace terminal::renderer
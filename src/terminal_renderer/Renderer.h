@@ -26,12 +26,20 @@
 #include <terminal_renderer/RenderTarget.h>
 #include <terminal_renderer/TextRenderer.h>
 
+#include <text_shaper/glyph_disk_cache.h>
+
+#include <crispy/AdaptiveCapacity.h>
+#include <crispy/CacheStats.h>
+
+#include <crispy/LatencyHistogram.h>
+#include <crispy/MemoryStats.h>
 #include <crispy/size.h>
 
 #include <fmt/format.h>
 
 #include <chrono>
 #include <memory>
+#include <optional>
 #include <utility>
 #include <vector>
 
@@ -57,7 +65,9 @@ class Renderer
      * @p colorPalette       User-configurable color profile to use to map terminal colors to.
      * @p projectionMatrix   Projection matrix to apply to the rendered scene when rendering the screen.
      * @p atlasDirectMapping Indicates whether or not direct mapped tiles are allowed.
-     * @p atlasTileCount     Number of tiles guaranteed to be available in LRU cache.
+     * @p atlasTileCount     Number of tiles guaranteed to be available in LRU cache, per atlas page.
+     * @p atlasPageLimit     Maximum number of pages the texture atlas may grow to.
+     * @p cellBackgroundGrid Indicates whether cell backgrounds are rendered as one grid of colors.
      */
     Renderer(PageSize screenSize,
              FontDescriptions fontDescriptions,
@@ -65,7 +75,9 @@ class Renderer
              Opacity backgroundOpacity,
              crispy::StrongHashtableSize atlasHashtableSlotCount,
              crispy::LRUCapacity atlasTileCount,
+             uint32_t atlasPageLimit,
              bool atlasDirectMapping,
+             bool cellBackgroundGrid,
              Decorator hyperlinkNormal,
              Decorator hyperlinkHover);
 
@@ -77,7 +89,11 @@ class Renderer
     RenderTarget& renderTarget() noexcept { return *_renderTarget; }
     bool hasRenderTarget() const noexcept { return _renderTarget != nullptr; }
 
-    void setBackgroundOpacity(terminal::Opacity _opacity) { backgroundOpacity_ = _opacity; }
+    void setBackgroundOpacity(terminal::Opacity _opacity)
+    {
+        backgroundOpacity_ = _opacity;
+        fullRedraw_ = true;
+    }
     terminal::Opacity backgroundOpacity() const noexcept { return backgroundOpacity_; }
 
     bool setFontSize(text::font_size _fontSize);
@@ -86,20 +102,55 @@ class Renderer
     FontDescriptions const& fontDescriptions() const noexcept { return fontDescriptions_; }
     void setFonts(FontDescriptions _fontDescriptions);
 
+    /// Changes the DPI of the current fonts, e.g. when the window has been moved to another screen.
+    ///
+    /// Unlike setFonts(), the fonts and shaping results of the recently used DPIs are kept,
+    /// such that moving back to a previous screen does not load or shape anything again.
+    void setFontDPI(text::DPI _dpi);
+
     GridMetrics const& gridMetrics() const noexcept { return gridMetrics_; }
 
+    /// Configures the on-disk cache of rasterized glyphs to be used, or none if nullptr.
+    void setGlyphDiskCache(std::unique_ptr<text::glyph_disk_cache> _cache);
+
+    /// Configures missing glyphs to be rasterized asynchronously on @p threadCount worker threads,
+    /// or synchronously while rendering if @p threadCount is 0.
+    void setAsyncRasterization(size_t threadCount, size_t uploadBudget)
+    {
+        textRenderer_.setAsyncRasterization(threadCount, uploadBudget);
+    }
+
+    /// Configures the texts of a frame missing the shaping cache to be shaped in parallel on up to
+    /// @p threadCount threads, or synchronously while rendering if @p threadCount is 0.
+    void setParallelShaping(size_t threadCount);
+
+    /// Limits the GPU memory used for images uploaded into textures of their own, in bytes.
+    void setImageTextureBudget(size_t bytes) { imageRenderer_.setTextureMemoryBudget(bytes); }
+
+    /// Enables rendering box drawing characters analytically on the render target.
+    void setProceduralBoxDrawing(bool _enabled) { textRenderer_.setProceduralBoxDrawing(_enabled); }
+
+    /// @returns whether another frame must be rendered to show glyphs still being rasterized.
+    [[nodiscard]] bool hasPendingGlyphs() const { return textRenderer_.hasPendingGlyphs(); }
+
     void setHyperlinkDecoration(Decorator _normal, Decorator _hover)
     {
         decorationRenderer_.setHyperlinkDecoration(_normal, _hover);
+        fullRedraw_ = true;
     }
 
-    void setPageSize(PageSize _screenSize) noexcept { gridMetrics_.pageSize = _screenSize; }
+    void setPageSize(PageSize _screenSize) noexcept
+    {
+        gridMetrics_.pageSize = _screenSize;
+        fullRedraw_ = true;
+    }
 
     void setMargin(PageMargin _margin) noexcept
     {
         if (_renderTarget)
             _renderTarget->setMargin(_margin);
         gridMetrics_.pageMargin = _margin;
+        fullRedraw_ = true;
     }
 
     /**
@@ -113,8 +164,33 @@ class Renderer
 
     void clearCache();
 
+    /// Releases the texture atlas pages and all caches, e.g. while the terminal is idle.
+    ///
+    /// They are filled again by the next frame rendered, which thus takes as long as the first one.
+    void releaseCaches();
+
     void inspect(std::ostream& _textOutput) const;
 
+    /// CPU time spent in the phases of rendering a frame.
+    struct FrameStats
+    {
+        crispy::LatencyHistogram frame;      //!< the whole of render()
+        crispy::LatencyHistogram cells;      //!< rendering the cells and lines of the render buffer
+        crispy::LatencyHistogram text;       //!< flushing the text renderer's pending glyphs
+        crispy::LatencyHistogram image;      //!< flushing the image renderer
+        crispy::LatencyHistogram background; //!< flushing the background renderer
+        crispy::LatencyHistogram cursor;     //!< rendering a non-block cursor
+        crispy::LatencyHistogram execute;    //!< executing the render target's command queues
+    };
+
+    [[nodiscard]] FrameStats const& frameStats() const noexcept { return frameStats_; }
+
+    /// Returns the time of the key press whose echo got rendered with the last frame, if any.
+    [[nodiscard]] std::optional<std::chrono::steady_clock::time_point> takeRenderedKeyPress() noexcept
+    {
+        return std::exchange(renderedKeyPress_, std::nullopt);
+    }
+
     std::array<std::reference_wrapper<Renderable>, 5> renderables()
     {
         return std::array<std::reference_wrapper<Renderable>, 5> {
@@ -131,12 +207,26 @@ class Renderer
 
   private:
     void configureTextureAtlas();
+    void planRedraw(RenderBuffer const& _renderBuffer);
+    [[nodiscard]] bool isRedrawn(LineOffset _line) const noexcept
+    {
+        return unbox<size_t>(_line) < redrawnLines_.size() && redrawnLines_[unbox<size_t>(_line)];
+    }
     void renderCells(std::vector<RenderCell> const& _renderableCells);
     void renderLines(std::vector<RenderLine> const& renderableLines);
+    void renderImages(std::vector<RenderImage> const& _renderableImages);
     void executeImageDiscards();
 
+    // Adds the stats of the caches owned by the renderer itself to the process-wide cache stats,
+    // and logs them all periodically if enabled.
+    void publishCacheStats();
+
+    // Periodically grows or shrinks the caches according to their hit rates and the memory pressure.
+    void adaptCacheCapacities();
+
     crispy::StrongHashtableSize _atlasHashtableSlotCount;
     crispy::LRUCapacity _atlasTileCount;
+    uint32_t _atlasPageLimit;
     bool _atlasDirectMapping;
 
     RenderTarget* _renderTarget;
@@ -145,6 +235,7 @@ class Renderer
     std::unique_ptr<Renderable::TextureAtlas> textureAtlas_;
 
     FontDescriptions fontDescriptions_;
+    std::unique_ptr<text::glyph_disk_cache> glyphDiskCache_;
     std::unique_ptr<text::shaper> textShaper_;
     FontKeys fonts_;
 
@@ -161,6 +252,28 @@ class Renderer
     TextRenderer textRenderer_;
     DecorationRenderer decorationRenderer_;
     CursorRenderer cursorRenderer_;
+
+    // {{{ partial redraw state
+    bool fullRedraw_ = true;                   //!< whether the next frame must be rendered in full
+    uint64_t lastFrameID_ = 0;                 //!< frame ID of the previously rendered render buffer
+    std::vector<bool> damagedLines_;           //!< damaged lines of the current frame
+    std::vector<bool> redrawnLines_;           //!< lines to be rendered in the current frame
+    std::optional<LineOffset> lastCursorLine_; //!< cursor line of the previously rendered frame
+    // }}}
+
+    FrameStats frameStats_;
+    std::optional<std::chrono::steady_clock::time_point> renderedKeyPress_;
+
+    crispy::CacheStats atlasCacheStats_ { "Texture atlas tiles" };
+    crispy::MemoryStats atlasMemory_ { "Texture atlas (GPU)" };
+    std::chrono::steady_clock::time_point lastCacheStatsLog_ {};
+
+    // Number of atlas pages that may be in use, adapted between 1 and the configured page limit.
+    crispy::AdaptiveCapacity atlasPageCapacity_;
+    std::chrono::steady_clock::time_point lastCacheAdaptation_ {};
+
+    // Whether the text renderer is to be prewarmed along with the next frame, see releaseCaches().
+    bool prewarmPending_ = false;
 };
 
 } // namespace terminal::renderer
@@ -19,14 +19,16 @@
         renderCell...
             appendCellTextToClusterGroup
             flushTextClusterGroup?
-                getOrCreateCachedGlyphPositions
+                getOrCreateCachedGlyphPositions (or defer it to the TextShapingPool on a cache miss)
                 getOrCreateRasterizedMetadata
-                    createRasterizedGlyph
+                    rasterizeGlyph (or request it from the GlyphRasterizerPool)
+                    insertRasterizedGlyph
                         upload each glyph tile
                 renderRasterizedGlyph
                     render each glyph tile
     endFrame
         &flushTextClusterGroup...
+        renderDeferredClusterGroups (shapes the deferred texts in parallel, then renders them)
 
 ### How ligatures are being rendered:
 
@@ -129,6 +131,7 @@ Making use of reserved glyph slots
 #include <terminal_renderer/shared_defines.h>
 #include <terminal_renderer/utils.h>
 
+#include <text_shaper/caching_font_locator.h>
 #include <text_shaper/font_locator_provider.h>
 #include <text_shaper/fontconfig_locator.h>
 #include <text_shaper/mock_font_locator.h>
@@ -141,6 +144,7 @@ Making use of reserved glyph slots
     #include <text_shaper/coretext_locator.h>
 #endif
 
+#include <crispy/StartupTrace.h>
 #include <crispy/algorithm.h>
 #include <crispy/assert.h>
 #include <crispy/indexed.h>
@@ -155,6 +159,8 @@ Making use of reserved glyph slots
 #include <range/v3/algorithm/copy.hpp>
 
 #include <algorithm>
+#include <chrono>
+#include <thread>
 
 using crispy::Point;
 using crispy::StrongHash;
@@ -171,6 +177,7 @@ using std::nullopt;
 using std::optional;
 using std::ostream;
 using std::pair;
+using std::string_view;
 using std::u32string;
 using std::u32string_view;
 using std::unique_ptr;
@@ -190,6 +197,25 @@ namespace
     constexpr auto LastReservedChar = char32_t { 0x7E };
     constexpr auto DirectMappedCharsCount = LastReservedChar - FirstReservedChar + 1;
 
+    constexpr auto DirectMappedStyles = array<TextStyle, 4> {
+        TextStyle::Regular,
+        TextStyle::Bold,
+        TextStyle::Italic,
+        TextStyle::BoldItalic,
+    };
+
+    constexpr size_t directMappedStyleIndex(TextStyle style) noexcept
+    {
+        return static_cast<size_t>(style) & 0x03;
+    }
+
+    // Punctuation is excluded as it may form ligatures, which requires text shaping.
+    constexpr bool isAsciiAlphanumeric(char32_t codepoint) noexcept
+    {
+        return (U'0' <= codepoint && codepoint <= U'9') || (U'A' <= codepoint && codepoint <= U'Z')
+               || (U'a' <= codepoint && codepoint <= U'z');
+    }
+
     StrongHash hashGlyphKeyAndPresentation(text::glyph_key const& glyphKey,
                                            unicode::PresentationStyle presentation) noexcept
     {
@@ -208,6 +234,11 @@ namespace
         return StrongHash::compute(text) * static_cast<uint32_t>(style);
     }
 
+    StrongHash hashLine(string_view text, TextStyle style, ColumnCount width) noexcept
+    {
+        return StrongHash::compute(text) * static_cast<uint32_t>(style) * unbox<uint32_t>(width);
+    }
+
     text::font_key getFontForStyle(FontKeys const& _fonts, TextStyle _style)
     {
         switch (_style)
@@ -234,13 +265,15 @@ namespace
         return atlas::Format::Red; // unreachable();
     }
 
-    uint32_t toFragmentShaderSelector(text::bitmap_format glyphFormat)
+    uint32_t toFragmentShaderSelector(text::bitmap_format glyphFormat, text::render_mode renderMode)
     {
         auto const lcdShaderId = FRAGMENT_SELECTOR_GLYPH_LCD;
         // TODO ^^^ configurable vs FRAGMENT_SELECTOR_GLYPH_LCD_SIMPLE
         switch (glyphFormat)
         {
-            case text::bitmap_format::alpha_mask: return FRAGMENT_SELECTOR_GLYPH_ALPHA;
+            case text::bitmap_format::alpha_mask:
+                return renderMode == text::render_mode::sdf ? FRAGMENT_SELECTOR_GLYPH_SDF
+                                                            : FRAGMENT_SELECTOR_GLYPH_ALPHA;
             case text::bitmap_format::rgb: return lcdShaderId;
             case text::bitmap_format::rgba: return FRAGMENT_SELECTOR_IMAGE_BGRA;
         }
@@ -268,10 +301,46 @@ namespace
                 return 2;
         return baseWidth;
     }
+
+    /// Copies the pixel columns [_x, _x + _width) of the given bitmap.
+    vector<uint8_t> sliceBitmap(text::rasterized_glyph const& _glyph, uintptr_t _x, uintptr_t _width)
+    {
+        auto const colorComponentCount = atlas::element_count(toAtlasFormat(_glyph.format));
+        auto const pitch = unbox<uintptr_t>(_glyph.bitmapSize.width) * colorComponentCount;
+        auto const subPitch = _width * colorComponentCount;
+        auto const rowCount = unbox<uintptr_t>(_glyph.bitmapSize.height);
+
+        auto bitmap = vector<uint8_t>(rowCount * subPitch);
+        for (uintptr_t rowIndex = 0; rowIndex < rowCount; ++rowIndex)
+        {
+            uint8_t const* sourceRow = _glyph.bitmap.data() + rowIndex * pitch + _x * colorComponentCount;
+            Require(sourceRow + subPitch <= _glyph.bitmap.data() + _glyph.bitmap.size());
+            std::memcpy(bitmap.data() + rowIndex * subPitch, sourceRow, subPitch);
+        }
+        return bitmap;
+    }
+
+    ScaledGlyphCache::Ptr createScaledGlyphCache(text::shaper const& _textShaper)
+    {
+        if (_textShaper.has_shared_font_keys())
+            return ScaledGlyphCache::shared();
+        return ScaledGlyphCache::create();
+    }
+
+    ShapingResultCache::Ptr createShapingCache(text::shaper const& _textShaper,
+                                               FontDescriptions const& _fontDescriptions,
+                                               FontKeys const& _fonts)
+    {
+        if (_textShaper.has_shared_font_keys())
+            return ShapingResultCache::shared(_fontDescriptions, _fonts);
+        return ShapingResultCache::create();
+    }
 } // namespace
 
 text::font_locator& createFontLocator(FontLocatorEngine _engine)
 {
+    auto const _ = crispy::StartupTrace::Scope("Create font locator");
+
     switch (_engine)
     {
         case FontLocatorEngine::Mock: return text::font_locator_provider::get().mock();
@@ -299,9 +368,182 @@ text::font_locator& createFontLocator(FontLocatorEngine _engine)
     return text::font_locator_provider::get().fontconfig();
 }
 
-// TODO: What's a good value here? Or do we want to make that configurable,
-// or even computed based on memory resources available?
+// {{{ ShapingResultCache
+// Initial number of cached shaping results, adapted to the hit rate and memory pressure at runtime.
 constexpr uint32_t TextShapingCacheSize = 4000;
+constexpr auto TextShapingCacheLimits = crispy::AdaptiveCapacity::Limits { 1000, 64000 };
+
+namespace
+{
+    crispy::StrongLRUHashtable<ShapingResultCache::Value>::Ptr createShapingResultTable(size_t _capacity)
+    {
+        // About four hash slots per entry keep the collision chains short.
+        auto const capacity = static_cast<uint32_t>(_capacity);
+        return crispy::StrongLRUHashtable<ShapingResultCache::Value>::create(
+            crispy::StrongHashtableSize { crispy::nextPowerOfTwo(capacity * 4) },
+            crispy::LRUCapacity { capacity },
+            "Text shaping cache");
+    }
+} // namespace
+
+ShapingResultCache::ShapingResultCache():
+    cache_ { createShapingResultTable(TextShapingCacheSize) },
+    capacity_ { TextShapingCacheSize, TextShapingCacheLimits }
+{
+}
+
+ShapingResultCache::Ptr ShapingResultCache::create()
+{
+    return Ptr(new ShapingResultCache());
+}
+
+ShapingResultCache::Ptr ShapingResultCache::shared(FontDescriptions const& _fontDescriptions,
+                                                   FontKeys const& _fonts)
+{
+    // The font keys identify the font files, sizes, and DPI. Font features and spacing
+    // influence the shaping results, too.
+    auto key = fmt::format("{} {} {} {} {} {}",
+                           _fontDescriptions.textShapingEngine,
+                           _fonts.regular,
+                           _fonts.bold,
+                           _fonts.italic,
+                           _fonts.boldItalic,
+                           _fonts.emoji);
+    for (text::font_description const* description: { &_fontDescriptions.regular,
+                                                       &_fontDescriptions.bold,
+                                                       &_fontDescriptions.italic,
+                                                       &_fontDescriptions.boldItalic,
+                                                       &_fontDescriptions.emoji })
+    {
+        key += fmt::format(" {}{}:", description->spacing, description->strict_spacing ? "!" : "");
+        for (text::font_feature const& feature: description->features)
+            key.append(feature.name.data(), feature.name.size());
+    }
+
+    static auto mutex = std::mutex {};
+    static auto caches = std::unordered_map<std::string, std::weak_ptr<ShapingResultCache>> {};
+
+    auto const _ = std::lock_guard { mutex };
+    for (auto i = caches.begin(); i != caches.end();)
+        i = i->second.expired() ? caches.erase(i) : std::next(i);
+
+    auto& weakCache = caches[key];
+    if (auto cache = weakCache.lock())
+        return cache;
+
+    auto cache = create();
+    weakCache = cache;
+    return cache;
+}
+
+void ShapingResultCache::clear()
+{
+    auto const _ = std::lock_guard { mutex_ };
+    cache_->clear();
+}
+
+void ShapingResultCache::inspect(ostream& _textOutput) const
+{
+    auto const _ = std::lock_guard { mutex_ };
+    cache_->inspect(_textOutput);
+}
+
+void ShapingResultCache::publishStats()
+{
+    auto const _ = std::lock_guard { mutex_ };
+    auto const stats = cache_->fetchAndClearStats();
+    stats_.update(stats, cache_->size(), cache_->capacity());
+    capacity_.record(stats);
+    memory_.update(cache_->storageSize() + cache_->size() * sizeof(text::shape_result), cache_->size());
+}
+
+size_t ShapingResultCache::memoryUsage() const
+{
+    auto const _ = std::lock_guard { mutex_ };
+    return cache_->storageSize() + cache_->size() * sizeof(text::shape_result);
+}
+
+void ShapingResultCache::adaptCapacity(bool _memoryPressure)
+{
+    auto const _ = std::lock_guard { mutex_ };
+    auto const capacity = capacity_.adapt(_memoryPressure);
+    if (capacity == cache_->capacity())
+        return;
+
+    // Re-inserting from the least to the most recently used entry preserves the LRU order,
+    // and evicts the least recently used entries first if shrinking.
+    auto resized = createShapingResultTable(capacity);
+    auto const hashes = cache_->hashes();
+    for (auto i = hashes.rbegin(); i != hashes.rend(); ++i)
+        resized->emplace(*i, cache_->peek(*i));
+    (void) resized->fetchAndClearStats();
+    cache_ = std::move(resized);
+}
+// }}}
+
+// {{{ ScaledGlyphCache
+// Scaled glyphs are few (mostly emoji), though not tiny.
+constexpr uint32_t ScaledGlyphCacheSize = 1024;
+
+ScaledGlyphCache::ScaledGlyphCache():
+    cache_ { crispy::StrongLRUHashtable<text::rasterized_glyph>::create(
+        crispy::StrongHashtableSize { ScaledGlyphCacheSize * 4 },
+        crispy::LRUCapacity { ScaledGlyphCacheSize },
+        "Scaled glyph cache") }
+{
+}
+
+ScaledGlyphCache::Ptr ScaledGlyphCache::create()
+{
+    return Ptr(new ScaledGlyphCache());
+}
+
+ScaledGlyphCache::Ptr ScaledGlyphCache::shared()
+{
+    static auto const cache = create();
+    return cache;
+}
+
+optional<text::rasterized_glyph> ScaledGlyphCache::get(StrongHash const& _key) const
+{
+    auto const _ = std::lock_guard { mutex_ };
+    if (text::rasterized_glyph const* glyph = cache_->try_get(_key))
+        return *glyph;
+    return nullopt;
+}
+
+void ScaledGlyphCache::put(StrongHash const& _key, text::rasterized_glyph const& _glyph)
+{
+    auto const _ = std::lock_guard { mutex_ };
+    cache_->emplace(_key, _glyph);
+}
+// }}}
+
+void prefetchFonts(FontDescriptions const& _fontDescriptions)
+{
+    auto const _ = crispy::StartupTrace::Scope("Prefetch fonts");
+
+    auto* fontLocator =
+        dynamic_cast<text::caching_font_locator*>(&createFontLocator(_fontDescriptions.fontLocator));
+    if (!fontLocator)
+        return;
+
+    fontLocator->prefetch({ _fontDescriptions.regular,
+                            _fontDescriptions.bold,
+                            _fontDescriptions.italic,
+                            _fontDescriptions.boldItalic,
+                            _fontDescriptions.emoji });
+}
+
+// Number of trivial lines whose tiles are cached, which is a few pages worth of lines.
+constexpr uint32_t LineCacheSize = 1000;
+
+// Minimum number of texts of a frame missing the shaping cache to shape them in parallel.
+constexpr size_t MinParallelShapingCount = 8;
+
+// Number of shaping caches kept alive for recently used fonts, e.g. one per DPI of the screens
+// the window has been moved across.
+constexpr size_t RetainedShapingCacheCount = 3;
 
 TextRenderer::TextRenderer(GridMetrics const& gridMetrics,
                            text::shaper& _textShaper,
@@ -312,25 +554,69 @@ TextRenderer::TextRenderer(GridMetrics const& gridMetrics,
     textRendererEvents_ { eventHandler },
     fontDescriptions_ { _fontDescriptions },
     fonts_ { _fonts },
-    textShapingCache_ { ShapingResultCache::create(crispy::StrongHashtableSize { 16384 },
-                                                   crispy::LRUCapacity { TextShapingCacheSize },
-                                                   "Text shaping cache") },
+    textShapingCache_ { createShapingCache(_textShaper, _fontDescriptions, _fonts) },
     textShaper_ { _textShaper },
+    lineCache_ { LineCache::create(crispy::StrongHashtableSize { 2048 },
+                                   crispy::LRUCapacity { LineCacheSize },
+                                   "Text line cache") },
+    scaledGlyphCache_ { createScaledGlyphCache(_textShaper) },
     boxDrawingRenderer_ { _gridMetrics }
 {
 }
 
+void TextRenderer::setAsyncRasterization(size_t threadCount, size_t uploadBudget)
+{
+    rasterizerPool_.reset();
+    glyphUploadBudget_ = std::max(uploadBudget, size_t { 1 });
+    if (threadCount == 0)
+        return;
+
+    rasterizerPool_ = make_unique<GlyphRasterizerPool>(
+        threadCount, [this](text::glyph_key const& glyph, unicode::PresentationStyle presentation) {
+            return rasterizeGlyph(glyph, presentation);
+        });
+}
+
+void TextRenderer::setParallelShaping(size_t threadCount, TextShapingPool::ShaperFactory createShaper)
+{
+    renderDeferredClusterGroups();
+    shapingPool_.reset();
+
+    // Shaping results of other shapers are only valid if they share the font keys.
+    if (threadCount == 0 || !textShaper_.has_shared_font_keys())
+        return;
+
+    shapingPool_ = make_unique<TextShapingPool>(threadCount, std::move(createShaper));
+}
+
+bool TextRenderer::hasPendingGlyphs() const
+{
+    return rasterizerPool_ && rasterizerPool_->pending();
+}
+
+void TextRenderer::discardPendingGlyphs()
+{
+    if (rasterizerPool_)
+        rasterizerPool_->discard();
+}
+
 void TextRenderer::inspect(ostream& _textOutput) const
 {
     _textOutput << "TextRenderer:\n";
     textShapingCache_->inspect(_textOutput);
+    lineCache_->inspect(_textOutput);
     boxDrawingRenderer_.inspect(_textOutput);
+    _textOutput << fmt::format("shaping cache memory : {}\n",
+                               crispy::humanReadableBytes(textShapingCache_->memoryUsage()));
+    _textOutput << fmt::format("line cache memory    : {}\n",
+                               crispy::humanReadableBytes(lineCache_->storageSize()));
 }
 
 void TextRenderer::setRenderTarget(
     RenderTarget& renderTarget, atlas::DirectMappingAllocator<RenderTileAttributes>& directMappingAllocator)
 {
-    _directMapping = directMappingAllocator.allocate(DirectMappedCharsCount);
+    _directMapping =
+        directMappingAllocator.allocate(static_cast<uint32_t>(DirectMappedCharsCount * DirectMappedStyleCount));
     Renderable::setRenderTarget(renderTarget, directMappingAllocator);
     boxDrawingRenderer_.setRenderTarget(renderTarget, directMappingAllocator);
     clearCache();
@@ -343,18 +629,85 @@ void TextRenderer::setTextureAtlas(TextureAtlas& atlas)
 
     if (_directMapping)
         initializeDirectMapping();
+
+    lineCache_->clear();
 }
 
 void TextRenderer::clearCache()
 {
+    discardPendingGlyphs();
+
     if (_textureAtlas && _directMapping)
         initializeDirectMapping();
 
-    textShapingCache_->clear();
+    // The shared shaping cache is still valid for the other sessions, and is only to be replaced
+    // in case the fonts have changed.
+    textShapingCache_ = createShapingCache(textShaper_, fontDescriptions_, fonts_);
+    retainShapingCache();
+    lineCache_->clear();
+
+    // The shapers of the shaping pool are to load the current fonts.
+    deferredClusterGroups_.clear();
+    if (shapingPool_)
+        shapingPool_->reset();
+
+    // Scaled glyphs stay valid as long as their font keys, unless these are reassigned upon reloading fonts.
+    if (!textShaper_.has_shared_font_keys())
+        scaledGlyphCache_ = ScaledGlyphCache::create();
 
     boxDrawingRenderer_.clearCache();
 }
 
+void TextRenderer::retainShapingCache()
+{
+    if (!textShaper_.has_shared_font_keys())
+        return;
+
+    auto const i = std::find(recentShapingCaches_.begin(), recentShapingCaches_.end(), textShapingCache_);
+    if (i != recentShapingCaches_.end())
+        recentShapingCaches_.erase(i);
+    recentShapingCaches_.insert(recentShapingCaches_.begin(), textShapingCache_);
+    if (recentShapingCaches_.size() > RetainedShapingCacheCount)
+        recentShapingCaches_.pop_back();
+}
+
+void TextRenderer::prewarm()
+{
+    if (!_textureAtlas)
+        return;
+
+    // The glyphs of the next frame are those of the whole page, as all caches are cleared.
+    rasterizeNextFrameSynchronously_ = true;
+
+    // TUIs tend to make heavy use of box drawing characters, which are cheap enough to all be
+    // rasterized right away.
+    if (fontDescriptions_.builtinBoxDrawing)
+    {
+        auto const start = std::chrono::steady_clock::now();
+        auto const count = boxDrawingRenderer_.prewarm(std::max(1u, std::thread::hardware_concurrency()));
+        auto const elapsed = std::chrono::steady_clock::now() - start;
+        RendererLog()("Prewarmed {} box drawing tiles in {} us.",
+                      count,
+                      std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+    }
+
+    if (!_directMapping)
+        return;
+
+    auto const start = std::chrono::steady_clock::now();
+    auto count = 0;
+    for (TextStyle const style: DirectMappedStyles)
+        for (AsciiGlyph const& asciiGlyph: _asciiGlyphs[directMappedStyleIndex(style)])
+            if (asciiGlyph.tileIndex
+                && ensureRasterizedDirectMapping(asciiGlyph.tileIndex, asciiGlyph.position.glyph))
+                ++count;
+
+    auto const elapsed = std::chrono::steady_clock::now() - start;
+    RendererLog()("Prewarmed {} direct-mapped glyphs in {} us.",
+                  count,
+                  std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+}
+
 void TextRenderer::restrictToTileSize(TextureAtlas::TileCreateData& tileCreateData)
 {
     if (tileCreateData.bitmapSize.width <= _textureAtlas->tileSize().width)
@@ -397,54 +750,89 @@ void TextRenderer::restrictToTileSize(TextureAtlas::TileCreateData& tileCreateDa
 void TextRenderer::initializeDirectMapping()
 {
     Require(_textureAtlas);
-    Require(_directMapping.count == DirectMappedCharsCount);
+    Require(_directMapping.count == DirectMappedCharsCount * DirectMappedStyleCount);
 
-    _directMappedGlyphKeyToTileIndex.clear();
-    _directMappedGlyphKeyToTileIndex.resize(LastReservedChar + 1);
-
-    for (char32_t codepoint = FirstReservedChar; codepoint <= LastReservedChar; ++codepoint)
+    for (TextStyle const style: DirectMappedStyles)
     {
-        if (optional<text::glyph_position> gposOpt = textShaper_.shape(fonts_.regular, codepoint))
+        auto const styleIndex = directMappedStyleIndex(style);
+        auto const font = getFontForStyle(fonts_, style);
+        auto& glyphKeyToTileIndex = _directMappedGlyphKeyToTileIndex[styleIndex];
+        auto& asciiGlyphs = _asciiGlyphs[styleIndex];
+
+        glyphKeyToTileIndex.clear();
+        glyphKeyToTileIndex.resize(LastReservedChar + 1);
+        asciiGlyphs.fill(AsciiGlyph {});
+
+        for (char32_t codepoint = FirstReservedChar; codepoint <= LastReservedChar; ++codepoint)
         {
-            text::glyph_key const& glyph = gposOpt.value().glyph;
-            if (glyph.index.value >= _directMappedGlyphKeyToTileIndex.size())
-                _directMappedGlyphKeyToTileIndex.resize(glyph.index.value
-                                                        + (LastReservedChar - codepoint + 1));
-            _directMappedGlyphKeyToTileIndex[glyph.index.value] =
-                _directMapping.toTileIndex(codepoint - FirstReservedChar);
+            if (optional<text::glyph_position> gposOpt =
+                    withShaper([&]() { return textShaper_.shape(font, codepoint); }))
+            {
+                text::glyph_key const& glyph = gposOpt.value().glyph;
+                if (glyph.index.value >= glyphKeyToTileIndex.size())
+                    glyphKeyToTileIndex.resize(glyph.index.value + (LastReservedChar - codepoint + 1));
+
+                auto const tileIndex =
+                    _directMapping.toTileIndex(static_cast<uint32_t>(styleIndex * DirectMappedCharsCount)
+                                               + codepoint - FirstReservedChar);
+                glyphKeyToTileIndex[glyph.index.value] = tileIndex;
+                asciiGlyphs[codepoint] = AsciiGlyph { tileIndex, gposOpt.value() };
+            }
         }
     }
 }
 
+uint32_t TextRenderer::directMappedTileIndex(text::glyph_key const& glyph) const noexcept
+{
+    if (!_directMapping)
+        return 0;
+
+    for (TextStyle const style: DirectMappedStyles)
+    {
+        if (!(glyph.font == getFontForStyle(fonts_, style)))
+            continue;
+
+        auto const& glyphKeyToTileIndex = _directMappedGlyphKeyToTileIndex[directMappedStyleIndex(style)];
+        return glyph.index.value < glyphKeyToTileIndex.size() ? glyphKeyToTileIndex[glyph.index.value] : 0;
+    }
+
+    return 0;
+}
+
 Renderable::AtlasTileAttributes const* TextRenderer::ensureRasterizedIfDirectMapped(
     text::glyph_key const& glyph)
 {
-    if (!isGlyphDirectMapped(glyph))
+    auto const tileIndex = directMappedTileIndex(glyph);
+    if (!tileIndex)
         return nullptr;
 
-    auto const tileIndex = _directMappedGlyphKeyToTileIndex[glyph.index.value];
+    return ensureRasterizedDirectMapping(tileIndex, glyph);
+}
 
+Renderable::AtlasTileAttributes const* TextRenderer::ensureRasterizedDirectMapping(
+    uint32_t tileIndex, text::glyph_key const& glyph)
+{
     if (_textureAtlas->directMapped(tileIndex).bitmapSize.width.value)
         // TODO: Find a better way to test if the glyph was rasterized&uploaded already.
         // like: if (_textureAtlas->isDirectMappingSet(tileIndex)) ...
         return &_textureAtlas->directMapped(tileIndex);
 
-    auto const tileLocation = _textureAtlas->tileLocation(tileIndex);
-    auto tileCreateData = createRasterizedGlyph(tileLocation, glyph, unicode::PresentationStyle::Text);
-    if (!tileCreateData)
+    auto rasterizedGlyph =
+        withShaper([&]() { return rasterizeGlyph(glyph, unicode::PresentationStyle::Text); });
+    if (!rasterizedGlyph)
         return nullptr;
 
-    // Require(tileCreateData->bitmapSize.width <= textureAtlas().tileSize().width);
-    restrictToTileSize(*tileCreateData);
+    auto const tileLocation = _textureAtlas->tileLocation(tileIndex);
+    auto tileCreateData = createGlyphTileData(tileLocation,
+                                              *rasterizedGlyph,
+                                              std::move(rasterizedGlyph->bitmap),
+                                              rasterizedGlyph->bitmapSize,
+                                              rasterizedGlyph->position.x);
 
-    // fmt::print("Initialize direct mapping {} ({}) for {}; {}; {}\n",
-    //            tileIndex,
-    //            tileLocation,
-    //            glyph,
-    //            tileCreateData->bitmapSize,
-    //            tileCreateData->metadata);
+    // Require(tileCreateData.bitmapSize.width <= textureAtlas().tileSize().width);
+    restrictToTileSize(tileCreateData);
 
-    _textureAtlas->setDirectMapping(tileIndex, std::move(*tileCreateData));
+    _textureAtlas->setDirectMapping(tileIndex, std::move(tileCreateData));
     return &_textureAtlas->directMapped(tileIndex);
 }
 
@@ -462,9 +850,21 @@ void TextRenderer::beginFrame()
     Require(textClusterGroup_.codepoints.empty());
     Require(textClusterGroup_.clusters.empty());
 
-    auto constexpr DefaultColor = RGBColor {};
     textClusterGroup_.style = TextStyle::Invalid;
-    textClusterGroup_.color = DefaultColor;
+
+    placeholdersRendered_ = false;
+    if (rasterizerPool_)
+        uploadRasterizedGlyphs();
+}
+
+void TextRenderer::uploadRasterizedGlyphs()
+{
+    rasterizedGlyphs_.clear();
+    rasterizerPool_->fetchResults(rasterizedGlyphs_, glyphUploadBudget_);
+    for (GlyphRasterizerPool::Result& result: rasterizedGlyphs_)
+        if (result.bitmap && !textureAtlas().contains(result.hash))
+            (void) insertRasterizedGlyph(result.hash, std::move(*result.bitmap));
+    rasterizedGlyphs_.clear();
 }
 
 void TextRenderer::renderLine(RenderLine const& renderLine)
@@ -474,11 +874,20 @@ void TextRenderer::renderLine(RenderLine const& renderLine)
 
     auto const textStyle = makeTextStyle(renderLine.textAttributes.flags);
 
-    auto graphemeClusterSegmenter = unicode::utf8_grapheme_segmenter(renderLine.text);
+    if (!textClusterGroup_.codepoints.empty())
+        flushTextClusterGroup();
+
     auto columnOffset = ColumnOffset(0);
+    auto const origin = _gridMetrics.mapBottomLeft(CellLocation { renderLine.lineOffset, columnOffset });
+    auto const hash = hashLine(renderLine.text, textStyle, renderLine.displayWidth);
+    if (tryRenderCachedLine(hash, origin, renderLine.textAttributes.foregroundColor))
+        return;
 
-    textClusterGroup_.initialPenPosition =
-        _gridMetrics.mapBottomLeft(CellLocation { renderLine.lineOffset, columnOffset });
+    auto graphemeClusterSegmenter = unicode::utf8_grapheme_segmenter(renderLine.text);
+
+    textClusterGroup_.initialPenPosition = origin;
+    lineRecording_.emplace();
+    lineRecordingOrigin_ = origin;
 
     for (u32string const& graphemeCluster: graphemeClusterSegmenter)
     {
@@ -497,6 +906,52 @@ void TextRenderer::renderLine(RenderLine const& renderLine)
 
     if (!textClusterGroup_.codepoints.empty())
         flushTextClusterGroup();
+
+    // Lines with box drawing characters are not recorded.
+    if (lineRecording_)
+        lineCache_->emplace(hash, std::move(*lineRecording_));
+    lineRecording_.reset();
+}
+
+bool TextRenderer::tryRenderCachedLine(StrongHash const& hash, Point origin, RGBColor color)
+{
+    CachedLineTiles const* tiles = lineCache_->try_get(hash);
+    if (!tiles)
+        return false;
+
+    cachedLineAttributes_.clear();
+    for (CachedLineTile const& tile: *tiles)
+    {
+        AtlasTileAttributes const* attributes = tile.directTileIndex
+                                                    ? &_textureAtlas->directMapped(tile.directTileIndex)
+                                                    : _textureAtlas->try_get(tile.hash);
+        if (!attributes)
+        {
+            // A tile has been evicted from the texture atlas in the meantime.
+            lineCache_->remove(hash);
+            return false;
+        }
+        cachedLineAttributes_.emplace_back(attributes);
+    }
+
+    textRendererEvents_.onBeforeRenderingText();
+    for (size_t i = 0; i < tiles->size(); ++i)
+    {
+        auto const offset = (*tiles)[i].offset;
+        renderRasterizedGlyph(
+            Point { origin.x + offset.x, origin.y + offset.y }, color, *cachedLineAttributes_[i]);
+    }
+    textRendererEvents_.onAfterRenderingText();
+    return true;
+}
+
+void TextRenderer::recordLineTile(Point pen, uint32_t directTileIndex, StrongHash const& hash)
+{
+    if (!lineRecording_)
+        return;
+
+    auto const offset = Point { pen.x - lineRecordingOrigin_.x, pen.y - lineRecordingOrigin_.y };
+    lineRecording_->emplace_back(CachedLineTile { offset, directTileIndex, hash });
 }
 
 void TextRenderer::renderCell(RenderCell const& cell)
@@ -505,7 +960,7 @@ void TextRenderer::renderCell(RenderCell const& cell)
         updateInitialPenPosition_ = true;
 
     renderCell(cell.position,
-               cell.codepoints,
+               cell.codepoints(),
                makeTextStyle(cell.attributes.flags),
                cell.attributes.foregroundColor);
 
@@ -533,6 +988,7 @@ void TextRenderer::renderCell(CellLocation position,
             boxDrawingRenderer_.render(position.line, position.column, codepoints[0], foregroundColor);
         if (success)
         {
+            lineRecording_.reset();
             if (!updateInitialPenPosition_)
                 flushTextClusterGroup();
             updateInitialPenPosition_ = true;
@@ -546,6 +1002,12 @@ void TextRenderer::renderCell(CellLocation position,
 void TextRenderer::endFrame()
 {
     flushTextClusterGroup();
+    renderDeferredClusterGroups();
+    rasterizeNextFrameSynchronously_ = false;
+
+    textShapingCache_->publishStats();
+    lineCacheStats_.update(lineCache_->fetchAndClearStats(), lineCache_->size(), lineCache_->capacity());
+    lineCacheMemory_.update(lineCache_->storageSize(), lineCache_->size());
 }
 
 Point TextRenderer::applyGlyphPositionToPen(Point pen,
@@ -612,7 +1074,11 @@ void TextRenderer::renderRasterizedGlyph(crispy::Point pen,
 
 void TextRenderer::appendCellTextToClusterGroup(u32string_view _codepoints, TextStyle _style, RGBColor _color)
 {
-    bool const attribsChanged = _color != textClusterGroup_.color || _style != textClusterGroup_.style;
+    // Text groups are words, i.e. split at whitespace and at changes of the text style, and their
+    // shaping results are cached by text and style. The color does not affect shaping. Therefore
+    // it does not split the group, such that neither ligatures are broken up nor words reshaped
+    // when only their coloring changes (e.g. syntax highlighting, or the cursor moving over them).
+    bool const attribsChanged = _style != textClusterGroup_.style;
     bool const hasText = !_codepoints.empty() && _codepoints[0] != 0x20;
     bool const noText = !hasText;
     bool const textStartFound = !textStartFound_ && hasText;
@@ -622,7 +1088,6 @@ void TextRenderer::appendCellTextToClusterGroup(u32string_view _codepoints, Text
     {
         if (textClusterGroup_.cellCount)
             flushTextClusterGroup(); // also increments text start position
-        textClusterGroup_.color = _color;
         textClusterGroup_.style = _style;
         textStartFound_ = textStartFound;
     }
@@ -632,12 +1097,13 @@ void TextRenderer::appendCellTextToClusterGroup(u32string_view _codepoints, Text
         textClusterGroup_.codepoints.emplace_back(codepoint);
         textClusterGroup_.clusters.emplace_back(textClusterGroup_.cellCount);
     }
+    textClusterGroup_.cellColors.emplace_back(_color);
     textClusterGroup_.cellCount++;
 }
 
 void TextRenderer::flushTextClusterGroup()
 {
-    if (!textClusterGroup_.codepoints.empty())
+    if (!textClusterGroup_.codepoints.empty() && !tryRenderAsciiClusterGroup())
     {
         // fmt::print("TextRenderer.flushTextClusterGroup: textPos={}, cellCount={}, width={}, count={}\n",
         //            textClusterGroup_.initialPenPosition, textClusterGroup_.cellCount,
@@ -649,163 +1115,243 @@ void TextRenderer::flushTextClusterGroup()
         auto hash = hashTextAndStyle(
             u32string_view(textClusterGroup_.codepoints.data(), textClusterGroup_.codepoints.size()),
             textClusterGroup_.style);
-        text::shape_result const& glyphPositions = getOrCreateCachedGlyphPositions(hash);
-        crispy::Point pen = textClusterGroup_.initialPenPosition;
-        auto const advanceX = *_gridMetrics.cellSize.width;
+        if (!shapingPool_)
+            renderClusterGroup(textClusterGroup_, *getOrCreateCachedGlyphPositions(hash));
+        else if (auto const glyphPositions = textShapingCache_->try_get(hash); glyphPositions)
+            renderClusterGroup(textClusterGroup_, *glyphPositions);
+        else
+        {
+            // Shaped along with the other misses of this frame, and thus not recorded into the line cache.
+            deferredClusterGroups_.emplace_back(DeferredClusterGroup { hash, textClusterGroup_ });
+            lineRecording_.reset();
+        }
+        textRendererEvents_.onAfterRenderingText();
+    }
 
-        for (text::glyph_position const& glyphPosition: glyphPositions)
+    textClusterGroup_.resetAndMovePenForward(textClusterGroup_.cellCount
+                                             * unbox<int>(_gridMetrics.cellSize.width));
+    textStartFound_ = false;
+}
+
+void TextRenderer::renderClusterGroup(TextClusterGroup const& _group,
+                                      text::shape_result const& _glyphPositions)
+{
+    crispy::Point pen = _group.initialPenPosition;
+    auto const advanceX = *_gridMetrics.cellSize.width;
+    auto const cellWidth = unbox<int>(_gridMetrics.cellSize.width);
+
+    for (text::glyph_position const& glyphPosition: _glyphPositions)
+    {
+        if (AtlasTileAttributes const* attributes = ensureRasterizedIfDirectMapped(glyphPosition.glyph))
         {
-            if (AtlasTileAttributes const* attributes = ensureRasterizedIfDirectMapped(glyphPosition.glyph))
-            {
-                auto const pen1 = applyGlyphPositionToPen(pen, *attributes, glyphPosition);
-                renderRasterizedGlyph(pen1, textClusterGroup_.color, *attributes);
-                pen.x += static_cast<decltype(pen.x)>(advanceX);
-                continue;
-            }
+            auto const pen1 = applyGlyphPositionToPen(pen, *attributes, glyphPosition);
+            renderRasterizedGlyph(pen1, _group.colorAt(pen, cellWidth), *attributes);
+            recordLineTile(pen1, directMappedTileIndex(glyphPosition.glyph), {});
+            pen.x += static_cast<decltype(pen.x)>(advanceX);
+            continue;
+        }
 
-            auto const hash = hashGlyphKeyAndPresentation(glyphPosition.glyph, glyphPosition.presentation);
+        auto const hash = hashGlyphKeyAndPresentation(glyphPosition.glyph, glyphPosition.presentation);
 
-            AtlasTileAttributes const* attributes =
-                getOrCreateRasterizedMetadata(hash, glyphPosition.glyph, glyphPosition.presentation);
+        AtlasTileAttributes const* attributes =
+            getOrCreateRasterizedMetadata(hash, glyphPosition.glyph, glyphPosition.presentation);
 
-            if (attributes)
-            {
-                auto const pen1 = applyGlyphPositionToPen(pen, *attributes, glyphPosition);
-                renderRasterizedGlyph(pen1, textClusterGroup_.color, *attributes);
-
-                auto xOffset = unbox<uint32_t>(textureAtlas().tileSize().width);
-                while (AtlasTileAttributes const* subAttribs = textureAtlas().try_get(hash * xOffset))
-                {
-                    renderTile(atlas::RenderTile::X { pen1.x + int(xOffset) },
-                               atlas::RenderTile::Y { pen1.y },
-                               textClusterGroup_.color,
-                               *subAttribs);
-                    xOffset += unbox<uint32_t>(textureAtlas().tileSize().width);
-                }
-            }
+        if (attributes)
+        {
+            auto const color = _group.colorAt(pen, cellWidth);
+            auto const pen1 = applyGlyphPositionToPen(pen, *attributes, glyphPosition);
+            renderRasterizedGlyph(pen1, color, *attributes);
+            recordLineTile(pen1, 0, hash);
 
-            if (glyphPosition.advance.x)
+            auto xOffset = unbox<uint32_t>(textureAtlas().tileSize().width);
+            while (AtlasTileAttributes const* subAttribs = textureAtlas().try_get(hash * xOffset))
             {
-                // Only advance horizontally, as we're (guess what) a terminal. :-)
-                // Only advance in fixed-width steps.
-                // Only advance iff there harfbuzz told us to.
-                pen.x += static_cast<decltype(pen.x)>(advanceX);
+                renderTile(atlas::RenderTile::X { pen1.x + int(xOffset) },
+                           atlas::RenderTile::Y { pen1.y },
+                           color,
+                           *subAttribs);
+                recordLineTile(Point { pen1.x + int(xOffset), pen1.y }, 0, hash * xOffset);
+                xOffset += unbox<uint32_t>(textureAtlas().tileSize().width);
             }
         }
-        textRendererEvents_.onAfterRenderingText();
+
+        if (glyphPosition.advance.x)
+        {
+            // Only advance horizontally, as we're (guess what) a terminal. :-)
+            // Only advance in fixed-width steps.
+            // Only advance iff there harfbuzz told us to.
+            pen.x += static_cast<decltype(pen.x)>(advanceX);
+        }
     }
+}
 
-    textClusterGroup_.resetAndMovePenForward(textClusterGroup_.cellCount
-                                             * unbox<int>(_gridMetrics.cellSize.width));
-    textStartFound_ = false;
+void TextRenderer::renderDeferredClusterGroups()
+{
+    if (deferredClusterGroups_.empty())
+        return;
+
+    auto shapeResults = vector<text::shape_result>(deferredClusterGroups_.size());
+    auto const shapeDeferred = [&](text::shaper& _shaper, size_t _index) {
+        shapeResults[_index] = shapeClusterGroup(_shaper, fonts_, deferredClusterGroups_[_index].group);
+    };
+
+    // A few texts are not worth starting threads for.
+    if (deferredClusterGroups_.size() < MinParallelShapingCount
+        || !shapingPool_->run(deferredClusterGroups_.size(), shapeDeferred))
+    {
+        withShaper([&]() {
+            for (size_t i = 0; i < deferredClusterGroups_.size(); ++i)
+                shapeDeferred(textShaper_, i);
+        });
+    }
+
+    textRendererEvents_.onBeforeRenderingText();
+    for (size_t i = 0; i < deferredClusterGroups_.size(); ++i)
+    {
+        auto const& deferred = deferredClusterGroups_[i];
+        auto const glyphPositions =
+            textShapingCache_->get_or_emplace(deferred.hash, [&]() { return std::move(shapeResults[i]); });
+        renderClusterGroup(deferred.group, *glyphPositions);
+    }
+    textRendererEvents_.onAfterRenderingText();
+
+    deferredClusterGroups_.clear();
 }
 
 Renderable::AtlasTileAttributes const* TextRenderer::getOrCreateRasterizedMetadata(
     StrongHash const& hash, text::glyph_key const& glyphKey, unicode::PresentationStyle presentationStyle)
 {
-    // clang-format off
-    return textureAtlas().get_or_try_emplace(
-        hash,
-        [&](atlas::TileLocation tileLocation)
-        -> optional<TextureAtlas::TileCreateData>
+    if (AtlasTileAttributes const* attributes = textureAtlas().try_get(hash))
+        return attributes;
+
+    if (rasterizerPool_ && !rasterizeNextFrameSynchronously_)
+    {
+        // The glyph is left blank for now, and rendered with one of the next frames.
+        if (rasterizerPool_->request(hash, glyphKey, presentationStyle))
         {
-            return createSlicedRasterizedGlyph(tileLocation, glyphKey, presentationStyle, hash);
+            placeholdersRendered_ = true;
+            lineRecording_.reset();
         }
-    );
-    // clang-format on
+        return nullptr;
+    }
+
+    auto glyph = withShaper([&]() { return rasterizeGlyph(glyphKey, presentationStyle); });
+    if (!glyph)
+        return nullptr;
+
+    return insertRasterizedGlyph(hash, std::move(*glyph));
 }
 
-auto TextRenderer::createSlicedRasterizedGlyph(atlas::TileLocation tileLocation,
-                                               text::glyph_key const& glyphKey,
-                                               unicode::PresentationStyle presentation,
-                                               StrongHash const& hash)
-    -> optional<TextureAtlas::TileCreateData>
+auto TextRenderer::createGlyphTileData(atlas::TileLocation tileLocation,
+                                       text::rasterized_glyph const& glyph,
+                                       vector<uint8_t> bitmap,
+                                       ImageSize bitmapSize,
+                                       int x) -> TextureAtlas::TileCreateData
 {
-    auto result = createRasterizedGlyph(tileLocation, glyphKey, presentation);
-    if (!result)
-        return result;
+    return createTileData(tileLocation,
+                          std::move(bitmap),
+                          toAtlasFormat(glyph.format),
+                          bitmapSize,
+                          RenderTileAttributes::X { x },
+                          RenderTileAttributes::Y { glyph.position.y },
+                          toFragmentShaderSelector(glyph.format, fontDescriptions_.renderMode));
+}
 
-    auto& createData = *result;
+Renderable::AtlasTileAttributes const* TextRenderer::insertRasterizedGlyph(StrongHash const& hash,
+                                                                           text::rasterized_glyph glyph)
+{
+    auto const tileWidth = unbox<uintptr_t>(textureAtlas().tileSize().width);
+    auto const glyphWidth = unbox<uintptr_t>(glyph.bitmapSize.width);
 
-    if (unbox<int>(createData.bitmapSize.width) <= unbox<int>(textureAtlas().tileSize().width))
+    // clang-format off
+    if (glyphWidth <= tileWidth)
         // standard (narrow) rasterization
-        return result;
+        return textureAtlas().get_or_try_emplace(
+            hash,
+            toAtlasFormat(glyph.format),
+            [&](atlas::TileLocation tileLocation) -> optional<TextureAtlas::TileCreateData>
+            {
+                return createGlyphTileData(
+                    tileLocation, glyph, std::move(glyph.bitmap), glyph.bitmapSize, glyph.position.x);
+            }
+        );
+    // clang-format on
 
-    // Now, slice wide glyph into smaller fitting tiles,
-    // upload all but the head-tile explicitly and then return the head-tile
-    // to the caller.
+    // Slice wide glyph into smaller fitting tiles, the head-tile being stored by the glyph's hash
+    // and every following tile by the hash multiplied with its x-offset.
+    for (uintptr_t xOffset = 0; xOffset < glyphWidth; xOffset += tileWidth)
+    {
+        auto const subWidth = min(tileWidth, glyphWidth - xOffset);
+        auto const subSize = ImageSize { Width::cast_from(subWidth), glyph.bitmapSize.height };
+        auto const key = xOffset ? hash * uint32_t(xOffset) : hash;
+        textureAtlas().emplace(key, toAtlasFormat(glyph.format), [&](atlas::TileLocation tileLocation) {
+            return createGlyphTileData(tileLocation,
+                                       glyph,
+                                       sliceBitmap(glyph, xOffset, subWidth),
+                                       subSize,
+                                       xOffset ? 0 : glyph.position.x);
+        });
+    }
 
-    auto const bitmapFormat = createData.bitmapFormat;
-    auto const colorComponentCount = atlas::element_count(bitmapFormat);
-    auto const pitch = unbox<uintptr_t>(createData.bitmapSize.width) * colorComponentCount;
-
-    auto const tileWidth = unbox<uintptr_t>(_gridMetrics.cellSize.width);
-    for (uintptr_t xOffset = tileWidth; xOffset < unbox<uintptr_t>(createData.bitmapSize.width); xOffset +=
-                                                                                                 tileWidth)
-    {
-        textureAtlas().emplace(
-            hash * uint32_t(xOffset),
-            [this, xOffset, tileWidth, &createData, colorComponentCount, bitmapFormat, pitch](
-                atlas::TileLocation tileLocation) {
-                auto const xNext = min(xOffset + tileWidth, unbox<uintptr_t>(createData.bitmapSize.width));
-                auto const subWidth = Width::cast_from(xNext - xOffset);
-                auto const subSize = ImageSize { subWidth, createData.bitmapSize.height };
-                auto const subPitch = unbox<uintptr_t>(subWidth) * colorComponentCount;
-
-                auto bitmap = vector<uint8_t>(subSize.area() * colorComponentCount);
-                for (uintptr_t rowIndex = 0; rowIndex < unbox<uintptr_t>(subSize.height); ++rowIndex)
-                {
-                    uint8_t* targetRow = bitmap.data() + rowIndex * subPitch;
-                    uint8_t const* sourceRow = createData.bitmap.data() + rowIndex * pitch
-                                               + uintptr_t(xOffset) * colorComponentCount;
-                    Require(sourceRow + subPitch <= createData.bitmap.data() + createData.bitmap.size());
-                    std::memcpy(targetRow, sourceRow, subPitch);
-                }
-
-                return createTileData(tileLocation,
-                                      std::move(bitmap),
-                                      bitmapFormat,
-                                      subSize,
-                                      RenderTileAttributes::X { 0 },
-                                      createData.metadata.y,
-                                      createData.metadata.fragmentShaderSelector);
-            });
-    }
-
-    // Construct head-tile
-    // cut off bitmap to first tile
-    auto const headWidth = textureAtlas().tileSize().width;
-    auto const headSize = ImageSize { headWidth, createData.bitmapSize.height };
-    auto const headPitch = unbox<uintptr_t>(headWidth) * colorComponentCount;
-    auto headBitmap = vector<uint8_t>(headSize.area() * colorComponentCount);
-    for (uintptr_t rowIndex = 0; rowIndex < unbox<uintptr_t>(headSize.height); ++rowIndex)
-        std::memcpy(headBitmap.data() + rowIndex * headPitch,    // target
-                    createData.bitmap.data() + rowIndex * pitch, // source
-                    headPitch);                                  // sub-image line length
-
-    return { createTileData(tileLocation,
-                            std::move(headBitmap),
-                            bitmapFormat,
-                            headSize,
-                            createData.metadata.x,
-                            createData.metadata.y,
-                            createData.metadata.fragmentShaderSelector) };
-}
-
-auto TextRenderer::createRasterizedGlyph(atlas::TileLocation tileLocation,
-                                         text::glyph_key const& glyphKey,
-                                         unicode::PresentationStyle presentation)
-    -> optional<TextureAtlas::TileCreateData>
-{
-    auto theGlyphOpt = textShaper_.rasterize(glyphKey, fontDescriptions_.renderMode);
-    if (!theGlyphOpt.has_value())
+    // Storing the following tiles may have evicted the head tile again.
+    return textureAtlas().try_get(hash);
+}
+
+optional<text::rasterized_glyph> TextRenderer::rasterizeFittingGlyph(text::glyph_key const& glyphKey,
+                                                                     ImageSize boundingBox)
+{
+    auto const renderMode = fontDescriptions_.renderMode;
+    auto const boxWidth = unbox<uint32_t>(boundingBox.width);
+    auto const boxHeight = unbox<uint32_t>(boundingBox.height);
+
+    auto const scaledKey = StrongHash(glyphKey.font.value, glyphKey.index.value, boxWidth, boxHeight)
+                           * StrongHash(0, 0, 0, static_cast<uint32_t>(renderMode));
+    if (auto scaledGlyph = scaledGlyphCache_->get(scaledKey))
+        return scaledGlyph;
+
+    // Scaled glyphs are told apart from the shaper's unscaled ones by their bounding box.
+    auto const diskKey = [&]() -> optional<StrongHash> {
+        if (!glyphDiskCache_)
+            return nullopt;
+        if (auto const glyphCacheKey = textShaper_.glyph_cache_key(glyphKey, renderMode))
+            return *glyphCacheKey * StrongHash(1, 0, boxWidth, boxHeight);
         return nullopt;
+    }();
+    if (diskKey)
+    {
+        if (auto scaledGlyph = glyphDiskCache_->get(*diskKey))
+        {
+            scaledGlyphCache_->put(scaledKey, *scaledGlyph);
+            return scaledGlyph;
+        }
+    }
 
-    text::rasterized_glyph& glyph = theGlyphOpt.value();
-    Require(glyph.bitmap.size()
-            == text::pixel_size(glyph.format) * unbox<size_t>(glyph.bitmapSize.width)
-                   * unbox<size_t>(glyph.bitmapSize.height));
+    auto glyph = textShaper_.rasterize(glyphKey, renderMode);
+    if (!glyph || glyph->format != text::bitmap_format::rgba)
+        return glyph;
+
+    if (glyph->bitmapSize.height <= Height::cast_from(unbox<double>(boundingBox.height) * 1.1)
+        && glyph->bitmapSize.width <= Width::cast_from(unbox<double>(boundingBox.width) * 1.5))
+        return glyph;
 
+    if (RasterizerLog)
+        RasterizerLog()("Scaling oversized glyph of {}+{} down to bounding box {}.",
+                        glyph->bitmapSize,
+                        glyph->position,
+                        boundingBox);
+    auto [scaledGlyph, scaleFactor] = text::scale(*glyph, boundingBox);
+    RasterizerLog()(" ==> scaled: {}/{}, factor {}", scaledGlyph, boundingBox, scaleFactor);
+
+    scaledGlyphCache_->put(scaledKey, scaledGlyph);
+    if (diskKey)
+        glyphDiskCache_->put(*diskKey, scaledGlyph);
+
+    return std::move(scaledGlyph);
+}
+
+optional<text::rasterized_glyph> TextRenderer::rasterizeGlyph(text::glyph_key const& glyphKey,
+                                                              unicode::PresentationStyle presentation)
+{
     uint32_t const numCells = presentation == unicode::PresentationStyle::Emoji
                                   ? 2
                                   : 1; // is this the only case - with colored := Emoji presentation?
@@ -817,24 +1363,15 @@ auto TextRenderer::createRasterizedGlyph(atlas::TileLocation tileLocation,
     auto const emojiBoundingBox =
         ImageSize { Width(_gridMetrics.cellSize.width.value * numCells),
                     Height::cast_from(unbox<int>(_gridMetrics.cellSize.height) - _gridMetrics.baseline) };
-    if (glyph.format == text::bitmap_format::rgba)
-    {
-        if (glyph.bitmapSize.height > Height::cast_from(unbox<double>(emojiBoundingBox.height) * 1.1)
-            || glyph.bitmapSize.width > Width::cast_from(unbox<double>(emojiBoundingBox.width) * 1.5))
-        {
-            if (RasterizerLog)
-                RasterizerLog()(
-                    "Scaling oversized glyph of {}+{} down to bounding box {} (expected cell count {}).",
-                    glyph.bitmapSize,
-                    glyph.position,
-                    emojiBoundingBox,
-                    numCells);
-            auto [scaledGlyph, scaleFactor] = text::scale(glyph, emojiBoundingBox);
-
-            glyph = std::move(scaledGlyph);
-            RasterizerLog()(" ==> scaled: {}/{}, factor {}", scaledGlyph, emojiBoundingBox, scaleFactor);
-        }
-    }
+
+    auto theGlyphOpt = rasterizeFittingGlyph(glyphKey, emojiBoundingBox);
+    if (!theGlyphOpt.has_value())
+        return nullopt;
+
+    text::rasterized_glyph& glyph = theGlyphOpt.value();
+    Require(glyph.bitmap.size()
+            == text::pixel_size(glyph.format) * unbox<size_t>(glyph.bitmapSize.width)
+                   * unbox<size_t>(glyph.bitmapSize.height));
 
     // y-position relative to cell-bottom of glyphs top.
     auto const yMax = _gridMetrics.baseline + glyph.position.y;
@@ -866,13 +1403,10 @@ auto TextRenderer::createRasterizedGlyph(atlas::TileLocation tileLocation,
 
     if (RasterizerLog)
     {
-        auto const boundingBox =
-            ImageSize { Width(_gridMetrics.cellSize.width.value * numCells),
-                        Height::cast_from(unbox<int>(_gridMetrics.cellSize.height) - _gridMetrics.baseline) };
         // clang-format off
         RasterizerLog()("Inserting {} (bbox {}, numCells {}) id {} render mode {} {} yOverflow {} yMin {}.",
                         glyph,
-                        boundingBox,
+                        emojiBoundingBox,
                         numCells,
                         glyphKey.index,
                         fontDescriptions_.renderMode,
@@ -882,29 +1416,61 @@ auto TextRenderer::createRasterizedGlyph(atlas::TileLocation tileLocation,
         // clang-format on
     }
 
-    return { createTileData(tileLocation,
-                            std::move(glyph.bitmap),
-                            toAtlasFormat(glyph.format),
-                            glyph.bitmapSize,
-                            RenderTileAttributes::X { glyph.position.x },
-                            RenderTileAttributes::Y { glyph.position.y },
-                            toFragmentShaderSelector(glyph.format)) };
+    return theGlyphOpt;
+}
+
+bool TextRenderer::tryRenderAsciiClusterGroup()
+{
+    if (!_directMapping || textClusterGroup_.style == TextStyle::Invalid
+        || textClusterGroup_.codepoints.size() != static_cast<size_t>(textClusterGroup_.cellCount))
+        return false;
+
+    auto const& asciiGlyphs = _asciiGlyphs[directMappedStyleIndex(textClusterGroup_.style)];
+    for (char32_t const codepoint: textClusterGroup_.codepoints)
+        if (!isAsciiAlphanumeric(codepoint) || !asciiGlyphs[codepoint].tileIndex)
+            return false;
+
+    textRendererEvents_.onBeforeRenderingText();
+
+    auto pen = textClusterGroup_.initialPenPosition;
+    auto const advanceX = unbox<int>(_gridMetrics.cellSize.width);
+    for (auto const [i, codepoint]: crispy::indexed(textClusterGroup_.codepoints))
+    {
+        AsciiGlyph const& glyph = asciiGlyphs[codepoint];
+        if (AtlasTileAttributes const* attributes =
+                ensureRasterizedDirectMapping(glyph.tileIndex, glyph.position.glyph))
+        {
+            auto const pen1 = applyGlyphPositionToPen(pen, *attributes, glyph.position);
+            renderRasterizedGlyph(pen1, textClusterGroup_.cellColors[i], *attributes);
+            recordLineTile(pen1, glyph.tileIndex, {});
+        }
+        pen.x += advanceX;
+    }
+
+    textRendererEvents_.onAfterRenderingText();
+    return true;
 }
 
-text::shape_result const& TextRenderer::getOrCreateCachedGlyphPositions(StrongHash hash)
+ShapingResultCache::Value TextRenderer::getOrCreateCachedGlyphPositions(StrongHash hash)
 {
-    return textShapingCache_->get_or_emplace(hash, [this](auto) { return createTextShapedGlyphPositions(); });
+    return textShapingCache_->get_or_emplace(hash, [this]() { return createTextShapedGlyphPositions(); });
 }
 
 text::shape_result TextRenderer::createTextShapedGlyphPositions()
+{
+    return withShaper([&]() { return shapeClusterGroup(textShaper_, fonts_, textClusterGroup_); });
+}
+
+text::shape_result TextRenderer::shapeClusterGroup(text::shaper& _shaper,
+                                                   FontKeys const& _fonts,
+                                                   TextClusterGroup const& _group)
 {
     auto glyphPositions = text::shape_result {};
 
     auto run = unicode::run_segmenter::range {};
-    auto rs = unicode::run_segmenter(
-        u32string_view(textClusterGroup_.codepoints.data(), textClusterGroup_.codepoints.size()));
+    auto rs = unicode::run_segmenter(u32string_view(_group.codepoints.data(), _group.codepoints.size()));
     while (rs.consume(out(run)))
-        for (text::glyph_position& glyphPosition: shapeTextRun(run))
+        for (text::glyph_position& glyphPosition: shapeTextRun(_shaper, _fonts, _group, run))
             glyphPositions.emplace_back(std::move(glyphPosition));
 
     return glyphPositions;
@@ -918,25 +1484,28 @@ text::shape_result TextRenderer::createTextShapedGlyphPositions()
  *  - same language tag
  *  - same SGR attributes (font style, color)
  */
-text::shape_result TextRenderer::shapeTextRun(unicode::run_segmenter::range const& _run)
+text::shape_result TextRenderer::shapeTextRun(text::shaper& _shaper,
+                                              FontKeys const& _fonts,
+                                              TextClusterGroup const& _group,
+                                              unicode::run_segmenter::range const& _run)
 {
     // TODO(where to apply cell-advances) auto const advanceX = _gridMetrics.cellSize.width;
     auto const count = static_cast<size_t>(_run.end - _run.start);
-    auto const codepoints = u32string_view(textClusterGroup_.codepoints.data() + _run.start, count);
-    auto const clusters = gsl::span(textClusterGroup_.clusters.data() + _run.start, count);
+    auto const codepoints = u32string_view(_group.codepoints.data() + _run.start, count);
+    auto const clusters = gsl::span(_group.clusters.data() + _run.start, count);
     auto const script = get<unicode::Script>(_run.properties);
     auto const presentationStyle = get<unicode::PresentationStyle>(_run.properties);
     auto const isEmojiPresentation = presentationStyle == unicode::PresentationStyle::Emoji;
-    auto const font = isEmojiPresentation ? fonts_.emoji : getFontForStyle(fonts_, textClusterGroup_.style);
+    auto const font = isEmojiPresentation ? _fonts.emoji : getFontForStyle(_fonts, _group.style);
 
     text::shape_result glyphPosition;
     glyphPosition.reserve(clusters.size());
-    textShaper_.shape(font,
-                      codepoints,
-                      clusters,
-                      script,            // get<unicode::Script>(_run.properties),
-                      presentationStyle, // get<unicode::PresentationStyle>(_run.properties),
-                      glyphPosition);
+    _shaper.shape(font,
+                  codepoints,
+                  clusters,
+                  script,            // get<unicode::Script>(_run.properties),
+                  presentationStyle, // get<unicode::PresentationStyle>(_run.properties),
+                  glyphPosition);
 
     if (RasterizerLog && !glyphPosition.empty())
     {
@@ -19,14 +19,21 @@
 
 #include <terminal_renderer/BoxDrawingRenderer.h>
 #include <terminal_renderer/FontDescriptions.h>
+#include <terminal_renderer/GlyphRasterizerPool.h>
 #include <terminal_renderer/RenderTarget.h>
+#include <terminal_renderer/TextShapingPool.h>
 #include <terminal_renderer/TextureAtlas.h>
 
 #include <text_shaper/font.h>
+#include <text_shaper/glyph_disk_cache.h>
 #include <text_shaper/shaper.h>
 
+#include <crispy/AdaptiveCapacity.h>
+#include <crispy/CacheStats.h>
+#include <crispy/MemoryStats.h>
 #include <crispy/FNV.h>
 #include <crispy/LRUCache.h>
+#include <crispy/StrongLRUHashtable.h>
 #include <crispy/point.h>
 #include <crispy/size.h>
 
@@ -36,9 +43,13 @@
 #include <gsl/span>
 #include <gsl/span_ext>
 
+#include <algorithm>
+#include <array>
 #include <functional>
 #include <list>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <unordered_map>
 #include <vector>
 
@@ -47,6 +58,10 @@ namespace terminal::renderer
 
 text::font_locator& createFontLocator(FontLocatorEngine _engine);
 
+/// Starts locating the given fonts in the background, if supported by the configured font locator,
+/// such that loading them later on does not have to wait for the font locator.
+void prefetchFonts(FontDescriptions const& _fontDescriptions);
+
 struct FontKeys
 {
     text::font_key regular;
@@ -56,6 +71,106 @@ struct FontKeys
     text::font_key emoji;
 };
 
+/**
+ * Thread-safe cache of text shaping results, keyed by text and style.
+ *
+ * Text renderers using the same fonts may share a cache process-wide (see shared()),
+ * such that text is shaped only once for all terminal sessions rather than once per session.
+ */
+class ShapingResultCache
+{
+  public:
+    using Ptr = std::shared_ptr<ShapingResultCache>;
+    using Value = std::shared_ptr<text::shape_result const>;
+
+    /// Creates a cache used by the caller alone.
+    static Ptr create();
+
+    /// @returns the cache shared by all callers with the same fonts, creating it if needed.
+    ///
+    /// The cache lives as long as any of its callers holds on to it. It must only be used
+    /// if the font keys identify the same fonts in all shapers (see text::shaper::has_shared_font_keys()).
+    static Ptr shared(FontDescriptions const& _fontDescriptions, FontKeys const& _fonts);
+
+    /// @returns the shaping result for the given key, or nullptr if not cached (yet).
+    [[nodiscard]] Value try_get(crispy::StrongHash const& _hash)
+    {
+        auto const _ = std::lock_guard { mutex_ };
+        if (Value const* result = cache_->try_get(_hash))
+            return *result;
+        return nullptr;
+    }
+
+    /// @returns the shaping result for the given key, invoking @p _create if not cached yet.
+    template <typename F>
+    [[nodiscard]] Value get_or_emplace(crispy::StrongHash const& _hash, F&& _create)
+    {
+        {
+            auto const _ = std::lock_guard { mutex_ };
+            if (Value const* result = cache_->try_get(_hash))
+                return *result;
+        }
+
+        // Shape without holding the lock, such that other renderers are not blocked meanwhile.
+        auto result = std::make_shared<text::shape_result const>(_create());
+        auto const _ = std::lock_guard { mutex_ };
+        cache_->emplace(_hash, result);
+        return result;
+    }
+
+    void clear();
+    void inspect(std::ostream& _textOutput) const;
+
+    /// Adds the stats gathered since the last call to the process-wide cache stats.
+    void publishStats();
+
+    /// Estimates the bytes held by the cache, excluding the glyph positions of each entry.
+    [[nodiscard]] size_t memoryUsage() const;
+
+    /// Grows or shrinks the cache according to its hit rate since the last call and the memory pressure,
+    /// keeping the most recently used entries.
+    void adaptCapacity(bool _memoryPressure);
+
+  private:
+    ShapingResultCache();
+
+    mutable std::mutex mutex_;
+    crispy::StrongLRUHashtable<Value>::Ptr cache_;
+    crispy::AdaptiveCapacity capacity_;
+    crispy::CacheStats stats_ { "Text shaping cache" };
+    crispy::MemoryStats memory_ { "Text shaping cache" };
+};
+
+/**
+ * Thread-safe cache of color glyphs that have been scaled down to fit into the grid cells,
+ * keyed by glyph and bounding box.
+ *
+ * Color emoji fonts provide large bitmaps that are expensive to scale down, which is thus done
+ * once rather than each time the glyph is rasterized again, e.g. into a recreated texture atlas.
+ * Text renderers whose font keys identify the same fonts process-wide share one cache (see shared()).
+ */
+class ScaledGlyphCache
+{
+  public:
+    using Ptr = std::shared_ptr<ScaledGlyphCache>;
+
+    /// Creates a cache used by the caller alone.
+    static Ptr create();
+
+    /// @returns the cache shared by all callers, which must only be used if the font keys identify
+    ///          the same fonts in all shapers (see text::shaper::has_shared_font_keys()).
+    static Ptr shared();
+
+    [[nodiscard]] std::optional<text::rasterized_glyph> get(crispy::StrongHash const& _key) const;
+    void put(crispy::StrongHash const& _key, text::rasterized_glyph const& _glyph);
+
+  private:
+    ScaledGlyphCache();
+
+    mutable std::mutex mutex_;
+    crispy::StrongLRUHashtable<text::rasterized_glyph>::Ptr cache_;
+};
+
 struct TextRendererEvents
 {
     virtual ~TextRendererEvents() = default;
@@ -85,6 +200,44 @@ class TextRenderer: public Renderable
 
     void setPressure(bool _pressure) noexcept { pressure_ = _pressure; }
 
+    /// Configures glyphs missing in the texture atlas to be rasterized on @p threadCount
+    /// worker threads, uploading at most @p uploadBudget of them per frame.
+    ///
+    /// With a thread count of 0 glyphs are rasterized synchronously while rendering.
+    void setAsyncRasterization(size_t threadCount, size_t uploadBudget);
+
+    /// Configures the texts of a frame that miss the shaping cache to be shaped in parallel on up to
+    /// @p threadCount threads, with shapers created by @p createShaper, and to be rendered at the end
+    /// of the frame. With a thread count of 0 texts are shaped synchronously while rendering.
+    void setParallelShaping(size_t threadCount, TextShapingPool::ShaperFactory createShaper);
+
+    /// Configures the on-disk cache to also store scaled color glyphs in, or none if nullptr.
+    ///
+    /// The cache must only be used with the shaper lock held, as it is shared with the shaper.
+    void setGlyphDiskCache(text::glyph_disk_cache* _cache) { glyphDiskCache_ = _cache; }
+
+    void setProceduralBoxDrawing(bool _enabled) noexcept { boxDrawingRenderer_.setProcedural(_enabled); }
+
+    /// @returns whether there are glyphs still being rasterized asynchronously, that will be
+    ///          uploaded with one of the next frames.
+    [[nodiscard]] bool hasPendingGlyphs() const;
+
+    /// @returns whether the last frame has rendered blank placeholders for glyphs
+    ///          that have not been rasterized yet.
+    [[nodiscard]] bool placeholdersRendered() const noexcept { return placeholdersRendered_; }
+
+    /// Rasterizes the direct-mapped US-ASCII glyphs of all font styles right away, and the glyphs
+    /// of the next frame synchronously, such that the first frame after e.g. a font size change
+    /// is neither slowed down by US-ASCII glyphs nor rendered with placeholders.
+    ///
+    /// All tiles are uploaded along with the next frame.
+    void prewarm();
+
+    /// Drops all pending asynchronous rasterizations.
+    ///
+    /// Must be invoked before the text shaper or the font descriptions are modified.
+    void discardPendingGlyphs();
+
     /// Must be invoked before a new terminal frame is rendered.
     void beginFrame();
 
@@ -102,35 +255,78 @@ class TextRenderer: public Renderable
     /// Must be invoked when rendering the terminal's text has finished for this frame.
     void endFrame();
 
+    /// Adapts the capacity of the text shaping cache, see ShapingResultCache::adaptCapacity().
+    void adaptCacheCapacity(bool _memoryPressure) { textShapingCache_->adaptCapacity(_memoryPressure); }
+
   private:
     void initializeDirectMapping();
 
+    /// Keeps the current shaping cache alive as one of the most recently used ones.
+    void retainShapingCache();
+
     /// Puts a sequence of codepoints that belong to the same grid cell at @p _pos
     /// at the end of the currently filled line.
     void appendCellTextToClusterGroup(std::u32string_view _codepoints, TextStyle _style, RGBColor _color);
 
     /// Gets the text shaping result of the current text cluster group
-    text::shape_result const& getOrCreateCachedGlyphPositions(crispy::StrongHash hash);
+    ShapingResultCache::Value getOrCreateCachedGlyphPositions(crispy::StrongHash hash);
     text::shape_result createTextShapedGlyphPositions();
-    text::shape_result shapeTextRun(unicode::run_segmenter::range const& _run);
     void flushTextClusterGroup();
 
+    /// Shapes the deferred text cluster groups of this frame (in parallel), and renders them.
+    void renderDeferredClusterGroups();
+
+    /// Renders a trivial line from the line cache, if all of its tiles are still available.
+    ///
+    /// @retval true  the line has been rendered.
+    /// @retval false the line is not cached (anymore) and must be rendered from scratch.
+    bool tryRenderCachedLine(crispy::StrongHash const& hash, crispy::Point origin, RGBColor color);
+
+    /// Adds a rendered glyph tile to the line currently being recorded, if any.
+    void recordLineTile(crispy::Point pen, uint32_t directTileIndex, crispy::StrongHash const& hash);
+
     AtlasTileAttributes const* getOrCreateRasterizedMetadata(crispy::StrongHash const& hash,
                                                              text::glyph_key const& glyphKey,
                                                              unicode::PresentationStyle presentationStyle);
 
     /**
-     * Creates (and rasterizes) a single glyph and returns its
-     * render tile attributes required for the render step.
+     * Rasterizes a single glyph, scaled and cropped to fit into the grid cells.
+     *
+     * Does not access the texture atlas and may therefore be invoked on a worker thread,
+     * with the shaper lock held.
      */
-    std::optional<TextureAtlas::TileCreateData> createSlicedRasterizedGlyph(
-        atlas::TileLocation tileLocation,
-        text::glyph_key const& id,
-        unicode::PresentationStyle presentation,
-        crispy::StrongHash const& hash);
-
-    std::optional<TextureAtlas::TileCreateData> createRasterizedGlyph(
-        atlas::TileLocation tileLocation, text::glyph_key const& id, unicode::PresentationStyle presentation);
+    std::optional<text::rasterized_glyph> rasterizeGlyph(text::glyph_key const& id,
+                                                         unicode::PresentationStyle presentation);
+
+    /// Rasterizes a single glyph, with oversized color glyphs scaled down to the given bounding box.
+    ///
+    /// Scaled glyphs are cached in memory as well as in the glyph disk cache, if any.
+    std::optional<text::rasterized_glyph> rasterizeFittingGlyph(text::glyph_key const& glyphKey,
+                                                                ImageSize boundingBox);
+
+    /// Stores a rasterized glyph into the texture atlas, sliced into multiple tiles if wider than one,
+    /// and returns the render tile attributes of its head-tile.
+    AtlasTileAttributes const* insertRasterizedGlyph(crispy::StrongHash const& hash,
+                                                     text::rasterized_glyph glyph);
+
+    TextureAtlas::TileCreateData createGlyphTileData(atlas::TileLocation tileLocation,
+                                                     text::rasterized_glyph const& glyph,
+                                                     std::vector<uint8_t> bitmap,
+                                                     ImageSize bitmapSize,
+                                                     int x = 0);
+
+    /// Uploads the glyphs rasterized asynchronously since the last frame, up to the upload budget.
+    void uploadRasterizedGlyphs();
+
+    /// Invokes @p f with exclusive access to the text shaper.
+    template <typename F>
+    decltype(auto) withShaper(F&& f)
+    {
+        if (!rasterizerPool_)
+            return f();
+        auto const _ = std::lock_guard { rasterizerPool_->shaperLock() };
+        return f();
+    }
 
     void restrictToTileSize(TextureAtlas::TileCreateData& tileCreateData);
 
@@ -152,26 +348,86 @@ class TextRenderer: public Renderable
     //
     bool pressure_ = false;
 
-    using ShapingResultCache = crispy::StrongLRUHashtable<text::shape_result>;
-    using ShapingResultCachePtr = ShapingResultCache::Ptr;
+    ShapingResultCache::Ptr textShapingCache_;
+
+    // The shared shaping caches of the most recently used fonts (most recent first), which are kept alive
+    // such that switching back to these fonts, e.g. to the DPI of a previous screen, does not reshape.
+    std::vector<ShapingResultCache::Ptr> recentShapingCaches_;
 
-    ShapingResultCachePtr textShapingCache_;
     // TODO: make unique_ptr, get owned, export cref for other users in Renderer impl.
     text::shaper& textShaper_;
 
+    // A glyph tile of a trivial line whose tiles have been cached.
+    struct CachedLineTile
+    {
+        crispy::Point offset {};      // tile position relative to the line's initial pen position
+        uint32_t directTileIndex = 0; // tile index if direct-mapped, 0 otherwise
+        crispy::StrongHash hash {};   // texture atlas key, if not direct-mapped
+    };
+    using CachedLineTiles = std::vector<CachedLineTile>;
+    using LineCache = crispy::StrongLRUHashtable<CachedLineTiles>;
+
+    // Maps trivial lines by text, style, and width to the tiles they have been rendered with,
+    // so that unchanged lines skip grapheme segmentation, text shaping, and glyph hashing.
+    LineCache::Ptr lineCache_;
+    crispy::CacheStats lineCacheStats_ { "Text line cache" };
+    crispy::MemoryStats lineCacheMemory_ { "Text line cache" };
+
+    // The line currently being recorded into the line cache, and its initial pen position.
+    std::optional<CachedLineTiles> lineRecording_;
+    crispy::Point lineRecordingOrigin_ {};
+
+    // Work buffer for resolving the tiles of a cached line.
+    std::vector<AtlasTileAttributes const*> cachedLineAttributes_;
+
+    // Color glyphs scaled down to the grid cell size.
+    ScaledGlyphCache::Ptr scaledGlyphCache_;
+    text::glyph_disk_cache* glyphDiskCache_ = nullptr;
+
+    // Rasterizes missing glyphs asynchronously, if enabled.
+    std::unique_ptr<GlyphRasterizerPool> rasterizerPool_;
+    size_t glyphUploadBudget_ = 256;
+    bool placeholdersRendered_ = false;
+    bool rasterizeNextFrameSynchronously_ = false;
+
+    // Work buffer for the glyphs to be uploaded at the beginning of a frame.
+    std::vector<GlyphRasterizerPool::Result> rasterizedGlyphs_;
+
+    // Shapes the texts of a frame that missed the shaping cache in parallel, if enabled.
+    std::unique_ptr<TextShapingPool> shapingPool_;
+
     DirectMapping _directMapping {};
 
-    // Maps from glyph index to tile index.
-    std::vector<uint32_t> _directMappedGlyphKeyToTileIndex {};
+    // Direct mapping is set up for each of the regular, bold, italic, and bold-italic fonts.
+    static constexpr size_t DirectMappedStyleCount = 4;
+
+    // Maps from glyph index to tile index, for each direct-mapped font style.
+    std::array<std::vector<uint32_t>, DirectMappedStyleCount> _directMappedGlyphKeyToTileIndex {};
+
+    // A direct-mapped US-ASCII glyph, for rendering without text shaping.
+    struct AsciiGlyph
+    {
+        uint32_t tileIndex = 0; // 0 if the glyph is not direct-mapped
+        text::glyph_position position {};
+    };
+
+    // Maps from US-ASCII codepoint to its direct-mapped glyph, for each direct-mapped font style.
+    std::array<std::array<AsciiGlyph, 128>, DirectMappedStyleCount> _asciiGlyphs {};
+
+    /// @returns the direct-mapped tile index of the given glyph or 0 if it is not direct-mapped.
+    [[nodiscard]] uint32_t directMappedTileIndex(text::glyph_key const& glyph) const noexcept;
 
     bool isGlyphDirectMapped(text::glyph_key const& glyph) const noexcept
     {
-        return _directMapping                  // Is direct mapping enabled?
-               && glyph.font == fonts_.regular // Only regular font is direct-mapped for now.
-               && glyph.index.value < _directMappedGlyphKeyToTileIndex.size()
-               && _directMappedGlyphKeyToTileIndex[glyph.index.value] != 0;
+        return directMappedTileIndex(glyph) != 0;
     }
 
+    /// Renders the current text cluster group without text shaping, if it consists of
+    /// US-ASCII letters and digits only.
+    bool tryRenderAsciiClusterGroup();
+
+    AtlasTileAttributes const* ensureRasterizedDirectMapping(uint32_t tileIndex,
+                                                             text::glyph_key const& glyphKey);
     AtlasTileAttributes const* ensureRasterizedIfDirectMapped(text::glyph_key const& glyphKey);
 
     // sub-renderer
@@ -187,8 +443,8 @@ class TextRenderer: public Renderable
         // uniform text style for this text group
         TextStyle style = TextStyle::Invalid;
 
-        // uniform text color for this text group
-        RGBColor color {};
+        // text color of each grid cell processed, as the color may change within a text group
+        std::vector<RGBColor> cellColors;
 
         // codepoints within this text group with
         // uniform unicode properties (script, language, direction).
@@ -200,16 +456,46 @@ class TextRenderer: public Renderable
         // number of grid cells processed
         int cellCount = 0; // FIXME: EA width vs actual cells
 
+        [[nodiscard]] RGBColor colorAt(crispy::Point pen, int cellWidth) const noexcept
+        {
+            auto const cell = std::clamp((pen.x - initialPenPosition.x) / cellWidth,
+                                         0,
+                                         static_cast<int>(cellColors.size()) - 1);
+            return cellColors[static_cast<size_t>(cell)];
+        }
+
         void resetAndMovePenForward(int penIncrementInX)
         {
             codepoints.clear();
             clusters.clear();
+            cellColors.clear();
             cellCount = 0;
             initialPenPosition.x += penIncrementInX;
         }
     };
     TextClusterGroup textClusterGroup_ {};
 
+    // Text cluster groups of the current frame that missed the shaping cache, to be shaped
+    // all at once by the shaping pool at the end of the frame.
+    struct DeferredClusterGroup
+    {
+        crispy::StrongHash hash;
+        TextClusterGroup group;
+    };
+    std::vector<DeferredClusterGroup> deferredClusterGroups_;
+
+    /// Shapes the given text cluster group, run by run, using the given shaper.
+    static text::shape_result shapeClusterGroup(text::shaper& _shaper,
+                                                FontKeys const& _fonts,
+                                                TextClusterGroup const& _group);
+    static text::shape_result shapeTextRun(text::shaper& _shaper,
+                                           FontKeys const& _fonts,
+                                           TextClusterGroup const& _group,
+                                           unicode::run_segmenter::range const& _run);
+
+    /// Renders the tiles of the given text cluster group, shaped into @p _glyphPositions.
+    void renderClusterGroup(TextClusterGroup const& _group, text::shape_result const& _glyphPositions);
+
     bool textStartFound_ = false;
     bool updateInitialPenPosition_ = false;
 };
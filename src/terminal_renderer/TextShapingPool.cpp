@@ -0,0 +1,65 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal_renderer/TextShapingPool.h>
+#include <terminal_renderer/utils.h>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+namespace terminal::renderer
+{
+
+TextShapingPool::TextShapingPool(size_t _threadCount, ShaperFactory _createShaper):
+    threadCount_ { std::max(_threadCount, size_t { 1 }) }, createShaper_ { std::move(_createShaper) }
+{
+}
+
+bool TextShapingPool::run(size_t _count, ShapeFn const& _shape)
+{
+    if (shapers_.empty())
+    {
+        for (size_t i = 0; i < threadCount_; ++i)
+        {
+            auto shaper = createShaper_();
+            if (!shaper)
+            {
+                RendererLog()("Failed to create text shaper for parallel shaping.");
+                shapers_.clear();
+                return false;
+            }
+            shapers_.emplace_back(std::move(shaper));
+        }
+    }
+
+    // Texts differ in length, which is balanced by each thread taking the next text once done.
+    auto next = std::atomic<size_t> { 0 };
+    auto const shapeAll = [&](text::shaper& _shaper) {
+        for (auto i = next++; i < _count; i = next++)
+            _shape(_shaper, i);
+    };
+
+    auto const threadCount = std::min(threadCount_, _count);
+    auto threads = std::vector<std::thread> {};
+    threads.reserve(threadCount);
+    for (size_t i = 1; i < threadCount; ++i)
+        threads.emplace_back(shapeAll, std::ref(*shapers_[i]));
+    shapeAll(*shapers_[0]);
+    for (auto& thread: threads)
+        thread.join();
+
+    return true;
+}
+
+} // namespace terminal::renderer
@@ -0,0 +1,59 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <text_shaper/shaper.h>
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace terminal::renderer
+{
+
+/**
+ * Shapes a batch of texts in parallel, such as all texts of a frame that missed the shaping cache.
+ *
+ * Text shapers are not thread-safe. Each thread therefore uses a shaper of its own, which loads
+ * the same fonts as the renderer's shaper. The font files are shared between them, and so are
+ * the font keys (see text::shaper::has_shared_font_keys()), such that the shaping results are
+ * valid for the renderer's shaper, too.
+ */
+class TextShapingPool
+{
+  public:
+    /// Creates a shaper with the renderer's fonts loaded, or returns nullptr if it cannot.
+    using ShaperFactory = std::function<std::unique_ptr<text::shaper>()>;
+    using ShapeFn = std::function<void(text::shaper& _shaper, size_t _index)>;
+
+    TextShapingPool(size_t _threadCount, ShaperFactory _createShaper);
+
+    [[nodiscard]] size_t threadCount() const noexcept { return threadCount_; }
+
+    /// Invokes @p _shape for each index in [0, @p _count), spread across up to threadCount() threads
+    /// (including the calling one), and returns once all of them have been shaped.
+    ///
+    /// @retval false the shapers could not be created, and nothing has been shaped.
+    bool run(size_t _count, ShapeFn const& _shape);
+
+    /// Drops the shapers, which are created again upon the next run(), e.g. after the fonts changed.
+    void reset() noexcept { shapers_.clear(); }
+
+  private:
+    size_t threadCount_;
+    ShaperFactory createShaper_;
+    std::vector<std::unique_ptr<text::shaper>> shapers_;
+};
+
+} // namespace terminal::renderer
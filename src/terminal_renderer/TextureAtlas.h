@@ -23,6 +23,8 @@
 
 #include <fmt/format.h>
 
+#include <algorithm>
+#include <array>
 #include <variant> // monostate
 #include <vector>
 
@@ -43,6 +45,22 @@ constexpr uint32_t element_count(Format format) noexcept
     return static_cast<uint32_t>(format);
 }
 
+// Each format is stored in a texture atlas of its own, such that grayscale glyphs,
+// which make up most of the tiles, only occupy one byte per pixel.
+constexpr std::array<Format, 3> AtlasFormats { Format::Red, Format::RGB, Format::RGBA };
+
+// Index into AtlasFormats of the given format.
+constexpr size_t format_index(Format format) noexcept
+{
+    switch (format)
+    {
+        case Format::Red: return 0;
+        case Format::RGB: return 1;
+        case Format::RGBA: return 2;
+    }
+    return 0;
+}
+
 // -----------------------------------------------------------------------
 // informational data structures
 
@@ -71,6 +89,7 @@ struct TileLocation
     // clang-format off
     struct X { uint16_t value; };
     struct Y { uint16_t value; };
+    struct Page { uint16_t value; };
     // struct RelativeX { float value; };
     // struct RelativeY { float value; };
     // struct RelativeWidth { float value; };
@@ -83,7 +102,16 @@ struct TileLocation
     // Y-offset of the tile into the texture atlas.
     Y y {};
 
-    constexpr TileLocation(X ax, Y ay) noexcept: x { ax }, y { ay } {}
+    // Index of the atlas page (texture layer) holding the tile.
+    Page page {};
+
+    // Format of the texture atlas holding the tile.
+    Format format = Format::Red;
+
+    constexpr TileLocation(X ax, Y ay, Page apage = {}, Format aformat = Format::Red) noexcept:
+        x { ax }, y { ay }, page { apage }, format { aformat }
+    {
+    }
 
     constexpr TileLocation() noexcept = default;
     constexpr TileLocation(TileLocation const&) noexcept = default;
@@ -105,11 +133,12 @@ struct NormalizedTileLocation
 // The tiles are identified using a 32-bit Integer (AtlasTileID) that can
 // be decomposed into X and Y coordinate pointing into the atlas texture's
 // coordinate system.
+//
+// The atlas consists of one or more equally sized pages, i.e. the layers of
+// an array texture, each page holding the same grid of tiles.
+// There is one such atlas per Format, all sharing the same properties.
 struct AtlasProperties
 {
-    // Texture pixel format, such as monochrome, RGB, or RGBA.
-    Format format {};
-
     // Size in pixels of a tile.
     ImageSize tileSize {};
 
@@ -118,7 +147,7 @@ struct AtlasProperties
     // This value is rounted up to a value equal to the power of two.
     crispy::StrongHashtableSize hashCount {};
 
-    // Number of tiles the texture atlas must be able to store at least.
+    // Number of tiles a single texture atlas page must be able to store at least.
     crispy::LRUCapacity tileCount {};
 
     // Number of direct-mapped tile slots.
@@ -126,18 +155,30 @@ struct AtlasProperties
     // This can be for example [A-Za-z0-9], characters that are most often
     // used and least likely part of a ligature.
     uint32_t directMappingCount {};
+
+    // Maximum number of pages the texture atlas of each format may grow to.
+    //
+    // Pages are added on demand. Once all of them are full, the least recently
+    // used page is evicted as a whole, bounding the atlas' memory usage.
+    uint32_t maxPageCount = 1;
 };
 
 // -----------------------------------------------------------------------
 // command data structures
 
-// Command structure to (re-)construct a texture atlas.
+// Command structure to (re-)construct the texture atlas of one format.
 struct ConfigureAtlas
 {
-    // Texture atlas size in pixels.
+    // Texture atlas size in pixels, per page.
     crispy::ImageSize size {};
 
     AtlasProperties properties {};
+
+    // Texture pixel format, such as monochrome, RGB, or RGBA.
+    Format format = Format::Red;
+
+    // Number of pages the atlas currently consists of, zero if it is not in use.
+    uint32_t pageCount = 1;
 };
 
 // Command structure for uploading a tile into the texture atlas.
@@ -168,6 +209,20 @@ struct RenderTile
     NormalizedTileLocation normalizedLocation {};
 
     uint32_t fragmentShaderSelector {};
+
+    // If non-zero, the tile is rendered from the image texture of this ID (see UploadImage)
+    // instead of from the texture atlas, with normalizedLocation relative to that image.
+    uint32_t imageTextureId = 0;
+};
+
+// Command structure for uploading an image into a texture of its own, rather than into the atlas.
+//
+// Large images would otherwise occupy one atlas tile per grid cell they span.
+struct UploadImage
+{
+    uint32_t imageTextureId; // non-zero ID chosen by the caller to refer to the texture
+    Buffer bitmap;           // RGBA data
+    ImageSize bitmapSize;
 };
 
 constexpr std::array<float, 4> normalize(terminal::RGBColor color, float alpha) noexcept
@@ -201,15 +256,27 @@ class AtlasBackend
 
     [[nodiscard]] virtual ImageSize atlasSize() const noexcept = 0;
 
-    /// Creates a new texture atlas, effectively destroying any prior existing one
-    /// as there  can be only one atlas.
+    /// Creates a new texture atlas for the given format, effectively destroying any prior
+    /// existing one of that format as there can be only one atlas per format.
+    ///
+    /// If the atlas' size and properties did not change but its page count grew,
+    /// the new pages are appended, preserving the contents of the existing ones.
+    /// A page count of zero releases the atlas.
     virtual void configureAtlas(ConfigureAtlas atlas) = 0;
 
-    /// Uploads given texture to the atlas.
+    /// Uploads given texture to the atlas of the tile location's format.
     virtual void uploadTile(UploadTile tile) = 0;
 
     /// Renders given texture from the atlas with the given target position parameters.
     virtual void renderTile(RenderTile tile) = 0;
+
+    /// Uploads the given image into a texture of its own, replacing any with the same ID.
+    ///
+    /// The texture may be rendered from via RenderTile::imageTextureId.
+    virtual void uploadImage(UploadImage image) = 0;
+
+    /// Releases the texture of the given image texture ID.
+    virtual void destroyImage(uint32_t imageTextureId) = 0;
 };
 
 // Defines location of the tile in the atlas and its associated metadata
@@ -222,12 +289,15 @@ struct TileAttributes
 };
 
 /**
- * Manages the tiles of a single texture atlas.
+ * Manages the tiles of the texture atlases, one per tile format.
  *
- * Atlas items are LRU-cached and the possibly passed metadata is
- * going to be destroyed at the time of cache eviction.
+ * Tiles are allocated page by page, in the atlas matching their bitmap format.
+ * Pages of an atlas are only allocated once a tile of its format is stored.
+ * When an atlas is full, it grows by another page until AtlasProperties::maxPageCount
+ * is reached, and from then on its least recently used page is evicted as a whole.
+ * The possibly passed metadata is going to be destroyed at the time of eviction.
  *
- * The total number of of cachable tiles should be at least as large
+ * The number of tiles per page should be at least as large
  * as the terminal's cell count per page.
  * More tiles will most likely improve render performance.
  *
@@ -241,7 +311,7 @@ class TextureAtlas
   public:
     /// Initializes this texture atlas given the passed AtlasProperties.
     ///
-    /// This will create at least one atlas in the backend.
+    /// This releases any atlas in the backend, pages being allocated on demand.
     TextureAtlas(AtlasBackend& backend, AtlasProperties atlasProperties);
 
     void reset(AtlasProperties atlasProperties);
@@ -257,7 +327,7 @@ class TextureAtlas
     // Return type for in-place tile-construction callback.
     struct TileCreateData
     {
-        Buffer bitmap; // RGBA bitmap data
+        Buffer bitmap; // bitmap data of the given format
         Format bitmapFormat;
         ImageSize bitmapSize;
         Metadata metadata;
@@ -265,23 +335,28 @@ class TextureAtlas
 
     /// Always returns either the existing item by the given key, if found,
     /// or a newly created one by invoking constructValue().
+    ///
+    /// The tile is allocated in the atlas of the given format, which the bitmap
+    /// returned by constructValue() must be of.
     template <typename CreateTileDataFn>
     [[nodiscard]] TileAttributes<Metadata>& get_or_emplace(crispy::StrongHash const& key,
+                                                           Format format,
                                                            CreateTileDataFn constructValue);
 
     [[nodiscard]] TileAttributes<Metadata> const* try_get(crispy::StrongHash const& key);
 
     template <typename CreateTileDataFn>
     [[nodiscard]] TileAttributes<Metadata> const* get_or_try_emplace(crispy::StrongHash const& key,
+                                                                     Format format,
                                                                      CreateTileDataFn constructValue);
 
     /// Explicitly create or overwrites a tile for the given hash key.
     template <typename CreateTileDataFn>
-    void emplace(crispy::StrongHash const& key, CreateTileDataFn constructValue);
+    void emplace(crispy::StrongHash const& key, Format format, CreateTileDataFn constructValue);
 
     void remove(crispy::StrongHash key);
 
-    // Uploads tile data to a direct-mapped slot in the texture atlas
+    // Uploads tile data to a direct-mapped slot in the texture atlas of its bitmap format,
     // bypassing the LRU cache.
     //
     // The index must be between 0 and number of direct-mapped tiles minus 1.
@@ -296,8 +371,41 @@ class TextureAtlas
 
     [[nodiscard]] TileLocation tileLocation(uint32_t tileIndex) const { return _tileLocations[tileIndex]; }
 
-    // Retrieves the number of total tiles that can be stored.
-    [[nodiscard]] size_t capacity() const noexcept { return _tileLocations.size(); }
+    // Retrieves the number of total tiles that can be stored in the atlas of the given format.
+    [[nodiscard]] size_t capacity(Format /*format*/) const noexcept
+    {
+        return _tileLocations.size() * _atlasProperties.maxPageCount;
+    }
+
+    // Retrieves the number of total tiles that can be stored, across all pages of all formats.
+    [[nodiscard]] size_t capacity() const noexcept { return capacity(Format::Red) * AtlasFormats.size(); }
+
+    // Retrieves the number of tiles currently cached, excluding the direct-mapped ones.
+    [[nodiscard]] size_t tileCount() const noexcept { return _tileCache->size(); }
+
+    // Returns gathered stats of the tile cache and clears them to start counting from zero again.
+    crispy::LRUHashtableStats fetchAndClearStats() noexcept { return _tileCache->fetchAndClearStats(); }
+
+    // Retrieves the number of pages currently in use by the atlas of the given format.
+    [[nodiscard]] size_t pageCount(Format format) const noexcept { return pool(format).pages.size(); }
+
+    // Retrieves the number of bytes the pages of all formats currently occupy in the backend.
+    [[nodiscard]] size_t textureBytes() const noexcept
+    {
+        auto const pageSize = unbox<size_t>(_atlasSize.width) * unbox<size_t>(_atlasSize.height);
+        auto bytes = size_t { 0 };
+        for (auto const format: AtlasFormats)
+            bytes += pageCount(format) * pageSize * element_count(format);
+        return bytes;
+    }
+
+    // Retrieves the number of pages that may currently be in use per format,
+    // at most AtlasProperties::maxPageCount.
+    [[nodiscard]] uint32_t pageLimit() const noexcept { return _pageLimit; }
+
+    // Limits the number of pages that may be in use per format, releasing the pages beyond
+    // that limit along with their tiles.
+    void setPageLimit(uint32_t pageLimit);
 
     void inspect(std::ostream& output) const;
 
@@ -308,8 +416,52 @@ class TextureAtlas
     using TileCache = crispy::StrongLRUHashtable<TileAttributes<Metadata>>;
     using TileCachePtr = typename TileCache::Ptr;
 
+    struct Page
+    {
+        // Number of allocated tiles, including the ones reserved for direct-mapping.
+        uint32_t usedTileCount = 0;
+
+        // Value of the atlas' use counter at the time this page was last accessed.
+        uint64_t lastUse = 0;
+
+        // Keys of the cached tiles that have been allocated in this page.
+        std::vector<crispy::StrongHash> tiles {};
+    };
+
+    // The pages of the texture atlas of a single format.
+    struct PagePool
+    {
+        std::vector<Page> pages {};
+        uint32_t currentPage = 0; // page new tiles are being allocated from
+    };
+
+    [[nodiscard]] PagePool& pool(Format format) noexcept { return _pools[format_index(format)]; }
+    [[nodiscard]] PagePool const& pool(Format format) const noexcept
+    {
+        return _pools[format_index(format)];
+    }
+
     template <typename CreateTileDataFn>
-    std::optional<TileAttributes<Metadata>> constructTile(CreateTileDataFn fn, uint32_t entryIndex);
+    std::optional<TileAttributes<Metadata>> constructTile(CreateTileDataFn fn, TileLocation tileLocation);
+
+    TileAttributes<Metadata>* touch(TileAttributes<Metadata>* tile) noexcept;
+    TileAttributes<Metadata>& store(crispy::StrongHash const& key, TileAttributes<Metadata> tile);
+
+    // Allocates a free tile, adding or evicting a page if the current one is full.
+    TileLocation allocateTile(Format format);
+
+    // Gives back the tile that was last allocated, if it could not be constructed.
+    void releaseLastTile(Format format);
+
+    void addPage(Format format);
+    void evictPage(Format format, uint32_t pageIndex);
+    void configureBackend(Format format);
+
+    // Number of tiles in page 0 that are not available to the LRU cached tiles.
+    [[nodiscard]] uint32_t reservedTileCount() const noexcept
+    {
+        return std::max(1u, _atlasProperties.directMappingCount);
+    }
 
     AtlasBackend& _backend;
     AtlasProperties _atlasProperties;
@@ -318,12 +470,17 @@ class TextureAtlas
     uint32_t _tilesInY;
 
     // The number of entries of this cache must at most match the number
-    // of tiles that can be stored into the atlas.
+    // of tiles that can be stored into all pages of all atlases,
+    // such that tiles are only ever evicted page-wise.
     TileCachePtr _tileCache;
 
-    // A vector of precomputed mappings from entry index to TileLocation.
+    // A vector of precomputed mappings from tile index within a page to TileLocation.
     std::vector<TileLocation> _tileLocations;
 
+    std::array<PagePool, AtlasFormats.size()> _pools;
+    uint32_t _pageLimit; // number of pages that may be allocated per format, at most maxPageCount
+    uint64_t _useCounter = 0;
+
     // A vector holding the tile meta data for the direct mapped textures.
     std::vector<TileAttributes<Metadata>> _directTileMapping;
 
@@ -489,14 +646,18 @@ TextureAtlas<Metadata>::TextureAtlas(AtlasBackend& backend, AtlasProperties atla
     }() },
     _tileCache { TileCache::create(
         atlasProperties.hashCount,
-        crispy::LRUCapacity { // The LRU entry capacity is the number of total tiles availabe,
-                              // minus the number of reserved tiles for direct-mapping, and
-                              // minus one for the LRU-sentinel entry (which is why entryIndex
-                              // is between 1 and capacity inclusive)
-                              _tilesInX * _tilesInY - _atlasProperties.directMappingCount - 1 },
+        crispy::LRUCapacity { // The LRU entry capacity is the number of total tiles availabe
+                              // in all pages of all formats, minus the number of reserved
+                              // tiles in each page 0.
+                              static_cast<uint32_t>(
+                                  (_tilesInX * _tilesInY * _atlasProperties.maxPageCount
+                                   - reservedTileCount())
+                                  * AtlasFormats.size()) },
         "LRU cache for texture atlas") },
-    _tileLocations { static_cast<size_t>(_tilesInX * _tilesInY) }
+    _tileLocations { static_cast<size_t>(_tilesInX * _tilesInY) },
+    _pageLimit { _atlasProperties.maxPageCount }
 {
+    Require(1 <= _atlasProperties.maxPageCount && _atlasProperties.maxPageCount <= 0x10000);
     Require(_atlasProperties.tileCount.value <= _tileCache->capacity());
     Require(_atlasProperties.directMappingCount + _atlasProperties.tileCount.value <= _tilesInX * _tilesInY);
 
@@ -510,10 +671,8 @@ TextureAtlas<Metadata>::TextureAtlas(AtlasBackend& backend, AtlasProperties atla
 
     Require(_tileLocations.size() >= _atlasProperties.directMappingCount + _atlasProperties.tileCount.value);
 
-    auto data = ConfigureAtlas {};
-    data.size = _atlasSize;
-    data.properties = _atlasProperties;
-    _backend.configureAtlas(data);
+    for (auto const format: AtlasFormats)
+        configureBackend(format);
 
     // The StrongLRUHashtable's passed entryIndex can be used
     // to construct the texture atlas' tile coordinates.
@@ -539,20 +698,18 @@ constexpr bool TextureAtlas<Metadata>::contains(crispy::StrongHash const& _id) c
 
 template <typename Metadata>
 template <typename CreateTileDataFn>
-auto TextureAtlas<Metadata>::constructTile(CreateTileDataFn createTileData, uint32_t entryIndex)
+auto TextureAtlas<Metadata>::constructTile(CreateTileDataFn createTileData, TileLocation tileLocation)
     -> std::optional<TileAttributes<Metadata>>
 {
-    Require(1 <= entryIndex && entryIndex <= _tileCache->capacity());
-    auto const tileIndex = _atlasProperties.directMappingCount + entryIndex;
-    Require(tileIndex < _tileLocations.size());
-    auto const tileLocation = _tileLocations[tileIndex];
-    Require(tileLocation.x.value != 0 || tileLocation.y.value != 0);
+    Require(tileLocation.page.value < pool(tileLocation.format).pages.size());
+    Require(tileLocation.page.value != 0 || tileLocation.x.value != 0 || tileLocation.y.value != 0);
 
     std::optional<TileCreateData> tileCreateDataOpt = createTileData(tileLocation);
     if (!tileCreateDataOpt)
         return std::nullopt;
 
     TileCreateData& tileCreateData = *tileCreateDataOpt;
+    Require(tileCreateData.bitmapFormat == tileLocation.format);
 
     auto tileUpload = UploadTile {};
     tileUpload.location = tileLocation;
@@ -569,54 +726,151 @@ auto TextureAtlas<Metadata>::constructTile(CreateTileDataFn createTileData, uint
     return instance;
 }
 
+template <typename Metadata>
+TileAttributes<Metadata>* TextureAtlas<Metadata>::touch(TileAttributes<Metadata>* tile) noexcept
+{
+    if (tile)
+        pool(tile->location.format).pages[tile->location.page.value].lastUse = ++_useCounter;
+    return tile;
+}
+
+template <typename Metadata>
+TileAttributes<Metadata>& TextureAtlas<Metadata>::store(crispy::StrongHash const& key,
+                                                        TileAttributes<Metadata> tile)
+{
+    pool(tile.location.format).pages[tile.location.page.value].tiles.emplace_back(key);
+    return _tileCache->emplace(key, std::move(tile));
+}
+
+template <typename Metadata>
+TileLocation TextureAtlas<Metadata>::allocateTile(Format format)
+{
+    PagePool& pagePool = pool(format);
+    if (pagePool.pages.empty())
+        addPage(format);
+    else if (pagePool.pages[pagePool.currentPage].usedTileCount == _tileLocations.size())
+    {
+        if (pagePool.pages.size() < _pageLimit)
+            addPage(format);
+        else
+        {
+            auto const lru =
+                std::min_element(pagePool.pages.begin(), pagePool.pages.end(), [](auto const& a, auto const& b) {
+                    return a.lastUse < b.lastUse;
+                });
+            pagePool.currentPage = static_cast<uint32_t>(std::distance(pagePool.pages.begin(), lru));
+            evictPage(format, pagePool.currentPage);
+        }
+    }
+
+    Page& page = pagePool.pages[pagePool.currentPage];
+    page.lastUse = ++_useCounter;
+    auto const location = _tileLocations[page.usedTileCount++];
+    auto const pageIndex = TileLocation::Page { static_cast<uint16_t>(pagePool.currentPage) };
+    return TileLocation { location.x, location.y, pageIndex, format };
+}
+
+template <typename Metadata>
+void TextureAtlas<Metadata>::releaseLastTile(Format format)
+{
+    PagePool& pagePool = pool(format);
+    Page& page = pagePool.pages[pagePool.currentPage];
+    Require(page.usedTileCount > (pagePool.currentPage == 0 ? reservedTileCount() : 0));
+    --page.usedTileCount;
+}
+
+template <typename Metadata>
+void TextureAtlas<Metadata>::addPage(Format format)
+{
+    PagePool& pagePool = pool(format);
+    pagePool.currentPage = static_cast<uint32_t>(pagePool.pages.size());
+    pagePool.pages.emplace_back().usedTileCount = pagePool.currentPage == 0 ? reservedTileCount() : 0;
+    configureBackend(format);
+}
+
+template <typename Metadata>
+void TextureAtlas<Metadata>::evictPage(Format format, uint32_t pageIndex)
+{
+    Page& page = pool(format).pages[pageIndex];
+
+    // A key may have been removed and then been re-added into another page meanwhile.
+    for (crispy::StrongHash const& key: page.tiles)
+        if (auto const* tile = _tileCache->try_get(key);
+            tile && tile->location.format == format && tile->location.page.value == pageIndex)
+            _tileCache->remove(key);
+
+    page.tiles.clear();
+    page.usedTileCount = pageIndex == 0 ? reservedTileCount() : 0;
+}
+
+template <typename Metadata>
+void TextureAtlas<Metadata>::configureBackend(Format format)
+{
+    auto data = ConfigureAtlas {};
+    data.size = _atlasSize;
+    data.properties = _atlasProperties;
+    data.format = format;
+    data.pageCount = static_cast<uint32_t>(pool(format).pages.size());
+    _backend.configureAtlas(data);
+}
+
 template <typename Metadata>
 template <typename CreateTileDataFn>
 TileAttributes<Metadata>& TextureAtlas<Metadata>::get_or_emplace(crispy::StrongHash const& key,
+                                                                 Format format,
                                                                  CreateTileDataFn createTileData)
 {
-    return _tileCache->get_or_emplace(key,
-                                      [&](uint32_t entryIndex) -> std::optional<TileAttributes<Metadata>> {
-                                          return constructTile(std::move(createTileData), entryIndex);
-                                      });
+    if (auto* tile = touch(_tileCache->try_get(key)))
+        return *tile;
+
+    // The tile must be allocated before inserting into the cache, as this may evict a page.
+    auto const tileLocation = allocateTile(format);
+    return store(key, constructTile(std::move(createTileData), tileLocation).value());
 }
 
 template <typename Metadata>
 TileAttributes<Metadata> const* TextureAtlas<Metadata>::try_get(crispy::StrongHash const& key)
 {
-    return _tileCache->try_get(key);
+    return touch(_tileCache->try_get(key));
 }
 
 template <typename Metadata>
 template <typename CreateTileDataFn>
 [[nodiscard]] TileAttributes<Metadata> const* TextureAtlas<Metadata>::get_or_try_emplace(
-    crispy::StrongHash const& key, CreateTileDataFn createTileData)
+    crispy::StrongHash const& key, Format format, CreateTileDataFn createTileData)
 {
-    return _tileCache->get_or_try_emplace(
-        key, [&](uint32_t entryIndex) -> std::optional<TileAttributes<Metadata>> {
-            return constructTile(std::move(createTileData), entryIndex);
-        });
+    if (auto* tile = touch(_tileCache->try_get(key)))
+        return tile;
+
+    auto const tileLocation = allocateTile(format);
+    auto tile = constructTile(std::move(createTileData), tileLocation);
+    if (!tile)
+    {
+        releaseLastTile(format);
+        return nullptr;
+    }
+    return &store(key, std::move(*tile));
 }
 
 template <typename Metadata>
 template <typename CreateTileDataFn>
-void TextureAtlas<Metadata>::emplace(crispy::StrongHash const& key, CreateTileDataFn createTileData)
+void TextureAtlas<Metadata>::emplace(crispy::StrongHash const& key,
+                                     Format format,
+                                     CreateTileDataFn createTileData)
 {
-    // clang-format off
-    _tileCache->emplace(
-        key,
-        [&](uint32_t entryIndex) -> TileAttributes<Metadata>
-        {
-            return constructTile(
-                [&](TileLocation location)
-                -> std::optional<TileCreateData>
-                {
-                    return { createTileData(location) };
-                },
-                entryIndex
-            ).value();
-        }
-    );
-    // clang-format on
+    auto const create = [&](TileLocation location) -> std::optional<TileCreateData> {
+        return { createTileData(location) };
+    };
+
+    // Overwriting an existing tile of the same format reuses its location.
+    if (auto* tile = touch(_tileCache->try_get(key)); tile && tile->location.format == format)
+    {
+        *tile = constructTile(create, tile->location).value();
+        return;
+    }
+
+    auto const tileLocation = allocateTile(format);
+    store(key, constructTile(create, tileLocation).value());
 }
 
 template <typename Metadata>
@@ -630,6 +884,31 @@ void TextureAtlas<Metadata>::reset(AtlasProperties atlasProperties)
 {
     _atlasProperties = atlasProperties;
     _tileCache->clear();
+    _pools = {};
+    _pageLimit = _atlasProperties.maxPageCount;
+    for (auto const format: AtlasFormats)
+        configureBackend(format);
+}
+
+template <typename Metadata>
+void TextureAtlas<Metadata>::setPageLimit(uint32_t pageLimit)
+{
+    _pageLimit = std::clamp(pageLimit, 1u, _atlasProperties.maxPageCount);
+
+    for (auto const format: AtlasFormats)
+    {
+        PagePool& pagePool = pool(format);
+        if (pagePool.pages.size() <= _pageLimit)
+            continue;
+
+        while (pagePool.pages.size() > _pageLimit)
+        {
+            evictPage(format, static_cast<uint32_t>(pagePool.pages.size() - 1));
+            pagePool.pages.pop_back();
+        }
+        pagePool.currentPage = std::min(pagePool.currentPage, _pageLimit - 1);
+        configureBackend(format);
+    }
 }
 
 template <typename Metadata>
@@ -644,7 +923,13 @@ void TextureAtlas<Metadata>::setDirectMapping(uint32_t tileIndex, TileCreateData
 {
     Require(tileIndex < _directMapping.size());
 
-    auto const tileLocation = _tileLocations[tileIndex];
+    // Direct-mapped tiles are reserved in page 0 of every format's atlas.
+    auto const format = tileCreateData.bitmapFormat;
+    if (pool(format).pages.empty())
+        addPage(format);
+
+    auto tileLocation = _tileLocations[tileIndex];
+    tileLocation.format = format;
 
     auto tileUpload = UploadTile {};
     tileUpload.location = tileLocation;
@@ -669,6 +954,18 @@ void TextureAtlas<Metadata>::inspect(std::ostream& output) const
     output << fmt::format("atlas size     : {}\n", _atlasSize);
     output << fmt::format("tile size      : {}\n", _atlasProperties.tileSize);
     output << fmt::format("direct mapped  : {}\n", _atlasProperties.directMappingCount);
+    output << fmt::format("page limit     : {} (at most {})\n", _pageLimit, _atlasProperties.maxPageCount);
+    for (auto const format: AtlasFormats)
+    {
+        auto const& pages = pool(format).pages;
+        output << fmt::format("{} pages: {}\n", format, pages.size());
+        for (size_t i = 0; i < pages.size(); ++i)
+            output << fmt::format("{} page {}: {} tiles used, last use {}\n",
+                                  format,
+                                  i,
+                                  pages[i].usedTileCount,
+                                  pages[i].lastUse);
+    }
     output << '\n';
     _tileCache->inspect(output);
 }
@@ -712,7 +1009,12 @@ struct formatter<terminal::renderer::atlas::TileLocation>
     template <typename FormatContext>
     auto format(terminal::renderer::atlas::TileLocation value, FormatContext& ctx)
     {
-        return fmt::format_to(ctx.out(), "Tile {}x+{}y", value.x.value, value.y.value);
+        return fmt::format_to(ctx.out(),
+                              "Tile {}x+{}y (page {}, {})",
+                              value.x.value,
+                              value.y.value,
+                              value.page.value,
+                              value.format);
     }
 };
 
@@ -744,10 +1046,10 @@ struct formatter<terminal::renderer::atlas::AtlasProperties>
     auto format(terminal::renderer::atlas::AtlasProperties const& value, FormatContext& ctx)
     {
         return fmt::format_to(ctx.out(),
-                              "tile size {}, format {}, direct-mapped {}",
+                              "tile size {}, direct-mapped {}, max pages {}",
                               value.tileSize,
-                              value.format,
-                              value.directMappingCount);
+                              value.directMappingCount,
+                              value.maxPageCount);
     }
 };
 } // namespace fmt
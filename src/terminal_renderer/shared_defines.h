@@ -13,3 +13,40 @@
 
 // Render an LCD-subpixel antialiased glyph (advanced algorithm)
 #define FRAGMENT_SELECTOR_GLYPH_LCD 3
+
+// Render a glyph from its signed distance field in the red channel
+#define FRAGMENT_SELECTOR_GLYPH_SDF 4
+
+// Box drawing characters rendered analytically, evaluating their shape in the fragment shader.
+// The lowest 4 bits of a shape select its kind, the remaining bits are laid out as follows.
+//
+// BOX_SHAPE_LINES:     bits 4..11 line style of the left, up, right and down arms, 2 bits each
+//                      (see BOX_LINE_*), bits 12..14 number of dashes (0 for solid lines),
+//                      bits 15..16 diagonals (1 forward, 2 backward, 3 both),
+//                      bits 17..19 rounded corner (1 top left, 2 top right, 3 bottom right, 4 bottom left)
+// BOX_SHAPE_BLOCK:     bits 4..19 left, top, right and bottom of the filled rectangle, in eighths of the cell
+// BOX_SHAPE_QUADRANTS: bits 4..7 filled quadrants (1 upper left, 2 upper right, 4 lower left, 8 lower right)
+// BOX_SHAPE_TRIANGLE:  bits 4..6 filled triangle (see BOX_TRIANGLE_*)
+#define BOX_SHAPE_LINES 1
+#define BOX_SHAPE_BLOCK 2
+#define BOX_SHAPE_QUADRANTS 3
+#define BOX_SHAPE_TRIANGLE 4
+
+#define BOX_LINE_NONE 0
+#define BOX_LINE_LIGHT 1
+#define BOX_LINE_HEAVY 2
+#define BOX_LINE_DOUBLE 3
+
+#define BOX_TRIANGLE_RIGHT_POINTING 0
+#define BOX_TRIANGLE_LEFT_POINTING 1
+#define BOX_TRIANGLE_LOWER_RIGHT 2
+#define BOX_TRIANGLE_UPPER_LEFT 3
+#define BOX_TRIANGLE_UPPER_RIGHT 4
+
+// Textures the text shader samples tiles from, each bound to the texture unit of the same number,
+// such that the tiles of all texture atlases are rendered with a single draw call.
+// The atlases are in the order of atlas::AtlasFormats, followed by the image being rendered.
+#define TEXT_TEXTURE_ATLAS_RED 0
+#define TEXT_TEXTURE_ATLAS_RGB 1
+#define TEXT_TEXTURE_ATLAS_RGBA 2
+#define TEXT_TEXTURE_IMAGE 3
@@ -25,6 +25,8 @@ namespace terminal::renderer
 auto const inline RendererLog =
     logstore::Category("vt.renderer", "Logs general information about VT renderer.");
 auto const inline RasterizerLog = logstore::Category("vt.rasterizer", "Logs details about text rendering.");
+auto const inline CacheStatsLog =
+    logstore::Category("vt.renderer.caches", "Periodically logs the statistics of all caches.");
 
 std::vector<uint8_t> downsampleRGBA(std::vector<uint8_t> const& _bitmap, ImageSize _size, ImageSize _newSize);
 
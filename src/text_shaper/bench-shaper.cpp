@@ -0,0 +1,410 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmark of text shaping and glyph rasterization with the fonts installed on the system.
+//
+// Each corpus is shaped and rasterized by each shaper available on this platform, once on a newly
+// created shaper (cold) and then repeatedly on the same shaper (warm). Note that the font files and
+// font keys are shared process-wide, so only the first shaper pays for locating and opening them.
+//
+// Usage: bench-shaper [--json FILE] [ROUNDS]
+//
+// If FILE is - (dash), only the JSON results are written to standard output.
+
+#include <text_shaper/font.h>
+#include <text_shaper/font_locator_provider.h>
+#include <text_shaper/open_shaper.h>
+#include <text_shaper/shaper.h>
+
+#if defined(_WIN32)
+    #include <text_shaper/directwrite_shaper.h>
+#endif
+
+#include <fmt/format.h>
+
+#include <unicode/convert.h>
+#include <unicode/run_segmenter.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+
+struct Corpus
+{
+    string_view name;
+    string_view fontFamily;
+    vector<text::font_feature> features;
+    vector<string_view> lines;
+};
+
+struct Engine
+{
+    string_view name;
+    function<unique_ptr<text::shaper>()> create;
+};
+
+struct Timing
+{
+    chrono::duration<double> cold {};
+    chrono::duration<double> warm {}; // average of one warm round
+};
+
+struct BenchResult
+{
+    string_view engine;
+    string_view corpus;
+    size_t codepoints = 0;
+    size_t glyphs = 0;
+    size_t uniqueGlyphs = 0;
+    chrono::duration<double> loadFonts {};
+    Timing shape;
+    Timing rasterize;
+};
+
+constexpr auto FontSize = text::font_size { 12.0 };
+constexpr auto ScreenDPI = text::DPI { 96, 96 };
+
+vector<Corpus> corpora()
+{
+    return {
+        { "ascii-code",
+          "monospace",
+          {},
+          {
+              "int main(int argc, char const* argv[])",
+              "{",
+              "    auto const size = argc > 1 ? strtoul(argv[1], nullptr, 10) : 64ul;",
+              "    for (size_t i = 0; i < size; ++i)",
+              "        fmt::print(\"{:>8} {}\\n\", i, values[i % values.size()]);",
+              "    return EXIT_SUCCESS; // Done.",
+              "}",
+          } },
+        { "ligatures",
+          "Fira Code",
+          { text::font_feature { 'c', 'a', 'l', 't' }, text::font_feature { 'l', 'i', 'g', 'a' } },
+          {
+              "a != b && c == d || e <= f && g >= h",
+              "auto f = [](auto x) -> auto { return x <=> 0; };",
+              "if (x === y && y !== z) { return a => b; }",
+              "/** www ::: <!-- --> |> <| <$> >>= =<< ... */",
+              "#include <iostream> // ## ### #### <- <-- -->",
+          } },
+        { "cjk",
+          "monospace",
+          {},
+          {
+              "终端模拟器是一种在图形界面中模拟文本终端的程序。",
+              "ターミナルエミュレータは、テキスト端末をエミュレートするプログラムです。",
+              "터미널 에뮬레이터는 그래픽 환경에서 텍스트 터미널을 흉내 내는 프로그램이다.",
+              "漢字、ひらがな、カタカナ、한글 and Latin mixed 混合 text.",
+          } },
+        { "complex-scripts",
+          "monospace",
+          {},
+          {
+              "محاكي الطرفية هو برنامج يحاكي طرفية نصية داخل واجهة رسومية.",
+              "مرحبا بالعالم، هذا نص عربي مع أرقام ١٢٣ وكلمات English.",
+              "टर्मिनल एमुलेटर एक प्रोग्राम है जो ग्राफिकल इंटरफ़ेस में टेक्स्ट टर्मिनल का अनुकरण करता है।",
+              "क्षत्रिय, द्वार, श्री, ज्ञान और हिन्दी संयुक्ताक्षर।",
+          } },
+        { "emoji-zwj",
+          "monospace",
+          {},
+          {
+              "👨‍👩‍👧‍👦 👩‍💻 🧑‍🚀 🏳️‍🌈 🏴‍☠️ 👁️‍🗨️ 🧑‍🤝‍🧑 ❤️‍🔥",
+              "👋🏻 👋🏼 👋🏽 👋🏾 👋🏿 🤝🏽 🧑🏿‍🦱 👩🏻‍🦰 🙇‍♀️",
+              "🇩🇪 🇺🇸 🇯🇵 🇫🇷 🇧🇷 🇮🇳 ✔️ ☺️ ©️ 1️⃣ #️⃣",
+          } },
+    };
+}
+
+vector<Engine> engines()
+{
+    auto result = vector<Engine> {};
+    result.push_back({ "open_shaper/fontconfig", []() -> unique_ptr<text::shaper> {
+                          return make_unique<text::open_shaper>(
+                              ScreenDPI, text::font_locator_provider::get().fontconfig());
+                      } });
+#if defined(__APPLE__)
+    // There is no CoreText shaper yet, only CoreText font location.
+    result.push_back({ "open_shaper/coretext", []() -> unique_ptr<text::shaper> {
+                          return make_unique<text::open_shaper>(
+                              ScreenDPI, text::font_locator_provider::get().coretext());
+                      } });
+#endif
+#if defined(_WIN32)
+    result.push_back({ "directwrite", []() -> unique_ptr<text::shaper> {
+                          return make_unique<text::directwrite_shaper>(
+                              ScreenDPI, text::font_locator_provider::get().directwrite());
+                      } });
+#endif
+    return result;
+}
+
+struct Fonts
+{
+    text::font_key text;
+    text::font_key emoji;
+};
+
+optional<Fonts> loadFonts(text::shaper& _shaper, Corpus const& _corpus)
+{
+    auto textFont = text::font_description::parse(_corpus.fontFamily);
+    textFont.spacing = text::font_spacing::mono;
+    textFont.features = _corpus.features;
+
+    auto emojiFont = text::font_description {};
+#if defined(_WIN32)
+    emojiFont.familyName = "Segoe UI Emoji";
+#else
+    emojiFont.familyName = "emoji";
+#endif
+    emojiFont.spacing = text::font_spacing::mono;
+
+    auto const textKey = _shaper.load_font(textFont, FontSize);
+    if (!textKey)
+        return nullopt;
+    return Fonts { *textKey, _shaper.load_font(emojiFont, FontSize).value_or(*textKey) };
+}
+
+/// Shapes all lines of the corpus the way the renderer does, i.e. split up into runs of the same
+/// script and presentation style.
+size_t shapeCorpus(text::shaper& _shaper,
+                   Fonts const& _fonts,
+                   vector<u32string> const& _lines,
+                   vector<text::glyph_position>* _glyphs)
+{
+    auto glyphCount = size_t { 0 };
+    auto result = text::shape_result {};
+    auto clusters = vector<unsigned> {};
+    for (u32string const& line: _lines)
+    {
+        clusters.resize(line.size());
+        for (size_t i = 0; i < clusters.size(); ++i)
+            clusters[i] = static_cast<unsigned>(i);
+
+        auto run = unicode::run_segmenter::range {};
+        auto rs = unicode::run_segmenter(u32string_view(line));
+        while (rs.consume(unicode::out(run)))
+        {
+            auto const count = static_cast<size_t>(run.end - run.start);
+            auto const presentation = get<unicode::PresentationStyle>(run.properties);
+            auto const font = presentation == unicode::PresentationStyle::Emoji ? _fonts.emoji : _fonts.text;
+            result.clear();
+            _shaper.shape(font,
+                          u32string_view(line).substr(run.start, count),
+                          gsl::span(clusters.data() + run.start, count),
+                          get<unicode::Script>(run.properties),
+                          presentation,
+                          result);
+            glyphCount += result.size();
+            if (_glyphs)
+                _glyphs->insert(_glyphs->end(), result.begin(), result.end());
+        }
+    }
+    return glyphCount;
+}
+
+void rasterizeGlyphs(text::shaper& _shaper, vector<text::glyph_position> const& _glyphs)
+{
+    for (text::glyph_position const& glyph: _glyphs)
+    {
+        auto const mode = glyph.presentation == unicode::PresentationStyle::Emoji ? text::render_mode::color
+                                                                                 : text::render_mode::gray;
+        (void) _shaper.rasterize(glyph.glyph, mode);
+    }
+}
+
+vector<text::glyph_position> uniqueGlyphs(vector<text::glyph_position> const& _glyphs)
+{
+    auto result = vector<text::glyph_position> {};
+    for (text::glyph_position const& glyph: _glyphs)
+    {
+        auto const isSame = [&](text::glyph_position const& other) {
+            return other.glyph == glyph.glyph;
+        };
+        if (std::none_of(result.begin(), result.end(), isSame))
+            result.push_back(glyph);
+    }
+    return result;
+}
+
+template <typename F>
+chrono::duration<double> measure(F&& _f)
+{
+    auto const startTime = chrono::steady_clock::now();
+    _f();
+    return chrono::steady_clock::now() - startTime;
+}
+
+optional<BenchResult> run(Engine const& _engine, Corpus const& _corpus, int _rounds)
+{
+    auto lines = vector<u32string> {};
+    auto result = BenchResult { _engine.name, _corpus.name };
+    for (string_view const line: _corpus.lines)
+    {
+        lines.emplace_back(unicode::convert_to<char32_t>(line));
+        result.codepoints += lines.back().size();
+    }
+
+    auto shaper = _engine.create();
+    auto fonts = optional<Fonts> {};
+    result.loadFonts = measure([&]() { fonts = loadFonts(*shaper, _corpus); });
+    if (!fonts)
+        return nullopt;
+
+    auto glyphs = vector<text::glyph_position> {};
+    result.shape.cold = measure([&]() { result.glyphs = shapeCorpus(*shaper, *fonts, lines, &glyphs); });
+    result.shape.warm = measure([&]() {
+                            for (int round = 0; round < _rounds; ++round)
+                                shapeCorpus(*shaper, *fonts, lines, nullptr);
+                        })
+                        / _rounds;
+
+    glyphs = uniqueGlyphs(glyphs);
+    result.uniqueGlyphs = glyphs.size();
+    result.rasterize.cold = measure([&]() { rasterizeGlyphs(*shaper, glyphs); });
+    result.rasterize.warm = measure([&]() {
+                                for (int round = 0; round < _rounds; ++round)
+                                    rasterizeGlyphs(*shaper, glyphs);
+                            })
+                            / _rounds;
+
+    return result;
+}
+
+double perSecond(size_t _count, chrono::duration<double> _elapsed)
+{
+    return _elapsed.count() > 0 ? static_cast<double>(_count) / _elapsed.count() : 0.0;
+}
+
+void writeResults(vector<BenchResult> const& _results)
+{
+    fmt::print("{:<24} {:<16} {:>10} {:>14} {:>14} {:>14} {:>14}\n",
+               "Engine",
+               "Corpus",
+               "Load (ms)",
+               "Shape cold/s",
+               "Shape warm/s",
+               "Raster cold/s",
+               "Raster warm/s");
+    for (auto const& result: _results)
+        fmt::print("{:<24} {:<16} {:>10.3f} {:>14.0f} {:>14.0f} {:>14.0f} {:>14.0f}\n",
+                   result.engine,
+                   result.corpus,
+                   result.loadFonts.count() * 1e3,
+                   perSecond(result.codepoints, result.shape.cold),
+                   perSecond(result.codepoints, result.shape.warm),
+                   perSecond(result.uniqueGlyphs, result.rasterize.cold),
+                   perSecond(result.uniqueGlyphs, result.rasterize.warm));
+    fmt::print("\nShaping is measured in codepoints, rasterization in distinct glyphs per second.\n");
+}
+
+void writeResultsJson(vector<BenchResult> const& _results, ostream& _output)
+{
+    // The names of the engines and corpora do not need any escaping.
+    _output << "{\n";
+    _output << "  \"results\": [\n";
+    for (size_t i = 0; i < _results.size(); ++i)
+    {
+        auto const& result = _results[i];
+        _output << fmt::format("    {{ \"engine\": \"{}\", \"corpus\": \"{}\", \"codepoints\": {}, "
+                               "\"glyphs\": {}, \"uniqueGlyphs\": {}, \"loadFontsSeconds\": {:.6f},\n",
+                               result.engine,
+                               result.corpus,
+                               result.codepoints,
+                               result.glyphs,
+                               result.uniqueGlyphs,
+                               result.loadFonts.count());
+        _output << fmt::format("      \"shape\": {{ \"coldSeconds\": {:.6f}, \"warmSeconds\": {:.6f}, "
+                               "\"coldCodepointsPerSecond\": {:.0f}, \"warmCodepointsPerSecond\": {:.0f} }},\n",
+                               result.shape.cold.count(),
+                               result.shape.warm.count(),
+                               perSecond(result.codepoints, result.shape.cold),
+                               perSecond(result.codepoints, result.shape.warm));
+        _output << fmt::format("      \"rasterize\": {{ \"coldSeconds\": {:.6f}, \"warmSeconds\": {:.6f}, "
+                               "\"coldGlyphsPerSecond\": {:.0f}, \"warmGlyphsPerSecond\": {:.0f} }} }}{}\n",
+                               result.rasterize.cold.count(),
+                               result.rasterize.warm.count(),
+                               perSecond(result.uniqueGlyphs, result.rasterize.cold),
+                               perSecond(result.uniqueGlyphs, result.rasterize.warm),
+                               i + 1 < _results.size() ? "," : "");
+    }
+    _output << "  ]\n";
+    _output << "}\n";
+}
+
+} // namespace
+
+int main(int argc, char const* argv[])
+{
+    auto jsonFileName = string {};
+    auto rounds = 100;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (string_view(argv[i]) == "--json" && i + 1 < argc)
+            jsonFileName = argv[++i];
+        else
+            rounds = max(1, atoi(argv[i]));
+    }
+
+    auto results = vector<BenchResult> {};
+    for (Engine const& engine: engines())
+    {
+        for (Corpus const& corpus: corpora())
+        {
+            if (auto result = run(engine, corpus, rounds))
+                results.emplace_back(*result);
+            else
+                cerr << fmt::format("{}: Failed to load font \"{}\" for {}.\n",
+                                    engine.name,
+                                    corpus.fontFamily,
+                                    corpus.name);
+        }
+    }
+
+    if (jsonFileName == "-")
+    {
+        writeResultsJson(results, cout);
+        return EXIT_SUCCESS;
+    }
+
+    writeResults(results);
+
+    if (!jsonFileName.empty())
+    {
+        auto output = ofstream { jsonFileName, ios::trunc };
+        writeResultsJson(results, output);
+        if (!output)
+        {
+            cerr << fmt::format("Failed to write results to {}.\n", jsonFileName);
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,155 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <text_shaper/caching_font_locator.h>
+
+#include <exception>
+#include <thread>
+
+using std::lock_guard;
+using std::promise;
+using std::shared_future;
+using std::shared_ptr;
+using std::vector;
+
+namespace text
+{
+
+caching_font_locator::caching_font_locator(create_locator_fn _createLocator):
+    createLocator_ { std::move(_createLocator) }
+{
+}
+
+caching_font_locator::~caching_font_locator()
+{
+    // Wait for a prefetch in progress, if any, as it is using this object.
+    if (locator_.valid())
+        locator_.wait();
+    for (auto& [description, sources]: located_)
+        sources.wait();
+}
+
+void caching_font_locator::prefetch(vector<font_description> _descriptions)
+{
+    auto const _ = lock_guard { mutex_ };
+
+    // The descriptions are located one after another on a single thread, as not all font
+    // locator implementations are safe to be used from multiple threads concurrently.
+    auto promises = std::make_shared<vector<promise<font_source_list>>>();
+    auto pending = vector<font_description> {};
+    for (auto& description: _descriptions)
+    {
+        if (located_.count(description))
+            continue;
+        located_.emplace(description, promises->emplace_back().get_future().share());
+        pending.emplace_back(std::move(description));
+    }
+
+    auto locatorPromise = std::make_shared<promise<shared_ptr<font_locator>>>();
+    auto const createLocator = !locator_.valid();
+    if (createLocator)
+        locator_ = locatorPromise->get_future().share();
+
+    if (pending.empty() && !createLocator)
+        return;
+
+    LocatorLog()("Locating {} fonts in background.", pending.size());
+
+    auto thread = std::thread([this,
+                               promises,
+                               locatorPromise,
+                               createLocator,
+                               locatorFuture = locator_,
+                               pending = std::move(pending)]() {
+        auto const _ = lock_guard { locatorLock_ };
+        size_t i = 0;
+        auto locatorReady = !createLocator;
+        try
+        {
+            if (createLocator)
+            {
+                locatorPromise->set_value(createLocator_());
+                locatorReady = true;
+            }
+
+            auto& fontLocator = *locatorFuture.get();
+            for (; i < pending.size(); ++i)
+                (*promises)[i].set_value(fontLocator.locate(pending[i]));
+        }
+        catch (...)
+        {
+            // Let the waiting callers see the failure as if they had located the fonts themselves.
+            if (!locatorReady)
+                locatorPromise->set_exception(std::current_exception());
+            for (; i < pending.size(); ++i)
+                (*promises)[i].set_exception(std::current_exception());
+        }
+    });
+    thread.detach();
+}
+
+font_locator& caching_font_locator::locator()
+{
+    auto locator = shared_future<shared_ptr<font_locator>> {};
+    {
+        auto const _ = lock_guard { mutex_ };
+        if (!locator_.valid())
+        {
+            auto locatorPromise = promise<shared_ptr<font_locator>> {};
+            locatorPromise.set_value(createLocator_());
+            locator_ = locatorPromise.get_future().share();
+        }
+        locator = locator_;
+    }
+    return *locator.get();
+}
+
+font_source_list caching_font_locator::locate(font_description const& _description)
+{
+    auto sources = shared_future<font_source_list> {};
+    {
+        auto const _ = lock_guard { mutex_ };
+        if (auto i = located_.find(_description); i != located_.end())
+            sources = i->second;
+    }
+    if (sources.valid())
+        return sources.get();
+
+    auto& fontLocator = locator();
+    auto result = [&]() {
+        auto const _ = lock_guard { locatorLock_ };
+        return fontLocator.locate(_description);
+    }();
+
+    auto const _ = lock_guard { mutex_ };
+    auto sourcesPromise = promise<font_source_list> {};
+    sourcesPromise.set_value(result);
+    located_.emplace(_description, sourcesPromise.get_future().share());
+    return result;
+}
+
+font_source_list caching_font_locator::all()
+{
+    auto& fontLocator = locator();
+    auto const _ = lock_guard { locatorLock_ };
+    return fontLocator.all();
+}
+
+font_source_list caching_font_locator::resolve(gsl::span<const char32_t> _codepoints)
+{
+    auto& fontLocator = locator();
+    auto const _ = lock_guard { locatorLock_ };
+    return fontLocator.resolve(_codepoints);
+}
+
+} // namespace text
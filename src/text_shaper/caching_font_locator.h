@@ -0,0 +1,68 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <text_shaper/font.h>
+#include <text_shaper/font_locator.h>
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace text
+{
+
+/**
+ * Font locator that remembers the fonts located for each font description,
+ * and that may locate fonts ahead of time on a background thread.
+ *
+ * The actual font locator is created lazily, as creating it may already be costly
+ * (e.g. fontconfig loading its configuration and font cache).
+ */
+class caching_font_locator: public font_locator
+{
+  public:
+    using create_locator_fn = std::function<std::unique_ptr<font_locator>()>;
+
+    explicit caching_font_locator(create_locator_fn _createLocator);
+    ~caching_font_locator() override;
+
+    /// Creates the underlying locator and locates the given font descriptions
+    /// on a background thread, unless located already.
+    ///
+    /// Subsequent calls to locate() for these descriptions wait for the result.
+    void prefetch(std::vector<font_description> _descriptions);
+
+    [[nodiscard]] font_source_list locate(font_description const& description) override;
+    [[nodiscard]] font_source_list all() override;
+    [[nodiscard]] font_source_list resolve(gsl::span<const char32_t> codepoints) override;
+
+  private:
+    /// @returns the underlying locator, waiting for its creation if in progress.
+    font_locator& locator();
+
+    create_locator_fn createLocator_;
+
+    // Serializes the use of the underlying locator, which need not be thread-safe.
+    std::mutex locatorLock_;
+
+    std::mutex mutex_; // guards the members below
+    std::shared_future<std::shared_ptr<font_locator>> locator_;
+    std::unordered_map<font_description, std::shared_future<font_source_list>> located_;
+};
+
+} // namespace text
@@ -1,9 +1,12 @@
 #include <text_shaper/directwrite_analysis_wrapper.h>
 #include <text_shaper/directwrite_shaper.h>
 #include <text_shaper/font_locator.h>
+#include <text_shaper/font_registry.h>
 
 #include <algorithm>
+#include <stdexcept>
 #include <string>
+#include <utility>
 
 // {{{ TODO: replace with libunicode
 #include <codecvt>
@@ -102,6 +105,7 @@ namespace
 
 struct DxFontInfo
 {
+    font_source source;
     font_description description;
     font_size size;
     font_metrics metrics;
@@ -122,7 +126,8 @@ struct directwrite_shaper::Private
     std::unordered_map<font_key, DxFontInfo> fonts;
     std::unordered_map<font_key, bool> fontsHasColor;
 
-    font_key nextFontKey;
+    // Created once, as the rendering parameters only depend on the system settings.
+    ComPtr<IDWriteRenderingParams> renderingParams;
 
     Private(DPI dpi, font_locator& _locator): dpi_ { dpi }, locator_ { &_locator }
     {
@@ -136,13 +141,8 @@ struct directwrite_shaper::Private
         wchar_t locale[LOCALE_NAME_MAX_LENGTH];
         GetUserDefaultLocaleName(locale, sizeof(locale));
         userLocale = locale;
-    }
 
-    font_key create_font_key()
-    {
-        auto result = nextFontKey;
-        nextFontKey.value++;
-        return result;
+        factory->CreateRenderingParams(&renderingParams);
     }
 
     optional<text::font_key> add_font(font_source const& _source,
@@ -154,6 +154,11 @@ struct directwrite_shaper::Private
             return nullopt;
         }
 
+        // Font keys are shared with all shapers, such that shaping results can be shared, too.
+        auto const key = font_key_registry::shared().get_or_create(_source, _size, dpi_);
+        if (fonts.count(key))
+            return key;
+
         auto const& sourcePath = std::get<font_path>(_source);
 
         std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> wStringConverter;
@@ -216,10 +221,6 @@ struct directwrite_shaper::Private
 
         familyNames->GetString(index, resolvedFamilyName.data(), length + 1);
 
-        for (auto&& [fontKey, fontInfo]: fonts)
-            if (_description == fontInfo.description && fontInfo.fontFace->Equals(fontFace))
-                return fontKey;
-
         auto dwMetrics = DWRITE_FONT_METRICS {};
         fontFace3->GetMetrics(&dwMetrics);
 
@@ -227,6 +228,7 @@ struct directwrite_shaper::Private
         auto const lineHeight = dwMetrics.ascent + dwMetrics.descent + dwMetrics.lineGap;
 
         DxFontInfo fontInfo {};
+        fontInfo.source = _source;
         fontInfo.description = _description;
         fontInfo.description.familyName = wStringConverter.to_bytes(resolvedFamilyName);
         fontInfo.description.wFamilyName = resolvedFamilyName;
@@ -240,12 +242,29 @@ struct directwrite_shaper::Private
 
         fontFace->QueryInterface(&fontInfo.fontFace);
 
-        auto key = create_font_key();
         fonts.emplace(pair { key, std::move(fontInfo) });
         fontsHasColor.emplace(pair { key, false });
         return key;
     }
 
+    /// @returns the font info of the given font key, loading the font if it has been loaded by
+    ///          another shaper only (e.g. a fallback font used in a shared shaping result).
+    DxFontInfo const& fontInfoOf(font_key _key)
+    {
+        if (auto i = fonts.find(_key); i != fonts.end())
+            return i->second;
+
+        // The key only equals if the font has been created for the same DPI.
+        if (auto const font = font_key_registry::shared().font_of(_key))
+        {
+            auto const key = add_font(font->first, font_description {}, font->second);
+            if (key && *key == _key)
+                return fonts.at(_key);
+        }
+
+        throw std::out_of_range("font key");
+    }
+
     int computeAverageAdvance(IDWriteFontFace* _fontFace)
     {
         auto constexpr firstCharIndex = UINT16 { 32 };
@@ -292,7 +311,7 @@ optional<font_key> directwrite_shaper::load_font(font_description const& _descri
 
 font_metrics directwrite_shaper::metrics(font_key _key) const
 {
-    DxFontInfo const& fontInfo = d->fonts.at(_key);
+    DxFontInfo const& fontInfo = d->fontInfoOf(_key);
     return fontInfo.metrics;
 }
 
@@ -310,7 +329,7 @@ void directwrite_shaper::shape(font_key _font,
 
     WCHAR const* textString = wText.c_str();
     UINT32 textLength = wText.size();
-    DxFontInfo fontInfo = d->fonts.at(_font);
+    DxFontInfo fontInfo = d->fontInfoOf(_font);
     IDWriteFontFace5* fontFace = fontInfo.fontFace;
 
     vector<UINT16> glyphIndices;
@@ -370,6 +389,12 @@ void directwrite_shaper::shape(font_key _font,
 
         uint8_t attempt = 0;
 
+        // Fallback fonts are looked up for the primary font and the block of the leading codepoint.
+        auto& fallbackFontCache = fallback_font_cache::shared();
+        auto const primaryId = identifier_of(fontInfo.source);
+        auto const leadingCodepoint = _text.empty() ? char32_t { 0 } : _text[0];
+        auto cachedFallbackId = fallbackFontCache.get(primaryId, leadingCodepoint);
+
         do
         {
             auto hr = d->textAnalyzer->GetGlyphs(&wText.at(textStart),
@@ -394,19 +419,30 @@ void directwrite_shaper::shape(font_key _font,
             if (SUCCEEDED(hr) && std::find(glyphIndices.begin(), glyphIndices.end(), 0) != glyphIndices.end())
             {
                 // glyphIndices contains 0 means some glyphs are missing from the current font.
-                // Need to perform fallback analysis.
-                font_source_list sources = d->locator_->resolve(gsl::span(_text.data(), _text.size()));
-                if (sources.size() > 0)
+                // Need to perform fallback analysis, unless the fallback font used for this block
+                // of codepoints before has not been tried yet.
+                optional<font_key> fontKeyOpt;
+                if (cachedFallbackId)
+                {
+                    auto const fallback = font_path { *std::exchange(cachedFallbackId, nullopt) };
+                    fontKeyOpt = d->add_font(fallback, fontInfo.description, fontInfo.size);
+                }
+                else
                 {
-                    optional<font_key> fontKeyOpt =
-                        d->add_font(sources[0], fontInfo.description, fontInfo.size);
-                    if (fontKeyOpt.has_value())
+                    font_source_list sources = d->locator_->resolve(gsl::span(_text.data(), _text.size()));
+                    if (sources.size() > 0)
                     {
-                        _font = fontKeyOpt.value();
-                        fontInfo = d->fonts.at(_font);
-                        fontFace = fontInfo.fontFace;
+                        fontKeyOpt = d->add_font(sources[0], fontInfo.description, fontInfo.size);
+                        if (fontKeyOpt.has_value())
+                            fallbackFontCache.set(primaryId, leadingCodepoint, identifier_of(sources[0]));
                     }
                 }
+                if (fontKeyOpt.has_value())
+                {
+                    _font = fontKeyOpt.value();
+                    fontInfo = d->fonts.at(_font);
+                    fontFace = fontInfo.fontFace;
+                }
                 continue;
             }
             else if (hr == E_NOT_SUFFICIENT_BUFFER)
@@ -462,7 +498,7 @@ void directwrite_shaper::shape(font_key _font,
 
 std::optional<rasterized_glyph> directwrite_shaper::rasterize(glyph_key _glyph, render_mode _mode)
 {
-    DxFontInfo const& fontInfo = d->fonts.at(_glyph.font);
+    DxFontInfo const& fontInfo = d->fontInfoOf(_glyph.font);
     IDWriteFontFace5* fontFace = fontInfo.fontFace;
     float const fontEmSize = ptToEm(_glyph.size.pt);
 
@@ -480,14 +516,11 @@ std::optional<rasterized_glyph> directwrite_shaper::rasterize(glyph_key _glyph,
     glyphRun.isSideways = false;
     glyphRun.bidiLevel = 0;
 
-    ComPtr<IDWriteRenderingParams> renderingParams;
-    d->factory->CreateRenderingParams(&renderingParams);
-
     DWRITE_RENDERING_MODE renderingMode;
     auto hr = fontFace->GetRecommendedRenderingMode(fontEmSize,
                                                     d->pixelPerDip(),
                                                     DWRITE_MEASURING_MODE::DWRITE_MEASURING_MODE_NATURAL,
-                                                    renderingParams.Get(),
+                                                    d->renderingParams.Get(),
                                                     &renderingMode);
     if (FAILED(hr))
     {
@@ -596,12 +629,23 @@ void directwrite_shaper::set_locator(font_locator& _locator)
 
 void directwrite_shaper::clear_cache()
 {
-    // TODO: clear the cache
+    // Loaded fonts are kept, as their keys are handed out already.
+    // Rasterized glyphs are cached by the renderer's texture atlas.
 }
 
 optional<glyph_position> directwrite_shaper::shape(font_key _font, char32_t _codepoint)
 {
-    return nullopt; // TODO
+    DxFontInfo const& fontInfo = d->fontInfoOf(_font);
+
+    auto const codepoint = static_cast<UINT32>(_codepoint);
+    UINT16 glyphIndex {};
+    if (FAILED(fontInfo.fontFace->GetGlyphIndices(&codepoint, 1, &glyphIndex)) || !glyphIndex)
+        return nullopt;
+
+    glyph_position gpos {};
+    gpos.glyph = glyph_key { fontInfo.size, _font, glyph_index { glyphIndex } };
+    gpos.advance.x = fontInfo.metrics.advance;
+    return gpos;
 }
 
 } // namespace text
@@ -22,8 +22,7 @@ namespace text
 {
 
 /**
- * Text shaping and rendering engine using open source technologies,
- * fontconfig + harfbuzz + freetype.
+ * Text shaping and rendering engine using DirectWrite.
  */
 class directwrite_shaper: public shaper
 {
@@ -49,6 +48,8 @@ class directwrite_shaper: public shaper
 
     std::optional<rasterized_glyph> rasterize(glyph_key _glyph, render_mode _mode) override;
 
+    [[nodiscard]] bool has_shared_font_keys() const noexcept override { return true; }
+
   private:
     struct Private;
     std::unique_ptr<Private, void (*)(Private*)> d;
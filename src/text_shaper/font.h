@@ -279,7 +279,8 @@ enum class render_mode
     gray,   //!< gray-scale anti-aliasing
     light,  //!< gray-scale anti-aliasing for optimized for LCD screens
     lcd,    //!< LCD-optimized anti-aliasing
-    color   //!< embedded color bitmaps are preferred
+    color,  //!< embedded color bitmaps are preferred
+    sdf     //!< signed distance fields, with the edge at value 128 (falls back to gray if unsupported)
 };
 
 } // namespace text
@@ -562,6 +563,7 @@ struct formatter<text::render_mode>
             case text::render_mode::light: return fmt::format_to(ctx.out(), "Light");
             case text::render_mode::lcd: return fmt::format_to(ctx.out(), "LCD");
             case text::render_mode::color: return fmt::format_to(ctx.out(), "Color");
+            case text::render_mode::sdf: return fmt::format_to(ctx.out(), "SDF");
         }
         return fmt::format_to(ctx.out(), "({})", unsigned(_value));
     }
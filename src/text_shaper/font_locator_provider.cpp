@@ -12,6 +12,7 @@
  * limitations under the License.
  */
 
+#include <text_shaper/caching_font_locator.h>
 #include <text_shaper/coretext_locator.h>
 #include <text_shaper/directwrite_locator.h>
 #include <text_shaper/font_locator_provider.h>
@@ -35,7 +36,7 @@ font_locator_provider& font_locator_provider::get()
 font_locator& font_locator_provider::coretext()
 {
     if (!_coretext)
-        _coretext = make_unique<coretext_locator>();
+        _coretext = make_unique<caching_font_locator>([]() { return make_unique<coretext_locator>(); });
 
     return *_coretext;
 }
@@ -45,7 +46,7 @@ font_locator& font_locator_provider::coretext()
 font_locator& font_locator_provider::directwrite()
 {
     if (!_directwrite)
-        _directwrite = make_unique<directwrite_locator>();
+        _directwrite = make_unique<caching_font_locator>([]() { return make_unique<directwrite_locator>(); });
 
     return *_directwrite;
 }
@@ -54,7 +55,7 @@ font_locator& font_locator_provider::directwrite()
 font_locator& font_locator_provider::fontconfig()
 {
     if (!_fontconfig)
-        _fontconfig = make_unique<fontconfig_locator>();
+        _fontconfig = make_unique<caching_font_locator>([]() { return make_unique<fontconfig_locator>(); });
 
     return *_fontconfig;
 }
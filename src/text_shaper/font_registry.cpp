@@ -0,0 +1,90 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <text_shaper/font_registry.h>
+
+#include <fmt/format.h>
+
+#include <stdexcept>
+
+using std::get;
+using std::holds_alternative;
+using std::lock_guard;
+using std::nullopt;
+using std::optional;
+using std::pair;
+using std::string;
+
+namespace text
+{
+
+string identifier_of(font_source const& _source)
+{
+    if (holds_alternative<font_path>(_source))
+        return get<font_path>(_source).value;
+    if (holds_alternative<font_memory_ref>(_source))
+        return get<font_memory_ref>(_source).identifier;
+    throw std::invalid_argument("source");
+}
+
+// {{{ font_key_registry
+font_key_registry& font_key_registry::shared()
+{
+    static auto registry = font_key_registry {};
+    return registry;
+}
+
+font_key font_key_registry::get_or_create(font_source const& _source, font_size _size, DPI _dpi)
+{
+    auto const _ = lock_guard { lock_ };
+    auto const id = fmt::format("{}:{}:{}x{}", identifier_of(_source), _size.pt, _dpi.x, _dpi.y);
+    auto const nextKey = font_key { static_cast<unsigned>(fonts_.size()) };
+    auto const [i, inserted] = keys_.try_emplace(id, nextKey);
+    if (inserted)
+        fonts_.emplace_back(_source, _size);
+    return i->second;
+}
+
+optional<pair<font_source, font_size>> font_key_registry::font_of(font_key _key) const
+{
+    auto const _ = lock_guard { lock_ };
+    if (_key.value < fonts_.size())
+        return fonts_[_key.value];
+    return nullopt;
+}
+// }}}
+
+// {{{ fallback_font_cache
+fallback_font_cache& fallback_font_cache::shared()
+{
+    static auto cache = fallback_font_cache {};
+    return cache;
+}
+
+optional<string> fallback_font_cache::get(string const& _primary, char32_t _codepoint) const
+{
+    auto const _ = lock_guard { lock_ };
+    if (auto i = fallbacks_.find(_primary); i != fallbacks_.end())
+        if (auto k = i->second.find(_codepoint / BlockSize); k != i->second.end())
+            return k->second;
+    return nullopt;
+}
+
+void fallback_font_cache::set(string const& _primary, char32_t _codepoint, string _fallback)
+{
+    auto const _ = lock_guard { lock_ };
+    fallbacks_[_primary][_codepoint / BlockSize] = std::move(_fallback);
+}
+// }}}
+
+} // namespace text
@@ -0,0 +1,78 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <text_shaper/font.h>
+#include <text_shaper/font_locator.h>
+
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace text
+{
+
+/// @returns a string identifying the given font source, e.g. its file path.
+[[nodiscard]] std::string identifier_of(font_source const& _source);
+
+/**
+ * Assigns font keys to fonts by their source, size, and DPI.
+ *
+ * The keys are shared by all shapers of the process, regardless of their backend, such that
+ * the same font gets the same key in every terminal session, and shaping results can be shared
+ * between them (see shaper::has_shared_font_keys()).
+ */
+class font_key_registry
+{
+  public:
+    [[nodiscard]] static font_key_registry& shared();
+
+    [[nodiscard]] font_key get_or_create(font_source const& _source, font_size _size, DPI _dpi);
+
+    /// @returns the font source and size the given key has been created for.
+    [[nodiscard]] std::optional<std::pair<font_source, font_size>> font_of(font_key _key) const;
+
+  private:
+    mutable std::mutex lock_;
+    std::unordered_map<std::string, font_key> keys_;
+    std::vector<std::pair<font_source, font_size>> fonts_; // indexed by font key
+};
+
+/**
+ * Remembers for each primary font which of its fallback fonts has been used last
+ * for shaping a block of codepoints, such that shaping the next text of that block does not
+ * need to try all fallback fonts in order again.
+ *
+ * Fonts are identified by their source rather than their font key, as the cache is shared by
+ * all shapers of the process, i.e. by all terminal sessions.
+ */
+class fallback_font_cache
+{
+  public:
+    static constexpr char32_t BlockSize = 128;
+
+    [[nodiscard]] static fallback_font_cache& shared();
+
+    [[nodiscard]] std::optional<std::string> get(std::string const& _primary, char32_t _codepoint) const;
+    void set(std::string const& _primary, char32_t _codepoint, std::string _fallback);
+
+  private:
+    mutable std::mutex lock_;
+    std::unordered_map<std::string, std::unordered_map<char32_t, std::string>> fallbacks_;
+};
+
+} // namespace text
@@ -0,0 +1,330 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <text_shaper/glyph_disk_cache.h>
+
+#include <cerrno>
+#include <cstring>
+#include <string_view>
+
+#if !defined(_WIN32)
+    #include <sys/file.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+using std::nullopt;
+using std::optional;
+using std::string;
+using std::string_view;
+using std::unique_ptr;
+
+namespace text
+{
+
+namespace
+{
+    constexpr auto Magic = string_view { "CTGLYPHS" };
+    constexpr uint32_t Version = 1;
+    constexpr size_t HeaderSize = 16; // magic, version, reserved
+
+    // Record layout: key (16), x (4), y (4), width (4), height (4), glyph index (4),
+    //                format (1), reserved (3), bitmap size (4), bitmap
+    constexpr size_t RecordHeaderSize = 44;
+
+    template <typename T>
+    void append(string& _out, T _value)
+    {
+        _out.append(reinterpret_cast<char const*>(&_value), sizeof(T));
+    }
+
+    template <typename T>
+    T read(char const* _in) noexcept
+    {
+        auto value = T {};
+        std::memcpy(&value, _in, sizeof(T));
+        return value;
+    }
+
+#if !defined(_WIN32)
+    bool writeAll(int fd, char const* data, size_t size) noexcept
+    {
+        while (size != 0)
+        {
+            auto const n = ::write(fd, data, size);
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+            data += n;
+            size -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    uint64_t fileSize(int fd) noexcept
+    {
+        struct stat st
+        {
+        };
+        if (fstat(fd, &st) != 0)
+            return 0;
+        return static_cast<uint64_t>(st.st_size);
+    }
+
+    bool hasValidHeader(int fd) noexcept
+    {
+        char header[HeaderSize];
+        if (::pread(fd, header, HeaderSize, 0) != static_cast<ssize_t>(HeaderSize))
+            return false;
+        return string_view(header, Magic.size()) == Magic && read<uint32_t>(header + Magic.size()) == Version;
+    }
+
+    /// Atomically replaces the file at the given path with an empty cache file.
+    ///
+    /// Other processes may still have the previous file mapped, which is why it must not be truncated.
+    int createEmptyFile(FileSystem::path const& _path) noexcept
+    {
+        auto const tempPath = _path.string() + "." + std::to_string(::getpid());
+        auto const fd = ::open(tempPath.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0600);
+        if (fd < 0)
+            return -1;
+
+        auto header = string { Magic };
+        append(header, Version);
+        append(header, uint32_t { 0 });
+        if (!writeAll(fd, header.data(), header.size()) || ::rename(tempPath.c_str(), _path.c_str()) != 0)
+        {
+            ::close(fd);
+            ::unlink(tempPath.c_str());
+            return -1;
+        }
+        return fd;
+    }
+
+    /// Holds an exclusive advisory lock on the given file for as long as it lives.
+    struct file_lock
+    {
+        int fd;
+        explicit file_lock(int _fd) noexcept: fd { _fd }
+        {
+            while (::flock(fd, LOCK_EX) != 0 && errno == EINTR)
+                ;
+        }
+        ~file_lock() { ::flock(fd, LOCK_UN); }
+        file_lock(file_lock const&) = delete;
+        file_lock& operator=(file_lock const&) = delete;
+    };
+#endif
+} // namespace
+
+unique_ptr<glyph_disk_cache> glyph_disk_cache::open(FileSystem::path _path, uint64_t _sizeLimit)
+{
+#if defined(_WIN32)
+    RasterizerLog()("Glyph disk cache is not supported on this platform.");
+    (void) _path;
+    (void) _sizeLimit;
+    return nullptr;
+#else
+    auto ec = FileSystemError {};
+    FileSystem::create_directories(_path.parent_path(), ec);
+
+    auto fd = ::open(_path.c_str(), O_RDWR | O_APPEND | O_CLOEXEC);
+    if (fd >= 0)
+    {
+        auto const size = fileSize(fd);
+        if (size < HeaderSize || size >= _sizeLimit || !hasValidHeader(fd))
+        {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+
+    // Start from scratch if the file is new, full, or of an unsupported version.
+    if (fd < 0)
+        fd = createEmptyFile(_path);
+
+    if (fd < 0)
+    {
+        RasterizerLog()("Failed to open glyph disk cache {}. {}", _path.string(), strerror(errno));
+        return nullptr;
+    }
+
+    auto cache = unique_ptr<glyph_disk_cache>(new glyph_disk_cache(std::move(_path), fd, _sizeLimit));
+    {
+        auto const _ = file_lock { fd };
+        cache->mapAndIndex(true);
+    }
+    RasterizerLog()("Using glyph disk cache {} with {} glyphs ({} bytes).",
+                    cache->path_.string(),
+                    cache->size(),
+                    cache->mappingSize_);
+    return cache;
+#endif
+}
+
+glyph_disk_cache::glyph_disk_cache(FileSystem::path _path, int _fd, uint64_t _sizeLimit):
+    path_ { std::move(_path) },
+    fd_ { _fd },
+    sizeLimit_ { _sizeLimit },
+    indexedSize_ { HeaderSize },
+    index_ { crispy::StrongLRUHashtable<uint64_t>::create(
+        crispy::StrongHashtableSize { 65536 }, crispy::LRUCapacity { 32768 }, "Glyph disk cache index") }
+{
+}
+
+glyph_disk_cache::~glyph_disk_cache()
+{
+    unmap();
+#if !defined(_WIN32)
+    ::close(fd_);
+#endif
+}
+
+optional<rasterized_glyph> glyph_disk_cache::get(crispy::StrongHash const& _key)
+{
+    uint64_t const* offset = index_->try_get(_key);
+    if (!offset || *offset + RecordHeaderSize > mappingSize_)
+        return nullopt;
+
+    char const* record = mapping_ + *offset;
+    auto glyph = rasterized_glyph {};
+    glyph.position.x = read<int32_t>(record + 16);
+    glyph.position.y = read<int32_t>(record + 20);
+    glyph.bitmapSize.width = crispy::Width::cast_from(read<uint32_t>(record + 24));
+    glyph.bitmapSize.height = crispy::Height::cast_from(read<uint32_t>(record + 28));
+    glyph.index = glyph_index { read<uint32_t>(record + 32) };
+    glyph.format = static_cast<bitmap_format>(read<uint8_t>(record + 36));
+    auto const bitmapSize = read<uint32_t>(record + 40);
+    if (*offset + RecordHeaderSize + bitmapSize > mappingSize_)
+        return nullopt;
+
+    auto const bitmap = reinterpret_cast<uint8_t const*>(record + RecordHeaderSize);
+    glyph.bitmap.assign(bitmap, bitmap + bitmapSize);
+
+    if (!glyph.valid())
+        return nullopt;
+
+    return glyph;
+}
+
+void glyph_disk_cache::put(crispy::StrongHash const& _key, rasterized_glyph const& _glyph)
+{
+#if defined(_WIN32)
+    (void) _key;
+    (void) _glyph;
+#else
+    if (full_ || index_->contains(_key))
+        return;
+
+    auto record = string {};
+    record.reserve(RecordHeaderSize + _glyph.bitmap.size());
+    record.append(reinterpret_cast<char const*>(&_key.value), sizeof(_key.value));
+    append(record, static_cast<int32_t>(_glyph.position.x));
+    append(record, static_cast<int32_t>(_glyph.position.y));
+    append(record, unbox<uint32_t>(_glyph.bitmapSize.width));
+    append(record, unbox<uint32_t>(_glyph.bitmapSize.height));
+    append(record, static_cast<uint32_t>(_glyph.index.value));
+    append(record, static_cast<uint8_t>(_glyph.format));
+    record.append(3, '\0');
+    append(record, static_cast<uint32_t>(_glyph.bitmap.size()));
+    record.append(reinterpret_cast<char const*>(_glyph.bitmap.data()), _glyph.bitmap.size());
+
+    auto const _ = file_lock { fd_ };
+    if (fileSize(fd_) + record.size() > sizeLimit_)
+    {
+        RasterizerLog()("Glyph disk cache {} is full. Not storing any more glyphs.", path_.string());
+        full_ = true;
+        return;
+    }
+
+    // The whole record is written at once (O_APPEND), such that readers never see partial records
+    // while they hold the file lock.
+    if (!writeAll(fd_, record.data(), record.size()))
+    {
+        RasterizerLog()("Failed to write to glyph disk cache {}. {}", path_.string(), strerror(errno));
+        full_ = true;
+    }
+#endif
+}
+
+void glyph_disk_cache::refresh()
+{
+#if !defined(_WIN32)
+    if (fileSize(fd_) == mappingSize_)
+        return;
+
+    auto const _ = file_lock { fd_ };
+    mapAndIndex(false);
+#endif
+}
+
+void glyph_disk_cache::mapAndIndex(bool _repair)
+{
+#if defined(_WIN32)
+    (void) _repair;
+#else
+    auto const size = fileSize(fd_);
+    if (size <= indexedSize_)
+        return;
+
+    unmap();
+    auto* mapping = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd_, 0);
+    if (mapping == MAP_FAILED)
+    {
+        RasterizerLog()("Failed to map glyph disk cache {}. {}", path_.string(), strerror(errno));
+        return;
+    }
+    mapping_ = static_cast<char const*>(mapping);
+    mappingSize_ = size;
+
+    auto offset = indexedSize_;
+    while (offset + RecordHeaderSize <= size)
+    {
+        char const* record = mapping_ + offset;
+        auto const recordSize = RecordHeaderSize + read<uint32_t>(record + 40);
+        if (offset + recordSize > size)
+            break;
+
+        auto key = crispy::StrongHash {};
+        std::memcpy(&key.value, record, sizeof(key.value));
+        index_->emplace(key, offset);
+        offset += recordSize;
+    }
+    indexedSize_ = offset;
+
+    if (offset != size && _repair)
+    {
+        RasterizerLog()("Truncating incomplete record of glyph disk cache {}.", path_.string());
+        if (::ftruncate(fd_, static_cast<off_t>(offset)) != 0)
+            full_ = true;
+    }
+#endif
+}
+
+void glyph_disk_cache::unmap() noexcept
+{
+#if !defined(_WIN32)
+    if (mapping_)
+        ::munmap(const_cast<char*>(mapping_), mappingSize_);
+#endif
+    mapping_ = nullptr;
+    mappingSize_ = 0;
+}
+
+} // namespace text
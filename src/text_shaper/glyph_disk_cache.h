@@ -0,0 +1,96 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <text_shaper/shaper.h>
+
+#include <crispy/StrongHash.h>
+#include <crispy/StrongLRUHashtable.h>
+#include <crispy/stdfs.h>
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+namespace text
+{
+
+/**
+ * Persistent on-disk cache of rasterized glyphs, shared across application launches.
+ *
+ * Glyphs are appended to a single file as they are rasterized, and read back via a read-only
+ * memory mapping of that file. The cache key must identify the font file (including its
+ * modification time), the font size, the DPI, the render mode, and the glyph index,
+ * such that a cached bitmap is exactly what the rasterizer would produce.
+ *
+ * Multiple processes may use the same cache file at the same time. Appending is serialized
+ * via an advisory file lock. Once the file reaches its size limit no more glyphs are stored,
+ * and the cache is started from scratch with the next launch.
+ *
+ * Not supported on Windows, where open() always fails.
+ */
+class glyph_disk_cache
+{
+  public:
+    /// Opens (or creates) the cache file at the given path.
+    ///
+    /// @returns the cache or nullptr if the file could not be opened.
+    static std::unique_ptr<glyph_disk_cache> open(FileSystem::path _path, uint64_t _sizeLimit);
+
+    glyph_disk_cache(glyph_disk_cache const&) = delete;
+    glyph_disk_cache(glyph_disk_cache&&) = delete;
+    glyph_disk_cache& operator=(glyph_disk_cache const&) = delete;
+    glyph_disk_cache& operator=(glyph_disk_cache&&) = delete;
+    ~glyph_disk_cache();
+
+    [[nodiscard]] FileSystem::path const& path() const noexcept { return path_; }
+
+    /// Number of glyphs currently known to the index.
+    [[nodiscard]] size_t size() const noexcept { return index_->size(); }
+
+    /// Reads back the glyph stored by the given key, if any.
+    [[nodiscard]] std::optional<rasterized_glyph> get(crispy::StrongHash const& _key);
+
+    /// Appends the given glyph to the cache file.
+    ///
+    /// The glyph becomes visible to get() with the next refresh().
+    void put(crispy::StrongHash const& _key, rasterized_glyph const& _glyph);
+
+    /// Indexes all glyphs that have been appended to the file since the last refresh,
+    /// also by other processes.
+    void refresh();
+
+  private:
+    glyph_disk_cache(FileSystem::path _path, int _fd, uint64_t _sizeLimit);
+
+    /// Maps the whole file and indexes all records beyond the ones indexed already.
+    ///
+    /// @p _repair truncates a trailing incomplete record, if any, and must only be used
+    ///            while holding the file lock.
+    void mapAndIndex(bool _repair);
+    void unmap() noexcept;
+
+    FileSystem::path path_;
+    int fd_ = -1;
+    uint64_t sizeLimit_;
+    char const* mapping_ = nullptr;
+    uint64_t mappingSize_ = 0;
+    uint64_t indexedSize_ = 0; // file offset up to which the records have been indexed
+    bool full_ = false;
+
+    // Maps glyph keys to the file offset of their record.
+    crispy::StrongLRUHashtable<uint64_t>::Ptr index_;
+};
+
+} // namespace text
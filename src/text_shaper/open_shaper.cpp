@@ -13,11 +13,16 @@
  */
 #include <text_shaper/font.h>
 #include <text_shaper/font_locator.h>
+#include <text_shaper/font_registry.h>
+#include <text_shaper/glyph_disk_cache.h>
 #include <text_shaper/open_shaper.h>
 
 #include <crispy/algorithm.h>
 #include <crispy/assert.h>
+#include <crispy/StrongHash.h>
+#include <crispy/MemoryStats.h>
 #include <crispy/indexed.h>
+#include <crispy/stdfs.h>
 #include <crispy/times.h>
 
 #include <unicode/convert.h>
@@ -32,18 +37,30 @@
 #include FT_ERRORS_H
 #include FT_FREETYPE_H
 #include FT_LCD_FILTER_H
+#include FT_MODULE_H
 // clang-format on
 
+// The signed distance field renderer has been added with FreeType 2.11.
+#if FREETYPE_MAJOR > 2 || (FREETYPE_MAJOR == 2 && FREETYPE_MINOR >= 11)
+    #define CONTOUR_FT_HAS_SDF 1
+#endif
+
 #include <fontconfig/fontconfig.h>
 
 #include <harfbuzz/hb-ft.h>
+#include <harfbuzz/hb-ot.h>
 #include <harfbuzz/hb.h>
 
 #include <algorithm>
+#include <array>
 #include <cmath>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
 #include <sstream>
 #include <stdexcept>
 #include <tuple>
+#include <type_traits>
 #include <unordered_map>
 #include <utility>
 
@@ -60,6 +77,7 @@ using std::optional;
 using std::ostringstream;
 using std::pair;
 using std::runtime_error;
+using std::shared_ptr;
 using std::size_t;
 using std::string;
 using std::string_view;
@@ -68,6 +86,7 @@ using std::u32string_view;
 using std::unique_ptr;
 using std::unordered_map;
 using std::vector;
+using std::weak_ptr;
 
 using namespace std::string_literals;
 using namespace std::string_view_literals;
@@ -84,11 +103,12 @@ struct FontPathAndSize
 {
     string path;
     text::font_size size;
+    text::DPI dpi;
 };
 
 [[maybe_unused]] bool operator==(FontPathAndSize const& a, FontPathAndSize const& b) noexcept
 {
-    return a.path == b.path && a.size.pt == b.size.pt;
+    return a.path == b.path && a.size.pt == b.size.pt && a.dpi == b.dpi;
 }
 
 } // namespace
@@ -101,7 +121,8 @@ struct hash<FontPathAndSize>
     size_t operator()(FontPathAndSize const& fd) const noexcept
     {
         auto fnv = crispy::FNV<char>();
-        return size_t(fnv(fnv(fd.path), to_string(fd.size.pt))); // SSO should kick in.
+        // SSO should kick in.
+        return size_t(fnv(fnv(fnv(fd.path), to_string(fd.size.pt)), to_string(fd.dpi.x)));
     }
 };
 } // namespace std
@@ -110,31 +131,164 @@ namespace text
 {
 
 using HbBufferPtr = unique_ptr<hb_buffer_t, void (*)(hb_buffer_t*)>;
+using HbBlobPtr = unique_ptr<hb_blob_t, void (*)(hb_blob_t*)>;
+using HbFacePtr = unique_ptr<hb_face_t, void (*)(hb_face_t*)>;
 using HbFontPtr = unique_ptr<hb_font_t, void (*)(hb_font_t*)>;
 using FtFacePtr = unique_ptr<FT_FaceRec_, void (*)(FT_FaceRec_*)>;
 
+/// Contents of a font file, mapped into memory once for all shapers of the process,
+/// along with its HarfBuzz face, which is immutable and thus safe to share between threads.
+///
+/// FreeType faces are not, and carry the size that has been selected for them.
+/// Each shaper therefore creates its own (per font size) on top of the shared file contents.
+struct SharedFontFile
+{
+    HbBlobPtr blob;
+    HbFacePtr hbFace;
+
+    [[nodiscard]] gsl::span<FT_Byte const> data() const noexcept
+    {
+        auto length = 0u;
+        auto const* bytes = hb_blob_get_data(blob.get(), &length);
+        return gsl::span(reinterpret_cast<FT_Byte const*>(bytes), length);
+    }
+};
+
+/**
+ * Font files in use by any shaper of the process, by their source.
+ *
+ * A font file is unmapped as soon as the last font loaded from it is released,
+ * e.g. when all sessions using it have been closed or changed their font.
+ */
+class SharedFontFileRegistry
+{
+  public:
+    static SharedFontFileRegistry& shared()
+    {
+        static auto registry = SharedFontFileRegistry {};
+        return registry;
+    }
+
+    /// @returns the contents of the given font file, mapping it into memory if not in use yet.
+    shared_ptr<SharedFontFile const> get(font_source const& _source)
+    {
+        auto const _ = std::lock_guard { lock_ };
+
+        auto const sourceId = identifier_of(_source);
+        if (auto i = files_.find(sourceId); i != files_.end())
+            if (auto file = i->second.lock())
+                return file;
+
+        auto blob = HbBlobPtr(nullptr, [](hb_blob_t* p) { hb_blob_destroy(p); });
+        if (holds_alternative<font_path>(_source))
+            // Memory-maps the file where supported.
+            blob.reset(hb_blob_create_from_file(get<font_path>(_source).value.c_str()));
+        else if (holds_alternative<font_memory_ref>(_source))
+        {
+            auto const& memory = get<font_memory_ref>(_source);
+            blob.reset(hb_blob_create(reinterpret_cast<char const*>(memory.data.data()),
+                                      static_cast<unsigned>(memory.data.size()),
+                                      HB_MEMORY_MODE_READONLY,
+                                      nullptr,
+                                      nullptr));
+        }
+        if (!blob || !hb_blob_get_length(blob.get()))
+            return nullptr;
+
+        auto hbFace = HbFacePtr(hb_face_create(blob.get(), 0), [](hb_face_t* p) { hb_face_destroy(p); });
+        hb_face_make_immutable(hbFace.get());
+        auto file = std::make_shared<SharedFontFile>(SharedFontFile { std::move(blob), std::move(hbFace) });
+
+        // Forget about the files that are not in use anymore.
+        for (auto i = files_.begin(); i != files_.end();)
+            i = i->second.expired() ? files_.erase(i) : std::next(i);
+        files_[sourceId] = file;
+
+        auto bytes = size_t { 0 };
+        for (auto const& entry: files_)
+            if (auto const liveFile = entry.second.lock())
+                bytes += liveFile->data().size();
+        memory_.update(bytes, files_.size());
+
+        return file;
+    }
+
+  private:
+    std::mutex lock_;
+    unordered_map<string, weak_ptr<SharedFontFile const>> files_;
+    crispy::MemoryStats memory_ { "Font files (mapped)" }; // as of the most recently mapped file
+};
+
 auto constexpr MissingGlyphId = 0xFFFDu;
 
+/// Codepoints below this limit (Latin, Greek, and Cyrillic) may be shaped without HarfBuzz.
+auto constexpr SimpleCodepointLimit = char32_t { 0x0530 };
+
+/// Marks an entry of HbFontInfo::cmap that has not been looked up yet.
+auto constexpr UnmappedGlyph = numeric_limits<uint32_t>::max();
+
 struct HbFontInfo
 {
     font_source primary;
     font_source_list fallbacks;
     font_size size;
+    shared_ptr<SharedFontFile const> file; // outlives the faces created from it
     FtFacePtr ftFace;
     HbFontPtr hbFont;
     std::optional<font_metrics> metrics {};
     font_description description {};
+    crispy::StrongHash glyphCacheKey {}; // identifies the font file, size, and DPI in the glyph disk cache
+
+    /// Whether simple text can be shaped by mapping codepoints to glyphs directly (see trySimpleShape()).
+    optional<bool> simpleShaping {};
+    /// Glyph indices of the codepoints below SimpleCodepointLimit, looked up upon first use.
+    vector<uint32_t> cmap {};
 };
 
 namespace
 {
-    string identifierOf(font_source const& source)
+    /// Number of DPIs whose fonts are kept loaded, such that moving a window back and forth
+    /// between screens of different DPI does not reload its fonts.
+    constexpr size_t RetainedDpiCount = 3;
+
+    /// Computes a key that identifies the given font face across launches, as long as
+    /// neither the font file nor the FreeType version changes.
+    crispy::StrongHash glyphCacheKeyOf(font_source const& source, font_size _fontSize, DPI _dpi)
     {
+        auto fingerprint = crispy::StrongHash {};
         if (holds_alternative<font_path>(source))
-            return get<font_path>(source).value;
-        if (holds_alternative<font_memory_ref>(source))
-            return get<font_memory_ref>(source).identifier;
-        throw invalid_argument("source");
+        {
+            // Using the file's size and modification time rather than hashing its contents,
+            // as font files can be many megabytes large.
+            auto const path = FileSystem::path(get<font_path>(source).value);
+            auto ec = FileSystemError {};
+            auto const fileSize = FileSystem::file_size(path, ec);
+            auto const lastWriteTime = [&]() {
+                // boost::filesystem returns a time_t, whereas std::filesystem returns a time_point.
+                auto const value = FileSystem::last_write_time(path, ec);
+                if constexpr (std::is_arithmetic_v<decltype(value)>)
+                    return static_cast<int64_t>(value);
+                else
+                    return static_cast<int64_t>(value.time_since_epoch().count());
+            }();
+            fingerprint =
+                crispy::StrongHash::compute(fmt::format("{}:{}:{}", path.string(), fileSize, lastWriteTime));
+        }
+        else
+        {
+            auto const& memory = get<font_memory_ref>(source);
+            fingerprint = crispy::StrongHash::compute(memory.identifier)
+                          * crispy::StrongHash::compute(memory.data.data(), memory.data.size());
+        }
+
+        return fingerprint
+               * crispy::StrongHash::compute(fmt::format("{}:{}x{}:{}.{}.{}",
+                                                         _fontSize.pt,
+                                                         _dpi.x,
+                                                         _dpi.y,
+                                                         FREETYPE_MAJOR,
+                                                         FREETYPE_MINOR,
+                                                         FREETYPE_PATCH));
     }
 
     // clang-format off
@@ -163,6 +317,7 @@ namespace
             case render_mode::lcd: return FT_LOAD_TARGET_LCD;
             case render_mode::color: return FT_LOAD_COLOR;
             case render_mode::gray: return FT_LOAD_DEFAULT;
+            case render_mode::sdf: return FT_LOAD_DEFAULT;
         }
         return FT_LOAD_DEFAULT;
     }
@@ -176,6 +331,11 @@ namespace
             case render_mode::light: return FT_RENDER_MODE_LIGHT;
             case render_mode::lcd: return FT_RENDER_MODE_LCD;
             case render_mode::color: return FT_RENDER_MODE_NORMAL; break;
+#if defined(CONTOUR_FT_HAS_SDF)
+            case render_mode::sdf: return FT_RENDER_MODE_SDF;
+#else
+            case render_mode::sdf: return FT_RENDER_MODE_NORMAL;
+#endif
         }
         return FT_RENDER_MODE_NORMAL;
     }
@@ -234,37 +394,21 @@ namespace
         return best;
     }
 
-    optional<FtFacePtr> loadFace(font_source const& _source, font_size _fontSize, DPI _dpi, FT_Library _ft)
+    optional<FtFacePtr> loadFace(font_source const& _source,
+                                 SharedFontFile const& _file,
+                                 font_size _fontSize,
+                                 DPI _dpi,
+                                 FT_Library _ft)
     {
         FT_Face ftFace = nullptr;
 
-        if (holds_alternative<font_path>(_source))
+        int faceIndex = 0;
+        auto const data = _file.data();
+        FT_Error ec =
+            FT_New_Memory_Face(_ft, data.data(), static_cast<FT_Long>(data.size()), faceIndex, &ftFace);
+        if (!ftFace)
         {
-            auto const& sourcePath = get<font_path>(_source);
-            FT_Error ec = FT_New_Face(_ft, sourcePath.value.c_str(), 0, &ftFace);
-            if (!ftFace)
-            {
-                // clang-format off
-                errorlog()("Failed to load font from path {}. {}", sourcePath.value, ftErrorStr(ec));
-                // clang-format on
-                return nullopt;
-            }
-        }
-        else if (holds_alternative<font_memory_ref>(_source))
-        {
-            int faceIndex = 0;
-            auto const& memory = get<font_memory_ref>(_source);
-            FT_Error ec = FT_New_Memory_Face(
-                _ft, memory.data.data(), static_cast<FT_Long>(memory.data.size()), faceIndex, &ftFace);
-            if (!ftFace)
-            {
-                errorlog()("Failed to load font from memory. {}", ftErrorStr(ec));
-                return nullopt;
-            }
-        }
-        else
-        {
-            errorlog()("Unsupported font_source type.");
+            errorlog()("Failed to load font from {}. {}", _source, ftErrorStr(ec));
             return nullopt;
         }
 
@@ -306,6 +450,29 @@ namespace
         return optional<FtFacePtr> { FtFacePtr(ftFace, [](FT_Face p) { FT_Done_Face(p); }) };
     }
 
+    /// Creates the HarfBuzz font for the given FreeType face, sharing the font file's HarfBuzz face.
+    HbFontPtr createHbFont(SharedFontFile const& _file, FT_Face _ftFace)
+    {
+        // Fonts without OpenType tables, such as PCF, can only be shaped via FreeType.
+        if (!hb_face_get_glyph_count(_file.hbFace.get()))
+            return HbFontPtr(hb_ft_font_create_referenced(_ftFace), [](hb_font_t* p) { hb_font_destroy(p); });
+
+        auto hbFont = HbFontPtr(hb_font_create(_file.hbFace.get()), [](hb_font_t* p) { hb_font_destroy(p); });
+        hb_ot_font_set_funcs(hbFont.get());
+
+        // Same scale as hb_ft_font_create() derives from the face's size.
+        auto const scale = [&](FT_Fixed _ftScale) {
+            return static_cast<int>(
+                (static_cast<uint64_t>(_ftScale) * static_cast<uint64_t>(_ftFace->units_per_EM) + (1u << 15))
+                >> 16);
+        };
+        hb_font_set_scale(
+            hbFont.get(), scale(_ftFace->size->metrics.x_scale), scale(_ftFace->size->metrics.y_scale));
+        hb_font_set_ppem(hbFont.get(), _ftFace->size->metrics.x_ppem, _ftFace->size->metrics.y_ppem);
+        hb_font_make_immutable(hbFont.get());
+        return hbFont;
+    }
+
     void replaceMissingGlyphs(FT_Face _ftFace, shape_result& _result)
     {
         auto const missingGlyph = FT_Get_Char_Index(_ftFace, MissingGlyphId);
@@ -318,6 +485,102 @@ namespace
                 gpos.glyph.index = glyph_index { missingGlyph };
     }
 
+    /// Tests whether the given codepoint looks the same with or without text shaping,
+    /// i.e. it is neither a control character, a default ignorable, nor a combining mark.
+    constexpr bool isSimpleCodepoint(char32_t _codepoint) noexcept
+    {
+        if (_codepoint < 0x20 || (_codepoint >= 0x7F && _codepoint < 0xA0) || _codepoint == 0xAD)
+            return false;
+        if (_codepoint >= 0x0300 && _codepoint < 0x0370) // Combining Diacritical Marks
+            return false;
+        if (_codepoint >= 0x0483 && _codepoint < 0x048A) // Combining Cyrillic
+            return false;
+        return _codepoint < SimpleCodepointLimit;
+    }
+
+    /// Tests whether HarfBuzz would by default apply neither substitutions nor positioning with
+    /// the given font (such as ligatures or kerning), that make simple text look different from
+    /// the glyphs of its cmap placed at fixed advances.
+    bool supportsSimpleShaping(HbFontInfo const& _fontInfo)
+    {
+        if (!FT_IS_FIXED_WIDTH(_fontInfo.ftFace.get()) || !_fontInfo.description.features.empty())
+            return false;
+
+        auto* hbFace = hb_font_get_face(_fontInfo.hbFont.get());
+        auto const hasAnyFeature = [&](hb_tag_t _table, std::initializer_list<hb_tag_t> _features) {
+            auto tags = std::array<hb_tag_t, 64> {};
+            auto offset = 0u;
+            auto count = 0u;
+            do
+            {
+                count = static_cast<unsigned>(tags.size());
+                hb_ot_layout_table_get_feature_tags(hbFace, _table, offset, &count, tags.data());
+                for (auto const i: iota(0u, count))
+                    if (std::find(_features.begin(), _features.end(), tags[i]) != _features.end())
+                        return true;
+                offset += count;
+            } while (count == tags.size());
+            return false;
+        };
+
+        return !hasAnyFeature(HB_OT_TAG_GSUB,
+                              { HB_TAG('l', 'i', 'g', 'a'),
+                                HB_TAG('c', 'l', 'i', 'g'),
+                                HB_TAG('c', 'a', 'l', 't'),
+                                HB_TAG('r', 'l', 'i', 'g'),
+                                HB_TAG('r', 'c', 'l', 't') })
+               && !hasAnyFeature(HB_OT_TAG_GPOS, { HB_TAG('k', 'e', 'r', 'n') });
+    }
+
+    /// Shapes text consisting of simple codepoints only by mapping each codepoint to its glyph
+    /// via the font's cached cmap, placed at the font's fixed advance.
+    ///
+    /// @retval false the text must be shaped by HarfBuzz instead, leaving @p _result untouched.
+    bool trySimpleShape(font_key _font,
+                        HbFontInfo& _fontInfo,
+                        int _advance,
+                        unicode::PresentationStyle _presentation,
+                        u32string_view _codepoints,
+                        shape_result& _result)
+    {
+        if (_presentation == unicode::PresentationStyle::Emoji)
+            return false;
+
+        if (!_fontInfo.simpleShaping.has_value())
+            _fontInfo.simpleShaping = supportsSimpleShaping(_fontInfo);
+        if (!*_fontInfo.simpleShaping)
+            return false;
+        if (!std::all_of(_codepoints.begin(), _codepoints.end(), isSimpleCodepoint))
+            return false;
+
+        if (_fontInfo.cmap.empty())
+            _fontInfo.cmap.resize(SimpleCodepointLimit, UnmappedGlyph);
+
+        auto const initialResultOffset = _result.size();
+        for (char32_t const codepoint: _codepoints)
+        {
+            auto& glyphIndex = _fontInfo.cmap[codepoint];
+            if (glyphIndex == UnmappedGlyph)
+                glyphIndex = FT_Get_Char_Index(_fontInfo.ftFace.get(), codepoint);
+            if (!glyphIndex)
+            {
+                // Leave picking a fallback font to HarfBuzz shaping.
+                _result.resize(initialResultOffset);
+                return false;
+            }
+
+            glyph_position gpos {};
+            gpos.glyph = glyph_key { _fontInfo.size, _font, glyph_index { glyphIndex } };
+#if defined(GLYPH_KEY_DEBUG)
+            gpos.glyph.text = std::u32string(1, codepoint);
+#endif
+            gpos.advance.x = _advance;
+            gpos.presentation = _presentation;
+            _result.emplace_back(gpos);
+        }
+        return true;
+    }
+
     void prepareBuffer(hb_buffer_t* _hbBuf,
                        u32string_view _codepoints,
                        gsl::span<unsigned> _clusters,
@@ -397,6 +660,7 @@ struct open_shaper::Private // {{{
     FT_Library ft_ {};
     font_locator* locator_ = nullptr;
     DPI dpi_;
+    std::vector<DPI> recentDpis_; // most recently used first, see retainDpi()
     unordered_map<FontPathAndSize, font_key> fontPathAndSizeToKeyMapping;
     unordered_map<font_key, HbFontInfo> fontKeyToHbFontInfoMapping; // from font_key to FontInfo struct
 
@@ -407,15 +671,8 @@ struct open_shaper::Private // {{{
     // (file_path, file_mtime, font_weight, font_slant, pixel_size)
 
     unordered_map<glyph_key, rasterized_glyph> glyphs_;
+    glyph_disk_cache* glyphCache_ = nullptr;
     HbBufferPtr hb_buf_;
-    font_key nextFontKey_;
-
-    font_key create_font_key()
-    {
-        auto result = nextFontKey_;
-        nextFontKey_.value++;
-        return result;
-    }
 
     [[nodiscard]] bool has_color(font_key _font) const noexcept
     {
@@ -424,15 +681,23 @@ struct open_shaper::Private // {{{
 
     optional<font_key> getOrCreateKeyForFont(font_source const& source, font_size _fontSize)
     {
-        auto const sourceId = identifierOf(source);
-        if (auto i = fontPathAndSizeToKeyMapping.find(FontPathAndSize { sourceId, _fontSize });
+        auto const sourceId = identifier_of(source);
+        if (auto i = fontPathAndSizeToKeyMapping.find(FontPathAndSize { sourceId, _fontSize, dpi_ });
             i != fontPathAndSizeToKeyMapping.end())
             return i->second;
 
         if (ranges::any_of(blacklistedSources, [&](auto const& a) { return a == sourceId; }))
             return nullopt;
 
-        auto ftFacePtrOpt = loadFace(source, _fontSize, dpi_, ft_);
+        auto file = SharedFontFileRegistry::shared().get(source);
+        if (!file)
+        {
+            errorlog()("Failed to read font file {}.", source);
+            blacklistedSources.emplace_back(sourceId);
+            return nullopt;
+        }
+
+        auto ftFacePtrOpt = loadFace(source, *file, _fontSize, dpi_, ft_);
         if (!ftFacePtrOpt.has_value())
         {
             blacklistedSources.emplace_back(sourceId);
@@ -440,13 +705,15 @@ struct open_shaper::Private // {{{
         }
 
         auto ftFacePtr = std::move(ftFacePtrOpt.value());
-        auto hbFontPtr =
-            HbFontPtr(hb_ft_font_create_referenced(ftFacePtr.get()), [](auto p) { hb_font_destroy(p); });
+        auto hbFontPtr = createHbFont(*file, ftFacePtr.get());
 
-        auto fontInfo = HbFontInfo { source, {}, _fontSize, std::move(ftFacePtr), std::move(hbFontPtr) };
+        auto fontInfo = HbFontInfo {
+            source, {}, _fontSize, std::move(file), std::move(ftFacePtr), std::move(hbFontPtr)
+        };
+        fontInfo.glyphCacheKey = glyphCacheKeyOf(source, _fontSize, dpi_);
 
-        auto key = create_font_key();
-        fontPathAndSizeToKeyMapping.emplace(pair { FontPathAndSize { sourceId, _fontSize }, key });
+        auto key = font_key_registry::shared().get_or_create(source, _fontSize, dpi_);
+        fontPathAndSizeToKeyMapping.emplace(pair { FontPathAndSize { sourceId, _fontSize, dpi_ }, key });
         fontKeyToHbFontInfoMapping.emplace(pair { key, std::move(fontInfo) });
         LocatorLog()("Loading font: key={}, id=\"{}\" size={} dpi {} {}",
                      key,
@@ -457,6 +724,49 @@ struct open_shaper::Private // {{{
         return key;
     }
 
+    /// @returns the font info of the given font key, loading the font if it has been loaded by
+    ///          another shaper only (e.g. a fallback font used in a shared shaping result).
+    HbFontInfo* fontInfoOf(font_key _key)
+    {
+        if (auto i = fontKeyToHbFontInfoMapping.find(_key); i != fontKeyToHbFontInfoMapping.end())
+            return &i->second;
+
+        auto const font = font_key_registry::shared().font_of(_key);
+        if (!font)
+            return nullptr;
+
+        // The key only equals if the font has been created for the same DPI.
+        auto const key = getOrCreateKeyForFont(font->first, font->second);
+        if (!key || !(*key == _key))
+            return nullptr;
+
+        return &fontKeyToHbFontInfoMapping.at(_key);
+    }
+
+    /// Marks the given DPI as the most recently used one, unloading the fonts of the least recently
+    /// used DPI if more than RetainedDpiCount DPIs are in use.
+    void retainDpi(DPI _dpi)
+    {
+        recentDpis_.erase(std::remove(recentDpis_.begin(), recentDpis_.end(), _dpi), recentDpis_.end());
+        recentDpis_.insert(recentDpis_.begin(), _dpi);
+        if (recentDpis_.size() <= RetainedDpiCount)
+            return;
+
+        auto const evictedDpi = recentDpis_.back();
+        recentDpis_.pop_back();
+        for (auto i = fontPathAndSizeToKeyMapping.begin(); i != fontPathAndSizeToKeyMapping.end();)
+        {
+            if (i->first.dpi != evictedDpi)
+            {
+                ++i;
+                continue;
+            }
+            fontKeyToHbFontInfoMapping.erase(i->second);
+            i = fontPathAndSizeToKeyMapping.erase(i);
+        }
+        LocatorLog()("Unloaded fonts of DPI {}.", evictedDpi);
+    }
+
     font_metrics metrics(font_key _key)
     {
         Require(fontKeyToHbFontInfoMapping.count(_key) == 1);
@@ -483,14 +793,23 @@ struct open_shaper::Private // {{{
         ft_ {},
         locator_ { &_locator },
         dpi_ { _dpi },
-        hb_buf_(hb_buffer_create(), [](auto p) { hb_buffer_destroy(p); }),
-        nextFontKey_ {}
+        recentDpis_ { _dpi },
+        hb_buf_(hb_buffer_create(), [](auto p) { hb_buffer_destroy(p); })
     {
         if (auto const ec = FT_Init_FreeType(&ft_); ec != FT_Err_Ok)
             throw runtime_error { "freetype: Failed to initialize. "s + ftErrorStr(ec) };
 
         if (auto const ec = FT_Library_SetLcdFilter(ft_, FT_LCD_FILTER_DEFAULT); ec != FT_Err_Ok)
             errorlog()("freetype: Failed to set LCD filter. {}", ftErrorStr(ec));
+
+#if defined(CONTOUR_FT_HAS_SDF)
+        // Keep the distance field's margin around the glyphs small (default: 8 pixels),
+        // as glyphs must fit into the grid cell.
+        FT_Int spread = 2;
+        for (auto const module: { "sdf", "bsdf" })
+            if (auto const ec = FT_Property_Set(ft_, module, "spread", &spread); ec != FT_Err_Ok)
+                errorlog()("freetype: Failed to set SDF spread. {}", ftErrorStr(ec));
+#endif
     }
 
     bool tryShapeWithFallback(font_key _font,
@@ -509,13 +828,12 @@ struct open_shaper::Private // {{{
                 _font, _fontInfo, _hbBuf, _hbFont, _script, _presentation, _codepoints, _clusters, _result))
             return true;
 
-        for (font_source const& fallbackFont: _fontInfo.fallbacks)
-        {
+        auto const tryShapeWithFallbackFont = [&](font_source const& fallbackFont) -> bool {
             _result.resize(initialResultOffset); // rollback to initial size
 
             optional<font_key> fallbackKeyOpt = getOrCreateKeyForFont(fallbackFont, _fontInfo.size);
             if (!fallbackKeyOpt.has_value())
-                continue;
+                return false;
 
             // Skip if main font is monospace but fallbacks font is not.
             if (_fontInfo.description.strict_spacing
@@ -525,7 +843,7 @@ struct open_shaper::Private // {{{
                 HbFontInfo const& fallbackFontInfo = fontKeyToHbFontInfoMapping.at(fallbackKeyOpt.value());
                 bool const fontIsMonospace = fallbackFontInfo.ftFace->face_flags & FT_FACE_FLAG_FIXED_WIDTH;
                 if (!fontIsMonospace)
-                    continue;
+                    return false;
             }
 
             Require(fontKeyToHbFontInfoMapping.count(fallbackKeyOpt.value()) == 1);
@@ -535,16 +853,46 @@ struct open_shaper::Private // {{{
                              fallbackKeyOpt.value(),
                              fallbackFontInfo.primary);
             // clang-format on
-            if (tryShape(fallbackKeyOpt.value(),
-                         fallbackFontInfo,
-                         _hbBuf,
-                         fallbackFontInfo.hbFont.get(),
-                         _script,
-                         _presentation,
-                         _codepoints,
-                         _clusters,
-                         _result))
+            return tryShape(fallbackKeyOpt.value(),
+                            fallbackFontInfo,
+                            _hbBuf,
+                            fallbackFontInfo.hbFont.get(),
+                            _script,
+                            _presentation,
+                            _codepoints,
+                            _clusters,
+                            _result);
+        };
+
+        auto& fallbackFontCache = fallback_font_cache::shared();
+        auto const primaryId = identifier_of(_fontInfo.primary);
+        auto const leadingCodepoint = _codepoints.empty() ? char32_t { 0 } : _codepoints[0];
+
+        // Try the fallback font first that has been used for this block of codepoints before.
+        auto const cachedFallbackId = fallbackFontCache.get(primaryId, leadingCodepoint);
+        if (cachedFallbackId)
+        {
+            for (font_source const& fallbackFont: _fontInfo.fallbacks)
+            {
+                if (identifier_of(fallbackFont) != *cachedFallbackId)
+                    continue;
+                if (tryShapeWithFallbackFont(fallbackFont))
+                    return true;
+                break;
+            }
+        }
+
+        for (font_source const& fallbackFont: _fontInfo.fallbacks)
+        {
+            auto fallbackId = identifier_of(fallbackFont);
+            if (fallbackId == cachedFallbackId)
+                continue;
+
+            if (tryShapeWithFallbackFont(fallbackFont))
+            {
+                fallbackFontCache.set(primaryId, leadingCodepoint, std::move(fallbackId));
                 return true;
+            }
         }
 
         return false;
@@ -562,6 +910,7 @@ void open_shaper::set_dpi(DPI _dpi)
         return;
 
     d->dpi_ = _dpi;
+    d->retainDpi(_dpi);
 }
 
 void open_shaper::set_locator(font_locator& _locator)
@@ -576,10 +925,30 @@ void open_shaper::clear_cache()
                  d->fontKeyToHbFontInfoMapping.size());
     d->fontPathAndSizeToKeyMapping.clear();
     d->fontKeyToHbFontInfoMapping.clear();
+    d->recentDpis_ = { d->dpi_ };
+}
+
+void open_shaper::set_glyph_cache(glyph_disk_cache* _cache)
+{
+    d->glyphCache_ = _cache;
+}
+
+optional<crispy::StrongHash> open_shaper::glyph_cache_key(glyph_key const& _glyph, render_mode _mode)
+{
+    HbFontInfo const* fontInfo = d->fontInfoOf(_glyph.font);
+    if (!fontInfo)
+        return nullopt;
+
+    return fontInfo->glyphCacheKey
+           * crispy::StrongHash(0, 0, static_cast<uint32_t>(_mode), _glyph.index.value);
 }
 
 optional<font_key> open_shaper::load_font(font_description const& _description, font_size _size)
 {
+    // Pick up the glyphs stored since, e.g. before a change of the font size.
+    if (d->glyphCache_)
+        d->glyphCache_->refresh();
+
     font_source_list sources = d->locator_->locate(_description);
     if (sources.empty())
         return nullopt;
@@ -672,9 +1041,12 @@ void open_shaper::shape(font_key _font,
         for (auto [i, codepoint]: crispy::indexed(_codepoints))
             logMessage.append(" {}:U+{:x}", _clusters[i], static_cast<unsigned>(codepoint));
         logMessage.append("\n");
-        logMessage.append("Using font: key={}, path=\"{}\"\n", _font, identifierOf(fontInfo.primary));
+        logMessage.append("Using font: key={}, path=\"{}\"\n", _font, identifier_of(fontInfo.primary));
     }
 
+    if (trySimpleShape(_font, fontInfo, metrics(_font).advance, _presentation, _codepoints, _result))
+        return;
+
     if (d->tryShapeWithFallback(
             _font, fontInfo, hbBuf, hbFont, _script, _presentation, _codepoints, _clusters, _result))
         return;
@@ -722,9 +1094,18 @@ void open_shaper::shape(font_key _font,
 
 optional<rasterized_glyph> open_shaper::rasterize(glyph_key _glyph, render_mode _mode)
 {
-    auto const font = _glyph.font;
-    auto ftFace = d->fontKeyToHbFontInfoMapping.at(font).ftFace.get();
+    HbFontInfo const* fontInfoPtr = d->fontInfoOf(_glyph.font);
+    if (!fontInfoPtr)
+        return nullopt;
+
+    HbFontInfo const& fontInfo = *fontInfoPtr;
+    auto ftFace = fontInfo.ftFace.get();
     auto const glyphIndex = _glyph.index;
+
+    auto const cacheKey = *glyph_cache_key(_glyph, _mode);
+    if (d->glyphCache_)
+        if (auto cachedGlyph = d->glyphCache_->get(cacheKey))
+            return cachedGlyph;
     auto const flags =
         static_cast<FT_Int32>(ftRenderFlag(_mode) | (FT_HAS_COLOR(ftFace) ? FT_LOAD_COLOR : 0));
 
@@ -872,6 +1253,9 @@ optional<rasterized_glyph> open_shaper::rasterize(glyph_key _glyph, render_mode
     if (RasterizerLog)
         RasterizerLog()("rasterize {} to {}", _glyph, output);
 
+    if (d->glyphCache_)
+        d->glyphCache_->put(cacheKey, output);
+
     return output;
 }
 
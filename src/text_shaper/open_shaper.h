@@ -54,6 +54,12 @@ class open_shaper: public shaper
 
     [[nodiscard]] std::optional<rasterized_glyph> rasterize(glyph_key _glyph, render_mode _mode) override;
 
+    void set_glyph_cache(glyph_disk_cache* _cache) override;
+    [[nodiscard]] std::optional<crispy::StrongHash> glyph_cache_key(glyph_key const& _glyph,
+                                                                    render_mode _mode) override;
+
+    [[nodiscard]] bool has_shared_font_keys() const noexcept override { return true; }
+
   private:
     struct Private;
     std::unique_ptr<Private, void (*)(Private*)> d;
@@ -18,9 +18,19 @@
 
 #include <range/v3/view/iota.hpp>
 
+#include <algorithm>
+#include <cstring>
 #include <utility>
 #include <vector>
 
+#if defined(__SSE2__)
+    #include <immintrin.h>
+    #define TEXT_SHAPER_SCALE_SIMD 1
+#elif defined(__aarch64__)
+    #include <crispy/sse2neon.h>
+    #define TEXT_SHAPER_SCALE_SIMD 1
+#endif
+
 using std::max;
 using std::min;
 using std::tuple;
@@ -33,37 +43,81 @@ namespace text
 
 namespace
 {
+    /// Adds up the components of each run of @p _factor pixels of the given row
+    /// to the sums of the output pixel the run is averaged into.
     template <std::size_t NumComponents>
-    constexpr void scaleDownExplicit(vector<uint8_t> const& inputBitmap,
-                                     crispy::ImageSize inputSize,
-                                     crispy::ImageSize outputSize,
-                                     size_t factor,
-                                     vector<uint8_t>& outputBitmap) noexcept
+    void accumulateRow(uint8_t const* _row,
+                       size_t _inputWidth,
+                       size_t _outputWidth,
+                       size_t _factor,
+                       uint32_t* _sums) noexcept
     {
-        outputBitmap.resize(outputSize.area() * NumComponents);
-        uint8_t* d = outputBitmap.data();
-        for (size_t i = 0, sr = 0; i < *outputSize.height; i++, sr += factor)
+        for (size_t j = 0; j < _outputWidth; ++j)
         {
-            for (size_t j = 0, sc = 0; j < *outputSize.width; j++, sc += factor, d += 4)
+            auto const x0 = min(j * _factor, _inputWidth);
+            auto const x1 = min(x0 + _factor, _inputWidth);
+#if defined(TEXT_SHAPER_SCALE_SIMD)
+            if constexpr (NumComponents == 4)
             {
-                // calculate area average
-                std::array<unsigned int, NumComponents> components { {} };
-                unsigned int count = 0;
-                for (size_t y = sr; y < min(sr + factor, unbox<size_t>(inputSize.height)); y++)
+                // All four components of a pixel are summed up at once.
+                auto const zero = _mm_setzero_si128();
+                auto sum = _mm_loadu_si128(reinterpret_cast<__m128i const*>(_sums + j * 4));
+                for (auto x = x0; x < x1; ++x)
                 {
-                    uint8_t const* p = inputBitmap.data() + (y * unbox<size_t>(inputSize.width) * 4) + sc * 4;
-                    for (auto x = sc; x < min(sc + factor, unbox<size_t>(inputSize.width)); x++, count++)
-                    {
-                        for (size_t i = 0; i < NumComponents; ++i)
-                            components[i] += *(p++);
-                    }
+                    int32_t pixel = 0;
+                    std::memcpy(&pixel, _row + x * 4, 4);
+                    auto const components =
+                        _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(pixel), zero), zero);
+                    sum = _mm_add_epi32(sum, components);
                 }
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(_sums + j * 4), sum);
+                continue;
+            }
+#endif
+            for (auto x = x0; x < x1; ++x)
+                for (size_t i = 0; i < NumComponents; ++i)
+                    _sums[j * 4 + i] += _row[x * NumComponents + i];
+        }
+    }
+
+    /// Scales the given bitmap down by averaging each block of @p factor x @p factor pixels
+    /// (clipped to the input) into one output pixel.
+    template <std::size_t NumComponents>
+    void scaleDownExplicit(vector<uint8_t> const& inputBitmap,
+                           crispy::ImageSize inputSize,
+                           crispy::ImageSize outputSize,
+                           size_t factor,
+                           vector<uint8_t>& outputBitmap) noexcept
+    {
+        auto const inputWidth = unbox<size_t>(inputSize.width);
+        auto const inputHeight = unbox<size_t>(inputSize.height);
+        auto const outputWidth = unbox<size_t>(outputSize.width);
+
+        outputBitmap.resize(outputSize.area() * NumComponents);
 
+        // Component sums of the output row's pixels, padded to four components each.
+        auto sums = vector<uint32_t>(outputWidth * 4);
+
+        uint8_t* d = outputBitmap.data();
+        for (size_t i = 0; i < unbox<size_t>(outputSize.height); i++)
+        {
+            auto const y0 = min(i * factor, inputHeight);
+            auto const y1 = min(y0 + factor, inputHeight);
+
+            std::fill(sums.begin(), sums.end(), 0);
+            for (auto y = y0; y < y1; ++y)
+            {
+                uint8_t const* row = inputBitmap.data() + y * inputWidth * NumComponents;
+                accumulateRow<NumComponents>(row, inputWidth, outputWidth, factor, sums.data());
+            }
+
+            for (size_t j = 0; j < outputWidth; j++, d += NumComponents)
+            {
+                auto const x0 = min(j * factor, inputWidth);
+                auto const count = static_cast<uint32_t>((y1 - y0) * (min(x0 + factor, inputWidth) - x0));
                 if (count)
-                {
-                    for (size_t i = 0; i < NumComponents; ++i)
-                        d[i] = static_cast<uint8_t>(components[i] / count);
-                }
+                    for (size_t k = 0; k < NumComponents; ++k)
+                        d[k] = static_cast<uint8_t>(sums[j * 4 + k] / count);
             }
         }
     }
@@ -16,6 +16,7 @@
 #include <text_shaper/font.h>
 
 #include <crispy/ImageSize.h>
+#include <crispy/StrongHash.h>
 #include <crispy/logstore.h>
 #include <crispy/point.h>
 #include <crispy/size.h>
@@ -91,6 +92,7 @@ struct glyph_position
 using shape_result = std::vector<glyph_position>;
 
 class font_locator;
+class glyph_disk_cache;
 
 /**
  * Platform-independent font loading, text shaping, and glyph rendering API.
@@ -160,6 +162,32 @@ class shaper
      * @param _mode  render technique to use.
      */
     [[nodiscard]] virtual std::optional<rasterized_glyph> rasterize(glyph_key _glyph, render_mode _mode) = 0;
+
+    /**
+     * Configures an on-disk cache for rasterized glyphs to be used, or none if nullptr.
+     *
+     * Shapers that cannot identify their fonts across launches ignore the cache.
+     */
+    virtual void set_glyph_cache(glyph_disk_cache* _cache) { (void) _cache; }
+
+    /**
+     * @returns the key identifying the given glyph rasterized with the given render mode
+     *          in the on-disk glyph cache, or std::nullopt if the shaper cannot identify
+     *          the glyph's font across launches.
+     */
+    [[nodiscard]] virtual std::optional<crispy::StrongHash> glyph_cache_key(glyph_key const& _glyph,
+                                                                            render_mode _mode)
+    {
+        (void) _glyph;
+        (void) _mode;
+        return std::nullopt;
+    }
+
+    /**
+     * Tests whether a font key identifies the same font in all shapers of this kind within the process,
+     * such that shaping results of one shaper can be used with another one.
+     */
+    [[nodiscard]] virtual bool has_shared_font_keys() const noexcept { return false; }
 };
 
 } // end namespace text